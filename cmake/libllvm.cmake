@@ -13,7 +13,7 @@ if(LLVM_CONFIG_PATH)
 	execute_process(COMMAND ${LLVM_CONFIG_PATH} --includedir OUTPUT_VARIABLE LLVM_INCLUDE_PATH OUTPUT_STRIP_TRAILING_WHITESPACE)
 	execute_process(COMMAND ${LLVM_CONFIG_PATH} --cppflags OUTPUT_VARIABLE LLVM_LIB_FLAGS OUTPUT_STRIP_TRAILING_WHITESPACE)
 	execute_process(COMMAND ${LLVM_CONFIG_PATH} --version OUTPUT_VARIABLE LLVM_LIB_VERSION OUTPUT_STRIP_TRAILING_WHITESPACE)
-	execute_process(COMMAND ${LLVM_CONFIG_PATH} --libs core irreader bitreader OUTPUT_VARIABLE LLVM_LIB_NAMES OUTPUT_STRIP_TRAILING_WHITESPACE)
+	execute_process(COMMAND ${LLVM_CONFIG_PATH} --libs core irreader bitreader bitwriter linker ipo scalaropts instcombine vectorize OUTPUT_VARIABLE LLVM_LIB_NAMES OUTPUT_STRIP_TRAILING_WHITESPACE)
 	# Additional system libraries, e.g. required for SPIRV-LLVM on raspberry, not for "default" LLVM on my development machine
 	execute_process(COMMAND ${LLVM_CONFIG_PATH} --system-libs OUTPUT_VARIABLE LLVM_SYSTEM_LIB_NAMES OUTPUT_STRIP_TRAILING_WHITESPACE)
 	# The --shared-mode option does not exist for e.g. SPIRV-LLVM, but we can ignore it and assume static linking
@@ -48,7 +48,7 @@ else()
 		if(LLVM_SHARED_LIBRARY)
 			set(LLVM_LIB_NAMES ${LLVM_SHARED_LIBRARY})
 		else()
-			llvm_map_components_to_libnames(LLVM_LIB_NAMES core irreader bitreader)
+			llvm_map_components_to_libnames(LLVM_LIB_NAMES core irreader bitreader bitwriter linker ipo scalaropts instcombine vectorize)
 		endif()
 		set(LLVM_SYSTEM_LIB_NAMES "")
 	endif()
@@ -0,0 +1,110 @@
+/*
+ * Header for the public C++-interface to the persistent compilation cache
+ *
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_COMPILATION_CACHE_H
+#define VC4C_COMPILATION_CACHE_H
+
+#include "Optional.h"
+#include "config.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace vc4c
+{
+    /*
+     * Statistics about the usage of the compilation cache
+     */
+    struct CompilationCacheStatistics
+    {
+        /*
+         * The number of compilations (within this process) which were answered from the cache
+         */
+        std::size_t numHits = 0;
+        /*
+         * The number of compilations (within this process) which were not found in the cache
+         */
+        std::size_t numMisses = 0;
+        /*
+         * The number of compilation results (within this process) which were added to the cache
+         */
+        std::size_t numInsertions = 0;
+        /*
+         * The number of cache entries (within this process) which were removed to stay within the size limit
+         */
+        std::size_t numEvictions = 0;
+        /*
+         * The number of entries currently stored in the cache directory
+         */
+        std::size_t numEntries = 0;
+        /*
+         * The accumulated size (in bytes) of all entries currently stored in the cache directory
+         */
+        std::size_t totalSize = 0;
+
+        std::string to_string() const;
+    };
+
+    /*
+     * Persistent, content-addressed cache for compilation results.
+     *
+     * The key of an entry is a hash over the input code, the compiler options, the relevant fields of the
+     * Configuration, the compiler version and the paths, sizes and modification times of the compiler library and the
+     * VC4CL standard-library files. Inputs including other files are not cached, since the key does not cover the
+     * contents of the included files (see #isCacheable()).
+     *
+     * The entries are stored as single files in the cache directory, which can be shared between processes.
+     * Additionally, the most recently used entries are kept in memory, so repeated compilations of unchanged input
+     * within a single process are answered without accessing the file-system.
+     */
+    class CompilationCache
+    {
+    public:
+        /*
+         * Returns whether the compilation result of the given input data and additional compiler options can be
+         * cached, i.e. the input does not include any other file (e.g. by an #include directive or an -include
+         * option) whose contents would need to be part of the key.
+         */
+        static bool isCacheable(const std::string& inputData, const std::string& options);
+
+        /*
+         * Calculates the cache-key for the given input data, configuration and additional compiler options
+         */
+        static std::string calculateKey(
+            const std::string& inputData, const Configuration& config, const std::string& options);
+
+        /*
+         * Tries to find the compilation result for the given key in the cache directory configured in the given
+         * configuration.
+         *
+         * On success, the cached result is written to the output and the number of bytes originally returned by the
+         * compilation is returned.
+         */
+        static Optional<std::size_t> lookup(const std::string& key, const Configuration& config, std::ostream& output);
+
+        /*
+         * Stores the compilation result for the given key in the cache directory configured in the given
+         * configuration and evicts the least recently used entries if the maximum cache size is exceeded.
+         */
+        static void insert(
+            const std::string& key, const Configuration& config, const std::string& result, std::size_t bytesWritten);
+
+        /*
+         * Removes all entries in the given cache directory
+         */
+        static void clear(const std::string& cacheDirectory);
+
+        /*
+         * Returns the usage statistics for the given cache directory
+         */
+        static CompilationCacheStatistics getStatistics(const std::string& cacheDirectory);
+    };
+} // namespace vc4c
+
+#endif /* VC4C_COMPILATION_CACHE_H */
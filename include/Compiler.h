@@ -9,12 +9,18 @@
 #ifndef COMPILER_H
 #define COMPILER_H
 
+#include "CompilationError.h"
 #include "Optional.h"
 #include "config.h"
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <vector>
 
 namespace vc4c
 {
@@ -34,6 +40,65 @@ namespace vc4c
         SEVERE = 'S'
     };
 
+    struct CompilationState;
+
+    /*
+     * Callback notified whenever a compilation stage starts. For the stages run per kernel (normalization,
+     * optimization and code generation), the name of the kernel is given, otherwise the name is empty.
+     *
+     * NOTE: The callback is called from the threads running the compilation, concurrently for different kernels.
+     */
+    using ProgressCallback = std::function<void(CompilationStep step, const std::string& kernelName)>;
+
+    /*
+     * Handle to a compilation running asynchronously, see Compiler#compileAsync()
+     */
+    class CompilationHandle
+    {
+    public:
+        CompilationHandle(const CompilationHandle&) = delete;
+        CompilationHandle(CompilationHandle&& other) noexcept;
+        /*
+         * Cancels the compilation and waits for it to stop, if it is still running
+         */
+        ~CompilationHandle();
+
+        CompilationHandle& operator=(const CompilationHandle&) = delete;
+        CompilationHandle& operator=(CompilationHandle&&) noexcept = delete;
+
+        /*
+         * Waits for the compilation to finish and returns the number of bytes written (see Compiler#compile()).
+         *
+         * If the compilation failed or was cancelled, the error is re-thrown. The result can only be retrieved once.
+         */
+        std::size_t get();
+
+        /*
+         * Returns whether the compilation has finished (successfully or not)
+         */
+        bool isFinished() const;
+
+        /*
+         * Waits at most the given duration for the compilation to finish and returns whether it has finished
+         */
+        bool waitFor(std::chrono::milliseconds duration) const;
+
+        /*
+         * Requests the compilation to be cancelled.
+         *
+         * The cancellation is cooperative: It is checked at the start of every compilation stage and between the
+         * optimization passes, so the compilation might continue for a short while.
+         */
+        void cancel();
+
+    private:
+        std::shared_ptr<CompilationState> state;
+        std::future<void> future;
+
+        CompilationHandle(std::shared_ptr<CompilationState>&& state, std::future<void>&& future);
+        friend class Compiler;
+    };
+
     /*
      * Base class for the compilation process
      */
@@ -69,10 +134,126 @@ namespace vc4c
         static std::size_t compile(std::istream& input, std::ostream& output, const Configuration& config = {},
             const std::string& options = "", const Optional<std::string>& inputFile = {});
 
+        /*
+         * Starts compiling a single input with the given configuration into the given output asynchronously and returns
+         * the handle to wait for the result or to cancel the compilation.
+         *
+         * The compilation runs on the process-wide thread pool shared by all compilations (see
+         * setMaximumCompilationThreads()), so building multiple programs concurrently does not over-subscribe the CPU.
+         *
+         * NOTE: The input and output streams need to be valid until the compilation has finished!
+         *
+         * \param progress the optional callback to be notified of the compilation progress
+         * \see #compile() for the other parameters
+         */
+        static CompilationHandle compileAsync(std::istream& input, std::ostream& output,
+            const Configuration& config = {}, const std::string& options = "",
+            const Optional<std::string>& inputFile = {}, ProgressCallback progress = {});
+
+        /*
+         * Helper-function to compile a single input with the given configuration into binary machine code kept in
+         * memory, e.g. to be directly passed to the VideoCore IV GPU without writing it to a stream or file first.
+         *
+         * The output-mode of the given configuration is ignored, the code is always generated in binary output-mode.
+         *
+         * \param input The input stream
+         * \param config The configuration to use for compilation
+         * \param options Specify additional compiler-options to pass onto the pre-compiler
+         * \param inputFile see #compile()
+         * \return the generated binary (module header, global data and kernel code)
+         */
+        static std::vector<uint8_t> compileToBinary(std::istream& input, const Configuration& config = {},
+            const std::string& options = "", const Optional<std::string>& inputFile = {});
+
+        /*
+         * Helper-function to compile a single input only up to the module-wide preparation steps and to write the
+         * prepared module as relocatable object into the given output.
+         *
+         * The relocatable object contains the kernels of the input and the global data referenced by name, but no
+         * machine code. Multiple objects (e.g. compiled in parallel on different machines) are combined into a single
+         * module via #linkObjects().
+         *
+         * \param input The input stream
+         * \param output The output-stream to write the relocatable object to
+         * \param config The configuration to use for compilation
+         * \param options Specify additional compiler-options to pass onto the pre-compiler
+         * \param inputFile see #compile()
+         * \return the number of bytes written
+         */
+        static std::size_t compileObject(std::istream& input, std::ostream& output, const Configuration& config = {},
+            const std::string& options = "", const Optional<std::string>& inputFile = {});
+
+        /*
+         * Helper-function to link the given relocatable objects (see #compileObject()) into a single module and to
+         * compile the module into the given output.
+         *
+         * Globals defined identically by multiple objects are merged into a single global, conflicting definitions of
+         * non-constant globals and kernels defined in multiple objects are rejected. If a compilation cache is
+         * configured, the machine code of the kernels not changed since they were last linked is reused.
+         *
+         * \param objects The input streams containing the relocatable objects
+         * \param output The output-stream
+         * \param config The configuration to use for compilation
+         * \return the number of bytes written (only meaningful for binary output-mode)
+         */
+        static std::size_t linkObjects(
+            const std::vector<std::istream*>& objects, std::ostream& output, const Configuration& config = {});
+
+        /*
+         * Helper-function to only extract the kernel information (kernel names, parameter names, types, address
+         * spaces and the work-group size (hints)) of the given input without compiling the kernels.
+         *
+         * Only the kernel declarations are read by the front-end, the kernels are neither normalized, optimized nor is
+         * any code generated. The kernel information is written in the format of the module header of the configured
+         * output-mode (see Configuration#writeKernelInfo) without any global data and with empty kernel code.
+         *
+         * NOTE: Since the kernels are not compiled, the implicit UNIFORMs used by the kernels are not known and the
+         * work-group size does not contain the number of work-items merged into a single QPU.
+         *
+         * \param input The input stream
+         * \param output The output-stream to write the kernel information to
+         * \param config The configuration to use for pre-compilation and output
+         * \param options Specify additional compiler-options to pass onto the pre-compiler
+         * \param inputFile see #compile()
+         * eturn the number of bytes written
+         */
+        static std::size_t extractKernelInfo(std::istream& input, std::ostream& output,
+            const Configuration& config = {}, const std::string& options = "",
+            const Optional<std::string>& inputFile = {});
+
     private:
         std::istream& input;
         std::ostream& output;
         Configuration config;
+        // whether the optimization of any kernel was cut short by the configured time budgets
+        bool exceededTimeBudget = false;
+
+        /*
+         * What is written by a compilation
+         */
+        enum class OutputKind : unsigned char
+        {
+            // the generated machine code
+            MACHINE_CODE,
+            // the relocatable object, see #compileObject()
+            OBJECT,
+            // only the kernel information, see #extractKernelInfo()
+            KERNEL_INFO
+        };
+
+        /*
+         * Runs the front-end and the module-wide preparation steps and writes the prepared module as relocatable
+         * object
+         */
+        std::size_t convertToObject();
+
+        /*
+         * Runs the front-end for the kernel declarations only and writes the kernel information
+         */
+        std::size_t convertToKernelInfo();
+
+        static std::size_t runCompilation(std::istream& input, std::ostream& output, const Configuration& config,
+            const std::string& options, const Optional<std::string>& inputFile, OutputKind outputKind);
     };
 
     /*
@@ -80,6 +261,14 @@ namespace vc4c
      * This defaults to logging to the console
      */
     void setLogger(std::wostream& outputStream, bool coloredOutput, LogLevel level = LogLevel::WARNING);
+
+    /*
+     * Limits the number of threads the compiler uses to concurrently run compilation steps.
+     * This can be used to not take all cores from the host application.
+     *
+     * A value of zero (the default) uses all available hardware threads.
+     */
+    void setMaximumCompilationThreads(unsigned numThreads);
 } // namespace vc4c
 
 #endif /* COMPILER_H */
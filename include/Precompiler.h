@@ -110,6 +110,8 @@ namespace vc4c
         std::string precompiledHeader;
         // The path to the pre-compiled LLVM module, empty if not found. Only required for LLVM module front-end
         std::string llvmModule;
+        // The path to the VC4CLStdLib.h source header, empty if not found. Only required to build PCH variants
+        std::string sourceHeader;
     };
 
     /*
@@ -190,6 +192,17 @@ namespace vc4c
          */
         static const StdlibFiles& findStandardLibraryFiles(const std::vector<std::string>& additionalFolders = {});
 
+        /*
+         * Returns the path to the pre-compiled standard-library header (PCH) matching the language options (e.g.
+         * -cl-std, -cl-fast-relaxed-math, the optimization level) of the given compilation options.
+         *
+         * If the options differ from the ones the installed PCH is compiled with, a PCH variant for these options is
+         * looked up in (or on first use built from the VC4CLStdLib.h header into) the user cache folder
+         * ($HOME/.cache/vc4c/pch/), keyed by the compiler version and the language options. If no variant can be
+         * built, the installed PCH is returned.
+         */
+        static const std::string& findPrecompiledHeader(const std::string& userOptions);
+
         /*
          * Pre-compiles the given VC4CL OpenCL C standard-library file (the VC4CLStdLib.h header) into a PCH and an LLVM
          * module and stores them in the given output folder.
@@ -9,6 +9,7 @@
 #ifndef VC4C_H
 #define VC4C_H
 
+#include "CompilationCache.h"
 #include "Compiler.h"
 #include "Precompiler.h"
 #include "config.h"
@@ -27,6 +28,27 @@ namespace vc4c
      */
     std::size_t disassembleCodeOnly(std::istream& binary, std::ostream& output, std::size_t numInstructions,
         OutputMode outputMode = OutputMode::HEX);
+
+    /*
+     * The machine-readable formats to write the disassembled instructions in
+     */
+    enum class DisassemblyTable
+    {
+        // comma-separated values with a header line and one line per instruction
+        CSV,
+        // a JSON array with one object per instruction
+        JSON
+    };
+
+    /*
+     * Disassembles the given machine-code module and writes a table of its instructions into output.
+     *
+     * For every instruction, the index, the name of the kernel containing it, the machine code, the instruction type,
+     * the signal and the assembler code are written.
+     *
+     * Returns the number of instructions written
+     */
+    std::size_t disassembleModuleTable(std::istream& binary, std::ostream& output, DisassemblyTable format);
 } /* namespace vc4c */
 
 #endif /* VC4C_H */
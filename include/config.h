@@ -7,9 +7,14 @@
 #ifndef VC4C_CONFIG_H
 #define VC4C_CONFIG_H
 
+#include <array>
+#include <cstdint>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace vc4c
 {
@@ -96,9 +101,51 @@ namespace vc4c
         /*
          * -O3, run all available optimizations
          */
-        FULL
+        FULL,
+        /*
+         * -Os, run the optimizations which do not increase the code size, e.g. for programs where many kernels share
+         * the instruction cache. This disables loop unrolling and vectorization, the work-group loop as well as any
+         * duplication of code.
+         */
+        SIZE
     };
 
+    /*
+     * Specifies the algorithm used to assign the locals to hardware registers.
+     */
+    enum class RegisterAllocator
+    {
+        /*
+         * Assign the locals in no particular order to the first free register (preferring accumulators) and rely on
+         * the register conflict resolver to fix the locals which could not be assigned.
+         */
+        GREEDY = 0,
+        /*
+         * Assign the locals in the order determined by simplifying the interference graph (Chaitin-Briggs), where the
+         * locals with the lowest spill costs are selected to be potentially spilled first, and assign locals copied to
+         * each other to the same register wherever possible (biased coalescing).
+         */
+        COALESCING = 1,
+        /*
+         * Assign the locals in the order of the start of their live ranges in the instruction order (linear scan) to
+         * the first free register.
+         *
+         * NOTE: This only changes the order in which the locals are assigned, the interference graph is still built
+         * and used to check the register constraints. Thus, this is not faster than the greedy allocator.
+         */
+        LINEAR_SCAN = 2
+    };
+
+    /*
+     * Numbers of elements for a native SIMD vector
+     */
+    constexpr std::size_t NATIVE_VECTOR_SIZE{16};
+
+    /*
+     * Number of QPUs on the VideoCore IV GPU
+     */
+    constexpr uint32_t NUM_QPUS{12};
+
     /*
      * The maximum VPM size to be used (in bytes).
      *
@@ -162,11 +209,195 @@ namespace vc4c
         unsigned maxOptimizationIterations = 512;
 
         /*
-         * Maximum distance between two instructions to be combined for the common subexpression optimization.
+         * Maximum distance between two instructions within a basic block whose expressions are combined by the common
+         * subexpression optimization. This does not limit the reuse of already calculated results.
          *
          * NOTE: Setting this to a large value might lead to very long compilation times.
          */
         unsigned maxCommonExpressionDinstance = 64;
+
+        /*
+         * The maximum number of instructions of an unrolled loop. Since the loop body is executed repeatedly, this
+         * should be well below the size of the QPU instruction cache (4 KB, i.e. 512 instructions, per QPU slice). The
+         * actually applied limit is additionally capped at half the instruction cache size of the target profile.
+         */
+        unsigned maxUnrolledLoopSize = 256;
+
+        /*
+         * The maximum number of instructions of a basic block to be copied into its predecessors to save the branch
+         * into the block. Since every taken branch costs the branch instruction itself and its 3 delay slots, copying
+         * blocks of this size does not increase the number of instructions executed.
+         */
+        unsigned maxTailDuplicationSize = 4;
+
+        /*
+         * The minimum number of instructions (weighted by the nesting depth of the loops containing the uses) saved by
+         * loading a constant vector from the constant pool in the global data instead of calculating it in code. Since
+         * the constant pool is shared by all kernels, all uses of the same constant are accounted for together.
+         *
+         * If this is zero, no constant vectors are moved to the constant pool.
+         */
+        unsigned constantPoolThreshold = 8;
+
+        /*
+         * The alignment (in instructions, relative to the start of the kernel code) of loop heads which are not
+         * entered by falling through from their preceding block. Aligning the loop heads to the size of an
+         * instruction cache line (e.g. 8 instructions for 64 Byte cache lines) minimizes the number of cache lines
+         * occupied by the loop bodies. The padding is never executed, but increases the code size.
+         *
+         * If this is zero or one, the loop heads are not aligned.
+         */
+        unsigned loopAlignment = 0;
+
+        /*
+         * The maximum wall-time (in milliseconds) all executions of a single optimization pass may take for a single
+         * kernel. A pass exceeding its budget is not run again for this kernel, e.g. to bound the compilation time of
+         * pathological kernels.
+         *
+         * If this is zero, the optimization passes are not limited.
+         */
+        unsigned passTimeBudget = 0;
+
+        /*
+         * The maximum wall-time (in milliseconds) of all optimization passes for a single kernel. After the budget is
+         * exceeded, the optimization is stopped after the currently running pass and the kernel is compiled with the
+         * optimizations applied so far.
+         *
+         * NOTE: Since the optimizations are stopped at the next pass boundary, a single long running pass might still
+         * exceed the budget. Kernels whose optimization was cut short are not stored in the compilation cache.
+         *
+         * If this is zero, the optimization of a kernel is not limited.
+         */
+        unsigned kernelTimeBudget = 0;
+    };
+
+    /*
+     * A variant of a kernel with some of its scalar parameters bound to compile-time constants.
+     *
+     * The variant is compiled as an additional kernel with the same parameters as the original kernel (so it can be
+     * launched the same way), but the bound parameters are replaced by their constant values, which are then
+     * propagated by the optimizations (e.g. to determine the number of loop iterations or the accessed memory ranges).
+     *
+     * NOTE: The runtime has to make sure that the variant is only executed with the bound parameter values!
+     */
+    struct KernelSpecialization
+    {
+        /*
+         * The name of the kernel to create the variant of
+         */
+        std::string kernelName;
+        /*
+         * The name of the created kernel variant, needs to be unique within the module
+         */
+        std::string variantName;
+        /*
+         * The bit-patterns of the constant values of the bound parameters, by the index of the parameter
+         */
+        std::map<unsigned, uint32_t> parameterValues;
+    };
+
+    /*
+     * A version of a kernel compiled under assumptions about its launch which can only be checked at run-time, e.g. a
+     * fast path for aligned and non-overlapping buffers.
+     *
+     * The version is compiled as an additional kernel with the same parameters as the original kernel (so it can be
+     * launched the same way), the original kernel is kept as generic fallback for all launches not fulfilling the
+     * assumptions.
+     *
+     * NOTE: The runtime has to check the assumptions before every launch of the version, e.g. the alignment of the
+     * buffer addresses, that no two buffers overlap and that the global size is a multiple of the work-group size!
+     */
+    struct KernelVersion
+    {
+        /*
+         * The name of the kernel to create the version of
+         */
+        std::string kernelName;
+        /*
+         * The name of the created kernel version, needs to be unique within the module
+         */
+        std::string versionName;
+        /*
+         * The alignment (in bytes) of the addresses passed for all pointer parameters, zero to assume no alignment
+         * beyond the alignment of the pointed-to types
+         */
+        unsigned pointerAlignment = 0;
+        /*
+         * Whether the memory areas passed for the different pointer parameters are known to not overlap
+         */
+        bool noAliasing = false;
+        /*
+         * The work-group size the version is always launched with, zeroes to assume no work-group size. This e.g.
+         * allows the work-items to be coarsened for a multiple of 16 in the first dimension.
+         */
+        std::array<uint32_t, 3> workGroupSizes{};
+    };
+
+    /*
+     * A kernel executing the code of a chain of kernels (e.g. each kernel reading the buffer written by the previous
+     * one) one after the other within a single launch.
+     *
+     * The fused kernel is compiled as an additional kernel, the original kernels are kept. Parameters of different
+     * kernels can be mapped to the same parameter of the fused kernel, e.g. the intermediate buffers or the
+     * parameters with the same value for all kernels.
+     *
+     * NOTE: The runtime has to make sure that every work-item only reads the elements of the intermediate buffers
+     * written by itself (e.g. element-wise kernels indexed by the global id), since no synchronization is inserted
+     * between the fused kernels.
+     */
+    struct KernelFusion
+    {
+        /*
+         * The name of the fused kernel, needs to be unique within the module
+         */
+        std::string fusedName;
+        /*
+         * The names of the kernels to be fused in the order of execution, each with the indices of the parameters of
+         * the fused kernel its parameters are mapped to. If no indices are given for a kernel, all its parameters
+         * are appended as new parameters of the fused kernel.
+         */
+        std::vector<std::pair<std::string, std::vector<unsigned>>> kernels;
+    };
+
+    /*
+     * The properties of the hardware (and firmware configuration) the code is generated for.
+     *
+     * The defaults match the VideoCore IV GPU as configured by the default Raspberry Pi firmware. Boards and firmware
+     * configurations may differ e.g. in the number of QPUs usable by user programs (some QPUs can be reserved for the
+     * 3D pipeline) and the VPM memory reserved for user programs.
+     */
+    struct TargetProfile
+    {
+        /*
+         * The number of QPUs available to run the work-items of a work-group, limits the maximum work-group size and
+         * the number of per-QPU stack frames reserved in the VPM. Can be at most NUM_QPUS.
+         *
+         * NOTE: The runtime must not execute work-groups larger than this number of work-items!
+         */
+        uint32_t numQPUs = NUM_QPUS;
+        /*
+         * The maximum size of the VPM available to be used as cache (in bytes).
+         *
+         * NOTE: Setting this to a value not available hardware-side may hang the execution/system
+         */
+        unsigned availableVPMSize = VPM_DEFAULT_SIZE;
+        /*
+         * The size of the instruction cache (in instructions) shared by the QPUs of a slice. Unrolled loops are kept
+         * below half of this size.
+         */
+        unsigned instructionCacheSize = 512;
+        /*
+         * The size of the TMU (L1) cache in bytes. This is used by the emulator to model TMU cache hits.
+         */
+        unsigned tmuCacheSize = 4 * 1024;
+        /*
+         * The measured latencies (in instructions) the instruction scheduler tries to fill between triggering an
+         * operation and waiting for its result (see DependencyGraph.h)
+         */
+        unsigned tmuLoadLatency = 8;
+        unsigned vpmDMALoadLatency = 6;
+        unsigned vpmDMAStoreLatency = 10;
+        unsigned mutexAcquireLatency = 4;
     };
 
     /*
@@ -186,11 +417,17 @@ namespace vc4c
          */
         bool writeKernelInfo = true;
         /*
-         * The maximum size of the VPM available to be used as cache.
+         * Whether to write the binary output in the sectioned module format, where the module header only contains an
+         * index of the kernels and the global data and every kernel has its own section containing its kernel-info
+         * and code. This allows to load only the kernels actually used.
          *
-         * NOTE: Setting this to a value not available hardware-side may hang the execution/system
+         * NOTE: This is only applied for binary output and requires the run-time to support the sectioned format!
          */
-        unsigned availableVPMSize = VPM_DEFAULT_SIZE;
+        bool sectionedBinary = false;
+        /*
+         * The properties of the hardware the code is generated for
+         */
+        TargetProfile target = {};
         /*
          * The front-end to be used
          */
@@ -212,30 +449,163 @@ namespace vc4c
          */
         OptimizationOptions additionalOptions = {};
         /*
-         * Whether to use CLang opt to apply optimizations like force-vectorization, etc...
+         * Whether to apply the LLVM optimizations like force-vectorization, etc...
+         *
+         * If the LLVM library front-end is available, the passes run in-process on the loaded module, otherwise the
+         * opt program is executed on the pre-compiled module.
          */
         bool useOpt = false;
+        /*
+         * Whether to run the SPIRV-Tools optimizer (inlining, constant folding, dead code and dead function elimination
+         * and compacting the IDs) in-process on SPIR-V modules before they are parsed
+         */
+        bool optimizeSPIRV = false;
         /*
          * Whether to stop compilation when instruction verification failed
          */
         bool stopWhenVerificationFailed = true;
+        /*
+         * Whether to execute multiple consecutive work-items in the SIMD elements of a single QPU for kernels with a
+         * fitting compile-time work-group size.
+         *
+         * NOTE: The runtime needs to take the number of work-items per QPU (as stored in the kernel info) into account!
+         */
+        bool coarsenWorkItems = false;
+        /*
+         * Whether to generate code for two hardware threads per QPU. Each thread can only use the half of the physical
+         * registers files (16 registers of A and B each) and the threads switch cooperatively while waiting for TMU
+         * loads.
+         *
+         * NOTE: Kernels are only marked as threadable if any thread switch was inserted (see the kernel info) and the
+         * runtime needs to start two threads per QPU for them!
+         */
+        bool generateThreadedCode = false;
+        /*
+         * Whether to calculate values which are the same for all work-items of a kernel execution (e.g. the global
+         * size or products of scalar parameters) host-side and pass them as additional UNIFORMs, instead of calculating
+         * them in the kernel code.
+         *
+         * NOTE: The runtime needs to evaluate the expressions stored in the kernel info and pass their results in the
+         * UNIFORMs following the parameters!
+         */
+        bool precomputeUniformValues = false;
+        /*
+         * Whether the QPUs running a kernel fetch the next work-item to execute from a counter shared between them
+         * (located in the VPM and guarded by the hardware mutex), instead of each QPU iterating over all work-groups
+         * with its fixed local ID. This balances the work between the QPUs if the run-time of the work-items differs.
+         *
+         * NOTE: This is only applied to kernels without barriers, local memory or coarsened work-items, all other
+         * kernels use the static work-group loop.
+         */
+        bool distributeWorkItemsDynamically = false;
+        /*
+         * The algorithm to use for assigning the locals to registers
+         */
+        RegisterAllocator registerAllocator = RegisterAllocator::GREEDY;
+        /*
+         * The estimated memory (in bytes) the kernels compiled concurrently may use in total for their optimization,
+         * register allocation and code generation. The kernels are compiled in batches not exceeding this size (unless
+         * a single kernel exceeds it on its own), e.g. to compile large modules on systems with little memory.
+         *
+         * This is also used as a soft limit for the actually used memory (as tracked by the profiler, see
+         * profiler::MemoryCategory): While the limit is exceeded, the kernels of the next batches are compiled one
+         * after another and the cached analyses are dropped after every optimization pass.
+         *
+         * If this is zero, all kernels are compiled concurrently.
+         */
+        std::size_t maxCompilationMemory = 0;
+        /*
+         * The directory to store compilation results in, to be reused by later compilations of the same input with
+         * the same configuration.
+         *
+         * If this is empty, the compilation cache is disabled.
+         */
+        std::string cacheDirectory = "";
+        /*
+         * The maximum accumulated size (in bytes) of all entries in the compilation cache. If this size is exceeded,
+         * the least recently used entries are evicted.
+         */
+        std::size_t maxCacheSize = 64 * 1024 * 1024;
+        /*
+         * The file to write the module to after the module-wide preparation steps (see ModuleSerializer.h), to be
+         * read back in instead of the original input by later compilations, e.g. with different optimization settings.
+         *
+         * If this is empty, the module is not written.
+         */
+        std::string moduleOutputFile = "";
+        /*
+         * The file to write the positions of the basic blocks within the generated code to. Given to the emulator, the
+         * positions are used to map the instrumentation results to the basic blocks to create an execution profile
+         * (see ExecutionProfile.h) to be used by later compilations.
+         *
+         * If this is empty, the block positions are not written.
+         */
+        std::string profileGenerateFile = "";
+        /*
+         * The execution profile created by a previous emulation run, which guides optimizations like the order of the
+         * basic blocks, the instruction scheduling and the loop unrolling.
+         *
+         * If this is empty, no profile is used.
+         */
+        std::string profileUseFile = "";
+        /*
+         * The file to write statistics about the machine code generated for every kernel to, e.g. the number of
+         * instructions and nops, the rate of paired ALU operations and the number of spilled locals, periphery
+         * accesses and used registers. The statistics are written as JSON object with an entry per kernel.
+         *
+         * If this is empty, no statistics are written.
+         */
+        std::string statisticsOutputFile = "";
+        /*
+         * The file to write a trace of the compilation stages to, containing the duration and peak memory usage of
+         * every normalization step, optimization pass and register fix-up step (see profiler::TraceScope). The trace
+         * is written in the Chrome trace event format.
+         *
+         * If this is empty, no trace is recorded.
+         */
+        std::string traceOutputFile = "";
+        /*
+         * The file to write the intermediate code of every kernel to, as it is after running the optimization passes
+         * (and before the second normalization). Comparing the files written with different passes enabled shows the
+         * changes made by these passes.
+         *
+         * If this is empty, no intermediate code is written.
+         */
+        std::string intermediateOutputFile = "";
+        /*
+         * The file to write the memory usage report to, containing the peak memory usage of every compilation stage of
+         * every kernel by category (e.g. instructions, locals and analyses, see profiler::MemoryCategory) as JSON.
+         *
+         * If this is empty, no memory report is written.
+         */
+        std::string memoryReportFile = "";
+        /*
+         * The kernel variants to compile in addition to the kernels of the input, with some of their parameters bound
+         * to constant values.
+         */
+        std::vector<KernelSpecialization> kernelSpecializations;
+        /*
+         * The kernels to compile in addition to the kernels of the input, each executing a chain of input kernels
+         * within a single launch.
+         */
+        std::vector<KernelFusion> kernelFusions;
+        /*
+         * The kernels to compile in addition to the kernels of the input, each a version of an input kernel optimized
+         * for assumptions the runtime checks before launching it.
+         */
+        std::vector<KernelVersion> kernelVersions;
     };
 
-    /*
-     * Numbers of elements for a native SIMD vector
-     */
-    constexpr std::size_t NATIVE_VECTOR_SIZE{16};
-
-    /*
-     * Number of QPUs on the VideoCore IV GPU
-     */
-    constexpr uint32_t NUM_QPUS{12};
-
     /*
      * Magic number to identify QPU assembler code (machine code)
      */
     constexpr uint32_t QPUASM_MAGIC_NUMBER = 0xDEADBEAF;
     constexpr uint32_t QPUASM_NUMBER_MAGIC = 0xAFBEADDE;
+    /*
+     * Magic number in the second half of the first word identifying machine code in the sectioned module format (see
+     * Configuration#sectionedBinary)
+     */
+    constexpr uint32_t QPUASM_SECTIONED_MAGIC_NUMBER = 0x5EC7C0DE;
 } // namespace vc4c
 
 #endif /* VC4C_CONFIG_H */
@@ -16,6 +16,7 @@
 #include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace vc4c
@@ -33,6 +34,68 @@ namespace vc4c
             std::array<uint32_t, 3> globalOffsets = {{0, 0, 0}};
         };
 
+        /*
+         * A buffer owned by the caller, which is accessed by the emulation directly without copying its contents
+         */
+        struct BufferSpan
+        {
+            uint32_t* data;
+            std::size_t numWords;
+        };
+
+        /*
+         * The latencies and bandwidth of the memory accesses of the emulated periphery, e.g. fitted to measurements on
+         * the real hardware via #calibrateTimingModel().
+         *
+         * The default values model fixed latencies without any TMU cache and with unlimited memory bandwidth.
+         */
+        struct TimingModel
+        {
+            /*
+             * The number of cycles between writing a TMU address and the loaded value being available, if the value
+             * is read from memory (missing the TMU cache)
+             */
+            uint32_t tmuLatency = 9;
+            /*
+             * The number of cycles for a TMU load, which only accesses cache lines present in the TMU cache
+             */
+            uint32_t tmuCacheHitLatency = 9;
+            /*
+             * The number of lines and the line size (in bytes) of the direct-mapped TMU cache of every QPU. A cache of
+             * zero lines disables the simulation of the cache and every TMU load reads the memory.
+             */
+            uint32_t tmuCacheLines = 0;
+            uint32_t tmuCacheLineSize = 64;
+            /*
+             * The number of cycles between triggering a VPM DMA transfer and its completion, excluding the time to
+             * transfer the data itself
+             */
+            uint32_t dmaLatency = 12;
+            /*
+             * The number of bytes the memory interface shared by all QPUs transfers per cycle. All TMU cache misses
+             * and DMA transfers of all QPUs are serialized on this interface, so QPUs accessing the memory at the
+             * same time stall each other. A value of zero models an unlimited bandwidth without any contention.
+             */
+            uint32_t memoryBytesPerCycle = 0;
+        };
+
+        /*
+         * Reads the timing model from the given stream, which contains a single "name=value" pair per line for the
+         * members of TimingModel to set (e.g. "tmuLatency=20"), empty lines and lines starting with '#' are skipped.
+         *
+         * NOTE: This function throws a CompilationError for unknown names or invalid values
+         */
+        TimingModel readTimingModel(std::istream& in);
+        /*
+         * Writes all members of the timing model in the format read by #readTimingModel()
+         */
+        void writeTimingModel(std::ostream& out, const TimingModel& model);
+        /*
+         * Creates the timing model matching the measured TMU latency and the TMU cache size of the given target
+         * profile. The members not covered by the profile (e.g. the memory bandwidth) keep their default values.
+         */
+        TimingModel createTimingModel(const TargetProfile& target);
+
         /*
          * Data container for all configuration required to emulate a kernel-execution
          */
@@ -55,6 +118,14 @@ namespace vc4c
              * Also, the output values are NOT stored back into the parameter, but need to be read via an extra function
              */
             std::vector<std::pair<uint32_t, Optional<std::vector<uint32_t>>>> parameter;
+            /*
+             * The caller-owned buffers for the pointer parameters with the given indices, which are mapped into the
+             * emulated memory instead of being copied into and out of it. The modifications of the kernel are written
+             * directly into these buffers and the corresponding entries in EmulationResult#results are left empty.
+             *
+             * NOTE: The entries in #parameter for these indices are ignored.
+             */
+            std::map<std::size_t, BufferSpan> mappedParameters;
             /*
              * The work-group configuration to run the execution with
              */
@@ -71,6 +142,89 @@ namespace vc4c
              * The path to dump the results of the instrumentation
              */
             std::string instrumentationDump;
+            /*
+             * The path to the basic block positions written by the compiler (see Configuration#profileGenerateFile),
+             * required to create an execution profile
+             */
+            std::string profileBlockPositions;
+            /*
+             * The path to write the execution profile (the number of executions of every basic block) into. If the
+             * file already exists, the execution counts are added to the existing profile.
+             */
+            std::string profileDump;
+            /*
+             * The path to write the hotspots of the kernel into, in the folded stack format read by flame graph tools.
+             * The emulated cycles are rolled up into the basic blocks and the loops containing them, the cycles spent
+             * stalling are attributed to the reasons of the stalls. The basic blocks are named by their labels, if
+             * the #profileBlockPositions are given, otherwise by the index of their first instruction.
+             */
+            std::string hotspotDump;
+            /*
+             * The path to write the trace of all memory accesses into: every TMU load, VPM DMA transfer and setup of
+             * VPM reads and writes with its cycle, QPU, address, size, stride and access pattern (contiguous, strided
+             * or gather). The trace is preceded by the achieved bandwidth per access type, the utilization of every
+             * TMU and hints on memory lowerings matching the access patterns better.
+             *
+             * NOTE: This is not supported for the emulation of work-group shards (see #numWorkGroupShards).
+             */
+            std::string memoryTraceDump;
+            /*
+             * The number of host threads to emulate the QPUs on. The QPUs are only synchronized for accesses to the
+             * periphery shared between them (e.g. the memory, the VPM or the hardware mutex), the results are the same
+             * as for the emulation on a single thread.
+             */
+            unsigned numThreads = 1;
+            /*
+             * The number of shards to split the work-groups into, which are emulated independently of each other on
+             * multiple host threads, each with its own copy of the memory. The memory modified by the shards is merged
+             * afterwards and the emulated cycles of all shards are summed up.
+             *
+             * NOTE: This requires the work-groups to be independent of each other (e.g. to not use global atomics).
+             * Also, the work-group IDs and the global offset seen by the kernel are relative to the shard, so only
+             * kernels accessing memory via the global IDs produce the same results as the emulation of all
+             * work-groups at once.
+             */
+            unsigned numWorkGroupShards = 1;
+            /*
+             * Whether to check the work-group shards for modifications of the same memory (e.g. by global atomics),
+             * throwing a CompilationError if any memory word is modified by multiple shards
+             */
+            bool checkWorkGroupShards = false;
+            /*
+             * The number of QPUs available on the emulated hardware (see TargetProfile#numQPUs). Executions with
+             * work-groups larger than this number of work-items are rejected.
+             */
+            uint32_t numQPUs = NUM_QPUS;
+            /*
+             * Whether to emulate the latencies of the periphery (e.g. the stalls of TMU loads and DMA waits) cycle by
+             * cycle. If disabled, only the functional behavior is emulated: the results of the periphery are available
+             * immediately and the executed instructions are not logged, which speeds up the emulation, but reports
+             * fewer cycles than the hardware takes. Errors in the generated code (e.g. reading an empty TMU queue,
+             * misusing the hardware mutex or reading the SFU result too early) are still detected.
+             */
+            bool cycleAccurate = true;
+            /*
+             * The latencies and bandwidth of the memory accesses to emulate, only used if #cycleAccurate is set
+             */
+            TimingModel timing;
+            /*
+             * The path to write a checkpoint of the complete emulator state (e.g. the registers and flags of all QPUs,
+             * the TMU queues, the VPM, the semaphores and the memory) into every #checkpointInterval cycles. Every
+             * checkpoint replaces the previous one.
+             *
+             * A failing long-running emulation can then be resumed from the last checkpoint (see #resumeCheckpoint)
+             * instead of rerunning it from the start, e.g. to replay the last cycles with verbose logging enabled.
+             *
+             * NOTE: Checkpoints are only supported for the cycle-wise emulation on a single thread (see #numThreads)
+             * without work-group shards and can only be restored for the same kernel and input.
+             */
+            std::string checkpointFile;
+            uint32_t checkpointInterval = 1000000;
+            /*
+             * The path of a checkpoint written by a previous emulation of the same kernel and input to resume the
+             * emulation from
+             */
+            std::string resumeCheckpoint;
 
             explicit EmulationData() = default;
 
@@ -136,6 +290,14 @@ namespace vc4c
              * The path to dump the results of the instrumentation
              */
             std::string instrumentationDump;
+            /*
+             * The number of host threads to emulate the QPUs on, see EmulationData#numThreads
+             */
+            unsigned numThreads = 1;
+            /*
+             * Whether to emulate the latencies of the periphery cycle by cycle, see EmulationData#cycleAccurate
+             */
+            bool cycleAccurate = true;
 
             LowLevelEmulationData(const std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>& buffers,
                 uint64_t* startAddress, uint32_t numInstructions, const std::vector<uint32_t>& uniformAddresses,
@@ -180,6 +342,14 @@ namespace vc4c
              * access or periphery)
              */
             unsigned numStalls;
+            /*
+             * The stalls of this instruction by their reason: waiting for a TMU load (or its result in r4), for a VPM
+             * DMA transfer, for the hardware mutex or for a semaphore
+             */
+            unsigned numTMUStalls;
+            unsigned numVPMStalls;
+            unsigned numMutexStalls;
+            unsigned numSemaphoreStalls;
             /*
              * Counts the total number, this instruction was executed
              */
@@ -202,6 +372,10 @@ namespace vc4c
              * execution limit (false)
              */
             bool executionSuccessful = false;
+            /*
+             * The number of cycles emulated until all QPUs finished execution (or the execution limit was reached)
+             */
+            uint32_t numCycles = 0;
             /*
              * The final contents of the parameter passed to the emulation (e.g. for output-parameter).
              */
@@ -227,6 +401,10 @@ namespace vc4c
              * execution limit (false)
              */
             bool executionSuccessful = false;
+            /*
+             * The number of cycles emulated until all QPUs finished execution (or the execution limit was reached)
+             */
+            uint32_t numCycles = 0;
             /*
              * The instrumentation result for the emulation run. The indices of the instrumentation result correspond to
              * the indices of the instruction in the executed kernel
@@ -243,6 +421,51 @@ namespace vc4c
         EmulationResult emulate(const EmulationData& data);
         LowLevelEmulationResult emulate(const LowLevelEmulationData& data);
 
+        /*
+         * A kernel extracted once from a compiled module, which can then be emulated repeatedly for different inputs.
+         *
+         * The module is only parsed and decoded once and the memory allocated for an execution is reused by the
+         * following executions, which saves the setup of every call to #emulate(const EmulationData&), e.g. when
+         * emulating small kernels very often for auto-tuning or fuzzing.
+         */
+        class PreparedKernel
+        {
+        public:
+            /*
+             * Extracts the kernel with the name EmulationData#kernelName from the module EmulationData#module
+             *
+             * NOTE: This constructor throws a CompilationError if the module or the kernel cannot be extracted
+             */
+            explicit PreparedKernel(const EmulationData& data);
+            PreparedKernel(const PreparedKernel&) = delete;
+            PreparedKernel(PreparedKernel&&) noexcept;
+            ~PreparedKernel() noexcept;
+
+            PreparedKernel& operator=(const PreparedKernel&) = delete;
+            PreparedKernel& operator=(PreparedKernel&&) noexcept;
+
+            /*
+             * Emulates the prepared kernel for the given input, see #emulate(const EmulationData&).
+             *
+             * NOTE: The EmulationData#module and EmulationData#kernelName of the input are ignored.
+             */
+            EmulationResult run(const EmulationData& input) const;
+
+            /*
+             * Emulates the prepared kernel for all given inputs in parallel and returns the results in the order of
+             * the inputs. The inputs are distributed to the given number of host threads, a value of zero uses the
+             * thread pool shared with the compiler.
+             *
+             * NOTE: If any of the emulations throws an exception, the exception of the first such input is rethrown.
+             */
+            std::vector<EmulationResult> runBatch(
+                const std::vector<EmulationData>& inputs, unsigned numThreads = 0) const;
+
+        private:
+            struct Impl;
+            std::unique_ptr<Impl> impl;
+        };
+
         /*
          * Parses the given command-line parameter and stores it in the configuration
          *
@@ -250,6 +473,325 @@ namespace vc4c
          */
         bool parseConfigurationParameter(Configuration& config, const std::string& arg);
 
+        /*
+         * Returns the command-line parameters which reproduce the optimization settings (optimization level, enabled
+         * and disabled optimization passes and optimization parameters) of the given configuration, when applied to
+         * the default configuration via #parseConfigurationParameter().
+         *
+         * Only the settings differing from their default values are returned.
+         */
+        std::vector<std::string> toConfigurationParameters(const Configuration& config);
+
+        /*
+         * Data container for all configuration required to tune the optimization settings for a kernel
+         */
+        struct TuningData
+        {
+            /*
+             * The source code of the module to compile for every tried configuration
+             */
+            std::string source;
+            /*
+             * Additional options to pass onto the pre-compiler
+             */
+            std::string compilerOptions;
+            /*
+             * The configuration to start the search from, also determines the settings not tuned (e.g. the math type)
+             */
+            Configuration baseConfig;
+            /*
+             * The kernel to execute, its sample input parameters and the work-group configuration to run it with.
+             *
+             * NOTE: The module and the dump files of the emulation data are ignored.
+             */
+            EmulationData emulation;
+            /*
+             * The maximum number of configurations to compile and emulate (including the base configuration)
+             */
+            unsigned maxTrials = 64;
+        };
+
+        /*
+         * The result of the tuning
+         */
+        struct TuningResult
+        {
+            /*
+             * The configuration resulting in the lowest number of emulated cycles
+             */
+            Configuration config;
+            /*
+             * The command-line parameters to reproduce the tuned configuration (see #toConfigurationParameters())
+             */
+            std::vector<std::string> parameters;
+            /*
+             * The number of cycles emulated for the base configuration
+             */
+            uint32_t baseCycles = 0;
+            /*
+             * The number of cycles emulated for the tuned configuration
+             */
+            uint32_t numCycles = 0;
+            /*
+             * The number of configurations compiled and emulated
+             */
+            unsigned numTrials = 0;
+        };
+
+        /*
+         * Searches the optimization level, the optimization passes and the optimization thresholds for the
+         * configuration which executes the given kernel with the given sample inputs in the lowest number of cycles.
+         *
+         * Every tried configuration is compiled and emulated. Configurations which fail to compile, exceed the maximum
+         * emulation cycles or produce results differing from the base configuration are rejected.
+         *
+         * NOTE: This function throws a CompilationError if the base configuration cannot be compiled or emulated
+         */
+        TuningResult tuneConfiguration(const TuningData& data);
+
+        /*
+         * Data container for all configuration required to check the optimizations for miscompilations of a kernel
+         */
+        struct DifferentialData
+        {
+            /*
+             * The source code of the module to compile
+             */
+            std::string source;
+            /*
+             * Additional options to pass onto the pre-compiler
+             */
+            std::string compilerOptions;
+            /*
+             * The candidate configuration to check. The reference configuration is derived by disabling all
+             * optimization passes, all other settings (e.g. the math type) are used for both configurations.
+             */
+            Configuration config;
+            /*
+             * The kernel to execute, its input parameters and the work-group configuration to run it with.
+             *
+             * NOTE: The module and the dump files of the emulation data are ignored.
+             */
+            EmulationData emulation;
+        };
+
+        /*
+         * The result of the differential check
+         */
+        struct DifferentialResult
+        {
+            /*
+             * Whether the candidate configuration fails to compile the kernel, exceeds the maximum emulation cycles or
+             * produces results differing from the reference configuration
+             */
+            bool isMiscompiled = false;
+            /*
+             * The description of the miscompilation, e.g. the error thrown when compiling with the candidate
+             * configuration
+             */
+            std::string error;
+            /*
+             * The first optimization pass (in execution order), which causes the miscompilation when enabled together
+             * with all previous passes of the candidate configuration. Is empty if no miscompilation was found or the
+             * miscompilation also occurs with all optimization passes disabled.
+             */
+            std::string failingPass;
+            /*
+             * The command-line parameters to reproduce the candidate configuration (see #toConfigurationParameters())
+             */
+            std::vector<std::string> parameters;
+            /*
+             * The number of configurations compiled and emulated
+             */
+            unsigned numTrials = 0;
+        };
+
+        /*
+         * Compiles the given kernel with all optimization passes disabled and with the candidate configuration,
+         * emulates both and compares the contents of all buffer parameters after the execution.
+         *
+         * If the results differ, the optimization pass causing the miscompilation is bisected by disabling the
+         * optimization passes of the candidate configuration (see Configuration#additionalDisabledOptimizations).
+         *
+         * NOTE: This function throws a CompilationError if the reference configuration cannot be compiled or emulated
+         */
+        DifferentialResult checkOptimizations(const DifferentialData& data);
+
+        /*
+         * Data container for all configuration required to profile the effect of the single optimization passes on
+         * the code quality of a kernel
+         */
+        struct PassProfileData
+        {
+            /*
+             * The source code of the module to compile
+             */
+            std::string source;
+            /*
+             * Additional options to pass onto the pre-compiler
+             */
+            std::string compilerOptions;
+            /*
+             * The configuration to profile the enabled optimization passes of
+             */
+            Configuration config;
+            /*
+             * The kernel to execute, its input parameters and the work-group configuration to run it with.
+             *
+             * NOTE: The module and the dump files of the emulation data are ignored.
+             */
+            EmulationData emulation;
+            /*
+             * The directory to write the intermediate code after every profiled step into (see
+             * Configuration#intermediateOutputFile), if not empty
+             */
+            std::string intermediateDirectory;
+            /*
+             * Whether to only bisect the pass introducing the slowdown instead of profiling every single pass. This
+             * requires the kernel to stay slower than the #referenceCycles once the slowdown is introduced.
+             */
+            bool bisect = false;
+            /*
+             * The number of cycles the bisection compares against, e.g. the cycles of the kernel before the
+             * regression. Defaults to the cycles of the kernel compiled with all optimization passes disabled.
+             */
+            uint32_t referenceCycles = 0;
+            /*
+             * The relative increase of the emulated cycles (e.g. 0.05 for 5%) tolerated before counting as slowdown
+             */
+            double slowdownThreshold = 0.0;
+        };
+
+        /*
+         * The code quality of the kernel compiled with the first optimization passes enabled
+         */
+        struct PassProfileStep
+        {
+            /*
+             * The number of enabled optimization passes (in execution order) and the last of them, empty for the
+             * step without any optimization passes
+             */
+            std::size_t numPasses = 0;
+            std::string pass;
+            /*
+             * The number of generated instructions and their statically estimated cycles (see
+             * Configuration#statisticsOutputFile)
+             */
+            std::size_t numInstructions = 0;
+            double estimatedCycles = 0.0;
+            /*
+             * The number of emulated cycles
+             */
+            uint32_t numCycles = 0;
+            /*
+             * The file the intermediate code of this step was written into, if any
+             */
+            std::string intermediateFile;
+        };
+
+        /*
+         * The result of profiling the optimization passes
+         */
+        struct PassProfileResult
+        {
+            /*
+             * The profiled steps, ordered by their number of enabled passes. Contains all steps if not bisecting,
+             * only the steps compiled for the bisection otherwise.
+             */
+            std::vector<PassProfileStep> steps;
+            /*
+             * The first optimization pass (in execution order) slowing down the kernel: the pass making the kernel
+             * slower than the previous step, if profiling every pass, or the pass making the kernel slower than the
+             * reference cycles, if bisecting. Is empty if no such pass was found.
+             */
+            std::string slowdownPass;
+            /*
+             * The number of configurations compiled and emulated
+             */
+            unsigned numTrials = 0;
+        };
+
+        /*
+         * Compiles and emulates the given kernel with the enabled optimization passes of the configuration enabled
+         * one after the other (in execution order, by disabling all following passes, see
+         * Configuration#additionalDisabledOptimizations) and records the code quality after every pass.
+         *
+         * NOTE: This function throws a CompilationError if the kernel cannot be compiled or emulated with any of the
+         * profiled steps
+         */
+        PassProfileResult profilePasses(const PassProfileData& data);
+
+        /*
+         * A kernel execution measured on the real hardware
+         */
+        struct CalibrationSample
+        {
+            /*
+             * The kernel, its input parameters and the work-group configuration of the measured execution.
+             *
+             * NOTE: The dump files, the EmulationData#timing and EmulationData#cycleAccurate are ignored.
+             */
+            EmulationData emulation;
+            /*
+             * The number of QPU cycles the execution took on the hardware, e.g. the kernel execution time reported by
+             * clpeak multiplied by the QPU clock rate
+             */
+            uint32_t measuredCycles = 0;
+        };
+
+        /*
+         * Data container for all configuration required to fit the timing model to measurements of the hardware
+         */
+        struct CalibrationData
+        {
+            /*
+             * The measured executions, should contain memory-bound kernels with different access patterns (e.g. the
+             * global bandwidth kernels of clpeak for different vector widths) to determine all parameters
+             */
+            std::vector<CalibrationSample> samples;
+            /*
+             * The timing model to start the search from
+             */
+            TimingModel baseModel;
+            /*
+             * The maximum number of timing models to emulate all samples with (including the base model)
+             */
+            unsigned maxTrials = 128;
+        };
+
+        /*
+         * The result of the calibration
+         */
+        struct CalibrationResult
+        {
+            /*
+             * The timing model resulting in the lowest error
+             */
+            TimingModel model;
+            /*
+             * The mean relative difference between the emulated and the measured cycles of all samples for the base
+             * model and for the calibrated model
+             */
+            double baseError = 0.0;
+            double error = 0.0;
+            /*
+             * The number of timing models emulated
+             */
+            unsigned numTrials = 0;
+        };
+
+        /*
+         * Searches the parameters of the timing model for which the emulated cycles of the samples match the measured
+         * cycles best.
+         *
+         * Every sample is emulated for every tried timing model. Timing models for which a sample exceeds its maximum
+         * emulation cycles are rejected.
+         *
+         * NOTE: This function throws a CompilationError if there are no samples or the samples cannot be emulated
+         * with the base model
+         */
+        CalibrationResult calibrateTimingModel(const CalibrationData& data);
+
     } /* namespace tools */
 } /* namespace vc4c */
 
@@ -13,6 +13,7 @@
 #include "Locals.h"
 #include "helper.h"
 #include "performance.h"
+#include "tools/IntrusiveList.h"
 
 namespace vc4c
 {
@@ -27,7 +28,7 @@ namespace vc4c
         struct BranchLabel;
 
         using IL = std::unique_ptr<IntermediateInstruction>;
-        using InstructionsList = FastModificationList<IL>;
+        using InstructionsList = tools::IntrusiveList<IL, profiler::MemoryCategory::INSTRUCTIONS>;
         using InstructionsIterator = InstructionsList::iterator;
         using ConstInstructionsIterator = InstructionsList::const_iterator;
     } // namespace intermediate
@@ -176,6 +177,7 @@ namespace vc4c
         friend class ConstInstructionWalker;
         friend struct InstructionVisitor;
         friend class Method;
+        friend class MethodCheckpoint;
     };
 
     template <typename Scope>
@@ -0,0 +1,544 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "CompilationCache.h"
+
+#include "CompilationError.h"
+#include "Precompiler.h"
+#include "Profiler.h"
+#include "helper.h"
+#include "log.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utime.h>
+#include <vector>
+
+using namespace vc4c;
+
+#ifndef VC4C_VERSION
+#define VC4C_VERSION ""
+#endif
+
+static const std::string CACHE_ENTRY_SUFFIX = ".vc4cache";
+static constexpr char CACHE_ENTRY_MAGIC[8] = {'V', 'C', '4', 'C', 'A', 'C', 'H', 'E'};
+
+static std::atomic_size_t numCacheHits{0};
+static std::atomic_size_t numCacheMisses{0};
+static std::atomic_size_t numCacheInsertions{0};
+static std::atomic_size_t numCacheEvictions{0};
+
+std::string CompilationCacheStatistics::to_string() const
+{
+    return std::to_string(numHits) + " hits, " + std::to_string(numMisses) + " misses, " +
+        std::to_string(numInsertions) + " insertions, " + std::to_string(numEvictions) + " evictions, " +
+        std::to_string(numEntries) + " entries with " + std::to_string(totalSize) + " bytes";
+}
+
+static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87;
+static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4F;
+static constexpr uint64_t PRIME3 = 0x165667B19E3779F9;
+
+static uint64_t rotateLeft(uint64_t val, unsigned bits)
+{
+    return (val << bits) | (val >> (64 - bits));
+}
+
+static uint64_t readWord(const char* data)
+{
+    uint64_t word = 0;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static uint64_t mixLane(uint64_t lane, uint64_t word)
+{
+    return rotateLeft(lane + word * PRIME2, 31) * PRIME1;
+}
+
+/*
+ * 64-bit hash in the style of xxHash64. The result needs to be stable across processes (which std::hash does not
+ * guarantee).
+ *
+ * The bulk of the data is processed in 32 byte blocks by 4 independent lanes, which the CPU can execute in parallel,
+ * so hashing runs at multiple bytes per cycle instead of the one byte per iteration of e.g. FNV-1a. This keeps
+ * hashing even large inputs cheap enough to look up the cache on every compilation.
+ */
+static uint64_t hashData(const std::string& data, uint64_t seed = 0)
+{
+    const char* ptr = data.data();
+    const char* const end = ptr + data.size();
+    uint64_t hash;
+    if(data.size() >= 32)
+    {
+        std::array<uint64_t, 4> lanes = {seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1};
+        for(; ptr + 32 <= end; ptr += 32)
+        {
+            for(std::size_t i = 0; i < lanes.size(); ++i)
+                lanes[i] = mixLane(lanes[i], readWord(ptr + 8 * i));
+        }
+        hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+        for(auto lane : lanes)
+            hash = (hash ^ mixLane(0, lane)) * PRIME1 + PRIME3;
+    }
+    else
+        hash = seed + PRIME3;
+    hash += static_cast<uint64_t>(data.size());
+    for(; ptr + 8 <= end; ptr += 8)
+        hash = rotateLeft(hash ^ mixLane(0, readWord(ptr)), 27) * PRIME1 + PRIME3;
+    for(; ptr < end; ++ptr)
+        hash = rotateLeft(hash ^ (static_cast<uint8_t>(*ptr) * PRIME3), 11) * PRIME1;
+    // final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/*
+ * The fields of the Configuration as known to #serializeConfiguration(), in declaration order. This mirrors the layout
+ * of the Configuration, so adding a field to the Configuration (or any of the nested option structures) without
+ * deciding whether it needs to be part of the cache key fails the static assertions below.
+ *
+ * NOTE: A new field might still fit into the padding between existing fields (e.g. a bool next to the other bools), so
+ * the assertions only catch most of the new fields.
+ */
+struct SerializedConfigurationFields
+{
+    MathType mathType;
+    OutputMode outputMode;
+    bool writeKernelInfo;
+    bool sectionedBinary;
+    TargetProfile target;
+    Frontend frontend;
+    OptimizationLevel optimizationLevel;
+    std::unordered_set<std::string> additionalEnabledOptimizations;
+    std::unordered_set<std::string> additionalDisabledOptimizations;
+    OptimizationOptions additionalOptions;
+    bool useOpt;
+    bool optimizeSPIRV;
+    bool stopWhenVerificationFailed;
+    bool coarsenWorkItems;
+    bool generateThreadedCode;
+    bool precomputeUniformValues;
+    bool distributeWorkItemsDynamically;
+    RegisterAllocator registerAllocator;
+    // not part of the key, only limits the number of kernels compiled concurrently
+    std::size_t maxCompilationMemory;
+    // not part of the key, only configure the cache itself
+    std::string cacheDirectory;
+    std::size_t maxCacheSize;
+    // not part of the key, the results are not cached if any of these files is written
+    std::string moduleOutputFile;
+    std::string profileGenerateFile;
+    // part of the key via the hash of the profile contents
+    std::string profileUseFile;
+    // not part of the key, only write additional reports and do not modify the generated code
+    std::string statisticsOutputFile;
+    std::string traceOutputFile;
+    std::string intermediateOutputFile;
+    std::string memoryReportFile;
+    std::vector<KernelSpecialization> kernelSpecializations;
+    std::vector<KernelFusion> kernelFusions;
+    std::vector<KernelVersion> kernelVersions;
+};
+
+static_assert(sizeof(Configuration) == sizeof(SerializedConfigurationFields),
+    "The Configuration was modified, check whether the new fields need to be added to the cache key and update the "
+    "serialized fields");
+static_assert(sizeof(TargetProfile) == 8 * sizeof(unsigned),
+    "The TargetProfile was modified, check whether the new fields need to be added to the cache key");
+// the time budgets are not part of the key, since the results of kernels exceeding their budgets are not cached
+static_assert(sizeof(OptimizationOptions) == 13 * sizeof(unsigned),
+    "The OptimizationOptions were modified, check whether the new fields need to be added to the cache key");
+
+static std::string serializeConfiguration(const Configuration& config)
+{
+    std::stringstream s;
+    s << static_cast<unsigned>(config.mathType) << ';' << static_cast<unsigned>(config.outputMode) << ';'
+      << config.writeKernelInfo << ';' << static_cast<unsigned>(config.frontend) << ';'
+      << static_cast<unsigned>(config.optimizationLevel) << ';' << config.useOpt << ';' << config.optimizeSPIRV << ';'
+      << config.stopWhenVerificationFailed << ';' << config.coarsenWorkItems << ';'
+      << static_cast<unsigned>(config.registerAllocator) << ';' << config.sectionedBinary << ';'
+      << config.generateThreadedCode << ';' << config.precomputeUniformValues << ';'
+      << config.distributeWorkItemsDynamically << ';';
+    const auto& target = config.target;
+    s << target.numQPUs << ';' << target.availableVPMSize << ';' << target.instructionCacheSize << ';'
+      << target.tmuCacheSize << ';' << target.tmuLoadLatency << ';' << target.vpmDMALoadLatency << ';'
+      << target.vpmDMAStoreLatency << ';' << target.mutexAcquireLatency << ';';
+    // the sets are unordered, so sort them to generate a stable representation
+    s << to_string<std::string>(std::set<std::string>(config.additionalEnabledOptimizations.begin(),
+                                    config.additionalEnabledOptimizations.end()),
+             ",")
+      << ';';
+    s << to_string<std::string>(std::set<std::string>(config.additionalDisabledOptimizations.begin(),
+                                    config.additionalDisabledOptimizations.end()),
+             ",")
+      << ';';
+    const auto& opts = config.additionalOptions;
+    s << opts.combineLoadThreshold << ';' << opts.accumulatorThreshold << ';' << opts.replaceNopThreshold << ';'
+      << opts.registerResolverMaxRounds << ';' << opts.moveConstantsDepth << ';' << opts.maxOptimizationIterations
+      << ';' << opts.maxCommonExpressionDinstance << ';' << opts.maxUnrolledLoopSize << ';'
+      << opts.maxTailDuplicationSize << ';' << opts.constantPoolThreshold << ';' << opts.loopAlignment;
+    for(const auto& specialization : config.kernelSpecializations)
+    {
+        s << ';' << specialization.kernelName << ':' << specialization.variantName;
+        for(const auto& entry : specialization.parameterValues)
+            s << ',' << entry.first << '=' << entry.second;
+    }
+    for(const auto& fusion : config.kernelFusions)
+    {
+        s << ';' << fusion.fusedName;
+        for(const auto& kernel : fusion.kernels)
+            s << ':' << kernel.first << '=' << to_string<unsigned>(kernel.second, ",");
+    }
+    for(const auto& version : config.kernelVersions)
+    {
+        s << ';' << version.kernelName << ':' << version.versionName << ',' << version.pointerAlignment << ','
+          << version.noAliasing << ',' << version.workGroupSizes[0] << 'x' << version.workGroupSizes[1] << 'x'
+          << version.workGroupSizes[2];
+    }
+    if(!config.profileUseFile.empty())
+    {
+        // the generated code depends on the contents of the execution profile, not on its location
+        std::ifstream profile(config.profileUseFile);
+        s << ';' << hashData(std::string{std::istreambuf_iterator<char>(profile), std::istreambuf_iterator<char>()});
+    }
+    return s.str();
+}
+
+static void serializeFileStatus(std::ostream& s, const std::string& path)
+{
+    struct stat info = {};
+    if(!path.empty() && stat(path.data(), &info) == 0)
+        s << path << ':' << info.st_size << ':' << info.st_mtime << ';';
+}
+
+/*
+ * The generated code also depends on the compiler library itself (the version is not changed for every build) and on
+ * the VC4CL standard-library (which is installed separately). Instead of hashing these large files for every
+ * compilation, their paths, sizes and modification times are added to the key.
+ */
+static std::string serializeDependencies()
+{
+    std::stringstream s;
+    Dl_info library = {};
+    if(dladdr(reinterpret_cast<void*>(&CompilationCache::calculateKey), &library) != 0 && library.dli_fname)
+        serializeFileStatus(s, library.dli_fname);
+    try
+    {
+        const auto& files = Precompiler::findStandardLibraryFiles();
+        serializeFileStatus(s, files.configurationHeader);
+        serializeFileStatus(s, files.precompiledHeader);
+        serializeFileStatus(s, files.llvmModule);
+        serializeFileStatus(s, files.sourceHeader);
+    }
+    catch(const CompilationError&)
+    {
+        // the compilation itself fails without the standard-library, so no result is cached anyway
+    }
+    return s.str();
+}
+
+bool CompilationCache::isCacheable(const std::string& inputData, const std::string& options)
+{
+    // this also rejects inputs only mentioning "#include" e.g. in a comment, which is fine for the cache
+    return inputData.find("#include") == std::string::npos && inputData.find("#import") == std::string::npos &&
+        options.find("-include") == std::string::npos;
+}
+
+std::string CompilationCache::calculateKey(
+    const std::string& inputData, const Configuration& config, const std::string& options)
+{
+    PROFILE_START(CalculateCacheKey);
+    // use two differently seeded hashes to reduce the probability of collisions
+    const auto meta = std::string(VC4C_VERSION) + '\n' + serializeDependencies() + '\n' +
+        serializeConfiguration(config) + '\n' + options + '\n';
+    auto first = hashData(inputData, hashData(meta));
+    auto second = hashData(meta, hashData(inputData, PRIME1));
+    std::stringstream s;
+    s << std::hex << std::setfill('0') << std::setw(16) << first << std::setw(16) << second;
+    PROFILE_END(CalculateCacheKey);
+    return s.str();
+}
+
+static std::string getEntryPath(const std::string& cacheDirectory, const std::string& key)
+{
+    return cacheDirectory + "/" + key + CACHE_ENTRY_SUFFIX;
+}
+
+static bool ensureDirectoryExists(const std::string& directory)
+{
+    if(directory.empty())
+        return false;
+    struct stat info = {};
+    if(stat(directory.data(), &info) == 0)
+        return S_ISDIR(info.st_mode);
+    // create all missing parent directories
+    auto pos = directory.find('/', 1);
+    while(pos != std::string::npos)
+    {
+        auto parent = directory.substr(0, pos);
+        if(stat(parent.data(), &info) != 0 && mkdir(parent.data(), 0755) != 0 && errno != EEXIST)
+            return false;
+        pos = directory.find('/', pos + 1);
+    }
+    return mkdir(directory.data(), 0755) == 0 || errno == EEXIST;
+}
+
+struct CacheEntry
+{
+    std::string path;
+    std::size_t size;
+    time_t lastUsed;
+};
+
+static std::vector<CacheEntry> listEntries(const std::string& cacheDirectory)
+{
+    std::vector<CacheEntry> entries;
+    DIR* dir = opendir(cacheDirectory.data());
+    if(dir == nullptr)
+        return entries;
+    while(auto entry = readdir(dir))
+    {
+        std::string name(entry->d_name);
+        if(name.size() <= CACHE_ENTRY_SUFFIX.size() ||
+            name.compare(name.size() - CACHE_ENTRY_SUFFIX.size(), CACHE_ENTRY_SUFFIX.size(), CACHE_ENTRY_SUFFIX) != 0)
+            continue;
+        auto path = cacheDirectory + "/" + name;
+        struct stat info = {};
+        if(stat(path.data(), &info) == 0 && S_ISREG(info.st_mode))
+            entries.emplace_back(CacheEntry{path, static_cast<std::size_t>(info.st_size), info.st_mtime});
+    }
+    closedir(dir);
+    return entries;
+}
+
+static void evictEntries(const std::string& cacheDirectory, std::size_t maxSize)
+{
+    auto entries = listEntries(cacheDirectory);
+    std::size_t totalSize = 0;
+    for(const auto& entry : entries)
+        totalSize += entry.size;
+    if(totalSize <= maxSize)
+        return;
+    // evict the least recently used entries first
+    std::sort(entries.begin(), entries.end(),
+        [](const CacheEntry& e1, const CacheEntry& e2) -> bool { return e1.lastUsed < e2.lastUsed; });
+    for(const auto& entry : entries)
+    {
+        if(totalSize <= maxSize)
+            break;
+        // another process might have already removed the same entry
+        if(remove(entry.path.data()) == 0)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG, log << "Evicted compilation cache entry: " << entry.path << logging::endl);
+            ++numCacheEvictions;
+        }
+        totalSize -= entry.size;
+    }
+}
+
+/*
+ * The most recently used entries are additionally kept in memory, so repeated compilations of the same input within
+ * a process (e.g. building the same program for multiple contexts) do not need to access the file-system at all.
+ */
+static constexpr std::size_t MAX_MEMORY_CACHE_SIZE = 16 * 1024 * 1024;
+
+struct MemoryCacheEntry
+{
+    std::string result;
+    std::size_t bytesWritten;
+    // the position in the list of least recently used entries
+    std::list<std::string>::iterator usage;
+};
+
+static std::mutex memoryCacheLock;
+// the entries by path of the corresponding entry file
+static std::unordered_map<std::string, MemoryCacheEntry> memoryCache;
+static std::list<std::string> memoryCacheUsage;
+static std::size_t memoryCacheSize = 0;
+
+static Optional<std::size_t> lookupInMemory(const std::string& path, std::ostream& output)
+{
+    std::lock_guard<std::mutex> guard(memoryCacheLock);
+    auto it = memoryCache.find(path);
+    if(it == memoryCache.end())
+        return {};
+    memoryCacheUsage.splice(memoryCacheUsage.end(), memoryCacheUsage, it->second.usage);
+    output.write(it->second.result.data(), static_cast<std::streamsize>(it->second.result.size()));
+    return it->second.bytesWritten;
+}
+
+static void insertIntoMemory(const std::string& path, std::string&& result, std::size_t bytesWritten)
+{
+    if(result.size() > MAX_MEMORY_CACHE_SIZE / 4)
+        // do not evict all other entries for a single large entry
+        return;
+    std::lock_guard<std::mutex> guard(memoryCacheLock);
+    auto it = memoryCache.find(path);
+    if(it != memoryCache.end())
+    {
+        memoryCacheSize -= it->second.result.size();
+        memoryCacheUsage.erase(it->second.usage);
+        memoryCache.erase(it);
+    }
+    memoryCacheSize += result.size();
+    memoryCacheUsage.emplace_back(path);
+    memoryCache.emplace(
+        path, MemoryCacheEntry{std::move(result), bytesWritten, std::prev(memoryCacheUsage.end())});
+    while(memoryCacheSize > MAX_MEMORY_CACHE_SIZE)
+    {
+        auto oldest = memoryCache.find(memoryCacheUsage.front());
+        memoryCacheSize -= oldest->second.result.size();
+        memoryCache.erase(oldest);
+        memoryCacheUsage.pop_front();
+    }
+}
+
+static void clearMemory()
+{
+    std::lock_guard<std::mutex> guard(memoryCacheLock);
+    memoryCache.clear();
+    memoryCacheUsage.clear();
+    memoryCacheSize = 0;
+}
+
+Optional<std::size_t> CompilationCache::lookup(
+    const std::string& key, const Configuration& config, std::ostream& output)
+{
+    if(config.cacheDirectory.empty())
+        return {};
+    PROFILE_START(CacheLookup);
+    auto path = getEntryPath(config.cacheDirectory, key);
+    if(auto bytesWritten = lookupInMemory(path, output))
+    {
+        PROFILE_END(CacheLookup);
+        ++numCacheHits;
+        CPPLOG_LAZY(logging::Level::INFO, log << "Using in-memory compilation result: " << path << logging::endl);
+        return bytesWritten;
+    }
+    std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+    std::array<char, sizeof(CACHE_ENTRY_MAGIC)> magic{};
+    uint64_t bytesWritten = 0;
+    if(!in || !in.read(magic.data(), magic.size()) || memcmp(magic.data(), CACHE_ENTRY_MAGIC, magic.size()) != 0 ||
+        !in.read(reinterpret_cast<char*>(&bytesWritten), sizeof(bytesWritten)))
+    {
+        PROFILE_END(CacheLookup);
+        ++numCacheMisses;
+        return {};
+    }
+    std::string result{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    output.write(result.data(), static_cast<std::streamsize>(result.size()));
+    insertIntoMemory(path, std::move(result), static_cast<std::size_t>(bytesWritten));
+    // update the modification time to track the least recently used entries
+    utime(path.data(), nullptr);
+    PROFILE_END(CacheLookup);
+    ++numCacheHits;
+    CPPLOG_LAZY(logging::Level::INFO, log << "Using cached compilation result: " << path << logging::endl);
+    return static_cast<std::size_t>(bytesWritten);
+}
+
+void CompilationCache::insert(
+    const std::string& key, const Configuration& config, const std::string& result, std::size_t bytesWritten)
+{
+    if(config.cacheDirectory.empty())
+        return;
+    if(!ensureDirectoryExists(config.cacheDirectory))
+    {
+        logging::warn() << "Failed to create compilation cache directory '" << config.cacheDirectory
+                        << "': " << strerror(errno) << logging::endl;
+        return;
+    }
+    if(result.size() + sizeof(CACHE_ENTRY_MAGIC) + sizeof(uint64_t) > config.maxCacheSize)
+        // would be evicted immediately anyway
+        return;
+    PROFILE_START(CacheInsert);
+    // write into a temporary file first and then rename it to not expose half-written entries to other processes
+    std::string tmpName = config.cacheDirectory + "/.entry-XXXXXX";
+    int fd = mkstemp(&tmpName[0]);
+    if(fd < 0)
+    {
+        PROFILE_END(CacheInsert);
+        logging::warn() << "Failed to create compilation cache entry: " << strerror(errno) << logging::endl;
+        return;
+    }
+    close(fd);
+    {
+        std::ofstream out(tmpName, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+        auto size = static_cast<uint64_t>(bytesWritten);
+        out.write(CACHE_ENTRY_MAGIC, sizeof(CACHE_ENTRY_MAGIC));
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(result.data(), static_cast<std::streamsize>(result.size()));
+        if(!out)
+        {
+            out.close();
+            remove(tmpName.data());
+            PROFILE_END(CacheInsert);
+            logging::warn() << "Failed to write compilation cache entry: " << tmpName << logging::endl;
+            return;
+        }
+    }
+    auto path = getEntryPath(config.cacheDirectory, key);
+    if(rename(tmpName.data(), path.data()) != 0)
+    {
+        remove(tmpName.data());
+        PROFILE_END(CacheInsert);
+        logging::warn() << "Failed to store compilation cache entry '" << path << "': " << strerror(errno)
+                        << logging::endl;
+        return;
+    }
+    ++numCacheInsertions;
+    CPPLOG_LAZY(logging::Level::DEBUG, log << "Stored compilation result in cache: " << path << logging::endl);
+    insertIntoMemory(path, std::string{result}, bytesWritten);
+    evictEntries(config.cacheDirectory, config.maxCacheSize);
+    PROFILE_END(CacheInsert);
+}
+
+void CompilationCache::clear(const std::string& cacheDirectory)
+{
+    clearMemory();
+    for(const auto& entry : listEntries(cacheDirectory))
+    {
+        if(remove(entry.path.data()) != 0)
+            logging::warn() << "Failed to remove compilation cache entry '" << entry.path << "': " << strerror(errno)
+                            << logging::endl;
+    }
+}
+
+CompilationCacheStatistics CompilationCache::getStatistics(const std::string& cacheDirectory)
+{
+    CompilationCacheStatistics stats;
+    stats.numHits = numCacheHits;
+    stats.numMisses = numCacheMisses;
+    stats.numInsertions = numCacheInsertions;
+    stats.numEvictions = numCacheEvictions;
+    for(const auto& entry : listEntries(cacheDirectory))
+    {
+        ++stats.numEntries;
+        stats.totalSize += entry.size;
+    }
+    return stats;
+}
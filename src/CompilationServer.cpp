@@ -0,0 +1,339 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "CompilationServer.h"
+
+#include "Profiler.h"
+#include "VC4C.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace vc4c;
+
+/*
+ * Compilation server
+ *
+ * The server keeps the process-wide state (located standard-library files, the loaded standard-library LLVM module,
+ * thread pool, optimization passes) warm between compilations, to not pay the start-up costs for every single kernel
+ * compiled.
+ *
+ * Protocol (all integers in host byte-order, since only local UNIX sockets are supported):
+ * - request: uint32 number of arguments, for every argument an uint32 length followed by the characters, uint64
+ *   length of the input followed by the input code
+ * - response: uint32 status (0 on success), uint64 length of the payload followed by the payload (the compiled code
+ *   on success, the error message otherwise)
+ *
+ * The sizes of the request are limited, to not allocate arbitrary amounts of memory for malformed requests. A client
+ * not sending (or receiving) any data for some time is disconnected, to not block the server for all other clients.
+ */
+static constexpr uint32_t MAX_REQUEST_ARGUMENTS = 1024;
+static constexpr uint32_t MAX_ARGUMENT_LENGTH = 64 * 1024;
+static constexpr uint64_t MAX_INPUT_LENGTH = 256 * 1024 * 1024;
+static constexpr time_t CLIENT_TIMEOUT_SECONDS = 30;
+
+/*
+ * The options clients are allowed to pass, i.e. the options only affecting the compilation itself. Especially options
+ * making the server read or write any other files (e.g. write the intermediate module, statistics, traces or modify
+ * the compilation cache) are rejected.
+ */
+static const std::vector<std::string> ALLOWED_OPTION_PREFIXES = {"-cl-", "-D", "-U", "-O", "--hex", "--bin", "--asm",
+    "--kernel-info", "--no-kernel-info", "--spirv", "--llvm", "--use-opt", "--no-opt", "--spirv-opt", "--target-",
+    "--max-memory=", "--verification-error", "--no-verification-error", "--sectioned-binary", "--coarsen-work-items",
+    "--precompute-uniforms", "--dynamic-work-distribution", "--threaded", "--register-allocator=", "--specialize=",
+    "--fuse=", "--kernel-version=", "--f"};
+
+static bool isAllowedOption(const std::string& arg)
+{
+    return std::any_of(ALLOWED_OPTION_PREFIXES.begin(), ALLOWED_OPTION_PREFIXES.end(),
+        [&](const std::string& prefix) -> bool { return arg.compare(0, prefix.size(), prefix) == 0; });
+}
+
+static bool readFully(int fd, void* buffer, std::size_t length)
+{
+    auto ptr = reinterpret_cast<char*>(buffer);
+    while(length > 0)
+    {
+        auto numRead = read(fd, ptr, length);
+        if(numRead < 0 && errno == EINTR)
+            continue;
+        if(numRead <= 0)
+            return false;
+        ptr += numRead;
+        length -= static_cast<std::size_t>(numRead);
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* buffer, std::size_t length)
+{
+    auto ptr = reinterpret_cast<const char*>(buffer);
+    while(length > 0)
+    {
+        // do not kill the server with SIGPIPE if the client already disconnected
+        auto numWritten = send(fd, ptr, length, MSG_NOSIGNAL);
+        if(numWritten < 0 && errno == EINTR)
+            continue;
+        if(numWritten <= 0)
+            return false;
+        ptr += numWritten;
+        length -= static_cast<std::size_t>(numWritten);
+    }
+    return true;
+}
+
+static bool readString(int fd, std::string& string, uint64_t maxLength)
+{
+    uint64_t length = 0;
+    if(!readFully(fd, &length, sizeof(length)))
+        return false;
+    if(length > maxLength)
+    {
+        errno = EMSGSIZE;
+        return false;
+    }
+    string.resize(static_cast<std::size_t>(length));
+    return readFully(fd, &string[0], string.size());
+}
+
+static bool writeString(int fd, const std::string& string)
+{
+    auto length = static_cast<uint64_t>(string.size());
+    return writeFully(fd, &length, sizeof(length)) && writeFully(fd, string.data(), string.size());
+}
+
+static bool readArguments(int fd, std::vector<std::string>& args)
+{
+    uint32_t numArgs = 0;
+    if(!readFully(fd, &numArgs, sizeof(numArgs)))
+        return false;
+    if(numArgs > MAX_REQUEST_ARGUMENTS)
+    {
+        errno = EMSGSIZE;
+        return false;
+    }
+    args.resize(numArgs);
+    for(auto& arg : args)
+    {
+        uint32_t length = 0;
+        if(!readFully(fd, &length, sizeof(length)))
+            return false;
+        if(length > MAX_ARGUMENT_LENGTH)
+        {
+            errno = EMSGSIZE;
+            return false;
+        }
+        arg.resize(length);
+        if(!readFully(fd, &arg[0], arg.size()))
+            return false;
+    }
+    return true;
+}
+
+static bool writeArguments(int fd, const std::vector<std::string>& args)
+{
+    auto numArgs = static_cast<uint32_t>(args.size());
+    if(!writeFully(fd, &numArgs, sizeof(numArgs)))
+        return false;
+    for(const auto& arg : args)
+    {
+        auto length = static_cast<uint32_t>(arg.size());
+        if(!writeFully(fd, &length, sizeof(length)) || !writeFully(fd, arg.data(), arg.size()))
+            return false;
+    }
+    return true;
+}
+
+static int openSocket(const std::string& socketPath, sockaddr_un& address)
+{
+    if(socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return -1;
+    }
+    address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.data(), sizeof(address.sun_path) - 1);
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+    return fd;
+}
+
+void vc4c::handleCompilationRequest(int clientFd)
+{
+    uint32_t status = 0;
+    std::string payload;
+    try
+    {
+        std::vector<std::string> args;
+        std::string inputCode;
+        if(!readArguments(clientFd, args) || !readString(clientFd, inputCode, MAX_INPUT_LENGTH))
+        {
+            payload = std::string("Invalid compilation request: ") + strerror(errno);
+            logging::warn() << payload << logging::endl;
+            status = 1;
+        }
+        else
+        {
+            Configuration config;
+            std::string options;
+            for(const auto& arg : args)
+            {
+                if(!isAllowedOption(arg))
+                    throw CompilationError(
+                        CompilationStep::GENERAL, "Option is not allowed for compilation server requests", arg);
+                if(!vc4c::tools::parseConfigurationParameter(config, arg) || arg.find("-cl") == 0)
+                    options.append(arg).append(" ");
+            }
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Compiling request with optimization level "
+                    << static_cast<unsigned>(config.optimizationLevel) << " and options '" << options << "' ..."
+                    << logging::endl);
+
+            std::istringstream input(inputCode);
+            std::ostringstream output;
+            PROFILE_START(Compiler);
+            Compiler::compile(input, output, config, options);
+            PROFILE_END(Compiler);
+            payload = output.str();
+        }
+    }
+    catch(const std::exception& e)
+    {
+        // neither a malformed request nor a failed compilation must take down the server
+        logging::error() << "Compilation request failed: " << e.what() << logging::endl;
+        status = 1;
+        payload = e.what();
+    }
+
+    if(!writeFully(clientFd, &status, sizeof(status)) || !writeString(clientFd, payload))
+        logging::warn() << "Failed to write compilation response: " << strerror(errno) << logging::endl;
+}
+
+/*
+ * Compiles a trivial kernel, so the front-end libraries, the standard-library files and the lazily initialized
+ * process-wide state of the compiler are already loaded when the first request arrives.
+ */
+static void warmUpCompiler()
+{
+    try
+    {
+        std::istringstream input("__kernel void warm_up(__global int* out) { *out = get_global_id(0); }");
+        std::ostringstream output;
+        Compiler::compile(input, output, Configuration{});
+    }
+    catch(const std::exception& e)
+    {
+        logging::warn() << "Failed to warm up compiler: " << e.what() << logging::endl;
+    }
+}
+
+int vc4c::runCompilationServer(const std::string& socketPath)
+{
+    sockaddr_un address;
+    auto serverFd = openSocket(socketPath, address);
+    if(serverFd < 0)
+        return 8;
+    struct stat info = {};
+    if(lstat(socketPath.data(), &info) == 0)
+    {
+        if(!S_ISSOCK(info.st_mode))
+        {
+            std::cerr << "Refusing to replace existing file '" << socketPath << "', which is not a socket"
+                      << std::endl;
+            close(serverFd);
+            return 8;
+        }
+        // remove stale socket left over from a previous server
+        unlink(socketPath.data());
+    }
+    if(bind(serverFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(serverFd, 16) != 0)
+    {
+        std::cerr << "Failed to listen on socket '" << socketPath << "': " << strerror(errno) << std::endl;
+        close(serverFd);
+        return 8;
+    }
+
+    // already locate the standard-library files and load everything else required, so the first request does not
+    // need to
+    Precompiler::findStandardLibraryFiles();
+    warmUpCompiler();
+    logging::info() << "Compilation server listening on: " << socketPath << logging::endl;
+
+    while(true)
+    {
+        auto clientFd = accept(serverFd, nullptr, nullptr);
+        if(clientFd < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+            break;
+        }
+        // the requests are handled one at a time, since every single compilation already uses all available threads
+        timeval timeout{CLIENT_TIMEOUT_SECONDS, 0};
+        if(setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+            setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0)
+            logging::warn() << "Failed to set client socket timeout: " << strerror(errno) << logging::endl;
+        handleCompilationRequest(clientFd);
+        close(clientFd);
+    }
+
+    close(serverFd);
+    unlink(socketPath.data());
+    PROFILE_RESULTS();
+    return 8;
+}
+
+int vc4c::runCompilationClient(const std::string& socketPath, const std::vector<std::string>& args, std::istream& input,
+    std::ostream& output)
+{
+    sockaddr_un address;
+    auto fd = openSocket(socketPath, address);
+    if(fd < 0)
+        return 9;
+    if(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::cerr << "Failed to connect to compilation server '" << socketPath << "': " << strerror(errno)
+                  << std::endl;
+        close(fd);
+        return 9;
+    }
+
+    std::stringstream inputCode;
+    inputCode << input.rdbuf();
+    uint32_t status = 0;
+    std::string payload;
+    if(!writeArguments(fd, args) || !writeString(fd, inputCode.str()) || !readFully(fd, &status, sizeof(status)) ||
+        !readString(fd, payload, std::numeric_limits<uint64_t>::max()))
+    {
+        std::cerr << "Failed to communicate with compilation server: " << strerror(errno) << std::endl;
+        close(fd);
+        return 9;
+    }
+    close(fd);
+
+    if(status != 0)
+    {
+        std::cerr << "Compilation failed: " << payload << std::endl;
+        return 10;
+    }
+    output << payload;
+    return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_COMPILATION_SERVER_H
+#define VC4C_COMPILATION_SERVER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace vc4c
+{
+    /*
+     * Reads a single compilation request from the given file descriptor, compiles it and writes the response.
+     *
+     * Malformed requests (e.g. exceeding the size limits) and requests with options not allowed to be set by clients
+     * (e.g. options writing additional files) are answered with an error status.
+     */
+    void handleCompilationRequest(int clientFd);
+
+    /*
+     * Runs the compilation server listening on the UNIX socket at the given path until an error occurs and returns the
+     * exit code
+     */
+    int runCompilationServer(const std::string& socketPath);
+
+    /*
+     * Sends the compilation request with the given arguments and input code to the compilation server listening on
+     * the given socket, writes the compiled code into the output and returns the exit code
+     */
+    int runCompilationClient(const std::string& socketPath, const std::vector<std::string>& args, std::istream& input,
+        std::ostream& output);
+} /* namespace vc4c */
+
+#endif /* VC4C_COMPILATION_SERVER_H */
@@ -0,0 +1,84 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "CompilationState.h"
+
+#include "ThreadPool.h"
+
+using namespace vc4c;
+
+static thread_local CompilationState* currentState = nullptr;
+
+CompilationScope::CompilationScope(CompilationState* state) : previousState(currentState)
+{
+    currentState = state;
+}
+
+CompilationScope::~CompilationScope()
+{
+    currentState = previousState;
+}
+
+CompilationState* vc4c::getCurrentCompilation()
+{
+    return currentState;
+}
+
+void vc4c::checkCancellation()
+{
+    if(currentState && currentState->cancelled.load(std::memory_order_relaxed))
+        throw CompilationError(CompilationStep::GENERAL, "Compilation was cancelled");
+}
+
+void vc4c::enterCompilationStage(CompilationStep step, const std::string& kernelName)
+{
+    checkCancellation();
+    if(currentState && currentState->progress)
+        currentState->progress(step, kernelName);
+}
+
+CompilationHandle::CompilationHandle(std::shared_ptr<CompilationState>&& state, std::future<void>&& future) :
+    state(std::move(state)), future(std::move(future))
+{
+}
+
+CompilationHandle::CompilationHandle(CompilationHandle&& other) noexcept = default;
+
+CompilationHandle::~CompilationHandle()
+{
+    if(future.valid())
+    {
+        // the compilation references the input and output streams, so we need to wait for it to stop
+        cancel();
+        future.wait();
+    }
+}
+
+std::size_t CompilationHandle::get()
+{
+    if(!future.valid())
+        throw CompilationError(CompilationStep::GENERAL, "The result of the compilation was already retrieved");
+    // execute pending tasks (e.g. of this compilation) while waiting instead of blocking this thread
+    ThreadPool::getDefaultPool().waitFor(future);
+    future = {};
+    return state->bytesWritten;
+}
+
+bool CompilationHandle::isFinished() const
+{
+    return !future.valid() || future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool CompilationHandle::waitFor(std::chrono::milliseconds duration) const
+{
+    return !future.valid() || future.wait_for(duration) == std::future_status::ready;
+}
+
+void CompilationHandle::cancel()
+{
+    if(state)
+        state->cancelled = true;
+}
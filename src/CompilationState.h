@@ -0,0 +1,64 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_COMPILATION_STATE_H
+#define VC4C_COMPILATION_STATE_H
+
+#include "Compiler.h"
+
+#include <atomic>
+
+namespace vc4c
+{
+    /*
+     * The state shared between an asynchronous compilation (see Compiler#compileAsync()) and its handle
+     */
+    struct CompilationState
+    {
+        std::atomic_bool cancelled{false};
+        ProgressCallback progress;
+        std::size_t bytesWritten = 0;
+    };
+
+    /*
+     * Makes the given compilation the compilation run by the current thread while this object exists.
+     *
+     * Needs to be set in every task running a part of the compilation on another thread (e.g. for the single
+     * kernels), since the state is kept per thread.
+     */
+    class CompilationScope
+    {
+    public:
+        explicit CompilationScope(CompilationState* state);
+        CompilationScope(const CompilationScope&) = delete;
+        CompilationScope(CompilationScope&&) noexcept = delete;
+        ~CompilationScope();
+
+        CompilationScope& operator=(const CompilationScope&) = delete;
+        CompilationScope& operator=(CompilationScope&&) noexcept = delete;
+
+    private:
+        CompilationState* previousState;
+    };
+
+    /*
+     * Returns the compilation run by the current thread, or nullptr for synchronous compilations
+     */
+    CompilationState* getCurrentCompilation();
+
+    /*
+     * Throws an error if the compilation run by the current thread was cancelled
+     */
+    void checkCancellation();
+
+    /*
+     * Reports the start of the given compilation stage (for the given kernel) to the progress callback of the
+     * compilation run by the current thread and throws an error if the compilation was cancelled
+     */
+    void enterCompilationStage(CompilationStep step, const std::string& kernelName = "");
+} // namespace vc4c
+
+#endif /* VC4C_COMPILATION_STATE_H */
@@ -6,25 +6,38 @@
 
 #include "Compiler.h"
 
+#include "CompilationCache.h"
 #include "CompilationError.h"
+#include "CompilationState.h"
+#include "Logging.h"
+#include "ModuleSerializer.h"
 #include "Parser.h"
 #include "Precompiler.h"
 #include "Profiler.h"
 #include "ThreadPool.h"
 #include "asm/CodeGenerator.h"
+#include "asm/KernelInfo.h"
 #include "log.h"
 #include "logger.h"
+#include "normalization/ConstantPool.h"
 #include "normalization/Normalizer.h"
+#include "normalization/Specialization.h"
 #include "optimization/Optimizer.h"
 #include "spirv/SPIRVParser.h"
+#include "tools/MemoryPool.h"
 #include "llvm/BitcodeReader.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <fcntl.h>
+#include <fstream>
+#include <functional>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <unistd.h>
 #include <vector>
@@ -82,44 +95,296 @@ static std::unique_ptr<Parser> getParser(std::istream& stream)
     }
     return nullptr;
 }
+// rough estimations of the memory required to compile a kernel, dominated by the per-instruction liveness
+// information and the interference graph built for the register allocation
+static constexpr std::size_t MEMORY_PER_INSTRUCTION = 1024;
+static constexpr std::size_t MEMORY_PER_LOCAL = 2048;
 
-std::size_t Compiler::convert()
+static std::size_t estimateCompilationMemory(const Method& kernel)
 {
-    Module module(config);
+    return kernel.countInstructions() * MEMORY_PER_INSTRUCTION + kernel.getNumLocals() * MEMORY_PER_LOCAL;
+}
 
+/*
+ * Groups the kernels into batches to be compiled concurrently, where the estimated memory required to compile all
+ * kernels of a batch does not exceed the given limit (unless a single kernel exceeds the limit on its own).
+ */
+static std::vector<std::vector<Method*>> groupKernelsByMemory(
+    const std::vector<Method*>& kernels, std::size_t maxMemory)
+{
+    if(maxMemory == 0)
+        return {kernels};
+    std::vector<std::vector<Method*>> batches;
+    std::size_t batchMemory = 0;
+    for(auto kernel : kernels)
     {
+        auto kernelMemory = estimateCompilationMemory(*kernel);
+        if(batches.empty() || batchMemory + kernelMemory > maxMemory)
+        {
+            batches.emplace_back();
+            batchMemory = 0;
+        }
+        batches.back().push_back(kernel);
+        batchMemory += kernelMemory;
+    }
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Compiling " << kernels.size() << " kernels in " << batches.size() << " batches to not exceed "
+            << maxMemory << " bytes of memory" << logging::endl);
+    return batches;
+}
+
+/*
+ * Runs the front-end for the given input and the module-wide preparation steps, unless the input is an already
+ * prepared serialized module
+ */
+static void readModule(Module& module, std::istream& input, const Configuration& config)
+{
+    if(isSerializedModule(input))
+    {
+        // the serialized module already went through the front-end and the module-wide preparation steps
+        logging::info() << "Reading serialized module..." << logging::endl;
+        deserializeModule(module, input);
+        return;
+    }
+
+    {
+        enterCompilationStage(CompilationStep::PARSER);
         std::unique_ptr<Parser> parser = getParser(input);
         PROFILE_START(Parser);
+        PROFILE_TRACE_START(Parser);
         parser->parse(module);
         PROFILE_END(Parser);
+        PROFILE_TRACE_END("stage", Parser);
         // early clean up the parser, since we do not need it anymore and it may use a lot of memory
     }
 
+    // the module-wide steps (e.g. inlining) need to be finished for all kernels, before any kernel can be
+    // processed further, since they read the functions called by the kernels
     normalization::Normalizer norm(config);
-    optimizations::Optimizer opt(config);
-    qpu_asm::CodeGenerator codeGen(module, config);
-
-    PROFILE_START(Normalizer);
-    norm.normalize(module);
-    PROFILE_END(Normalizer);
+    enterCompilationStage(CompilationStep::NORMALIZER);
+    PROFILE_START(PrepareModule);
+    PROFILE_TRACE_START(PrepareModule);
+    norm.prepareModule(module);
+    PROFILE_END(PrepareModule);
+    PROFILE_TRACE_END("stage", PrepareModule);
 
     // remove all non-kernel functions, since we do not handle them anymore, to free up some memory
     module.dropNonKernels();
 
-    PROFILE_START(Optimizer);
-    opt.optimize(module);
-    PROFILE_END(Optimizer);
+    if(!config.moduleOutputFile.empty())
+    {
+        std::ofstream moduleOutput(config.moduleOutputFile, std::ios::binary | std::ios::trunc);
+        if(!moduleOutput)
+            throw CompilationError(
+                CompilationStep::GENERAL, "Failed to open file to write serialized module", config.moduleOutputFile);
+        serializeModule(module, moduleOutput);
+    }
+}
+
+/*
+ * Collects the peak memory usage of the compilation stages of all kernels, if requested by the configuration
+ */
+class MemoryReport
+{
+public:
+    explicit MemoryReport(const Configuration& config) : fileName(config.memoryReportFile) {}
 
-    PROFILE_START(SecondNormalizer);
-    norm.adjust(module);
-    PROFILE_END(SecondNormalizer);
+    void addStage(const Method& kernel, const char* stage, const profiler::MemoryUsage& usage)
+    {
+        if(fileName.empty())
+            return;
+        std::lock_guard<std::mutex> guard(lock);
+        kernels[kernel.name].emplace_back(stage, usage);
+    }
 
+    void write() const
+    {
+        if(fileName.empty())
+            return;
+        std::ofstream out(fileName, std::ios::trunc);
+        if(!out)
+            throw CompilationError(CompilationStep::GENERAL, "Failed to open file to write memory report", fileName);
+        out << "{" << std::endl << "  \"kernels\": {";
+        for(auto it = kernels.begin(); it != kernels.end(); ++it)
+        {
+            out << (it != kernels.begin() ? "," : "") << std::endl << "    \"" << it->first << "\": {";
+            for(auto stageIt = it->second.begin(); stageIt != it->second.end(); ++stageIt)
+            {
+                out << (stageIt != it->second.begin() ? ", " : "") << "\"" << stageIt->first << "\": ";
+                writeUsage(out, stageIt->second);
+            }
+            out << "}";
+        }
+        out << std::endl << "  }," << std::endl << "  \"process\": ";
+        writeUsage(out, profiler::getMemoryUsage());
+        out << std::endl << "}" << std::endl;
+    }
+
+private:
+    std::string fileName;
+    std::mutex lock;
+    // the stages of every kernel in the order they were run
+    std::map<std::string, std::vector<std::pair<const char*, profiler::MemoryUsage>>> kernels;
+
+    static void writeUsage(std::ostream& out, const profiler::MemoryUsage& usage)
+    {
+        out << "{\"peak\": " << usage.peakTotal;
+        for(std::size_t i = 0; i < profiler::NUM_MEMORY_CATEGORIES; ++i)
+            out << ", \"" << profiler::toString(static_cast<profiler::MemoryCategory>(i)) << "\": " << usage.peak[i];
+        out << "}";
+    }
+};
+
+/*
+ * Runs the remaining compilation steps for all kernels of the prepared module and writes the generated machine code.
+ *
+ * The flag is set if the optimization of any kernel was cut short by the configured time budgets.
+ */
+static std::size_t generateCode(
+    Module& module, std::ostream& output, const Configuration& config, std::atomic_bool& exceededTimeBudget)
+{
+    normalization::Normalizer norm(config);
+    optimizations::Optimizer opt(config);
+
+    // the kernel variants are created from the prepared kernels, so they are also created for serialized modules
+    normalization::specializeKernels(module, config);
+    normalization::fuseKernels(module, config);
+    normalization::createKernelVersions(module, config);
+    // the constant pool depends on the configuration, so it is not part of the serialized module
+    normalization::createConstantPool(module, config);
+    // the global data is only shrunk after all kernel variants and constant pool entries (referencing it) exist
+    normalization::optimizeGlobalData(module);
+    // the kernels identical to another kernel are not compiled, but share the code of the other kernel
+    auto duplicateKernels = normalization::findDuplicateKernels(module, config);
+
+    qpu_asm::CodeGenerator codeGen(module, config);
+    for(const auto& duplicate : duplicateKernels)
+        codeGen.addKernelAlias(*duplicate.first, *duplicate.second);
+    // the optimized intermediate code of the kernels, by kernel name, if requested
+    std::map<std::string, std::string> intermediateCode;
+    std::mutex intermediateCodeLock;
+    MemoryReport memoryReport(config);
+
+    // after inlining, all kernels are independent of each other, so every kernel runs through the remaining stages
+    // on its own without waiting for the other kernels to finish the previous stage
     auto kernels = module.getKernels();
-    const auto f = [&codeGen](Method* kernelFunc) -> void { codeGen.toMachineCode(*kernelFunc); };
-    ThreadPool{"CodeGenerator"}.scheduleAll<Method*>(kernels, f);
+    kernels.erase(std::remove_if(kernels.begin(), kernels.end(),
+                      [&](Method* kernel) -> bool { return duplicateKernels.find(kernel) != duplicateKernels.end(); }),
+        kernels.end());
+    auto compilation = getCurrentCompilation();
+    const auto f = [&](Method* kernelFunc) -> void {
+        CompilationScope compilationScope(compilation);
+        // kernels which did not change since they were last compiled can reuse the previously generated machine code
+        std::string fingerprint;
+        // the block positions for the execution profile, the optimized intermediate code and the memory usage are
+        // only known when actually generating the code
+        if(!config.cacheDirectory.empty() && config.profileGenerateFile.empty() &&
+            config.intermediateOutputFile.empty() && config.memoryReportFile.empty())
+        {
+            fingerprint = qpu_asm::calculateKernelFingerprint(module, *kernelFunc, config);
+            if(auto cachedKernel = qpu_asm::lookupKernel(fingerprint, config))
+            {
+                codeGen.addPrecompiledKernel(*kernelFunc, std::move(cachedKernel).value());
+                codeGen.finishKernel(*kernelFunc);
+                return;
+            }
+        }
+
+        // while waiting for its own parallel tasks, this thread might run (parts of) other kernels (see
+        // ThreadPool#waitFor()), so do not account their memory usage for this kernel and vice versa
+        profiler::MemoryScope kernelMemory(true);
+
+        {
+            profiler::MemoryScope stageMemory;
+            enterCompilationStage(CompilationStep::NORMALIZER, kernelFunc->name);
+            PROFILE_START(Normalizer);
+            PROFILE_TRACE_START(Normalizer);
+            norm.normalizeMethod(module, *kernelFunc);
+            PROFILE_END(Normalizer);
+            PROFILE_TRACE_END("stage", Normalizer);
+            memoryReport.addStage(*kernelFunc, "Normalizer", stageMemory.getUsage());
+        }
+
+        {
+            profiler::MemoryScope stageMemory;
+            enterCompilationStage(CompilationStep::OPTIMIZER, kernelFunc->name);
+            PROFILE_START(Optimizer);
+            PROFILE_TRACE_START(Optimizer);
+            auto optimizationStatistics = opt.optimizeMethod(module, *kernelFunc);
+            // do not cache the code of kernels only partially optimized, to retry the full optimization next time
+            if(optimizationStatistics.exceededTimeBudget)
+            {
+                exceededTimeBudget = true;
+                fingerprint.clear();
+            }
+            PROFILE_END(Optimizer);
+            PROFILE_TRACE_END("stage", Optimizer);
+            memoryReport.addStage(*kernelFunc, "Optimizer", stageMemory.getUsage());
+        }
+
+        if(!config.intermediateOutputFile.empty())
+        {
+            std::stringstream ss;
+            kernelFunc->dumpInstructions(ss);
+            std::lock_guard<std::mutex> guard(intermediateCodeLock);
+            intermediateCode[kernelFunc->name] = ss.str();
+        }
+
+        {
+            profiler::MemoryScope stageMemory;
+            enterCompilationStage(CompilationStep::NORMALIZER, kernelFunc->name);
+            PROFILE_START(SecondNormalizer);
+            PROFILE_TRACE_START(SecondNormalizer);
+            norm.adjustMethod(module, *kernelFunc);
+            PROFILE_END(SecondNormalizer);
+            PROFILE_TRACE_END("stage", SecondNormalizer);
+            memoryReport.addStage(*kernelFunc, "SecondNormalizer", stageMemory.getUsage());
+        }
+
+        {
+            profiler::MemoryScope stageMemory;
+            enterCompilationStage(CompilationStep::CODE_GENERATION, kernelFunc->name);
+            PROFILE_START(CodeGenerator);
+            PROFILE_TRACE_START(CodeGenerator);
+            codeGen.toMachineCode(*kernelFunc);
+            PROFILE_END(CodeGenerator);
+            PROFILE_TRACE_END("stage", CodeGenerator);
+            memoryReport.addStage(*kernelFunc, "CodeGenerator", stageMemory.getUsage());
+        }
+        memoryReport.addStage(*kernelFunc, "total", kernelMemory.getUsage());
+
+        if(!fingerprint.empty())
+            qpu_asm::storeKernel(fingerprint, config, codeGen.getCompiledKernel(*kernelFunc));
+        // only keep the output data of the finished kernel, not all generated instructions
+        codeGen.finishKernel(*kernelFunc);
+    };
+    for(const auto& batch : groupKernelsByMemory(kernels, config.maxCompilationMemory))
+    {
+        if(!profiler::exceedsMemoryLimit(config.maxCompilationMemory))
+        {
+            ThreadPool::getDefaultPool().scheduleAll<Method*>(batch, f);
+            continue;
+        }
+        // Compile the kernels one after another on this thread. This cannot be done by locking the kernels against
+        // each other, since a kernel waiting for its own parallel tasks might run another kernel on the same thread.
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Memory limit is exceeded, compiling the next " << batch.size() << " kernels one after another"
+                << logging::endl);
+        for(auto kernel : batch)
+            f(kernel);
+    }
+
+    if(!config.intermediateOutputFile.empty())
+    {
+        std::ofstream intermediateOutput(config.intermediateOutputFile, std::ios::trunc);
+        for(const auto& entry : intermediateCode)
+            intermediateOutput << "; kernel " << entry.first << std::endl << entry.second;
+        if(!intermediateOutput)
+            throw CompilationError(CompilationStep::GENERAL, "Failed to write intermediate code",
+                config.intermediateOutputFile);
+    }
 
-    // TODO could discard unused globals
-    // since they are exported, they are still in the intermediate code, even if not used (e.g. optimized away)
+    memoryReport.write();
 
     // code generation
     std::size_t bytesWritten = codeGen.writeOutput(output);
@@ -128,6 +393,118 @@ std::size_t Compiler::convert()
     return bytesWritten;
 }
 
+/*
+ * Records a trace of the compilation stages while it exists, if requested by the configuration
+ */
+class CompilationTrace
+{
+public:
+    explicit CompilationTrace(const Configuration& config) : fileName(config.traceOutputFile)
+    {
+        if(!fileName.empty())
+            profiler::startTracing();
+    }
+    CompilationTrace(const CompilationTrace&) = delete;
+    CompilationTrace(CompilationTrace&&) noexcept = delete;
+    ~CompilationTrace()
+    {
+        if(fileName.empty())
+            return;
+        // also write the trace if the compilation failed, to show the stages run so far
+        std::ofstream traceOutput(fileName, std::ios::trunc);
+        if(traceOutput)
+            profiler::writeTrace(traceOutput);
+        else
+            logging::error() << "Failed to open file to write compilation trace: " << fileName << logging::endl;
+    }
+
+    CompilationTrace& operator=(const CompilationTrace&) = delete;
+    CompilationTrace& operator=(CompilationTrace&&) noexcept = delete;
+
+private:
+    std::string fileName;
+};
+
+std::size_t Compiler::convert()
+{
+    CompilationTrace trace(config);
+    Module module(config);
+    if(!config.profileUseFile.empty())
+        module.executionProfile = analysis::ExecutionProfile::readFile(config.profileUseFile);
+
+    readModule(module, input, config);
+    std::atomic_bool exceeded{false};
+    auto bytesWritten = generateCode(module, output, config, exceeded);
+    exceededTimeBudget = exceeded;
+    return bytesWritten;
+}
+
+std::size_t Compiler::convertToObject()
+{
+    CompilationTrace trace(config);
+    Module module(config);
+    readModule(module, input, config);
+
+    auto bytesWritten = serializeModule(module, output);
+    output.flush();
+    return bytesWritten;
+}
+
+std::size_t Compiler::convertToKernelInfo()
+{
+    Module module(config);
+    if(isSerializedModule(input))
+        // the kernel declarations are part of the relocatable object
+        deserializeModule(module, input);
+    else
+    {
+        enterCompilationStage(CompilationStep::PARSER);
+        std::unique_ptr<Parser> parser = getParser(input);
+        PROFILE_START(ParseDeclarations);
+        parser->parseDeclarations(module);
+        PROFILE_END(ParseDeclarations);
+    }
+
+    qpu_asm::ModuleInfo moduleInfo;
+    for(auto kernel : module.getKernels())
+        moduleInfo.addKernelInfo(qpu_asm::getKernelInfos(*kernel, 0, 0));
+    // the (empty) kernel codes start directly after the header
+    auto headerSize = moduleInfo.calculateHeaderSize(config.outputMode, {});
+    for(auto& info : moduleInfo.kernelInfos)
+        info.setOffset(Word(headerSize));
+    auto bytesWritten =
+        moduleInfo.write(output, config.outputMode, StableList<Global>{}, std::vector<uint8_t>{}, Byte(0)) *
+        sizeof(uint64_t);
+    output.flush();
+    return bytesWritten;
+}
+
+/*
+ * Stream buffer directly appending all written data to a byte vector
+ */
+class ByteVectorBuffer : public std::streambuf
+{
+public:
+    explicit ByteVectorBuffer(std::vector<uint8_t>& data) : data(data) {}
+
+protected:
+    std::streamsize xsputn(const char_type* s, std::streamsize count) override
+    {
+        data.insert(data.end(), reinterpret_cast<const uint8_t*>(s), reinterpret_cast<const uint8_t*>(s) + count);
+        return count;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if(!traits_type::eq_int_type(ch, traits_type::eof()))
+            data.push_back(static_cast<uint8_t>(traits_type::to_char_type(ch)));
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    std::vector<uint8_t>& data;
+};
+
 Configuration& Compiler::getConfiguration()
 {
     return config;
@@ -140,25 +517,161 @@ const Configuration& Compiler::getConfiguration() const
 
 std::size_t Compiler::compile(std::istream& input, std::ostream& output, const Configuration& config,
     const std::string& options, const Optional<std::string>& inputFile)
+{
+    return runCompilation(input, output, config, options, inputFile, OutputKind::MACHINE_CODE);
+}
+
+CompilationHandle Compiler::compileAsync(std::istream& input, std::ostream& output, const Configuration& config,
+    const std::string& options, const Optional<std::string>& inputFile, ProgressCallback progress)
+{
+    auto state = std::make_shared<CompilationState>();
+    state->progress = std::move(progress);
+    // the configuration and the options are copied, since they are not required to outlive the compilation
+    auto future = ThreadPool::getDefaultPool().schedule([&input, &output, config, options, inputFile, state]() {
+        CompilationScope scope(state.get());
+        state->bytesWritten = runCompilation(input, output, config, options, inputFile, OutputKind::MACHINE_CODE);
+    });
+    return CompilationHandle(std::move(state), std::move(future));
+}
+
+std::size_t Compiler::compileObject(std::istream& input, std::ostream& output, const Configuration& config,
+    const std::string& options, const Optional<std::string>& inputFile)
+{
+    return runCompilation(input, output, config, options, inputFile, OutputKind::OBJECT);
+}
+
+std::size_t Compiler::extractKernelInfo(std::istream& input, std::ostream& output, const Configuration& config,
+    const std::string& options, const Optional<std::string>& inputFile)
+{
+    return runCompilation(input, output, config, options, inputFile, OutputKind::KERNEL_INFO);
+}
+
+std::size_t Compiler::linkObjects(
+    const std::vector<std::istream*>& objects, std::ostream& output, const Configuration& config)
 {
     try
     {
+        Module module(config);
+        if(!config.profileUseFile.empty())
+            module.executionProfile = analysis::ExecutionProfile::readFile(config.profileUseFile);
+
+        PROFILE_START(LinkObjects);
+        for(auto object : objects)
+        {
+            if(!isSerializedModule(*object))
+                throw CompilationError(CompilationStep::LINKER, "Input is not a relocatable object");
+            deserializeModule(module, *object);
+        }
+        PROFILE_END(LinkObjects);
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Linked " << objects.size() << " objects into a module with " << module.methods.size()
+                << " kernels and " << module.globalData.size() << " globals" << logging::endl);
+
+        std::atomic_bool exceededTimeBudget{false};
+        auto result = generateCode(module, output, config, exceededTimeBudget);
+        CPPLOG_LAZY(
+            logging::Level::DEBUG, log << "Compilation complete: " << result << " bytes written" << logging::endl);
+        return result;
+    }
+    catch(const CompilationError& e)
+    {
+        // log exception to log
+        logging::error() << "Compiler threw exception: " << e.what() << logging::endl;
+        // re-throw, so caller gets notified
+        throw;
+    }
+}
+
+std::size_t Compiler::runCompilation(std::istream& input, std::ostream& output, const Configuration& config,
+    const std::string& options, const Optional<std::string>& inputFile, OutputKind outputKind)
+{
+    try
+    {
+        std::string cacheKey;
+        std::istringstream cachedInput;
+        std::ostringstream cachedOutput;
+        std::reference_wrapper<std::istream> precompilerInput = input;
+        std::reference_wrapper<std::ostream> compilerOutput = output;
+        // if the serialized module, the block positions, the statistics, the trace or the intermediate code are
+        // requested, we need to actually run the compilation
+        if(!config.cacheDirectory.empty() && config.moduleOutputFile.empty() && config.profileGenerateFile.empty() &&
+            config.statisticsOutputFile.empty() && config.traceOutputFile.empty() &&
+            config.intermediateOutputFile.empty() && config.memoryReportFile.empty() &&
+            outputKind == OutputKind::MACHINE_CODE)
+        {
+            // the input needs to be read completely to calculate the cache key, so we buffer it for the
+            // pre-compilation
+            cachedInput.str(std::string{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()});
+            precompilerInput = cachedInput;
+            if(CompilationCache::isCacheable(cachedInput.str(), options))
+            {
+                cacheKey = CompilationCache::calculateKey(cachedInput.str(), config, options);
+                if(auto bytesWritten = CompilationCache::lookup(cacheKey, config, output))
+                {
+                    output.flush();
+                    return bytesWritten.value();
+                }
+                compilerOutput = cachedOutput;
+            }
+            else
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Not using compilation cache for input including other files" << logging::endl);
+        }
+
         // pre-compilation
-        TemporaryFile tmpFile;
         std::unique_ptr<std::istream> in;
-        Precompiler::precompile(input, in, config, options, inputFile, tmpFile.fileName);
+        std::reference_wrapper<std::istream> compilerInput = precompilerInput;
+#ifndef USE_LIBCLANG
+        // external compilers might remove /dev/stdout when writing to it, so write into a temporary file instead
+        TemporaryFile tmpFile;
+#endif
+        // serialized modules are already past the front-ends, so they are directly passed to the compiler
+        if(!isSerializedModule(precompilerInput))
+        {
+            enterCompilationStage(CompilationStep::PRECOMPILATION);
+#ifdef USE_LIBCLANG
+            // the OpenCL C compilation runs in-process, so the pre-compiled code can be kept in memory
+            Precompiler::precompile(precompilerInput, in, config, options, inputFile);
+#else
+            Precompiler::precompile(precompilerInput, in, config, options, inputFile, tmpFile.fileName);
 
-        if(in == nullptr ||
-            (dynamic_cast<std::istringstream*>(in.get()) != nullptr &&
-                dynamic_cast<std::istringstream*>(in.get())->str().empty()))
-            // replace only when pre-compiled (and not just linked output to input, e.g. if source-type is output-type)
-            tmpFile.openInputStream(in);
+            if(in == nullptr ||
+                (dynamic_cast<std::istringstream*>(in.get()) != nullptr &&
+                    dynamic_cast<std::istringstream*>(in.get())->str().empty()))
+                // replace only when pre-compiled (and not just linked output to input, e.g. if source-type is
+                // output-type)
+                tmpFile.openInputStream(in);
+#endif
+            compilerInput = *in;
+        }
 
         // compilation
-        Compiler conv(*in, output);
+        Compiler conv(compilerInput, compilerOutput);
 
         conv.getConfiguration() = config;
-        std::size_t result = conv.convert();
+        std::size_t result = 0;
+        switch(outputKind)
+        {
+        case OutputKind::MACHINE_CODE:
+            result = conv.convert();
+            break;
+        case OutputKind::OBJECT:
+            result = conv.convertToObject();
+            break;
+        case OutputKind::KERNEL_INFO:
+            result = conv.convertToKernelInfo();
+            break;
+        }
+        // the module is destroyed, so most of the pooled memory is unused
+        tools::releaseUnusedPoolMemory();
+
+        if(!cacheKey.empty())
+        {
+            // do not cache partially optimized code, to retry the full optimization next time
+            if(!conv.exceededTimeBudget)
+                CompilationCache::insert(cacheKey, config, cachedOutput.str(), result);
+            output << cachedOutput.str();
+        }
 
         // clean-up
         std::wcout.flush();
@@ -179,12 +692,32 @@ std::size_t Compiler::compile(std::istream& input, std::ostream& output, const C
     }
 }
 
+std::vector<uint8_t> Compiler::compileToBinary(std::istream& input, const Configuration& config,
+    const std::string& options, const Optional<std::string>& inputFile)
+{
+    Configuration binaryConfig = config;
+    binaryConfig.outputMode = OutputMode::BINARY;
+    std::vector<uint8_t> binary;
+    // the module is written with a single write call (see CodeGenerator#writeOutput()), which is directly appended
+    ByteVectorBuffer buffer(binary);
+    std::ostream output(&buffer);
+    compile(input, output, binaryConfig, options, inputFile);
+    return binary;
+}
+
 std::unique_ptr<logging::Logger> logging::LOGGER(new logging::ColoredLogger(std::wcout, logging::Level::WARNING));
+std::atomic<unsigned> vc4c::activeLogSeverity{toSeverity(logging::Level::WARNING)};
 
 void vc4c::setLogger(std::wostream& outputStream, const bool coloredOutput, const LogLevel level)
 {
+    activeLogSeverity.store(toSeverity(static_cast<logging::Level>(level)), std::memory_order_relaxed);
     if(coloredOutput)
         logging::LOGGER = std::make_unique<logging::ColoredLogger>(outputStream, static_cast<logging::Level>(level));
     else
         logging::LOGGER = std::make_unique<logging::StreamLogger>(outputStream, static_cast<logging::Level>(level));
 }
+
+void vc4c::setMaximumCompilationThreads(unsigned numThreads)
+{
+    ThreadPool::setMaximumParallelism(numThreads);
+}
@@ -9,12 +9,19 @@
 #include "GlobalValues.h"
 #include "Locals.h"
 #include "asm/ALUInstruction.h"
+#include "asm/BranchInstruction.h"
 #include "asm/Instruction.h"
 #include "asm/KernelInfo.h"
 #include "asm/LoadInstruction.h"
+#include "asm/SemaphoreInstruction.h"
 #include "log.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <sstream>
 
 using namespace vc4c;
@@ -22,6 +29,9 @@ using namespace vc4c;
 // Is located in Types.cpp
 extern TypeHolder GLOBAL_TYPE_HOLDER;
 
+// the size of the text collected before it is written to the output stream at once
+static constexpr std::size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+
 LCOV_EXCL_START
 static std::vector<std::string> createUniformValues(const qpu_asm::KernelInfo& kernel)
 {
@@ -35,6 +45,7 @@ static std::vector<std::string> createUniformValues(const qpu_asm::KernelInfo& k
      * - global_offset (x, y, z): global initial offset per dimension
      * - address of global data / to load the global data from
      * - parameters
+     * - precomputed values
      * - re-run counter
      */
     const KernelUniforms& uniformsUsed = kernel.uniformsUsed;
@@ -72,6 +83,8 @@ static std::vector<std::string> createUniformValues(const qpu_asm::KernelInfo& k
         for(uint16_t i = 0; i < param.getVectorElements(); ++i)
             values.emplace_back(param.typeName + " " + param.name);
     }
+    for(const auto& expression : kernel.precomputedUniforms)
+        values.emplace_back("precomputed value (" + expression.to_string() + ")");
     if(uniformsUsed.getUniformAddressUsed())
         values.emplace_back("uniform address");
     if(uniformsUsed.getMaxGroupIDXUsed())
@@ -228,49 +241,45 @@ static std::string readString(std::istream& binary, uint64_t stringLength)
     return name;
 }
 
-void extractBinary(std::istream& binary, qpu_asm::ModuleInfo& moduleInfo, StableList<Global>& globals,
-    std::vector<qpu_asm::Instruction>& instructions)
+static qpu_asm::KernelInfo readKernelInfo(std::istream& binary)
 {
-    // skip magic number
-    binary.seekg(8);
-
-    uint64_t initialInstructionOffset = std::numeric_limits<uint64_t>::max();
-    uint64_t totalInstructions = 0;
-    binary.read(reinterpret_cast<char*>(&moduleInfo.value), sizeof(moduleInfo.value));
+    qpu_asm::KernelInfo kernelInfo(4);
+    binary.read(reinterpret_cast<char*>(&kernelInfo.value), sizeof(kernelInfo.value));
+    binary.read(reinterpret_cast<char*>(&kernelInfo.workGroupSize), sizeof(kernelInfo.workGroupSize));
+    binary.read(reinterpret_cast<char*>(&kernelInfo.uniformsUsed.value), sizeof(kernelInfo.uniformsUsed.value));
+    kernelInfo.name = readString(binary, kernelInfo.getNameLength().getValue());
     CPPLOG_LAZY(logging::Level::DEBUG,
-        log << "Extracted module with " << moduleInfo.getInfoCount() << " kernels, " << moduleInfo.getGlobalDataSize()
-            << " words of global data and " << moduleInfo.getStackFrameSize() << " words of stack-frames"
+        log << "Extracted kernel '" << kernelInfo.name << "' with " << kernelInfo.getParamCount() << " parameters"
             << logging::endl);
 
-    for(uint16_t k = 0; k < moduleInfo.getInfoCount(); ++k)
+    for(uint16_t p = 0; p < kernelInfo.getParamCount(); ++p)
     {
-        qpu_asm::KernelInfo kernelInfo(4);
-        binary.read(reinterpret_cast<char*>(&kernelInfo.value), sizeof(kernelInfo.value));
-        binary.read(reinterpret_cast<char*>(&kernelInfo.workGroupSize), sizeof(kernelInfo.workGroupSize));
-        binary.read(reinterpret_cast<char*>(&kernelInfo.uniformsUsed.value), sizeof(kernelInfo.uniformsUsed.value));
-        kernelInfo.name = readString(binary, kernelInfo.getNameLength().getValue());
-        totalInstructions += kernelInfo.getLength().getValue();
+        qpu_asm::ParamInfo paramInfo;
+        binary.read(reinterpret_cast<char*>(&paramInfo.value), sizeof(paramInfo.value));
+        paramInfo.name = readString(binary, paramInfo.getNameLength().getValue());
+        paramInfo.typeName = readString(binary, paramInfo.getTypeNameLength().getValue());
         CPPLOG_LAZY(logging::Level::DEBUG,
-            log << "Extracted kernel '" << kernelInfo.name << "' with " << kernelInfo.getParamCount() << " parameters"
-                << logging::endl);
-
-        for(uint16_t p = 0; p < kernelInfo.getParamCount(); ++p)
+            log << "Extracted parameter '" << paramInfo.typeName << " " << paramInfo.name << logging::endl);
+        kernelInfo.parameters.push_back(paramInfo);
+    }
+    kernelInfo.precomputedUniforms.resize(kernelInfo.uniformsUsed.getNumPrecomputedValues());
+    for(auto& expression : kernelInfo.precomputedUniforms)
+    {
+        uint64_t word = 0;
+        binary.read(reinterpret_cast<char*>(&word), sizeof(word));
+        expression.steps.resize(static_cast<std::size_t>(word));
+        for(auto& step : expression.steps)
         {
-            qpu_asm::ParamInfo paramInfo;
-            binary.read(reinterpret_cast<char*>(&paramInfo.value), sizeof(paramInfo.value));
-            paramInfo.name = readString(binary, paramInfo.getNameLength().getValue());
-            paramInfo.typeName = readString(binary, paramInfo.getTypeNameLength().getValue());
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Extracted parameter '" << paramInfo.typeName << " " << paramInfo.name << logging::endl);
-            kernelInfo.parameters.push_back(paramInfo);
+            binary.read(reinterpret_cast<char*>(&word), sizeof(word));
+            step.code = static_cast<UniformExpression::OpCode>((word >> 32) & 0xFF);
+            step.operand = static_cast<uint32_t>(word);
         }
-        moduleInfo.kernelInfos.push_back(kernelInfo);
-        initialInstructionOffset = std::min(initialInstructionOffset, kernelInfo.getOffset().getValue());
     }
+    return kernelInfo;
+}
 
-    // skip zero-word between kernels and globals
-    binary.seekg(sizeof(uint64_t), std::ios_base::cur);
-
+static void readGlobalData(std::istream& binary, const qpu_asm::ModuleInfo& moduleInfo, StableList<Global>& globals)
+{
     if(moduleInfo.getGlobalDataSize().getValue() > 0)
     {
         // since we don't know the number, sizes and types of the original globals, we build a single global containing
@@ -294,6 +303,107 @@ void extractBinary(std::istream& binary, qpu_asm::ModuleInfo& moduleInfo, Stable
         CPPLOG_LAZY(logging::Level::DEBUG,
             log << "Extracted " << moduleInfo.getGlobalDataSize() << " words of global data" << logging::endl);
     }
+}
+
+/*
+ * Reads all instruction words at once and decodes them into the given list of instructions
+ */
+static void decodeInstructions(
+    std::istream& binary, uint64_t numInstructions, std::vector<qpu_asm::Instruction>& instructions)
+{
+    std::vector<uint64_t> words(numInstructions);
+    binary.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint64_t)));
+    if(static_cast<uint64_t>(binary.gcount()) != words.size() * sizeof(uint64_t))
+        throw CompilationError(CompilationStep::GENERAL, "Unexpected end of machine code",
+            std::to_string(static_cast<uint64_t>(binary.gcount()) / sizeof(uint64_t)) + " of " +
+                std::to_string(numInstructions) + " instructions");
+    instructions.reserve(instructions.size() + words.size());
+    for(auto word : words)
+    {
+        qpu_asm::Instruction instr(word);
+        if(!instr.isValidInstruction())
+            throw CompilationError(CompilationStep::GENERAL, "Unrecognized instruction", std::to_string(word));
+        instructions.emplace_back(instr);
+    }
+}
+
+static void readInstructions(std::istream& binary, uint64_t firstIndex, uint64_t numInstructions,
+    const qpu_asm::ModuleInfo& moduleInfo, std::vector<qpu_asm::Instruction>& instructions)
+{
+    auto firstInstruction = instructions.size();
+    decodeInstructions(binary, numInstructions, instructions);
+    // the instructions are only formatted and annotated if they are actually logged
+    logging::logLazy(logging::Level::DEBUG, [&](std::wostream& os) {
+        for(uint64_t i = 0; i < numInstructions; ++i)
+        {
+            const auto& instr = instructions[firstInstruction + i];
+            os << instr.toASMString() << annotateRegisters(instr, firstIndex + i, moduleInfo) << logging::endl;
+        }
+    });
+}
+
+void extractBinary(std::istream& binary, qpu_asm::ModuleInfo& moduleInfo, StableList<Global>& globals,
+    std::vector<qpu_asm::Instruction>& instructions)
+{
+    // the second half of the magic number word determines the module format
+    uint32_t formatMagic = 0;
+    binary.seekg(4);
+    binary.read(reinterpret_cast<char*>(&formatMagic), sizeof(formatMagic));
+    const bool isSectioned = formatMagic == QPUASM_SECTIONED_MAGIC_NUMBER;
+
+    uint64_t initialInstructionOffset = std::numeric_limits<uint64_t>::max();
+    uint64_t totalInstructions = 0;
+    binary.read(reinterpret_cast<char*>(&moduleInfo.value), sizeof(moduleInfo.value));
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Extracted " << (isSectioned ? "sectioned " : "") << "module with " << moduleInfo.getInfoCount()
+            << " kernels, " << moduleInfo.getGlobalDataSize() << " words of global data and "
+            << moduleInfo.getStackFrameSize() << " words of stack-frames" << logging::endl);
+
+    if(isSectioned)
+    {
+        // the kernel infos are contained in the kernel sections, the index only contains their positions
+        std::vector<uint32_t> sectionOffsets;
+        sectionOffsets.reserve(moduleInfo.getInfoCount());
+        for(uint16_t k = 0; k < moduleInfo.getInfoCount(); ++k)
+        {
+            std::array<uint32_t, 4> indexEntry{};
+            binary.read(reinterpret_cast<char*>(indexEntry.data()), sizeof(indexEntry));
+            sectionOffsets.push_back(indexEntry[0]);
+        }
+        binary.seekg(static_cast<std::streamoff>(moduleInfo.getGlobalDataOffset().toBytes().getValue()));
+        readGlobalData(binary, moduleInfo, globals);
+
+        for(auto sectionOffset : sectionOffsets)
+        {
+            binary.seekg(static_cast<std::streamoff>(sectionOffset * sizeof(uint64_t)));
+            auto kernelInfo = readKernelInfo(binary);
+            readInstructions(
+                binary, kernelInfo.getOffset().getValue(), kernelInfo.getLength().getValue(), moduleInfo, instructions);
+            // the extracted instructions of all kernels are contiguous, so the offsets are adapted to skip the kernel
+            // infos in between, like in the non-sectioned format
+            if(moduleInfo.kernelInfos.empty())
+                initialInstructionOffset = kernelInfo.getOffset().getValue();
+            kernelInfo.setOffset(Word(initialInstructionOffset + totalInstructions));
+            totalInstructions += kernelInfo.getLength().getValue();
+            moduleInfo.kernelInfos.push_back(kernelInfo);
+        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Extracted " << totalInstructions << " machine-code instructions" << logging::endl);
+        return;
+    }
+
+    for(uint16_t k = 0; k < moduleInfo.getInfoCount(); ++k)
+    {
+        auto kernelInfo = readKernelInfo(binary);
+        totalInstructions += kernelInfo.getLength().getValue();
+        moduleInfo.kernelInfos.push_back(kernelInfo);
+        initialInstructionOffset = std::min(initialInstructionOffset, kernelInfo.getOffset().getValue());
+    }
+
+    // skip zero-word between kernels and globals
+    binary.seekg(sizeof(uint64_t), std::ios_base::cur);
+
+    readGlobalData(binary, moduleInfo, globals);
 
     // skip zero-word between globals and kernel-code
     binary.seekg(sizeof(uint64_t), std::ios_base::cur);
@@ -301,22 +411,77 @@ void extractBinary(std::istream& binary, qpu_asm::ModuleInfo& moduleInfo, Stable
     // the remainder is kernel-code
     // we don't need to associate it to any particular kernel
     instructions.reserve(totalInstructions);
+    readInstructions(binary, initialInstructionOffset, totalInstructions, moduleInfo, instructions);
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Extracted " << totalInstructions << " machine-code instructions" << logging::endl);
+}
 
-    for(uint64_t i = initialInstructionOffset; i < totalInstructions + initialInstructionOffset; ++i)
+/*
+ * Collects the output text and writes it to the output stream in large chunks
+ */
+struct OutputBuffer
+{
+    std::ostream& stream;
+    std::string text;
+
+    explicit OutputBuffer(std::ostream& stream) : stream(stream)
     {
-        uint64_t tmp64;
-        binary.read(reinterpret_cast<char*>(&tmp64), sizeof(tmp64));
-        qpu_asm::Instruction instr(tmp64);
-        if(!instr.isValidInstruction())
-            throw CompilationError(CompilationStep::GENERAL, "Unrecognized instruction", std::to_string(tmp64));
-        instructions.emplace_back(instr);
-        logging::logLazy(logging::Level::DEBUG, [&](std::wostream& os) {
-            os << instr.toASMString() << annotateRegisters(instr, i, moduleInfo) << logging::endl;
-        });
+        text.reserve(OUTPUT_BUFFER_SIZE + 256);
     }
 
-    CPPLOG_LAZY(logging::Level::DEBUG,
-        log << "Extracted " << totalInstructions << " machine-code instructions" << logging::endl);
+    ~OutputBuffer()
+    {
+        flush();
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer(OutputBuffer&&) noexcept = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(OutputBuffer&&) noexcept = delete;
+
+    void finishLine()
+    {
+        text.push_back('\n');
+        if(text.size() >= OUTPUT_BUFFER_SIZE)
+            flush();
+    }
+
+    void flush()
+    {
+        stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+        text.clear();
+    }
+};
+
+static void appendHexCode(std::string& text, uint64_t code)
+{
+    // same format as qpu_asm::toHexString(), but without creating a temporary string
+    std::array<char, 32> buffer{};
+    auto length = snprintf(buffer.data(), buffer.size(), "0x%08x, 0x%08x, ", static_cast<uint32_t>(code & 0xFFFFFFFFLL),
+        static_cast<uint32_t>((code & 0xFFFFFFFF00000000LL) >> 32));
+    text.append(buffer.data(), static_cast<std::size_t>(length));
+}
+
+static std::size_t writeInstructions(
+    OutputBuffer& output, const std::vector<qpu_asm::Instruction>& instructions, const OutputMode outputMode)
+{
+    if(outputMode != OutputMode::ASSEMBLER && outputMode != OutputMode::HEX)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Invalid output mode", std::to_string(static_cast<unsigned>(outputMode)));
+    // the number of bytes is unused for assembler and hexadecimal output
+    std::size_t numBytes = outputMode == OutputMode::HEX ? instructions.size() * sizeof(uint64_t) : 0;
+    for(const auto& instr : instructions)
+    {
+        if(outputMode == OutputMode::HEX)
+        {
+            appendHexCode(output.text, instr.toBinaryCode());
+            output.text.append("//");
+        }
+        output.text.append(instr.toASMString());
+        output.finishLine();
+    }
+    return numBytes;
 }
 
 static std::size_t generateOutput(std::ostream& stream, qpu_asm::ModuleInfo& moduleInfo,
@@ -324,26 +489,102 @@ static std::size_t generateOutput(std::ostream& stream, qpu_asm::ModuleInfo& mod
     const OutputMode outputMode)
 {
     std::size_t numBytes = moduleInfo.write(stream, outputMode, globals, Byte(0)) * sizeof(uint64_t);
+    {
+        OutputBuffer output(stream);
+        numBytes += writeInstructions(output, instructions, outputMode);
+    }
+    stream.flush();
+    return numBytes;
+}
 
-    for(const auto& instr : instructions)
+static const char* getInstructionType(const qpu_asm::Instruction& instr)
+{
+    if(instr.as<qpu_asm::ALUInstruction>())
+        return "alu";
+    if(instr.as<qpu_asm::BranchInstruction>())
+        return "branch";
+    if(instr.as<qpu_asm::LoadInstruction>())
+        return "load";
+    if(instr.as<qpu_asm::SemaphoreInstruction>())
+        return "semaphore";
+    return "invalid";
+}
+
+/*
+ * Appends the given text as quoted CSV field or JSON string
+ */
+static void appendQuoted(std::string& text, const std::string& value, DisassemblyTable format)
+{
+    text.push_back('"');
+    for(auto c : value)
     {
-        switch(outputMode)
+        if(c == '"')
+            // CSV escapes quotes by doubling them, JSON with a backslash
+            text.push_back(format == DisassemblyTable::CSV ? '"' : '\\');
+        else if(c == '\\' && format == DisassemblyTable::JSON)
+            text.push_back('\\');
+        text.push_back(c);
+    }
+    text.push_back('"');
+}
+
+static std::size_t generateTable(std::ostream& stream, const qpu_asm::ModuleInfo& moduleInfo,
+    const std::vector<qpu_asm::Instruction>& instructions, DisassemblyTable format)
+{
+    // the instructions of all kernels are contiguous, starting at the lowest kernel offset
+    uint64_t firstOffset = std::numeric_limits<uint64_t>::max();
+    for(const auto& kernel : moduleInfo.kernelInfos)
+        firstOffset = std::min(firstOffset, kernel.getOffset().getValue());
+    std::vector<const std::string*> kernelNames(instructions.size(), nullptr);
+    for(const auto& kernel : moduleInfo.kernelInfos)
+    {
+        auto start = kernel.getOffset().getValue() - firstOffset;
+        auto end = std::min(start + kernel.getLength().getValue(), static_cast<uint64_t>(instructions.size()));
+        for(auto i = start; i < end; ++i)
+            kernelNames[i] = &kernel.name;
+    }
+
+    OutputBuffer output(stream);
+    std::array<char, 32> buffer{};
+    const std::string noKernel;
+    output.text.append(format == DisassemblyTable::CSV ? "index,kernel,code,type,signal,instruction" : "[");
+    output.finishLine();
+    for(std::size_t i = 0; i < instructions.size(); ++i)
+    {
+        const auto& instr = instructions[i];
+        const auto& kernelName = kernelNames[i] ? *kernelNames[i] : noKernel;
+        auto codeLength = snprintf(buffer.data(), buffer.size(), "\"0x%016llx\"",
+            static_cast<unsigned long long>(instr.toBinaryCode()));
+        if(format == DisassemblyTable::CSV)
         {
-        case OutputMode::ASSEMBLER:
-            stream << instr.toASMString() << std::endl;
-            numBytes += 0; // doesn't matter here, since the number of bytes is unused for assembler output
-            break;
-        case OutputMode::HEX:
-            stream << instr.toHexString(true) << std::endl;
-            numBytes += 8; // doesn't matter here, since the number of bytes is unused for hexadecimal output
-            break;
-        default:
-            throw CompilationError(
-                CompilationStep::GENERAL, "Invalid output mode", std::to_string(static_cast<unsigned>(outputMode)));
+            output.text.append(std::to_string(i)).push_back(',');
+            appendQuoted(output.text, kernelName, format);
+            output.text.push_back(',');
+            output.text.append(buffer.data(), static_cast<std::size_t>(codeLength)).push_back(',');
+            output.text.append(getInstructionType(instr)).push_back(',');
+            output.text.append(instr.getSig().to_string()).push_back(',');
+            appendQuoted(output.text, instr.toASMString(), format);
+        }
+        else
+        {
+            output.text.append("{\"index\": ").append(std::to_string(i)).append(", \"kernel\": ");
+            appendQuoted(output.text, kernelName, format);
+            output.text.append(", \"code\": ").append(buffer.data(), static_cast<std::size_t>(codeLength));
+            output.text.append(", \"type\": \"").append(getInstructionType(instr));
+            output.text.append("\", \"signal\": \"").append(instr.getSig().to_string()).append("\", \"instruction\": ");
+            appendQuoted(output.text, instr.toASMString(), format);
+            output.text.append(i + 1 < instructions.size() ? "}," : "}");
         }
+        output.finishLine();
+    }
+    if(format == DisassemblyTable::JSON)
+    {
+        output.text.append("]");
+        output.finishLine();
     }
+    output.flush();
     stream.flush();
-    return numBytes;
+    return instructions.size();
 }
 
 std::size_t vc4c::disassembleModule(std::istream& binary, std::ostream& output, const OutputMode outputMode)
@@ -364,37 +605,31 @@ std::size_t vc4c::disassembleModule(std::istream& binary, std::ostream& output,
     return generateOutput(output, moduleInfo, globals, instructions, outputMode);
 }
 
+std::size_t vc4c::disassembleModuleTable(std::istream& binary, std::ostream& output, DisassemblyTable format)
+{
+    if(Precompiler::getSourceType(binary) != SourceType::QPUASM_BIN)
+        throw CompilationError(CompilationStep::GENERAL, "Invalid input binary for disassembling!");
+
+    qpu_asm::ModuleInfo moduleInfo;
+    StableList<Global> globals;
+    std::vector<qpu_asm::Instruction> instructions;
+    extractBinary(binary, moduleInfo, globals, instructions);
+
+    return generateTable(output, moduleInfo, instructions, format);
+}
+
 std::size_t vc4c::disassembleCodeOnly(
     std::istream& binary, std::ostream& output, std::size_t numInstructions, const OutputMode outputMode)
 {
-    std::size_t numBytes = 0;
-    for(std::size_t i = 0; i < numInstructions; ++i)
-    {
-        uint64_t tmp64;
-        binary.read(reinterpret_cast<char*>(&tmp64), sizeof(tmp64));
-        qpu_asm::Instruction instr(tmp64);
-        if(!instr.isValidInstruction())
-            throw CompilationError(CompilationStep::GENERAL, "Unrecognized instruction", std::to_string(tmp64));
-        switch(outputMode)
-        {
-        case OutputMode::ASSEMBLER:
-            output << instr.toASMString() << std::endl;
-            numBytes += 0; // doesn't matter here, since the number of bytes is unused for assembler output
-            break;
-        case OutputMode::HEX:
-            output << instr.toHexString(true) << std::endl;
-            numBytes += 8; // doesn't matter here, since the number of bytes is unused for hexadecimal output
-            break;
-        default:
-            throw CompilationError(
-                CompilationStep::GENERAL, "Invalid output mode", std::to_string(static_cast<unsigned>(outputMode)));
-        }
-    }
-    return numBytes;
+    std::vector<qpu_asm::Instruction> instructions;
+    decodeInstructions(binary, numInstructions, instructions);
+    OutputBuffer buffer(output);
+    return writeInstructions(buffer, instructions, outputMode);
 }
 
 // command-line version
-void disassemble(const std::string& input, const std::string& output, const OutputMode outputMode)
+static void runDisassembler(const std::string& input, const std::string& output,
+    const std::function<void(std::istream&, std::ostream&)>& disassembler)
 {
     std::unique_ptr<std::istream> inputFile;
     std::unique_ptr<std::ostream> outputFile;
@@ -417,5 +652,17 @@ void disassemble(const std::string& input, const std::string& output, const Outp
         os = outputFile.get();
     }
 
-    disassembleModule(*is, *os, outputMode);
+    disassembler(*is, *os);
+}
+
+void disassemble(const std::string& input, const std::string& output, const OutputMode outputMode)
+{
+    runDisassembler(input, output,
+        [outputMode](std::istream& is, std::ostream& os) { disassembleModule(is, os, outputMode); });
+}
+
+void disassembleTable(const std::string& input, const std::string& output, DisassemblyTable format)
+{
+    runDisassembler(
+        input, output, [format](std::istream& is, std::ostream& os) { disassembleModuleTable(is, os, format); });
 }
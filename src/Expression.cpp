@@ -1,11 +1,15 @@
 #include "Expression.h"
 
+#include "Method.h"
 #include "Profiler.h"
+#include "analysis/ValueRange.h"
 #include "log.h"
 
 using namespace vc4c;
 
 constexpr OpCode Expression::FAKEOP_UMUL;
+constexpr uint32_t ExpressionTable::EXPRESSION_OPERAND;
+constexpr uint32_t ExpressionTable::NO_OPERAND;
 
 SubExpression::SubExpression(const Optional<Value>& val) : Base(VariantNamespace::monostate{})
 {
@@ -217,6 +221,18 @@ static bool hasValue(const Optional<Value>& val, Optional<Literal> lit)
     return val && lit && val->hasLiteral(*lit);
 }
 
+/*
+ * Returns a copy of the given expression with the given decorations added. The input is not modified, since it might be
+ * shared (e.g. be an interned expression, see ExpressionTable).
+ */
+static std::shared_ptr<Expression> copyWithDecorations(
+    const Expression& expr, intermediate::InstructionDecorations deco)
+{
+    auto copy = std::make_shared<Expression>(expr);
+    copy->addDecorations(deco);
+    return copy;
+}
+
 std::shared_ptr<Expression> Expression::combineWith(
     const FastMap<const Local*, std::shared_ptr<Expression>>& inputs, ExpressionOptions options)
 {
@@ -319,7 +335,7 @@ std::shared_ptr<Expression> Expression::combineWith(
         {
             // f(f(a)) = a, e.g. not(not(a)) = a
             auto inner = firstExpr->arg0.checkExpression();
-            return inner ? inner->addDecorations(deco).shared_from_this() :
+            return inner ? copyWithDecorations(*inner, deco) :
                            std::make_shared<Expression>(OP_V8MIN, firstExpr->arg0, firstExpr->arg0, UNPACK_NOP,
                                PACK_NOP, add_flag(deco, firstExpr->deco));
         }
@@ -330,7 +346,7 @@ std::shared_ptr<Expression> Expression::combineWith(
         if(code.isIdempotent() && arg0 == arg1)
             // f(a, a) = a
             // XXX this is actually hidden by the isMoveExpression() check above
-            return firstExpr ? firstExpr->addDecorations(deco).shared_from_this() :
+            return firstExpr ? copyWithDecorations(*firstExpr, deco) :
                                std::make_shared<Expression>(OP_V8MIN, arg0, arg0, UNPACK_NOP, PACK_NOP, deco);
         if(code.isSelfInverse() && arg0 == arg1)
         {
@@ -344,7 +360,7 @@ std::shared_ptr<Expression> Expression::combineWith(
                                 std::make_shared<Expression>(OP_V8MIN, arg1, arg1, UNPACK_NOP, PACK_NOP, deco);
         if(secondVal && hasValue(secondVal, OpCode::getRightIdentity(code) & &Value::getLiteralValue))
             // f(a, id) = a
-            return firstExpr ? firstExpr->addDecorations(deco).shared_from_this() :
+            return firstExpr ? copyWithDecorations(*firstExpr, deco) :
                                std::make_shared<Expression>(OP_V8MIN, arg0, arg0, UNPACK_NOP, PACK_NOP, deco);
         if(firstVal && hasValue(firstVal, OpCode::getLeftAbsorbingElement(code) & &Value::getLiteralValue))
             // f(absorb, a) = absorb
@@ -820,63 +836,309 @@ Optional<Value> Expression::getConvergenceLimit(Optional<Literal> initialValue)
     return NO_VALUE;
 }
 
-intermediate::IntermediateInstruction* Expression::toInstruction(const Value& output) const
+// the operations which can be reassociated freely, since they are associative and commutative and exact for integers
+static bool isReassociable(const OpCode& code)
 {
-    if(code.opAdd > 32 || code.opMul > 32)
-        // check for fake opcodes
-        return nullptr;
+    return code == OP_ADD || code == OP_AND || code == OP_OR || code == OP_XOR || code == OP_MIN || code == OP_MAX;
+}
 
-    intermediate::Operation* inst;
-    auto firstVal = arg0.checkValue();
-    auto secondVal = arg1.checkValue();
-    if(firstVal && code.numOperands == 1)
-        inst = new intermediate::Operation(code, output, *firstVal);
-    else if(firstVal && secondVal)
-        inst = new intermediate::Operation(code, output, *firstVal, *secondVal);
-    else
-        // if either input is an expression, there is no instructions generating the values (and we don't know the local
-        // to read), so we cannot generate the instruction.
+static bool isShift(const OpCode& code)
+{
+    return code == OP_SHL || code == OP_SHR || code == OP_ASR;
+}
+
+static std::shared_ptr<Expression> createIntExpression(const OpCode& code, const SubExpression& first,
+    const SubExpression& second, intermediate::InstructionDecorations deco)
+{
+    return std::make_shared<Expression>(code, first, second, UNPACK_NOP, PACK_NOP, deco);
+}
+
+static std::shared_ptr<Expression> createConstantExpression(uint32_t value, intermediate::InstructionDecorations deco)
+{
+    Value val(Literal(value), TYPE_INT32);
+    return std::make_shared<Expression>(OP_V8MIN, val, val, UNPACK_NOP, PACK_NOP, deco);
+}
+
+static analysis::ValueRange getSubExpressionRange(const SubExpression& sub, const Method* method)
+{
+    if(auto val = sub.checkValue())
+        return analysis::ValueRange::getValueRangeRecursive(*val, method);
+    if(auto expr = sub.checkExpression())
+        return analysis::ValueRange::getValueRange(*expr, method);
+    return analysis::ValueRange{};
+}
+
+/*
+ * Collects the operands of the given reassociable operation, looking through nested operations of the same kind
+ */
+static void collectOperands(const Expression& expr, FastAccessList<SubExpression>& operands)
+{
+    for(const auto& arg : {expr.arg0, expr.arg1})
+    {
+        auto argExpr = arg.checkExpression();
+        if(argExpr && argExpr->code == expr.code && !argExpr->unpackMode.hasEffect() &&
+            !argExpr->packMode.hasEffect())
+            collectOperands(*argExpr, operands);
+        else
+            operands.emplace_back(arg);
+    }
+}
+
+/*
+ * Folds all constant operands of nested reassociable operations into a single constant operand
+ */
+static std::shared_ptr<Expression> reassociateConstants(const Expression& expr)
+{
+    FastAccessList<SubExpression> operands;
+    collectOperands(expr, operands);
+    Optional<Value> constant;
+    unsigned numConstants = 0;
+    FastAccessList<SubExpression> otherOperands;
+    for(const auto& operand : operands)
+    {
+        auto lit = operand.getLiteralValue();
+        if(lit && lit->type == LiteralType::INTEGER)
+        {
+            constant = constant ? expr.code(*constant, Value(*lit, TYPE_INT32)).first : Value(*lit, TYPE_INT32);
+            ++numConstants;
+        }
+        else if(expr.code != OP_XOR &&
+            std::find(otherOperands.begin(), otherOperands.end(), operand) != otherOperands.end())
+            // all other reassociable operations are idempotent, f(a, f(a, b)) = f(a, b)
+            continue;
+        else
+            otherOperands.emplace_back(operand);
+    }
+    bool removedDuplicates = otherOperands.size() + numConstants != operands.size();
+    if((numConstants < 2 && !removedDuplicates) || (constant && !constant->getLiteralValue()))
+        // nothing to fold
         return nullptr;
-    inst->setUnpackMode(unpackMode);
-    inst->setPackMode(packMode);
-    inst->addDecorations(deco);
-    return inst;
+
+    if(constant &&
+        (otherOperands.empty() ||
+            hasValue(constant, OpCode::getRightAbsorbingElement(expr.code) & &Value::getLiteralValue)))
+        return createConstantExpression(constant->getLiteralValue()->unsignedInt(), expr.deco);
+    SubExpression result = otherOperands.front();
+    for(auto it = std::next(otherOperands.begin()); it != otherOperands.end(); ++it)
+        result = createIntExpression(expr.code, result, *it, expr.deco);
+    if(constant && !hasValue(constant, OpCode::getRightIdentity(expr.code) & &Value::getLiteralValue))
+        result = createIntExpression(expr.code, result, *constant, expr.deco);
+    if(auto resultExpr = result.checkExpression())
+        return resultExpr;
+    return std::make_shared<Expression>(OP_V8MIN, result, result, UNPACK_NOP, PACK_NOP, expr.deco);
 }
 
-bool Expression::insertInstructions(
-    InstructionWalker& it, const Value& out, const AvailableExpressions& existingExpressions) const
+/*
+ * Applies the integer rewrites of #simplify() to the given expression whose arguments are already simplified
+ */
+static std::shared_ptr<Expression> simplifyIntegerExpression(const Expression& expr, const Method* method)
+{
+    auto firstExpr = expr.arg0.checkExpression();
+    auto firstIsPlain = firstExpr && !firstExpr->unpackMode.hasEffect() && !firstExpr->packMode.hasEffect();
+    auto firstConstant = expr.arg0.getLiteralValue();
+    auto secondConstant = expr.arg1.getLiteralValue();
+    if(firstConstant && firstConstant->type != LiteralType::INTEGER)
+        firstConstant = {};
+    if(secondConstant && secondConstant->type != LiteralType::INTEGER)
+        secondConstant = {};
+
+    if(firstConstant && !secondConstant && expr.code.isCommutative() && expr.code.numOperands == 2)
+        // move constants to the right to simplify the following checks
+        return createIntExpression(expr.code, expr.arg1, expr.arg0, expr.deco);
+
+    if(expr.code == OP_SUB && secondConstant)
+        // a - const = a + (-const), allows reassociation
+        return createIntExpression(
+            OP_ADD, expr.arg0, Value(Literal(0u - secondConstant->unsignedInt()), TYPE_INT32), expr.deco);
+
+    if(isReassociable(expr.code))
+    {
+        if(auto result = reassociateConstants(expr))
+            return result;
+    }
+
+    if(expr.code == OP_ASR && getSubExpressionRange(expr.arg0, method).minValue >= 0.0)
+        // the sign-extension of a non-negative value inserts zeroes
+        return createIntExpression(OP_SHR, expr.arg0, expr.arg1, expr.deco);
+
+    if(isShift(expr.code) && secondConstant && firstIsPlain && firstExpr->code == expr.code)
+    {
+        if(auto innerOffset = firstExpr->arg1.getLiteralValue())
+        {
+            // (a << constA) << constB = a << (constA + constB), same for right shifts
+            auto offset = (innerOffset->unsignedInt() & 0x1F) + (secondConstant->unsignedInt() & 0x1F);
+            auto deco = add_flag(expr.deco, firstExpr->deco);
+            if(offset < 32)
+                return createIntExpression(expr.code, firstExpr->arg0, Value(Literal(offset), TYPE_INT32), deco);
+            if(expr.code == OP_ASR)
+                return createIntExpression(OP_ASR, firstExpr->arg0, Value(Literal(31u), TYPE_INT32), deco);
+            return createConstantExpression(0u, expr.deco);
+        }
+    }
+
+    if(expr.code == OP_SHL && secondConstant && firstIsPlain &&
+        (firstExpr->code == OP_ADD || firstExpr->code == OP_AND || firstExpr->code == OP_OR ||
+            firstExpr->code == OP_XOR))
+    {
+        if(auto innerConstant = firstExpr->arg1.getLiteralValue())
+        {
+            // (a + const) << offset = (a << offset) + (const << offset), same for the bit-wise operations
+            auto offset = secondConstant->unsignedInt() & 0x1F;
+            auto shifted = createIntExpression(OP_SHL, firstExpr->arg0, expr.arg1, expr.deco);
+            return createIntExpression(firstExpr->code, shifted,
+                Value(Literal(innerConstant->unsignedInt() << offset), TYPE_INT32),
+                add_flag(expr.deco, firstExpr->deco));
+        }
+    }
+
+    if(expr.code == OP_AND && secondConstant)
+    {
+        auto mask = secondConstant->unsignedInt();
+        if(firstIsPlain && firstExpr->code == OP_SHR && firstExpr->arg1.getLiteralValue())
+        {
+            // (a >> const) & mask = a >> const, if the mask covers all bits which can be set
+            auto offset = firstExpr->arg1.getLiteralValue()->unsignedInt() & 0x1F;
+            if(((0xFFFFFFFFu >> offset) & ~mask) == 0)
+                return firstExpr;
+        }
+        if(firstIsPlain && firstExpr->code == OP_SHL && firstExpr->arg1.getLiteralValue())
+        {
+            // (a << const) & mask = a << const, if the mask covers all bits which can be set
+            auto offset = firstExpr->arg1.getLiteralValue()->unsignedInt() & 0x1F;
+            if(((0xFFFFFFFFu << offset) & ~mask) == 0)
+                return firstExpr;
+        }
+        // a & mask = a, if all bits possibly set in a are covered by the mask
+        auto range = getSubExpressionRange(expr.arg0, method);
+        if(range.minValue >= 0.0 && range.maxValue <= static_cast<double>(mask) && (mask & (mask + 1)) == 0)
+            return firstExpr ? firstExpr : std::make_shared<Expression>(OP_V8MIN, expr.arg0, expr.arg0, UNPACK_NOP,
+                                                                         PACK_NOP, expr.deco);
+    }
+
+    if((expr.code == OP_MIN || expr.code == OP_MAX) && secondConstant)
+    {
+        // min(a, const) = a, if a <= const, max(a, const) = a, if a >= const
+        auto range = getSubExpressionRange(expr.arg0, method);
+        auto limit = static_cast<double>(secondConstant->signedInt());
+        if((expr.code == OP_MIN && range.maxValue <= limit) || (expr.code == OP_MAX && range.minValue >= limit))
+            return firstExpr ? firstExpr : std::make_shared<Expression>(OP_V8MIN, expr.arg0, expr.arg0, UNPACK_NOP,
+                                                                         PACK_NOP, expr.deco);
+    }
+    return nullptr;
+}
+
+static std::shared_ptr<Expression> simplifyTree(
+    const std::shared_ptr<Expression>& expr, const Method* method, unsigned& remainingRewrites)
+{
+    if(expr->unpackMode.hasEffect() || expr->packMode.hasEffect())
+        return expr;
+
+    // simplify the children first
+    auto firstExpr = expr->arg0.checkExpression();
+    auto secondExpr = expr->arg1.checkExpression();
+    auto newFirst = firstExpr ? simplifyTree(firstExpr, method, remainingRewrites) : nullptr;
+    auto newSecond = secondExpr ? simplifyTree(secondExpr, method, remainingRewrites) : nullptr;
+    auto current = expr;
+    if(newFirst != firstExpr || newSecond != secondExpr)
+    {
+        current = std::make_shared<Expression>(*expr);
+        // replace moves of values (e.g. folded constants) with the values themselves
+        if(newFirst)
+            current->arg0 = newFirst->isMoveExpression() && newFirst->arg0.checkValue() ? newFirst->arg0 : newFirst;
+        if(newSecond)
+            current->arg1 = newSecond->isMoveExpression() && newSecond->arg0.checkValue() ? newSecond->arg0 : newSecond;
+    }
+
+    if(current->isMoveExpression() || remainingRewrites == 0)
+        return current;
+    auto constant = current->getConstantExpression();
+    if(constant && constant->getLiteralValue())
+        return std::make_shared<Expression>(OP_V8MIN, *constant, *constant, UNPACK_NOP, PACK_NOP, current->deco);
+
+    std::shared_ptr<Expression> next;
+    if(!current->code.acceptsFloat && !current->code.returnsFloat && current->code.opAdd <= 32 &&
+        current->code.opMul <= 32)
+        next = simplifyIntegerExpression(*current, method);
+    if(!next)
+    {
+        // apply the single-level rewrites on a copy, since #combineWith modifies the expression
+        next = std::make_shared<Expression>(*current)->combineWith({});
+        if(*next == *current)
+            return current;
+    }
+    // the rewritten expression might allow for further simplifications (of the newly created child expressions too).
+    // The number of rewrites is limited in case some rules revert each other.
+    --remainingRewrites;
+    return simplifyTree(next, method, remainingRewrites);
+}
+
+std::shared_ptr<Expression> Expression::simplify(const Method* method) const
+{
+    auto self = std::const_pointer_cast<Expression>(shared_from_this());
+    unsigned remainingRewrites = 64;
+    auto result = simplifyTree(self, method, remainingRewrites);
+    return *result == *this ? self : result;
+}
+
+/*
+ * Returns whether instructions can be generated for the whole expression tree
+ */
+static bool isInsertable(const Expression& expr)
+{
+    if(expr.code.opAdd > 32 || expr.code.opMul > 32)
+        // check for fake opcodes
+        return false;
+    if(!expr.arg0 || (expr.code.numOperands > 1 && !expr.arg1))
+        return false;
+    for(const auto& arg : {expr.arg0, expr.arg1})
+    {
+        if(auto argExpr = arg.checkExpression())
+        {
+            if(!isInsertable(*argExpr))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool Expression::insertInstructions(InstructionWalker& it, const Value& out,
+    const AvailableExpressions& existingExpressions, bool insertSubExpressions) const
 {
     if(code.opAdd > 32 || code.opMul > 32)
         // check for fake opcodes
         return false;
 
-    if(existingExpressions.find(std::const_pointer_cast<Expression>(shared_from_this())) != existingExpressions.end())
+    if(existingExpressions.find(this) != existingExpressions.end())
         // nothing to do
         return false;
 
     if(isMoveExpression() && arg0.checkExpression())
         // to not insert moves, but the moved-from data
-        return arg0.checkExpression()->insertInstructions(it, out, existingExpressions);
+        return arg0.checkExpression()->insertInstructions(it, out, existingExpressions, insertSubExpressions);
 
-    // TODO this is only 0-level recursive, since we do not have the right locals for intermediate results
+    // check in front, so we do not insert the instructions for only some of the sub-expressions
+    if(insertSubExpressions && !isInsertable(*this))
+        return false;
 
-    auto leftVal = arg0.checkValue();
-    if(auto leftExpr = arg0.checkExpression())
-    {
-        auto exprIt = existingExpressions.find(leftExpr);
-        if(exprIt == existingExpressions.end())
-            return false;
-        leftVal = exprIt->second.first->getOutput();
-    }
+    auto getInput = [&](const SubExpression& sub) -> Optional<Value> {
+        if(auto expr = sub.checkExpression())
+        {
+            auto exprIt = existingExpressions.find(expr.get());
+            if(exprIt != existingExpressions.end())
+                return exprIt->second.first->getOutput();
+            if(!insertSubExpressions)
+                return NO_VALUE;
+            auto type = (expr->code.returnsFloat ? TYPE_FLOAT : TYPE_INT32).toVectorType(out.type.getVectorWidth());
+            auto tmp = it.getBasicBlock()->getMethod().addNewLocal(type, "%expr");
+            if(!expr->insertInstructions(it, tmp, existingExpressions, true))
+                return NO_VALUE;
+            return tmp;
+        }
+        return sub.checkValue();
+    };
 
-    auto rightVal = arg0.checkValue();
-    if(auto rightExpr = arg0.checkExpression())
-    {
-        auto exprIt = existingExpressions.find(rightExpr);
-        if(exprIt == existingExpressions.end())
-            return false;
-        rightVal = exprIt->second.first->getOutput();
-    }
+    auto leftVal = getInput(arg0);
+    auto rightVal = code.numOperands > 1 ? getInput(arg1) : arg1.checkValue();
 
     if(!leftVal || (code.numOperands > 1 && !rightVal))
         return false;
@@ -886,6 +1148,71 @@ bool Expression::insertInstructions(
     return true;
 }
 
+bool ExpressionTable::NodeKey::operator==(const NodeKey& other) const noexcept
+{
+    return opCode == other.opCode && arg0 == other.arg0 && arg1 == other.arg1 && unpackMode == other.unpackMode &&
+        packMode == other.packMode && decorations == other.decorations;
+}
+
+std::size_t ExpressionTable::NodeKeyHash::operator()(const NodeKey& key) const noexcept
+{
+    std::size_t hash = key.opCode;
+    for(std::size_t part : {static_cast<std::size_t>(key.arg0), static_cast<std::size_t>(key.arg1),
+            static_cast<std::size_t>(key.unpackMode), static_cast<std::size_t>(key.packMode),
+            static_cast<std::size_t>(key.decorations)})
+        hash = hash * 31 + part;
+    return hash;
+}
+
+static uint32_t getOpCodeKey(const OpCode& code)
+{
+    // same as the OpCode comparison, the ADD ALU operation code takes precedence
+    return code.opAdd != 0 ? code.opAdd : (0x100u | code.opMul);
+}
+
+ExpressionTable::Id ExpressionTable::intern(const Expression& expr)
+{
+    SubExpression arg0;
+    SubExpression arg1;
+    auto arg0Key = internOperand(expr.arg0, arg0);
+    auto arg1Key = internOperand(expr.arg1, arg1);
+    NodeKey key{getOpCodeKey(expr.code), arg0Key, arg1Key, expr.unpackMode.value, expr.packMode.value,
+        static_cast<uint32_t>(expr.deco)};
+    if(expr.code.isCommutative() && key.arg1 < key.arg0)
+        // the order of the operands does not matter, see Expression#operator==
+        std::swap(key.arg0, key.arg1);
+
+    auto it = nodeIds.find(key);
+    if(it != nodeIds.end())
+        return it->second;
+    auto id = static_cast<Id>(nodes.size());
+    nodes.emplace_back(std::make_shared<Expression>(
+        expr.code, std::move(arg0), std::move(arg1), expr.unpackMode, expr.packMode, expr.deco));
+    nodeIds.emplace(key, id);
+    return id;
+}
+
+std::shared_ptr<Expression> ExpressionTable::canonicalize(const Expression& expr)
+{
+    return nodes[intern(expr)];
+}
+
+uint32_t ExpressionTable::internOperand(const SubExpression& sub, SubExpression& canonicalOperand)
+{
+    if(auto expr = sub.checkExpression())
+    {
+        auto id = intern(*expr);
+        canonicalOperand = SubExpression(nodes[id]);
+        return EXPRESSION_OPERAND | id;
+    }
+    if(auto val = sub.checkValue())
+    {
+        canonicalOperand = sub;
+        return values.emplace(*val, static_cast<uint32_t>(values.size())).first->second;
+    }
+    return NO_OPERAND;
+}
+
 size_t std::hash<vc4c::SubExpression>::operator()(const vc4c::SubExpression& expr) const noexcept
 {
     std::hash<SubExpression::Base> baseHash;
@@ -22,9 +22,11 @@ namespace vc4c
      * Maps the available locals and the available expression writing into the given local for a given point in
      * the program code. The additional integer value is the distance in instructions from the current position
      * where the expression was written.
+     *
+     * NOTE: The expressions are looked up by identity, so they need to be interned in the same ExpressionTable.
      */
     using AvailableExpressions =
-        FastMap<std::shared_ptr<Expression>, std::pair<const intermediate::IntermediateInstruction*, unsigned>>;
+        FastMap<const Expression*, std::pair<const intermediate::IntermediateInstruction*, unsigned>>;
 
     // Using shared_ptr allows to copy expressions and also to share subexpressions
     struct SubExpression : private Variant<VariantNamespace::monostate, Value, std::shared_ptr<Expression>>
@@ -182,6 +184,26 @@ namespace vc4c
          */
         Optional<Value> getConvergenceLimit(Optional<Literal> initialValue = {}) const;
 
+        /**
+         * Simplifies the whole expression tree bottom-up, in contrast to #combineWith which only looks at the direct
+         * arguments of this expression.
+         *
+         * Next to the rewrites of #combineWith (and constant folding), this applies for integer operations:
+         * - reassociation of all constants in nested associative and commutative operations,
+         *   e.g. (a + 1) + (b + 2) = (a + b) + 3
+         * - folding of successive shifts and of shifts and masks, e.g. (a << 2) << 3 = a << 5,
+         *   (a >> 24) & 0xFF = a >> 24
+         * - distribution of left shifts over additions and bit-wise operations with constants to allow further
+         *   reassociation, e.g. (a + 1) << 2 = (a << 2) + 4
+         * - range-aware rewrites, e.g. a & 0xFF = a and max(a, 0) = a if a is known to be in [0, 255],
+         *   asr a, b = shr a, b if a is known to be non-negative
+         *
+         * The value ranges of the leaf values are determined (recursively) within the given method, if any.
+         *
+         * Returns this expression, if it could not be simplified
+         */
+        std::shared_ptr<Expression> simplify(const Method* method = nullptr) const;
+
         /**
          * Returns the instruction representing this expression or a nullptr of no such instruction can be formed.
          *
@@ -193,10 +215,13 @@ namespace vc4c
          * If possible, generates instructions for this and all child expressions, if there a not yet any matching
          * instructions for the (sub-)expressions in the input container.
          *
+         * If insertSubExpressions is set, the child expressions without matching instructions are calculated into new
+         * locals, otherwise no instructions are generated for them.
+         *
          * Returns whether instructions were inserted
          */
-        NODISCARD bool insertInstructions(
-            InstructionWalker& it, const Value& out, const AvailableExpressions& existingExpressions) const;
+        NODISCARD bool insertInstructions(InstructionWalker& it, const Value& out,
+            const AvailableExpressions& existingExpressions, bool insertSubExpressions = false) const;
 
         inline Expression& addDecorations(intermediate::InstructionDecorations newDeco)
         {
@@ -205,6 +230,71 @@ namespace vc4c
         }
     };
 
+    /*
+     * A hash-consed DAG of expressions, e.g. for all expressions calculated within a single method.
+     *
+     * Every distinct expression is stored exactly once in the arena of this table and identified by a dense ID. Since
+     * the sub-expressions (and leaf values) are interned first, the key of an expression only consists of integers and
+     * two expressions are equal if and only if they are interned as the same node. Thus, interned expressions can be
+     * compared and hashed by their identity instead of recursively by their contents.
+     *
+     * NOTE: The interned expressions are shared and must not be modified!
+     */
+    class ExpressionTable
+    {
+    public:
+        using Id = uint32_t;
+
+        /*
+         * Returns the ID of the node equal to the given expression, inserting the expression (and all its
+         * sub-expressions) if it is not yet interned
+         */
+        Id intern(const Expression& expr);
+
+        /*
+         * Returns the interned node equal to the given expression, whose sub-expressions are also all interned
+         */
+        std::shared_ptr<Expression> canonicalize(const Expression& expr);
+
+        inline const std::shared_ptr<Expression>& operator[](Id id) const
+        {
+            return nodes[id];
+        }
+
+        inline std::size_t size() const noexcept
+        {
+            return nodes.size();
+        }
+
+    private:
+        // the operand keys of sub-expressions are their node IDs with this flag, the other keys are value IDs
+        static constexpr uint32_t EXPRESSION_OPERAND = 0x80000000;
+        static constexpr uint32_t NO_OPERAND = 0xFFFFFFFF;
+
+        struct NodeKey
+        {
+            uint32_t opCode;
+            uint32_t arg0;
+            uint32_t arg1;
+            unsigned char unpackMode;
+            unsigned char packMode;
+            uint32_t decorations;
+
+            bool operator==(const NodeKey& other) const noexcept;
+        };
+
+        struct NodeKeyHash
+        {
+            std::size_t operator()(const NodeKey& key) const noexcept;
+        };
+
+        std::vector<std::shared_ptr<Expression>> nodes;
+        FastMap<NodeKey, Id, NodeKeyHash> nodeIds;
+        FastMap<Value, uint32_t> values;
+
+        uint32_t internOperand(const SubExpression& sub, SubExpression& canonicalOperand);
+    };
+
     // Extends the operator syntax to create expressions from it
     namespace operators
     {
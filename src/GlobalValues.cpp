@@ -65,6 +65,19 @@ bool CompoundConstant::isZeroInitializer() const
     return true;
 }
 
+bool CompoundConstant::operator==(const CompoundConstant& other) const
+{
+    if(type != other.type)
+        return false;
+    auto lit = VariantNamespace::get_if<Literal>(&elements);
+    auto otherLit = VariantNamespace::get_if<Literal>(&other.elements);
+    if(lit || otherLit)
+        return lit && otherLit && *lit == *otherLit;
+    const auto& entries = VariantNamespace::get<std::vector<CompoundConstant>>(elements);
+    const auto& otherEntries = VariantNamespace::get<std::vector<CompoundConstant>>(other.elements);
+    return entries == otherEntries;
+}
+
 Optional<Literal> CompoundConstant::getScalar() const noexcept
 {
     if(auto lit = VariantNamespace::get_if<Literal>(&elements))
@@ -158,8 +171,7 @@ bool Global::residesInMemory() const
     return true;
 }
 
-Local::RAIILock Global::getUsersLock() const
+Local::SharedUsers* Global::getSharedUsers() const
 {
-    usersLock.lock();
-    return RAIILock([&]() { usersLock.unlock(); });
+    return &sharedUsers;
 }
@@ -51,6 +51,15 @@ namespace vc4c
         Optional<Literal> getScalar() const noexcept;
         Optional<std::vector<CompoundConstant>> getCompound() const;
 
+        /*
+         * Returns whether both constants have the same type and the same (bit-wise) contents
+         */
+        bool operator==(const CompoundConstant& other) const;
+        inline bool operator!=(const CompoundConstant& other) const
+        {
+            return !(*this == other);
+        }
+
         /*
          * Converts this compound constant to a Value.
          * The constant can be converted, if:
@@ -95,10 +104,16 @@ namespace vc4c
          */
         const bool isConstant;
 
+        /*
+         * Whether this global is an entry of the constant pool (see normalization::createConstantPool()), which is
+         * always read from memory instead of being lowered into the value of its contents
+         */
+        bool isConstantPoolEntry = false;
+
     protected:
-        // required, since the access to the same global value from multiple kernels could be modified at the same time
-        mutable std::mutex usersLock;
-        RAIILock getUsersLock() const override;
+        // required, since the users of the same global value from multiple kernels could be modified at the same time
+        mutable SharedUsers sharedUsers;
+        SharedUsers* getSharedUsers() const override;
     };
 } /* namespace vc4c */
 
@@ -8,11 +8,15 @@
 #define VC4C_GRAPH_H
 
 #include "CompilationError.h"
+#include "Profiler.h"
 #include "performance.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <string>
 #include <type_traits>
+#include <utility>
 
 namespace vc4c
 {
@@ -30,7 +34,8 @@ namespace vc4c
         BIDIRECTIONAL
     };
 
-    template <typename Key, typename Relation, Directionality Direction, typename Base = empty_base>
+    template <typename Key, typename Relation, Directionality Direction, typename Base = empty_base,
+        bool CompactEdges = false>
     class Node;
 
     template <typename NodeType, typename Relation, Directionality Direction>
@@ -39,32 +44,139 @@ namespace vc4c
     template <typename Key, typename NodeType>
     class Graph;
 
+    template <typename Key, typename Relation, Directionality Direction>
+    class FrozenGraph;
+
+    /*
+     * The category the memory of the nodes and edges of graphs with the given node base type is accounted to, see
+     * profiler::trackMemory()
+     */
+    template <typename Base>
+    struct GraphMemoryCategory
+    {
+        static constexpr profiler::MemoryCategory value = profiler::MemoryCategory::ANALYSES;
+    };
+
+    /*
+     * Map-like container for the edges of a single node, storing the neighbors and edges compactly in a vector.
+     *
+     * Iterating the edges is faster and requires less memory than for a hash-map, but since the neighbors are looked up
+     * by linear search, this should only be used for graphs where the nodes have few neighbors or the edges are mostly
+     * iterated and not looked up.
+     *
+     * NOTE: The order of the edges is not stable, since erasing an edge moves the last edge into its place.
+     */
+    template <typename NodeType, typename EdgeType>
+    class EdgeList
+    {
+    public:
+        using value_type = std::pair<NodeType*, EdgeType*>;
+        using iterator = typename FastAccessList<value_type>::iterator;
+        using const_iterator = typename FastAccessList<value_type>::const_iterator;
+
+        iterator begin() noexcept
+        {
+            return entries.begin();
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return entries.begin();
+        }
+
+        iterator end() noexcept
+        {
+            return entries.end();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return entries.end();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return entries.size();
+        }
+
+        void reserve(std::size_t numEdges)
+        {
+            entries.reserve(numEdges);
+        }
+
+        iterator find(NodeType* neighbor) noexcept
+        {
+            return std::find_if(
+                entries.begin(), entries.end(), [neighbor](const value_type& entry) { return entry.first == neighbor; });
+        }
+
+        const_iterator find(NodeType* neighbor) const noexcept
+        {
+            return std::find_if(
+                entries.begin(), entries.end(), [neighbor](const value_type& entry) { return entry.first == neighbor; });
+        }
+
+        /*
+         * NOTE: In contrast to a map, this does not check whether there already is an edge to the given neighbor,
+         * since the graph only inserts edges between not yet adjacent nodes.
+         */
+        std::pair<iterator, bool> emplace(NodeType* neighbor, EdgeType* edge)
+        {
+            entries.emplace_back(neighbor, edge);
+            return std::make_pair(--entries.end(), true);
+        }
+
+        std::size_t erase(NodeType* neighbor)
+        {
+            auto it = find(neighbor);
+            if(it == entries.end())
+                return 0;
+            *it = entries.back();
+            entries.pop_back();
+            return 1;
+        }
+
+    private:
+        FastAccessList<value_type> entries;
+    };
+
     /*
      * A node in a graph, general base-class maintaining the list of edges to neighboring nodes
+     *
+     * If CompactEdges is set, the edges are stored in an EdgeList instead of a hash-map.
      */
-    template <typename Key, typename Relation, Directionality Direction, typename Base>
+    template <typename Key, typename Relation, Directionality Direction, typename Base, bool CompactEdges>
     class Node : public Base
     {
     public:
         using RelationType = Relation;
-        using NodeType = Node<Key, Relation, Direction, Base>;
+        using NodeType = Node<Key, Relation, Direction, Base, CompactEdges>;
         using EdgeType = Edge<NodeType, Relation, Direction>;
         using GraphType = Graph<Key, NodeType>;
+        using EdgeContainer = typename std::conditional<CompactEdges, EdgeList<NodeType, EdgeType>,
+            FastMap<NodeType*, EdgeType*>>::type;
+
+        static constexpr profiler::MemoryCategory MEMORY_CATEGORY = GraphMemoryCategory<Base>::value;
 
         template <typename... Args>
         explicit Node(GraphType& graph, const Key& key, Args&&... args) :
             Base(std::forward<Args&&>(args)...), key(key), graph(graph), edges()
         {
+            profiler::trackMemory(MEMORY_CATEGORY, static_cast<int64_t>(sizeof(Node)));
         }
         template <typename... Args>
         explicit Node(GraphType& graph, Key&& key, Args&&... args) :
             Base(std::forward<Args&&>(args)...), key(key), graph(graph), edges()
         {
+            profiler::trackMemory(MEMORY_CATEGORY, static_cast<int64_t>(sizeof(Node)));
         }
 
         Node(const Node&) = delete;
         Node(Node&&) noexcept = delete;
-        ~Node() noexcept = default;
+        ~Node() noexcept
+        {
+            profiler::trackMemory(MEMORY_CATEGORY, -static_cast<int64_t>(sizeof(Node)));
+        }
 
         Node& operator=(const Node&) = delete;
         Node& operator=(Node&&) noexcept = delete;
@@ -431,7 +543,7 @@ namespace vc4c
 
     protected:
         GraphType& graph;
-        FastMap<NodeType*, EdgeType*> edges;
+        EdgeContainer edges;
 
         friend GraphType;
     };
@@ -564,11 +676,17 @@ namespace vc4c
     public:
         using NodeType = Node;
 
-        Edge(NodeType& first, NodeType& second, Relation&& data) : Base(first, second), data(data) {}
+        Edge(NodeType& first, NodeType& second, Relation&& data) : Base(first, second), data(data)
+        {
+            profiler::trackMemory(NodeType::MEMORY_CATEGORY, static_cast<int64_t>(sizeof(Edge)));
+        }
 
         Edge(const Edge&) = delete;
         Edge(Edge&&) noexcept = delete;
-        ~Edge() noexcept = default;
+        ~Edge() noexcept
+        {
+            profiler::trackMemory(NodeType::MEMORY_CATEGORY, -static_cast<int64_t>(sizeof(Edge)));
+        }
 
         Edge& operator=(const Edge&) = delete;
         Edge& operator=(Edge&&) noexcept = delete;
@@ -630,6 +748,7 @@ namespace vc4c
     public:
         using RelationType = typename NodeType::RelationType;
         using EdgeType = typename NodeType::EdgeType;
+        using FrozenType = FrozenGraph<Key, RelationType, EdgeType::Directed>;
 
         explicit Graph(std::size_t numNodes = 0) : nodes(), edges()
         {
@@ -708,7 +827,10 @@ namespace vc4c
                 throw CompilationError(CompilationStep::GENERAL, "Failed to find graph-node for key");
             for(auto& edge : it->second.edges)
             {
-                edge.second->getOtherNode(it->second).edges.erase(&it->second);
+                // for edges to the node itself, the node's own edges are erased together with the node below
+                auto& otherNode = edge.second->getOtherNode(it->second);
+                if(&otherNode != &it->second)
+                    otherNode.edges.erase(&it->second);
                 edges.erase(*edge.second);
             }
             nodes.erase(it);
@@ -780,12 +902,12 @@ namespace vc4c
             }
         }
 
-        const FastMap<Key, NodeType>& getNodes() const
+        const StableMap<Key, NodeType>& getNodes() const
         {
             return nodes;
         }
 
-        FastMap<Key, NodeType>& getNodes()
+        StableMap<Key, NodeType>& getNodes()
         {
             return nodes;
         }
@@ -806,6 +928,14 @@ namespace vc4c
             edges.clear();
         }
 
+        /*
+         * Creates an immutable compact copy of this graph, see FrozenGraph
+         */
+        FrozenType freeze() const
+        {
+            return FrozenType(*this);
+        }
+
         // NOTE: Since the reserve forces a rehashing, this should be called for empty graphs only!
         void reserveNodeSize(std::size_t numNodes)
         {
@@ -815,15 +945,17 @@ namespace vc4c
         }
 
     protected:
-        FastMap<Key, NodeType> nodes;
-        FastSet<EdgeType> edges;
+        // the nodes and edges are referenced by pointers, so they need to stay at their position
+        StableMap<Key, NodeType> nodes;
+        StableSet<EdgeType> edges;
 
         EdgeType* createEdge(NodeType* first, NodeType* second, RelationType&& relation)
         {
             EdgeType& edge =
                 const_cast<EdgeType&>(*(edges.emplace(*first, *second, std::forward<RelationType&&>(relation)).first));
             first->edges.emplace(second, &edge);
-            second->edges.emplace(first, &edge);
+            if(first != second)
+                second->edges.emplace(first, &edge);
             return &edge;
         }
 
@@ -836,6 +968,207 @@ namespace vc4c
 
         friend NodeType;
     };
+
+    /*
+     * Immutable graph storing the edges of all nodes in compressed sparse row (CSR) format.
+     *
+     * The nodes are identified by their dense index (in the iteration order of the nodes of the original graph) and
+     * the edges of every node are stored consecutively in a single array. Compared to the node-based Graph, this
+     * requires a lot less memory and the edges can be iterated sequentially without any indirection, but the graph
+     * cannot be modified. This makes it a good fit for graphs which are built once and afterwards only read.
+     *
+     * For (bi-)directional graphs, the outgoing and incoming edges of all nodes are stored separately.
+     */
+    template <typename Key, typename Relation, Directionality Direction>
+    class FrozenGraph
+    {
+    public:
+        using IndexType = uint32_t;
+
+        struct FrozenEdge
+        {
+            // the index of the neighbor node
+            IndexType neighbor;
+            Relation data;
+        };
+
+        /*
+         * The consecutive edges of a single node
+         */
+        class EdgeRange
+        {
+        public:
+            EdgeRange(const FrozenEdge* begin, const FrozenEdge* end) : first(begin), last(end) {}
+
+            const FrozenEdge* begin() const noexcept
+            {
+                return first;
+            }
+
+            const FrozenEdge* end() const noexcept
+            {
+                return last;
+            }
+
+            std::size_t size() const noexcept
+            {
+                return static_cast<std::size_t>(last - first);
+            }
+
+            bool empty() const noexcept
+            {
+                return first == last;
+            }
+
+        private:
+            const FrozenEdge* first;
+            const FrozenEdge* last;
+        };
+
+        template <typename NodeType>
+        explicit FrozenGraph(const Graph<Key, NodeType>& graph)
+        {
+            const auto& nodes = graph.getNodes();
+            keys.reserve(nodes.size());
+            indices.reserve(nodes.size());
+            FastMap<const NodeType*, IndexType> nodeIndices;
+            nodeIndices.reserve(nodes.size());
+            for(const auto& pair : nodes)
+            {
+                auto index = static_cast<IndexType>(keys.size());
+                nodeIndices.emplace(&pair.second, index);
+                indices.emplace(pair.first, index);
+                keys.emplace_back(pair.first);
+            }
+
+            outgoingOffsets.reserve(nodes.size() + 1);
+            outgoingOffsets.emplace_back(0);
+            if(Direction != Directionality::UNDIRECTED)
+            {
+                incomingOffsets.reserve(nodes.size() + 1);
+                incomingOffsets.emplace_back(0);
+            }
+            for(const auto& pair : nodes)
+            {
+                insertEdges(pair.second, nodeIndices,
+                    std::integral_constant<bool, Direction == Directionality::UNDIRECTED>{});
+                outgoingOffsets.emplace_back(static_cast<IndexType>(outgoingEdges.size()));
+                if(Direction != Directionality::UNDIRECTED)
+                    incomingOffsets.emplace_back(static_cast<IndexType>(incomingEdges.size()));
+            }
+        }
+
+        /*
+         * Creates an undirected graph directly from its compressed representation, e.g. for graphs whose edges are
+         * collected in parallel without building the node-based Graph first.
+         *
+         * The edges of node i are given at the positions [offsets[i], offsets[i + 1]) of the edges array and each edge
+         * needs to be contained for both of its nodes.
+         */
+        FrozenGraph(
+            FastAccessList<Key>&& nodeKeys, FastAccessList<IndexType>&& offsets, FastAccessList<FrozenEdge>&& edges) :
+            keys(std::move(nodeKeys)),
+            outgoingOffsets(std::move(offsets)), outgoingEdges(std::move(edges))
+        {
+            static_assert(Direction == Directionality::UNDIRECTED, "Only undirected graphs can be created from edges!");
+            if(outgoingOffsets.size() != keys.size() + 1 || outgoingOffsets.back() != outgoingEdges.size())
+                throw CompilationError(CompilationStep::GENERAL, "Invalid compressed graph representation");
+            indices.reserve(keys.size());
+            for(IndexType i = 0; i < keys.size(); ++i)
+                indices.emplace(keys[i], i);
+        }
+
+        std::size_t size() const noexcept
+        {
+            return keys.size();
+        }
+
+        const Key& getKey(IndexType node) const
+        {
+            return keys.at(node);
+        }
+
+        /*
+         * Returns the index of the node for the given key.
+         * Throws a compilation-error, if there is no such node
+         */
+        IndexType getIndex(const Key& key) const
+        {
+            auto it = indices.find(key);
+            if(it == indices.end())
+                throw CompilationError(CompilationStep::GENERAL, "Failed to find graph-node for key");
+            return it->second;
+        }
+
+        bool hasNode(const Key& key) const
+        {
+            return indices.find(key) != indices.end();
+        }
+
+        /*
+         * Returns all edges of the given node
+         */
+        EdgeRange getEdges(IndexType node) const
+        {
+            static_assert(Direction == Directionality::UNDIRECTED,
+                "For directed graphs, incoming and outgoing edges need to be handled differently!");
+            return getRange(outgoingOffsets, outgoingEdges, node);
+        }
+
+        EdgeRange getOutgoingEdges(IndexType node) const
+        {
+            static_assert(Direction != Directionality::UNDIRECTED, "Only directed graphs have outgoing edges!");
+            return getRange(outgoingOffsets, outgoingEdges, node);
+        }
+
+        EdgeRange getIncomingEdges(IndexType node) const
+        {
+            static_assert(Direction != Directionality::UNDIRECTED, "Only directed graphs have incoming edges!");
+            return getRange(incomingOffsets, incomingEdges, node);
+        }
+
+    private:
+        FastAccessList<Key> keys;
+        FastMap<Key, IndexType> indices;
+        // the edges of node i are stored at the positions [offsets[i], offsets[i + 1]) of the edges array
+        FastAccessList<IndexType> outgoingOffsets;
+        FastAccessList<FrozenEdge> outgoingEdges;
+        // only used for (bi-)directional graphs
+        FastAccessList<IndexType> incomingOffsets;
+        FastAccessList<FrozenEdge> incomingEdges;
+
+        static EdgeRange getRange(
+            const FastAccessList<IndexType>& offsets, const FastAccessList<FrozenEdge>& edges, IndexType node)
+        {
+            if(node + 1u >= offsets.size())
+                throw CompilationError(CompilationStep::GENERAL, "Node index is out of bounds", std::to_string(node));
+            return EdgeRange(edges.data() + offsets[node], edges.data() + offsets[node + 1]);
+        }
+
+        template <typename NodeType>
+        void insertEdges(const NodeType& node, const FastMap<const NodeType*, IndexType>& nodeIndices,
+            std::true_type /* undirected */)
+        {
+            node.forAllEdges([&](const NodeType& neighbor, const typename NodeType::EdgeType& edge) -> bool {
+                outgoingEdges.emplace_back(FrozenEdge{nodeIndices.at(&neighbor), edge.data});
+                return true;
+            });
+        }
+
+        template <typename NodeType>
+        void insertEdges(const NodeType& node, const FastMap<const NodeType*, IndexType>& nodeIndices,
+            std::false_type /* undirected */)
+        {
+            node.forAllOutgoingEdges([&](const NodeType& neighbor, const typename NodeType::EdgeType& edge) -> bool {
+                outgoingEdges.emplace_back(FrozenEdge{nodeIndices.at(&neighbor), edge.data});
+                return true;
+            });
+            node.forAllIncomingEdges([&](const NodeType& neighbor, const typename NodeType::EdgeType& edge) -> bool {
+                incomingEdges.emplace_back(FrozenEdge{nodeIndices.at(&neighbor), edge.data});
+                return true;
+            });
+        }
+    };
 } // namespace vc4c
 
 namespace std
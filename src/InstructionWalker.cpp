@@ -140,7 +140,7 @@ bool InstructionVisitor::visitReverse(const InstructionWalker& start, analysis::
     }
 }
 
-InstructionWalker::InstructionWalker() : basicBlock(nullptr), pos(nullptr) {}
+InstructionWalker::InstructionWalker() : basicBlock(nullptr), pos() {}
 
 InstructionWalker::InstructionWalker(BasicBlock* basicBlock, intermediate::InstructionsIterator pos) :
     basicBlock(basicBlock), pos(pos)
@@ -236,6 +236,13 @@ bool InstructionWalker::isStartOfBlock() const
     return pos == basicBlock->instructions.begin();
 }
 
+bool InstructionWalker::isBefore(const InstructionWalker& other) const
+{
+    if(basicBlock == nullptr || basicBlock != other.basicBlock)
+        throw CompilationError(CompilationStep::GENERAL, "Can't compare positions of instructions in different blocks");
+    return basicBlock->instructions.isBefore(pos, other.pos);
+}
+
 static inline void throwOnEnd(bool isEnd)
 {
     if(isEnd)
@@ -257,6 +264,9 @@ const intermediate::IntermediateInstruction* InstructionWalker::get() const
 intermediate::IntermediateInstruction* InstructionWalker::release()
 {
     throwOnEnd(isEndOfBlock());
+    if(basicBlock->method.numActiveBatches > 0)
+        // the empty position is removed when the modification batch is committed
+        basicBlock->method.blocksWithEmptyInstructions.emplace(basicBlock);
     if(get<intermediate::BranchLabel>())
         basicBlock->method.updateCFGOnBlockRemoval(basicBlock);
     if(get<intermediate::Branch>())
@@ -321,7 +331,7 @@ InstructionWalker& InstructionWalker::emplace(intermediate::IntermediateInstruct
     return *this;
 }
 
-ConstInstructionWalker::ConstInstructionWalker() : basicBlock(nullptr), pos(nullptr) {}
+ConstInstructionWalker::ConstInstructionWalker() : basicBlock(nullptr), pos() {}
 
 ConstInstructionWalker::ConstInstructionWalker(InstructionWalker it) : basicBlock(it.basicBlock), pos(it.pos) {}
 
@@ -449,6 +459,13 @@ bool ConstInstructionWalker::isStartOfBlock() const
     return pos == basicBlock->instructions.begin();
 }
 
+bool ConstInstructionWalker::isBefore(const ConstInstructionWalker& other) const
+{
+    if(basicBlock == nullptr || basicBlock != other.basicBlock)
+        throw CompilationError(CompilationStep::GENERAL, "Can't compare positions of instructions in different blocks");
+    return basicBlock->instructions.isBefore(pos, other.pos);
+}
+
 const intermediate::IntermediateInstruction* ConstInstructionWalker::get() const
 {
     throwOnEnd(isEndOfBlock());
@@ -104,6 +104,12 @@ namespace vc4c
          * Whether this object points to the beginning of the basic block (the block's label)
          */
         bool isStartOfBlock() const;
+        /*
+         * Whether this object points to an instruction located before the instruction the other object points to.
+         *
+         * This check is executed in constant time, both objects need to point into the same basic block.
+         */
+        bool isBefore(const InstructionWalker& other) const;
 
         /*
          * Steps forward to the next instruction.
@@ -321,6 +327,12 @@ namespace vc4c
          * Whether this object points to the beginning of the basic block (the block's label)
          */
         bool isStartOfBlock() const;
+        /*
+         * Whether this object points to an instruction located before the instruction the other object points to.
+         *
+         * This check is executed in constant time, both objects need to point into the same basic block.
+         */
+        bool isBefore(const ConstInstructionWalker& other) const;
 
         /*
          * Steps forward to the next instruction.
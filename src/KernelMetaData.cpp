@@ -0,0 +1,135 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "KernelMetaData.h"
+
+#include "CompilationError.h"
+#include "helper.h"
+
+using namespace vc4c;
+
+static uint32_t applyOperation(UniformExpression::OpCode code, uint32_t first, uint32_t second)
+{
+    // the QPU only takes the lower 5 bits of the shift offset into account
+    auto offset = second & 0x1F;
+    switch(code)
+    {
+    case UniformExpression::OpCode::ADD:
+        return first + second;
+    case UniformExpression::OpCode::SUB:
+        return first - second;
+    case UniformExpression::OpCode::MUL24:
+        return (first & 0xFFFFFF) * (second & 0xFFFFFF);
+    case UniformExpression::OpCode::MUL:
+        return first * second;
+    case UniformExpression::OpCode::SHL:
+        return first << offset;
+    case UniformExpression::OpCode::SHR:
+        return first >> offset;
+    case UniformExpression::OpCode::ASR:
+        return static_cast<uint32_t>(static_cast<int32_t>(first) >> offset);
+    case UniformExpression::OpCode::AND:
+        return first & second;
+    case UniformExpression::OpCode::OR:
+        return first | second;
+    case UniformExpression::OpCode::XOR:
+        return first ^ second;
+    default:
+        break;
+    }
+    throw CompilationError(CompilationStep::GENERAL, "Unhandled uniform expression operation",
+        std::to_string(static_cast<unsigned>(code)));
+}
+
+uint32_t UniformExpression::evaluate(
+    const std::array<uint32_t, 8>& workInfo, const std::vector<uint32_t>& parameters) const
+{
+    std::vector<uint32_t> stack;
+    stack.reserve(steps.size());
+    for(const auto& step : steps)
+    {
+        if(step.code == OpCode::CONSTANT)
+            stack.push_back(step.operand);
+        else if(step.code >= OpCode::WORK_DIMENSIONS && step.code <= OpCode::GLOBAL_OFFSET_Z)
+            stack.push_back(workInfo[static_cast<uint8_t>(step.code) - static_cast<uint8_t>(OpCode::WORK_DIMENSIONS)]);
+        else if(step.code == OpCode::PARAMETER)
+        {
+            if(step.operand >= parameters.size())
+                throw CompilationError(CompilationStep::GENERAL, "Uniform expression accesses parameter out of bounds",
+                    std::to_string(step.operand));
+            stack.push_back(parameters[step.operand]);
+        }
+        else
+        {
+            if(stack.size() < 2)
+                throw CompilationError(CompilationStep::GENERAL, "Malformed uniform expression", to_string());
+            auto second = stack.back();
+            stack.pop_back();
+            stack.back() = applyOperation(step.code, stack.back(), second);
+        }
+    }
+    if(stack.size() != 1)
+        throw CompilationError(CompilationStep::GENERAL, "Malformed uniform expression", to_string());
+    return stack.front();
+}
+
+LCOV_EXCL_START
+static std::string toString(const UniformExpression::Step& step)
+{
+    switch(step.code)
+    {
+    case UniformExpression::OpCode::CONSTANT:
+        return std::to_string(step.operand);
+    case UniformExpression::OpCode::WORK_DIMENSIONS:
+        return "dims";
+    case UniformExpression::OpCode::LOCAL_SIZES:
+        return "lSize";
+    case UniformExpression::OpCode::NUM_GROUPS_X:
+        return "numX";
+    case UniformExpression::OpCode::NUM_GROUPS_Y:
+        return "numY";
+    case UniformExpression::OpCode::NUM_GROUPS_Z:
+        return "numZ";
+    case UniformExpression::OpCode::GLOBAL_OFFSET_X:
+        return "offX";
+    case UniformExpression::OpCode::GLOBAL_OFFSET_Y:
+        return "offY";
+    case UniformExpression::OpCode::GLOBAL_OFFSET_Z:
+        return "offZ";
+    case UniformExpression::OpCode::PARAMETER:
+        return "param" + std::to_string(step.operand);
+    case UniformExpression::OpCode::ADD:
+        return "add";
+    case UniformExpression::OpCode::SUB:
+        return "sub";
+    case UniformExpression::OpCode::MUL24:
+        return "mul24";
+    case UniformExpression::OpCode::MUL:
+        return "mul";
+    case UniformExpression::OpCode::SHL:
+        return "shl";
+    case UniformExpression::OpCode::SHR:
+        return "shr";
+    case UniformExpression::OpCode::ASR:
+        return "asr";
+    case UniformExpression::OpCode::AND:
+        return "and";
+    case UniformExpression::OpCode::OR:
+        return "or";
+    case UniformExpression::OpCode::XOR:
+        return "xor";
+    }
+    return "?";
+}
+
+std::string UniformExpression::to_string() const
+{
+    std::string result;
+    for(const auto& step : steps)
+        result.append(result.empty() ? "" : " ").append(toString(step));
+    return result;
+}
+LCOV_EXCL_STOP
@@ -14,6 +14,8 @@
 #include <array>
 #include <bitset>
 #include <numeric>
+#include <string>
+#include <vector>
 
 namespace vc4c
 {
@@ -39,14 +41,74 @@ namespace vc4c
         BITFIELD_ENTRY(MaxGroupIDXUsed, bool, 14, Bit)
         BITFIELD_ENTRY(MaxGroupIDYUsed, bool, 15, Bit)
         BITFIELD_ENTRY(MaxGroupIDZUsed, bool, 16, Bit)
+        /*
+         * The number of additional UNIFORMs (following the parameters) with values calculated host-side, see
+         * UniformExpression
+         */
+        BITFIELD_ENTRY(NumPrecomputedValues, uint8_t, 32, Byte)
 
         inline size_t countUniforms() const
         {
-            std::bitset<64> tmp(value);
-            return tmp.count();
+            std::bitset<32> tmp(value & 0xFFFFFFFF);
+            return tmp.count() + getNumPrecomputedValues();
         }
     };
 
+    /*
+     * The calculation of a value which is the same for all work-items of a kernel execution, executed by the host
+     * before the kernel is started and passed in an additional UNIFORM (see Configuration#precomputeUniformValues).
+     *
+     * The calculation is stored in postfix notation: the operands push their value onto a stack and the operations
+     * replace the top two values with their result. The single remaining value is the value of the UNIFORM.
+     */
+    struct UniformExpression
+    {
+        enum class OpCode : uint8_t
+        {
+            // pushes the operand of the step
+            CONSTANT = 0,
+            // push the value of the work-item information, as it is passed in the corresponding UNIFORM
+            WORK_DIMENSIONS = 1,
+            LOCAL_SIZES = 2,
+            NUM_GROUPS_X = 3,
+            NUM_GROUPS_Y = 4,
+            NUM_GROUPS_Z = 5,
+            GLOBAL_OFFSET_X = 6,
+            GLOBAL_OFFSET_Y = 7,
+            GLOBAL_OFFSET_Z = 8,
+            // pushes the value of the parameter UNIFORM with the index of the operand (counting all UNIFORMs of all
+            // preceding parameters, e.g. for direct vector parameters)
+            PARAMETER = 9,
+            // the integer operations with the semantics of the corresponding QPU operations
+            ADD = 16,
+            SUB = 17,
+            MUL24 = 18,
+            MUL = 19,
+            SHL = 20,
+            SHR = 21,
+            ASR = 22,
+            AND = 23,
+            OR = 24,
+            XOR = 25
+        };
+
+        struct Step
+        {
+            OpCode code;
+            uint32_t operand;
+        };
+
+        std::vector<Step> steps;
+
+        /*
+         * Calculates the value from the work-item information (in the order of the op-codes WORK_DIMENSIONS to
+         * GLOBAL_OFFSET_Z) and the parameter UNIFORMs
+         */
+        uint32_t evaluate(const std::array<uint32_t, 8>& workInfo, const std::vector<uint32_t>& parameters) const;
+
+        std::string to_string() const;
+    };
+
     /*
      * Container for additional meta-data of kernel-functions
      */
@@ -64,8 +126,24 @@ namespace vc4c
          * The compilation-time preferred work-group size, specified by the work_group_size_hint attribute
          */
         std::array<uint32_t, 3> workGroupSizeHints;
+        /*
+         * The number of consecutive work-items (in the first dimension) executed in the SIMD elements of a single QPU,
+         * see normalization#coarsenWorkItems
+         */
+        uint32_t workItemsPerQPU;
+        /*
+         * Whether the kernel code is generated to be run in two hardware threads per QPU, see
+         * normalization#insertThreadSwitches
+         */
+        bool isThreadable;
+        /*
+         * The values calculated host-side and passed in the UNIFORMs following the parameters, see
+         * KernelUniforms#NumPrecomputedValues
+         */
+        std::vector<UniformExpression> precomputedUniforms;
 
-        KernelMetaData() : uniformsUsed(), workGroupSizes(), workGroupSizeHints()
+        KernelMetaData() :
+            uniformsUsed(), workGroupSizes(), workGroupSizeHints(), workItemsPerQPU(1), isThreadable(false)
         {
             workGroupSizes.fill(0);
             workGroupSizeHints.fill(0);
@@ -79,12 +157,16 @@ namespace vc4c
             return std::any_of(workGroupSizes.begin(), workGroupSizes.end(), [](uint32_t u) -> bool { return u > 0; });
         }
 
-        uint32_t getWorkGroupSize()
+        /*
+         * Returns the fixed work-group size, if set or the given maximum work-group size (e.g. the number of QPUs of
+         * the target profile) otherwise
+         */
+        uint32_t getWorkGroupSize(uint32_t maxWorkGroupSize = NUM_QPUS)
         {
             if(isWorkGroupSizeSet())
                 return std::accumulate(workGroupSizes.begin(), workGroupSizes.end(), 1u, std::multiplies<uint32_t>{});
             // we don't know - assume "worst"
-            return NUM_QPUS;
+            return maxWorkGroupSize;
         }
     };
 } // namespace vc4c
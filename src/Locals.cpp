@@ -34,38 +34,28 @@ Value Local::createReference() const
     return Value(const_cast<Local*>(this), type);
 }
 
-const tools::SmallSortedPointerMap<const LocalUser*, LocalUse>& Local::getUsers() const
+static bool matchesUse(LocalUse::Type type, const LocalUse& use) noexcept
 {
-    return users;
+    return (has_flag(type, LocalUse::Type::READER) && use.readsLocal()) ||
+        (has_flag(type, LocalUse::Type::WRITER) && use.writesLocal());
 }
 
-FastSet<const LocalUser*> Local::getUsers(const LocalUse::Type type) const
-{
-    auto lock = getUsersLock();
-    FastSet<const LocalUser*> users;
-    for(const auto& pair : this->users)
-    {
-        if((has_flag(type, LocalUse::Type::READER) && pair.second.readsLocal()) ||
-            (has_flag(type, LocalUse::Type::WRITER) && pair.second.writesLocal()))
-            users.insert(pair.first);
-    }
-    return users;
-}
-
-void Local::forUsers(const LocalUse::Type type, const std::function<void(const LocalUser*)>& consumer) const
+static void addUse(
+    tools::SmallSortedPointerMap<const LocalUser*, LocalUse>& users, const LocalUser& user, const LocalUse::Type type)
 {
-    auto lock = getUsersLock();
-    for(const auto& pair : this->users)
-    {
-        if((has_flag(type, LocalUse::Type::READER) && pair.second.readsLocal()) ||
-            (has_flag(type, LocalUse::Type::WRITER) && pair.second.writesLocal()))
-            consumer(pair.first);
-    }
+    auto it = users.find(&user);
+    if(it == users.end())
+        it = users.emplace(&user, LocalUse()).first;
+    LocalUse& use = it->second;
+    if(has_flag(type, LocalUse::Type::READER))
+        ++use.numReads;
+    if(has_flag(type, LocalUse::Type::WRITER))
+        ++use.numWrites;
 }
 
-void Local::removeUser(const LocalUser& user, const LocalUse::Type type)
+static void removeUse(
+    tools::SmallSortedPointerMap<const LocalUser*, LocalUse>& users, const LocalUser& user, const LocalUse::Type type)
 {
-    auto lock = getUsersLock();
     if(type == LocalUse::Type::BOTH)
     {
         // if we remove the user completely, ignore if it was a user
@@ -85,34 +75,63 @@ void Local::removeUser(const LocalUser& user, const LocalUse::Type type)
         users.erase(&user);
 }
 
-void Local::addUser(const LocalUser& user, const LocalUse::Type type)
+tools::SmallSortedPointerMap<const LocalUser*, LocalUse> Local::getUsers() const
 {
-    auto lock = getUsersLock();
-    auto it = users.find(&user);
-    if(it == users.end())
-        it = users.emplace(&user, LocalUse()).first;
-    LocalUse& use = it->second;
-    if(has_flag(type, LocalUse::Type::READER))
-        ++use.numReads;
-    if(has_flag(type, LocalUse::Type::WRITER))
-        ++use.numWrites;
+    if(auto shared = getSharedUsers())
+        return shared->getUsers();
+    return users;
 }
 
-const LocalUser* Local::getSingleWriter() const
+FastSet<const LocalUser*> Local::getUsers(const LocalUse::Type type) const
 {
-    auto lock = getUsersLock();
-    const LocalUser* writer = nullptr;
+    FastSet<const LocalUser*> users;
+    forUsers(type, [&](const LocalUser* user) { users.insert(user); });
+    return users;
+}
+
+void Local::forUsers(const LocalUse::Type type, const std::function<void(const LocalUser*)>& consumer) const
+{
+    if(auto shared = getSharedUsers())
+    {
+        shared->forAllUsers([&](const LocalUser* user, const LocalUse& use) {
+            if(matchesUse(type, use))
+                consumer(user);
+        });
+        return;
+    }
     for(const auto& pair : this->users)
     {
-        if(pair.second.writesLocal())
-        {
-            if(writer != nullptr)
-                // multiple writers
-                return nullptr;
-            writer = pair.first;
-        }
+        if(matchesUse(type, pair.second))
+            consumer(pair.first);
     }
-    return writer;
+}
+
+void Local::removeUser(const LocalUser& user, const LocalUse::Type type)
+{
+    if(auto shared = getSharedUsers())
+        shared->removeUser(user, type);
+    else
+        removeUse(users, user, type);
+}
+
+void Local::addUser(const LocalUser& user, const LocalUse::Type type)
+{
+    if(auto shared = getSharedUsers())
+        shared->addUser(user, type);
+    else
+        addUse(users, user, type);
+}
+
+const LocalUser* Local::getSingleWriter() const
+{
+    const LocalUser* writer = nullptr;
+    bool multipleWriters = false;
+    forUsers(LocalUse::Type::WRITER, [&](const LocalUser* user) {
+        if(writer != nullptr)
+            multipleWriters = true;
+        writer = user;
+    });
+    return multipleWriters ? nullptr : writer;
 }
 
 LCOV_EXCL_START
@@ -137,16 +156,65 @@ const Local* Local::getBase(bool includeOffsets) const
     return this;
 }
 
-Local::RAIILock Local::getUsersLock() const
+Local::SharedUsers* Local::getSharedUsers() const
+{
+    return nullptr;
+}
+
+void Local::SharedUsers::addUser(const LocalUser& user, LocalUse::Type type)
+{
+    auto& shard = getShard(user);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    addUse(getWritableUsers(shard), user, type);
+}
+
+void Local::SharedUsers::removeUser(const LocalUser& user, LocalUse::Type type)
+{
+    auto& shard = getShard(user);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    removeUse(getWritableUsers(shard), user, type);
+}
+
+void Local::SharedUsers::forAllUsers(const std::function<void(const LocalUser*, const LocalUse&)>& consumer) const
+{
+    for(auto& shard : shards)
+    {
+        // do not hold the lock while running the consumer, which might access the users again
+        std::shared_ptr<const tools::SmallSortedPointerMap<const LocalUser*, LocalUse>> users;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            users = shard.users;
+        }
+        if(!users)
+            continue;
+        for(const auto& pair : *users)
+            consumer(pair.first, pair.second);
+    }
+}
+
+tools::SmallSortedPointerMap<const LocalUser*, LocalUse> Local::SharedUsers::getUsers() const
+{
+    tools::SmallSortedPointerMap<const LocalUser*, LocalUse> users;
+    forAllUsers([&](const LocalUser* user, const LocalUse& use) { users.emplace(user, use); });
+    return users;
+}
+
+Local::SharedUsers::Shard& Local::SharedUsers::getShard(const LocalUser& user) const
 {
-    // no-op
-    return RAIILock{};
+    // the users are allocated with similar alignment, so mix all the address bits (Fibonacci hashing)
+    auto hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&user)) * 0x9E3779B97F4A7C15ull;
+    return shards[static_cast<std::size_t>(hash >> 60) % NUM_SHARDS];
 }
 
-Local::RAIILock::~RAIILock() noexcept
+tools::SmallSortedPointerMap<const LocalUser*, LocalUse>& Local::SharedUsers::getWritableUsers(Shard& shard)
 {
-    if(func)
-        func();
+    // NOTE: the shard lock needs to be held. Since readers only acquire the users while holding the lock, no reader can
+    // access the users if we hold the only reference.
+    if(!shard.users)
+        shard.users = std::make_shared<tools::SmallSortedPointerMap<const LocalUser*, LocalUse>>();
+    else if(shard.users.use_count() > 1)
+        shard.users = std::make_shared<tools::SmallSortedPointerMap<const LocalUser*, LocalUse>>(*shard.users);
+    return *shard.users;
 }
 
 Parameter::Parameter(const std::string& name, DataType type, const ParameterDecorations decorations) :
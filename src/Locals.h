@@ -9,10 +9,13 @@
 
 #include "CompilationError.h"
 #include "Values.h"
+#include "tools/MemoryPool.h"
 #include "tools/SmallMap.h"
 
+#include <array>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <utility>
 
 namespace vc4c
@@ -72,7 +75,7 @@ namespace vc4c
      * Local type itself would waste memory. Also, depending on the type of Local (e.g. the DataType stored), different
      * types of additional information might be of interest.
      */
-    struct LocalData
+    struct LocalData : public tools::PooledObject<profiler::MemoryCategory::LOCALS>
     {
         LocalData() = default;
         LocalData(const LocalData&) = default;
@@ -95,7 +98,7 @@ namespace vc4c
      * Similarly to LocalUsers tracking the Locals used, Locals track their users. This allows for easier finding of
      * reading/writing access to locals.
      */
-    class Local : private NonCopyable
+    class Local : public tools::PooledObject<profiler::MemoryCategory::LOCALS>, private NonCopyable
     {
     public:
         Local(const Local&) = delete;
@@ -115,8 +118,11 @@ namespace vc4c
 
         /*
          * Returns all the LocalUsers accessing this object
+         *
+         * NOTE: This returns a copy of the users, since the users of locals shared across kernels (e.g. globals) can
+         * be modified concurrently. To not copy the users, use #forUsers instead.
          */
-        const tools::SmallSortedPointerMap<const LocalUser*, LocalUse>& getUsers() const;
+        tools::SmallSortedPointerMap<const LocalUser*, LocalUse> getUsers() const;
         /*
          * Returns the users of the given kind (reading or writing) accessing this Local
          */
@@ -234,27 +240,51 @@ namespace vc4c
     protected:
         Local(DataType type, const std::string& name);
 
-        struct RAIILock
+        /*
+         * Container for the users of locals shared across kernels (and therefore across threads), e.g. globals.
+         *
+         * To not serialize all kernels processed in parallel on a single lock, the users are split into several
+         * shards (selected by the address of the user), each guarded by its own lock. Thus, two threads only contend,
+         * if they modify users falling into the same shard.
+         */
+        class SharedUsers
         {
-            using UnlockFunc = std::function<void()>;
-            explicit RAIILock(UnlockFunc&& f = nullptr) : func(std::move(f)) {}
-            RAIILock(const RAIILock&) = delete;
-            RAIILock(RAIILock&& other) noexcept : func(std::move(other.func))
+        public:
+            void addUser(const LocalUser& user, LocalUse::Type type);
+            void removeUser(const LocalUser& user, LocalUse::Type type);
+            /*
+             * Executes the consumer for all users, locking only a single shard at a time and only for the duration of
+             * acquiring its current users
+             */
+            void forAllUsers(const std::function<void(const LocalUser*, const LocalUse&)>& consumer) const;
+            /*
+             * Returns a copy of the users of all shards
+             */
+            tools::SmallSortedPointerMap<const LocalUser*, LocalUse> getUsers() const;
+
+        private:
+            static constexpr std::size_t NUM_SHARDS = 16;
+
+            /*
+             * The users of a shard are copy-on-write: Readers only take a reference to the current users while holding
+             * the lock and iterate them without it. Writers modify the users in-place, unless any reader still
+             * references them, in which case they are copied first. Thus, published users are never modified.
+             */
+            struct Shard
             {
-                other.func = nullptr;
-            }
-            ~RAIILock() noexcept;
+                std::mutex lock;
+                std::shared_ptr<tools::SmallSortedPointerMap<const LocalUser*, LocalUse>> users;
+            };
 
-            RAIILock& operator=(const RAIILock&) = delete;
-            RAIILock& operator=(RAIILock&&) noexcept = delete;
+            mutable std::array<Shard, NUM_SHARDS> shards;
 
-        private:
-            UnlockFunc func;
+            Shard& getShard(const LocalUser& user) const;
+            static tools::SmallSortedPointerMap<const LocalUser*, LocalUse>& getWritableUsers(Shard& shard);
         };
 
-        // To be implemented by locals shared across kernels (and therefore across threads) to prevent concurrent
-        // modifications
-        virtual RAIILock getUsersLock() const;
+        // To be implemented by locals shared across kernels (and therefore across threads) to track their users in a
+        // container which can be concurrently modified. Returns nullptr for locals only accessed by a single thread.
+        virtual SharedUsers* getSharedUsers() const;
 
     private:
         // FIXME unordered_map randomly throws SEGFAULT somewhere in stdlib in #removeUser called by
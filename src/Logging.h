@@ -0,0 +1,86 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_LOGGING_H
+#define VC4C_LOGGING_H
+
+#include "log.h"
+
+#include <atomic>
+
+/*
+ * The minimum log level compiled into the library (0 = DEBUG, 1 = INFO, 2 = WARNING, 3 = ERROR, 4 = SEVERE), set via
+ * the VC4C_LOG_LEVEL CMake option. Messages of lower levels logged with the macros below are removed at compile-time.
+ */
+#ifndef VC4C_MINIMUM_LOG_LEVEL
+#define VC4C_MINIMUM_LOG_LEVEL 0
+#endif
+
+namespace vc4c
+{
+    /*
+     * Converts the log level to its severity, since the numerical values of the log levels (their character codes) are
+     * not ordered by severity
+     */
+    constexpr unsigned toSeverity(logging::Level level)
+    {
+        switch(level)
+        {
+        case logging::Level::DEBUG:
+            return 0;
+        case logging::Level::INFO:
+            return 1;
+        case logging::Level::WARNING:
+            return 2;
+        case logging::Level::ERROR:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    /*
+     * The severity of the minimum log level of the current logger, updated by #setLogger().
+     *
+     * NOTE: Loggers set directly (without #setLogger()) are not tracked and are assumed to log at WARNING level.
+     */
+    extern std::atomic<unsigned> activeLogSeverity;
+
+    /*
+     * Returns whether messages of the given level are compiled in and logged by the current logger.
+     *
+     * In contrast to the check done by cpplog itself, this is a single relaxed atomic load (and is constant-folded for
+     * the levels removed at compile-time), so it is cheap enough for the hot paths of the optimizer and the emulator.
+     */
+    inline bool isLogLevelEnabled(logging::Level level)
+    {
+#if VC4C_MINIMUM_LOG_LEVEL > 0
+        if(toSeverity(level) < VC4C_MINIMUM_LOG_LEVEL)
+            return false;
+#endif
+        return toSeverity(level) >= activeLogSeverity.load(std::memory_order_relaxed);
+    }
+} // namespace vc4c
+
+/*
+ * Variants of CPPLOG_LAZY and CPPLOG_LAZY_BLOCK which skip the message (including the creation of the lambda and the
+ * check within cpplog) if the level is not enabled, see #isLogLevelEnabled(). Use these in frequently executed code.
+ */
+#define LOG_LAZY(level, ...)                                                                                           \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if(vc4c::isLogLevelEnabled(level))                                                                             \
+            CPPLOG_LAZY(level, __VA_ARGS__);                                                                           \
+    } while(false)
+
+#define LOG_LAZY_BLOCK(level, ...)                                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if(vc4c::isLogLevelEnabled(level))                                                                             \
+            CPPLOG_LAZY_BLOCK(level, __VA_ARGS__);                                                                     \
+    } while(false)
+
+#endif /* VC4C_LOGGING_H */
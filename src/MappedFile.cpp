@@ -0,0 +1,90 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "MappedFile.h"
+
+#include "CompilationError.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace vc4c;
+
+MappedFileBuffer::MappedFileBuffer(const std::string& fileName) : begin(nullptr), length(0)
+{
+    int fd = open(fileName.data(), O_RDONLY);
+    if(fd < 0)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open file: " + std::string(strerror(errno)), fileName);
+    struct stat info = {};
+    if(fstat(fd, &info) != 0)
+    {
+        close(fd);
+        throw CompilationError(
+            CompilationStep::GENERAL, "Failed to determine file size: " + std::string(strerror(errno)), fileName);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if(length > 0)
+    {
+        // mapping of empty files fails, so leave the buffer empty for them
+        void* ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(ptr == MAP_FAILED)
+        {
+            close(fd);
+            throw CompilationError(
+                CompilationStep::GENERAL, "Failed to map file into memory: " + std::string(strerror(errno)), fileName);
+        }
+        begin = static_cast<char*>(ptr);
+        // the file is read from start to end
+        madvise(ptr, length, MADV_SEQUENTIAL);
+    }
+    // the mapping stays valid after closing the file descriptor
+    close(fd);
+    setg(begin, begin, begin + length);
+}
+
+MappedFileBuffer::~MappedFileBuffer()
+{
+    if(begin != nullptr)
+        munmap(begin, length);
+}
+
+MappedFileBuffer::pos_type MappedFileBuffer::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if((which & std::ios_base::in) == 0)
+        return pos_type(off_type(-1));
+    off_type base = 0;
+    if(dir == std::ios_base::cur)
+        base = gptr() - eback();
+    else if(dir == std::ios_base::end)
+        base = static_cast<off_type>(length);
+    return seekpos(pos_type(base + off), which);
+}
+
+MappedFileBuffer::pos_type MappedFileBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    auto offset = static_cast<off_type>(pos);
+    if((which & std::ios_base::in) == 0 || offset < 0 || offset > static_cast<off_type>(length))
+        return pos_type(off_type(-1));
+    setg(begin, begin + offset, begin + length);
+    return pos;
+}
+
+MappedFileStream::MappedFileStream(const std::string& fileName) : std::istream(nullptr), buffer(fileName)
+{
+    rdbuf(&buffer);
+}
+
+MappedFileStream::~MappedFileStream() = default;
+
+const MappedFileBuffer* vc4c::getMappedBuffer(const std::istream& stream)
+{
+    return dynamic_cast<const MappedFileBuffer*>(stream.rdbuf());
+}
@@ -0,0 +1,77 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_MAPPED_FILE_H
+#define VC4C_MAPPED_FILE_H
+
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+namespace vc4c
+{
+    /*
+     * Read-only stream buffer directly operating on the contents of a memory-mapped file.
+     *
+     * This allows the consumers of the input (e.g. the source-type detection and the front-ends) to access the whole
+     * file contents without copying them into intermediate buffers.
+     */
+    class MappedFileBuffer final : public std::streambuf
+    {
+    public:
+        explicit MappedFileBuffer(const std::string& fileName);
+        MappedFileBuffer(const MappedFileBuffer&) = delete;
+        MappedFileBuffer(MappedFileBuffer&&) noexcept = delete;
+        ~MappedFileBuffer() override;
+
+        MappedFileBuffer& operator=(const MappedFileBuffer&) = delete;
+        MappedFileBuffer& operator=(MappedFileBuffer&&) noexcept = delete;
+
+        const char* data() const
+        {
+            return begin;
+        }
+
+        std::size_t size() const
+        {
+            return length;
+        }
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+    private:
+        char* begin;
+        std::size_t length;
+    };
+
+    /*
+     * Input stream reading the contents of a memory-mapped file
+     */
+    class MappedFileStream final : public std::istream
+    {
+    public:
+        explicit MappedFileStream(const std::string& fileName);
+        ~MappedFileStream() override;
+
+        const MappedFileBuffer& getBuffer() const
+        {
+            return buffer;
+        }
+
+    private:
+        MappedFileBuffer buffer;
+    };
+
+    /*
+     * Returns the memory-mapped file backing the given stream, if any
+     */
+    const MappedFileBuffer* getMappedBuffer(const std::istream& stream);
+
+} /* namespace vc4c */
+
+#endif /* VC4C_MAPPED_FILE_H */
@@ -8,6 +8,7 @@
 
 #include "Module.h"
 #include "Profiler.h"
+#include "analysis/AnalysisManager.h"
 #include "analysis/ControlFlowGraph.h"
 #include "intermediate/IntermediateInstruction.h"
 #include "periphery/VPM.h"
@@ -23,7 +24,7 @@ using namespace vc4c;
 
 Method::Method(Module& module) :
     isKernel(false), name(), returnType(TYPE_UNKNOWN),
-    vpm(new periphery::VPM(module.compilationConfig.availableVPMSize)), module(module)
+    vpm(new periphery::VPM(module.compilationConfig.target.availableVPMSize)), module(module)
 {
 }
 
@@ -51,6 +52,13 @@ const Parameter* Method::findParameter(const std::string& name) const
     return nullptr;
 }
 
+const Local* Method::findLocal(const std::string& name) const
+{
+    std::lock_guard<std::mutex> guard(localsLock);
+    auto it = locals.find(Local(TYPE_UNKNOWN, name));
+    return it != locals.end() ? &(*it) : nullptr;
+}
+
 const Global* Method::findGlobal(const std::string& name) const
 {
     return module.findGlobal(name);
@@ -68,6 +76,7 @@ const StackAllocation* Method::findStackAllocation(const std::string& name) cons
 
 const Local* Method::createLocal(DataType type, const std::string& name)
 {
+    std::lock_guard<std::mutex> guard(localsLock);
     auto it = locals.emplace(Local(type, name)).first;
     addLocalData(const_cast<Local&>(*it));
     return &(*it);
@@ -333,6 +342,35 @@ std::size_t Method::getNumLocals() const
     return locals.size();
 }
 
+tools::IndexTable<const Local*> Method::createLocalIndices() const
+{
+    tools::IndexTable<const Local*> table(parameters.size() + locals.size() + builtinLocals.size());
+    for(const auto& param : parameters)
+        table.addObject(&param);
+    for(const auto& builtin : builtinLocals)
+    {
+        if(builtin)
+            table.addObject(builtin.get());
+    }
+    for(const auto& loc : locals)
+        table.addObject(&loc);
+    return table;
+}
+
+tools::IndexTable<const intermediate::IntermediateInstruction*> Method::createInstructionIndices() const
+{
+    tools::IndexTable<const intermediate::IntermediateInstruction*> table(countInstructions());
+    for(const BasicBlock& bb : *this)
+    {
+        for(const auto& instr : bb.instructions)
+        {
+            if(instr)
+                table.addObject(instr.get());
+        }
+    }
+    return table;
+}
+
 void Method::cleanLocals()
 {
     // FIXME deletes locals which still have Local#reference to them
@@ -387,6 +425,15 @@ void Method::dumpInstructions() const
 }
 LCOV_EXCL_STOP
 
+void Method::dumpInstructions(std::ostream& out) const
+{
+    for(const BasicBlock& bb : *this)
+    {
+        for(const auto& instr : bb.instructions)
+            out << (instr ? instr->to_string() : "(null)") << std::endl;
+    }
+}
+
 BasicBlock* Method::findBasicBlock(const Local* label)
 {
     for(BasicBlock& bb : *this)
@@ -470,7 +517,10 @@ bool Method::removeBlock(BasicBlock& block, bool overwriteUsages)
 
 BasicBlock& Method::createAndInsertNewBlock(BasicBlockList::iterator position, const std::string& labelName)
 {
-    auto newLabel = locals.emplace(Local(TYPE_LABEL, labelName));
+    auto newLabel = [&]() {
+        std::lock_guard<std::mutex> guard(localsLock);
+        return locals.emplace(Local(TYPE_LABEL, labelName));
+    }();
     auto& block = *basicBlocks.emplace(position, *this, new intermediate::BranchLabel(*newLabel.first));
     updateCFGOnBlockInsertion(&block);
     return block;
@@ -614,11 +664,20 @@ analysis::ControlFlowGraph& Method::getCFG()
     return *cfg;
 }
 
+analysis::AnalysisManager& Method::getAnalyses()
+{
+    if(!analyses)
+        analyses.reset(new analysis::AnalysisManager(*this));
+    return *analyses;
+}
+
 void Method::moveBlock(BasicBlockList::iterator origin, BasicBlockList::iterator dest)
 {
     // splice removes the element pointed to by origin from the list (second) parameter and inserts it into the list
     // object at position dest without creating or destroying an object
     basicBlocks.splice(dest, basicBlocks, origin);
+    // the order of the blocks is part of the loop and data dependency analyses results
+    invalidateAnalyses();
 }
 
 DataType Method::createPointerType(DataType elementType, AddressSpace addressSpace, unsigned alignment)
@@ -682,6 +741,9 @@ void Method::checkAndCreateDefaultBasicBlock()
 
 void Method::updateCFGOnBlockInsertion(BasicBlock* block)
 {
+    if(deferCFGUpdate())
+        return;
+    invalidateAnalyses();
     if(!cfg)
         return;
     cfg->updateOnBlockInsertion(*this, *block);
@@ -689,6 +751,10 @@ void Method::updateCFGOnBlockInsertion(BasicBlock* block)
 
 void Method::updateCFGOnBlockRemoval(BasicBlock* block)
 {
+    blocksWithEmptyInstructions.erase(block);
+    if(deferCFGUpdate())
+        return;
+    invalidateAnalyses();
     if(!cfg)
         return;
     cfg->updateOnBlockRemoval(*this, *block);
@@ -696,6 +762,9 @@ void Method::updateCFGOnBlockRemoval(BasicBlock* block)
 
 void Method::updateCFGOnBranchInsertion(InstructionWalker it)
 {
+    if(deferCFGUpdate())
+        return;
+    invalidateAnalyses();
     if(!cfg)
         return;
     cfg->updateOnBranchInsertion(*this, it);
@@ -703,11 +772,31 @@ void Method::updateCFGOnBranchInsertion(InstructionWalker it)
 
 void Method::updateCFGOnBranchRemoval(BasicBlock& affectedBlock, const Local* branchTarget)
 {
+    if(deferCFGUpdate())
+        return;
+    invalidateAnalyses();
     if(!cfg)
         return;
     cfg->updateOnBranchRemoval(*this, affectedBlock, branchTarget);
 }
 
+bool Method::deferCFGUpdate()
+{
+    if(numActiveBatches == 0)
+        return false;
+    // drop the CFG instead of updating it for every single change, it is re-created from scratch on the next access
+    if(cfg)
+        cfg.reset();
+    invalidateAnalyses();
+    return true;
+}
+
+void Method::invalidateAnalyses()
+{
+    if(analyses)
+        analyses->invalidate();
+}
+
 void Method::addLocalData(Local& loc)
 {
     if(loc.type.isSimpleType() && loc.type.getScalarBitCount() > 32 && loc.type.getScalarBitCount() <= 64)
@@ -718,3 +807,125 @@ void Method::addLocalData(Local& loc)
         loc.set(MultiRegisterData(&*lower, &*upper));
     }
 }
+
+/*
+ * Copies the instruction, keeping all locals, and removes the copy as user of the locals
+ */
+static std::unique_ptr<intermediate::IntermediateInstruction> copyInstruction(
+    Method& method, const intermediate::IntermediateInstruction& instr, bool registerAsUser)
+{
+    intermediate::InlineMapping sameLocals;
+    for(const auto& pair : instr.getUsedLocals())
+        sameLocals.emplace(pair.first, pair.first);
+    std::unique_ptr<intermediate::IntermediateInstruction> copy(instr.copyFor(method, "", sameLocals));
+    if(!registerAsUser)
+    {
+        for(const auto& pair : copy->getUsedLocals())
+            const_cast<Local*>(pair.first)->removeUser(*copy, LocalUse::Type::BOTH);
+    }
+    return copy;
+}
+
+ModificationBatch::ModificationBatch(Method& method) : method(method), active(true)
+{
+    ++method.numActiveBatches;
+}
+
+ModificationBatch::~ModificationBatch() noexcept
+{
+    if(active)
+        commit();
+}
+
+void ModificationBatch::commit()
+{
+    if(!active)
+        throw CompilationError(CompilationStep::GENERAL, "Modification batch was already committed");
+    active = false;
+    if(--method.numActiveBatches > 0)
+        return;
+    for(auto block : method.blocksWithEmptyInstructions)
+    {
+        auto it = block->walk();
+        while(!it.isEndOfBlock())
+        {
+            if(it.has())
+                it.nextInBlock();
+            else
+                it.erase();
+        }
+    }
+    method.blocksWithEmptyInstructions.clear();
+}
+
+MethodCheckpoint::MethodCheckpoint(Method& method) : method(method), active(true)
+{
+    PROFILE_START(CreateMethodCheckpoint);
+    blocks.reserve(method.size());
+    for(const BasicBlock& block : method)
+    {
+        BlockState state{block.getLabel()->getLabel(), {}};
+        state.instructions.reserve(block.instructions.size());
+        for(const auto& instr : block.instructions)
+        {
+            if(instr)
+                state.instructions.emplace_back(copyInstruction(method, *instr, false));
+        }
+        blocks.emplace_back(std::move(state));
+    }
+    PROFILE_END(CreateMethodCheckpoint);
+}
+
+MethodCheckpoint::~MethodCheckpoint() noexcept = default;
+
+void MethodCheckpoint::commit()
+{
+    if(!active)
+        throw CompilationError(CompilationStep::GENERAL, "Checkpoint was already committed or rolled back");
+    active = false;
+    blocks.clear();
+}
+
+void MethodCheckpoint::rollback()
+{
+    if(!active)
+        throw CompilationError(CompilationStep::GENERAL, "Checkpoint was already committed or rolled back");
+    PROFILE_START(RollbackMethodCheckpoint);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Rolling back function " << method.name << " to the checkpoint with " << blocks.size() << " blocks"
+            << logging::endl);
+    // remember the blocks still present, since the labels will be removed in the next step
+    FastMap<const Local*, Method::BasicBlockList::iterator> remainingBlocks;
+    for(auto it = method.basicBlocks.begin(); it != method.basicBlocks.end(); ++it)
+        remainingBlocks.emplace(it->getLabel()->getLabel(), it);
+    // remove all current instructions, which also de-registers them as users of their locals
+    for(auto& block : method.basicBlocks)
+        block.instructions.clear();
+
+    Method::BasicBlockList restoredBlocks;
+    for(auto& state : blocks)
+    {
+        auto blockIt = remainingBlocks.find(state.label);
+        if(blockIt != remainingBlocks.end())
+            restoredBlocks.splice(restoredBlocks.end(), method.basicBlocks, blockIt->second);
+        else
+        {
+            // the block was removed in the meantime, re-create it
+            auto label = copyInstruction(method, *state.instructions.front(), true);
+            restoredBlocks.emplace_back(method, dynamic_cast<intermediate::BranchLabel*>(label.release()));
+            state.instructions.erase(state.instructions.begin());
+        }
+        auto& block = restoredBlocks.back();
+        for(const auto& instr : state.instructions)
+            block.instructions.emplace_back(copyInstruction(method, *instr, true).release());
+    }
+    // the blocks left over were created after the checkpoint and are already empty
+    method.basicBlocks.swap(restoredBlocks);
+    method.blocksWithEmptyInstructions.clear();
+    method.cfg.reset();
+    method.invalidateAnalyses();
+
+    active = false;
+    blocks.clear();
+    PROFILE_END(RollbackMethodCheckpoint);
+}
@@ -10,6 +10,9 @@
 #include "BasicBlock.h"
 #include "KernelMetaData.h"
 #include "Optional.h"
+#include "tools/IndexTable.h"
+
+#include <mutex>
 
 namespace vc4c
 {
@@ -20,6 +23,7 @@ namespace vc4c
     namespace analysis
     {
         class ControlFlowGraph;
+        class AnalysisManager;
     } // namespace analysis
     class Module;
     struct Global;
@@ -78,6 +82,8 @@ namespace vc4c
          * If both pre- and postfix are set, the local has the name "prefix.postfix"
          *
          * NOTE: The name of a local must be unique within a method (for parameter, globals, stack-allocations too)
+         * NOTE: This (as well as #createLocal() and #findLocal()) can be called concurrently, e.g. by the optimization
+         * steps run in parallel for independent blocks.
          */
         NODISCARD const Value addNewLocal(
             DataType type, const std::string& prefix = "", const std::string& postfix = "");
@@ -106,6 +112,10 @@ namespace vc4c
          * Looks for a parameter with the given name and returns it.
          */
         const Parameter* findParameter(const std::string& name) const;
+        /*
+         * Looks for a local with the given name and returns it.
+         */
+        const Local* findLocal(const std::string& name) const;
         /*
          * Looks for a global with the given name and returns it.
          */
@@ -159,6 +169,18 @@ namespace vc4c
         InstructionWalker appendToEnd();
 
         std::size_t getNumLocals() const;
+        /*
+         * Assigns dense indices to all parameters and locals (including the builtin locals) of this method, e.g. to
+         * be able to store sets of locals as bit-sets.
+         *
+         * NOTE: Locals not owned by this method (e.g. globals) are not assigned an index, but can be added to the
+         * table explicitly.
+         */
+        tools::IndexTable<const Local*> createLocalIndices() const;
+        /*
+         * Assigns dense indices to all instructions of this method in the order of their occurrence.
+         */
+        tools::IndexTable<const intermediate::IntermediateInstruction*> createInstructionIndices() const;
         /*
          * Removes all locals without any usages left
          */
@@ -168,6 +190,10 @@ namespace vc4c
          * Prints all instruction to the logging-stream
          */
         void dumpInstructions() const;
+        /*
+         * Writes all instructions into the given stream, one per line
+         */
+        void dumpInstructions(std::ostream& out) const;
 
         /*
          * The following functions are for traversal only and do not allow the basic blocks themselves to be modified.
@@ -202,6 +228,11 @@ namespace vc4c
         BasicBlock* findBasicBlock(const std::string& label);
         const BasicBlock* findBasicBlock(const std::string& label) const;
 
+        /*
+         * Returns the basic block following the given block in the order of the method, or nullptr for the last block
+         */
+        BasicBlock* getNextBlockAfter(const BasicBlock* block);
+
         /*
          * Clears and removes the given basic block.
          *
@@ -271,6 +302,13 @@ namespace vc4c
          */
         analysis::ControlFlowGraph& getCFG();
 
+        /*
+         * Returns the cache of the method-wide analysis results for this function.
+         *
+         * NOTE: Any change in the control flow of the function invalidates all cached analysis results
+         */
+        analysis::AnalysisManager& getAnalyses();
+
         /*
          * The module the method belongs to
          */
@@ -302,8 +340,13 @@ namespace vc4c
          * The list of locals
          *
          * This is a sorted set, since a hashset somehow a very bad performance!
+         * The nodes are allocated from the memory pool, since large kernels create (and remove) lots of locals.
+         */
+        SortedSet<Local, std::less<Local>, tools::PoolAllocator<Local, profiler::MemoryCategory::LOCALS>> locals;
+        /*
+         * Guards the insertion into and the lookup in the list of locals
          */
-        SortedSet<Local> locals;
+        mutable std::mutex localsLock;
 
         /*
          * The builtin locals which are statically named
@@ -317,9 +360,23 @@ namespace vc4c
          */
         std::unique_ptr<analysis::ControlFlowGraph> cfg;
 
+        /*
+         * The cached analysis results, created on first access
+         */
+        std::unique_ptr<analysis::AnalysisManager> analyses;
+
+        /*
+         * The number of currently active modification batches, see ModificationBatch
+         */
+        unsigned numActiveBatches = 0;
+        /*
+         * The basic blocks containing positions emptied by InstructionWalker#release() while a modification batch is
+         * active, cleaned up when the last batch is committed
+         */
+        FastSet<BasicBlock*> blocksWithEmptyInstructions;
+
         std::string createLocalName(const std::string& prefix = "", const std::string& postfix = "");
 
-        BasicBlock* getNextBlockAfter(const BasicBlock* block);
         BasicBlock* getPreviousBlock(const BasicBlock* block);
 
         void checkAndCreateDefaultBasicBlock();
@@ -328,12 +385,107 @@ namespace vc4c
         void updateCFGOnBlockRemoval(BasicBlock* block);
         void updateCFGOnBranchInsertion(InstructionWalker it);
         void updateCFGOnBranchRemoval(BasicBlock& affectedBlock, const Local* branchTarget);
+        bool deferCFGUpdate();
+        void invalidateAnalyses();
 
         void addLocalData(Local& loc);
 
         friend class BasicBlock;
         friend class InstructionWalker;
         friend class ConstInstructionWalker;
+        friend class MethodCheckpoint;
+        friend class ModificationBatch;
+    };
+
+    /*
+     * Batches the modifications of the control flow of a method, e.g. for lowerings or the inlining inserting many
+     * instructions, branches and basic blocks at once.
+     *
+     * While a batch is active, inserting or removing branches and basic blocks does not update the CFG for every single
+     * change. Instead, the CFG is dropped (and re-created on its next access) and the analyses are invalidated once.
+     * When the last active batch is committed (or destroyed), the positions emptied by InstructionWalker#release() are
+     * removed from their basic blocks.
+     *
+     * NOTE: The users of the locals are still updated immediately, since the instructions register themselves on
+     * construction and the lowerings rely on them being up-to-date (e.g. to find the single writer of a value).
+     * NOTE: Any reference to the CFG is invalidated by a modification of the control flow while a batch is active!
+     */
+    class ModificationBatch : private NonCopyable
+    {
+    public:
+        explicit ModificationBatch(Method& method);
+        ModificationBatch(const ModificationBatch&) = delete;
+        ModificationBatch(ModificationBatch&&) noexcept = delete;
+        // If not yet committed, commits the batch
+        ~ModificationBatch() noexcept;
+
+        ModificationBatch& operator=(const ModificationBatch&) = delete;
+        ModificationBatch& operator=(ModificationBatch&&) noexcept = delete;
+
+        /*
+         * Ends this batch and applies the deferred clean-up, if this is the last active batch of the method
+         */
+        void commit();
+
+    private:
+        Method& method;
+        bool active;
+    };
+
+    /*
+     * Checkpoint of the instructions of a method, allowing to speculatively apply a transformation and to revert the
+     * method to the state at the creation of the checkpoint, if the transformation does not pay off.
+     *
+     * The checkpoint stores copies of all instructions (in the order of the basic blocks). The copies are not
+     * registered as users of the locals they access, so the checkpoint does not influence any other optimization.
+     *
+     * On rollback, the basic blocks (identified by their labels) are restored in their previous order, including
+     * blocks removed in the meantime, blocks created after the checkpoint are removed. The instructions of all blocks
+     * are replaced with the stored state and the CFG is invalidated.
+     *
+     * NOTE: Any iterator or pointer to instructions (and to blocks created after the checkpoint) is invalidated by a
+     * rollback! Locals created after the checkpoint are not removed.
+     */
+    class MethodCheckpoint : private NonCopyable
+    {
+    public:
+        explicit MethodCheckpoint(Method& method);
+        MethodCheckpoint(const MethodCheckpoint&) = delete;
+        MethodCheckpoint(MethodCheckpoint&&) noexcept = default;
+        // If neither committed nor rolled back, all changes are kept
+        ~MethodCheckpoint() noexcept;
+
+        MethodCheckpoint& operator=(const MethodCheckpoint&) = delete;
+        MethodCheckpoint& operator=(MethodCheckpoint&&) noexcept = delete;
+
+        /*
+         * Keeps all changes made to the method since the creation of the checkpoint
+         */
+        void commit();
+
+        /*
+         * Reverts all instructions and basic blocks to the state at creation of this checkpoint
+         */
+        void rollback();
+
+        /*
+         * Whether this checkpoint was neither committed nor rolled back yet
+         */
+        bool isActive() const noexcept
+        {
+            return active;
+        }
+
+    private:
+        struct BlockState
+        {
+            const Local* label;
+            std::vector<std::unique_ptr<intermediate::IntermediateInstruction>> instructions;
+        };
+
+        Method& method;
+        std::vector<BlockState> blocks;
+        bool active;
     };
 
     using MethodIterator = ScopedInstructionWalker<Method>;
@@ -10,6 +10,7 @@
 #include "GlobalValues.h"
 #include "Method.h"
 #include "SIMDVector.h"
+#include "analysis/ExecutionProfile.h"
 #include "performance.h"
 
 namespace vc4c
@@ -47,6 +48,11 @@ namespace vc4c
          * find a function with the mapped value as name to be inlined.
          */
         FastMap<std::string, std::string> functionAliases;
+        /*
+         * The execution profile of the kernels to guide the optimizations, empty if no profile is used (see
+         * Configuration#profileUseFile)
+         */
+        analysis::ExecutionProfile executionProfile;
 
         const Configuration& compilationConfig;
 
@@ -0,0 +1,1214 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "ModuleSerializer.h"
+
+#include "CompilationError.h"
+#include "InstructionWalker.h"
+#include "MappedFile.h"
+#include "Module.h"
+#include "Profiler.h"
+#include "intermediate/IntermediateInstruction.h"
+#include "spirv/SPIRVBuiltins.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+using namespace vc4c;
+using namespace vc4c::intermediate;
+
+#ifndef VC4C_VERSION
+#define VC4C_VERSION ""
+#endif
+
+static constexpr char MODULE_MAGIC[8] = {'V', 'C', '4', 'C', 'M', 'O', 'D', 'L'};
+// needs to be increased whenever the layout of the serialized data changes
+static constexpr uint32_t MODULE_FORMAT_VERSION = 1;
+
+namespace
+{
+    enum class TypeTag : uint8_t
+    {
+        SIMPLE,
+        COMPLEX
+    };
+
+    enum class ComplexTypeTag : uint8_t
+    {
+        POINTER,
+        STRUCT,
+        ARRAY,
+        IMAGE
+    };
+
+    enum class ValueTag : uint8_t
+    {
+        LITERAL,
+        REGISTER,
+        LOCAL,
+        SMALL_IMMEDIATE,
+        VECTOR,
+        UNDEFINED
+    };
+
+    enum class LocalTag : uint8_t
+    {
+        PLAIN,
+        PARAMETER,
+        STACK_ALLOCATION,
+        BUILTIN,
+        GLOBAL,
+        SPIRV_BUILTIN
+    };
+
+    enum class InstructionTag : uint8_t
+    {
+        OPERATION,
+        INTRINSIC,
+        COMPARISON,
+        METHOD_CALL,
+        RETURN,
+        MOVE,
+        ROTATION,
+        BRANCH,
+        NOP,
+        LOAD_IMMEDIATE,
+        SEMAPHORE,
+        PHI,
+        BARRIER,
+        LIFETIME,
+        MUTEX,
+        MEMORY,
+        COMBINED
+    };
+
+    class BinaryWriter
+    {
+    public:
+        template <typename T>
+        void write(T val)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Can only write trivial values");
+            data.append(reinterpret_cast<const char*>(&val), sizeof(T));
+        }
+
+        void writeString(const std::string& s)
+        {
+            write(static_cast<uint32_t>(s.size()));
+            data.append(s);
+        }
+
+        void append(const BinaryWriter& other)
+        {
+            data.append(other.data);
+        }
+
+        std::string data;
+    };
+
+    class BinaryReader
+    {
+    public:
+        BinaryReader(const char* begin, const char* end) : pos(begin), end(end) {}
+
+        template <typename T>
+        T read()
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Can only read trivial values");
+            T val{};
+            std::memcpy(&val, consume(sizeof(T)), sizeof(T));
+            return val;
+        }
+
+        std::string readString()
+        {
+            auto size = read<uint32_t>();
+            return std::string(consume(size), size);
+        }
+
+        const char* consume(std::size_t numBytes)
+        {
+            if(static_cast<std::size_t>(end - pos) < numBytes)
+                throw CompilationError(CompilationStep::GENERAL, "Unexpected end of serialized module");
+            auto start = pos;
+            pos += numBytes;
+            return start;
+        }
+
+    private:
+        const char* pos;
+        const char* end;
+    };
+
+    /*
+     * The types are referenced by their index in the type table, which is written in front of the module contents.
+     * Since the complex types are only collected while writing the module contents, the contents are written into a
+     * separate buffer first (same for the locals of the single methods).
+     */
+    class ModuleWriter
+    {
+    public:
+        explicit ModuleWriter(const Module& module) : module(module), currentMethod(nullptr) {}
+
+        std::string write();
+
+    private:
+        const Module& module;
+        std::vector<DataType> complexTypes;
+        FastMap<const ComplexType*, uint32_t> complexTypeIndices;
+        FastMap<const Global*, uint32_t> globalIndices;
+        // the locals referenced by the method currently written
+        const Method* currentMethod;
+        std::vector<const Local*> localTable;
+        FastMap<const Local*, uint32_t> localIndices;
+
+        void writeType(BinaryWriter& out, DataType type);
+        void writeComplexType(BinaryWriter& out, DataType type);
+        void writeLiteral(BinaryWriter& out, Literal lit);
+        void writeValue(BinaryWriter& out, const Value& val);
+        void writeConstant(BinaryWriter& out, const CompoundConstant& constant);
+        uint32_t getLocalIndex(const Local* loc);
+        void writeLocal(BinaryWriter& out, const Local* loc);
+        void writeInstruction(BinaryWriter& out, const IntermediateInstruction& inst);
+        void writeMethod(BinaryWriter& out, const Method& method);
+    };
+
+    struct TypeReference
+    {
+        DataType simpleType = TYPE_UNKNOWN;
+        Optional<uint32_t> complexIndex;
+    };
+
+    struct ComplexTypeEntry
+    {
+        ComplexTypeTag tag;
+        std::vector<TypeReference> elementTypes;
+        std::string name;
+        // the additional type-specific values, e.g. address space and alignment for pointers
+        uint32_t firstValue = 0;
+        uint32_t secondValue = 0;
+        std::array<bool, 3> flags{};
+        // the type created for this entry
+        Optional<DataType> type;
+        bool isResolving = false;
+    };
+
+    struct LocalEntry
+    {
+        Local* local;
+        Optional<std::pair<uint32_t, int32_t>> reference;
+    };
+
+    class ModuleReader
+    {
+    public:
+        explicit ModuleReader(Module& module) : module(module) {}
+
+        void read(BinaryReader& in);
+
+    private:
+        Module& module;
+        std::vector<ComplexTypeEntry> complexTypes;
+        std::vector<Global*> globals;
+        std::vector<LocalEntry> locals;
+
+        TypeReference readTypeReference(BinaryReader& in);
+        DataType resolveType(const TypeReference& ref);
+        DataType resolveComplexType(uint32_t index);
+        void readTypes(BinaryReader& in);
+        DataType readType(BinaryReader& in);
+        Literal readLiteral(BinaryReader& in);
+        Value readValue(BinaryReader& in);
+        CompoundConstant readConstant(BinaryReader& in);
+        Global* addGlobal(std::string&& name, DataType type, CompoundConstant&& initialValue, bool isConstant);
+        Local* getLocal(uint32_t index) const;
+        void readLocals(BinaryReader& in, Method& method);
+        IntermediateInstruction* readInstruction(BinaryReader& in);
+        void readMethod(BinaryReader& in);
+    };
+} // namespace
+
+static const ComplexType* toComplexType(DataType type)
+{
+    if(auto ptrType = type.getPointerType())
+        return ptrType;
+    if(auto structType = type.getStructType())
+        return structType;
+    if(auto arrayType = type.getArrayType())
+        return arrayType;
+    if(auto imageType = type.getImageType())
+        return imageType;
+    throw CompilationError(CompilationStep::GENERAL, "Cannot serialize unknown complex type", type.to_string());
+}
+
+std::string ModuleWriter::write()
+{
+    BinaryWriter body;
+    body.write(static_cast<uint32_t>(module.globalData.size()));
+    for(const auto& global : module.globalData)
+    {
+        globalIndices.emplace(&global, static_cast<uint32_t>(globalIndices.size()));
+        body.writeString(global.name);
+        writeType(body, global.type);
+        body.write(static_cast<uint8_t>(global.isConstant));
+        writeConstant(body, global.initialValue);
+    }
+    body.write(static_cast<uint32_t>(module.functionAliases.size()));
+    for(const auto& alias : module.functionAliases)
+    {
+        body.writeString(alias.first);
+        body.writeString(alias.second);
+    }
+    body.write(static_cast<uint32_t>(module.methods.size()));
+    for(const auto& method : module.methods)
+        writeMethod(body, *method);
+
+    // writing the complex types might add new types (e.g. the element types), so check the size on every iteration
+    BinaryWriter types;
+    for(std::size_t i = 0; i < complexTypes.size(); ++i)
+        writeComplexType(types, complexTypes[i]);
+
+    BinaryWriter header;
+    header.data.append(MODULE_MAGIC, sizeof(MODULE_MAGIC));
+    header.write(MODULE_FORMAT_VERSION);
+    header.writeString(VC4C_VERSION);
+    header.write(static_cast<uint32_t>(complexTypes.size()));
+    header.append(types);
+    header.append(body);
+    return std::move(header.data);
+}
+
+void ModuleWriter::writeType(BinaryWriter& out, DataType type)
+{
+    if(type.isSimpleType())
+    {
+        out.write(static_cast<uint8_t>(TypeTag::SIMPLE));
+        // the special types report a different bit-width than the one they are created with
+        uint8_t bitWidth = type.getScalarBitCount();
+        if(type.isVoidType())
+            bitWidth = DataType::VOID;
+        else if(type.isUnknown())
+            bitWidth = DataType::UNKNOWN;
+        else if(type.isLabelType())
+            bitWidth = DataType::LABEL;
+        out.write(bitWidth);
+        out.write(static_cast<uint8_t>(type.getVectorWidth()));
+        out.write(static_cast<uint8_t>(type.isFloatingType()));
+        return;
+    }
+    auto complexType = toComplexType(type);
+    auto it = complexTypeIndices.find(complexType);
+    if(it == complexTypeIndices.end())
+    {
+        it = complexTypeIndices.emplace(complexType, static_cast<uint32_t>(complexTypes.size())).first;
+        complexTypes.push_back(type);
+    }
+    out.write(static_cast<uint8_t>(TypeTag::COMPLEX));
+    out.write(it->second);
+}
+
+void ModuleWriter::writeComplexType(BinaryWriter& out, DataType type)
+{
+    if(auto ptrType = type.getPointerType())
+    {
+        out.write(static_cast<uint8_t>(ComplexTypeTag::POINTER));
+        writeType(out, ptrType->elementType);
+        out.write(static_cast<uint8_t>(ptrType->addressSpace));
+        out.write(static_cast<uint32_t>(ptrType->alignment));
+    }
+    else if(auto structType = type.getStructType())
+    {
+        out.write(static_cast<uint8_t>(ComplexTypeTag::STRUCT));
+        out.writeString(structType->name);
+        out.write(static_cast<uint8_t>(structType->isPacked));
+        out.write(static_cast<uint32_t>(structType->elementTypes.size()));
+        for(auto element : structType->elementTypes)
+            writeType(out, element);
+    }
+    else if(auto arrayType = type.getArrayType())
+    {
+        out.write(static_cast<uint8_t>(ComplexTypeTag::ARRAY));
+        writeType(out, arrayType->elementType);
+        out.write(static_cast<uint32_t>(arrayType->size));
+    }
+    else if(auto imageType = type.getImageType())
+    {
+        out.write(static_cast<uint8_t>(ComplexTypeTag::IMAGE));
+        out.write(static_cast<uint8_t>(imageType->dimensions));
+        out.write(static_cast<uint8_t>(imageType->isImageArray));
+        out.write(static_cast<uint8_t>(imageType->isImageBuffer));
+        out.write(static_cast<uint8_t>(imageType->isSampled));
+    }
+    else
+        throw CompilationError(CompilationStep::GENERAL, "Cannot serialize unknown complex type", type.to_string());
+}
+
+void ModuleWriter::writeLiteral(BinaryWriter& out, Literal lit)
+{
+    out.write(static_cast<uint8_t>(lit.type));
+    out.write(lit.unsignedInt());
+}
+
+void ModuleWriter::writeValue(BinaryWriter& out, const Value& val)
+{
+    if(auto lit = val.checkLiteral())
+    {
+        out.write(static_cast<uint8_t>(ValueTag::LITERAL));
+        writeType(out, val.type);
+        writeLiteral(out, *lit);
+    }
+    else if(auto reg = val.checkRegister())
+    {
+        out.write(static_cast<uint8_t>(ValueTag::REGISTER));
+        writeType(out, val.type);
+        out.write(static_cast<uint8_t>(reg->file));
+        out.write(reg->num);
+    }
+    else if(auto loc = val.checkLocal())
+    {
+        out.write(static_cast<uint8_t>(ValueTag::LOCAL));
+        writeType(out, val.type);
+        out.write(getLocalIndex(loc));
+    }
+    else if(auto imm = val.checkImmediate())
+    {
+        out.write(static_cast<uint8_t>(ValueTag::SMALL_IMMEDIATE));
+        writeType(out, val.type);
+        out.write(imm->value);
+    }
+    else if(auto vec = val.checkVector())
+    {
+        out.write(static_cast<uint8_t>(ValueTag::VECTOR));
+        writeType(out, val.type);
+        for(std::size_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            writeLiteral(out, (*vec)[i]);
+    }
+    else
+    {
+        out.write(static_cast<uint8_t>(ValueTag::UNDEFINED));
+        writeType(out, val.type);
+    }
+}
+
+void ModuleWriter::writeConstant(BinaryWriter& out, const CompoundConstant& constant)
+{
+    writeType(out, constant.type);
+    if(auto lit = constant.getScalar())
+    {
+        out.write(static_cast<uint8_t>(true));
+        writeLiteral(out, *lit);
+        return;
+    }
+    out.write(static_cast<uint8_t>(false));
+    auto elements = constant.getCompound().value();
+    out.write(static_cast<uint32_t>(elements.size()));
+    for(const auto& element : elements)
+        writeConstant(out, element);
+}
+
+uint32_t ModuleWriter::getLocalIndex(const Local* loc)
+{
+    auto it = localIndices.find(loc);
+    if(it != localIndices.end())
+        return it->second;
+    auto index = static_cast<uint32_t>(localTable.size());
+    localIndices.emplace(loc, index);
+    localTable.push_back(loc);
+    return index;
+}
+
+void ModuleWriter::writeLocal(BinaryWriter& out, const Local* loc)
+{
+    if(auto param = loc->as<Parameter>())
+    {
+        auto index = static_cast<std::size_t>(param - currentMethod->parameters.data());
+        if(index >= currentMethod->parameters.size())
+            throw CompilationError(
+                CompilationStep::GENERAL, "Cannot serialize parameter of another function", loc->to_string());
+        out.write(static_cast<uint8_t>(LocalTag::PARAMETER));
+        out.write(static_cast<uint32_t>(index));
+    }
+    else if(loc->is<StackAllocation>())
+    {
+        out.write(static_cast<uint8_t>(LocalTag::STACK_ALLOCATION));
+        out.writeString(loc->name);
+    }
+    else if(auto builtin = loc->as<BuiltinLocal>())
+    {
+        out.write(static_cast<uint8_t>(LocalTag::BUILTIN));
+        out.write(static_cast<uint8_t>(builtin->builtinType));
+    }
+    else if(auto global = loc->as<Global>())
+    {
+        auto it = globalIndices.find(global);
+        if(it == globalIndices.end())
+            throw CompilationError(
+                CompilationStep::GENERAL, "Cannot serialize global not contained in the module", loc->to_string());
+        out.write(static_cast<uint8_t>(LocalTag::GLOBAL));
+        out.write(it->second);
+    }
+#ifdef SPIRV_FRONTEND
+    else if(loc->is<spirv::SPIRVBuiltin>())
+    {
+        out.write(static_cast<uint8_t>(LocalTag::SPIRV_BUILTIN));
+        out.writeString(loc->name);
+    }
+#endif
+    else
+    {
+        out.write(static_cast<uint8_t>(LocalTag::PLAIN));
+        writeType(out, loc->type);
+        out.writeString(loc->name);
+    }
+
+    // the lower and upper parts of 64-bit locals are automatically created when the local is read back in
+    if(auto ref = loc->get<ReferenceData>())
+    {
+        out.write(static_cast<uint8_t>(true));
+        out.write(getLocalIndex(ref->base));
+        out.write(static_cast<int32_t>(ref->offset));
+    }
+    else
+        out.write(static_cast<uint8_t>(false));
+}
+
+void ModuleWriter::writeInstruction(BinaryWriter& out, const IntermediateInstruction& inst)
+{
+    // the type-specific data is written after the common data of all instructions
+    BinaryWriter extra;
+    InstructionTag tag;
+    if(auto op = dynamic_cast<const Operation*>(&inst))
+    {
+        tag = InstructionTag::OPERATION;
+        extra.writeString(op->op.name);
+    }
+    else if(auto comp = dynamic_cast<const Comparison*>(&inst))
+    {
+        tag = InstructionTag::COMPARISON;
+        extra.writeString(comp->opCode);
+    }
+    else if(auto intrinsic = dynamic_cast<const IntrinsicOperation*>(&inst))
+    {
+        tag = InstructionTag::INTRINSIC;
+        extra.writeString(intrinsic->opCode);
+    }
+    else if(auto call = dynamic_cast<const MethodCall*>(&inst))
+    {
+        tag = InstructionTag::METHOD_CALL;
+        extra.writeString(call->methodName);
+    }
+    else if(dynamic_cast<const Return*>(&inst))
+        tag = InstructionTag::RETURN;
+    else if(auto rotation = dynamic_cast<const VectorRotation*>(&inst))
+    {
+        tag = InstructionTag::ROTATION;
+        extra.write(static_cast<uint8_t>(rotation->type));
+    }
+    else if(dynamic_cast<const MoveOperation*>(&inst))
+        tag = InstructionTag::MOVE;
+    else if(auto branch = dynamic_cast<const Branch*>(&inst))
+    {
+        tag = InstructionTag::BRANCH;
+        extra.write(branch->branchCondition.value);
+    }
+    else if(auto nop = dynamic_cast<const Nop*>(&inst))
+    {
+        tag = InstructionTag::NOP;
+        extra.write(static_cast<uint8_t>(nop->type));
+    }
+    else if(auto load = dynamic_cast<const LoadImmediate*>(&inst))
+    {
+        tag = InstructionTag::LOAD_IMMEDIATE;
+        extra.write(static_cast<uint8_t>(load->type));
+    }
+    else if(auto semaphore = dynamic_cast<const SemaphoreAdjustment*>(&inst))
+    {
+        tag = InstructionTag::SEMAPHORE;
+        extra.write(static_cast<uint8_t>(semaphore->semaphore));
+        extra.write(static_cast<uint8_t>(semaphore->increase));
+    }
+    else if(dynamic_cast<const PhiNode*>(&inst))
+        tag = InstructionTag::PHI;
+    else if(auto barrier = dynamic_cast<const MemoryBarrier*>(&inst))
+    {
+        tag = InstructionTag::BARRIER;
+        extra.write(static_cast<uint8_t>(barrier->scope));
+        extra.write(static_cast<uint16_t>(barrier->semantics));
+    }
+    else if(auto lifetime = dynamic_cast<const LifetimeBoundary*>(&inst))
+    {
+        tag = InstructionTag::LIFETIME;
+        extra.write(static_cast<uint8_t>(lifetime->isLifetimeEnd));
+    }
+    else if(auto mutex = dynamic_cast<const MutexLock*>(&inst))
+    {
+        tag = InstructionTag::MUTEX;
+        extra.write(static_cast<uint8_t>(mutex->locksMutex()));
+    }
+    else if(auto mem = dynamic_cast<const MemoryInstruction*>(&inst))
+    {
+        tag = InstructionTag::MEMORY;
+        extra.write(static_cast<uint8_t>(mem->op));
+        extra.write(static_cast<uint8_t>(mem->guardAccess));
+    }
+    else if(auto combined = dynamic_cast<const CombinedOperation*>(&inst))
+    {
+        tag = InstructionTag::COMBINED;
+        writeInstruction(extra, *combined->op1);
+        writeInstruction(extra, *combined->op2);
+    }
+    else
+        throw CompilationError(CompilationStep::GENERAL, "Cannot serialize instruction", inst.to_string());
+
+    out.write(static_cast<uint8_t>(tag));
+    out.write(static_cast<uint32_t>(inst.decoration));
+    out.write(inst.getSignal().value);
+    auto unpacking = dynamic_cast<const UnpackingInstruction*>(&inst);
+    out.write((unpacking ? unpacking->getUnpackMode() : UNPACK_NOP).value);
+    auto extended = dynamic_cast<const ExtendedInstruction*>(&inst);
+    out.write((extended ? extended->getPackMode() : PACK_NOP).value);
+    out.write((extended ? extended->getCondition() : COND_ALWAYS).value);
+    out.write(static_cast<uint8_t>(inst.getFlags()));
+    out.write(static_cast<uint8_t>(inst.getOutput().has_value()));
+    if(auto output = inst.getOutput())
+        writeValue(out, *output);
+    out.write(static_cast<uint32_t>(inst.getArguments().size()));
+    for(const auto& arg : inst.getArguments())
+        writeValue(out, arg);
+    out.append(extra);
+}
+
+void ModuleWriter::writeMethod(BinaryWriter& out, const Method& method)
+{
+    currentMethod = &method;
+    localTable.clear();
+    localIndices.clear();
+
+    out.writeString(method.name);
+    out.write(static_cast<uint8_t>(method.isKernel));
+    writeType(out, method.returnType);
+    out.write(static_cast<uint32_t>(method.parameters.size()));
+    for(const auto& param : method.parameters)
+    {
+        out.writeString(param.name);
+        writeType(out, param.type);
+        out.write(static_cast<uint8_t>(param.decorations));
+        out.write(static_cast<uint64_t>(param.maxByteOffset));
+        out.writeString(param.parameterName);
+        out.writeString(param.origTypeName);
+        out.write(static_cast<uint8_t>(param.isLowered));
+    }
+    out.write(static_cast<uint32_t>(method.stackAllocations.size()));
+    for(const auto& alloc : method.stackAllocations)
+    {
+        out.writeString(alloc.name);
+        writeType(out, alloc.type);
+        out.write(static_cast<uint64_t>(alloc.size));
+        out.write(static_cast<uint64_t>(alloc.alignment));
+        out.write(static_cast<uint64_t>(alloc.offset));
+        out.write(static_cast<uint8_t>(alloc.isLowered));
+    }
+    out.write(method.metaData.uniformsUsed.value);
+    for(auto size : method.metaData.workGroupSizes)
+        out.write(size);
+    for(auto size : method.metaData.workGroupSizeHints)
+        out.write(size);
+
+    BinaryWriter code;
+    code.write(static_cast<uint32_t>(std::distance(method.begin(), method.end())));
+    for(const auto& block : method)
+    {
+        code.write(getLocalIndex(block.getLabel()->getLabel()));
+        code.write(static_cast<uint32_t>(block.getLabel()->decoration));
+        BinaryWriter instructions;
+        uint32_t numInstructions = 0;
+        // skip the label, which is recreated together with the block
+        for(auto it = std::next(block.begin()); it != block.end(); ++it)
+        {
+            if(!*it)
+                continue;
+            writeInstruction(instructions, **it);
+            ++numInstructions;
+        }
+        code.write(numInstructions);
+        code.append(instructions);
+    }
+
+    // the locals are written in front of the instructions, so they are known when the instructions are read back in.
+    // Since writing a local can reference further locals (e.g. the base of a reference), check the size every time
+    BinaryWriter localData;
+    for(std::size_t i = 0; i < localTable.size(); ++i)
+        writeLocal(localData, localTable[i]);
+    out.write(static_cast<uint32_t>(localTable.size()));
+    out.append(localData);
+    out.append(code);
+    currentMethod = nullptr;
+}
+
+void ModuleReader::read(BinaryReader& in)
+{
+    if(std::memcmp(in.consume(sizeof(MODULE_MAGIC)), MODULE_MAGIC, sizeof(MODULE_MAGIC)) != 0)
+        throw CompilationError(CompilationStep::GENERAL, "Input is not a serialized module");
+    auto formatVersion = in.read<uint32_t>();
+    if(formatVersion != MODULE_FORMAT_VERSION)
+        throw CompilationError(CompilationStep::GENERAL, "Unsupported version of serialized module format",
+            std::to_string(formatVersion));
+    auto compilerVersion = in.readString();
+    if(compilerVersion != VC4C_VERSION)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Serialized module was written by another compiler version", compilerVersion);
+
+    readTypes(in);
+
+    auto numGlobals = in.read<uint32_t>();
+    globals.reserve(numGlobals);
+    for(uint32_t i = 0; i < numGlobals; ++i)
+    {
+        auto name = in.readString();
+        auto type = readType(in);
+        auto isConstant = in.read<uint8_t>() != 0;
+        globals.push_back(addGlobal(std::move(name), type, readConstant(in), isConstant));
+    }
+    auto numAliases = in.read<uint32_t>();
+    for(uint32_t i = 0; i < numAliases; ++i)
+    {
+        auto alias = in.readString();
+        module.functionAliases.emplace(alias, in.readString());
+    }
+    auto numMethods = in.read<uint32_t>();
+    for(uint32_t i = 0; i < numMethods; ++i)
+        readMethod(in);
+}
+
+TypeReference ModuleReader::readTypeReference(BinaryReader& in)
+{
+    TypeReference ref;
+    auto tag = static_cast<TypeTag>(in.read<uint8_t>());
+    if(tag == TypeTag::COMPLEX)
+        ref.complexIndex = in.read<uint32_t>();
+    else if(tag == TypeTag::SIMPLE)
+    {
+        auto bitWidth = in.read<uint8_t>();
+        auto vectorWidth = in.read<uint8_t>();
+        auto isFloat = in.read<uint8_t>() != 0;
+        ref.simpleType = DataType(bitWidth, vectorWidth, isFloat);
+    }
+    else
+        throw CompilationError(CompilationStep::GENERAL, "Invalid type in serialized module");
+    return ref;
+}
+
+DataType ModuleReader::resolveType(const TypeReference& ref)
+{
+    return ref.complexIndex ? resolveComplexType(*ref.complexIndex) : ref.simpleType;
+}
+
+DataType ModuleReader::resolveComplexType(uint32_t index)
+{
+    if(index >= complexTypes.size())
+        throw CompilationError(CompilationStep::GENERAL, "Invalid type index in serialized module");
+    auto& entry = complexTypes[index];
+    if(entry.type)
+        return *entry.type;
+    // any recursive type needs to contain a struct somewhere, which are already created empty
+    if(entry.isResolving)
+        throw CompilationError(CompilationStep::GENERAL, "Cyclic type definition in serialized module");
+    entry.isResolving = true;
+    switch(entry.tag)
+    {
+    case ComplexTypeTag::POINTER:
+        entry.type = DataType(module.createPointerType(
+            resolveType(entry.elementTypes.at(0)), static_cast<AddressSpace>(entry.firstValue), entry.secondValue));
+        break;
+    case ComplexTypeTag::ARRAY:
+        entry.type = DataType(module.createArrayType(resolveType(entry.elementTypes.at(0)), entry.firstValue));
+        break;
+    case ComplexTypeTag::IMAGE:
+        entry.type = DataType(module.createImageType(
+            static_cast<uint8_t>(entry.firstValue), entry.flags[0], entry.flags[1], entry.flags[2]));
+        break;
+    case ComplexTypeTag::STRUCT:
+        throw CompilationError(CompilationStep::GENERAL, "Struct type was not created in advance", entry.name);
+    }
+    return *entry.type;
+}
+
+void ModuleReader::readTypes(BinaryReader& in)
+{
+    auto numTypes = in.read<uint32_t>();
+    complexTypes.resize(numTypes);
+    for(auto& entry : complexTypes)
+    {
+        entry.tag = static_cast<ComplexTypeTag>(in.read<uint8_t>());
+        switch(entry.tag)
+        {
+        case ComplexTypeTag::POINTER:
+            entry.elementTypes.push_back(readTypeReference(in));
+            entry.firstValue = in.read<uint8_t>();
+            entry.secondValue = in.read<uint32_t>();
+            break;
+        case ComplexTypeTag::STRUCT:
+        {
+            entry.name = in.readString();
+            entry.flags[0] = in.read<uint8_t>() != 0;
+            auto numElements = in.read<uint32_t>();
+            for(uint32_t i = 0; i < numElements; ++i)
+                entry.elementTypes.push_back(readTypeReference(in));
+            break;
+        }
+        case ComplexTypeTag::ARRAY:
+            entry.elementTypes.push_back(readTypeReference(in));
+            entry.firstValue = in.read<uint32_t>();
+            break;
+        case ComplexTypeTag::IMAGE:
+            entry.firstValue = in.read<uint8_t>();
+            entry.flags[0] = in.read<uint8_t>() != 0;
+            entry.flags[1] = in.read<uint8_t>() != 0;
+            entry.flags[2] = in.read<uint8_t>() != 0;
+            break;
+        default:
+            throw CompilationError(CompilationStep::GENERAL, "Invalid complex type in serialized module");
+        }
+    }
+
+    // Similar to the front-ends, the struct types are created empty first, since their elements can refer back to
+    // the struct itself (e.g. via pointers)
+    for(auto& entry : complexTypes)
+    {
+        if(entry.tag == ComplexTypeTag::STRUCT)
+            entry.type = DataType(module.createStructType(entry.name, {}, entry.flags[0]));
+    }
+    for(uint32_t i = 0; i < complexTypes.size(); ++i)
+        resolveComplexType(i);
+    for(auto& entry : complexTypes)
+    {
+        if(entry.tag != ComplexTypeTag::STRUCT)
+            continue;
+        auto structType = const_cast<StructType*>(entry.type->getStructType());
+        for(const auto& element : entry.elementTypes)
+            structType->elementTypes.push_back(resolveType(element));
+    }
+}
+
+DataType ModuleReader::readType(BinaryReader& in)
+{
+    return resolveType(readTypeReference(in));
+}
+
+Literal ModuleReader::readLiteral(BinaryReader& in)
+{
+    auto type = static_cast<LiteralType>(in.read<uint8_t>());
+    Literal lit(in.read<uint32_t>());
+    lit.type = type;
+    return lit;
+}
+
+Value ModuleReader::readValue(BinaryReader& in)
+{
+    auto tag = static_cast<ValueTag>(in.read<uint8_t>());
+    auto type = readType(in);
+    switch(tag)
+    {
+    case ValueTag::LITERAL:
+        return Value(readLiteral(in), type);
+    case ValueTag::REGISTER:
+    {
+        auto file = static_cast<RegisterFile>(in.read<uint8_t>());
+        return Value(Register(file, in.read<uint8_t>()), type);
+    }
+    case ValueTag::LOCAL:
+        return Value(getLocal(in.read<uint32_t>()), type);
+    case ValueTag::SMALL_IMMEDIATE:
+        return Value(SmallImmediate(in.read<uint8_t>()), type);
+    case ValueTag::VECTOR:
+    {
+        SIMDVector vector;
+        for(std::size_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            vector[i] = readLiteral(in);
+        return module.storeVector(std::move(vector), type);
+    }
+    case ValueTag::UNDEFINED:
+        return Value(type);
+    }
+    throw CompilationError(CompilationStep::GENERAL, "Invalid value in serialized module");
+}
+
+CompoundConstant ModuleReader::readConstant(BinaryReader& in)
+{
+    auto type = readType(in);
+    if(in.read<uint8_t>() != 0)
+        return CompoundConstant(type, readLiteral(in));
+    auto numElements = in.read<uint32_t>();
+    std::vector<CompoundConstant> elements;
+    elements.reserve(numElements);
+    for(uint32_t i = 0; i < numElements; ++i)
+        elements.emplace_back(readConstant(in));
+    return CompoundConstant(type, std::move(elements));
+}
+
+Global* ModuleReader::addGlobal(
+    std::string&& name, DataType type, CompoundConstant&& initialValue, bool isConstant)
+{
+    if(auto existing = const_cast<Global*>(module.findGlobal(name)))
+    {
+        // the same global can be defined by multiple linked modules, e.g. a constant declared in a shared header
+        if(existing->type == type && existing->isConstant == isConstant &&
+            existing->initialValue.to_string(true) == initialValue.to_string(true))
+            return existing;
+        if(!isConstant || !existing->isConstant)
+            throw CompilationError(CompilationStep::LINKER, "Conflicting definitions of global", name);
+        // different constants of the same name (e.g. string literals named by the front-end) are only accessed by the
+        // kernels of their own module, so they can be kept apart
+        auto baseName = name;
+        for(std::size_t i = 1; module.findGlobal(name); ++i)
+            name = baseName + "." + std::to_string(i);
+    }
+    module.globalData.emplace_back(name, type, std::move(initialValue), isConstant);
+    return &module.globalData.back();
+}
+
+Local* ModuleReader::getLocal(uint32_t index) const
+{
+    if(index >= locals.size())
+        throw CompilationError(CompilationStep::GENERAL, "Invalid local index in serialized module");
+    return locals[index].local;
+}
+
+void ModuleReader::readLocals(BinaryReader& in, Method& method)
+{
+    locals.clear();
+    auto numLocals = in.read<uint32_t>();
+    locals.reserve(numLocals);
+    for(uint32_t i = 0; i < numLocals; ++i)
+    {
+        LocalEntry entry{nullptr, {}};
+        switch(static_cast<LocalTag>(in.read<uint8_t>()))
+        {
+        case LocalTag::PLAIN:
+        {
+            auto type = readType(in);
+            entry.local = const_cast<Local*>(method.createLocal(type, in.readString()));
+            break;
+        }
+        case LocalTag::PARAMETER:
+        {
+            auto index = in.read<uint32_t>();
+            if(index >= method.parameters.size())
+                throw CompilationError(CompilationStep::GENERAL, "Invalid parameter index in serialized module");
+            entry.local = &method.parameters[index];
+            break;
+        }
+        case LocalTag::STACK_ALLOCATION:
+        {
+            auto name = in.readString();
+            entry.local = const_cast<StackAllocation*>(method.findStackAllocation(name));
+            if(!entry.local)
+                throw CompilationError(CompilationStep::GENERAL, "Unknown stack allocation in serialized module", name);
+            break;
+        }
+        case LocalTag::BUILTIN:
+            entry.local =
+                const_cast<BuiltinLocal*>(method.findOrCreateBuiltin(static_cast<BuiltinLocal::Type>(in.read<uint8_t>())));
+            break;
+        case LocalTag::GLOBAL:
+        {
+            auto index = in.read<uint32_t>();
+            if(index >= globals.size())
+                throw CompilationError(CompilationStep::GENERAL, "Invalid global index in serialized module");
+            entry.local = globals[index];
+            break;
+        }
+        case LocalTag::SPIRV_BUILTIN:
+        {
+            auto name = in.readString();
+#ifdef SPIRV_FRONTEND
+            entry.local = spirv::findBuiltin(name);
+#endif
+            if(!entry.local)
+                throw CompilationError(CompilationStep::GENERAL, "Unknown SPIR-V built-in in serialized module", name);
+            break;
+        }
+        default:
+            throw CompilationError(CompilationStep::GENERAL, "Invalid local in serialized module");
+        }
+        if(in.read<uint8_t>() != 0)
+        {
+            auto base = in.read<uint32_t>();
+            entry.reference = std::make_pair(base, in.read<int32_t>());
+        }
+        locals.push_back(entry);
+    }
+    // the references can only be resolved after all locals are created
+    for(auto& entry : locals)
+    {
+        if(entry.reference)
+            entry.local->set(ReferenceData(*getLocal(entry.reference->first), entry.reference->second));
+    }
+}
+
+IntermediateInstruction* ModuleReader::readInstruction(BinaryReader& in)
+{
+    auto tag = static_cast<InstructionTag>(in.read<uint8_t>());
+    auto decorations = static_cast<InstructionDecorations>(in.read<uint32_t>());
+    Signaling signal(in.read<uint8_t>());
+    Unpack unpackMode(in.read<uint8_t>());
+    Pack packMode(in.read<uint8_t>());
+    ConditionCode condition(in.read<uint8_t>());
+    auto setFlags = static_cast<SetFlag>(in.read<uint8_t>());
+    Optional<Value> output;
+    if(in.read<uint8_t>() != 0)
+        output = readValue(in);
+    std::vector<Value> args;
+    auto numArgs = in.read<uint32_t>();
+    args.reserve(numArgs);
+    for(uint32_t i = 0; i < numArgs; ++i)
+        args.emplace_back(readValue(in));
+
+    auto getOutput = [&]() -> Value {
+        if(!output)
+            throw CompilationError(CompilationStep::GENERAL, "Missing output of serialized instruction");
+        return *output;
+    };
+    auto getArg = [&](std::size_t index) -> Value {
+        if(index >= args.size())
+            throw CompilationError(CompilationStep::GENERAL, "Missing argument of serialized instruction");
+        return args[index];
+    };
+    auto getLabel = [&](std::size_t index) -> const Local* {
+        auto label = getArg(index).checkLocal();
+        if(!label)
+            throw CompilationError(CompilationStep::GENERAL, "Missing label of serialized instruction");
+        return label;
+    };
+
+    std::unique_ptr<IntermediateInstruction> inst;
+    switch(tag)
+    {
+    case InstructionTag::OPERATION:
+    {
+        const auto& opCode = OpCode::toOpCode(in.readString());
+        if(args.size() == 1)
+            inst.reset(new Operation(opCode, getOutput(), getArg(0)));
+        else
+            inst.reset(new Operation(opCode, getOutput(), getArg(0), getArg(1)));
+        break;
+    }
+    case InstructionTag::INTRINSIC:
+        if(args.size() == 1)
+            inst.reset(new IntrinsicOperation(in.readString(), getOutput(), getArg(0)));
+        else
+            inst.reset(new IntrinsicOperation(in.readString(), getOutput(), getArg(0), getArg(1)));
+        break;
+    case InstructionTag::COMPARISON:
+        inst.reset(new Comparison(in.readString(), getOutput(), getArg(0), getArg(1)));
+        break;
+    case InstructionTag::METHOD_CALL:
+        if(output)
+            inst.reset(new MethodCall(getOutput(), in.readString(), std::move(args)));
+        else
+            inst.reset(new MethodCall(in.readString(), std::move(args)));
+        break;
+    case InstructionTag::RETURN:
+        if(args.empty())
+            inst.reset(new Return());
+        else
+            inst.reset(new Return(getArg(0)));
+        break;
+    case InstructionTag::MOVE:
+        inst.reset(new MoveOperation(getOutput(), getArg(0)));
+        break;
+    case InstructionTag::ROTATION:
+    {
+        auto type = static_cast<RotationType>(in.read<uint8_t>());
+        auto offset = getArg(1);
+        if(offset != ROTATION_REGISTER && !offset.checkImmediate())
+            throw CompilationError(CompilationStep::GENERAL, "Invalid offset of serialized vector rotation");
+        inst.reset(new VectorRotation(getOutput(), getArg(0),
+            offset == ROTATION_REGISTER ? VECTOR_ROTATE_R5 : *offset.checkImmediate(), type));
+        break;
+    }
+    case InstructionTag::BRANCH:
+        inst.reset(new Branch(getLabel(0), BranchCond(in.read<uint8_t>())));
+        break;
+    case InstructionTag::NOP:
+        inst.reset(new Nop(static_cast<DelayType>(in.read<uint8_t>()), signal));
+        break;
+    case InstructionTag::LOAD_IMMEDIATE:
+        inst.reset(new LoadImmediate(getOutput(), 0u, static_cast<LoadType>(in.read<uint8_t>())));
+        // for all load types, the loaded value is stored in the first argument
+        inst->setArgument(0, getArg(0));
+        break;
+    case InstructionTag::SEMAPHORE:
+    {
+        auto semaphore = static_cast<Semaphore>(in.read<uint8_t>());
+        inst.reset(new SemaphoreAdjustment(semaphore, in.read<uint8_t>() != 0));
+        break;
+    }
+    case InstructionTag::PHI:
+    {
+        std::vector<std::pair<Value, const Local*>> labelPairs;
+        for(std::size_t i = 0; i + 1 < args.size(); i += 2)
+            labelPairs.emplace_back(getArg(i + 1), getLabel(i));
+        inst.reset(new PhiNode(getOutput(), std::move(labelPairs)));
+        break;
+    }
+    case InstructionTag::BARRIER:
+    {
+        auto scope = static_cast<MemoryScope>(in.read<uint8_t>());
+        inst.reset(new MemoryBarrier(scope, static_cast<MemorySemantics>(in.read<uint16_t>())));
+        break;
+    }
+    case InstructionTag::LIFETIME:
+        inst.reset(new LifetimeBoundary(getArg(0), in.read<uint8_t>() != 0));
+        break;
+    case InstructionTag::MUTEX:
+        inst.reset(new MutexLock(in.read<uint8_t>() != 0 ? MutexAccess::LOCK : MutexAccess::RELEASE));
+        break;
+    case InstructionTag::MEMORY:
+    {
+        auto op = static_cast<MemoryOperation>(in.read<uint8_t>());
+        inst.reset(new MemoryInstruction(op, getOutput(), getArg(0), getArg(1), in.read<uint8_t>() != 0));
+        break;
+    }
+    case InstructionTag::COMBINED:
+    {
+        std::unique_ptr<IntermediateInstruction> first(readInstruction(in));
+        std::unique_ptr<IntermediateInstruction> second(readInstruction(in));
+        auto firstOp = dynamic_cast<Operation*>(first.get());
+        auto secondOp = dynamic_cast<Operation*>(second.get());
+        if(!firstOp || !secondOp)
+            throw CompilationError(CompilationStep::GENERAL, "Invalid parts of serialized combined operation");
+        first.release();
+        second.release();
+        inst.reset(new CombinedOperation(firstOp, secondOp));
+        break;
+    }
+    default:
+        throw CompilationError(CompilationStep::GENERAL, "Invalid instruction in serialized module");
+    }
+
+    inst->decoration = decorations;
+    if(auto signaling = dynamic_cast<SignalingInstruction*>(inst.get()))
+        signaling->setSignaling(signal);
+    if(auto extended = dynamic_cast<ExtendedInstruction*>(inst.get()))
+    {
+        extended->setPackMode(packMode);
+        extended->setCondition(condition);
+        extended->setSetFlags(setFlags);
+    }
+    if(auto unpacking = dynamic_cast<UnpackingInstruction*>(inst.get()))
+        unpacking->setUnpackMode(unpackMode);
+    return inst.release();
+}
+
+void ModuleReader::readMethod(BinaryReader& in)
+{
+    auto name = in.readString();
+    if(std::any_of(module.methods.begin(), module.methods.end(),
+           [&](const std::unique_ptr<Method>& method) -> bool { return method->name == name; }))
+        throw CompilationError(CompilationStep::LINKER, "Function is defined by multiple linked modules", name);
+    module.methods.emplace_back(new Method(module));
+    auto& method = *module.methods.back();
+    method.name = std::move(name);
+    method.isKernel = in.read<uint8_t>() != 0;
+    method.returnType = readType(in);
+    auto numParameters = in.read<uint32_t>();
+    method.parameters.reserve(numParameters);
+    for(uint32_t i = 0; i < numParameters; ++i)
+    {
+        auto name = in.readString();
+        auto type = readType(in);
+        Parameter param(name, type, static_cast<ParameterDecorations>(in.read<uint8_t>()));
+        param.maxByteOffset = static_cast<std::size_t>(in.read<uint64_t>());
+        param.parameterName = in.readString();
+        param.origTypeName = in.readString();
+        param.isLowered = in.read<uint8_t>() != 0;
+        method.addParameter(std::move(param));
+    }
+    auto numAllocations = in.read<uint32_t>();
+    for(uint32_t i = 0; i < numAllocations; ++i)
+    {
+        auto name = in.readString();
+        auto type = readType(in);
+        auto size = static_cast<std::size_t>(in.read<uint64_t>());
+        auto alignment = static_cast<std::size_t>(in.read<uint64_t>());
+        StackAllocation alloc(name, type, size, alignment);
+        alloc.offset = static_cast<std::size_t>(in.read<uint64_t>());
+        alloc.isLowered = in.read<uint8_t>() != 0;
+        method.stackAllocations.emplace(std::move(alloc));
+    }
+    method.metaData.uniformsUsed.value = in.read<uint64_t>();
+    for(auto& size : method.metaData.workGroupSizes)
+        size = in.read<uint32_t>();
+    for(auto& size : method.metaData.workGroupSizeHints)
+        size = in.read<uint32_t>();
+
+    readLocals(in, method);
+
+    auto numBlocks = in.read<uint32_t>();
+    for(uint32_t i = 0; i < numBlocks; ++i)
+    {
+        auto label = getLocal(in.read<uint32_t>());
+        auto& block = method.createAndInsertNewBlock(method.end(), label->name);
+        block.getLabel()->decoration = static_cast<InstructionDecorations>(in.read<uint32_t>());
+        auto numInstructions = in.read<uint32_t>();
+        auto it = block.walkEnd();
+        for(uint32_t j = 0; j < numInstructions; ++j)
+            it.emplace(readInstruction(in)).nextInBlock();
+    }
+}
+
+std::size_t vc4c::serializeModule(const Module& module, std::ostream& output)
+{
+    PROFILE_START(SerializeModule);
+    ModuleWriter writer(module);
+    auto data = writer.write();
+    output.write(data.data(), static_cast<std::streamsize>(data.size()));
+    PROFILE_END(SerializeModule);
+    return data.size();
+}
+
+void vc4c::deserializeModule(Module& module, std::istream& input)
+{
+    PROFILE_START(DeserializeModule);
+    std::string buffer;
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    if(auto mappedFile = getMappedBuffer(input))
+    {
+        // no need to copy the data, directly read the mapped file contents
+        begin = mappedFile->data();
+        end = begin + mappedFile->size();
+    }
+    else
+    {
+        buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        begin = buffer.data();
+        end = begin + buffer.size();
+    }
+    BinaryReader in(begin, end);
+    ModuleReader reader(module);
+    reader.read(in);
+    PROFILE_END(DeserializeModule);
+}
+
+bool vc4c::isSerializedModule(std::istream& input)
+{
+    if(auto mappedFile = getMappedBuffer(input))
+        return mappedFile->size() >= sizeof(MODULE_MAGIC) &&
+            std::memcmp(mappedFile->data(), MODULE_MAGIC, sizeof(MODULE_MAGIC)) == 0;
+    std::array<char, sizeof(MODULE_MAGIC)> buffer{};
+    auto pos = input.tellg();
+    input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    auto numBytes = static_cast<std::size_t>(input.gcount());
+    // reset flags (e.g. if we were at the end of the file) and stream position
+    input.clear();
+    input.seekg(pos);
+    return numBytes == sizeof(MODULE_MAGIC) && std::memcmp(buffer.data(), MODULE_MAGIC, sizeof(MODULE_MAGIC)) == 0;
+}
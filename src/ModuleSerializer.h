@@ -0,0 +1,60 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+#ifndef VC4C_MODULE_SERIALIZER_H
+#define VC4C_MODULE_SERIALIZER_H
+
+#include <cstddef>
+#include <iostream>
+
+namespace vc4c
+{
+    class Module;
+
+    /*
+     * Writes the given module in a compact, versioned binary format.
+     *
+     * The serialized module contains all types, globals and methods (including their parameters, stack allocations,
+     * locals and instructions), so it can be read back in by #deserializeModule() instead of running the
+     * pre-compilation, the front-ends and the module-wide normalization again, e.g. when compiling the same input
+     * with different optimization settings.
+     *
+     * Since the globals are only referenced by name and no memory layout is assigned yet, the serialized module can
+     * be used as relocatable object, which is linked with other serialized modules by deserializing them into the
+     * same module (see #deserializeModule()).
+     *
+     * NOTE: The data is written in host byte order and only contains the state required for the module-wide
+     * preparation steps onwards (see Normalizer#prepareModule()). It is therefore only meant to be read back in by
+     * the same version of the compiler on the same machine.
+     *
+     * Returns the number of bytes written
+     */
+    std::size_t serializeModule(const Module& module, std::ostream& output);
+
+    /*
+     * Reads the module serialized by #serializeModule() from the given input stream into the module.
+     *
+     * If the module is not empty (e.g. another serialized module was already read into it), the contents are linked
+     * into the existing module:
+     * - globals with the same name, type and initial value are merged into a single global
+     * - constant globals with the same name but different contents are kept apart by renaming the new global
+     * - any other globals with the same name as well as functions defined in both modules are rejected
+     *
+     * If the input is backed by a memory-mapped file (see MappedFileStream), the data is directly read from the
+     * mapped file without copying it into an intermediate buffer.
+     *
+     * Throws a CompilationError, if the data is not a valid serialized module, was written by another version or
+     * cannot be linked into the module.
+     */
+    void deserializeModule(Module& module, std::istream& input);
+
+    /*
+     * Checks whether the given stream contains a serialized module, without consuming any input
+     */
+    bool isSerializedModule(std::istream& input);
+
+} /* namespace vc4c */
+
+#endif /* VC4C_MODULE_SERIALIZER_H */
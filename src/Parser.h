@@ -23,6 +23,18 @@ namespace vc4c
          * input.
          */
         virtual void parse(Module& module) = 0;
+
+        /*
+         * Parses only the declarations of the kernels (signature and meta-data) of the currently set input and
+         * populates the module given with the kernels without their bodies.
+         *
+         * This is used to retrieve the kernel information without running the whole compilation, the default
+         * implementation parses the whole input.
+         */
+        virtual void parseDeclarations(Module& module)
+        {
+            parse(module);
+        }
     };
 } // namespace vc4c
 
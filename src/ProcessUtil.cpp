@@ -7,48 +7,75 @@
 #include "ProcessUtil.h"
 
 #include "CompilationError.h"
+#include "MappedFile.h"
 #include "Profiler.h"
 #include "log.h"
 
 #include <array>
-#include <chrono>
-#include <cstdio>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
 #include <sstream>
-#include <sys/select.h>
-#include <sys/time.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
-#include <thread>
 #include <unistd.h>
 #include <vector>
 
 using namespace vc4c;
 
-static constexpr int STD_IN = 0;
-static constexpr int STD_OUT = 1;
-static constexpr int STD_ERR = 2;
+extern char** environ;
 
 static constexpr int READ = 0;
 static constexpr int WRITE = 1;
 
-static constexpr int BUFFER_SIZE = 1024;
+// large buffers reduce the number of system calls for the typically multiple MB big modules
+static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
 
-static void initPipe(std::array<int, 2>& fds)
+/*
+ * Wrapper around a pipe, which closes the pipe ends not yet closed on destruction (e.g. on errors)
+ */
+struct Pipe
 {
-    if(pipe(fds.data()) != 0)
-        throw CompilationError(CompilationStep::GENERAL, "Error creating pipe", strerror(errno));
-}
+    std::array<int, 2> fds{-1, -1};
 
-static void closePipe(int fd)
-{
-    if(close(fd) != 0)
-        throw CompilationError(CompilationStep::GENERAL, "Error closing pipe", strerror(errno));
-}
+    Pipe() = default;
+    Pipe(const Pipe&) = delete;
+    Pipe(Pipe&&) = delete;
+    ~Pipe()
+    {
+        close(READ);
+        close(WRITE);
+    }
+
+    Pipe& operator=(const Pipe&) = delete;
+    Pipe& operator=(Pipe&&) = delete;
+
+    void open()
+    {
+        if(pipe2(fds.data(), O_CLOEXEC) != 0)
+            throw CompilationError(CompilationStep::GENERAL, "Error creating pipe", strerror(errno));
+    }
 
-static void mapPipe(int pipe, int fd)
+    void close(int end)
+    {
+        if(fds[end] >= 0 && ::close(fds[end]) != 0)
+            CPPLOG_LAZY(logging::Level::WARNING, log << "Error closing pipe: " << strerror(errno) << logging::endl);
+        fds[end] = -1;
+    }
+
+    bool isOpen(int end) const
+    {
+        return fds[end] >= 0;
+    }
+};
+
+static void setNonBlocking(int fd)
 {
-    if(dup2(pipe, fd) == -1)
-        throw CompilationError(CompilationStep::GENERAL, "Error duplicating pipe", strerror(errno));
+    auto flags = fcntl(fd, F_GETFL);
+    if(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        throw CompilationError(CompilationStep::GENERAL, "Error configuring pipe", strerror(errno));
 }
 
 static std::vector<std::string> splitString(const std::string& input, const char delimiter)
@@ -58,49 +85,52 @@ static std::vector<std::string> splitString(const std::string& input, const char
     std::string token;
     while(std::getline(in, token, delimiter))
     {
-        result.push_back(token);
+        // skip empty tokens, e.g. for multiple consecutive delimiters
+        if(!token.empty())
+            result.push_back(token);
     }
     return result;
 }
 
-static void runChild(
-    const std::string& command, std::array<std::array<int, 2>, 3>& pipes, bool hasStdIn, bool hasStdOut, bool hasStdErr)
+static void checkSpawnError(int error, const char* message)
 {
-    // map pipes into stdin/stdout/stderr
-    // close pipes not used by child
-    if(hasStdIn)
+    if(error != 0)
+        throw CompilationError(CompilationStep::GENERAL, message, strerror(error));
+}
+
+/*
+ * RAII wrapper for the posix_spawn file actions
+ */
+struct SpawnActions
+{
+    posix_spawn_file_actions_t actions{};
+
+    SpawnActions()
     {
-        mapPipe(pipes[STD_IN][READ], STDIN_FILENO);
-        closePipe(pipes[STD_IN][READ]);
-        closePipe(pipes[STD_IN][WRITE]);
+        checkSpawnError(posix_spawn_file_actions_init(&actions), "Error initializing child process actions");
     }
-    if(hasStdOut)
+    SpawnActions(const SpawnActions&) = delete;
+    SpawnActions(SpawnActions&&) = delete;
+    ~SpawnActions()
     {
-        mapPipe(pipes[STD_OUT][WRITE], STDOUT_FILENO);
-        closePipe(pipes[STD_OUT][READ]);
-        closePipe(pipes[STD_OUT][WRITE]);
+        posix_spawn_file_actions_destroy(&actions);
     }
-    if(hasStdErr)
+
+    SpawnActions& operator=(const SpawnActions&) = delete;
+    SpawnActions& operator=(SpawnActions&&) = delete;
+
+    void mapPipe(int pipe, int fd)
     {
-        mapPipe(pipes[STD_ERR][WRITE], STDERR_FILENO);
-        closePipe(pipes[STD_ERR][READ]);
-        closePipe(pipes[STD_ERR][WRITE]);
+        // the original pipe ends are closed in the child on exec, since they are created with O_CLOEXEC
+        checkSpawnError(posix_spawn_file_actions_adddup2(&actions, pipe, fd), "Error duplicating pipe");
     }
 
-    // split command
-    std::vector<std::string> parts = splitString(command, ' ');
-    const std::string file = parts.at(0);
-    std::array<char*, 128> args{};
-    args.fill(nullptr);
-    // man(3) exec: "The first argument, by convention, should point to the filename associated with the file being
-    // executed"
-    for(std::size_t i = 0; i < parts.size(); ++i)
+    void discard(int fd)
     {
-        args.at(i) = const_cast<char*>(parts[i].data());
+        checkSpawnError(posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", O_WRONLY, 0),
+            "Error redirecting child output");
     }
-
-    execvp(file.data(), args.data());
-}
+};
 
 static bool isChildFinished(pid_t pid, int* exitStatus, bool wait = false)
 {
@@ -128,219 +158,204 @@ static bool isChildFinished(pid_t pid, int* exitStatus, bool wait = false)
         CompilationStep::GENERAL, "Unhandled case in retrieving child process information", std::to_string(result));
 }
 
-static int runReadOnlySubprocess(const std::string& command, std::ostream* output)
+/*
+ * The data to be written into the standard input of the child process. For memory-mapped input files, the data is
+ * directly written (spliced into the pipe) from the mapping, otherwise it is read into a buffer in chunks.
+ */
+struct InputData
 {
-    auto fd = popen(command.data(), "r");
-    if(fd == nullptr)
-        throw CompilationError(CompilationStep::GENERAL, "Failed to run command", strerror(errno));
-    if(output != nullptr)
+    std::istream* stream;
+    const char* mappedData = nullptr;
+    std::size_t mappedSize = 0;
+    std::vector<char> buffer;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+
+    explicit InputData(std::istream* stream) : stream(stream)
     {
-        std::array<char, 512> buffer;
-        std::size_t numRead = 0;
-        while((numRead = fread(buffer.data(), sizeof(char), buffer.size(), fd)) > 0)
-        {
-            output->write(buffer.data(), static_cast<std::streamsize>(numRead));
-        }
-        if(ferror(fd))
+        auto mapped = stream ? getMappedBuffer(*stream) : nullptr;
+        auto position = stream ? stream->tellg() : std::istream::pos_type(-1);
+        if(mapped && position != std::istream::pos_type(-1))
         {
-            auto err = ferror(fd);
-            pclose(fd);
-            throw CompilationError(CompilationStep::GENERAL, "Error reading from sub-process", strerror(err));
+            mappedData = mapped->data() + static_cast<std::size_t>(position);
+            mappedSize = mapped->size() - static_cast<std::size_t>(position);
         }
+        else if(stream)
+            buffer.resize(BUFFER_SIZE);
     }
-    return pclose(fd);
-}
 
-static int runWriteOnlySubprocess(const std::string& command, std::istream* input)
-{
-    auto fd = popen(command.data(), "w");
-    if(fd == nullptr)
-        throw CompilationError(CompilationStep::GENERAL, "Failed to run command", strerror(errno));
-    if(input != nullptr)
+    /*
+     * Returns the next chunk of data to write, an empty chunk on end of input
+     */
+    std::pair<const char*, std::size_t> next()
     {
-        std::array<char, 512> buffer;
-        while(input->read(buffer.data(), buffer.size()))
-        {
-            fwrite(buffer.data(), sizeof(char), static_cast<std::size_t>(input->gcount()), fd);
-        }
-        if(ferror(fd))
+        if(mappedData)
+            return std::make_pair(mappedData + offset, mappedSize - offset);
+        if(offset == size && *stream)
         {
-            auto err = ferror(fd);
-            pclose(fd);
-            throw CompilationError(CompilationStep::GENERAL, "Error writing into sub-process", strerror(err));
+            stream->read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            size = static_cast<std::size_t>(stream->gcount());
+            offset = 0;
         }
+        return std::make_pair(buffer.data() + offset, size - offset);
     }
-    return pclose(fd);
-}
 
-int vc4c::runProcess(const std::string& command, std::istream* stdin, std::ostream* stdout, std::ostream* stderr)
+    void consume(std::size_t numBytes)
+    {
+        offset += numBytes;
+    }
+
+    void finish()
+    {
+        if(mappedData && stream)
+            // mark the mapped input as read completely
+            stream->seekg(0, std::ios_base::end);
+    }
+};
+
+static ssize_t writeToPipe(int fd, const char* data, std::size_t size, bool isMapped)
 {
-    /*
-     * Simple version, only ONE of stdin, stdout or stderr is set.
-     * Now we can simplify by using popen
-     */
-    if(static_cast<unsigned>(stdin != nullptr) + static_cast<unsigned>(stdout != nullptr) +
-            static_cast<unsigned>(stderr != nullptr) <=
-        1)
+#ifdef __linux__
+    if(isMapped)
     {
-        if(stderr != nullptr)
-        {
-            // redirect stderr to stdout, so we can read it
-            // see
-            // https://stackoverflow.com/questions/876239/how-can-i-redirect-and-append-both-stdout-and-stderr-to-a-file-with-bash
-            return runReadOnlySubprocess(command + " 2>&1", stderr);
-        }
-        else if(stdout != nullptr)
-        {
-            return runReadOnlySubprocess(command, stderr);
-        }
-        return runWriteOnlySubprocess(command, stdin);
+        // map the pages of the (read-only) mapped file into the pipe instead of copying them
+        iovec vec{const_cast<char*>(data), size};
+        return vmsplice(fd, &vec, 1, SPLICE_F_NONBLOCK);
     }
+#endif
+    return write(fd, data, size);
+}
 
+int vc4c::runProcess(const std::string& command, std::istream* stdin, std::ostream* stdout, std::ostream* stderr)
+{
     /*
-     * For the general case:
+     * The child process is created via posix_spawn (which uses vfork()/clone(CLONE_VM) on Linux), since fork() needs
+     * to copy the page tables of the whole (possibly large) heap of the compiler just to immediately replace them on
+     * exec().
      *
-     * NOTE: not setting a stream to put the stdout of the child-process in doesn't currently work (hangs the
-     * child-process)  so we always set an output-stream, even if we write to file. But since the stream will have no
-     * content (is not written to), it has no impact
-     */
-
-    /*
-     * See:
-     * https://jineshkj.wordpress.com/2006/12/22/how-to-capture-stdin-stdout-and-stderr-of-child-program/
-     * https://stackoverflow.com/questions/6171552/popen-simultaneous-read-and-write
-     * https://www.linuxquestions.org/questions/programming-9/popen-read-and-write-both-how-201083/
-     * https://stackoverflow.com/questions/29554036/waiting-for-popen-subprocess-to-terminate-before-reading?rq=1
+     * Standard input/output/error of the child are then written/read concurrently with non-blocking pipes to not
+     * dead-lock if the child fills up one output pipe before having read its whole input.
      */
-
-    std::array<std::array<int, 2>, 3> pipes{};
+    Pipe inPipe;
+    Pipe outPipe;
+    Pipe errPipe;
+    SpawnActions actions;
 
     if(stdin != nullptr)
-        initPipe(pipes[STD_IN]);
-    if(true)
-        initPipe(pipes[STD_OUT]);
+    {
+        inPipe.open();
+        actions.mapPipe(inPipe.fds[READ], STDIN_FILENO);
+    }
+    if(stdout != nullptr)
+    {
+        outPipe.open();
+        actions.mapPipe(outPipe.fds[WRITE], STDOUT_FILENO);
+    }
+    else
+        // the output is written into a file, if we do not want to read it
+        actions.discard(STDOUT_FILENO);
     if(stderr != nullptr)
-        initPipe(pipes[STD_ERR]);
-
-    pid_t pid = fork();
-    if(pid == 0) // child
     {
-        runChild(command, pipes, stdin != nullptr, true, stderr != nullptr);
-        /*
-         * Nothing below this line should be executed by child process. If so, it means that the exec function wasn't
-         * successful, so lets exit:
-         */
-        throw CompilationError(CompilationStep::GENERAL, "Error executing the child process", strerror(errno));
+        errPipe.open();
+        actions.mapPipe(errPipe.fds[WRITE], STDERR_FILENO);
     }
 
-    std::array<char, BUFFER_SIZE> buffer{};
-    ssize_t numBytes;
-    int exitStatus = 0;
-    bool childFinished = false;
-
-    PROFILE_START(WriteToChildProcess);
-    // write to stdin
-    if(stdin != nullptr)
+    std::vector<std::string> parts = splitString(command, ' ');
+    if(parts.empty())
+        throw CompilationError(CompilationStep::GENERAL, "Cannot execute empty command");
+    std::vector<char*> args;
+    args.reserve(parts.size() + 1);
+    // man(3) exec: "The first argument, by convention, should point to the filename associated with the file being
+    // executed"
+    for(auto& part : parts)
+        args.push_back(&part[0]);
+    args.push_back(nullptr);
+
+    pid_t pid = 0;
+    PROFILE_START(SpawnChildProcess);
+    checkSpawnError(posix_spawnp(&pid, parts[0].data(), &actions.actions, nullptr, args.data(), environ),
+        "Error executing the child process");
+    PROFILE_END(SpawnChildProcess);
+
+    // close the pipe ends used by the child
+    inPipe.close(READ);
+    outPipe.close(WRITE);
+    errPipe.close(WRITE);
+    if(inPipe.isOpen(WRITE))
+        // only write as much as fits into the pipe to not block reading the child's output
+        setNonBlocking(inPipe.fds[WRITE]);
+
+    InputData input(stdin);
+    std::vector<char> buffer(BUFFER_SIZE);
+
+    PROFILE_START(CommunicateWithChildProcess);
+    while(inPipe.isOpen(WRITE) || outPipe.isOpen(READ) || errPipe.isOpen(READ))
     {
-        std::istream& in = *stdin;
-        while(!(childFinished = childFinished || isChildFinished(pid, &exitStatus)))
+        std::array<pollfd, 3> descriptors{};
+        nfds_t numDescriptors = 0;
+        if(inPipe.isOpen(WRITE))
+            descriptors[numDescriptors++] = pollfd{inPipe.fds[WRITE], POLLOUT, 0};
+        if(outPipe.isOpen(READ))
+            descriptors[numDescriptors++] = pollfd{outPipe.fds[READ], POLLIN, 0};
+        if(errPipe.isOpen(READ))
+            descriptors[numDescriptors++] = pollfd{errPipe.fds[READ], POLLIN, 0};
+
+        if(poll(descriptors.data(), numDescriptors, -1) == -1)
         {
-            in.read(buffer.data(), buffer.size());
-            numBytes = in.gcount();
-            write(pipes[STD_IN][WRITE], buffer.data(), static_cast<std::size_t>(in.gcount()));
-            if(numBytes != buffer.size())
-                break;
+            if(errno == EINTR)
+                continue;
+            throw CompilationError(CompilationStep::GENERAL, "Error waiting on child's streams", strerror(errno));
         }
-        closePipe(pipes[STD_IN][READ]);
-        closePipe(pipes[STD_IN][WRITE]);
-    }
-    PROFILE_END(WriteToChildProcess);
 
-    bool stdOutFinished = true;
-    bool stdErrFinished = stderr != nullptr;
-
-    int highestFD = std::max(pipes[STD_OUT][READ], pipes[STD_ERR][READ]);
-    fd_set readDescriptors{};
-    timeval timeout{};
-
-    /*
-     * While the child program has not yet finished and the output-streams are not read to the end (EOF, thus the child
-     * process has also finished), check which output stream has data and read it
-     */
-    PROFILE_START(ReadFromChildProcess);
-    while(!(stdOutFinished && stdErrFinished) || !(childFinished = childFinished || isChildFinished(pid, &exitStatus)))
-    {
-        FD_ZERO(&readDescriptors);
-        if(true)
-            FD_SET(pipes[STD_OUT][READ], &readDescriptors);
-        if(stderr != nullptr)
-            FD_SET(pipes[STD_ERR][READ], &readDescriptors);
-
-        /*
-         * We need to re-initialize the timeout every iteration, because the select man-page states:
-         * On Linux, select() modifies timeout to reflect the amount of time not slept; most other implementations do
-         * not do this. (POSIX.1-2001 permits either behavior.) This causes problems both when Linux code which reads
-         * timeout is ported to other operating systems, and when code is ported to Linux that reuses a struct timeval
-         * for multiple select()s in a loop without reinitializing it. Consider timeout to be undefined after select()
-         * returns.
-         */
-        timeout.tv_sec = 0;
-        // wait 1ms
-        timeout.tv_usec = 1000;
-
-        /*
-         * "Those listed in readfds will be watched to see if characters become available for reading
-         * [...] On exit, the sets are modified in place to indicate which file descriptors actually changed status."
-         *
-         * "nfds is the highest-numbered file descriptor in any of the three sets, plus 1.
-         *
-         * "On success, select() and pselect() return the number of file descriptors contained in the three returned
-         * descriptor sets
-         * [...] which may be zero if the timeout expires before anything interesting happens"
-         */
-        int selectStatus = select(highestFD + 1, &readDescriptors, nullptr, nullptr, &timeout);
-        if(selectStatus == -1)
-            throw CompilationError(
-                CompilationStep::GENERAL, "Error waiting on child's output streams", strerror(errno));
-        else if(selectStatus != 0)
+        for(nfds_t i = 0; i < numDescriptors; ++i)
         {
-            // something happened
-            if(FD_ISSET(pipes[STD_OUT][READ], &readDescriptors))
+            const auto& desc = descriptors[i];
+            if(desc.revents == 0)
+                continue;
+            if(desc.fd == inPipe.fds[WRITE])
             {
-                numBytes = read(pipes[STD_OUT][READ], buffer.data(), buffer.size());
-                if(stdout != nullptr)
-                    stdout->write(buffer.data(), numBytes);
-                if(numBytes == 0)
-                    // EOF
-                    stdOutFinished = true;
+                if(desc.revents & (POLLERR | POLLHUP))
+                {
+                    // child closed its standard input, e.g. if it does not read all of it
+                    inPipe.close(WRITE);
+                    continue;
+                }
+                auto chunk = input.next();
+                if(chunk.second == 0)
+                {
+                    // end of input, signal EOF to the child
+                    input.finish();
+                    inPipe.close(WRITE);
+                    continue;
+                }
+                auto numBytes = writeToPipe(desc.fd, chunk.first, chunk.second, input.mappedData != nullptr);
+                if(numBytes > 0)
+                    input.consume(static_cast<std::size_t>(numBytes));
+                else if(errno == EPIPE)
+                    inPipe.close(WRITE);
+                else if(errno != EAGAIN && errno != EINTR)
+                    throw CompilationError(
+                        CompilationStep::GENERAL, "Error writing into sub-process", strerror(errno));
             }
-            if(stderr != nullptr && FD_ISSET(pipes[STD_ERR][READ], &readDescriptors))
+            else
             {
-                numBytes = read(pipes[STD_ERR][READ], buffer.data(), buffer.size());
-                stderr->write(buffer.data(), numBytes);
-                if(numBytes == 0)
+                auto& pipe = desc.fd == outPipe.fds[READ] ? outPipe : errPipe;
+                auto stream = desc.fd == outPipe.fds[READ] ? stdout : stderr;
+                auto numBytes = read(desc.fd, buffer.data(), buffer.size());
+                if(numBytes > 0)
+                    stream->write(buffer.data(), static_cast<std::streamsize>(numBytes));
+                else if(numBytes == 0)
                     // EOF
-                    stdErrFinished = true;
+                    pipe.close(READ);
+                else if(errno != EAGAIN && errno != EINTR)
+                    throw CompilationError(
+                        CompilationStep::GENERAL, "Error reading from sub-process", strerror(errno));
             }
         }
     }
-    PROFILE_END(ReadFromChildProcess);
-
-    if(true)
-    {
-        closePipe(pipes[STD_OUT][READ]);
-        closePipe(pipes[STD_OUT][WRITE]);
-    }
+    PROFILE_END(CommunicateWithChildProcess);
 
-    if(stderr != nullptr)
-    {
-        closePipe(pipes[STD_ERR][READ]);
-        closePipe(pipes[STD_ERR][WRITE]);
-    }
-
-    if(!childFinished)
-    {
-        PROFILE(isChildFinished, pid, &exitStatus, true);
-    }
+    int exitStatus = 0;
+    PROFILE(isChildFinished, pid, &exitStatus, true);
     return exitStatus;
 }
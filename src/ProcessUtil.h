@@ -15,6 +15,10 @@ namespace vc4c
     /*
      * Runs the command in a new child-process, passes the standard input/output/error streams, waits for the process to
      * finish and returns it status
+     *
+     * The command is split at spaces into the program and its arguments, it is NOT run via a shell. If no stream is
+     * given for the standard output, the output of the child process is discarded. If no stream is given for the
+     * standard input or error, the child inherits them from this process.
      */
     int runProcess(const std::string& command, std::istream* stdin = nullptr, std::ostream* stdout = nullptr,
         std::ostream* stderr = nullptr);
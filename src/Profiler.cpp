@@ -8,16 +8,21 @@
 
 #include "log.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <memory>
+#include <ostream>
 #include <set>
 #include <sys/resource.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <unordered_map>
+#include <vector>
 
 #ifdef MULTI_THREADED
 #include <mutex>
@@ -212,4 +217,221 @@ void profiler::increaseCounter(const std::size_t index, std::string name, const
     entry.fileName = std::move(file);
     entry.lineNumber = line;
 }
+
+std::atomic_bool profiler::TRACING_ENABLED{false};
+
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    profiler::TraceClock::time_point start;
+    profiler::TraceClock::time_point end;
+    // in kB
+    long peakResidentSize;
+};
+
+struct TraceBuffer
+{
+    std::size_t threadId;
+    std::vector<TraceEvent> events;
+};
+
+// the buffers of all threads which recorded any event, only accessed for creating a buffer and writing the trace
+static std::vector<std::shared_ptr<TraceBuffer>> traceBuffers;
+static profiler::TraceClock::time_point traceStart;
+#ifdef MULTI_THREADED
+static std::mutex lockTraceBuffers;
+#endif
+
+static std::shared_ptr<TraceBuffer> createTraceBuffer()
+{
+#ifdef MULTI_THREADED
+    std::lock_guard<std::mutex> guard(lockTraceBuffers);
+#endif
+    traceBuffers.emplace_back(std::make_shared<TraceBuffer>());
+    traceBuffers.back()->threadId = traceBuffers.size();
+    return traceBuffers.back();
+}
+
+void profiler::startTracing()
+{
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(lockTraceBuffers);
+#endif
+        for(auto& buffer : traceBuffers)
+            buffer->events.clear();
+        traceStart = TraceClock::now();
+    }
+    TRACING_ENABLED = true;
+}
+
+void profiler::recordTraceEvent(const char* category, const char* name, TraceClock::time_point start)
+{
+    // every thread only ever appends to its own buffer, so no locking is required
+    thread_local std::shared_ptr<TraceBuffer> buffer = createTraceBuffer();
+    auto end = TraceClock::now();
+    rusage usage{};
+    long peakResidentSize = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+    buffer->events.emplace_back(TraceEvent{category, name, start, end, peakResidentSize});
+}
+
+static void writeTraceString(std::ostream& out, const char* text)
+{
+    out << '"';
+    for(; *text != '\0'; ++text)
+    {
+        if(*text == '"' || *text == '\\')
+            out << '\\';
+        out << *text;
+    }
+    out << '"';
+}
+
+void profiler::writeTrace(std::ostream& out)
+{
+    TRACING_ENABLED = false;
+#ifdef MULTI_THREADED
+    std::lock_guard<std::mutex> guard(lockTraceBuffers);
+#endif
+    const auto toMicroseconds = [](TraceClock::duration duration) -> long long {
+        return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    };
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+    bool isFirst = true;
+    for(const auto& buffer : traceBuffers)
+    {
+        for(const auto& event : buffer->events)
+        {
+            // the stage itself as complete event and the peak memory as counter event
+            out << (isFirst ? "" : ",\n") << "{\"name\": ";
+            writeTraceString(out, event.name);
+            out << ", \"cat\": ";
+            writeTraceString(out, event.category);
+            out << ", \"ph\": \"X\", \"ts\": " << toMicroseconds(event.start - traceStart)
+                << ", \"dur\": " << toMicroseconds(event.end - event.start) << ", \"pid\": 1, \"tid\": "
+                << buffer->threadId << ", \"args\": {\"peakRSS_kB\": " << event.peakResidentSize << "}},\n";
+            out << "{\"name\": \"peak RSS\", \"ph\": \"C\", \"ts\": " << toMicroseconds(event.end - traceStart)
+                << ", \"pid\": 1, \"args\": {\"kB\": " << event.peakResidentSize << "}}";
+            isFirst = false;
+        }
+        buffer->events.clear();
+    }
+    out << std::endl << "]}" << std::endl;
+}
+
+std::map<std::string, profiler::TraceSummary> profiler::summarizeTrace(const std::string& category)
+{
+    TRACING_ENABLED = false;
+#ifdef MULTI_THREADED
+    std::lock_guard<std::mutex> guard(lockTraceBuffers);
+#endif
+    std::map<std::string, TraceSummary> summaries;
+    for(const auto& buffer : traceBuffers)
+    {
+        for(const auto& event : buffer->events)
+        {
+            if(event.category != category)
+                continue;
+            auto& summary = summaries[event.name];
+            ++summary.numEvents;
+            summary.duration += event.end - event.start;
+            summary.peakResidentSize = std::max(summary.peakResidentSize, event.peakResidentSize);
+        }
+        buffer->events.clear();
+    }
+    return summaries;
+}
 // LCOV_EXCL_STOP
+
+const char* profiler::toString(MemoryCategory category)
+{
+    switch(category)
+    {
+    case MemoryCategory::INSTRUCTIONS:
+        return "instructions";
+    case MemoryCategory::LOCALS:
+        return "locals";
+    case MemoryCategory::ANALYSES:
+        return "analyses";
+    case MemoryCategory::REGISTER_ALLOCATION:
+        return "registerAllocation";
+    case MemoryCategory::EMULATOR:
+        return "emulator";
+    case MemoryCategory::OTHER:
+        return "other";
+    }
+    return "unknown";
+}
+
+static std::array<std::atomic<int64_t>, profiler::NUM_MEMORY_CATEGORIES> currentMemory{};
+static std::array<std::atomic<int64_t>, profiler::NUM_MEMORY_CATEGORIES> peakMemory{};
+static std::atomic<int64_t> currentTotalMemory{0};
+static std::atomic<int64_t> peakTotalMemory{0};
+// the usage of the current thread, the peak values are reset by every MemoryScope
+static thread_local profiler::MemoryUsage threadMemory;
+
+static void updatePeak(std::atomic<int64_t>& peak, int64_t value) noexcept
+{
+    auto previous = peak.load(std::memory_order_relaxed);
+    while(value > previous && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void profiler::trackMemory(MemoryCategory category, int64_t numBytes) noexcept
+{
+    const auto index = static_cast<std::size_t>(category);
+    threadMemory.current[index] += numBytes;
+    threadMemory.peak[index] = std::max(threadMemory.peak[index], threadMemory.current[index]);
+    threadMemory.currentTotal += numBytes;
+    threadMemory.peakTotal = std::max(threadMemory.peakTotal, threadMemory.currentTotal);
+
+    // the peak values only need to be updated (with the more expensive compare-and-swap) for new maxima
+    updatePeak(peakMemory[index], currentMemory[index].fetch_add(numBytes, std::memory_order_relaxed) + numBytes);
+    updatePeak(peakTotalMemory, currentTotalMemory.fetch_add(numBytes, std::memory_order_relaxed) + numBytes);
+}
+
+profiler::MemoryUsage profiler::getMemoryUsage()
+{
+    MemoryUsage usage;
+    for(std::size_t i = 0; i < NUM_MEMORY_CATEGORIES; ++i)
+    {
+        usage.current[i] = currentMemory[i].load(std::memory_order_relaxed);
+        usage.peak[i] = peakMemory[i].load(std::memory_order_relaxed);
+    }
+    usage.currentTotal = currentTotalMemory.load(std::memory_order_relaxed);
+    usage.peakTotal = peakTotalMemory.load(std::memory_order_relaxed);
+    return usage;
+}
+
+int64_t profiler::getCurrentMemoryUsage() noexcept
+{
+    return currentTotalMemory.load(std::memory_order_relaxed);
+}
+
+profiler::MemoryScope::MemoryScope(bool isolated) : outerUsage(threadMemory), isolated(isolated)
+{
+    if(isolated)
+        threadMemory = MemoryUsage{};
+    threadMemory.peak = threadMemory.current;
+    threadMemory.peakTotal = threadMemory.currentTotal;
+}
+
+profiler::MemoryScope::~MemoryScope()
+{
+    if(isolated)
+    {
+        // the memory still held by the isolated scope is not accounted for the enclosing scopes
+        threadMemory = outerUsage;
+        return;
+    }
+    for(std::size_t i = 0; i < NUM_MEMORY_CATEGORIES; ++i)
+        threadMemory.peak[i] = std::max(threadMemory.peak[i], outerUsage.peak[i]);
+    threadMemory.peakTotal = std::max(threadMemory.peakTotal, outerUsage.peakTotal);
+}
+
+profiler::MemoryUsage profiler::MemoryScope::getUsage() const
+{
+    return threadMemory;
+}
@@ -7,7 +7,12 @@
 #ifndef PROFILER_H
 #define PROFILER_H
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
 #include <string>
 
 namespace vc4c
@@ -52,6 +57,12 @@ namespace vc4c
 #define PROFILE_RESULTS()
 #endif
 
+    /*
+     * Traces the stage between the start and the end macro, also in release builds (see profiler::TraceScope)
+     */
+#define PROFILE_TRACE_START(name) const auto trace##name = profiler::startTraceEvent()
+#define PROFILE_TRACE_END(category, name) profiler::endTraceEvent(category, #name, trace##name)
+
     namespace profiler
     {
         using Clock = std::chrono::system_clock;
@@ -83,6 +94,193 @@ namespace vc4c
         static constexpr std::size_t COUNTER_OPTIMIZATION = 30000;
         static constexpr std::size_t COUNTER_BACKEND = 40000;
         static constexpr std::size_t COUNTER_EMULATOR = 100000;
+
+        /*
+         * Low-overhead tracing of the compilation stages (e.g. normalization steps, optimization passes and register
+         * fix-up steps), which is also available in release builds and is enabled at run-time, see
+         * Configuration#traceOutputFile.
+         *
+         * The events are recorded into per-thread buffers without locking and are written in the Chrome trace event
+         * format (as read by chrome://tracing or Perfetto). Every event records the duration of the traced stage and
+         * the peak resident memory of the process at the end of the stage.
+         *
+         * NOTE: The category and name of the traced stages are not copied and therefore need to have static storage
+         * duration, e.g. the names of the statically registered optimization passes.
+         */
+        using TraceClock = std::chrono::steady_clock;
+
+        extern std::atomic_bool TRACING_ENABLED;
+
+        /*
+         * Discards all previously recorded events and starts recording
+         */
+        void startTracing();
+        /*
+         * Stops recording and writes all recorded events in the Chrome trace event format to the given stream.
+         *
+         * NOTE: This must not be called while any traced stage is still running.
+         */
+        void writeTrace(std::ostream& out);
+
+        /*
+         * The accumulated duration and the maximum peak resident memory of all recorded events of a traced stage
+         */
+        struct TraceSummary
+        {
+            std::size_t numEvents = 0;
+            TraceClock::duration duration{};
+            // in kB
+            long peakResidentSize = 0;
+        };
+
+        /*
+         * Stops recording and returns the summary of all recorded events of the given category by their names,
+         * instead of writing the events (see #writeTrace()).
+         *
+         * NOTE: This must not be called while any traced stage is still running.
+         */
+        std::map<std::string, TraceSummary> summarizeTrace(const std::string& category);
+        void recordTraceEvent(const char* category, const char* name, TraceClock::time_point start);
+
+        /*
+         * Returns the start time of a traced stage, if tracing is enabled. Otherwise, returns the default time-point
+         * and the corresponding #endTraceEvent() does nothing.
+         */
+        inline TraceClock::time_point startTraceEvent() noexcept
+        {
+            return TRACING_ENABLED.load(std::memory_order_relaxed) ? TraceClock::now() : TraceClock::time_point{};
+        }
+
+        inline void endTraceEvent(const char* category, const char* name, TraceClock::time_point start)
+        {
+            if(start != TraceClock::time_point{})
+                recordTraceEvent(category, name, start);
+        }
+
+        /*
+         * Records the duration of the enclosing scope as trace event, if tracing is enabled
+         */
+        class TraceScope
+        {
+        public:
+            TraceScope(const char* category, const char* name) :
+                category(category), name(name), start(startTraceEvent())
+            {
+            }
+            TraceScope(const TraceScope&) = delete;
+            TraceScope(TraceScope&&) noexcept = delete;
+            ~TraceScope()
+            {
+                endTraceEvent(category, name, start);
+            }
+
+            TraceScope& operator=(const TraceScope&) = delete;
+            TraceScope& operator=(TraceScope&&) noexcept = delete;
+
+        private:
+            const char* category;
+            const char* name;
+            TraceClock::time_point start;
+        };
+
+        /*
+         * Accounting of the memory used by the main data structures of the compiler and the emulator, which is also
+         * available in release builds.
+         *
+         * The usage is tracked globally (e.g. to check the soft memory limit, see
+         * Configuration#maxCompilationMemory) as well as per thread. Every kernel is driven by a single thread, which
+         * might also run other kernels while waiting for its parallel tasks. Thus the usage of the compilation stages
+         * of a single kernel is taken from the per-thread usage within an isolated MemoryScope.
+         *
+         * NOTE: Only the sizes of the tracked objects themselves (e.g. the instructions, locals and graph nodes and
+         * edges) are accounted, not any additional memory allocated by these objects (e.g. for their members).
+         */
+        enum class MemoryCategory : unsigned char
+        {
+            // the intermediate instructions and the nodes of the instruction lists
+            INSTRUCTIONS,
+            // the locals and their additional data
+            LOCALS,
+            // the nodes and edges of the graphs created by the analyses
+            ANALYSES,
+            // the nodes and edges of the interference graph of the register allocation, see GraphColoring
+            REGISTER_ALLOCATION,
+            // the memory owned by the emulated device
+            EMULATOR,
+            // all other pooled objects
+            OTHER
+        };
+
+        static constexpr std::size_t NUM_MEMORY_CATEGORIES = static_cast<std::size_t>(MemoryCategory::OTHER) + 1;
+
+        const char* toString(MemoryCategory category);
+
+        /*
+         * The current and the peak memory usage in bytes, by category and in total.
+         *
+         * NOTE: The peak usages of the single categories are not necessarily reached at the same time, so their sum can
+         * exceed the peak total usage.
+         */
+        struct MemoryUsage
+        {
+            std::array<int64_t, NUM_MEMORY_CATEGORIES> current{};
+            std::array<int64_t, NUM_MEMORY_CATEGORIES> peak{};
+            int64_t currentTotal = 0;
+            int64_t peakTotal = 0;
+        };
+
+        /*
+         * Adds the given number of bytes (or removes them, if negative) to the usage of the given category
+         */
+        void trackMemory(MemoryCategory category, int64_t numBytes) noexcept;
+
+        /*
+         * Returns the memory usage of the whole process, the peak usage is the peak since the start of the process
+         */
+        MemoryUsage getMemoryUsage();
+        int64_t getCurrentMemoryUsage() noexcept;
+
+        /*
+         * Returns whether the current memory usage of the whole process exceeds the given limit, a limit of zero is
+         * never exceeded
+         */
+        inline bool exceedsMemoryLimit(std::size_t limit) noexcept
+        {
+            return limit != 0 && getCurrentMemoryUsage() > static_cast<int64_t>(limit);
+        }
+
+        /*
+         * Records the peak memory usage of the current thread for its lifetime, e.g. for a single compilation stage.
+         *
+         * Scopes can be nested, the peak usage of the inner scope is also accounted for the outer scope, unless the
+         * inner scope is isolated. An isolated scope starts with zero usage and does not change the usage of the
+         * enclosing scopes, e.g. for a kernel compiled on a thread which is waiting for the tasks of another kernel
+         * (see ThreadPool#waitFor()).
+         *
+         * NOTE: Memory allocated on other threads (e.g. by the optimization steps run in parallel) is not recorded and
+         * memory released on another thread than it was allocated on shifts the per-thread usage.
+         */
+        class MemoryScope
+        {
+        public:
+            explicit MemoryScope(bool isolated = false);
+            MemoryScope(const MemoryScope&) = delete;
+            MemoryScope(MemoryScope&&) noexcept = delete;
+            ~MemoryScope();
+
+            MemoryScope& operator=(const MemoryScope&) = delete;
+            MemoryScope& operator=(MemoryScope&&) noexcept = delete;
+
+            /*
+             * Returns the current usage and the peak usage since the start of this scope of the current thread
+             */
+            MemoryUsage getUsage() const;
+
+        private:
+            // the peak usage recorded for the enclosing scope before this scope was started
+            MemoryUsage outerUsage;
+            bool isolated;
+        };
     } // namespace profiler
 } // namespace vc4c
 
@@ -166,10 +166,19 @@ Value SIMDVectorHolder::storeVector(SIMDVector&& vec, DataType type)
         // store a SIMDVector entry.
         return Value(vec[0], type);
     }
+    // calculate the hash outside of the critical section
+    auto hash = std::hash<SIMDVector>{}(vec);
     // TODO does this mutex lock too often??
     std::lock_guard<std::mutex> guard(accessMutex);
     auto it = constantVectors.emplace(std::move(vec)).first;
-    const_cast<SIMDVectorHolder*&>(it->storage) = this;
+    if(!it->isInterned())
+    {
+        // newly inserted
+        const_cast<SIMDVectorHolder*&>(it->storage) = this;
+        // this does not change the hash of the entry, since the cached hash is equal to the calculated hash
+        const_cast<std::size_t&>(it->cachedHash) = hash;
+        const_cast<const SIMDVector*&>(it->internedInstance) = &*it;
+    }
     return Value(&*it, type);
 }
 
@@ -181,7 +190,11 @@ Value SIMDVectorHolder::storeVector(SIMDVector&& vec, DataType type, SIMDVectorH
 
 std::size_t std::hash<vc4c::SIMDVector>::operator()(vc4c::SIMDVector const& val) const noexcept
 {
+    if(val.isInterned())
+        return val.cachedHash;
     static const std::hash<Literal> elementHash;
+    // combine the element hashes depending on their position, so vectors with the same elements in a different order
+    // (e.g. permutation tables) do not collide
     return std::accumulate(val.begin(), val.end(), static_cast<std::size_t>(0),
-        [&](std::size_t s, const Literal& val) -> std::size_t { return s + elementHash(val); });
+        [&](std::size_t s, const Literal& val) -> std::size_t { return s * 31 + elementHash(val); });
 }
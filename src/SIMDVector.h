@@ -60,12 +60,15 @@ namespace vc4c
 
         inline bool operator==(const SIMDVector& other) const noexcept
         {
+            if(isInterned() && other.isInterned() && storage == other.storage)
+                // the interned vectors of a single storage are unique, so we can just compare their identities
+                return this == &other;
             return elements == other.elements;
         }
 
         inline bool operator!=(const SIMDVector& other) const noexcept
         {
-            return elements != other.elements;
+            return !(*this == other);
         }
 
         Elements::iterator begin() noexcept
@@ -162,10 +165,24 @@ namespace vc4c
             return storage;
         }
 
+        /*
+         * Whether this object is the unique (immutable) instance of its content stored in a SIMDVectorHolder
+         */
+        bool isInterned() const noexcept
+        {
+            // copies of an interned vector are not interned, since they might be modified
+            return internedInstance == this;
+        }
+
     private:
         Elements elements;
         SIMDVectorHolder* storage = nullptr;
+        // the address of the object when it was interned, to be able to distinguish the interned object from its copies
+        const SIMDVector* internedInstance = nullptr;
+        // the precalculated hash of an interned vector
+        std::size_t cachedHash = 0;
         friend struct SIMDVectorHolder;
+        friend struct std::hash<SIMDVector>;
     };
 
     /*
@@ -196,8 +213,11 @@ namespace vc4c
          * The contents of set are immutable!
          * This is a hashmap so a) we can quickly check for and avoid duplicates and b) the references to the elements
          * are stable.
+         *
+         * Since every vector content is only stored once, the stored vectors can be compared by their identity (see
+         * SIMDVector#operator==).
          */
-        FastSet<SIMDVector> constantVectors;
+        StableSet<SIMDVector> constantVectors;
         std::mutex accessMutex;
     };
 
@@ -6,16 +6,27 @@
 
 #include "ThreadPool.h"
 
+#include <algorithm>
 #include <sys/prctl.h>
 
 using namespace vc4c;
 
-ThreadPool::ThreadPool(const std::string& poolName, unsigned numThreads) : keepRunning(true)
+static std::atomic_uint maximumParallelism{0};
+
+// the pool and index of the worker running on the current thread, if any
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local std::size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(const std::string& poolName, unsigned numThreads) :
+    keepRunning(true), nextQueue(0), numPendingTasks(0)
 {
 #ifdef MULTI_THREADED
     workers.reserve(numThreads);
     for(unsigned i = 0; i < numThreads; ++i)
-        workers.emplace_back([this, poolName]() { workerTask(poolName); });
+        workers.emplace_back(new Worker());
+    // only start the threads after all workers are created, since they access the other workers' queues
+    for(unsigned i = 0; i < numThreads; ++i)
+        workers[i]->thread = std::thread([this, poolName, i]() { workerTask(poolName, i); });
 #endif
 }
 
@@ -27,45 +38,126 @@ ThreadPool::~ThreadPool()
     // wait for all threads to end to not cause std::terminate to be issued
     queueCondition.notify_all();
     for(auto& worker : workers)
-        worker.join();
+        worker->thread.join();
 #endif
 }
 
+static std::size_t getNumActiveWorkers(std::size_t numWorkers)
+{
+    auto limit = maximumParallelism.load();
+    return limit == 0 ? numWorkers : std::min(numWorkers, static_cast<std::size_t>(limit));
+}
+
 std::future<void> ThreadPool::schedule(std::function<void()>&& func)
 {
-    std::packaged_task<void()> task{func};
+    std::packaged_task<void()> task{std::move(func)};
     auto fut = task.get_future();
 #ifdef MULTI_THREADED
+    if(workers.empty())
+    {
+        task();
+        return fut;
+    }
+    // tasks scheduled from within a worker are put into its own queue, all other tasks are distributed round-robin
+    // among the workers allowed to run
+    auto numActive = std::max(getNumActiveWorkers(workers.size()), std::size_t{1});
+    auto queueIndex = currentPool == this ? currentWorker : (nextQueue++ % numActive);
+    // increment before inserting to not have the counter underflow when the task is popped immediately
+    ++numPendingTasks;
+    {
+        std::lock_guard<std::mutex> guard(workers[queueIndex]->queueMutex);
+        workers[queueIndex]->taskQueue.emplace_back(std::move(task));
+    }
     {
-        std::lock_guard<std::mutex> guard(queueMutex);
-        taskQueue.emplace(std::move(task));
+        // acquire the lock to not miss any worker which just checked for pending tasks and is about to wait
+        std::lock_guard<std::mutex> guard(waitMutex);
     }
-    queueCondition.notify_one();
+    // need to wake up all workers, since the woken up one might not be allowed to run due to the parallelism limit
+    queueCondition.notify_all();
 #else
     task();
 #endif
     return fut;
 }
 
-void ThreadPool::workerTask(const std::string& poolName)
+void ThreadPool::waitFor(std::future<void>& future)
 {
-    prctl(PR_SET_NAME, poolName.data(), 0, 0, 0);
-    while(true)
+    while(future.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
     {
-        std::packaged_task<void()> task;
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            queueCondition.wait_for(
-                lock, std::chrono::milliseconds{100}, [&] { return !keepRunning || !taskQueue.empty(); });
-            if(!keepRunning)
-                return;
-            if(taskQueue.empty())
-                continue;
-            task = std::move(taskQueue.front());
-            taskQueue.pop();
-        }
+        // help out executing pending tasks, this also prevents dead-locks for tasks waiting on other tasks
+        if(!tryRunPendingTask(currentPool == this ? currentWorker : 0))
+            future.wait_for(std::chrono::milliseconds{1});
+    }
+    future.get();
+}
+
+ThreadPool& ThreadPool::getDefaultPool()
+{
+    static ThreadPool defaultPool{"VC4C"};
+    return defaultPool;
+}
+
+void ThreadPool::setMaximumParallelism(unsigned numThreads)
+{
+    maximumParallelism = numThreads;
+}
 
+unsigned ThreadPool::getMaximumParallelism()
+{
+    auto limit = maximumParallelism.load();
+    return limit == 0 ? std::thread::hardware_concurrency() : limit;
+}
+
+void ThreadPool::workerTask(const std::string& poolName, std::size_t workerIndex)
+{
+    prctl(PR_SET_NAME, poolName.data(), 0, 0, 0);
+    currentPool = this;
+    currentWorker = workerIndex;
+    while(keepRunning)
+    {
+        auto isActive = [&]() -> bool { return workerIndex < getNumActiveWorkers(workers.size()); };
         // execute task outside of lock
-        task();
+        if(isActive() && tryRunPendingTask(workerIndex))
+            continue;
+
+        std::unique_lock<std::mutex> lock(waitMutex);
+        queueCondition.wait_for(lock, std::chrono::milliseconds{100},
+            [&] { return !keepRunning || (numPendingTasks > 0 && isActive()); });
+    }
+}
+
+bool ThreadPool::tryRunPendingTask(std::size_t preferredQueue)
+{
+    if(workers.empty() || numPendingTasks == 0)
+        return false;
+    std::packaged_task<void()> task;
+    // take the most recently added task from the own queue (best cache locality), otherwise steal the oldest task from
+    // any other queue
+    bool found = tryPopTask(preferredQueue, true, task);
+    for(std::size_t i = 1; !found && i < workers.size(); ++i)
+        found = tryPopTask((preferredQueue + i) % workers.size(), false, task);
+    if(!found)
+        return false;
+    --numPendingTasks;
+    task();
+    return true;
+}
+
+bool ThreadPool::tryPopTask(std::size_t queueIndex, bool fromBack, std::packaged_task<void()>& task)
+{
+    auto& worker = *workers[queueIndex];
+    std::lock_guard<std::mutex> guard(worker.queueMutex);
+    if(worker.taskQueue.empty())
+        return false;
+    if(fromBack)
+    {
+        task = std::move(worker.taskQueue.back());
+        worker.taskQueue.pop_back();
+    }
+    else
+    {
+        task = std::move(worker.taskQueue.front());
+        worker.taskQueue.pop_front();
     }
+    return true;
 }
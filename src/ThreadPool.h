@@ -6,16 +6,27 @@
 #ifndef VC4C_THREDAPOOL_H
 #define VC4C_THREDAPOOL_H
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <future>
+#include <iterator>
 #include <list>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
 namespace vc4c
 {
+    /*
+     * Thread pool with one task queue per worker, where idle workers steal tasks from the queues of other workers.
+     *
+     * Threads waiting for scheduled tasks to finish (see #scheduleAll()) execute pending tasks themselves, so tasks
+     * can be scheduled from within other tasks without dead-locking the pool.
+     */
     class ThreadPool
     {
     public:
@@ -29,27 +40,79 @@ namespace vc4c
 
         std::future<void> schedule(std::function<void()>&& func);
 
+        /*
+         * Runs the given function for all elements of the container and waits for all executions to finish.
+         *
+         * The elements are grouped into chunks of the given size (or an automatically determined size if zero) and
+         * every chunk is scheduled as a single task, to not create one task per element for large containers.
+         */
         template <typename T, typename Container = std::list<T>>
-        void scheduleAll(const Container& c, const std::function<void(const T&)>& func)
+        void scheduleAll(const Container& c, const std::function<void(const T&)>& func, std::size_t chunkSize = 0)
         {
+            if(c.empty())
+                return;
+            const auto numElements = static_cast<std::size_t>(std::distance(c.begin(), c.end()));
+            if(chunkSize == 0)
+                // create some more chunks than there are workers, to be able to balance differently sized tasks
+                chunkSize = std::max(numElements / (4 * std::max(getMaximumParallelism(), 1u)), std::size_t{1});
+
             std::vector<std::future<void>> futures;
-            futures.reserve(c.size());
+            futures.reserve((numElements + chunkSize - 1) / chunkSize);
 
-            for(auto& elem : c)
-                futures.emplace_back(schedule([&]() { func(elem); }));
+            auto it = c.begin();
+            while(it != c.end())
+            {
+                auto start = it;
+                for(std::size_t i = 0; i < chunkSize && it != c.end(); ++i)
+                    ++it;
+                auto end = it;
+                futures.emplace_back(schedule([start, end, &func]() {
+                    for(auto elemIt = start; elemIt != end; ++elemIt)
+                        func(*elemIt);
+                }));
+            }
 
             for(auto& fut : futures)
-                fut.get();
+                waitFor(fut);
         }
 
+        /*
+         * Waits for the given future to become ready while executing pending tasks and returns the result (or
+         * re-throws the exception thrown by the task).
+         */
+        void waitFor(std::future<void>& future);
+
+        /*
+         * Returns the process-wide thread pool shared by all compilation steps
+         */
+        static ThreadPool& getDefaultPool();
+
+        /*
+         * Limits the number of threads concurrently executing tasks in any thread pool.
+         *
+         * A value of zero (the default) uses all available hardware threads.
+         */
+        static void setMaximumParallelism(unsigned numThreads);
+        static unsigned getMaximumParallelism();
+
     private:
-        std::vector<std::thread> workers;
+        struct Worker
+        {
+            std::mutex queueMutex;
+            std::deque<std::packaged_task<void()>> taskQueue;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
         std::atomic_bool keepRunning;
-        std::mutex queueMutex;
-        std::queue<std::packaged_task<void()>> taskQueue;
+        std::atomic_uint nextQueue;
+        std::atomic_uint numPendingTasks;
+        std::mutex waitMutex;
         std::condition_variable queueCondition;
 
-        void workerTask(const std::string& poolName);
+        void workerTask(const std::string& poolName, std::size_t workerIndex);
+        bool tryRunPendingTask(std::size_t preferredQueue);
+        bool tryPopTask(std::size_t queueIndex, bool fromBack, std::packaged_task<void()>& task);
     };
 
 } /* namespace vc4c */
@@ -458,6 +458,19 @@ bool StructType::operator==(const ComplexType& other) const
 
 unsigned int StructType::getStructSize(const int index) const
 {
+    std::lock_guard<std::mutex> guard(layoutLock);
+    updateLayout();
+    if(index < 0)
+        return layout->totalSize;
+    return layout->elementOffsets.at(static_cast<std::size_t>(index));
+}
+
+void StructType::updateLayout() const
+{
+    if(layout && layout->isPacked == isPacked && layout->elementTypes == elementTypes)
+        return;
+    std::unique_ptr<Layout> newLayout(new Layout{elementTypes, isPacked, {}, 0});
+    newLayout->elementOffsets.reserve(elementTypes.size());
     unsigned int size = 0;
     // TODO an empty struct has a size of at least 1?!? On the other hand, empty structs are not allowed (by the
     // grammar) in C (which OpenCL is based on), see
@@ -466,53 +479,41 @@ unsigned int StructType::getStructSize(const int index) const
     if(isPacked)
     {
         // packed -> no padding
-        for(std::size_t i = 0; i < elementTypes.size(); ++i)
+        for(const auto& element : elementTypes)
         {
-            if(i == static_cast<std::size_t>(index))
-                break;
-            size += elementTypes[i].getInMemoryWidth();
+            newLayout->elementOffsets.push_back(size);
+            size += element.getInMemoryWidth();
         }
-        return size;
+        newLayout->totalSize = size;
     }
-    // calculates size of struct including padding (!!NEED TO MATCH THE HOST!!)
-    // see also: http://stackoverflow.com/a/2749096
-    unsigned int alignment = 1;
-    for(std::size_t i = 0; i < elementTypes.size(); ++i)
+    else
     {
-        if(i == static_cast<std::size_t>(index))
-            break;
-        auto elementAlignment = elementTypes[i].getInMemoryAlignment();
-        alignment = std::max(alignment, elementAlignment);
-        // OpenCL 1.2, page 203
-        //"A data item declared to be a data type in memory is always aligned to the size of the data type in bytes."
-        if(size % elementAlignment != 0)
+        // calculates size of struct including padding (!!NEED TO MATCH THE HOST!!)
+        // see also: http://stackoverflow.com/a/2749096
+        unsigned int alignment = 1;
+        for(const auto& element : elementTypes)
         {
-            // alignment is added before the next type, not after the last
-            size += elementAlignment - (size % elementAlignment);
+            auto elementAlignment = element.getInMemoryAlignment();
+            alignment = std::max(alignment, elementAlignment);
+            // OpenCL 1.2, page 203
+            //"A data item declared to be a data type in memory is always aligned to the size of the data type in
+            // bytes."
+            if(size % elementAlignment != 0)
+            {
+                // alignment is added before the next type, not after the last
+                size += elementAlignment - (size % elementAlignment);
+            }
+            newLayout->elementOffsets.push_back(size);
+            size += element.getInMemoryWidth();
         }
-        size += elementTypes[i].getInMemoryWidth();
-    }
-    if(index < 0)
-    {
-        // whole object
         // padding at end of struct to align to alignment of largest
         if(size % alignment != 0)
         {
             size += alignment - (size % alignment);
         }
+        newLayout->totalSize = size;
     }
-    else
-    {
-        // add padding for element which is retrieved
-        auto elementAlignment = elementTypes.at(static_cast<std::size_t>(index)).getInMemoryAlignment();
-        if(size % elementAlignment != 0)
-        {
-            // alignment is added before the next type, not after the last
-            size += elementAlignment - (size % elementAlignment);
-        }
-    }
-
-    return size;
+    layout = std::move(newLayout);
 }
 
 unsigned StructType::getInMemoryAlignment() const
@@ -410,11 +410,37 @@ namespace vc4c
         std::string getContent() const;
 
     private:
+        /*
+         * The precalculated in-memory layout of the struct.
+         *
+         * Since the element types are public and might be modified after the struct type is created (e.g. the
+         * BitcodeReader inserts empty struct types and resolves the elements afterwards), the layout remembers the
+         * element types it was calculated for and is recalculated if they do not match anymore.
+         */
+        struct Layout
+        {
+            std::vector<DataType> elementTypes;
+            bool isPacked;
+            // the offsets of the single elements (including padding in front of the element)
+            std::vector<unsigned> elementOffsets;
+            // the size of the whole struct (including padding at the end)
+            unsigned totalSize;
+        };
+
+        mutable std::mutex layoutLock;
+        mutable std::unique_ptr<Layout> layout;
+
         StructType(const std::string& name, const std::vector<DataType>& elementTypes, bool isPacked = false) :
             name(name), elementTypes(elementTypes), isPacked(isPacked)
         {
         }
 
+        /*
+         * (Re-)calculates the layout, if it is not yet calculated or outdated. Needs to be called with the layout lock
+         * held.
+         */
+        void updateLayout() const;
+
         friend struct TypeHolder;
     };
 
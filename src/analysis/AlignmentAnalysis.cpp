@@ -0,0 +1,231 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "AlignmentAnalysis.h"
+
+#include "../GlobalValues.h"
+#include "../SIMDVector.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "../performance.h"
+
+#include <algorithm>
+
+using namespace vc4c;
+using namespace vc4c::analysis;
+
+constexpr uint32_t KnownAlignment::MAX_ALIGNMENT;
+
+// the maximum number of instructions followed to determine the alignment of a single value
+static constexpr unsigned MAX_RECURSION_DEPTH = 8;
+
+static constexpr KnownAlignment UNKNOWN_ALIGNMENT{};
+
+bool KnownAlignment::isAlignedTo(uint32_t numBytes) const noexcept
+{
+    return numBytes != 0 && (alignment % numBytes) == 0 && (offset % numBytes) == 0;
+}
+
+bool KnownAlignment::getOffsetTo(uint32_t numBytes, uint32_t& result) const noexcept
+{
+    if(numBytes == 0 || (numBytes & (numBytes - 1)) != 0 || alignment < numBytes)
+        return false;
+    result = offset & (numBytes - 1);
+    return true;
+}
+
+std::string KnownAlignment::to_string() const
+{
+    if(offset == 0)
+        return "aligned to " + std::to_string(alignment);
+    return "aligned to " + std::to_string(alignment) + " + " + std::to_string(offset);
+}
+
+/*
+ * Returns the largest power of two the given value is a multiple of, capped at the maximum tracked alignment
+ */
+static uint32_t getLowestBit(uint32_t val)
+{
+    if(val == 0)
+        return KnownAlignment::MAX_ALIGNMENT;
+    return std::min(val & (~val + 1u), KnownAlignment::MAX_ALIGNMENT);
+}
+
+static KnownAlignment fromConstant(uint32_t val)
+{
+    return KnownAlignment{KnownAlignment::MAX_ALIGNMENT, val};
+}
+
+/*
+ * Returns the alignment common to both inputs, i.e. the alignment of a value which can be either of the inputs
+ */
+static KnownAlignment join(const KnownAlignment& first, const KnownAlignment& second)
+{
+    auto alignment = std::min(first.alignment, second.alignment);
+    alignment = std::min(alignment, getLowestBit(first.offset - second.offset));
+    return KnownAlignment{alignment, first.offset};
+}
+
+static KnownAlignment add(const KnownAlignment& first, const KnownAlignment& second)
+{
+    return KnownAlignment{std::min(first.alignment, second.alignment), first.offset + second.offset};
+}
+
+static KnownAlignment subtract(const KnownAlignment& first, const KnownAlignment& second)
+{
+    return KnownAlignment{std::min(first.alignment, second.alignment), first.offset - second.offset};
+}
+
+static KnownAlignment multiply(const KnownAlignment& first, const KnownAlignment& second)
+{
+    // (o1 + k1 * a1) * (o2 + k2 * a2) = o1 * o2 + o1 * k2 * a2 + o2 * k1 * a1 + k1 * k2 * a1 * a2
+    auto alignment = static_cast<uint64_t>(first.alignment) * second.alignment;
+    alignment = std::min(alignment, static_cast<uint64_t>(first.alignment) * getLowestBit(second.offset));
+    alignment = std::min(alignment, static_cast<uint64_t>(second.alignment) * getLowestBit(first.offset));
+    alignment = std::min(alignment, static_cast<uint64_t>(KnownAlignment::MAX_ALIGNMENT));
+    return KnownAlignment{static_cast<uint32_t>(alignment), first.offset * second.offset};
+}
+
+/*
+ * Returns the largest power of two all elements of the value are known to be a multiple of
+ */
+static uint32_t getZeroBitsAlignment(const KnownAlignment& alignment)
+{
+    return alignment.offset == 0 ? alignment.alignment : getLowestBit(alignment.offset);
+}
+
+static KnownAlignment bitwiseAnd(const KnownAlignment& first, const KnownAlignment& second)
+{
+    KnownAlignment result{std::min(first.alignment, second.alignment), first.offset & second.offset};
+    // the lower bits known to be zero in either input (e.g. a mask) are also zero in the result
+    auto zeroBitsAlignment = std::max(getZeroBitsAlignment(first), getZeroBitsAlignment(second));
+    if(zeroBitsAlignment > result.alignment)
+        result = KnownAlignment{zeroBitsAlignment};
+    return result;
+}
+
+static KnownAlignment bitwiseOr(const KnownAlignment& first, const KnownAlignment& second)
+{
+    return KnownAlignment{std::min(first.alignment, second.alignment), first.offset | second.offset};
+}
+
+static KnownAlignment getLocalAlignment(const Local* local)
+{
+    if(auto alloc = local->as<StackAllocation>())
+        // the stack frames are located to heed the alignment of all stack allocations
+        return KnownAlignment{getLowestBit(static_cast<uint32_t>(alloc->alignment))};
+    if(local->is<Parameter>() || local->is<Global>())
+    {
+        // the buffers are aligned at least to their pointed-to types, as required by the OpenCL C standard and the
+        // global data segment layout
+        if(auto ptrType = local->type.getPointerType())
+            return KnownAlignment{getLowestBit(ptrType->getAlignment())};
+    }
+    return UNKNOWN_ALIGNMENT;
+}
+
+namespace
+{
+    class AlignmentResolver
+    {
+    public:
+        KnownAlignment getAlignment(const Value& val, unsigned depth)
+        {
+            if(auto lit = val.getLiteralValue())
+                return fromConstant(lit->unsignedInt());
+            if(auto vector = val.checkVector())
+            {
+                auto result = fromConstant(vector->begin()->unsignedInt());
+                for(const auto& element : *vector)
+                    result = join(result, fromConstant(element.unsignedInt()));
+                return result;
+            }
+            if(auto local = val.checkLocal())
+                return getAlignment(local, depth);
+            return UNKNOWN_ALIGNMENT;
+        }
+
+    private:
+        FastMap<const Local*, KnownAlignment> cache;
+
+        KnownAlignment getAlignment(const Local* local, unsigned depth)
+        {
+            auto known = getLocalAlignment(local);
+            if(known.alignment > 1 || depth >= MAX_RECURSION_DEPTH)
+                return known;
+            auto it = cache.find(local);
+            if(it != cache.end())
+                return it->second;
+            // break cycles (e.g. of loop induction variables) by assuming unknown alignment while resolving the writers
+            cache.emplace(local, UNKNOWN_ALIGNMENT);
+
+            Optional<KnownAlignment> result;
+            bool hasUnknownWriter = false;
+            local->forUsers(LocalUse::Type::WRITER, [&](const LocalUser* writer) {
+                if(hasUnknownWriter)
+                    return;
+                auto alignment = getAlignment(*writer, depth + 1);
+                result = result ? join(*result, alignment) : alignment;
+                hasUnknownWriter = result->alignment == 1;
+            });
+            auto alignment = result.value_or(UNKNOWN_ALIGNMENT);
+            cache[local] = alignment;
+            return alignment;
+        }
+
+        KnownAlignment getAlignment(const intermediate::IntermediateInstruction& inst, unsigned depth)
+        {
+            using namespace vc4c::intermediate;
+            if(inst.hasUnpackMode() || inst.hasPackMode())
+                return UNKNOWN_ALIGNMENT;
+            if(auto load = dynamic_cast<const LoadImmediate*>(&inst))
+                return load->type == LoadType::REPLICATE_INT32 ? fromConstant(load->getImmediate().unsignedInt()) :
+                                                                 UNKNOWN_ALIGNMENT;
+            if(auto move = dynamic_cast<const MoveOperation*>(&inst))
+                // since all elements have the same alignment, rotating the vector does not change it
+                return getAlignment(move->getSource(), depth);
+            if(auto op = dynamic_cast<const Operation*>(&inst))
+            {
+                auto secondArg = op->getSecondArg();
+                if(!secondArg)
+                    return UNKNOWN_ALIGNMENT;
+                if(op->op == OP_SHL)
+                {
+                    auto shift = secondArg->getLiteralValue();
+                    if(!shift || shift->unsignedInt() >= 32)
+                        return UNKNOWN_ALIGNMENT;
+                    return multiply(getAlignment(op->getFirstArg(), depth), fromConstant(1u << shift->unsignedInt()));
+                }
+                auto first = getAlignment(op->getFirstArg(), depth);
+                auto second = getAlignment(*secondArg, depth);
+                if(op->op == OP_ADD)
+                    return add(first, second);
+                if(op->op == OP_SUB)
+                    return subtract(first, second);
+                if(op->op == OP_MUL24)
+                    // the lower 24 bits of the inputs, and therefore the tracked lower bits of the result, are correct
+                    return multiply(first, second);
+                if(op->op == OP_AND)
+                    return bitwiseAnd(first, second);
+                if(op->op == OP_OR)
+                    return bitwiseOr(first, second);
+                return UNKNOWN_ALIGNMENT;
+            }
+            if(auto op = dynamic_cast<const IntrinsicOperation*>(&inst))
+            {
+                // the lower bits of the product of two integers only depend on the lower bits of the inputs
+                if(op->opCode == "mul" && op->getSecondArg())
+                    return multiply(getAlignment(op->getFirstArg(), depth), getAlignment(*op->getSecondArg(), depth));
+            }
+            return UNKNOWN_ALIGNMENT;
+        }
+    };
+} // namespace
+
+KnownAlignment KnownAlignment::getAlignment(const Value& val)
+{
+    AlignmentResolver resolver;
+    return resolver.getAlignment(val, 0);
+}
@@ -0,0 +1,64 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_ALIGNMENT_ANALYSIS_H
+#define VC4C_ALIGNMENT_ANALYSIS_H
+
+#include <cstdint>
+#include <string>
+
+namespace vc4c
+{
+    struct Value;
+
+    namespace analysis
+    {
+        /*
+         * The known alignment of an (integer or pointer) value, e.g. a memory address or an offset.
+         *
+         * All elements of the value are guaranteed to be congruent to the offset modulo the alignment, e.g. an address
+         * with an alignment of 4 and an offset of 2 is always the address of the upper half-word of a 32-bit word.
+         */
+        struct KnownAlignment
+        {
+            // Alignments larger than this are not relevant for any memory access and therefore not tracked
+            static constexpr uint32_t MAX_ALIGNMENT = 4096;
+
+            // The alignment in bytes, always a power of two
+            uint32_t alignment;
+            // The offset in bytes from the alignment, always smaller than the alignment
+            uint32_t offset;
+
+            constexpr KnownAlignment(uint32_t alignment = 1, uint32_t offset = 0) noexcept :
+                alignment(alignment), offset(offset & (alignment - 1))
+            {
+            }
+
+            /*
+             * Returns whether all elements of the value are known to be a multiple of the given number of bytes
+             */
+            bool isAlignedTo(uint32_t numBytes) const noexcept;
+
+            /*
+             * Returns the known offset to the given (power of two) alignment, if the offset is known
+             */
+            bool getOffsetTo(uint32_t numBytes, uint32_t& offset) const noexcept;
+
+            std::string to_string() const;
+
+            /*
+             * Determines the known alignment of the given value.
+             *
+             * The alignment is derived from the pointer types of parameters, globals and stack allocations, constant
+             * values and the arithmetic operations (e.g. additions, shifts, multiplications and masking) applied to
+             * them. Locals with multiple writers are aligned to the alignment common to all their writers.
+             */
+            static KnownAlignment getAlignment(const Value& val);
+        };
+    } // namespace analysis
+} // namespace vc4c
+
+#endif /* VC4C_ALIGNMENT_ANALYSIS_H */
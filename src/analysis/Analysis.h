@@ -9,8 +9,10 @@
 
 #include "../BasicBlock.h"
 #include "../intermediate/IntermediateInstruction.h"
+#include "ControlFlowGraph.h"
 #include "log.h"
 
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 
@@ -212,6 +214,142 @@ namespace vc4c
             std::unordered_map<const BasicBlock*, std::pair<Values, Values>> results;
         };
 
+        /*
+         * Template for global data-flow analyses, which are solved by a worklist algorithm over the control flow graph.
+         *
+         * In contrast to a LocalAnalysis, only the summaries of the basic blocks (the values at the start and the end
+         * of the blocks) are calculated and stored. The blocks are processed in reverse post-order (for forward
+         * analyses) or post-order (for backward analyses) of the CFG, which processes most of the blocks only after
+         * all their inputs are known. A block is only processed again, if the value of any of its predecessors (for
+         * forward analyses) or successors (for backward analyses) changed.
+         *
+         * The results for the single instructions can be calculated on demand by running a LocalAnalysis for a single
+         * block, starting with the value at the start (forward) or end (backward) of that block.
+         */
+        template <AnalysisDirection D, typename V, typename... Args>
+        class GlobalDataFlowAnalysis
+        {
+        public:
+            static constexpr AnalysisDirection Direction = D;
+            using Values = V;
+            /*
+             * Calculates the value at the end (for forward analyses) or start (for backward analyses) of the block from
+             * the given value at the other end of the block
+             */
+            using TransferFunction = std::function<V(const BasicBlock&, const V&, Args&...)>;
+            /*
+             * Merges the given value of the neighbor block (the predecessor for forward analyses, the successor for
+             * backward analyses) into the value of the block (the first parameter) and returns whether that value
+             * changed.
+             *
+             * NOTE: The merge function is only called with the changed values of the neighbors, so it needs to be
+             * monotonic, e.g. only add to (union) or only remove from (intersection) the value of the block.
+             */
+            using MeetFunction = std::function<bool(V&, const V&, const BasicBlock& block, const BasicBlock& neighbor)>;
+
+            /*
+             * Analyses the given method and fills the internal result store
+             */
+            void operator()(Method& method, Args&... args)
+            {
+                auto order = method.getCFG().getReversePostOrder();
+                if(Direction == AnalysisDirection::BACKWARD)
+                    std::reverse(order.begin(), order.end());
+
+                results.clear();
+                results.reserve(order.size());
+                FastMap<const CFGNode*, std::size_t> positions;
+                positions.reserve(order.size());
+                // the positions (in processing order) of the blocks still to be processed, initially all blocks
+                SortedSet<std::size_t> pendingBlocks;
+                for(std::size_t i = 0; i < order.size(); ++i)
+                {
+                    // all entries are inserted before the first block is processed, so the references stay valid
+                    results.emplace(order[i]->key, std::make_pair(initialValue, initialValue));
+                    positions.emplace(order[i], i);
+                    pendingBlocks.emplace(i);
+                }
+                FastAccessList<bool> processedBlocks(order.size(), false);
+
+                while(!pendingBlocks.empty())
+                {
+                    auto position = *pendingBlocks.begin();
+                    pendingBlocks.erase(pendingBlocks.begin());
+                    const CFGNode& node = *order[position];
+                    auto& entry = results.at(node.key);
+                    auto& input = Direction == AnalysisDirection::FORWARD ? entry.first : entry.second;
+                    auto& output = Direction == AnalysisDirection::FORWARD ? entry.second : entry.first;
+
+                    auto newOutput = transferFunction(*node.key, input, args...);
+                    if(processedBlocks[position] && newOutput == output)
+                        // the neighbors already know this value
+                        continue;
+                    processedBlocks[position] = true;
+                    output = std::move(newOutput);
+
+                    auto propagate = [&](const CFGNode& neighbor, const CFGEdge&) -> bool {
+                        auto& neighborEntry = results.at(neighbor.key);
+                        auto& neighborInput =
+                            Direction == AnalysisDirection::FORWARD ? neighborEntry.first : neighborEntry.second;
+                        if(meetFunction(neighborInput, output, *neighbor.key, *node.key))
+                            pendingBlocks.emplace(positions.at(&neighbor));
+                        return true;
+                    };
+                    if(Direction == AnalysisDirection::FORWARD)
+                        node.forAllOutgoingEdges(propagate);
+                    else
+                        node.forAllIncomingEdges(propagate);
+                }
+            }
+
+            /*
+             * Returns the value at the start of the given block (before the block is executed)
+             */
+            const Values& getInitialResult(const BasicBlock& block) const
+            {
+                return results.at(&block).first;
+            }
+
+            /*
+             * Returns the value at the end of the given block (after the block is executed)
+             */
+            const Values& getFinalResult(const BasicBlock& block) const
+            {
+                return results.at(&block).second;
+            }
+
+            void dumpResults(const Method& method) const
+            {
+                logging::logLazy(logging::Level::DEBUG, [&]() {
+                    for(const BasicBlock& block : method)
+                    {
+                        logging::debug() << block.to_string() << " (in) : " << dumpFunction(getInitialResult(block))
+                                         << logging::endl;
+                        logging::debug() << block.to_string() << " (out) : " << dumpFunction(getFinalResult(block))
+                                         << logging::endl;
+                    }
+                });
+            }
+
+        protected:
+            GlobalDataFlowAnalysis(TransferFunction&& transferFunction, MeetFunction&& meetFunction,
+                DumpFunction<Values>&& dumpFunction, Values&& initialValue = {}) :
+                transferFunction(std::forward<TransferFunction>(transferFunction)),
+                meetFunction(std::forward<MeetFunction>(meetFunction)),
+                dumpFunction(std::forward<DumpFunction<Values>>(dumpFunction)),
+                initialValue(std::forward<Values>(initialValue))
+            {
+            }
+
+            const TransferFunction transferFunction;
+            const MeetFunction meetFunction;
+            const DumpFunction<Values> dumpFunction;
+            // the value at the start and end of the blocks
+            FastMap<const BasicBlock*, std::pair<Values, Values>> results;
+            // the value all blocks start with before they are analyzed
+            const Values initialValue;
+        };
+
         template <typename AnalysisA, typename AnalysisB, typename... Args>
         class CombinedLocalAnalysis
         {
@@ -0,0 +1,142 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "AnalysisManager.h"
+
+#include "../Profiler.h"
+#include "ControlFlowGraph.h"
+#include "DataDependencyGraph.h"
+#include "DivergenceAnalysis.h"
+#include "DominatorTree.h"
+#include "LivenessAnalysis.h"
+
+using namespace vc4c;
+using namespace vc4c::analysis;
+
+AnalysisManager::AnalysisManager(Method& method) :
+    method(method), validAnalyses(CachedAnalysis::NONE), recursiveLoops(false)
+{
+}
+
+AnalysisManager::~AnalysisManager() = default;
+
+const DominatorTree& AnalysisManager::getDominatorTree()
+{
+    if(!isValid(CachedAnalysis::DOMINATOR_TREE))
+    {
+        dominatorTree = DominatorTree::createDominatorTree(method.getCFG());
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::DOMINATOR_TREE);
+    }
+    return *dominatorTree;
+}
+
+const DominatorTree& AnalysisManager::getPostDominatorTree()
+{
+    if(!isValid(CachedAnalysis::POST_DOMINATOR_TREE))
+    {
+        postDominatorTree = DominatorTree::createPostDominatorTree(method.getCFG());
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::POST_DOMINATOR_TREE);
+    }
+    return *postDominatorTree;
+}
+
+const FastAccessList<ControlFlowLoop>& AnalysisManager::getLoops(bool recursively)
+{
+    if(!isValid(CachedAnalysis::LOOPS) || recursiveLoops != recursively)
+    {
+        const auto& dominators = getDominatorTree();
+        loops = method.getCFG().findLoops(recursively, true, &dominators);
+        recursiveLoops = recursively;
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::LOOPS);
+    }
+    else
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 120, "Cached loops reused", 1);
+    return loops;
+}
+
+const DataDependencyGraph& AnalysisManager::getDataDependencies()
+{
+    if(!isValid(CachedAnalysis::DATA_DEPENDENCIES))
+    {
+        dataDependencies = DataDependencyGraph::createDependencyGraph(method);
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::DATA_DEPENDENCIES);
+    }
+    else
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 121, "Cached data dependencies reused", 1);
+    return *dataDependencies;
+}
+
+const FastMap<const Local*, ValueRange>& AnalysisManager::getValueRanges()
+{
+    if(!isValid(CachedAnalysis::VALUE_RANGES))
+    {
+        valueRanges = ValueRange::determineValueRanges(method);
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::VALUE_RANGES);
+    }
+    return valueRanges;
+}
+
+const FastAccessList<LoopInfo>& AnalysisManager::getLoopInfos()
+{
+    if(!isValid(CachedAnalysis::LOOP_INFO))
+    {
+        // the loop information is stored independently of the cached loops, so re-calculating them (e.g.
+        // non-recursively) afterwards does not affect it
+        const auto& nestedLoops = getLoops(true);
+        const auto& dependencies = getDataDependencies();
+        ValueRangeCache ranges{method};
+        loopInfos = LoopInfo::determineLoopInfos(nestedLoops, dependencies, ranges);
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::LOOP_INFO);
+    }
+    else
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 123, "Cached loop infos reused", 1);
+    return loopInfos;
+}
+
+const RegisterPressureAnalysis& AnalysisManager::getRegisterPressure()
+{
+    if(!isValid(CachedAnalysis::REGISTER_PRESSURE))
+    {
+        registerPressure.reset(new RegisterPressureAnalysis());
+        (*registerPressure)(method);
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::REGISTER_PRESSURE);
+    }
+    return *registerPressure;
+}
+
+const DivergenceAnalysis& AnalysisManager::getDivergence()
+{
+    if(!isValid(CachedAnalysis::DIVERGENCE))
+    {
+        divergence = DivergenceAnalysis::analyze(method, getPostDominatorTree());
+        validAnalyses = add_flag(validAnalyses, CachedAnalysis::DIVERGENCE);
+    }
+    return *divergence;
+}
+
+void AnalysisManager::invalidate(CachedAnalysis preservedAnalyses)
+{
+    validAnalyses = intersect_flags(validAnalyses, preservedAnalyses);
+}
+
+void AnalysisManager::release()
+{
+    validAnalyses = CachedAnalysis::NONE;
+    dominatorTree.reset();
+    postDominatorTree.reset();
+    // assigning empty containers (instead of clearing them) also frees their storage
+    loops = FastAccessList<ControlFlowLoop>{};
+    dataDependencies.reset();
+    valueRanges = FastMap<const Local*, ValueRange>{};
+    loopInfos = FastAccessList<LoopInfo>{};
+    registerPressure.reset();
+    divergence.reset();
+}
+
+bool AnalysisManager::isValid(CachedAnalysis analysis) const
+{
+    return has_flag(validAnalyses, analysis);
+}
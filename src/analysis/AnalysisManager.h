@@ -0,0 +1,131 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_ANALYSIS_MANAGER_H
+#define VC4C_ANALYSIS_MANAGER_H
+
+#include "../Method.h"
+#include "../performance.h"
+#include "ControlFlowLoop.h"
+#include "LoopInfo.h"
+#include "ValueRange.h"
+
+#include <memory>
+
+namespace vc4c
+{
+    namespace analysis
+    {
+        struct DominatorTree;
+        class DataDependencyGraph;
+        class DivergenceAnalysis;
+        class RegisterPressureAnalysis;
+
+        /*
+         * The analysis results which can be cached by the AnalysisManager.
+         *
+         * Used as bit-field of the analyses which stay valid after a modification of the method.
+         */
+        enum class CachedAnalysis : unsigned char
+        {
+            NONE = 0,
+            // the dominator tree of the control flow graph
+            DOMINATOR_TREE = 1,
+            // the (non-recursive and recursive) loops of the control flow graph
+            LOOPS = 2,
+            // the data dependencies between the basic blocks
+            DATA_DEPENDENCIES = 4,
+            // the value ranges of the locals
+            VALUE_RANGES = 8,
+            // the post-dominator tree of the control flow graph
+            POST_DOMINATOR_TREE = 16,
+            // the induction variables, trip counts and nesting of the loops
+            LOOP_INFO = 32,
+            // the number of live locals per instruction
+            REGISTER_PRESSURE = 64,
+            // the uniformity of the locals across SIMD elements and work-items
+            DIVERGENCE = 128,
+            // all analyses depending only on the shape of the control flow graph
+            CONTROL_FLOW = DOMINATOR_TREE | LOOPS | POST_DOMINATOR_TREE,
+            ALL = DOMINATOR_TREE | LOOPS | DATA_DEPENDENCIES | VALUE_RANGES | POST_DOMINATOR_TREE | LOOP_INFO |
+                REGISTER_PRESSURE | DIVERGENCE
+        };
+
+        /*
+         * Caches the results of method-wide analyses, so they are only re-calculated when the method is modified in a
+         * way which invalidates the results.
+         *
+         * Any modification of the control flow (inserting/removing blocks or branches, moving blocks) automatically
+         * invalidates all cached results, other modifications need to be reported by calling #invalidate() with the
+         * set of analyses which are preserved by the modification (e.g. after every optimization pass).
+         *
+         * NOTE: Invalidating a result does not destroy it, the references returned by the getters stay valid until the
+         * same getter is called again after the result has been invalidated.
+         */
+        class AnalysisManager : private NonCopyable
+        {
+        public:
+            explicit AnalysisManager(Method& method);
+            ~AnalysisManager();
+
+            const DominatorTree& getDominatorTree();
+            const DominatorTree& getPostDominatorTree();
+            /*
+             * Returns the loops of the method's control flow graph, see ControlFlowGraph#findLoops()
+             */
+            const FastAccessList<ControlFlowLoop>& getLoops(bool recursively);
+            const DataDependencyGraph& getDataDependencies();
+            /*
+             * Returns the value ranges of all locals in the method, see ValueRange#determineValueRanges()
+             */
+            const FastMap<const Local*, ValueRange>& getValueRanges();
+            /*
+             * Returns the loop information (induction variables, trip counts and nesting) for all (nested) loops of the
+             * method, see LoopInfo#determineLoopInfos()
+             */
+            const FastAccessList<LoopInfo>& getLoopInfos();
+            /*
+             * Returns the estimated register pressure for all instructions of the method, see RegisterPressureAnalysis
+             */
+            const RegisterPressureAnalysis& getRegisterPressure();
+            /*
+             * Returns the uniformity of all locals across the SIMD elements and the work-items, see DivergenceAnalysis
+             */
+            const DivergenceAnalysis& getDivergence();
+
+            /*
+             * Marks all cached results as invalid, except for the given preserved analyses
+             */
+            void invalidate(CachedAnalysis preservedAnalyses = CachedAnalysis::NONE);
+            /*
+             * Invalidates all cached results and releases their memory, e.g. when exceeding the memory limit (see
+             * Configuration#maxCompilationMemory).
+             *
+             * NOTE: In contrast to #invalidate(), this also invalidates the references returned by the getters!
+             */
+            void release();
+
+        private:
+            Method& method;
+            // the bit-field of the currently valid cached results
+            CachedAnalysis validAnalyses;
+            // whether the cached loops were determined recursively
+            bool recursiveLoops;
+            std::unique_ptr<DominatorTree> dominatorTree;
+            std::unique_ptr<DominatorTree> postDominatorTree;
+            FastAccessList<ControlFlowLoop> loops;
+            std::unique_ptr<DataDependencyGraph> dataDependencies;
+            FastMap<const Local*, ValueRange> valueRanges;
+            FastAccessList<LoopInfo> loopInfos;
+            std::unique_ptr<RegisterPressureAnalysis> registerPressure;
+            std::unique_ptr<DivergenceAnalysis> divergence;
+
+            bool isValid(CachedAnalysis analysis) const;
+        };
+    } // namespace analysis
+} // namespace vc4c
+
+#endif /* VC4C_ANALYSIS_MANAGER_H */
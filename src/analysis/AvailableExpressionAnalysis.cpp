@@ -22,7 +22,7 @@ AvailableExpressionAnalysis::AvailableExpressionAnalysis() :
 
 std::pair<AvailableExpressions, std::shared_ptr<Expression>> AvailableExpressionAnalysis::analyzeAvailableExpressions(
     const intermediate::IntermediateInstruction* instr, const AvailableExpressions& previousExpressions,
-    FastMap<const Local*, FastSet<std::shared_ptr<Expression>>>& cache, unsigned maxExpressionDistance)
+    FastMap<const Local*, FastSet<const Expression*>>& readers, ExpressionTable& table, unsigned maxExpressionDistance)
 {
     PROFILE_START(AvailableExpressionAnalysis);
     AvailableExpressions newExpressions(previousExpressions);
@@ -45,25 +45,29 @@ std::pair<AvailableExpressions, std::shared_ptr<Expression>> AvailableExpression
     if(auto loc = instr->checkOutputLocal())
     {
         // re-set all expressions using the local written to as input
-        auto cacheIt = cache.find(loc);
-        if(cacheIt != cache.end())
+        auto readersIt = readers.find(loc);
+        if(readersIt != readers.end())
         {
-            for(const auto& expr : cacheIt->second)
+            for(auto expr : readersIt->second)
                 newExpressions.erase(expr);
         }
         if((expr = Expression::createExpression(*instr)))
         {
-            // only adds if expression is not already in there
-            auto it = newExpressions.emplace(expr, std::make_pair(instr, 0));
+            // the same expression is always interned as the same node, so it is only added once
+            expr = table.canonicalize(*expr);
+            auto it = newExpressions.emplace(expr.get(), std::make_pair(instr, 0));
             if(it.second)
             {
                 // add map from input locals to expression (if we really inserted an expression)
                 for(const auto& loc : instr->getUsedLocals())
                 {
                     if(has_flag(loc.second, LocalUse::Type::READER))
-                        cache[loc.first].emplace(it.first->first);
+                        readers[loc.first].emplace(it.first->first);
                 }
             }
+            else
+                // refer to the latest calculation of the expression
+                it.first->second = std::make_pair(instr, 0u);
         }
     }
     PROFILE_END(AvailableExpressionAnalysis);
@@ -72,9 +76,11 @@ std::pair<AvailableExpressions, std::shared_ptr<Expression>> AvailableExpression
 
 AvailableExpressions AvailableExpressionAnalysis::analyzeAvailableExpressionsWrapper(
     const intermediate::IntermediateInstruction* instr, const AvailableExpressions& previousExpressions,
-    FastMap<const Local*, FastSet<std::shared_ptr<Expression>>>& cache)
+    AvailableExpressionCache& cache)
 {
-    return analyzeAvailableExpressions(instr, previousExpressions, cache, std::numeric_limits<unsigned>::max()).first;
+    return analyzeAvailableExpressions(
+        instr, previousExpressions, cache.readers, cache.table, std::numeric_limits<unsigned>::max())
+        .first;
 }
 
 LCOV_EXCL_START
@@ -106,32 +112,32 @@ void AvailableExpressionAnalysis::dumpGraph(const AvailableExpressions& expressi
     for(const auto& pair : expressions)
     {
         const auto& expr = pair.first;
-        graph.addNode(expr.get(), expr->code.name);
+        graph.addNode(expr, expr->code.name);
         if(auto val = expr->arg0.checkValue())
         {
             graph.addNode(&expr->arg0, val.to_string());
-            graph.addEdge(expr.get(), &expr->arg0, false, "left", vc4c::Direction::FIRST_TO_SECOND);
+            graph.addEdge(expr, &expr->arg0, false, "left", vc4c::Direction::FIRST_TO_SECOND);
         }
         else if(auto child = expr->arg0.checkExpression())
         {
             graph.addNode(child.get(), child->code.name);
-            graph.addEdge(expr.get(), child.get(), false, "left", vc4c::Direction::FIRST_TO_SECOND);
+            graph.addEdge(expr, child.get(), false, "left", vc4c::Direction::FIRST_TO_SECOND);
         }
         if(auto val = expr->arg1.checkValue())
         {
             graph.addNode(&expr->arg1, val.to_string());
-            graph.addEdge(expr.get(), &expr->arg1, false, "right", vc4c::Direction::FIRST_TO_SECOND);
+            graph.addEdge(expr, &expr->arg1, false, "right", vc4c::Direction::FIRST_TO_SECOND);
         }
         else if(auto child = expr->arg1.checkExpression())
         {
             graph.addNode(child.get(), child->code.name);
-            graph.addEdge(expr.get(), child.get(), false, "right", vc4c::Direction::FIRST_TO_SECOND);
+            graph.addEdge(expr, child.get(), false, "right", vc4c::Direction::FIRST_TO_SECOND);
         }
 
         if(auto loc = pair.second.first->checkOutputLocal())
         {
             graph.addNode(loc, loc->to_string());
-            graph.addEdge(loc, expr.get(), true, "", vc4c::Direction::FIRST_TO_SECOND);
+            graph.addEdge(loc, expr, true, "", vc4c::Direction::FIRST_TO_SECOND);
         }
     }
 
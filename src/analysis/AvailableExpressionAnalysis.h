@@ -23,8 +23,17 @@ namespace vc4c
          * See also: https://en.wikipedia.org/wiki/Available_expression
          *
          */
-        class AvailableExpressionAnalysis : public LocalAnalysis<AnalysisDirection::FORWARD, AvailableExpressions,
-                                                FastMap<const Local*, FastSet<std::shared_ptr<Expression>>>>
+        /*
+         * The expressions interned while analyzing a block and the available expressions reading the locals
+         */
+        struct AvailableExpressionCache
+        {
+            ExpressionTable table;
+            FastMap<const Local*, FastSet<const Expression*>> readers;
+        };
+
+        class AvailableExpressionAnalysis
+            : public LocalAnalysis<AnalysisDirection::FORWARD, AvailableExpressions, AvailableExpressionCache>
         {
         public:
             explicit AvailableExpressionAnalysis();
@@ -37,12 +46,16 @@ namespace vc4c
              * NOTE: Usage of this function directly and dropping of old results is highly recommended over running the
              * analysis over the whole block!
              *
-             * Returns the available expressions for the instruction and the expression generated by the instruction, if
-             * any.
+             * The expressions are interned in the given table, so the same table needs to be used for all
+             * instructions whose available expressions are compared.
+             *
+             * Returns the available expressions for the instruction and the (interned) expression generated by the
+             * instruction, if any.
              */
             static std::pair<AvailableExpressions, std::shared_ptr<Expression>> analyzeAvailableExpressions(
                 const intermediate::IntermediateInstruction* instr, const AvailableExpressions& previousExpressions,
-                FastMap<const Local*, FastSet<std::shared_ptr<Expression>>>& cache, unsigned maxExpressionDistance);
+                FastMap<const Local*, FastSet<const Expression*>>& readers, ExpressionTable& table,
+                unsigned maxExpressionDistance);
 
             static std::string to_string(const AvailableExpressions& expressions);
 
@@ -59,7 +72,7 @@ namespace vc4c
              */
             static AvailableExpressions analyzeAvailableExpressionsWrapper(
                 const intermediate::IntermediateInstruction* instr, const AvailableExpressions& previousExpressions,
-                FastMap<const Local*, FastSet<std::shared_ptr<Expression>>>& cache);
+                AvailableExpressionCache& cache);
         };
     } /* namespace analysis */
 } /* namespace vc4c */
@@ -12,6 +12,7 @@
 
 #include "log.h"
 
+#include <algorithm>
 #include <numeric>
 #include <queue>
 #include <sstream>
@@ -211,16 +212,13 @@ FastAccessList<ControlFlowLoop> ControlFlowGraph::findLoops(
     }
 
     // Merge loops for different branches, e.g. for if-else, switch-case or inner loops taken/not taken
-    FastMap<const ControlFlowLoop*, FastAccessList<const analysis::DominatorTreeNode*>> dominatorChains;
+    FastMap<const ControlFlowLoop*, FastAccessList<const CFGNode*>> dominatorChains;
     for(auto& loop : loops)
     {
         auto& chain = dominatorChains[&loop];
         chain.reserve(loop.size());
         for(auto entry : loop)
-        {
-            auto node = dominators->findNode(entry);
-            chain.emplace_back(node ? node->getSinglePredecessor() : nullptr);
-        }
+            chain.emplace_back(dominators->getImmediateDominator(*entry));
 
         // Remove adjacent duplicate dominators, as they e.g. happen for if-without-else, if-else, switch-case and
         // loops. This allows us to simply check for equality of the dominator chains to cover all the cases listed
@@ -644,6 +642,59 @@ void ControlFlowGraph::traverseDepthFirst(const std::function<ControlFlowVisitRe
     traverseDepthFirstHelper(start, consumer);
 }
 
+FastAccessList<const CFGNode*> ControlFlowGraph::getReversePostOrder() const
+{
+    FastAccessList<const CFGNode*> order;
+    if(nodes.empty())
+        return order;
+    order.reserve(nodes.size());
+    FastSet<const CFGNode*> visitedNodes;
+    visitedNodes.reserve(nodes.size());
+    // the nodes currently on the depth-first path together with their successors not yet visited. This is done
+    // iteratively instead of recursively to not overflow the stack for big kernels
+    FastAccessList<std::pair<const CFGNode*, FastAccessList<const CFGNode*>>> stack;
+    auto visitTree = [&](const CFGNode& root) {
+        auto treeStart = order.size();
+        stack.emplace_back(&root, FastAccessList<const CFGNode*>{});
+        visitedNodes.emplace(&root);
+        root.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge&) -> bool {
+            stack.back().second.push_back(&successor);
+            return true;
+        });
+        while(!stack.empty())
+        {
+            if(stack.back().second.empty())
+            {
+                // all successors are visited, so the node is finished
+                order.push_back(stack.back().first);
+                stack.pop_back();
+                continue;
+            }
+            auto next = stack.back().second.back();
+            stack.back().second.pop_back();
+            if(!visitedNodes.emplace(next).second)
+                continue;
+            stack.emplace_back(next, FastAccessList<const CFGNode*>{});
+            next->forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge&) -> bool {
+                stack.back().second.push_back(&successor);
+                return true;
+            });
+        }
+        // the post-order of the nodes reachable from this root
+        std::reverse(order.begin() + static_cast<std::ptrdiff_t>(treeStart), order.end());
+    };
+
+    auto& start = const_cast<ControlFlowGraph&>(*this).getStartOfControlFlow();
+    visitTree(start);
+    for(auto& block : start.key->method)
+    {
+        auto nodeIt = nodes.find(&block);
+        if(nodeIt != nodes.end() && visitedNodes.find(&nodeIt->second) == visitedNodes.end())
+            visitTree(nodeIt->second);
+    }
+    return order;
+}
+
 ControlFlowLoop ControlFlowGraph::findLoopsHelper(const CFGNode* node, FastMap<const CFGNode*, int>& discoveryTimes,
     FastMap<const CFGNode*, int>& lowestReachable, FastModificationList<const CFGNode*>& stack, int& time)
 {
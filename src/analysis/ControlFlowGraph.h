@@ -135,6 +135,16 @@ namespace vc4c
              */
             void traverseDepthFirst(const std::function<ControlFlowVisitResult(const CFGNode&)>& consumer) const;
 
+            /**
+             * Returns all nodes of this CFG in reverse post-order of a depth-first traversal starting at the start of
+             * the control flow.
+             *
+             * In this order, every node is located before all its successors, except for the successors reached via
+             * back edges (e.g. the loop headers). Nodes not reachable from the start of the control flow are appended
+             * (in the order of their basic blocks) after all reachable nodes.
+             */
+            FastAccessList<const CFGNode*> getReversePostOrder() const;
+
         private:
             explicit ControlFlowGraph(std::size_t numBlocks) : Graph(numBlocks) {}
             /*
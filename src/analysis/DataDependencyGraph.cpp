@@ -8,6 +8,7 @@
 
 #include "../InstructionWalker.h"
 #include "../Profiler.h"
+#include "../ThreadPool.h"
 #include "ControlFlowGraph.h"
 #include "DebugGraph.h"
 #include "LivenessAnalysis.h"
@@ -82,57 +83,95 @@ static InstructionMapping mapInstructionsToPosition(Method& method)
     return mapping;
 }
 
-static void findDependencies(BasicBlock& bb, DataDependencyGraph& graph, InstructionMapping& mapping)
+/*
+ * A single data dependency of a basic block, found by #findDependencies()
+ */
+struct FoundDependency
+{
+    // the other basic block
+    const BasicBlock* otherBlock;
+    // the local the dependency is for
+    const Local* local;
+    DataDependencyType type;
+    // whether the dependency is for a local read in block (true) or written in the block (false)
+    bool isRead;
+};
+
+/*
+ * Collects the dependencies of the given basic block without modifying the graph, so this can be run for multiple
+ * blocks in parallel
+ */
+static FastAccessList<FoundDependency> findDependencies(const BasicBlock& bb, const InstructionMapping& mapping)
 {
+    FastAccessList<FoundDependency> dependencies;
     for(const auto& inst : bb)
     {
         if(!inst)
             continue;
-        inst->forUsedLocals([&bb, &mapping, &graph](const Local* local, LocalUse::Type type,
+        inst->forUsedLocals([&bb, &mapping, &dependencies](const Local* local, LocalUse::Type type,
                                 const intermediate::IntermediateInstruction& inst) -> void {
             if(has_flag(type, LocalUse::Type::READER) && !local->type.isLabelType())
             {
-                local->forUsers(LocalUse::Type::WRITER, [local, &bb, &mapping, &graph](const LocalUser* user) -> void {
-                    auto& instIt = mapping.at(user);
-
-                    // add local to relation (may not yet exist)
-                    if(instIt.getBasicBlock() != &bb ||
-                        instIt->hasDecoration(intermediate::InstructionDecorations::PHI_NODE))
-                    {
-                        auto type = DataDependencyType::FLOW;
-                        if(instIt->hasDecoration(intermediate::InstructionDecorations::PHI_NODE))
-                            type = add_flag(type, DataDependencyType::PHI);
-
-                        auto& neighbor = graph.getOrCreateNode(instIt.getBasicBlock());
-                        auto& neighborDependencies =
-                            graph.getOrCreateNode(&bb).getOrCreateEdge(&neighbor).addInput(neighbor).data;
-                        neighborDependencies[instIt.getBasicBlock()][const_cast<Local*>(local)] =
-                            add_flag(neighborDependencies[instIt.getBasicBlock()][const_cast<Local*>(local)], type);
-                    }
-                });
+                local->forUsers(
+                    LocalUse::Type::WRITER, [local, &bb, &mapping, &dependencies](const LocalUser* user) -> void {
+                        auto& instIt = mapping.at(user);
+
+                        // add local to relation (may not yet exist)
+                        if(instIt.getBasicBlock() != &bb ||
+                            instIt->hasDecoration(intermediate::InstructionDecorations::PHI_NODE))
+                        {
+                            auto type = DataDependencyType::FLOW;
+                            if(instIt->hasDecoration(intermediate::InstructionDecorations::PHI_NODE))
+                                type = add_flag(type, DataDependencyType::PHI);
+                            dependencies.emplace_back(FoundDependency{instIt.getBasicBlock(), local, type, true});
+                        }
+                    });
             }
             if(has_flag(type, LocalUse::Type::WRITER) && !local->type.isLabelType())
             {
-                local->forUsers(
-                    LocalUse::Type::READER, [&inst, local, &bb, &mapping, &graph](const LocalUser* user) -> void {
+                local->forUsers(LocalUse::Type::READER,
+                    [&inst, local, &bb, &mapping, &dependencies](const LocalUser* user) -> void {
                         auto& instIt = mapping.at(user);
 
                         // add local to relation (may not yet exist)
                         if(instIt.getBasicBlock() != &bb ||
                             inst.hasDecoration(intermediate::InstructionDecorations::PHI_NODE))
-                        {
-                            auto& node = graph.getOrCreateNode(&bb);
-                            auto& neighborDependencies =
-                                node.getOrCreateEdge(&graph.getOrCreateNode(instIt.getBasicBlock()))
-                                    .addInput(node)
-                                    .data;
-                            neighborDependencies[&bb][const_cast<Local*>(local)] = add_flag(
-                                neighborDependencies[&bb][const_cast<Local*>(local)], DataDependencyType::ANTI);
-                        }
+                            dependencies.emplace_back(
+                                FoundDependency{instIt.getBasicBlock(), local, DataDependencyType::ANTI, false});
                     });
             }
         });
     }
+    return dependencies;
+}
+
+using BlockDependencies = std::pair<BasicBlock*, FastAccessList<FoundDependency>>;
+
+static void insertDependencies(
+    BasicBlock& bb, DataDependencyGraph& graph, const FastAccessList<FoundDependency>& dependencies)
+{
+    for(const auto& dependency : dependencies)
+    {
+        auto otherBlock = const_cast<BasicBlock*>(dependency.otherBlock);
+        auto local = const_cast<Local*>(dependency.local);
+        if(dependency.isRead)
+        {
+            // the local is written in the other block and read in this block
+            auto& neighbor = graph.getOrCreateNode(otherBlock);
+            auto& neighborDependencies = graph.getOrCreateNode(&bb).getOrCreateEdge(&neighbor).addInput(neighbor).data;
+            auto& dependencyType = neighborDependencies[otherBlock][local];
+            dependencyType = add_flag(dependencyType, dependency.type);
+        }
+        else
+        {
+            // the local is written in this block and read in the other block
+            auto& node = graph.getOrCreateNode(&bb);
+            auto& neighborDependencies =
+                node.getOrCreateEdge(&graph.getOrCreateNode(otherBlock)).addInput(node).data;
+            auto& dependencyType = neighborDependencies[&bb][local];
+            dependencyType = add_flag(dependencyType, dependency.type);
+        }
+    }
 }
 
 static void makeTransitive(
@@ -140,7 +179,7 @@ static void makeTransitive(
 {
     for(auto& cfgNode : cfg.getNodes())
     {
-        auto& startLiveLocals = analysis.getLocalAnalysis(*cfgNode.first).getStartResult();
+        auto& startLiveLocals = analysis.getIncomingLiveLocals(*cfgNode.first);
         auto& node = graph.getOrCreateNode(cfgNode.first);
 
         // a basic block has all incoming live locals as dependencies to all direct successor blocks
@@ -190,10 +229,25 @@ std::unique_ptr<DataDependencyGraph> DataDependencyGraph::createDependencyGraph(
     PROFILE_START(createDataDependencyGraph);
     InstructionMapping mapping = mapInstructionsToPosition(method);
     std::unique_ptr<DataDependencyGraph> graph(new DataDependencyGraph(method.size()));
+
+    // Finding the dependencies only reads the instructions and the users of the locals, so it can be done for all
+    // blocks in parallel. The results are then inserted in block order, to create the same graph as if the blocks were
+    // processed sequentially.
+    FastAccessList<BlockDependencies> blockDependencies;
+    blockDependencies.reserve(method.size());
+    FastAccessList<BlockDependencies*> pendingBlocks;
+    pendingBlocks.reserve(method.size());
     for(auto& block : method)
     {
-        findDependencies(block, *graph, mapping);
+        blockDependencies.emplace_back(&block, FastAccessList<FoundDependency>{});
+        pendingBlocks.emplace_back(&blockDependencies.back());
     }
+    ThreadPool::getDefaultPool().scheduleAll<BlockDependencies*>(
+        pendingBlocks, [&mapping](BlockDependencies* const& entry) {
+            entry->second = findDependencies(*entry->first, mapping);
+        });
+    for(auto& entry : blockDependencies)
+        insertDependencies(*entry.first, *graph, entry.second);
 
 #ifdef DEBUG_MODE
     LCOV_EXCL_START
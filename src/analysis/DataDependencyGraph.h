@@ -50,8 +50,9 @@ namespace vc4c
             FastSet<const Local*> getAllOutgoingDependencies() const;
         };
 
+        // Most blocks only depend on few other blocks, so store the edges compactly
         using DataDependencyNode =
-            Node<BasicBlock*, DataDependency, Directionality::BIDIRECTIONAL, DataDependencyNodeBase>;
+            Node<BasicBlock*, DataDependency, Directionality::BIDIRECTIONAL, DataDependencyNodeBase, true>;
         using DataDependencyEdge = typename DataDependencyNode::EdgeType;
 
         /*
@@ -7,6 +7,8 @@
 #include "DependencyGraph.h"
 
 #include "../InstructionWalker.h"
+#include "../Method.h"
+#include "../Module.h"
 #include "../Profiler.h"
 #include "../helper.h"
 #include "../intermediate/IntermediateInstruction.h"
@@ -159,6 +161,15 @@ std::size_t DependencyNodeBase::calculateSucceedingCriticalPathLength(
     return maxLength;
 }
 
+unsigned analysis::getExpectedStallCycles(
+    const intermediate::IntermediateInstruction& inst, const TargetProfile& target)
+{
+    auto semaphore = dynamic_cast<const intermediate::SemaphoreAdjustment*>(&inst);
+    if(inst.readsRegister(REG_MUTEX) || (semaphore && !semaphore->increase))
+        return target.mutexAcquireLatency;
+    return 0;
+}
+
 static void addDependency(Dependency& dependency, DependencyType type, unsigned numCycles = 0, bool fixedDelay = false)
 {
     dependency.type = add_flag(dependency.type, type);
@@ -269,7 +280,7 @@ static void createR4Dependencies(DependencyGraph& graph, DependencyNode& node,
         if(lastTriggerOfR4->checkOutputRegister() & &Register::triggersReadOfR4)
         {
             // delay slots for SFU calculations
-            delayCycles = 2;
+            delayCycles = SFU_RESULT_LATENCY;
             fixedDelay = true;
         }
         // For reading from TMU, the actual reading of memory is done between writing the TMU address and the signals.
@@ -412,7 +423,8 @@ static void createUniformDependencies(DependencyGraph& graph, DependencyNode& no
              * uniforms can be accessed once more."
              * - Broadcom specification, page 22
              */
-            addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::VALUE_READ_AFTER_WRITE, 2, true);
+            addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::VALUE_READ_AFTER_WRITE,
+                UNIFORM_ADDRESS_LATENCY, true);
         }
         if(lastReadOfUniform != nullptr)
         {
@@ -428,7 +440,8 @@ static void createUniformDependencies(DependencyGraph& graph, DependencyNode& no
             // any writing of UNIFORM address must be ordered after the previous write
             auto& otherNode = graph.assertNode(lastWriteOfUniformAddress);
             // just to be sure, add the mandatory distance here too
-            addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::VALUE_READ_AFTER_WRITE, 2, true);
+            addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::VALUE_READ_AFTER_WRITE,
+                UNIFORM_ADDRESS_LATENCY, true);
         }
         if(lastReadOfUniform != nullptr)
         {
@@ -493,7 +506,9 @@ static void createVPMSetupDependencies(DependencyGraph& graph, DependencyNode& n
     {
         // any other VPM read setup, VPM read or VPM read address setup must be ordered after the VPM read setup
         auto& otherNode = graph.assertNode(lastVPMReadSetup);
-        addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER);
+        // the VPM read waits for the data to be available
+        addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER,
+            node.key->readsRegister(REG_VPM_IO) ? VPM_READ_SETUP_LATENCY : 0);
     }
 }
 
@@ -518,21 +533,23 @@ static void createVPMIODependencies(DependencyGraph& graph, DependencyNode& node
 
 static void createVPMAddressDependencies(DependencyGraph& graph, DependencyNode& node,
     const intermediate::IntermediateInstruction* lastVPMWriteAddress,
-    const intermediate::IntermediateInstruction* lastVPMReadAddress)
+    const intermediate::IntermediateInstruction* lastVPMReadAddress, const TargetProfile& target)
 {
     if(node.key->readsRegister(REG_VPM_DMA_STORE_WAIT))
     {
         // the VPM write wait instruction needs to be executed after the setting of the VPM write address
         auto& otherNode = graph.assertNode(lastVPMWriteAddress);
         // XXX correct delay
-        addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER, 10);
+        addDependency(
+            otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER, target.vpmDMAStoreLatency);
     }
     if(node.key->readsRegister(REG_VPM_DMA_LOAD_WAIT))
     {
         // the VPM read wait instruction needs to be executed after the setting of the VPM read address
         auto& otherNode = graph.assertNode(lastVPMReadAddress);
         // XXX correct delay
-        addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER, 6);
+        addDependency(
+            otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER, target.vpmDMALoadLatency);
     }
 }
 
@@ -564,13 +581,14 @@ static void createTMUCoordinateDependencies(DependencyGraph& graph, DependencyNo
     const intermediate::IntermediateInstruction* lastTMU1CoordsWrite,
     const intermediate::IntermediateInstruction* lastTMUNoswapWrite,
     const intermediate::IntermediateInstruction* lastSemaphoreAccess,
-    const intermediate::IntermediateInstruction* lastMemFence)
+    const intermediate::IntermediateInstruction* lastMemFence, const TargetProfile& target)
 {
     if(lastTMUNoswapWrite != nullptr && (node.key->checkOutputRegister() & &Register::isTextureMemoryUnit))
     {
         // do not re-order/keep minimum distance between TMU swapping configuration and writing TMU addresses
         auto& otherNode = graph.assertNode(lastTMUNoswapWrite);
-        addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER, 3, true);
+        addDependency(
+            otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER, TMU_NOSWAP_LATENCY, true);
     }
     if(lastTMU0CoordsWrite != nullptr &&
         (node.key->writesRegister(REG_TMU0_COORD_B_LOD_BIAS) ||
@@ -602,11 +620,10 @@ static void createTMUCoordinateDependencies(DependencyGraph& graph, DependencyNo
         auto& otherNode = graph.assertNode(lastMemFence);
         addDependency(otherNode.getOrCreateEdge(&node).data, DependencyType::PERIPHERY_ORDER);
     }
-    // TMU seems to need 9 cycles to load from cache and (additional?) 20 to load from memory
-    // Tests show a delay of 8 instructions in between (total of 9 cycles) to be the most efficient:
-    // 8 instructions inserted increase execution time almost not at all (a bit due to instruction fetching), 9+ do
-    // noticeably
-    const unsigned tmuLoadDelay = 8;
+    // The TMU needs 9 cycles to load from L2 cache (and up to 20 cycles to load from RAM). Tests on the Raspberry Pi
+    // show 8 instructions inserted to increase execution time almost not at all (a bit due to instruction fetching), 9+
+    // do noticeably
+    const unsigned tmuLoadDelay = target.tmuLoadLatency;
     if(node.key->getSignal() == SIGNAL_LOAD_TMU0)
     {
         // triggering of read from the FIFO depends on the memory address being set previously which fills the FIFO from
@@ -708,6 +725,7 @@ std::unique_ptr<DependencyGraph> DependencyGraph::createGraph(const BasicBlock&
 {
     PROFILE_START(createDependencyGraph);
     std::unique_ptr<DependencyGraph> graph(new DependencyGraph(block.size()));
+    const auto& target = block.getMethod().module.compilationConfig.target;
 
     const intermediate::IntermediateInstruction* lastSettingOfFlags = nullptr;
     const intermediate::IntermediateInstruction* lastConditional = nullptr;
@@ -761,10 +779,10 @@ std::unique_ptr<DependencyGraph> DependencyGraph::createGraph(const BasicBlock&
         createReplicationDependencies(*graph, node, lastReplicationWrite, lastReplicationRead);
         createVPMSetupDependencies(*graph, node, lastVPMWriteSetup, lastVPMReadSetup);
         createVPMIODependencies(*graph, node, lastVPMWrite, lastVPMRead);
-        createVPMAddressDependencies(*graph, node, lastVPMWriteAddress, lastVPMReadAddress);
+        createVPMAddressDependencies(*graph, node, lastVPMWriteAddress, lastVPMReadAddress, target);
         createVPMWaitDependencies(*graph, node, lastVPMWriteWait, lastVPMReadWait);
         createTMUCoordinateDependencies(*graph, node, lastTMU0CoordsWrite, lastTMU1CoordsWrite, lastTMUNoswapWrite,
-            lastSemaphoreAccess, lastMemFence);
+            lastSemaphoreAccess, lastMemFence, target);
         createThreadEndDependencies(*graph, node, lastHostInterrupt, lastProgramEnd);
         auto branch = dynamic_cast<const intermediate::Branch*>(inst.get());
         if(branch)
@@ -19,6 +19,7 @@ namespace vc4c
     }
 
     class BasicBlock;
+    struct TargetProfile;
 
     namespace analysis
     {
@@ -74,6 +75,31 @@ namespace vc4c
             // also could be used to go to "dependents and remove this instruction as dependency"
         };
 
+        /*
+         * The machine model of the latencies of the hardware units, given as the number of instructions which need to
+         * (or should) be executed between triggering an operation and using its result.
+         */
+        // The result of an SFU calculation can be read from r4 by the 3rd instruction after writing the SFU register
+        constexpr unsigned SFU_RESULT_LATENCY = 2;
+        // The number of requests which can be queued per TMU. Tests show that 9+ queued requests hang the QPU.
+        constexpr unsigned TMU_QUEUE_DEPTH = 8;
+        // The distance between changing the TMU swap configuration and writing the TMU address
+        constexpr unsigned TMU_NOSWAP_LATENCY = 3;
+        // "[...] there must be at least two nonuniform-accessing instructions following a pointer change before
+        // uniforms can be accessed once more." - Broadcom specification, page 22
+        constexpr unsigned UNIFORM_ADDRESS_LATENCY = 2;
+        // The VPM read FIFO is filled in the cycles following the VPM read setup, an earlier read stalls the QPU
+        constexpr unsigned VPM_READ_SETUP_LATENCY = 3;
+        // The latencies which depend on the memory system and the number of competing QPUs (the TMU load latency, the
+        // VPM DMA load and store durations and the stall cycles when acquiring the hardware mutex) are measured for the
+        // specific hardware and taken from the TargetProfile of the configuration.
+
+        /*
+         * Returns the number of cycles the given instruction is expected to stall the QPU (in addition to its own
+         * execution), independent of the latencies of the instructions it depends on
+         */
+        unsigned getExpectedStallCycles(const intermediate::IntermediateInstruction& inst, const TargetProfile& target);
+
         /*
          * A single dependency between two instructions within a basic block
          *
@@ -116,7 +142,7 @@ namespace vc4c
         struct DependencyNodeBase
         {
             using DependencyNode = Node<const intermediate::IntermediateInstruction*, Dependency,
-                Directionality::DIRECTED, DependencyNodeBase>;
+                Directionality::DIRECTED, DependencyNodeBase, true>;
 
             /*
              * Returns whether this instruction depends on any other instruction within the same basic block to be
@@ -186,8 +212,9 @@ namespace vc4c
                 FastMap<const intermediate::IntermediateInstruction*, std::size_t>* cache = nullptr) const;
         };
 
+        // The edges are mostly iterated (e.g. for calculating the critical path), so store them compactly
         using DependencyNode = Node<const intermediate::IntermediateInstruction*, Dependency, Directionality::DIRECTED,
-            DependencyNodeBase>;
+            DependencyNodeBase, true>;
         using DependencyEdge = typename DependencyNode::EdgeType;
 
         /*
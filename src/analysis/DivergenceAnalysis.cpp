@@ -0,0 +1,253 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "DivergenceAnalysis.h"
+
+#include "../GlobalValues.h"
+#include "../Profiler.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "ControlFlowGraph.h"
+#include "DominatorTree.h"
+#include "log.h"
+
+#include <algorithm>
+
+using namespace vc4c;
+using namespace vc4c::analysis;
+
+std::string analysis::toString(Uniformity uniformity)
+{
+    switch(uniformity)
+    {
+    case Uniformity::DIVERGENT:
+        return "divergent";
+    case Uniformity::LANE_UNIFORM:
+        return "lane uniform";
+    case Uniformity::GROUP_UNIFORM:
+        return "group uniform";
+    case Uniformity::UNIFORM:
+        return "uniform";
+    }
+    return "unknown";
+}
+
+static Uniformity getBuiltinUniformity(const BuiltinLocal& builtin)
+{
+    // the local IDs and the UNIFORM address are the only work-group information which differ per QPU
+    if(builtin.builtinType == BuiltinLocal::Type::LOCAL_IDS ||
+        builtin.builtinType == BuiltinLocal::Type::UNIFORM_ADDRESS)
+        return Uniformity::LANE_UNIFORM;
+    return Uniformity::UNIFORM;
+}
+
+Uniformity DivergenceAnalysis::getUniformity(const Local* local) const
+{
+    if(local->is<Parameter>() || local->is<Global>())
+        // the parameter values and the addresses of the globals are the same for all work-items
+        return Uniformity::UNIFORM;
+    if(local->is<StackAllocation>())
+        // every QPU has its own stack frame
+        return Uniformity::LANE_UNIFORM;
+    if(auto builtin = local->as<BuiltinLocal>())
+        return getBuiltinUniformity(*builtin);
+    auto it = uniformities.find(local);
+    return it != uniformities.end() ? it->second : Uniformity::DIVERGENT;
+}
+
+Uniformity DivergenceAnalysis::getUniformity(const Value& value) const
+{
+    if(auto local = value.checkLocal())
+        return getUniformity(local);
+    if(auto reg = value.checkRegister())
+    {
+        // the UNIFORMs are read by all QPUs, the per-work-item UNIFORMs (e.g. the local ID) are handled via the
+        // decorations of the reading instructions
+        auto result = value.isUniform() ? Uniformity::LANE_UNIFORM : Uniformity::DIVERGENT;
+        if(*reg == REG_UNIFORM || *reg == REG_ELEMENT_NUMBER)
+            result = add_flag(result, Uniformity::GROUP_UNIFORM);
+        return result;
+    }
+    // constants are the same for all work-items
+    return value.isUniform() ? Uniformity::UNIFORM : Uniformity::GROUP_UNIFORM;
+}
+
+bool DivergenceAnalysis::isLaneUniform(const Value& value) const
+{
+    return has_flag(getUniformity(value), Uniformity::LANE_UNIFORM);
+}
+
+bool DivergenceAnalysis::isGroupUniform(const Value& value) const
+{
+    return has_flag(getUniformity(value), Uniformity::GROUP_UNIFORM);
+}
+
+bool DivergenceAnalysis::isDivergentBlock(const BasicBlock& block) const
+{
+    return divergentBlocks.find(&block) != divergentBlocks.end();
+}
+
+/*
+ * Determines the uniformity of the value calculated by the given instruction from its inputs
+ */
+static Uniformity evaluateInputs(const DivergenceAnalysis& analysis, const intermediate::IntermediateInstruction& inst)
+{
+    using namespace vc4c::intermediate;
+    Uniformity result = Uniformity::UNIFORM;
+    if(auto load = dynamic_cast<const LoadImmediate*>(&inst))
+        result = load->type == LoadType::REPLICATE_INT32 ? Uniformity::UNIFORM : Uniformity::GROUP_UNIFORM;
+    else if(auto rotation = dynamic_cast<const VectorRotation*>(&inst))
+        // rotating a vector with all elements the same does not change the vector
+        result = analysis.getUniformity(rotation->getSource());
+    else if(dynamic_cast<const Operation*>(&inst) || dynamic_cast<const MoveOperation*>(&inst) ||
+        dynamic_cast<const IntrinsicOperation*>(&inst) || dynamic_cast<const PhiNode*>(&inst))
+    {
+        // all these operations are applied element-wise
+        for(const auto& arg : inst.getArguments())
+            result = intersect_flags(result, analysis.getUniformity(arg));
+    }
+    else
+        // e.g. memory accesses or function calls
+        result = Uniformity::DIVERGENT;
+
+    if(inst.hasDecoration(InstructionDecorations::BUILTIN_LOCAL_ID) ||
+        inst.hasDecoration(InstructionDecorations::BUILTIN_GLOBAL_ID))
+        result = remove_flag(result, Uniformity::GROUP_UNIFORM);
+    else if(inst.hasDecoration(InstructionDecorations::WORK_GROUP_UNIFORM_VALUE))
+        result = add_flag(result, Uniformity::GROUP_UNIFORM);
+    return result;
+}
+
+/*
+ * Returns the blocks which are control-dependent on the branch(es) at the end of the given block, i.e. the blocks
+ * post-dominating any successor of the block, but not strictly post-dominating the block itself
+ */
+static FastAccessList<const BasicBlock*> findControlDependentBlocks(
+    const ControlFlowGraph& cfg, const DominatorTree& postDominators, const CFGNode& branchNode)
+{
+    FastAccessList<const CFGNode*> successors;
+    branchNode.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge& edge) -> bool {
+        // the work-group loop is always run by all work-items
+        if(!edge.data.isWorkGroupLoop)
+            successors.push_back(&successor);
+        return true;
+    });
+    FastAccessList<const BasicBlock*> blocks;
+    for(const auto& node : cfg.getNodes())
+    {
+        if(postDominators.strictlyDominates(node.second, branchNode))
+            continue;
+        if(std::any_of(successors.begin(), successors.end(),
+               [&](const CFGNode* successor) -> bool { return postDominators.dominates(node.second, *successor); }))
+            blocks.push_back(node.first);
+    }
+    return blocks;
+}
+
+std::unique_ptr<DivergenceAnalysis> DivergenceAnalysis::analyze(Method& method, const DominatorTree& postDominators)
+{
+    PROFILE_START(DivergenceAnalysis);
+    std::unique_ptr<DivergenceAnalysis> analysis(new DivergenceAnalysis());
+    // the block containing each instruction writing or reading a local
+    FastMap<const intermediate::IntermediateInstruction*, const BasicBlock*> instructionBlocks;
+    // the last instruction setting the flags read by a conditional instruction, nullptr if not in the same block
+    FastMap<const intermediate::IntermediateInstruction*, const intermediate::IntermediateInstruction*> flagSetters;
+    // the flags setters of the conditional branches and the blocks control-dependent on them
+    FastAccessList<std::pair<const intermediate::IntermediateInstruction*, FastAccessList<const BasicBlock*>>>
+        conditionalBranches;
+
+    const auto& cfg = method.getCFG();
+    for(auto& block : method)
+    {
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(it.has())
+            {
+                instructionBlocks.emplace(it.get(), &block);
+                if(auto local = it->checkOutputLocal())
+                    // start with all locals being uniform, the uniformity is only removed while iterating
+                    analysis->uniformities.emplace(local, Uniformity::UNIFORM);
+                auto branch = it.get<intermediate::Branch>();
+                if(it->hasConditionalExecution() || (branch && !branch->isUnconditional()))
+                {
+                    auto setterIt = block.findLastSettingOfFlags(it);
+                    auto setter = setterIt ? setterIt->get() : nullptr;
+                    if(branch)
+                        conditionalBranches.emplace_back(
+                            setter, findControlDependentBlocks(cfg, postDominators, cfg.assertNode(&block)));
+                    else
+                        flagSetters.emplace(it.get(), setter);
+                }
+            }
+            it.nextInBlock();
+        }
+    }
+
+    // whether the given local is (possibly) visible in any block other than the given one
+    auto isVisibleOutside = [&](const Local* local, const BasicBlock* block) -> bool {
+        std::size_t numWriters = 0;
+        for(const auto& user : local->getUsers())
+        {
+            if(user.second.writesLocal() && ++numWriters > 1)
+                return true;
+            auto it = instructionBlocks.find(user.first);
+            if(it == instructionBlocks.end() || it->second != block)
+                return true;
+        }
+        return false;
+    };
+
+    bool changed = true;
+    while(changed)
+    {
+        changed = false;
+        for(const auto& branch : conditionalBranches)
+        {
+            // since the branch is taken for all SIMD elements of a QPU, only the uniformity across work-items matters
+            if(branch.first && has_flag(evaluateInputs(*analysis, *branch.first), Uniformity::GROUP_UNIFORM))
+                continue;
+            for(auto block : branch.second)
+                analysis->divergentBlocks.emplace(block);
+        }
+
+        for(const auto& entry : instructionBlocks)
+        {
+            const auto& inst = *entry.first;
+            auto local = inst.checkOutputLocal();
+            if(!local)
+                continue;
+            auto uniformity = evaluateInputs(*analysis, inst);
+            auto setterIt = flagSetters.find(&inst);
+            if(setterIt != flagSetters.end())
+                // the value is only written for some of the SIMD elements/work-items, if the flags are not uniform
+                uniformity = intersect_flags(uniformity,
+                    setterIt->second ? evaluateInputs(*analysis, *setterIt->second) : Uniformity::DIVERGENT);
+            if(analysis->isDivergentBlock(*entry.second) && isVisibleOutside(local, entry.second))
+                // the work-items not executing this block see a different value
+                uniformity = remove_flag(uniformity, Uniformity::GROUP_UNIFORM);
+            auto& current = analysis->uniformities[local];
+            auto updated = intersect_flags(current, uniformity);
+            if(updated != current)
+            {
+                current = updated;
+                changed = true;
+            }
+        }
+    }
+    PROFILE_END(DivergenceAnalysis);
+
+    LCOV_EXCL_START
+    logging::logLazy(logging::Level::DEBUG, [&]() {
+        for(const auto& entry : analysis->uniformities)
+        {
+            if(entry.second != Uniformity::DIVERGENT)
+                logging::debug() << "Local " << entry.first->to_string() << " is " << toString(entry.second)
+                                 << logging::endl;
+        }
+    });
+    LCOV_EXCL_STOP
+    return analysis;
+}
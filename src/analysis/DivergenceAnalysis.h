@@ -0,0 +1,87 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+#ifndef VC4C_DIVERGENCE_ANALYSIS_H
+#define VC4C_DIVERGENCE_ANALYSIS_H
+
+#include "../Method.h"
+#include "../performance.h"
+
+#include <memory>
+#include <string>
+
+namespace vc4c
+{
+    namespace analysis
+    {
+        struct DominatorTree;
+
+        /*
+         * Bit-field describing which executions of an instruction produce the same value
+         */
+        enum class Uniformity : unsigned char
+        {
+            // the value may differ between the SIMD elements as well as between the work-items
+            DIVERGENT = 0,
+            // the value is the same for all 16 SIMD elements, but may differ between the work-items (e.g. the local ID)
+            LANE_UNIFORM = 1,
+            // the value is the same for all work-items of the work-group, but may differ between the SIMD elements (e.g.
+            // the element number)
+            GROUP_UNIFORM = 2,
+            // the value is the same for all SIMD elements of all work-items (e.g. constants and kernel parameters)
+            UNIFORM = LANE_UNIFORM | GROUP_UNIFORM
+        };
+
+        std::string toString(Uniformity uniformity);
+
+        /*
+         * Classifies all locals of a method by whether they are uniform across the SIMD elements and/or the work-items
+         * of the work-group.
+         *
+         * The analysis starts with all locals being uniform and iteratively removes the uniformity of locals written
+         * by instructions with non-uniform inputs until a fixed point is reached. The sources of non-uniformity are:
+         * - the element number (differs per SIMD element) and the QPU number (differs per work-item)
+         * - the local and global IDs as well as the per-QPU UNIFORM address
+         * - data read from memory or peripherals (TMU, SFU, VPM, ...)
+         * - conditional writes where the flags are set by non-uniform values
+         * - writes in blocks which are only executed by some of the work-items (i.e. which are control-dependent on a
+         *   branch on a non-work-group uniform condition), if the written value is visible to other blocks
+         *
+         * Since branches are always taken for all SIMD elements of a QPU, only the work-group uniformity of a branch
+         * condition affects the control flow.
+         *
+         * NOTE: Locals not known to the analysis (e.g. inserted after it was run) are always classified as divergent.
+         */
+        class DivergenceAnalysis
+        {
+        public:
+            static std::unique_ptr<DivergenceAnalysis> analyze(Method& method, const DominatorTree& postDominators);
+
+            Uniformity getUniformity(const Local* local) const;
+            Uniformity getUniformity(const Value& value) const;
+
+            /*
+             * Returns whether the value is the same for all SIMD elements of a single work-item
+             */
+            bool isLaneUniform(const Value& value) const;
+            /*
+             * Returns whether the value is the same for all work-items of the work-group
+             */
+            bool isGroupUniform(const Value& value) const;
+
+            /*
+             * Returns whether the given block is only executed by some of the work-items, since it is control-dependent
+             * on a branch with a non-work-group uniform condition
+             */
+            bool isDivergentBlock(const BasicBlock& block) const;
+
+        private:
+            FastMap<const Local*, Uniformity> uniformities;
+            FastSet<const BasicBlock*> divergentBlocks;
+        };
+    } // namespace analysis
+} // namespace vc4c
+
+#endif /* VC4C_DIVERGENCE_ANALYSIS_H */
@@ -10,147 +10,280 @@
 #include "DebugGraph.h"
 #include "log.h"
 
+#include <limits>
+#include <numeric>
+
 using namespace vc4c;
 using namespace vc4c::analysis;
 
-static FastSet<const CFGNode*> getDominatorCandidates(const CFGNode& node)
-{
-    // check all incoming edges that are not back edges
-    FastSet<const CFGNode*> possibleDominators;
-    node.forAllIncomingEdges([&](const CFGNode& predecessor, const CFGEdge& edge) -> bool {
-        if(!edge.data.isBackEdge(predecessor.key) && !edge.data.isWorkGroupLoop)
-            possibleDominators.emplace(&predecessor);
-        return true;
-    });
+static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
 
+/*
+ * Returns whether the given edge from the source to the destination node is taken into account for the dominance
+ */
+static bool isDominanceEdge(const CFGNode& source, const CFGNode& destination, const CFGEdge& edge)
+{
     // don't use the node itself as dominator (e.g. for single-block loop)
-    possibleDominators.erase(&node);
+    return &source != &destination && !edge.data.isBackEdge(source.key) && !edge.data.isWorkGroupLoop;
+}
+
+const CFGNode* DominatorTree::getImmediateDominator(const CFGNode& node) const
+{
+    auto dominator = getPosition(node).immediateDominator;
+    return dominator == NO_INDEX ? nullptr : cfgNodes[dominator];
+}
 
-    return possibleDominators;
+bool DominatorTree::dominates(const CFGNode& dominator, const CFGNode& node) const
+{
+    return &dominator == &node || strictlyDominates(dominator, node);
+}
+
+bool DominatorTree::strictlyDominates(const CFGNode& dominator, const CFGNode& node) const
+{
+    if(&dominator == &node)
+        return false;
+    const auto& dominatorPosition = getPosition(dominator);
+    const auto& nodePosition = getPosition(node);
+    if(dominatorPosition.preOrder == NO_INDEX || nodePosition.preOrder == NO_INDEX)
+        // at least one of the nodes is not reachable, so it can only dominate itself
+        return false;
+    return dominatorPosition.preOrder < nodePosition.preOrder && dominatorPosition.postOrder > nodePosition.postOrder;
+}
+
+FastAccessList<const CFGNode*> DominatorTree::getDominanceFrontier(const CFGNode& node) const
+{
+    FastAccessList<const CFGNode*> frontier;
+    for(auto candidate : cfgNodes)
+    {
+        if(strictlyDominates(node, *candidate))
+            continue;
+        bool dominatesPredecessor = false;
+        auto checkPredecessor = [&](const CFGNode& predecessor, const CFGEdge& edge) -> bool {
+            if(!edge.data.isWorkGroupLoop && dominates(node, predecessor))
+            {
+                dominatesPredecessor = true;
+                return false;
+            }
+            return true;
+        };
+        if(isPostDominatorTree)
+            candidate->forAllOutgoingEdges(checkPredecessor);
+        else
+            candidate->forAllIncomingEdges(checkPredecessor);
+        if(dominatesPredecessor)
+            frontier.push_back(candidate);
+    }
+    return frontier;
 }
 
 std::unique_ptr<DominatorTree> DominatorTree::createDominatorTree(const ControlFlowGraph& cfg)
 {
     PROFILE_START(createDominatorTree);
-    std::unique_ptr<DominatorTree> tree(new DominatorTree(cfg.getNodes().size()));
+    auto tree = createTree(cfg, false);
+
+#ifdef DEBUG_MODE
+    LCOV_EXCL_START
+    logging::logLazy(logging::Level::DEBUG, [&]() {
+        auto nameFunc = [](const CFGNode* node) -> std::string { return node->key->to_string(); };
+        DebugGraph<const CFGNode*, DominationRelation, Directionality::DIRECTED>::dumpGraph<DominatorTree>(
+            *tree, "/tmp/vc4c-dominators.dot", nameFunc);
+    });
+    LCOV_EXCL_STOP
+#endif
+
+    PROFILE_END(createDominatorTree);
+    return tree;
+}
+
+std::unique_ptr<DominatorTree> DominatorTree::createPostDominatorTree(const ControlFlowGraph& cfg)
+{
+    PROFILE_START(createPostDominatorTree);
+    auto tree = createTree(cfg, true);
+
+#ifdef DEBUG_MODE
+    LCOV_EXCL_START
+    logging::logLazy(logging::Level::DEBUG, [&]() {
+        auto nameFunc = [](const CFGNode* node) -> std::string { return node->key->to_string(); };
+        DebugGraph<const CFGNode*, DominationRelation, Directionality::DIRECTED>::dumpGraph<DominatorTree>(
+            *tree, "/tmp/vc4c-post-dominators.dot", nameFunc);
+    });
+    LCOV_EXCL_STOP
+#endif
+
+    PROFILE_END(createPostDominatorTree);
+    return tree;
+}
 
-    FastMap<const CFGNode*, FastSet<const CFGNode*>> predecessors;
-    FastMap<const CFGNode*, FastAccessList<const CFGNode*>> dominatorChains;
+const DominatorTree::TreePosition& DominatorTree::getPosition(const CFGNode& node) const
+{
+    auto it = indices.find(&node);
+    if(it == indices.end())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Node is not part of the dominator tree", node.key->to_string());
+    return positions[it->second];
+}
 
-    // 1. handle direct predecessors and single direct dominators
+std::unique_ptr<DominatorTree> DominatorTree::createTree(const ControlFlowGraph& cfg, bool postDominators)
+{
+    const auto numNodes = cfg.getNodes().size();
+    std::unique_ptr<DominatorTree> tree(new DominatorTree(numNodes, postDominators));
+    tree->indices.reserve(numNodes);
+    tree->cfgNodes.reserve(numNodes);
     for(const auto& node : cfg.getNodes())
     {
-        auto& entry = tree->getOrCreateNode(&node.second);
-        auto tmp = getDominatorCandidates(node.second);
+        tree->indices.emplace(&node.second, static_cast<IndexType>(tree->cfgNodes.size()));
+        tree->cfgNodes.push_back(&node.second);
+        tree->getOrCreateNode(&node.second);
+    }
 
-        if(tmp.empty())
-        {
-            // node has no predecessors, therefore no dominators, nothing further to do
-            dominatorChains.emplace(&node.second, FastAccessList<const CFGNode*>{nullptr});
-        }
-        else if(tmp.size() == 1)
+    // 1. determine the successors and predecessors (by dense index) in the direction of the (for post-dominators
+    // reversed) control flow. The additional virtual root connects to all nodes without predecessors, so we can handle
+    // multiple start (or for post-dominators end) nodes.
+    const auto root = static_cast<IndexType>(numNodes);
+    FastAccessList<FastAccessList<IndexType>> successors(numNodes + 1);
+    FastAccessList<FastAccessList<IndexType>> predecessors(numNodes + 1);
+    for(IndexType i = 0; i < root; ++i)
+    {
+        const auto& node = *tree->cfgNodes[i];
+        node.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge& edge) -> bool {
+            if(isDominanceEdge(node, successor, edge))
+            {
+                auto successorIndex = tree->indices.at(&successor);
+                auto source = postDominators ? successorIndex : i;
+                auto destination = postDominators ? i : successorIndex;
+                successors[source].push_back(destination);
+                predecessors[destination].push_back(source);
+            }
+            return true;
+        });
+    }
+    for(IndexType i = 0; i < root; ++i)
+    {
+        if(predecessors[i].empty())
         {
-            // the one candidate is the dominator
-            tree->getOrCreateNode(*tmp.begin()).addEdge(&entry, {});
-            auto it = dominatorChains.emplace(&node.second, FastAccessList<const CFGNode*>{*tmp.begin()}).first;
-
-            // try to extend the dominator chain with an existing one
-            auto domIt = dominatorChains.find(*tmp.begin());
-            if(domIt != dominatorChains.end())
-                it->second.insert(it->second.end(), domIt->second.begin(), domIt->second.end());
+            successors[root].push_back(i);
+            predecessors[i].push_back(root);
         }
-        else
-            predecessors.emplace(&node.second, std::move(tmp));
     }
 
-    // 2. check whether we can resolve transitive dominators
-    while(!predecessors.empty())
+    // 2. number the nodes in depth-first pre-order, starting at the virtual root. From here on, the nodes are
+    // identified by their depth-first number
+    FastAccessList<IndexType> dfsNumbers(numNodes + 1, NO_INDEX);
+    FastAccessList<IndexType> vertices;
+    FastAccessList<IndexType> parents;
+    vertices.reserve(numNodes + 1);
+    parents.reserve(numNodes + 1);
     {
-        // extend all dominator chains by appending other known chains
-        for(auto& chain : dominatorChains)
+        // the nodes on the current depth-first path with the position of the next successor to visit
+        FastAccessList<std::pair<IndexType, std::size_t>> stack;
+        dfsNumbers[root] = 0;
+        vertices.push_back(root);
+        parents.push_back(0);
+        stack.emplace_back(root, 0);
+        while(!stack.empty())
         {
-            if(!chain.second.empty() && chain.second.back())
+            auto current = stack.back().first;
+            auto& nextSuccessor = stack.back().second;
+            if(nextSuccessor == successors[current].size())
             {
-                auto chainIt = dominatorChains.find(chain.second.back());
-                if(chainIt != dominatorChains.end())
-                    chain.second.insert(chain.second.end(), chainIt->second.begin(), chainIt->second.end());
+                stack.pop_back();
+                continue;
             }
+            auto next = successors[current][nextSuccessor++];
+            if(dfsNumbers[next] != NO_INDEX)
+                continue;
+            dfsNumbers[next] = static_cast<IndexType>(vertices.size());
+            vertices.push_back(next);
+            parents.push_back(dfsNumbers[current]);
+            stack.emplace_back(next, 0);
         }
+    }
 
-        auto it = predecessors.begin();
-        while(it != predecessors.end())
+    // 3. calculate the semi-dominators in reverse pre-order, using path-compression for the ancestors
+    const auto numReachable = static_cast<IndexType>(vertices.size());
+    FastAccessList<IndexType> semiDominators(numReachable);
+    std::iota(semiDominators.begin(), semiDominators.end(), 0);
+    FastAccessList<IndexType> labels(semiDominators);
+    FastAccessList<IndexType> ancestors(numReachable, NO_INDEX);
+    FastAccessList<IndexType> path;
+    auto eval = [&](IndexType node) -> IndexType {
+        if(ancestors[node] == NO_INDEX)
+            return node;
+        // compress the path to the root of the ancestor forest, iteratively to not overflow the stack for big CFGs
+        path.clear();
+        auto current = node;
+        while(ancestors[ancestors[current]] != NO_INDEX)
         {
-            auto& pendingNode = *it;
-            // need to find (if possible yet) for all predecessors the one node where the dominator chain (path in the
-            // dominator tree) of all predecessors merge. E.g. for node A, predecessor B with dominators B -> C -> D ->
-            // E and predecessor F with dominators F -> D -> E, need to find D.
-            FastMap<const CFGNode*, FastAccessList<const CFGNode*>*> predecessorDominatorChains;
-            bool allPredecessorsProcessed = true;
-            for(auto predecessor : pendingNode.second)
-            {
-                auto domIt = dominatorChains.find(predecessor);
-                if(domIt != dominatorChains.end())
-                    predecessorDominatorChains.emplace(predecessor, &domIt->second);
-                else
-                {
-                    allPredecessorsProcessed = false;
-                    break;
-                }
-            }
+            path.push_back(current);
+            current = ancestors[current];
+        }
+        for(auto it = path.rbegin(); it != path.rend(); ++it)
+        {
+            auto ancestor = ancestors[*it];
+            if(semiDominators[labels[ancestor]] < semiDominators[labels[*it]])
+                labels[*it] = labels[ancestor];
+            ancestors[*it] = ancestors[ancestor];
+        }
+        return labels[node];
+    };
+    for(IndexType node = numReachable - 1; node > 0; --node)
+    {
+        for(auto predecessor : predecessors[vertices[node]])
+        {
+            auto predecessorNumber = dfsNumbers[predecessor];
+            if(predecessorNumber == NO_INDEX)
+                // not reachable from any start node
+                continue;
+            semiDominators[node] = std::min(semiDominators[node], semiDominators[eval(predecessorNumber)]);
+        }
+        ancestors[node] = parents[node];
+    }
+
+    // 4. the immediate dominator is the nearest common ancestor of the semi-dominator and the parent
+    FastAccessList<IndexType> immediateDominators(numReachable, 0);
+    for(IndexType node = 1; node < numReachable; ++node)
+    {
+        auto dominator = parents[node];
+        while(dominator > semiDominators[node])
+            dominator = immediateDominators[dominator];
+        immediateDominators[node] = dominator;
+    }
 
-            if(allPredecessorsProcessed)
+    // 5. build the tree and number the tree nodes for the constant-time ancestor checks
+    tree->positions.assign(numNodes, TreePosition{NO_INDEX, NO_INDEX, NO_INDEX});
+    FastAccessList<FastAccessList<IndexType>> children(numNodes + 1);
+    for(IndexType node = 1; node < numReachable; ++node)
+    {
+        auto index = vertices[node];
+        auto dominatorIndex = vertices[immediateDominators[node]];
+        children[dominatorIndex].push_back(index);
+        if(dominatorIndex != root)
+        {
+            tree->positions[index].immediateDominator = dominatorIndex;
+            tree->assertNode(tree->cfgNodes[dominatorIndex]).addEdge(&tree->assertNode(tree->cfgNodes[index]), {});
+        }
+    }
+    {
+        IndexType preOrder = 0;
+        IndexType postOrder = 0;
+        FastAccessList<std::pair<IndexType, std::size_t>> stack;
+        stack.emplace_back(root, 0);
+        while(!stack.empty())
+        {
+            auto current = stack.back().first;
+            auto& nextChild = stack.back().second;
+            if(nextChild == children[current].size())
             {
-                // try to connect the dominator chains to a point where we have a single dominator
-                auto chainIt = predecessorDominatorChains.begin();
-                // initially take the first chain
-                auto dominatorCandidates = *chainIt->second;
-                // prepend the first predecessor itself to the chain, since it might be in the dominator chain of
-                // another predecessor
-                dominatorCandidates.insert(dominatorCandidates.begin(), chainIt->first);
-                bool loopAborted = false;
-                for(++chainIt; chainIt != predecessorDominatorChains.end(); ++chainIt)
-                {
-                    // find the point in both chains, where they merge (if any)
-                    auto domIt =
-                        std::find_if(dominatorCandidates.begin(), dominatorCandidates.end(), [&](const CFGNode* node) {
-                            // also check for the other predecessor itself
-                            return chainIt->first == node ||
-                                std::find(chainIt->second->begin(), chainIt->second->end(), node) !=
-                                chainIt->second->end();
-                        });
-                    if(domIt == dominatorCandidates.end())
-                    {
-                        loopAborted = true;
-                        break;
-                    }
-                    // remove all preceeding dominator candidates, since they are not valid anymore
-                    dominatorCandidates.erase(dominatorCandidates.begin(), domIt);
-                }
-
-                if(!loopAborted && !dominatorCandidates.empty())
-                {
-                    // we found or new dominator
-                    if(auto first = dominatorCandidates.front())
-                        tree->assertNode(first).addEdge(&tree->assertNode(pendingNode.first), {});
-                    dominatorChains.emplace(pendingNode.first, std::move(dominatorCandidates));
-                    it = predecessors.erase(it);
-                    continue;
-                }
+                if(current != root)
+                    tree->positions[current].postOrder = postOrder++;
+                stack.pop_back();
+                continue;
             }
-            ++it;
+            auto next = children[current][nextChild++];
+            tree->positions[next].preOrder = preOrder++;
+            stack.emplace_back(next, 0);
         }
     }
 
-#ifdef DEBUG_MODE
-    LCOV_EXCL_START
-    logging::logLazy(logging::Level::DEBUG, [&]() {
-        auto nameFunc = [](const CFGNode* node) -> std::string { return node->key->to_string(); };
-        DebugGraph<const CFGNode*, DominationRelation, Directionality::DIRECTED>::dumpGraph<DominatorTree>(
-            *tree, "/tmp/vc4c-dominators.dot", nameFunc);
-    });
-    LCOV_EXCL_STOP
-#endif
-
-    PROFILE_END(createDominatorTree);
     return tree;
 }
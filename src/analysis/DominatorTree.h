@@ -11,6 +11,7 @@
 #include "../Method.h"
 #include "ControlFlowGraph.h"
 
+#include <cstdint>
 #include <memory>
 
 namespace vc4c
@@ -33,14 +34,83 @@ namespace vc4c
          * * A node D immediately dominates a node N if D strictly dominates N, but does not strictly dominate any other
          *   node that strictly dominates N (D is the dominator "closest" to N).
          *
+         * A post-dominator tree uses the same definitions on the reversed control flow, i.e. a node D post-dominates a
+         * node N if every path from N to the end of the control flow must go through D. For post-dominator trees, all
+         * queries (e.g. #dominates()) refer to the post-dominance.
+         *
+         * The back edges (e.g. of loops) and the edges of the work-group loop are not considered for dominance.
+         *
+         * The tree is calculated with the Semi-NCA algorithm, see:
+         * Loukas Georgiadis: "Linear-Time Algorithms for Dominators and Related Problems", Chapter 2.2.3
+         *
          * Adapted from:
          * https://en.wikipedia.org/wiki/Dominator_(graph_theory)
          */
         struct DominatorTree : public Graph<const CFGNode*, DominatorTreeNode>
         {
-            explicit DominatorTree(std::size_t numNodes) : Graph(numNodes) {}
+            explicit DominatorTree(std::size_t numNodes, bool isPostDominatorTree = false) :
+                Graph(numNodes), isPostDominatorTree(isPostDominatorTree)
+            {
+            }
+
+            /*
+             * Returns the immediate (post-)dominator of the given node or a nullptr, if the node has no such dominator
+             */
+            const CFGNode* getImmediateDominator(const CFGNode& node) const;
+
+            /*
+             * Returns whether the first node (post-)dominates the second one.
+             *
+             * NOTE: Every node dominates itself. This check runs in constant time.
+             */
+            bool dominates(const CFGNode& dominator, const CFGNode& node) const;
+            bool strictlyDominates(const CFGNode& dominator, const CFGNode& node) const;
+
+            /*
+             * Returns the dominance frontier of the given node, the nodes where the dominance of the given node ends.
+             *
+             * A node F is in the dominance frontier of a node N if N dominates a predecessor of F, but does not
+             * strictly dominate F itself. For post-dominator trees, this returns the post-dominance frontier (on the
+             * reversed control flow), i.e. the nodes the given node is control-dependent on.
+             *
+             * NOTE: In contrast to the dominance itself, the frontier takes back edges into account, e.g. the header of
+             * a loop is in the dominance frontier of the block containing the back edge.
+             */
+            FastAccessList<const CFGNode*> getDominanceFrontier(const CFGNode& node) const;
+
+            bool isPostDominators() const noexcept
+            {
+                return isPostDominatorTree;
+            }
 
             static std::unique_ptr<DominatorTree> createDominatorTree(const ControlFlowGraph& cfg);
+            static std::unique_ptr<DominatorTree> createPostDominatorTree(const ControlFlowGraph& cfg);
+
+        private:
+            using IndexType = uint32_t;
+
+            /*
+             * The position of a node in the dominator tree
+             */
+            struct TreePosition
+            {
+                // the index of the immediate dominator, NO_INDEX for nodes without dominator
+                IndexType immediateDominator;
+                // the pre-order and post-order numbers of a depth-first traversal of the dominator tree. A node A is an
+                // ancestor of a node B, iff A's pre-order number is lower and A's post-order number is higher than B's
+                IndexType preOrder;
+                IndexType postOrder;
+            };
+
+            bool isPostDominatorTree;
+            // the dense indices of the CFG nodes
+            FastMap<const CFGNode*, IndexType> indices;
+            FastAccessList<const CFGNode*> cfgNodes;
+            FastAccessList<TreePosition> positions;
+
+            const TreePosition& getPosition(const CFGNode& node) const;
+
+            static std::unique_ptr<DominatorTree> createTree(const ControlFlowGraph& cfg, bool postDominators);
         };
 
     } // namespace analysis
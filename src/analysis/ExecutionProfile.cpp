@@ -0,0 +1,107 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "ExecutionProfile.h"
+
+#include "../Method.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "CompilationError.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace vc4c;
+using namespace vc4c::analysis;
+
+void ExecutionProfile::addEntry(const std::string& kernelName, const std::string& labelName, uint64_t value)
+{
+    entries[kernelName][labelName] += value;
+}
+
+const SortedMap<std::string, uint64_t>* ExecutionProfile::getEntries(const std::string& kernelName) const
+{
+    auto it = entries.find(kernelName);
+    return it != entries.end() ? &it->second : nullptr;
+}
+
+Optional<uint64_t> ExecutionProfile::getBlockFrequency(const Method& method, const BasicBlock& block) const
+{
+    auto kernelEntries = getEntries(getKernelName(method));
+    if(!kernelEntries)
+        return {};
+    auto it = kernelEntries->find(block.getLabel()->getLabel()->name);
+    if(it == kernelEntries->end())
+        return {};
+    return it->second;
+}
+
+bool ExecutionProfile::isNeverExecuted(const Method& method, const BasicBlock& block) const
+{
+    auto frequency = getBlockFrequency(method, block);
+    return frequency && *frequency == 0;
+}
+
+bool ExecutionProfile::empty() const noexcept
+{
+    return entries.empty();
+}
+
+void ExecutionProfile::readFrom(std::istream& in)
+{
+    std::string line;
+    std::size_t lineNumber = 0;
+    while(std::getline(in, line))
+    {
+        ++lineNumber;
+        if(line.empty())
+            continue;
+        // the label names might contain any character except for the tab separating the columns
+        auto firstTab = line.find('\t');
+        auto lastTab = line.rfind('\t');
+        if(firstTab == std::string::npos || firstTab == lastTab)
+            throw CompilationError(CompilationStep::GENERAL,
+                "Malformed execution profile entry in line " + std::to_string(lineNumber), line);
+        std::size_t valueLength = 0;
+        uint64_t value = 0;
+        try
+        {
+            value = std::stoull(line.substr(lastTab + 1), &valueLength);
+        }
+        catch(const std::exception&)
+        {
+            valueLength = 0;
+        }
+        if(valueLength == 0 || lastTab + 1 + valueLength != line.size())
+            throw CompilationError(CompilationStep::GENERAL,
+                "Invalid value in execution profile in line " + std::to_string(lineNumber), line);
+        addEntry(line.substr(0, firstTab), line.substr(firstTab + 1, lastTab - firstTab - 1), value);
+    }
+}
+
+void ExecutionProfile::writeTo(std::ostream& out) const
+{
+    for(const auto& kernel : entries)
+    {
+        for(const auto& entry : kernel.second)
+            out << kernel.first << '\t' << entry.first << '\t' << entry.second << '\n';
+    }
+    out.flush();
+}
+
+ExecutionProfile ExecutionProfile::readFile(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    if(!in)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open execution profile", fileName);
+    ExecutionProfile profile;
+    profile.readFrom(in);
+    return profile;
+}
+
+std::string ExecutionProfile::getKernelName(const Method& method)
+{
+    return method.name[0] == '@' ? method.name.substr(1) : method.name;
+}
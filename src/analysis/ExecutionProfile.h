@@ -0,0 +1,88 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_EXECUTION_PROFILE_H
+#define VC4C_EXECUTION_PROFILE_H
+
+#include "../performance.h"
+#include "Optional.h"
+
+#include <iosfwd>
+#include <string>
+
+namespace vc4c
+{
+    class BasicBlock;
+    class Method;
+
+    namespace analysis
+    {
+        /*
+         * The execution frequencies of the basic blocks of the kernels of a module as recorded by an emulation run, to
+         * be used by profile-guided optimizations.
+         *
+         * The profile is created by the emulator from the block positions written by the compiler (see
+         * Configuration#profileGenerateFile) and the number of executions of the first instruction of every block.
+         * Since the blocks are identified by the names of their labels, a profile is only meaningful for compilations
+         * of the same input with the same configuration (except for the profile options themselves). Blocks which do
+         * not exist in the compilation the profile was generated from (e.g. since they were merged into other blocks)
+         * have no recorded frequency.
+         *
+         * The block positions and the profile use the same text format: One line per block, consisting of the
+         * tab-separated kernel name, label name and block position (in bytes from the start of the kernel code) or
+         * number of executions respectively.
+         */
+        class ExecutionProfile
+        {
+        public:
+            /*
+             * Adds the given value to the entry for the given kernel and block label
+             */
+            void addEntry(const std::string& kernelName, const std::string& labelName, uint64_t value);
+
+            /*
+             * Returns all entries for the given kernel, mapped by their label names
+             */
+            const SortedMap<std::string, uint64_t>* getEntries(const std::string& kernelName) const;
+
+            /*
+             * Returns the recorded number of executions of the given basic block, if the profile contains the block
+             */
+            Optional<uint64_t> getBlockFrequency(const Method& method, const BasicBlock& block) const;
+
+            /*
+             * Returns whether the profile contains the given block, but it was never executed
+             */
+            bool isNeverExecuted(const Method& method, const BasicBlock& block) const;
+
+            bool empty() const noexcept;
+
+            /*
+             * Reads the entries from the given stream, accumulating the values of duplicate entries.
+             *
+             * Throws a CompilationError if the input is malformed.
+             */
+            void readFrom(std::istream& in);
+            void writeTo(std::ostream& out) const;
+
+            /*
+             * Reads the entries from the given file, throwing a CompilationError if the file cannot be read
+             */
+            static ExecutionProfile readFile(const std::string& fileName);
+
+            /*
+             * Returns the name the given kernel is identified with in the profile, which is the name also written into
+             * the kernel info, i.e. without any LLVM global prefix
+             */
+            static std::string getKernelName(const Method& method);
+
+        private:
+            SortedMap<std::string, SortedMap<std::string, uint64_t>> entries;
+        };
+    } // namespace analysis
+} // namespace vc4c
+
+#endif /* VC4C_EXECUTION_PROFILE_H */
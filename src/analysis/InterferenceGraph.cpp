@@ -8,10 +8,14 @@
 
 #include "../Method.h"
 #include "../Profiler.h"
+#include "../ThreadPool.h"
 #include "ControlFlowGraph.h"
 #include "DebugGraph.h"
 #include "LivenessAnalysis.h"
 
+#include <algorithm>
+#include <numeric>
+
 using namespace vc4c;
 using namespace vc4c::analysis;
 
@@ -28,6 +32,114 @@ FastSet<InterferenceNode*> InterferenceGraph::findOverfullNodes(std::size_t numN
     return results;
 }
 
+/*
+ * A single interference between two locals as found in a basic block
+ */
+struct LocalInterference
+{
+    const Local* first;
+    const Local* second;
+    InterferenceType type;
+};
+
+/*
+ * Collects the interferences between the locals of the given block.
+ *
+ * This only reads the instructions of the block and the (already calculated) liveness of the block, so the
+ * interferences of all blocks can be collected in parallel.
+ */
+static FastAccessList<LocalInterference> collectInterferences(
+    const BasicBlock& block, const GlobalLivenessAnalysis& livenessAnalysis)
+{
+    FastAccessList<LocalInterference> interferences;
+    if(block.empty())
+        // empty block means no changes in live locals -> no changes in interference
+        return interferences;
+    auto& livenessChanges = livenessAnalysis.getChanges(block);
+    // to update only the interference for local lifetime changes, we re-create the changes given from the
+    // LivenessChangesAnalysis on the list of tracked live locals.
+    FastSet<const Local*> liveLocals = livenessAnalysis.getOutgoingLiveLocals(block);
+    // NOTE: iterate in reverse order to be able to track the changes in live locals (which are also generated in
+    // reverse order) correctly
+    for(auto it = block.rbegin(); it != block.rend(); ++it)
+    {
+        // combined operations can write multiple locals
+        const auto combInstr = dynamic_cast<const intermediate::CombinedOperation*>(it->get());
+        if(combInstr && combInstr->op1 && combInstr->op2)
+        {
+            auto firstOut = combInstr->op1->checkOutputLocal();
+            auto secondOut = combInstr->op2->checkOutputLocal();
+            if(firstOut && secondOut && firstOut != secondOut)
+                interferences.emplace_back(LocalInterference{firstOut, secondOut, InterferenceType::USED_TOGETHER});
+        }
+        // instructions in general can read multiple locals
+        // we have a maximum of 4 locals per (combined) instruction
+        FastSet<const Local*> localsRead(4);
+        (*it)->forUsedLocals(
+            [&](const Local* loc, LocalUse::Type type, const intermediate::IntermediateInstruction& inst) {
+                if(has_flag(type, LocalUse::Type::READER) && !loc->type.isLabelType())
+                    localsRead.emplace(loc);
+            });
+        if(localsRead.size() > 1)
+        {
+            for(auto locIt = localsRead.begin(); locIt != localsRead.end(); ++locIt)
+            {
+                auto locIt2 = locIt;
+                for(++locIt2; locIt2 != localsRead.end(); ++locIt2)
+                    interferences.emplace_back(LocalInterference{*locIt, *locIt2, InterferenceType::USED_TOGETHER});
+            }
+        }
+
+        auto& changes = livenessChanges.getResult(it->get());
+        // Most live locals for one instruction are also live for the previous/next instruction (the only changes
+        // are the one given by the LivenessChangeAnalysis). Therefore, we only need to create a new edge for all
+        // newly added live locals (times all existing live locals), instead of all live locals times all live
+        // locals.
+
+        for(auto loc : changes.removedLocals)
+            liveLocals.erase(loc);
+
+        for(auto loc : changes.addedLocals)
+        {
+            for(auto live : liveLocals)
+            {
+                if(live != loc)
+                    // the local could already be in the list (e.g. when read multiple times) and creating an edge
+                    // between a local and itself would cause allocation errors.
+                    interferences.emplace_back(LocalInterference{loc, live, InterferenceType::USED_SIMULTANEOUSLY});
+            }
+            liveLocals.emplace(loc);
+        }
+    }
+    return interferences;
+}
+
+/*
+ * Collects the interferences of all basic blocks of the method in parallel
+ */
+static FastAccessList<FastAccessList<LocalInterference>> collectInterferences(
+    Method& method, const GlobalLivenessAnalysis& livenessAnalysis)
+{
+    PROFILE_START(LivenessToInterference);
+    FastAccessList<std::pair<const BasicBlock*, FastAccessList<LocalInterference>>> blockInterferences;
+    blockInterferences.reserve(method.size());
+    for(const auto& block : method)
+        blockInterferences.emplace_back(&block, FastAccessList<LocalInterference>{});
+    FastAccessList<std::pair<const BasicBlock*, FastAccessList<LocalInterference>>*> tasks;
+    tasks.reserve(blockInterferences.size());
+    for(auto& entry : blockInterferences)
+        tasks.emplace_back(&entry);
+    ThreadPool::getDefaultPool().scheduleAll<decltype(tasks)::value_type>(
+        tasks, [&](auto entry) { entry->second = collectInterferences(*entry->first, livenessAnalysis); });
+
+    FastAccessList<FastAccessList<LocalInterference>> interferences;
+    interferences.reserve(blockInterferences.size());
+    for(auto& entry : blockInterferences)
+        interferences.emplace_back(std::move(entry.second));
+    PROFILE_END(LivenessToInterference);
+    return interferences;
+}
+
 std::unique_ptr<InterferenceGraph> InterferenceGraph::createGraph(
     Method& method, const GlobalLivenessAnalysis* globalLivenessAnalysis)
 {
@@ -40,84 +152,16 @@ std::unique_ptr<InterferenceGraph> InterferenceGraph::createGraph(
         tmpAnalysis(method);
     auto& livenessAnalysis = globalLivenessAnalysis ? *globalLivenessAnalysis : tmpAnalysis;
 
-    PROFILE_START(LivenessToInterference);
-    for(auto& block : method)
+    for(const auto& block : collectInterferences(method, livenessAnalysis))
     {
-        auto& blockAnalysis = livenessAnalysis.getLocalAnalysis(block);
-        auto& livenessChanges = livenessAnalysis.getChanges(block);
-        if(block.empty())
-            // empty block means no changes in live locals -> no changes in interference
-            continue;
-        // to update only the interference for local lifetime changes, we re-create the changes given from the
-        // LivenessChangesAnalysis on the list of tracked live locals.
-        auto& liveLocals = blockAnalysis.getEndResult();
-        FastMap<const Local*, InterferenceNode*> liveNodes(liveLocals.size());
-        for(auto loc : liveLocals)
-            liveNodes.emplace(loc, &graph.getOrCreateNode(const_cast<Local*>(loc)));
-        // NOTE: iterate in reverse order to be able to track the changes in live locals (which are also generated in
-        // reverse order) correctly
-        for(auto it = block.rbegin(); it != block.rend(); ++it)
+        for(const auto& interference : block)
         {
-            // combined operations can write multiple locals
-            const auto combInstr = dynamic_cast<const intermediate::CombinedOperation*>(it->get());
-            if(combInstr && combInstr->op1 && combInstr->op2)
-            {
-                auto firstOut = combInstr->op1->checkOutputLocal();
-                auto secondOut = combInstr->op2->checkOutputLocal();
-                if(firstOut && secondOut && firstOut != secondOut)
-                {
-                    graph.getOrCreateNode(const_cast<Local*>(firstOut))
-                        .getOrCreateEdge(
-                            &graph.getOrCreateNode(const_cast<Local*>(secondOut)), InterferenceType::USED_TOGETHER)
-                        .data = InterferenceType::USED_TOGETHER;
-                }
-            }
-            // instructions in general can read multiple locals
-            // we have a maximum of 4 locals per (combined) instruction
-            FastSet<InterferenceNode*> localsRead(4);
-            (*it)->forUsedLocals(
-                [&](const Local* loc, LocalUse::Type type, const intermediate::IntermediateInstruction& inst) {
-                    if(has_flag(type, LocalUse::Type::READER) && !loc->type.isLabelType())
-                        localsRead.emplace(&graph.getOrCreateNode(const_cast<Local*>(loc)));
-                });
-            if(localsRead.size() > 1)
-            {
-                for(auto locIt = localsRead.begin(); locIt != localsRead.end(); ++locIt)
-                {
-                    auto& firstNode = **locIt;
-                    auto locIt2 = locIt;
-                    for(++locIt2; locIt2 != localsRead.end(); ++locIt2)
-                    {
-                        firstNode.getOrCreateEdge(*locIt2, InterferenceType::USED_TOGETHER).data =
-                            InterferenceType::USED_TOGETHER;
-                    }
-                }
-            }
-
-            auto& changes = livenessChanges.getResult(it->get());
-            // Most live locals for one instruction are also live for the previous/next instruction (the only changes
-            // are the one given by the LivenessChangeAnalysis). Therefore, we only need to create a new edge for all
-            // newly added live locals (times all existing live locals), instead of all live locals times all live
-            // locals.
-
-            for(auto loc : changes.removedLocals)
-                liveNodes.erase(loc);
-
-            for(auto loc : changes.addedLocals)
-            {
-                auto& firstNode = graph.getOrCreateNode(const_cast<Local*>(loc));
-                for(auto node : liveNodes)
-                {
-                    if(node.second != &firstNode)
-                        // the node could already be in the list (e.g. when read multiple times) and creating an edge
-                        // between a node and itself would cause allocation errors.
-                        firstNode.getOrCreateEdge(node.second, InterferenceType::USED_SIMULTANEOUSLY);
-                }
-                liveNodes.emplace(loc, &firstNode);
-            }
+            auto& edge = graph.getOrCreateNode(const_cast<Local*>(interference.first))
+                             .getOrCreateEdge(&graph.getOrCreateNode(const_cast<Local*>(interference.second)),
+                                 InterferenceType{interference.type});
+            edge.data = std::max(edge.data, interference.type);
         }
     }
-    PROFILE_END(LivenessToInterference);
 
     PROFILE_END(createInterferenceGraph);
 
@@ -133,3 +177,59 @@ std::unique_ptr<InterferenceGraph> InterferenceGraph::createGraph(
 #endif
     return graph_ptr;
 }
+
+FrozenInterferenceGraph InterferenceGraph::createFrozenGraph(
+    Method& method, const GlobalLivenessAnalysis& livenessAnalysis)
+{
+    PROFILE_START(createFrozenInterferenceGraph);
+    using IndexType = FrozenInterferenceGraph::IndexType;
+    using FrozenEdge = FrozenInterferenceGraph::FrozenEdge;
+
+    // assign the node indices in order of the first occurrence to be independent of the local addresses
+    FastAccessList<Local*> keys;
+    FastMap<const Local*, IndexType> indices(method.getNumLocals());
+    auto getIndex = [&](const Local* loc) -> IndexType {
+        auto it = indices.emplace(loc, static_cast<IndexType>(keys.size()));
+        if(it.second)
+            keys.emplace_back(const_cast<Local*>(loc));
+        return it.first->second;
+    };
+
+    // every edge is inserted for both of its nodes, sorting them groups the edges of each node together
+    FastAccessList<std::pair<IndexType, FrozenEdge>> edges;
+    for(const auto& block : collectInterferences(method, livenessAnalysis))
+    {
+        for(const auto& interference : block)
+        {
+            auto first = getIndex(interference.first);
+            auto second = getIndex(interference.second);
+            edges.emplace_back(first, FrozenEdge{second, interference.type});
+            edges.emplace_back(second, FrozenEdge{first, interference.type});
+        }
+    }
+    std::sort(edges.begin(), edges.end(),
+        [](const std::pair<IndexType, FrozenEdge>& one, const std::pair<IndexType, FrozenEdge>& other) -> bool {
+            if(one.first != other.first)
+                return one.first < other.first;
+            if(one.second.neighbor != other.second.neighbor)
+                return one.second.neighbor < other.second.neighbor;
+            // sort the stronger interference first to be kept when merging duplicate edges
+            return one.second.data > other.second.data;
+        });
+
+    FastAccessList<IndexType> offsets(keys.size() + 1, 0);
+    FastAccessList<FrozenEdge> uniqueEdges;
+    uniqueEdges.reserve(edges.size());
+    for(std::size_t i = 0; i < edges.size(); ++i)
+    {
+        if(i > 0 && edges[i].first == edges[i - 1].first && edges[i].second.neighbor == edges[i - 1].second.neighbor)
+            continue;
+        uniqueEdges.emplace_back(edges[i].second);
+        ++offsets[edges[i].first + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    FrozenInterferenceGraph graph(std::move(keys), std::move(offsets), std::move(uniqueEdges));
+    PROFILE_END(createFrozenInterferenceGraph);
+    return graph;
+}
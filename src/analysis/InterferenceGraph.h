@@ -39,6 +39,7 @@ namespace vc4c
 
         using InterferenceNode = vc4c::Node<vc4c::Local*, InterferenceType, vc4c::Directionality::UNDIRECTED>;
         using Interference = InterferenceNode::EdgeType;
+        using FrozenInterferenceGraph = FrozenGraph<vc4c::Local*, InterferenceType, vc4c::Directionality::UNDIRECTED>;
 
         /*
          * The interference graph connects locals by how they interfere which each other (are live at the same time)
@@ -53,9 +54,24 @@ namespace vc4c
              */
             FastSet<InterferenceNode*> findOverfullNodes(std::size_t numNeighbors);
 
+            /*
+             * Creates the interference graph of all locals interfering with any other local.
+             *
+             * The interferences of the single basic blocks are collected in parallel, since they only depend on the
+             * instructions and the liveness of the block itself.
+             */
             static std::unique_ptr<InterferenceGraph> createGraph(
                 Method& method, const GlobalLivenessAnalysis* globalLivenessAnalysis = nullptr);
 
+            /*
+             * Creates the interference graph directly in its frozen form.
+             *
+             * In contrast to #createGraph(), the interferences collected in parallel are merged by sorting them into
+             * the compressed edge arrays without creating (and afterwards copying) the node-based graph.
+             */
+            static FrozenInterferenceGraph createFrozenGraph(
+                Method& method, const GlobalLivenessAnalysis& livenessAnalysis);
+
         private:
             explicit InterferenceGraph(std::size_t numLocals) : Graph(numLocals) {}
         };
@@ -10,6 +10,7 @@
 #include "ControlFlowGraph.h"
 #include "ControlFlowLoop.h"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace vc4c;
@@ -280,103 +281,245 @@ LCOV_EXCL_STOP
 
 /*
  * Algorithm:
- * in reverse order of control flow, starting from end of kernel
- * 1. run local liveness analysis, cache result for block including live locals at end of block
- * 2. for all direct predecessor blocks
- * 2.1 if cached live locals at end of predecessor block already contains all live locals at start of current block,
- * stop
- * 2.2 if edge is work-group loop, stop
- * 2.3 if no cached live locals of predecessor blocks, or new locals, (re-)run step 1 for predecessor block
+ * 1. calculate the liveness changes for every block and summarize them into the locals read before written (used) and
+ * the locals written (killed) in the block
+ * 2. solve the live locals at the end of all blocks with the global data-flow solver on the summaries only
+ * 3. the live locals for the single instructions of a block are only calculated on demand from the live locals at the
+ * end of the block (see #getLocalAnalysis())
  */
 
-using LiveLocalsCache = FastMap<const BasicBlock*, FastSet<const Local*>>;
+// The live locals are handled as bit-sets of their indices, since merging the live locals of the successor blocks and
+// checking for changes is the hot spot of the fixed-point iteration.
+struct BlockLivenessSummary
+{
+    // the locals whose values at the start of the block are read within the block
+    tools::DynamicBitSet usedLocals;
+    // the locals whose liveness ends within the block (i.e. which are written before any read)
+    tools::DynamicBitSet killedLocals;
+};
 
-static void runAnalysis(const CFGNode& node, FastMap<const BasicBlock*, std::unique_ptr<LivenessAnalysis>>& results,
-    const FastMap<const BasicBlock*, LivenessChangesAnalysis>& changes, LiveLocalsCache& cachedEndLiveLocals,
-    FastSet<const Local*>&& cacheEntry, const BasicBlock* startOfKernel, FastSet<const CFGNode*>& pendingNodes)
+class LiveLocalsAnalysis : public GlobalDataFlowAnalysis<AnalysisDirection::BACKWARD, tools::DynamicBitSet>
 {
-    PROFILE_START(SingleLivenessAnalysis);
-    auto& analyzer = results[node.key];
-    if(!analyzer)
+public:
+    LiveLocalsAnalysis(const FastMap<const BasicBlock*, BlockLivenessSummary>& summaries,
+        const BasicBlock* startOfKernel, std::size_t numLocals) :
+        GlobalDataFlowAnalysis(
+            [&summaries](const BasicBlock& block, const tools::DynamicBitSet& outgoingLiveLocals) {
+                const auto& summary = summaries.at(&block);
+                tools::DynamicBitSet incomingLiveLocals(outgoingLiveLocals);
+                incomingLiveLocals.eraseAll(summary.killedLocals);
+                incomingLiveLocals.insertAll(summary.usedLocals);
+                return incomingLiveLocals;
+            },
+            [startOfKernel](tools::DynamicBitSet& outgoingLiveLocals, const tools::DynamicBitSet& successorLiveLocals,
+                const BasicBlock& block, const BasicBlock& successor) -> bool {
+                // skip work-group loop, since they do not modify the live locals
+                // Since if the work-group loop is not active, there might be a kernel code loop back to the start, we
+                // only skip if the work-group loop is active (in which case the first block will have the flag set).
+                if(&successor == startOfKernel &&
+                    successor.getLabel()->hasDecoration(intermediate::InstructionDecorations::WORK_GROUP_LOOP))
+                    return false;
+                return outgoingLiveLocals.insertAll(successorLiveLocals);
+            },
+            [](const tools::DynamicBitSet& liveLocals) -> std::string {
+                return std::to_string(liveLocals.size()) + " live locals";
+            },
+            tools::DynamicBitSet(numLocals))
     {
-        analyzer.reset(new LivenessAnalysis(std::move(cacheEntry)));
-        analyzer->analyzeWithChanges(*node.key, changes.at(node.key));
     }
-    else
-        analyzer->updateWithChanges(*node.key, changes.at(node.key), std::move(cacheEntry));
-    PROFILE_END(SingleLivenessAnalysis);
+};
 
-    // copy on purpose, since result could be modified by previous forAllIncomingEdges loop
-    auto startLiveLocals = analyzer->getStartResult();
-
-    if(node.key == startOfKernel &&
-        node.key->getLabel()->hasDecoration(intermediate::InstructionDecorations::WORK_GROUP_LOOP))
+static BlockLivenessSummary summarizeLivenessChanges(
+    const BasicBlock& block, const LivenessChangesAnalysis& changes, tools::IndexTable<const Local*>& localIndices)
+{
+    BlockLivenessSummary summary{
+        tools::DynamicBitSet(localIndices.size()), tools::DynamicBitSet(localIndices.size())};
+    // Applies the changes of all instructions from the end to the start of the block, similar to #updateLiveness()
+    auto it = block.end();
+    do
     {
-        // skip work-group loop, since they do not modify the live locals
-        // Since if the work-group loop is not active, there might be a kernel code loop back to the start, we only
-        // abort if the work-group loop is active (in which case the first block will have the flag set).
-        return;
-    }
-
-    node.forAllIncomingEdges([&](const CFGNode& predecessor, const CFGEdge&) -> bool {
-        // add all live locals from the beginning of this block to the end of the new one and check whether we are done
-        // with this predecessor
-        auto predCacheIt = cachedEndLiveLocals.find(predecessor.key);
-        if(predCacheIt != cachedEndLiveLocals.end())
+        --it;
+        if(*it)
         {
-            auto sizePrevious = predCacheIt->second.size();
-            predCacheIt->second.insert(startLiveLocals.begin(), startLiveLocals.end());
-            if(predCacheIt->second.size() == sizePrevious)
-                // no new locals were added, can abort this node
-                return true;
+            const auto& instructionChanges = changes.getResult(it->get());
+            for(auto removed : instructionChanges.removedLocals)
+            {
+                auto index = localIndices.addObject(removed);
+                summary.usedLocals.erase(index);
+                summary.killedLocals.insert(index);
+            }
+            for(auto added : instructionChanges.addedLocals)
+                summary.usedLocals.insert(localIndices.addObject(added));
         }
-        else
-            predCacheIt = cachedEndLiveLocals.emplace(predecessor.key, startLiveLocals).first;
-
-        // we need to (re-)run the analysis on that basic blocks sine the live locals changed
-        pendingNodes.emplace(&predecessor);
-        return true;
-    });
+    } while(it != block.begin());
+    return summary;
 }
 
 void GlobalLivenessAnalysis::operator()(Method& method)
 {
     PROFILE_START(GlobalLivenessAnalysis);
     auto& cfg = method.getCFG();
-    auto& finalNode = cfg.getEndOfControlFlow();
     auto startOfKernel = cfg.getStartOfControlFlow().key;
+    // the analysis might be rerun on an already analyzed method
+    changes.clear();
+    results.clear();
     changes.reserve(method.size());
+    auto localIndices = method.createLocalIndices();
+    FastMap<const BasicBlock*, BlockLivenessSummary> summaries;
+    summaries.reserve(method.size());
     // precalculate changes in livenesses
     for(const auto& block : method)
     {
         auto it = changes.emplace(&block, LivenessChangesAnalysis{}).first;
         it->second(block, trackR5Usage);
+        summaries.emplace(&block, summarizeLivenessChanges(block, it->second, localIndices));
     }
 
-    // The cache of the live locals at the end of a given basic blocks (e.g. consumed by any succeeding block)
-    LiveLocalsCache cachedEndLiveLocals(cfg.getNodes().size());
-    results.reserve(cfg.getNodes().size());
-    // to avoid stack overflows, we rerun the pending blocks iteratively, not recursively. So keep track of the basic
-    // blocks still to be processed (again).
-    FastSet<const CFGNode*> pendingNodes;
-    // initial run for the last node
-    runAnalysis(finalNode, results, changes, cachedEndLiveLocals, {}, startOfKernel, pendingNodes);
-    // repeat until there are no more pending nodes. Since we have a limited number of locals, this can never be an
-    // infinite loop. It will always stop, latest when all locals are added to all blocks.
-    while(!pendingNodes.empty())
+    LiveLocalsAnalysis liveLocals(summaries, startOfKernel, localIndices.size());
+    liveLocals(method);
+
+    // keep the live locals at the end of the blocks, so we can analyze (and update) single blocks later on
+    outgoingLiveLocals.clear();
+    outgoingLiveLocals.reserve(method.size());
+    incomingLiveLocals.clear();
+    incomingLiveLocals.reserve(method.size());
+    for(const auto& block : method)
     {
-        auto node = *pendingNodes.begin();
-        // remove before running the analysis since (e.g. on a 1 block loop) it could be added again with new locals
-        pendingNodes.erase(pendingNodes.begin());
-        // if the node is in the pendingNodes set, then it is also guaranteed that there is an entry in the
-        // cachedEndLiveLocals map, since the map is written before the pendingNodes set.
-        auto predCacheIt = cachedEndLiveLocals.find(node->key);
-        runAnalysis(*node, results, changes, cachedEndLiveLocals, FastSet<const Local*>{predCacheIt->second},
-            startOfKernel, pendingNodes);
+        outgoingLiveLocals.emplace(&block, localIndices.toSet(liveLocals.getFinalResult(block)));
+        incomingLiveLocals.emplace(&block, localIndices.toSet(liveLocals.getInitialResult(block)));
     }
     PROFILE_END(GlobalLivenessAnalysis);
 }
 
+const LivenessAnalysis& GlobalLivenessAnalysis::getLocalAnalysis(const BasicBlock& block) const
+{
+    auto& analyzer = results[&block];
+    if(!analyzer)
+    {
+        PROFILE_START(SingleLivenessAnalysis);
+        // throws if the block was not analyzed
+        const auto& blockChanges = changes.at(&block);
+        auto outIt = outgoingLiveLocals.find(&block);
+        analyzer.reset(new LivenessAnalysis(
+            outIt != outgoingLiveLocals.end() ? FastSet<const Local*>{outIt->second} : FastSet<const Local*>{}));
+        analyzer->analyzeWithChanges(block, blockChanges);
+        PROFILE_END(SingleLivenessAnalysis);
+    }
+    return *analyzer;
+}
+
+const FastSet<const Local*>& GlobalLivenessAnalysis::getIncomingLiveLocals(const BasicBlock& block) const
+{
+    // the per-instruction results are kept up-to-date by #update(), the summaries are not
+    auto resultIt = results.find(&block);
+    if(resultIt != results.end() && resultIt->second)
+        return resultIt->second->getStartResult();
+    return incomingLiveLocals.at(&block);
+}
+
+static void propagateLiveLocals(const CFGNode& node, const FastSet<const Local*>& newLiveLocals,
+    const BasicBlock* startOfKernel, FastMap<const BasicBlock*, FastSet<const Local*>>& outgoingLiveLocals,
+    FastMap<const BasicBlock*, FastSet<const Local*>>& pendingLocals)
+{
+    // same as in #runAnalysis(), the work-group loop does not modify the live locals
+    if(node.key == startOfKernel &&
+        node.key->getLabel()->hasDecoration(intermediate::InstructionDecorations::WORK_GROUP_LOOP))
+        return;
+
+    node.forAllIncomingEdges([&](const CFGNode& predecessor, const CFGEdge&) -> bool {
+        auto& predecessorLocals = outgoingLiveLocals[predecessor.key];
+        for(auto loc : newLiveLocals)
+        {
+            // only the locals not yet live at the end of the predecessor need to be processed
+            if(predecessorLocals.emplace(loc).second)
+                pendingLocals[predecessor.key].emplace(loc);
+        }
+        return true;
+    });
+}
+
+static FastSet<const Local*> getAddedLocals(
+    const FastSet<const Local*>& previousLocals, const FastSet<const Local*>& currentLocals)
+{
+    FastSet<const Local*> addedLocals;
+    for(auto loc : currentLocals)
+    {
+        if(previousLocals.find(loc) == previousLocals.end())
+            addedLocals.emplace(loc);
+    }
+    return addedLocals;
+}
+
+void GlobalLivenessAnalysis::update(Method& method, const FastSet<BasicBlock*>& modifiedBlocks)
+{
+    if(modifiedBlocks.empty())
+        return;
+    PROFILE_START(UpdateGlobalLivenessAnalysis);
+    auto& cfg = method.getCFG();
+    auto startOfKernel = cfg.getStartOfControlFlow().key;
+    // the additional live locals at the end of the blocks which still need to be processed
+    FastMap<const BasicBlock*, FastSet<const Local*>> pendingLocals;
+
+    if(std::any_of(modifiedBlocks.begin(), modifiedBlocks.end(),
+           [&](const BasicBlock* block) { return changes.find(block) == changes.end(); }))
+    {
+        // we have no previous result for this block, so we cannot determine what changed
+        PROFILE_END(UpdateGlobalLivenessAnalysis);
+        (*this)(method);
+        return;
+    }
+    // the live locals of the single instructions are updated below, so they need to be available
+    for(const auto& entry : changes)
+        getLocalAnalysis(*entry.first);
+
+    for(auto block : modifiedBlocks)
+    {
+        auto resultIt = results.find(block);
+        // copy on purpose, since the analysis result is replaced
+        auto previousStartLocals = resultIt->second->getStartResult();
+
+        changes.erase(block);
+        auto& blockChanges = changes.emplace(block, LivenessChangesAnalysis{}).first->second;
+        blockChanges(*block, trackR5Usage);
+        auto outIt = outgoingLiveLocals.find(block);
+        resultIt->second.reset(new LivenessAnalysis(
+            outIt != outgoingLiveLocals.end() ? FastSet<const Local*>{outIt->second} : FastSet<const Local*>{}));
+        resultIt->second->analyzeWithChanges(*block, blockChanges);
+
+        const auto& currentStartLocals = resultIt->second->getStartResult();
+        if(std::any_of(previousStartLocals.begin(), previousStartLocals.end(),
+               [&](const Local* loc) { return currentStartLocals.find(loc) == currentStartLocals.end(); }))
+        {
+            // We can only add live locals to the other blocks. Removing would require us to check whether the local
+            // is still live due to any other successor.
+            PROFILE_END(UpdateGlobalLivenessAnalysis);
+            (*this)(method);
+            return;
+        }
+        auto addedLocals = getAddedLocals(previousStartLocals, currentStartLocals);
+        if(!addedLocals.empty())
+            propagateLiveLocals(cfg.assertNode(block), addedLocals, startOfKernel, outgoingLiveLocals, pendingLocals);
+    }
+
+    // iteratively propagate the additional live locals, similar to the full analysis
+    while(!pendingLocals.empty())
+    {
+        auto pendingIt = pendingLocals.begin();
+        auto block = pendingIt->first;
+        auto newLocals = std::move(pendingIt->second);
+        pendingLocals.erase(pendingIt);
+
+        auto& analyzer = results.at(block);
+        auto previousStartLocals = analyzer->getStartResult();
+        analyzer->updateWithChanges(*block, changes.at(block), std::move(newLocals));
+        auto addedLocals = getAddedLocals(previousStartLocals, analyzer->getStartResult());
+        if(!addedLocals.empty())
+            propagateLiveLocals(cfg.assertNode(const_cast<BasicBlock*>(block)), addedLocals, startOfKernel,
+                outgoingLiveLocals, pendingLocals);
+    }
+    PROFILE_END(UpdateGlobalLivenessAnalysis);
+}
+
 LCOV_EXCL_START
 void GlobalLivenessAnalysis::dumpResults(const Method& method) const
 {
@@ -384,7 +527,7 @@ void GlobalLivenessAnalysis::dumpResults(const Method& method) const
         for(const BasicBlock& block : method)
         {
             logging::debug() << block.to_string() << logging::endl;
-            results.at(&block)->dumpResults(block);
+            getLocalAnalysis(block).dumpResults(block);
         }
     });
 }
@@ -667,3 +810,148 @@ void LocalUsageRangeAnalysis::dumpResults(const Method& method) const
     });
 }
 LCOV_EXCL_STOP
+
+/*
+ * Determines the locals which are fixed to a certain register-file by the instructions accessing them, see
+ * GraphColoring for the complete list of constraints
+ */
+static FastMap<const Local*, RegisterFile> determineFixedLocals(const Method& method)
+{
+    FastMap<const Local*, RegisterFile> fixedLocals;
+    fixedLocals.emplace(FAKE_REPLICATE_REGISTER, RegisterFile::ACCUMULATOR);
+    for(const auto& block : method)
+    {
+        for(const auto& inst : block)
+        {
+            if(!inst)
+                continue;
+            auto rot = dynamic_cast<const intermediate::VectorRotation*>(inst.get());
+            if(rot && !rot->isPerQuadRotationAllowed())
+            {
+                // only accumulators can be rotated across all vector elements
+                if(auto loc = rot->getSource().checkLocal())
+                    fixedLocals[loc] = RegisterFile::ACCUMULATOR;
+            }
+            if(inst->hasUnpackMode())
+            {
+                // only register-file A can unpack, an accumulator constraint is stricter
+                for(const auto& arg : inst->getArguments())
+                {
+                    if(auto loc = arg.checkLocal())
+                        fixedLocals.emplace(loc, RegisterFile::PHYSICAL_A);
+                }
+            }
+            if(inst->hasPackMode())
+            {
+                if(auto loc = inst->checkOutputLocal())
+                    fixedLocals.emplace(loc, RegisterFile::PHYSICAL_A);
+            }
+        }
+    }
+    return fixedLocals;
+}
+
+static void updatePressure(RegisterPressure& pressure, const FastMap<const Local*, RegisterFile>& fixedLocals,
+    const Local* loc, bool addLocal)
+{
+    auto it = fixedLocals.find(loc);
+    auto file = it != fixedLocals.end() ? it->second : RegisterFile::ANY;
+    unsigned& count = file == RegisterFile::ACCUMULATOR ?
+        pressure.accumulators :
+        (file == RegisterFile::PHYSICAL_A ? pressure.fileA : pressure.unconstrained);
+    if(addLocal)
+        ++count;
+    else
+        --count;
+}
+
+static void updateMaximum(RegisterPressure& maximum, const RegisterPressure& pressure)
+{
+    maximum.accumulators = std::max(maximum.accumulators, pressure.accumulators);
+    maximum.fileA = std::max(maximum.fileA, pressure.fileA);
+    maximum.unconstrained = std::max(maximum.unconstrained, pressure.unconstrained);
+}
+
+void RegisterPressureAnalysis::operator()(Method& method)
+{
+    PROFILE_START(RegisterPressureAnalysis);
+
+    std::unique_ptr<GlobalLivenessAnalysis> globalLiveness;
+    auto actualLiveness = livenessAnalysis;
+    if(!livenessAnalysis)
+    {
+        globalLiveness.reset(new GlobalLivenessAnalysis(true));
+        (*globalLiveness)(method);
+        actualLiveness = globalLiveness.get();
+    }
+
+    auto fixedLocals = determineFixedLocals(method);
+    pressures.clear();
+    blockPressures.clear();
+    maximumPressure = RegisterPressure{};
+
+    for(const auto& block : method)
+    {
+        const auto& changes = actualLiveness->getChanges(block);
+        // only the set of live locals is updated with the changes of the single instructions, the pressure is
+        // calculated incrementally
+        FastSet<const Local*> liveLocals = actualLiveness->getOutgoingLiveLocals(block);
+        RegisterPressure pressure{};
+        for(auto loc : liveLocals)
+            updatePressure(pressure, fixedLocals, loc, true);
+        auto& blockMaximum = blockPressures[&block];
+
+        auto it = block.end();
+        do
+        {
+            --it;
+            if(*it)
+            {
+                const auto& instructionChanges = changes.getResult(it->get());
+                for(auto removed : instructionChanges.removedLocals)
+                {
+                    if(liveLocals.erase(removed) != 0)
+                        updatePressure(pressure, fixedLocals, removed, false);
+                }
+                for(auto added : instructionChanges.addedLocals)
+                {
+                    if(liveLocals.emplace(added).second)
+                        updatePressure(pressure, fixedLocals, added, true);
+                }
+                pressures[it->get()] = pressure;
+                updateMaximum(blockMaximum, pressure);
+            }
+        } while(it != block.begin());
+        updateMaximum(maximumPressure, blockMaximum);
+    }
+
+    PROFILE_END(RegisterPressureAnalysis);
+}
+
+const RegisterPressure& RegisterPressureAnalysis::getPressure(const intermediate::IntermediateInstruction* inst) const
+{
+    return pressures.at(inst);
+}
+
+const RegisterPressure& RegisterPressureAnalysis::getMaximumPressure(const BasicBlock& block) const
+{
+    return blockPressures.at(&block);
+}
+
+LCOV_EXCL_START
+std::string RegisterPressure::to_string() const
+{
+    return std::to_string(total()) + " live locals (" + std::to_string(accumulators) + " accumulators, " +
+        std::to_string(fileA) + " register-file A, " + std::to_string(unconstrained) + " unconstrained)";
+}
+
+void RegisterPressureAnalysis::dumpResults(const Method& method) const
+{
+    logging::logLazy(logging::Level::DEBUG, [&]() {
+        for(const auto& block : method)
+            logging::debug() << block.getLabel()->to_string() << ": " << getMaximumPressure(block).to_string()
+                             << logging::endl;
+        logging::debug() << "Maximum register pressure: " << maximumPressure.to_string() << logging::endl;
+    });
+}
+LCOV_EXCL_STOP
@@ -144,8 +144,8 @@ namespace vc4c
          *
          * See LivenessAnalysis for detailed description of the liveness.
          *
-         * Runs the LivenessAnalysis for every block taking into account all locals that are live at the end and start
-         * of all blocks, recursively.
+         * Solves the locals live at the end and start of all blocks via the GlobalDataFlowAnalysis and runs the
+         * LivenessAnalysis for the single blocks on demand.
          *
          * The result will contain all locals for a given instruction that are live at that instruction, whether
          * actually used in the corresponding block or not.
@@ -157,9 +157,39 @@ namespace vc4c
 
             void operator()(Method& method);
 
-            inline const LivenessAnalysis& getLocalAnalysis(const BasicBlock& block) const
+            /**
+             * Updates the results after the instructions of the given basic blocks have been modified (e.g. by
+             * inserting moves or NOPs), without re-analyzing the unmodified basic blocks.
+             *
+             * The liveness changes of the modified blocks are recalculated and any additional locals live at the start
+             * of these blocks are propagated to their predecessors. If a local is no longer live at the start of a
+             * modified block, the whole analysis is rerun, since the local could otherwise keep itself alive across
+             * loops.
+             *
+             * NOTE: The control flow of the method needs to be unchanged since the last analysis!
+             */
+            void update(Method& method, const FastSet<BasicBlock*>& modifiedBlocks);
+
+            /**
+             * Returns the live locals for the single instructions of the given basic block.
+             *
+             * NOTE: The live locals of the single instructions are only calculated on the first call for a basic block,
+             * since some users only need the live locals at the start or end of the blocks.
+             */
+            const LivenessAnalysis& getLocalAnalysis(const BasicBlock& block) const;
+            /**
+             * Returns the locals live at the start of the given basic block.
+             *
+             * In contrast to #getLocalAnalysis(), this does not require the live locals of the single instructions to
+             * be calculated.
+             */
+            const FastSet<const Local*>& getIncomingLiveLocals(const BasicBlock& block) const;
+            /**
+             * Returns the locals live at the end of the given basic block (i.e. live at the start of any successor).
+             */
+            const FastSet<const Local*>& getOutgoingLiveLocals(const BasicBlock& block) const
             {
-                return *results.at(&block);
+                return outgoingLiveLocals.at(&block);
             }
             inline const LivenessChangesAnalysis& getChanges(const BasicBlock& block) const
             {
@@ -169,8 +199,13 @@ namespace vc4c
 
         private:
             bool trackR5Usage;
-            FastMap<const BasicBlock*, std::unique_ptr<LivenessAnalysis>> results;
+            // the lazily calculated live locals of the single instructions
+            mutable FastMap<const BasicBlock*, std::unique_ptr<LivenessAnalysis>> results;
             FastMap<const BasicBlock*, LivenessChangesAnalysis> changes;
+            // the locals live at the end of the blocks (i.e. live at the start of any succeeding block)
+            FastMap<const BasicBlock*, FastSet<const Local*>> outgoingLiveLocals;
+            // the locals live at the start of the blocks, only used for the blocks without per-instruction results
+            FastMap<const BasicBlock*, FastSet<const Local*>> incomingLiveLocals;
         };
 
         /*
@@ -288,6 +323,101 @@ namespace vc4c
             SortedSet<LocalUtilization> overallUsages;
             FastMap<const BasicBlock*, SortedSet<LocalUsageRange>> detailedRanges;
         };
+
+        /**
+         * The number of locals live at a single point in the program, grouped by the registers they can be assigned to
+         */
+        struct RegisterPressure
+        {
+            // r0 to r3 as well as r5 (tracked as FAKE_REPLICATE_REGISTER), r4 is reserved for the SFU results
+            static constexpr unsigned NUM_ACCUMULATORS = 5;
+            static constexpr unsigned NUM_FILE_REGISTERS = 32;
+
+            // the live locals which can only be assigned to accumulators
+            unsigned accumulators = 0;
+            // the live locals which can only be assigned to the physical register-file A
+            unsigned fileA = 0;
+            // the live locals which can be assigned to any register (accumulators, register-file A or B)
+            unsigned unconstrained = 0;
+
+            constexpr unsigned total() const noexcept
+            {
+                return accumulators + fileA + unconstrained;
+            }
+
+            /*
+             * Returns whether the live locals cannot all be assigned to registers at the same time, i.e. locals need
+             * to be spilled
+             */
+            constexpr bool exceedsRegisters() const noexcept
+            {
+                return accumulators > NUM_ACCUMULATORS || fileA > NUM_FILE_REGISTERS ||
+                    total() > NUM_ACCUMULATORS + 2 * NUM_FILE_REGISTERS;
+            }
+
+            /*
+             * Returns the (upper bound of the) number of additional unconstrained locals which can be live without
+             * exceeding the available registers
+             */
+            constexpr unsigned getFreeRegisters() const noexcept
+            {
+                return exceedsRegisters() ? 0 : NUM_ACCUMULATORS + 2 * NUM_FILE_REGISTERS - total();
+            }
+
+            std::string to_string() const;
+        };
+
+        /**
+         * Using the results of the given or a newly created global liveness analysis, determines the register pressure
+         * at every instruction (i.e. for the locals live at that instruction, see LivenessAnalysis) as well as the
+         * maximum pressure of every basic block and the whole method.
+         *
+         * The live locals are not materialized per instruction, the pressure is instead tracked by applying the
+         * liveness changes (see LivenessChangesAnalysis) of the instructions to the locals live at the end of the
+         * blocks.
+         *
+         * The classification of the locals only considers the most common constraints applied by the register
+         * allocator (e.g. locals unpacked/packed must be on register-file A), so the result is an estimate which can be
+         * used by optimizations to not increase the register pressure to the point where locals need to be spilled.
+         */
+        class RegisterPressureAnalysis
+        {
+        public:
+            explicit RegisterPressureAnalysis(const GlobalLivenessAnalysis* globalLiveness = nullptr) :
+                livenessAnalysis(globalLiveness)
+            {
+            }
+
+            void operator()(Method& method);
+
+            /*
+             * Returns the register pressure for the locals live at the given instruction.
+             *
+             * NOTE: Throws an exception, if the instruction was not analyzed
+             */
+            const RegisterPressure& getPressure(const intermediate::IntermediateInstruction* inst) const;
+
+            /*
+             * Returns the element-wise maximum of the register pressures of all instructions within the given block
+             */
+            const RegisterPressure& getMaximumPressure(const BasicBlock& block) const;
+
+            /*
+             * Returns the element-wise maximum of the register pressures of all instructions within the method
+             */
+            inline const RegisterPressure& getMaximumPressure() const
+            {
+                return maximumPressure;
+            }
+
+            void dumpResults(const Method& method) const;
+
+        private:
+            const GlobalLivenessAnalysis* livenessAnalysis;
+            FastMap<const intermediate::IntermediateInstruction*, RegisterPressure> pressures;
+            FastMap<const BasicBlock*, RegisterPressure> blockPressures;
+            RegisterPressure maximumPressure;
+        };
     } /* namespace analysis */
 } /* namespace vc4c */
 
@@ -0,0 +1,203 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "LoopInfo.h"
+
+#include "../Profiler.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "ValueRange.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace vc4c;
+using namespace vc4c::analysis;
+using namespace vc4c::intermediate;
+
+/*
+ * Returns the constant literal value of the given value, either directly, by pre-calculating its single writer or by
+ * checking whether its value range only contains a single value.
+ */
+static Optional<Literal> resolveConstant(const Value& val, ValueRangeCache& valueRanges)
+{
+    if(auto lit = val.getLiteralValue())
+        return lit;
+    if(auto writer = val.getSingleWriter())
+    {
+        if(auto lit = (writer->precalculate(4).first & &Value::getLiteralValue))
+            return lit;
+    }
+    if(val.checkLocal() && val.type.isIntegralType())
+    {
+        if(auto singleValue = valueRanges.getValueRange(val).getSingletonValue())
+            return Literal(static_cast<int32_t>(*singleValue));
+    }
+    return {};
+}
+
+static Optional<unsigned> calculateDistance(
+    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound)
+{
+    auto comp = inductionVariable.repeatCondition.value().first;
+
+    if((comp == intermediate::COMP_SIGNED_LE || comp == intermediate::COMP_SIGNED_LT ||
+           comp == intermediate::COMP_UNSIGNED_LE || comp == intermediate::COMP_UNSIGNED_LT) &&
+        lowerBound.signedInt() > upperBound.signedInt())
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Iterating across type wrap is not supported for: " << inductionVariable.local->to_string()
+                << " from " << lowerBound.to_string() << " to " << upperBound.to_string() << logging::endl);
+        return {};
+    }
+
+    if((comp == intermediate::COMP_SIGNED_GE || comp == intermediate::COMP_SIGNED_GT ||
+           comp == intermediate::COMP_UNSIGNED_GE || comp == intermediate::COMP_UNSIGNED_GT) &&
+        lowerBound.signedInt() < upperBound.signedInt())
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Iterating across type wrap is not supported for: " << inductionVariable.local->to_string()
+                << " from " << lowerBound.to_string() << " to " << upperBound.to_string() << logging::endl);
+        return {};
+    }
+
+    if(comp == intermediate::COMP_SIGNED_LT)
+        return static_cast<unsigned>(upperBound.signedInt() - lowerBound.signedInt());
+    if(comp == intermediate::COMP_SIGNED_LE)
+        return static_cast<unsigned>(upperBound.signedInt() - lowerBound.signedInt() + 1);
+    if(comp == intermediate::COMP_SIGNED_GT)
+        return static_cast<unsigned>(lowerBound.signedInt() - upperBound.signedInt());
+    if(comp == intermediate::COMP_SIGNED_GE)
+        return static_cast<unsigned>(lowerBound.signedInt() - upperBound.signedInt() + 1);
+    if(comp == intermediate::COMP_UNSIGNED_LT)
+        return upperBound.unsignedInt() - lowerBound.unsignedInt();
+    if(comp == intermediate::COMP_UNSIGNED_LE)
+        return upperBound.unsignedInt() - lowerBound.unsignedInt() + 1u;
+    if(comp == intermediate::COMP_UNSIGNED_GT)
+        return lowerBound.unsignedInt() - upperBound.unsignedInt();
+    if(comp == intermediate::COMP_UNSIGNED_GE)
+        return lowerBound.unsignedInt() - upperBound.unsignedInt() + 1u;
+    if(comp == intermediate::COMP_NEQ)
+        // XXX could be wrong for unsigned induction variable and more than 2^31 iterations
+        return static_cast<unsigned>(std::max(lowerBound.signedInt(), upperBound.signedInt()) -
+            std::min(lowerBound.signedInt(), upperBound.signedInt()));
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Unsupported comparison for calculating distance for: " << inductionVariable.local->to_string()
+            << " and comparison: " << comp << logging::endl);
+    return {};
+}
+
+Optional<unsigned> LoopInfo::calculateTripCount(
+    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound, Literal stepValue)
+{
+    if(!inductionVariable.inductionStep || !inductionVariable.repeatCondition || stepValue.signedInt() == 0)
+        return {};
+
+    auto distance = calculateDistance(inductionVariable, lowerBound, upperBound);
+    if(!distance)
+        return {};
+
+    if(inductionVariable.inductionStep->op == OP_ADD)
+        // iterations = (end - start) / step
+        return *distance / static_cast<unsigned>(std::abs(stepValue.signedInt()));
+    if(inductionVariable.inductionStep->op == OP_SUB)
+        // iterations = (start - end) / step
+        return *distance / static_cast<unsigned>(std::abs(stepValue.signedInt()));
+    // XXX add support for more step operations
+    // E.g. mul? Need to calculate:
+    // limit = (start * step) ^ iterations -> iterations = log(start * step) / log(limit)
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Unsupported induction operation for: " << inductionVariable.local->to_string()
+            << " and induction step: " << inductionVariable.inductionStep->to_string() << logging::endl);
+    return {};
+}
+
+static void determineIterationBounds(LoopInfo& info, ValueRangeCache& valueRanges)
+{
+    const auto& inductionVariable = info.iterationVariable.value();
+    if(!inductionVariable.initialAssignment || !inductionVariable.inductionStep ||
+        !inductionVariable.repeatCondition || !inductionVariable.repeatCondition->first ||
+        inductionVariable.repeatCondition->second.isUndefined())
+        // we need to know both bounds and the iteration step
+        return;
+
+    info.lowerBound = inductionVariable.initialAssignment->precalculate(4).first & &Value::getLiteralValue;
+    if(!info.lowerBound)
+    {
+        if(auto move = dynamic_cast<const MoveOperation*>(inductionVariable.initialAssignment))
+            info.lowerBound = resolveConstant(move->getSource(), valueRanges);
+    }
+    info.upperBound = resolveConstant(inductionVariable.repeatCondition->second, valueRanges);
+    if(auto stepValue = inductionVariable.inductionStep->findOtherArgument(inductionVariable.local->createReference()))
+        info.stepValue = resolveConstant(*stepValue, valueRanges);
+
+    if(info.lowerBound && info.upperBound && info.stepValue)
+        info.tripCount =
+            LoopInfo::calculateTripCount(inductionVariable, *info.lowerBound, *info.upperBound, *info.stepValue);
+}
+
+FastAccessList<LoopInfo> LoopInfo::determineLoopInfos(const FastAccessList<ControlFlowLoop>& loops,
+    const DataDependencyGraph& dependencyGraph, ValueRangeCache& valueRanges)
+{
+    PROFILE_START(determineLoopInfos);
+    FastAccessList<LoopInfo> infos;
+    infos.reserve(loops.size());
+
+    for(const auto& loop : loops)
+    {
+        infos.emplace_back();
+        auto& info = infos.back();
+        info.loop = loop;
+        info.inductionVariables = loop.findInductionVariables(dependencyGraph, true);
+        if(info.inductionVariables.size() == 1)
+        {
+            info.iterationVariable = info.inductionVariables.front();
+            determineIterationBounds(info, valueRanges);
+        }
+
+        CPPLOG_LAZY_BLOCK(logging::Level::DEBUG, {
+            for(const auto& var : info.inductionVariables)
+                logging::debug() << "Induction variable: " << var.local->to_string() << " from "
+                                 << var.initialAssignment->to_string() << " step " << var.inductionStep->to_string()
+                                 << " while "
+                                 << (var.repeatCondition ?
+                                            (var.repeatCondition->first +
+                                                (" " + var.repeatCondition->second.to_string())) :
+                                            "(?)")
+                                 << logging::endl;
+            if(info.tripCount)
+                logging::debug() << "Determined iteration count of " << *info.tripCount << logging::endl;
+        });
+    }
+
+    // the parent of a loop is the smallest loop including it
+    for(std::size_t i = 0; i < infos.size(); ++i)
+    {
+        for(std::size_t k = 0; k < infos.size(); ++k)
+        {
+            if(i == k || !infos[k].loop.includes(infos[i].loop))
+                continue;
+            if(!infos[i].parentLoop || infos[k].loop.size() < infos[infos[i].parentLoop.value()].loop.size())
+                infos[i].parentLoop = k;
+        }
+        if(infos[i].parentLoop)
+            infos[infos[i].parentLoop.value()].innerLoops.push_back(i);
+    }
+    for(auto& info : infos)
+    {
+        auto parent = info.parentLoop;
+        while(parent)
+        {
+            ++info.nestingDepth;
+            parent = infos[*parent].parentLoop;
+        }
+    }
+
+    PROFILE_END(determineLoopInfos);
+    return infos;
+}
@@ -0,0 +1,66 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_LOOP_INFO_H
+#define VC4C_LOOP_INFO_H
+
+#include "../performance.h"
+#include "ControlFlowLoop.h"
+
+namespace vc4c
+{
+    namespace analysis
+    {
+        class ValueRangeCache;
+
+        /*
+         * The information about a single control flow loop required by loop transformations (e.g. vectorization and
+         * unrolling), i.e. the induction variables, the iteration bounds and count and the position in the loop nest.
+         *
+         * NOTE: Like the ControlFlowLoop, a loop info can only be used within the life-time of the ControlFlowGraph it
+         * is created from!
+         */
+        struct LoopInfo
+        {
+            // the basic blocks of the loop
+            ControlFlowLoop loop;
+            // all induction variables of the loop (including the iteration information, if it could be determined)
+            FastAccessList<InductionVariable> inductionVariables;
+            // the single loop iteration variable, not set if the loop has none or several induction variables
+            Optional<InductionVariable> iterationVariable;
+            // the initial value, the limit and the step of the iteration variable, if they are constant
+            Optional<Literal> lowerBound;
+            Optional<Literal> upperBound;
+            Optional<Literal> stepValue;
+            // the exact number of loop iterations, if it can be statically determined
+            Optional<unsigned> tripCount;
+            // the index of the inner-most loop including this loop, not set for outer-most loops
+            Optional<std::size_t> parentLoop;
+            // the indices of the loops directly nested in this loop
+            FastAccessList<std::size_t> innerLoops;
+            // the number of loops this loop is nested in, 0 for outer-most loops
+            unsigned nestingDepth = 0;
+
+            /*
+             * Determines the loop information for all the given loops.
+             *
+             * The bounds of the iteration variables which are not constant themselves are looked up in the value range
+             * cache, and used if the range only contains a single value.
+             */
+            static FastAccessList<LoopInfo> determineLoopInfos(const FastAccessList<ControlFlowLoop>& loops,
+                const DataDependencyGraph& dependencyGraph, ValueRangeCache& valueRanges);
+
+            /*
+             * Calculates the number of iterations for the given iteration variable running from the lower to the upper
+             * bound with the given step.
+             */
+            static Optional<unsigned> calculateTripCount(
+                const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound, Literal stepValue);
+        };
+    } // namespace analysis
+} // namespace vc4c
+
+#endif /* VC4C_LOOP_INFO_H */
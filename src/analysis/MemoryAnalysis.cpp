@@ -353,8 +353,8 @@ static bool findTypeSizeShift(
     return true;
 }
 
-static Optional<MemoryAccessRange> determineAccessRange(
-    Method& method, const intermediate::IntermediateInstruction& inst, InstructionWalker memIt)
+static Optional<MemoryAccessRange> determineAccessRange(Method& method,
+    const intermediate::IntermediateInstruction& inst, InstructionWalker memIt, ValueRangeCache& rangeCache)
 {
     // 1. find writes to VPM DMA addresses with work-group uniform part in address values
     if(auto memInst = dynamic_cast<const intermediate::MemoryInstruction*>(&inst))
@@ -448,7 +448,7 @@ static Optional<MemoryAccessRange> determineAccessRange(
             range.dynamicAddressParts.emplace(val);
             if(val.first.checkLocal())
             {
-                if(auto singleRange = analysis::ValueRange::getValueRangeRecursive(val.first, &method))
+                if(auto singleRange = rangeCache.getValueRange(val.first))
                 {
                     if(range.offsetRange && *range.offsetRange)
                     {
@@ -482,6 +482,8 @@ AccessRanges analysis::determineAccessRanges(Method& method)
 {
     // TODO if we cannot find an access range for a local, we cannot combine any other access ranges for this globally!
     AccessRanges result;
+    // the address calculations of the different memory accesses often share parts, so only determine their ranges once
+    ValueRangeCache rangeCache(method);
     for(BasicBlock& block : method)
     {
         InstructionWalker it = block.walk();
@@ -489,7 +491,7 @@ AccessRanges analysis::determineAccessRanges(Method& method)
         {
             if(it.has() && (it->writesRegister(REG_VPM_DMA_LOAD_ADDR) || it->writesRegister(REG_VPM_DMA_STORE_ADDR)))
             {
-                if(auto range = determineAccessRange(method, *it.get(), it))
+                if(auto range = determineAccessRange(method, *it.get(), it, rangeCache))
                     result[range->memoryObject].emplace_back(std::move(range).value());
             }
             it.nextInBlock();
@@ -499,11 +501,11 @@ AccessRanges analysis::determineAccessRanges(Method& method)
 }
 
 static Optional<MemoryAccessRange> findAccessRange(Method& method, const Value& val, const Local* baseAddr,
-    InstructionWalker accessIt, const intermediate::IntermediateInstruction* defaultInst)
+    InstructionWalker accessIt, const intermediate::IntermediateInstruction* defaultInst, ValueRangeCache& rangeCache)
 {
     if(auto writer = getSingleWriter(val, defaultInst))
         // if there is a single address writer, take that one
-        return determineAccessRange(method, *writer, accessIt);
+        return determineAccessRange(method, *writer, accessIt, rangeCache);
     // TODO how to determine access range for a memory location for conditionally written address??
     return {};
 }
@@ -513,6 +515,7 @@ FastAccessList<MemoryAccessRange> analysis::determineAccessRanges(
 {
     // NOTE: If we cannot find one access range for a local, we cannot combine any other access ranges for this local!
     FastAccessList<MemoryAccessRange> result;
+    ValueRangeCache rangeCache(method);
     for(const auto& entry : access.accessInstructions)
     {
         const auto memInstr = entry.first.get<intermediate::MemoryInstruction>();
@@ -520,7 +523,7 @@ FastAccessList<MemoryAccessRange> analysis::determineAccessRanges(
         {
         case intermediate::MemoryOperation::READ:
         {
-            if(auto res = findAccessRange(method, memInstr->getSource(), baseAddr, entry.first, memInstr))
+            if(auto res = findAccessRange(method, memInstr->getSource(), baseAddr, entry.first, memInstr, rangeCache))
             {
                 result.emplace_back(std::move(res).value());
                 break;
@@ -534,7 +537,8 @@ FastAccessList<MemoryAccessRange> analysis::determineAccessRanges(
         case intermediate::MemoryOperation::WRITE:
         case intermediate::MemoryOperation::FILL:
         {
-            if(auto res = findAccessRange(method, memInstr->getDestination(), baseAddr, entry.first, memInstr))
+            if(auto res = findAccessRange(
+                    method, memInstr->getDestination(), baseAddr, entry.first, memInstr, rangeCache))
             {
                 result.emplace_back(std::move(res).value());
                 break;
@@ -555,7 +559,7 @@ FastAccessList<MemoryAccessRange> analysis::determineAccessRanges(
                 throw CompilationError(CompilationStep::GENERAL, "Failed to find address referring to memory location",
                     memInstr->to_string() + " and " + baseAddr->to_string());
 
-            if(auto res = findAccessRange(method, matchingAddress, baseAddr, entry.first, memInstr))
+            if(auto res = findAccessRange(method, matchingAddress, baseAddr, entry.first, memInstr, rangeCache))
             {
                 result.emplace_back(std::move(res).value());
                 break;
@@ -655,3 +659,85 @@ std::pair<bool, analysis::ValueRange> analysis::checkWorkGroupUniformParts(
     }
     return std::make_pair(true, offsetRange);
 }
+
+// The maximum depth of instructions to follow for determining the offset of an address to its memory object
+static constexpr unsigned MAX_OFFSET_DEPTH = 8;
+
+/*
+ * Determines the range of byte offsets of the given address relative to the given memory object it is based on
+ */
+static Optional<ValueRange> determineOffsetRange(
+    const Method& method, const Value& address, const Local* memoryObject, unsigned depth = 0)
+{
+    auto loc = address.checkLocal();
+    if(!loc || depth > MAX_OFFSET_DEPTH)
+        return {};
+    if(loc == memoryObject)
+        return ValueRange{0.0, 0.0};
+    auto writer = dynamic_cast<const intermediate::IntermediateInstruction*>(loc->getSingleWriter());
+    if(!writer || writer->hasConditionalExecution() || writer->hasUnpackMode() || writer->hasPackMode())
+        return {};
+    if(auto move = dynamic_cast<const intermediate::MoveOperation*>(writer))
+        return determineOffsetRange(method, move->getSource(), memoryObject, depth + 1);
+    auto op = dynamic_cast<const intermediate::Operation*>(writer);
+    if(!op || op->op != OP_ADD)
+        return {};
+    const auto& firstArg = op->assertArgument(0);
+    const auto& secondArg = op->assertArgument(1);
+    auto range = determineOffsetRange(method, firstArg, memoryObject, depth + 1);
+    auto offset = secondArg;
+    if(!range)
+    {
+        range = determineOffsetRange(method, secondArg, memoryObject, depth + 1);
+        offset = firstArg;
+    }
+    if(!range)
+        return {};
+    auto offsetRange = ValueRange::getValueRangeRecursive(offset, &method);
+    if(!offsetRange.hasExplicitBoundaries())
+        return {};
+    return ValueRange{range->minValue + offsetRange.minValue, range->maxValue + offsetRange.maxValue};
+}
+
+static bool isMemoryObject(const Local* local)
+{
+    return local->is<Global>() || local->is<StackAllocation>() ||
+        (local->is<Parameter>() && local->type.getPointerType());
+}
+
+bool analysis::mayAlias(const Method& method, const Value& firstAddress, unsigned firstNumBytes,
+    const Value& secondAddress, unsigned secondNumBytes)
+{
+    if(!firstAddress.checkLocal() || !secondAddress.checkLocal())
+        return true;
+    auto firstObject = firstAddress.local()->getBase(true);
+    auto secondObject = secondAddress.local()->getBase(true);
+    if(!isMemoryObject(firstObject) || !isMemoryObject(secondObject))
+        // e.g. addresses selected via phi-nodes, we cannot tell which memory they point to
+        return true;
+
+    if(firstObject != secondObject)
+    {
+        auto firstParam = firstObject->as<Parameter>();
+        auto secondParam = secondObject->as<Parameter>();
+        if(!firstParam || !secondParam)
+            // global data and stack allocations are separate memory objects, which cannot be accessed via any other
+            // memory object
+            return false;
+        if(has_flag(firstParam->decorations, ParameterDecorations::RESTRICT) ||
+            has_flag(secondParam->decorations, ParameterDecorations::RESTRICT))
+            return false;
+        auto firstSpace = firstParam->type.getPointerType()->addressSpace;
+        auto secondSpace = secondParam->type.getPointerType()->addressSpace;
+        return firstSpace == secondSpace || firstSpace == AddressSpace::GENERIC ||
+            secondSpace == AddressSpace::GENERIC;
+    }
+
+    auto firstRange = determineOffsetRange(method, firstAddress, firstObject);
+    auto secondRange = determineOffsetRange(method, secondAddress, secondObject);
+    if(!firstRange || !secondRange)
+        return true;
+    // the accesses cover the bytes [offset, offset + size)
+    return firstRange->minValue < secondRange->maxValue + secondNumBytes &&
+        secondRange->minValue < firstRange->maxValue + firstNumBytes;
+}
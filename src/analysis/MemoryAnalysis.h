@@ -136,6 +136,22 @@ namespace vc4c
         std::pair<bool, analysis::ValueRange> checkWorkGroupUniformParts(
             FastAccessList<MemoryAccessRange>& accessRanges, bool allowConstantOffsets = true);
 
+        /**
+         * Checks whether the two memory accesses of the given number of bytes at the given addresses might access the
+         * same memory, i.e. whether the order of the accesses needs to be kept, if at least one of them writes memory.
+         *
+         * The accesses are known to be independent, if they access:
+         * - different memory objects of which at least one is not a kernel parameter (e.g. __local buffers, constant
+         *   global data, private stack allocations), since these never overlap
+         * - different kernel parameters of which at least one is decorated as restrict or which point to different
+         *   address spaces
+         * - the same memory object at disjoint ranges of byte offsets (see ValueRange)
+         *
+         * NOTE: This function is intended to be run BEFORE the MemoryInstructions have been lowered!
+         */
+        bool mayAlias(const Method& method, const Value& firstAddress, unsigned firstNumBytes,
+            const Value& secondAddress, unsigned secondNumBytes);
+
     } // namespace analysis
 
 } // namespace vc4c
@@ -8,6 +8,7 @@
 #include "../Expression.h"
 #include "../InstructionWalker.h"
 #include "../Method.h"
+#include "../Module.h"
 #include "../Profiler.h"
 #include "../SIMDVector.h"
 #include "../asm/OpCodes.h"
@@ -610,7 +611,7 @@ Optional<ValueRange> ValueRange::getValueRange(intermediate::InstructionDecorati
             maxID =
                 *std::max_element(method->metaData.workGroupSizes.begin(), method->metaData.workGroupSizes.end()) - 1;
         else
-            maxID = NUM_QPUS - 1;
+            maxID = (method ? method->module.compilationConfig.target.numQPUs : NUM_QPUS) - 1;
         return ValueRange{0.0, static_cast<double>(maxID)};
     }
     else if(has_flag(deco, InstructionDecorations::BUILTIN_LOCAL_SIZE))
@@ -619,7 +620,7 @@ Optional<ValueRange> ValueRange::getValueRange(intermediate::InstructionDecorati
         if(method && method->metaData.isWorkGroupSizeSet())
             maxSize = *std::max_element(method->metaData.workGroupSizes.begin(), method->metaData.workGroupSizes.end());
         else
-            maxSize = NUM_QPUS;
+            maxSize = method ? method->module.compilationConfig.target.numQPUs : NUM_QPUS;
         return ValueRange{0.0, static_cast<double>(maxSize)};
     }
     else if(has_flag(deco, InstructionDecorations::BUILTIN_WORK_DIMENSIONS))
@@ -669,6 +670,49 @@ ValueRange ValueRange::getValueRangeRecursive(const Value& val, const Method* me
     return range;
 }
 
+ValueRange ValueRangeCache::getValueRange(const Value& val)
+{
+    auto loc = val.checkLocal();
+    if(loc)
+    {
+        auto rangeIt = ranges.find(loc);
+        if(rangeIt != ranges.end())
+        {
+            PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 122, "Cached value ranges reused", 1);
+            return rangeIt->second;
+        }
+        auto widenedIt = widenedRanges.find(loc);
+        if(widenedIt != widenedRanges.end())
+        {
+            PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 122, "Cached value ranges reused", 1);
+            return widenedIt->second;
+        }
+
+        PROFILE_START(RecursiveValueRange);
+        // the open set is not kept, since the partial ranges might still change on the next query
+        FastMap<const intermediate::IntermediateInstruction*, Optional<ValueRange>> openSet;
+        ValueRange::updateRecursively(loc, &method, ranges, closedSet, openSet);
+        ValueRange::processedOpenSet(&method, ranges, closedSet, openSet);
+        PROFILE_END(RecursiveValueRange);
+
+        rangeIt = ranges.find(loc);
+        if(rangeIt != ranges.end())
+            return rangeIt->second;
+    }
+    ValueRange range;
+    range.update(val.getConstantValue(), ranges, val.getSingleWriter(), &method);
+    if(loc)
+        widenedRanges.emplace(loc, range);
+    return range;
+}
+
+void ValueRangeCache::invalidate()
+{
+    ranges.clear();
+    closedSet.clear();
+    widenedRanges.clear();
+}
+
 static Optional<analysis::ValueRange> getRange(const SubExpression& sub, const Method* method)
 {
     if(auto val = sub.checkValue())
@@ -144,6 +144,41 @@ namespace vc4c
             static void processedOpenSet(const Method* method, FastMap<const Local*, ValueRange>& ranges,
                 FastMap<const intermediate::IntermediateInstruction*, ValueRange>& closedSet,
                 FastMap<const intermediate::IntermediateInstruction*, Optional<ValueRange>>& openSet);
+
+            friend class ValueRangeCache;
+        };
+
+        /*
+         * Memoizes the recursively determined value ranges (see ValueRange#getValueRangeRecursive()) of the locals of a
+         * single method.
+         *
+         * The ranges of all locals and writing instructions visited while determining the range of one value are kept
+         * and reused for all further queries, so the writers of common inputs (e.g. the address calculations shared by
+         * several memory accesses) are only walked once. Locals whose writes cannot be resolved (e.g. the phi-nodes of
+         * loop headers without a convergent expression) are widened to the range derived from their single writer (or
+         * to the full range) and are not re-visited either.
+         *
+         * NOTE: The cached ranges are not updated when the method is modified, so #invalidate() needs to be called
+         * after any modification of an instruction writing a local which might have been queried!
+         */
+        class ValueRangeCache : private NonCopyable
+        {
+        public:
+            explicit ValueRangeCache(const Method& method) : method(method) {}
+
+            ValueRange getValueRange(const Value& val);
+
+            /*
+             * Drops all cached ranges
+             */
+            void invalidate();
+
+        private:
+            const Method& method;
+            FastMap<const Local*, ValueRange> ranges;
+            FastMap<const intermediate::IntermediateInstruction*, ValueRange> closedSet;
+            // the ranges of the locals which could not be determined recursively
+            FastMap<const Local*, ValueRange> widenedRanges;
         };
 
         extern ValueRange RANGE_HALF;
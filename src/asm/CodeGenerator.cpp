@@ -13,14 +13,26 @@
 #include "../InstructionWalker.h"
 #include "../Module.h"
 #include "../Profiler.h"
+#include "../analysis/AnalysisManager.h"
+#include "../analysis/LoopInfo.h"
+#include "../optimization/Reordering.h"
+#include "../periphery/VPM.h"
+#include "ALUInstruction.h"
 #include "GraphColoring.h"
 #include "KernelInfo.h"
 #include "RegisterFixes.h"
 #include "log.h"
+#include "tools.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <climits>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <map>
+#include <set>
 #include <sstream>
 
 using namespace vc4c;
@@ -29,6 +41,27 @@ using namespace vc4c::intermediate;
 
 CodeGenerator::CodeGenerator(const Module& module, const Configuration& config) : config(config), module(module) {}
 
+// the number of iterations assumed for loops with a trip count which cannot be determined statically
+static constexpr double DEFAULT_LOOP_ITERATIONS = 8.0;
+
+/*
+ * Returns the expected number of executions of all basic blocks inside of loops, the product of the trip counts of all
+ * loops containing the block
+ */
+static FastMap<const BasicBlock*, double> determineBlockWeights(Method& method)
+{
+    // the register fix-ups and the filling of the delay slots modified the instructions
+    method.getAnalyses().invalidate();
+    FastMap<const BasicBlock*, double> weights;
+    for(const auto& info : method.getAnalyses().getLoopInfos())
+    {
+        auto iterations = info.tripCount ? static_cast<double>(info.tripCount.value()) : DEFAULT_LOOP_ITERATIONS;
+        for(const auto* node : info.loop)
+            weights.emplace(node->key, 1.0).first->second *= iterations;
+    }
+    return weights;
+}
+
 static FastMap<const Local*, std::size_t> mapLabels(Method& method)
 {
     CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
@@ -68,11 +101,72 @@ static FastMap<const Local*, std::size_t> mapLabels(Method& method)
     return labelsMap;
 }
 
+/*
+ * Pads the blocks preceding loop heads with (never executed) NOPs, so the loop heads start at the given alignment (in
+ * instructions) relative to the start of the kernel code. This reduces the number of instruction cache lines occupied
+ * by the loop body.
+ *
+ * Only loop heads which are not entered by falling through from their preceding block are aligned, since otherwise the
+ * padding would be executed too.
+ */
+static std::size_t alignLoopHeads(Method& method, unsigned alignment)
+{
+    // the loop heads are the targets of backward branches (or branches to the block itself)
+    FastSet<const Local*> previousLabels;
+    FastSet<const Local*> loopHeads;
+    for(auto& block : method)
+    {
+        previousLabels.emplace(block.getLabel()->getLabel());
+        for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            auto branch = it.get<Branch>();
+            if(branch && previousLabels.find(branch->getTarget()) != previousLabels.end())
+                loopHeads.emplace(branch->getTarget());
+        }
+    }
+    if(loopHeads.empty())
+        return 0;
+
+    std::size_t numInstructions = 0;
+    std::size_t numPadding = 0;
+    BasicBlock* previousBlock = nullptr;
+    bool canFallThrough = true;
+    for(auto& block : method)
+    {
+        if(previousBlock && !canFallThrough && numInstructions % alignment != 0 &&
+            loopHeads.find(block.getLabel()->getLabel()) != loopHeads.end())
+        {
+            auto padding = alignment - numInstructions % alignment;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Inserting " << padding << " instructions of padding to align loop head: " << block.to_string()
+                    << logging::endl);
+            // the padding is placed after the delay slots of the last branch and is therefore never executed
+            for(std::size_t i = 0; i < padding; ++i)
+                previousBlock->walkEnd().emplace(new Nop(DelayType::BRANCH_DELAY));
+            numInstructions += padding;
+            numPadding += padding;
+        }
+        // a block can only fall through to its successor, if it does not end with an unconditional branch
+        canFallThrough = true;
+        for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has() || !it->mapsToASMInstruction())
+                continue;
+            ++numInstructions;
+            if(auto branch = it.get<Branch>())
+                canFallThrough = !branch->isUnconditional();
+        }
+        previousBlock = &block;
+    }
+    return numPadding;
+}
+
 static FixupResult runRegisterFixupStep(const std::pair<std::string, RegisterFixupStep>& step, Method& method,
     const Configuration& config, std::unique_ptr<GraphColoring>& coloredGraph)
 {
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Running register fix-up step: " << step.first << "..." << logging::endl);
     PROFILE_START(runRegisterFixupStep);
+    profiler::TraceScope trace("fixup", step.first.c_str());
     auto result = step.second(method, config, *coloredGraph);
     PROFILE_END(runRegisterFixupStep);
     return result;
@@ -99,7 +193,8 @@ const FastAccessList<DecoratedInstruction>& CodeGenerator::generateInstructions(
         if(!coloredGraph || lastResult == FixupResult::FIXES_APPLIED_RECREATE_GRAPH)
         {
             PROFILE_START(initializeLocalsUses);
-            coloredGraph = std::make_unique<GraphColoring>(method, method.walkAllInstructions());
+            coloredGraph =
+                std::make_unique<GraphColoring>(method, method.walkAllInstructions(), config.registerAllocator);
             PROFILE_END(initializeLocalsUses);
         }
         if(lastResult != FixupResult::NOTHING_FIXED)
@@ -127,7 +222,8 @@ const FastAccessList<DecoratedInstruction>& CodeGenerator::generateInstructions(
         if(!coloredGraph || lastResult == FixupResult::FIXES_APPLIED_RECREATE_GRAPH)
         {
             PROFILE_START(initializeLocalsUses);
-            coloredGraph = std::make_unique<GraphColoring>(method, method.walkAllInstructions());
+            coloredGraph =
+                std::make_unique<GraphColoring>(method, method.walkAllInstructions(), config.registerAllocator);
             PROFILE_END(initializeLocalsUses);
         }
         PROFILE_START(colorGraph);
@@ -137,17 +233,53 @@ const FastAccessList<DecoratedInstruction>& CodeGenerator::generateInstructions(
         PROFILE_END(colorGraph);
     }
 
+    // map to registers
+    PROFILE_START(toRegisterMap);
+    auto registerMapping = coloredGraph->toRegisterMap();
+    PROFILE_END(toRegisterMap);
+
+    if(config.optimizationLevel != OptimizationLevel::NONE)
+    {
+        // this needs to run after all register fixups, since they might insert instructions in front of the moved ones
+        PROFILE_START(fillBranchDelaySlots);
+        optimizations::fillBranchDelaySlots(method, registerMapping, coloredGraph->getLivenessAnalysis());
+        PROFILE_END(fillBranchDelaySlots);
+        PROFILE_START(fillDelayNops);
+        optimizations::fillDelayNops(method, registerMapping, config.additionalOptions.replaceNopThreshold);
+        PROFILE_END(fillDelayNops);
+    }
+
+    if(config.additionalOptions.loopAlignment > 1)
+    {
+        // this needs to run after all instructions are moved, since it depends on the final position of all blocks
+        PROFILE_START(alignLoopHeads);
+        auto numPadding = alignLoopHeads(method, config.additionalOptions.loopAlignment);
+        PROFILE_END(alignLoopHeads);
+        if(numPadding > 0)
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Inserted " << numPadding << " instructions to align loop heads" << logging::endl);
+    }
+
     // create label-map + remove labels
     const auto labelMap = mapLabels(method);
+    if(!config.profileGenerateFile.empty())
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+        auto kernelName = analysis::ExecutionProfile::getKernelName(method);
+        for(const auto& label : labelMap)
+            blockPositions.addEntry(kernelName, label.first->name, label.second);
+    }
+
+    FastMap<const BasicBlock*, double> blockWeights;
+    std::vector<BlockCost> blocks;
+    if(!config.statisticsOutputFile.empty())
+        blockWeights = determineBlockWeights(method);
 
     // IMPORTANT: DO NOT OPTIMIZE, RE-ORDER, COMBINE, INSERT OR REMOVE ANY INSTRUCTION AFTER THIS POINT!!!
     // otherwise, labels/branches will be wrong
 
-    // map to registers
-    PROFILE_START(toRegisterMap);
-    auto registerMapping = coloredGraph->toRegisterMap();
-    PROFILE_END(toRegisterMap);
-
     CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
     std::size_t index = 0;
 
@@ -168,6 +300,17 @@ const FastAccessList<DecoratedInstruction>& CodeGenerator::generateInstructions(
         assert(label != nullptr);
         ++it;
 
+        if(!config.statisticsOutputFile.empty())
+        {
+            BlockCost block;
+            block.label = label->getLabel()->name;
+            block.firstInstruction = index;
+            auto weightIt = blockWeights.find(&bb);
+            if(weightIt != blockWeights.end())
+                block.weight = weightIt->second;
+            blocks.emplace_back(std::move(block));
+        }
+
         auto instr = it->get();
         if(instr->mapsToASMInstruction())
         {
@@ -192,6 +335,14 @@ const FastAccessList<DecoratedInstruction>& CodeGenerator::generateInstructions(
         }
     }
 
+    if(!config.statisticsOutputFile.empty())
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+        blockCosts[&method] = std::move(blocks);
+    }
+
     CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
     index = 0;
     for(const auto& instr : generatedInstructions)
@@ -207,78 +358,557 @@ const FastAccessList<DecoratedInstruction>& CodeGenerator::generateInstructions(
     return generatedInstructions;
 }
 
-std::size_t CodeGenerator::writeOutput(std::ostream& stream)
+static std::size_t writeInstructions(
+    std::ostream& stream, const FastAccessList<DecoratedInstruction>& instructions, OutputMode outputMode)
 {
-    ModuleInfo moduleInfo;
+    std::size_t numBytes = 0;
+    switch(outputMode)
+    {
+    case OutputMode::ASSEMBLER:
+        for(const auto& instr : instructions)
+        {
+            stream << instr.toASMString() << std::endl;
+            numBytes += 0; // doesn't matter here, since the number of bytes is unused for assembler output
+        }
+        break;
+    case OutputMode::BINARY:
+        // handled directly in #finishKernel()
+        break;
+    case OutputMode::HEX:
+        for(const auto& instr : instructions)
+        {
+            stream << instr.toHexString(true) << std::endl;
+            numBytes += 8; // doesn't matter here, since the number of bytes is unused for hexadecimal output
+        }
+    }
+    return numBytes;
+}
+
+double KernelStatistics::getPairingRate() const
+{
+    if(numALUInstructions == 0)
+        return 0.0;
+    return static_cast<double>(numPairedInstructions) / static_cast<double>(numALUInstructions);
+}
+
+static bool isPeripheryAccess(Register reg, Register periphery)
+{
+    // the periphery registers are accessible via both physical register-files
+    return reg.file != RegisterFile::ACCUMULATOR && reg.num == periphery.num;
+}
+
+// the number of instructions after writing an SFU register until the result can be read from r4 without stalling
+static constexpr std::size_t SFU_DELAY = 3;
+
+KernelStatistics qpu_asm::calculateKernelStatistics(const FastAccessList<DecoratedInstruction>& instructions,
+    std::size_t numSpilledLocals, std::vector<BlockCost> blocks)
+{
+    KernelStatistics statistics;
+    statistics.numInstructions = instructions.size();
+    statistics.numSpilledLocals = numSpilledLocals;
+    std::set<Register> usedRegisters;
+
+    const tools::TimingModel timing{};
+    if(blocks.empty())
+        blocks.emplace_back();
+    // the cycles the results of the pending SFU calculation, TMU loads and DMA transfers become available in
+    std::size_t sfuReadyCycle = 0;
+    std::array<std::deque<std::size_t>, 2> tmuReadyCycles;
+    std::size_t dmaLoadDoneCycle = 0;
+    std::size_t dmaStoreDoneCycle = 0;
+    Optional<std::size_t> mutexLockCycle;
+    std::size_t cycle = 0;
+    auto blockIt = blocks.begin();
+
+    for(std::size_t index = 0; index < instructions.size(); ++index)
+    {
+        while(std::next(blockIt) != blocks.end() && std::next(blockIt)->firstInstruction <= index)
+            ++blockIt;
+        const auto& instr = instructions[index].instruction;
+        // the cycles this instruction stalls before being executed
+        std::size_t numStallCycles = 0;
+        const auto waitFor = [&](std::size_t readyCycle, std::size_t& stallCounter) {
+            if(readyCycle > cycle + numStallCycles)
+            {
+                stallCounter += readyCycle - (cycle + numStallCycles);
+                numStallCycles = readyCycle - cycle;
+            }
+        };
+
+        // non-ALU instructions (branches, loads and semaphores) always write both outputs, nop-register included
+        bool writesAdd = true;
+        bool writesMul = true;
+        bool locksMutex = false;
+        if(auto alu = instr.as<ALUInstruction>())
+        {
+            writesAdd = alu->getAddition() != OP_NOP.opAdd;
+            writesMul = alu->getMultiplication() != OP_NOP.opMul;
+            if(!writesAdd && !writesMul && alu->getSig() == SIGNAL_NONE)
+                ++statistics.numNops;
+            if(writesAdd || writesMul)
+                ++statistics.numALUInstructions;
+            if(writesAdd && writesMul)
+                ++statistics.numPairedInstructions;
+
+            const std::array<Register, 4> inputs{alu->getAddFirstOperand(), alu->getAddSecondOperand(),
+                alu->getMulFirstOperand(), alu->getMulSecondOperand()};
+            // reading the same register for multiple operands only reads the periphery once
+            const auto readsRegister = [&](Register periphery) -> bool {
+                return std::any_of(inputs.begin(), inputs.end(),
+                    [&](Register input) -> bool { return isPeripheryAccess(input, periphery); });
+            };
+            // the DMA wait registers are only distinguished by their register-file
+            const auto readsExactRegister = [&](Register reg) -> bool {
+                return std::find(inputs.begin(), inputs.end(), reg) != inputs.end();
+            };
+            if(readsRegister(REG_UNIFORM))
+                ++statistics.numUniformReads;
+            if(readsRegister(REG_VPM_IO))
+                ++statistics.numVPMAccesses;
+            if(readsRegister(REG_MUTEX))
+            {
+                ++statistics.numMutexRegions;
+                locksMutex = true;
+            }
+            if(readsExactRegister(REG_SFU_OUT))
+                waitFor(sfuReadyCycle, statistics.numSFUStallCycles);
+            if(readsExactRegister(REG_VPM_DMA_LOAD_WAIT))
+                waitFor(dmaLoadDoneCycle, statistics.numVPMStallCycles);
+            if(readsExactRegister(REG_VPM_DMA_STORE_WAIT))
+                waitFor(dmaStoreDoneCycle, statistics.numVPMStallCycles);
+        }
+        if(instr.getSig() == SIGNAL_LOAD_TMU0 || instr.getSig() == SIGNAL_LOAD_TMU1)
+        {
+            auto& pendingLoads = tmuReadyCycles[instr.getSig() == SIGNAL_LOAD_TMU0 ? 0 : 1];
+            if(!pendingLoads.empty())
+            {
+                waitFor(pendingLoads.front(), statistics.numTMUStallCycles);
+                pendingLoads.pop_front();
+            }
+        }
+
+        const auto executionCycle = cycle + numStallCycles;
+        if(locksMutex)
+            mutexLockCycle = executionCycle;
+        const auto countOutput = [&](Register output) {
+            if(isPeripheryAccess(output, REG_VPM_IO))
+                ++statistics.numVPMAccesses;
+            if(isPeripheryAccess(output, REG_TMU0_ADDRESS))
+            {
+                ++statistics.numTMUAccesses;
+                tmuReadyCycles[0].push_back(executionCycle + timing.tmuLatency);
+            }
+            if(isPeripheryAccess(output, REG_TMU1_ADDRESS))
+            {
+                ++statistics.numTMUAccesses;
+                tmuReadyCycles[1].push_back(executionCycle + timing.tmuLatency);
+            }
+            if(isPeripheryAccess(output, REG_SFU_RECIP) || isPeripheryAccess(output, REG_SFU_RECIP_SQRT) ||
+                isPeripheryAccess(output, REG_SFU_EXP2) || isPeripheryAccess(output, REG_SFU_LOG2))
+                sfuReadyCycle = executionCycle + SFU_DELAY;
+            if(output == REG_VPM_DMA_LOAD_ADDR)
+                dmaLoadDoneCycle = executionCycle + timing.dmaLatency;
+            if(output == REG_VPM_DMA_STORE_ADDR)
+                dmaStoreDoneCycle = executionCycle + timing.dmaLatency;
+            if(isPeripheryAccess(output, REG_MUTEX) && mutexLockCycle)
+            {
+                auto regionCycles = executionCycle + 1 - mutexLockCycle.value();
+                statistics.numMutexCycles += regionCycles;
+                statistics.maxMutexRegionCycles = std::max(statistics.maxMutexRegionCycles, regionCycles);
+                mutexLockCycle = {};
+            }
+            if(output.isGeneralPurpose() || output.file == RegisterFile::ACCUMULATOR)
+                usedRegisters.emplace(output);
+        };
+        if(writesAdd)
+            countOutput(instr.getAddOutput());
+        if(writesMul)
+            countOutput(instr.getMulOutput());
+
+        cycle = executionCycle + 1;
+        ++blockIt->numInstructions;
+        blockIt->numCycles += numStallCycles + 1;
+    }
+    statistics.numRegistersUsed = usedRegisters.size();
+    for(const auto& block : blocks)
+        statistics.estimatedCycles += static_cast<double>(block.numCycles) * block.weight;
+    statistics.blocks = std::move(blocks);
+    return statistics;
+}
+
+std::vector<uint8_t> CodeGenerator::prepareModuleInfo(ModuleInfo& moduleInfo)
+{
+    std::vector<Method*> pendingKernels;
+    pendingKernels.reserve(allInstructions.size());
+    for(const auto& pair : allInstructions)
+        pendingKernels.push_back(pair.first);
+    for(auto kernel : pendingKernels)
+        finishKernel(*kernel);
 
     std::size_t maxStackSize = 0;
     for(const auto& m : module)
-        maxStackSize = std::max(maxStackSize, m->calculateStackSize() * m->metaData.getWorkGroupSize());
+    {
+        // the aliases are not compiled themselves and therefore have no valid stack-frame information
+        auto aliasIt = kernelAliases.find(m.get());
+        auto kernel = aliasIt != kernelAliases.end() ? aliasIt->second : m.get();
+        auto precompiledIt = precompiledKernels.find(kernel);
+        auto stackSize = precompiledIt != precompiledKernels.end() ?
+            precompiledIt->second.second :
+            kernel->calculateStackSize() * kernel->metaData.getWorkGroupSize(config.target.numQPUs);
+        maxStackSize = std::max(maxStackSize, stackSize);
+    }
     if(maxStackSize / sizeof(uint64_t) > std::numeric_limits<uint16_t>::max() || maxStackSize % sizeof(uint64_t) != 0)
         throw CompilationError(
             CompilationStep::CODE_GENERATION, "Stack-frame has unsupported size of", std::to_string(maxStackSize));
     moduleInfo.setStackFrameSize(Word(Byte(maxStackSize)));
 
-    std::size_t numBytes = 0;
+    // the global data is only written as binary data, the assembler output lists the globals themselves
+    auto dataSegment = config.outputMode == OutputMode::ASSEMBLER ?
+        std::vector<uint8_t>{} :
+        generateDataSegment(module.globalData, Byte(maxStackSize));
+
+    // every section of the sectioned format can be loaded on its own and therefore needs to contain the kernel code
+    const bool isSectioned = config.sectionedBinary && config.outputMode == OutputMode::BINARY;
+    if(isSectioned)
+    {
+        for(const auto& alias : kernelAliases)
+            finishedKernels[alias.first] = finishedKernels.at(alias.second);
+    }
+
+    kernelOrder = determineKernelOrder();
+    logging::logLazy(logging::Level::INFO, [&]() {
+        std::size_t totalInstructions = 0;
+        for(auto kernel : kernelOrder)
+        {
+            auto numInstructions = finishedKernels.at(kernel).numInstructions;
+            logging::info() << "Kernel '" << kernel->name << "' has " << numInstructions << " instructions ("
+                            << numInstructions * sizeof(uint64_t) << " bytes)" << logging::endl;
+            totalInstructions += numInstructions;
+        }
+        logging::info() << "Generated " << totalInstructions << " instructions for " << kernelOrder.size()
+                        << " kernels" << logging::endl;
+    });
+
     // initial offset is zero
     std::size_t offset = 0;
-    if(config.writeKernelInfo)
+    // the sectioned format always contains the kernel infos, since they are part of the kernel sections
+    if(config.writeKernelInfo || isSectioned)
     {
-        moduleInfo.kernelInfos.reserve(allInstructions.size());
+        moduleInfo.kernelInfos.reserve(kernelOrder.size() + kernelAliases.size());
         // generate kernel-infos
-        for(const auto& pair : allInstructions)
+        for(auto kernel : kernelOrder)
+        {
+            const auto& finished = finishedKernels.at(kernel);
+            moduleInfo.addKernelInfo(createKernelInfo(*kernel, offset, finished.numInstructions));
+            // the aliases without code of their own refer to the code of this kernel
+            for(const auto& m : module)
+            {
+                auto aliasIt = kernelAliases.find(m.get());
+                if(aliasIt != kernelAliases.end() && aliasIt->second == kernel &&
+                    finishedKernels.find(m.get()) == finishedKernels.end())
+                    moduleInfo.addKernelInfo(createKernelInfo(*m, offset, finished.numInstructions));
+            }
+            offset += finished.numInstructions;
+        }
+    }
+    // add global offset (size of header)
+    offset = moduleInfo.calculateHeaderSize(config.outputMode, dataSegment);
+    for(KernelInfo& info : moduleInfo.kernelInfos)
+        info.setOffset(info.getOffset() + Word(offset));
+    return dataSegment;
+}
+
+KernelInfo CodeGenerator::createKernelInfo(Method& kernel, std::size_t offset, std::size_t numInstructions) const
+{
+    auto aliasIt = kernelAliases.find(&kernel);
+    auto compiledKernel = aliasIt != kernelAliases.end() ? aliasIt->second : &kernel;
+    auto precompiledIt = precompiledKernels.find(compiledKernel);
+    KernelInfo info = precompiledIt != precompiledKernels.end() ?
+        precompiledIt->second.first :
+        getKernelInfos(*compiledKernel, offset, numInstructions);
+    info.setOffset(Word(offset));
+    info.setLength(Word(numInstructions));
+    if(compiledKernel != &kernel)
+    {
+        // the alias only differs in the names of the kernel and its parameters
+        info.setName(kernel.name[0] == '@' ? kernel.name.substr(1) : kernel.name);
+        for(std::size_t i = 0; i < std::min(info.parameters.size(), kernel.parameters.size()); ++i)
+        {
+            const auto& param = kernel.parameters[i];
+            const auto& paramName = param.parameterName.empty() ? param.name : param.parameterName;
+            info.parameters[i].setName(paramName[0] == '%' ? paramName.substr(1) : paramName);
+            if(!param.origTypeName.empty())
+                info.parameters[i].setTypeName(param.origTypeName);
+        }
+    }
+    return info;
+}
+
+std::vector<Method*> CodeGenerator::determineKernelOrder() const
+{
+    std::vector<std::pair<Method*, uint64_t>> kernels;
+    kernels.reserve(finishedKernels.size());
+    for(const auto& m : module)
+    {
+        if(finishedKernels.find(m.get()) == finishedKernels.end())
+            continue;
+        // the total number of block executions approximates how much of the execution time is spent in the kernel
+        uint64_t numExecutions = 0;
+        if(auto entries = module.executionProfile.getEntries(analysis::ExecutionProfile::getKernelName(*m)))
+        {
+            for(const auto& entry : *entries)
+                numExecutions += entry.second;
+        }
+        kernels.emplace_back(m.get(), numExecutions);
+    }
+    // place the executed kernels next to each other at the start of the code, all others keep the module order
+    std::stable_sort(kernels.begin(), kernels.end(),
+        [](const std::pair<Method*, uint64_t>& one, const std::pair<Method*, uint64_t>& other) -> bool {
+            return one.second > other.second;
+        });
+    std::vector<Method*> order;
+    order.reserve(kernels.size());
+    for(const auto& pair : kernels)
+        order.push_back(pair.first);
+    return order;
+}
+
+void CodeGenerator::writeStatistics() const
+{
+    if(config.statisticsOutputFile.empty())
+        return;
+    std::ofstream out(config.statisticsOutputFile, std::ios::trunc);
+    if(!out)
+        throw CompilationError(
+            CompilationStep::CODE_GENERATION, "Failed to open file to write statistics", config.statisticsOutputFile);
+    out << "{" << std::endl;
+    for(auto it = kernelOrder.begin(); it != kernelOrder.end(); ++it)
+    {
+        const auto& stats = finishedKernels.at(*it).statistics;
+        out << "  \"" << (*it)->name << "\": {\"instructions\": " << stats.numInstructions
+            << ", \"nops\": " << stats.numNops << ", \"aluInstructions\": " << stats.numALUInstructions
+            << ", \"pairedInstructions\": " << stats.numPairedInstructions
+            << ", \"pairingRate\": " << stats.getPairingRate() << ", \"spilledLocals\": " << stats.numSpilledLocals
+            << ", \"vpmAccesses\": " << stats.numVPMAccesses << ", \"tmuAccesses\": " << stats.numTMUAccesses
+            << ", \"mutexRegions\": " << stats.numMutexRegions << ", \"registersUsed\": " << stats.numRegistersUsed
+            << ", \"uniformReads\": " << stats.numUniformReads << ", \"sfuStalls\": " << stats.numSFUStallCycles
+            << ", \"tmuStalls\": " << stats.numTMUStallCycles << ", \"vpmStalls\": " << stats.numVPMStallCycles
+            << ", \"mutexCycles\": " << stats.numMutexCycles << ", \"maxMutexRegion\": " << stats.maxMutexRegionCycles
+            << ", \"estimatedCycles\": " << stats.estimatedCycles << ", \"blocks\": [";
+        for(auto blockIt = stats.blocks.begin(); blockIt != stats.blocks.end(); ++blockIt)
         {
-            moduleInfo.addKernelInfo(getKernelInfos(*pair.first, offset, pair.second.size()));
-            offset += pair.second.size();
+            // the block entries use different keys than the kernel entries to keep those unique per kernel
+            out << (blockIt != stats.blocks.begin() ? ", " : "") << "{\"label\": \"" << blockIt->label
+                << "\", \"start\": " << blockIt->firstInstruction << ", \"length\": " << blockIt->numInstructions
+                << ", \"cycles\": " << blockIt->numCycles << ", \"weight\": " << blockIt->weight << "}";
         }
-        // add global offset (size of  header)
-        std::ostringstream dummyStream;
-        offset = moduleInfo.write(dummyStream, config.outputMode, module.globalData, Byte(maxStackSize));
+        out << "]" << (std::next(it) != kernelOrder.end() ? "}," : "}") << std::endl;
+    }
+    out << "}" << std::endl;
+}
+
+void CodeGenerator::writeBlockPositions() const
+{
+    if(!config.profileGenerateFile.empty())
+    {
+        std::ofstream positions(config.profileGenerateFile, std::ios::trunc);
+        if(!positions)
+            throw CompilationError(CompilationStep::CODE_GENERATION, "Failed to open file to write block positions",
+                config.profileGenerateFile);
+        blockPositions.writeTo(positions);
+    }
+}
 
-        for(KernelInfo& info : moduleInfo.kernelInfos)
-            info.setOffset(info.getOffset() + Word(offset));
+std::size_t CodeGenerator::writeOutput(std::ostream& stream)
+{
+    if(config.outputMode == OutputMode::BINARY)
+    {
+        // the whole module is written at once
+        auto binary = generateBinary();
+        stream.write(reinterpret_cast<const char*>(binary.data()), static_cast<std::streamsize>(binary.size()));
+        stream.flush();
+        return binary.size();
     }
+
+    ModuleInfo moduleInfo;
+    auto dataSegment = prepareModuleInfo(moduleInfo);
+
     // prepend module header to output
     // also write, if writeKernelInfo is not set, since global-data is written in here too
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Writing module header..." << logging::endl);
-    numBytes += moduleInfo.write(stream, config.outputMode, module.globalData, Byte(maxStackSize)) * sizeof(uint64_t);
+    std::size_t numBytes =
+        moduleInfo.write(stream, config.outputMode, module.globalData, dataSegment,
+            moduleInfo.getStackFrameSize().toBytes()) *
+        sizeof(uint64_t);
 
-    for(const auto& pair : allInstructions)
+    for(auto kernel : kernelOrder)
     {
-        switch(config.outputMode)
-        {
-        case OutputMode::ASSEMBLER:
-            for(const auto& instr : pair.second)
-            {
-                stream << instr.toASMString() << std::endl;
-                numBytes += 0; // doesn't matter here, since the number of bytes is unused for assembler output
-            }
-            break;
-        case OutputMode::BINARY:
-            for(const auto& instr : pair.second)
-            {
-                const uint64_t binary = instr.toBinaryCode();
-                stream.write(reinterpret_cast<const char*>(&binary), 8);
-                numBytes += 8;
-            }
-            break;
-        case OutputMode::HEX:
-            for(const auto& instr : pair.second)
-            {
-                stream << instr.toHexString(true) << std::endl;
-                numBytes += 8; // doesn't matter here, since the number of bytes is unused for hexadecimal output
-            }
-        }
+        const auto& finished = finishedKernels.at(kernel);
+        stream << finished.code;
+        numBytes += finished.numBytes;
     }
     stream.flush();
+
+    writeBlockPositions();
+    writeStatistics();
     return numBytes;
 }
 
+std::vector<uint8_t> CodeGenerator::generateBinary()
+{
+    if(config.outputMode != OutputMode::BINARY)
+        throw CompilationError(CompilationStep::CODE_GENERATION, "Generating binary code requires binary output mode");
+
+    ModuleInfo moduleInfo;
+    auto dataSegment = prepareModuleInfo(moduleInfo);
+    auto totalSize = (config.sectionedBinary ? moduleInfo.calculateSectionedLayout(dataSegment) :
+                                               moduleInfo.calculateHeaderSize(config.outputMode, dataSegment)) *
+        sizeof(uint64_t);
+    for(auto kernel : kernelOrder)
+        totalSize += finishedKernels.at(kernel).numBytes;
+    if(config.sectionedBinary)
+    {
+        for(const auto& info : moduleInfo.kernelInfos)
+            totalSize += info.getNumWords() * sizeof(uint64_t);
+    }
+
+    CPPLOG_LAZY(logging::Level::DEBUG, log << "Writing module header..." << logging::endl);
+    std::ostringstream header;
+    if(config.sectionedBinary)
+        moduleInfo.writeSectionedHeader(header, dataSegment);
+    else
+        moduleInfo.write(
+            header, config.outputMode, module.globalData, dataSegment, moduleInfo.getStackFrameSize().toBytes());
+    // release the data segment, since it is now contained in the header
+    dataSegment = {};
+
+    std::vector<uint8_t> binary;
+    binary.reserve(totalSize);
+    auto headerData = header.str();
+    binary.insert(binary.end(), headerData.begin(), headerData.end());
+    // the kernel infos are in the same order as the kernels
+    auto infoIt = moduleInfo.kernelInfos.begin();
+    for(auto kernel : kernelOrder)
+    {
+        if(config.sectionedBinary)
+        {
+            // every kernel section starts with the kernel info
+            std::ostringstream info;
+            (infoIt++)->write(info, OutputMode::BINARY);
+            auto infoData = info.str();
+            binary.insert(binary.end(), infoData.begin(), infoData.end());
+        }
+        const auto& code = finishedKernels.at(kernel).code;
+        binary.insert(binary.end(), code.begin(), code.end());
+    }
+
+    writeBlockPositions();
+    writeStatistics();
+    return binary;
+}
+
+void CodeGenerator::addPrecompiledKernel(Method& kernel, CachedKernel&& precompiled)
+{
+#ifdef MULTI_THREADED
+    std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+    allInstructions[&kernel] = std::move(precompiled.instructions);
+    precompiledKernels.emplace(&kernel, std::make_pair(std::move(precompiled.info), precompiled.stackSize));
+    spilledLocals[&kernel] = precompiled.numSpilledLocals;
+}
+
+void CodeGenerator::addKernelAlias(Method& alias, Method& kernel)
+{
+#ifdef MULTI_THREADED
+    std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+    kernelAliases[&alias] = &kernel;
+}
+
+CachedKernel CodeGenerator::getCompiledKernel(Method& kernel)
+{
+    CachedKernel compiled;
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+        compiled.instructions = allInstructions.at(&kernel);
+        compiled.numSpilledLocals = spilledLocals.at(&kernel);
+    }
+    compiled.info = getKernelInfos(kernel, 0, compiled.instructions.size());
+    compiled.stackSize = kernel.calculateStackSize() * kernel.metaData.getWorkGroupSize(config.target.numQPUs);
+    return compiled;
+}
+
+void CodeGenerator::finishKernel(Method& kernel)
+{
+    FastAccessList<DecoratedInstruction> instructions;
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+        auto it = allInstructions.find(&kernel);
+        if(it == allInstructions.end())
+            return;
+        instructions = std::move(it->second);
+        allInstructions.erase(it);
+    }
+    std::size_t numSpilledLocals = 0;
+    std::vector<BlockCost> blocks;
+    if(!config.statisticsOutputFile.empty())
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+        numSpilledLocals = spilledLocals.at(&kernel);
+        // precompiled kernels have no basic block information
+        auto blockIt = blockCosts.find(&kernel);
+        if(blockIt != blockCosts.end())
+        {
+            blocks = std::move(blockIt->second);
+            blockCosts.erase(blockIt);
+        }
+    }
+    // the conversion to the output representation can run in parallel for different kernels
+    FinishedKernel finished{instructions.size(), 0, "", {}};
+    if(!config.statisticsOutputFile.empty())
+        finished.statistics = calculateKernelStatistics(instructions, numSpilledLocals, std::move(blocks));
+    if(config.outputMode == OutputMode::BINARY)
+    {
+        // the binary code is directly written into the output data
+        finished.numBytes = instructions.size() * sizeof(uint64_t);
+        finished.code.resize(finished.numBytes);
+        auto out = &finished.code[0];
+        for(const auto& instr : instructions)
+        {
+            const uint64_t binary = instr.toBinaryCode();
+            std::memcpy(out, &binary, sizeof(binary));
+            out += sizeof(binary);
+        }
+    }
+    else
+    {
+        std::ostringstream code;
+        finished.numBytes = writeInstructions(code, instructions, config.outputMode);
+        finished.code = code.str();
+    }
+#ifdef MULTI_THREADED
+    std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+    finishedKernels[&kernel] = std::move(finished);
+}
+
 // register/instruction mapping
 void CodeGenerator::toMachineCode(Method& kernel)
 {
     kernel.cleanLocals();
     const auto& instructions = generateInstructions(kernel);
+    {
+#ifdef MULTI_THREADED
+        std::lock_guard<std::mutex> guard(instructionsLock);
+#endif
+        spilledLocals[&kernel] = kernel.vpm->countAreas(periphery::VPMUsage::REGISTER_SPILLING);
+    }
 #ifdef VERIFIER_HEADER
     LCOV_EXCL_START
     std::vector<uint64_t> hexData;
@@ -312,5 +942,8 @@ void CodeGenerator::toMachineCode(Method& kernel)
     v.Validate();
     fflush(stderr);
     LCOV_EXCL_STOP
+#else
+    // the generated instructions are only used for the verification
+    (void) instructions;
 #endif
 }
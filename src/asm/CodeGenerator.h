@@ -7,13 +7,16 @@
 #ifndef CODEGENERATOR_H
 #define CODEGENERATOR_H
 
+#include "../analysis/ExecutionProfile.h"
 #include "../performance.h"
 #include "Instruction.h"
+#include "KernelCache.h"
 #include "config.h"
 
 #include <map>
 #include <memory>
 #include <ostream>
+#include <string>
 #include <vector>
 #ifdef MULTI_THREADED
 #include <mutex>
@@ -26,18 +29,136 @@ namespace vc4c
 
     namespace qpu_asm
     {
+        /*
+         * The statically estimated execution costs of a single basic block of the generated machine code
+         */
+        struct BlockCost
+        {
+            std::string label;
+            std::size_t firstInstruction = 0;
+            std::size_t numInstructions = 0;
+            // the cycles of a single execution of the block, including the expected stalls
+            std::size_t numCycles = 0;
+            // the expected number of executions of the block, the product of the trip counts of all enclosing loops
+            double weight = 1.0;
+        };
+
+        /*
+         * Statistics about the machine code generated for a single kernel, see Configuration#statisticsOutputFile
+         */
+        struct KernelStatistics
+        {
+            std::size_t numInstructions = 0;
+            // instructions executing neither an ALU operation nor a signal
+            std::size_t numNops = 0;
+            // ALU instructions executing an operation on the add and/or the mul ALU
+            std::size_t numALUInstructions = 0;
+            // ALU instructions executing an operation on both the add and the mul ALU
+            std::size_t numPairedInstructions = 0;
+            std::size_t numSpilledLocals = 0;
+            // reads from and writes to the VPM I/O register
+            std::size_t numVPMAccesses = 0;
+            // writes to the TMU address registers, each triggering a memory load
+            std::size_t numTMUAccesses = 0;
+            // locks of the hardware mutex
+            std::size_t numMutexRegions = 0;
+            // the distinct general purpose registers and accumulators written
+            std::size_t numRegistersUsed = 0;
+            // instructions reading the UNIFORM register
+            std::size_t numUniformReads = 0;
+            // the cycles all instructions are expected to stall for waiting on the SFU, the TMU and the VPM DMA
+            std::size_t numSFUStallCycles = 0;
+            std::size_t numTMUStallCycles = 0;
+            std::size_t numVPMStallCycles = 0;
+            // the summed up and the maximum cycles between locking and unlocking the hardware mutex
+            std::size_t numMutexCycles = 0;
+            std::size_t maxMutexRegionCycles = 0;
+            // the cycles of all blocks weighted by their expected number of executions
+            double estimatedCycles = 0.0;
+            std::vector<BlockCost> blocks;
+
+            double getPairingRate() const;
+        };
+
+        /*
+         * Calculates the statistics of the given machine code and statically estimates its execution costs.
+         *
+         * The blocks specify the labels, the first instructions and the weights of the basic blocks. If no blocks are
+         * given, the whole code is handled as a single block executed once.
+         *
+         * The stalls are estimated by tracking the cycles the results of the SFU, the TMU loads and the VPM DMA
+         * transfers become available in, using the latencies of the default emulator timing model
+         * (see tools::TimingModel). Since the instructions are handled in code order, the stalls carried over
+         * branches are only approximated.
+         */
+        KernelStatistics calculateKernelStatistics(const FastAccessList<DecoratedInstruction>& instructions,
+            std::size_t numSpilledLocals, std::vector<BlockCost> blocks = {});
+
         class CodeGenerator
         {
         public:
             explicit CodeGenerator(const Module& module, const Configuration& config = {});
 
             std::size_t writeOutput(std::ostream& stream);
+            /*
+             * Generates the whole module (module header, global data and the code of all kernels) in binary output
+             * mode into a single buffer of pre-calculated size.
+             */
+            std::vector<uint8_t> generateBinary();
             void toMachineCode(Method& kernel);
 
+            /*
+             * Adds the machine code previously generated for the given kernel (e.g. read from the compilation cache).
+             * The kernel then does not need to (and must not) be converted via #toMachineCode().
+             */
+            void addPrecompiledKernel(Method& kernel, CachedKernel&& precompiled);
+            /*
+             * Returns the machine code and meta data generated by #toMachineCode() for the given kernel
+             *
+             * NOTE: This needs to be called before the kernel is finished (see #finishKernel()).
+             */
+            CachedKernel getCompiledKernel(Method& kernel);
+            /*
+             * Marks the given kernel as structurally identical to the other kernel (see
+             * normalization::findDuplicateKernels()), so the alias is not compiled itself, but its kernel info refers
+             * to the code generated for the other kernel.
+             *
+             * NOTE: In the sectioned binary format, every kernel section contains its own copy of the code.
+             */
+            void addKernelAlias(Method& alias, Method& kernel);
+            /*
+             * Converts the machine code generated for the given kernel to its final output representation and releases
+             * the generated instructions, so only the output data is kept in memory until #writeOutput() is called.
+             *
+             * Any kernel not explicitly finished is finished by #writeOutput().
+             */
+            void finishKernel(Method& kernel);
+
         private:
             Configuration config;
             const Module& module;
             std::map<Method*, FastAccessList<qpu_asm::DecoratedInstruction>> allInstructions;
+            // the kernels already converted to their output representation, see #finishKernel()
+            struct FinishedKernel
+            {
+                std::size_t numInstructions;
+                std::size_t numBytes;
+                std::string code;
+                KernelStatistics statistics;
+            };
+            std::map<Method*, FinishedKernel> finishedKernels;
+            // the order the finished kernels are placed in the output, see #determineKernelOrder()
+            std::vector<Method*> kernelOrder;
+            // the kernel infos and stack sizes for the kernels not generated by this code generator
+            std::map<Method*, std::pair<KernelInfo, std::size_t>> precompiledKernels;
+            // the kernels sharing the code of a structurally identical kernel, see #addKernelAlias()
+            std::map<Method*, Method*> kernelAliases;
+            // the number of locals spilled into VPM for all generated or precompiled kernels
+            std::map<Method*, std::size_t> spilledLocals;
+            // the basic blocks and their weights for all generated kernels, if statistics are requested
+            std::map<Method*, std::vector<BlockCost>> blockCosts;
+            // the byte positions of the basic blocks within their kernel code, if requested for profile generation
+            analysis::ExecutionProfile blockPositions;
 #ifdef MULTI_THREADED
             std::mutex instructionsLock;
 #endif
@@ -47,6 +168,23 @@ namespace vc4c
              * so no static or non-constant global data can be used
              */
             const FastAccessList<qpu_asm::DecoratedInstruction>& generateInstructions(Method& method);
+            /*
+             * Finishes all kernels, generates the kernel infos and the global data segment and sets the layout of the
+             * module header. Returns the global data segment.
+             */
+            std::vector<uint8_t> prepareModuleInfo(ModuleInfo& moduleInfo);
+            /*
+             * Creates the kernel info for the given generated, precompiled or aliased kernel
+             */
+            KernelInfo createKernelInfo(Method& kernel, std::size_t offset, std::size_t numInstructions) const;
+            /*
+             * Returns the order of the finished kernels in the output. The kernels executed most often according to the
+             * execution profile (if any) are placed first next to each other, so they share the instruction cache with
+             * as few other kernels as possible. All other kernels keep the order of the module.
+             */
+            std::vector<Method*> determineKernelOrder() const;
+            void writeBlockPositions() const;
+            void writeStatistics() const;
         };
     } // namespace qpu_asm
 } // namespace vc4c
@@ -7,8 +7,10 @@
 #include "GraphColoring.h"
 
 #include "../Profiler.h"
+#include "../analysis/AnalysisManager.h"
 #include "../analysis/ControlFlowGraph.h"
 #include "../analysis/DebugGraph.h"
+#include "../analysis/DivergenceAnalysis.h"
 #include "../analysis/LivenessAnalysis.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "RegisterAllocation.h"
@@ -179,6 +181,42 @@ std::size_t ColoredNodeBase::fixToRegister()
         CompilationStep::LABEL_REGISTER_MAPPING, "Cannot fix local to file with no registers left", to_string());
 }
 
+bool ColoredNodeBase::preferRegister(Register reg)
+{
+    if(reg.isAccumulator())
+    {
+        auto index = static_cast<std::size_t>(reg.getAccumulatorNumber());
+        if(!has_flag(possibleFiles, RegisterFile::ACCUMULATOR) || index >= availableAcc.size() ||
+            !availableAcc.test(index))
+            return false;
+        possibleFiles = RegisterFile::ACCUMULATOR;
+        availableAcc.reset();
+        availableAcc.set(index);
+        return true;
+    }
+    if(!reg.isGeneralPurpose())
+        return false;
+    auto& available = reg.file == RegisterFile::PHYSICAL_A ? availableA : availableB;
+    if(!has_flag(possibleFiles, reg.file) || !available.test(reg.num))
+        return false;
+    possibleFiles = reg.file;
+    available.reset();
+    available.set(reg.num);
+    return true;
+}
+
+std::size_t ColoredNodeBase::countAllFreeRegisters() const
+{
+    std::size_t numFree = 0;
+    if(has_flag(possibleFiles, RegisterFile::ACCUMULATOR))
+        numFree += availableAcc.count();
+    if(has_flag(possibleFiles, RegisterFile::PHYSICAL_A))
+        numFree += availableA.count();
+    if(has_flag(possibleFiles, RegisterFile::PHYSICAL_B))
+        numFree += availableB.count();
+    return numFree;
+}
+
 LCOV_EXCL_START
 std::string ColoredNodeBase::to_string(bool longDescription) const
 {
@@ -405,12 +443,14 @@ static void fixLocals(const InstructionWalker it, FastMap<const Local*, LocalUsa
     }
 }
 
-GraphColoring::GraphColoring(Method& method, InstructionWalker it) :
-    method(method), closedSet(), openSet(), livenessAnalysis(true), localUses()
+GraphColoring::GraphColoring(Method& method, InstructionWalker it, RegisterAllocator allocator) :
+    method(method), allocator(allocator), closedSet(), openSet(), livenessAnalysis(true), localUses()
 {
     closedSet.reserve(method.getNumLocals());
     openSet.reserve(method.getNumLocals());
     localUses.reserve(method.getNumLocals());
+    // the instructions were modified since the cached analyses were run, e.g. by the register fix-ups
+    method.getAnalyses().invalidate(analysis::CachedAnalysis::CONTROL_FLOW);
 
     const Local* lastWrittenLocal0 = nullptr;
     const Local* lastWrittenLocal1 = nullptr;
@@ -479,16 +519,114 @@ static void insertR5Node(ColoredGraph& graph)
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Created dummy node: " << r5Node.to_string(false) << logging::endl);
 }
 
+static RegisterFile getOtherPhysicalFile(RegisterFile file)
+{
+    return file == RegisterFile::PHYSICAL_A ? RegisterFile::PHYSICAL_B : RegisterFile::PHYSICAL_A;
+}
+
+/*
+ * Assigns the preferred physical register-files by 2-coloring the graph of the locals used together (breadth-first),
+ * starting with the locals fixed to a single register-file. If the graph is not 2-colorable (e.g. three locals used
+ * together with each other), the conflicting locals keep the file assigned first and still need to be fixed up.
+ */
+static void partitionRegisterFiles(ColoredGraph& graph)
+{
+    auto isUsedTogether = [](const ColoredEdge& edge) -> bool {
+        return edge.data == analysis::InterferenceType::USED_TOGETHER;
+    };
+    FastAccessList<ColoredNode*> queue;
+    auto propagate = [&]() {
+        for(std::size_t i = 0; i < queue.size(); ++i)
+        {
+            auto node = queue[i];
+            auto otherFile = getOtherPhysicalFile(node->preferredFile);
+            node->forAllEdges([&](ColoredNode& neighbor, ColoredEdge& edge) -> bool {
+                if(isUsedTogether(edge) && neighbor.preferredFile == RegisterFile::NONE &&
+                    has_flag(neighbor.possibleFiles, otherFile))
+                {
+                    neighbor.preferredFile = otherFile;
+                    queue.push_back(&neighbor);
+                }
+                return true;
+            });
+        }
+        queue.clear();
+    };
+
+    for(auto& node : graph.getNodes())
+    {
+        if(node.second.possibleFiles == RegisterFile::PHYSICAL_A ||
+            node.second.possibleFiles == RegisterFile::PHYSICAL_B)
+        {
+            node.second.preferredFile = node.second.possibleFiles;
+            queue.push_back(&node.second);
+        }
+    }
+    propagate();
+
+    // all remaining components of locals used together are not bound to any file, so we can start with either file
+    for(auto& node : graph.getNodes())
+    {
+        if(node.second.preferredFile != RegisterFile::NONE ||
+            !has_flag(node.second.possibleFiles, RegisterFile::PHYSICAL_A) ||
+            !node.second.findEdge(analysis::InterferenceType::USED_TOGETHER))
+            continue;
+        node.second.preferredFile = RegisterFile::PHYSICAL_A;
+        queue.push_back(&node.second);
+        propagate();
+    }
+}
+
+// in threaded mode, every hardware thread can only access the lower half of the physical register-files
+static constexpr std::size_t NUM_THREAD_REGISTERS = 16;
+
+/*
+ * Restricts the locals to the registers available to a single hardware thread: The upper half of the physical
+ * register-files is used by the other thread and the accumulators are not preserved across thread switches.
+ */
+static void restrictToThreadRegisters(
+    ColoredGraph& graph, const Method& method, const analysis::GlobalLivenessAnalysis& livenessAnalysis)
+{
+    for(auto& node : graph.getNodes())
+    {
+        for(std::size_t i = NUM_THREAD_REGISTERS; i < 2 * NUM_THREAD_REGISTERS; ++i)
+        {
+            node.second.blockRegister(RegisterFile::PHYSICAL_A, i);
+            node.second.blockRegister(RegisterFile::PHYSICAL_B, i);
+        }
+    }
+    for(const auto& block : method)
+    {
+        for(const auto& inst : block)
+        {
+            if(!inst || inst->getSignal() != SIGNAL_SWITCH_THREAD)
+                continue;
+            for(auto loc : livenessAnalysis.getLocalAnalysis(block).getResult(inst.get()))
+            {
+                auto node = loc != analysis::FAKE_REPLICATE_REGISTER ? graph.findNode(loc) : nullptr;
+                if(node)
+                    node->possibleFiles = remove_flag(node->possibleFiles, RegisterFile::ACCUMULATOR);
+            }
+        }
+    }
+}
+
 void GraphColoring::createGraph()
 {
     // We need to update these every time, since fix in the previous iteration may have changed the livenesses and will
-    // have changed the local interferences.
-    livenessAnalysis = analysis::GlobalLivenessAnalysis(true);
-    livenessAnalysis(method);
-    interferenceGraph = analysis::InterferenceGraph::createGraph(method, &livenessAnalysis);
+    // have changed the local interferences. Since the fixes only insert instructions into or modify single blocks,
+    // the liveness only needs to be updated for these blocks.
+    if(interferenceGraph)
+        livenessAnalysis.update(method, modifiedBlocks);
+    else
+        livenessAnalysis(method);
+    modifiedBlocks.clear();
+    interferenceGraph.reset(new analysis::FrozenInterferenceGraph(
+        analysis::InterferenceGraph::createFrozenGraph(method, livenessAnalysis)));
 
     graph.reserveNodeSize(localUses.size());
     insertR5Node(graph);
+    const auto& divergence = method.getAnalyses().getDivergence();
     // 1. iteration: set files and locals used together and map to start/end of range
     PROFILE_START(createColoredNodes);
     for(const auto& pair : localUses)
@@ -500,7 +638,9 @@ void GraphColoring::createGraph()
             auto load = dynamic_cast<const intermediate::LoadImmediate*>(pair.first->getSingleWriter());
             auto move = dynamic_cast<const intermediate::MoveOperation*>(pair.first->getSingleWriter());
             if(!(load && load->type == intermediate::LoadType::REPLICATE_INT32) &&
-                !(move && !dynamic_cast<const intermediate::VectorRotation*>(move) && move->readsRegister(REG_UNIFORM)))
+                !(move && !dynamic_cast<const intermediate::VectorRotation*>(move) &&
+                    move->readsRegister(REG_UNIFORM)) &&
+                !divergence.isLaneUniform(pair.first->createReference()))
                 // Since writing to r5 automatically replicates, we only use it for values we know to be the same across
                 // all SIMD elements
                 node.blockR5();
@@ -554,19 +694,24 @@ void GraphColoring::createGraph()
 
     // 2. iteration: associate locals used together
     PROFILE_START(InterferenceToColoredGraph);
-    for(const auto& interferenceNode : interferenceGraph->getNodes())
+    // look up the colored nodes only once per node instead of once per edge
+    FastAccessList<ColoredNode*> coloredNodes;
+    coloredNodes.reserve(interferenceGraph->size());
+    for(analysis::FrozenInterferenceGraph::IndexType i = 0; i < interferenceGraph->size(); ++i)
+        coloredNodes.emplace_back(&graph.assertNode(interferenceGraph->getKey(i)));
+    for(analysis::FrozenInterferenceGraph::IndexType i = 0; i < interferenceGraph->size(); ++i)
     {
-        ColoredNode& node = graph.assertNode(interferenceNode.first);
+        ColoredNode& node = *coloredNodes[i];
+        auto interferences = interferenceGraph->getEdges(i);
         if(node.getEdgesSize() == 0)
             // To not force rehashing, only reserve for nodes without edges
-            node.reserveEdgesSize(interferenceNode.second.getEdgesSize());
-        interferenceNode.second.forAllEdges(
-            [&](const analysis::InterferenceNode& neighbor, const analysis::Interference& edge) -> bool {
-                // TODO can we here somehow only run for one half of the edges? since now we want to add every edge
-                // twice (for each adjacent node)
-                node.getOrCreateEdge(&graph.assertNode(neighbor.key)).data = edge.data;
-                return true;
-            });
+            node.reserveEdgesSize(interferences.size());
+        for(const auto& edge : interferences)
+        {
+            // TODO can we here somehow only run for one half of the edges? since now we want to add every edge
+            // twice (for each adjacent node)
+            node.getOrCreateEdge(coloredNodes[edge.neighbor]).data = edge.data;
+        }
     }
     PROFILE_END(InterferenceToColoredGraph);
 
@@ -623,6 +768,19 @@ void GraphColoring::createGraph()
     }
     PROFILE_END(ForwardBlockedRegisterFiles);
 
+    // 4. iteration: partition the locals used together onto the physical register-files
+    PROFILE_START(PartitionRegisterFiles);
+    partitionRegisterFiles(graph);
+    PROFILE_END(PartitionRegisterFiles);
+
+    // 5. iteration: restrict the locals to the registers available to a single hardware thread
+    if(method.metaData.isThreadable)
+    {
+        PROFILE_START(RestrictToThreadRegisters);
+        restrictToThreadRegisters(graph, method, livenessAnalysis);
+        PROFILE_END(RestrictToThreadRegisters);
+    }
+
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Colored graph with " << graph.getNodes().size() << " nodes created!" << logging::endl);
 #ifdef DEBUG_MODE
@@ -708,6 +866,35 @@ bool GraphColoring::colorGraph()
     // process all nodes fixed initially to a register-file
     processClosedSet(graph, closedSet, openSet, errorSet);
 
+    if(allocator == RegisterAllocator::COALESCING)
+        colorOpenSetCoalescing();
+    else if(allocator == RegisterAllocator::LINEAR_SCAN)
+        colorOpenSetLinearScan();
+    else
+        colorOpenSetGreedy();
+
+    return errorSet.empty();
+}
+
+/*
+ * Selects the register-file to assign the node to, preferring the accumulators and then the physical register-file of
+ * the partition of the node
+ */
+static RegisterFile selectRegisterFile(const ColoredNode& node)
+{
+    if(has_flag(node.possibleFiles, RegisterFile::ACCUMULATOR))
+        return RegisterFile::ACCUMULATOR;
+    if(node.preferredFile != RegisterFile::NONE && has_flag(node.possibleFiles, node.preferredFile))
+        return node.preferredFile;
+    if(has_flag(node.possibleFiles, RegisterFile::PHYSICAL_A))
+        return RegisterFile::PHYSICAL_A;
+    if(has_flag(node.possibleFiles, RegisterFile::PHYSICAL_B))
+        return RegisterFile::PHYSICAL_B;
+    return RegisterFile::NONE;
+}
+
+void GraphColoring::colorOpenSetGreedy()
+{
     while(!openSet.empty())
     {
         // for every node in the open-set, assign to accumulator if possible, assign to the first available
@@ -718,14 +905,8 @@ bool GraphColoring::colorGraph()
             throw CompilationError(
                 CompilationStep::LABEL_REGISTER_MAPPING, "Error getting local from graph", (*openSet.begin())->name);
         }
-        RegisterFile currentFile = RegisterFile::NONE;
-        if(has_flag(node->possibleFiles, RegisterFile::ACCUMULATOR))
-            currentFile = RegisterFile::ACCUMULATOR;
-        else if(has_flag(node->possibleFiles, RegisterFile::PHYSICAL_A))
-            currentFile = RegisterFile::PHYSICAL_A;
-        else if(has_flag(node->possibleFiles, RegisterFile::PHYSICAL_B))
-            currentFile = RegisterFile::PHYSICAL_B;
-        else
+        RegisterFile currentFile = selectRegisterFile(*node);
+        if(currentFile == RegisterFile::NONE)
         {
             errorSet.insert(node->key);
             openSet.erase(node->key);
@@ -736,8 +917,177 @@ bool GraphColoring::colorGraph()
         openSet.erase(node->key);
         processClosedSet(graph, closedSet, openSet, errorSet);
     }
+}
 
-    return errorSet.empty();
+/*
+ * Determines the order to assign the nodes of the open-set in by simplifying the graph (Chaitin-Briggs): Nodes with
+ * less neighbors (in the open-set) than free registers can always be assigned and are removed from the graph first.
+ * If there are no such nodes left, the node with the lowest spill costs (number of uses per neighbor) is removed, which
+ * still might find a free register on assignment (optimistic coloring).
+ *
+ * Returns the nodes in the order to be assigned, i.e. the reverse order of removal
+ */
+static std::vector<ColoredNode*> determineSimplifyOrder(ColoredGraph& graph, const FastSet<const Local*>& openSet,
+    const FastMap<const Local*, LocalUsage>& localUses)
+{
+    FastMap<ColoredNode*, std::size_t> degrees;
+    degrees.reserve(openSet.size());
+    for(const Local* loc : openSet)
+        degrees.emplace(&graph.assertNode(loc), 0);
+    std::vector<ColoredNode*> simplifyWorklist;
+    for(auto& entry : degrees)
+    {
+        entry.first->forAllEdges([&](ColoredNode& neighbor, ColoredEdge& edge) -> bool {
+            if(degrees.find(&neighbor) != degrees.end())
+                ++entry.second;
+            return true;
+        });
+        if(entry.second < entry.first->countAllFreeRegisters())
+            simplifyWorklist.push_back(entry.first);
+    }
+
+    std::vector<ColoredNode*> order;
+    order.reserve(degrees.size());
+    while(!degrees.empty())
+    {
+        ColoredNode* next = nullptr;
+        while(!simplifyWorklist.empty() && !next)
+        {
+            // the worklist might contain nodes already removed as spill candidates
+            if(degrees.find(simplifyWorklist.back()) != degrees.end())
+                next = simplifyWorklist.back();
+            simplifyWorklist.pop_back();
+        }
+        if(!next)
+        {
+            // all remaining nodes have at least as many neighbors as free registers, select the cheapest to spill
+            auto spillCosts = [&](const std::pair<ColoredNode* const, std::size_t>& entry) -> double {
+                auto usesIt = localUses.find(entry.first->key);
+                auto numUses = usesIt != localUses.end() ? usesIt->second.associatedInstructions.size() : 0;
+                return static_cast<double>(numUses) / static_cast<double>(entry.second + 1);
+            };
+            next = std::min_element(degrees.begin(), degrees.end(),
+                [&](const std::pair<ColoredNode* const, std::size_t>& first,
+                    const std::pair<ColoredNode* const, std::size_t>& second) -> bool {
+                    return spillCosts(first) < spillCosts(second);
+                })->first;
+        }
+        degrees.erase(next);
+        order.push_back(next);
+        next->forAllEdges([&](ColoredNode& neighbor, ColoredEdge& edge) -> bool {
+            auto degreeIt = degrees.find(&neighbor);
+            if(degreeIt != degrees.end() && degreeIt->second-- == neighbor.countAllFreeRegisters())
+                // the neighbor now has less neighbors than free registers
+                simplifyWorklist.push_back(&neighbor);
+            return true;
+        });
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/*
+ * Returns the locals copied from or into the given local by a simple move
+ */
+static FastSet<const Local*> getMovePartners(const Local* local, const LocalUsage& usage)
+{
+    FastSet<const Local*> partners;
+    for(const auto& it : usage.associatedInstructions)
+    {
+        auto move = it.get<const intermediate::MoveOperation>();
+        if(!move || it.get<const intermediate::VectorRotation>() || move->hasPackMode() || move->hasUnpackMode())
+            continue;
+        auto source = move->getSource().checkLocal();
+        auto output = move->checkOutputLocal();
+        if(source && output && source != output && (source == local || output == local))
+            partners.emplace(source == local ? output : source);
+    }
+    return partners;
+}
+
+void GraphColoring::colorOpenSetCoalescing()
+{
+    FastMap<const Local*, Register> assignedRegisters;
+    for(ColoredNode* node : determineSimplifyOrder(graph, openSet, localUses))
+    {
+        if(openSet.find(node->key) == openSet.end())
+            // node was already fixed by assigning its neighbors
+            continue;
+        RegisterFile currentFile = selectRegisterFile(*node);
+        if(currentFile == RegisterFile::NONE)
+        {
+            errorSet.insert(node->key);
+            openSet.erase(node->key);
+            continue;
+        }
+        // biased coalescing: if the local is copied from or to an already assigned local, try to use the same register
+        // so the copy becomes obsolete
+        bool assigned = false;
+        auto usageIt = localUses.find(node->key);
+        if(usageIt != localUses.end())
+        {
+            for(const Local* partner : getMovePartners(node->key, usageIt->second))
+            {
+                auto regIt = assignedRegisters.find(partner);
+                if(regIt != assignedRegisters.end() && node->preferRegister(regIt->second))
+                {
+                    assigned = true;
+                    break;
+                }
+            }
+        }
+        if(!assigned)
+            node->possibleFiles = currentFile;
+        closedSet.insert(node->key);
+        openSet.erase(node->key);
+        processClosedSet(graph, closedSet, openSet, errorSet);
+        if(node->possibleFiles != RegisterFile::NONE && errorSet.find(node->key) == errorSet.end())
+            assignedRegisters.emplace(node->key, node->getRegisterFixed());
+    }
+}
+
+void GraphColoring::colorOpenSetLinearScan()
+{
+    // determine the start of the live ranges as the position of the first instruction using the local
+    FastMap<const Local*, std::size_t> rangeStarts;
+    rangeStarts.reserve(openSet.size());
+    std::size_t index = 0;
+    for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+    {
+        if(!it.has())
+            continue;
+        it->forUsedLocals(
+            [&](const Local* loc, LocalUse::Type type, const intermediate::IntermediateInstruction& inst) -> void {
+                if(openSet.find(loc) != openSet.end())
+                    rangeStarts.emplace(loc, index);
+            });
+        ++index;
+    }
+    std::vector<std::pair<const Local*, std::size_t>> order(rangeStarts.begin(), rangeStarts.end());
+    std::sort(order.begin(), order.end(),
+        [](const std::pair<const Local*, std::size_t>& first, const std::pair<const Local*, std::size_t>& second)
+            -> bool { return first.second < second.second; });
+
+    for(const auto& entry : order)
+    {
+        if(openSet.find(entry.first) == openSet.end())
+            // node was already fixed by assigning its neighbors
+            continue;
+        auto& node = graph.assertNode(entry.first);
+        RegisterFile currentFile = selectRegisterFile(node);
+        if(currentFile == RegisterFile::NONE)
+        {
+            errorSet.insert(node.key);
+            openSet.erase(node.key);
+            continue;
+        }
+        node.possibleFiles = currentFile;
+        closedSet.insert(node.key);
+        openSet.erase(node.key);
+        processClosedSet(graph, closedSet, openSet, errorSet);
+    }
+    // locals not used by any instruction (should not happen) are assigned in arbitrary order
+    colorOpenSetGreedy();
 }
 
 static RegisterFile getBlockedInputs(
@@ -811,7 +1161,8 @@ static NODISCARD bool reassignNodeToRegister(ColoredGraph& graph, ColoredNode& n
 }
 
 static NODISCARD bool moveLocalToRegisterFile(Method& method, ColoredGraph& graph, ColoredNode& node,
-    FastMap<const Local*, LocalUsage>& localUses, LocalUsage& localUse, const RegisterFile file)
+    FastMap<const Local*, LocalUsage>& localUses, LocalUsage& localUse, const RegisterFile file,
+    FastSet<BasicBlock*>& modifiedBlocks)
 {
     bool needNextRound = false;
     const auto& users = node.key->getUsers();
@@ -847,6 +1198,7 @@ static NODISCARD bool moveLocalToRegisterFile(Method& method, ColoredGraph& grap
         auto& tmpUse = localUses.emplace(tmp.local(), LocalUsage(it, it)).first->second;
         it.nextInBlock();
         it->replaceLocal(node.key, tmp.local(), LocalUse::Type::READER);
+        modifiedBlocks.emplace(it.getBasicBlock());
         // 4) add temporary to graph (and local usage) with same blocked registers as local, but accumulator as file
         // (since it is read in the next instruction)
         tmpUse.possibleFiles = RegisterFile::ACCUMULATOR;
@@ -889,7 +1241,7 @@ static bool blocksLocal(const ColoredNode* neighbor, LocalRelation relation)
 }
 
 static NODISCARD bool fixSingleError(Method& method, ColoredGraph& graph, ColoredNode& node,
-    FastMap<const Local*, LocalUsage>& localUses, LocalUsage& localUse)
+    FastMap<const Local*, LocalUsage>& localUses, LocalUsage& localUse, FastSet<BasicBlock*>& modifiedBlocks)
 {
     /*
      * The following cases can occur:
@@ -968,6 +1320,7 @@ static NODISCARD bool fixSingleError(Method& method, ColoredGraph& graph, Colore
                         log << "Fixing register-conflict by inserting NOP before: " << it->to_string()
                             << logging::endl);
                     it.emplace(new intermediate::Nop(intermediate::DelayType::WAIT_REGISTER));
+                    modifiedBlocks.emplace(it.getBasicBlock());
                     PROFILE_COUNTER(vc4c::profiler::COUNTER_BACKEND + 11, "NOP insertions", 1);
                 }
             }
@@ -1028,7 +1381,7 @@ static NODISCARD bool fixSingleError(Method& method, ColoredGraph& graph, Colore
             // the "easier" solution is to copy the local into an accumulator before each use, where it conflicts with
             // other inputs
             return moveLocalToRegisterFile(method, graph, node, localUses, localUse,
-                fileACouldBeUsed ? RegisterFile::PHYSICAL_A : RegisterFile::PHYSICAL_B);
+                fileACouldBeUsed ? RegisterFile::PHYSICAL_A : RegisterFile::PHYSICAL_B, modifiedBlocks);
         }
         else
         {
@@ -1069,7 +1422,11 @@ static NODISCARD bool fixSingleError(Method& method, ColoredGraph& graph, Colore
         }
         else if(!moveToFileA && !moveToFileB)
         {
-            // there are no more free register AT ALL, so we cannot do anything useful here
+            // there are no more free register AT ALL, so we cannot do anything useful here. This is left for the
+            // spilling of locals (see RegisterFixes)
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "No free registers left for local, requires spilling: " << node.key->to_string()
+                    << logging::endl);
             return false;
         }
 
@@ -1087,7 +1444,7 @@ static NODISCARD bool fixSingleError(Method& method, ColoredGraph& graph, Colore
         }
 
         return moveLocalToRegisterFile(method, graph, node, localUses, localUse,
-            moveToFileA ? RegisterFile::PHYSICAL_A : RegisterFile::PHYSICAL_B);
+            moveToFileA ? RegisterFile::PHYSICAL_A : RegisterFile::PHYSICAL_B, modifiedBlocks);
     }
     else
         throw CompilationError(
@@ -1120,7 +1477,7 @@ bool GraphColoring::fixErrors()
             s << logging::endl;
         });
         LCOV_EXCL_STOP
-        if(!fixSingleError(method, graph, node, localUses, localUses.at(local)))
+        if(!fixSingleError(method, graph, node, localUses, localUses.at(local), modifiedBlocks))
             allFixed = false;
     }
     PROFILE_END(fixRegisterErrors);
@@ -1155,6 +1512,11 @@ const analysis::GlobalLivenessAnalysis& GraphColoring::getLivenessAnalysis() con
     return livenessAnalysis;
 }
 
+const FastSet<const Local*>& GraphColoring::getErrorLocals() const
+{
+    return errorSet;
+}
+
 void GraphColoring::resetGraph()
 {
     // reset the graph and the closed- and open sets
@@ -72,6 +72,19 @@ namespace vc4c
              */
             NODISCARD std::size_t fixToRegister();
 
+            /*!
+             * Restricts this node to the given register (e.g. the register of a local copied from or to the local of
+             * this node), if it is still available.
+             *
+             * \return whether the register was available and this node is now restricted to it
+             */
+            bool preferRegister(Register reg);
+
+            /*
+             * Counts the number of free registers over all possible register-files of this node
+             */
+            std::size_t countAllFreeRegisters() const;
+
             std::string to_string(bool longDescription = false) const;
 
             inline void blockR5()
@@ -81,6 +94,9 @@ namespace vc4c
 
             RegisterFile initialFile;
             RegisterFile possibleFiles;
+            // the physical register-file assigned by the partitioning of the locals used together, which is preferred
+            // if the local cannot be assigned to an accumulator
+            RegisterFile preferredFile = RegisterFile::NONE;
 
         private:
             std::bitset<32> availableA = 0xFFFFFFFFUL;
@@ -88,7 +104,16 @@ namespace vc4c
             // r0 - r3 are GP accumulators, r5 is also available for uniform (across all SIMD elements) values
             std::bitset<6> availableAcc = 0x02FUL;
         };
+    } // namespace qpu_asm
+
+    template <>
+    struct GraphMemoryCategory<qpu_asm::ColoredNodeBase>
+    {
+        static constexpr profiler::MemoryCategory value = profiler::MemoryCategory::REGISTER_ALLOCATION;
+    };
 
+    namespace qpu_asm
+    {
         using ColoredNode = Node<const Local*, LocalRelation, Directionality::UNDIRECTED, ColoredNodeBase>;
         using ColoredEdge = typename ColoredNode::EdgeType;
 
@@ -117,6 +142,27 @@ namespace vc4c
          *
          *
          * - remove keeping track of all used register / locals used together
+         *
+         * Before any local is assigned, the locals used together in the same instruction are partitioned onto the
+         * physical register-files A and B by 2-coloring the graph of these relations, starting from the locals already
+         * fixed to a register-file. Locals not assigned to an accumulator prefer the register-file of their partition,
+         * which avoids both locals read by an instruction ending up on the same register-file (which would then need to
+         * be fixed by inserting moves), instead of greedily assigning them in arbitrary order.
+         *
+         * For kernels run in two hardware threads per QPU (see KernelMetaData#isThreadable), only the lower 16
+         * registers of the physical register-files are used and locals live across a thread switch are not assigned to
+         * an accumulator, since the accumulators are not preserved.
+         *
+         * For RegisterAllocator#COALESCING, the "freely" assignable locals are not processed in arbitrary order, but
+         * in the reverse order of simplifying the graph: locals with less neighbors than free registers are removed
+         * first, if there are none, the local with the lowest spill costs (uses per neighbor) is removed
+         * optimistically. Locals copied from or to an already assigned local are preferably assigned to the same
+         * register.
+         *
+         * For RegisterAllocator#LINEAR_SCAN, the "freely" assignable locals are processed in the order of the start
+         * of their live ranges (their first occurrence in the instruction order). Since the same interference graph is
+         * built and updated for every assignment, this does not reduce the allocation time compared to the other
+         * allocators.
          */
         class GraphColoring
         {
@@ -124,7 +170,8 @@ namespace vc4c
             /*!
              * Initializes all internal data structures with a single iteration over all instructions
              */
-            GraphColoring(Method& method, InstructionWalker it);
+            GraphColoring(
+                Method& method, InstructionWalker it, RegisterAllocator allocator = RegisterAllocator::GREEDY);
 
             /*!
              * Tries to color the local interference graph to assign every local to a color (register).
@@ -149,19 +196,32 @@ namespace vc4c
              */
             const analysis::GlobalLivenessAnalysis& getLivenessAnalysis() const;
 
+            /*!
+             * \return the locals which could not be assigned to a register by the last #colorGraph() call, e.g. to
+             * select the locals to be spilled
+             */
+            const FastSet<const Local*>& getErrorLocals() const;
+
         private:
             Method& method;
+            RegisterAllocator allocator;
             FastSet<const Local*> closedSet;
             FastSet<const Local*> openSet;
             analysis::GlobalLivenessAnalysis livenessAnalysis;
-            std::unique_ptr<analysis::InterferenceGraph> interferenceGraph;
+            // the interference graph is only read after creation, so it is stored in its more compact frozen form
+            std::unique_ptr<analysis::FrozenInterferenceGraph> interferenceGraph;
             FastMap<const Local*, LocalUsage> localUses;
 
             ColoredGraph graph;
             FastSet<const Local*> errorSet;
+            // the basic blocks modified by the last #fixErrors() call, whose liveness needs to be updated
+            FastSet<BasicBlock*> modifiedBlocks;
 
             void createGraph();
             void resetGraph();
+            void colorOpenSetGreedy();
+            void colorOpenSetCoalescing();
+            void colorOpenSetLinearScan();
         };
     } // namespace qpu_asm
 } // namespace vc4c
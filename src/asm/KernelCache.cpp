@@ -0,0 +1,161 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "KernelCache.h"
+
+#include "../Method.h"
+#include "../Module.h"
+#include "../Profiler.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "CompilationCache.h"
+#include "log.h"
+
+#include <sstream>
+
+using namespace vc4c;
+using namespace vc4c::qpu_asm;
+
+// prefix for the cache keys to distinguish kernel entries from whole program entries
+static const std::string KERNEL_FINGERPRINT_PREFIX = "kernel\n";
+
+std::string qpu_asm::calculateKernelFingerprint(
+    const Module& module, const Method& kernel, const Configuration& config)
+{
+    PROFILE_START(CalculateKernelFingerprint);
+    std::stringstream s;
+    s << kernel.name << '\n' << kernel.returnType.to_string() << '\n';
+    for(const auto& param : kernel.parameters)
+        s << param.to_string(true) << ' ' << param.parameterName << ' ' << param.origTypeName << '\n';
+    s << to_string<uint32_t>(kernel.metaData.workGroupSizes) << '\n'
+      << to_string<uint32_t>(kernel.metaData.workGroupSizeHints) << '\n';
+    // the global data is referenced by its offset, which changes if any global is modified
+    for(const auto& global : module.globalData)
+        s << global.to_string(true) << '\n';
+    for(const auto& bb : kernel)
+    {
+        for(const auto& inst : bb)
+            s << inst->to_string() << '\n';
+    }
+    auto fingerprint = CompilationCache::calculateKey(KERNEL_FINGERPRINT_PREFIX + s.str(), config, "");
+    PROFILE_END(CalculateKernelFingerprint);
+    return fingerprint;
+}
+
+template <typename T>
+static void writeValue(std::ostream& out, T val)
+{
+    out.write(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+template <typename T>
+static T readValue(std::istream& in)
+{
+    T val{};
+    in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    return val;
+}
+
+static void writeString(std::ostream& out, const std::string& s)
+{
+    writeValue(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+static std::string readString(std::istream& in)
+{
+    std::string s(readValue<uint32_t>(in), '\0');
+    in.read(&s[0], static_cast<std::streamsize>(s.size()));
+    return s;
+}
+
+Optional<CachedKernel> qpu_asm::lookupKernel(const std::string& fingerprint, const Configuration& config)
+{
+    std::stringstream in;
+    if(!CompilationCache::lookup(fingerprint, config, in))
+        return {};
+
+    CachedKernel kernel;
+    kernel.stackSize = static_cast<std::size_t>(readValue<uint64_t>(in));
+    kernel.info.value = readValue<uint64_t>(in);
+    kernel.info.workGroupSize = readValue<uint64_t>(in);
+    kernel.info.uniformsUsed.value = readValue<uint64_t>(in);
+    kernel.info.name = readString(in);
+    auto numParameters = readValue<uint32_t>(in);
+    kernel.info.parameters.reserve(numParameters);
+    for(uint32_t i = 0; i < numParameters; ++i)
+    {
+        ParamInfo param;
+        param.value = readValue<uint64_t>(in);
+        param.name = readString(in);
+        param.typeName = readString(in);
+        kernel.info.parameters.emplace_back(std::move(param));
+    }
+    auto numInstructions = readValue<uint64_t>(in);
+    kernel.instructions.reserve(static_cast<std::size_t>(numInstructions));
+    for(uint64_t i = 0; i < numInstructions; ++i)
+    {
+        DecoratedInstruction instr(Instruction(readValue<uint64_t>(in)));
+        instr.comment = readString(in);
+        instr.previousComment = readString(in);
+        kernel.instructions.emplace_back(std::move(instr));
+    }
+    // appended last, so entries written before the value was added are detected as truncated
+    kernel.numSpilledLocals = static_cast<std::size_t>(readValue<uint64_t>(in));
+    kernel.info.precomputedUniforms.resize(kernel.info.uniformsUsed.getNumPrecomputedValues());
+    for(auto& expression : kernel.info.precomputedUniforms)
+    {
+        expression.steps.resize(readValue<uint32_t>(in));
+        for(auto& step : expression.steps)
+        {
+            step.code = static_cast<UniformExpression::OpCode>(readValue<uint8_t>(in));
+            step.operand = readValue<uint32_t>(in);
+        }
+    }
+    if(!in)
+    {
+        logging::warn() << "Ignoring truncated compilation cache entry for kernel '" << kernel.info.name << "'"
+                        << logging::endl;
+        return {};
+    }
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Using cached machine code for kernel '" << kernel.info.name << "'" << logging::endl);
+    return kernel;
+}
+
+void qpu_asm::storeKernel(const std::string& fingerprint, const Configuration& config, const CachedKernel& kernel)
+{
+    std::stringstream out;
+    writeValue(out, static_cast<uint64_t>(kernel.stackSize));
+    writeValue(out, kernel.info.value);
+    writeValue(out, kernel.info.workGroupSize);
+    writeValue(out, kernel.info.uniformsUsed.value);
+    writeString(out, kernel.info.name);
+    writeValue(out, static_cast<uint32_t>(kernel.info.parameters.size()));
+    for(const auto& param : kernel.info.parameters)
+    {
+        writeValue(out, param.value);
+        writeString(out, param.name);
+        writeString(out, param.typeName);
+    }
+    writeValue(out, static_cast<uint64_t>(kernel.instructions.size()));
+    for(const auto& instr : kernel.instructions)
+    {
+        writeValue(out, instr.toBinaryCode());
+        writeString(out, instr.comment);
+        writeString(out, instr.previousComment);
+    }
+    writeValue(out, static_cast<uint64_t>(kernel.numSpilledLocals));
+    for(const auto& expression : kernel.info.precomputedUniforms)
+    {
+        writeValue(out, static_cast<uint32_t>(expression.steps.size()));
+        for(const auto& step : expression.steps)
+        {
+            writeValue(out, static_cast<uint8_t>(step.code));
+            writeValue(out, step.operand);
+        }
+    }
+    CompilationCache::insert(fingerprint, config, out.str(), kernel.instructions.size());
+}
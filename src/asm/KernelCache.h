@@ -0,0 +1,61 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_KERNEL_CACHE_H
+#define VC4C_KERNEL_CACHE_H
+
+#include "../performance.h"
+#include "Instruction.h"
+#include "KernelInfo.h"
+#include "Optional.h"
+#include "config.h"
+
+#include <string>
+
+namespace vc4c
+{
+    class Method;
+    class Module;
+
+    namespace qpu_asm
+    {
+        /*
+         * The machine code and meta data generated for a single kernel, as stored in the compilation cache
+         */
+        struct CachedKernel
+        {
+            FastAccessList<DecoratedInstruction> instructions;
+            // the kernel info for the kernel, the offset and length are set when writing the module
+            KernelInfo info;
+            // the size of the stack frames of all work-items of this kernel
+            std::size_t stackSize;
+            // the number of locals spilled into VPM by the register allocation
+            std::size_t numSpilledLocals;
+
+            CachedKernel() : info(0), stackSize(0), numSpilledLocals(0) {}
+        };
+
+        /*
+         * Calculates the fingerprint of the given kernel, to recognize an unchanged kernel in a (modified) program.
+         *
+         * NOTE: The fingerprint needs to be calculated after all called functions are inlined into the kernel, since
+         * the fingerprint is calculated from the kernel's instructions.
+         */
+        std::string calculateKernelFingerprint(const Module& module, const Method& kernel, const Configuration& config);
+
+        /*
+         * Tries to find the machine code for the kernel with the given fingerprint in the compilation cache
+         */
+        Optional<CachedKernel> lookupKernel(const std::string& fingerprint, const Configuration& config);
+
+        /*
+         * Stores the machine code for the kernel with the given fingerprint in the compilation cache
+         */
+        void storeKernel(const std::string& fingerprint, const Configuration& config, const CachedKernel& kernel);
+    } // namespace qpu_asm
+} // namespace vc4c
+
+#endif /* VC4C_KERNEL_CACHE_H */
@@ -7,10 +7,12 @@
 #include "KernelInfo.h"
 
 #include "../GlobalValues.h"
+#include "../Module.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "Instruction.h"
 #include "log.h"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <numeric>
@@ -18,6 +20,8 @@
 using namespace vc4c;
 using namespace vc4c::qpu_asm;
 
+constexpr uint32_t KernelInfo::MAX_WORK_GROUP_SIZES;
+
 // TODO can also remove address/uniform for lowered parameter on both sides!
 
 static void writeStream(std::ostream& stream, const std::array<uint8_t, 8>& buf, const OutputMode mode)
@@ -86,6 +90,16 @@ std::size_t ParamInfo::write(std::ostream& stream, const OutputMode mode) const
     return numWords;
 }
 
+static std::size_t getNameSize(const std::string& name)
+{
+    return (name.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+std::size_t ParamInfo::getNumWords() const
+{
+    return 1 + getNameSize(name) + getNameSize(typeName);
+}
+
 KernelInfo::KernelInfo(const std::size_t& numParameters) : Bitfield(0), workGroupSize(0)
 {
     parameters.reserve(numParameters);
@@ -117,10 +131,33 @@ std::size_t KernelInfo::write(std::ostream& stream, const OutputMode mode) const
             // for each parameter, copy infos and name
             numWords += info.write(stream, mode);
         }
+        for(const auto& expression : precomputedUniforms)
+        {
+            *reinterpret_cast<uint64_t*>(buf.data()) = expression.steps.size();
+            writeStream(stream, buf, mode);
+            ++numWords;
+            for(const auto& step : expression.steps)
+            {
+                *reinterpret_cast<uint64_t*>(buf.data()) =
+                    (static_cast<uint64_t>(step.code) << 32) | static_cast<uint64_t>(step.operand);
+                writeStream(stream, buf, mode);
+                ++numWords;
+            }
+        }
     }
     return numWords;
 }
 
+std::size_t KernelInfo::getNumWords() const
+{
+    auto numWords = std::accumulate(parameters.begin(), parameters.end(), 3 + getNameSize(name),
+        [](std::size_t sum, const ParamInfo& info) -> std::size_t { return sum + info.getNumWords(); });
+    return std::accumulate(precomputedUniforms.begin(), precomputedUniforms.end(), numWords,
+        [](std::size_t sum, const UniformExpression& expression) -> std::size_t {
+            return sum + 1 + expression.steps.size();
+        });
+}
+
 LCOV_EXCL_START
 std::string KernelInfo::to_string() const
 {
@@ -159,6 +196,8 @@ std::string KernelInfo::to_string() const
         uniformsSet.emplace_back("maxGidY");
     if(uniformsUsed.getMaxGroupIDZUsed())
         uniformsSet.emplace_back("maxGidZ");
+    for(const auto& expression : precomputedUniforms)
+        uniformsSet.emplace_back("[" + expression.to_string() + "]");
     const std::string uniformsString =
         uniformsSet.empty() ? "" : (std::string(" (") + vc4c::to_string<std::string>(uniformsSet) + ")");
 
@@ -213,7 +252,18 @@ static void toBinary(const CompoundConstant& val, std::vector<uint8_t>& queue)
             CompilationStep::CODE_GENERATION, "Can't map value-type to binary literal", val.to_string());
 }
 
-static std::vector<uint8_t> generateDataSegment(const StableList<Global>& globalData, Byte totalStackFrameSize)
+uint64_t qpu_asm::getKernelNameHash(const std::string& name)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for(char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+std::vector<uint8_t> qpu_asm::generateDataSegment(const StableList<Global>& globalData, Byte totalStackFrameSize)
 {
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Writing data segment for " << globalData.size() << " values..." << logging::endl);
@@ -248,6 +298,90 @@ static std::vector<uint8_t> generateDataSegment(const StableList<Global>& global
 
 std::size_t ModuleInfo::write(
     std::ostream& stream, const OutputMode mode, const StableList<Global>& globalData, Byte totalStackFrameSize)
+{
+    const auto dataSegment = mode == OutputMode::ASSEMBLER ? std::vector<uint8_t>{} :
+                                                             generateDataSegment(globalData, totalStackFrameSize);
+    return write(stream, mode, globalData, dataSegment, totalStackFrameSize);
+}
+
+std::size_t ModuleInfo::calculateHeaderSize(const OutputMode mode, const std::vector<uint8_t>& dataSegment)
+{
+    // the delimiter between the kernel infos and the global data
+    std::size_t numWords = 1;
+    if(mode == OutputMode::BINARY || mode == OutputMode::HEX)
+    {
+        // magic number and module info
+        numWords += 2;
+        for(const KernelInfo& info : kernelInfos)
+            numWords += info.getNumWords();
+    }
+    setGlobalDataOffset(Word(numWords));
+    // the global data is not counted for the assembler output
+    auto dataSize = mode == OutputMode::ASSEMBLER ? 0 : dataSegment.size() / sizeof(uint64_t);
+    setGlobalDataSize(Word(dataSize));
+    // the delimiter between the global data and the kernel code
+    return numWords + dataSize + 1;
+}
+
+std::size_t ModuleInfo::calculateSectionedLayout(const std::vector<uint8_t>& dataSegment)
+{
+    // magic number, module info, 2 words per kernel index entry and the delimiter to the global data
+    std::size_t numWords = 2 + 2 * kernelInfos.size() + 1;
+    setGlobalDataOffset(Word(numWords));
+    setGlobalDataSize(Word(dataSegment.size() / sizeof(uint64_t)));
+    // the delimiter between the global data and the kernel sections
+    numWords += dataSegment.size() / sizeof(uint64_t) + 1;
+    const auto headerSize = numWords;
+    for(KernelInfo& info : kernelInfos)
+    {
+        numWords += info.getNumWords();
+        info.setOffset(Word(numWords));
+        numWords += info.getLength().getValue();
+    }
+    return headerSize;
+}
+
+std::size_t ModuleInfo::writeSectionedHeader(std::ostream& stream, const std::vector<uint8_t>& dataSegment) const
+{
+    std::size_t numWords = 0;
+    std::array<uint8_t, 8> buf{};
+    reinterpret_cast<uint32_t*>(buf.data())[0] = QPUASM_MAGIC_NUMBER;
+    reinterpret_cast<uint32_t*>(buf.data())[1] = QPUASM_SECTIONED_MAGIC_NUMBER;
+    writeStream(stream, buf, OutputMode::BINARY);
+    ++numWords;
+
+    *reinterpret_cast<uint64_t*>(buf.data()) = value;
+    writeStream(stream, buf, OutputMode::BINARY);
+    ++numWords;
+
+    // write kernel index
+    for(const KernelInfo& info : kernelInfos)
+    {
+        auto sectionOffset = info.getOffset().getValue() - info.getNumWords();
+        reinterpret_cast<uint32_t*>(buf.data())[0] = static_cast<uint32_t>(sectionOffset);
+        reinterpret_cast<uint32_t*>(buf.data())[1] =
+            static_cast<uint32_t>(info.getNumWords() + info.getLength().getValue());
+        writeStream(stream, buf, OutputMode::BINARY);
+        *reinterpret_cast<uint64_t*>(buf.data()) = getKernelNameHash(info.name);
+        writeStream(stream, buf, OutputMode::BINARY);
+        numWords += 2;
+    }
+    // write kernel-index-to-global-data delimiter
+    buf.fill(0);
+    writeStream(stream, buf, OutputMode::BINARY);
+    ++numWords;
+
+    stream.write(reinterpret_cast<const char*>(dataSegment.data()), static_cast<std::streamsize>(dataSegment.size()));
+    numWords += dataSegment.size() / sizeof(uint64_t);
+
+    // write global-data-to-kernel-sections delimiter
+    writeStream(stream, buf, OutputMode::BINARY);
+    ++numWords;
+    return numWords;
+}
+
+std::size_t ModuleInfo::write(std::ostream& stream, const OutputMode mode, const StableList<Global>& globalData,
+    const std::vector<uint8_t>& dataSegment, Byte totalStackFrameSize)
 {
     std::size_t numWords = 0;
     if(mode == OutputMode::HEX || mode == OutputMode::ASSEMBLER)
@@ -295,14 +429,14 @@ std::size_t ModuleInfo::write(
     }
     case OutputMode::BINARY:
     {
-        const auto binary = generateDataSegment(globalData, totalStackFrameSize);
-        stream.write(reinterpret_cast<const char*>(binary.data()), static_cast<std::streamsize>(binary.size()));
-        numWords += binary.size() / sizeof(uint64_t);
+        stream.write(
+            reinterpret_cast<const char*>(dataSegment.data()), static_cast<std::streamsize>(dataSegment.size()));
+        numWords += dataSegment.size() / sizeof(uint64_t);
         break;
     }
     case OutputMode::HEX:
     {
-        const auto binary = generateDataSegment(globalData, totalStackFrameSize);
+        const auto& binary = dataSegment;
         for(const Global& global : globalData)
             stream << "//" << global.to_string(true) << std::endl;
         if(totalStackFrameSize.getValue() > 0)
@@ -339,28 +473,39 @@ KernelInfo qpu_asm::getKernelInfos(
     info.setName(method.name[0] == '@' ? method.name.substr(1) : method.name);
     info.workGroupSize = 0;
     info.uniformsUsed = method.metaData.uniformsUsed;
+    info.precomputedUniforms = method.metaData.precomputedUniforms;
+    // the target hardware might provide less QPUs than supported by the runtime library
+    const auto maxWorkGroupSize =
+        std::min(KernelInfo::MAX_WORK_GROUP_SIZES, method.module.compilationConfig.target.numQPUs);
     {
         size_t requiredSize = 1;
         unsigned offset = 0;
         for(uint32_t size : method.metaData.workGroupSizes)
         {
+            // the host-side work-group size is the number of QPUs actually executing the work-items
+            if(offset == 0 && method.metaData.workItemsPerQPU > 1)
+                size /= method.metaData.workItemsPerQPU;
             info.workGroupSize |= static_cast<uint64_t>(size) << offset;
             offset += 16;
             requiredSize *= size;
         }
-        if(requiredSize > KernelInfo::MAX_WORK_GROUP_SIZES)
+        if(method.metaData.workItemsPerQPU > 1)
+            info.workGroupSize |= static_cast<uint64_t>(method.metaData.workItemsPerQPU) << 48;
+        if(method.metaData.isThreadable)
+            info.workGroupSize |= uint64_t{1} << 63;
+        if(requiredSize > maxWorkGroupSize)
         {
             logging::error() << "Required work-group size " << requiredSize << " exceeds the limit of "
-                             << KernelInfo::MAX_WORK_GROUP_SIZES << logging::endl;
+                             << maxWorkGroupSize << logging::endl;
         }
     }
     {
         uint32_t requiredSize = std::accumulate(method.metaData.workGroupSizeHints.begin(),
             method.metaData.workGroupSizeHints.end(), 1u, std::multiplies<uint32_t>());
-        if(requiredSize > KernelInfo::MAX_WORK_GROUP_SIZES)
+        if(requiredSize > maxWorkGroupSize)
         {
-            logging::warn() << "Work-group size hint " << requiredSize << " exceeds the limit of "
-                            << KernelInfo::MAX_WORK_GROUP_SIZES << logging::endl;
+            logging::warn() << "Work-group size hint " << requiredSize << " exceeds the limit of " << maxWorkGroupSize
+                            << logging::endl;
         }
     }
     for(const Parameter& param : method.parameters)
@@ -111,6 +111,10 @@ namespace vc4c
             std::string to_string() const;
 
             std::size_t write(std::ostream& stream, OutputMode mode) const;
+            /*
+             * Returns the number of 64-bit words written by #write() for binary output
+             */
+            std::size_t getNumWords() const;
 
             std::string name;
             std::string typeName;
@@ -158,7 +162,11 @@ namespace vc4c
              */
             BITFIELD_ENTRY(ParamCount, uint8_t, 56, Byte)
             /*
-             * The 3 dimensions for the work-group size specified in the source code
+             * The 3 dimensions for the work-group size specified in the source code (16 bits each) and the number of
+             * work-items executed per QPU in the upper 16 bits (zero for a single work-item, see
+             * KernelMetaData#workItemsPerQPU). If multiple work-items are executed per QPU, the size of the first
+             * dimension is already divided by this number. The highest bit is set if the kernel is run in two hardware
+             * threads per QPU (see KernelMetaData#isThreadable).
              */
             uint64_t workGroupSize;
             /*
@@ -168,6 +176,10 @@ namespace vc4c
             KernelUniforms uniformsUsed;
 
             std::size_t write(std::ostream& stream, OutputMode mode) const;
+            /*
+             * Returns the number of 64-bit words written by #write() for binary output
+             */
+            std::size_t getNumWords() const;
             std::string to_string() const;
 
             // The maximum work group sizes specified in the VC4CL runtime library
@@ -187,12 +199,45 @@ namespace vc4c
 
             std::string name;
             std::vector<ParamInfo> parameters;
+            /*
+             * The calculations of the values passed in the UNIFORMs following the parameters, only written if
+             * KernelUniforms#NumPrecomputedValues is set.
+             *
+             * Binary layout (per value): the number of steps, followed by a 64-bit word per step containing the operand
+             * in the lower 32 bits and the op-code in the next 8 bits.
+             */
+            std::vector<UniformExpression> precomputedUniforms;
         };
 
         /*
          * Binary layout:
          *
          * | num kernel-infos | global-data offset | global-data size | stack-frame size |
+         *
+         * Layout of the whole module:
+         *
+         * | magic number | magic number |
+         * | module info                 |
+         * | kernel info ...             |
+         * | zero-word                   |
+         * | global data ...             |
+         * | zero-word                   |
+         * | kernel code ...             |
+         *
+         * Layout of the whole module in the sectioned format (see Configuration#sectionedBinary):
+         *
+         * | magic number | sectioned magic number     |
+         * | module info                               |
+         * | section offset (32 bit) | section length (32 bit) | (per kernel)
+         * | kernel name hash (64 bit)                 | (per kernel)
+         * | zero-word                                 |
+         * | global data ...                           |
+         * | zero-word                                 |
+         * | kernel info | kernel code ...             | (per kernel)
+         *
+         * The section offset and length (in multiples of 64-bit) of the sections containing the kernel info and code
+         * of a single kernel allow to only load the kernels used, which can be found by the hash of their names (see
+         * #getKernelNameHash()).
          */
         class ModuleInfo : public Bitfield<uint64_t>
         {
@@ -230,6 +275,37 @@ namespace vc4c
              */
             std::size_t write(
                 std::ostream& stream, OutputMode mode, const StableList<Global>& globalData, Byte totalStackFrameSize);
+            /*
+             * Writes the module header with the given (already generated, see #generateDataSegment()) global data
+             * segment.
+             *
+             * NOTE: The global-data offset and size need to be set before (see #calculateHeaderSize()) to be written
+             * correctly.
+             */
+            std::size_t write(std::ostream& stream, OutputMode mode, const StableList<Global>& globalData,
+                const std::vector<uint8_t>& dataSegment, Byte totalStackFrameSize);
+
+            /*
+             * Calculates the number of 64-bit words written by #write(), i.e. the offset of the first kernel code,
+             * without actually writing the module header and sets the global-data offset and size accordingly.
+             */
+            std::size_t calculateHeaderSize(OutputMode mode, const std::vector<uint8_t>& dataSegment);
+
+            /*
+             * Calculates the layout of the sectioned module format, i.e. sets the global-data offset and size as well
+             * as the offsets of the kernel codes (behind their kernel infos) and returns the number of 64-bit words of
+             * the module header, i.e. the offset of the first kernel section.
+             *
+             * NOTE: The kernel infos need to contain the code lengths of their kernels.
+             */
+            std::size_t calculateSectionedLayout(const std::vector<uint8_t>& dataSegment);
+            /*
+             * Writes the module header of the sectioned module format, i.e. the kernel index and the global data. The
+             * layout needs to be calculated before (see #calculateSectionedLayout()).
+             *
+             * Every section consists of the binary kernel info (see KernelInfo#write()) followed by the kernel code.
+             */
+            std::size_t writeSectionedHeader(std::ostream& stream, const std::vector<uint8_t>& dataSegment) const;
 
             inline void addKernelInfo(const KernelInfo& info)
             {
@@ -241,6 +317,18 @@ namespace vc4c
         };
 
         KernelInfo getKernelInfos(const Method& method, std::size_t initialOffset, std::size_t numInstructions);
+
+        /*
+         * Returns the hash (64-bit FNV-1a) of the given kernel name as written to the kernel index of the sectioned
+         * module format
+         */
+        uint64_t getKernelNameHash(const std::string& name);
+
+        /*
+         * Generates the binary representation of the global data segment containing the initial values of all globals
+         * followed by the space reserved for the stack frames, padded to a multiple of 8 bytes.
+         */
+        std::vector<uint8_t> generateDataSegment(const StableList<Global>& globalData, Byte totalStackFrameSize);
     } // namespace qpu_asm
 } // namespace vc4c
 
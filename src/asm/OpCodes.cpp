@@ -13,8 +13,12 @@
 #include "../intrinsics/Operators.h"
 #include "CompilationError.h"
 
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <cmath>
-#include <map>
+#include <initializer_list>
+#include <utility>
 
 using namespace vc4c;
 
@@ -1133,6 +1137,175 @@ PrecalculatedValue OpCode::operator()(Literal firstOperand, Literal secondOperan
     return std::make_pair(Value(*tmp.first, resultType), tmp.second);
 }
 
+/*
+ * Batched evaluation of the integer and bit-wise operations over all elements of a SIMD vector.
+ *
+ * The operands are unpacked into plain 32-bit lanes once and every operation is then calculated in simple branch-free
+ * loops over all lanes, which the host compiler can auto-vectorize (e.g. to SSE or NEON instructions). This avoids
+ * dispatching on the op-code and converting from/to Literal for every single element. Elements which are undefined in
+ * any operand are tracked as bit-mask and are undefined in the result.
+ */
+using LaneMask = std::bitset<NATIVE_VECTOR_SIZE>;
+using Lanes = std::array<uint32_t, NATIVE_VECTOR_SIZE>;
+
+struct LaneResult
+{
+    Lanes values;
+    // 1 for all lanes where the carry/overflow flag is set, 0 otherwise
+    Lanes carry;
+    Lanes overflow;
+    bool setsCarry;
+    bool setsOverflow;
+};
+
+static LaneMask unpackLanes(const SIMDVector& vector, Lanes& lanes) noexcept
+{
+    LaneMask undefinedLanes;
+    for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        lanes[i] = vector[i].unsignedInt();
+        undefinedLanes[i] = vector[i].isUndefined();
+    }
+    return undefinedLanes;
+}
+
+static inline int32_t toSigned(uint32_t val) noexcept
+{
+    return bit_cast<uint32_t, int32_t>(val);
+}
+
+static bool calcLanes(const OpCode& code, const Lanes& a, const Lanes& b, LaneResult& res) noexcept
+{
+    auto& out = res.values;
+    res.carry.fill(0);
+    res.overflow.fill(0);
+    res.setsCarry = true;
+    res.setsOverflow = true;
+    switch(code.opAdd)
+    {
+    case OP_ADD.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            out[i] = a[i] + b[i];
+            res.carry[i] = out[i] < a[i];
+            // signed overflow if both operands have the same sign and the result has a different one
+            res.overflow[i] = ((a[i] ^ out[i]) & (b[i] ^ out[i])) >> 31;
+        }
+        return true;
+    case OP_SUB.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            out[i] = a[i] - b[i];
+            res.carry[i] = toSigned(a[i]) < toSigned(b[i]);
+            // signed overflow if the operands have different signs and the result has not the sign of the minuend
+            res.overflow[i] = ((a[i] ^ b[i]) & (a[i] ^ out[i])) >> 31;
+        }
+        return true;
+    case OP_SHR.opAdd:
+        // Tests have shown that on VC4 all shifts (asr, shr, shl) only take the last 5 bits of the offset (modulo 32)
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            out[i] = a[i] >> (b[i] & 0x1F);
+            res.carry[i] = (a[i] & ((1u << (b[i] & 0x1F)) - 1u)) != 0;
+        }
+        res.setsOverflow = false;
+        return true;
+    case OP_ASR.opAdd:
+        // shifts by negative offsets are rejected by intrinsics::asr and a non-arithmetic signed right shift of the
+        // host needs the manual shifting, so leave these to the generic calculation
+        if((-1 >> 31u) != -1 ||
+            std::any_of(b.begin(), b.end(), [](uint32_t offset) -> bool { return toSigned(offset) < 0; }))
+            return false;
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            out[i] = static_cast<uint32_t>(toSigned(a[i]) >> (b[i] & 0x1F));
+            res.carry[i] = (a[i] & ((1u << (b[i] & 0x1F)) - 1u)) != 0;
+        }
+        return true;
+    case OP_SHL.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            out[i] = a[i] << (b[i] & 0x1F);
+            res.carry[i] = (static_cast<uint64_t>(a[i]) << (b[i] & 0x1F)) > static_cast<uint64_t>(0xFFFFFFFFul);
+        }
+        res.setsOverflow = false;
+        return true;
+    case OP_MIN.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            res.carry[i] = toSigned(a[i]) > toSigned(b[i]);
+            out[i] = res.carry[i] ? b[i] : a[i];
+        }
+        return true;
+    case OP_MAX.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            res.carry[i] = toSigned(a[i]) > toSigned(b[i]);
+            out[i] = res.carry[i] ? a[i] : b[i];
+        }
+        return true;
+    case OP_AND.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            out[i] = a[i] & b[i];
+        return true;
+    case OP_OR.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            out[i] = a[i] | b[i];
+        return true;
+    case OP_XOR.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            out[i] = a[i] ^ b[i];
+        return true;
+    case OP_NOT.opAdd:
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            out[i] = ~a[i];
+        res.setsOverflow = false;
+        return true;
+    }
+
+    if(code.opMul == OP_MUL24.opMul)
+    {
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            auto extendedVal = static_cast<uint64_t>(a[i] & 0xFFFFFFu) * static_cast<uint64_t>(b[i] & 0xFFFFFFu);
+            out[i] = static_cast<uint32_t>(extendedVal);
+            res.carry[i] = extendedVal > static_cast<uint64_t>(0xFFFFFFFFul);
+        }
+        res.setsOverflow = false;
+        return true;
+    }
+    return false;
+}
+
+static Optional<PrecalculatedVector> calcVector(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    Lanes first{};
+    Lanes second{};
+    auto undefinedLanes = unpackLanes(firstOperand, first);
+    if(code.numOperands == 2)
+        undefinedLanes |= unpackLanes(secondOperand, second);
+    LaneResult res;
+    if(!calcLanes(code, first, second, res))
+        return {};
+
+    SIMDVector vector;
+    VectorFlags flags;
+    for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        if(undefinedLanes.test(i))
+            // leave the result element and its flags undefined
+            continue;
+        vector[i] = Literal(res.values[i]);
+        flags[i] = ElementFlags::fromLiteral(vector[i]);
+        if(res.setsCarry)
+            flags[i].carry = res.carry[i] ? FlagStatus::SET : FlagStatus::CLEAR;
+        if(res.setsOverflow)
+            flags[i].overflow = res.overflow[i] ? FlagStatus::SET : FlagStatus::CLEAR;
+    }
+    return std::make_pair(Optional<SIMDVector>{vector}, flags);
+}
+
 PrecalculatedVector OpCode::operator()(const SIMDVector& firstOperand, const SIMDVector& secondOperand) const
 {
     if(numOperands >= 1 && firstOperand.isUndefined())
@@ -1141,6 +1314,8 @@ PrecalculatedVector OpCode::operator()(const SIMDVector& firstOperand, const SIM
     if(numOperands == 2 && secondOperand.isUndefined())
         // returns an undefined vector
         return std::make_pair(SIMDVector{}, VectorFlags{});
+    if(auto result = calcVector(*this, firstOperand, secondOperand))
+        return *result;
     SIMDVector res;
     VectorFlags flags;
     for(unsigned char i = 0; i < res.size(); ++i)
@@ -1330,14 +1505,10 @@ const OpCode& OpCode::toOpCode(const std::string& name)
     return code;
 }
 
-static const std::multimap<std::string, OpCode> opCodes = {{OP_ADD.name, OP_ADD}, {OP_AND.name, OP_AND},
-    {OP_ASR.name, OP_ASR}, {OP_CLZ.name, OP_CLZ}, {OP_FADD.name, OP_FADD}, {OP_FMAX.name, OP_FMAX},
-    {OP_FMAXABS.name, OP_FMAXABS}, {OP_FMIN.name, OP_FMIN}, {OP_FMINABS.name, OP_FMINABS}, {OP_FMUL.name, OP_FMUL},
-    {OP_FSUB.name, OP_FSUB}, {OP_FTOI.name, OP_FTOI}, {OP_ITOF.name, OP_ITOF}, {OP_MAX.name, OP_MAX},
-    {OP_MIN.name, OP_MIN}, {OP_MUL24.name, OP_MUL24}, {OP_NOP.name, OP_NOP}, {OP_NOT.name, OP_NOT}, {OP_OR.name, OP_OR},
-    {OP_ROR.name, OP_ROR}, {OP_SHL.name, OP_SHL}, {OP_SHR.name, OP_SHR}, {OP_SUB.name, OP_SUB},
-    {OP_V8ADDS.name, OP_V8ADDS}, {OP_V8MAX.name, OP_V8MAX}, {OP_V8MIN.name, OP_V8MIN}, {OP_V8MULD.name, OP_V8MULD},
-    {OP_V8SUBS.name, OP_V8SUBS}, {OP_XOR.name, OP_XOR}};
+// all op-codes which can be executed by the ALUs
+static constexpr std::array<OpCode, 29> ALL_OP_CODES = {OP_ADD, OP_AND, OP_ASR, OP_CLZ, OP_FADD, OP_FMAX, OP_FMAXABS,
+    OP_FMIN, OP_FMINABS, OP_FMUL, OP_FSUB, OP_FTOI, OP_ITOF, OP_MAX, OP_MIN, OP_MUL24, OP_NOP, OP_NOT, OP_OR, OP_ROR,
+    OP_SHL, OP_SHR, OP_SUB, OP_V8ADDS, OP_V8MAX, OP_V8MIN, OP_V8MULD, OP_V8SUBS, OP_XOR};
 
 // NOTE: The indices MUST correspond to the op-codes!
 static const std::array<OpCode, 32> addCodes = {OP_NOP, OP_FADD, OP_FSUB, OP_FMIN, OP_FMAX, OP_FMINABS, OP_FMAXABS,
@@ -1348,56 +1519,179 @@ static const std::array<OpCode, 32> addCodes = {OP_NOP, OP_FADD, OP_FSUB, OP_FMI
 static const std::array<OpCode, 8> mulCodes = {
     OP_NOP, OP_FMUL, OP_MUL24, OP_V8MULD, OP_V8MIN, OP_V8MAX, OP_V8ADDS, OP_V8SUBS};
 
+/*
+ * The op-codes are indexed densely by their add ALU code, followed by the codes of the op-codes only executable on the
+ * mul ALU. This matches the equality of op-codes (see OpCode#operator==), since all op-codes executable on both ALUs
+ * have an add ALU code.
+ */
+static constexpr std::size_t NUM_OP_CODE_INDICES = 32 + 8;
+
+CONST static constexpr std::size_t toOpCodeIndex(const OpCode& code) noexcept
+{
+    return code.opAdd != 0 ? code.opAdd : (code.opMul != 0 ? 32u + code.opMul : 0u);
+}
+
+CONST static constexpr uint64_t toOpCodeBit(const OpCode& code) noexcept
+{
+    return uint64_t{1} << toOpCodeIndex(code);
+}
+
+static_assert(NUM_OP_CODE_INDICES <= 64, "Op-code indices do not fit into bit-mask");
+
+template <typename T, std::size_t... Indices>
+CONST static constexpr std::array<T, sizeof...(Indices)> createOpCodeTable(
+    T (*func)(std::size_t), std::index_sequence<Indices...>) noexcept
+{
+    return {{func(Indices)...}};
+}
+
+static constexpr uint8_t PROPERTY_IDEMPOTENT = 1u << 0u;
+static constexpr uint8_t PROPERTY_ASSOCIATIVE = 1u << 1u;
+static constexpr uint8_t PROPERTY_COMMUTATIVE = 1u << 2u;
+static constexpr uint8_t PROPERTY_SELF_INVERSE = 1u << 3u;
+
+CONST static constexpr bool isAnyOf(std::size_t index, std::initializer_list<OpCode> codes) noexcept
+{
+    for(const auto& code : codes)
+    {
+        if(toOpCodeIndex(code) == index)
+            return true;
+    }
+    return false;
+}
+
+CONST static constexpr uint8_t determineProperties(std::size_t index) noexcept
+{
+    // the index 0 is only used by the nop-operation (and invalid op-codes), which has no properties
+    if(index == 0)
+        return 0;
+    uint8_t properties = 0;
+    if(isAnyOf(index, {OP_AND, OP_FMAX, OP_FMIN, OP_MAX, OP_MIN, OP_OR, OP_V8MAX, OP_V8MIN}))
+        properties |= PROPERTY_IDEMPOTENT;
+    if(isAnyOf(index,
+           {OP_ADD, OP_AND, OP_FADD, OP_FMAX, OP_FMAXABS, OP_FMIN, OP_FMINABS, OP_FMUL, OP_MAX, OP_MIN, OP_OR, OP_V8MAX,
+               OP_V8MIN, OP_XOR}))
+        properties |= PROPERTY_ASSOCIATIVE;
+    if(isAnyOf(index,
+           {OP_ADD, OP_AND, OP_FADD, OP_FMAX, OP_FMAXABS, OP_FMIN, OP_FMINABS, OP_FMUL, OP_MAX, OP_MIN, OP_MUL24, OP_OR,
+               OP_V8ADDS, OP_V8MAX, OP_V8MIN, OP_V8MULD, OP_XOR}))
+        properties |= PROPERTY_COMMUTATIVE;
+    if(isAnyOf(index, {OP_NOT, OP_SUB, OP_FSUB, OP_XOR}))
+        properties |= PROPERTY_SELF_INVERSE;
+    return properties;
+}
+
+/*
+ * Returns the bit-mask of the op-codes the op-code with the given index is distributive over.
+ *
+ * NOTE: For all supported op-codes, the left- and right-distributivity are the same.
+ */
+CONST static constexpr uint64_t determineDistributivity(std::size_t index) noexcept
+{
+    if(index == toOpCodeIndex(OP_FMUL))
+        return toOpCodeBit(OP_FADD) | toOpCodeBit(OP_FSUB);
+    if(index == toOpCodeIndex(OP_FADD))
+        return toOpCodeBit(OP_FMIN) | toOpCodeBit(OP_FMAX);
+    if(index == toOpCodeIndex(OP_ADD))
+        return toOpCodeBit(OP_MIN) | toOpCodeBit(OP_MAX);
+    if(index == toOpCodeIndex(OP_AND))
+        return toOpCodeBit(OP_OR) | toOpCodeBit(OP_XOR);
+    return 0;
+}
+
+static constexpr auto OP_CODE_PROPERTIES =
+    createOpCodeTable(&determineProperties, std::make_index_sequence<NUM_OP_CODE_INDICES>{});
+static constexpr auto OP_CODE_DISTRIBUTIVITY =
+    createOpCodeTable(&determineDistributivity, std::make_index_sequence<NUM_OP_CODE_INDICES>{});
+
+static_assert(OP_CODE_PROPERTIES[toOpCodeIndex(OP_XOR)] ==
+        (PROPERTY_ASSOCIATIVE | PROPERTY_COMMUTATIVE | PROPERTY_SELF_INVERSE),
+    "Invalid op-code properties table");
+
+/*
+ * The op-code names are looked up via a perfect hash: The FNV-1a hash with the basis below maps every op-code name to a
+ * distinct slot (given by the upper bits of the hash), which is checked at compile-time.
+ */
+static constexpr uint32_t OP_CODE_NAME_HASH_BASIS = 1164;
+static constexpr std::size_t NUM_OP_CODE_NAME_SLOTS = 64;
+
+CONST static constexpr std::size_t toNameSlot(const char* name, std::size_t length) noexcept
+{
+    uint32_t hash = OP_CODE_NAME_HASH_BASIS;
+    for(std::size_t i = 0; i < length; ++i)
+        hash = (hash ^ static_cast<uint8_t>(name[i])) * 16777619u;
+    // upper 6 bits
+    return hash >> 26u;
+}
+
+CONST static constexpr std::size_t toNameSlot(const char* name) noexcept
+{
+    std::size_t length = 0;
+    while(name[length] != '\0')
+        ++length;
+    return toNameSlot(name, length);
+}
+
+/*
+ * Returns the index into ALL_OP_CODES plus one of the op-code with the name mapping to the given slot, zero if the slot
+ * is empty
+ */
+CONST static constexpr uint8_t determineNameSlotEntry(std::size_t slot) noexcept
+{
+    for(std::size_t i = 0; i < ALL_OP_CODES.size(); ++i)
+    {
+        if(toNameSlot(ALL_OP_CODES[i].name) == slot)
+            return static_cast<uint8_t>(i + 1);
+    }
+    return 0;
+}
+
+CONST static constexpr bool hasDistinctNameSlots() noexcept
+{
+    for(std::size_t i = 0; i < ALL_OP_CODES.size(); ++i)
+    {
+        for(std::size_t k = i + 1; k < ALL_OP_CODES.size(); ++k)
+        {
+            if(toNameSlot(ALL_OP_CODES[i].name) == toNameSlot(ALL_OP_CODES[k].name))
+                return false;
+        }
+    }
+    return true;
+}
+
+static_assert(hasDistinctNameSlots(), "Op-code name hash is not perfect, adapt the hash basis");
+
+static constexpr auto OP_CODE_NAME_SLOTS =
+    createOpCodeTable(&determineNameSlotEntry, std::make_index_sequence<NUM_OP_CODE_NAME_SLOTS>{});
+
 bool OpCode::isIdempotent() const noexcept
 {
-    return *this == OP_AND || *this == OP_FMAX || *this == OP_FMIN || *this == OP_MAX || *this == OP_MIN ||
-        *this == OP_OR || *this == OP_V8MAX || *this == OP_V8MIN;
+    return OP_CODE_PROPERTIES[toOpCodeIndex(*this)] & PROPERTY_IDEMPOTENT;
 }
 
 bool OpCode::isAssociative() const noexcept
 {
-    return *this == OP_ADD || *this == OP_AND || *this == OP_FADD || *this == OP_FMAX || *this == OP_FMAXABS ||
-        *this == OP_FMIN || *this == OP_FMINABS || *this == OP_FMUL || *this == OP_MAX || *this == OP_MIN ||
-        *this == OP_OR || *this == OP_V8MAX || *this == OP_V8MIN || *this == OP_XOR;
+    return OP_CODE_PROPERTIES[toOpCodeIndex(*this)] & PROPERTY_ASSOCIATIVE;
 }
 
 bool OpCode::isCommutative() const noexcept
 {
-    return *this == OP_ADD || *this == OP_AND || *this == OP_FADD || *this == OP_FMAX || *this == OP_FMAXABS ||
-        *this == OP_FMIN || *this == OP_FMINABS || *this == OP_FMUL || *this == OP_MAX || *this == OP_MIN ||
-        *this == OP_MUL24 || *this == OP_OR || *this == OP_V8ADDS || *this == OP_V8MAX || *this == OP_V8MIN ||
-        *this == OP_V8MULD || *this == OP_XOR;
+    return OP_CODE_PROPERTIES[toOpCodeIndex(*this)] & PROPERTY_COMMUTATIVE;
 }
 
 bool OpCode::isLeftDistributiveOver(const OpCode& other) const noexcept
 {
-    if(*this == OP_FMUL)
-        return other == OP_FADD || other == OP_FSUB;
-    if(*this == OP_FADD)
-        return other == OP_FMIN || other == OP_FMAX;
-    if(*this == OP_ADD)
-        return other == OP_MIN || other == OP_MAX;
-    if(*this == OP_AND)
-        return other == OP_OR || other == OP_XOR;
-    return false;
+    return OP_CODE_DISTRIBUTIVITY[toOpCodeIndex(*this)] & toOpCodeBit(other);
 }
 
 bool OpCode::isRightDistributiveOver(const OpCode& other) const noexcept
 {
-    if(*this == OP_FMUL)
-        return other == OP_FADD || other == OP_FSUB;
-    if(*this == OP_FADD)
-        return other == OP_FMIN || other == OP_FMAX;
-    if(*this == OP_ADD)
-        return other == OP_MIN || other == OP_MAX;
-    if(*this == OP_AND)
-        return other == OP_OR || other == OP_XOR;
-    return false;
+    return OP_CODE_DISTRIBUTIVITY[toOpCodeIndex(*this)] & toOpCodeBit(other);
 }
 
 bool OpCode::isSelfInverse() const noexcept
 {
-    return *this == OP_NOT || *this == OP_SUB || *this == OP_FSUB || *this == OP_XOR;
+    return OP_CODE_PROPERTIES[toOpCodeIndex(*this)] & PROPERTY_SELF_INVERSE;
 }
 
 const OpCode& OpCode::toOpCode(const unsigned char opCode, const bool isMulALU)
@@ -1412,9 +1706,9 @@ const OpCode& OpCode::toOpCode(const unsigned char opCode, const bool isMulALU)
 
 const OpCode& OpCode::findOpCode(const std::string& name)
 {
-    auto it = opCodes.find(name);
-    if(it != opCodes.end())
-        return it->second;
+    auto entry = OP_CODE_NAME_SLOTS[toNameSlot(name.data(), name.size())];
+    if(entry != 0 && name == ALL_OP_CODES[entry - 1u].name)
+        return ALL_OP_CODES[entry - 1u];
     return OP_NOP;
 }
 
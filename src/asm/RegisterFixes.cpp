@@ -7,17 +7,21 @@
 #include "RegisterFixes.h"
 
 #include "../Method.h"
+#include "../Profiler.h"
 #include "../analysis/ControlFlowGraph.h"
 #include "../analysis/LivenessAnalysis.h"
 #include "../intermediate/VectorHelper.h"
 #include "../intermediate/operators.h"
+#include "../periphery/VPM.h"
 #include "GraphColoring.h"
 
+#include <algorithm>
+
 using namespace vc4c;
 using namespace vc4c::qpu_asm;
 using namespace vc4c::operators;
 
-// TODO make steps: 1. only small fixes, 2. group locals, "spill" to vector, rematerialize, 3. spill into VPM
+// TODO make steps: 1. only small fixes, 2. group locals, "spill" to vector, rematerialize
 const std::vector<std::pair<std::string, RegisterFixupStep>> qpu_asm::FIXUP_STEPS = {
     // For the first two steps, try to run our in-graph fix-ups
     {"Small rewrites",
@@ -31,8 +35,19 @@ const std::vector<std::pair<std::string, RegisterFixupStep>> qpu_asm::FIXUP_STEP
             // same as above
             return coloredGraph.fixErrors() ? FixupResult::ALL_FIXED : FixupResult::FIXES_APPLIED_KEEP_GRAPH;
         }},
+    // Recalculate cheap long-living locals in every block instead of keeping them in registers
+    {"Split live ranges", splitLiveRanges},
     // Try to group pointer parameters into vectors to save registers used
-    {"Group parameters", groupParameters}};
+    {"Group parameters", groupParameters},
+    // Re-read long-living locals from their UNIFORMs to free up registers
+    {"Re-read UNIFORMs", rematerializeUniforms},
+    // Spill long-living locals into VPM to free up registers
+    {"Spill locals", spillLocals},
+    // Fix the errors introduced by the spilling code (e.g. read-after-writes on the spill setup values)
+    {"Small rewrites",
+        [](Method& method, const Configuration& config, GraphColoring& coloredGraph) -> FixupResult {
+            return coloredGraph.fixErrors() ? FixupResult::ALL_FIXED : FixupResult::FIXES_APPLIED_KEEP_GRAPH;
+        }}};
 
 FixupResult qpu_asm::groupParameters(Method& method, const Configuration& config, const GraphColoring& coloredGraph)
 {
@@ -144,3 +159,479 @@ FixupResult qpu_asm::groupParameters(Method& method, const Configuration& config
 
     return somethingChanged ? FixupResult::FIXES_APPLIED_RECREATE_GRAPH : FixupResult::NOTHING_FIXED;
 }
+
+// The minimum average number of instructions between two accesses of a local to be worth spilling
+static constexpr std::size_t MIN_SPILL_USE_DISTANCE = 8;
+
+/*
+ * Returns whether the given instruction is part of a VPM access sequence (e.g. between the VPM setup and the actual
+ * access or within the region guarded by the hardware mutex), where no other VPM access must be inserted.
+ */
+static bool isWithinVPMAccess(InstructionWalker it)
+{
+    auto accessesVPM = [](const intermediate::IntermediateInstruction& inst) -> bool {
+        return inst.readsRegister(REG_VPM_IO) || inst.writesRegister(REG_VPM_IO) ||
+            inst.writesRegister(REG_VPM_IN_SETUP) || inst.writesRegister(REG_VPM_OUT_SETUP);
+    };
+    if(accessesVPM(*it.get()))
+        return true;
+    while(!it.isStartOfBlock())
+    {
+        it.previousInBlock();
+        if(!it.has())
+            continue;
+        if(auto mutex = it.get<intermediate::MutexLock>())
+            return mutex->locksMutex();
+        if(accessesVPM(*it.get()))
+            // conservatively assume the access is not yet finished
+            return true;
+    }
+    return false;
+}
+
+static bool isSpillable(const Local* local)
+{
+    if(local->residesInMemory() || local->is<BuiltinLocal>() || local->type.getScalarBitCount() > 32)
+        return false;
+    if(Local::getLocalData<MultiRegisterData>(local))
+        return false;
+    for(const auto& user : local->getUsers())
+    {
+        // the register is always spilled as a whole, so partial (conditional) writes would need the previous value
+        if(user.second.writesLocal() && user.first->hasConditionalExecution())
+            return false;
+        // locals read unpacked need to be on register-file A, which a filled value read right away cannot be
+        if(user.second.readsLocal() && user.first->hasUnpackMode())
+            return false;
+    }
+    return true;
+}
+
+static FastSet<const Local*> determineConflictingLocals(const Method& method, const FastSet<const Local*>& errorLocals,
+    const analysis::LocalUsageRangeAnalysis& localUsageRangeAnalysis)
+{
+    FastSet<const Local*> conflictingLocals;
+    for(const auto& block : method)
+    {
+        const auto& ranges = localUsageRangeAnalysis.getRanges(block);
+        for(const auto& errorRange : ranges)
+        {
+            if(errorLocals.find(errorRange.local) == errorLocals.end())
+                continue;
+            for(const auto& range : ranges)
+            {
+                if(range.startIndex <= errorRange.endIndex && errorRange.startIndex <= range.endIndex)
+                    conflictingLocals.emplace(range.local);
+            }
+        }
+    }
+    return conflictingLocals;
+}
+
+static void insertSpillSetup(InstructionWalker& it, Method& method, const Value& setupRegister, uint32_t setupValue,
+    intermediate::InstructionDecorations deco)
+{
+    // the per-QPU row is selected by adding the QPU number to the base row of the area
+    auto setup = method.addNewLocal(TYPE_INT32, "%spill_setup");
+    it.emplace(new intermediate::LoadImmediate(setup, Literal(setupValue)));
+    it->addDecorations(deco);
+    it.nextInBlock();
+    assign(it, setupRegister) = (setup + Value(REG_QPU_NUMBER, TYPE_INT8), deco);
+}
+
+FixupResult qpu_asm::spillLocals(Method& method, const Configuration& config, const GraphColoring& coloredGraph)
+{
+    const auto& errorLocals = coloredGraph.getErrorLocals();
+    if(errorLocals.empty() || !method.vpm)
+        return FixupResult::NOTHING_FIXED;
+
+    analysis::LocalUsageRangeAnalysis localUsageRangeAnalysis(&coloredGraph.getLivenessAnalysis());
+    localUsageRangeAnalysis(method);
+
+    // only spilling the locals live together with the locals which could not be assigned frees up registers for them
+    auto conflictingLocals = determineConflictingLocals(method, errorLocals, localUsageRangeAnalysis);
+
+    FastAccessList<analysis::LocalUtilization> candidates;
+    for(const auto& entry : localUsageRangeAnalysis.getOverallUsages())
+    {
+        if(entry.numAccesses == 0 || entry.numInstructions / entry.numAccesses < MIN_SPILL_USE_DISTANCE)
+            // spilling a local accessed that often would only introduce the spill code without freeing a register
+            continue;
+        if(conflictingLocals.find(entry.local) == conflictingLocals.end() || !isSpillable(entry.local))
+            continue;
+        candidates.emplace_back(entry);
+    }
+    // prefer locals not accessed in loops (where the spill code is executed repeatedly) and with larger use distances
+    std::sort(candidates.begin(), candidates.end(), [](const auto& one, const auto& other) -> bool {
+        if(one.numLoops != other.numLoops)
+            return one.numLoops < other.numLoops;
+        return one.numInstructions * other.numAccesses > other.numInstructions * one.numAccesses;
+    });
+    // spill one local per local which could not be assigned a register
+    if(candidates.size() > errorLocals.size())
+        candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(errorLocals.size()), candidates.end());
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Trying to spill " << candidates.size() << " locals into VPM..." << logging::endl);
+
+    FastMap<const Local*, std::pair<FastAccessList<InstructionWalker>, FastAccessList<InstructionWalker>>> accesses;
+    for(const auto& candidate : candidates)
+        accesses[candidate.local];
+    for(auto& block : method)
+    {
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(it.has())
+            {
+                for(auto& entry : accesses)
+                {
+                    if(it->writesLocal(entry.first))
+                        entry.second.first.emplace_back(it);
+                    if(it->readsLocal(entry.first))
+                        entry.second.second.emplace_back(it);
+                }
+            }
+            it.nextInBlock();
+        }
+    }
+
+    bool somethingChanged = false;
+    for(const auto& candidate : candidates)
+    {
+        const Local* local = candidate.local;
+        auto& writers = accesses.at(local).first;
+        auto& readers = accesses.at(local).second;
+        if(writers.empty() || readers.empty())
+            continue;
+        if(std::any_of(writers.begin(), writers.end(), isWithinVPMAccess) ||
+            std::any_of(readers.begin(), readers.end(), isWithinVPMAccess))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Skipping spilling of local accessed within VPM access: " << local->to_string()
+                    << logging::endl);
+            continue;
+        }
+
+        auto area = method.vpm->addPerQPUArea(local, periphery::VPMUsage::REGISTER_SPILLING);
+        if(!area)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Not enough VPM space left to spill local: " << local->to_string() << logging::endl);
+            break;
+        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Spilling local '" << local->to_string() << "' into VPM area: " << area->to_string()
+                << logging::endl);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_BACKEND + 50, "Locals spilled", 1);
+
+        const periphery::VPWSetup writeSetup(area->toWriteSetup(area->getElementType()));
+        const periphery::VPRSetup readSetup(area->toReadSetup(area->getElementType()));
+
+        // store the value into VPM after every write, the reads are replaced before the writes are spilled, since
+        // the spilling code reads the local itself
+        for(auto& readerIt : readers)
+        {
+            auto it = readerIt;
+            insertSpillSetup(it, method, VPM_IN_SETUP_REGISTER, readSetup.value,
+                intermediate::InstructionDecorations::VPM_READ_CONFIGURATION);
+            auto fill = assign(it, local->type, std::string{local->name} + ".fill") = VPM_IO_REGISTER;
+            it->replaceLocal(local, fill, LocalUse::Type::READER);
+        }
+        for(auto& writerIt : writers)
+        {
+            auto it = writerIt.copy().nextInBlock();
+            insertSpillSetup(it, method, VPM_OUT_SETUP_REGISTER, writeSetup.value,
+                intermediate::InstructionDecorations::VPM_WRITE_CONFIGURATION);
+            assign(it, VPM_IO_REGISTER) = local->createReference();
+        }
+        somethingChanged = true;
+    }
+
+    return somethingChanged ? FixupResult::FIXES_APPLIED_RECREATE_GRAPH : FixupResult::NOTHING_FIXED;
+}
+
+/*
+ * The costs (in instructions) of recalculating a value per instruction type. The costs of keeping the value in a
+ * register is 0, spilling it costs at least 3 instructions (setup, QPU offset, VPM read) per fill.
+ */
+static constexpr unsigned REMATERIALIZATION_COSTS_LOAD_IMMEDIATE = 1;
+static constexpr unsigned REMATERIALIZATION_COSTS_MOVE = 1;
+static constexpr unsigned REMATERIALIZATION_COSTS_OPERATION = 1;
+// the maximum costs of recalculating a value to be cheaper than filling it from a spill slot
+static constexpr unsigned MAX_REMATERIALIZATION_COSTS = 2;
+
+/*
+ * Returns the costs of repeating the instruction writing the local at any point of the program, if it only depends on
+ * constant values, the element number and QPU number registers or locals which can be recalculated themselves.
+ */
+static Optional<unsigned> getRematerializationCosts(
+    const intermediate::IntermediateInstruction& inst, unsigned maxCosts = MAX_REMATERIALIZATION_COSTS)
+{
+    if(inst.hasConditionalExecution() || inst.doesSetFlag() || inst.hasPackMode() || inst.hasUnpackMode() ||
+        inst.getSignal() != SIGNAL_NONE || inst.hasSideEffects() || !inst.checkOutputLocal())
+        return {};
+    unsigned costs = 0;
+    if(dynamic_cast<const intermediate::LoadImmediate*>(&inst))
+        costs = REMATERIALIZATION_COSTS_LOAD_IMMEDIATE;
+    else if(dynamic_cast<const intermediate::MoveOperation*>(&inst) &&
+        !dynamic_cast<const intermediate::VectorRotation*>(&inst))
+        costs = REMATERIALIZATION_COSTS_MOVE;
+    else if(dynamic_cast<const intermediate::Operation*>(&inst))
+        costs = REMATERIALIZATION_COSTS_OPERATION;
+    else
+        return {};
+    for(const auto& arg : inst.getArguments())
+    {
+        if(costs > maxCosts)
+            return {};
+        if(arg.getLiteralValue() || arg.checkImmediate() || arg.hasRegister(REG_ELEMENT_NUMBER) ||
+            arg.hasRegister(REG_QPU_NUMBER))
+            continue;
+        auto loc = arg.checkLocal();
+        auto writer =
+            loc ? dynamic_cast<const intermediate::IntermediateInstruction*>(loc->getSingleWriter()) : nullptr;
+        if(!writer || writer->checkOutputLocal() != loc)
+            return {};
+        // the input local needs to be recalculated too, since it might not be live at the point of recalculation
+        auto argCosts = getRematerializationCosts(*writer, maxCosts - costs);
+        if(!argCosts)
+            return {};
+        costs += *argCosts;
+    }
+    if(costs > maxCosts)
+        return {};
+    return costs;
+}
+
+/*
+ * Inserts the recalculation of the given instruction (and all local inputs it depends on) before the given position
+ */
+static void insertRematerialization(InstructionWalker& it, Method& method,
+    const intermediate::IntermediateInstruction& inst, intermediate::InlineMapping& mapping)
+{
+    for(const auto& arg : inst.getArguments())
+    {
+        auto loc = arg.checkLocal();
+        if(!loc || mapping.find(loc) != mapping.end())
+            continue;
+        auto remat = method.addNewLocal(loc->type, std::string{loc->name} + ".remat");
+        mapping.emplace(loc, remat.local());
+        insertRematerialization(
+            it, method, *dynamic_cast<const intermediate::IntermediateInstruction*>(loc->getSingleWriter()), mapping);
+    }
+    it.emplace(inst.copyFor(method, "", mapping));
+    it.nextInBlock();
+}
+
+FixupResult qpu_asm::splitLiveRanges(Method& method, const Configuration& config, const GraphColoring& coloredGraph)
+{
+    const auto& errorLocals = coloredGraph.getErrorLocals();
+    if(errorLocals.empty())
+        return FixupResult::NOTHING_FIXED;
+
+    analysis::LocalUsageRangeAnalysis localUsageRangeAnalysis(&coloredGraph.getLivenessAnalysis());
+    localUsageRangeAnalysis(method);
+    auto conflictingLocals = determineConflictingLocals(method, errorLocals, localUsageRangeAnalysis);
+
+    // the single writer and the readers (grouped by their blocks) of all candidates for rematerialization
+    FastMap<const Local*, std::pair<InstructionWalker, const BasicBlock*>> writers;
+    FastMap<const Local*, FastMap<BasicBlock*, FastAccessList<InstructionWalker>>> readers;
+    for(auto& block : method)
+    {
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            auto out = it->checkOutputLocal();
+            if(out && conflictingLocals.find(out) != conflictingLocals.end() && out->getSingleWriter() == it.get() &&
+                getRematerializationCosts(*it.get()))
+                writers.emplace(out, std::make_pair(it, &block));
+            it->forUsedLocals(
+                [&](const Local* loc, LocalUse::Type type, const intermediate::IntermediateInstruction& inst) -> void {
+                    if(has_flag(type, LocalUse::Type::READER) &&
+                        conflictingLocals.find(loc) != conflictingLocals.end())
+                    {
+                        auto& blockReaders = readers[loc][&block];
+                        if(blockReaders.empty() || !(blockReaders.back() == it))
+                            blockReaders.emplace_back(it);
+                    }
+                });
+        }
+    }
+
+    bool somethingChanged = false;
+    for(auto& writer : writers)
+    {
+        const Local* local = writer.first;
+        auto readerIt = readers.find(local);
+        if(readerIt == readers.end())
+            continue;
+        auto& writerIt = writer.second.first;
+        bool readInWriterBlock = false;
+        for(auto& blockReaders : readerIt->second)
+        {
+            if(blockReaders.first == writer.second.second)
+            {
+                readInWriterBlock = true;
+                continue;
+            }
+            // the readers in the same block share the rematerialized value, which is calculated before the first read
+            auto remat = method.addNewLocal(local->type, std::string{local->name} + ".remat");
+            intermediate::InlineMapping mapping{{local, remat.local()}};
+            auto it = blockReaders.second.front();
+            insertRematerialization(it, method, *writerIt.get(), mapping);
+            for(auto& reader : blockReaders.second)
+                reader->replaceLocal(local, remat, LocalUse::Type::READER);
+            somethingChanged = true;
+        }
+        if(readerIt->second.size() > (readInWriterBlock ? 1u : 0u))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Rematerialized local '" << local->to_string() << "' in "
+                    << (readerIt->second.size() - (readInWriterBlock ? 1u : 0u)) << " blocks" << logging::endl);
+            PROFILE_COUNTER(vc4c::profiler::COUNTER_BACKEND + 52, "Locals rematerialized", 1);
+        }
+        if(!readInWriterBlock)
+            // the original value is no longer read at all
+            writerIt.erase();
+    }
+
+    return somethingChanged ? FixupResult::FIXES_APPLIED_RECREATE_GRAPH : FixupResult::NOTHING_FIXED;
+}
+
+/*
+ * Determines the UNIFORM index (the position in the UNIFORM stream) of all locals written only by a plain read of a
+ * UNIFORM.
+ *
+ * Returns the instruction reading the UNIFORM address (the address of the first UNIFORM), if all UNIFORMs are read at
+ * the beginning of the kernel and the UNIFORM pointer is never reset afterwards. Otherwise, re-reading a UNIFORM
+ * would break the order of the following UNIFORM reads.
+ */
+static Optional<InstructionWalker> determineUniformIndices(
+    Method& method, FastMap<const Local*, uint32_t>& uniformIndices)
+{
+    // the UNIFORM address is only passed with the UNIFORMs required for the work-group loop, where it directly
+    // precedes the maximum group ids
+    auto maxGroupIdX = method.findBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_X);
+    if(!maxGroupIdX || method.empty())
+        return {};
+    Optional<InstructionWalker> uniformAddressRead;
+    Optional<InstructionWalker> previousUniformRead;
+    uint32_t index = 0;
+    const auto& firstBlock = *method.begin();
+    for(auto& block : method)
+    {
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            if(it->writesRegister(REG_UNIFORM_ADDRESS))
+                // the UNIFORM pointer is reset, e.g. for the next work-group
+                return {};
+            if(!it->readsRegister(REG_UNIFORM))
+                continue;
+            if(&block != &firstBlock || it->hasConditionalExecution())
+                return {};
+            auto move = it.get<intermediate::MoveOperation>();
+            auto out = it->checkOutputLocal();
+            if(out == maxGroupIdX)
+                uniformAddressRead = previousUniformRead;
+            if(move && out && move->getSource().hasRegister(REG_UNIFORM) && !move->hasPackMode() &&
+                !move->doesSetFlag() && out->getSingleWriter() == move && out->type.getScalarBitCount() <= 32 &&
+                !out->is<BuiltinLocal>())
+                uniformIndices.emplace(out, index);
+            previousUniformRead = it;
+            ++index;
+        }
+    }
+    return uniformAddressRead;
+}
+
+FixupResult qpu_asm::rematerializeUniforms(
+    Method& method, const Configuration& config, const GraphColoring& coloredGraph)
+{
+    const auto& errorLocals = coloredGraph.getErrorLocals();
+    if(errorLocals.empty())
+        return FixupResult::NOTHING_FIXED;
+
+    FastMap<const Local*, uint32_t> uniformIndices;
+    auto uniformAddressRead = determineUniformIndices(method, uniformIndices);
+    if(!uniformAddressRead || uniformIndices.empty())
+        return FixupResult::NOTHING_FIXED;
+
+    analysis::LocalUsageRangeAnalysis localUsageRangeAnalysis(&coloredGraph.getLivenessAnalysis());
+    localUsageRangeAnalysis(method);
+    auto conflictingLocals = determineConflictingLocals(method, errorLocals, localUsageRangeAnalysis);
+
+    FastAccessList<analysis::LocalUtilization> candidates;
+    for(const auto& entry : localUsageRangeAnalysis.getOverallUsages())
+    {
+        if(entry.numAccesses == 0 || entry.numInstructions / entry.numAccesses < MIN_SPILL_USE_DISTANCE)
+            // re-reading a local accessed that often would only introduce the additional instructions
+            continue;
+        if(conflictingLocals.find(entry.local) == conflictingLocals.end() ||
+            uniformIndices.find(entry.local) == uniformIndices.end())
+            continue;
+        candidates.emplace_back(entry);
+    }
+    // the UNIFORM address needs to be kept in a register, so we need to re-read at least one more local than the
+    // number of locals which could not be assigned a register
+    if(candidates.size() < 2)
+        return FixupResult::NOTHING_FIXED;
+    std::sort(candidates.begin(), candidates.end(), [](const auto& one, const auto& other) -> bool {
+        if(one.numLoops != other.numLoops)
+            return one.numLoops < other.numLoops;
+        return one.numInstructions * other.numAccesses > other.numInstructions * one.numAccesses;
+    });
+    if(candidates.size() > errorLocals.size() + 1)
+        candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(errorLocals.size() + 1), candidates.end());
+
+    // keep the UNIFORM address, which is otherwise discarded
+    auto uniformAddress = (*uniformAddressRead)->checkOutputLocal() ?
+        (*uniformAddressRead)->getOutput().value() :
+        method.addNewLocal(method.createPointerType(TYPE_INT32), "%uniform_address");
+    if(!(*uniformAddressRead)->checkOutputLocal())
+        (*uniformAddressRead)->setOutput(uniformAddress);
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Re-reading " << candidates.size() << " locals from their UNIFORMs..." << logging::endl);
+
+    const auto& firstBlock = *method.begin();
+    for(const auto& candidate : candidates)
+    {
+        const Local* local = candidate.local;
+        auto uniformOffset = uniformIndices.at(local) * static_cast<uint32_t>(sizeof(uint32_t));
+        // the reads within the block reading the UNIFORMs are kept, since the UNIFORM address might not be read yet
+        FastAccessList<InstructionWalker> readers;
+        for(auto& block : method)
+        {
+            if(&block == &firstBlock)
+                continue;
+            for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+            {
+                if(it.has() && it->readsLocal(local))
+                    readers.emplace_back(it);
+            }
+        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Re-reading local '" << local->to_string() << "' from UNIFORM at offset " << uniformOffset << " for "
+                << readers.size() << " reads" << logging::endl);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_BACKEND + 51, "Locals re-read from UNIFORMs", 1);
+        for(auto& readerIt : readers)
+        {
+            auto it = readerIt;
+            auto offset = method.addNewLocal(TYPE_INT32, "%uniform_offset");
+            it.emplace(new intermediate::LoadImmediate(offset, Literal(uniformOffset)));
+            it.nextInBlock();
+            assign(it, Value(REG_UNIFORM_ADDRESS, uniformAddress.type)) = uniformAddress + offset;
+            // need to wait 2 instructions for UNIFORM-pointer to be changed
+            nop(it, intermediate::DelayType::WAIT_UNIFORM);
+            nop(it, intermediate::DelayType::WAIT_UNIFORM);
+            auto reread = assign(it, local->type, std::string{local->name} + ".reread") = UNIFORM_REGISTER;
+            it->replaceLocal(local, reread, LocalUse::Type::READER);
+        }
+    }
+
+    return FixupResult::FIXES_APPLIED_RECREATE_GRAPH;
+}
@@ -74,6 +74,100 @@ namespace vc4c
          * livenesses changed.
          */
         FixupResult groupParameters(Method& method, const Configuration& config, const GraphColoring& coloredGraph);
+
+        /**
+         * Reduces register pressure by splitting the live ranges of locals live together with the locals which could
+         * not be assigned a register at the block boundaries, if the local is cheap to recalculate. Instead of keeping
+         * the local live across blocks, its value is rematerialized in every other block reading it.
+         *
+         * Only locals with a single unconditional writer are rematerialized, if the recalculation is cheaper than
+         * filling the local from a spill slot (according to the per-instruction costs). The writer can load a constant
+         * value (a literal, small immediate or load of a constant mask), read the element number or QPU number
+         * register or calculate a value from these or other rematerializable locals (e.g. "elem_num * 4"). Any local
+         * input is recalculated too.
+         *
+         * Example:
+         *   %a = loadi 42
+         *   %b = elem_num
+         *   [...]
+         *   label: %loop
+         *   %c = add %a, %b
+         *
+         * is converted to:
+         *   %a = loadi 42
+         *   %b = elem_num
+         *   [...]
+         *   label: %loop
+         *   %a.remat = loadi 42
+         *   %b.remat = elem_num
+         *   %c = add %a.remat, %b.remat
+         *
+         * Returns whether at least one local was rematerialized and therefore the instructions and livenesses changed.
+         */
+        FixupResult splitLiveRanges(Method& method, const Configuration& config, const GraphColoring& coloredGraph);
+
+        /**
+         * Reduces register pressure by re-reading long-living locals loaded from UNIFORMs (e.g. kernel parameters)
+         * from the UNIFORM stream before every use outside of the first block, instead of keeping them in a register.
+         *
+         * Re-reading a UNIFORM only requires resetting the UNIFORM pointer to the address of the UNIFORM. Thus, this
+         * requires the UNIFORM address (as passed for the work-group loop) to be kept in a register, and all UNIFORMs
+         * to be read at the beginning of the kernel without the UNIFORM pointer being reset afterwards.
+         *
+         * Example:
+         *   %in = reg uniform
+         *   [...]
+         *   %uniform_address = reg uniform
+         *   [...]
+         *   %in_addr = add %in, %offset
+         *
+         * is converted to:
+         *   %in = reg uniform
+         *   [...]
+         *   %uniform_address = reg uniform
+         *   [...]
+         *   %uniform_offset = loadi 8
+         *   unif_addr = add %uniform_address, %uniform_offset
+         *   nop
+         *   nop
+         *   %in.reread = reg uniform
+         *   %in_addr = add %in.reread, %offset
+         *
+         * Returns whether at least one local is re-read and therefore the instructions and livenesses changed.
+         */
+        FixupResult rematerializeUniforms(
+            Method& method, const Configuration& config, const GraphColoring& coloredGraph);
+
+        /**
+         * Spills locals live together with the locals which could not be assigned a register into VPM.
+         *
+         * Every spilled local gets its own VPM area with a row per QPU (indexed by the QPU number), so the spilling
+         * and filling only requires a plain VPM write/read without any DMA transfer or locking of the hardware mutex.
+         * The locals to be spilled are selected by their distance between uses (the number of instructions the local
+         * is live divided by its number of accesses), preferring locals not accessed inside of loops.
+         *
+         * Example:
+         *   %a = add %b, %c
+         *   [...]
+         *   %d = fmul %a, %e
+         *
+         * is converted to:
+         *   %a = add %b, %c
+         *   %spill_setup = loadi <VPW setup>
+         *   vpw_setup = add %spill_setup, qpu_num
+         *   vpm = %a
+         *   [...]
+         *   %fill_setup = loadi <VPR setup>
+         *   vpr_setup = add %fill_setup, qpu_num
+         *   %a.fill = vpm
+         *   %d = fmul %a.fill, %e
+         *
+         * NOTE: Locals written conditionally, with a too small distance between uses or accessed within a VPM access
+         * sequence are not spilled.
+         *
+         * Returns whether at least one local was spilled and therefore the instructions and livenesses changed.
+         */
+        FixupResult spillLocals(Method& method, const Configuration& config, const GraphColoring& coloredGraph);
     } // namespace qpu_asm
 
 } // namespace vc4c
@@ -385,6 +385,8 @@ BasicBlock& intermediate::insertLoop(
     auto loopLabel = method.addNewLocal(TYPE_LABEL, label);
     auto preheaderLabel = method.addNewLocal(TYPE_LABEL, loopLabel.local()->name, "preheader");
     auto afterLoopLabel = method.addNewLocal(TYPE_LABEL, loopLabel.local()->name, "after");
+    // inserting the loop blocks moves all following instructions (and branches) multiple times
+    ModificationBatch batch(method);
 
     auto preheaderIt = method.emplaceLabel(it, new BranchLabel(*preheaderLabel.local()));
     preheaderIt.nextInBlock();
@@ -405,6 +407,7 @@ BasicBlock& intermediate::insertLoop(
     inLoopIt.nextInBlock();
 
     it = method.emplaceLabel(inLoopIt, new BranchLabel(*afterLoopLabel.local()));
+    batch.commit();
     return *inLoopIt.getBasicBlock();
 }
 
@@ -422,6 +425,23 @@ std::pair<InstructionWalker, BranchCond> intermediate::insertBranchCondition(Met
     if(conditionalElements == 0x1)
         // default case for simple jump on 0th element
         assign(it, NOP_REGISTER) = (ELEMENT_NUMBER_REGISTER | conditionValue, SetFlag::SET_FLAGS);
+    else if(!branchOnAllElements)
+    {
+        // set any not used vector-element to zero, so only the selected elements can take the branch
+        if(conditionalElements.all())
+            assign(it, NOP_REGISTER) = (conditionValue, SetFlag::SET_FLAGS);
+        else
+        {
+            auto elementMask = it.getBasicBlock()->getMethod().addNewLocal(TYPE_INT32.toVectorType(16));
+            auto mask = static_cast<uint32_t>(conditionalElements.to_ulong());
+            // the signed per-element load writes -1 (all bits set) for elements with both the low and high bit set
+            it.emplace(new intermediate::LoadImmediate(
+                elementMask, mask | (mask << 16u), intermediate::LoadType::PER_ELEMENT_SIGNED));
+            it.nextInBlock();
+            assign(it, NOP_REGISTER) = (elementMask & conditionValue, SetFlag::SET_FLAGS);
+        }
+        return std::make_pair(it, BRANCH_ANY_Z_CLEAR);
+    }
     else
     {
         // more special case for jump on different element(s)
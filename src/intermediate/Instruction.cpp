@@ -8,6 +8,8 @@
 #include "IntermediateInstruction.h"
 #include "log.h"
 
+#include <typeinfo>
+
 using namespace vc4c;
 using namespace vc4c::intermediate;
 
@@ -67,6 +69,8 @@ std::string intermediate::toString(const InstructionDecorations decoration)
         res.append("invariant ");
     if(has_flag(decoration, InstructionDecorations::WORK_GROUP_LOOP))
         res.append("wg_loop ");
+    if(has_flag(decoration, InstructionDecorations::WORK_GROUP_BARRIER))
+        res.append("wg_barrier ");
     return res.substr(0, res.empty() ? 0 : res.size() - 1);
 }
 LCOV_EXCL_STOP
@@ -155,6 +159,26 @@ bool IntermediateInstruction::operator==(const IntermediateInstruction& other) c
     return innerEquals(other);
 }
 
+std::size_t IntermediateInstruction::getFingerprint() const noexcept
+{
+    std::size_t fingerprint = std::hash<const IntermediateInstruction*>{}(this);
+    auto combine = [&](std::size_t value) { fingerprint = fingerprint * 31 + value; };
+    combine(typeid(*this).hash_code());
+    combine(signal.value);
+    combine(unpackMode.value);
+    combine(packMode.value);
+    combine(conditional.value);
+    combine(static_cast<std::size_t>(setFlags));
+    combine(static_cast<std::size_t>(decoration));
+    if(output)
+        combine(std::hash<Value>{}(*output));
+    for(const auto& arg : arguments)
+        combine(std::hash<Value>{}(arg));
+    if(auto op = dynamic_cast<const Operation*>(this))
+        combine(std::hash<const void*>{}(op->op.name));
+    return fingerprint;
+}
+
 bool IntermediateInstruction::mapsToASMInstruction() const
 {
     return true;
@@ -211,7 +235,7 @@ Optional<Value> IntermediateInstruction::findOtherArgument(const Value& val) con
     return NO_VALUE;
 }
 
-const std::vector<Value>& IntermediateInstruction::getArguments() const
+const tools::SmallVector<Value, 2>& IntermediateInstruction::getArguments() const
 {
     return arguments;
 }
@@ -9,6 +9,7 @@
 
 #include "../Method.h"
 #include "../asm/OpCodes.h"
+#include "../tools/SmallVector.h"
 #include "CompilationError.h"
 #include "Optional.h"
 
@@ -87,7 +88,10 @@ namespace vc4c
             // nested loop might not be invariant for its parent loop!
             LOOP_INVARIANT = 1u << 24u,
             // The instruction is part of the work-group-loop and not of the actual kernel body
-            WORK_GROUP_LOOP = 1u << 25u
+            WORK_GROUP_LOOP = 1u << 25u,
+            // The instruction synchronizes the work-items of a work-group as part of a work-group barrier, e.g. the
+            // semaphore adjustments of the barrier() function
+            WORK_GROUP_BARRIER = 1u << 26u
         };
 
         std::string toString(InstructionDecorations decoration);
@@ -137,7 +141,7 @@ namespace vc4c
          * Converted to QPU instructions,
          * but still with method-calls and typed locals
          */
-        class IntermediateInstruction
+        class IntermediateInstruction : public tools::PooledObject<profiler::MemoryCategory::INSTRUCTIONS>
         {
         public:
             IntermediateInstruction(const IntermediateInstruction&) = delete;
@@ -153,6 +157,14 @@ namespace vc4c
                 return !(*this == other);
             }
 
+            /*
+             * Returns a hash value over the position, type, operands and modifiers of this instruction.
+             *
+             * This can be used to cheaply detect whether an instruction was replaced or modified in-place. Of the
+             * type-specific members, only the op-code of operations is included.
+             */
+            std::size_t getFingerprint() const noexcept;
+
             virtual FastMap<const Local*, LocalUse::Type> getUsedLocals() const;
             virtual void forUsedLocals(
                 const std::function<void(const Local*, LocalUse::Type, const IntermediateInstruction&)>& consumer)
@@ -261,7 +273,7 @@ namespace vc4c
             /*
              * Lists all arguments/operands
              */
-            const std::vector<Value>& getArguments() const;
+            const tools::SmallVector<Value, 2>& getArguments() const;
             /**
              * Returns the other input value if the instruction takes exactly 2 input arguments and one of them is the
              * given value
@@ -360,7 +372,11 @@ namespace vc4c
 
         private:
             Optional<Value> output;
-            std::vector<Value> arguments;
+            /*
+             * Most instructions have at most two operands, so store them inline to not require an additional heap
+             * allocation per instruction
+             */
+            tools::SmallVector<Value, 2> arguments;
 
             void removeAsUserFromValue(const Value& value, LocalUse::Type type);
             void addAsUserToValue(const Value& value, LocalUse::Type type);
@@ -662,7 +678,10 @@ namespace vc4c
             WAIT_UNIFORM,
             // waiting for a VPM operation (DMA read/write or VPM read) to finish. These types of nops can be removed,
             // after they are replaced
-            WAIT_VPM
+            WAIT_VPM,
+            // delay-slots after a thread switch signal. Nothing may be moved over the thread switch, since the
+            // accumulators are not preserved
+            THREAD_SWITCH
         };
 
         struct Nop final : public SignalingInstruction
@@ -739,6 +739,8 @@ static std::string toTypeString(DelayType delay)
         return "uniform_address";
     case DelayType::WAIT_VPM:
         return "vpm_dma";
+    case DelayType::THREAD_SWITCH:
+        return "thread_switch";
     }
     throw CompilationError(
         CompilationStep::GENERAL, "Invalid nop delay type", std::to_string(static_cast<unsigned>(delay)));
@@ -749,7 +751,7 @@ Nop::Nop(const DelayType type, const Signaling signal) : SignalingInstruction(si
 {
     // add mandatory-delay marker for delays which cannot be removed
     if(type == DelayType::BRANCH_DELAY || type == DelayType::WAIT_REGISTER || type == DelayType::WAIT_SFU ||
-        type == DelayType::WAIT_UNIFORM)
+        type == DelayType::WAIT_UNIFORM || type == DelayType::THREAD_SWITCH)
         decoration = InstructionDecorations::MANDATORY_DELAY;
 }
 
@@ -503,6 +503,25 @@ InstructionWalker intermediate::insertFloatToIntegerSaturation(
     auto minFloat = Value(Literal(static_cast<float>(minInt)), TYPE_FLOAT);
     auto minInteger = Value(Literal(minInt), dest.type);
 
+    if(maxInt <= 0xFFFFFF && minInt >= -0xFFFFFF)
+    {
+        // the bounds are exactly representable as float, so the value can be clamped before the conversion. Since
+        // fmin/fmax treat NaN as larger than Inf, this gives the same results as the comparisons below.
+        if(minInt == 0 && maxInt == std::numeric_limits<uint8_t>::max())
+        {
+            // negative values (including the zero returned by ftoi for out-of-range values) are saturated by the
+            // pack-mode -> dest = ftoi(fmin(src, 255)) (pack 8a saturate)
+            auto tmp = assign(it, src.type, "%sat_clamp") = min(as_float{src}, as_float{maxFloat});
+            it.emplace((new Operation(OP_FTOI, dest, tmp))->setPackMode(PACK_INT_TO_UNSIGNED_CHAR_SATURATE));
+            return it.nextInBlock();
+        }
+        // dest = ftoi(fmin(fmax(src, min), max))
+        auto tmp = assign(it, src.type, "%sat_clamp") = max(as_float{src}, as_float{minFloat});
+        tmp = assign(it, src.type, "%sat_clamp") = min(as_float{tmp}, as_float{maxFloat});
+        it.emplace(new Operation(OP_FTOI, dest, tmp));
+        return it.nextInBlock();
+    }
+
     // default -> dest = ftoi(src)
     it.emplace((new Operation(OP_FTOI, dest, src)));
     it.nextInBlock();
@@ -10,6 +10,7 @@
 #include "log.h"
 #include "operators.h"
 
+#include <algorithm>
 #include <map>
 #include <sstream>
 
@@ -385,14 +386,24 @@ InstructionWalker intermediate::insertVectorShuffle(InstructionWalker it, Method
         }
         return it;
     }
-    if(auto elem = maskContainer.getAllSame())
+    // if all (defined) indices are the same, replicate this index over the vector
+    Optional<Literal> singleIndex;
+    bool isSingleIndex = true;
+    for(const auto& index : maskContainer)
     {
-        const int32_t indexValue = elem->signedInt() < static_cast<int32_t>(source0.type.getVectorWidth()) ?
-            elem->signedInt() :
-            elem->signedInt() - static_cast<int32_t>(source0.type.getVectorWidth());
+        if(index.isUndefined())
+            continue;
+        if(singleIndex && *singleIndex != index)
+            isSingleIndex = false;
+        singleIndex = index;
+    }
+    if(singleIndex && isSingleIndex)
+    {
+        const int32_t indexValue = singleIndex->signedInt() < static_cast<int32_t>(source0.type.getVectorWidth()) ?
+            singleIndex->signedInt() :
+            singleIndex->signedInt() - static_cast<int32_t>(source0.type.getVectorWidth());
         const Value source =
-            elem->signedInt() < static_cast<int32_t>(source0.type.getVectorWidth()) ? source0 : source1;
-        // if all indices same, replicate
+            singleIndex->signedInt() < static_cast<int32_t>(source0.type.getVectorWidth()) ? source0 : source1;
         Value tmp(UNDEFINED_VALUE);
         if(indexValue == 0)
             tmp = source;
@@ -406,25 +417,6 @@ InstructionWalker intermediate::insertVectorShuffle(InstructionWalker it, Method
         return insertReplication(it, tmp, destination);
     }
 
-    // copy source(s) into destination
-    // this allows us to skip extracting and inserting values from/to same index
-    // also required so register allocator finds unconditional write to destination
-    uint8_t numCorrespondingIndices = 0;
-    if(destination.checkLocal() && destination.local()->getUsers(LocalUse::Type::WRITER).empty())
-    {
-        if(isSingleSource || source0.type.getVectorWidth() + source1.type.getVectorWidth() > NATIVE_VECTOR_SIZE)
-        {
-            assign(it, destination) = source0;
-            numCorrespondingIndices = source0.type.getVectorWidth();
-        }
-        else
-        {
-            it = insertVectorConcatenation(it, method, source0, source1, destination);
-            numCorrespondingIndices =
-                static_cast<uint8_t>(source0.type.getVectorWidth() + source1.type.getVectorWidth());
-        }
-    }
-
     // mask is container of literals, indices have arbitrary order
     // For optimization, find combinations of elements to rotate together (same offset) from the same source vector
     std::map<std::pair<uint8_t, uint8_t>, std::bitset<32>> relativeSources;
@@ -432,10 +424,7 @@ InstructionWalker intermediate::insertVectorShuffle(InstructionWalker it, Method
     {
         auto firstVectorSize = source0.type.getVectorWidth();
         if(maskContainer[i].isUndefined())
-            // don't write anything at this position
-            continue;
-        if(maskContainer[i].unsignedInt() == i && i < numCorrespondingIndices)
-            // copies same element from and to same position, already done above
+            // don't care which value is written at this position
             continue;
         auto source = (maskContainer[i].unsignedInt() >= firstVectorSize) ?
             // source is from second vector
@@ -444,43 +433,92 @@ InstructionWalker intermediate::insertVectorShuffle(InstructionWalker it, Method
             std::make_pair(rotateElementNumberDown(maskContainer[i].unsignedInt(), i), 0);
         relativeSources[source] |= (1u << i);
     }
+    if(relativeSources.empty())
+    {
+        // all elements are undefined, but the register allocator requires an unconditional write to the destination
+        assign(it, destination) = source0;
+        return it;
+    }
 
-    for(const auto& sources : relativeSources)
+    /*
+     * Every combination of source vector and rotation offset requires its own rotation, so the costs only differ in
+     * how the rotated vectors are combined:
+     * - The combination covering the most elements is rotated directly into the destination. Since this write is
+     *   unconditional, it also fills all undefined elements and satisfies the register allocator.
+     * - All other combinations are rotated into temporaries and conditionally moved into the destination. The flags
+     *   selecting the elements of two such combinations are set at once by a signed per-element load, which results in
+     *   zero for the elements of the first, negative values for the elements of the second and positive values for all
+     *   other elements.
+     */
+    auto baseIt = std::max_element(relativeSources.begin(), relativeSources.end(),
+        [](const std::pair<const std::pair<uint8_t, uint8_t>, std::bitset<32>>& one,
+            const std::pair<const std::pair<uint8_t, uint8_t>, std::bitset<32>>& other) -> bool {
+            return one.second.count() < other.second.count();
+        });
+    it = insertVectorRotation(it, baseIt->first.second == 0 ? source0 : source1,
+        Value(Literal(baseIt->first.first), TYPE_INT8), destination, Direction::DOWN);
+    relativeSources.erase(baseIt);
+
+    auto rotateSource = [&](const std::pair<uint8_t, uint8_t>& source) -> Value {
+        auto tmp = method.addNewLocal(destination.type, "%vector_shuffle");
+        it = insertVectorRotation(it, source.second == 0 ? source0 : source1, Value(Literal(source.first), TYPE_INT8),
+            tmp, Direction::DOWN);
+        return tmp;
+    };
+
+    auto sourceIt = relativeSources.begin();
+    while(sourceIt != relativeSources.end())
     {
-        const Value& src = sources.first.second == 0 ? source0 : source1;
-        if(sources.second.count() == destination.type.getVectorWidth())
+        auto nextIt = std::next(sourceIt);
+        if(nextIt != relativeSources.end())
         {
-            it = insertVectorRotation(
-                it, src, Value(Literal(sources.first.first), TYPE_INT8), destination, Direction::DOWN);
-        }
-        else
-        {
-            auto tmp = method.addNewLocal(destination.type, "%vector_shuffle");
-            // rotate source vector by the given offset
-            it = insertVectorRotation(it, src, Value(Literal(sources.first.first), TYPE_INT8), tmp, Direction::DOWN);
-            // set flags only for the selected elements
-            ConditionCode cond = COND_NEVER;
-            if(sources.second.count() == 1)
-            {
-                // for cosmetic purposes (and possible combination with other instructions), mask single elements via
-                // xoring small immediates
-                assign(it, NOP_REGISTER) = (ELEMENT_NUMBER_REGISTER ^
-                        Value(Literal(toLowestIndex(static_cast<uint32_t>(sources.second.to_ulong()))), TYPE_INT8),
-                    SetFlag::SET_FLAGS);
-                cond = COND_ZERO_SET;
-            }
-            else
+            auto zeroElements = sourceIt->second;
+            auto negativeElements = nextIt->second;
+            auto zeroTmp = rotateSource(sourceIt->first);
+            auto negativeTmp = rotateSource(nextIt->first);
+            SIMDVector selection(Literal(1));
+            for(uint8_t i = 0; i < selection.size(); ++i)
             {
-                it.emplace((new LoadImmediate(NOP_REGISTER, static_cast<uint32_t>(sources.second.to_ulong()),
-                                LoadType::PER_ELEMENT_UNSIGNED))
-                               ->setSetFlags(SetFlag::SET_FLAGS));
-                it.nextInBlock();
-                cond = COND_ZERO_CLEAR;
+                if(zeroElements.test(i))
+                    selection[i] = Literal(0);
+                else if(negativeElements.test(i))
+                    selection[i] = Literal(-1);
             }
+            it.emplace((new LoadImmediate(NOP_REGISTER,
+                            LoadImmediate::fromLoadedValues(selection, LoadType::PER_ELEMENT_SIGNED),
+                            LoadType::PER_ELEMENT_SIGNED))
+                           ->setSetFlags(SetFlag::SET_FLAGS));
+            it.nextInBlock();
+            assign(it, destination) = (zeroTmp, COND_ZERO_SET);
+            assign(it, destination) = (negativeTmp, COND_NEGATIVE_SET);
+            sourceIt = std::next(nextIt);
+            continue;
+        }
 
-            // copy into destination only for the selected flags
-            assign(it, destination) = (tmp, cond);
+        auto tmp = rotateSource(sourceIt->first);
+        // set flags only for the selected elements
+        ConditionCode cond = COND_NEVER;
+        if(sourceIt->second.count() == 1)
+        {
+            // for cosmetic purposes (and possible combination with other instructions), mask single elements via
+            // xoring small immediates
+            assign(it, NOP_REGISTER) = (ELEMENT_NUMBER_REGISTER ^
+                    Value(Literal(toLowestIndex(static_cast<uint32_t>(sourceIt->second.to_ulong()))), TYPE_INT8),
+                SetFlag::SET_FLAGS);
+            cond = COND_ZERO_SET;
         }
+        else
+        {
+            it.emplace((new LoadImmediate(NOP_REGISTER, static_cast<uint32_t>(sourceIt->second.to_ulong()),
+                            LoadType::PER_ELEMENT_UNSIGNED))
+                           ->setSetFlags(SetFlag::SET_FLAGS));
+            it.nextInBlock();
+            cond = COND_ZERO_CLEAR;
+        }
+
+        // copy into destination only for the selected flags
+        assign(it, destination) = (tmp, cond);
+        ++sourceIt;
     }
     return it;
 }
@@ -1010,3 +1048,134 @@ InstructionWalker intermediate::insertFoldVector(InstructionWalker it, Method& m
     // 3. move result to dest
     return it.emplace(new MoveOperation(dest, tmpResult));
 }
+
+static void checkCrossLaneOperation(const OpCode& op, bool needsCommutative)
+{
+    if(op.numOperands != 2 || op.acceptsFloat != op.returnsFloat || !op.isAssociative() ||
+        (needsCommutative && !op.isCommutative()))
+        throw CompilationError(CompilationStep::GENERAL, "Invalid operation to combine vector elements", op.name);
+}
+
+InstructionWalker intermediate::insertVectorReduction(InstructionWalker it, Method& method, const Value& dest,
+    const Value& src, OpCode reductionOp, InstructionDecorations decorations)
+{
+    checkCrossLaneOperation(reductionOp, true);
+    if(!isPowerTwo(src.type.getVectorWidth()))
+        throw CompilationError(
+            CompilationStep::GENERAL, "Reducing vectors non-power of two is not yet implemented", src.to_string());
+
+    if(src.type.getVectorWidth() != NATIVE_VECTOR_SIZE)
+    {
+        // the rotations wrap around the 16 SIMD elements, so we can only fold the used elements and replicate the
+        // scalar result
+        auto scalar = method.addNewLocal(src.type.getElementType(), "%vector_reduce");
+        it = insertFoldVector(it, method, scalar, src, reductionOp, decorations);
+        it.nextInBlock();
+        return insertReplication(it, scalar, dest);
+    }
+
+    /*
+     * Since all 16 elements are used, combining every element with the element rotated by half the remaining
+     * distance leaves the combination of all elements in every element:
+     *
+     *    | in[0] . in[1] . ... . in[7] . in[8] . ... . in[F] |
+     * op | in[8] . in[9] . ... . in[F] . in[0] . ... . in[7] |
+     * =  | tm[0] . tm[1] . ... . tm[7] . tm[0] . ... . tm[7] |
+     * [...]
+     */
+    auto tmpResult = src;
+    for(uint8_t distance = NATIVE_VECTOR_SIZE / 2; distance > 0; distance /= 2)
+    {
+        auto rotated = method.addNewLocal(src.type, "%vector_reduce.rotated");
+        auto newTmpResult = method.addNewLocal(src.type, "%vector_reduce");
+        it = insertVectorRotation(it, tmpResult, Value(Literal(distance), TYPE_INT8), rotated, Direction::DOWN);
+        it.emplace(new Operation(reductionOp, newTmpResult, tmpResult, rotated));
+        it->addDecorations(decorations);
+        it.nextInBlock();
+        tmpResult = newTmpResult;
+    }
+    assign(it, dest) = tmpResult;
+    return it;
+}
+
+InstructionWalker intermediate::insertVectorScan(InstructionWalker it, Method& method, const Value& dest,
+    const Value& src, OpCode scanOp, bool inclusive, InstructionDecorations decorations)
+{
+    checkCrossLaneOperation(scanOp, false);
+    auto tmpResult = src;
+    if(!inclusive)
+    {
+        // shift all elements up by one and insert the identity into the first element
+        auto identity = OpCode::getLeftIdentity(scanOp);
+        if(!identity)
+            throw CompilationError(
+                CompilationStep::GENERAL, "Exclusive scan requires an operation with an identity", scanOp.name);
+        auto shifted = method.addNewLocal(src.type, "%vector_scan.shifted");
+        it = insertVectorRotation(it, src, INT_ONE, shifted, Direction::UP);
+        auto cond = assignNop(it) = selectSIMDElement(0);
+        assign(it, shifted) = (*identity, cond);
+        tmpResult = shifted;
+    }
+
+    for(uint8_t distance = 1; distance < src.type.getVectorWidth(); distance *= 2)
+    {
+        auto rotated = method.addNewLocal(src.type, "%vector_scan.rotated");
+        auto newTmpResult = method.addNewLocal(src.type, "%vector_scan");
+        it = insertVectorRotation(it, tmpResult, Value(Literal(distance), TYPE_INT8), rotated, Direction::UP);
+        // the elements below the distance have no element to combine with and keep their previous value
+        auto cond = assignNop(it) =
+            as_signed{ELEMENT_NUMBER_REGISTER} < as_signed{Value(Literal(distance), TYPE_INT8)};
+        it.emplace(new Operation(scanOp, newTmpResult, rotated, tmpResult));
+        it->addDecorations(decorations);
+        it.nextInBlock();
+        assign(it, newTmpResult) = (tmpResult, cond);
+        tmpResult = newTmpResult;
+    }
+    assign(it, dest) = tmpResult;
+    return it;
+}
+
+bool intermediate::isSplitStructType(const DataType& type)
+{
+    auto structType = type.getStructType();
+    if(!structType || structType->elementTypes.empty() || structType->elementTypes.size() > NATIVE_VECTOR_SIZE)
+        return false;
+    return std::all_of(structType->elementTypes.begin(), structType->elementTypes.end(), [](const DataType& member) {
+        return (member.isScalarType() || member.getPointerType()) && member.getScalarBitCount() <= 32;
+    });
+}
+
+Value intermediate::getSplitStructMember(Method& method, const Value& structValue, unsigned index)
+{
+    const auto& memberTypes = structValue.type.getStructType()->elementTypes;
+    if(index >= memberTypes.size())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Struct member index is out of bounds", structValue.to_string(false, true));
+    if(structValue.isUndefined())
+        return Value(memberTypes[index]);
+    if(auto loc = structValue.checkLocal())
+        return method.createLocal(memberTypes[index], loc->name + ".member." + std::to_string(index))
+            ->createReference();
+    throw CompilationError(CompilationStep::GENERAL, "Unhandled struct value", structValue.to_string(false, true));
+}
+
+InstructionWalker intermediate::insertStructExtraction(
+    InstructionWalker it, Method& method, const Value& container, unsigned index, const Value& dest)
+{
+    assign(it, dest) = getSplitStructMember(method, container, index);
+    return it;
+}
+
+InstructionWalker intermediate::insertStructInsertion(InstructionWalker it, Method& method, const Value& dest,
+    const Value& container, unsigned index, const Value& value)
+{
+    const auto numMembers = static_cast<unsigned>(dest.type.getStructType()->elementTypes.size());
+    for(unsigned i = 0; i < numMembers; ++i)
+    {
+        auto member = i == index ? value : getSplitStructMember(method, container, i);
+        // undefined members do not need to be copied
+        if(!member.isUndefined())
+            assign(it, getSplitStructMember(method, dest, i)) = member;
+    }
+    return it;
+}
@@ -126,6 +126,83 @@ namespace vc4c
         NODISCARD InstructionWalker insertFoldVector(InstructionWalker it, Method& method, const Value& dest,
             const Value& src, OpCode foldingOp, InstructionDecorations decorations = InstructionDecorations::NONE);
 
+        /**
+         * Inserts operations to reduce all elements of the given input vector with the given associative and
+         * commutative binary operation and replicates the result into all elements of the output value.
+         *
+         * For full 16-element vectors, this is done in log2(16) steps by combining every element with the element
+         * rotated by 8, 4, 2 and 1 positions (butterfly), which leaves the result in every SIMD element. Smaller
+         * vectors are folded (see #insertFoldVector) and the scalar result is replicated afterwards.
+         *
+         * Example (int16 -> int16):
+         *   %tmp.8 = %src rotated down by 8
+         *   %tmp = add %src, %tmp.8
+         *   %tmp.4 = %tmp rotated down by 4
+         *   %tmp = add %tmp, %tmp.4
+         *   [...]
+         *   %dest = %tmp
+         */
+        NODISCARD InstructionWalker insertVectorReduction(InstructionWalker it, Method& method, const Value& dest,
+            const Value& src, OpCode reductionOp, InstructionDecorations decorations = InstructionDecorations::NONE);
+
+        /**
+         * Inserts operations to calculate the prefix-scan (e.g. the prefix-sum) of the elements of the given input
+         * vector with the given associative binary operation.
+         *
+         * The scan is calculated in log2(N) steps, where in every step i, every element j >= 2^i is combined with the
+         * element j - 2^i (Hillis-Steele scan). For an inclusive scan, element j of the result contains the combination
+         * of the input elements 0 to j, for an exclusive scan the elements 0 to j - 1, where the first element is set
+         * to the identity of the operation.
+         *
+         * Example (int4, inclusive):
+         *   %tmp.1 = %src rotated up by 1
+         *   - = sub.setf elem_num, 1
+         *   %tmp = add %tmp.1, %src
+         *   %tmp = %src (ifn)
+         *   %tmp.2 = %tmp rotated up by 2
+         *   - = sub.setf elem_num, 2
+         *   %dest = add %tmp.2, %tmp
+         *   %dest = %tmp (ifn)
+         */
+        NODISCARD InstructionWalker insertVectorScan(InstructionWalker it, Method& method, const Value& dest,
+            const Value& src, OpCode scanOp, bool inclusive,
+            InstructionDecorations decorations = InstructionDecorations::NONE);
+
+        /**
+         * Returns whether values of the given (non-pointer) struct type are kept in a separate local per struct member
+         * for their whole life-time, i.e. whether the struct has at most 16 members which all are scalars of at most
+         * 32 bit.
+         */
+        bool isSplitStructType(const DataType& type);
+
+        /**
+         * Returns the value of the member at the given index of the struct value split into separate locals (see
+         * #isSplitStructType), i.e. the local "<struct>.member.<index>". For an undefined struct value, an undefined
+         * value of the member type is returned.
+         */
+        Value getSplitStructMember(Method& method, const Value& structValue, unsigned index);
+
+        /**
+         * Inserts the extraction of the member at the given index of the struct value split into separate locals (see
+         * #isSplitStructType), which is a simple move of the member local.
+         *
+         * Example:
+         *   %dest = %container.member.1
+         */
+        NODISCARD InstructionWalker insertStructExtraction(
+            InstructionWalker it, Method& method, const Value& container, unsigned index, const Value& dest);
+
+        /**
+         * Inserts the insertion of the given value as member at the given index into the struct value split into
+         * separate locals (see #isSplitStructType), which copies all other (defined) members of the container.
+         *
+         * Example:
+         *   %dest.member.0 = %container.member.0
+         *   %dest.member.1 = %value
+         */
+        NODISCARD InstructionWalker insertStructInsertion(InstructionWalker it, Method& method, const Value& dest,
+            const Value& container, unsigned index, const Value& value);
+
     } // namespace intermediate
 } // namespace vc4c
 
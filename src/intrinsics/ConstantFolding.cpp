@@ -0,0 +1,354 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "ConstantFolding.h"
+
+#include "../SIMDVector.h"
+#include "../asm/OpCodes.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "Operators.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+using namespace vc4c;
+using namespace vc4c::intermediate;
+
+static constexpr uint32_t UNDEFINED_INDEX = 0xFFFFFFFF;
+
+static uint32_t truncateTo(uint32_t val, unsigned numBits)
+{
+    return numBits >= 32 ? val : val & ((1u << numBits) - 1u);
+}
+
+static int32_t signExtendFrom(uint32_t val, unsigned numBits)
+{
+    if(numBits >= 32 || numBits == 0)
+        return static_cast<int32_t>(val);
+    auto shift = 32u - numBits;
+    return static_cast<int32_t>(val << shift) >> shift;
+}
+
+static unsigned getBitWidth(DataType type)
+{
+    return type.getPointerType() ? 32u : type.getScalarBitCount();
+}
+
+using ScalarFunction = std::function<Optional<Literal>(Literal, Literal, DataType, DataType)>;
+
+/*
+ * Applies the given function to the scalar operands or to all pairs of elements of aggregate operands
+ */
+static Optional<CompoundConstant> foldElementWise(DataType resultType, const CompoundConstant& first,
+    const Optional<CompoundConstant>& second, const ScalarFunction& func)
+{
+    if(auto firstScalar = first.getScalar())
+    {
+        Literal secondScalar = UNDEFINED_LITERAL;
+        if(second)
+        {
+            if(auto tmp = second->getScalar())
+                secondScalar = *tmp;
+            else
+                return {};
+        }
+        if(auto result = func(*firstScalar, secondScalar, first.type, resultType))
+            return CompoundConstant(resultType, *result);
+        return {};
+    }
+    auto firstElements = first.getCompound();
+    if(!firstElements || !(resultType.isVectorType() || resultType.getArrayType()))
+        return {};
+    Optional<std::vector<CompoundConstant>> secondElements;
+    if(second)
+    {
+        secondElements = second->getCompound();
+        if(!secondElements || secondElements->size() != firstElements->size())
+            return {};
+    }
+    auto elementType = resultType.getElementType();
+    std::vector<CompoundConstant> elements;
+    elements.reserve(firstElements->size());
+    for(std::size_t i = 0; i < firstElements->size(); ++i)
+    {
+        auto element = foldElementWise(elementType, (*firstElements)[i],
+            secondElements ? Optional<CompoundConstant>((*secondElements)[i]) : Optional<CompoundConstant>{}, func);
+        if(!element)
+            return {};
+        elements.emplace_back(std::move(element.value()));
+    }
+    return CompoundConstant(resultType, std::move(elements));
+}
+
+static Optional<Literal> foldScalarOperation(
+    const std::string& operation, Literal first, Literal second, DataType sourceType, DataType resultType)
+{
+    const auto sourceBits = getBitWidth(sourceType);
+    const auto resultBits = getBitWidth(resultType);
+
+    // integer arithmetic (calculated as unsigned to wrap around on overflow like the hardware does)
+    if(operation == "add")
+        return Literal(first.unsignedInt() + second.unsignedInt());
+    if(operation == "sub")
+        return Literal(first.unsignedInt() - second.unsignedInt());
+    if(operation == "mul")
+        return Literal(first.unsignedInt() * second.unsignedInt());
+    if(operation == "udiv" || operation == "urem" || operation == "umod")
+    {
+        auto divisor = truncateTo(second.unsignedInt(), sourceBits);
+        if(divisor == 0)
+            return {};
+        auto dividend = truncateTo(first.unsignedInt(), sourceBits);
+        return Literal(operation == "udiv" ? dividend / divisor : dividend % divisor);
+    }
+    if(operation == "sdiv" || operation == "srem" || operation == "smod")
+    {
+        auto divisor = signExtendFrom(second.unsignedInt(), sourceBits);
+        auto dividend = signExtendFrom(first.unsignedInt(), sourceBits);
+        if(divisor == 0 || (dividend == std::numeric_limits<int32_t>::min() && divisor == -1))
+            return {};
+        if(operation == "sdiv")
+            return Literal(dividend / divisor);
+        return operation == "srem" ? intrinsics::srem(sourceType, Literal(dividend), Literal(divisor)) :
+                                     intrinsics::smod(sourceType, Literal(dividend), Literal(divisor));
+    }
+    if(operation == "negate" || operation == "fneg")
+        return sourceType.isFloatingType() ? Literal(-first.real()) : Literal(0u - first.unsignedInt());
+
+    // floating-point arithmetic
+    if(operation == "fadd")
+        return Literal(first.real() + second.real());
+    if(operation == "fsub")
+        return Literal(first.real() - second.real());
+    if(operation == "fmul")
+        return Literal(first.real() * second.real());
+    if(operation == "fdiv")
+        return Literal(first.real() / second.real());
+    if(operation == "frem")
+        return intrinsics::frem(sourceType, first, second);
+    if(operation == "fmod")
+        return intrinsics::fmod(sourceType, first, second);
+
+    // bitwise operations
+    if(operation == "and")
+        return Literal(first.unsignedInt() & second.unsignedInt());
+    if(operation == "or")
+        return Literal(first.unsignedInt() | second.unsignedInt());
+    if(operation == "xor")
+        return Literal(first.unsignedInt() ^ second.unsignedInt());
+    if(operation == "not")
+        return Literal(~first.unsignedInt());
+    // shifts by the type-width or more are undefined, so (like the hardware) only use the lower 5 bits of the offset
+    if(operation == "shl")
+        return Literal(first.unsignedInt() << (second.unsignedInt() & 0x1F));
+    if(operation == "shr" || operation == "lshr")
+        return Literal(truncateTo(first.unsignedInt(), sourceBits) >> (second.unsignedInt() & 0x1F));
+    if(operation == "asr" || operation == "ashr")
+        return intrinsics::asr(Literal(signExtendFrom(first.unsignedInt(), sourceBits)), second);
+
+    // conversions
+    if(operation == "trunc")
+        return Literal(truncateTo(first.unsignedInt(), resultBits));
+    if(operation == "zext")
+        return Literal(truncateTo(first.unsignedInt(), sourceBits));
+    if(operation == "sext")
+        return Literal(signExtendFrom(first.unsignedInt(), sourceBits));
+    if(operation == "fptoui")
+        return first.real() < 0.0f ? Optional<Literal>{} : Literal(static_cast<uint32_t>(first.real()));
+    if(operation == "fptosi")
+        return Literal(static_cast<int32_t>(first.real()));
+    if(operation == "uitofp")
+        return Literal(static_cast<float>(truncateTo(first.unsignedInt(), sourceBits)));
+    if(operation == "sitofp")
+        return Literal(static_cast<float>(signExtendFrom(first.unsignedInt(), sourceBits)));
+    if(operation == "fptrunc" || operation == "fpext")
+        // all floating-point values are stored with the same representation
+        return first;
+    if(operation == "bitcast" || operation == "addrspacecast" || operation == "ptrtoint" || operation == "inttoptr")
+    {
+        if(sourceBits == resultBits)
+            return first;
+        if(operation == "ptrtoint" || operation == "inttoptr")
+            return Literal(truncateTo(first.unsignedInt(), std::min(sourceBits, resultBits)));
+        // bit-casts between different element sizes change the number of elements
+        return {};
+    }
+
+    const OpCode& code = OpCode::findOpCode(operation);
+    if(code == OP_NOP)
+        return {};
+    if(auto result = code(first, second, resultType).first)
+        return result->getLiteralValue();
+    return {};
+}
+
+Optional<CompoundConstant> intrinsics::toCompoundConstant(const Value& val)
+{
+    if(val.isUndefined())
+        return CompoundConstant(val.type, UNDEFINED_LITERAL);
+    if(auto lit = val.getLiteralValue())
+        return CompoundConstant(val.type, *lit);
+    if(auto vector = val.checkVector())
+    {
+        auto elementType = val.type.getElementType();
+        std::vector<CompoundConstant> elements;
+        elements.reserve(val.type.getVectorWidth());
+        for(unsigned i = 0; i < val.type.getVectorWidth(); ++i)
+            elements.emplace_back(elementType, (*vector)[i]);
+        return CompoundConstant(val.type, std::move(elements));
+    }
+    return {};
+}
+
+Optional<CompoundConstant> intrinsics::foldConstantOperation(const std::string& operation, DataType resultType,
+    const CompoundConstant& firstOperand, const Optional<CompoundConstant>& secondOperand)
+{
+    return foldElementWise(resultType, firstOperand, secondOperand,
+        [&](Literal first, Literal second, DataType sourceType, DataType elementType) -> Optional<Literal> {
+            if(first.isUndefined() || (secondOperand && second.isUndefined()))
+                return UNDEFINED_LITERAL;
+            return foldScalarOperation(operation, first, second, sourceType, elementType);
+        });
+}
+
+static Optional<bool> compareScalars(const std::string& comparison, Literal first, Literal second, DataType type)
+{
+    if(comparison == COMP_TRUE)
+        return true;
+    if(comparison == COMP_FALSE)
+        return false;
+    if(type.isFloatingType())
+    {
+        auto a = first.real();
+        auto b = second.real();
+        bool isUnordered = std::isnan(a) || std::isnan(b);
+        if(comparison == COMP_ORDERED)
+            return !isUnordered;
+        if(comparison == COMP_UNORDERED)
+            return isUnordered;
+        // "oxx" comparisons yield false, "uxx" comparisons yield true if any operand is NaN
+        bool isOrdered = comparison[0] == 'o';
+        if(isUnordered && (isOrdered || comparison[0] == 'u'))
+            return !isOrdered;
+        auto predicate = comparison[0] == 'o' || comparison[0] == 'u' ? comparison.substr(1) : comparison;
+        if(predicate == "eq")
+            return a == b;
+        if(predicate == "ne")
+            return a != b;
+        if(predicate == "gt")
+            return a > b;
+        if(predicate == "ge")
+            return a >= b;
+        if(predicate == "lt")
+            return a < b;
+        if(predicate == "le")
+            return a <= b;
+        return {};
+    }
+    const auto numBits = getBitWidth(type);
+    auto ua = truncateTo(first.unsignedInt(), numBits);
+    auto ub = truncateTo(second.unsignedInt(), numBits);
+    auto sa = signExtendFrom(first.unsignedInt(), numBits);
+    auto sb = signExtendFrom(second.unsignedInt(), numBits);
+    if(comparison == COMP_EQ)
+        return ua == ub;
+    if(comparison == COMP_NEQ)
+        return ua != ub;
+    if(comparison == COMP_UNSIGNED_GT)
+        return ua > ub;
+    if(comparison == COMP_UNSIGNED_GE)
+        return ua >= ub;
+    if(comparison == COMP_UNSIGNED_LT)
+        return ua < ub;
+    if(comparison == COMP_UNSIGNED_LE)
+        return ua <= ub;
+    if(comparison == COMP_SIGNED_GT)
+        return sa > sb;
+    if(comparison == COMP_SIGNED_GE)
+        return sa >= sb;
+    if(comparison == COMP_SIGNED_LT)
+        return sa < sb;
+    if(comparison == COMP_SIGNED_LE)
+        return sa <= sb;
+    return {};
+}
+
+Optional<CompoundConstant> intrinsics::foldConstantComparison(const std::string& comparison, DataType resultType,
+    const CompoundConstant& firstOperand, const CompoundConstant& secondOperand)
+{
+    return foldElementWise(resultType, firstOperand, secondOperand,
+        [&](Literal first, Literal second, DataType sourceType, DataType elementType) -> Optional<Literal> {
+            if(first.isUndefined() || second.isUndefined())
+                return UNDEFINED_LITERAL;
+            if(auto result = compareScalars(comparison, first, second, sourceType))
+                return Literal(*result);
+            return {};
+        });
+}
+
+Optional<CompoundConstant> intrinsics::foldConstantShuffle(DataType resultType, const CompoundConstant& firstVector,
+    const CompoundConstant& secondVector, const std::vector<uint32_t>& indices)
+{
+    auto firstElements = firstVector.getCompound();
+    auto secondElements = secondVector.getCompound();
+    if(!firstElements)
+        return {};
+    auto elementType = resultType.getElementType();
+    std::vector<CompoundConstant> elements;
+    elements.reserve(indices.size());
+    for(auto index : indices)
+    {
+        if(index == UNDEFINED_INDEX)
+            elements.emplace_back(elementType, UNDEFINED_LITERAL);
+        else if(index < firstElements->size())
+            elements.emplace_back((*firstElements)[index]);
+        else if(secondElements && (index - firstElements->size()) < secondElements->size())
+            elements.emplace_back((*secondElements)[index - firstElements->size()]);
+        else if(!secondElements && secondVector.isUndefined())
+            // the second vector is a single undefined value
+            elements.emplace_back(elementType, UNDEFINED_LITERAL);
+        else
+            return {};
+    }
+    return CompoundConstant(resultType, std::move(elements));
+}
+
+Optional<int32_t> intrinsics::foldConstantElementOffset(
+    DataType containerType, const std::vector<CompoundConstant>& indices, DataType* resultType)
+{
+    int32_t offset = 0;
+    DataType subContainerType = containerType;
+    for(const auto& index : indices)
+    {
+        auto lit = index.getScalar();
+        if(!lit || lit->isUndefined())
+            return {};
+        if(subContainerType.getPointerType() || subContainerType.getArrayType())
+        {
+            // index is index in pointer/array -> add offset of element at given index
+            subContainerType = subContainerType.getElementType();
+            offset += lit->signedInt() * static_cast<int32_t>(subContainerType.getInMemoryWidth());
+        }
+        else if(auto structType = subContainerType.getStructType())
+        {
+            // index is the element in the struct
+            offset += static_cast<int32_t>(structType->getStructSize(lit->signedInt()));
+            subContainerType = subContainerType.getElementType(lit->signedInt());
+        }
+        else if(subContainerType.isVectorType())
+        {
+            subContainerType = subContainerType.getElementType();
+            offset += lit->signedInt() * static_cast<int32_t>(subContainerType.getInMemoryWidth());
+        }
+        else
+            return {};
+    }
+    if(resultType)
+        *resultType = subContainerType;
+    return offset;
+}
@@ -0,0 +1,75 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_CONSTANT_FOLDING_H
+#define VC4C_CONSTANT_FOLDING_H
+
+#include "../GlobalValues.h"
+
+#include <string>
+#include <vector>
+
+namespace vc4c
+{
+    namespace intrinsics
+    {
+        /*
+         * Compile-time evaluation of constant expressions, shared by the front-ends (e.g. for LLVM constant
+         * expressions and SPIR-V OpSpecConstantOp), so constant operations are folded at parse time instead of being
+         * emitted as instructions which need to be folded by the optimizer.
+         *
+         * All functions operate on CompoundConstants, vector (and other aggregate) operands are evaluated
+         * element-wise. If the expression cannot be evaluated (e.g. unknown operations, non-constant or undefined
+         * operands, division by zero), an empty optional is returned.
+         */
+
+        /*
+         * Converts the constant value (literal, vector or undefined) to a compound constant
+         */
+        Optional<CompoundConstant> toCompoundConstant(const Value& val);
+
+        /*
+         * Evaluates the arithmetic, bitwise or conversion operation with the given name.
+         *
+         * The name is one of:
+         * - the name of an OpCode (e.g. "add", "fmul", "shr", "max"),
+         * - the name of an integer/floating-point operation which is not directly supported by the hardware (e.g.
+         *   "mul", "udiv", "srem", "fmod") or of the LLVM instructions with different names (e.g. "lshr", "urem",
+         *   "fneg"),
+         * - a conversion (e.g. "trunc", "zext", "sext", "fptoui", "sitofp", "fptrunc", "bitcast", "ptrtoint").
+         *
+         * For conversions, the bit-width of the source is taken from the type of the first operand, the bit-width of
+         * the result from the result type.
+         */
+        Optional<CompoundConstant> foldConstantOperation(const std::string& operation, DataType resultType,
+            const CompoundConstant& firstOperand, const Optional<CompoundConstant>& secondOperand = {});
+
+        /*
+         * Evaluates the comparison with the given name (see the COMP_XXX constants in intermediate::Comparison, which
+         * are also the names of the LLVM icmp/fcmp predicates)
+         */
+        Optional<CompoundConstant> foldConstantComparison(const std::string& comparison, DataType resultType,
+            const CompoundConstant& firstOperand, const CompoundConstant& secondOperand);
+
+        /*
+         * Evaluates the vector shuffle, which selects the elements with the given indices from the concatenation of
+         * both vectors. An index of 0xFFFFFFFF (-1) selects an undefined element.
+         */
+        Optional<CompoundConstant> foldConstantShuffle(DataType resultType, const CompoundConstant& firstVector,
+            const CompoundConstant& secondVector, const std::vector<uint32_t>& indices);
+
+        /*
+         * Calculates the byte offset of the element addressed by the given chain of indices (as for getelementptr
+         * or OpAccessChain) relative to the base address of the given (pointer) container type.
+         *
+         * If the result type is given, it is set to the type of the addressed element.
+         */
+        Optional<int32_t> foldConstantElementOffset(
+            DataType containerType, const std::vector<CompoundConstant>& indices, DataType* resultType = nullptr);
+    } // namespace intrinsics
+} // namespace vc4c
+
+#endif /* VC4C_CONSTANT_FOLDING_H */
@@ -46,6 +46,10 @@ Global* intermediate::reserveImageConfiguration(Module& module, Parameter& image
     return &(*it);
 }
 
+/*
+ * The image-configuration is constant for the whole kernel execution, so every entry is only loaded once at the
+ * beginning of the kernel and all accesses copy the cached value, instead of executing a TMU load per access.
+ */
 static NODISCARD InstructionWalker insertLoadImageConfig(
     InstructionWalker it, Method& method, const Value& image, const Value& dest, const Value& offset)
 {
@@ -53,11 +57,24 @@ static NODISCARD InstructionWalker insertLoadImageConfig(
         method.findGlobal(ImageType::toImageConfigurationName(image.local()->getBase(false)->name));
     if(imageConfig == nullptr)
         throw CompilationError(CompilationStep::GENERAL, "Image-configuration is not yet reserved", image.to_string());
-    const Value addrTemp =
-        method.addNewLocal(method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL), "%image_config");
-    it.emplace(new Operation(OP_ADD, addrTemp, imageConfig->createReference(), offset));
+    const auto cacheName = imageConfig->name + "." + std::to_string(offset.getLiteralValue()->unsignedInt());
+    const Local* cachedConfig = method.findLocal(cacheName);
+    if(cachedConfig == nullptr)
+    {
+        cachedConfig = method.createLocal(TYPE_INT32, cacheName);
+        // skip the label of the first block
+        auto startIt = method.begin()->walk().nextInBlock();
+        const Value addrTemp =
+            method.addNewLocal(method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL), "%image_config");
+        startIt.emplace(new Operation(OP_ADD, addrTemp, imageConfig->createReference(), offset));
+        startIt.nextInBlock();
+        startIt = periphery::insertReadVectorFromTMU(method, startIt, cachedConfig->createReference(), addrTemp);
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Loading image-configuration entry once at the beginning of the kernel: " << cacheName
+                << logging::endl);
+    }
+    it.emplace(new MoveOperation(dest, cachedConfig->createReference()));
     it.nextInBlock();
-    it = periphery::insertReadVectorFromTMU(method, it, dest, addrTemp);
     return it;
 }
 
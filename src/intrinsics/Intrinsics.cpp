@@ -11,6 +11,7 @@
 #include "../intermediate/TypeConversions.h"
 #include "../intermediate/VectorHelper.h"
 #include "../intermediate/operators.h"
+#include "../normalization/MemoryAccess.h"
 #include "../periphery/SFU.h"
 #include "../periphery/TMU.h"
 #include "../periphery/VPM.h"
@@ -20,9 +21,9 @@
 #include "Operators.h"
 #include "log.h"
 
+#include <cctype>
 #include <cmath>
 #include <cstdbool>
-#include <map>
 #include <vector>
 
 using namespace vc4c;
@@ -248,6 +249,35 @@ static IntrinsicFunction intrinsifyVectorRotation()
     };
 }
 
+static IntrinsicFunction intrinsifyVectorReduction(OpCode opCode)
+{
+    return [=](Method& method, InstructionWalker it, const MethodCall* callSite) -> InstructionWalker {
+        CPPLOG_LAZY(
+            logging::Level::DEBUG, log << "Intrinsifying vector reduction " << callSite->to_string() << logging::endl);
+        it = insertVectorReduction(it, method, callSite->getOutput().value(), callSite->assertArgument(0), opCode);
+        it.erase();
+        // so next instruction is not skipped
+        it.previousInBlock();
+
+        return it;
+    };
+}
+
+static IntrinsicFunction intrinsifyVectorScan(OpCode opCode, bool inclusive)
+{
+    return [=](Method& method, InstructionWalker it, const MethodCall* callSite) -> InstructionWalker {
+        CPPLOG_LAZY(
+            logging::Level::DEBUG, log << "Intrinsifying vector scan " << callSite->to_string() << logging::endl);
+        it = insertVectorScan(
+            it, method, callSite->getOutput().value(), callSite->assertArgument(0), opCode, inclusive);
+        it.erase();
+        // so next instruction is not skipped
+        it.previousInBlock();
+
+        return it;
+    };
+}
+
 static IntrinsicFunction intrinsifyCheckNaN(bool checkInfinite)
 {
     return [=](Method& method, InstructionWalker it, const MethodCall* callSite) -> InstructionWalker {
@@ -327,16 +357,39 @@ struct Intrinsic
 };
 
 /*
- * NOTE: We sort intrinsics in descending order on purpose, to correctly select e.g. fmaxabs for vc4cl_fmaxabs (and not
- * fmax)
+ * Returns the plain name of the called function, i.e. the identifier encoded in a mangled (Itanium C++ ABI) name of an
+ * overloaded function (e.g. "vc4cl_ftoi" for "_Z10vc4cl_ftoiDv16_f").
  */
-const static std::map<std::string, Intrinsic, std::greater<std::string>> nonaryInstrinsics = {
+static std::string getFunctionName(const std::string& methodName)
+{
+    if(methodName.compare(0, 2, "_Z") != 0)
+        return methodName;
+    std::size_t pos = 2;
+    // internal linkage
+    if(pos < methodName.size() && methodName[pos] == 'L')
+        ++pos;
+    std::size_t length = 0;
+    while(pos < methodName.size() && std::isdigit(static_cast<unsigned char>(methodName[pos])))
+    {
+        length = length * 10 + static_cast<std::size_t>(methodName[pos] - '0');
+        ++pos;
+    }
+    if(length == 0 || pos + length > methodName.size())
+        return methodName;
+    return methodName.substr(pos, length);
+}
+
+/*
+ * NOTE: The intrinsics are indexed by the plain function name (see #getFunctionName()), so every call is matched by a
+ * single hash lookup per table instead of searching all entries of all tables for a part of the (mangled) name.
+ */
+const static FastMap<std::string, Intrinsic> nonaryInstrinsics = {
     {"vc4cl_mutex_lock", Intrinsic{intrinsifyMutexAccess(true)}},
     {"vc4cl_mutex_unlock", Intrinsic{intrinsifyMutexAccess(false)}},
     {"vc4cl_element_number", Intrinsic{intrinsifyValueRead(ELEMENT_NUMBER_REGISTER)}},
     {"vc4cl_qpu_number", Intrinsic{intrinsifyValueRead(Value(REG_QPU_NUMBER, TYPE_INT8))}}};
 
-const static std::map<std::string, Intrinsic, std::greater<std::string>> unaryIntrinsicMapping = {
+const static FastMap<std::string, Intrinsic> unaryIntrinsicMapping = {
     {"vc4cl_ftoi",
         Intrinsic{intrinsifyUnaryALUInstruction(OP_FTOI.name),
             [](const Value& val) { return OP_FTOI(val, NO_VALUE).first.value(); }}},
@@ -383,10 +436,26 @@ const static std::map<std::string, Intrinsic, std::greater<std::string>> unaryIn
                 return std::isnan(val.literal().real()) || std::isinf(val.literal().real()) ? INT_ONE : INT_ZERO;
             }}},
     {"vc4cl_vload3", Intrinsic{intrinsifyMemoryAccess(MemoryAccess::READ, true)}},
+    {"vc4cl_vector_reduce_add", Intrinsic{intrinsifyVectorReduction(OP_ADD)}},
+    {"vc4cl_vector_reduce_fadd", Intrinsic{intrinsifyVectorReduction(OP_FADD)}},
+    {"vc4cl_vector_reduce_min", Intrinsic{intrinsifyVectorReduction(OP_MIN)}},
+    {"vc4cl_vector_reduce_max", Intrinsic{intrinsifyVectorReduction(OP_MAX)}},
+    {"vc4cl_vector_reduce_fmin", Intrinsic{intrinsifyVectorReduction(OP_FMIN)}},
+    {"vc4cl_vector_reduce_fmax", Intrinsic{intrinsifyVectorReduction(OP_FMAX)}},
+    {"vc4cl_vector_scan_inclusive_add", Intrinsic{intrinsifyVectorScan(OP_ADD, true)}},
+    {"vc4cl_vector_scan_inclusive_fadd", Intrinsic{intrinsifyVectorScan(OP_FADD, true)}},
+    {"vc4cl_vector_scan_inclusive_min", Intrinsic{intrinsifyVectorScan(OP_MIN, true)}},
+    {"vc4cl_vector_scan_inclusive_max", Intrinsic{intrinsifyVectorScan(OP_MAX, true)}},
+    {"vc4cl_vector_scan_inclusive_fmin", Intrinsic{intrinsifyVectorScan(OP_FMIN, true)}},
+    {"vc4cl_vector_scan_inclusive_fmax", Intrinsic{intrinsifyVectorScan(OP_FMAX, true)}},
+    {"vc4cl_vector_scan_exclusive_add", Intrinsic{intrinsifyVectorScan(OP_ADD, false)}},
+    {"vc4cl_vector_scan_exclusive_fadd", Intrinsic{intrinsifyVectorScan(OP_FADD, false)}},
+    {"vc4cl_vector_scan_exclusive_fmin", Intrinsic{intrinsifyVectorScan(OP_FMIN, false)}},
+    {"vc4cl_vector_scan_exclusive_fmax", Intrinsic{intrinsifyVectorScan(OP_FMAX, false)}},
     /* simply set the event to something so it is initialized */
     {"vc4cl_set_event", Intrinsic{intrinsifyValueRead(INT_ZERO), [](const Value& val) -> Value { return INT_ZERO; }}}};
 
-const static std::map<std::string, Intrinsic, std::greater<std::string>> binaryIntrinsicMapping = {
+const static FastMap<std::string, Intrinsic> binaryIntrinsicMapping = {
     {"vc4cl_fmax",
         Intrinsic{intrinsifyBinaryALUInstruction(OP_FMAX.name),
             [](const Value& val0, const Value& val1) { return OP_FMAX(val0, val1).first.value(); }}},
@@ -429,9 +498,12 @@ const static std::map<std::string, Intrinsic, std::greater<std::string>> binaryI
         Intrinsic{intrinsifyBinaryALUInstruction(OP_SUB.name, false, PACK_NOP, UNPACK_NOP, true),
             /* can't set flags for pre-calculation, so don't */}},
     {"vc4cl_prefetch", Intrinsic{[](Method& m, InstructionWalker it, const MethodCall* call) -> InstructionWalker {
-         /* for now do nothing, TODO make use of this! */
-         CPPLOG_LAZY(logging::Level::DEBUG, log << "Dropping intrinsic function: " << it->to_string() << logging::endl);
-         return it.erase();
+         // the prefetch can only be lowered once the memory access type of the prefetched memory is known, so keep it
+         // as call with a fixed name until the memory access is mapped
+         it.reset((new MethodCall(normalization::PREFETCH_FUNCTION,
+                       {Value(call->assertArgument(0)), Value(call->assertArgument(1))}))
+                      ->copyExtrasFrom(call));
+         return it;
      }}},
     {"vc4cl_v8adds",
         Intrinsic{intrinsifyBinaryALUInstruction(OP_V8ADDS.name, false),
@@ -448,67 +520,126 @@ const static std::map<std::string, Intrinsic, std::greater<std::string>> binaryI
     {"vc4cl_vstore3", Intrinsic{intrinsifyMemoryAccess(MemoryAccess::WRITE, true)}},
     {"vc4cl_mul_hi", Intrinsic{intrinsifyIntegerMultiplicationHighPart}}};
 
-const static std::map<std::string, Intrinsic, std::greater<std::string>> ternaryIntrinsicMapping = {
+const static FastMap<std::string, Intrinsic> ternaryIntrinsicMapping = {
     {"vc4cl_dma_copy", Intrinsic{intrinsifyMemoryAccess(MemoryAccess::COPY, false)}},
     {"vc4cl_flag_cond", Intrinsic{intrinsifyFlagCondition}}};
 
-const static std::map<std::string, std::pair<Intrinsic, Optional<Value>>, std::greater<std::string>>
-    typeCastIntrinsics = {
-        // since we run all the (not intrinsified) calculations with 32-bit, don't truncate signed conversions to
-        // smaller types
-        // TODO correct?? Since we do not discard out-of-bounds values!
-        {"vc4cl_bitcast_uchar",
-            {Intrinsic{intrinsifyBinaryALUInstruction("and", true),
-                 [](const Value& val) { return Value(Literal(val.literal().unsignedInt() & 0xFF), TYPE_INT8); }},
-                Value(Literal(0xFFu), TYPE_INT8)}},
-        {"vc4cl_bitcast_char",
-            {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
-                 [](const Value& val) { return Value(val.literal(), TYPE_INT8); }},
-                NO_VALUE}},
-        {"vc4cl_bitcast_ushort",
-            {Intrinsic{intrinsifyBinaryALUInstruction("and", true),
-                 [](const Value& val) { return Value(Literal(val.literal().unsignedInt() & 0xFFFF), TYPE_INT16); }},
-                Value(Literal(0xFFFFu), TYPE_INT16)}},
-        {"vc4cl_bitcast_short",
-            {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
-                 [](const Value& val) { return Value(val.literal(), TYPE_INT16); }},
-                NO_VALUE}},
-        {"vc4cl_bitcast_uint",
-            {Intrinsic{intrinsifyBinaryALUInstruction("mov", true),
-                 [](const Value& val) { return Value(Literal(val.literal()), TYPE_INT32); }},
-                NO_VALUE}},
-        {"vc4cl_bitcast_int",
-            {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
-                 [](const Value& val) { return Value(val.literal(), TYPE_INT32); }},
-                NO_VALUE}},
-        {"vc4cl_bitcast_float",
-            {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
-                 [](const Value& val) { return Value(Literal(val.literal()), TYPE_INT32); }},
-                NO_VALUE}}};
-
-static bool intrinsifyNoArgs(Method& method, InstructionWalker it)
+const static FastMap<std::string, std::pair<Intrinsic, Optional<Value>>> typeCastIntrinsics = {
+    // since we run all the (not intrinsified) calculations with 32-bit, don't truncate signed conversions to
+    // smaller types
+    // TODO correct?? Since we do not discard out-of-bounds values!
+    {"vc4cl_bitcast_uchar",
+        {Intrinsic{intrinsifyBinaryALUInstruction("and", true),
+             [](const Value& val) { return Value(Literal(val.literal().unsignedInt() & 0xFF), TYPE_INT8); }},
+            Value(Literal(0xFFu), TYPE_INT8)}},
+    {"vc4cl_bitcast_char",
+        {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
+             [](const Value& val) { return Value(val.literal(), TYPE_INT8); }},
+            NO_VALUE}},
+    {"vc4cl_bitcast_ushort",
+        {Intrinsic{intrinsifyBinaryALUInstruction("and", true),
+             [](const Value& val) { return Value(Literal(val.literal().unsignedInt() & 0xFFFF), TYPE_INT16); }},
+            Value(Literal(0xFFFFu), TYPE_INT16)}},
+    {"vc4cl_bitcast_short",
+        {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
+             [](const Value& val) { return Value(val.literal(), TYPE_INT16); }},
+            NO_VALUE}},
+    {"vc4cl_bitcast_uint",
+        {Intrinsic{intrinsifyBinaryALUInstruction("mov", true),
+             [](const Value& val) { return Value(Literal(val.literal()), TYPE_INT32); }},
+            NO_VALUE}},
+    {"vc4cl_bitcast_int",
+        {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
+             [](const Value& val) { return Value(val.literal(), TYPE_INT32); }},
+            NO_VALUE}},
+    {"vc4cl_bitcast_float",
+        {Intrinsic{intrinsifyBinaryALUInstruction("mov"),
+             [](const Value& val) { return Value(Literal(val.literal()), TYPE_INT32); }},
+            NO_VALUE}}};
+
+/*
+ * The accuracy tiers of the SFU-based math functions in addition to the native SFU results (see vc4cl_sfu_xxx)
+ */
+enum class SFUAccuracy
+{
+    // for half_xxx functions, requires an error of at most 8192 ULP (i.e. about 10 correct bits)
+    HALF,
+    // for the full precision functions
+    FULL
+};
+
+const static FastMap<std::string, std::pair<Register, SFUAccuracy>> refinedSFUFunctions = {
+    {"vc4cl_half_recip", {REG_SFU_RECIP, SFUAccuracy::HALF}},
+    {"vc4cl_half_rsqrt", {REG_SFU_RECIP_SQRT, SFUAccuracy::HALF}},
+    {"vc4cl_recip", {REG_SFU_RECIP, SFUAccuracy::FULL}},
+    {"vc4cl_rsqrt", {REG_SFU_RECIP_SQRT, SFUAccuracy::FULL}}};
+
+static unsigned getNumRefinementSteps(SFUAccuracy accuracy, MathType mathType)
+{
+    if(accuracy == SFUAccuracy::HALF)
+        // the SFU results are close to the required accuracy, so only refine them if not relaxed anyway
+        return has_flag(mathType, MathType::FAST_RELAXED_MATH) ? 0 : 1;
+    // a single step results in about 20 correct bits, which is acceptable for unsafe math
+    return has_flag(mathType, MathType::UNSAFE_MATH) ? 1 : 2;
+}
+
+static bool intrinsifyRefinedSFUFunction(
+    Method& method, InstructionWalker it, const std::string& functionName, MathType mathType)
 {
     MethodCall* callSite = it.get<MethodCall>();
     if(callSite == nullptr)
     {
         return false;
     }
-    if(callSite->getArguments().size() > 1 /* check for sign-flag too*/)
+    if(callSite->getArguments().empty() || callSite->getArguments().size() > 2 /* check for sign-flag too*/)
     {
         return false;
     }
-    for(const auto& pair : nonaryInstrinsics)
+    auto entry = refinedSFUFunctions.find(functionName);
+    if(entry == refinedSFUFunctions.end())
+        return false;
+    const Value& arg = callSite->assertArgument(0);
+    const auto sfuReg = entry->second.first;
+    Optional<Value> result = NO_VALUE;
+    if((arg.getLiteralValue() || arg.checkVector()) && (result = periphery::precalculateSFU(sfuReg, arg)))
     {
-        if(callSite->methodName.find(pair.first) != std::string::npos)
-        {
-            pair.second.func(method, it, callSite);
-            return true;
-        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Intrinsifying unary '" << callSite->to_string()
+                << "' to pre-calculated value: " << result->to_string() << logging::endl);
+        it.reset(new MoveOperation(callSite->getOutput().value(), result.value()));
+        return true;
     }
-    return false;
+    auto numSteps = getNumRefinementSteps(entry->second.second, mathType);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Intrinsifying unary '" << callSite->to_string() << "' to SFU call with " << numSteps
+            << " Newton-Raphson steps" << logging::endl);
+    it = insertRefinedSFUCall(method, it, sfuReg, arg, callSite->getOutput().value(), numSteps,
+        entry->second.second == SFUAccuracy::FULL && !has_flag(mathType, MathType::FINITE_MATH));
+    it.erase();
+    // so next instruction is not skipped
+    it.previousInBlock();
+    return true;
+}
+
+static bool intrinsifyNoArgs(Method& method, InstructionWalker it, const std::string& functionName)
+{
+    MethodCall* callSite = it.get<MethodCall>();
+    if(callSite == nullptr)
+    {
+        return false;
+    }
+    if(callSite->getArguments().size() > 1 /* check for sign-flag too*/)
+    {
+        return false;
+    }
+    auto entry = nonaryInstrinsics.find(functionName);
+    if(entry == nonaryInstrinsics.end())
+        return false;
+    entry->second.func(method, it, callSite);
+    return true;
 }
 
-static bool intrinsifyUnary(Method& method, InstructionWalker it)
+static bool intrinsifyUnary(Method& method, InstructionWalker it, const std::string& functionName)
 {
     MethodCall* callSite = it.get<MethodCall>();
     if(callSite == nullptr)
@@ -521,58 +652,54 @@ static bool intrinsifyUnary(Method& method, InstructionWalker it)
     }
     const Value& arg = callSite->assertArgument(0);
     Optional<Value> result = NO_VALUE;
-    for(const auto& pair : unaryIntrinsicMapping)
+    auto entry = unaryIntrinsicMapping.find(functionName);
+    if(entry != unaryIntrinsicMapping.end())
     {
-        if(callSite->methodName.find(pair.first) != std::string::npos)
+        if((arg.getLiteralValue() || arg.checkVector()) && entry->second.unaryInstr &&
+            (result = entry->second.unaryInstr.value()(arg)))
         {
-            if((arg.getLiteralValue() || arg.checkVector()) && pair.second.unaryInstr &&
-                (result = pair.second.unaryInstr.value()(arg)))
-            {
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Intrinsifying unary '" << callSite->to_string()
-                        << "' to pre-calculated value: " << result->to_string() << logging::endl);
-                it.reset(new MoveOperation(callSite->getOutput().value(), result.value()));
-            }
-            else
-                pair.second.func(method, it, callSite);
-            return true;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Intrinsifying unary '" << callSite->to_string()
+                    << "' to pre-calculated value: " << result->to_string() << logging::endl);
+            it.reset(new MoveOperation(callSite->getOutput().value(), result.value()));
         }
+        else
+            entry->second.func(method, it, callSite);
+        return true;
     }
-    for(const auto& pair : typeCastIntrinsics)
+    auto castEntry = typeCastIntrinsics.find(functionName);
+    if(castEntry != typeCastIntrinsics.end())
     {
-        if(callSite->methodName.find(pair.first) != std::string::npos)
+        const auto& cast = castEntry->second;
+        // TODO support constant type-cast for constant containers
+        if(arg.checkLiteral() && cast.first.unaryInstr && (result = cast.first.unaryInstr.value()(arg)))
         {
-            // TODO support constant type-cast for constant containers
-            if(arg.checkLiteral() && pair.second.first.unaryInstr &&
-                (result = pair.second.first.unaryInstr.value()(arg)))
-            {
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Intrinsifying type-cast '" << callSite->to_string()
-                        << "' to pre-calculated value: " << result->to_string() << logging::endl);
-                it.reset(new MoveOperation(callSite->getOutput().value(), result.value()));
-            }
-            else if(!pair.second.second) // there is no value to apply -> simple move
-            {
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Intrinsifying '" << callSite->to_string() << "' to simple move" << logging::endl);
-                it.reset(new MoveOperation(callSite->getOutput().value(), arg));
-            }
-            else
-            {
-                // TODO could use pack-mode here, but only for UNSIGNED values!!
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Intrinsifying '" << callSite->to_string() << "' to operation with constant "
-                        << pair.second.second.to_string() << logging::endl);
-                callSite->setArgument(1, pair.second.second.value());
-                pair.second.first.func(method, it, callSite);
-            }
-            return true;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Intrinsifying type-cast '" << callSite->to_string()
+                    << "' to pre-calculated value: " << result->to_string() << logging::endl);
+            it.reset(new MoveOperation(callSite->getOutput().value(), result.value()));
+        }
+        else if(!cast.second) // there is no value to apply -> simple move
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Intrinsifying '" << callSite->to_string() << "' to simple move" << logging::endl);
+            it.reset(new MoveOperation(callSite->getOutput().value(), arg));
         }
+        else
+        {
+            // TODO could use pack-mode here, but only for UNSIGNED values!!
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Intrinsifying '" << callSite->to_string() << "' to operation with constant "
+                    << cast.second.to_string() << logging::endl);
+            callSite->setArgument(1, cast.second.value());
+            cast.first.func(method, it, callSite);
+        }
+        return true;
     }
     return false;
 }
 
-static bool intrinsifyBinary(Method& method, InstructionWalker it)
+static bool intrinsifyBinary(Method& method, InstructionWalker it, const std::string& functionName)
 {
     MethodCall* callSite = it.get<MethodCall>();
     if(callSite == nullptr)
@@ -583,29 +710,24 @@ static bool intrinsifyBinary(Method& method, InstructionWalker it)
     {
         return false;
     }
-    for(const auto& pair : binaryIntrinsicMapping)
+    auto entry = binaryIntrinsicMapping.find(functionName);
+    if(entry == binaryIntrinsicMapping.end())
+        return false;
+    if(callSite->assertArgument(0).checkLiteral() && callSite->assertArgument(1).checkLiteral() &&
+        entry->second.binaryInstr &&
+        entry->second.binaryInstr.value()(callSite->assertArgument(0), callSite->assertArgument(1)))
     {
-        if(callSite->methodName.find(pair.first) != std::string::npos)
-        {
-            if(callSite->assertArgument(0).checkLiteral() && callSite->assertArgument(1).checkLiteral() &&
-                pair.second.binaryInstr &&
-                pair.second.binaryInstr.value()(callSite->assertArgument(0), callSite->assertArgument(1)))
-            {
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Intrinsifying binary '" << callSite->to_string() << "' to pre-calculated value"
-                        << logging::endl);
-                it.reset(new MoveOperation(callSite->getOutput().value(),
-                    pair.second.binaryInstr.value()(callSite->assertArgument(0), callSite->assertArgument(1)).value()));
-            }
-            else
-                pair.second.func(method, it, callSite);
-            return true;
-        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Intrinsifying binary '" << callSite->to_string() << "' to pre-calculated value" << logging::endl);
+        it.reset(new MoveOperation(callSite->getOutput().value(),
+            entry->second.binaryInstr.value()(callSite->assertArgument(0), callSite->assertArgument(1)).value()));
     }
-    return false;
+    else
+        entry->second.func(method, it, callSite);
+    return true;
 }
 
-static bool intrinsifyTernary(Method& method, InstructionWalker it)
+static bool intrinsifyTernary(Method& method, InstructionWalker it, const std::string& functionName)
 {
     MethodCall* callSite = it.get<MethodCall>();
     if(callSite == nullptr)
@@ -616,15 +738,11 @@ static bool intrinsifyTernary(Method& method, InstructionWalker it)
     {
         return false;
     }
-    for(const auto& pair : ternaryIntrinsicMapping)
-    {
-        if(callSite->methodName.find(pair.first) != std::string::npos)
-        {
-            pair.second.func(method, it, callSite);
-            return true;
-        }
-    }
-    return false;
+    auto entry = ternaryIntrinsicMapping.find(functionName);
+    if(entry == ternaryIntrinsicMapping.end())
+        return false;
+    entry->second.func(method, it, callSite);
+    return true;
 }
 
 static constexpr uint32_t getMaximumUnsignedValue(uint8_t numBits)
@@ -706,6 +824,15 @@ static bool intrinsifyArithmetic(Method& method, InstructionWalker it, const Mat
             it.reset((new Operation(OP_MUL24, op->getOutput().value(), op->getFirstArg(), op->assertArgument(1)))
                          ->copyExtrasFrom(it.get()));
         }
+        else if(canOptimizeMultiplicationWithMul24(method, *op))
+        {
+            // e.g. index calculations with the local ID or values loaded from char/short memory
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Intrinsifying multiplication of values known to fit into 24 bits to mul24: " << op->to_string()
+                    << logging::endl);
+            it.reset((new Operation(OP_MUL24, op->getOutput().value(), op->getFirstArg(), op->assertArgument(1)))
+                         ->copyExtrasFrom(it.get()));
+        }
         else if(arg0.getLiteralValue() && arg0.getLiteralValue()->signedInt() > 0 &&
             isPowerTwo(arg0.getLiteralValue()->unsignedInt() + 1))
         {
@@ -781,6 +908,8 @@ static bool intrinsifyArithmetic(Method& method, InstructionWalker it, const Mat
             // XXX is never used, LLVM always uses i32 for division??
             it = intrinsifyUnsignedIntegerDivisionByConstant(method, it, *op);
         }
+        else if(canOptimizeDivisionByUniform(*op))
+            it = intrinsifyUnsignedIntegerDivisionByUniform(method, it, *op);
         else
             it = intrinsifyUnsignedIntegerDivision(method, it, *op);
         return true;
@@ -828,6 +957,8 @@ static bool intrinsifyArithmetic(Method& method, InstructionWalker it, const Mat
             // XXX is never used, LLVM always uses i32 for division??
             it = intrinsifySignedIntegerDivisionByConstant(method, it, *op);
         }
+        else if(canOptimizeDivisionByUniform(*op))
+            it = intrinsifySignedIntegerDivisionByUniform(method, it, *op);
         /*        // a / b = ftoi(itof(a) / itof(b))
                 // possible for |type| < 24, since for -2^23 <= x <= 2^23 float is an exact representation
                 else if(arg0.type.getScalarBitCount() < 24 && arg1.type.getScalarBitCount() < 24)
@@ -878,6 +1009,8 @@ static bool intrinsifyArithmetic(Method& method, InstructionWalker it, const Mat
         {
             it = intrinsifyUnsignedIntegerDivisionByConstant(method, it, *op, true);
         }
+        else if(canOptimizeDivisionByUniform(*op))
+            it = intrinsifyUnsignedIntegerDivisionByUniform(method, it, *op, true);
         else
             it = intrinsifyUnsignedIntegerDivision(method, it, *op, true);
         return true;
@@ -921,6 +1054,8 @@ static bool intrinsifyArithmetic(Method& method, InstructionWalker it, const Mat
         {
             it = intrinsifySignedIntegerDivisionByConstant(method, it, *op, true);
         }
+        else if(canOptimizeDivisionByUniform(*op))
+            it = intrinsifySignedIntegerDivisionByUniform(method, it, *op, true);
         else
             it = intrinsifySignedIntegerDivision(method, it, *op, true);
         return true;
@@ -945,24 +1080,8 @@ static bool intrinsifyArithmetic(Method& method, InstructionWalker it, const Mat
                           periphery::precalculateSFU(REG_SFU_RECIP, arg1).value()))
                          ->copyExtrasFrom(it.get()));
         }
-        else if(op->hasDecoration(InstructionDecorations::ALLOW_RECIP) ||
-            op->hasDecoration(InstructionDecorations::FAST_MATH))
-        {
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Intrinsifying floating division with multiplication of reciprocal: " << op->to_string()
-                    << logging::endl);
-            it = periphery::insertSFUCall(REG_SFU_RECIP, it, arg1);
-            it.reset((new Operation(OP_FMUL, op->getOutput().value(), op->getFirstArg(),
-                          Value(REG_SFU_OUT, op->getFirstArg().type)))
-                         ->copyExtrasFrom(it.get()));
-        }
         else
-        {
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Intrinsifying floating division with multiplication of inverse: " << op->to_string()
-                    << logging::endl);
-            it = intrinsifyFloatingDivision(method, it, *op);
-        }
+            it = intrinsifyFloatingDivision(method, it, *op, mathType);
         return true;
     }
     // truncate bits
@@ -1307,14 +1426,20 @@ static NODISCARD InstructionWalker intrinsifyReadLocalSize(Method& method, Instr
 
 static NODISCARD InstructionWalker intrinsifyReadLocalID(Method& method, InstructionWalker it, const Value& arg)
 {
-    if(method.metaData.isWorkGroupSizeSet() &&
-        std::all_of(method.metaData.workGroupSizes.begin(), method.metaData.workGroupSizes.end(),
-            [](uint32_t u) -> bool { return u == 1; }))
+    if(method.metaData.isWorkGroupSizeSet())
     {
-        // if all the work-group sizes are 1, the ID is always 0 for all dimensions
-        return it.reset((new MoveOperation(it->getOutput().value(), INT_ZERO))
-                            ->addDecorations(add_flag(
-                                InstructionDecorations::BUILTIN_LOCAL_ID, InstructionDecorations::UNSIGNED_RESULT)));
+        // if the work-group size of a dimension is 1 (or the dimension is not set), the ID is always 0 for that
+        // dimension. This removes the bookkeeping of unused dimensions, e.g. for 1-dimensional work-groups.
+        const auto& workGroupSizes = method.metaData.workGroupSizes;
+        auto isSingleItem = [](uint32_t u) -> bool { return u <= 1; };
+        auto literalDim = arg.getConstantValue() & &Value::getLiteralValue;
+        if(std::all_of(workGroupSizes.begin(), workGroupSizes.end(), isSingleItem) ||
+            (literalDim &&
+                (literalDim->unsignedInt() >= workGroupSizes.size() ||
+                    isSingleItem(workGroupSizes.at(literalDim->unsignedInt())))))
+            return it.reset((new MoveOperation(it->getOutput().value(), INT_ZERO))
+                                ->addDecorations(add_flag(InstructionDecorations::BUILTIN_LOCAL_ID,
+                                    InstructionDecorations::UNSIGNED_RESULT)));
     }
     return intrinsifyReadWorkItemInfo(method, it, arg, BuiltinLocal::Type::LOCAL_IDS,
         add_flag(InstructionDecorations::BUILTIN_LOCAL_ID, InstructionDecorations::UNSIGNED_RESULT));
@@ -1460,13 +1585,17 @@ void intrinsics::intrinsify(const Module& module, Method& method, InstructionWal
         return;
     if(intrinsifyWorkItemFunctions(method, it))
         return;
-    if(intrinsifyNoArgs(method, it))
+    // the plain name of the called function is only extracted once per call and then looked up in the intrinsics tables
+    const std::string functionName = it.get<MethodCall>() ? getFunctionName(it.get<MethodCall>()->methodName) : "";
+    if(intrinsifyNoArgs(method, it, functionName))
+        return;
+    if(intrinsifyRefinedSFUFunction(method, it, functionName, config.mathType))
         return;
-    if(intrinsifyUnary(method, it))
+    if(intrinsifyUnary(method, it, functionName))
         return;
-    if(intrinsifyBinary(method, it))
+    if(intrinsifyBinary(method, it, functionName))
         return;
-    if(intrinsifyTernary(method, it))
+    if(intrinsifyTernary(method, it, functionName))
         return;
     if(intrinsifyArithmetic(method, it, config.mathType))
         return;
@@ -7,6 +7,7 @@
 #include "Operators.h"
 
 #include "../Module.h"
+#include "../analysis/ValueRange.h"
 #include "../intermediate/Helper.h"
 #include "../intermediate/operators.h"
 #include "../periphery/SFU.h"
@@ -206,6 +207,19 @@ bool intrinsics::canOptimizeMultiplicationWithBinaryMethod(const IntrinsicOperat
     });
 }
 
+// mul24 multiplies the lower 24 bits of its (unsigned) inputs
+static constexpr analysis::ValueRange MUL24_INPUT_RANGE{0.0, static_cast<double>((1u << 24u) - 1u)};
+
+bool intrinsics::canOptimizeMultiplicationWithMul24(const Method& method, const IntrinsicOperation& op)
+{
+    // The product of two (unsigned) 24-bit values might still overflow 32 bits, but the lower 32 bits of the result are
+    // the same as for the full 32-bit multiplication, which is all the (truncating) mul instruction returns. Negative
+    // values are not allowed, since their two's complement representation does not fit into 24 bits.
+    return std::all_of(op.getArguments().begin(), op.getArguments().end(), [&](const Value& arg) -> bool {
+        return analysis::ValueRange::getValueRangeRecursive(arg, &method).fitsIntoRange(MUL24_INPUT_RANGE);
+    });
+}
+
 /*
  * Optimization of integer multiplication with binary method
  *
@@ -571,15 +585,225 @@ InstructionWalker intrinsics::intrinsifyUnsignedIntegerDivisionByConstant(
     return it;
 }
 
-InstructionWalker intrinsics::intrinsifyFloatingDivision(Method& method, InstructionWalker it, IntrinsicOperation& op)
+bool intrinsics::canOptimizeDivisionByUniform(const IntrinsicOperation& op)
+{
+    const auto& divisor = op.assertArgument(1);
+    auto local = divisor.checkLocal();
+    // kernel parameters are the same for all work-items (and work-groups) of a kernel execution
+    return local && local->as<Parameter>() && divisor.type.isScalarType() && !divisor.type.isFloatingType() &&
+        divisor.type.getScalarBitCount() == 32 && op.getFirstArg().type.getScalarBitCount() == 32;
+}
+
+/*
+ * The constants required for the division by a work-group uniform divisor, split into 16-bit half-words to be
+ * multiplied with mul24
+ */
+struct UniformDivisor
+{
+    // the (positive) divisor
+    Value divisor;
+    Value divisorLow;
+    Value divisorHigh;
+    // the reciprocal floor((2^32 - 1) / divisor)
+    Value reciprocalLow;
+    Value reciprocalHigh;
+    // the sign of the original divisor (-1 for negative, 0 for positive), only calculated for signed divisions
+    Value sign;
+};
+
+/*
+ * Returns the constants for the division by the given divisor, which are calculated once at the beginning of the
+ * kernel (and shared by all divisions by the same divisor).
+ */
+static UniformDivisor getUniformDivisor(Method& method, const Local& divisor, bool isSigned)
+{
+    const std::string prefix = divisor.name + (isSigned ? ".sdiv" : ".udiv");
+    auto getLocal = [&](const std::string& postfix) -> Value {
+        return method.createLocal(divisor.type, prefix + postfix)->createReference();
+    };
+    UniformDivisor constants{isSigned ? getLocal(".divisor") : divisor.createReference(), getLocal(".divisor_low"),
+        getLocal(".divisor_high"), getLocal(".reciprocal_low"), getLocal(".reciprocal_high"),
+        isSigned ? getLocal(".sign") : INT_ZERO};
+    if(!constants.reciprocalHigh.local()->getUsers(LocalUse::Type::WRITER).empty())
+        // already calculated for a previous division by the same divisor
+        return constants;
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Calculating reciprocal of work-group uniform divisor: " << divisor.to_string() << logging::endl);
+    auto it = method.begin()->walk().nextInBlock();
+    if(isSigned)
+    {
+        Value positiveDivisor = constants.divisor;
+        Value sign = constants.sign;
+        it = insertMakePositive(it, method, divisor.createReference(), positiveDivisor, sign);
+    }
+    // the reciprocal is calculated with the "default" bit-wise division, but only once per work-group
+    Value reciprocal = method.addNewLocal(divisor.type, "%udiv.reciprocal");
+    it.emplace(new IntrinsicOperation("udiv", Value(reciprocal), Value(Literal(0xFFFFFFFFu), divisor.type),
+        Value(constants.divisor)));
+    it = intrinsics::intrinsifyUnsignedIntegerDivision(method, it, *it.get<IntrinsicOperation>());
+    it.nextInBlock();
+    assign(it, constants.divisorLow) = (constants.divisor & 0xFFFF_val, InstructionDecorations::UNSIGNED_RESULT);
+    assign(it, constants.divisorHigh) =
+        (as_unsigned{constants.divisor} >> 16_val, InstructionDecorations::UNSIGNED_RESULT);
+    assign(it, constants.reciprocalLow) = (reciprocal & 0xFFFF_val, InstructionDecorations::UNSIGNED_RESULT);
+    assign(it, constants.reciprocalHigh) = (as_unsigned{reciprocal} >> 16_val, InstructionDecorations::UNSIGNED_RESULT);
+    return constants;
+}
+
+/*
+ * Calculates the unsigned division (or remainder) of the first argument and the uniform divisor by calculating the
+ * quotient estimate q = mulhi(n, floor((2^32 - 1) / d)) and correcting it by one if the remainder n - q * d >= d.
+ *
+ * Since floor((2^32 - 1) / d) >= (2^32 - d) / d, the estimate is either the correct quotient or one less.
+ */
+static InstructionWalker insertDivisionByUniform(
+    Method& method, InstructionWalker it, IntrinsicOperation& op, const UniformDivisor& constants, bool useRemainder)
+{
+    const Value& numerator = op.getFirstArg();
+    const auto type = numerator.type;
+    // 1. q = mulhi(n, reciprocal), assembled from the products of the 16-bit half-words
+    auto numeratorLow = assign(it, type, "%udiv.low") = numerator & 0xFFFF_val;
+    auto numeratorHigh = assign(it, type, "%udiv.high") = as_unsigned{numerator} >> 16_val;
+    auto lowLow = assign(it, type, "%udiv.tmp") = mul24(numeratorLow, constants.reciprocalLow);
+    auto highLow = assign(it, type, "%udiv.tmp") = mul24(numeratorHigh, constants.reciprocalLow);
+    auto lowHigh = assign(it, type, "%udiv.tmp") = mul24(numeratorLow, constants.reciprocalHigh);
+    auto highHigh = assign(it, type, "%udiv.tmp") = mul24(numeratorHigh, constants.reciprocalHigh);
+    auto carry = assign(it, type, "%udiv.tmp") = as_unsigned{lowLow} >> 16_val;
+    auto middle = assign(it, type, "%udiv.tmp") = highLow + carry;
+    auto middleLow = assign(it, type, "%udiv.tmp") = middle & 0xFFFF_val;
+    auto middleHigh = assign(it, type, "%udiv.tmp") = as_unsigned{middle} >> 16_val;
+    auto middle2 = assign(it, type, "%udiv.tmp") = lowHigh + middleLow;
+    auto middle2High = assign(it, type, "%udiv.tmp") = as_unsigned{middle2} >> 16_val;
+    auto tmp = assign(it, type, "%udiv.tmp") = highHigh + middleHigh;
+    auto quotient = assign(it, type, "%udiv.quotient") = tmp + middle2High;
+
+    // 2. r = n - q * d, only the lower 32 bits of the product are required
+    auto quotientLow = assign(it, type, "%udiv.low") = quotient & 0xFFFF_val;
+    auto quotientHigh = assign(it, type, "%udiv.high") = as_unsigned{quotient} >> 16_val;
+    auto productLow = assign(it, type, "%udiv.tmp") = mul24(quotientLow, constants.divisorLow);
+    auto cross0 = assign(it, type, "%udiv.tmp") = mul24(quotientHigh, constants.divisorLow);
+    auto cross1 = assign(it, type, "%udiv.tmp") = mul24(quotientLow, constants.divisorHigh);
+    auto cross = assign(it, type, "%udiv.tmp") = cross0 + cross1;
+    auto crossShifted = assign(it, type, "%udiv.tmp") = cross << 16_val;
+    auto product = assign(it, type, "%udiv.tmp") = productLow + crossShifted;
+    auto remainder = assign(it, type, "%udiv.remainder") = numerator - product;
+
+    // 3. correct the estimate, if r >= d (unsigned comparison, see #intrinsifyUnsignedIntegerDivision)
+    assign(it, NOP_REGISTER) = (remainder ^ constants.divisor, SetFlag::SET_FLAGS);
+    Value unsignedMax = method.addNewLocal(type, "%icomp");
+    assign(it, unsignedMax) = (min(remainder, constants.divisor), COND_NEGATIVE_SET);
+    assign(it, unsignedMax) = (max(remainder, constants.divisor), COND_NEGATIVE_CLEAR);
+    assign(it, NOP_REGISTER) = (unsignedMax ^ remainder, SetFlag::SET_FLAGS);
+
+    const Value& result = op.getOutput().value();
+    if(useRemainder)
+    {
+        assign(it, result) = (remainder, InstructionDecorations::UNSIGNED_RESULT);
+        assign(it, result) = (remainder - constants.divisor, COND_ZERO_SET, InstructionDecorations::UNSIGNED_RESULT);
+    }
+    else
+    {
+        assign(it, result) = (quotient, InstructionDecorations::UNSIGNED_RESULT);
+        assign(it, result) = (quotient + 1_val, COND_ZERO_SET, InstructionDecorations::UNSIGNED_RESULT);
+    }
+    // erase original division
+    it.erase();
+    // so next instruction is not skipped
+    it.previousInBlock();
+    return it;
+}
+
+InstructionWalker intrinsics::intrinsifyUnsignedIntegerDivisionByUniform(
+    Method& method, InstructionWalker it, IntrinsicOperation& op, bool useRemainder)
+{
+    if(!canOptimizeDivisionByUniform(op))
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Can only optimize division by work-group uniform value", op.to_string());
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Intrinsifying unsigned division by work-group uniform value: " << op.to_string() << logging::endl);
+    auto constants = getUniformDivisor(method, *op.assertArgument(1).local(), false);
+    return insertDivisionByUniform(method, it, op, constants, useRemainder);
+}
+
+InstructionWalker intrinsics::intrinsifySignedIntegerDivisionByUniform(
+    Method& method, InstructionWalker it, IntrinsicOperation& op, bool useRemainder)
+{
+    if(!canOptimizeDivisionByUniform(op))
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Can only optimize division by work-group uniform value", op.to_string());
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Intrinsifying signed division by work-group uniform value: " << op.to_string() << logging::endl);
+    Value opDest = op.getOutput().value();
+    // convert the numerator to positive, the divisor is converted once together with the calculation of the reciprocal
+    Value op1Sign = UNDEFINED_VALUE;
+    Value op1Pos = method.addNewLocal(op.assertArgument(0).type, "%unsigned");
+    it = insertMakePositive(it, method, op.assertArgument(0), op1Pos, op1Sign);
+    auto constants = getUniformDivisor(method, *op.assertArgument(1).local(), true);
+
+    op.setArgument(0, std::move(op1Pos));
+    // use new temporary result, so we can store the final result in the correct value
+    const Value tmpDest = method.addNewLocal(opDest.type, "%result");
+    op.setOutput(tmpDest);
+
+    // calculate unsigned division
+    it = insertDivisionByUniform(method, it, op, constants, useRemainder);
+    it.nextInBlock();
+
+    if(useRemainder)
+        // For signed remainder (srem), the results sign only depends on the sign of the dividend!
+        return insertRestoreSign(it, method, tmpDest, opDest, op1Sign);
+    // if exactly one operand was negative, invert sign of result
+    Value eitherSign = assign(it, op1Sign.type) = op1Sign ^ constants.sign;
+    return insertRestoreSign(it, method, tmpDest, opDest, eitherSign);
+}
+
+/*
+ * Returns the number of Newton-Raphson steps refining the reciprocal of the divisor for the given math mode
+ */
+static unsigned getNumDivisionRefinementSteps(const IntrinsicOperation& op, MathType mathType)
+{
+    if(op.hasDecoration(InstructionDecorations::ALLOW_RECIP) || op.hasDecoration(InstructionDecorations::FAST_MATH))
+        // the division may be replaced by the multiplication with the reciprocal, so use the SFU result directly
+        return 0;
+    if(has_flag(mathType, MathType::FAST_RELAXED_MATH))
+        // a single step results in about 20 correct bits, which is enough for relaxed math
+        return 1;
+    if(has_flag(mathType, MathType::UNSAFE_MATH))
+        return 2;
+    // TODO add a 6th step? Sometimes the float-division is too inaccurate
+    return 5;
+}
+
+/*
+ * Returns the (refined) reciprocal of the given kernel parameter, which is calculated once at the beginning of the
+ * kernel and shared by all divisions by the same parameter with the same accuracy.
+ */
+static Value getUniformReciprocal(Method& method, const Local& divisor, unsigned numSteps)
+{
+    const std::string name = divisor.name + ".fdiv.reciprocal" + std::to_string(numSteps);
+    auto reciprocal = method.createLocal(divisor.type, name)->createReference();
+    if(!reciprocal.local()->getUsers(LocalUse::Type::WRITER).empty())
+        // already calculated for a previous division by the same divisor
+        return reciprocal;
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Calculating reciprocal of work-group uniform divisor: " << divisor.to_string() << logging::endl);
+    auto it = method.begin()->walk().nextInBlock();
+    it = intrinsics::insertRefinedSFUCall(method, it, REG_SFU_RECIP, divisor.createReference(), reciprocal, numSteps);
+    return reciprocal;
+}
+
+InstructionWalker intrinsics::intrinsifyFloatingDivision(
+    Method& method, InstructionWalker it, IntrinsicOperation& op, MathType mathType)
 {
     /*
      * https://dspace.mit.edu/bitstream/handle/1721.1/80133/43609668-MIT.pdf
      * https://en.wikipedia.org/wiki/Division_algorithm#Newton.E2.80.93Raphson_division
      * http://www.rfwireless-world.com/Tutorials/floating-point-tutorial.html
      */
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Intrinsifying floating-point division" << logging::endl);
-
     const Value nominator = op.getFirstArg();
     const Value& divisor = op.assertArgument(1);
     auto outputType = op.getOutput()->type;
@@ -595,39 +819,83 @@ InstructionWalker intrinsics::intrinsifyFloatingDivision(Method& method, Instruc
      * The GLSL shader uses the SFU_RECIP with a Newton-Raphson step "to improve our approximation",
      * see http://anholt.livejournal.com/49474.html
      */
-    it = periphery::insertSFUCall(REG_SFU_RECIP, it, divisor);
-    Value P0 = assign(it, outputType, "%fdiv_recip") = Value(REG_SFU_OUT, TYPE_FLOAT);
-
     // 2. iteration step: Pi+1 = Pi(2 - D * Pi)
-    // run 5 iterations
-    Value P1 = assign(it, outputType, "%fdiv_p1") = divisor * P0;
-    Value P1_1 = assign(it, outputType, "%fdiv_p1") = 2.0_val - P1;
-    Value P1_2 = assign(it, outputType, "%fdiv_p1") = P0 * P1_1;
-
-    Value P2 = assign(it, outputType, "%fdiv_p2") = divisor * P1_2;
-    Value P2_1 = assign(it, outputType, "%fdiv_p2") = 2.0_val - P2;
-    Value P2_2 = assign(it, outputType, "%fdiv_p2") = P1_2 * P2_1;
-
-    Value P3 = assign(it, outputType, "%fdiv_p3") = divisor * P2_2;
-    Value P3_1 = assign(it, outputType, "%fdiv_p3") = 2.0_val - P3;
-    Value P3_2 = assign(it, outputType, "%fdiv_p3") = P2_2 * P3_1;
-
-    Value P4 = assign(it, outputType, "%fdiv_p4") = divisor * P3_2;
-    Value P4_1 = assign(it, outputType, "%fdiv_p4") = 2.0_val - P4;
-    Value P4_2 = assign(it, outputType, "%fdiv_p4") = P3_2 * P4_1;
-
-    Value P5 = assign(it, outputType, "%fdiv_p5") = divisor * P4_2;
-    Value P5_1 = assign(it, outputType, "%fdiv_p5") = 2.0_val - P5;
-    Value P5_2 = assign(it, outputType, "%fdiv_p5") = P4_2 * P5_1;
-
-    // TODO add a 6th step? Sometimes the float-division is too inaccurate
+    auto numSteps = getNumDivisionRefinementSteps(op, mathType);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Intrinsifying floating-point division with " << numSteps << " Newton-Raphson steps: " << op.to_string()
+            << logging::endl);
+    Value reciprocal = UNDEFINED_VALUE;
+    auto local = divisor.checkLocal();
+    if(local && local->as<Parameter>())
+        // kernel parameters are the same for all work-items, so the reciprocal can be calculated once for the kernel
+        reciprocal = getUniformReciprocal(method, *local, numSteps);
+    else if(numSteps == 0)
+    {
+        it = periphery::insertSFUCall(REG_SFU_RECIP, it, divisor);
+        reciprocal = Value(REG_SFU_OUT, nominator.type);
+    }
+    else
+    {
+        reciprocal = method.addNewLocal(outputType, "%fdiv_recip");
+        it = insertRefinedSFUCall(method, it, REG_SFU_RECIP, divisor, reciprocal, numSteps);
+    }
 
     // 3. final step: Q = Pn * N
-    it.reset(new Operation(OP_FMUL, op.getOutput().value(), nominator, P5_2));
+    it.reset((new Operation(OP_FMUL, op.getOutput().value(), nominator, reciprocal))->copyExtrasFrom(it.get()));
 
     return it;
 }
 
+InstructionWalker intrinsics::insertRefinedSFUCall(Method& method, InstructionWalker it, Register sfuReg,
+    const Value& arg, const Value& dest, unsigned numSteps, bool handleSpecialValues)
+{
+    if(sfuReg != REG_SFU_RECIP && sfuReg != REG_SFU_RECIP_SQRT)
+        throw CompilationError(CompilationStep::NORMALIZER,
+            "Newton-Raphson refinement is only supported for (square root) reciprocals", sfuReg.to_string());
+    it = periphery::insertSFUCall(sfuReg, it, arg);
+    if(numSteps == 0)
+    {
+        assign(it, dest) = Value(REG_SFU_OUT, dest.type);
+        return it;
+    }
+    const Value initial = assign(it, dest.type, "%sfu_result") = Value(REG_SFU_OUT, dest.type);
+    // for the reciprocal square root, the steps use half the argument
+    const Value halfArg = sfuReg == REG_SFU_RECIP_SQRT ? (assign(it, dest.type, "%rsqrt_half") = arg * 0.5_val) :
+                                                         UNDEFINED_VALUE;
+    Value approximation = initial;
+    for(unsigned step = 1; step <= numSteps; ++step)
+    {
+        auto next = step == numSteps ? dest : method.addNewLocal(dest.type, "%sfu_refined");
+        if(sfuReg == REG_SFU_RECIP)
+        {
+            // Pi+1 = Pi(2 - x * Pi)
+            auto tmp = assign(it, dest.type, "%recip_error") = arg * approximation;
+            tmp = assign(it, dest.type, "%recip_error") = 2.0_val - tmp;
+            assign(it, next) = approximation * tmp;
+        }
+        else
+        {
+            // Yi+1 = Yi(1.5 - x/2 * Yi * Yi)
+            auto tmp = assign(it, dest.type, "%rsqrt_error") = approximation * approximation;
+            tmp = assign(it, dest.type, "%rsqrt_error") = halfArg * tmp;
+            tmp = assign(it, dest.type, "%rsqrt_error") = 1.5_val - tmp;
+            assign(it, next) = approximation * tmp;
+        }
+        approximation = next;
+    }
+    if(handleSpecialValues)
+    {
+        // x * Pi is NaN for a result of zero (x is +-Inf) or Inf (x is +-0), so use the SFU result directly
+        auto absolute = assign(it, TYPE_INT32.toVectorType(dest.type.getVectorWidth()), "%sfu_abs") =
+            initial & 0x7FFFFFFF_val;
+        assign(it, NOP_REGISTER) = (absolute ^ FLOAT_INF, SetFlag::SET_FLAGS);
+        assign(it, dest) = (initial, COND_ZERO_SET);
+        assign(it, NOP_REGISTER) = (absolute, SetFlag::SET_FLAGS);
+        assign(it, dest) = (initial, COND_ZERO_SET);
+    }
+    return it;
+}
+
 static constexpr unsigned MSB = 31;
 
 Literal intrinsics::asr(Literal left, Literal right)
@@ -669,20 +937,39 @@ Literal intrinsics::clz(Literal val)
 
 Literal intrinsics::smod(DataType type, const Literal& numerator, const Literal& denominator)
 {
-    throw CompilationError(CompilationStep::GENERAL, "SMOD is currently not implemented!");
+    if(type.isFloatingType())
+        return fmod(type, numerator, denominator);
+    if(denominator.signedInt() == 0)
+        throw CompilationError(CompilationStep::GENERAL, "Division by zero", denominator.to_string());
+    auto remainder = srem(type, numerator, denominator).signedInt();
+    if(remainder != 0 && ((remainder < 0) != (denominator.signedInt() < 0)))
+        remainder += denominator.signedInt();
+    return Literal(remainder);
 }
 
 Literal intrinsics::srem(DataType type, const Literal& numerator, const Literal& denominator)
 {
-    throw CompilationError(CompilationStep::GENERAL, "SREM is currently not implemented!");
+    if(type.isFloatingType())
+        return frem(type, numerator, denominator);
+    if(denominator.signedInt() == 0)
+        throw CompilationError(CompilationStep::GENERAL, "Division by zero", denominator.to_string());
+    if(denominator.signedInt() == -1)
+        // also handles INT_MIN % -1, which would overflow
+        return Literal(0);
+    // in C++11 and later, the sign of the remainder is the sign of the numerator
+    return Literal(numerator.signedInt() % denominator.signedInt());
 }
 
 Literal intrinsics::fmod(DataType type, const Literal& numerator, const Literal& denominator)
 {
-    throw CompilationError(CompilationStep::GENERAL, "FMOD is currently not implemented!");
+    auto remainder = std::fmod(numerator.real(), denominator.real());
+    if(remainder != 0.0f && (std::signbit(remainder) != std::signbit(denominator.real())))
+        remainder += denominator.real();
+    return Literal(remainder);
 }
 
 Literal intrinsics::frem(DataType type, const Literal& numerator, const Literal& denominator)
 {
-    throw CompilationError(CompilationStep::GENERAL, "FREM is currently not implemented!");
+    // std::fmod returns the remainder with the sign of the numerator
+    return Literal(std::fmod(numerator.real(), denominator.real()));
 }
@@ -16,6 +16,11 @@ namespace vc4c
         NODISCARD InstructionWalker intrinsifySignedIntegerMultiplication(
             Method& method, InstructionWalker it, intermediate::IntrinsicOperation& op);
         bool canOptimizeMultiplicationWithBinaryMethod(const intermediate::IntrinsicOperation& op);
+        /*
+         * Returns whether both factors are known to be non-negative 24-bit values, in which case the full 32-bit
+         * multiplication can be replaced with a single mul24 instruction
+         */
+        bool canOptimizeMultiplicationWithMul24(const Method& method, const intermediate::IntrinsicOperation& op);
         NODISCARD InstructionWalker intrinsifyUnsignedIntegerMultiplication(
             Method& method, InstructionWalker it, intermediate::IntrinsicOperation& op);
         /**
@@ -35,8 +40,48 @@ namespace vc4c
         NODISCARD InstructionWalker intrinsifyUnsignedIntegerDivisionByConstant(
             Method& method, InstructionWalker it, intermediate::IntrinsicOperation& op, bool useRemainder = false);
 
-        NODISCARD InstructionWalker intrinsifyFloatingDivision(
-            Method& method, InstructionWalker it, intermediate::IntrinsicOperation& op);
+        /*
+         * Returns whether the divisor of the given integer division is a kernel parameter, i.e. uniform for the whole
+         * work-group, so the division can be optimized with #intrinsifyUnsignedIntegerDivisionByUniform or
+         * #intrinsifySignedIntegerDivisionByUniform
+         */
+        bool canOptimizeDivisionByUniform(const intermediate::IntrinsicOperation& op);
+        /*
+         * Converts the division (or remainder) by a work-group uniform 32-bit divisor to a multiplication with the
+         * reciprocal of the divisor (the upper 32 bits of the 64-bit product, calculated from 16-bit half-words with
+         * mul24) and a correction step.
+         *
+         * The reciprocal is calculated once at the beginning of the kernel, and shared by all divisions by the same
+         * divisor, which saves the 32 iterations of the bit-wise division per division.
+         */
+        NODISCARD InstructionWalker intrinsifyUnsignedIntegerDivisionByUniform(
+            Method& method, InstructionWalker it, intermediate::IntrinsicOperation& op, bool useRemainder = false);
+        NODISCARD InstructionWalker intrinsifySignedIntegerDivisionByUniform(
+            Method& method, InstructionWalker it, intermediate::IntrinsicOperation& op, bool useRemainder = false);
+
+        /*
+         * Converts the floating-point division to a multiplication with the reciprocal of the divisor calculated by
+         * the SFU.
+         *
+         * The number of Newton-Raphson steps refining the reciprocal depends on the accuracy required: None for
+         * divisions allowed to use the reciprocal (e.g. native_divide), a single step for fast relaxed math and more
+         * steps otherwise. The reciprocals of kernel parameters are calculated once at the beginning of the kernel.
+         */
+        NODISCARD InstructionWalker intrinsifyFloatingDivision(Method& method, InstructionWalker it,
+            intermediate::IntrinsicOperation& op, MathType mathType = MathType::EXACT);
+
+        /*
+         * Inserts a call to the reciprocal (or reciprocal square root) SFU function followed by the given number of
+         * Newton-Raphson steps refining the result written into the given destination.
+         *
+         * Every step about doubles the number of correct bits of the SFU result (which has an accuracy of about 10 to
+         * 12 bits, see doc/sfu_accuracy.txt), so 2 steps are sufficient for single precision results.
+         *
+         * If the special values are to be handled, the unrefined SFU result is used for zero and infinite results,
+         * since the refinement steps would produce NaN for them.
+         */
+        NODISCARD InstructionWalker insertRefinedSFUCall(Method& method, InstructionWalker it, Register sfuReg,
+            const Value& arg, const Value& dest, unsigned numSteps, bool handleSpecialValues = false);
 
         /*
          * Implementations for on-host calculations
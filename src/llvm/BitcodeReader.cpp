@@ -8,8 +8,11 @@
 
 #ifdef USE_LLVM_LIBRARY
 
+#include "../MappedFile.h"
 #include "../intermediate/IntermediateInstruction.h"
+#include "../intrinsics/ConstantFolding.h"
 #include "../intrinsics/Images.h"
+#include "PassPipeline.h"
 #include "log.h"
 
 #include "llvm-c/Core.h"
@@ -31,9 +34,14 @@ using namespace vc4c;
 using namespace vc4c::llvm2qasm;
 
 // also used by LibClang
-// NOTE: The buffer string needs to outlive the MemoryBuffer object!
+// NOTE: The buffer string (or the memory-mapped file backing the stream) needs to outlive the MemoryBuffer object!
 std::unique_ptr<llvm::MemoryBuffer> fromInputStream(std::istream& stream, std::string& buffer)
 {
+    auto mappedFile = getMappedBuffer(stream);
+    if(mappedFile && mappedFile->size() >= 2 && mappedFile->data()[0] == 'B' && mappedFile->data()[1] == 'C')
+        // directly reference the file contents without copying them. Only done for bit-code, since the parsers for
+        // textual input require the buffer to be null-terminated, which the mapped file is not.
+        return llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(mappedFile->data(), mappedFile->size()), "", false);
     // required, since LLVM cannot read from std::istreams
     if(auto sstream = dynamic_cast<std::istringstream*>(&stream))
         buffer = sstream->str();
@@ -45,7 +53,8 @@ std::unique_ptr<llvm::MemoryBuffer> fromInputStream(std::istream& stream, std::s
         ss << stream.rdbuf();
         buffer = ss.str();
     }
-    return std::unique_ptr<llvm::MemoryBuffer>(llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(buffer)));
+    // the buffer already is a copy of the stream contents, so there is no need to copy it again
+    return llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(buffer));
 }
 
 static AddressSpace toAddressSpace(int num)
@@ -95,12 +104,17 @@ LCOV_EXCL_STOP
 
 BitcodeReader::BitcodeReader(std::istream& stream, SourceType sourceType) : context()
 {
-    std::string tmp;
-    auto buf = fromInputStream(stream, tmp);
+    auto buf = fromInputStream(stream, inputBuffer);
     if(sourceType == SourceType::LLVM_IR_BIN)
     {
         CPPLOG_LAZY(logging::Level::DEBUG, log << "Reading LLVM module from bit-code..." << logging::endl);
+#if LLVM_LIBRARY_VERSION >= 40
+        // Only read the function bodies on demand, since most functions of the module (e.g. the VC4CL std-lib
+        // functions linked in) are never referenced from any kernel. The module takes ownership of the buffer.
+        auto expected = llvm::getOwningLazyBitcodeModule(std::move(buf), context);
+#else
         auto expected = llvm::parseBitcodeFile(buf->getMemBufferRef(), context);
+#endif
         if(!expected)
         {
 #if LLVM_LIBRARY_VERSION >= 40
@@ -451,23 +465,15 @@ static void extractKernelMetadata(
 
 void BitcodeReader::parse(Module& module)
 {
-    const llvm::Module::FunctionListType& functions = llvmModule->getFunctionList();
-
+#if LLVM_LIBRARY_VERSION >= 40
+    if(module.compilationConfig.useOpt)
+        optimizeModule(*llvmModule);
+#endif
     // The global data is explicitly not read here, but on #toConstant() only resolving global data actually used
 
     // parse functions
     // Starting with kernel-functions, recursively parse all included functions (and only those)
-    for(const llvm::Function& func : functions)
-    {
-        if(func.getCallingConv() == llvm::CallingConv::SPIR_KERNEL)
-        {
-            CPPLOG_LAZY(
-                logging::Level::DEBUG, log << "Found SPIR kernel-function: " << func.getName() << logging::endl);
-            Method& kernelFunc = parseFunction(module, func);
-            extractKernelMetadata(kernelFunc, func, *llvmModule, context);
-            kernelFunc.isKernel = true;
-        }
-    }
+    parseKernels(module, true);
 
     // map instructions to intermediate representation
     for(auto& method : parsedFunctions)
@@ -481,6 +487,27 @@ void BitcodeReader::parse(Module& module)
     }
 }
 
+void BitcodeReader::parseDeclarations(Module& module)
+{
+    // the optimizations do not modify the kernel signatures, so there is no need to run them
+    parseKernels(module, false);
+}
+
+void BitcodeReader::parseKernels(Module& module, bool parseBodies)
+{
+    for(const llvm::Function& func : llvmModule->getFunctionList())
+    {
+        if(func.getCallingConv() == llvm::CallingConv::SPIR_KERNEL)
+        {
+            CPPLOG_LAZY(
+                logging::Level::DEBUG, log << "Found SPIR kernel-function: " << func.getName() << logging::endl);
+            Method& kernelFunc = parseFunction(module, func, parseBodies);
+            extractKernelMetadata(kernelFunc, func, *llvmModule, context);
+            kernelFunc.isKernel = true;
+        }
+    }
+}
+
 static DataType& addToMap(DataType&& dataType, const llvm::Type* type, FastMap<const llvm::Type*, DataType>& typesMap)
 {
     return typesMap.emplace(type, dataType).first->second;
@@ -648,12 +675,22 @@ static std::string toParameterName(const llvm::Argument& arg, unsigned& counter)
     return std::string("%") + arg.getName().str();
 }
 
-Method& BitcodeReader::parseFunction(Module& module, const llvm::Function& func)
+Method& BitcodeReader::parseFunction(Module& module, const llvm::Function& func, bool parseBody)
 {
     auto it = parsedFunctions.find(&func);
     if(it != parsedFunctions.end())
         return *it->second.first;
 
+#if LLVM_LIBRARY_VERSION >= 40
+    if(func.isMaterializable())
+    {
+        // the function body (e.g. of a lazy loaded module) is only read when it is required. This also needs to be done
+        // if only the declaration is parsed, since the meta-data attached to the function is read with its body
+        if(auto error = const_cast<llvm::Function&>(func).materialize())
+            throw std::system_error(llvm::errorToErrorCode(std::move(error)), "Error reading LLVM function body");
+    }
+#endif
+
     Method* method = new Method(module);
     module.methods.emplace_back(method);
     parsedFunctions[&func] = std::make_pair(method, LLVMInstructionList{});
@@ -696,7 +733,8 @@ Method& BitcodeReader::parseFunction(Module& module, const llvm::Function& func)
         localMap[&arg] = &param;
     }
 
-    parseFunctionBody(module, *method, parsedFunctions.at(&func).second, func);
+    if(parseBody)
+        parseFunctionBody(module, *method, parsedFunctions.at(&func).second, func);
 
     return *method;
 }
@@ -1373,6 +1411,17 @@ Value BitcodeReader::toConstant(
     }
 }
 
+/*
+ * Converts the constant to a value, storing vector constants in the module (instead of the global vector storage)
+ */
+static Optional<Value> toConstantValue(Module& module, const CompoundConstant& constant)
+{
+    auto value = constant.toValue();
+    if(value && value->checkVector())
+        return module.storeVector(SIMDVector(*value->checkVector()), value->type);
+    return value;
+}
+
 Value BitcodeReader::precalculateConstantExpression(
     Module& module, const llvm::ConstantExpr* expr, Method* method, LLVMInstructionList* instructions)
 {
@@ -1391,171 +1440,117 @@ Value BitcodeReader::precalculateConstantExpression(
     }
     if(expr->getOpcode() == llvm::Instruction::MemoryOps::GetElementPtr)
     {
-        // e.g. in-line getelementptr in load or store instructions
-        if(llvm::dyn_cast<const llvm::GlobalVariable>(expr->getOperand(0)) != nullptr)
+        // e.g. in-line getelementptr in load or store instructions, possibly of other constant getelementptr
+        Value srcContainer = toConstant(module, expr->getOperand(0), method, instructions);
+        std::vector<Value> indices;
+        std::vector<CompoundConstant> constantIndices;
+        indices.reserve(expr->getNumOperands());
+        constantIndices.reserve(expr->getNumOperands());
+        for(unsigned i = 1; i < expr->getNumOperands(); ++i)
         {
-            Value srcGlobal = toConstant(module, expr->getOperand(0), method, instructions);
-            std::vector<Value> indices;
-            bool allIndicesAreZero = true;
-            indices.reserve(expr->getNumOperands());
-            for(unsigned i = 1; i < expr->getNumOperands(); ++i)
-            {
-                indices.emplace_back(toConstant(module, expr->getOperand(i), method, instructions));
-                if(!indices.back().isZeroInitializer())
-                    allIndicesAreZero = false;
-            }
+            indices.emplace_back(toConstant(module, expr->getOperand(i), method, instructions));
+            if(auto index = intrinsics::toCompoundConstant(indices.back()))
+                constantIndices.emplace_back(std::move(index.value()));
+        }
+        Optional<int32_t> offset;
+        if(constantIndices.size() == indices.size())
+            offset = intrinsics::foldConstantElementOffset(
+                toDataType(module, expr->getOperand(0)->getType()), constantIndices);
 
-            if(allIndicesAreZero)
-            {
-                // indices of all zero -> reference to the global itself (or the first entry)
-                // we need to make the type of the value fit the return-type expected
-                srcGlobal.type = toDataType(module, expr->getType());
-                return srcGlobal;
-            }
-            else if(method && instructions)
-            {
-                // insert dynamic calculation of indices
-                auto elementOffset = method->addNewLocal(toDataType(module, expr->getType()), "%constant_offset");
-                instructions->emplace_back(new IndexOf(Value(elementOffset), std::move(srcGlobal), std::move(indices)));
-                return elementOffset;
-            }
-            else
-            {
-                dumpLLVM(expr);
-                throw CompilationError(CompilationStep::PARSER,
-                    "Only constant global getelementptr without offsets are supported for now", expr->getName());
-            }
+        if(offset && *offset == 0)
+        {
+            // offset of zero -> reference to the container itself (or the first entry)
+            // we need to make the type of the value fit the return-type expected
+            srcContainer.type = toDataType(module, expr->getType());
+            return srcContainer;
         }
+        if(offset && srcContainer.getLiteralValue())
+            // constant address, e.g. for the offsetof() pattern of getelementptr on a null pointer
+            return Value(Literal(srcContainer.getLiteralValue()->unsignedInt() + static_cast<uint32_t>(*offset)),
+                toDataType(module, expr->getType()));
+        if(method && instructions)
+        {
+            // insert dynamic calculation of indices
+            auto elementOffset = method->addNewLocal(toDataType(module, expr->getType()), "%constant_offset");
+            instructions->emplace_back(new IndexOf(Value(elementOffset), std::move(srcContainer), std::move(indices)));
+            return elementOffset;
+        }
+        dumpLLVM(expr);
+        throw CompilationError(CompilationStep::PARSER,
+            "Only constant global getelementptr without offsets are supported for now", expr->getName());
     }
-    if(expr->getOpcode() == llvm::Instruction::CastOps::PtrToInt ||
-        expr->getOpcode() == llvm::Instruction::CastOps::IntToPtr ||
-        expr->getOpcode() == llvm::Instruction::CastOps::ZExt)
+
+    const DataType destType = toDataType(module, expr->getType());
+    if(expr->getOpcode() == llvm::Instruction::OtherOps::ICmp || expr->getOpcode() == llvm::Instruction::OtherOps::FCmp)
     {
-        // int <-> pointer cast is a zext (+ type conversion)
-        const Value src = toConstant(module, expr->getOperand(0), method, instructions);
-        const DataType destType = toDataType(module, expr->getType());
-        // if the bit-widths of the source and destination are the the same width, simply return the source
-        // otherwise, simply truncate or zero-extend
-        Value dest(src);
-        dest.type = destType;
-        switch(src.type.getScalarBitCount())
-        {
-        case 32:
+        const auto src0 = intrinsics::toCompoundConstant(toConstant(module, expr->getOperand(0), method, instructions));
+        const auto src1 = intrinsics::toCompoundConstant(toConstant(module, expr->getOperand(1), method, instructions));
+        const DataType boolType = TYPE_BOOL.toVectorType(destType.getVectorWidth());
+        auto comparison = toComparison(static_cast<llvm::CmpInst::Predicate>(expr->getPredicate())).first;
+        if(src0 && src1)
         {
-            switch(destType.getScalarBitCount())
+            if(auto result = intrinsics::foldConstantComparison(comparison, boolType, *src0, *src1))
             {
-            case 32:
-                return dest;
-            case 16:
-                return PACK_INT_TO_SHORT_TRUNCATE(dest, {}).value();
-            case 8:
-                return PACK_INT_TO_CHAR_TRUNCATE(dest, {}).value();
+                if(auto value = toConstantValue(module, *result))
+                    return *value;
             }
-            break;
         }
-        case 16:
-            switch(destType.getScalarBitCount())
-            {
-            case 16:
-                return dest;
-            case 8:
-                return UNPACK_CHAR_TO_INT_ZEXT(dest).value();
-            }
-            break;
-        case 8:
-            switch(destType.getScalarBitCount())
+        dumpLLVM(expr);
+        throw CompilationError(CompilationStep::PARSER, "Failed to pre-calculate constant comparison", comparison);
+    }
+    if(expr->getOpcode() == llvm::Instruction::OtherOps::ShuffleVector)
+    {
+        const auto src0 = toConstantGlobal(module, expr->getOperand(0));
+        const auto src1 = toConstantGlobal(module, expr->getOperand(1));
+        const auto mask = toConstantGlobal(module, expr->getOperand(2));
+        std::vector<uint32_t> indices;
+        if(auto elements = mask.getCompound())
+        {
+            for(const auto& element : *elements)
             {
-            case 32:
-                FALL_THROUGH
-            case 16:
-                return UNPACK_CHAR_TO_INT_ZEXT(dest).value();
-            case 8:
-                return dest;
+                auto index = element.getScalar();
+                indices.push_back(index && !index->isUndefined() ? index->unsignedInt() : 0xFFFFFFFF);
             }
         }
+        if(auto result = intrinsics::foldConstantShuffle(destType, src0, src1, indices))
+        {
+            if(auto value = toConstantValue(module, *result))
+                return *value;
+        }
         dumpLLVM(expr);
-        throw CompilationError(CompilationStep::PARSER, "Unhandled bit-width of type", src.to_string());
+        throw CompilationError(CompilationStep::PARSER, "Failed to pre-calculate constant vector shuffle");
     }
-    if(expr->getOpcode() == llvm::Instruction::OtherOps::ICmp || expr->getOpcode() == llvm::Instruction::OtherOps::FCmp)
-    {
-        const DataType destType = toDataType(module, expr->getType());
-        const DataType boolType = TYPE_BOOL.toVectorType(destType.getVectorWidth());
-
-        const Value src0 = toConstant(module, expr->getOperand(0), method, instructions);
-        const Value src1 = toConstant(module, expr->getOperand(1), method, instructions);
 
-        auto predicate = expr->getPredicate();
-
-        switch(predicate)
+    // arithmetic operations and casts of (non-pointer) constants
+    const Value src0 = toConstant(module, expr->getOperand(0), method, instructions);
+    auto first = intrinsics::toCompoundConstant(src0);
+    Optional<CompoundConstant> second;
+    if(expr->getNumOperands() > 1)
+        second = intrinsics::toCompoundConstant(toConstant(module, expr->getOperand(1), method, instructions));
+    if(first && (expr->getNumOperands() == 1 || second))
+    {
+        if(auto result = intrinsics::foldConstantOperation(expr->getOpcodeName(), destType, *first, second))
         {
-        case llvm::CmpInst::FCMP_FALSE:
-            return Value(Literal(false), boolType);
-        case llvm::CmpInst::FCMP_OEQ:
-            return Value(Literal(src0.getLiteralValue()->real() == src1.getLiteralValue()->real()), boolType);
-        case llvm::CmpInst::FCMP_OGT:
-            return Value(Literal(src0.getLiteralValue()->real() > src1.getLiteralValue()->real()), boolType);
-        case llvm::CmpInst::FCMP_OGE:
-            return Value(Literal(src0.getLiteralValue()->real() >= src1.getLiteralValue()->real()), boolType);
-        case llvm::CmpInst::FCMP_OLT:
-            return Value(Literal(src0.getLiteralValue()->real() < src1.getLiteralValue()->real()), boolType);
-        case llvm::CmpInst::FCMP_OLE:
-            return Value(Literal(src0.getLiteralValue()->real() <= src1.getLiteralValue()->real()), boolType);
-        case llvm::CmpInst::FCMP_ONE:
-            return Value(Literal(src0.getLiteralValue()->real() != src1.getLiteralValue()->real()), boolType);
-        case llvm::CmpInst::FCMP_ORD:
-        case llvm::CmpInst::FCMP_UNO:
-        case llvm::CmpInst::FCMP_UEQ:
-        case llvm::CmpInst::FCMP_UGT:
-        case llvm::CmpInst::FCMP_UGE:
-        case llvm::CmpInst::FCMP_ULT:
-        case llvm::CmpInst::FCMP_ULE:
-        case llvm::CmpInst::FCMP_UNE:
-            break;
-        case llvm::CmpInst::FCMP_TRUE:
-            return Value(Literal(true), destType);
-        case llvm::CmpInst::ICMP_EQ:
-            return Value(
-                Literal(src0.getLiteralValue()->unsignedInt() == src1.getLiteralValue()->unsignedInt()), boolType);
-        case llvm::CmpInst::ICMP_NE:
-            return Value(
-                Literal(src0.getLiteralValue()->unsignedInt() != src1.getLiteralValue()->unsignedInt()), boolType);
-        case llvm::CmpInst::ICMP_UGT:
-            return Value(
-                Literal(src0.getLiteralValue()->unsignedInt() > src1.getLiteralValue()->unsignedInt()), boolType);
-        case llvm::CmpInst::ICMP_UGE:
-            return Value(
-                Literal(src0.getLiteralValue()->unsignedInt() >= src1.getLiteralValue()->unsignedInt()), boolType);
-        case llvm::CmpInst::ICMP_ULT:
-            return Value(
-                Literal(src0.getLiteralValue()->unsignedInt() < src1.getLiteralValue()->unsignedInt()), boolType);
-        case llvm::CmpInst::ICMP_ULE:
-            return Value(
-                Literal(src0.getLiteralValue()->unsignedInt() <= src1.getLiteralValue()->unsignedInt()), boolType);
-        case llvm::CmpInst::ICMP_SGT:
-            return Value(Literal(src0.getLiteralValue()->signedInt() > src1.getLiteralValue()->signedInt()), boolType);
-        case llvm::CmpInst::ICMP_SGE:
-            return Value(Literal(src0.getLiteralValue()->signedInt() >= src1.getLiteralValue()->signedInt()), boolType);
-        case llvm::CmpInst::ICMP_SLT:
-            return Value(Literal(src0.getLiteralValue()->signedInt() < src1.getLiteralValue()->signedInt()), boolType);
-        case llvm::CmpInst::ICMP_SLE:
-            return Value(Literal(src0.getLiteralValue()->signedInt() <= src1.getLiteralValue()->signedInt()), boolType);
-        default:
-            break;
+            if(auto value = toConstantValue(module, *result))
+                return *value;
         }
     }
 
-    OpCode opCode = OpCode::findOpCode(expr->getOpcodeName());
-
-    Optional<Value> result = NO_VALUE;
-    if(opCode.numOperands == 1)
-        result = opCode(toConstant(module, expr->getOperand(0), method, instructions), NO_VALUE).first;
-    else if(opCode.numOperands == 2)
-        result = opCode(toConstant(module, expr->getOperand(0), method, instructions),
-            toConstant(module, expr->getOperand(1), method, instructions))
-                     .first;
+    if(expr->getOpcode() == llvm::Instruction::CastOps::PtrToInt ||
+        expr->getOpcode() == llvm::Instruction::CastOps::IntToPtr ||
+        expr->getOpcode() == llvm::Instruction::CastOps::ZExt)
+    {
+        // int <-> pointer cast of a non-constant value (e.g. the address of a global), the address is 32-bit
+        if(src0.type.getScalarBitCount() == destType.getScalarBitCount())
+        {
+            Value dest(src0);
+            dest.type = destType;
+            return dest;
+        }
+        dumpLLVM(expr);
+        throw CompilationError(CompilationStep::PARSER, "Unhandled bit-width of type", src0.to_string());
+    }
 
-    if(result)
-        return result.value();
     dumpLLVM(expr);
     throw CompilationError(
         CompilationStep::PARSER, "This type of constant expression is not supported yet", expr->getOpcodeName());
@@ -43,8 +43,11 @@ namespace vc4c
             ~BitcodeReader() override = default;
 
             void parse(Module& module) override;
+            void parseDeclarations(Module& module) override;
 
         private:
+            // the copy of the input data, needs to outlast the module which might lazily read from it
+            std::string inputBuffer;
             //"the lifetime of the LLVMContext needs to outlast the module"
             llvm::LLVMContext context;
             std::unique_ptr<llvm::Module> llvmModule;
@@ -53,7 +56,8 @@ namespace vc4c
             // required to support recursive types
             FastMap<const llvm::Type*, DataType> typesMap;
 
-            Method& parseFunction(Module& module, const llvm::Function& func);
+            Method& parseFunction(Module& module, const llvm::Function& func, bool parseBody = true);
+            void parseKernels(Module& module, bool parseBodies);
             void parseFunctionBody(
                 Module& module, Method& method, LLVMInstructionList& instructions, const llvm::Function& func);
             void parseInstruction(
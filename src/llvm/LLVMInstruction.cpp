@@ -465,6 +465,13 @@ bool ContainerInsertion::mapInstruction(Method& method)
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Generating insertion of " << newValue.to_string() << " at " << index.to_string() << " into "
             << container.to_string() << " into " << dest.to_string() << logging::endl);
+    if(intermediate::isSplitStructType(dest.type) && index.getLiteralValue())
+    {
+        // small structs are kept in a local per member, so the insertion is only a copy of the members
+        ignoreReturnValue(intermediate::insertStructInsertion(method.appendToEnd(), method, dest, container,
+            index.getLiteralValue()->unsignedInt(), newValue));
+        return true;
+    }
     // 1. copy whole container
     method.appendToEnd(new intermediate::MoveOperation(std::move(dest), std::move(container)));
     // 2. insert new element
@@ -494,7 +501,12 @@ bool ContainerExtraction::mapInstruction(Method& method)
         log << "Generation extraction of " << elementType.to_string() << " at " << index.to_string() << " from "
             << container.to_string() << " into " << dest.to_string() << logging::endl);
 
-    if(container.type.isVectorType() || index.hasLiteral(Literal(0u)))
+    if(intermediate::isSplitStructType(container.type) && index.getLiteralValue())
+    {
+        ignoreReturnValue(intermediate::insertStructExtraction(
+            method.appendToEnd(), method, container, index.getLiteralValue()->unsignedInt(), dest));
+    }
+    else if(container.type.isVectorType() || index.hasLiteral(Literal(0u)))
     {
         ignoreReturnValue(intermediate::insertVectorExtraction(method.appendToEnd(), method, container, index, dest));
     }
@@ -556,6 +568,21 @@ bool PhiNode::mapInstruction(Method& method)
 {
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Generating Phi-Node with " << labels.size() << " options into " << dest.to_string() << logging::endl);
+    if(intermediate::isSplitStructType(dest.type))
+    {
+        // small structs are kept in a local per member, so we need a phi-node per member
+        for(unsigned i = 0; i < dest.type.getStructType()->elementTypes.size(); ++i)
+        {
+            std::vector<std::pair<Value, const Local*>> memberLabels;
+            memberLabels.reserve(labels.size());
+            for(const auto& label : labels)
+                memberLabels.emplace_back(intermediate::getSplitStructMember(method, label.first, i), label.second);
+            method.appendToEnd((new intermediate::PhiNode(
+                                    intermediate::getSplitStructMember(method, dest, i), std::move(memberLabels)))
+                                   ->addDecorations(decorations));
+        }
+        return true;
+    }
     method.appendToEnd((new intermediate::PhiNode(std::move(dest), std::move(labels)))->addDecorations(decorations));
     return true;
 }
@@ -586,6 +613,19 @@ bool Selection::mapInstruction(Method& method)
     else
         method.appendToEnd(new intermediate::MoveOperation(NOP_REGISTER, cond, COND_ALWAYS, SetFlag::SET_FLAGS));
 
+    if(intermediate::isSplitStructType(dest.type))
+    {
+        // small structs are kept in a local per member, so we select every member on its own
+        for(unsigned i = 0; i < dest.type.getStructType()->elementTypes.size(); ++i)
+        {
+            auto member = intermediate::getSplitStructMember(method, dest, i);
+            method.appendToEnd(new intermediate::MoveOperation(
+                member, intermediate::getSplitStructMember(method, opt1, i), COND_ZERO_CLEAR));
+            method.appendToEnd(new intermediate::MoveOperation(
+                member, intermediate::getSplitStructMember(method, opt2, i), COND_ZERO_SET));
+        }
+        return true;
+    }
     method.appendToEnd(new intermediate::MoveOperation(Value(dest), std::move(opt1), COND_ZERO_CLEAR));
     method.appendToEnd(new intermediate::MoveOperation(std::move(dest), std::move(opt2), COND_ZERO_SET));
     return true;
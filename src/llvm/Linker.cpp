@@ -0,0 +1,139 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "Linker.h"
+
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+
+#include "../Profiler.h"
+#include "CompilationError.h"
+#include "log.h"
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_os_ostream.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <system_error>
+
+using namespace vc4c;
+
+extern std::unique_ptr<llvm::MemoryBuffer> fromInputStream(std::istream& stream, std::string& buffer);
+
+struct StandardLibraryBuffer
+{
+    time_t lastModified;
+    off_t fileSize;
+    std::shared_ptr<const llvm::MemoryBuffer> buffer;
+};
+
+static std::shared_ptr<const llvm::MemoryBuffer> getStandardLibraryBuffer(const std::string& stdlibModule)
+{
+    // the std-lib module file is only read (mapped) once per path, unless it was modified in the meantime
+    static std::map<std::string, StandardLibraryBuffer> buffers;
+    static std::mutex bufferLock;
+    struct stat info = {};
+    if(stat(stdlibModule.data(), &info) != 0)
+        throw CompilationError(CompilationStep::LINKER,
+            std::string("Failed to access VC4CL std-lib module: ") + strerror(errno), stdlibModule);
+    std::lock_guard<std::mutex> guard(bufferLock);
+    auto& entry = buffers[stdlibModule];
+    if(!entry.buffer || entry.lastModified != info.st_mtime || entry.fileSize != info.st_size)
+    {
+        PROFILE_START(LoadStandardLibraryModule);
+        // large files are memory-mapped by LLVM
+        auto buf = llvm::MemoryBuffer::getFile(stdlibModule);
+        PROFILE_END(LoadStandardLibraryModule);
+        if(!buf)
+            throw CompilationError(
+                CompilationStep::LINKER, "Failed to read VC4CL std-lib module: " + buf.getError().message(), stdlibModule);
+        // the previous buffer is kept alive by the linking still using it
+        entry = StandardLibraryBuffer{info.st_mtime, info.st_size, std::move(buf.get())};
+    }
+    return entry.buffer;
+}
+
+static std::unique_ptr<llvm::Module> checkModule(llvm::Expected<std::unique_ptr<llvm::Module>>&& expected)
+{
+    if(!expected)
+        throw std::system_error(llvm::errorToErrorCode(expected.takeError()), "Error parsing LLVM module");
+    return std::move(expected.get());
+}
+
+void llvm2qasm::linkInStandardLibrary(std::istream& input, std::ostream& output, const std::string& stdlibModule)
+{
+    PROFILE_START(LinkInStandardLibrary);
+    llvm::LLVMContext context;
+    std::string tmp;
+    auto inputBuffer = fromInputStream(input, tmp);
+    auto module = checkModule(llvm::parseBitcodeFile(inputBuffer->getMemBufferRef(), context));
+
+    // lazily loaded modules only parse the function bodies actually materialized by the linker, so the buffer needs to
+    // be kept alive until the linking is done
+    auto stdlibBuffer = getStandardLibraryBuffer(stdlibModule);
+    auto stdlib = checkModule(llvm::getLazyBitcodeModule(stdlibBuffer->getMemBufferRef(), context));
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Linking VC4CL std-lib module '" << stdlibModule << "' into module with " << module->size()
+            << " functions..." << logging::endl);
+    // only pull in the std-lib functions which are actually used by the module
+    if(llvm::Linker::linkModules(*module, std::move(stdlib), llvm::Linker::Flags::LinkOnlyNeeded))
+        throw CompilationError(CompilationStep::LINKER, "Failed to link in VC4CL std-lib module", stdlibModule);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Linked module contains " << module->size() << " functions" << logging::endl);
+
+    llvm::raw_os_ostream out(output);
+#if LLVM_LIBRARY_VERSION >= 70
+    llvm::WriteBitcodeToFile(*module, out);
+#else
+    llvm::WriteBitcodeToFile(module.get(), out);
+#endif
+    PROFILE_END(LinkInStandardLibrary);
+}
+
+void llvm2qasm::linkModules(const std::vector<std::istream*>& inputs, std::ostream& output, bool onlyNeeded)
+{
+    if(inputs.empty())
+        throw CompilationError(CompilationStep::LINKER, "Cannot link without input modules!");
+    PROFILE_START(LinkLLVMModulesInProcess);
+    llvm::LLVMContext context;
+    std::string tmp;
+    auto buffer = fromInputStream(*inputs.front(), tmp);
+    auto module = checkModule(llvm::parseBitcodeFile(buffer->getMemBufferRef(), context));
+    llvm::Linker linker(*module);
+    unsigned flags = llvm::Linker::Flags::OverrideFromSrc;
+    if(onlyNeeded)
+        flags |= llvm::Linker::Flags::LinkOnlyNeeded;
+    for(auto it = std::next(inputs.begin()); it != inputs.end(); ++it)
+    {
+        buffer = fromInputStream(**it, tmp);
+        if(linker.linkInModule(checkModule(llvm::parseBitcodeFile(buffer->getMemBufferRef(), context)), flags))
+            throw CompilationError(CompilationStep::LINKER, "Failed to link LLVM modules");
+    }
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Linked " << inputs.size() << " modules into module with " << module->size() << " functions"
+            << logging::endl);
+
+    llvm::raw_os_ostream out(output);
+#if LLVM_LIBRARY_VERSION >= 70
+    llvm::WriteBitcodeToFile(*module, out);
+#else
+    llvm::WriteBitcodeToFile(module.get(), out);
+#endif
+    PROFILE_END(LinkLLVMModulesInProcess);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_LLVM_LINKER_H
+#define VC4C_LLVM_LINKER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace vc4c
+{
+    namespace llvm2qasm
+    {
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+        /*
+         * Links the VC4CL standard-library module at the given path into the LLVM module read from the input and writes
+         * the resulting module as LLVM bitcode into the output.
+         *
+         * In contrast to linking via llvm-link, the standard-library module is only read from disk (memory-mapped) once
+         * per process and only the functions actually referenced by the input module are materialized.
+         */
+        void linkInStandardLibrary(std::istream& input, std::ostream& output, const std::string& stdlibModule);
+
+        /*
+         * Links the LLVM modules read from the given inputs into a single module and writes it as LLVM bitcode into the
+         * output.
+         *
+         * As with "llvm-link -override", all but the first module may override symbols already defined by the
+         * previous modules (e.g. the VC4CL std-lib functions compiled into multiple modules). If onlyNeeded is set,
+         * only the symbols of the following modules referenced by the previous modules are linked in.
+         */
+        void linkModules(const std::vector<std::istream*>& inputs, std::ostream& output, bool onlyNeeded = false);
+#endif
+    } /* namespace llvm2qasm */
+} /* namespace vc4c */
+
+#endif /* VC4C_LLVM_LINKER_H */
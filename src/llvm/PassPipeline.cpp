@@ -0,0 +1,112 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "PassPipeline.h"
+
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+
+#include "../Profiler.h"
+#include "log.h"
+
+#include "llvm/IR/CallingConv.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar.h"
+#if LLVM_LIBRARY_VERSION >= 100
+#include "llvm/Transforms/Scalar/GVN.h"
+#endif
+#if LLVM_LIBRARY_VERSION >= 70
+#include "llvm/Transforms/Utils.h"
+#endif
+#include "llvm/Transforms/Vectorize.h"
+
+#include <mutex>
+#include <system_error>
+
+using namespace vc4c;
+
+// the native SIMD vector width of the VC4 QPUs
+static constexpr unsigned VECTOR_WIDTH = 16;
+
+static void forceVectorWidth()
+{
+    /*
+     * The loop vectorizer determines the vector width from the target, which we do not have for SPIR modules, so
+     * force the width like "opt -force-vector-width" does.
+     *
+     * NOTE: This option is global for the whole process, but since the SPIR target has no vector registers, it is
+     * not used otherwise anyway.
+     */
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        auto& options = llvm::cl::getRegisteredOptions();
+        auto it = options.find("force-vector-width");
+        if(it != options.end())
+            static_cast<llvm::cl::opt<unsigned>*>(it->second)->setValue(VECTOR_WIDTH);
+        else
+            CPPLOG_LAZY(logging::Level::WARNING,
+                log << "Failed to force LLVM loop vectorization width, loops will not be vectorized" << logging::endl);
+    });
+}
+
+static void addPasses(llvm::legacy::PassManager& passes)
+{
+    // only kernels are called from the outside, so all other functions (including the std-lib functions) can be
+    // removed if they are not referenced by any kernel
+    passes.add(llvm::createInternalizePass([](const llvm::GlobalValue& val) -> bool {
+        auto func = llvm::dyn_cast<llvm::Function>(&val);
+        return func && func->getCallingConv() == llvm::CallingConv::SPIR_KERNEL;
+    }));
+    passes.add(llvm::createGlobalDCEPass());
+
+    // we inline all functions into the kernels anyway, so do it early to have more optimization opportunities
+    passes.add(llvm::createFunctionInliningPass());
+    passes.add(llvm::createSROAPass());
+    passes.add(llvm::createEarlyCSEPass());
+    passes.add(llvm::createInstructionCombiningPass());
+    passes.add(llvm::createCFGSimplificationPass());
+    passes.add(llvm::createReassociatePass());
+
+    // simplify and vectorize loops
+    passes.add(llvm::createLoopRotatePass());
+    passes.add(llvm::createLICMPass());
+    passes.add(llvm::createIndVarSimplifyPass());
+    passes.add(llvm::createLoopUnrollPass());
+    passes.add(llvm::createLoopVectorizePass());
+
+    // clean up
+    passes.add(llvm::createInstructionCombiningPass());
+    passes.add(llvm::createGVNPass());
+    passes.add(llvm::createDeadStoreEliminationPass());
+    passes.add(llvm::createAggressiveDCEPass());
+    passes.add(llvm::createCFGSimplificationPass());
+    passes.add(llvm::createGlobalDCEPass());
+}
+
+void llvm2qasm::optimizeModule(llvm::Module& module)
+{
+    PROFILE_START(OptimizeLLVMModule);
+    // the passes need to see all function bodies
+    if(auto error = module.materializeAll())
+        throw std::system_error(llvm::errorToErrorCode(std::move(error)), "Error materializing LLVM module");
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Running LLVM optimization passes on module with " << module.size() << " functions..."
+            << logging::endl);
+
+    forceVectorWidth();
+    llvm::legacy::PassManager passes;
+    addPasses(passes);
+    passes.run(module);
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Optimized LLVM module contains " << module.size() << " functions" << logging::endl);
+    PROFILE_END(OptimizeLLVMModule);
+}
+
+#endif
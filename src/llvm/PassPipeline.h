@@ -0,0 +1,33 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_LLVM_PASS_PIPELINE_H
+#define VC4C_LLVM_PASS_PIPELINE_H
+
+namespace llvm
+{
+    class Module;
+} /* namespace llvm */
+
+namespace vc4c
+{
+    namespace llvm2qasm
+    {
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+        /*
+         * Runs the LLVM optimization passes on the given (possibly lazily loaded) module in-process.
+         *
+         * This replaces running "opt -force-vector-width=16 -O3" on the pre-compiled module with a pass list tailored
+         * to the VC4: All functions not reachable from any kernel (e.g. the unused VC4CL std-lib functions) are
+         * removed first, then the functions are inlined and simplified and the loops are vectorized to the native
+         * SIMD width of 16 elements.
+         */
+        void optimizeModule(llvm::Module& module);
+#endif
+    } /* namespace llvm2qasm */
+} /* namespace vc4c */
+
+#endif /* VC4C_LLVM_PASS_PIPELINE_H */
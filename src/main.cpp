@@ -5,9 +5,11 @@
  */
 
 #include "./optimization/Optimizer.h"
+#include "CompilationServer.h"
 #include "Compiler.h"
 #include "Precompiler.h"
 #include "Profiler.h"
+#include "VC4C.h"
 #include "concepts.h"
 #include "config.h"
 #include "log.h"
@@ -27,6 +29,7 @@ using namespace std;
 using namespace vc4c;
 
 extern void disassemble(const std::string& input, const std::string& output, const OutputMode outputMode);
+extern void disassembleTable(const std::string& input, const std::string& output, DisassemblyTable format);
 
 static void printHelp()
 {
@@ -44,6 +47,7 @@ static void printHelp()
 
     std::cout << "optimizations:" << std::endl;
     std::cout << "\t-O0,-O1,-O2,-O3\t\t\tSwitches to the specific optimization level, defaults to -O2" << std::endl;
+    std::cout << "\t-Os\t\t\t\tOptimizes for small code size, e.g. to reduce instruction cache misses" << std::endl;
     for(const auto& pass : vc4c::optimizations::Optimizer::ALL_PASSES)
     {
         std::cout << "\t--f" << std::left << std::setw(28) << pass.parameterName << pass.description << std::endl;
@@ -66,7 +70,39 @@ static void printHelp()
     std::cout << "\t--foptimization-iterations=" << defaultConfig.additionalOptions.maxOptimizationIterations
               << "\tThe maximum number of iterations to repeat the optimizations in" << std::endl;
     std::cout << "\t--fcommon-subexpression-threshold=" << defaultConfig.additionalOptions.maxCommonExpressionDinstance
-              << "\tThe maximum distance for two common subexpressions to be combined" << std::endl;
+              << "\tThe maximum distance for two expressions to be combined" << std::endl;
+    std::cout << "\t--funroll-threshold=" << defaultConfig.additionalOptions.maxUnrolledLoopSize
+              << "\tThe maximum number of instructions of an unrolled loop" << std::endl;
+    std::cout << "\t--ftail-duplication-threshold=" << defaultConfig.additionalOptions.maxTailDuplicationSize
+              << "\tThe maximum number of instructions of a block to be copied into its predecessors" << std::endl;
+    std::cout << "\t--fconstant-pool-threshold=" << defaultConfig.additionalOptions.constantPoolThreshold
+              << "\tThe minimum number of instructions saved to load a constant vector from memory" << std::endl;
+    std::cout << "\t--floop-alignment=" << defaultConfig.additionalOptions.loopAlignment
+              << "\tThe alignment (in instructions) of loop heads, e.g. the instruction cache line size" << std::endl;
+    std::cout << "\t--fpass-time-budget=" << defaultConfig.additionalOptions.passTimeBudget
+              << "\tThe maximum time (in ms) a single optimization pass may take per kernel, 0 for unlimited"
+              << std::endl;
+    std::cout << "\t--fkernel-time-budget=" << defaultConfig.additionalOptions.kernelTimeBudget
+              << "\tThe maximum time (in ms) all optimization passes may take per kernel, 0 for unlimited"
+              << std::endl;
+
+    std::cout << "target profile parameters:" << std::endl;
+    std::cout << "\t--target-qpus=" << defaultConfig.target.numQPUs
+              << "\tThe number of QPUs available for user programs, limits the work-group size" << std::endl;
+    std::cout << "\t--target-vpm-size=" << defaultConfig.target.availableVPMSize
+              << "\tThe size (in bytes) of the VPM reserved for user programs" << std::endl;
+    std::cout << "\t--target-icache-size=" << defaultConfig.target.instructionCacheSize
+              << "\tThe size (in instructions) of the instruction cache per QPU slice" << std::endl;
+    std::cout << "\t--target-tmu-cache-size=" << defaultConfig.target.tmuCacheSize
+              << "\tThe size (in bytes) of the TMU cache" << std::endl;
+    std::cout << "\t--target-tmu-latency=" << defaultConfig.target.tmuLoadLatency
+              << "\tThe number of instructions to schedule between a TMU request and reading its result" << std::endl;
+    std::cout << "\t--target-dma-load-latency=" << defaultConfig.target.vpmDMALoadLatency
+              << "\tThe number of instructions to schedule between a VPM DMA load and waiting for it" << std::endl;
+    std::cout << "\t--target-dma-store-latency=" << defaultConfig.target.vpmDMAStoreLatency
+              << "\tThe number of instructions to schedule between a VPM DMA store and waiting for it" << std::endl;
+    std::cout << "\t--target-mutex-latency=" << defaultConfig.target.mutexAcquireLatency
+              << "\tThe expected number of cycles a QPU stalls when acquiring the hardware mutex" << std::endl;
 
     std::cout << "options:" << std::endl;
     std::cout << "\t--kernel-info\t\tWrite the kernel-info meta-data (as required by VC4CL run-time, default)"
@@ -74,8 +110,67 @@ static void printHelp()
     std::cout << "\t--no-kernel-info\tDont write the kernel-info meta-data" << std::endl;
     std::cout << "\t--spirv\t\t\tExplicitely use the SPIR-V front-end" << std::endl;
     std::cout << "\t--llvm\t\t\tExplicitely use the LLVM-IR front-end" << std::endl;
+    std::cout << "\t--cache-dir=<dir>\tStore compilation results in and reuse them from the given directory"
+              << std::endl;
+    std::cout << "\t--cache-size=<bytes>\tThe maximum size of the compilation cache, defaults to "
+              << defaultConfig.maxCacheSize << std::endl;
+    std::cout << "\t--max-memory=<bytes>\tThe estimated memory all concurrently compiled kernels may use, also the "
+                 "soft limit triggering memory-saving behavior, defaults to unlimited"
+              << std::endl;
+    std::cout << "\t--write-module=<file>\tWrite the prepared module to the given file, which can be used as input to "
+                 "later compilations"
+              << std::endl;
+    std::cout << "\t--object\t\tWrite the prepared module as relocatable object instead of machine code, to be "
+                 "linked with other objects via --link"
+              << std::endl;
+    std::cout << "\t--profile-generate=<file>\tWrite the positions of the basic blocks to the given file, which can be "
+                 "passed to the emulator to create an execution profile"
+              << std::endl;
+    std::cout << "\t--profile-use=<file>\tUse the execution profile created by the emulator to guide optimizations"
+              << std::endl;
+    std::cout << "\t--write-statistics=<file>\tWrite statistics about the code generated for every kernel as JSON to "
+                 "the given file"
+              << std::endl;
+    std::cout << "\t--trace=<file>\t\tWrite the duration and peak memory usage of all compilation steps to the given "
+                 "file in the Chrome trace event format"
+              << std::endl;
+    std::cout << "\t--write-ir=<file>\tWrite the intermediate code of every kernel after running the optimization "
+                 "passes to the given file"
+              << std::endl;
+    std::cout << "\t--memory-report=<file>\tWrite the peak memory usage of all compilation stages of every kernel to "
+                 "the given file as JSON"
+              << std::endl;
     std::cout << "\t--verification-error\tAbort if instruction verification failed" << std::endl;
     std::cout << "\t--no-verification-error\tContinue if instruction verification failed" << std::endl;
+    std::cout << "\t--sectioned-binary\tWrite the binary output with a kernel index and one section per kernel"
+              << std::endl;
+    std::cout << "\t--coarsen-work-items\tExecute multiple work-items per QPU for fitting compile-time work-group sizes"
+              << std::endl;
+    std::cout << "\t--threaded\tGenerate code for two hardware threads per QPU, switching threads on TMU loads"
+              << std::endl;
+    std::cout << "\t--spirv-opt\tRun the SPIRV-Tools optimizer on SPIR-V modules before parsing them" << std::endl;
+    std::cout << "\t--precompute-uniforms\tCalculate work-group uniform values host-side and pass them as additional "
+                 "UNIFORMs (requires support by the runtime)"
+              << std::endl;
+    std::cout << "\t--dynamic-work-distribution\tLet the QPUs fetch the next work-item from a shared counter "
+                 "instead of iterating over fixed work-items"
+              << std::endl;
+    std::cout << "\t--register-allocator=greedy|coalescing|linear-scan\tThe algorithm to assign locals to registers, "
+                 "'coalescing' orders the locals by simplifying the interference graph and assigns copied locals to "
+                 "the same register, 'linear-scan' assigns the locals in the order of their first use"
+              << std::endl;
+    std::cout << "\t--specialize=<kernel>:<variant>:<index>=<value>[,<index>=<value>...]\tAdditionally compile the "
+                 "kernel variant with the parameters at the given indices bound to the given (bit-pattern) values"
+              << std::endl;
+    std::cout << "\t--fuse=<fused>:<kernel>[=<index>,...][+<kernel>[=<index>,...]...]\tAdditionally compile a kernel "
+                 "executing the given kernels one after the other, with their parameters mapped to the parameters "
+                 "of the fused kernel at the given indices"
+              << std::endl;
+    std::cout << "\t--kernel-version=<kernel>:<version>:<assumption>[,<assumption>...]\tAdditionally compile the "
+                 "kernel version optimized for the given run-time assumptions (align=<bytes> for the alignment of all "
+                 "buffers, no-alias for non-overlapping buffers, work-group-size=<x>[x<y>[x<z>]]), the runtime needs "
+                 "to check the assumptions before launching the version"
+              << std::endl;
     std::cout << "\tany other option is passed to the pre-compiler" << std::endl;
 
     std::cout << "modes:" << std::endl;
@@ -85,9 +180,22 @@ static void printHelp()
     std::cout << "\t--disassemble\t\tDisassembles the binary input to either hex or assembler output. Only supports "
                  "the input-, output- and logging-flags listed above."
               << std::endl;
+    std::cout << "\t--disassemble-table=csv|json\tDisassembles the binary input into a machine-readable table with "
+                 "one entry per instruction. Only supports the input-, output- and logging-flags listed above."
+              << std::endl;
+    std::cout << "\t--link\t\t\tLinks the relocatable objects given as input (see --object) into a single module "
+                 "and compiles it to machine code. Supports all options except for the pre-compiler options."
+              << std::endl;
     std::cout << "\t--precompile-stdlib\tPre-compiles the the VC4CLStdLib.h header file given as input "
                  "into the folder specified as output. Ignores all other options except for the logging flags"
               << std::endl;
+    std::cout << "\t--server <socket>\tRuns a compilation server accepting compilation requests on the given UNIX "
+                 "socket. Only supports the logging-flags listed above."
+              << std::endl;
+    std::cout << "\t--connect <socket>\tSends the compilation of the single input file to the compilation server "
+                 "listening on the given UNIX socket. Options writing additional files (e.g. --write-ir) or using the "
+                 "compilation cache are rejected by the server"
+              << std::endl;
 }
 
 #ifndef LLVM_LIBRARY_VERSION
@@ -173,7 +281,14 @@ int main(int argc, char** argv)
     std::string outputFile;
     std::string options;
     bool runDisassembler = false;
+    Optional<DisassemblyTable> disassemblyTable;
     bool precompileStdlib = false;
+    bool writeObject = false;
+    bool linkObjects = false;
+    std::string serverSocket;
+    std::string connectSocket;
+    // the arguments forwarded to the compilation server
+    std::vector<std::string> compilationArgs;
 
     if(argc == 1)
     {
@@ -221,8 +336,36 @@ int main(int argc, char** argv)
         }
         else if(strcmp("--disassemble", argv[i]) == 0)
             runDisassembler = true;
+        else if(strstr(argv[i], "--disassemble-table=") == argv[i])
+        {
+            const std::string format = argv[i] + strlen("--disassemble-table=");
+            if(format == "csv")
+                disassemblyTable = DisassemblyTable::CSV;
+            else if(format == "json")
+                disassemblyTable = DisassemblyTable::JSON;
+            else
+            {
+                std::cerr << "Unknown disassembly table format '" << format << "', aborting!" << std::endl;
+                return 7;
+            }
+            runDisassembler = true;
+        }
         else if(strcmp("--precompile-stdlib", argv[i]) == 0)
             precompileStdlib = true;
+        else if(strcmp("--object", argv[i]) == 0)
+            writeObject = true;
+        else if(strcmp("--link", argv[i]) == 0)
+            linkObjects = true;
+        else if(strcmp("--server", argv[i]) == 0 || strcmp("--connect", argv[i]) == 0)
+        {
+            if(i + 1 == argc)
+            {
+                std::cerr << "No socket specified after " << argv[i] << ", aborting!" << std::endl;
+                return 7;
+            }
+            (strcmp("--server", argv[i]) == 0 ? serverSocket : connectSocket) = argv[i + 1];
+            ++i;
+        }
         else if(strcmp("-o", argv[i]) == 0)
         {
             if(i + 1 == argc)
@@ -236,9 +379,13 @@ int main(int argc, char** argv)
             // increment `i` more than usual, because argv[i + 1] is already consumed
             i += 1;
         }
-        else if(!vc4c::tools::parseConfigurationParameter(config, argv[i]) || strstr(argv[i], "-cl") == argv[i])
-            // pass every not understood option to the pre-compiler, as well as every OpenCL compiler option
-            options.append(argv[i]).append(" ");
+        else
+        {
+            compilationArgs.emplace_back(argv[i]);
+            if(!vc4c::tools::parseConfigurationParameter(config, argv[i]) || strstr(argv[i], "-cl") == argv[i])
+                // pass every not understood option to the pre-compiler, as well as every OpenCL compiler option
+                options.append(argv[i]).append(" ");
+        }
     }
 
     if(&logStream.get() == &std::wcout && outputFile == "-")
@@ -248,6 +395,9 @@ int main(int argc, char** argv)
     }
     setLogger(logStream, colorLog, minLevel);
 
+    if(!serverSocket.empty())
+        return runCompilationServer(serverSocket);
+
     if(inputFiles.empty())
     {
         std::cerr << "No input file(s) specified, aborting!" << std::endl;
@@ -259,18 +409,23 @@ int main(int argc, char** argv)
         std::string postfix;
         if(inputFiles.size() == 1)
         {
-            switch(config.outputMode)
-            {
-            case OutputMode::BINARY:
-                postfix = ".bin";
-                break;
-            case OutputMode::HEX:
-                postfix = ".hex";
-                break;
-            case OutputMode::ASSEMBLER:
-                postfix = ".s";
-                break;
-            }
+            if(disassemblyTable)
+                postfix = *disassemblyTable == DisassemblyTable::CSV ? ".csv" : ".json";
+            else if(writeObject)
+                postfix = ".o";
+            else
+                switch(config.outputMode)
+                {
+                case OutputMode::BINARY:
+                    postfix = ".bin";
+                    break;
+                case OutputMode::HEX:
+                    postfix = ".hex";
+                    break;
+                case OutputMode::ASSEMBLER:
+                    postfix = ".s";
+                    break;
+                }
             outputFile = inputFiles[0] + postfix;
         }
         else
@@ -290,7 +445,10 @@ int main(int argc, char** argv)
         }
         CPPLOG_LAZY(logging::Level::DEBUG,
             log << "Disassembling '" << inputFiles[0] << "' into '" << outputFile << "'..." << logging::endl);
-        disassemble(inputFiles[0], outputFile, config.outputMode);
+        if(disassemblyTable)
+            disassembleTable(inputFiles[0], outputFile, *disassemblyTable);
+        else
+            disassemble(inputFiles[0], outputFile, config.outputMode);
         return 0;
     }
     if(precompileStdlib)
@@ -308,6 +466,47 @@ int main(int argc, char** argv)
         return 0;
     }
 
+    if(!connectSocket.empty())
+    {
+        if(inputFiles.size() != 1)
+        {
+            std::cerr << "For compiling via a compilation server, a single input file must be specified, aborting!"
+                      << std::endl;
+            return 4;
+        }
+        std::ifstream input(inputFiles[0], std::ios_base::in | std::ios_base::binary);
+        if(!input.is_open())
+            throw CompilationError(CompilationStep::PRECOMPILATION, "cannot find file", inputFiles[0]);
+        std::ofstream output(outputFile == "-" ? "/dev/stdout" : outputFile,
+            std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+        return runCompilationClient(connectSocket, compilationArgs, input, output);
+    }
+
+    if(linkObjects)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Linking '" << to_string<std::string>(inputFiles, "', '") << "' into '" << outputFile << "'..."
+                << logging::endl);
+        std::vector<std::unique_ptr<std::istream>> fileStreams;
+        std::vector<std::istream*> objects;
+        for(const std::string& file : inputFiles)
+        {
+            auto ifs = new std::ifstream(file, std::ios_base::in | std::ios_base::binary);
+            if(!ifs->is_open())
+                throw CompilationError(CompilationStep::LINKER, "cannot find file", file);
+            fileStreams.emplace_back(ifs);
+            objects.push_back(fileStreams.back().get());
+        }
+        std::ofstream output(outputFile == "-" ? "/dev/stdout" : outputFile,
+            std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+        PROFILE_START(Compiler);
+        Compiler::linkObjects(objects, output, config);
+        PROFILE_END(Compiler);
+
+        PROFILE_RESULTS();
+        return 0;
+    }
+
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Compiling '" << to_string<std::string>(inputFiles, "', '") << "' into '" << outputFile
             << "' with optimization level " << static_cast<unsigned>(config.optimizationLevel) << " and options '"
@@ -350,7 +549,10 @@ int main(int argc, char** argv)
     std::ofstream output(outputFile == "-" ? "/dev/stdout" : outputFile,
         std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
     PROFILE_START(Compiler);
-    Compiler::compile(*input, output, config, options, inputFile);
+    if(writeObject)
+        Compiler::compileObject(*input, output, config, options, inputFile);
+    else
+        Compiler::compile(*input, output, config, options, inputFile);
     PROFILE_END(Compiler);
 
     PROFILE_RESULTS();
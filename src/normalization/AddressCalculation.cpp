@@ -7,6 +7,7 @@
 #include "AddressCalculation.h"
 
 #include "../InstructionWalker.h"
+#include "../Method.h"
 #include "../intermediate/operators.h"
 #include "../periphery/VPM.h"
 #include "log.h"
@@ -27,6 +28,7 @@ MemoryAccessType normalization::toMemoryAccessType(periphery::VPMUsage usage)
         return MemoryAccessType::VPM_SHARED_ACCESS;
     case periphery::VPMUsage::REGISTER_SPILLING:
     case periphery::VPMUsage::STACK:
+    case periphery::VPMUsage::DMA_BUFFER:
         return MemoryAccessType::VPM_PER_QPU;
     }
     throw CompilationError(CompilationStep::NORMALIZER,
@@ -219,3 +221,155 @@ InstructionWalker normalization::insertAddressToWorkItemSpecificOffset(
             (dynamicParts->first << range.typeSizeShift->assertArgument(1), dynamicParts->second);
     return it;
 }
+
+/*
+ * The canonical form of an address offset: variablePart * factor + constantPart
+ *
+ * NOTE: Since all calculations are modulo 2^32, the factor and constant part are stored as unsigned values.
+ */
+struct CanonicalOffset
+{
+    Value variablePart;
+    uint32_t factor;
+    uint32_t constantPart;
+};
+
+// the maximum number of instructions followed back when canonicalizing an address offset
+static constexpr unsigned MAX_OFFSET_DEPTH = 4;
+
+static Optional<Literal> getConstantLiteral(const Value& val)
+{
+    auto constant = val.getConstantValue();
+    return constant ? constant->getLiteralValue() : Optional<Literal>{};
+}
+
+static CanonicalOffset canonicalizeOffset(const Value& offset, unsigned depth = 0)
+{
+    if(auto lit = getConstantLiteral(offset))
+        return CanonicalOffset{INT_ZERO, 0, lit->unsignedInt()};
+    auto op = depth < MAX_OFFSET_DEPTH && offset.checkLocal() ?
+        dynamic_cast<const Operation*>(offset.getSingleWriter()) :
+        nullptr;
+    // only 32-bit scalar operations wrap around the same as the address calculation
+    if(!op || op->hasConditionalExecution() || op->hasUnpackMode() || op->hasPackMode() || !op->getSecondArg() ||
+        offset.type.isVectorType() || offset.type.getScalarBitCount() != 32)
+        return CanonicalOffset{offset, 1, 0};
+    auto firstLiteral = getConstantLiteral(op->getFirstArg());
+    auto secondLiteral = getConstantLiteral(op->assertArgument(1));
+    if(op->op == OP_ADD && (firstLiteral || secondLiteral))
+    {
+        auto inner = canonicalizeOffset(secondLiteral ? op->getFirstArg() : op->assertArgument(1), depth + 1);
+        inner.constantPart += (secondLiteral ? secondLiteral : firstLiteral)->unsignedInt();
+        return inner;
+    }
+    if(op->op == OP_SUB && secondLiteral)
+    {
+        auto inner = canonicalizeOffset(op->getFirstArg(), depth + 1);
+        inner.constantPart -= secondLiteral->unsignedInt();
+        return inner;
+    }
+    if(op->op == OP_SHL && secondLiteral)
+    {
+        // the shift only uses the lower 5 bits of the offset
+        auto shift = secondLiteral->unsignedInt() & 0x1F;
+        auto inner = canonicalizeOffset(op->getFirstArg(), depth + 1);
+        inner.factor <<= shift;
+        inner.constantPart <<= shift;
+        return inner;
+    }
+    return CanonicalOffset{offset, 1, 0};
+}
+
+static bool isCombinableBaseAddress(const Value& val)
+{
+    // Memory areas which might be lowered into VPM or registers determine the offset from the base address directly
+    // from the addition of the base address, so only parameters in global memory are combined
+    auto param = val.checkLocal() ? val.local()->as<Parameter>() : nullptr;
+    auto ptrType = param ? param->type.getPointerType() : nullptr;
+    return ptrType &&
+        (ptrType->addressSpace == AddressSpace::GLOBAL || ptrType->addressSpace == AddressSpace::CONSTANT);
+}
+
+/*
+ * An address calculation in the form of base address + offset, where the offset is in canonical form
+ */
+struct CanonicalAddress
+{
+    const Local* address;
+    Value baseAddress;
+    CanonicalOffset offset;
+
+    bool hasSameVariablePart(const CanonicalAddress& other) const
+    {
+        return baseAddress == other.baseAddress && offset.variablePart == other.offset.variablePart &&
+            offset.factor == other.offset.factor;
+    }
+};
+
+static Optional<CanonicalAddress> canonicalizeAddress(const Value& address)
+{
+    auto loc = address.checkLocal();
+    auto add = loc ? dynamic_cast<const Operation*>(loc->getSingleWriter()) : nullptr;
+    if(!add || add->op != OP_ADD || add->hasConditionalExecution() || add->hasUnpackMode() || add->hasPackMode() ||
+        address.type.isVectorType())
+        return {};
+    if(isCombinableBaseAddress(add->getFirstArg()))
+        return CanonicalAddress{loc, add->getFirstArg(), canonicalizeOffset(add->assertArgument(1))};
+    if(isCombinableBaseAddress(add->assertArgument(1)))
+        return CanonicalAddress{loc, add->assertArgument(1), canonicalizeOffset(add->getFirstArg())};
+    return {};
+}
+
+void normalization::combineAddressCalculations(Module& module, Method& method, const Configuration& config)
+{
+    for(auto& block : method)
+    {
+        // the addresses already calculated in this block, which can be reused by all following addresses
+        std::vector<CanonicalAddress> calculatedAddresses;
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            auto mem = it.get<MemoryInstruction>();
+            if(!mem)
+                continue;
+            std::vector<Value> addresses;
+            if(mem->op == MemoryOperation::READ || mem->op == MemoryOperation::COPY)
+                addresses.emplace_back(mem->getSource());
+            if(mem->op != MemoryOperation::READ)
+                addresses.emplace_back(mem->getDestination());
+            for(const auto& address : addresses)
+            {
+                auto canonical = canonicalizeAddress(address);
+                if(!canonical)
+                    continue;
+                auto writerIt = block.findWalkerForInstruction(canonical->address->getSingleWriter(), it);
+                if(!writerIt)
+                    continue;
+                auto previousIt = std::find_if(calculatedAddresses.begin(), calculatedAddresses.end(),
+                    [&](const CanonicalAddress& other) -> bool { return canonical->hasSameVariablePart(other); });
+                if(previousIt == calculatedAddresses.end())
+                {
+                    calculatedAddresses.emplace_back(*canonical);
+                    continue;
+                }
+                if(previousIt->address == canonical->address ||
+                    // the reused address needs to be calculated before the current address
+                    !block.findWalkerForInstruction(previousIt->address->getSingleWriter(), *writerIt))
+                    continue;
+                auto difference = canonical->offset.constantPart - previousIt->offset.constantPart;
+                auto writer = writerIt->get();
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Reusing address '" << previousIt->address->to_string() << "' with constant offset "
+                        << static_cast<int32_t>(difference) << " for address calculation: " << writer->to_string()
+                        << logging::endl);
+                Value previousAddress = previousIt->address->createReference();
+                if(difference == 0)
+                    writerIt->reset(
+                        (new MoveOperation(address, std::move(previousAddress)))->copyExtrasFrom(writer));
+                else
+                    writerIt->reset((new Operation(OP_ADD, address, std::move(previousAddress),
+                                         Value(Literal(difference), TYPE_INT32)))
+                                        ->copyExtrasFrom(writer));
+            }
+        }
+    }
+}
@@ -16,6 +16,9 @@
 
 namespace vc4c
 {
+    class Module;
+    struct Configuration;
+
     namespace periphery
     {
         enum class VPMUsage : unsigned char;
@@ -80,6 +83,39 @@ namespace vc4c
         NODISCARD InstructionWalker insertAddressToWorkItemSpecificOffset(
             InstructionWalker it, Method& method, Value& out, MemoryAccessRange& range);
 
+        /*
+         * Reuses already calculated addresses for memory accesses into the same parameter which only differ by a
+         * constant offset.
+         *
+         * The address calculations are converted to the canonical form base + variable part * factor + constant part
+         * by following the additions and shifts of the offset. If an address in the same block with the same base and
+         * variable part is calculated before, the address is calculated by adding the difference of the constant parts
+         * to it instead. The no longer used offset calculations are then removed by the dead code elimination.
+         *
+         * Example:
+         *   %offset = shl %i, 2
+         *   %addr = add %in, %offset
+         *   %val = load memory at %addr
+         *   %i.1 = add %i, 1
+         *   %offset.1 = shl %i.1, 2
+         *   %addr.1 = add %in, %offset.1
+         *   %val.1 = load memory at %addr.1
+         *
+         * is converted to:
+         *   %offset = shl %i, 2
+         *   %addr = add %in, %offset
+         *   %val = load memory at %addr
+         *   %i.1 = add %i, 1
+         *   %offset.1 = shl %i.1, 2
+         *   %addr.1 = add %addr, 4
+         *   %val.1 = load memory at %addr.1
+         *
+         * NOTE: This needs to run before the memory access is lowered and is only applied to addresses into __global
+         * and __constant parameters, since the lowering of other memory areas into the VPM or registers expects the
+         * offset to be directly added to the base address.
+         */
+        void combineAddressCalculations(Module& module, Method& method, const Configuration& config);
+
     } /* namespace normalization */
 } /* namespace vc4c */
 #endif /* VC4C_NORMALIZATION_ADDRESS_CALCULATION_H */
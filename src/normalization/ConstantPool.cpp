@@ -0,0 +1,267 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "ConstantPool.h"
+
+#include "../GlobalValues.h"
+#include "../InstructionWalker.h"
+#include "../Method.h"
+#include "../Module.h"
+#include "../Profiler.h"
+#include "../analysis/AnalysisManager.h"
+#include "../analysis/ControlFlowGraph.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "LiteralValues.h"
+#include "log.h"
+
+#include <algorithm>
+
+using namespace vc4c;
+using namespace vc4c::normalization;
+
+// the estimated number of instructions to load a vector via TMU: calculate the per-element addresses (shift of the
+// element number, addition of the base address), write the address and read the result
+static constexpr unsigned POOL_LOAD_COSTS = 5;
+// the weight of the instructions saved per nesting level of loops (i.e. the estimated number of iterations)
+static constexpr unsigned LOOP_WEIGHT_SHIFT = 3;
+static constexpr unsigned MAX_LOOP_DEPTH = 3;
+
+struct ConstantUse
+{
+    Method* method;
+    InstructionWalker it;
+    std::size_t argIndex;
+    unsigned loopDepth;
+};
+
+struct PoolCandidate
+{
+    Value container;
+    unsigned inlineCosts;
+    std::vector<ConstantUse> uses;
+};
+
+static bool canBeMovedToPool(const Value& arg)
+{
+    // the pooled vector is read via TMU, which only supports 32-bit elements without unpacking
+    return arg.checkVector() && !arg.type.getPointerType() && arg.type.isVectorType() &&
+        arg.type.getVectorWidth() <= NATIVE_VECTOR_SIZE && arg.type.getElementType().getScalarBitCount() == 32;
+}
+
+static FastMap<const BasicBlock*, unsigned> determineLoopDepths(Method& method)
+{
+    FastMap<const BasicBlock*, unsigned> depths;
+    // the loops are determined recursively, so a block is contained in all its nesting loops
+    for(const auto& loop : method.getAnalyses().getLoops(true))
+    {
+        for(const auto* node : loop)
+            ++depths[node->key];
+    }
+    return depths;
+}
+
+static void collectConstantUses(Method& method, std::vector<PoolCandidate>& candidates)
+{
+    auto loopDepths = determineLoopDepths(method);
+    for(auto& block : method)
+    {
+        auto depthIt = loopDepths.find(&block);
+        auto depth = depthIt != loopDepths.end() ? depthIt->second : 0u;
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.get<intermediate::MoveOperation>() && !it.get<intermediate::Operation>())
+                continue;
+            const auto& args = it->getArguments();
+            for(std::size_t i = 0; i < args.size(); ++i)
+            {
+                if(!canBeMovedToPool(args[i]))
+                    continue;
+                auto candIt =
+                    std::find_if(candidates.begin(), candidates.end(), [&](const PoolCandidate& cand) -> bool {
+                        return cand.container.type == args[i].type && cand.container.vector() == args[i].vector();
+                    });
+                if(candIt == candidates.end())
+                    candIt = candidates.emplace(
+                        candidates.end(), PoolCandidate{args[i], estimateContainerCosts(args[i]), {}});
+                candIt->uses.emplace_back(ConstantUse{&method, it, i, depth});
+            }
+        }
+    }
+    // the analyses are no longer valid after the instructions are modified
+    method.getAnalyses().invalidate();
+}
+
+static unsigned calculateSavings(const PoolCandidate& candidate, bool weightByLoops)
+{
+    if(candidate.inlineCosts <= POOL_LOAD_COSTS)
+        return 0;
+    unsigned savings = 0;
+    for(const auto& use : candidate.uses)
+        savings += (candidate.inlineCosts - POOL_LOAD_COSTS)
+            << (weightByLoops ? LOOP_WEIGHT_SHIFT * std::min(use.loopDepth, MAX_LOOP_DEPTH) : 0u);
+    return savings;
+}
+
+static Global& createPoolEntry(Module& module, const Value& container)
+{
+    const auto& vector = container.vector();
+    auto elementType = container.type.getElementType();
+    std::vector<CompoundConstant> elements;
+    elements.reserve(container.type.getVectorWidth());
+    for(uint8_t i = 0; i < container.type.getVectorWidth(); ++i)
+        // the undefined elements can be set to any value
+        elements.emplace_back(elementType, vector[i].isUndefined() ? Literal(0u) : vector[i]);
+    auto name = "%constant_pool." + std::to_string(module.globalData.size());
+    auto globalIt = module.globalData.emplace(module.globalData.end(), std::move(name),
+        DataType(module.createPointerType(container.type, AddressSpace::CONSTANT)),
+        CompoundConstant(container.type, std::move(elements)), true);
+    globalIt->isConstantPoolEntry = true;
+    return *globalIt;
+}
+
+void normalization::createConstantPool(Module& module, const Configuration& config)
+{
+    if(config.additionalOptions.constantPoolThreshold == 0)
+        return;
+    PROFILE_START(CreateConstantPool);
+    std::vector<PoolCandidate> candidates;
+    for(auto kernel : module.getKernels())
+        collectConstantUses(*kernel, candidates);
+
+    for(const auto& candidate : candidates)
+    {
+        // when optimizing for size, only the number of instructions in the code matters, not how often they run
+        auto savings = calculateSavings(candidate, config.optimizationLevel != OptimizationLevel::SIZE);
+        if(savings < config.additionalOptions.constantPoolThreshold)
+            continue;
+        auto& entry = createPoolEntry(module, candidate.container);
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Moving constant with " << candidate.uses.size() << " uses into constant pool (saving about "
+                << savings << " weighted instructions): " << entry.to_string(true) << logging::endl);
+        for(auto use : candidate.uses)
+        {
+            auto tmp = use.method->addNewLocal(candidate.container.type, "%pool_load");
+            use.it.emplace(new intermediate::MemoryInstruction(
+                intermediate::MemoryOperation::READ, Value(tmp), entry.createReference()));
+            use.it.nextInBlock();
+            use.it->setArgument(use.argIndex, std::move(tmp));
+        }
+    }
+    PROFILE_END(CreateConstantPool);
+}
+
+static unsigned getAlignment(const Global& global)
+{
+    return global.type.getPointerType()->getAlignment();
+}
+
+/*
+ * Maps all constant globals to the global with the same contents they are merged into
+ */
+static FastMap<const Global*, Global*> findDuplicateConstants(Module& module)
+{
+    std::vector<std::vector<Global*>> groups;
+    for(auto& global : module.globalData)
+    {
+        if(!global.isConstant)
+            continue;
+        auto addressSpace = global.type.getPointerType()->addressSpace;
+        auto groupIt = std::find_if(groups.begin(), groups.end(), [&](const std::vector<Global*>& group) -> bool {
+            const auto& other = *group.front();
+            return other.type.getPointerType()->addressSpace == addressSpace &&
+                other.initialValue == global.initialValue;
+        });
+        if(groupIt != groups.end())
+            groupIt->push_back(&global);
+        else
+            groups.emplace_back(std::vector<Global*>{&global});
+    }
+
+    FastMap<const Global*, Global*> replacements;
+    for(const auto& group : groups)
+    {
+        if(group.size() < 2)
+            continue;
+        // the merged global needs to satisfy the alignment requirements of all its uses
+        auto representative = *std::max_element(group.begin(), group.end(),
+            [](const Global* one, const Global* other) -> bool { return getAlignment(*one) < getAlignment(*other); });
+        for(auto global : group)
+        {
+            if(global != representative)
+                replacements.emplace(global, representative);
+        }
+    }
+    return replacements;
+}
+
+void normalization::optimizeGlobalData(Module& module)
+{
+    if(module.globalData.empty())
+        return;
+    PROFILE_START(OptimizeGlobalData);
+    auto sizeBefore = module.getGlobalDataOffset(nullptr).value_or(0);
+    auto numGlobalsBefore = module.globalData.size();
+
+    auto replacements = findDuplicateConstants(module);
+    // returns the global the given global is merged into, or the global itself
+    auto getReplacement = [&](const Local* local) -> const Global* {
+        auto global = local->as<Global>();
+        auto it = global ? replacements.find(global) : replacements.end();
+        return it != replacements.end() ? it->second : global;
+    };
+
+    FastSet<const Global*> referencedGlobals;
+    for(auto& method : module.methods)
+    {
+        auto it = method->walkAllInstructions();
+        while(!it.isEndOfMethod())
+        {
+            if(it.has())
+            {
+                for(std::size_t i = 0; i < it->getArguments().size(); ++i)
+                {
+                    auto arg = it->assertArgument(i);
+                    auto global = arg.checkLocal() ? getReplacement(arg.local()) : nullptr;
+                    if(!global)
+                        continue;
+                    referencedGlobals.emplace(global);
+                    if(global != arg.local())
+                        it->setArgument(i, Value(const_cast<Global*>(global), arg.type));
+                }
+                // pointers into the global data also reference the globals
+                auto output = it->checkOutputLocal();
+                if(auto data = output ? const_cast<Local*>(output)->get<ReferenceData>() : nullptr)
+                {
+                    if(auto global = getReplacement(data->base))
+                    {
+                        referencedGlobals.emplace(global);
+                        data->base = global;
+                    }
+                }
+            }
+            it.nextInMethod();
+        }
+    }
+
+    module.globalData.remove_if([&](const Global& global) -> bool {
+        if(referencedGlobals.find(&global) != referencedGlobals.end())
+            return false;
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Removing " << (replacements.find(&global) != replacements.end() ? "duplicate" : "unused")
+                << " global: " << global.to_string() << logging::endl);
+        return true;
+    });
+    // the (stable) sorting by descending alignment only requires padding after globals with sizes not being a
+    // multiple of the alignment of the next global
+    module.globalData.sort(
+        [](const Global& one, const Global& other) -> bool { return getAlignment(one) > getAlignment(other); });
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Reduced global data from " << numGlobalsBefore << " globals with " << sizeBefore << " bytes to "
+            << module.globalData.size() << " globals with " << module.getGlobalDataOffset(nullptr).value_or(0)
+            << " bytes" << logging::endl);
+    PROFILE_END(OptimizeGlobalData);
+}
@@ -0,0 +1,53 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_NORMALIZATION_CONSTANT_POOL_H
+#define VC4C_NORMALIZATION_CONSTANT_POOL_H
+
+namespace vc4c
+{
+    class Module;
+    struct Configuration;
+
+    namespace normalization
+    {
+        /*
+         * Moves constant vectors which are expensive to calculate in code into a constant pool in the global data
+         * segment and replaces their uses with loads from memory.
+         *
+         * All uses of the same constant vector (across all kernels of the module) share the same pool entry. A
+         * constant is only moved to the pool, if the instructions saved by loading it (via TMU) instead of calculating
+         * it in code (see normalization::estimateContainerCosts()), weighted by the nesting depth of the loops
+         * containing the uses, exceed the threshold configured in OptimizationOptions#constantPoolThreshold.
+         *
+         * Example:
+         *   %a = add %b, <7, 42, 13, 1234, ...>
+         *
+         * is converted to:
+         *   %constant_pool.0 = <7, 42, 13, 1234, ...> (global data)
+         *   %pool_load = load memory at %constant_pool.0
+         *   %a = add %b, %pool_load
+         *
+         * NOTE: This needs to run on the whole module before the kernels are normalized, since the global data is
+         * shared by all kernels.
+         */
+        void createConstantPool(Module& module, const Configuration& config);
+
+        /*
+         * Shrinks the global data segment of the module:
+         * - globals not referenced by any kernel (e.g. only used by removed functions) are removed
+         * - constant globals with identical contents are merged into a single global
+         * - the remaining globals are ordered by descending alignment to minimize the padding between them
+         *
+         * NOTE: This needs to run on the whole module before the kernels are normalized, since the offsets of the
+         * globals in the global data segment are inserted into the kernel code there. Thus, globals whose accesses are
+         * only removed by the later optimizations are still kept.
+         */
+        void optimizeGlobalData(Module& module);
+    } // namespace normalization
+} // namespace vc4c
+
+#endif /* VC4C_NORMALIZATION_CONSTANT_POOL_H */
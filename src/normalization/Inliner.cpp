@@ -16,157 +16,251 @@
 using namespace vc4c;
 using namespace vc4c::normalization;
 
-static const Method* matchSignatures(
-    const std::vector<std::unique_ptr<Method>>& methods, const intermediate::MethodCall* callSignature)
+/*
+ * Index of the functions of the module by their name, to only check the signatures of the functions with the same name
+ * for every call-site
+ */
+using MethodIndex = FastMap<std::string, std::vector<const Method*>>;
+
+static const Method* matchSignatures(const MethodIndex& methods, const intermediate::MethodCall* callSignature)
 {
-    for(const auto& m : methods)
+    auto entry = methods.find(callSignature->methodName);
+    if(entry == methods.end())
+        return nullptr;
+    for(const auto* m : entry->second)
     {
         if(callSignature->matchesSignature(*m))
         {
             CPPLOG_LAZY(logging::Level::DEBUG,
                 log << "Found method matching " << m->returnType.to_string() << ' ' << m->name << " with "
                     << m->parameters.size() << " arguments" << logging::endl);
-            return m.get();
+            return m;
         }
     }
     return nullptr;
 }
 
-static Method& inlineMethod(const std::string& localPrefix, const std::vector<std::unique_ptr<Method>>& methods,
-    const FastMap<std::string, std::string>& functionAliases, Method& currentMethod)
+static const Method* findCalledMethod(const MethodIndex& methods,
+    const FastMap<std::string, std::string>& functionAliases, intermediate::MethodCall* call)
+{
+    // search for method with matching signature
+    auto calledMethod = matchSignatures(methods, call);
+    if(!calledMethod)
+    {
+        // if not find directly, try aliasing
+        auto aliasIt = functionAliases.find(call->methodName);
+        if(aliasIt != functionAliases.end())
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Using alias '" << aliasIt->second << "' for call-site: " << call->to_string()
+                    << logging::endl);
+            // we need to rewrite the call-site function name, since this is checked in
+            // CallSite#matchesSignature(...)
+            call->methodName = aliasIt->second;
+            calledMethod = matchSignatures(methods, call);
+        }
+    }
+    return calledMethod;
+}
+
+/*
+ * Whether the given method implements a work-group barrier (i.e. barrier() or work_group_barrier()), the name might
+ * still be mangled
+ */
+static bool isWorkGroupBarrier(const Method& method)
+{
+    std::size_t pos = 0;
+    if(method.name.compare(0, 2, "_Z") == 0)
+    {
+        // skip mangling prefix "_Z<length>"
+        pos = method.name.find_first_not_of("0123456789", 2);
+        if(pos == std::string::npos)
+            return false;
+    }
+    return method.name.compare(pos, 7, "barrier") == 0 || method.name.compare(pos, 18, "work_group_barrier") == 0;
+}
+
+/*
+ * Whether the given instruction accesses the hardware semaphores
+ */
+static bool isSemaphoreAccess(const intermediate::IntermediateInstruction* instr)
+{
+    if(auto call = dynamic_cast<const intermediate::MethodCall*>(instr))
+        return call->methodName.find("vc4cl_semaphore_") != std::string::npos;
+    return dynamic_cast<const intermediate::SemaphoreAdjustment*>(instr) != nullptr;
+}
+
+/*
+ * Inlines the body of the called method at the given call-site, replacing the call.
+ *
+ * NOTE: The called method is expected to not contain any calls to be inlined anymore.
+ */
+static InstructionWalker inlineCall(
+    Method& currentMethod, InstructionWalker it, intermediate::MethodCall* call, const Method* calledMethod)
 {
-    auto it = currentMethod.walkAllInstructions();
-    while(!it.isEndOfMethod())
+    const std::size_t numInstructions = currentMethod.countInstructions();
+    const std::string newLocalPrefix = (!(call->getReturnType() == TYPE_VOID) ?
+                                               call->getOutput()->local()->name :
+                                               std::string("%") + (calledMethod->name + ".") + std::to_string(rand())) +
+        '.';
+    const Local* methodEndLabel = currentMethod.createLocal(TYPE_LABEL, newLocalPrefix + "after");
+
+    intermediate::InlineMapping mapping;
+    // the number of instructions is a good guess for the number of locals used
+    mapping.reserve(calledMethod->countInstructions());
+    // Starting at lowest level (here), insert in parent
+    // map parameters to arguments
+    for(std::size_t i = 0; i < call->getArguments().size(); ++i)
+    {
+        auto callArg = call->assertArgument(i);
+        const Parameter& param = calledMethod->parameters.at(i);
+        auto ref = currentMethod.createLocal(param.type, newLocalPrefix + param.name)->createReference();
+        mapping.emplace(&param, ref.local());
+        if(has_flag(param.decorations, ParameterDecorations::SIGN_EXTEND))
+            it = intermediate::insertSignExtension(it, currentMethod, callArg, ref, true);
+        else if(has_flag(param.decorations, ParameterDecorations::ZERO_EXTEND))
+            it = intermediate::insertZeroExtension(it, currentMethod, callArg, ref, true);
+        else
+        {
+            it.emplace(new intermediate::MoveOperation(ref, callArg));
+            it.nextInMethod();
+        }
+        if(ref.checkLocal() && callArg.checkLocal() && callArg.type.getPointerType())
+            ref.local()->set(ReferenceData(*callArg.local()->getBase(false), 0));
+    }
+    // add parameters and locals to locals of parent
+    for(const Parameter& arg : calledMethod->parameters)
     {
-        // Find all method calls
-        if(auto call = it.get<intermediate::MethodCall>())
+        if(mapping.find(&arg) == mapping.end())
+            mapping.emplace(&arg, currentMethod.createLocal(arg.type, newLocalPrefix + arg.name));
+    }
+    // the blocks and branches of the inlined body are inserted one by one, so update the CFG only once
+    ModificationBatch batch(currentMethod);
+    const bool isBarrier = isWorkGroupBarrier(*calledMethod);
+    // insert instructions
+    calledMethod->forAllInstructions([&](const intermediate::IntermediateInstruction& instr) -> void {
+        if(auto ret = dynamic_cast<const intermediate::Return*>(&instr))
         {
-            // search for method with matching signature
-            auto calledMethod = matchSignatures(methods, call);
-            if(!calledMethod)
+            if(auto retVal = ret->getReturnValue())
             {
-                // if not find directly, try aliasing
-                auto aliasIt = functionAliases.find(call->methodName);
-                if(aliasIt != functionAliases.end())
+                // prefix locals with destination of call
+                // map return-value to destination
+                if(auto retLoc = retVal->checkLocal())
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
-                        log << "Using alias '" << aliasIt->second << "' for call-site: " << call->to_string()
-                            << logging::endl);
-                    // we need to rewrite the call-site function name, since this is checked in
-                    // CallSite#matchesSignature(...)
-                    call->methodName = aliasIt->second;
-                    calledMethod = matchSignatures(methods, call);
+                    auto it = mapping.find(retLoc);
+                    if(it != mapping.end())
+                        retVal->local() = const_cast<Local*>(it->second);
+                    else
+                        retVal->local() = const_cast<Local*>(
+                            currentMethod.createLocal(retVal->type, newLocalPrefix + retLoc->name));
                 }
+                it.emplace(new intermediate::MoveOperation(call->getOutput().value(), *retVal));
+                it.nextInMethod();
             }
-            if(calledMethod)
+            // after each return, jump to label after call-site (since there may be several return
+            // statements in a method)
+            it.emplace(new intermediate::Branch(methodEndLabel));
+        }
+        else
+        {
+            // prefix locals with destination of call
+            // copy instructions
+            if(dynamic_cast<const intermediate::BranchLabel*>(&instr) != nullptr)
+                it = currentMethod.emplaceLabel(it,
+                    dynamic_cast<intermediate::BranchLabel*>(instr.copyFor(currentMethod, newLocalPrefix, mapping)));
+            else
             {
-                const std::size_t numInstructions = currentMethod.countInstructions();
-                // recursively search for used methods
-                const std::string newLocalPrefix = localPrefix +
-                    (!(call->getReturnType() == TYPE_VOID) ?
-                            call->getOutput()->local()->name :
-                            std::string("%") + (calledMethod->name + ".") + std::to_string(rand())) +
-                    '.';
-                const Local* methodEndLabel = currentMethod.createLocal(TYPE_LABEL, newLocalPrefix + "after");
-                inlineMethod(newLocalPrefix, methods, functionAliases, const_cast<Method&>(*calledMethod));
-                // at this point, the called method has already inlined all other methods
-
-                intermediate::InlineMapping mapping;
-                // the number of instructions is a good guess for the number of locals used
-                mapping.reserve(calledMethod->countInstructions());
-                // Starting at lowest level (here), insert in parent
-                // map parameters to arguments
-                for(std::size_t i = 0; i < call->getArguments().size(); ++i)
-                {
-                    auto callArg = call->assertArgument(i);
-                    const Parameter& param = calledMethod->parameters.at(i);
-                    auto ref = currentMethod.createLocal(param.type, newLocalPrefix + param.name)->createReference();
-                    mapping.emplace(&param, ref.local());
-                    if(has_flag(param.decorations, ParameterDecorations::SIGN_EXTEND))
-                        it = intermediate::insertSignExtension(it, currentMethod, callArg, ref, true);
-                    else if(has_flag(param.decorations, ParameterDecorations::ZERO_EXTEND))
-                        it = intermediate::insertZeroExtension(it, currentMethod, callArg, ref, true);
-                    else
-                    {
-                        it.emplace(new intermediate::MoveOperation(ref, callArg));
-                        it.nextInMethod();
-                    }
-                    if(ref.checkLocal() && callArg.checkLocal() && callArg.type.getPointerType())
-                        ref.local()->set(ReferenceData(*callArg.local()->getBase(false), 0));
-                }
-                // add parameters and locals to locals of parent
-                for(const Parameter& arg : calledMethod->parameters)
-                {
-                    if(mapping.find(&arg) == mapping.end())
-                        mapping.emplace(&arg, currentMethod.createLocal(arg.type, newLocalPrefix + arg.name));
-                }
-                // insert instructions
-                calledMethod->forAllInstructions([&](const intermediate::IntermediateInstruction& instr) -> void {
-                    if(auto ret = dynamic_cast<const intermediate::Return*>(&instr))
-                    {
-                        if(auto retVal = ret->getReturnValue())
-                        {
-                            // prefix locals with destination of call
-                            // map return-value to destination
-                            if(auto retLoc = retVal->checkLocal())
-                            {
-                                auto it = mapping.find(retLoc);
-                                if(it != mapping.end())
-                                    retVal->local() = const_cast<Local*>(it->second);
-                                else
-                                    retVal->local() = const_cast<Local*>(
-                                        currentMethod.createLocal(retVal->type, newLocalPrefix + retLoc->name));
-                            }
-                            it.emplace(new intermediate::MoveOperation(call->getOutput().value(), *retVal));
-                            it.nextInMethod();
-                        }
-                        // after each return, jump to label after call-site (since there may be several return
-                        // statements in a method)
-                        it.emplace(new intermediate::Branch(methodEndLabel));
-                    }
-                    else
-                    {
-                        // prefix locals with destination of call
-                        // copy instructions
-                        if(dynamic_cast<const intermediate::BranchLabel*>(&instr) != nullptr)
-                            it = currentMethod.emplaceLabel(it,
-                                dynamic_cast<intermediate::BranchLabel*>(
-                                    instr.copyFor(currentMethod, newLocalPrefix, mapping)));
-                        else
-                            it.emplace(instr.copyFor(currentMethod, newLocalPrefix, mapping));
-                    }
-                    it.nextInMethod();
-                });
-                if(it.get() != call)
-                {
-                    throw CompilationError(CompilationStep::OPTIMIZER, "Method call expected, got", it->to_string());
-                }
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Function body for " << call->to_string() << " inlined, added "
-                        << (currentMethod.countInstructions() - 1 - numInstructions) << " instructions"
-                        << logging::endl);
-                // replace method-call from parent with label to jump to (for returns)
-                it = it.erase();
-                auto copyIt = it.copy().previousInMethod();
-                it = currentMethod.emplaceLabel(it, new intermediate::BranchLabel(*methodEndLabel));
-
-                // fix-up to immediately remove branches from return to %end_of_function when consecutive instructions
-                if(copyIt.get<intermediate::Branch>() &&
-                    copyIt.get<intermediate::Branch>()->getTarget() == methodEndLabel)
-                    copyIt.erase();
+                auto copy = instr.copyFor(currentMethod, newLocalPrefix, mapping);
+                // mark the synchronization of the work-group barrier, to be able to distinguish it from any other
+                // semaphore access, e.g. when removing the work-group synchronization
+                if(isBarrier && isSemaphoreAccess(copy))
+                    copy->addDecorations(intermediate::InstructionDecorations::WORK_GROUP_BARRIER);
+                it.emplace(copy);
             }
         }
         it.nextInMethod();
+    });
+    if(it.get() != call)
+    {
+        throw CompilationError(CompilationStep::OPTIMIZER, "Method call expected, got", it->to_string());
     }
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Function body for " << call->to_string() << " inlined, added "
+            << (currentMethod.countInstructions() - 1 - numInstructions) << " instructions" << logging::endl);
+    // replace method-call from parent with label to jump to (for returns)
+    it = it.erase();
+    auto copyIt = it.copy().previousInMethod();
+    it = currentMethod.emplaceLabel(it, new intermediate::BranchLabel(*methodEndLabel));
 
-    return currentMethod;
+    // fix-up to immediately remove branches from return to %end_of_function when consecutive instructions
+    if(copyIt.get<intermediate::Branch>() && copyIt.get<intermediate::Branch>()->getTarget() == methodEndLabel)
+        copyIt.erase();
+    batch.commit();
+    return it;
 }
 
-void normalization::inlineMethods(const Module& module, Method& kernel, const Configuration& config)
+/*
+ * Determines the methods called by the given method and adds them (and recursively all methods called by them) in
+ * post-order (i.e. the callees before their callers) to the given list of methods to process.
+ */
+static void addCallGraphInPostOrder(const MethodIndex& methods,
+    const FastMap<std::string, std::string>& functionAliases, Method* method, FastMap<const Method*, bool>& visited,
+    std::vector<Method*>& order)
+{
+    auto visitedIt = visited.find(method);
+    if(visitedIt != visited.end())
+    {
+        if(!visitedIt->second)
+            // method is still being processed, so it calls itself (directly or indirectly)
+            throw CompilationError(CompilationStep::NORMALIZER, "Recursive function calls are not supported",
+                method->returnType.to_string() + " " + method->name);
+        return;
+    }
+    visited.emplace(method, false);
+    method->forAllInstructions([&](const intermediate::IntermediateInstruction& instr) {
+        if(auto call = dynamic_cast<const intermediate::MethodCall*>(&instr))
+        {
+            if(auto calledMethod =
+                    findCalledMethod(methods, functionAliases, const_cast<intermediate::MethodCall*>(call)))
+                addCallGraphInPostOrder(
+                    methods, functionAliases, const_cast<Method*>(calledMethod), visited, order);
+        }
+    });
+    visited[method] = true;
+    order.emplace_back(method);
+}
+
+void normalization::inlineMethods(Module& module, const Configuration& config)
 {
     CPPLOG_LAZY(logging::Level::INFO, log << "-----" << logging::endl);
-    CPPLOG_LAZY(logging::Level::INFO, log << "Inlining functions for kernel: " << kernel.name << logging::endl);
-    // Starting at kernel
-    inlineMethod("", module.methods, module.functionAliases, kernel);
+    MethodIndex methods;
+    for(const auto& method : module.methods)
+        methods[method->name].emplace_back(method.get());
+
+    // Only the methods (transitively) called by any kernel need to be processed
+    FastMap<const Method*, bool> visited;
+    std::vector<Method*> order;
+    for(auto kernel : module.getKernels())
+        addCallGraphInPostOrder(methods, module.functionAliases, kernel, visited, order);
+
+    // Since all callees are processed before their callers, every method only needs to be flattened once and then its
+    // body (which no longer contains any calls to inline) is copied into all call-sites across all kernels
+    for(Method* method : order)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG, log << "Inlining functions into: " << method->name << logging::endl);
+        auto it = method->walkAllInstructions();
+        while(!it.isEndOfMethod())
+        {
+            if(auto call = it.get<intermediate::MethodCall>())
+            {
+                if(auto calledMethod = findCalledMethod(methods, module.functionAliases, call))
+                    it = inlineCall(*method, it, call, calledMethod);
+            }
+            it.nextInMethod();
+        }
+    }
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Inlined functions into " << module.getKernels().size() << " kernels, processed " << order.size()
+            << " methods" << logging::endl);
     CPPLOG_LAZY(logging::Level::INFO, log << "-----" << logging::endl);
 }
@@ -9,13 +9,22 @@
 
 namespace vc4c
 {
-    class Method;
     class Module;
     struct Configuration;
 
     namespace normalization
     {
-        void inlineMethods(const Module& module, Method& kernel, const Configuration& config);
+        /*
+         * Inlines all function calls in all kernels of the module.
+         *
+         * The functions are processed bottom-up along the call graph (starting at the kernels), so every called
+         * function has all its calls inlined exactly once, before its body is copied into all its call-sites.
+         * Functions not reachable from any kernel are not processed at all.
+         *
+         * NOTE: Since the VideoCore IV QPUs do not support function calls, all calls are inlined and recursive calls
+         * result in a compilation error.
+         */
+        void inlineMethods(Module& module, const Configuration& config);
     } // namespace normalization
 } // namespace vc4c
 
@@ -10,10 +10,13 @@
 #include "../Module.h"
 #include "../Profiler.h"
 #include "../intermediate/VectorHelper.h"
+#include "../intermediate/operators.h"
 #include "log.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <limits>
 #include <unordered_map>
 
 using namespace vc4c;
@@ -48,6 +51,336 @@ static bool fitsIntoSignedMaskedLoad(Literal lit)
     return lit.signedInt() == 0 || lit.signedInt() == 1 || lit.signedInt() == -2 || lit.signedInt() == -1;
 }
 
+/*
+ * A short sequence of instructions calculating a constant vector from a per-element index (either the shifted and
+ * masked element number or loaded via per-element masked loads), scaled and offset, and optionally rotated:
+ *
+ *   vector = rotate(offset + factor * index, rotation)
+ *
+ * or selecting between two arbitrary values via a signed masked load:
+ *
+ *   vector = first ^ (mask & (first ^ second))
+ */
+struct ConstantSynthesis
+{
+    // whether the index is calculated from the element number, otherwise it is loaded via masked loads
+    bool fromElementNumber = true;
+    // the index is calculated as (elem_num >> shift) & mask (mask of zero for no masking)
+    uint8_t shift = 0;
+    uint8_t mask = 0;
+    // the indices to load via masked loads
+    SIMDVector loadedIndices;
+    bool requiresUpperBits = false;
+    int32_t factor = 1;
+    uint32_t offset = 0;
+    // the calculated vector is rotated upwards by this number of elements
+    uint8_t rotation = 0;
+    // whether the vector selects between the first and second value via a signed masked load of the loaded indices
+    bool isSelection = false;
+    uint32_t first = 0;
+    uint32_t second = 0;
+    // the number of instructions inserted (excluding loading of literals and the rotation)
+    unsigned numSteps = 0;
+    // the estimated number of instructions, including loading of non-immediate literals
+    unsigned costs = std::numeric_limits<unsigned>::max();
+};
+
+// the values of the vector to create, unset for elements which are not used
+using ConstantElements = std::array<Optional<uint32_t>, NATIVE_VECTOR_SIZE>;
+
+static unsigned getLiteralCosts(uint32_t value)
+{
+    return toImmediate(Literal(value)) ? 0 : 1;
+}
+
+static bool isPowerOfTwo(uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b)
+{
+    while(b != 0)
+    {
+        auto tmp = a % b;
+        a = b;
+        b = tmp;
+    }
+    return a;
+}
+
+/*
+ * Returns the number of instructions required to insert the elements separately, see #copyVector
+ */
+static unsigned getElementWiseCosts(const SIMDVector& container, uint8_t numElements)
+{
+    auto maxOccurrence = getMostCommonElement(container, numElements);
+    unsigned costs = 1 + (maxOccurrence && maxOccurrence.value() != container[0] ? 2 : 0);
+    for(uint8_t i = 0; i < numElements; ++i)
+    {
+        if(!maxOccurrence || container[i] != maxOccurrence.value())
+            costs += 2;
+    }
+    return costs;
+}
+
+/*
+ * Tries to find a factor and offset to calculate all set elements from the given indices and calculates the costs of
+ * the resulting instructions
+ */
+static bool fitIndices(const ConstantElements& elements, const std::array<uint32_t, NATIVE_VECTOR_SIZE>& indices,
+    unsigned indexSteps, ConstantSynthesis& synthesis)
+{
+    Optional<std::size_t> base;
+    Optional<int64_t> factor;
+    for(std::size_t i = 0; i < elements.size(); ++i)
+    {
+        if(!elements[i])
+            continue;
+        if(!base)
+            base = i;
+        else if(!factor && indices[i] != indices[*base])
+        {
+            auto valueDiff = static_cast<int64_t>(static_cast<int32_t>(*elements[i])) -
+                static_cast<int64_t>(static_cast<int32_t>(*elements[*base]));
+            auto indexDiff = static_cast<int64_t>(indices[i]) - static_cast<int64_t>(indices[*base]);
+            if(valueDiff % indexDiff != 0)
+                return false;
+            factor = valueDiff / indexDiff;
+        }
+    }
+    if(!base || !factor || *factor == 0)
+        // all elements are the same, handled elsewhere
+        return false;
+    if(*factor <= std::numeric_limits<int32_t>::min() || *factor > std::numeric_limits<int32_t>::max())
+        return false;
+    const auto absFactor = static_cast<uint32_t>(std::abs(*factor));
+    if(absFactor >= (1u << 24) && !isPowerOfTwo(absFactor))
+        // does not fit into mul24
+        return false;
+    const auto offset = *elements[*base] - static_cast<uint32_t>(*factor) * indices[*base];
+    for(std::size_t i = 0; i < elements.size(); ++i)
+    {
+        if(elements[i] && offset + static_cast<uint32_t>(*factor) * indices[i] != *elements[i])
+            return false;
+    }
+
+    unsigned numSteps = indexSteps;
+    unsigned costs = indexSteps;
+    if(absFactor != 1)
+    {
+        ++numSteps;
+        costs += 1 + getLiteralCosts(isPowerOfTwo(absFactor) ? static_cast<uint32_t>(std::log2(absFactor)) : absFactor);
+    }
+    if(*factor < 0 || offset != 0)
+    {
+        ++numSteps;
+        costs += 1 + getLiteralCosts(offset);
+    }
+    if(synthesis.rotation != 0)
+        // the rotation might require an additional move of the source into an accumulator
+        costs += 2;
+    if(numSteps == 0 && synthesis.rotation == 0)
+        // plain element number, handled elsewhere
+        return false;
+    if(costs >= synthesis.costs)
+        return false;
+    synthesis.factor = static_cast<int32_t>(*factor);
+    synthesis.offset = offset;
+    synthesis.numSteps = numSteps;
+    synthesis.costs = costs;
+    return true;
+}
+
+/*
+ * Searches for the cheapest sequence of instructions calculating the given constant vector
+ */
+static ConstantSynthesis synthesizeConstant(const SIMDVector& container, uint8_t numElements, bool isFloatingType)
+{
+    ConstantSynthesis best;
+    ConstantElements values;
+    for(uint8_t i = 0; i < numElements; ++i)
+    {
+        if(!container[i].isUndefined())
+            values[i] = container[i].unsignedInt();
+    }
+
+    FastSet<uint32_t> distinctValues;
+    for(const auto& val : values)
+    {
+        if(val)
+            distinctValues.emplace(*val);
+    }
+    if(distinctValues.size() == 2)
+    {
+        // select between the two values via a signed masked load of 0/-1 (works for any values, even floating-point)
+        ConstantSynthesis selection;
+        selection.isSelection = true;
+        selection.first =
+            **std::find_if(values.begin(), values.end(), [](const Optional<uint32_t>& val) -> bool { return !!val; });
+        selection.second = *distinctValues.begin() == selection.first ? *std::next(distinctValues.begin()) :
+                                                                        *distinctValues.begin();
+        for(std::size_t i = 0; i < values.size(); ++i)
+            selection.loadedIndices[i] = Literal(values[i] && *values[i] == selection.second ? -1 : 0);
+        selection.numSteps = selection.first != 0 ? 3 : 2;
+        selection.costs = selection.numSteps + getLiteralCosts(selection.first ^ selection.second) +
+            (selection.first != 0 ? getLiteralCosts(selection.first) : 0);
+        best = selection;
+    }
+    if(isFloatingType)
+        // the arithmetic calculations do not work for floating-point values
+        return best;
+
+    for(uint8_t rotation = 0; rotation < NATIVE_VECTOR_SIZE; ++rotation)
+    {
+        // vector = rotate(source, rotation) <=> vector[i] = source[i - rotation]
+        ConstantElements source;
+        for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            source[i] = values[(i + rotation) % NATIVE_VECTOR_SIZE];
+
+        ConstantSynthesis candidate;
+        candidate.rotation = rotation;
+        candidate.costs = best.costs;
+        // 1. index from shifted and masked element number
+        for(uint8_t shift = 0; shift < 4; ++shift)
+        {
+            for(uint8_t mask : std::initializer_list<uint8_t>{0, 1, 3, 7})
+            {
+                if(mask != 0 && mask >= (15u >> shift))
+                    continue;
+                std::array<uint32_t, NATIVE_VECTOR_SIZE> indices;
+                for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+                    indices[i] = mask != 0 ? ((i >> shift) & mask) : (i >> shift);
+                unsigned indexSteps = (shift != 0 ? 1 : 0) + (mask != 0 ? 1 : 0);
+                if(fitIndices(source, indices, indexSteps, candidate))
+                {
+                    candidate.fromElementNumber = true;
+                    candidate.shift = shift;
+                    candidate.mask = mask;
+                    best = candidate;
+                }
+            }
+        }
+        if(rotation != 0)
+            // rotating masked loads does not make sense, since the masked load can load any indices directly
+            continue;
+        // 2. index loaded via (up to 2) masked loads, requires all values to be an arithmetic progression
+        if(distinctValues.size() > NATIVE_VECTOR_SIZE)
+            continue;
+        auto minValue = std::numeric_limits<int32_t>::max();
+        for(auto val : distinctValues)
+            minValue = std::min(minValue, static_cast<int32_t>(val));
+        uint32_t step = 0;
+        for(auto val : distinctValues)
+            step = greatestCommonDivisor(
+                step, static_cast<uint32_t>(static_cast<int64_t>(static_cast<int32_t>(val)) - minValue));
+        if(step == 0)
+            continue;
+        std::array<uint32_t, NATIVE_VECTOR_SIZE> indices{};
+        bool fitsIndices = true;
+        for(std::size_t i = 0; i < source.size(); ++i)
+        {
+            if(!source[i])
+                continue;
+            indices[i] = static_cast<uint32_t>(
+                (static_cast<int64_t>(static_cast<int32_t>(*source[i])) - minValue) / static_cast<int64_t>(step));
+            fitsIndices = fitsIndices && indices[i] < NATIVE_VECTOR_SIZE;
+        }
+        if(!fitsIndices)
+            continue;
+        const bool requiresUpperBits =
+            std::any_of(indices.begin(), indices.end(), [](uint32_t index) -> bool { return index > 3; });
+        // for upper bits: load lower bits, load upper bits, shift upper bits, add
+        if(fitIndices(source, indices, requiresUpperBits ? 4 : 1, candidate))
+        {
+            candidate.fromElementNumber = false;
+            candidate.requiresUpperBits = requiresUpperBits;
+            for(std::size_t i = 0; i < indices.size(); ++i)
+                candidate.loadedIndices[i] = Literal(indices[i]);
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+static NODISCARD InstructionWalker insertConstantSynthesis(
+    Method& method, InstructionWalker it, const Value& out, const ConstantSynthesis& synthesis)
+{
+    using namespace vc4c::operators;
+    const DataType tmpType = TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE);
+    // only the last instruction writes the output, all other instructions write temporaries
+    unsigned remainingSteps = synthesis.numSteps + (synthesis.rotation != 0 ? 1 : 0);
+    auto nextOutput = [&]() -> Value {
+        return --remainingSteps == 0 ? out : method.addNewLocal(tmpType, "%vector_constant");
+    };
+    auto loadMasked = [&](const SIMDVector& elements, intermediate::LoadType type) -> Value {
+        auto tmp = nextOutput();
+        it.emplace(
+            new intermediate::LoadImmediate(tmp, intermediate::LoadImmediate::fromLoadedValues(elements, type), type));
+        it.nextInBlock();
+        return tmp;
+    };
+
+    if(synthesis.isSelection)
+    {
+        auto mask = loadMasked(synthesis.loadedIndices, intermediate::LoadType::PER_ELEMENT_SIGNED);
+        auto diff = Value(Literal(synthesis.first ^ synthesis.second), TYPE_INT32);
+        auto selected = nextOutput();
+        assign(it, selected) = mask & diff;
+        if(synthesis.first != 0)
+            assign(it, nextOutput()) = selected ^ Value(Literal(synthesis.first), TYPE_INT32);
+        return it;
+    }
+
+    Value index = ELEMENT_NUMBER_REGISTER;
+    // writes the given operation into the next output and uses the result as new index
+    auto updateIndex = [&](OperationWrapper&& op) {
+        auto result = nextOutput();
+        assign(it, result) = std::move(op);
+        index = result;
+    };
+    if(synthesis.fromElementNumber)
+    {
+        if(synthesis.shift != 0)
+            updateIndex(as_unsigned{index} >> Value(SmallImmediate(synthesis.shift), TYPE_INT8));
+        if(synthesis.mask != 0)
+            updateIndex(index & Value(SmallImmediate(synthesis.mask), TYPE_INT8));
+    }
+    else if(synthesis.requiresUpperBits)
+    {
+        SIMDVector lowerBits;
+        SIMDVector upperBits;
+        for(std::size_t i = 0; i < synthesis.loadedIndices.size(); ++i)
+        {
+            lowerBits[i] = Literal(synthesis.loadedIndices[i].unsignedInt() & 3u);
+            upperBits[i] = Literal(synthesis.loadedIndices[i].unsignedInt() >> 2u);
+        }
+        auto lower = loadMasked(lowerBits, intermediate::LoadType::PER_ELEMENT_UNSIGNED);
+        auto upper = loadMasked(upperBits, intermediate::LoadType::PER_ELEMENT_UNSIGNED);
+        auto upperShifted = nextOutput();
+        assign(it, upperShifted) = upper << 2_val;
+        updateIndex(upperShifted + lower);
+    }
+    else
+    {
+        index = loadMasked(synthesis.loadedIndices, intermediate::LoadType::PER_ELEMENT_UNSIGNED);
+    }
+
+    const auto absFactor = static_cast<uint32_t>(std::abs(synthesis.factor));
+    if(absFactor != 1 && isPowerOfTwo(absFactor))
+        updateIndex(index << Value(Literal(static_cast<uint32_t>(std::log2(absFactor))), TYPE_INT8));
+    else if(absFactor != 1)
+        updateIndex(mul24(index, Value(Literal(absFactor), TYPE_INT32)));
+    if(synthesis.factor < 0)
+        updateIndex(Value(Literal(synthesis.offset), TYPE_INT32) - index);
+    else if(synthesis.offset != 0)
+        updateIndex(index + Value(Literal(synthesis.offset), TYPE_INT32));
+    if(synthesis.rotation != 0)
+        it = intermediate::insertVectorRotation(
+            it, index, Value(Literal(static_cast<uint32_t>(synthesis.rotation)), TYPE_INT8), nextOutput());
+    return it;
+}
+
 static NODISCARD InstructionWalker copyVector(Method& method, InstructionWalker it, const Value& out, const Value& in)
 {
     const auto& inContainer = in.vector();
@@ -115,6 +448,18 @@ static NODISCARD InstructionWalker copyVector(Method& method, InstructionWalker
         // try the more complex vector assembly before falling back to almost complete element-wise
         return intermediate::insertAssembleVector(it, method, out, *std::move(sources));
     }
+    // the input could be an array lowered into register, so the type is not required to be a vector
+    auto typeWidth =
+        in.type.getArrayType() ? static_cast<uint8_t>(in.type.getArrayType()->size) : in.type.getVectorWidth();
+    auto synthesis = synthesizeConstant(inContainer, typeWidth, in.type.getElementType().isFloatingType());
+    if(synthesis.costs < getElementWiseCosts(inContainer, typeWidth))
+    {
+        // calculate the vector with a short sequence of arithmetic operations instead of inserting single elements
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Calculating constant vector with " << synthesis.costs
+                << " instructions instead of inserting the elements: " << in.to_string() << logging::endl);
+        return insertConstantSynthesis(method, it, out, synthesis);
+    }
     Value realOut = out;
     if(!out.checkLocal())
     {
@@ -125,9 +470,6 @@ static NODISCARD InstructionWalker copyVector(Method& method, InstructionWalker
         throw CompilationError(CompilationStep::OPTIMIZER, "Input vector has invalid type", in.to_string(false, true));
     }
 
-    // the input could be an array lowered into register, so the type is not required to be a vector
-    auto typeWidth =
-        in.type.getArrayType() ? static_cast<uint8_t>(in.type.getArrayType()->size) : in.type.getVectorWidth();
     auto elemType = in.type.getElementType();
     // copy first element without test for flags, so the register allocator finds an unconditional write of the
     // container
@@ -168,6 +510,25 @@ static NODISCARD InstructionWalker copyVector(Method& method, InstructionWalker
     return it;
 }
 
+unsigned normalization::estimateContainerCosts(const Value& container)
+{
+    const auto& vector = container.vector();
+    // see #copyVector for the instructions generated
+    if(vector.isUndefined() || vector.getAllSame() || vector.isElementNumber(false, false, true) ||
+        vector.isElementNumber(true, false, true) ||
+        (vector.isElementNumber(false, true, true) && vector[NATIVE_VECTOR_SIZE - 1].unsignedInt() < (1 << 16)) ||
+        std::all_of(vector.begin(), vector.end(), fitsIntoUnsignedMaskedLoad) ||
+        std::all_of(vector.begin(), vector.end(), fitsIntoSignedMaskedLoad))
+        return 1;
+    if(intermediate::checkVectorCanBeAssembled(container.type, vector))
+        // loading of the source and at most one modification
+        return 3;
+    auto typeWidth = container.type.getArrayType() ? static_cast<uint8_t>(container.type.getArrayType()->size) :
+                                                     container.type.getVectorWidth();
+    auto synthesis = synthesizeConstant(vector, typeWidth, container.type.getElementType().isFloatingType());
+    return std::min(synthesis.costs, getElementWiseCosts(vector, typeWidth));
+}
+
 InstructionWalker normalization::handleContainer(
     const Module& module, Method& method, InstructionWalker it, const Configuration& config)
 {
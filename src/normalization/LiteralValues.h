@@ -60,6 +60,12 @@ namespace vc4c
         InstructionWalker handleUseWithImmediate(
             const Module& module, Method& method, InstructionWalker it, const Configuration& config);
 
+        /*
+         * Returns the estimated number of instructions inserted by #handleContainer to calculate the given literal
+         * container in code
+         */
+        unsigned estimateContainerCosts(const Value& container);
+
         /**
          * Returns the small immediate representation of the given literal, if it can be represented as such
          */
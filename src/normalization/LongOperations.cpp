@@ -6,12 +6,15 @@
 
 #include "LongOperations.h"
 
+#include "../analysis/ValueRange.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "../intermediate/TypeConversions.h"
 #include "../intermediate/operators.h"
 #include "../intrinsics/Operators.h"
 #include "log.h"
 
+#include <limits>
+
 using namespace vc4c;
 using namespace vc4c::normalization;
 using namespace vc4c::operators;
@@ -19,10 +22,54 @@ using namespace vc4c::operators;
 // see VC4CLStdLib (_intrinsics.h)
 static constexpr unsigned char VC4CL_UNSIGNED{1};
 
+/*
+ * Returns whether only the zero flags set by the given instruction are read (before the flags are set again), e.g. by
+ * the conditional moves and branches generated for (in-)equality comparisons.
+ *
+ * NOTE: Flags are not used across basic blocks, so the search stops at the end of the block.
+ */
+static bool isOnlyZeroFlagRead(InstructionWalker it)
+{
+    it.nextInBlock();
+    while(!it.isEndOfBlock())
+    {
+        if(it.has())
+        {
+            if(auto branch = it.get<intermediate::Branch>())
+            {
+                auto cond = branch->branchCondition;
+                if(cond != BRANCH_ALWAYS && cond != BRANCH_ALL_Z_SET && cond != BRANCH_ALL_Z_CLEAR &&
+                    cond != BRANCH_ANY_Z_SET && cond != BRANCH_ANY_Z_CLEAR)
+                    return false;
+            }
+            else if(it->hasConditionalExecution())
+            {
+                auto extended = it.get<intermediate::ExtendedInstruction>();
+                auto cond = extended ? extended->getCondition() : COND_NEVER;
+                if(cond != COND_ZERO_SET && cond != COND_ZERO_CLEAR)
+                    return false;
+            }
+            if(it->doesSetFlag())
+                return true;
+        }
+        it.nextInBlock();
+    }
+    return true;
+}
+
 static void lowerFlags(Method& method, InstructionWalker it, const MultiRegisterData& output, FlagBehavior flagBehavior)
 {
     auto flagType = TYPE_INT32.toVectorType(output.lower->type.getVectorWidth());
     auto flagIt = it.copy().nextInBlock();
+    if(has_flag(flagBehavior, FlagBehavior::ZERO_ALL_ZEROS) && isOnlyZeroFlagRead(it))
+    {
+        /*
+         * Fast path for (in-)equality comparisons (e.g. against zero), where the negative flag is not read:
+         * The 64-bit value is zero if and only if the OR of its upper and lower part is zero.
+         */
+        assignNop(flagIt) = (output.lower->createReference() | output.upper->createReference(), SetFlag::SET_FLAGS);
+        return;
+    }
     // Need to combine the flags into single instruction -> for all possible combinations, find instruction
     // which produces those flags behavior...
     if(has_flag(flagBehavior,
@@ -45,6 +92,213 @@ static void lowerFlags(Method& method, InstructionWalker it, const MultiRegister
         throw CompilationError(CompilationStep::NORMALIZER, "Unhandled flag behavior for 64-bit operation");
 }
 
+/*
+ * Returns the constant value of the given part of a 64-bit operand, if known (e.g. the zero upper part of a
+ * zero-extended 32-bit value)
+ */
+static Optional<Literal> getConstantPart(const Value& part)
+{
+    return part.getConstantValue() & &Value::getLiteralValue;
+}
+
+static bool isZeroPart(const Optional<Literal>& part)
+{
+    return part && part->unsignedInt() == 0;
+}
+
+/*
+ * Returns the value range of the given part of a 64-bit operand, if it is known to be non-negative
+ */
+static Optional<analysis::ValueRange> getUnsignedRange(const Method& method, const Value& part)
+{
+    auto range = analysis::ValueRange::getValueRangeRecursive(part, &method);
+    if(range.hasExplicitBoundaries() && range.minValue >= 0.0)
+        return range;
+    return {};
+}
+
+static Value toShiftOffset(unsigned offset)
+{
+    return Value(Literal(offset), TYPE_INT8);
+}
+
+/*
+ * Lowers selected 64-bit operations into shorter instruction sequences than the general lowering, if the operand
+ * values allow it:
+ * - additions of values which are known to not produce a carry from the lower into the upper part are lowered to two
+ *   independent 32-bit additions without setting and reading the carry flag
+ * - shifts by constant offsets are lowered without the conditional execution for offsets below/above 32
+ * - bitwise operations and minimum/maximum on values with known upper parts (e.g. zero-extended 32-bit values) only
+ *   calculate the lower part, producing constant upper parts, which in turn enable these fast paths for the following
+ *   operations
+ *
+ * Returns whether the operation was lowered
+ */
+static bool lowerLongOperationFastPath(Method& method, InstructionWalker it, intermediate::Operation& op,
+    const MultiRegisterData& out, const Value& in0Low, const Value& in0Up, const Optional<Value>& in1Low,
+    const Optional<Value>& in1Up)
+{
+    if(op.hasConditionalExecution() || !in1Low || !in1Up)
+        return false;
+    if(op.doesSetFlag() && op.op != OP_AND && op.op != OP_OR && op.op != OP_XOR)
+        return false;
+    const auto outLow = out.lower->createReference();
+    const auto outUp = out.upper->createReference();
+    const auto upper0 = getConstantPart(in0Up);
+    const auto upper1 = getConstantPart(*in1Up);
+    const auto flagBehavior = op.op.flagBehavior;
+
+    if(op.op == OP_ADD)
+    {
+        auto range0 = getUnsignedRange(method, in0Low);
+        auto range1 = getUnsignedRange(method, *in1Low);
+        if(!range0 || !range1 ||
+            range0->maxValue + range1->maxValue > static_cast<double>(std::numeric_limits<uint32_t>::max()))
+            return false;
+        /*
+         * The lower parts can not overflow, so no carry needs to be added:
+         * %out.lower = %a.lower + %b.lower
+         * %out.upper = %a.upper + %b.upper
+         */
+        assign(it, outLow) = (in0Low + *in1Low, op.decoration);
+        op.setOutput(outUp);
+        op.setArgument(0, in0Up);
+        op.setArgument(1, *in1Up);
+    }
+    else if((op.op == OP_SHL || op.op == OP_SHR || op.op == OP_ASR) && in1Low->getLiteralValue() &&
+        in1Low->getLiteralValue()->unsignedInt() < 64)
+    {
+        const auto offset = in1Low->getLiteralValue()->unsignedInt();
+        if(offset == 0)
+        {
+            assign(it, outLow) = in0Low;
+            op.op = OP_OR;
+            op.setOutput(outUp);
+            op.setArgument(0, in0Up);
+            op.setArgument(1, in0Up);
+        }
+        else if(op.op == OP_SHL && offset < 32)
+        {
+            /*
+             * %out.lower = %a.lower << offset
+             * %out.upper = (%a.lower >> (32 - offset)) | (%a.upper << offset)
+             */
+            assign(it, outLow) = in0Low << toShiftOffset(offset);
+            op.setOutput(outUp);
+            if(isZeroPart(upper0))
+            {
+                op.op = OP_SHR;
+                op.setArgument(0, in0Low);
+                op.setArgument(1, toShiftOffset(32 - offset));
+            }
+            else
+            {
+                auto tmpLow = assign(it, out.lower->type, "%long_shift") =
+                    as_unsigned{in0Low} >> toShiftOffset(32 - offset);
+                auto tmpUp = assign(it, out.upper->type, "%long_shift") = in0Up << toShiftOffset(offset);
+                op.op = OP_OR;
+                op.setArgument(0, tmpLow);
+                op.setArgument(1, tmpUp);
+            }
+        }
+        else if(op.op == OP_SHL)
+        {
+            /*
+             * %out.lower = 0
+             * %out.upper = %a.lower << (offset - 32)
+             */
+            assign(it, outLow) = INT_ZERO;
+            op.setOutput(outUp);
+            op.setArgument(0, in0Low);
+            op.setArgument(1, toShiftOffset(offset - 32));
+        }
+        else if(offset < 32)
+        {
+            /*
+             * %out.lower = (%a.lower >> offset) | (%a.upper << (32 - offset))
+             * %out.upper = %a.upper >> offset
+             */
+            if(isZeroPart(upper0))
+                assign(it, outLow) = as_unsigned{in0Low} >> toShiftOffset(offset);
+            else
+            {
+                auto tmpLow = assign(it, out.lower->type, "%long_shift") = as_unsigned{in0Low} >> toShiftOffset(offset);
+                auto tmpUp = assign(it, out.upper->type, "%long_shift") = in0Up << toShiftOffset(32 - offset);
+                assign(it, outLow) = tmpLow | tmpUp;
+            }
+            op.setOutput(outUp);
+            op.setArgument(0, in0Up);
+            op.setArgument(1, toShiftOffset(offset));
+        }
+        else
+        {
+            /*
+             * %out.lower = %a.upper >> (offset - 32)
+             * %out.upper = 0 (or sign-extension)
+             */
+            if(op.op == OP_ASR)
+                assign(it, outLow) = as_signed{in0Up} >> toShiftOffset(offset - 32);
+            else
+                assign(it, outLow) = as_unsigned{in0Up} >> toShiftOffset(offset - 32);
+            op.setOutput(outUp);
+            op.setArgument(0, op.op == OP_ASR ? in0Up : INT_ZERO);
+            op.setArgument(1, op.op == OP_ASR ? toShiftOffset(31) : INT_ZERO);
+            if(op.op != OP_ASR)
+                op.op = OP_OR;
+        }
+    }
+    else if(op.op == OP_AND || op.op == OP_OR || op.op == OP_XOR)
+    {
+        Optional<Value> upperResult;
+        if(op.op == OP_AND && (isZeroPart(upper0) || isZeroPart(upper1)))
+            upperResult = INT_ZERO;
+        else if(op.op != OP_AND && isZeroPart(upper0))
+            upperResult = *in1Up;
+        else if(op.op != OP_AND && isZeroPart(upper1))
+            upperResult = in0Up;
+        else
+            return false;
+        /*
+         * Only the lower part needs to be calculated, the upper part is one of the upper parts of the operands:
+         * %out.lower = %a.lower op %b.lower
+         * %out.upper = %a.upper or %b.upper or 0
+         */
+        it.emplace(new intermediate::Operation(op.op, outLow, in0Low, *in1Low));
+        it->addDecorations(op.decoration);
+        it.nextInBlock();
+        op.op = OP_OR;
+        op.setOutput(outUp);
+        op.setArgument(0, *upperResult);
+        op.setArgument(1, *upperResult);
+    }
+    else if((op.op == OP_MIN || op.op == OP_MAX) && upper0 && upper1 && *upper0 == *upper1)
+    {
+        // for equal upper parts, the result only depends on the lower parts, which we need to compare unsigned
+        auto range0 = getUnsignedRange(method, in0Low);
+        auto range1 = getUnsignedRange(method, *in1Low);
+        const auto maxSigned = static_cast<double>(std::numeric_limits<int32_t>::max());
+        if(!range0 || !range1 || range0->maxValue > maxSigned || range1->maxValue > maxSigned)
+            return false;
+        /*
+         * %out.upper = %a.upper
+         * %out.lower = min/max(%a.lower, %b.lower)
+         */
+        assign(it, outUp) = in0Up;
+        op.setOutput(outLow);
+        op.setArgument(0, in0Low);
+        op.setArgument(1, *in1Low);
+    }
+    else
+        return false;
+
+    if(op.doesSetFlag())
+    {
+        op.setSetFlags(SetFlag::DONT_SET);
+        lowerFlags(method, it, out, flagBehavior);
+    }
+    return true;
+}
+
 static void lowerLongOperation(
     Method& method, InstructionWalker it, intermediate::Operation& op, const Configuration& config)
 {
@@ -98,6 +352,12 @@ static void lowerLongOperation(
         out = Local::getLocalData<MultiRegisterData>(outLocal);
     }
 
+    if(lowerLongOperationFastPath(method, it, op, *out, in0Low, in0Up, in1Low, in1Up))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG, log << "Used fast path to lower 64-bit operation" << logging::endl);
+        return;
+    }
+
     if(op.op == OP_ADD)
     {
         /*
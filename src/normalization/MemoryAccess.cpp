@@ -9,8 +9,11 @@
 #include "../InstructionWalker.h"
 #include "../Module.h"
 #include "../Profiler.h"
+#include "../analysis/ControlFlowGraph.h"
+#include "../analysis/MemoryAnalysis.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "../intermediate/operators.h"
+#include "../periphery/TMU.h"
 #include "../periphery/VPM.h"
 #include "AddressCalculation.h"
 #include "MemoryMappings.h"
@@ -195,8 +198,67 @@ struct VPMAccessGroup
     }
 };
 
+// maps basic blocks to the following block they are always executed together with
+using LinearSuccessors = FastMap<const BasicBlock*, BasicBlock*>;
+
+/*
+ * Determines for all basic blocks the block directly following, if the control flow can only continue with the
+ * following block and the following block can only be reached from the preceding block, i.e. the two blocks are always
+ * executed together.
+ */
+static LinearSuccessors determineLinearSuccessors(Method& method)
+{
+    LinearSuccessors linearSuccessors;
+    auto& cfg = method.getCFG();
+    for(auto& block : method)
+    {
+        auto& node = cfg.assertNode(&block);
+        auto successor = node.getSingleSuccessor();
+        if(successor && successor != &node && successor->getSinglePredecessor() == &node)
+            linearSuccessors.emplace(&block, successor->key);
+    }
+    return linearSuccessors;
+}
+
+/*
+ * Advances the walker to the next instruction, continuing at the start of the linear successor (if any) when the end
+ * of the current block is reached.
+ */
+static InstructionWalker& nextInLinearFlow(InstructionWalker& it, const LinearSuccessors& linearSuccessors)
+{
+    it.nextInBlock();
+    if(it.isEndOfBlock())
+    {
+        auto successorIt = linearSuccessors.find(it.getBasicBlock());
+        if(successorIt != linearSuccessors.end())
+            it = successorIt->second->walk();
+    }
+    return it;
+}
+
+/*
+ * Removes all mutex locks and unlocks between the two given instructions (following the linear control flow), so the
+ * combined VPM accesses are executed within a single locked region
+ */
+static std::size_t removeMutexAccesses(
+    InstructionWalker it, const InstructionWalker end, const LinearSuccessors& linearSuccessors)
+{
+    std::size_t numRemoved = 0;
+    while(!it.isEndOfBlock() && it != end)
+    {
+        if(it.get() && (it->writesRegister(REG_MUTEX) || it->readsRegister(REG_MUTEX)))
+        {
+            // the empty instruction is cleaned up in #combineVPMAccess
+            it.reset(nullptr);
+            ++numRemoved;
+        }
+        nextInLinearFlow(it, linearSuccessors);
+    }
+    return numRemoved;
+}
+
 static InstructionWalker findGroupOfVPMAccess(
-    VPM& vpm, InstructionWalker start, const InstructionWalker end, VPMAccessGroup& group)
+    VPM& vpm, InstructionWalker start, const LinearSuccessors& linearSuccessors, VPMAccessGroup& group)
 {
     Optional<Value> baseAddress = NO_VALUE;
     int32_t nextOffset = -1;
@@ -214,18 +276,19 @@ static InstructionWalker findGroupOfVPMAccess(
     // 1) is not too large: either in total numbers of instructions or in ratio instructions / VPW writes, since we save
     // a few cycles per write (incl. delay for wait DMA)
 
+    // the group can continue into the following basic blocks as long as they are always executed together
     auto it = start;
-    for(; !it.isEndOfBlock() && it != end; it.nextInBlock())
+    for(; !it.isEndOfBlock(); nextInLinearFlow(it, linearSuccessors))
     {
         if(it.get() == nullptr)
             continue;
 
         if(it.get<MemoryBarrier>())
             // memory barriers end groups, also don't check this barrier again
-            return it.nextInBlock();
+            return nextInLinearFlow(it, linearSuccessors);
         if(it.get<SemaphoreAdjustment>())
             // semaphore accesses end groups, also don't check this instruction again
-            return it.nextInBlock();
+            return nextInLinearFlow(it, linearSuccessors);
 
         if(!(it->writesRegister(REG_VPM_DMA_LOAD_ADDR) || it->writesRegister(REG_VPM_DMA_STORE_ADDR)))
             // for simplicity, we only check for VPM addresses and find all other instructions relative to it
@@ -243,12 +306,12 @@ static InstructionWalker findGroupOfVPMAccess(
         if(!baseAndOffset.base)
             // this address-write could not be fixed to a base and an offset
             // skip this address write for the next check
-            return it.nextInBlock();
+            return nextInLinearFlow(it, linearSuccessors);
         if(baseAndOffset.base && baseAndOffset.base->checkLocal() && baseAndOffset.base->local()->is<Parameter>() &&
             has_flag(baseAndOffset.base->local()->as<Parameter>()->decorations, ParameterDecorations::VOLATILE))
             // address points to a volatile parameter, which explicitly forbids combining reads/writes
             // skip this address write for the next check
-            return it.nextInBlock();
+            return nextInLinearFlow(it, linearSuccessors);
 
         // check if this address is consecutive to the previous one (if any)
         if(baseAddress)
@@ -306,7 +369,7 @@ static InstructionWalker findGroupOfVPMAccess(
         if(!elementType.isSimpleType())
             // XXX for now, skip combining any access to complex types (here: only struct, image)
             // don't check this read/write again
-            return it.nextInBlock();
+            return nextInLinearFlow(it, linearSuccessors);
 
         // all matches so far, add to group (or create a new one)
         group.isVPMWrite = isVPMWrite;
@@ -325,7 +388,7 @@ static InstructionWalker findGroupOfVPMAccess(
         {
             // since the current address write might be removed, skip to next instruction
             // TODO could the following instruction(s) be removed too?? (See beneath)
-            return it.nextInBlock();
+            return nextInLinearFlow(it, linearSuccessors);
         }
         if(!group.isVPMWrite && group.addressWrites.size() >= vpm.getMaxCacheVectors(elementType, false))
         {
@@ -342,7 +405,7 @@ static InstructionWalker findGroupOfVPMAccess(
     return it;
 }
 
-static void groupVPMWrites(VPM& vpm, VPMAccessGroup& group)
+static void groupVPMWrites(VPM& vpm, VPMAccessGroup& group, const LinearSuccessors& linearSuccessors)
 {
     if(group.genericSetups.size() != group.addressWrites.size() || group.genericSetups.size() != group.dmaSetups.size())
     {
@@ -412,27 +475,12 @@ static void groupVPMWrites(VPM& vpm, VPMAccessGroup& group)
     }
 
     // 4. remove all Mutex acquires and releases between the first and the last write, so memory consistency is restored
-    auto it = group.dmaSetups.front();
-    while(!it.isEndOfBlock() && it != group.addressWrites.back())
-    {
-        if(it.get() && it->writesRegister(REG_MUTEX))
-        {
-            it = it.erase();
-            ++numRemoved;
-        }
-        else if(it.get() && it->readsRegister(REG_MUTEX))
-        {
-            it = it.erase();
-            ++numRemoved;
-        }
-        else
-            it.nextInBlock();
-    }
+    numRemoved += removeMutexAccesses(group.dmaSetups.front(), group.addressWrites.back(), linearSuccessors);
 
     logging::debug() << "Removed " << numRemoved << " instructions by combining VPW writes" << logging::endl;
 }
 
-static void groupVPMReads(VPM& vpm, VPMAccessGroup& group)
+static void groupVPMReads(VPM& vpm, VPMAccessGroup& group, const LinearSuccessors& linearSuccessors)
 {
     if(group.genericSetups.size() != group.addressWrites.size() || group.genericSetups.size() != group.dmaSetups.size())
     {
@@ -494,22 +542,7 @@ static void groupVPMReads(VPM& vpm, VPMAccessGroup& group)
     }
 
     // 3. remove all Mutex acquires and releases between the first and the last write, so memory consistency is restored
-    auto it = group.addressWrites.front();
-    while(!it.isEndOfBlock() && it != group.addressWrites.back())
-    {
-        if(it.get() && it->writesRegister(REG_MUTEX))
-        {
-            it = it.erase();
-            ++numRemoved;
-        }
-        else if(it.get() && it->readsRegister(REG_MUTEX))
-        {
-            it = it.erase();
-            ++numRemoved;
-        }
-        else
-            it.nextInBlock();
-    }
+    numRemoved += removeMutexAccesses(group.addressWrites.front(), group.addressWrites.back(), linearSuccessors);
 
     // 4. remove all but the first address writes (and the following DMA writes)
     for(std::size_t i = 1; i < group.addressWrites.size(); ++i)
@@ -531,33 +564,43 @@ static void groupVPMReads(VPM& vpm, VPMAccessGroup& group)
  * Combine consecutive configuration of VPW/VPR with the same settings
  *
  * In detail, this combines VPM read/writes of uniform type of access (read or write), uniform data-type and consecutive
- * memory-addresses
+ * (or equidistant) memory-addresses into a single multi-row DMA access. The combined accesses are not limited to a
+ * single basic block, but can span all basic blocks which are always executed together (see
+ * #determineLinearSuccessors).
  *
  * NOTE: Combining VPM accesses merges their mutex-lock blocks which can cause other QPUs to stall for a long time.
  * Also, this optimization currently only supports access memory <-> QPU, data exchange between only memory and VPM are
  * not optimized
  */
-static void combineVPMAccess(FastSet<BasicBlock*>& blocks, Method& method)
+static void combineVPMAccess(Method& method)
 {
     // combine configurations of VPM (VPW/VPR) which have the same values
 
     // TODO for now, this cannot handle RAM->VPM, VPM->RAM only access as well as VPM->QPU or QPU->VPM
 
-    // run within all basic blocks
-    for(BasicBlock* block : blocks)
+    const auto linearSuccessors = determineLinearSuccessors(method);
+    FastSet<const BasicBlock*> continuedBlocks;
+    for(const auto& entry : linearSuccessors)
+        continuedBlocks.emplace(entry.second);
+
+    // run along all chains of basic blocks always executed together
+    for(BasicBlock& block : method)
     {
-        auto it = block->walk();
+        if(continuedBlocks.find(&block) != continuedBlocks.end())
+            // is handled as part of the chain of its predecessor
+            continue;
+        auto it = block.walk();
         while(!it.isEndOfBlock())
         {
             VPMAccessGroup group;
-            it = findGroupOfVPMAccess(*method.vpm.get(), it, block->walkEnd(), group);
+            it = findGroupOfVPMAccess(*method.vpm.get(), it, linearSuccessors, group);
             if(group.addressWrites.size() > 1)
             {
                 group.cleanDuplicateInstructions();
                 if(group.isVPMWrite)
-                    groupVPMWrites(*method.vpm.get(), group);
+                    groupVPMWrites(*method.vpm.get(), group, linearSuccessors);
                 else
-                    groupVPMReads(*method.vpm.get(), group);
+                    groupVPMReads(*method.vpm.get(), group, linearSuccessors);
             }
         }
     }
@@ -829,6 +872,539 @@ static tools::SmallSortedPointerSet<const MemoryInfo*> getMemoryInfos(const Loca
  */
 /* clang-format on */
 
+/*
+ * Loads the cached global memory area into VPM at the start of the kernel and writes it back to RAM at the end of the
+ * kernel, see checkCacheGlobalMemory() in MemoryMapChecks.cpp
+ */
+static void insertVPMCacheLoadAndWriteBack(Method& method, const MemoryInfo& info)
+{
+    const auto elementType = info.local->type.getElementType();
+    // every (32-bit scalar) element is stored in its own VPM row
+    const unsigned numElements = info.area->numRows;
+    const auto baseAddress = info.local->createReference();
+
+    auto it = method.begin()->walk().nextInBlock();
+    // a single DMA load can transfer at most 16 rows
+    for(unsigned offset = 0; offset < numElements; offset += 16)
+    {
+        Value byteOffset(Literal(offset * elementType.getInMemoryWidth()), TYPE_INT32);
+        auto address = baseAddress;
+        if(offset != 0)
+            address = assign(it, baseAddress.type, "%vpm_cache_address") = baseAddress + byteOffset;
+        it = method.vpm->insertReadRAM(method, it, address, elementType, info.area, true, byteOffset,
+            Value(Literal(std::min(numElements - offset, 16u)), TYPE_INT32));
+    }
+
+    it = method.findBasicBlock(BasicBlock::LAST_BLOCK)->walkEnd();
+    it = method.vpm->insertWriteRAM(
+        method, it, baseAddress, elementType, info.area, true, INT_ZERO, Value(Literal(numElements), TYPE_INT32));
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Inserted loading of " << numElements << " elements of '" << info.local->to_string()
+            << "' into VPM cache and writing them back at the end of the kernel" << logging::endl);
+}
+
+/*
+ * Returns the address and the number of bytes of the memory read (or written) by the given memory access instruction
+ */
+static Optional<std::pair<Value, unsigned>> getAccessedMemory(const MemoryInstruction& mem, bool destination)
+{
+    auto numEntries = mem.getNumEntries().getLiteralValue();
+    const auto& address = destination ? mem.getDestination() : mem.getSource();
+    auto param = address.checkLocal() ? address.local()->getBase(true)->as<Parameter>() : nullptr;
+    if(!numEntries || (param && has_flag(param->decorations, ParameterDecorations::VOLATILE)))
+        // the accessed size is unknown or the memory must not be accessed in any other order
+        return {};
+    auto type = destination ? mem.getDestinationElementType(true) : mem.getSourceElementType(true);
+    return std::make_pair(address, type.getInMemoryWidth());
+}
+
+/*
+ * Checks whether the memory read can be moved in front of the given instruction
+ */
+static bool canMoveReadBefore(const Method& method, const MemoryInstruction& read,
+    const std::pair<Value, unsigned>& readMemory, const IntermediateInstruction& inst)
+{
+    const auto& output = read.getDestination();
+    if(inst.readsLocal(output.local()) || inst.writesLocal(output.local()))
+        return false;
+    for(const auto& arg : read.getArguments())
+    {
+        if(arg.checkLocal() && inst.writesLocal(arg.local()))
+            return false;
+    }
+    if(auto mem = dynamic_cast<const MemoryInstruction*>(&inst))
+    {
+        if(mem->op == MemoryOperation::READ)
+            // the order of reads does not matter
+            return !mem->hasConditionalExecution() && getAccessedMemory(*mem, false).has_value();
+        auto writtenMemory = getAccessedMemory(*mem, true);
+        return !mem->hasConditionalExecution() && writtenMemory &&
+            !analysis::mayAlias(
+                method, readMemory.first, readMemory.second, writtenMemory->first, writtenMemory->second);
+    }
+    return !inst.hasSideEffects() && !inst.hasConditionalExecution();
+}
+
+// The maximum number of instructions between two critical sections to still be merged into a single one
+static constexpr unsigned MAX_CRITICAL_SECTION_GAP = 4;
+
+static bool isMutexAccess(const IntermediateInstruction* inst, MutexAccess access)
+{
+    auto mutex = dynamic_cast<const MutexLock*>(inst);
+    return mutex && (access == MutexAccess::LOCK ? mutex->locksMutex() : mutex->releasesMutex());
+}
+
+/*
+ * Merges the critical section ending at the given mutex release with the following critical section, if they are only
+ * separated by a few calculations not accessing any memory
+ */
+static bool mergeWithNextCriticalSection(InstructionWalker releaseIt)
+{
+    unsigned numInstructions = 0;
+    auto it = releaseIt.copy().nextInBlock();
+    for(; !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(isMutexAccess(it.get(), MutexAccess::LOCK))
+            break;
+        if(!it->checkOutputLocal() || it->hasSideEffects() || it->hasConditionalExecution() || it->doesSetFlag() ||
+            ++numInstructions > MAX_CRITICAL_SECTION_GAP)
+            return false;
+    }
+    if(it.isEndOfBlock())
+        return false;
+    releaseIt.reset(nullptr);
+    it.reset(nullptr);
+    return true;
+}
+
+/*
+ * Returns whether the given value is the same at all instructions reading it, so it can replace a later read of the
+ * memory it was read from or written to
+ */
+static bool isForwardableValue(const Value& val)
+{
+    if(val.getLiteralValue() || val.checkImmediate())
+        return true;
+    auto loc = val.checkLocal();
+    return loc && loc->getUsers(LocalUse::Type::WRITER).size() <= 1;
+}
+
+/*
+ * The value last read from or written to a memory location inside of the current critical section
+ */
+struct KnownMemoryValue
+{
+    DataType type;
+    Optional<Value> value;
+    // the last write of the memory location, if the location was not read (via memory) since
+    Optional<InstructionWalker> lastWrite;
+};
+
+/*
+ * Returns the address of the single element accessed by the given memory instruction, if the access can be combined
+ * with other accesses to the same address
+ */
+static const Local* getSingleAccessedAddress(const MemoryInstruction& mem, bool destination)
+{
+    auto numEntries = mem.getNumEntries().getLiteralValue();
+    if(mem.hasConditionalExecution() || !numEntries || numEntries->unsignedInt() != 1 ||
+        !getAccessedMemory(mem, destination))
+        return nullptr;
+    auto address = destination ? mem.getDestination().checkLocal() : mem.getSource().checkLocal();
+    return address && address->getUsers(LocalUse::Type::WRITER).size() <= 1 ? address : nullptr;
+}
+
+void normalization::combineCriticalSections(const Module& module, Method& method, const Configuration& config)
+{
+    std::size_t numMerged = 0;
+    std::size_t numForwarded = 0;
+    std::size_t numRemoved = 0;
+    for(auto& block : method)
+    {
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has() && isMutexAccess(it.get(), MutexAccess::RELEASE) && mergeWithNextCriticalSection(it))
+                ++numMerged;
+        }
+
+        // while the mutex is locked, no other QPU accesses the memory guarded by it, so the memory contents only change
+        // by the memory accesses of this QPU
+        bool isLocked = false;
+        FastMap<const Local*, KnownMemoryValue> knownValues;
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            if(isMutexAccess(it.get(), MutexAccess::LOCK) || isMutexAccess(it.get(), MutexAccess::RELEASE))
+            {
+                isLocked = isMutexAccess(it.get(), MutexAccess::LOCK);
+                knownValues.clear();
+                continue;
+            }
+            if(!isLocked)
+                continue;
+            auto mem = it.get<MemoryInstruction>();
+            if(mem && mem->op == MemoryOperation::READ && mem->getDestination().checkLocal())
+            {
+                if(auto address = getSingleAccessedAddress(*mem, false))
+                {
+                    auto type = mem->getSourceElementType();
+                    auto knownIt = knownValues.find(address);
+                    if(knownIt != knownValues.end() && knownIt->second.value && knownIt->second.type == type)
+                    {
+                        CPPLOG_LAZY(logging::Level::DEBUG,
+                            log << "Forwarding memory value " << knownIt->second.value->to_string()
+                                << " inside critical section to: " << mem->to_string() << logging::endl);
+                        it.reset(new MoveOperation(mem->getDestination(), knownIt->second.value.value()));
+                        ++numForwarded;
+                        continue;
+                    }
+                    // the read memory might alias any previously written memory location
+                    for(auto& entry : knownValues)
+                        entry.second.lastWrite = {};
+                    auto value = isForwardableValue(mem->getDestination()) ? mem->getDestination() : Optional<Value>{};
+                    knownValues.erase(address);
+                    knownValues.emplace(address, KnownMemoryValue{type, value, {}});
+                    continue;
+                }
+            }
+            else if(mem && mem->op == MemoryOperation::WRITE)
+            {
+                if(auto address = getSingleAccessedAddress(*mem, true))
+                {
+                    auto type = mem->getDestinationElementType();
+                    auto knownIt = knownValues.find(address);
+                    if(knownIt != knownValues.end() && knownIt->second.lastWrite && knownIt->second.type == type)
+                    {
+                        CPPLOG_LAZY(logging::Level::DEBUG,
+                            log << "Removing memory write overwritten inside critical section: "
+                                << (*knownIt->second.lastWrite)->to_string() << logging::endl);
+                        knownIt->second.lastWrite->reset(nullptr);
+                        ++numRemoved;
+                    }
+                    // the written memory might alias any other known memory location
+                    knownValues.clear();
+                    auto value = isForwardableValue(mem->getSource()) ? mem->getSource() : Optional<Value>{};
+                    knownValues.emplace(address, KnownMemoryValue{type, value, it});
+                    continue;
+                }
+            }
+            if(mem || it->hasSideEffects())
+            {
+                knownValues.clear();
+                continue;
+            }
+            if(auto out = it->checkOutputLocal())
+            {
+                // the forwarded values or addresses are no longer valid after being overwritten
+                for(auto entryIt = knownValues.begin(); entryIt != knownValues.end();)
+                {
+                    if(entryIt->first == out || (entryIt->second.value && entryIt->second.value->hasLocal(out)))
+                        entryIt = knownValues.erase(entryIt);
+                    else
+                        ++entryIt;
+                }
+            }
+        }
+    }
+    if(numMerged > 0 || numRemoved > 0)
+        method.cleanEmptyInstructions();
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Merged " << numMerged << " critical sections, forwarded " << numForwarded
+            << " memory reads and removed " << numRemoved << " overwritten memory writes" << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_NORMALIZATION + 8, "Memory reads forwarded in critical sections",
+        numForwarded);
+}
+
+// the maximum number of locals a single stack allocation is split into to not exhaust the registers
+static constexpr std::size_t MAX_SPLIT_STACK_ELEMENTS = 16;
+
+struct SplitStackAllocation
+{
+    // the byte offsets of all addresses (derived from the stack allocation) into the stack allocation
+    FastMap<const Local*, int32_t> addressOffsets;
+    // the type of the element accessed at the given byte offset
+    SortedMap<int32_t, DataType> accessedElements;
+};
+
+static bool addSplitElementAccess(SplitStackAllocation& split, int32_t offset, DataType type)
+{
+    if(type.getPointerType() || type.getElementType().getScalarBitCount() > 32)
+        return false;
+    auto it = split.accessedElements.find(offset);
+    if(it != split.accessedElements.end())
+        // all accesses to the same element need to use the same type
+        return it->second == type;
+    split.accessedElements.emplace(offset, type);
+    return true;
+}
+
+/*
+ * Follows all uses of the given address (and the addresses derived from it) and determines the accessed elements.
+ *
+ * Returns false, if the stack allocation cannot be split, e.g. since it is accessed with a dynamic offset or the
+ * address escapes.
+ */
+static bool collectSplitElements(SplitStackAllocation& split, const Local* address, int32_t offset)
+{
+    if(!split.addressOffsets.emplace(address, offset).second)
+        return split.addressOffsets.at(address) == offset;
+    for(const auto& user : address->getUsers())
+    {
+        if(!user.second.readsLocal())
+            continue;
+        auto inst = user.first;
+        if(dynamic_cast<const LifetimeBoundary*>(inst))
+            continue;
+        if(inst->hasConditionalExecution() || inst->doesSetFlag())
+            return false;
+        if(auto mem = dynamic_cast<const MemoryInstruction*>(inst))
+        {
+            if(mem->getNumEntries() != INT_ONE)
+                return false;
+            if(mem->op == MemoryOperation::READ && mem->getSource().hasLocal(address) &&
+                mem->getDestination().checkLocal())
+            {
+                if(!addSplitElementAccess(split, offset, mem->getDestination().type))
+                    return false;
+                continue;
+            }
+            if(mem->op == MemoryOperation::WRITE && mem->getDestination().hasLocal(address) &&
+                !mem->getSource().hasLocal(address))
+            {
+                if(!addSplitElementAccess(split, offset, mem->getSource().type))
+                    return false;
+                continue;
+            }
+            // copying or filling, or the address is stored in memory
+            return false;
+        }
+        auto out = inst->checkOutputLocal();
+        if(!out || out->getSingleWriter() != inst)
+            return false;
+        if(auto move = dynamic_cast<const MoveOperation*>(inst))
+        {
+            if(!move->isSimpleMove() || !collectSplitElements(split, out, offset))
+                return false;
+            continue;
+        }
+        auto op = dynamic_cast<const Operation*>(inst);
+        if(op && op->op == OP_ADD && !op->hasPackMode() && !op->hasUnpackMode())
+        {
+            auto otherArg = op->getFirstArg().hasLocal(address) ? op->getSecondArg() : op->getFirstArg();
+            auto lit = otherArg & &Value::getLiteralValue;
+            if(lit && collectSplitElements(split, out, offset + lit->signedInt()))
+                continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+static bool canSplitStackAllocation(const StackAllocation& allocation, const SplitStackAllocation& split)
+{
+    if(split.accessedElements.empty() || split.accessedElements.size() > MAX_SPLIT_STACK_ELEMENTS)
+        return false;
+    // the accessed elements must not overlap, since each element is mapped to its own local
+    int32_t endOfPrevious = 0;
+    for(const auto& element : split.accessedElements)
+    {
+        if(element.first < endOfPrevious)
+            return false;
+        endOfPrevious = element.first + static_cast<int32_t>(element.second.getInMemoryWidth());
+    }
+    return static_cast<std::size_t>(endOfPrevious) <= allocation.size;
+}
+
+void normalization::splitStackAllocations(const Module& module, Method& method, const Configuration& config)
+{
+    // maps the addresses derived from split stack allocations to the local replacing the accessed element
+    FastMap<const Local*, Value> addressMappings;
+    for(auto& allocation : method.stackAllocations)
+    {
+        if(allocation.isLowered || allocation.type.getPointerType()->elementType.isSimpleType())
+            // simple values are lowered into a single register anyway
+            continue;
+        SplitStackAllocation split;
+        if(!collectSplitElements(split, &allocation, 0) || !canSplitStackAllocation(allocation, split))
+            continue;
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Splitting stack allocation '" << allocation.to_string() << "' into "
+                << split.accessedElements.size() << " locals" << logging::endl);
+        FastMap<int32_t, Value> elements;
+        for(const auto& element : split.accessedElements)
+            elements.emplace(element.first,
+                method.addNewLocal(element.second, allocation.name, "element." + std::to_string(element.first)));
+        for(const auto& address : split.addressOffsets)
+        {
+            auto elementIt = elements.find(address.second);
+            if(elementIt != elements.end())
+                addressMappings.emplace(address.first, elementIt->second);
+        }
+        // the stack allocation is no longer accessed in memory
+        const_cast<StackAllocation&>(allocation).isLowered = true;
+    }
+    if(addressMappings.empty())
+        return;
+
+    std::size_t numRewritten = 0;
+    for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+    {
+        auto mem = it.get<MemoryInstruction>();
+        if(!mem)
+            continue;
+        const auto& address = mem->op == MemoryOperation::READ ? mem->getSource() : mem->getDestination();
+        auto mappingIt = address.checkLocal() ? addressMappings.find(address.local()) : addressMappings.end();
+        if(mappingIt == addressMappings.end())
+            continue;
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Replacing access to split stack allocation: " << mem->to_string() << logging::endl);
+        if(mem->op == MemoryOperation::READ)
+            it.reset((new MoveOperation(mem->getDestination(), mappingIt->second))->copyExtrasFrom(mem));
+        else
+            it.reset((new MoveOperation(mappingIt->second, mem->getSource()))->copyExtrasFrom(mem));
+        ++numRewritten;
+    }
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_NORMALIZATION + 9, "Stack accesses replaced with locals", numRewritten);
+}
+
+/*
+ * Moves memory reads in front of the preceding writes to independent memory (see analysis::mayAlias) to directly follow
+ * the previous read of the same memory object in the same basic block.
+ *
+ * This groups reads and writes of the same memory objects, which otherwise are interleaved for kernels reading from and
+ * writing to separate buffers, so the DMA accesses can be combined (see #combineVPMAccess). Additionally, the reads are
+ * started earlier.
+ *
+ * Example:
+ *   %a = load memory at %in
+ *   store memory at %out = %a
+ *   %in_addr = add %in, 4
+ *   %b = load memory at %in_addr
+ *   %out_addr = add %out, 4
+ *   store memory at %out_addr = %b
+ *
+ * is converted to:
+ *   %a = load memory at %in
+ *   %in_addr = add %in, 4
+ *   %b = load memory at %in_addr
+ *   store memory at %out = %a
+ *   %out_addr = add %out, 4
+ *   store memory at %out_addr = %b
+ */
+static void groupIndependentMemoryReads(Method& method)
+{
+    std::size_t numMoved = 0;
+    for(auto& block : method)
+    {
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            auto read = it.get<MemoryInstruction>();
+            if(!read || read->op != MemoryOperation::READ || read->hasConditionalExecution() ||
+                !read->getDestination().checkLocal())
+                continue;
+            auto readMemory = getAccessedMemory(*read, false);
+            if(!readMemory)
+                continue;
+            auto memoryObject = readMemory->first.local()->getBase(true);
+
+            // find the previous read of the same memory object, all instructions in between need to be skipped
+            bool skipsWrite = false;
+            auto previousRead = it.copy().previousInBlock();
+            for(; !previousRead.isStartOfBlock(); previousRead.previousInBlock())
+            {
+                if(!previousRead.has())
+                    continue;
+                auto mem = previousRead.get<MemoryInstruction>();
+                if(mem && mem->op == MemoryOperation::READ && mem->getSource().checkLocal() &&
+                    mem->getSource().local()->getBase(true) == memoryObject)
+                    break;
+                if(!canMoveReadBefore(method, *read, *readMemory, *previousRead.get()))
+                {
+                    previousRead = block.walk();
+                    break;
+                }
+                skipsWrite = skipsWrite || (mem && mem->op != MemoryOperation::READ);
+            }
+            if(previousRead.isStartOfBlock() || !skipsWrite)
+                continue;
+
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Moving memory read in front of independent memory writes: " << read->to_string()
+                    << logging::endl);
+            auto inst = it.release();
+            previousRead.nextInBlock().emplace(inst);
+            ++numMoved;
+        }
+    }
+    if(numMoved > 0)
+        method.cleanEmptyInstructions();
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_NORMALIZATION + 7, "Memory reads moved in front of writes", numMoved);
+}
+
+/*
+ * Lowers the prefetch() hints (see the vc4cl_prefetch intrinsic) depending on where the prefetched memory is located.
+ *
+ * Memory lowered into registers or the VPM (or cached completely in the VPM) is already located in fast memory and
+ * memory accessed via VPM DMA does not profit from the TMU cache, so for these the hint is dropped. For memory read via
+ * the TMU, the cache lines covering the prefetched range (one cache line per SIMD element) are loaded by a gather whose
+ * result is discarded, so the actual reads of the memory hit the TMU cache.
+ */
+static void lowerPrefetches(Method& method, const FastMap<const Local*, MemoryInfo>& infos)
+{
+    // the size of a TMU cache line in bytes
+    static constexpr int32_t TMU_CACHE_LINE_SIZE = 64;
+    for(auto& block : method)
+    {
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            auto call = it.get<const MethodCall>();
+            if(!call || call->methodName != PREFETCH_FUNCTION)
+            {
+                it.nextInBlock();
+                continue;
+            }
+            const auto& address = call->assertArgument(0);
+            const auto& numEntries = call->assertArgument(1);
+            auto baseLocal = address.checkLocal() ? address.local()->getBase(true) : nullptr;
+            auto infoIt = baseLocal ? infos.find(baseLocal) : infos.end();
+            if(infoIt == infos.end() || infoIt->second.type != MemoryAccessType::RAM_LOAD_TMU)
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Dropping prefetch of memory not read via TMU: " << call->to_string() << logging::endl);
+                it.erase();
+                continue;
+            }
+
+            // the offset of the last prefetched byte, the offsets of all SIMD elements are capped to not read behind
+            // the prefetched memory area
+            auto elementSize = static_cast<int32_t>(address.type.getElementType().getInMemoryWidth());
+            Value lastOffset = INT_ZERO;
+            if(auto lit = numEntries.getLiteralValue())
+                lastOffset = Value(Literal(std::max(lit->signedInt() * elementSize - 1, 0)), TYPE_INT32);
+            else if(numEntries.type.getScalarBitCount() <= 32)
+            {
+                auto numBytes = assign(it, TYPE_INT32, "%prefetch_size") =
+                    mul24(numEntries, Value(Literal(elementSize), TYPE_INT32));
+                numBytes = assign(it, TYPE_INT32, "%prefetch_size") = numBytes - INT_ONE;
+                lastOffset = assign(it, TYPE_INT32, "%prefetch_size") = max(numBytes, INT_ZERO);
+            }
+            auto offsets = assign(it, TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE), "%prefetch_offset") =
+                mul24(ELEMENT_NUMBER_REGISTER, Value(Literal(TMU_CACHE_LINE_SIZE), TYPE_INT8));
+            offsets = assign(it, offsets.type, "%prefetch_offset") = min(offsets, lastOffset);
+            auto addresses = assign(it, offsets.type, "%prefetch_address") = address + offsets;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Prefetching memory into TMU cache: " << call->to_string() << logging::endl);
+            // the loaded values are not needed, only the filled cache lines are
+            it = insertGatherFromTMU(method, it, Value(REG_NOP, offsets.type), addresses, selectTMU(it));
+            it.erase();
+        }
+    }
+}
+
 void normalization::mapMemoryAccess(const Module& module, Method& method, const Configuration& config)
 {
     /*
@@ -847,17 +1423,22 @@ void normalization::mapMemoryAccess(const Module& module, Method& method, const
      * 4. final pass which actually converts VPM cache
      */
 
+    groupIndependentMemoryReads(method);
+
     // determine preferred and fall-back memory access type for each memory are
     auto memoryAccessInfo = determineMemoryAccess(method);
 
     FastMap<const Local*, MemoryInfo> infos;
     {
         // gather more information about the memory areas and modify the access types. E.g. if the preferred access type
-        // cannot be used, use the fall-back
+        // cannot be used, use the fall-back.
+        // The areas are checked in the order of their estimated cost savings, so the areas profiting the most from the
+        // VPM space reserve it first.
         infos.reserve(memoryAccessInfo.memoryAccesses.size());
-        for(auto& mapping : memoryAccessInfo.memoryAccesses)
+        for(auto local : determineMappingOrder(method, memoryAccessInfo.memoryAccesses))
         {
-            auto it = infos.emplace(mapping.first, checkMemoryMapping(method, mapping.first, mapping.second));
+            auto& access = memoryAccessInfo.memoryAccesses.at(local);
+            auto it = infos.emplace(local, checkMemoryMapping(method, local, access));
             CPPLOG_LAZY(logging::Level::DEBUG,
                 log << (it.first->first->is<Parameter>() ?
                                "Parameter" :
@@ -867,8 +1448,7 @@ void normalization::mapMemoryAccess(const Module& module, Method& method, const
         }
     }
 
-    // list of basic blocks where multiple VPM accesses could be combined
-    FastSet<BasicBlock*> affectedBlocks;
+    lowerPrefetches(method, infos);
 
     // TODO sort locals by where to put them and then call 1. check of mapping and 2. mapping on all
     for(auto& memIt : memoryAccessInfo.accessInstructions)
@@ -880,19 +1460,20 @@ void normalization::mapMemoryAccess(const Module& module, Method& method, const
         auto sourceInfos = getMemoryInfos(srcBaseLocal, infos, memoryAccessInfo.additionalAreaMappings);
         auto destInfos = getMemoryInfos(dstBaseLocal, infos, memoryAccessInfo.additionalAreaMappings);
 
-        auto checkVPMAccess = [](const MemoryInfo* info) { return info->type == MemoryAccessType::RAM_READ_WRITE_VPM; };
-        if(std::any_of(sourceInfos.begin(), sourceInfos.end(), checkVPMAccess) ||
-            std::any_of(destInfos.begin(), destInfos.end(), checkVPMAccess))
-            affectedBlocks.emplace(InstructionWalker{memIt}.getBasicBlock());
-
         mapMemoryAccess(method, memIt, const_cast<MemoryInstruction*>(mem), sourceInfos, destInfos);
-        // TODO mark local for prefetch/write-back (if necessary)
+        // TODO mark local for write-back (if necessary)
+    }
+
+    for(const auto& info : infos)
+    {
+        if(info.second.type == MemoryAccessType::RAM_READ_WRITE_VPM && info.second.area)
+            insertVPMCacheLoadAndWriteBack(method, info.second);
     }
 
     method.vpm->dumpUsage();
 
     // TODO move this to optimization?
-    combineVPMAccess(affectedBlocks, method);
+    combineVPMAccess(method);
 
     // TODO clean up no longer used (all kernels!) globals and stack allocations
 }
@@ -16,6 +16,12 @@ namespace vc4c
 
     namespace normalization
     {
+        /*
+         * The name of the function call the prefetch() hints are kept as until the memory access is mapped (see
+         * #mapMemoryAccess)
+         */
+        constexpr const char* PREFETCH_FUNCTION = "vc4cl_prefetch";
+
         /*
          * Replaces the address of global data with the corresponding offset from the GLOBAL_DATA_ADDRESS value
          */
@@ -26,7 +32,8 @@ namespace vc4c
          * Spills long-living locals which are rarely read into the VPM to be cached there.
          * Also splits the uses before and after being spilled into several locals
          *
-         * NOTE: This step currently only runs the analysis of spill-candidates, no actual spilling is performed
+         * NOTE: This step currently only runs the analysis of spill-candidates, the actual spilling is performed on
+         * register allocation errors (see qpu_asm::spillLocals)
          */
         void spillLocals(const Module& module, Method& method, const Configuration& config);
 
@@ -41,10 +48,72 @@ namespace vc4c
         void resolveStackAllocation(
             const Module& module, Method& method, InstructionWalker it, const Configuration& config);
 
+        /*
+         * Combines the memory accesses of adjacent critical sections (e.g. as generated for atomic operations), which
+         * access the same memory location.
+         *
+         * Critical sections in the same basic block which are only separated by a few calculations are merged. Since no
+         * other QPU accesses the memory guarded by the hardware mutex while it is locked, reads of a memory location
+         * already read or written inside of the same critical section are replaced with the known value, and writes
+         * overwritten by a later write to the same location (without a memory read in between) are removed.
+         *
+         * Example:
+         *   mutex_acq
+         *   %a = load memory at %counter
+         *   %a.inc = add %a, 1
+         *   store memory at %counter = %a.inc
+         *   mutex_rel
+         *   mutex_acq
+         *   %b = load memory at %counter
+         *   %b.inc = add %b, 1
+         *   store memory at %counter = %b.inc
+         *   mutex_rel
+         *
+         * is converted to:
+         *   mutex_acq
+         *   %a = load memory at %counter
+         *   %a.inc = add %a, 1
+         *   %b = %a.inc
+         *   %b.inc = add %b, 1
+         *   store memory at %counter = %b.inc
+         *   mutex_rel
+         *
+         * NOTE: This needs to run before the memory access is lowered.
+         */
+        void combineCriticalSections(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Splits stack allocations (e.g. private arrays and structs) which are only accessed at constant offsets into
+         * separate locals per accessed element (scalar replacement of aggregates), so the accesses no longer require
+         * any memory access.
+         *
+         * A stack allocation is only split, if all its addresses are calculated by adding constant offsets, all
+         * accesses are reads or writes of single elements and the accessed elements do not overlap. Small stack
+         * allocations which are accessed with dynamic offsets are still lowered into a single register when the memory
+         * access is mapped (see #mapMemoryAccess).
+         *
+         * Example:
+         *   %addr = add %struct, 4
+         *   store memory at %addr = %a
+         *   [...]
+         *   %b = load memory at %addr
+         *
+         * is converted to:
+         *   %struct.element.4 = %a
+         *   [...]
+         *   %b = %struct.element.4
+         *
+         * NOTE: This needs to run before the memory access is lowered.
+         */
+        void splitStackAllocations(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Maps the memory-instructions to instructions actually performing the memory-access (e.g. TMU, VPM access).
          *
          * This optimization-step also contains most of the optimizations for accessing VPM/RAM.
+         *
+         * The prefetch() hints are lowered to preload the TMU cache for memory read via the TMU and dropped for all
+         * other memory.
          */
         void mapMemoryAccess(const Module& module, Method& method, const Configuration& config);
     } // namespace normalization
@@ -7,14 +7,19 @@
 #include "MemoryMappings.h"
 
 #include "../GlobalValues.h"
+#include "../Module.h"
 #include "../Profiler.h"
 #include "../SIMDVector.h"
+#include "../analysis/ControlFlowGraph.h"
 #include "../intermediate/Helper.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "../intermediate/operators.h"
 #include "../periphery/VPM.h"
 #include "log.h"
 
+#include <algorithm>
+#include <limits>
+
 using namespace vc4c;
 using namespace vc4c::normalization;
 using namespace vc4c::intermediate;
@@ -685,7 +690,15 @@ MemoryAccessInfo normalization::determineMemoryAccess(Method& method)
                     if(isMemoryOnlyRead(local))
                     {
                         // global buffer
-                        if(getConstantElementValue(memInstr->getSource()))
+                        if(local->as<Global>()->isConstantPoolEntry)
+                        {
+                            CPPLOG_LAZY(logging::Level::DEBUG,
+                                log << "Constant pool entry '" << local->to_string() << "' is read from RAM via TMU"
+                                    << logging::endl);
+                            mapping[local].preferred = MemoryAccessType::RAM_LOAD_TMU;
+                            mapping[local].fallback = MemoryAccessType::RAM_READ_WRITE_VPM;
+                        }
+                        else if(getConstantElementValue(memInstr->getSource()))
                         {
                             CPPLOG_LAZY(logging::Level::DEBUG,
                                 log << "Constant element of constant buffer '" << local->to_string()
@@ -961,6 +974,147 @@ MemoryAccessInfo normalization::determineMemoryAccess(Method& method)
     return MemoryAccessInfo{std::move(mapping), std::move(allWalkers), std::move(conditionalLocalMappings)};
 }
 
+// The factor the estimated number of executions of a memory access is multiplied with per level of enclosing loops
+static constexpr uint64_t LOOP_ACCESS_FACTOR = 16;
+// The maximum loop depth considered for the estimated number of executions, to not overflow the weight
+static constexpr unsigned MAX_WEIGHTED_LOOP_DEPTH = 4;
+// The size of a single VPM row (16 words of 32-bit) in bytes
+static constexpr uint64_t VPM_ROW_SIZE = NATIVE_VECTOR_SIZE * sizeof(uint32_t);
+
+/*
+ * The estimated costs (in instructions, including stalls) of a single access to a memory area mapped with the given
+ * access type
+ */
+static uint64_t getAccessCosts(MemoryAccessType type)
+{
+    switch(type)
+    {
+    case MemoryAccessType::QPU_REGISTER_READONLY:
+    case MemoryAccessType::QPU_REGISTER_READWRITE:
+        return 1;
+    case MemoryAccessType::VPM_PER_QPU:
+    case MemoryAccessType::VPM_SHARED_ACCESS:
+        // locking the mutex, the setup, the actual access and releasing the mutex again
+        return 4;
+    case MemoryAccessType::RAM_LOAD_TMU:
+        // the TMU latency is partially hidden by the instruction scheduler
+        return 12;
+    case MemoryAccessType::RAM_READ_WRITE_VPM:
+        // the VPM access plus the DMA setup and the waiting for the DMA transfer
+        return 40;
+    }
+    throw CompilationError(CompilationStep::NORMALIZER, "Cannot determine costs for unknown memory access type",
+        std::to_string(static_cast<unsigned>(type)));
+}
+
+/*
+ * Returns the number of VPM rows the memory area would occupy when mapped to its preferred access type
+ */
+static uint64_t getRequiredVPMRows(const Method& method, const Local* local, const MemoryAccess& access)
+{
+    switch(access.preferred)
+    {
+    case MemoryAccessType::QPU_REGISTER_READONLY:
+    case MemoryAccessType::QPU_REGISTER_READWRITE:
+    case MemoryAccessType::RAM_LOAD_TMU:
+        return 0;
+    case MemoryAccessType::VPM_PER_QPU:
+    case MemoryAccessType::VPM_SHARED_ACCESS:
+    {
+        auto width = periphery::VPM::getVPMStorageType(local->type.getElementType()).getLogicalWidth();
+        // data private to the work-items needs to be stored once per QPU, data shared by them only once
+        if(access.preferred == MemoryAccessType::VPM_PER_QPU)
+            width *= NUM_QPUS;
+        return std::max((uint64_t{width} + VPM_ROW_SIZE - 1) / VPM_ROW_SIZE, uint64_t{1});
+    }
+    case MemoryAccessType::RAM_READ_WRITE_VPM:
+        // The memory might be cached in VPM, but the accessed range is not yet known, so assume the biggest cacheable
+        // range
+        return method.vpm->getMaxCacheVectors(TYPE_INT32, true);
+    }
+    return 0;
+}
+
+/*
+ * Estimates the number of executions of the memory access instructions accessing the memory area, either from the
+ * execution profile (if any) or statically from the depth of the loops containing the accesses.
+ */
+static uint64_t estimateAccessCount(const Method& method, const MemoryAccess& access,
+    const FastMap<const BasicBlock*, unsigned>& loopDepths)
+{
+    uint64_t count = 0;
+    for(const auto& entry : access.accessInstructions)
+    {
+        auto block = entry.first.getBasicBlock();
+        if(auto frequency = method.module.executionProfile.getBlockFrequency(method, *block))
+        {
+            count += *frequency;
+            continue;
+        }
+        auto depthIt = loopDepths.find(block);
+        uint64_t weight = 1;
+        for(unsigned i = 0; i < std::min(depthIt != loopDepths.end() ? depthIt->second : 0u, MAX_WEIGHTED_LOOP_DEPTH);
+            ++i)
+            weight *= LOOP_ACCESS_FACTOR;
+        count += weight;
+    }
+    return count;
+}
+
+FastAccessList<const Local*> normalization::determineMappingOrder(Method& method, const MemoryAccessMap& accesses)
+{
+    FastMap<const BasicBlock*, unsigned> loopDepths;
+    for(const auto& loop : method.getCFG().findLoops(true))
+    {
+        for(auto node : loop)
+            ++loopDepths[node->key];
+    }
+
+    struct MappingCosts
+    {
+        const Local* local;
+        // the estimated costs saved by mapping the memory area to its preferred instead of its fall-back access type
+        uint64_t savedCosts;
+        // the number of VPM rows reserved by the preferred access type
+        uint64_t requiredRows;
+    };
+    FastAccessList<MappingCosts> costs;
+    costs.reserve(accesses.size());
+    for(const auto& entry : accesses)
+    {
+        const auto& access = entry.second;
+        auto accessCosts = getAccessCosts(access.preferred);
+        auto fallbackCosts = getAccessCosts(access.fallback);
+        // a RAM area preferred to be accessed via DMA is cached in VPM instead, if possible
+        if(access.preferred == MemoryAccessType::RAM_READ_WRITE_VPM)
+            accessCosts = getAccessCosts(MemoryAccessType::VPM_SHARED_ACCESS);
+        auto savedCosts = estimateAccessCount(method, access, loopDepths) *
+            (fallbackCosts > accessCosts ? fallbackCosts - accessCosts : 0);
+        costs.emplace_back(MappingCosts{entry.first, savedCosts, getRequiredVPMRows(method, entry.first, access)});
+    }
+
+    // Mapping the memory areas is a knapsack problem with the VPM size as capacity, which is solved greedily: the areas
+    // not occupying any VPM space are mapped first, then the areas saving the most costs per reserved VPM row. Areas
+    // which then no longer fit into the VPM are mapped to their fall-back access types.
+    std::stable_sort(costs.begin(), costs.end(), [](const MappingCosts& first, const MappingCosts& second) -> bool {
+        if(first.requiredRows == 0 || second.requiredRows == 0)
+            return first.requiredRows == 0 && second.requiredRows != 0;
+        // compares first.savedCosts / first.requiredRows > second.savedCosts / second.requiredRows
+        return first.savedCosts * second.requiredRows > second.savedCosts * first.requiredRows;
+    });
+
+    FastAccessList<const Local*> order;
+    order.reserve(costs.size());
+    for(const auto& entry : costs)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Mapping memory area '" << entry.local->to_string() << "' saves estimated " << entry.savedCosts
+                << " instructions for " << entry.requiredRows << " VPM rows" << logging::endl);
+        order.emplace_back(entry.local);
+    }
+    return order;
+}
+
 static MemoryInfo canLowerToRegisterReadOnly(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
     // a) the global is a constant scalar/vector which fits into a single register
@@ -1038,6 +1192,60 @@ static MemoryInfo canLowerToPrivateVPMArea(Method& method, const Local* baseAddr
     return checkMemoryMapping(method, baseAddr, access);
 }
 
+/*
+ * Determines the synchronization phases (see periphery::VPMAreaLifetime) the memory area is accessed in.
+ *
+ * The phases are separated by the semaphore decrements of the work-group barriers, since these are the only positions
+ * where a QPU waits for all other QPUs of the work-group. If the memory area is accessed inside a loop, the life-time
+ * is extended over all phases of the loop, since the area is accessed again in the next iteration.
+ */
+static Optional<periphery::VPMAreaLifetime> determineLifetime(Method& method, const MemoryAccess& access)
+{
+    if(access.accessInstructions.empty())
+        return {};
+
+    // the phases at the beginning and the end of every block
+    FastMap<const BasicBlock*, std::pair<unsigned, unsigned>> blockPhases;
+    unsigned currentPhase = 0;
+    for(const auto& block : method)
+    {
+        auto startPhase = currentPhase;
+        auto hasBarrier =
+            std::any_of(block.begin(), block.end(), [](const std::unique_ptr<IntermediateInstruction>& inst) -> bool {
+                auto semaphore = dynamic_cast<const SemaphoreAdjustment*>(inst.get());
+                return semaphore && !semaphore->increase;
+            });
+        if(hasBarrier)
+            ++currentPhase;
+        blockPhases.emplace(&block, std::make_pair(startPhase, currentPhase));
+    }
+
+    periphery::VPMAreaLifetime lifetime{std::numeric_limits<unsigned>::max(), 0, currentPhase + 1};
+    auto extendLifetime = [&](const BasicBlock* block) {
+        const auto& phases = blockPhases.at(block);
+        lifetime.firstPhase = std::min(lifetime.firstPhase, phases.first);
+        lifetime.lastPhase = std::max(lifetime.lastPhase, phases.second);
+    };
+
+    FastSet<const BasicBlock*> accessBlocks;
+    for(const auto& entry : access.accessInstructions)
+    {
+        accessBlocks.emplace(entry.first.getBasicBlock());
+        extendLifetime(entry.first.getBasicBlock());
+    }
+    for(const auto& loop : method.getCFG().findLoops(true))
+    {
+        auto isAccessedInLoop = std::any_of(loop.begin(), loop.end(), [&](const analysis::CFGNode* node) -> bool {
+            return accessBlocks.find(node->key) != accessBlocks.end();
+        });
+        if(!isAccessedInLoop)
+            continue;
+        for(const auto& node : loop)
+            extendLifetime(node->key);
+    }
+    return lifetime;
+}
+
 static MemoryInfo toSharedVPMArea(const Local* baseAddr, const periphery::VPMArea* area,
     Optional<std::vector<MemoryAccessRange>>&& ranges, Optional<DataType>&& areaType)
 {
@@ -1050,7 +1258,8 @@ static MemoryInfo toSharedVPMArea(const Local* baseAddr, const periphery::VPMAre
 
 static MemoryInfo canLowerToSharedVPMArea(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
-    auto area = method.vpm->addArea(baseAddr, baseAddr->type.getElementType(), false);
+    auto area = method.vpm->addArea(
+        baseAddr, baseAddr->type.getElementType(), false, NUM_QPUS, determineLifetime(method, access));
     if(area)
         return toSharedVPMArea(baseAddr, area, {}, convertSmallArrayToRegister(baseAddr));
 
@@ -1061,15 +1270,15 @@ static MemoryInfo canLowerToSharedVPMArea(Method& method, const Local* baseAddr,
 
 static MemoryInfo canMapToTMUReadOnly(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
-    // TODO for better performance, the TMU flag should alternate in according to the order of usage (first read use
-    // TMU0, second read use TMU1, ...)
-    static thread_local bool tmuFlag = true;
-    tmuFlag = !tmuFlag;
-    return MemoryInfo{baseAddr, MemoryAccessType::RAM_LOAD_TMU, nullptr, {}, {}, {}, tmuFlag};
+    // the TMU to use is selected per load instruction, see periphery::selectTMU
+    return MemoryInfo{baseAddr, MemoryAccessType::RAM_LOAD_TMU};
 }
 
-static const periphery::VPMArea* checkCacheMemoryAccessRanges(
-    Method& method, const Local* baseAddr, FastAccessList<MemoryAccessRange>& accesRanges);
+static const periphery::VPMArea* checkCacheMemoryAccessRanges(Method& method, const Local* baseAddr,
+    FastAccessList<MemoryAccessRange>& accesRanges, const Optional<periphery::VPMAreaLifetime>& lifetime);
+
+static const periphery::VPMArea* checkCacheGlobalMemory(
+    Method& method, const Local* baseAddr, MemoryAccess& access, FastAccessList<MemoryAccessRange>& accessRanges);
 
 static MemoryInfo canMapToDMAReadWrite(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
@@ -1080,18 +1289,124 @@ static MemoryInfo canMapToDMAReadWrite(Method& method, const Local* baseAddr, Me
     if(!ranges.empty() && baseAddr->type.getPointerType() &&
         baseAddr->type.getPointerType()->addressSpace == AddressSpace::LOCAL)
     {
-        auto area = checkCacheMemoryAccessRanges(method, baseAddr, ranges);
+        auto area = checkCacheMemoryAccessRanges(method, baseAddr, ranges, determineLifetime(method, access));
         if(area)
         {
             // for local/private memory, there is no need for initial load/write-back
             return toSharedVPMArea(baseAddr, area, std::move(ranges), {});
         }
     }
+    if(!ranges.empty() && baseAddr->type.getPointerType() &&
+        baseAddr->type.getPointerType()->addressSpace == AddressSpace::GLOBAL)
+    {
+        if(auto area = checkCacheGlobalMemory(method, baseAddr, access, ranges))
+            // the memory stays in RAM, but is loaded into VPM at the start and written back at the end of the kernel
+            return MemoryInfo{baseAddr, MemoryAccessType::RAM_READ_WRITE_VPM, area, std::move(ranges)};
+    }
     return MemoryInfo{baseAddr, MemoryAccessType::RAM_READ_WRITE_VPM};
 }
 
-static const periphery::VPMArea* checkCacheMemoryAccessRanges(
-    Method& method, const Local* baseAddr, FastAccessList<MemoryAccessRange>& memoryAccessRanges)
+static bool isAccessedInLoop(Method& method, const MemoryAccess& access)
+{
+    FastSet<const BasicBlock*> accessBlocks;
+    for(const auto& entry : access.accessInstructions)
+        accessBlocks.emplace(entry.first.getBasicBlock());
+    for(const auto& loop : method.getCFG().findLoops(true))
+    {
+        if(std::any_of(loop.begin(), loop.end(), [&](const analysis::CFGNode* node) -> bool {
+               return accessBlocks.find(node->key) != accessBlocks.end();
+           }))
+            return true;
+    }
+    return false;
+}
+
+static bool mayBeAliased(const Method& method, const Parameter& param)
+{
+    if(has_flag(param.decorations, ParameterDecorations::RESTRICT))
+        return false;
+    return std::any_of(method.parameters.begin(), method.parameters.end(), [&](const Parameter& other) -> bool {
+        auto pointerType = other.type.getPointerType();
+        return &other != &param && pointerType &&
+            (pointerType->addressSpace == AddressSpace::GLOBAL || pointerType->addressSpace == AddressSpace::GENERIC);
+    });
+}
+
+/*
+ * Checks whether the global memory accessed via the given parameter can be cached in VPM for the whole execution of
+ * the kernel, i.e. loaded into VPM once at the start of the kernel and written back once at its end, and reserves
+ * the VPM area if so.
+ *
+ * Since the VPM is shared between all QPUs and there is no synchronization between the QPUs at the start and the end
+ * of the kernel, this is only done for kernels with a fixed work-group size of 1, where only a single QPU runs at any
+ * time. Additionally, the memory area needs to be:
+ * - accessed only via this parameter, which is not aliased by any other parameter
+ * - accessed repeatedly (inside of a loop), otherwise the caching would only add DMA transfers
+ * - accessed only in reads and writes of 32-bit scalar elements, which are stored one element per VPM row, just like
+ *   the DMA transfers copy them
+ * - accessed in a range of element offsets with known (small enough) bounds, independent of the work-group
+ */
+static const periphery::VPMArea* checkCacheGlobalMemory(
+    Method& method, const Local* baseAddr, MemoryAccess& access, FastAccessList<MemoryAccessRange>& accessRanges)
+{
+    auto param = baseAddr->as<Parameter>();
+    if(!param || method.metaData.getWorkGroupSize() != 1 ||
+        has_flag(param->decorations, ParameterDecorations::VOLATILE))
+        return nullptr;
+    if(mayBeAliased(method, *param) || !method.findBasicBlock(BasicBlock::LAST_BLOCK) ||
+        accessRanges.size() != access.accessInstructions.size() || !isAccessedInLoop(method, access))
+        return nullptr;
+
+    auto elementType = baseAddr->type.getElementType();
+    if(!elementType.isScalarType() || elementType.getScalarBitCount() != 32)
+        return nullptr;
+    for(const auto& entry : access.accessInstructions)
+    {
+        auto mem = entry.first.get<const MemoryInstruction>();
+        if(entry.second != baseAddr || !mem)
+            return nullptr;
+        if(mem->op == MemoryOperation::READ && mem->getSourceElementType() == elementType)
+            continue;
+        if(mem->op == MemoryOperation::WRITE && mem->getDestinationElementType() == elementType)
+            continue;
+        // copies and fills are mapped directly to RAM, not to the cached area
+        return nullptr;
+    }
+    for(const auto& range : accessRanges)
+    {
+        // the in-VPM offset is calculated from the element offset, see insertAddressToWorkItemSpecificOffset
+        auto shift =
+            range.typeSizeShift ? range.typeSizeShift->assertArgument(1).getLiteralValue() : Optional<Literal>{};
+        if(!shift || shift->unsignedInt() != 2)
+            return nullptr;
+    }
+
+    bool allUniformPartsEqual;
+    analysis::ValueRange offsetRange;
+    std::tie(allUniformPartsEqual, offsetRange) = analysis::checkWorkGroupUniformParts(accessRanges, false);
+    // the cached area starts at the base address, so there can be no additional (work-group uniform) offset
+    if(!allUniformPartsEqual || !accessRanges.front().groupUniformAddressParts.empty() || offsetRange.minValue < 0 ||
+        offsetRange.maxValue < offsetRange.minValue ||
+        offsetRange.maxValue >= method.vpm->getMaxCacheVectors(elementType, true))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Cannot cache global memory " << baseAddr->to_string()
+                << " in VPM, since the accessed range is unknown, too big or differs between work-groups"
+                << logging::endl);
+        return nullptr;
+    }
+
+    auto cachedType = method.createArrayType(elementType, static_cast<unsigned>(offsetRange.maxValue + 1));
+    auto area = method.vpm->addArea(baseAddr, cachedType, false);
+    if(area)
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Caching global memory " << baseAddr->to_string() << " in the range [0, " << offsetRange.maxValue
+                << "] in VPM: " << area->to_string() << logging::endl);
+    return area;
+}
+
+static const periphery::VPMArea* checkCacheMemoryAccessRanges(Method& method, const Local* baseAddr,
+    FastAccessList<MemoryAccessRange>& memoryAccessRanges, const Optional<periphery::VPMAreaLifetime>& lifetime)
 {
     auto maxNumVectors = method.vpm->getMaxCacheVectors(TYPE_INT32, true);
     GroupedAccessRanges result;
@@ -1131,7 +1446,7 @@ static const periphery::VPMArea* checkCacheMemoryAccessRanges(
 
     // XXX the local is not correct, at least not if there is a work-group uniform offset, but since all work-items
     // use the same work-group offset, it doesn't matter
-    auto vpmArea = method.vpm->addArea(baseAddr, accessedType, false);
+    auto vpmArea = method.vpm->addArea(baseAddr, accessedType, false, NUM_QPUS, lifetime);
     if(vpmArea == nullptr)
     {
         CPPLOG_LAZY(logging::Level::DEBUG,
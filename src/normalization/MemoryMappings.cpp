@@ -80,7 +80,7 @@ std::string MemoryInfo::to_string() const
     case MemoryAccessType::VPM_SHARED_ACCESS:
         return "shared VPM area " + (area ? area->to_string() : "(null)");
     case MemoryAccessType::RAM_LOAD_TMU:
-        return "read-only memory access via TMU" + std::string(tmuFlag ? "1" : "0");
+        return "read-only memory access via TMU";
     case MemoryAccessType::RAM_READ_WRITE_VPM:
         return "read-write memory access via VPM" + (area ? " (cached in" + area->to_string() + ")" : "");
     }
@@ -498,7 +498,9 @@ static InstructionWalker lowerMemoryWriteToVPM(Method& method, InstructionWalker
                 CompilationStep::NORMALIZER, "Cannot lower into VPM without VPM area", mem->to_string());
         if(destInfo->type != MemoryAccessType::VPM_PER_QPU)
             allAreasArePerQPU = false;
-        if(destInfo->type != MemoryAccessType::VPM_SHARED_ACCESS)
+        // memory located in RAM, but cached in VPM is accessed like shared VPM areas
+        if(destInfo->type != MemoryAccessType::VPM_SHARED_ACCESS &&
+            destInfo->type != MemoryAccessType::RAM_READ_WRITE_VPM)
             allAreasAreShared = false;
     }
 
@@ -581,18 +583,13 @@ static InstructionWalker loadMemoryViaTMU(Method& method, InstructionWalker it,
         logging::Level::DEBUG, log << "Loading from read-only memory via TMU: " << mem->to_string() << logging::endl);
     if(mem->op == MemoryOperation::READ)
     {
-        // we have to use the same TMU for all loads. To minimize cache misses, select the TMU which is used by the most
-        // sources selected
-        uint32_t numTMU0 = 0;
-        uint32_t numTMU1 = 0;
         for(auto srcInfo : srcInfos)
         {
             if(auto param = srcInfo->local->as<Parameter>())
                 const_cast<Parameter*>(param)->decorations = add_flag(param->decorations, ParameterDecorations::INPUT);
-            ++(srcInfo->tmuFlag ? numTMU0 : numTMU1);
         }
-        // prefer TMU1 here, since statistically TMU0 will be used more often
-        auto tmu = numTMU0 > numTMU1 ? periphery::TMU0 : periphery::TMU1;
+        // spread independent loads across both TMUs to be able to queue more requests
+        const auto& tmu = periphery::selectTMU(it);
         it = periphery::insertReadVectorFromTMU(method, it, mem->getDestination(), mem->getSource(), tmu);
         return it.erase();
     }
@@ -609,6 +606,20 @@ static InstructionWalker accessMemoryInRAMViaVPM(Method& method, InstructionWalk
     const tools::SmallSortedPointerSet<const MemoryInfo*>& srcInfos,
     const tools::SmallSortedPointerSet<const MemoryInfo*>& destInfos)
 {
+    auto isCachedInVPM = [](const MemoryInfo* info) -> bool { return info->area && info->ranges; };
+    if(mem->op == MemoryOperation::READ && std::all_of(srcInfos.begin(), srcInfos.end(), isCachedInVPM))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Mapping read of memory located in RAM to VPM cache: " << mem->to_string() << logging::endl);
+        return lowerMemoryReadToVPM(method, it, mem, srcInfos, destInfos);
+    }
+    if(mem->op == MemoryOperation::WRITE && std::all_of(destInfos.begin(), destInfos.end(), isCachedInVPM))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Mapping write of memory located in RAM to VPM cache: " << mem->to_string() << logging::endl);
+        return lowerMemoryWriteToVPM(method, it, mem, srcInfos, destInfos);
+    }
+
     CPPLOG_LAZY(
         logging::Level::DEBUG, log << "Mapping access to memory located in RAM: " << mem->to_string() << logging::endl);
     switch(mem->op)
@@ -625,17 +636,14 @@ static InstructionWalker accessMemoryInRAMViaVPM(Method& method, InstructionWalk
             if(mem->getSource().type == TYPE_INT8)
             {
                 // if we fill single bytes, combine them to some vector type to not have to write so many single bytes
-                auto vpmType = periphery::getBestVectorSize(numCopies->unsignedInt());
                 // 1. replicate byte across word
                 auto fillWord = assign(it, TYPE_INT32) = (mem->getSource(), UNPACK_8A_32);
                 // 2. replicate word across all vector elements
                 auto fillVector = method.addNewLocal(TYPE_INT32.toVectorType(16), "%memory_fill");
                 it = insertReplication(it, fillWord, fillVector);
-                // 3. write vector to VPM
-                it = method.vpm->insertWriteVPM(method, it, fillVector, nullptr, false);
-                // 4. fill memory with vector
+                // 3. write vector to VPM and fill memory with it
                 it = method.vpm->insertFillRAM(
-                    method, it, mem->getDestination(), vpmType.first, vpmType.second, nullptr, false);
+                    method, it, mem->getDestination(), fillVector, numCopies->unsignedInt(), false);
             }
             else
             {
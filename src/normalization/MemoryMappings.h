@@ -36,8 +36,6 @@ namespace vc4c
             Optional<Value> mappedRegisterOrConstant = NO_VALUE;
             // e.g. for arrays converted to vectors, this is the resulting vector type
             Optional<DataType> convertedRegisterType = {};
-            // flags which TMU to be used for reading
-            bool tmuFlag = false;
 
             std::string to_string() const;
         };
@@ -69,6 +67,17 @@ namespace vc4c
          */
         MemoryAccessInfo determineMemoryAccess(Method& method);
 
+        /*
+         * Determines the order in which the memory areas are mapped (see #checkMemoryMapping) and therefore in which
+         * order the limited VPM space is reserved for them.
+         *
+         * For every memory area, the costs saved by its preferred access type are estimated from the number of accesses
+         * (weighted by the execution profile or the loop depth), the VPM rows occupied (private data once per QPU,
+         * shared data only once) and the costs per access of the preferred and fall-back access types. Memory areas
+         * not requiring any VPM space are mapped first, followed by the areas saving the most costs per VPM row.
+         */
+        FastAccessList<const Local*> determineMappingOrder(Method& method, const MemoryAccessMap& accesses);
+
         /*
          * Returns the constant value which will be read from the given memory access instruction.
          *
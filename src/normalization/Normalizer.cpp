@@ -10,17 +10,22 @@
 #include "../Method.h"
 #include "../Module.h"
 #include "../Profiler.h"
+#include "../analysis/AnalysisManager.h"
+#include "../analysis/DivergenceAnalysis.h"
 #include "../ThreadPool.h"
 #include "../intrinsics/Intrinsics.h"
 #include "../optimization/ControlFlow.h"
 #include "../optimization/Eliminator.h"
 #include "../optimization/Reordering.h"
 #include "../spirv/SPIRVBuiltins.h"
+#include "AddressCalculation.h"
+#include "ConstantPool.h"
 #include "Inliner.h"
 #include "LiteralValues.h"
 #include "LongOperations.h"
 #include "MemoryAccess.h"
 #include "Rewrite.h"
+#include "WorkItemCoarsening.h"
 
 #include "log.h"
 
@@ -31,45 +36,20 @@ using namespace vc4c;
 using namespace vc4c::normalization;
 
 /*
- * Propagate WORK_GROUP_UNIFORM_VALUE decoration through the kernel code
+ * Propagate WORK_GROUP_UNIFORM_VALUE decoration through the kernel code, as determined by the divergence analysis
  */
-static void propagateGroupUniforms(Module& module, Method& method, InstructionWalker it, const Configuration& config)
+static void propagateGroupUniforms(Module& module, Method& method, const Configuration& config)
 {
-    // XXX does not propagate decoration via phi-nodes of back jumps
-    static const auto check = [](const Value& arg) -> bool {
-        if(arg.checkRegister())
-            return arg.hasRegister(REG_UNIFORM) || arg.hasRegister(REG_ELEMENT_NUMBER);
-        if(arg.checkImmediate() || arg.checkLiteral() || arg.checkVector())
-            return true;
-        if(auto local = arg.checkLocal())
-        {
-            auto writes = local->getUsers(LocalUse::Type::WRITER);
-            return local->is<Parameter>() || local->is<Global>() ||
-                std::all_of(
-                    writes.begin(), writes.end(), [](const intermediate::IntermediateInstruction* instr) -> bool {
-                        return instr->hasDecoration(
-                            vc4c::intermediate::InstructionDecorations::WORK_GROUP_UNIFORM_VALUE);
-                    });
-        }
-        return false;
-    };
-    if(it.get<intermediate::Nop>() || it.get<intermediate::BranchLabel>() || it.get<intermediate::MutexLock>() ||
-        it.get<intermediate::SemaphoreAdjustment>() || it.get<intermediate::MemoryBarrier>())
-        return;
-    if(it->hasDecoration(intermediate::InstructionDecorations::BUILTIN_GLOBAL_ID) ||
-        it->hasDecoration(intermediate::InstructionDecorations::BUILTIN_LOCAL_ID))
-        return;
-    if(it->hasConditionalExecution())
+    // the previous normalization steps modified the instructions
+    method.getAnalyses().invalidate();
+    const auto& divergence = method.getAnalyses().getDivergence();
+    auto it = method.walkAllInstructions();
+    while(!it.isEndOfMethod())
     {
-        auto flagsIt = it.getBasicBlock()->findLastSettingOfFlags(it);
-        if(!(flagsIt && (*flagsIt)->hasDecoration(intermediate::InstructionDecorations::WORK_GROUP_UNIFORM_VALUE)))
-        {
-            // for conditional writes need to check whether condition is met by all work-items (e.g. element insertion)
-            return;
-        }
+        if(it.has() && it->checkOutputLocal() && divergence.isGroupUniform(it->getOutput().value()))
+            it->addDecorations(intermediate::InstructionDecorations::WORK_GROUP_UNIFORM_VALUE);
+        it.nextInMethod();
     }
-    if(std::all_of(it->getArguments().begin(), it->getArguments().end(), check))
-        it->addDecorations(intermediate::InstructionDecorations::WORK_GROUP_UNIFORM_VALUE);
 }
 
 /*
@@ -153,8 +133,6 @@ const static std::vector<std::pair<std::string, NormalizationStep>> initialNorma
     // this first run here is only required, so some loading of literals can be optimized, which is no longer possible
     // after the second run
     {"HandleImmediates", handleImmediate},
-    // propagates the instruction decoration whether values are work-group uniform
-    {"PropagateGroupUniformValues", propagateGroupUniforms},
     // propagates the unsigned result instruction decoration
     {"PropagateUnsigned", propagateUnsignedValues}};
 
@@ -205,6 +183,16 @@ static void runNormalizationStep(
 }
 
 void Normalizer::normalize(Module& module) const
+{
+    prepareModule(module);
+    createConstantPool(module, config);
+    // 3. run other normalization steps on kernel functions
+    auto kernels = module.getKernels();
+    const auto f = [&module, this](Method* kernelFunc) -> void { normalizeMethod(module, *kernelFunc); };
+    ThreadPool::getDefaultPool().scheduleAll<Method*>(kernels, f);
+}
+
+void Normalizer::prepareModule(Module& module) const
 {
     // 1. eliminate phi on all methods
     for(auto& method : module)
@@ -224,20 +212,20 @@ void Normalizer::normalize(Module& module) const
     }
     auto kernels = module.getKernels();
     // 2. inline kernel-functions
-    for(Method* kernelFunc : kernels)
-    {
-        Method& kernel = *kernelFunc;
-
-        PROFILE_COUNTER(vc4c::profiler::COUNTER_NORMALIZATION + 4, "Inline (before)", kernel.countInstructions());
-        PROFILE_START(Inline);
-        inlineMethods(module, kernel, config);
-        PROFILE_END(Inline);
-        PROFILE_COUNTER_WITH_PREV(vc4c::profiler::COUNTER_NORMALIZATION + 5, "Inline (after)",
-            kernel.countInstructions(), vc4c::profiler::COUNTER_NORMALIZATION + 4);
-    }
-    // 3. run other normalization steps on kernel functions
-    const auto f = [&module, this](Method* kernelFunc) -> void { normalizeMethod(module, *kernelFunc); };
-    ThreadPool{"Normalization"}.scheduleAll<Method*>(kernels, f);
+    auto countKernelInstructions = [&]() -> std::size_t {
+        std::size_t numInstructions = 0;
+        for(Method* kernelFunc : kernels)
+            numInstructions += kernelFunc->countInstructions();
+        return numInstructions;
+    };
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_NORMALIZATION + 4, "Inline (before)", countKernelInstructions());
+    PROFILE_START(Inline);
+    PROFILE_TRACE_START(Inline);
+    inlineMethods(module, config);
+    PROFILE_END(Inline);
+    PROFILE_TRACE_END("normalization", Inline);
+    PROFILE_COUNTER_WITH_PREV(vc4c::profiler::COUNTER_NORMALIZATION + 5, "Inline (after)", countKernelInstructions(),
+        vc4c::profiler::COUNTER_NORMALIZATION + 4);
 }
 
 void Normalizer::adjust(Module& module) const
@@ -245,7 +233,7 @@ void Normalizer::adjust(Module& module) const
     // run adjustment steps on kernel functions
     auto kernels = module.getKernels();
     const auto f = [&module, this](Method* kernelFunc) -> void { adjustMethod(module, *kernelFunc); };
-    ThreadPool{"Adjustment"}.scheduleAll<Method*>(kernels, f);
+    ThreadPool::getDefaultPool().scheduleAll<Method*>(kernels, f);
 }
 
 void Normalizer::normalizeMethod(Module& module, Method& method) const
@@ -260,11 +248,83 @@ void Normalizer::normalizeMethod(Module& module, Method& method) const
     {
         logging::debug() << logging::endl;
         logging::debug() << "Running pass: " << step.first << logging::endl;
+        profiler::TraceScope trace("normalization", step.first.c_str());
         PROFILE_START_DYNAMIC(step.first);
         runNormalizationStep(step.second, module, method, config);
         PROFILE_END_DYNAMIC(step.first);
     }
 
+    // propagates the instruction decoration whether values are work-group uniform, needs to run before the memory
+    // access is lowered, which uses this decoration
+    logging::logLazy(logging::Level::DEBUG, []() {
+        logging::debug() << logging::endl;
+        logging::debug() << "Running pass: PropagateGroupUniformValues" << logging::endl;
+    });
+    PROFILE_START(PropagateGroupUniformValues);
+    PROFILE_TRACE_START(PropagateGroupUniformValues);
+    propagateGroupUniforms(module, method, config);
+    PROFILE_END(PropagateGroupUniformValues);
+    PROFILE_TRACE_END("normalization", PropagateGroupUniformValues);
+
+    if(config.coarsenWorkItems)
+    {
+        // needs to run before the memory access is lowered, since it converts the accessed types
+        logging::logLazy(logging::Level::DEBUG, []() {
+            logging::debug() << logging::endl;
+            logging::debug() << "Running pass: CoarsenWorkItems" << logging::endl;
+        });
+        PROFILE_START(CoarsenWorkItems);
+        PROFILE_TRACE_START(CoarsenWorkItems);
+        coarsenWorkItems(module, method, config);
+        PROFILE_END(CoarsenWorkItems);
+        PROFILE_TRACE_END("normalization", CoarsenWorkItems);
+    }
+
+    // needs to run after the work-items are coarsened, since this changes the number of QPUs executing a work-group
+    logging::logLazy(logging::Level::DEBUG, []() {
+        logging::debug() << logging::endl;
+        logging::debug() << "Running pass: RemoveWorkGroupSynchronization" << logging::endl;
+    });
+    PROFILE_START(RemoveWorkGroupSynchronization);
+    PROFILE_TRACE_START(RemoveWorkGroupSynchronization);
+    removeWorkGroupSynchronization(module, method, config);
+    PROFILE_END(RemoveWorkGroupSynchronization);
+    PROFILE_TRACE_END("normalization", RemoveWorkGroupSynchronization);
+
+    // needs to run after the work-items are coarsened (which expects the original address calculations), but before
+    // the memory access is lowered
+    logging::logLazy(logging::Level::DEBUG, []() {
+        logging::debug() << logging::endl;
+        logging::debug() << "Running pass: CombineAddressCalculations" << logging::endl;
+    });
+    PROFILE_START(CombineAddressCalculations);
+    PROFILE_TRACE_START(CombineAddressCalculations);
+    combineAddressCalculations(module, method, config);
+    PROFILE_END(CombineAddressCalculations);
+    PROFILE_TRACE_END("normalization", CombineAddressCalculations);
+
+    // needs to run before the memory access is lowered, since it operates on the memory instructions
+    logging::logLazy(logging::Level::DEBUG, []() {
+        logging::debug() << logging::endl;
+        logging::debug() << "Running pass: CombineCriticalSections" << logging::endl;
+    });
+    PROFILE_START(CombineCriticalSections);
+    PROFILE_TRACE_START(CombineCriticalSections);
+    combineCriticalSections(module, method, config);
+    PROFILE_END(CombineCriticalSections);
+    PROFILE_TRACE_END("normalization", CombineCriticalSections);
+
+    // needs to run before the memory access is lowered, since it operates on the memory instructions
+    logging::logLazy(logging::Level::DEBUG, []() {
+        logging::debug() << logging::endl;
+        logging::debug() << "Running pass: SplitStackAllocations" << logging::endl;
+    });
+    PROFILE_START(SplitStackAllocations);
+    PROFILE_TRACE_START(SplitStackAllocations);
+    splitStackAllocations(module, method, config);
+    PROFILE_END(SplitStackAllocations);
+    PROFILE_TRACE_END("normalization", SplitStackAllocations);
+
     // maps all memory-accessing instructions to instructions actually performing the hardware memory-access
     // this step is called extra, because it needs to be run over all instructions
     logging::logLazy(logging::Level::DEBUG, []() {
@@ -272,8 +332,10 @@ void Normalizer::normalizeMethod(Module& module, Method& method) const
         logging::debug() << "Running pass: MapMemoryAccess" << logging::endl;
     });
     PROFILE_START(MapMemoryAccess);
+    PROFILE_TRACE_START(MapMemoryAccess);
     mapMemoryAccess(module, method, config);
     PROFILE_END(MapMemoryAccess);
+    PROFILE_TRACE_END("normalization", MapMemoryAccess);
 
     // calculate current/final stack offsets after lowering stack-accesses
     method.calculateStackOffsets();
@@ -284,6 +346,7 @@ void Normalizer::normalizeMethod(Module& module, Method& method) const
             logging::debug() << logging::endl;
             logging::debug() << "Running pass: " << step.first << logging::endl;
         });
+        profiler::TraceScope trace("normalization", step.first.c_str());
         PROFILE_START_DYNAMIC(step.first);
         runNormalizationStep(step.second, module, method, config);
         PROFILE_END_DYNAMIC(step.first);
@@ -295,8 +358,10 @@ void Normalizer::normalizeMethod(Module& module, Method& method) const
         logging::debug() << "Running pass: AddStartStopSegment" << logging::endl;
     });
     PROFILE_START(AddStartStopSegment);
+    PROFILE_TRACE_START(AddStartStopSegment);
     optimizations::addStartStopSegment(module, method, config);
     PROFILE_END(AddStartStopSegment);
+    PROFILE_TRACE_END("normalization", AddStartStopSegment);
 
     PROFILE_END(NormalizationPasses);
 
@@ -332,6 +397,7 @@ void Normalizer::adjustMethod(Module& module, Method& method) const
             logging::debug() << logging::endl;
             logging::debug() << "Running pass: " << step.first << logging::endl;
         });
+        profiler::TraceScope trace("normalization", step.first.c_str());
         PROFILE_START_DYNAMIC(step.first);
         runNormalizationStep(step.second, module, method, config);
         PROFILE_END_DYNAMIC(step.first);
@@ -344,8 +410,24 @@ void Normalizer::adjustMethod(Module& module, Method& method) const
         logging::debug() << "Running pass: ExtendBranches" << logging::endl;
     });
     PROFILE_START(ExtendBranches);
+    PROFILE_TRACE_START(ExtendBranches);
     extendBranches(module, method, config);
     PROFILE_END(ExtendBranches);
+    PROFILE_TRACE_END("normalization", ExtendBranches);
+
+    // inserts the thread switches after all other adjustments, since no instruction may be moved over them
+    if(config.generateThreadedCode)
+    {
+        logging::logLazy(logging::Level::DEBUG, []() {
+            logging::debug() << logging::endl;
+            logging::debug() << "Running pass: InsertThreadSwitches" << logging::endl;
+        });
+        PROFILE_START(InsertThreadSwitches);
+        PROFILE_TRACE_START(InsertThreadSwitches);
+        insertThreadSwitches(module, method, config);
+        PROFILE_END(InsertThreadSwitches);
+        PROFILE_TRACE_END("normalization", InsertThreadSwitches);
+    }
 
     PROFILE_END(AdjustmentPasses);
     LCOV_EXCL_START
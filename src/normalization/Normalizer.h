@@ -47,25 +47,44 @@ namespace vc4c
             void normalize(Module& module) const;
 
             /*
-             * Runs the second batch of normalization steps, trying to fix any possible issues with hardware limitations
+             * Runs the module-wide normalization steps (e.g. the elimination of phi-nodes and the inlining of all
+             * called functions into the kernels).
              *
-             * Depending on the build configuration, the normalization steps are run in parallel
+             * After this function returns, the kernels no longer depend on any other function in the module and the
+             * remaining normalization steps can be run independently for every kernel (see #normalizeMethod()).
              *
-             * NOTE: The fix-up needs to be run AFTER the optimizations
+             * NOTE: This needs to be run BEFORE any of the per-kernel normalization steps
              */
-            void adjust(Module& module) const;
-
-        private:
-            Configuration config;
+            void prepareModule(Module& module) const;
 
             /*
              * Runs all registered normalization steps on the given method.
              *
              * After this function has returned, it is guaranteed, that all remaining instructions within the method are
              * normalized (e.g. return true for #isNormalized()).
+             *
+             * NOTE: This can be run in parallel for different kernels of the same module
              */
             void normalizeMethod(Module& module, Method& method) const;
+
+            /*
+             * Runs the second batch of normalization steps, trying to fix any possible issues with hardware limitations
+             *
+             * Depending on the build configuration, the normalization steps are run in parallel
+             *
+             * NOTE: The fix-up needs to be run AFTER the optimizations
+             */
+            void adjust(Module& module) const;
+
+            /*
+             * Runs the second batch of normalization steps on the given method.
+             *
+             * NOTE: This can be run in parallel for different kernels of the same module
+             */
             void adjustMethod(Module& module, Method& method) const;
+
+        private:
+            Configuration config;
         };
     } /* namespace normalization */
 } /* namespace vc4c */
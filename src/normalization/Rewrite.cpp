@@ -7,6 +7,8 @@
 #include "Rewrite.h"
 
 #include "../InstructionWalker.h"
+#include "../Method.h"
+#include "../intermediate/IntermediateInstruction.h"
 #include "../intermediate/operators.h"
 #include "LiteralValues.h"
 #include "log.h"
@@ -105,3 +107,92 @@ void normalization::extendBranches(const Module& module, Method& method, const C
         it.nextInMethod();
     }
 }
+
+/*
+ * Checks whether the flags set before the given position might still be read afterwards, i.e. whether there is an
+ * instruction executed conditionally before the flags are set again
+ */
+static bool areFlagsLive(InstructionWalker it)
+{
+    for(; !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(it->hasConditionalExecution())
+            return true;
+        if(auto branch = it.get<const intermediate::Branch>())
+        {
+            if(!branch->isUnconditional())
+                return true;
+        }
+        if(it->doesSetFlag())
+            return false;
+    }
+    return false;
+}
+
+static bool canSwitchThreads(const Method& method)
+{
+    for(const auto& block : method)
+    {
+        for(const auto& inst : block)
+        {
+            // the other thread of the same QPU might wait on the semaphore this thread needs to increment or vice
+            // versa, which could dead-lock the QPU
+            if(dynamic_cast<const intermediate::SemaphoreAdjustment*>(inst.get()))
+                return false;
+        }
+    }
+    return true;
+}
+
+void normalization::insertThreadSwitches(const Module& module, Method& method, const Configuration& config)
+{
+    if(!config.generateThreadedCode)
+        return;
+    if(!canSwitchThreads(method))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Kernel '" << method.name << "' accesses semaphores and is not run in multiple threads"
+                << logging::endl);
+        return;
+    }
+    std::size_t numSwitches = 0;
+    // the mutex can be held across blocks (e.g. for loops copying memory), so track it in the order of the blocks
+    bool mutexLocked = false;
+    for(auto& block : method)
+    {
+        // whether a new TMU load was requested since the last thread switch. Since we do not know what happened in the
+        // previous blocks, we assume a load to be pending at the start of the block
+        bool newRequest = true;
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            if(auto mutex = it.get<const intermediate::MutexLock>())
+                // the other thread would dead-lock when trying to lock the mutex held by this thread
+                mutexLocked = mutex->locksMutex();
+            if(it->writesRegister(REG_TMU0_ADDRESS) || it->writesRegister(REG_TMU1_ADDRESS))
+                newRequest = true;
+            if(it->getSignal() != SIGNAL_LOAD_TMU0 && it->getSignal() != SIGNAL_LOAD_TMU1)
+                continue;
+            // the flags are not preserved across the thread switch
+            if(!newRequest || mutexLocked || areFlagsLive(it))
+                continue;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Inserting thread switch before waiting for TMU load: " << it->to_string() << logging::endl);
+            it.emplace(new intermediate::Nop(intermediate::DelayType::THREAD_SWITCH, SIGNAL_SWITCH_THREAD));
+            it.nextInBlock();
+            it.emplace(new intermediate::Nop(intermediate::DelayType::THREAD_SWITCH));
+            it.nextInBlock();
+            it.emplace(new intermediate::Nop(intermediate::DelayType::THREAD_SWITCH));
+            it.nextInBlock();
+            newRequest = false;
+            ++numSwitches;
+        }
+    }
+    if(numSwitches > 0)
+        method.metaData.isThreadable = true;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Inserted " << numSwitches << " thread switches into kernel: " << method.name << logging::endl);
+}
@@ -49,6 +49,33 @@ namespace vc4c
          *   nop
          */
         void extendBranches(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Inserts thread switches before waiting for the result of a TMU load, to run the other hardware thread of the
+         * QPU while this thread is waiting (see Configuration#generateThreadedCode). The thread switch signal is
+         * followed by 2 delay slots, after which the accumulators of the other thread are active.
+         *
+         * No thread switch is inserted while the hardware mutex is locked or the flags are still used afterwards.
+         * Kernels accessing semaphores are not run in multiple threads.
+         *
+         * If any thread switch is inserted, the kernel is marked as threadable, see KernelMetaData#isThreadable.
+         *
+         * Example:
+         *   tmu0s = %addr
+         *   nop (tmu) (ldtmu0)
+         *   %val = r4
+         *
+         * is converted to:
+         *   tmu0s = %addr
+         *   nop (thread_switch) (thrsw)
+         *   nop (thread_switch)
+         *   nop (thread_switch)
+         *   nop (tmu) (ldtmu0)
+         *   %val = r4
+         *
+         * NOTE: This needs to run after all other adjustments, since nothing may be moved over the thread switch.
+         */
+        void insertThreadSwitches(const Module& module, Method& method, const Configuration& config);
     } // namespace normalization
 } // namespace vc4c
 
@@ -0,0 +1,477 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "Specialization.h"
+
+#include "../Method.h"
+#include "../Module.h"
+#include "../Profiler.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "CompilationError.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+
+using namespace vc4c;
+using namespace vc4c::normalization;
+
+static std::string getKernelName(const std::string& name)
+{
+    return name.empty() || name[0] != '@' ? name : name.substr(1);
+}
+
+static Method* findKernel(Module& module, const std::string& kernelName)
+{
+    auto it = std::find_if(module.methods.begin(), module.methods.end(), [&](const std::unique_ptr<Method>& method) {
+        return method && method->isKernel && getKernelName(method->name) == kernelName;
+    });
+    return it != module.methods.end() ? it->get() : nullptr;
+}
+
+/*
+ * Creates the constant value the host would pass for the given parameter, including the sign- or zero-extension
+ * applied when loading the parameter.
+ */
+static Value createParameterValue(const Parameter& param, uint32_t bits)
+{
+    if(param.type.getPointerType() || param.type.getImageType() || !param.type.isScalarType() ||
+        param.type.getScalarBitCount() > 32)
+        throw CompilationError(CompilationStep::NORMALIZER,
+            "Only scalar parameters of up to 32 bits can be bound to constant values", param.to_string());
+    if(param.type.isFloatingType())
+        return Value(Literal(bit_cast<uint32_t, float>(bits)), param.type);
+    const auto bitCount = param.type.getScalarBitCount();
+    if(bitCount < 32)
+    {
+        const uint32_t mask = (1u << bitCount) - 1u;
+        bits &= mask;
+        if(has_flag(param.decorations, ParameterDecorations::SIGN_EXTEND) && (bits >> (bitCount - 1u)) != 0)
+            bits |= ~mask;
+    }
+    return Value(Literal(bits), param.type);
+}
+
+/*
+ * Copies the whole kernel code into the given new method, mapping the parameters of the original kernel to the
+ * parameters of the new method.
+ */
+static void copyKernel(const Method& kernel, Method& variant, const KernelVersion* version = nullptr)
+{
+    variant.isKernel = true;
+    variant.returnType = kernel.returnType;
+    variant.metaData = kernel.metaData;
+
+    intermediate::InlineMapping mapping;
+    mapping.reserve(kernel.countInstructions());
+    for(const Parameter& param : kernel.parameters)
+    {
+        auto type = param.type;
+        auto decorations = param.decorations;
+        auto ptrType = param.type.getPointerType();
+        if(version && ptrType)
+        {
+            if(version->pointerAlignment > ptrType->getAlignment())
+                type = variant.createPointerType(
+                    ptrType->elementType, ptrType->addressSpace, version->pointerAlignment);
+            if(version->noAliasing)
+                decorations = add_flag(decorations, ParameterDecorations::RESTRICT);
+        }
+        Parameter copy(param.name, type, decorations);
+        copy.maxByteOffset = param.maxByteOffset;
+        copy.parameterName = param.parameterName;
+        copy.origTypeName = param.origTypeName;
+        copy.isLowered = param.isLowered;
+        mapping.emplace(&param, &variant.addParameter(std::move(copy)));
+    }
+    for(std::size_t i = 0; i < BuiltinLocal::NUM_LOCALS; ++i)
+    {
+        auto type = static_cast<BuiltinLocal::Type>(i);
+        if(auto builtin = kernel.findBuiltin(type))
+            mapping.emplace(builtin, variant.findOrCreateBuiltin(type));
+    }
+
+    for(const BasicBlock& block : kernel)
+    {
+        for(const auto& inst : block)
+        {
+            if(inst)
+                variant.appendToEnd(inst->copyFor(variant, "", mapping));
+        }
+    }
+}
+
+static void specializeKernel(Module& module, const KernelSpecialization& specialization)
+{
+    auto kernel = findKernel(module, specialization.kernelName);
+    if(!kernel)
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Failed to find kernel to be specialized", specialization.kernelName);
+    if(specialization.variantName.empty() || findKernel(module, specialization.variantName))
+        throw CompilationError(CompilationStep::NORMALIZER,
+            "Name of specialized kernel variant is empty or already in use", specialization.variantName);
+
+    std::unique_ptr<Method> variant(new Method(module));
+    // keep the naming convention of the original kernel
+    variant->name = (kernel->name.size() > 0 && kernel->name[0] == '@' ? "@" : "") + specialization.variantName;
+    copyKernel(*kernel, *variant);
+
+    for(const auto& entry : specialization.parameterValues)
+    {
+        if(entry.first >= variant->parameters.size())
+            throw CompilationError(CompilationStep::NORMALIZER,
+                "Parameter index for kernel specialization is out of bounds: " + std::to_string(entry.first),
+                kernel->name);
+        const Parameter& param = variant->parameters[entry.first];
+        const auto value = createParameterValue(param, entry.second);
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Binding parameter '" << param.to_string() << "' of kernel variant '" << variant->name
+                << "' to constant: " << value.to_string() << logging::endl);
+        // the parameter is still loaded from its UNIFORM, but the loaded value is never read
+        for(auto reader : param.getUsers(LocalUse::Type::READER))
+            const_cast<LocalUser*>(reader)->replaceLocal(&param, value, LocalUse::Type::READER);
+    }
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Created kernel variant '" << variant->name << "' of kernel '" << kernel->name << "' with "
+            << specialization.parameterValues.size() << " bound parameters" << logging::endl);
+    module.methods.emplace_back(std::move(variant));
+}
+
+static ParameterDecorations mergeDecorations(ParameterDecorations first, ParameterDecorations second)
+{
+    // the shared parameter is accessed by both kernels, so it is only read-only or not aliased, if it is for both
+    auto merged = add_flag(first, second);
+    if(!has_flag(first, ParameterDecorations::READ_ONLY) || !has_flag(second, ParameterDecorations::READ_ONLY))
+        merged = remove_flag(merged, ParameterDecorations::READ_ONLY);
+    if(!has_flag(first, ParameterDecorations::RESTRICT) || !has_flag(second, ParameterDecorations::RESTRICT))
+        merged = remove_flag(merged, ParameterDecorations::RESTRICT);
+    return merged;
+}
+
+/*
+ * Creates the parameters of the fused kernel and returns the parameter of the fused kernel every parameter of the
+ * fused kernels is mapped to.
+ */
+static intermediate::InlineMapping createFusedParameters(
+    const std::vector<std::pair<const Method*, std::vector<unsigned>>>& kernels, Method& fused)
+{
+    std::vector<std::vector<const Parameter*>> fusedParameters;
+    for(const auto& entry : kernels)
+    {
+        if(!entry.second.empty() && entry.second.size() != entry.first->parameters.size())
+            throw CompilationError(CompilationStep::NORMALIZER,
+                "Number of parameter indices for kernel fusion does not match the number of kernel parameters",
+                entry.first->name);
+        for(std::size_t i = 0; i < entry.first->parameters.size(); ++i)
+        {
+            auto index = entry.second.empty() ? fusedParameters.size() : entry.second[i];
+            if(index >= fusedParameters.size())
+                fusedParameters.resize(index + 1);
+            fusedParameters[index].push_back(&entry.first->parameters[i]);
+        }
+    }
+
+    intermediate::InlineMapping mapping;
+    for(std::size_t index = 0; index < fusedParameters.size(); ++index)
+    {
+        if(fusedParameters[index].empty())
+            throw CompilationError(CompilationStep::NORMALIZER,
+                "Parameter of fused kernel is not used by any kernel: " + std::to_string(index), fused.name);
+        const Parameter& first = *fusedParameters[index].front();
+        // the names of the parameters of different kernels may collide
+        auto name = first.name;
+        if(std::any_of(fused.parameters.begin(), fused.parameters.end(),
+               [&](const Parameter& param) -> bool { return param.name == name; }))
+            name.append(".").append(std::to_string(index));
+        Parameter copy(name, first.type, first.decorations);
+        copy.maxByteOffset = first.maxByteOffset;
+        copy.parameterName = first.parameterName;
+        copy.origTypeName = first.origTypeName;
+        for(const Parameter* param : fusedParameters[index])
+        {
+            if(!(param->type == first.type))
+                throw CompilationError(CompilationStep::NORMALIZER,
+                    "Kernel parameters mapped to the same parameter of the fused kernel have different types",
+                    param->to_string() + " and " + first.to_string());
+            copy.decorations = mergeDecorations(copy.decorations, param->decorations);
+            copy.maxByteOffset = std::max(copy.maxByteOffset, param->maxByteOffset);
+        }
+        const Parameter& fusedParam = fused.addParameter(std::move(copy));
+        for(const Parameter* param : fusedParameters[index])
+            mapping.emplace(param, &fusedParam);
+    }
+    return mapping;
+}
+
+/*
+ * Appends the code of the given kernel to the fused kernel. If the kernel is not the last fused kernel, all its returns
+ * are replaced with branches to the given label following its code.
+ */
+static void appendKernelCode(
+    const Method& kernel, Method& fused, intermediate::InlineMapping mapping, const Local* nextKernelLabel)
+{
+    for(std::size_t i = 0; i < BuiltinLocal::NUM_LOCALS; ++i)
+    {
+        auto type = static_cast<BuiltinLocal::Type>(i);
+        if(auto builtin = kernel.findBuiltin(type))
+            mapping.emplace(builtin, fused.findOrCreateBuiltin(type));
+    }
+
+    // the locals (including the labels) of the different kernels may collide
+    const std::string localPrefix = "%" + getKernelName(kernel.name) + ".";
+    for(const BasicBlock& block : kernel)
+    {
+        for(const auto& inst : block)
+        {
+            if(!inst)
+                continue;
+            if(nextKernelLabel && dynamic_cast<const intermediate::Return*>(inst.get()))
+                fused.appendToEnd(new intermediate::Branch(nextKernelLabel));
+            else
+                fused.appendToEnd(inst->copyFor(fused, localPrefix, mapping));
+        }
+    }
+    if(nextKernelLabel)
+        fused.appendToEnd(new intermediate::BranchLabel(*nextKernelLabel));
+}
+
+static void fuseKernel(Module& module, const KernelFusion& fusion)
+{
+    if(fusion.fusedName.empty() || findKernel(module, fusion.fusedName))
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Name of fused kernel is empty or already in use", fusion.fusedName);
+    if(fusion.kernels.empty())
+        throw CompilationError(CompilationStep::NORMALIZER, "No kernels to be fused given", fusion.fusedName);
+
+    std::vector<std::pair<const Method*, std::vector<unsigned>>> kernels;
+    kernels.reserve(fusion.kernels.size());
+    for(const auto& entry : fusion.kernels)
+    {
+        auto kernel = findKernel(module, entry.first);
+        if(!kernel)
+            throw CompilationError(CompilationStep::NORMALIZER, "Failed to find kernel to be fused", entry.first);
+        if(std::any_of(kernels.begin(), kernels.end(),
+               [&](const std::pair<const Method*, std::vector<unsigned>>& other) -> bool {
+                   return other.first == kernel;
+               }))
+            // the locals of the copies of the same kernel would collide
+            throw CompilationError(CompilationStep::NORMALIZER, "Kernel can only be fused once", entry.first);
+        if(!kernels.empty() && kernel->metaData.workGroupSizes != kernels.front().first->metaData.workGroupSizes)
+            throw CompilationError(CompilationStep::NORMALIZER,
+                "Fused kernels need to have the same compile-time work-group size", entry.first);
+        kernels.emplace_back(kernel, entry.second);
+    }
+
+    const Method& firstKernel = *kernels.front().first;
+    std::unique_ptr<Method> fused(new Method(module));
+    // keep the naming convention of the original kernels
+    fused->name = (firstKernel.name.size() > 0 && firstKernel.name[0] == '@' ? "@" : "") + fusion.fusedName;
+    fused->isKernel = true;
+    fused->returnType = firstKernel.returnType;
+    fused->metaData = firstKernel.metaData;
+    auto mapping = createFusedParameters(kernels, *fused);
+
+    fused->appendToEnd(new intermediate::BranchLabel(*fused->createLocal(TYPE_LABEL, BasicBlock::DEFAULT_BLOCK)));
+    for(std::size_t i = 0; i < kernels.size(); ++i)
+    {
+        const Local* nextKernelLabel = i + 1 < kernels.size() ?
+            fused->createLocal(TYPE_LABEL, "%" + getKernelName(kernels[i + 1].first->name) + ".start") :
+            nullptr;
+        appendKernelCode(*kernels[i].first, *fused, mapping, nextKernelLabel);
+    }
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Created fused kernel '" << fused->name << "' of " << kernels.size() << " kernels with "
+            << fused->parameters.size() << " parameters" << logging::endl);
+    module.methods.emplace_back(std::move(fused));
+}
+
+static void createKernelVersion(Module& module, const KernelVersion& version)
+{
+    auto kernel = findKernel(module, version.kernelName);
+    if(!kernel)
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Failed to find kernel to create version of", version.kernelName);
+    if(version.versionName.empty() || findKernel(module, version.versionName))
+        throw CompilationError(CompilationStep::NORMALIZER, "Name of kernel version is empty or already in use",
+            version.versionName);
+    if((version.pointerAlignment & (version.pointerAlignment - 1)) != 0)
+        throw CompilationError(CompilationStep::NORMALIZER,
+            "Assumed pointer alignment for kernel version is not a power of two",
+            std::to_string(version.pointerAlignment));
+    const bool hasWorkGroupSize = std::any_of(version.workGroupSizes.begin(), version.workGroupSizes.end(),
+        [](uint32_t size) -> bool { return size > 0; });
+    // unset dimensions are launched with a single work-item
+    auto workGroupSizes = version.workGroupSizes;
+    for(auto& size : workGroupSizes)
+        size = std::max(size, 1u);
+    if(hasWorkGroupSize && kernel->metaData.isWorkGroupSizeSet() && kernel->metaData.workGroupSizes != workGroupSizes)
+        throw CompilationError(CompilationStep::NORMALIZER,
+            "Assumed work-group size for kernel version differs from the compile-time work-group size of the kernel",
+            version.versionName);
+
+    std::unique_ptr<Method> copy(new Method(module));
+    // keep the naming convention of the original kernel
+    copy->name = (kernel->name.size() > 0 && kernel->name[0] == '@' ? "@" : "") + version.versionName;
+    copyKernel(*kernel, *copy, &version);
+    if(hasWorkGroupSize)
+        copy->metaData.workGroupSizes = workGroupSizes;
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Created kernel version '" << copy->name << "' of kernel '" << kernel->name << "' assuming "
+            << (version.pointerAlignment ? std::to_string(version.pointerAlignment) + " byte aligned" : "unaligned")
+            << (version.noAliasing ? ", non-overlapping" : "") << " buffers"
+            << (hasWorkGroupSize ? " and a fixed work-group size" : "") << logging::endl);
+    module.methods.emplace_back(std::move(copy));
+}
+
+void normalization::specializeKernels(Module& module, const Configuration& config)
+{
+    if(config.kernelSpecializations.empty())
+        return;
+    PROFILE_START(SpecializeKernels);
+    for(const auto& specialization : config.kernelSpecializations)
+        specializeKernel(module, specialization);
+    PROFILE_END(SpecializeKernels);
+}
+
+void normalization::fuseKernels(Module& module, const Configuration& config)
+{
+    if(config.kernelFusions.empty())
+        return;
+    PROFILE_START(FuseKernels);
+    for(const auto& fusion : config.kernelFusions)
+        fuseKernel(module, fusion);
+    PROFILE_END(FuseKernels);
+}
+
+void normalization::createKernelVersions(Module& module, const Configuration& config)
+{
+    if(config.kernelVersions.empty())
+        return;
+    PROFILE_START(CreateKernelVersions);
+    for(const auto& version : config.kernelVersions)
+        createKernelVersion(module, version);
+    PROFILE_END(CreateKernelVersions);
+}
+
+/*
+ * Appends the given text to the structural key of a kernel, replacing the names of the given locals with the index of
+ * their first appearance. Thus, the keys of two kernels are the same if they only differ in the names of their locals.
+ */
+static void appendCanonicalized(std::string& key, const std::string& text, const FastSet<std::string>& localNames,
+    FastMap<std::string, std::size_t>& canonicalNames)
+{
+    auto isNameCharacter = [](char c) -> bool {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$';
+    };
+    std::size_t pos = 0;
+    while(pos < text.size())
+    {
+        auto start = text.find('%', pos);
+        if(start == std::string::npos)
+        {
+            key.append(text, pos, std::string::npos);
+            break;
+        }
+        auto end = start + 1;
+        while(end < text.size() && isNameCharacter(text[end]))
+            ++end;
+        key.append(text, pos, start - pos);
+        auto name = text.substr(start, end - start);
+        // all other names (e.g. of globals or types) are kept, since they are not specific to the kernel
+        if(localNames.find(name) != localNames.end())
+        {
+            auto index = canonicalNames.emplace(name, canonicalNames.size()).first->second;
+            key.append("%#").append(std::to_string(index));
+        }
+        else
+            key.append(name);
+        pos = end;
+    }
+}
+
+/*
+ * Calculates the key of the kernel's code (and everything else influencing the compilation of the kernel), which is
+ * independent of the names of the kernel, its parameters and its locals.
+ */
+static std::string calculateStructuralKey(const Method& kernel)
+{
+    FastSet<std::string> localNames;
+    for(const auto& param : kernel.parameters)
+        localNames.emplace(param.name);
+    for(const auto& allocation : kernel.stackAllocations)
+        localNames.emplace(allocation.name);
+    for(const auto& bb : kernel)
+    {
+        localNames.emplace(bb.getLabel()->getLabel()->name);
+        for(const auto& inst : bb)
+        {
+            if(!inst)
+                continue;
+            for(const auto& pair : inst->getUsedLocals())
+            {
+                if(!pair.first->is<Global>())
+                    localNames.emplace(pair.first->name);
+            }
+        }
+    }
+
+    FastMap<std::string, std::size_t> canonicalNames;
+    std::string key = kernel.returnType.to_string() + '\n';
+    for(const auto& param : kernel.parameters)
+    {
+        // the parameter and type names are only used for the kernel info, not for the compilation
+        appendCanonicalized(key, param.to_string(false), localNames, canonicalNames);
+        key.append(" ")
+            .append(std::to_string(static_cast<uint32_t>(param.decorations)))
+            .append(" ")
+            .append(std::to_string(param.maxByteOffset))
+            .append("\n");
+    }
+    key.append(to_string<uint32_t>(kernel.metaData.workGroupSizes))
+        .append("\n")
+        .append(to_string<uint32_t>(kernel.metaData.workGroupSizeHints))
+        .append("\n");
+    for(const auto& allocation : kernel.stackAllocations)
+    {
+        appendCanonicalized(key, allocation.to_string(true), localNames, canonicalNames);
+        key.append("\n");
+    }
+    for(const auto& bb : kernel)
+    {
+        for(const auto& inst : bb)
+        {
+            if(inst)
+                appendCanonicalized(key, inst->to_string(), localNames, canonicalNames);
+            key.append("\n");
+        }
+    }
+    return key;
+}
+
+FastMap<Method*, Method*> normalization::findDuplicateKernels(Module& module, const Configuration& config)
+{
+    FastMap<Method*, Method*> duplicates;
+    if(!config.profileGenerateFile.empty() || !config.profileUseFile.empty())
+        return duplicates;
+    PROFILE_START(FindDuplicateKernels);
+    FastMap<std::string, Method*> kernelsByKey;
+    for(auto kernel : module.getKernels())
+    {
+        auto it = kernelsByKey.emplace(calculateStructuralKey(*kernel), kernel).first;
+        if(it->second == kernel)
+            continue;
+        CPPLOG_LAZY(logging::Level::INFO,
+            log << "Kernel '" << kernel->name << "' is identical to kernel '" << it->second->name
+                << "' and shares its code" << logging::endl);
+        duplicates.emplace(kernel, it->second);
+    }
+    PROFILE_END(FindDuplicateKernels);
+    return duplicates;
+}
@@ -0,0 +1,108 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_NORMALIZATION_SPECIALIZATION_H
+#define VC4C_NORMALIZATION_SPECIALIZATION_H
+
+#include "../performance.h"
+
+namespace vc4c
+{
+    class Method;
+    class Module;
+    struct Configuration;
+
+    namespace normalization
+    {
+        /*
+         * Creates the kernel variants configured in Configuration#kernelSpecializations as additional kernels of the
+         * module.
+         *
+         * Every variant is a copy of the original kernel with the same parameters (so the UNIFORMs passed by the host
+         * are the same as for the original kernel), but with all reads of the bound parameters replaced by their
+         * constant values. The constants are then propagated by the usual normalization and optimization steps, e.g.
+         * folded into the loop conditions to allow for the loops to be unrolled.
+         *
+         * Example (for %width bound to 4):
+         *   %offset = mul %i, %width
+         *   - = xor.setf %i, %width
+         *
+         * is converted to:
+         *   %offset = mul %i, 4
+         *   - = xor.setf %i, 4
+         *
+         * NOTE: This needs to run after the module-wide preparation steps (e.g. inlining), since the variant only
+         * contains a copy of the kernel code.
+         */
+        void specializeKernels(Module& module, const Configuration& config);
+
+        /*
+         * Creates the fused kernels configured in Configuration#kernelFusions as additional kernels of the module.
+         *
+         * The fused kernel contains copies of the code of all fused kernels in the configured order, where every
+         * return of a kernel (except the last one) is replaced with a branch to the code of the next kernel. This
+         * saves the launch of the additional kernels (including the loading of the UNIFORMs and the work-item info)
+         * and allows the optimizations (e.g. the common subexpression elimination) to work across the kernel
+         * boundaries, e.g. to share the calculation of the element addresses of the intermediate buffers.
+         *
+         * Example (for the second parameter of %blur and the first of %threshold mapped to the same parameter):
+         *   kernel %blur(%in, %tmp): [body of %blur]
+         *   kernel %threshold(%tmp, %out): [body of %threshold]
+         *
+         * is converted to the additional kernel:
+         *   kernel %blur_threshold(%in, %tmp, %out):
+         *   [body of %blur]
+         *   [body of %threshold]
+         *
+         * NOTE: All fused kernels need to have the same compile-time work-group size (if any).
+         * NOTE: This needs to run after the module-wide preparation steps (e.g. inlining), since the fused kernel only
+         * contains a copy of the kernel code.
+         */
+        void fuseKernels(Module& module, const Configuration& config);
+
+        /*
+         * Creates the kernel versions configured in Configuration#kernelVersions as additional kernels of the module.
+         *
+         * Every version is a copy of the original kernel with the same parameters, where the assumptions of the
+         * version are applied to the copy:
+         * - the pointer parameters get pointer types with the assumed alignment, which is then used to simplify the
+         *   memory accesses (see analysis::KnownAlignment)
+         * - the pointer parameters are marked as restrict, which allows the memory accesses to be reordered, combined
+         *   and cached in VPM
+         * - the assumed work-group size is set as compile-time work-group size, e.g. to allow for the work-items to be
+         *   coarsened
+         *
+         * Example (for an alignment of 16 and no aliasing):
+         *   kernel %copy(i8 addrspace(1)* %in, i8 addrspace(1)* %out)
+         *
+         * is converted to the additional kernel:
+         *   kernel %copy_fast(i8 addrspace(1)* align 16 restrict %in, i8 addrspace(1)* align 16 restrict %out)
+         *
+         * NOTE: This needs to run after the module-wide preparation steps (e.g. inlining), since the version only
+         * contains a copy of the kernel code.
+         */
+        void createKernelVersions(Module& module, const Configuration& config);
+
+        /*
+         * Finds the kernels which are structurally identical to another kernel of the module, i.e. which only differ
+         * in the names of the kernel, its parameters and its locals (e.g. kernels generated by macros for several
+         * image formats or the kernel variants and versions matching their original kernel).
+         *
+         * Since the compilation of a kernel only depends on its code and not on the names, the identical kernels only
+         * need to be compiled once and can share the generated code (see qpu_asm::CodeGenerator#addKernelAlias()).
+         *
+         * Returns the duplicate kernels mapped to the (first in module order) identical kernel to be compiled.
+         *
+         * NOTE: This needs to run after the module-wide preparation steps (e.g. inlining), since only the code of the
+         * kernels themselves is compared.
+         * NOTE: The kernels are not deduplicated if an execution profile is recorded or applied, since the profile is
+         * stored per kernel name.
+         */
+        FastMap<Method*, Method*> findDuplicateKernels(Module& module, const Configuration& config);
+    } // namespace normalization
+} // namespace vc4c
+
+#endif /* VC4C_NORMALIZATION_SPECIALIZATION_H */
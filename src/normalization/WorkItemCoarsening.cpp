@@ -0,0 +1,742 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "WorkItemCoarsening.h"
+
+#include "../InstructionWalker.h"
+#include "../Method.h"
+#include "../Module.h"
+#include "../Profiler.h"
+#include "../intermediate/IntermediateInstruction.h"
+#include "../intermediate/VectorHelper.h"
+#include "../intermediate/operators.h"
+#include "../periphery/TMU.h"
+#include "LiteralValues.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace vc4c;
+using namespace vc4c::normalization;
+using namespace vc4c::intermediate;
+using namespace vc4c::operators;
+
+// the number of work-items mapped onto the SIMD elements of a single QPU
+static constexpr uint8_t COARSENING_FACTOR = static_cast<uint8_t>(NATIVE_VECTOR_SIZE);
+// the shift to scale the QPU-local id to the local id of the work-item in the first SIMD element
+static constexpr uint32_t COARSENING_SHIFT = 4;
+// the maximum absolute stride between the values of two SIMD elements still tracked as such
+static constexpr int32_t MAX_STRIDE = 1 << 20;
+// the maximum number of pointer calculations followed to determine the parameter a memory address is derived from
+static constexpr unsigned MAX_ADDRESS_DEPTH = 16;
+
+enum class LaneKind : unsigned char
+{
+    // the value is the same for all work-items of the QPU and calculated as before
+    UNIFORM,
+    // the value of a work-item is the value of the first work-item plus a constant stride per SIMD element, e.g. the
+    // local id. The local still only holds the value of the first work-item.
+    STRIDED,
+    // the values differ arbitrarily between the work-items, the local is converted to a vector
+    VARYING
+};
+
+struct LaneValue
+{
+    LaneKind kind;
+    // the difference between the values of two neighboring SIMD elements, only valid for STRIDED values
+    int32_t stride;
+
+    bool operator==(const LaneValue& other) const
+    {
+        return kind == other.kind && stride == other.stride;
+    }
+};
+
+static constexpr LaneValue UNIFORM_LANES{LaneKind::UNIFORM, 0};
+static constexpr LaneValue VARYING_LANES{LaneKind::VARYING, 0};
+
+using LaneValues = FastMap<const Local*, LaneValue>;
+
+static LaneValue getLaneValue(const Local* loc, const LaneValues& values)
+{
+    auto it = values.find(loc);
+    return it != values.end() ? it->second : UNIFORM_LANES;
+}
+
+static LaneValue getLaneValue(const Value& val, const LaneValues& values)
+{
+    if(auto loc = val.checkLocal())
+        return getLaneValue(loc, values);
+    return UNIFORM_LANES;
+}
+
+static bool hasUniformArguments(const IntermediateInstruction& inst, const LaneValues& values)
+{
+    return std::all_of(inst.getArguments().begin(), inst.getArguments().end(),
+        [&](const Value& arg) -> bool { return getLaneValue(arg, values).kind == LaneKind::UNIFORM; });
+}
+
+/*
+ * Returns the instructions actually writing the value of the given local. Memory writes are also registered as writers
+ * of their address operand, but do not modify it.
+ */
+static FastSet<const LocalUser*> getValueWriters(const Local* loc)
+{
+    auto writers = loc->getUsers(LocalUse::Type::WRITER);
+    for(auto it = writers.begin(); it != writers.end();)
+    {
+        auto mem = dynamic_cast<const MemoryInstruction*>(*it);
+        if(mem && mem->op != MemoryOperation::READ)
+            it = writers.erase(it);
+        else
+            ++it;
+    }
+    return writers;
+}
+
+/*
+ * Returns the dimension of the local id read by the given instruction, if it extracts a single dimension of the local
+ * ids UNIFORM value
+ */
+static Optional<unsigned> getReadLocalIdDimension(const IntermediateInstruction& inst)
+{
+    auto move = dynamic_cast<const MoveOperation*>(&inst);
+    if(!move || dynamic_cast<const VectorRotation*>(&inst) || move->hasConditionalExecution() ||
+        move->doesSetFlag() || move->hasPackMode() || !move->checkOutputLocal())
+        return {};
+    auto builtin = move->getSource().checkLocal() ? move->getSource().local()->as<BuiltinLocal>() : nullptr;
+    if(!builtin || builtin->builtinType != BuiltinLocal::Type::LOCAL_IDS)
+        return {};
+    if(move->getUnpackMode() == UNPACK_8A_32)
+        return 0u;
+    if(move->getUnpackMode() == UNPACK_8B_32)
+        return 1u;
+    if(move->getUnpackMode() == UNPACK_8C_32)
+        return 2u;
+    return {};
+}
+
+static bool isScalarValueType(DataType type)
+{
+    return type.getPointerType() || (type.isScalarType() && type.getScalarBitCount() <= 32);
+}
+
+static DataType toCoarsenedType(DataType type)
+{
+    // the addresses of all SIMD elements are no longer a single pointer
+    return (type.getPointerType() ? TYPE_INT32 : type).toVectorType(COARSENING_FACTOR);
+}
+
+/*
+ * Returns the kernel parameter the given memory address is calculated from
+ */
+static const Parameter* findParameterBase(const Value& address)
+{
+    auto loc = address.checkLocal();
+    for(unsigned i = 0; loc && i < MAX_ADDRESS_DEPTH; ++i)
+    {
+        if(auto param = loc->as<Parameter>())
+            return param;
+        auto writers = getValueWriters(loc);
+        if(writers.size() != 1)
+            return nullptr;
+        auto writer = *writers.begin();
+        auto op = dynamic_cast<const Operation*>(writer);
+        if((!op || op->op != OP_ADD) && !dynamic_cast<const MoveOperation*>(writer))
+            return nullptr;
+        if(writer->hasConditionalExecution() || writer->hasPackMode() || writer->hasUnpackMode())
+            return nullptr;
+        const Local* next = nullptr;
+        for(const auto& arg : writer->getArguments())
+        {
+            if(!arg.type.getPointerType() || !arg.checkLocal())
+                continue;
+            if(next)
+                // the calculation of two pointers, e.g. a pointer difference
+                return nullptr;
+            next = arg.local();
+        }
+        loc = next;
+    }
+    return nullptr;
+}
+
+/*
+ * Returns whether the given address accesses consecutive elements of the given type in memory for consecutive SIMD
+ * elements, i.e. whether the memory access can be converted to the access of a vector of elements.
+ */
+static bool isConsecutiveAccess(const Value& address, DataType elementType, const LaneValues& values)
+{
+    auto lanes = getLaneValue(address, values);
+    if(lanes.kind != LaneKind::STRIDED || !elementType.isScalarType() || elementType.getScalarBitCount() > 32 ||
+        lanes.stride != static_cast<int32_t>(elementType.getInMemoryWidth()))
+        return false;
+    // other memory areas might be lowered to registers or VPM, where the access is calculated differently
+    auto param = findParameterBase(address);
+    return param && param->type.getPointerType() &&
+        (param->type.getPointerType()->addressSpace == AddressSpace::GLOBAL ||
+            param->type.getPointerType()->addressSpace == AddressSpace::CONSTANT);
+}
+
+/*
+ * Returns whether the given memory read loads an element from a different, arbitrary address for every SIMD element,
+ * which can be lowered to a per-element TMU load (gather), since the memory is only read by the kernel.
+ */
+static bool isTMUGather(const MemoryInstruction& mem, const LaneValues& values)
+{
+    const auto elementType = mem.getSourceElementType();
+    if(mem.op != MemoryOperation::READ || mem.getNumEntries() != INT_ONE || elementType.getPointerType() ||
+        !elementType.isScalarType() || elementType.getScalarBitCount() > 32 ||
+        getLaneValue(mem.getSource(), values).kind == LaneKind::UNIFORM)
+        return false;
+    // other memory areas might be lowered to registers or VPM and the TMU cache is not coherent with any memory write
+    auto param = findParameterBase(mem.getSource());
+    auto pointerType = param ? param->type.getPointerType() : nullptr;
+    return pointerType &&
+        (pointerType->addressSpace == AddressSpace::CONSTANT ||
+            (pointerType->addressSpace == AddressSpace::GLOBAL &&
+                has_flag(param->decorations, ParameterDecorations::READ_ONLY)));
+}
+
+/*
+ * Determines how the value written by the given instruction differs between the work-items mapped to the SIMD
+ * elements. Returns an empty value if the instruction cannot be coarsened.
+ */
+static Optional<LaneValue> determineWrittenLanes(const IntermediateInstruction& inst, const LaneValues& values)
+{
+    if(getReadLocalIdDimension(inst) == 0u)
+        return LaneValue{LaneKind::STRIDED, 1};
+    if(hasUniformArguments(inst, values))
+        return UNIFORM_LANES;
+    if(auto mem = dynamic_cast<const MemoryInstruction*>(&inst))
+    {
+        if(mem->op == MemoryOperation::READ &&
+            isConsecutiveAccess(mem->getSource(), mem->getSourceElementType(), values))
+            return VARYING_LANES;
+        if(isTMUGather(*mem, values))
+            return VARYING_LANES;
+        return {};
+    }
+
+    auto op = dynamic_cast<const Operation*>(&inst);
+    auto move = dynamic_cast<const MoveOperation*>(&inst);
+    if((!op && !move) || dynamic_cast<const VectorRotation*>(&inst) || inst.hasConditionalExecution() ||
+        inst.doesSetFlag() || inst.hasSideEffects() || !inst.checkOutputLocal())
+        return {};
+    for(const auto& arg : inst.getArguments())
+    {
+        if(!isScalarValueType(arg.type))
+            return {};
+        // the other registers (e.g. the element number) are not the same for all SIMD elements
+        if(arg.checkRegister() && !arg.hasRegister(REG_UNIFORM) && !arg.hasRegister(REG_QPU_NUMBER))
+            return {};
+    }
+
+    const auto& outType = inst.getOutput()->type;
+    if((outType.isIntegralType() || outType.getPointerType()) && !inst.hasPackMode() && !inst.hasUnpackMode())
+    {
+        // calculations linear in the values of the SIMD elements keep the stride between them
+        Optional<LaneValue> result;
+        if(move)
+            result = getLaneValue(move->getSource(), values);
+        else
+        {
+            auto first = getLaneValue(op->getFirstArg(), values);
+            auto second = op->getSecondArg() ? getLaneValue(*op->getSecondArg(), values) : UNIFORM_LANES;
+            auto firstLiteral = op->getFirstArg().getLiteralValue();
+            auto secondLiteral = op->getSecondArg() & &Value::getLiteralValue;
+            if(first.kind == LaneKind::VARYING || second.kind == LaneKind::VARYING)
+                result = {};
+            else if(op->op == OP_ADD)
+                result = LaneValue{LaneKind::STRIDED, first.stride + second.stride};
+            else if(op->op == OP_SUB)
+                result = LaneValue{LaneKind::STRIDED, first.stride - second.stride};
+            else if(op->op == OP_SHL && secondLiteral && secondLiteral->unsignedInt() < 16)
+                result = LaneValue{LaneKind::STRIDED, first.stride * (1 << secondLiteral->unsignedInt())};
+            else if(op->op == OP_MUL24 && secondLiteral && second.kind == LaneKind::UNIFORM)
+                result = LaneValue{LaneKind::STRIDED, first.stride * secondLiteral->signedInt()};
+            else if(op->op == OP_MUL24 && firstLiteral && first.kind == LaneKind::UNIFORM)
+                result = LaneValue{LaneKind::STRIDED, second.stride * firstLiteral->signedInt()};
+        }
+        if(result && result->kind == LaneKind::STRIDED && std::abs(result->stride) <= MAX_STRIDE)
+            return result;
+    }
+
+    if(!isScalarValueType(outType))
+        return {};
+    // NOTE: Memory accessed via addresses differing arbitrarily between the SIMD elements can only be read via TMU
+    // gathers, all other memory accesses with such addresses are rejected
+    return VARYING_LANES;
+}
+
+/*
+ * Checks whether the given memory write (or copy, fill) can be coarsened
+ */
+static bool canCoarsenMemoryWrite(const MemoryInstruction& mem, const LaneValues& values)
+{
+    if(hasUniformArguments(mem, values) && getLaneValue(mem.getDestination(), values).kind == LaneKind::UNIFORM)
+        // NOTE: If the stored value is not uniform, all work-items write the same location
+        return true;
+    return mem.op == MemoryOperation::WRITE && isScalarValueType(mem.getSource().type) &&
+        getLaneValue(mem.getNumEntries(), values).kind == LaneKind::UNIFORM &&
+        isConsecutiveAccess(mem.getDestination(), mem.getDestinationElementType(), values);
+}
+
+/*
+ * Determines for all locals of the kernel how their values differ between the work-items mapped to the SIMD elements.
+ * Locals not contained in the result are the same for all work-items.
+ *
+ * Returns an empty value if the kernel cannot be coarsened.
+ */
+static Optional<LaneValues> determineLaneValues(Method& method)
+{
+    LaneValues values;
+    bool hasChanged = true;
+    while(hasChanged)
+    {
+        hasChanged = false;
+        // the lanes written and the number of writers for every local
+        FastMap<const Local*, std::pair<LaneValue, unsigned>> writtenLanes;
+        for(auto& block : method)
+        {
+            for(auto& inst : block)
+            {
+                if(!inst)
+                    continue;
+                auto mem = dynamic_cast<const MemoryInstruction*>(inst.get());
+                if(mem && mem->op != MemoryOperation::READ)
+                {
+                    if(!canCoarsenMemoryWrite(*mem, values))
+                    {
+                        CPPLOG_LAZY(logging::Level::DEBUG,
+                            log << "Cannot coarsen memory access: " << mem->to_string() << logging::endl);
+                        return {};
+                    }
+                    continue;
+                }
+                auto loc = inst->checkOutputLocal();
+                auto lanes = loc ? determineWrittenLanes(*inst, values) : Optional<LaneValue>{};
+                if(!loc && hasUniformArguments(*inst, values))
+                    // e.g. setting flags for a branch taken by all work-items
+                    continue;
+                if(!lanes)
+                {
+                    CPPLOG_LAZY(logging::Level::DEBUG,
+                        log << "Cannot coarsen instruction depending on the work-item: " << inst->to_string()
+                            << logging::endl);
+                    return {};
+                }
+                auto& entry = writtenLanes[loc];
+                if(entry.second == 0)
+                    entry.first = *lanes;
+                else if(entry.first.kind != LaneKind::UNIFORM || lanes->kind != LaneKind::UNIFORM)
+                    // the value of a multiply written local is only known to be strided, if all writers agree
+                    entry.first = VARYING_LANES;
+                ++entry.second;
+            }
+        }
+
+        for(const auto& entry : writtenLanes)
+        {
+            auto lanes = entry.second.first;
+            if(lanes.kind == LaneKind::UNIFORM)
+                continue;
+            auto it = values.find(entry.first);
+            if(it != values.end())
+            {
+                // make sure to converge, e.g. for cyclic dependencies within loops
+                if(it->second.kind == LaneKind::VARYING ||
+                    (it->second.kind == LaneKind::STRIDED && lanes.kind == LaneKind::STRIDED &&
+                        it->second.stride != lanes.stride))
+                    lanes = VARYING_LANES;
+                if(it->second == lanes)
+                    continue;
+            }
+            values[entry.first] = lanes;
+            hasChanged = true;
+        }
+    }
+    return values;
+}
+
+/*
+ * Checks the restrictions on locals whose values differ between the work-items
+ */
+static bool checkCoarsenedLocals(const LaneValues& values)
+{
+    for(const auto& entry : values)
+    {
+        const Local* loc = entry.first;
+        if(loc->get<MultiRegisterData>() || !isScalarValueType(loc->type))
+            return false;
+        if(entry.second.kind == LaneKind::STRIDED && !loc->type.isIntegralType() && !loc->type.getPointerType())
+            return false;
+        if(entry.second.kind != LaneKind::VARYING)
+            continue;
+        if(loc->is<Parameter>())
+            return false;
+        for(auto writer : getValueWriters(loc))
+        {
+            // the instruction is either converted to a vector operation, a consecutive memory read or a TMU gather
+            if(writer->hasConditionalExecution() || getReadLocalIdDimension(*writer) ||
+                (!dynamic_cast<const Operation*>(writer) && !dynamic_cast<const MoveOperation*>(writer) &&
+                    !dynamic_cast<const MemoryInstruction*>(writer)) ||
+                dynamic_cast<const VectorRotation*>(writer))
+                return false;
+            auto mem = dynamic_cast<const MemoryInstruction*>(writer);
+            if(mem && getLaneValue(mem->getSource(), values).kind != LaneKind::STRIDED && !isTMUGather(*mem, values))
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Determines the locals which hold the same value in all SIMD elements, e.g. values read from UNIFORMs and values
+ * calculated from them. This does not hold for e.g. values loaded from memory, since only the first SIMD element is
+ * loaded.
+ */
+static FastSet<const Local*> determineReplicatedLocals(Method& method)
+{
+    FastSet<const Local*> writtenLocals;
+    FastSet<const Local*> nonReplicatedLocals;
+    for(auto& block : method)
+    {
+        for(auto& inst : block)
+        {
+            auto loc = inst ? inst->checkOutputLocal() : nullptr;
+            auto mem = inst.get() ? dynamic_cast<const MemoryInstruction*>(inst.get()) : nullptr;
+            if(!loc || (mem && mem->op != MemoryOperation::READ))
+                continue;
+            writtenLocals.emplace(loc);
+            auto load = dynamic_cast<const LoadImmediate*>(inst.get());
+            if((!dynamic_cast<const Operation*>(inst.get()) && !dynamic_cast<const MoveOperation*>(inst.get()) &&
+                   (!load || load->type != LoadType::REPLICATE_INT32)) ||
+                dynamic_cast<const VectorRotation*>(inst.get()) || inst->hasConditionalExecution())
+                nonReplicatedLocals.emplace(loc);
+        }
+    }
+
+    // optimistically assume all other locals to be replicated and remove the ones calculated from non-replicated values
+    auto isReplicated = [&](const Value& val) -> bool {
+        if(auto loc = val.checkLocal())
+            return !nonReplicatedLocals.count(loc);
+        if(val.checkRegister())
+            return val.hasRegister(REG_UNIFORM) || val.hasRegister(REG_QPU_NUMBER);
+        return val.isLiteralValue() || val.checkImmediate();
+    };
+    bool hasChanged = true;
+    while(hasChanged)
+    {
+        hasChanged = false;
+        for(auto& block : method)
+        {
+            for(auto& inst : block)
+            {
+                auto loc = inst ? inst->checkOutputLocal() : nullptr;
+                if(!loc || nonReplicatedLocals.count(loc) ||
+                    std::all_of(inst->getArguments().begin(), inst->getArguments().end(), isReplicated))
+                    continue;
+                nonReplicatedLocals.emplace(loc);
+                hasChanged = true;
+            }
+        }
+    }
+
+    FastSet<const Local*> replicatedLocals;
+    for(auto loc : writtenLocals)
+    {
+        if(!nonReplicatedLocals.count(loc))
+            replicatedLocals.emplace(loc);
+    }
+    return replicatedLocals;
+}
+
+/*
+ * Returns the value of the given operand for all SIMD elements, inserting the instructions to calculate it if required
+ */
+static Value toCoarsenedValue(const Module& module, Method& method, InstructionWalker& it, const Value& arg,
+    const LaneValues& values, const FastSet<const Local*>& replicatedLocals, FastMap<const Local*, Value>& cache,
+    const Configuration& config)
+{
+    auto loc = arg.checkLocal();
+    if(!loc)
+    {
+        // literals, immediates and the remaining registers are the same for all SIMD elements
+        Value result = arg;
+        if(arg.type.getVectorWidth() == 1)
+            result.type = toCoarsenedType(arg.type);
+        return result;
+    }
+    auto lanes = getLaneValue(arg, values);
+    if(lanes.kind == LaneKind::VARYING)
+        return loc->createReference();
+    auto cacheIt = cache.find(loc);
+    if(cacheIt != cache.end())
+        return cacheIt->second;
+    // parameters and other locals without writers (e.g. work-group info) are read from UNIFORMs
+    bool isReplicated = replicatedLocals.count(loc) || getValueWriters(loc).empty();
+    if(lanes.kind == LaneKind::UNIFORM && isReplicated)
+        return arg;
+
+    Value base = arg;
+    if(!isReplicated)
+    {
+        base = method.addNewLocal(toCoarsenedType(loc->type), "%coarsened_base");
+        it = insertReplication(it, arg, base);
+    }
+    Value result = base;
+    if(lanes.kind == LaneKind::STRIDED && lanes.stride != 0)
+    {
+        // value of element i = value of element 0 + i * stride
+        auto vectorType = TYPE_INT32.toVectorType(COARSENING_FACTOR);
+        Value offsets = ELEMENT_NUMBER_REGISTER;
+        if(std::abs(lanes.stride) != 1)
+        {
+            offsets = method.addNewLocal(vectorType, "%coarsened_offsets");
+            assign(it, offsets) =
+                mul24(ELEMENT_NUMBER_REGISTER, Value(Literal(std::abs(lanes.stride)), TYPE_INT32));
+            // the stride might not fit into a small immediate
+            ignoreReturnValue(handleImmediate(module, method, it.copy().previousInBlock(), config));
+        }
+        result = method.addNewLocal(toCoarsenedType(loc->type), "%coarsened");
+        if(lanes.stride > 0)
+            assign(it, result) = base + offsets;
+        else
+            assign(it, result) = base - offsets;
+    }
+    cache.emplace(loc, result);
+    return result;
+}
+
+static DataType toVectorPointerType(Method& method, DataType pointerType)
+{
+    auto ptrType = pointerType.getPointerType();
+    return method.createPointerType(
+        ptrType->elementType.toVectorType(COARSENING_FACTOR), ptrType->addressSpace, ptrType->getAlignment());
+}
+
+/*
+ * Returns the number of work-items per work-group, if the work-group size is fixed at compile-time
+ */
+static Optional<uint32_t> getFixedWorkGroupSize(const KernelMetaData& metaData)
+{
+    if(!metaData.isWorkGroupSizeSet())
+        return {};
+    uint32_t numWorkItems = 1;
+    for(auto size : metaData.workGroupSizes)
+        // unset dimensions have a size of 1
+        numWorkItems *= std::max(size, 1u);
+    return numWorkItems;
+}
+
+bool normalization::coarsenWorkItems(const Module& module, Method& method, const Configuration& config)
+{
+    const auto& sizes = method.metaData.workGroupSizes;
+    if(!method.metaData.isWorkGroupSizeSet() || sizes[0] == 0 || sizes[0] % COARSENING_FACTOR != 0)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Work-items of kernel '" << method.name
+                << "' are not coarsened, since the work-group size is not a fixed multiple of "
+                << static_cast<unsigned>(COARSENING_FACTOR) << logging::endl);
+        return false;
+    }
+    if(!method.stackAllocations.empty())
+    {
+        // the private memory of all work-items of a QPU would be shared
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Work-items of kernel '" << method.name << "' are not coarsened, since it has stack allocations"
+                << logging::endl);
+        return false;
+    }
+
+    auto workGroupSize = getFixedWorkGroupSize(method.metaData);
+    auto isSingleQPUWorkGroup = workGroupSize && *workGroupSize == COARSENING_FACTOR;
+    for(auto& block : method)
+    {
+        for(auto& inst : block)
+        {
+            if(!inst)
+                continue;
+            // synchronization and atomic operations as well as remaining function calls would only be executed once
+            // for all work-items of a QPU. Work-group barriers are only supported if the whole work-group is executed
+            // by a single QPU, since they are removed afterwards (see #removeWorkGroupSynchronization()).
+            // Any other semaphore access is never supported, since it is not removed.
+            auto semaphore = dynamic_cast<const SemaphoreAdjustment*>(inst.get());
+            bool isUnsupported = dynamic_cast<const MethodCall*>(inst.get()) ||
+                dynamic_cast<const MutexLock*>(inst.get()) ||
+                (semaphore && !semaphore->hasDecoration(InstructionDecorations::WORK_GROUP_BARRIER)) ||
+                (!isSingleQPUWorkGroup && (semaphore || dynamic_cast<const MemoryBarrier*>(inst.get())));
+            // the local sizes of the work-group (except for the compile-time constants) are no longer the ones of the
+            // kernel code and all local ids need to be determined
+            inst->forUsedLocals([&](const Local* loc, LocalUse::Type type, const IntermediateInstruction& i) {
+                auto builtin = loc->as<BuiltinLocal>();
+                if(builtin && has_flag(type, LocalUse::Type::READER) &&
+                    (builtin->builtinType == BuiltinLocal::Type::LOCAL_SIZES ||
+                        (builtin->builtinType == BuiltinLocal::Type::LOCAL_IDS && !getReadLocalIdDimension(i))))
+                    isUnsupported = true;
+            });
+            if(isUnsupported)
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Work-items of kernel '" << method.name
+                        << "' are not coarsened, since it contains unsupported instruction: " << inst->to_string()
+                        << logging::endl);
+                return false;
+            }
+        }
+    }
+
+    auto lanes = determineLaneValues(method);
+    if(!lanes || !checkCoarsenedLocals(*lanes))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Work-items of kernel '" << method.name
+                << "' are not coarsened, since the work-item specific calculations are not supported" << logging::endl);
+        return false;
+    }
+    const auto& values = *lanes;
+    auto replicatedLocals = determineReplicatedLocals(method);
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Coarsening " << static_cast<unsigned>(COARSENING_FACTOR) << " work-items per QPU for kernel '"
+            << method.name << "' with " << values.size() << " work-item specific locals" << logging::endl);
+
+    // the addresses of the gathers are no longer pointers after converting the types of the work-item specific locals
+    FastSet<const MemoryInstruction*> gatheredReads;
+    for(auto& block : method)
+    {
+        for(auto& inst : block)
+        {
+            auto mem = inst ? dynamic_cast<const MemoryInstruction*>(inst.get()) : nullptr;
+            if(!mem || mem->op != MemoryOperation::READ ||
+                isConsecutiveAccess(mem->getSource(), mem->getSourceElementType(), values) ||
+                !isTMUGather(*mem, values))
+                continue;
+            gatheredReads.emplace(mem);
+            // the memory is read directly via TMU and not by the later lowering of the memory accesses
+            auto param = findParameterBase(mem->getSource());
+            const_cast<Parameter*>(param)->decorations = add_flag(param->decorations, ParameterDecorations::INPUT);
+        }
+    }
+
+    for(const auto& entry : values)
+    {
+        if(entry.second.kind == LaneKind::VARYING)
+            const_cast<DataType&>(entry.first->type) = toCoarsenedType(entry.first->type);
+    }
+
+    std::size_t numCoarsened = 0;
+    for(auto& block : method)
+    {
+        // the values for all SIMD elements already calculated in this block
+        FastMap<const Local*, Value> coarsenedValues;
+        auto it = block.walk().nextInBlock();
+        while(!it.isEndOfBlock())
+        {
+            if(!it.has())
+            {
+                it.nextInBlock();
+                continue;
+            }
+            auto out = it->checkOutputLocal();
+            auto mem = it.get<MemoryInstruction>();
+            if(getReadLocalIdDimension(*it.get()) == 0u)
+            {
+                // local id = QPU-local id * 16 (+ element number)
+                auto localId = it->getOutput().value();
+                auto qpuLocalId = method.addNewLocal(localId.type, "%local_id_qpu");
+                it->setOutput(qpuLocalId);
+                it.nextInBlock();
+                it.emplace((new Operation(OP_SHL, localId, qpuLocalId,
+                                Value(Literal(COARSENING_SHIFT), TYPE_INT8)))
+                               ->addDecorations(add_flag(InstructionDecorations::BUILTIN_LOCAL_ID,
+                                   InstructionDecorations::UNSIGNED_RESULT)));
+                ++numCoarsened;
+            }
+            else if(mem && mem->op == MemoryOperation::READ && getLaneValue(out, values).kind == LaneKind::VARYING &&
+                gatheredReads.count(mem))
+            {
+                // load every SIMD element from its own address
+                auto addresses = toCoarsenedValue(
+                    module, method, it, mem->getSource(), values, replicatedLocals, coarsenedValues, config);
+                it = periphery::insertGatherFromTMU(
+                    method, it, out->createReference(), addresses, periphery::selectTMU(it));
+                it.erase();
+                coarsenedValues.erase(out);
+                ++numCoarsened;
+                continue;
+            }
+            else if(mem && mem->op == MemoryOperation::READ && getLaneValue(out, values).kind == LaneKind::VARYING)
+            {
+                const auto& address = mem->getSource();
+                it->setArgument(0, Value(address.local(), toVectorPointerType(method, address.type)));
+                it->setOutput(out->createReference());
+                ++numCoarsened;
+            }
+            else if(mem && mem->op == MemoryOperation::WRITE &&
+                getLaneValue(mem->getDestination(), values).kind == LaneKind::STRIDED)
+            {
+                auto address = mem->getDestination();
+                it->setArgument(0,
+                    toCoarsenedValue(
+                        module, method, it, mem->getSource(), values, replicatedLocals, coarsenedValues, config));
+                it->setOutput(Value(address.local(), toVectorPointerType(method, address.type)));
+                ++numCoarsened;
+            }
+            else if(!mem && out && getLaneValue(out, values).kind == LaneKind::VARYING)
+            {
+                for(std::size_t i = 0; i < it->getArguments().size(); ++i)
+                    it->setArgument(i,
+                        toCoarsenedValue(module, method, it, it->assertArgument(i), values, replicatedLocals,
+                            coarsenedValues, config));
+                it->setOutput(out->createReference());
+                ++numCoarsened;
+            }
+            // the values calculated from the previous value of a local are no longer valid
+            if(out)
+                coarsenedValues.erase(out);
+            it.nextInBlock();
+        }
+    }
+
+    method.metaData.workItemsPerQPU = COARSENING_FACTOR;
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_NORMALIZATION + 6, "Work-item coarsened instructions", numCoarsened);
+    return true;
+}
+
+bool normalization::removeWorkGroupSynchronization(const Module& module, Method& method, const Configuration& config)
+{
+    auto numWorkItems = getFixedWorkGroupSize(method.metaData);
+    if(!numWorkItems || *numWorkItems > method.metaData.workItemsPerQPU)
+        return false;
+
+    // the whole work-group is executed by a single QPU, so the semaphore increments and decrements of the work-group
+    // barriers for the other QPUs of the work-group cancel each other out and the QPU never needs to wait. Any other
+    // semaphore access (e.g. explicitly by the kernel code) is kept.
+    std::size_t numRemoved = 0;
+    for(auto& block : method)
+    {
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(it.get<SemaphoreAdjustment>() && it->hasDecoration(InstructionDecorations::WORK_GROUP_BARRIER))
+            {
+                it = it.erase();
+                ++numRemoved;
+            }
+            else
+                it.nextInBlock();
+        }
+    }
+    if(numRemoved > 0)
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Removed " << numRemoved << " semaphore adjustments from kernel '" << method.name
+                << "', since the whole work-group is executed by a single QPU" << logging::endl);
+    return numRemoved > 0;
+}
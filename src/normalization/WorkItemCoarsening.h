@@ -0,0 +1,85 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_NORMALIZATION_WORK_ITEM_COARSENING_H
+#define VC4C_NORMALIZATION_WORK_ITEM_COARSENING_H
+
+namespace vc4c
+{
+    class Method;
+    class Module;
+    struct Configuration;
+
+    namespace normalization
+    {
+        /*
+         * Maps 16 consecutive work-items (in the first dimension) onto the 16 SIMD elements of a single QPU, instead of
+         * executing every work-item on its own QPU, only using the first SIMD element.
+         *
+         * The QPU-local id (as passed by the host) is scaled to the local id of the work-item in the first SIMD element
+         * and all values depending on it are either kept as the value of the first work-item plus a constant stride per
+         * SIMD element (e.g. the global id or addresses indexed by it) or converted to 16-element vectors. Memory
+         * accesses with a stride of the accessed element size are converted to accesses of 16-element vectors.
+         *
+         * Since the host-side work-group size is reduced accordingly (see KernelMetaData#workItemsPerQPU), this is only
+         * applied to kernels with a compile-time work-group size (reqd_work_group_size) which is a multiple of 16 in
+         * the first dimension. Additionally, the kernel code has to fulfill these restrictions:
+         * - no divergent control flow or conditional execution depending on the work-item
+         * - no barriers (unless the whole work-group is executed by a single QPU), atomic operations, stack
+         *   allocations or remaining function calls
+         * - all memory accesses depending on the work-item are consecutive accesses to scalar elements of __global or
+         *   __constant kernel parameters or reads of scalar elements from read-only kernel parameters (gathers), which
+         *   are directly lowered to per-element TMU loads (i.e. no scatters)
+         * - only scalar values depend on the work-item
+         *
+         * Example (for a work-group size of 16):
+         *   %lid = local_ids (unpack 8a)
+         *   %offset = shl %lid, 2
+         *   %addr = add %in, %offset
+         *   %val = load memory at %addr
+         *   %res = fadd %val, %val
+         *
+         * is converted to:
+         *   %local_id_qpu = local_ids (unpack 8a)
+         *   %lid = shl %local_id_qpu, 4
+         *   %offset = shl %lid, 2
+         *   %addr = add %in, %offset
+         *   %val (float16) = load memory at %addr (float16*)
+         *   %res (float16) = fadd %val, %val
+         *
+         * NOTE: This needs to run after the work-item functions are intrinsified, but before the memory access is
+         * lowered. It is only run by the Normalizer if enabled via Configuration#coarsenWorkItems.
+         *
+         * Returns whether the kernel was coarsened
+         */
+        bool coarsenWorkItems(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Removes the semaphore adjustments of the work-group barriers, if the whole work-group is known to be executed
+         * by a single QPU, i.e. the compile-time work-group size is a single work-item or all work-items are mapped to
+         * the SIMD elements of a single QPU (see #coarsenWorkItems()).
+         *
+         * The QPU would only increment and decrement its own semaphores, which never blocks. The memory barriers are
+         * kept, since they still order the memory accesses of the QPU. Only the semaphore adjustments marked as part
+         * of a work-group barrier (see InstructionDecorations#WORK_GROUP_BARRIER) are removed, any other semaphore
+         * access is kept.
+         *
+         * Example (for a work-group size of 1):
+         *   semaphore 0 increment
+         *   semaphore 0 decrement
+         *
+         * is converted to:
+         *   (nothing)
+         *
+         * NOTE: This needs to run after the work-items are coarsened.
+         *
+         * Returns whether any semaphore adjustment was removed
+         */
+        bool removeWorkGroupSynchronization(const Module& module, Method& method, const Configuration& config);
+    } // namespace normalization
+} // namespace vc4c
+
+#endif /* VC4C_NORMALIZATION_WORK_ITEM_COARSENING_H */
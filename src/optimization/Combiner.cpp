@@ -7,14 +7,21 @@
 #include "Combiner.h"
 
 #include "../InstructionWalker.h"
+#include "../Expression.h"
+#include "../Logging.h"
+#include "../Profiler.h"
+#include "../analysis/DependencyGraph.h"
 #include "../analysis/MemoryAnalysis.h"
+#include "../analysis/ValueRange.h"
 #include "../intermediate/Helper.h"
+#include "../intermediate/VectorHelper.h"
 #include "../intermediate/operators.h"
 #include "../periphery/VPM.h"
 #include "Eliminator.h"
-#include "log.h"
 
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <cstdlib>
 #include <memory>
 
@@ -57,7 +64,7 @@ bool optimizations::simplifyBranches(const Module& module, Method& method, const
                 // intermediate::Branch* br = nextIt.get<intermediate::Branch>();
                 if(label != nullptr && label->getLabel() == thisBranch->getTarget())
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Removing branch to next instruction: " << thisBranch->to_string() << logging::endl);
                     it = it.erase();
                     // don't skip next instruction
@@ -90,7 +97,7 @@ bool optimizations::simplifyBranches(const Module& module, Method& method, const
                 // for now, only remove unconditional branches
                 if(!thisBranch->isUnconditional() || !nextBranch->isUnconditional())
                     continue;
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Removing duplicate branch to same target: " << thisBranch->to_string() << logging::endl);
                 it = it.erase();
                 // don't skip next instruction
@@ -448,6 +455,200 @@ static const std::vector<MergeCondition> mergeConditions = {
         return true;
     }};
 
+/*
+ * Checks whether the combination of the two given instructions is valid with regard to the instructions directly
+ * preceding and following the combined instruction (if any)
+ */
+static bool checkSurroundingInstructions(const IntermediateInstruction* previous, const IntermediateInstruction* instr,
+    const IntermediateInstruction* nextInstr, const IntermediateInstruction* following)
+{
+    if(!instr->checkOutputLocal() && !nextInstr->checkOutputLocal())
+        return true;
+    // also check that if the next instruction is a vector rotation, neither of the locals is being rotated there  since
+    // vector rotations can't rotate vectors which have been written in the instruction directly preceding it (true for
+    // both full-vector and per-quad rotations)
+    if(auto rotation = dynamic_cast<const VectorRotation*>(following))
+    {
+        const Value& src = rotation->getSource();
+        if(instr->checkOutputLocal() && instr->getOutput() == src)
+            return false;
+        if(nextInstr->checkOutputLocal() && nextInstr->getOutput() == src)
+            return false;
+    }
+    // the next instruction MUST NOT unpack a value written to in one of the combined instructions equally, neither of
+    // the combined instructions is allowed to pack a value read in the following instructions
+    if(following)
+    {
+        if(following->hasUnpackMode())
+        {
+            if(std::any_of(following->getArguments().begin(), following->getArguments().end(),
+                   [instr, nextInstr](const Value& val) -> bool {
+                       return val.checkLocal() &&
+                           (instr->writesLocal(val.local()) || nextInstr->writesLocal(val.local()));
+                   }))
+                return false;
+        }
+        if(instr->hasPackMode() && instr->checkOutputLocal() && following->readsLocal(instr->getOutput()->local()))
+            return false;
+        if(nextInstr->hasPackMode() && nextInstr->checkOutputLocal() &&
+            following->readsLocal(nextInstr->getOutput()->local()))
+            return false;
+    }
+    // run previous checks also for the previous (before instr) instruction this time with inverted checks (since the
+    // order is inverted)
+    if(previous && previous->checkOutputLocal())
+    {
+        auto previousOutput = previous->getOutput()->local();
+        if(previous->hasPackMode() && (instr->readsLocal(previousOutput) || nextInstr->readsLocal(previousOutput)))
+            return false;
+        if(instr->hasUnpackMode() && instr->readsLocal(previousOutput))
+            return false;
+        if(nextInstr->hasUnpackMode() && nextInstr->readsLocal(previousOutput))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Checks whether the two instructions can be combined into a single instruction, if the second instruction directly
+ * follows the first one and the combined instruction is surrounded by the given instructions
+ */
+static bool canBeCombined(IntermediateInstruction* instr, IntermediateInstruction* nextInstr,
+    const IntermediateInstruction* previous, const IntermediateInstruction* following)
+{
+    //- combine add/mul instructions, where:
+    /*
+     * - combined instructions use at least 2 accumulators, or share getSource()-registers, so that only 2 getSource()
+     * registers are required
+     * - the instructions do not depend one-on-another (e.g. out of first is in of second)
+     * - both instructions write to different locals (or to same local and have inverted conditions)
+     * - MUL instruction does not set flags (otherwise flags would be applied for ADD output)
+     * - only one instruction uses a literal (or the literal is the same)
+     * - both set signals (including immediate ALU operation)
+     * For now, may be removed (with exceptions):
+     * - neither of these instructions read/write from special registers
+     *   otherwise this could cause reading two UNIFORMS at once / writing VPM/VPM_ADDR at once
+     */
+    // TODO a written-to register MUST not be read in the next instruction (check instruction before/after combined)
+    // (unless within local range)
+    auto op = dynamic_cast<Operation*>(instr);
+    auto move = dynamic_cast<MoveOperation*>(instr);
+    auto nextOp = dynamic_cast<Operation*>(nextInstr);
+    auto nextMove = dynamic_cast<MoveOperation*>(nextInstr);
+    if((op == nullptr && move == nullptr) || (nextOp == nullptr && nextMove == nullptr))
+        return false;
+    return std::all_of(mergeConditions.begin(), mergeConditions.end(),
+               [op, nextOp, move, nextMove](const MergeCondition& cond) -> bool {
+                   return cond(op, nextOp, move, nextMove);
+               }) &&
+        checkSurroundingInstructions(previous, instr, nextInstr, following);
+}
+
+/*
+ * Combines the instruction at the given position with the directly following instruction, returns whether the
+ * instructions were combined
+ */
+static bool combineWithNextInstruction(InstructionWalker it)
+{
+    auto nextIt = it.copy().nextInBlock();
+    IntermediateInstruction* instr = it.get();
+    IntermediateInstruction* nextInstr = nextIt.get();
+    Operation* op = it.get<Operation>();
+    MoveOperation* move = it.get<MoveOperation>();
+    Operation* nextOp = nextIt.get<Operation>();
+    MoveOperation* nextMove = nextIt.get<MoveOperation>();
+    // move supports both ADD and MUL ALU
+    // if merge, make "move" to other op-code or x x / v8max x x
+    LOG_LAZY(logging::Level::DEBUG,
+        log << "Merging instructions " << instr->to_string() << " and " << nextInstr->to_string() << logging::endl);
+    if(op != nullptr && nextOp != nullptr)
+    {
+        it.reset(new CombinedOperation(
+            dynamic_cast<Operation*>(it.release()), dynamic_cast<Operation*>(nextIt.release())));
+        nextIt.erase();
+    }
+    else if(op != nullptr && nextMove != nullptr)
+    {
+        Operation* newMove = nextMove->combineWith(op->op);
+        if(newMove != nullptr)
+        {
+            newMove->copyExtrasFrom(nextMove);
+            it.reset(new CombinedOperation(dynamic_cast<Operation*>(it.release()), newMove));
+            nextIt.erase();
+        }
+        else
+            logging::warn() << "Error combining move-operation '" << nextMove->to_string()
+                            << "' with: " << op->to_string() << logging::endl;
+    }
+    else if(move != nullptr && nextOp != nullptr)
+    {
+        Operation* newMove = move->combineWith(nextOp->op);
+        if(newMove != nullptr)
+        {
+            newMove->copyExtrasFrom(move);
+            it.reset(new CombinedOperation(newMove, dynamic_cast<Operation*>(nextIt.release())));
+            nextIt.erase();
+        }
+        else
+            logging::warn() << "Error combining move-operation '" << move->to_string()
+                            << "' with: " << nextOp->to_string() << logging::endl;
+    }
+    else if(move != nullptr && nextMove != nullptr)
+    {
+        bool firstOnMul = (move->hasPackMode() && move->getPackMode().supportsMulALU()) ||
+            (nextMove->hasPackMode() && !nextMove->getPackMode().supportsMulALU()) || nextMove->doesSetFlag();
+        Operation* newMove0 = move->combineWith(firstOnMul ? OP_ADD : OP_MUL24);
+        Operation* newMove1 = nextMove->combineWith(firstOnMul ? OP_MUL24 : OP_ADD);
+        if(newMove0 != nullptr && newMove1 != nullptr)
+        {
+            newMove0->copyExtrasFrom(move);
+            newMove1->copyExtrasFrom(nextMove);
+            it.reset(new CombinedOperation(newMove0, newMove1));
+            nextIt.erase();
+        }
+        else
+            logging::warn() << "Error combining move-operation '" << move->to_string()
+                            << "' with: " << nextMove->to_string() << logging::endl;
+    }
+    else
+        throw CompilationError(CompilationStep::OPTIMIZER, "Unhandled combination, type",
+            (instr->to_string() + ", ") + nextInstr->to_string());
+    CombinedOperation* comb = it.get<CombinedOperation>();
+    if(comb == nullptr)
+        return false;
+    // move instruction usable on both ALUs to the free ALU
+    if(comb->getFirstOp()->op.runsOnAddALU() && comb->getFirstOp()->op.runsOnMulALU())
+    {
+        OpCode code = comb->getFirstOp()->op;
+        if(comb->getSecondOP()->op.runsOnAddALU())
+            code.opAdd = 0;
+        else // by default (e.g. both run on both ALUs), map to ADD ALU
+            code.opMul = 0;
+        dynamic_cast<Operation*>(comb->op1.get())->op = code;
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Fixing operation available on both ALUs to " << (code.opAdd == 0 ? "MUL" : "ADD")
+                << " ALU: " << comb->op1->to_string() << logging::endl);
+    }
+    if(comb->getSecondOP()->op.runsOnAddALU() && comb->getSecondOP()->op.runsOnMulALU())
+    {
+        OpCode code = comb->getSecondOP()->op;
+        if(comb->getFirstOp()->op.runsOnMulALU())
+            code.opMul = 0;
+        else // by default (e.g. both run on both ALUs), map to MUL ALU
+            code.opAdd = 0;
+        dynamic_cast<Operation*>(comb->op2.get())->op = code;
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Fixing operation available on both ALUs to " << (code.opAdd == 0 ? "MUL" : "ADD")
+                << " ALU: " << comb->op2->to_string() << logging::endl);
+    }
+
+    // mark combined instruction as delay, if one of the combined instructions is
+    if(comb->op1->hasDecoration(InstructionDecorations::MANDATORY_DELAY) ||
+        comb->op2->hasDecoration(InstructionDecorations::MANDATORY_DELAY))
+        comb->addDecorations(InstructionDecorations::MANDATORY_DELAY);
+    return true;
+}
+
 bool optimizations::combineOperations(const Module& module, Method& method, const Configuration& config)
 {
     // TODO can combine operation x and y if y is something like (result of x & 0xFF/0xFFFF) -> pack-mode
@@ -468,29 +669,14 @@ bool optimizations::combineOperations(const Module& module, Method& method, cons
             {
                 IntermediateInstruction* instr = it.get();
                 auto nextIt = it.copy().nextInBlock();
-                Operation* nextOp = nextIt.get<Operation>();
-                MoveOperation* nextMove = nextIt.get<MoveOperation>();
-                if(nextOp != nullptr || nextMove != nullptr)
+                if(nextIt.get<Operation>() != nullptr || nextIt.get<MoveOperation>() != nullptr)
                 {
                     IntermediateInstruction* nextInstr = nextIt.get();
-                    //- combine add/mul instructions, where:
-                    /*
-                     * - combined instructions use at least 2 accumulators, or share getSource()-registers, so that only
-                     * 2 getSource() registers are required
-                     * - the instructions do not depend one-on-another (e.g. out of first is in of second)
-                     * - both instructions write to different locals (or to same local and have inverted conditions)
-                     * - MUL instruction does not set flags (otherwise flags would be applied for ADD output)
-                     * - only one instruction uses a literal (or the literal is the same)
-                     * - both set signals (including immediate ALU operation)
-                     * For now, may be removed (with exceptions):
-                     * - neither of these instructions read/write from special registers
-                     *   otherwise this could cause reading two UNIFORMS at once / writing VPM/VPM_ADDR at once
-                     */
-                    // TODO a written-to register MUST not be read in the next instruction (check instruction
-                    // before/after combined) (unless within local range)
-                    bool conditionsMet = std::all_of(mergeConditions.begin(), mergeConditions.end(),
-                        [op, nextOp, move, nextMove](
-                            const MergeCondition& cond) -> bool { return cond(op, nextOp, move, nextMove); });
+                    auto prevIt = it.copy().previousInBlock();
+                    auto followingIt = nextIt.copy().nextInBlock();
+                    bool conditionsMet = canBeCombined(instr, nextInstr,
+                        prevIt.isStartOfBlock() ? nullptr : prevIt.get(),
+                        followingIt.isEndOfBlock() ? nullptr : followingIt.get());
                     if(instr->checkOutputLocal() && nextInstr->checkOutputLocal())
                     {
                         // extra check, only combine writes to the same local, if local is only used within the next
@@ -501,157 +687,9 @@ bool optimizations::combineOperations(const Module& module, Method& method, cons
                                 nextIt, instr->getOutput()->local(), config.additionalOptions.accumulatorThreshold))
                             conditionsMet = false;
                     }
-                    if(instr->checkOutputLocal() || nextInstr->checkOutputLocal())
-                    {
-                        // also check that if the next instruction is a vector rotation, neither of the locals is being
-                        // rotated there  since vector rotations can't rotate vectors which have been written in the
-                        // instruction directly preceding it (true for both full-vector and per-quad rotations)
-                        auto checkIt = nextIt.copy().nextInBlock();
-                        if(!checkIt.isEndOfBlock() && checkIt.get<VectorRotation>())
-                        {
-                            const Value& src = checkIt.get<VectorRotation>()->getSource();
-                            if(instr->checkOutputLocal() && instr->getOutput() == src)
-                                conditionsMet = false;
-                            if(nextInstr->checkOutputLocal() && nextInstr->getOutput() == src)
-                                conditionsMet = false;
-                        }
-                        // the next instruction MUST NOT unpack a value written to in one of the combined instructions
-                        // equally, neither of the combined instructions is allowed to pack a value read in the
-                        // following instructions
-                        if(!checkIt.isEndOfBlock())
-                        {
-                            if(checkIt->hasUnpackMode())
-                            {
-                                if(std::any_of(checkIt->getArguments().begin(), checkIt->getArguments().end(),
-                                       [instr, nextInstr](const Value& val) -> bool {
-                                           return val.checkLocal() &&
-                                               (instr->writesLocal(val.local()) || nextInstr->writesLocal(val.local()));
-                                       }))
-                                {
-                                    conditionsMet = false;
-                                }
-                            }
-                            if(instr->hasPackMode() && instr->checkOutputLocal() &&
-                                checkIt->readsLocal(instr->getOutput()->local()))
-                                conditionsMet = false;
-                            if(nextInstr->hasPackMode() && nextInstr->checkOutputLocal() &&
-                                checkIt->readsLocal(nextInstr->getOutput()->local()))
-                                conditionsMet = false;
-                        }
-                        // run previous checks also for the previous (before instr) instruction
-                        // this time with inverted checks (since the order is inverted)
-                        checkIt = it.copy().previousInBlock();
-                        if(!checkIt.isStartOfBlock() && checkIt->checkOutputLocal())
-                        {
-                            if(checkIt->hasPackMode() &&
-                                (instr->readsLocal(checkIt->getOutput()->local()) ||
-                                    nextInstr->readsLocal(checkIt->getOutput()->local())))
-                                conditionsMet = false;
-                            if(instr->hasUnpackMode() && instr->readsLocal(checkIt->getOutput()->local()))
-                                conditionsMet = false;
-                            if(nextInstr->hasUnpackMode() && nextInstr->readsLocal(checkIt->getOutput()->local()))
-                                conditionsMet = false;
-                        }
-                    }
 
-                    if(conditionsMet)
-                    {
+                    if(conditionsMet && combineWithNextInstruction(it))
                         hasChanged = true;
-                        // move supports both ADD and MUL ALU
-                        // if merge, make "move" to other op-code or x x / v8max x x
-                        CPPLOG_LAZY(logging::Level::DEBUG,
-                            log << "Merging instructions " << instr->to_string() << " and " << nextInstr->to_string()
-                                << logging::endl);
-                        if(op != nullptr && nextOp != nullptr)
-                        {
-                            it.reset(new CombinedOperation(
-                                dynamic_cast<Operation*>(it.release()), dynamic_cast<Operation*>(nextIt.release())));
-                            nextIt.erase();
-                        }
-                        else if(op != nullptr && nextMove != nullptr)
-                        {
-                            Operation* newMove = nextMove->combineWith(op->op);
-                            if(newMove != nullptr)
-                            {
-                                newMove->copyExtrasFrom(nextMove);
-                                it.reset(new CombinedOperation(dynamic_cast<Operation*>(it.release()), newMove));
-                                nextIt.erase();
-                            }
-                            else
-                                logging::warn() << "Error combining move-operation '" << nextMove->to_string()
-                                                << "' with: " << op->to_string() << logging::endl;
-                        }
-                        else if(move != nullptr && nextOp != nullptr)
-                        {
-                            Operation* newMove = move->combineWith(nextOp->op);
-                            if(newMove != nullptr)
-                            {
-                                newMove->copyExtrasFrom(move);
-                                it.reset(new CombinedOperation(newMove, dynamic_cast<Operation*>(nextIt.release())));
-                                nextIt.erase();
-                            }
-                            else
-                                logging::warn() << "Error combining move-operation '" << move->to_string()
-                                                << "' with: " << nextOp->to_string() << logging::endl;
-                        }
-                        else if(move != nullptr && nextMove != nullptr)
-                        {
-                            bool firstOnMul = (move->hasPackMode() && move->getPackMode().supportsMulALU()) ||
-                                (nextMove->hasPackMode() && !nextMove->getPackMode().supportsMulALU()) ||
-                                nextMove->doesSetFlag();
-                            Operation* newMove0 = move->combineWith(firstOnMul ? OP_ADD : OP_MUL24);
-                            Operation* newMove1 = nextMove->combineWith(firstOnMul ? OP_MUL24 : OP_ADD);
-                            if(newMove0 != nullptr && newMove1 != nullptr)
-                            {
-                                newMove0->copyExtrasFrom(move);
-                                newMove1->copyExtrasFrom(nextMove);
-                                it.reset(new CombinedOperation(newMove0, newMove1));
-                                nextIt.erase();
-                            }
-                            else
-                                logging::warn() << "Error combining move-operation '" << move->to_string()
-                                                << "' with: " << nextMove->to_string() << logging::endl;
-                        }
-                        else
-                            throw CompilationError(CompilationStep::OPTIMIZER, "Unhandled combination, type",
-                                (instr->to_string() + ", ") + nextInstr->to_string());
-                        if(it.get<CombinedOperation>() != nullptr)
-                        {
-                            // move instruction usable on both ALUs to the free ALU
-                            CombinedOperation* comb = it.get<CombinedOperation>();
-                            if(comb->getFirstOp()->op.runsOnAddALU() && comb->getFirstOp()->op.runsOnMulALU())
-                            {
-                                OpCode code = comb->getFirstOp()->op;
-                                if(comb->getSecondOP()->op.runsOnAddALU())
-                                    code.opAdd = 0;
-                                else // by default (e.g. both run on both ALUs), map to ADD ALU
-                                    code.opMul = 0;
-                                dynamic_cast<Operation*>(comb->op1.get())->op = code;
-                                CPPLOG_LAZY(logging::Level::DEBUG,
-                                    log << "Fixing operation available on both ALUs to "
-                                        << (code.opAdd == 0 ? "MUL" : "ADD") << " ALU: " << comb->op1->to_string()
-                                        << logging::endl);
-                            }
-                            if(comb->getSecondOP()->op.runsOnAddALU() && comb->getSecondOP()->op.runsOnMulALU())
-                            {
-                                OpCode code = comb->getSecondOP()->op;
-                                if(comb->getFirstOp()->op.runsOnMulALU())
-                                    code.opMul = 0;
-                                else // by default (e.g. both run on both ALUs), map to MUL ALU
-                                    code.opAdd = 0;
-                                dynamic_cast<Operation*>(comb->op2.get())->op = code;
-                                CPPLOG_LAZY(logging::Level::DEBUG,
-                                    log << "Fixing operation available on both ALUs to "
-                                        << (code.opAdd == 0 ? "MUL" : "ADD") << " ALU: " << comb->op2->to_string()
-                                        << logging::endl);
-                            }
-
-                            // mark combined instruction as delay, if one of the combined instructions is
-                            if(comb->op1->hasDecoration(InstructionDecorations::MANDATORY_DELAY) ||
-                                comb->op2->hasDecoration(InstructionDecorations::MANDATORY_DELAY))
-                                comb->addDecorations(InstructionDecorations::MANDATORY_DELAY);
-                        }
-                    }
                 }
             }
             it.nextInBlock();
@@ -661,6 +699,226 @@ bool optimizations::combineOperations(const Module& module, Method& method, cons
     return hasChanged;
 }
 
+// The maximum number of instructions an instruction is moved up to be paired with another instruction
+static constexpr std::size_t MAX_PAIRING_DISTANCE = 8;
+
+enum class PairableALU : unsigned char
+{
+    ADD,
+    MUL,
+    BOTH
+};
+
+static Optional<PairableALU> getPairableALU(const IntermediateInstruction* inst)
+{
+    if(!inst || !inst->mapsToASMInstruction() || inst->hasDecoration(InstructionDecorations::MANDATORY_DELAY) ||
+        dynamic_cast<const VectorRotation*>(inst))
+        return {};
+    if(dynamic_cast<const MoveOperation*>(inst))
+        return PairableALU::BOTH;
+    if(auto op = dynamic_cast<const Operation*>(inst))
+    {
+        if(op->op.runsOnAddALU() && op->op.runsOnMulALU())
+            return PairableALU::BOTH;
+        return op->op.runsOnAddALU() ? PairableALU::ADD : PairableALU::MUL;
+    }
+    return {};
+}
+
+/*
+ * Checks whether the instruction at the given later position can be moved directly behind the instruction at the given
+ * earlier position and be combined with it
+ */
+static bool canBePaired(const FastAccessList<IntermediateInstruction*>& instructions,
+    const FastMap<const IntermediateInstruction*, std::size_t>& positions, analysis::DependencyGraph& graph,
+    std::size_t first, std::size_t second)
+{
+    auto instr = instructions[first];
+    auto nextInstr = instructions[second];
+    // writes to the same output (with inverted conditions) are already combined if adjacent
+    if(instr->getOutput() && nextInstr->getOutput() &&
+        (*instr->getOutput() == *nextInstr->getOutput() ||
+            (instr->checkOutputLocal() && nextInstr->getOutput()->checkLocal() == instr->getOutput()->local())))
+        return false;
+    for(auto i = first + 1; i < second; ++i)
+    {
+        // do not move across instructions which are required for timing
+        if(!instructions[i] || dynamic_cast<const Nop*>(instructions[i]) ||
+            instructions[i]->hasDecoration(InstructionDecorations::MANDATORY_DELAY))
+            return false;
+    }
+    bool dependenciesMet = true;
+    graph.assertNode(nextInstr).forAllIncomingEdges(
+        [&](const analysis::DependencyNode& predecessor, const analysis::DependencyEdge& edge) -> bool {
+            auto pos = positions.at(predecessor.key);
+            // moving the instruction up shortens the delay to all instructions it depends on
+            if((edge.data.numDelayCycles > 0 && edge.data.isMandatoryDelay) || pos > first ||
+                (pos == first && edge.data.numDelayCycles > 0))
+                dependenciesMet = false;
+            return dependenciesMet;
+        });
+    if(!dependenciesMet)
+        return false;
+    auto previous = first > 0 ? instructions[first - 1] : nullptr;
+    auto following = first + 1 < second ? instructions[first + 1] :
+                                          (second + 1 < instructions.size() ? instructions[second + 1] : nullptr);
+    return canBeCombined(instr, nextInstr, previous, following);
+}
+
+/*
+ * Tries to find an augmenting path for the given left-side instruction (Kuhn's algorithm) and updates the matching
+ */
+static bool findAugmentingPath(std::size_t left, const FastMap<std::size_t, FastAccessList<std::size_t>>& candidates,
+    FastMap<std::size_t, std::size_t>& matches, FastSet<std::size_t>& visited)
+{
+    auto it = candidates.find(left);
+    if(it == candidates.end())
+        return false;
+    for(auto right : it->second)
+    {
+        if(!visited.emplace(right).second)
+            continue;
+        auto matchIt = matches.find(right);
+        if(matchIt == matches.end() || findAugmentingPath(matchIt->second, candidates, matches, visited))
+        {
+            matches[right] = left;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Calculates a maximum matching between the unpaired instructions of the two given kinds and adds the matched pairs
+ */
+static void matchInstructions(const FastAccessList<Optional<PairableALU>>& kinds, PairableALU leftKind,
+    PairableALU rightKind, const std::function<bool(std::size_t, std::size_t)>& isCompatible,
+    FastMap<std::size_t, std::size_t>& pairs)
+{
+    FastMap<std::size_t, FastAccessList<std::size_t>> candidates;
+    for(std::size_t left = 0; left < kinds.size(); ++left)
+    {
+        if(kinds[left] != leftKind || pairs.find(left) != pairs.end())
+            continue;
+        auto start = left > MAX_PAIRING_DISTANCE ? left - MAX_PAIRING_DISTANCE : 0;
+        auto end = std::min(kinds.size(), left + MAX_PAIRING_DISTANCE + 1);
+        for(auto right = start; right < end; ++right)
+        {
+            if(right != left && kinds[right] == rightKind && pairs.find(right) == pairs.end() &&
+                isCompatible(std::min(left, right), std::max(left, right)))
+                candidates[left].emplace_back(right);
+        }
+    }
+
+    FastMap<std::size_t, std::size_t> matches;
+    for(const auto& entry : candidates)
+    {
+        FastSet<std::size_t> visited;
+        findAugmentingPath(entry.first, candidates, matches, visited);
+    }
+    for(const auto& match : matches)
+    {
+        pairs[match.first] = match.second;
+        pairs[match.second] = match.first;
+    }
+}
+
+bool optimizations::pairALUOperations(const Module& module, Method& method, const Configuration& config)
+{
+    bool hasChanged = false;
+    for(BasicBlock& bb : method)
+    {
+        FastAccessList<InstructionWalker> walkers;
+        FastAccessList<IntermediateInstruction*> instructions;
+        FastAccessList<Optional<PairableALU>> kinds;
+        FastMap<const IntermediateInstruction*, std::size_t> positions;
+        auto it = bb.walk().nextInBlock();
+        while(!it.isEndOfBlock())
+        {
+            if(it.has())
+            {
+                positions.emplace(it.get(), instructions.size());
+                walkers.emplace_back(it);
+                instructions.emplace_back(it.get());
+                kinds.emplace_back(getPairableALU(it.get()));
+            }
+            it.nextInBlock();
+        }
+        if(std::count_if(kinds.begin(), kinds.end(), [](const Optional<PairableALU>& kind) -> bool {
+               return kind.has_value();
+           }) < 2)
+            continue;
+
+        auto graph = analysis::DependencyGraph::createGraph(bb);
+        FastMap<std::size_t, bool> compatibilityCache;
+        auto isCompatible = [&](std::size_t first, std::size_t second) -> bool {
+            auto key = first * instructions.size() + second;
+            auto cacheIt = compatibilityCache.find(key);
+            if(cacheIt != compatibilityCache.end())
+                return cacheIt->second;
+            auto result = canBePaired(instructions, positions, *graph, first, second);
+            compatibilityCache.emplace(key, result);
+            return result;
+        };
+
+        // The instructions only executable on one of the ALUs are the most restricted ones, so they are matched first
+        // with the instructions executable on the other (or both) ALU(s). The remaining instructions executable on both
+        // ALUs are then paired greedily among each other.
+        FastMap<std::size_t, std::size_t> pairs;
+        matchInstructions(kinds, PairableALU::ADD, PairableALU::MUL, isCompatible, pairs);
+        matchInstructions(kinds, PairableALU::ADD, PairableALU::BOTH, isCompatible, pairs);
+        matchInstructions(kinds, PairableALU::MUL, PairableALU::BOTH, isCompatible, pairs);
+        for(std::size_t first = 0; first < kinds.size(); ++first)
+        {
+            if(kinds[first] != PairableALU::BOTH || pairs.find(first) != pairs.end())
+                continue;
+            for(auto second = first + 1; second < std::min(kinds.size(), first + MAX_PAIRING_DISTANCE + 1); ++second)
+            {
+                if(kinds[second] == PairableALU::BOTH && pairs.find(second) == pairs.end() &&
+                    isCompatible(first, second))
+                {
+                    pairs[first] = second;
+                    pairs[second] = first;
+                    break;
+                }
+            }
+        }
+        // the dependency graph references the instructions which are replaced by the combination
+        graph.reset();
+
+        // Since an instruction is only moved up behind its partner if it does not depend on any instruction in
+        // between, all pairs can be combined independent of each other.
+        for(std::size_t first = 0; first < instructions.size(); ++first)
+        {
+            auto pairIt = pairs.find(first);
+            if(pairIt == pairs.end() || pairIt->second < first)
+                continue;
+            auto firstIt = walkers[first];
+            auto secondIt = walkers[pairIt->second];
+            // re-check the combination with the actual surrounding instructions, which might have been changed by the
+            // previous combinations
+            auto previousIt = firstIt.copy().previousInBlock();
+            auto followingIt = firstIt.copy().nextInBlock();
+            if(followingIt.get() == secondIt.get())
+                followingIt.nextInBlock();
+            if(!canBeCombined(firstIt.get(), secondIt.get(), previousIt.isStartOfBlock() ? nullptr : previousIt.get(),
+                   followingIt.isEndOfBlock() ? nullptr : followingIt.get()))
+                continue;
+            if(firstIt.copy().nextInBlock().get() != secondIt.get())
+            {
+                LOG_LAZY(logging::Level::DEBUG,
+                    log << "Moving instruction '" << secondIt->to_string() << "' up to be combined with: "
+                        << firstIt->to_string() << logging::endl);
+                firstIt.copy().nextInBlock().emplace(secondIt.release());
+                secondIt.erase();
+            }
+            if(combineWithNextInstruction(firstIt))
+                hasChanged = true;
+        }
+    }
+    return hasChanged;
+}
+
 static Optional<Literal> getSourceLiteral(InstructionWalker it)
 {
     if(it.get<LoadImmediate>() && it.get<LoadImmediate>()->type == LoadType::REPLICATE_INT32)
@@ -731,7 +989,7 @@ bool optimizations::combineLoadingConstants(const Module& module, Method& method
                     {
                         Local* oldLocal = it->getOutput()->local();
                         Local* newLocal = immIt->second->getOutput()->local();
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Removing duplicate loading of literal: " << it->to_string() << logging::endl);
                         // Local#forUsers can't be used here, since we modify the list of users via
                         // LocalUser#replaceLocal
@@ -753,7 +1011,7 @@ bool optimizations::combineLoadingConstants(const Module& module, Method& method
                     {
                         Local* oldLocal = it->getOutput()->local();
                         Local* newLocal = regIt->second->getOutput()->local();
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Removing duplicate loading of register: " << it->to_string() << logging::endl);
                         // Local#forUsers can't be used here, since we modify the list of users via
                         // LocalUser#replaceLocal
@@ -818,7 +1076,7 @@ InstructionWalker optimizations::combineSelectionWithZero(
     // additionally, one of the moves writes a zero-vale
     if(move->getSource().hasLiteral(0_lit) && !nextMove->getSource().hasLiteral(0_lit))
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Rewriting selection of either zero or " << nextMove->getSource().to_string()
                 << " using only one input" << logging::endl);
         it.reset((new Operation(OP_XOR, move->getOutput().value(), nextMove->getSource(), nextMove->getSource()))
@@ -828,7 +1086,7 @@ InstructionWalker optimizations::combineSelectionWithZero(
     }
     else if(nextMove->getSource().hasLiteral(0_lit))
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Rewriting selection of either " << move->getSource().to_string() << " or zero using only one input"
                 << logging::endl);
         nextIt.reset((new Operation(OP_XOR, nextMove->getOutput().value(), move->getSource(), move->getSource()))
@@ -867,7 +1125,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                     {
                         // NOTE: offset of 16 can occur for downwards rotations a << (16 - x) when the actual
                         // rotation x is zero.
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Replacing vector rotation by offset of zero with move: " << it->to_string()
                                 << logging::endl);
                         it.reset((new MoveOperation(rot->getOutput().value(), rot->getSource()))->copyExtrasFrom(rot));
@@ -877,7 +1135,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                     else if(staticOffset->getLiteralValue() &&
                         staticOffset->getLiteralValue()->unsignedInt() < NATIVE_VECTOR_SIZE)
                     {
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Rewriting vector rotation to use constant offset: " << it->to_string()
                                 << logging::endl);
                         rot->replaceValue(ROTATION_REGISTER,
@@ -899,7 +1157,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                     // we rotate the result of a load -> rewrite to rotate the load instead.
                     if(writer->type == LoadType::REPLICATE_INT32)
                     {
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Replacing rotation of constant load with constant load: " << rot->to_string()
                                 << logging::endl);
                         it.reset((new LoadImmediate(it->getOutput().value(), writer->getImmediate()))
@@ -914,7 +1172,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                         auto offset = rot->getOffset().getRotationOffset();
                         auto upper = rotate_left_halfword(lit >> 16, *offset) << 16;
                         auto lower = rotate_left_halfword(lit & 0xFFFF, *offset);
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Replacing rotation of masked load with rotated masked load: " << rot->to_string()
                                 << logging::endl);
                         it.reset((new LoadImmediate(it->getOutput().value(), upper | lower, writer->type))
@@ -932,7 +1190,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                 {
                     // we don't directly take the literal source, so that the writing move can apply its pack mode (and
                     // this instruction can apply its unpack mode)
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Replacing rotation of constant operation with move: " << rot->to_string()
                             << logging::endl);
                     it.reset(
@@ -969,7 +1227,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                                     (!rot->isFullRotationAllowed() ? 4 : 16);
                                 if(offset == 0)
                                 {
-                                    CPPLOG_LAZY(logging::Level::DEBUG,
+                                    LOG_LAZY(logging::Level::DEBUG,
                                         log << "Replacing unnecessary vector rotations " << firstRot->to_string()
                                             << " and " << rot->to_string() << " with single move" << logging::endl);
                                     it.reset((new MoveOperation(rot->getOutput().value(), firstRot->getSource()))
@@ -983,7 +1241,7 @@ bool optimizations::combineVectorRotations(const Module& module, Method& method,
                                 }
                                 else
                                 {
-                                    CPPLOG_LAZY(logging::Level::DEBUG,
+                                    LOG_LAZY(logging::Level::DEBUG,
                                         log << "Combining vector rotations " << firstRot->to_string() << " and "
                                             << rot->to_string() << " to a single rotation with offset "
                                             << static_cast<unsigned>(offset) << logging::endl);
@@ -1077,14 +1335,14 @@ InstructionWalker optimizations::combineArithmeticOperations(
     Optional<Value> precalc = NO_VALUE;
     if(op->op.isAssociative())
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Combining associative operations " << singleWriter->to_string() << " and " << it->to_string()
                 << logging::endl);
         precalc = op->op(literalArg, otherLiteralArg).first;
     }
     else if(op->op == OP_SHL || op->op == OP_SHR || op->op == OP_ASR || op->op == OP_ROR)
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Combining shifts " << singleWriter->to_string() << " and " << it->to_string() << logging::endl);
         precalc = OP_ADD(literalArg, otherLiteralArg).first;
     }
@@ -1100,6 +1358,997 @@ InstructionWalker optimizations::combineArithmeticOperations(
     return it;
 }
 
+/*
+ * Returns the unconditional operation writing the given local, if the local is only read by a single instruction and
+ * the operation can therefore be removed after its result is no longer read.
+ */
+static const Operation* getSingleUseWriter(const Value& val)
+{
+    auto loc = val.checkLocal();
+    if(!loc || loc->getUsers(LocalUse::Type::READER).size() != 1)
+        return nullptr;
+    auto writer = dynamic_cast<const Operation*>(loc->getSingleWriter());
+    if(!writer || writer->hasConditionalExecution() || !writer->isSimpleOperation())
+        return nullptr;
+    return writer;
+}
+
+/*
+ * Returns whether the given value is the same at all instructions reading it, so it can be read at a different
+ * position and a different number of times than in the original code.
+ */
+static bool isStableValue(const Value& val)
+{
+    if(val.getLiteralValue() || val.checkImmediate())
+        return true;
+    auto loc = val.checkLocal();
+    return loc && loc->getUsers(LocalUse::Type::WRITER).size() <= 1;
+}
+
+static bool isLiteral(const Value& val, uint32_t literal)
+{
+    auto lit = val.getConstantValue() & &Value::getLiteralValue;
+    return lit && lit->unsignedInt() == literal;
+}
+
+/*
+ * Returns the source and the offset to rotate right by, if the given shifts of the same value by complementary offsets
+ * are a rotation.
+ */
+static Optional<std::pair<Value, Value>> getRotation(const Operation* shl, const Operation* shr)
+{
+    if(shl->op != OP_SHL || shr->op != OP_SHR || shl->getFirstArg() != shr->getFirstArg())
+        return {};
+    const auto& shlOffset = shl->assertArgument(1);
+    const auto& shrOffset = shr->assertArgument(1);
+    auto shlLiteral = shlOffset.getConstantValue() & &Value::getLiteralValue;
+    auto shrLiteral = shrOffset.getConstantValue() & &Value::getLiteralValue;
+    if(shlLiteral && shrLiteral && shlLiteral->unsignedInt() + shrLiteral->unsignedInt() == 32)
+        // x << n | x >> (32 - n)
+        return std::make_pair(shl->getFirstArg(), Value(Literal(shrLiteral->unsignedInt()), TYPE_INT8));
+    auto isComplement = [](const Value& offset, const Value& otherOffset) -> bool {
+        // the offset is calculated as 32 - otherOffset
+        auto writer = dynamic_cast<const Operation*>(offset.getSingleWriter());
+        return writer && writer->op == OP_SUB && !writer->hasConditionalExecution() &&
+            isLiteral(writer->getFirstArg(), 32) && writer->assertArgument(1) == otherOffset;
+    };
+    if(isStableValue(shrOffset) && (isComplement(shrOffset, shlOffset) || isComplement(shlOffset, shrOffset)))
+        // x << n | x >> (32 - n) or x << (32 - n) | x >> n
+        return std::make_pair(shl->getFirstArg(), shrOffset);
+    return {};
+}
+
+/*
+ * Returns the value inverted by the given operation (via not or xor with all bits set), if any
+ */
+static Optional<Value> getInvertedValue(const Value& val)
+{
+    auto writer = getSingleUseWriter(val);
+    if(!writer)
+        return {};
+    if(writer->op == OP_NOT)
+        return writer->getFirstArg();
+    if(writer->op == OP_XOR && isLiteral(writer->assertArgument(1), 0xFFFFFFFF))
+        return writer->getFirstArg();
+    if(writer->op == OP_XOR && isLiteral(writer->getFirstArg(), 0xFFFFFFFF))
+        return writer->assertArgument(1);
+    return {};
+}
+
+/*
+ * Returns the values a, b and c, if the given AND operations calculate (a & ~c) and (b & c) (in any order)
+ */
+static Optional<std::array<Value, 3>> getBitSelection(const Operation* first, const Operation* second)
+{
+    if(first->op != OP_AND || second->op != OP_AND)
+        return {};
+    for(auto masked : {first, second})
+    {
+        auto other = masked == first ? second : first;
+        for(std::size_t maskIndex = 0; maskIndex < 2; ++maskIndex)
+        {
+            auto mask = getInvertedValue(masked->assertArgument(maskIndex));
+            if(!mask)
+                continue;
+            for(std::size_t otherIndex = 0; otherIndex < 2; ++otherIndex)
+            {
+                if(other->assertArgument(otherIndex) == *mask)
+                    return std::array<Value, 3>{
+                        masked->assertArgument(1 - maskIndex), other->assertArgument(1 - otherIndex), *mask};
+            }
+        }
+    }
+    return {};
+}
+
+InstructionWalker optimizations::combineBitwiseOperations(
+    const Module& module, Method& method, InstructionWalker it, const Configuration& config)
+{
+    auto op = it.get<Operation>();
+    if(!op || (op->op != OP_OR && op->op != OP_XOR) || !op->isSimpleOperation() || op->hasConditionalExecution() ||
+        op->getArguments().size() != 2 || !op->getOutput())
+        return it;
+    if(op->getOutput()->type.getScalarBitCount() != 32)
+        // rotations and bit-selections of smaller types would need to handle the unused upper bits
+        return it;
+    auto firstWriter = getSingleUseWriter(op->getFirstArg());
+    auto secondWriter = getSingleUseWriter(op->assertArgument(1));
+    if(!firstWriter || !secondWriter || firstWriter == secondWriter)
+        return it;
+
+    // the shifted bits do not overlap, so the rotation can be combined with both OR and XOR
+    auto rotation = getRotation(firstWriter, secondWriter);
+    if(!rotation)
+        rotation = getRotation(secondWriter, firstWriter);
+    if(rotation && isStableValue(rotation->first))
+    {
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Replacing shifts " << firstWriter->to_string() << " and " << secondWriter->to_string()
+                << " with rotation" << logging::endl);
+        it.reset((new Operation(OP_ROR, op->getOutput().value(), rotation->first, rotation->second))
+                     ->copyExtrasFrom(op));
+        return it;
+    }
+
+    // the masked bits do not overlap, so the bit-selection can be combined with both OR and XOR
+    auto selection = getBitSelection(firstWriter, secondWriter);
+    if(selection && std::all_of(selection->begin(), selection->end(), isStableValue))
+    {
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Replacing bit-selection " << firstWriter->to_string() << " and " << secondWriter->to_string()
+                << " with shorter version" << logging::endl);
+        const auto& a = (*selection)[0];
+        const auto& b = (*selection)[1];
+        const auto& c = (*selection)[2];
+        auto out = op->getOutput().value();
+        // a ^ ((a ^ b) & c)
+        auto tmp = assign(it, out.type, "%bitselect") = (a ^ b, op->decoration);
+        tmp = assign(it, out.type, "%bitselect") = (tmp & c, op->decoration);
+        it.reset((new Operation(OP_XOR, out, a, tmp))->copyExtrasFrom(op));
+    }
+    return it;
+}
+
+/*
+ * Returns whether the given instruction is a conversion from or to half-precision floating-point values as generated by
+ * intermediate::insertFloatingPointConversion(), i.e. a multiplication with 1.0 with the un-/pack mode converting the
+ * values.
+ */
+static bool isHalfConversion(const Operation* op, bool toFloat)
+{
+    if(!op || op->op != OP_FMUL || op->hasConditionalExecution() || op->doesSetFlag() || op->hasSideEffects() ||
+        !op->checkOutputLocal() || !op->getFirstArg().checkLocal())
+        return false;
+    auto identity = op->assertArgument(1).getConstantValue() & &Value::getLiteralValue;
+    if(!identity || identity->real() != 1.0f)
+        return false;
+    if(toFloat)
+        return op->getUnpackMode() == UNPACK_HALF_TO_FLOAT && !op->hasPackMode();
+    return op->getPackMode() == PACK_FLOAT_TO_HALF_TRUNCATE && !op->hasUnpackMode();
+}
+
+/*
+ * Returns whether the given half-precision value can be unpacked by the given instruction instead of the separate
+ * conversion instruction
+ */
+static bool canUnpackHalfInput(const LocalUser* reader, const Local* converted)
+{
+    auto op = dynamic_cast<const Operation*>(reader);
+    // the unpack mode only converts half to float for floating-point operations
+    if(!op || !op->op.acceptsFloat || op->hasUnpackMode() || dynamic_cast<const VectorRotation*>(reader))
+        return false;
+    // all other inputs would also be unpacked if read from physical register file A, so the register allocation does
+    // not allow any other local input
+    return std::all_of(op->getArguments().begin(), op->getArguments().end(),
+        [&](const Value& arg) -> bool { return arg.hasLocal(converted) || arg.checkImmediate(); });
+}
+
+InstructionWalker optimizations::combineHalfConversions(
+    const Module& module, Method& method, InstructionWalker it, const Configuration& config)
+{
+    auto op = it.get<Operation>();
+    if(isHalfConversion(op, true))
+    {
+        // %f = fmul %h, 1.0 (unpack 16a) + %g = fadd %f, %f -> %g = fadd %h, %h (unpack 16a)
+        auto converted = op->getOutput()->local();
+        auto half = op->getFirstArg();
+        auto readers = converted->getUsers(LocalUse::Type::READER);
+        if(readers.empty() ||
+            !std::all_of(readers.begin(), readers.end(),
+                [&](const LocalUser* reader) -> bool { return canUnpackHalfInput(reader, converted); }))
+            return it;
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Combining half-precision conversion into its " << readers.size()
+                << " readers: " << op->to_string() << logging::endl);
+        for(const LocalUser* reader : readers)
+        {
+            auto user = const_cast<Operation*>(dynamic_cast<const Operation*>(reader));
+            user->replaceLocal(converted, half, LocalUse::Type::READER);
+            user->setUnpackMode(UNPACK_HALF_TO_FLOAT);
+        }
+        return it.erase();
+    }
+    if(isHalfConversion(op, false))
+    {
+        // %f = fadd %a, %b + %h = fmul %f, 1.0 (pack 16a) -> %h = fadd %a, %b (pack 16a)
+        auto converted = op->getFirstArg().local();
+        auto half = op->getOutput()->local();
+        auto writer = dynamic_cast<const Operation*>(converted->getSingleWriter());
+        if(converted->getUsers(LocalUse::Type::READER).size() != 1 || !writer || !writer->op.returnsFloat ||
+            writer->hasPackMode() || writer->hasConditionalExecution() ||
+            half->getUsers(LocalUse::Type::WRITER).size() != 1)
+            return it;
+        auto writerIt = it.getBasicBlock()->findWalkerForInstruction(writer, it);
+        if(!writerIt)
+            return it;
+        // the half-precision value must not be read between the original calculation and the conversion
+        for(auto checkIt = writerIt->copy().nextInBlock(); checkIt != it; checkIt.nextInBlock())
+        {
+            if(checkIt.has() && checkIt->readsLocal(half))
+                return it;
+        }
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Combining half-precision conversion into the calculation of its input: " << op->to_string()
+                << logging::endl);
+        (*writerIt)->setOutput(op->getOutput());
+        writerIt->get<Operation>()->setPackMode(PACK_FLOAT_TO_HALF_TRUNCATE);
+        return it.erase();
+    }
+    if(op && op->op == OP_AND && op->isSimpleOperation() && !op->hasConditionalExecution() && op->checkOutputLocal())
+    {
+        // %h = and %x, 0xFFFF + %g = fadd %h, %h (unpack 16a) -> %g = fadd %x, %x (unpack 16a)
+        // the unpack mode only reads the lower half-word anyway
+        auto mask = op->assertArgument(1).getConstantValue() & &Value::getLiteralValue;
+        auto source = op->getFirstArg().checkLocal();
+        auto masked = op->getOutput()->local();
+        auto readers = masked->getUsers(LocalUse::Type::READER);
+        if(!mask || mask->unsignedInt() != TYPE_HALF.getScalarWidthMask() || !source || readers.empty() ||
+            !std::all_of(readers.begin(), readers.end(), [](const LocalUser* reader) -> bool {
+                auto unpacking = dynamic_cast<const UnpackingInstruction*>(reader);
+                return unpacking && unpacking->getUnpackMode() == UNPACK_16A_32;
+            }))
+            return it;
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Removing masking of lower half-word only read via unpack mode: " << op->to_string()
+                << logging::endl);
+        for(const LocalUser* reader : readers)
+            const_cast<LocalUser*>(reader)->replaceLocal(masked, source, LocalUse::Type::READER);
+        return it.erase();
+    }
+    return it;
+}
+
+/*
+ * Returns whether the given local is written anywhere between the two instructions (exclusive) of the same block
+ */
+static bool isWrittenBetween(InstructionWalker start, const InstructionWalker& end, const Local* local)
+{
+    for(start.nextInBlock(); !start.isEndOfBlock() && start != end; start.nextInBlock())
+    {
+        if(start.has() && start->writesLocal(local))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Returns the source local and the integer unpack mode extracting the same value as the given zero-/sign-extension or
+ * byte-extraction (e.g. for bit-casts of vectors of smaller types), if any.
+ */
+static Optional<std::pair<const Local*, Unpack>> getExtensionUnpack(InstructionWalker it)
+{
+    if(it->hasConditionalExecution() || it->doesSetFlag() || it->hasSideEffects() || it->hasPackMode() ||
+        !it->checkOutputLocal())
+        return {};
+    if(auto move = it.get<MoveOperation>())
+    {
+        // %e = mov %x (unpack 8a) as inserted by insertZeroExtension()/insertSignExtension()
+        auto source = move->getSource().checkLocal();
+        auto mode = move->getUnpackMode();
+        if(!source || dynamic_cast<const VectorRotation*>(move) || mode.isUnpackFromR4() || !mode.hasEffect() ||
+            mode == UNPACK_8888_32)
+            return {};
+        return std::make_pair(source, mode);
+    }
+    auto op = it.get<Operation>();
+    if(!op || op->hasUnpackMode() || !op->getFirstArg().checkLocal())
+        return {};
+    const Local* source = op->getFirstArg().local();
+    auto constant =
+        op->getSecondArg() ? op->assertArgument(1).getConstantValue() & &Value::getLiteralValue : Optional<Literal>{};
+    if(!constant)
+        return {};
+    // the shift/mask in front of the extension, e.g. %t = shr %x, 8 + %e = and %t, 255 -> %x (unpack 8b)
+    auto getInnerShift = [&](OpCode code, uint32_t offset) -> const Local* {
+        auto inner = dynamic_cast<const Operation*>(source->getSingleWriter());
+        if(!inner || inner->op != code || !inner->isSimpleOperation() || inner->hasConditionalExecution() ||
+            !inner->getFirstArg().checkLocal() || !inner->getSecondArg())
+            return nullptr;
+        auto shift = inner->assertArgument(1).getLiteralValue();
+        if(!shift || shift->unsignedInt() != offset)
+            return nullptr;
+        auto innerIt = it.getBasicBlock()->findWalkerForInstruction(inner, it);
+        if(!innerIt || isWrittenBetween(*innerIt, it, inner->getFirstArg().local()))
+            return nullptr;
+        return inner->getFirstArg().local();
+    };
+    if(op->op == OP_AND && constant->unsignedInt() == 0xFF)
+    {
+        if(auto inner = getInnerShift(OP_SHR, 8))
+            return std::make_pair(inner, UNPACK_8B_32);
+        if(auto inner = getInnerShift(OP_SHR, 16))
+            return std::make_pair(inner, UNPACK_8C_32);
+        return std::make_pair(source, UNPACK_8A_32);
+    }
+    if(op->op == OP_SHR && constant->unsignedInt() == 24)
+        return std::make_pair(source, UNPACK_8D_32);
+    if(op->op == OP_ASR && constant->unsignedInt() == 16)
+    {
+        if(auto inner = getInnerShift(OP_SHL, 16))
+            return std::make_pair(inner, UNPACK_16A_32);
+        return std::make_pair(source, UNPACK_16B_32);
+    }
+    return {};
+}
+
+/*
+ * Returns whether the given integer extension can be unpacked by the given instruction instead of the separate
+ * extension instruction
+ */
+static bool canUnpackIntegerInput(const LocalUser* reader, const Local* extended)
+{
+    auto op = dynamic_cast<const Operation*>(reader);
+    auto move = dynamic_cast<const MoveOperation*>(reader);
+    // the unpack modes convert to floating-point values for floating-point operations
+    if((!op && !move) || (op && op->op.acceptsFloat) || dynamic_cast<const VectorRotation*>(reader) ||
+        dynamic_cast<const UnpackingInstruction*>(reader)->hasUnpackMode())
+        return false;
+    // as for the half conversions, any other local input would also be unpacked
+    return std::all_of(reader->getArguments().begin(), reader->getArguments().end(),
+        [&](const Value& arg) -> bool { return arg.hasLocal(extended) || arg.checkImmediate(); });
+}
+
+InstructionWalker optimizations::combineExtensionUnpacks(
+    const Module& module, Method& method, InstructionWalker it, const Configuration& config)
+{
+    auto extension = getExtensionUnpack(it);
+    if(!extension || extension->first->get<MultiRegisterData>())
+        return it;
+    // %e = and %x, 255 + %g = add %e, 7 -> %g = add %x, 7 (unpack 8a)
+    auto extended = it->getOutput()->local();
+    auto source = extension->first;
+    auto readers = extended->getUsers(LocalUse::Type::READER);
+    if(readers.empty() || extended->getUsers(LocalUse::Type::WRITER).size() != 1 ||
+        !std::all_of(readers.begin(), readers.end(),
+            [&](const LocalUser* reader) -> bool { return canUnpackIntegerInput(reader, extended); }))
+        return it;
+    // all readers need to follow in the same block without the source being modified before them
+    auto remainingReaders = readers;
+    for(auto checkIt = it.copy().nextInBlock(); !checkIt.isEndOfBlock() && !remainingReaders.empty();
+        checkIt.nextInBlock())
+    {
+        if(!checkIt.has())
+            continue;
+        remainingReaders.erase(checkIt.get());
+        if(checkIt->writesLocal(source) && !remainingReaders.empty())
+            return it;
+    }
+    if(!remainingReaders.empty())
+        return it;
+    LOG_LAZY(logging::Level::DEBUG,
+        log << "Combining integer extension into its " << readers.size()
+            << " readers via unpack mode: " << it->to_string() << logging::endl);
+    for(const LocalUser* reader : readers)
+    {
+        auto user = const_cast<LocalUser*>(reader);
+        user->replaceLocal(extended, source, LocalUse::Type::READER);
+        dynamic_cast<UnpackingInstruction*>(user)->setUnpackMode(extension->second);
+    }
+    return it.erase();
+}
+
+/*
+ * Returns whether the given value is known to be an unsigned byte, i.e. whether the packed 8-bit operations calculate
+ * the same result in the lowest byte as the 32-bit operations, while the upper (zero) bytes stay zero.
+ */
+static bool isUnsignedByte(const Value& val, const Method& method)
+{
+    return analysis::ValueRange::getValueRangeRecursive(val, &method).fitsIntoRange(analysis::ValueRange{0.0, 255.0});
+}
+
+InstructionWalker optimizations::combineSaturatedByteOperations(
+    const Module& module, Method& method, InstructionWalker it, const Configuration& config)
+{
+    auto op = it.get<Operation>();
+    if(!op || (op->op != OP_MIN && op->op != OP_MAX) || !op->isSimpleOperation() || op->hasConditionalExecution() ||
+        op->getArguments().size() != 2 || !op->checkOutputLocal() || op->getOutput()->type.isFloatingType())
+        return it;
+    // %s = add %a, %b + %r = min %s, 255 -> %r = v8adds %a, %b
+    // %d = sub %a, %b + %r = max %d, 0 -> %r = v8subs %a, %b
+    const auto& saturatedOp = op->op == OP_MIN ? OP_ADD : OP_SUB;
+    const auto& packedOp = op->op == OP_MIN ? OP_V8ADDS : OP_V8SUBS;
+    auto bound = op->op == OP_MIN ? 255u : 0u;
+    const Operation* writer = nullptr;
+    if(isLiteral(op->assertArgument(1), bound))
+        writer = getSingleUseWriter(op->getFirstArg());
+    else if(isLiteral(op->getFirstArg(), bound))
+        writer = getSingleUseWriter(op->assertArgument(1));
+    if(!writer || writer->op != saturatedOp || writer->getArguments().size() != 2)
+        return it;
+    const auto& a = writer->getFirstArg();
+    const auto& b = writer->assertArgument(1);
+    // the inputs are read at the position of the saturation instead of the original calculation
+    if(!isStableValue(a) || !isStableValue(b) || !isUnsignedByte(a, method) || !isUnsignedByte(b, method))
+        return it;
+    LOG_LAZY(logging::Level::DEBUG,
+        log << "Replacing saturated byte calculation " << writer->to_string() << " and " << op->to_string()
+            << " with packed 8-bit operation" << logging::endl);
+    it.reset((new Operation(packedOp, op->getOutput().value(), a, b))->copyExtrasFrom(op));
+    return it;
+}
+
+/*
+ * Returns whether the given operation can apply a saturating pack-mode to its result instead of the separate move.
+ * Since the pack-mode of an operation saturates the result to 32-bit first, the result must not overflow.
+ */
+static bool canApplySaturationPackMode(const Operation* op, const Method& method)
+{
+    if(op->op.returnsFloat)
+        // the pack-modes convert floating-point results to half-precision
+        return false;
+    if(op->op == OP_ADD || op->op == OP_SUB || op->op == OP_SHL || op->op == OP_MUL24)
+    {
+        auto range = analysis::ValueRange::getValueRangeRecursive(op->getOutput().value(), &method);
+        return range.fitsIntoRange(analysis::ValueRange{static_cast<double>(std::numeric_limits<int32_t>::min()),
+            static_cast<double>(std::numeric_limits<int32_t>::max())});
+    }
+    return true;
+}
+
+InstructionWalker optimizations::combineSaturationPackModes(
+    const Module& module, Method& method, InstructionWalker it, const Configuration& config)
+{
+    // %t = add %a, %b + %r = mov %t (pack 8a saturate) -> %r = add %a, %b (pack 8a saturate)
+    auto move = it.get<MoveOperation>();
+    if(!move || it.get<VectorRotation>() || move->hasConditionalExecution() || move->doesSetFlag() ||
+        move->hasUnpackMode() || move->getSignal().hasSideEffects() || !move->checkOutputLocal())
+        return it;
+    auto pack = move->getPackMode();
+    if(pack != PACK_INT_TO_UNSIGNED_CHAR_SATURATE && pack != PACK_INT_TO_SIGNED_SHORT_SATURATE && pack != PACK_32_32)
+        return it;
+    auto writer = getSingleUseWriter(move->getSource());
+    auto result = move->getOutput()->local();
+    if(!writer || writer->doesSetFlag() || result->getUsers(LocalUse::Type::WRITER).size() != 1 ||
+        !canApplySaturationPackMode(writer, method))
+        return it;
+    auto writerIt = it.getBasicBlock()->findWalkerForInstruction(writer, it);
+    if(!writerIt)
+        return it;
+    // the saturated value must not be read between the original calculation and the move
+    for(auto checkIt = writerIt->copy().nextInBlock(); checkIt != it; checkIt.nextInBlock())
+    {
+        if(checkIt.has() && checkIt->readsLocal(result))
+            return it;
+    }
+    LOG_LAZY(logging::Level::DEBUG,
+        log << "Combining saturation into the calculation of its input: " << move->to_string() << logging::endl);
+    (*writerIt)->setOutput(move->getOutput());
+    writerIt->get<Operation>()->setPackMode(pack);
+    (*writerIt)->addDecorations(move->decoration);
+    return it.erase();
+}
+
+/*
+ * Returns the SIMD element the given instruction inserts its value into, if it is a single element insertion as
+ * generated by #insertVectorInsertion(), i.e. a conditional move depending on the flags set by comparing the element
+ * number with the index.
+ */
+static Optional<uint8_t> getInsertedElement(
+    BasicBlock& block, InstructionWalker it, Optional<InstructionWalker>& setter)
+{
+    auto move = it.get<const MoveOperation>();
+    if(!move || it.get<const VectorRotation>() || move->getCondition() != COND_ZERO_SET ||
+        !move->hasDecoration(InstructionDecorations::ELEMENT_INSERTION) || move->doesSetFlag() ||
+        move->hasPackMode() || move->hasUnpackMode() || !move->checkOutputLocal())
+        return {};
+    setter = block.findLastSettingOfFlags(it);
+    if(!setter)
+        return {};
+    auto flagsInst = setter->get<const ExtendedInstruction>();
+    if(!flagsInst || !flagsInst->getOutput() || !flagsInst->getOutput()->hasRegister(REG_NOP) ||
+        flagsInst->hasConditionalExecution() || flagsInst->hasPackMode() || flagsInst->hasUnpackMode())
+        return {};
+    auto flagsMove = dynamic_cast<const MoveOperation*>(flagsInst);
+    if(flagsMove && !dynamic_cast<const VectorRotation*>(flagsInst) &&
+        flagsMove->getSource().hasRegister(REG_ELEMENT_NUMBER))
+        // element number == 0
+        return 0;
+    auto flagsOp = dynamic_cast<const Operation*>(flagsInst);
+    if(flagsOp && flagsOp->op == OP_XOR && flagsOp->readsRegister(REG_ELEMENT_NUMBER))
+    {
+        auto index = flagsOp->findOtherArgument(ELEMENT_NUMBER_REGISTER);
+        auto lit = index ? index->getLiteralValue() : Optional<Literal>{};
+        if(lit && lit->unsignedInt() < NATIVE_VECTOR_SIZE)
+            return static_cast<uint8_t>(lit->unsignedInt());
+    }
+    return {};
+}
+
+namespace
+{
+    // The scalar values inserted into all the elements of a vector
+    struct VectorElements
+    {
+        // the scalar value inserted for every element, the values are only valid in their SIMD element 0
+        FastAccessList<Value> elements;
+        // the instructions writing the vector, in order of the basic block
+        FastAccessList<InstructionWalker> writers;
+        // the instructions setting the flags for the single element insertions into the vector
+        FastAccessList<InstructionWalker> flagSetters;
+    };
+} // namespace
+
+/*
+ * Determines the values inserted into all the elements of the given vector within the given block, by following the
+ * chain of single element insertions and copies of partially assembled vectors.
+ */
+static Optional<VectorElements> findInsertedElements(BasicBlock& block, const Local* vector)
+{
+    auto numElements = vector->type.getVectorWidth();
+    VectorElements result;
+    result.elements.assign(numElements, UNDEFINED_VALUE);
+    std::bitset<NATIVE_VECTOR_SIZE> insertedElements;
+    const Local* container = vector;
+    while(container)
+    {
+        FastAccessList<InstructionWalker> writers;
+        bool readBeforeAssembled = false;
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            if(it->writesLocal(container))
+                writers.push_back(it);
+            else if(!writers.empty() && container == vector && it->readsLocal(container) &&
+                writers.size() < container->getUsers(LocalUse::Type::WRITER).size())
+                // the partially assembled vector is read
+                readBeforeAssembled = true;
+        }
+        if(readBeforeAssembled || writers.empty() ||
+            writers.size() != container->getUsers(LocalUse::Type::WRITER).size())
+            return {};
+
+        // the first writer might copy a partially assembled vector, all other writers need to insert single elements
+        const Local* previousContainer = nullptr;
+        auto copy = writers.front().get<const MoveOperation>();
+        bool isCopied = copy && !writers.front().get<const VectorRotation>() && !copy->hasConditionalExecution() &&
+            !copy->hasPackMode() && !copy->hasUnpackMode() && !copy->doesSetFlag();
+        if(isCopied)
+        {
+            previousContainer = copy->getSource().checkLocal();
+            if(previousContainer && previousContainer->type != vector->type)
+                return {};
+        }
+        for(auto it = writers.rbegin(); it != writers.rend(); ++it)
+        {
+            if(isCopied && it->get() == writers.front().get())
+                break;
+            Optional<InstructionWalker> setter;
+            auto index = getInsertedElement(block, *it, setter);
+            if(!index)
+                return {};
+            if(*index >= numElements)
+                // the element is not part of the vector type
+                continue;
+            if(container == vector &&
+                std::none_of(result.flagSetters.begin(), result.flagSetters.end(),
+                    [&](const InstructionWalker& other) -> bool { return other.get() == setter->get(); }))
+                result.flagSetters.push_back(*setter);
+            if(insertedElements.test(*index))
+                // overwritten by a later insertion
+                continue;
+            insertedElements.set(*index);
+
+            // the inserted value is rotated into the position of the element
+            auto source = it->get<const MoveOperation>()->getSource();
+            auto rotation = dynamic_cast<const VectorRotation*>(source.getSingleWriter());
+            auto offset = rotation ? rotation->getOffset().getRotationOffset() : Optional<unsigned char>{};
+            if(rotation && rotation->type == RotationType::FULL && !rotation->hasConditionalExecution() &&
+                !rotation->hasPackMode() && !rotation->hasUnpackMode() && offset && *offset == *index)
+                result.elements[*index] = rotation->getSource();
+            else if(*index == 0 || source.getLiteralValue())
+                result.elements[*index] = source;
+            else
+                return {};
+        }
+        if(container == vector)
+            result.writers = std::move(writers);
+        if(insertedElements.count() == numElements)
+            return result;
+        container = previousContainer;
+    }
+    return {};
+}
+
+/*
+ * Follows the chain of simple copies of the given value
+ */
+static Value skipCopies(const Value& val)
+{
+    Value result = val;
+    while(auto move = dynamic_cast<const MoveOperation*>(result.getSingleWriter()))
+    {
+        if(dynamic_cast<const VectorRotation*>(move) || move->hasConditionalExecution() || move->hasPackMode() ||
+            move->hasUnpackMode() || move->hasSideEffects() || !move->getSource().checkLocal() ||
+            move->getSource().type.getVectorWidth() != result.type.getVectorWidth())
+            break;
+        result = move->getSource();
+    }
+    return result;
+}
+
+/*
+ * Returns the vector the given scalar value is extracted from, if it is the element with the given index as generated
+ * by #insertVectorExtraction()
+ */
+static Optional<Value> getExtractionSource(const Value& val, uint8_t index, FastAccessList<const LocalUser*>& readers)
+{
+    if(!val.checkLocal())
+        return {};
+    if(index == 0 && val.type.getVectorWidth() > 1)
+        // the vector is used directly, e.g. after the extracting move was propagated
+        return val;
+    auto writer = val.getSingleWriter();
+    auto move = dynamic_cast<const MoveOperation*>(writer);
+    if(!move || move->hasConditionalExecution() || move->hasPackMode() || move->hasUnpackMode() ||
+        move->hasSideEffects() || !move->getSource().checkLocal() || move->getSource().type.getVectorWidth() <= 1)
+        return {};
+    auto rotation = dynamic_cast<const VectorRotation*>(move);
+    if(rotation)
+    {
+        // the element is rotated down to element 0
+        auto offset = rotation->getOffset().getRotationOffset();
+        if(rotation->type != RotationType::FULL || !offset ||
+            *offset != (NATIVE_VECTOR_SIZE - index) % NATIVE_VECTOR_SIZE)
+            return {};
+    }
+    if(!rotation && index != 0)
+        return {};
+    readers.push_back(writer);
+    return move->getSource();
+}
+
+namespace
+{
+    enum class ElementArgumentType
+    {
+        // the argument is the same constant for all elements
+        CONSTANT,
+        // the argument is extracted from the matching element of a vector
+        EXTRACTED,
+        // the argument is the same scalar local for all elements and needs to be replicated
+        REPLICATED
+    };
+
+    // A candidate for combining the operations calculating the elements of a vector into a single vector operation
+    struct ElementOperation
+    {
+        const Operation* firstOperation;
+        FastAccessList<std::pair<ElementArgumentType, Optional<Value>>> arguments;
+        // all instructions reading the arguments
+        FastAccessList<const LocalUser*> readers;
+    };
+} // namespace
+
+/*
+ * Checks whether all elements are calculated by isomorphic operations which only differ in the vector element
+ * the arguments are taken from
+ */
+static Optional<ElementOperation> findIsomorphicOperations(const VectorElements& elements, DataType vectorType)
+{
+    ElementOperation result{nullptr, {}, {}};
+    for(uint8_t index = 0; index < elements.elements.size(); ++index)
+    {
+        auto element = skipCopies(elements.elements[index]);
+        auto op = dynamic_cast<const Operation*>(element.getSingleWriter());
+        if(!op || !op->checkOutputLocal() || op->hasConditionalExecution() || op->hasSideEffects() ||
+            op->hasPackMode() || op->hasUnpackMode() ||
+            op->getOutput()->type.getElementType() != vectorType.getElementType())
+            return {};
+        if(!result.firstOperation)
+        {
+            result.firstOperation = op;
+            result.arguments.resize(op->getArguments().size(), std::make_pair(ElementArgumentType::CONSTANT, NO_VALUE));
+        }
+        else if(op->op != result.firstOperation->op ||
+            op->getArguments().size() != result.firstOperation->getArguments().size())
+            return {};
+        result.readers.push_back(op);
+
+        for(std::size_t i = 0; i < op->getArguments().size(); ++i)
+        {
+            const auto& arg = op->getArgument(i).value();
+            auto& argument = result.arguments[i];
+            if(auto source = getExtractionSource(skipCopies(arg), index, result.readers))
+            {
+                if(index == 0)
+                    argument = std::make_pair(ElementArgumentType::EXTRACTED, *source);
+                else if(argument.first != ElementArgumentType::EXTRACTED || !argument.second ||
+                    *argument.second != *source)
+                    return {};
+            }
+            else if(arg.getLiteralValue() || arg.checkImmediate())
+            {
+                if(index == 0)
+                    argument = std::make_pair(ElementArgumentType::CONSTANT, arg);
+                else if(argument.first != ElementArgumentType::CONSTANT || !argument.second || *argument.second != arg)
+                    return {};
+            }
+            else if(arg.checkLocal() && arg.type.getVectorWidth() == 1)
+            {
+                if(index == 0)
+                    argument = std::make_pair(ElementArgumentType::REPLICATED, arg);
+                else if(argument.first != ElementArgumentType::REPLICATED || !argument.second ||
+                    *argument.second != arg)
+                    return {};
+            }
+            else
+                return {};
+        }
+    }
+    return result;
+}
+
+/*
+ * Checks whether the locals read by the combined operation are not modified between their original reads and the
+ * position of the combined operation
+ */
+static bool areArgumentsUnchanged(BasicBlock& block, const ElementOperation& operation, InstructionWalker insertIt)
+{
+    FastSet<const LocalUser*> readers(operation.readers.begin(), operation.readers.end());
+    FastSet<const Local*> locals;
+    for(const auto& arg : operation.arguments)
+    {
+        if(auto loc = arg.second ? arg.second->checkLocal() : nullptr)
+            locals.emplace(loc);
+    }
+    bool firstReadFound = false;
+    for(auto it = block.walk(); !it.isEndOfBlock() && it.get() != insertIt.get(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(readers.find(it.get()) != readers.end())
+        {
+            readers.erase(it.get());
+            firstReadFound = true;
+        }
+        else if(firstReadFound &&
+            std::any_of(locals.begin(), locals.end(), [&](const Local* loc) -> bool { return it->writesLocal(loc); }))
+            return false;
+    }
+    // all the reading instructions need to be located in this block before the combined operation
+    return readers.empty();
+}
+
+/*
+ * Removes the given flag setter, if no instruction depends on its flags any more
+ */
+static void removeUnusedFlags(InstructionWalker setter)
+{
+    if(setter.isEndOfBlock() || !setter.has())
+        return;
+    for(auto it = setter.copy().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(it->hasConditionalExecution() || it.get<Branch>())
+            return;
+        if(it->doesSetFlag())
+            break;
+    }
+    setter.erase();
+}
+
+bool optimizations::vectorizeElementOperations(const Module& module, Method& method, const Configuration& config)
+{
+    std::size_t numVectorized = 0;
+    for(BasicBlock& block : method)
+    {
+        FastSet<const Local*> checkedVectors;
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            Optional<InstructionWalker> setter;
+            auto loc = it.has() ? it->checkOutputLocal() : nullptr;
+            if(!loc || loc->type.getVectorWidth() < 2 || !checkedVectors.emplace(loc).second ||
+                !getInsertedElement(block, it, setter))
+            {
+                it.nextInBlock();
+                continue;
+            }
+            auto elements = findInsertedElements(block, loc);
+            auto operation = elements ? findIsomorphicOperations(*elements, loc->type) : Optional<ElementOperation>{};
+            if(!operation || !areArgumentsUnchanged(block, *operation, elements->writers.back()))
+            {
+                it.nextInBlock();
+                continue;
+            }
+
+            auto insertIt = elements->writers.back();
+            FastAccessList<Value> arguments;
+            for(const auto& arg : operation->arguments)
+            {
+                if(arg.first == ElementArgumentType::REPLICATED)
+                {
+                    auto replicated =
+                        method.addNewLocal(arg.second->type.toVectorType(loc->type.getVectorWidth()), "%replicated");
+                    insertIt = insertReplication(insertIt, *arg.second, replicated);
+                    arguments.push_back(replicated);
+                }
+                else
+                    arguments.push_back(*arg.second);
+            }
+            auto firstOp = operation->firstOperation;
+            auto vectorOp = arguments.size() == 1 ?
+                new Operation(firstOp->op, loc->createReference(), arguments[0]) :
+                new Operation(firstOp->op, loc->createReference(), arguments[0], arguments[1]);
+            vectorOp->addDecorations(firstOp->decoration);
+            LOG_LAZY(logging::Level::DEBUG,
+                log << "Combining the calculation of the " << static_cast<unsigned>(loc->type.getVectorWidth())
+                    << " elements of " << loc->to_string() << " into vector operation: " << vectorOp->to_string()
+                    << logging::endl);
+            insertIt.emplace(vectorOp);
+
+            for(auto& writer : elements->writers)
+                writer.erase();
+            for(auto& flagSetter : elements->flagSetters)
+                removeUnusedFlags(flagSetter);
+            ++numVectorized;
+            // the scalar calculations of the elements are removed by the dead code elimination if not used elsewhere
+            it = block.walk();
+        }
+    }
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 340, "Vectorized element operations", numVectorized);
+    return numVectorized > 0;
+}
+
+// The maximum depth of the expression trees built for the simplification
+static constexpr unsigned MAX_SIMPLIFICATION_DEPTH = 4;
+
+static bool requiresLiteralLoad(const SubExpression& sub)
+{
+    // only integers in [-16, 15] can be encoded as small immediate values
+    auto lit = sub.getLiteralValue();
+    return lit && lit->type == LiteralType::INTEGER && (lit->signedInt() < -16 || lit->signedInt() > 15);
+}
+
+/*
+ * Returns the number of instructions (including the loading of literal values which cannot be encoded as small
+ * immediate values) required to calculate the given expression tree
+ */
+static unsigned calculateExpressionCosts(const Expression& expr)
+{
+    if(expr.isMoveExpression())
+        return expr.arg0.checkExpression() ? calculateExpressionCosts(*expr.arg0.checkExpression()) : 1;
+    unsigned costs = 1;
+    if(requiresLiteralLoad(expr.arg0) || requiresLiteralLoad(expr.arg1))
+        ++costs;
+    for(const auto& arg : {expr.arg0, expr.arg1})
+    {
+        if(auto argExpr = arg.checkExpression())
+            costs += calculateExpressionCosts(*argExpr);
+    }
+    return costs;
+}
+
+/*
+ * Returns the number of instructions (see #calculateExpressionCosts) saved when the given instruction is removed, i.e.
+ * the instruction itself and the instructions of the expression tree (see Expression#createRecursiveExpression)
+ * calculating values only used by the removed instructions
+ */
+static unsigned calculateRemovedCosts(const IntermediateInstruction& inst, unsigned depth)
+{
+    auto expr = Expression::createExpression(inst);
+    if(!expr)
+        return 0;
+    unsigned costs = 1;
+    if(requiresLiteralLoad(expr->arg0) || requiresLiteralLoad(expr->arg1))
+        ++costs;
+    if(depth == 0 || intermediate::isGroupBuiltin(expr->deco, true))
+        return costs;
+    FastSet<const Local*> processedLocals;
+    for(const auto& arg : inst.getArguments())
+    {
+        auto loc = arg.checkLocal();
+        if(!loc || !processedLocals.emplace(loc).second)
+            continue;
+        auto writer = arg.getSingleWriter();
+        if(writer && loc->getUsers(LocalUse::Type::READER).size() == 1)
+            costs += calculateRemovedCosts(*writer, depth - 1);
+    }
+    return costs;
+}
+
+/*
+ * Checks whether all leaf values of the given expression tree have the same value at the position of the given
+ * instruction as at the position they were read originally
+ */
+static bool hasAvailableInputs(const Expression& expr, const IntermediateInstruction& inst)
+{
+    for(const auto& arg : {expr.arg0, expr.arg1})
+    {
+        if(auto argExpr = arg.checkExpression())
+        {
+            if(!hasAvailableInputs(*argExpr, inst))
+                return false;
+        }
+        else if(auto val = arg.checkValue())
+        {
+            if(auto reg = val->checkRegister())
+            {
+                if(*reg != REG_ELEMENT_NUMBER && *reg != REG_QPU_NUMBER)
+                    return false;
+            }
+            else if(auto loc = val->checkLocal())
+            {
+                // locals which are written multiple times (e.g. phi-nodes) might have changed in between
+                if(loc->getUsers(LocalUse::Type::WRITER).size() > 1 && !inst.readsLocal(loc))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool optimizations::simplifyExpressionTrees(const Module& module, Method& method, const Configuration& config)
+{
+    bool hasChanged = false;
+    for(auto& block : method)
+    {
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            auto out = it.has() ? it->checkOutputLocal() : nullptr;
+            if(!out || out->type.isFloatingType() || it->doesSetFlag() ||
+                it->hasDecoration(InstructionDecorations::MANDATORY_DELAY))
+            {
+                it.nextInBlock();
+                continue;
+            }
+            auto expr = Expression::createRecursiveExpression(
+                *it.get(), MAX_SIMPLIFICATION_DEPTH, ExpressionOptions::STOP_AT_BUILTINS);
+            auto newExpr = expr ? expr->simplify(&method) : nullptr;
+            if(!newExpr || newExpr == expr || !hasAvailableInputs(*newExpr, *it.get()) ||
+                calculateExpressionCosts(*newExpr) >= calculateRemovedCosts(*it.get(), MAX_SIMPLIFICATION_DEPTH))
+            {
+                it.nextInBlock();
+                continue;
+            }
+            LOG_LAZY(logging::Level::DEBUG,
+                log << "Simplifying expression of '" << it->to_string() << "' to: " << newExpr->to_string()
+                    << logging::endl);
+            auto output = it->getOutput().value();
+            auto deco = it->decoration;
+            auto insertIt = it.copy();
+            if(newExpr->isMoveExpression() && newExpr->arg0.checkValue())
+            {
+                insertIt.emplace(new MoveOperation(output, *newExpr->arg0.checkValue()));
+                insertIt.nextInBlock();
+            }
+            else if(!newExpr->insertInstructions(insertIt, output, {}, true))
+            {
+                it.nextInBlock();
+                continue;
+            }
+            // the value calculated is the same, so the decorations still apply
+            insertIt.copy().previousInBlock()->addDecorations(deco);
+            it = insertIt.erase();
+            hasChanged = true;
+        }
+    }
+    return hasChanged;
+}
+
 static Optional<std::pair<Value, InstructionDecorations>> combineAdditions(
     Method& method, InstructionWalker referenceIt, FastMap<Value, InstructionDecorations>& addedValues)
 {
@@ -1153,7 +2402,7 @@ static Optional<std::pair<Value, InstructionDecorations>> combineAdditions(
 //         throw CompilationError(
 //             CompilationStep::OPTIMIZER, "Not yet implemented, no shift in address calculation", range.to_string());
 
-//     CPPLOG_LAZY(logging::Level::DEBUG,
+//     LOG_LAZY(logging::Level::DEBUG,
 //         log << "Rewrote address-calculation with indices "
 //             << (firstVal ? (firstVal->first.to_string() + " (" + toString(firstVal->second) + ")") : "") << " and "
 //             << (secondVal ? (secondVal->first.to_string() + " (" + toString(secondVal->second) + ")") : "")
@@ -1165,7 +2414,7 @@ bool optimizations::cacheWorkGroupDMAAccess(const Module& module, Method& method
     if(method.metaData.getWorkGroupSize() == 1)
     {
         // no need to do anything, if there is only 1 work-item
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Skipping work-group caching for work-groups of fixed item count of 1" << logging::endl);
         return false;
     }
@@ -1177,24 +2426,24 @@ bool optimizations::cacheWorkGroupDMAAccess(const Module& module, Method& method
         std::tie(allUniformPartsEqual, offsetRange) = analysis::checkWorkGroupUniformParts(pair.second, false);
         if(!allUniformPartsEqual)
         {
-            CPPLOG_LAZY(logging::Level::DEBUG,
+            LOG_LAZY(logging::Level::DEBUG,
                 log << "Cannot cache memory location " << pair.first->to_string()
                     << " in VPM, since the work-group uniform parts of the address calculations differ, which "
                        "is not yet supported!"
                     << logging::endl);
             continue;
         }
-        if((offsetRange.maxValue - offsetRange.minValue) >= config.availableVPMSize ||
+        if((offsetRange.maxValue - offsetRange.minValue) >= config.target.availableVPMSize ||
             (offsetRange.maxValue < offsetRange.minValue))
         {
             // this also checks for any over/underflow when converting the range to unsigned int in the next steps
-            CPPLOG_LAZY(logging::Level::DEBUG,
+            LOG_LAZY(logging::Level::DEBUG,
                 log << "Cannot cache memory location " << pair.first->to_string()
                     << " in VPM, the accessed range is too big: [" << offsetRange.minValue << ", "
                     << offsetRange.maxValue << "]" << logging::endl);
             continue;
         }
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Memory location " << pair.first->to_string() << " is accessed via DMA in the dynamic range ["
                 << offsetRange.minValue << ", " << offsetRange.maxValue << "]" << logging::endl);
 
@@ -1206,7 +2455,7 @@ bool optimizations::cacheWorkGroupDMAAccess(const Module& module, Method& method
         auto vpmArea = method.vpm->addArea(pair.first, accessedType, false);
         if(vpmArea == nullptr)
         {
-            CPPLOG_LAZY(logging::Level::DEBUG,
+            LOG_LAZY(logging::Level::DEBUG,
                 log << "Memory location " << pair.first->to_string() << " with dynamic access range ["
                     << offsetRange.minValue << ", " << offsetRange.maxValue
                     << "] cannot be cached in VPM, since it does not fit" << logging::endl);
@@ -66,6 +66,30 @@ namespace vc4c
          */
         bool combineOperations(const Module& module, Method& method, const Configuration& config);
 
+        /*
+         * Combines ALU-instructions which (can) use different ALUs into a single instruction, like #combineOperations,
+         * but also pairs instructions which are not adjacent.
+         *
+         * An instruction is moved up directly behind its partner instruction, if it does not depend on any instruction
+         * in between (within a window of a few instructions) and is not subject to a fixed delay. The pairs are
+         * determined per basic block via a maximum matching of the instructions only executable on the ADD ALU with
+         * the instructions executable on the MUL ALU (and afterwards the instructions only executable on the MUL ALU
+         * with the instructions executable on both ALUs), so as many instructions as possible are combined.
+         *
+         * Example:
+         *   %a = fadd %x, %y
+         *   %b = fadd %a, %z
+         *   %c = fmul %x, %y
+         *
+         * is converted to:
+         *   %a = fadd %x, %y and %c = fmul %x, %y
+         *   %b = fadd %a, %z
+         *
+         * NOTE: This needs to run after the instructions are scheduled, since the scheduling might separate the
+         * combined instructions again. Writes to the same output are left to #combineOperations.
+         */
+        bool pairALUOperations(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Combines the loading of the same constant value (e.g. literal or constant register) within a small range in a
          * single basic block
@@ -128,6 +152,54 @@ namespace vc4c
          */
         bool combineVectorRotations(const Module& module, Method& method, const Configuration& config);
 
+        /*
+         * Combines the isomorphic scalar operations calculating all the elements of a vector, which are assembled via
+         * single element insertions, into a single vector operation on the vectors the arguments are extracted from
+         *
+         * Example:
+         *   %a0 = %a >> 0
+         *   %b0 = %b >> 0
+         *   %c0 = add %a0, %b0
+         *   %a1 = %a >> 15
+         *   %b1 = %b >> 15
+         *   %c1 = add %a1, %b1
+         *   %tmp1 = %c1 << 1
+         *   [...]
+         *   - = xor.setf elem_num, 1
+         *   %c = %tmp1 (ifz)
+         *   [...]
+         *
+         * is converted to:
+         *   %c = add %a, %b
+         *
+         * NOTE: The scalar calculations are not removed here, but by the dead code elimination, if not used otherwise.
+         */
+        bool vectorizeElementOperations(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Simplifies the integer calculations of the expression trees (see Expression#createRecursiveExpression) of
+         * all instructions via Expression#simplify, e.g. by reassociating constants, folding shifts and masks and
+         * removing masks of values already known to fit into the mask.
+         *
+         * The simplified expression tree is only inserted instead of the original instruction, if this requires fewer
+         * instructions than are removed (the original instruction and the instructions calculating values only used
+         * in the expression tree).
+         *
+         * Example:
+         *   %a = add %x, 1
+         *   %b = shl %a, 2
+         *   %c = add %b, 4
+         *   %d = add %c, %y
+         *
+         * becomes:
+         *   %expr = shl %x, 2
+         *   %expr.1 = add %expr, 8
+         *   %d = add %expr.1, %y
+         *
+         * NOTE: The instructions no longer used are removed by the dead code elimination.
+         */
+        bool simplifyExpressionTrees(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Combines arithmetic operations if the result of the first operation is used as the second operation and the
          * operations allow combining (e.g. no side-effects).
@@ -154,6 +226,122 @@ namespace vc4c
         InstructionWalker combineArithmeticOperations(
             const Module& module, Method& method, InstructionWalker it, const Configuration& config);
 
+        /*
+         * Replaces common bitwise idioms (e.g. of cryptographic hash functions) with shorter sequences of native QPU
+         * operations:
+         * - rotations written as two shifts combined by an OR are replaced with a single rotation on the add ALU
+         * - bit-selections (e.g. the OpenCL C bitselect() function or the "choose" function of SHA) written as
+         *   (a & ~c) | (b & c) are replaced with a ^ ((a ^ b) & c), saving the inversion of the mask
+         *
+         * The replacement is only done if the intermediate results are not used anywhere else, so the instructions
+         * calculating them can be removed.
+         *
+         * Example:
+         *   %a = shl %x, 7
+         *   %b = shr %x, 25
+         *   %c = or %a, %b
+         *
+         * becomes:
+         *   %c = ror %x, 25
+         *
+         * Also:
+         *   %nc = not %c
+         *   %d = and %a, %nc
+         *   %e = and %b, %c
+         *   %f = or %d, %e
+         *
+         * becomes:
+         *   %d = xor %a, %b
+         *   %e = and %d, %c
+         *   %f = xor %a, %e
+         */
+        InstructionWalker combineBitwiseOperations(
+            const Module& module, Method& method, InstructionWalker it, const Configuration& config);
+
+        /*
+         * Combines the conversions from and to half-precision floating-point values (see
+         * intermediate::insertFloatingPointConversion()) into the instructions consuming or producing the converted
+         * values by using the un-/pack modes of these instructions directly. Also removes the masking of the lower
+         * half-word (e.g. when loading half values via TMU), if the masked value is only read via unpack mode.
+         *
+         * Example:
+         *   %h = and %tmu_result, 0xFFFF
+         *   %f = fmul %h, 1.0 (unpack 16a)
+         *   %g = fadd %f, 2.0
+         *   %r = fmul %g, 1.0 (pack 16a)
+         *
+         * becomes:
+         *   %r = fadd %tmu_result, 2.0 (unpack 16a, pack 16a)
+         *
+         * NOTE: Since the unpack mode converts all inputs read from the physical register file A, the conversion is
+         * only combined into floating-point operations without any other local input.
+         */
+        InstructionWalker combineHalfConversions(
+            const Module& module, Method& method, InstructionWalker it, const Configuration& config);
+
+        /*
+         * Combines integer zero- and sign-extensions (see intermediate::insertZeroExtension() and
+         * intermediate::insertSignExtension()) as well as the extraction of single bytes and half-words (e.g. for
+         * bit-casts to vectors of smaller types) into the unpack modes of the instructions consuming the extended
+         * values and removes the separate extension instructions.
+         *
+         * Example:
+         *   %t = shr %x, 8
+         *   %b = and %t, 255
+         *   %r = add %b, 7
+         *
+         * becomes:
+         *   %t = shr %x, 8
+         *   %r = add %x, 7 (unpack 8b)
+         *
+         * NOTE: Since the unpack mode is applied to all inputs read from the physical register file A and converts the
+         * inputs of floating-point operations to float, the extension is only combined into integer operations and
+         * moves without any other local input. The unpack modes of r4 only convert to floating-point values and are
+         * therefore not used.
+         */
+        InstructionWalker combineExtensionUnpacks(
+            const Module& module, Method& method, InstructionWalker it, const Configuration& config);
+
+        /*
+         * Replaces additions and subtractions of unsigned byte values which are saturated to the byte range via
+         * min/max (e.g. as generated for add_sat(), sub_sat() or convert_uchar_sat() of uchar values) with the packed
+         * 8-bit operations of the ALU, which saturate the result per byte.
+         *
+         * Example:
+         *   %a = and %x, 255
+         *   %b = and %y, 255
+         *   %s = add %a, %b
+         *   %r = min %s, 255
+         *
+         * becomes:
+         *   %a = and %x, 255
+         *   %b = and %y, 255
+         *   %r = v8adds %a, %b
+         *
+         * NOTE: This is only applied if the value ranges of both inputs are known to be within [0, 255] and the result
+         * of the addition/subtraction is not used anywhere else.
+         */
+        InstructionWalker combineSaturatedByteOperations(
+            const Module& module, Method& method, InstructionWalker it, const Configuration& config);
+
+        /*
+         * Combines moves applying a saturating pack-mode (e.g. as generated for convert_uchar_sat() and similar, see
+         * intermediate::insertSaturation() and intermediate::insertFloatToIntegerSaturation()) into the integer
+         * operation calculating the moved value.
+         *
+         * Example:
+         *   %t = ftoi %f
+         *   %r = mov %t (pack 8a saturate)
+         *
+         * becomes:
+         *   %r = ftoi %f (pack 8a saturate)
+         *
+         * NOTE: Since the pack-mode of an operation saturates the result to 32-bit first, additions, subtractions,
+         * shifts and multiplications are only combined, if their result is known to not overflow.
+         */
+        InstructionWalker combineSaturationPackModes(
+            const Module& module, Method& method, InstructionWalker it, const Configuration& config);
+
         // TODO documentation, TODO move somewhere else?!
         bool cacheWorkGroupDMAAccess(const Module& module, Method& method, const Configuration& config);
     } // namespace optimizations
@@ -7,10 +7,14 @@
 #include "ControlFlow.h"
 
 #include "../InstructionWalker.h"
+#include "../Module.h"
 #include "../Profiler.h"
+#include "../analysis/AnalysisManager.h"
 #include "../analysis/ControlFlowGraph.h"
 #include "../analysis/ControlFlowLoop.h"
 #include "../analysis/DataDependencyGraph.h"
+#include "../analysis/LivenessAnalysis.h"
+#include "../analysis/LoopInfo.h"
 #include "../intermediate/Helper.h"
 #include "../intermediate/TypeConversions.h"
 #include "../intermediate/VectorHelper.h"
@@ -23,6 +27,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <limits>
 #include <numeric>
 #include <queue>
 
@@ -32,110 +37,12 @@ using namespace vc4c::optimizations;
 using namespace vc4c::intermediate;
 using namespace vc4c::operators;
 
-static InductionVariable extractLoopControl(const ControlFlowLoop& loop, const DataDependencyGraph& dependencyGraph)
-{
-    auto inductionVariables = loop.findInductionVariables(dependencyGraph, true);
-
-    for(auto& var : inductionVariables)
-        logging::debug() << "Induction variable: " << var.local->to_string() << " from "
-                         << var.initialAssignment->to_string() << " step " << var.inductionStep->to_string()
-                         << " while "
-                         << (var.repeatCondition ?
-                                    (var.repeatCondition->first + (" " + var.repeatCondition->second.to_string())) :
-                                    "(?)")
-                         << logging::endl;
-
-    if(inductionVariables.empty())
-        return InductionVariable{};
-    else if(inductionVariables.size() == 1)
-        return *inductionVariables.begin();
-
-    throw CompilationError(
-        CompilationStep::OPTIMIZER, "Selecting from multiple iteration variables is not supported yet!");
-}
-
-static Optional<unsigned> calculateDistance(
-    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound)
-{
-    auto comp = inductionVariable.repeatCondition.value().first;
-
-    if((comp == intermediate::COMP_SIGNED_LE || comp == intermediate::COMP_SIGNED_LT ||
-           comp == intermediate::COMP_UNSIGNED_LE || comp == intermediate::COMP_UNSIGNED_LT) &&
-        lowerBound.signedInt() > upperBound.signedInt())
-    {
-        CPPLOG_LAZY(logging::Level::DEBUG,
-            log << "Iterating across type wrap is not supported for: " << inductionVariable.local->to_string()
-                << " from " << lowerBound.to_string() << " to " << upperBound.to_string() << logging::endl);
-        return {};
-    }
-
-    if((comp == intermediate::COMP_SIGNED_GE || comp == intermediate::COMP_SIGNED_GT ||
-           comp == intermediate::COMP_UNSIGNED_GE || comp == intermediate::COMP_UNSIGNED_GT) &&
-        lowerBound.signedInt() < upperBound.signedInt())
-    {
-        CPPLOG_LAZY(logging::Level::DEBUG,
-            log << "Iterating across type wrap is not supported for: " << inductionVariable.local->to_string()
-                << " from " << lowerBound.to_string() << " to " << upperBound.to_string() << logging::endl);
-        return {};
-    }
-
-    if(comp == intermediate::COMP_SIGNED_LT)
-        return static_cast<unsigned>(upperBound.signedInt() - lowerBound.signedInt());
-    if(comp == intermediate::COMP_SIGNED_LE)
-        return static_cast<unsigned>(upperBound.signedInt() - lowerBound.signedInt() + 1);
-    if(comp == intermediate::COMP_SIGNED_GT)
-        return static_cast<unsigned>(lowerBound.signedInt() - upperBound.signedInt());
-    if(comp == intermediate::COMP_SIGNED_GE)
-        return static_cast<unsigned>(lowerBound.signedInt() - upperBound.signedInt() + 1);
-    if(comp == intermediate::COMP_UNSIGNED_LT)
-        return upperBound.unsignedInt() - lowerBound.unsignedInt();
-    if(comp == intermediate::COMP_UNSIGNED_LE)
-        return upperBound.unsignedInt() - lowerBound.unsignedInt() + 1u;
-    if(comp == intermediate::COMP_UNSIGNED_GT)
-        return lowerBound.unsignedInt() - upperBound.unsignedInt();
-    if(comp == intermediate::COMP_UNSIGNED_GE)
-        return lowerBound.unsignedInt() - upperBound.unsignedInt() + 1u;
-    if(comp == intermediate::COMP_NEQ)
-        // XXX could be wrong for unsigned induction variable and more than 2^31 iterations
-        return static_cast<unsigned>(std::max(lowerBound.signedInt(), upperBound.signedInt()) -
-            std::min(lowerBound.signedInt(), upperBound.signedInt()));
-
-    CPPLOG_LAZY(logging::Level::DEBUG,
-        log << "Unsupported comparison for calculating distance for: " << inductionVariable.local->to_string()
-            << " and comparison: " << comp << logging::endl);
-    return {};
-}
-
-static Optional<unsigned> calculateIterationCount(
-    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound, Literal stepValue)
-{
-    auto distance = calculateDistance(inductionVariable, lowerBound, upperBound);
-    if(!distance)
-        return {};
-
-    if(inductionVariable.inductionStep->op == OP_ADD)
-        // iterations = (end - start) / step
-        return *distance / static_cast<unsigned>(std::abs(stepValue.signedInt()));
-    if(inductionVariable.inductionStep->op == OP_SUB)
-        // iterations = (start - end) / step
-        return *distance / static_cast<unsigned>(std::abs(stepValue.signedInt()));
-    // XXX add support for more step operations
-    // E.g. mul? Need to calculate:
-    // limit = (start * step) ^ iterations -> iterations = log(start * step) / log(limit)
-
-    CPPLOG_LAZY(logging::Level::DEBUG,
-        log << "Unsupported induction operation for: " << inductionVariable.local->to_string()
-            << " and induction step: " << inductionVariable.inductionStep->to_string() << logging::endl);
-    return {};
-}
-
 /*
  * For now uses a very simple algorithm:
  * - checks the maximum vector-width used inside the loop
  * - tries to find an optimal factor, which never exceeds 16 elements and divides the number of iterations equally
  */
-static Optional<unsigned> determineVectorizationFactor(const ControlFlowLoop& loop,
-    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound, Literal stepValue)
+static unsigned determineVectorizationFactor(const ControlFlowLoop& loop, unsigned iterations)
 {
     unsigned char maxTypeWidth = 1;
     InstructionWalker it = loop.front()->key->walk();
@@ -153,19 +60,12 @@ static Optional<unsigned> determineVectorizationFactor(const ControlFlowLoop& lo
         log << "Found maximum used vector-width of " << static_cast<unsigned>(maxTypeWidth) << " elements"
             << logging::endl);
 
-    // the number of iterations from the bounds depends on the iteration operation
-    auto iterations = calculateIterationCount(inductionVariable, lowerBound, upperBound, stepValue);
-    if(!iterations)
-        return {};
-
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Determined iteration count of " << *iterations << logging::endl);
-
     // find the biggest factor fitting into 16 SIMD-elements
     unsigned factor = 16 / maxTypeWidth;
     while(factor > 0)
     {
         // TODO factors not in [1,2,3,4,8,16] possible?? Should be from hardware-specification side
-        if((*iterations % factor) == 0)
+        if((iterations % factor) == 0)
             break;
         --factor;
     }
@@ -711,69 +611,50 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
 {
     if(method.empty())
         return false;
-    // 1. find loops
-    auto& cfg = method.getCFG();
-    auto loops = cfg.findLoops(false);
+    // 1. find loops and determine their iteration variables and bounds
+    auto& analyses = method.getAnalyses();
+    // copy the loop information, since the vectorization modifies the loops
+    auto loopInfos = analyses.getLoopInfos();
     bool hasChanged = false;
 
     // 2. determine data dependencies of loop bodies
-    auto dependencyGraph = DataDependencyGraph::createDependencyGraph(method);
+    // NOTE: the reference stays valid, even if the vectorization below invalidates the cached result
+    const auto& dependencyGraph = analyses.getDataDependencies();
 
-    for(auto& loop : loops)
+    for(auto& info : loopInfos)
     {
-        // 3. determine operation on iteration variable and bounds
-        auto inductionVariable = extractLoopControl(loop, *dependencyGraph);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 333, "Loops found", 1);
-        if(inductionVariable.local == nullptr)
-            // we could not find the iteration variable, skip this loop
+        if(!info.innerLoops.empty())
+            // only the inner-most loops are vectorized
             continue;
+        auto& loop = info.loop;
 
-        if(!inductionVariable.initialAssignment || !inductionVariable.inductionStep ||
-            !inductionVariable.repeatCondition || !inductionVariable.repeatCondition->first ||
-            inductionVariable.repeatCondition->second.isUndefined())
-        {
-            // we need to know both bounds and the iteration step (for now)
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Failed to find all bounds and step for loop, aborting vectorization!" << logging::endl);
+        // 3. determine operation on iteration variable and bounds
+        if(!info.iterationVariable)
+            // we could not find the (single) iteration variable, skip this loop
             continue;
-        }
-
-        auto lowerBound = (inductionVariable.initialAssignment->precalculate(4).first & &Value::getLiteralValue);
-        auto upperBound = inductionVariable.repeatCondition->second.getLiteralValue();
+        auto& inductionVariable = *info.iterationVariable;
 
-        if(!lowerBound || !upperBound)
+        if(!info.lowerBound || !info.upperBound || !info.stepValue)
         {
+            // we need to know both bounds and the iteration step (for now)
             CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Upper or lower bound is not a literal value, aborting vectorization!" << logging::endl);
+                log << "Failed to find all constant bounds and step for loop, aborting vectorization!"
+                    << logging::endl);
             continue;
         }
 
-        Optional<Literal> stepConstant{};
-        if(auto stepValue =
-                inductionVariable.inductionStep->findOtherArgument(inductionVariable.local->createReference()))
-        {
-            stepConstant =
-                ((stepValue->getSingleWriter() ? stepValue->getSingleWriter()->precalculate(4).first : stepValue) &
-                    &Value::getLiteralValue);
-        }
-
-        if(!stepConstant)
+        if(!info.tripCount)
         {
             CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Iteration step increment is not a literal value, aborting vectorization!" << logging::endl);
+                log << "Failed to determine the iteration count for the loop, aborting vectorization!"
+                    << logging::endl);
             continue;
         }
 
         // 4. determine vectorization factor
-        Optional<unsigned> vectorizationFactor =
-            determineVectorizationFactor(loop, inductionVariable, *lowerBound, *upperBound, *stepConstant);
-        if(!vectorizationFactor)
-        {
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Failed to determine a vectorization factor for the loop, aborting!" << logging::endl);
-            continue;
-        }
-        if(vectorizationFactor.value() == 1)
+        auto vectorizationFactor = determineVectorizationFactor(loop, *info.tripCount);
+        if(vectorizationFactor == 1)
         {
             // nothing to do
             CPPLOG_LAZY(logging::Level::DEBUG,
@@ -782,7 +663,7 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
         }
 
         // 5. cost-benefit calculation
-        int rating = calculateCostsVsBenefits(loop, inductionVariable, *dependencyGraph, *vectorizationFactor);
+        int rating = calculateCostsVsBenefits(loop, inductionVariable, dependencyGraph, vectorizationFactor);
         if(rating < 0 /* TODO some positive factor to be required before vectorizing loops? */)
         {
             // vectorization (probably) doesn't pay off
@@ -793,164 +674,1517 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
         }
 
         // 6. run vectorization
-        vectorize(loop, inductionVariable, method, *vectorizationFactor, *stepConstant);
+        vectorize(loop, inductionVariable, method, vectorizationFactor, *info.stepValue);
         // increasing the iteration step might create a value not fitting into small immediate
         normalization::handleImmediate(
             module, method, loop.findInLoop(inductionVariable.inductionStep).value(), config);
         hasChanged = true;
 
-        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 334, "Vectorization factors", *vectorizationFactor);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 334, "Vectorization factors", vectorizationFactor);
     }
 
     return hasChanged;
 }
 
-static NODISCARD InstructionWalker loadVectorParameter(Parameter& param, Method& method, InstructionWalker it)
+// the costs of executing a branch, e.g. a loop back-edge: the branch instruction itself and its 3 delay slots
+static constexpr unsigned BRANCH_COSTS = 4;
+// the maximum factor to partially unroll loops by
+static constexpr unsigned MAX_UNROLL_FACTOR = 16;
+// the minimum number of free registers within the loop to consider unrolling it
+static constexpr unsigned MIN_FREE_REGISTERS_FOR_UNROLLING = 4;
+
+/*
+ * Returns the number of instructions of the loop body, i.e. all instructions except the label and the branches at the
+ * end of the block, if the given single-block loop can be unrolled
+ */
+static Optional<unsigned> getUnrollableBodySize(const BasicBlock& block)
 {
-    // we need to load a UNIFORM per vector element into the particular vector element
-    for(uint8_t i = 0; i < param.type.getVectorWidth(); ++i)
+    unsigned numInstructions = 0;
+    bool branchFound = false;
+    for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
     {
-        // the first write to the parameter needs to unconditional, so the register allocator can find it
-        if(i > 0)
-        {
-            assign(it, NOP_REGISTER) =
-                (ELEMENT_NUMBER_REGISTER ^ Value(SmallImmediate(i), TYPE_INT8), SetFlag::SET_FLAGS);
-        }
-        if(has_flag(param.decorations, ParameterDecorations::SIGN_EXTEND))
-        {
-            it = intermediate::insertSignExtension(it, method, Value(REG_UNIFORM, param.type),
-                Value(&param, TYPE_INT32), false, i == 0 ? COND_ALWAYS : COND_ZERO_SET);
-            it.copy().previousInBlock()->addDecorations(intermediate::InstructionDecorations::ELEMENT_INSERTION);
-        }
-        else if(has_flag(param.decorations, ParameterDecorations::ZERO_EXTEND))
-        {
-            it = intermediate::insertZeroExtension(it, method, Value(REG_UNIFORM, param.type),
-                Value(&param, TYPE_INT32), false, i == 0 ? COND_ALWAYS : COND_ZERO_SET);
-            it.copy().previousInBlock()->addDecorations(intermediate::InstructionDecorations::ELEMENT_INSERTION);
-        }
-        else
-        {
-            assign(it, param.createReference()) =
-                (UNIFORM_REGISTER, i == 0 ? COND_ALWAYS : COND_ZERO_SET, InstructionDecorations::ELEMENT_INSERTION);
-        }
-        // TODO improve performance by first putting together the vector, then zero/sign extending all elements?
+        if(!it.has())
+            continue;
+        if(it.get<const intermediate::Branch>())
+            branchFound = true;
+        else if(branchFound)
+            // instructions between the branches are only executed when leaving the loop, cannot simply copy the body
+            return {};
+        else if(it->mapsToASMInstruction())
+            ++numInstructions;
     }
-    return it;
+    if(!branchFound)
+        return {};
+    return numInstructions;
 }
 
-static void generateStopSegment(Method& method)
+/*
+ * On the benefit-side, every loop iteration removed saves the branch to repeat the loop and its delay slots.
+ *
+ * On the cost-side, we have:
+ * - the increased code size. Since the loop body is executed repeatedly, the unrolled loop must still fit into the
+ *   instruction cache, otherwise we would introduce cache misses for every iteration
+ * - the possibly increased register pressure when the instructions of the unrolled iterations are scheduled together
+ *
+ * Returns the number of iterations to combine, i.e. the trip count for full unrolling and 1 for no unrolling at all.
+ */
+static unsigned determineUnrollFactor(unsigned tripCount, unsigned bodySize, bool allowFullUnroll,
+    const RegisterPressure& pressure, unsigned maxUnrolledSize)
 {
-    // write interrupt for host
-    // write QPU number finished (value must be NON-NULL, so we invert it -> the first 28 bits are always 1)
-    method.appendToEnd(
-        (new intermediate::Operation(OP_NOT, Value(REG_HOST_INTERRUPT, TYPE_INT8), Value(REG_QPU_NUMBER, TYPE_INT8)))
-            ->addDecorations(InstructionDecorations::WORK_GROUP_UNIFORM_VALUE));
-    auto nop = new intermediate::Nop(intermediate::DelayType::THREAD_END);
-    // set signals to stop thread/program
-    nop->setSignaling(SIGNAL_END_PROGRAM);
-    method.appendToEnd(nop);
-    method.appendToEnd(new intermediate::Nop(intermediate::DelayType::THREAD_END));
-    method.appendToEnd(new intermediate::Nop(intermediate::DelayType::THREAD_END));
-}
+    if(tripCount < 2 || bodySize == 0)
+        return 1;
+    if(pressure.getFreeRegisters() < MIN_FREE_REGISTERS_FOR_UNROLLING)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Not unrolling loop to not increase register pressure " << pressure.to_string() << logging::endl);
+        return 1;
+    }
+    if(allowFullUnroll && static_cast<uint64_t>(tripCount) * bodySize <= maxUnrolledSize)
+        return tripCount;
 
-static const Local* isLocalUsed(Method& method, BuiltinLocal::Type type)
-{
-    auto loc = method.findBuiltin(type);
-    if(loc != nullptr && !loc->getUsers(LocalUse::Type::READER).empty())
-        return loc;
-    return nullptr;
+    // find the largest factor fitting into the instruction cache and dividing the number of iterations equally, so we
+    // do not need to handle any remaining iterations
+    unsigned factor = std::min(std::min(MAX_UNROLL_FACTOR, tripCount - 1), maxUnrolledSize / bodySize);
+    while(factor > 1)
+    {
+        if((tripCount % factor) == 0)
+            break;
+        --factor;
+    }
+    return std::max(factor, 1u);
 }
 
-void optimizations::addStartStopSegment(const Module& module, Method& method, const Configuration& config)
+/*
+ * Inserts the given number of copies of the loop body in front of the original body. Since the number of iterations
+ * is a multiple of the unroll factor, the copies do not need to check the loop condition.
+ *
+ * For full unrolling, the loop branches are replaced with a branch to the block following the loop.
+ */
+static void unrollLoop(Method& method, BasicBlock& block, unsigned factor, const BasicBlock* exitBlock)
 {
-    auto it = method.walkAllInstructions();
-    if(it.isEndOfMethod() || !it.get<intermediate::BranchLabel>() ||
-        BasicBlock::DEFAULT_BLOCK != it.get<intermediate::BranchLabel>()->getLabel()->name)
+    FastAccessList<const intermediate::IntermediateInstruction*> body;
+    auto branchIt = block.walk().nextInBlock();
+    for(; !branchIt.isEndOfBlock(); branchIt.nextInBlock())
     {
-        it = method.createAndInsertNewBlock(method.begin(), BasicBlock::DEFAULT_BLOCK).walk();
+        if(branchIt.get<intermediate::Branch>())
+            break;
+        if(branchIt.has())
+            body.push_back(branchIt.get());
     }
-    it.nextInBlock();
 
-    // if the second TMU was used explicitly at some point, we disable TMU_SWAP
+    auto it = block.walk().nextInBlock();
+    for(unsigned i = 1; i < factor; ++i)
     {
-        bool tmu1Used = false;
-        auto checkIt = method.walkAllInstructions();
-        while(!checkIt.isEndOfMethod())
-        {
-            if(checkIt->writesRegister(REG_TMU1_ADDRESS))
-            {
-                tmu1Used = true;
-                break;
-            }
-            checkIt.nextInMethod();
-        }
-        if(tmu1Used)
+        for(auto inst : body)
         {
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Using both TMUs explicitly, disable automatic swapping!" << logging::endl);
-            assign(it, Value(REG_TMU_NOSWAP, TYPE_BOOL)) = BOOL_TRUE;
+            // copy the instruction, keeping all locals
+            intermediate::InlineMapping sameLocals;
+            for(const auto& pair : inst->getUsedLocals())
+                sameLocals.emplace(pair.first, pair.first);
+            it.emplace(inst->copyFor(method, "", sameLocals));
+            it.nextInBlock();
         }
     }
 
-    /*
-     * The first UNIFORMs are reserved for relaying information about the work-item and work-group
-     * - work_dim: number of dimensions
-     * - local_sizes: local number of work-items in its work-group per dimension
-     * - local_ids: local id of this work-item within its work-group
-     * - num_groups (x,y,z): global number of work-groups per dimension
-     * - group_id (x, y, z): id of this work-group
-     * - global_offset (x, y, z): global initial offset per dimension
-     * - address of global data / to load the global data from
-     *
-     */
-    // initially set all implicit UNIFORMs to unused
-    method.metaData.uniformsUsed.value = 0;
-    auto workInfoDecorations =
-        add_flag(InstructionDecorations::UNSIGNED_RESULT, InstructionDecorations::WORK_GROUP_UNIFORM_VALUE);
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::WORK_DIMENSIONS))
+    if(exitBlock)
     {
-        method.metaData.uniformsUsed.setWorkDimensionsUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT8), workInfoDecorations);
+        // all iterations are unrolled, remove the loop branches
+        while(!branchIt.isEndOfBlock())
+            branchIt.erase();
+        if(method.getNextBlockAfter(&block) != exitBlock)
+            branchIt.emplace(new intermediate::Branch(exitBlock->getLabel()->getLabel()));
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::LOCAL_SIZES))
+}
+
+bool optimizations::unrollLoops(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.empty())
+        return false;
+    auto& analyses = method.getAnalyses();
+    const auto& registerPressure = analyses.getRegisterPressure();
+
+    struct UnrollCandidate
     {
-        method.metaData.uniformsUsed.setLocalSizesUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+        BasicBlock* block;
+        unsigned factor;
+        // the block to continue with after a full unrolling
+        const BasicBlock* exitBlock;
+    };
+    FastAccessList<UnrollCandidate> candidates;
+    // keep the unrolled loop well within the instruction cache of the target hardware
+    const auto maxUnrolledSize =
+        std::min(config.additionalOptions.maxUnrolledLoopSize, config.target.instructionCacheSize / 2);
+
+    // determine all loops to unroll first, since the unrolling modifies the control flow and invalidates the analyses
+    for(const auto& info : analyses.getLoopInfos())
+    {
+        if(!info.innerLoops.empty() || info.loop.size() != 1 || info.loop.isWorkGroupLoop())
+            // only the inner-most loops consisting of a single basic block are unrolled
+            continue;
+        if(!info.tripCount)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Failed to determine the iteration count for the loop, aborting unrolling!" << logging::endl);
+            continue;
+        }
+        auto block = info.loop.front()->key;
+        if(module.executionProfile.isNeverExecuted(method, *block))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Not unrolling loop which is never executed according to the execution profile: "
+                    << info.loop.to_string() << logging::endl);
+            continue;
+        }
+        auto bodySize = getUnrollableBodySize(*block);
+        if(!bodySize)
+            continue;
+        auto successor = info.loop.findSuccessor();
+        auto factor = determineUnrollFactor(*info.tripCount, *bodySize, successor != nullptr,
+            registerPressure.getMaximumPressure(*block), maxUnrolledSize);
+        if(factor == 1)
+            continue;
+
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << (factor == *info.tripCount ? "Fully unrolling loop " : "Unrolling loop ") << info.loop.to_string()
+                << " with " << *info.tripCount << " iterations of " << *bodySize << " instructions by factor "
+                << factor << ", saving "
+                << (*info.tripCount - (factor == *info.tripCount ? 0 : *info.tripCount / factor)) * BRANCH_COSTS
+                << " cycles" << logging::endl);
+        candidates.emplace_back(UnrollCandidate{block, factor, factor == *info.tripCount ? successor->key : nullptr});
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::LOCAL_IDS))
+
+    for(const auto& candidate : candidates)
     {
-        method.metaData.uniformsUsed.setLocalIDsUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32),
-            remove_flag(workInfoDecorations, InstructionDecorations::WORK_GROUP_UNIFORM_VALUE));
+        unrollLoop(method, *candidate.block, candidate.factor, candidate.exitBlock);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 335, "Loops unrolled", 1);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 336, "Unroll factors", candidate.factor);
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::NUM_GROUPS_X))
+
+    return !candidates.empty();
+}
+
+/*
+ * A TMU or DMA load in a single-block loop which can be pipelined across loop iterations. The loop block is split into:
+ *   label: %loop
+ *   [address]   - the calculation of the load address, ending with the write of the TMU address register (or the
+ *                 release of the mutex after starting the DMA load)
+ *   [load]      - the nop triggering the TMU load and the read of the result from r4 (or the wait for the DMA load and
+ *                 the read of the result from VPM)
+ *   [body]      - the remaining loop body
+ *   [condition] - the setting of the flags for the loop branch and the loop branch(es)
+ */
+struct PipelinedLoad
+{
+    BasicBlock* block;
+    BasicBlock* preheader;
+    BasicBlock* exitBlock;
+    InstructionWalker addressWrite;
+    InstructionWalker condition;
+    // the signal triggering the TMU load, SIGNAL_NONE for DMA loads
+    Signaling signal;
+    // only for DMA loads: the DMA setup, the wait for the DMA load and the VPM read setup
+    InstructionWalker dmaSetup;
+    InstructionWalker dmaWait;
+    InstructionWalker vpmSetup;
+};
+
+static bool isAccessedOnlyInBlock(
+    const Local* loc, const FastSet<const intermediate::IntermediateInstruction*>& blockInstructions)
+{
+    bool onlyInBlock = true;
+    loc->forUsers(LocalUse::Type::BOTH, [&](const LocalUser* user) {
+        if(blockInstructions.find(user) == blockInstructions.end())
+            onlyInBlock = false;
+    });
+    return onlyInBlock;
+}
+
+/*
+ * Finds the end of the calculation of the load address at the beginning of the given loop block, i.e. the first
+ * instruction the predicate returns true for.
+ *
+ * Since the address calculation is executed once more after the last iteration (and the loaded value is discarded),
+ * it must not have any side-effects or write any local used outside of the loop.
+ */
+template <typename Predicate>
+static Optional<InstructionWalker> findAddressCalculationEnd(
+    BasicBlock& block, FastSet<const Local*>& addressLocals, const Predicate& isEnd)
+{
+    FastSet<const intermediate::IntermediateInstruction*> blockInstructions;
+    for(const auto& inst : block)
     {
-        method.metaData.uniformsUsed.setNumGroupsXUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+        if(inst)
+            blockInstructions.emplace(inst.get());
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::NUM_GROUPS_Y))
+
+    bool flagsSet = false;
+    auto it = block.walk().nextInBlock();
+    for(; !it.isEndOfBlock(); it.nextInBlock())
     {
-        method.metaData.uniformsUsed.setNumGroupsYUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+        if(!it.has())
+            continue;
+        if(isEnd(it))
+            return it;
+        if(it->hasConditionalExecution() && !flagsSet)
+            // depends on the flags set before the loop iteration, which change when moving the calculation
+            return {};
+        if(it->hasOtherSideEffects(SideEffectType::FLAGS) || it->checkOutputRegister() ||
+            it->readsRegister(REG_TMU_OUT) || it.get<intermediate::Branch>())
+            return {};
+        if(auto loc = it->checkOutputLocal())
+        {
+            if(!isAccessedOnlyInBlock(loc, blockInstructions))
+                return {};
+            addressLocals.emplace(loc);
+        }
+        flagsSet = flagsSet || it->doesSetFlag();
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::NUM_GROUPS_Z))
+    return {};
+}
+
+/*
+ * Finds the setting of the flags for the loop branch in the loop body starting at the given position.
+ *
+ * The remaining body must not depend on the flags set by the address calculation, the condition must only set flags
+ * and be directly followed by the loop branches.
+ */
+static Optional<InstructionWalker> findLoopCondition(
+    InstructionWalker bodyStart, const FastSet<const Local*>& addressLocals)
+{
+    bool flagsSet = false;
+    InstructionWalker condition{};
+    auto it = bodyStart;
+    for(; !it.isEndOfBlock(); it.nextInBlock())
     {
-        method.metaData.uniformsUsed.setNumGroupsZUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+        if(!it.has())
+            continue;
+        if(it.get<intermediate::Branch>())
+            break;
+        if(it->hasConditionalExecution() && !flagsSet)
+            return {};
+        if(it->doesSetFlag())
+        {
+            flagsSet = true;
+            condition = it;
+        }
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_ID_X))
+    if(it.isEndOfBlock() || !flagsSet)
+        return {};
+    for(it = condition; !it.isEndOfBlock(); it.nextInBlock())
     {
-        method.metaData.uniformsUsed.setGroupIDXUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+        if(!it.has())
+            continue;
+        if(it.get<intermediate::Branch>())
+            continue;
+        if(it->checkOutputLocal() || (it->checkOutputRegister() && !it->getOutput()->hasRegister(REG_NOP)))
+            return {};
+        for(const auto& arg : it->getArguments())
+        {
+            if(arg.checkLocal() && addressLocals.find(arg.local()) != addressLocals.end())
+                return {};
+        }
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_ID_Y))
+    return condition;
+}
+
+static Optional<PipelinedLoad> findPipelinedLoad(BasicBlock& block)
+{
+    // 1. the address calculation ends with the write of the TMU address
+    FastSet<const Local*> addressLocals;
+    auto addressIt = findAddressCalculationEnd(block, addressLocals, [](InstructionWalker it) -> bool {
+        return it->writesRegister(REG_TMU0_ADDRESS) || it->writesRegister(REG_TMU1_ADDRESS);
+    });
+    if(!addressIt || (*addressIt)->hasConditionalExecution() ||
+        (*addressIt)->hasOtherSideEffects(SideEffectType::REGISTER_WRITE) || (*addressIt)->getSignal() != SIGNAL_NONE)
+        return {};
+    auto addressWrite = *addressIt;
+    auto signal = addressWrite->writesRegister(REG_TMU0_ADDRESS) ? SIGNAL_LOAD_TMU0 : SIGNAL_LOAD_TMU1;
+
+    // 2. the load needs to be triggered and read directly after writing the address
+    auto loadIt = addressWrite.copy().nextInBlock();
+    if(loadIt.isEndOfBlock() || !loadIt.get<intermediate::Nop>() || loadIt->getSignal() != signal)
+        return {};
+    auto readIt = loadIt.copy().nextInBlock();
+    if(readIt.isEndOfBlock() || !readIt.get<intermediate::MoveOperation>() || !readIt->readsRegister(REG_TMU_OUT) ||
+        readIt->hasConditionalExecution() || !readIt->checkOutputLocal())
+        return {};
+
+    // 3. the condition must not depend on the address calculation
+    auto condition = findLoopCondition(readIt.copy().nextInBlock(), addressLocals);
+    if(!condition)
+        return {};
+    return PipelinedLoad{&block, nullptr, nullptr, addressWrite, *condition, signal, InstructionWalker{},
+        InstructionWalker{}, InstructionWalker{}};
+}
+
+/*
+ * Returns the constant value written into the VPM read setup register by the given instruction, if any
+ */
+static Optional<periphery::VPRSetup> getConstantReadSetup(InstructionWalker it)
+{
+    if(!it.has() || !it->writesRegister(REG_VPM_IN_SETUP) || it->hasConditionalExecution() ||
+        it->getSignal() != SIGNAL_NONE)
+        return {};
+    if(auto load = it.get<intermediate::LoadImmediate>())
     {
-        method.metaData.uniformsUsed.setGroupIDYUsed(true);
-        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+        if(load->type == intermediate::LoadType::REPLICATE_INT32)
+            return periphery::VPRSetup::fromLiteral(load->getImmediate().unsignedInt());
     }
-    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_ID_Z))
+    else if(auto move = it.get<intermediate::MoveOperation>())
     {
-        method.metaData.uniformsUsed.setGroupIDZUsed(true);
+        if(auto lit = move->getSource().getLiteralValue())
+            return periphery::VPRSetup::fromLiteral(lit->unsignedInt());
+    }
+    return {};
+}
+
+/*
+ * Matches a single 32-bit vector loaded via DMA into the VPM scratch area, as generated by periphery::insertReadDMA:
+ *   mutex_acq
+ *   vpr_setup = DMA setup
+ *   vpr_setup = stride setup
+ *   vpr_addr = %addr
+ *   - = vpr_wait
+ *   vpr_setup = VPM read setup
+ *   %val = vpm
+ *   mutex_rel
+ */
+static Optional<PipelinedLoad> findPipelinedDMALoad(BasicBlock& block)
+{
+    // 1. the address calculation ends with the locking of the mutex for the DMA load
+    FastSet<const Local*> addressLocals;
+    auto lockIt = findAddressCalculationEnd(block, addressLocals, [](InstructionWalker it) -> bool {
+        auto mutex = it.get<intermediate::MutexLock>();
+        return mutex && mutex->locksMutex();
+    });
+    if(!lockIt)
+        return {};
+
+    // 2. the DMA load needs to read a single row of 32-bit words into the scratch area
+    auto dmaSetupIt = lockIt->copy().nextInBlock();
+    auto dmaSetup = getConstantReadSetup(dmaSetupIt);
+    if(!dmaSetup || !dmaSetup->isDMASetup() || dmaSetup->dmaSetup.getAddress() != 0 ||
+        dmaSetup->dmaSetup.getNumberRows() != 1)
+        return {};
+    auto strideIt = dmaSetupIt.copy().nextInBlock();
+    auto strideSetup = getConstantReadSetup(strideIt);
+    if(!strideSetup || !strideSetup->isStrideSetup())
+        return {};
+    auto addressIt = strideIt.copy().nextInBlock();
+    if(addressIt.isEndOfBlock() || !addressIt.get<intermediate::MoveOperation>() ||
+        !addressIt->writesRegister(REG_VPM_DMA_LOAD_ADDR) || addressIt->hasConditionalExecution() ||
+        addressIt->getSignal() != SIGNAL_NONE)
+        return {};
+
+    // 3. the loaded row needs to be waited for and read directly after starting the DMA load
+    auto waitIt = addressIt.copy().nextInBlock();
+    if(waitIt.isEndOfBlock() || !waitIt->readsRegister(REG_VPM_DMA_LOAD_WAIT) || waitIt->checkOutputLocal())
+        return {};
+    auto vpmSetupIt = waitIt.copy().nextInBlock();
+    auto vpmSetup = getConstantReadSetup(vpmSetupIt);
+    if(!vpmSetup || !vpmSetup->isGenericSetup() || vpmSetup->genericSetup.getAddress() != 0 ||
+        vpmSetup->genericSetup.getSize() != 2 /* 32-bit words */ || vpmSetup->genericSetup.getNumber() != 1)
+        return {};
+    auto readIt = vpmSetupIt.copy().nextInBlock();
+    if(readIt.isEndOfBlock() || !readIt.get<intermediate::MoveOperation>() || !readIt->readsRegister(REG_VPM_IO) ||
+        readIt->hasConditionalExecution() || !readIt->checkOutputLocal() ||
+        readIt->checkOutputLocal()->type.getScalarBitCount() != 32)
+        return {};
+    auto unlockIt = readIt.copy().nextInBlock();
+    auto unlock = unlockIt.isEndOfBlock() ? nullptr : unlockIt.get<intermediate::MutexLock>();
+    if(!unlock || !unlock->releasesMutex())
+        return {};
+
+    // 4. the condition must not depend on the address calculation
+    auto condition = findLoopCondition(unlockIt.copy().nextInBlock(), addressLocals);
+    if(!condition)
+        return {};
+    return PipelinedLoad{
+        &block, nullptr, nullptr, addressIt, *condition, SIGNAL_NONE, dmaSetupIt, waitIt, vpmSetupIt};
+}
+
+/*
+ * Moves the DMA load into a per-QPU row of the given VPM area and splits the mutex-protected region of the DMA load
+ * into the starting of the DMA and the waiting for and reading of the loaded data:
+ *
+ *   mutex_acq
+ *   vpr_setup = DMA setup
+ *   vpr_setup = stride setup
+ *   vpr_addr = %addr
+ *   - = vpr_wait
+ *   vpr_setup = VPM read setup
+ *   %val = vpm
+ *   mutex_rel
+ *
+ * is converted to:
+ *   mutex_acq
+ *   %vpr_setup = DMA setup for area
+ *   %vpm_row = shl qpu_num, 4
+ *   vpr_setup = add %vpr_setup, %vpm_row
+ *   vpr_setup = stride setup
+ *   vpr_addr = %addr
+ *   mutex_rel
+ *   mutex_acq
+ *   - = vpr_wait
+ *   %vpr_setup = VPM read setup for area
+ *   vpr_setup = add %vpr_setup, qpu_num
+ *   %val = vpm
+ *   mutex_rel
+ *
+ * Since every QPU loads into its own VPM row, the mutex does not need to be held while the DMA load is executed.
+ */
+static void splitDMALoad(Method& method, PipelinedLoad& load, const periphery::VPMArea& area)
+{
+    auto it = load.dmaSetup;
+    auto dmaSetup = getConstantReadSetup(it).value();
+    dmaSetup.dmaSetup.setWordRow(area.rowOffset);
+    auto setup = method.addNewLocal(TYPE_INT32, "%vpr_setup");
+    it.emplace(new intermediate::LoadImmediate(setup, Literal(dmaSetup.value)));
+    it->addDecorations(intermediate::InstructionDecorations::VPM_READ_CONFIGURATION);
+    it.nextInBlock();
+    auto rowOffset = assign(it, TYPE_INT32, "%vpm_row") = Value(REG_QPU_NUMBER, TYPE_INT8) << 4_val;
+    assign(it, VPM_IN_SETUP_REGISTER) =
+        (setup + rowOffset, intermediate::InstructionDecorations::VPM_READ_CONFIGURATION);
+    it.erase();
+
+    it = load.vpmSetup;
+    auto vpmSetup = getConstantReadSetup(it).value();
+    vpmSetup.genericSetup.setAddress(area.rowOffset);
+    setup = method.addNewLocal(TYPE_INT32, "%vpr_setup");
+    it.emplace(new intermediate::LoadImmediate(setup, Literal(vpmSetup.value)));
+    it->addDecorations(intermediate::InstructionDecorations::VPM_READ_CONFIGURATION);
+    it.nextInBlock();
+    assign(it, VPM_IN_SETUP_REGISTER) = (setup + Value(REG_QPU_NUMBER, TYPE_INT8),
+        intermediate::InstructionDecorations::VPM_READ_CONFIGURATION);
+    it.erase();
+
+    // release the mutex after starting the DMA load and re-acquire it for waiting for the load
+    it = load.dmaWait;
+    it.emplace(new intermediate::MutexLock(intermediate::MutexAccess::LOCK));
+    it.emplace(new intermediate::MutexLock(intermediate::MutexAccess::RELEASE));
+    load.addressWrite = it;
+}
+
+/*
+ * Rotates the loop, so the TMU or DMA load of the next iteration is issued at the end of the current iteration:
+ *
+ *   [preheader]
+ *   label: %loop
+ *   [address]
+ *   [load]
+ *   [body]
+ *   [condition]
+ *   label: %exit
+ *
+ * is converted to:
+ *   [preheader]
+ *   [address]
+ *   label: %loop
+ *   [load]
+ *   [body]
+ *   [address]
+ *   [condition]
+ *   label: %exit
+ *   nop (ldtmu)
+ *
+ * Since the load for the iteration following the last one is issued too, it is drained when leaving the loop (by
+ * waiting for the DMA load to finish for DMA loads).
+ */
+static void pipelineLoad(Method& method, const PipelinedLoad& load)
+{
+    // copy the initial address calculation into the preheader, in front of the (unconditional) branch to the loop
+    auto preheaderIt = load.preheader->walk().nextInBlock();
+    while(!preheaderIt.isEndOfBlock() && !preheaderIt.get<intermediate::Branch>())
+        preheaderIt.nextInBlock();
+    for(auto it = load.block->walk().nextInBlock();; it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        intermediate::InlineMapping sameLocals;
+        for(const auto& pair : it->getUsedLocals())
+            sameLocals.emplace(pair.first, pair.first);
+        preheaderIt.emplace(it->copyFor(method, "", sameLocals));
+        preheaderIt.nextInBlock();
+        if(it == load.addressWrite)
+            break;
+    }
+
+    // move the address calculation in the loop in front of the loop condition
+    auto conditionIt = load.condition;
+    auto it = load.block->walk().nextInBlock();
+    bool isAddressWrite = false;
+    while(!isAddressWrite)
+    {
+        isAddressWrite = it == load.addressWrite;
+        if(it.has())
+        {
+            conditionIt.emplace(it.release());
+            conditionIt.nextInBlock();
+        }
+        it.erase();
+    }
+
+    // drain the additional load issued by the last iteration
+    auto exitIt = load.exitBlock->walk().nextInBlock();
+    if(load.signal == SIGNAL_NONE)
+    {
+        exitIt.emplace(new intermediate::MutexLock(intermediate::MutexAccess::LOCK));
+        exitIt.nextInBlock();
+        assign(exitIt, NOP_REGISTER) = VPM_DMA_LOAD_WAIT_REGISTER;
+        exitIt.emplace(new intermediate::MutexLock(intermediate::MutexAccess::RELEASE));
+    }
+    else
+        nop(exitIt, intermediate::DelayType::WAIT_TMU, load.signal);
+}
+
+bool optimizations::pipelineLoopLoads(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.empty())
+        return false;
+    FastAccessList<PipelinedLoad> loads;
+
+    for(const auto& info : method.getAnalyses().getLoopInfos())
+    {
+        if(!info.innerLoops.empty() || info.loop.size() != 1 || info.loop.isWorkGroupLoop())
+            // only the inner-most loops consisting of a single basic block are pipelined
+            continue;
+        auto loopNode = info.loop.front();
+        // the initial load is issued in the single block leading into the loop and drained in the single block
+        // following the loop, so these blocks must not be reachable by any other path
+        auto predecessor = info.loop.findPredecessor();
+        auto successor = info.loop.findSuccessor();
+        if(!predecessor || predecessor->getSingleSuccessor() != loopNode || !successor ||
+            successor->getSinglePredecessor() != loopNode)
+            continue;
+        bool hasConditionalBranch = false;
+        for(auto it = predecessor->key->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(auto branch = it.get<intermediate::Branch>())
+                hasConditionalBranch = hasConditionalBranch || !branch->isUnconditional();
+        }
+        if(hasConditionalBranch)
+            continue;
+
+        auto load = findPipelinedLoad(*loopNode->key);
+        if(!load && method.vpm)
+            load = findPipelinedDMALoad(*loopNode->key);
+        if(load)
+        {
+            load->preheader = predecessor->key;
+            load->exitBlock = successor->key;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Pipelining " << (load->signal == SIGNAL_NONE ? "DMA" : "TMU")
+                    << " load across iterations of loop " << info.loop.to_string() << ": "
+                    << load->addressWrite->to_string() << logging::endl);
+            loads.emplace_back(*load);
+        }
+    }
+
+    bool changedCode = false;
+    for(auto& load : loads)
+    {
+        if(load.signal == SIGNAL_NONE)
+        {
+            // the next row is loaded while the current one is processed, so every QPU needs its own VPM row
+            auto area = method.vpm->addPerQPUArea(load.vpmSetup.copy().nextInBlock()->checkOutputLocal(),
+                periphery::VPMUsage::DMA_BUFFER);
+            if(!area)
+                continue;
+            splitDMALoad(method, load, *area);
+            PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 344, "Pipelined loop DMA loads", 1);
+        }
+        pipelineLoad(method, load);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 337, "Pipelined loop loads", 1);
+        changedCode = true;
+    }
+    return changedCode;
+}
+
+/*
+ * A value linear in the induction variable i of a loop, i.e. of the form factor * i + base + offset (modulo 2^32)
+ */
+struct LinearValue
+{
+    uint32_t factor;
+    // the loop-invariant local added to the value, if any
+    const Local* base;
+    uint32_t offset;
+    // the instructions within the loop block calculating the value from the induction variable
+    FastSet<const IntermediateInstruction*> chain;
+};
+
+/*
+ * Returns the constant value of the given operand, either directly or by its single immediate load
+ */
+static Optional<Literal> getConstantOperand(const Value& val)
+{
+    if(auto lit = val.getLiteralValue())
+        return lit;
+    auto load = dynamic_cast<const intermediate::LoadImmediate*>(val.getSingleWriter());
+    if(load && load->type == intermediate::LoadType::REPLICATE_INT32 && !load->hasConditionalExecution())
+        return load->getImmediate();
+    return {};
+}
+
+static bool isLoopInvariant(const Value& val, const FastSet<const IntermediateInstruction*>& loopInstructions)
+{
+    auto loc = val.checkLocal();
+    if(!loc || loc->is<Global>())
+        return false;
+    const auto& writers = loc->getUsers(LocalUse::Type::WRITER);
+    return std::none_of(writers.begin(), writers.end(),
+        [&](const LocalUser* writer) -> bool { return loopInstructions.find(writer) != loopInstructions.end(); });
+}
+
+/*
+ * Determines whether the given instruction calculates a value linear in the induction variable from the induction
+ * variable itself, the linear values calculated so far, constants and loop-invariant locals.
+ */
+static Optional<LinearValue> toLinearValue(InstructionWalker it, const Local* inductionVariable,
+    const FastMap<const Local*, LinearValue>& linearValues,
+    const FastSet<const IntermediateInstruction*>& loopInstructions, const FastMap<const Local*, ValueRange>& ranges)
+{
+    auto loc = it->checkOutputLocal();
+    if(!loc || loc == inductionVariable || !loc->type.isIntegralType() || it->hasConditionalExecution() ||
+        it->hasSideEffects() || it->doesSetFlag() || it->hasPackMode() || it->hasUnpackMode() ||
+        loc->getUsers(LocalUse::Type::WRITER).size() != 1)
+        return {};
+    auto getLinearOperand = [&](const Value& arg) -> Optional<LinearValue> {
+        if(arg.checkLocal() == inductionVariable)
+            return LinearValue{1, nullptr, 0, {}};
+        auto valIt = arg.checkLocal() ? linearValues.find(arg.local()) : linearValues.end();
+        if(valIt != linearValues.end())
+            return valIt->second;
+        return {};
+    };
+
+    Optional<LinearValue> result;
+    auto move = it.get<const MoveOperation>();
+    auto op = it.get<const Operation>();
+    if(move && move->isSimpleMove())
+        result = getLinearOperand(move->getSource());
+    else if(op && op->getArguments().size() == 2)
+    {
+        const auto& firstArg = op->getFirstArg();
+        const auto& secondArg = op->assertArgument(1);
+        auto firstLinear = getLinearOperand(firstArg);
+        auto secondLinear = getLinearOperand(secondArg);
+        auto secondConstant = getConstantOperand(secondArg);
+        if(op->op == OP_SHL && firstLinear && !firstLinear->base && secondConstant &&
+            secondConstant->unsignedInt() < 32)
+        {
+            result = firstLinear;
+            result->factor <<= secondConstant->unsignedInt();
+            result->offset <<= secondConstant->unsignedInt();
+        }
+        else if(op->op == OP_MUL24 && (firstLinear || secondLinear))
+        {
+            // mul24 only calculates the correct product if both operands fit into 24 bits
+            auto linear = firstLinear ? firstLinear : secondLinear;
+            const auto& linearArg = firstLinear ? firstArg : secondArg;
+            auto constant = getConstantOperand(firstLinear ? secondArg : firstArg);
+            auto rangeIt = ranges.find(linearArg.local());
+            if(!linear->base && constant && constant->unsignedInt() < (1u << 24) && rangeIt != ranges.end() &&
+                rangeIt->second.fitsIntoRange(ValueRange(0.0, static_cast<double>((1u << 24) - 1u))))
+            {
+                result = linear;
+                result->factor *= constant->unsignedInt();
+                result->offset *= constant->unsignedInt();
+            }
+        }
+        else if(op->op == OP_ADD || op->op == OP_SUB)
+        {
+            auto firstConstant = getConstantOperand(firstArg);
+            bool isSub = op->op == OP_SUB;
+            if(firstLinear && secondLinear && (!firstLinear->base || !secondLinear->base) &&
+                (!isSub || !secondLinear->base))
+            {
+                result = firstLinear;
+                result->factor = isSub ? firstLinear->factor - secondLinear->factor :
+                                         firstLinear->factor + secondLinear->factor;
+                result->offset = isSub ? firstLinear->offset - secondLinear->offset :
+                                         firstLinear->offset + secondLinear->offset;
+                result->base = firstLinear->base ? firstLinear->base : secondLinear->base;
+                result->chain.insert(secondLinear->chain.begin(), secondLinear->chain.end());
+            }
+            else if(firstLinear && secondConstant)
+            {
+                result = firstLinear;
+                result->offset = isSub ? firstLinear->offset - secondConstant->unsignedInt() :
+                                         firstLinear->offset + secondConstant->unsignedInt();
+            }
+            else if(!isSub && secondLinear && firstConstant)
+            {
+                result = secondLinear;
+                result->offset += firstConstant->unsignedInt();
+            }
+            else if(firstLinear && !firstLinear->base && !isSub && isLoopInvariant(secondArg, loopInstructions))
+            {
+                result = firstLinear;
+                result->base = secondArg.local();
+            }
+            else if(secondLinear && !secondLinear->base && !isSub && isLoopInvariant(firstArg, loopInstructions))
+            {
+                result = secondLinear;
+                result->base = firstArg.local();
+            }
+        }
+    }
+    if(result)
+        result->chain.emplace(it.get());
+    return result;
+}
+
+/*
+ * Returns the number of (non-move) instructions which calculate only the given root value and can therefore be
+ * removed after the root value is replaced with a running value
+ */
+static unsigned countExclusiveInstructions(const IntermediateInstruction* root, const LinearValue& value)
+{
+    unsigned count = 0;
+    for(auto inst : value.chain)
+    {
+        if(dynamic_cast<const MoveOperation*>(inst))
+            continue;
+        // the root instruction itself is always replaced
+        const auto& readers = inst->checkOutputLocal()->getUsers(LocalUse::Type::READER);
+        if(inst == root || std::all_of(readers.begin(), readers.end(), [&](const LocalUser* reader) -> bool {
+               return value.chain.find(reader) != value.chain.end();
+           }))
+            ++count;
+    }
+    return count;
+}
+
+struct StrengthReducedValue
+{
+    InstructionWalker root;
+    LinearValue value;
+};
+
+/*
+ * Finds all values linear in the given induction variable calculated in the given loop block which are used in
+ * another way than for calculating further linear values.
+ */
+static FastAccessList<StrengthReducedValue> findStrengthReducibleValues(BasicBlock& block,
+    const InductionVariable& inductionVariable, const FastSet<const IntermediateInstruction*>& loopInstructions,
+    const FastMap<const Local*, ValueRange>& ranges)
+{
+    FastMap<const Local*, LinearValue> linearValues;
+    FastAccessList<StrengthReducedValue> candidates;
+    FastSet<const IntermediateInstruction*> chainInstructions;
+    for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(it->writesLocal(inductionVariable.local))
+        {
+            // any value calculated afterwards uses the new value of the induction variable
+            linearValues.clear();
+            continue;
+        }
+        if(auto value = toLinearValue(it, inductionVariable.local, linearValues, loopInstructions, ranges))
+        {
+            linearValues[it->checkOutputLocal()] = *value;
+            chainInstructions.emplace(it.get());
+            if(value->factor != 0 && it.get() != inductionVariable.inductionStep)
+                candidates.emplace_back(StrengthReducedValue{it, *value});
+        }
+    }
+
+    FastAccessList<StrengthReducedValue> values;
+    for(auto& candidate : candidates)
+    {
+        // the linear values only used to calculate other linear values are replaced with them
+        const auto& readers = candidate.root->checkOutputLocal()->getUsers(LocalUse::Type::READER);
+        if(std::all_of(readers.begin(), readers.end(), [&](const LocalUser* reader) -> bool {
+               return chainInstructions.find(reader) != chainInstructions.end();
+           }))
+            continue;
+        // only replace the calculation with a single addition per iteration if it saves instructions
+        if(countExclusiveInstructions(candidate.root.get(), candidate.value) < 2)
+            continue;
+        values.emplace_back(std::move(candidate));
+    }
+    return values;
+}
+
+/*
+ * Initializes the running value in the loop preheader by copying the calculation of the value from the initial value
+ * of the induction variable and inserts the update of the running value next to the update of the induction variable
+ */
+static void insertRunningValue(Method& method, const Module& module, const Configuration& config,
+    InstructionWalker preheaderIt, InstructionWalker inductionWrite, const StrengthReducedValue& reduced,
+    uint32_t inductionDelta, const Local* runningValue)
+{
+    intermediate::InlineMapping mapping;
+    mapping.emplace(reduced.root->checkOutputLocal(), runningValue);
+    for(auto it = reduced.root.getBasicBlock()->walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has() || reduced.value.chain.find(it.get()) == reduced.value.chain.end())
+            continue;
+        for(const auto& pair : it->getUsedLocals())
+        {
+            if(has_flag(pair.second, LocalUse::Type::READER) && mapping.find(pair.first) == mapping.end())
+                mapping.emplace(pair.first, pair.first);
+        }
+        auto out = it->checkOutputLocal();
+        if(mapping.find(out) == mapping.end())
+            mapping.emplace(out, method.addNewLocal(out->type, "%strength_reduced").local());
+        auto copy = it->copyFor(method, "", mapping);
+        for(std::size_t i = 0; i < copy->getArguments().size(); ++i)
+        {
+            // the immediate loads inside the loop are not executed yet
+            auto arg = copy->assertArgument(i);
+            auto constant = arg.checkLocal() ? getConstantOperand(arg) : Optional<Literal>{};
+            if(constant)
+                copy->setArgument(i, Value(*constant, arg.type));
+        }
+        preheaderIt.emplace(copy);
+        preheaderIt = normalization::handleImmediate(module, method, preheaderIt, config);
+        preheaderIt.nextInBlock();
+        if(it.get() == reduced.root.get())
+            break;
+    }
+
+    auto updateIt = inductionWrite.copy().nextInBlock();
+    updateIt.emplace(new Operation(OP_ADD, runningValue->createReference(), runningValue->createReference(),
+        Value(Literal(inductionDelta * reduced.value.factor), runningValue->type)));
+    normalization::handleImmediate(module, method, updateIt, config);
+}
+
+bool optimizations::reduceStrengthInLoops(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.empty())
+        return false;
+    bool changedCode = false;
+    auto& analyses = method.getAnalyses();
+    const auto& ranges = analyses.getValueRanges();
+
+    for(const auto& info : analyses.getLoopInfos())
+    {
+        auto predecessor = info.loop.findPredecessor();
+        if(info.loop.isWorkGroupLoop() || !predecessor)
+            continue;
+        auto preheaderIt = predecessor->key->walk().nextInBlock();
+        while(!preheaderIt.isEndOfBlock() && !preheaderIt.get<intermediate::Branch>())
+            preheaderIt.nextInBlock();
+
+        for(const auto& inductionVariable : info.inductionVariables)
+        {
+            auto step = inductionVariable.inductionStep;
+            if(!step || (step->op != OP_ADD && step->op != OP_SUB) || !inductionVariable.local->type.isIntegralType())
+                continue;
+            Optional<Literal> stepValue;
+            if(step->op == OP_SUB)
+                stepValue = getConstantOperand(step->assertArgument(1));
+            else
+                stepValue = getConstantOperand(step->getFirstArg()) | getConstantOperand(step->assertArgument(1));
+            if(!stepValue)
+                continue;
+            uint32_t delta = step->op == OP_SUB ? 0u - stepValue->unsignedInt() : stepValue->unsignedInt();
+
+            // the instructions of the loop are (re-)collected, since previous replacements changed the loop
+            FastSet<const IntermediateInstruction*> loopInstructions;
+            for(auto node : info.loop)
+            {
+                for(auto it = node->key->walk(); !it.isEndOfBlock(); it.nextInBlock())
+                {
+                    if(it.has())
+                        loopInstructions.emplace(it.get());
+                }
+            }
+
+            // the running values are updated together with the only (unconditional) write of the induction variable
+            // inside the loop
+            Optional<InstructionWalker> inductionWrite;
+            unsigned numWrites = 0;
+            for(auto writer : inductionVariable.local->getUsers(LocalUse::Type::WRITER))
+            {
+                if(loopInstructions.find(writer) == loopInstructions.end())
+                    continue;
+                ++numWrites;
+                if(!writer->hasConditionalExecution())
+                    inductionWrite = info.loop.findInLoop(writer);
+            }
+            if(numWrites != 1 || !inductionWrite)
+                continue;
+
+            for(auto node : info.loop)
+            {
+                // the roots are only replaced after all calculations are copied, since they might be part of the
+                // calculations of other roots
+                FastAccessList<std::pair<InstructionWalker, const Local*>> replacedRoots;
+                for(auto& reduced :
+                    findStrengthReducibleValues(*node->key, inductionVariable, loopInstructions, ranges))
+                {
+                    // the values read by the calculation need to be the same at the end of the preheader
+                    bool isOverwritten = false;
+                    for(auto it = preheaderIt.copy(); !it.isEndOfBlock(); it.nextInBlock())
+                    {
+                        auto out = it.has() ? it->checkOutputLocal() : nullptr;
+                        auto readsOutput = [&](const IntermediateInstruction* inst) -> bool {
+                            return inst->readsLocal(out);
+                        };
+                        isOverwritten = isOverwritten ||
+                            (out && std::any_of(reduced.value.chain.begin(), reduced.value.chain.end(), readsOutput));
+                    }
+                    if(isOverwritten)
+                        continue;
+
+                    CPPLOG_LAZY(logging::Level::DEBUG,
+                        log << "Replacing calculation of value linear in induction variable "
+                            << inductionVariable.local->to_string() << " with running value: "
+                            << reduced.root->to_string() << logging::endl);
+                    auto runningValue =
+                        method.addNewLocal(reduced.root->checkOutputLocal()->type, "%strength_reduced").local();
+                    insertRunningValue(
+                        method, module, config, preheaderIt, *inductionWrite, reduced, delta, runningValue);
+                    replacedRoots.emplace_back(reduced.root, runningValue);
+                }
+                for(auto& root : replacedRoots)
+                {
+                    auto out = root.first->getOutput().value();
+                    root.first.reset((new MoveOperation(out, root.second->createReference()))
+                                         ->copyExtrasFrom(root.first.get()));
+                    changedCode = true;
+                    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 341, "Strength reduced values", 1);
+                }
+            }
+        }
+    }
+    return changedCode;
+}
+
+/*
+ * Returns whether the given loop-invariant instruction can be moved in front of the loop, i.e. it is executed
+ * unconditionally, has no side-effects (and therefore can be executed speculatively) and only reads values not written
+ * inside the loop or written by instructions already selected to be moved out of the loop
+ */
+static bool isHoistable(const IntermediateInstruction& inst,
+    const FastSet<const IntermediateInstruction*>& loopInstructions,
+    const FastSet<const IntermediateInstruction*>& hoistedInstructions)
+{
+    auto move = dynamic_cast<const MoveOperation*>(&inst);
+    if(!dynamic_cast<const Operation*>(&inst) && !dynamic_cast<const intermediate::LoadImmediate*>(&inst) &&
+        !(move && move->isSimpleMove()))
+        return false;
+    if(inst.hasConditionalExecution() || inst.doesSetFlag() || inst.hasSideEffects())
+        return false;
+    auto out = inst.checkOutputLocal();
+    if(!out || out->getUsers(LocalUse::Type::WRITER).size() != 1)
+        // the output would be overwritten inside the loop
+        return false;
+    auto isWrittenOnlyOutside = [&](const LocalUser* writer) -> bool {
+        return loopInstructions.find(writer) == loopInstructions.end() ||
+            hoistedInstructions.find(writer) != hoistedInstructions.end();
+    };
+    return std::all_of(inst.getArguments().begin(), inst.getArguments().end(), [&](const Value& arg) -> bool {
+        if(arg.getLiteralValue() || arg.hasRegister(REG_ELEMENT_NUMBER) || arg.hasRegister(REG_QPU_NUMBER))
+            return true;
+        if(auto loc = arg.checkLocal())
+        {
+            auto writers = loc->getUsers(LocalUse::Type::WRITER);
+            return std::all_of(writers.begin(), writers.end(), isWrittenOnlyOutside);
+        }
+        return false;
+    });
+}
+
+/*
+ * Moves the invariant instructions of the given loop in front of the branch of the loop preheader into the loop.
+ *
+ * Returns the number of moved instructions.
+ */
+static unsigned hoistLoopInvariants(Method& method, const LoopInfo& info)
+{
+    auto predecessor = info.loop.findPredecessor();
+    if(!predecessor || info.loop.isWorkGroupLoop())
+        return 0;
+
+    FastSet<const IntermediateInstruction*> loopInstructions;
+    for(auto node : info.loop)
+    {
+        for(auto it = node->key->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has())
+                loopInstructions.emplace(it.get());
+        }
+    }
+
+    // Hoisting an instruction extends the life-time of its output to the whole loop, so only as many instructions are
+    // moved as there are registers free within the loop, to not force locals to be spilled.
+    const auto& registerPressure = method.getAnalyses().getRegisterPressure();
+    auto freeRegisters = std::numeric_limits<unsigned>::max();
+    for(auto node : info.loop)
+        freeRegisters = std::min(freeRegisters, registerPressure.getMaximumPressure(*node->key).getFreeRegisters());
+
+    // the invariance determined by the loop is only a first approximation, since it does not consider side-effects
+    // and may consider locals written by instructions which cannot be moved as invariant
+    auto loop = info.loop;
+    auto candidates = loop.findLoopInvariants();
+    FastSet<const IntermediateInstruction*> hoistedInstructions;
+    FastAccessList<InstructionWalker> hoistedWalkers;
+    bool foundNewInstruction = true;
+    while(foundNewInstruction && freeRegisters > 0)
+    {
+        foundNewInstruction = false;
+        for(auto node : info.loop)
+        {
+            for(auto it = node->key->walk(); !it.isEndOfBlock() && freeRegisters > 0; it.nextInBlock())
+            {
+                if(!it.has() || candidates.find(it) == candidates.end() ||
+                    hoistedInstructions.find(it.get()) != hoistedInstructions.end() ||
+                    !isHoistable(*it.get(), loopInstructions, hoistedInstructions))
+                    continue;
+                hoistedInstructions.emplace(it.get());
+                hoistedWalkers.emplace_back(it);
+                foundNewInstruction = true;
+                --freeRegisters;
+            }
+        }
+    }
+    if(hoistedWalkers.empty())
+        return 0;
+
+    auto preheaderIt = predecessor->key->walk().nextInBlock();
+    while(!preheaderIt.isEndOfBlock() && !preheaderIt.get<intermediate::Branch>())
+        preheaderIt.nextInBlock();
+    // the values read by the moved instructions need to be the same before the branch as on entering the loop
+    for(auto it = preheaderIt.copy(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        auto out = it.has() ? it->checkOutputLocal() : nullptr;
+        if(out &&
+            std::any_of(hoistedInstructions.begin(), hoistedInstructions.end(),
+                [&](const IntermediateInstruction* inst) -> bool { return inst->readsLocal(out); }))
+            return 0;
+    }
+
+    for(auto& it : hoistedWalkers)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Moving loop invariant instruction out of loop " << info.loop.to_string() << ": " << it->to_string()
+                << logging::endl);
+        preheaderIt.emplace(it.release());
+        preheaderIt.nextInBlock();
+        it.erase();
+    }
+    return static_cast<unsigned>(hoistedWalkers.size());
+}
+
+bool optimizations::moveLoopInvariantCode(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.empty())
+        return false;
+    const auto& infos = method.getAnalyses().getLoopInfos();
+    // the inner-most loops are handled first, so their invariant instructions moved into the outer loops can be moved
+    // further out
+    FastAccessList<const LoopInfo*> loops;
+    loops.reserve(infos.size());
+    for(const auto& info : infos)
+        loops.emplace_back(&info);
+    std::stable_sort(loops.begin(), loops.end(),
+        [](const LoopInfo* one, const LoopInfo* other) -> bool { return one->nestingDepth > other->nestingDepth; });
+
+    unsigned numMoved = 0;
+    for(auto info : loops)
+        numMoved += hoistLoopInvariants(method, *info);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 342, "Loop invariant instructions moved", numMoved);
+    return numMoved > 0;
+}
+
+static NODISCARD InstructionWalker loadVectorParameter(Parameter& param, Method& method, InstructionWalker it)
+{
+    // we need to load a UNIFORM per vector element into the particular vector element
+    for(uint8_t i = 0; i < param.type.getVectorWidth(); ++i)
+    {
+        // the first write to the parameter needs to unconditional, so the register allocator can find it
+        if(i > 0)
+        {
+            assign(it, NOP_REGISTER) =
+                (ELEMENT_NUMBER_REGISTER ^ Value(SmallImmediate(i), TYPE_INT8), SetFlag::SET_FLAGS);
+        }
+        if(has_flag(param.decorations, ParameterDecorations::SIGN_EXTEND))
+        {
+            it = intermediate::insertSignExtension(it, method, Value(REG_UNIFORM, param.type),
+                Value(&param, TYPE_INT32), false, i == 0 ? COND_ALWAYS : COND_ZERO_SET);
+            it.copy().previousInBlock()->addDecorations(intermediate::InstructionDecorations::ELEMENT_INSERTION);
+        }
+        else if(has_flag(param.decorations, ParameterDecorations::ZERO_EXTEND))
+        {
+            it = intermediate::insertZeroExtension(it, method, Value(REG_UNIFORM, param.type),
+                Value(&param, TYPE_INT32), false, i == 0 ? COND_ALWAYS : COND_ZERO_SET);
+            it.copy().previousInBlock()->addDecorations(intermediate::InstructionDecorations::ELEMENT_INSERTION);
+        }
+        else
+        {
+            assign(it, param.createReference()) =
+                (UNIFORM_REGISTER, i == 0 ? COND_ALWAYS : COND_ZERO_SET, InstructionDecorations::ELEMENT_INSERTION);
+        }
+        // TODO improve performance by first putting together the vector, then zero/sign extending all elements?
+    }
+    return it;
+}
+
+static void generateStopSegment(Method& method)
+{
+    // write interrupt for host
+    // write QPU number finished (value must be NON-NULL, so we invert it -> the first 28 bits are always 1)
+    method.appendToEnd(
+        (new intermediate::Operation(OP_NOT, Value(REG_HOST_INTERRUPT, TYPE_INT8), Value(REG_QPU_NUMBER, TYPE_INT8)))
+            ->addDecorations(InstructionDecorations::WORK_GROUP_UNIFORM_VALUE));
+    auto nop = new intermediate::Nop(intermediate::DelayType::THREAD_END);
+    // set signals to stop thread/program
+    nop->setSignaling(SIGNAL_END_PROGRAM);
+    method.appendToEnd(nop);
+    method.appendToEnd(new intermediate::Nop(intermediate::DelayType::THREAD_END));
+    method.appendToEnd(new intermediate::Nop(intermediate::DelayType::THREAD_END));
+}
+
+static const Local* isLocalUsed(Method& method, BuiltinLocal::Type type)
+{
+    auto loc = method.findBuiltin(type);
+    if(loc != nullptr && !loc->getUsers(LocalUse::Type::READER).empty())
+        return loc;
+    return nullptr;
+}
+
+static Optional<UniformExpression::OpCode> getUniformExpressionOperation(const IntermediateInstruction& inst)
+{
+    using Code = UniformExpression::OpCode;
+    if(auto intrinsic = dynamic_cast<const IntrinsicOperation*>(&inst))
+        return intrinsic->opCode == "mul" ? Code::MUL : Optional<Code>{};
+    auto op = dynamic_cast<const Operation*>(&inst);
+    if(!op || !op->getSecondArg())
+        return {};
+    if(op->op == OP_ADD)
+        return Code::ADD;
+    if(op->op == OP_SUB)
+        return Code::SUB;
+    if(op->op == OP_MUL24)
+        return Code::MUL24;
+    if(op->op == OP_SHL)
+        return Code::SHL;
+    if(op->op == OP_SHR)
+        return Code::SHR;
+    if(op->op == OP_ASR)
+        return Code::ASR;
+    if(op->op == OP_AND)
+        return Code::AND;
+    if(op->op == OP_OR)
+        return Code::OR;
+    if(op->op == OP_XOR)
+        return Code::XOR;
+    return {};
+}
+
+namespace
+{
+    /*
+     * Determines the calculations of values which are the same for all work-items of the kernel execution, since they
+     * only depend on work-item information and parameters which are the same for all work-groups, see
+     * Configuration#precomputeUniformValues
+     */
+    class UniformCalculationResolver
+    {
+    public:
+        struct Calculation
+        {
+            InstructionWalker writer;
+            UniformExpression expression;
+            bool hasOperation;
+        };
+
+        explicit UniformCalculationResolver(Method& method)
+        {
+            using Code = UniformExpression::OpCode;
+            using Type = BuiltinLocal::Type;
+            const std::vector<std::pair<Type, Code>> builtins = {{Type::WORK_DIMENSIONS, Code::WORK_DIMENSIONS},
+                {Type::LOCAL_SIZES, Code::LOCAL_SIZES}, {Type::NUM_GROUPS_X, Code::NUM_GROUPS_X},
+                {Type::NUM_GROUPS_Y, Code::NUM_GROUPS_Y}, {Type::NUM_GROUPS_Z, Code::NUM_GROUPS_Z},
+                {Type::GLOBAL_OFFSET_X, Code::GLOBAL_OFFSET_X}, {Type::GLOBAL_OFFSET_Y, Code::GLOBAL_OFFSET_Y},
+                {Type::GLOBAL_OFFSET_Z, Code::GLOBAL_OFFSET_Z}};
+            for(const auto& builtin : builtins)
+            {
+                // the group IDs (and the values derived from them) differ per work-group
+                if(auto loc = method.findBuiltin(builtin.first))
+                    inputs.emplace(loc, UniformExpression::Step{builtin.second, 0});
+            }
+
+            // the index of the first UNIFORM of each parameter, must match the loading of the parameters in
+            // #addStartStopSegment()
+            uint32_t uniformIndex = 0;
+            for(const Parameter& param : method.parameters)
+            {
+                bool isDirectVector = !param.type.getPointerType() && param.type.getVectorWidth() != 1;
+                if(!isDirectVector && !has_flag(param.decorations, ParameterDecorations::SIGN_EXTEND) &&
+                    !has_flag(param.decorations, ParameterDecorations::ZERO_EXTEND) &&
+                    param.getUsers(LocalUse::Type::WRITER).empty())
+                    inputs.emplace(&param, UniformExpression::Step{Code::PARAMETER, uniformIndex});
+                uniformIndex += isDirectVector ? param.type.getVectorWidth() : 1u;
+            }
+
+            for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+            {
+                if(it.has() && it->checkOutputLocal())
+                    writers.emplace(it.get(), it);
+            }
+        }
+
+        const Calculation* getCalculation(const Local* local)
+        {
+            auto it = calculations.find(local);
+            if(it != calculations.end())
+                return it->second ? &it->second.value() : nullptr;
+            // mark as not calculable while resolving to abort on any recursion
+            calculations.emplace(local, Optional<Calculation>{});
+            auto calculation = resolveCalculation(local);
+            calculations[local] = calculation;
+            return calculation ? &calculations[local].value() : nullptr;
+        }
+
+    private:
+        FastMap<const Local*, UniformExpression::Step> inputs;
+        FastMap<const IntermediateInstruction*, InstructionWalker> writers;
+        FastMap<const Local*, Optional<Calculation>> calculations;
+
+        // The maximum number of steps of a single expression, to keep the expressions stored in the kernel info small
+        static constexpr std::size_t MAX_STEPS = 32;
+
+        bool addOperand(UniformExpression& expression, bool& hasOperation, const Value& arg)
+        {
+            if(auto lit = arg.getLiteralValue())
+            {
+                expression.steps.push_back(UniformExpression::Step{UniformExpression::OpCode::CONSTANT,
+                    lit->unsignedInt()});
+                return true;
+            }
+            auto loc = arg.checkLocal();
+            if(!loc)
+                return false;
+            auto inputIt = inputs.find(loc);
+            if(inputIt != inputs.end())
+            {
+                expression.steps.push_back(inputIt->second);
+                return true;
+            }
+            auto calculation = getCalculation(loc);
+            if(!calculation)
+                return false;
+            expression.steps.insert(
+                expression.steps.end(), calculation->expression.steps.begin(), calculation->expression.steps.end());
+            hasOperation = hasOperation || calculation->hasOperation;
+            return true;
+        }
+
+        Optional<Calculation> resolveCalculation(const Local* local)
+        {
+            if(local->type.isFloatingType() || local->type.getVectorWidth() != 1 || local->is<Parameter>() ||
+                local->is<BuiltinLocal>() || local->is<Global>() || local->is<StackAllocation>())
+                return {};
+            auto writer = local->getSingleWriter();
+            auto writerIt = writers.find(writer);
+            if(!writer || writerIt == writers.end() || writer->hasConditionalExecution() || writer->hasSideEffects() ||
+                writer->doesSetFlag() || writer->hasPackMode() || writer->hasUnpackMode())
+                return {};
+
+            Calculation calculation{writerIt->second, UniformExpression{}, false};
+            auto move = dynamic_cast<const MoveOperation*>(writer);
+            if(move && !dynamic_cast<const VectorRotation*>(writer))
+            {
+                if(!addOperand(calculation.expression, calculation.hasOperation, move->getSource()))
+                    return {};
+            }
+            else if(auto code = getUniformExpressionOperation(*writer))
+            {
+                for(const auto& arg : writer->getArguments())
+                {
+                    if(!addOperand(calculation.expression, calculation.hasOperation, arg))
+                        return {};
+                }
+                calculation.expression.steps.push_back(UniformExpression::Step{*code, 0});
+                calculation.hasOperation = true;
+            }
+            else
+                return {};
+            if(calculation.expression.steps.size() > MAX_STEPS)
+                return {};
+            return calculation;
+        }
+    };
+} // namespace
+
+/*
+ * Removes the calculations of values which are the same for all work-items of the kernel execution and can therefore
+ * be executed host-side. Returns the locals to be read from the additional UNIFORMs and the decorations of their
+ * original writers.
+ *
+ * Only the "outermost" calculations are exported, i.e. the values which are also used outside of calculations of other
+ * exported values.
+ */
+static std::vector<std::pair<const Local*, InstructionDecorations>> removePrecomputedCalculations(Method& method)
+{
+    UniformCalculationResolver resolver(method);
+    FastSet<const IntermediateInstruction*> calculationWriters;
+    std::vector<const Local*> calculatedLocals;
+    for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+    {
+        auto loc = it.has() ? it->checkOutputLocal() : nullptr;
+        if(loc && resolver.getCalculation(loc))
+        {
+            calculationWriters.emplace(it.get());
+            calculatedLocals.push_back(loc);
+        }
+    }
+
+    std::vector<std::pair<const Local*, InstructionDecorations>> precomputedLocals;
+    std::vector<const UniformCalculationResolver::Calculation*> precomputedCalculations;
+    for(auto loc : calculatedLocals)
+    {
+        auto calculation = resolver.getCalculation(loc);
+        auto readers = loc->getUsers(LocalUse::Type::READER);
+        if(!calculation->hasOperation ||
+            std::all_of(readers.begin(), readers.end(), [&](const LocalUser* reader) -> bool {
+                return calculationWriters.find(reader) != calculationWriters.end();
+            }))
+            continue;
+        if(precomputedLocals.size() >= std::numeric_limits<uint8_t>::max())
+            break;
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Calculating value host-side: " << calculation->writer->to_string() << " ("
+                << calculation->expression.to_string() << ')' << logging::endl);
+        precomputedLocals.emplace_back(loc, calculation->writer->decoration);
+        method.metaData.precomputedUniforms.push_back(calculation->expression);
+        precomputedCalculations.push_back(calculation);
+    }
+
+    // remove the calculations and all their inputs not used otherwise
+    FastAccessList<const Local*> removedInputs;
+    for(auto calculation : precomputedCalculations)
+    {
+        auto args = calculation->writer->getArguments();
+        calculation->writer.copy().erase();
+        for(const auto& arg : args)
+        {
+            if(auto loc = arg.checkLocal())
+                removedInputs.push_back(loc);
+        }
+    }
+    while(!removedInputs.empty())
+    {
+        auto loc = removedInputs.back();
+        removedInputs.pop_back();
+        auto calculation = resolver.getCalculation(loc);
+        if(!calculation || !loc->getUsers(LocalUse::Type::READER).empty() ||
+            loc->getUsers(LocalUse::Type::WRITER).empty())
+            continue;
+        auto args = calculation->writer->getArguments();
+        calculation->writer.copy().erase();
+        for(const auto& arg : args)
+        {
+            if(auto argLoc = arg.checkLocal())
+                removedInputs.push_back(argLoc);
+        }
+    }
+    return precomputedLocals;
+}
+
+void optimizations::addStartStopSegment(const Module& module, Method& method, const Configuration& config)
+{
+    // needs to be done before the work-item information is loaded to not load the values only used in the calculations
+    std::vector<std::pair<const Local*, InstructionDecorations>> precomputedLocals;
+    method.metaData.precomputedUniforms.clear();
+    if(config.precomputeUniformValues)
+        precomputedLocals = removePrecomputedCalculations(method);
+
+    auto it = method.walkAllInstructions();
+    if(it.isEndOfMethod() || !it.get<intermediate::BranchLabel>() ||
+        BasicBlock::DEFAULT_BLOCK != it.get<intermediate::BranchLabel>()->getLabel()->name)
+    {
+        it = method.createAndInsertNewBlock(method.begin(), BasicBlock::DEFAULT_BLOCK).walk();
+    }
+    it.nextInBlock();
+
+    // if the second TMU was used explicitly at some point, we disable TMU_SWAP
+    {
+        bool tmu1Used = false;
+        auto checkIt = method.walkAllInstructions();
+        while(!checkIt.isEndOfMethod())
+        {
+            if(checkIt->writesRegister(REG_TMU1_ADDRESS))
+            {
+                tmu1Used = true;
+                break;
+            }
+            checkIt.nextInMethod();
+        }
+        if(tmu1Used)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Using both TMUs explicitly, disable automatic swapping!" << logging::endl);
+            assign(it, Value(REG_TMU_NOSWAP, TYPE_BOOL)) = BOOL_TRUE;
+        }
+    }
+
+    /*
+     * The first UNIFORMs are reserved for relaying information about the work-item and work-group
+     * - work_dim: number of dimensions
+     * - local_sizes: local number of work-items in its work-group per dimension
+     * - local_ids: local id of this work-item within its work-group
+     * - num_groups (x,y,z): global number of work-groups per dimension
+     * - group_id (x, y, z): id of this work-group
+     * - global_offset (x, y, z): global initial offset per dimension
+     * - address of global data / to load the global data from
+     *
+     */
+    // initially set all implicit UNIFORMs to unused
+    method.metaData.uniformsUsed.value = 0;
+    auto workInfoDecorations =
+        add_flag(InstructionDecorations::UNSIGNED_RESULT, InstructionDecorations::WORK_GROUP_UNIFORM_VALUE);
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::WORK_DIMENSIONS))
+    {
+        method.metaData.uniformsUsed.setWorkDimensionsUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT8), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::LOCAL_SIZES))
+    {
+        method.metaData.uniformsUsed.setLocalSizesUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::LOCAL_IDS))
+    {
+        method.metaData.uniformsUsed.setLocalIDsUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32),
+            remove_flag(workInfoDecorations, InstructionDecorations::WORK_GROUP_UNIFORM_VALUE));
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::NUM_GROUPS_X))
+    {
+        method.metaData.uniformsUsed.setNumGroupsXUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::NUM_GROUPS_Y))
+    {
+        method.metaData.uniformsUsed.setNumGroupsYUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::NUM_GROUPS_Z))
+    {
+        method.metaData.uniformsUsed.setNumGroupsZUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_ID_X))
+    {
+        method.metaData.uniformsUsed.setGroupIDXUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_ID_Y))
+    {
+        method.metaData.uniformsUsed.setGroupIDYUsed(true);
+        assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
+    }
+    if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_ID_Z))
+    {
+        method.metaData.uniformsUsed.setGroupIDZUsed(true);
         assign(it, loc->createReference()) = (Value(REG_UNIFORM, TYPE_INT32), workInfoDecorations);
     }
     if(auto loc = isLocalUsed(method, BuiltinLocal::Type::GROUP_IDS))
@@ -1024,6 +2258,12 @@ void optimizations::addStartStopSegment(const Module& module, Method& method, co
         }
     }
 
+    // load the values calculated host-side
+    method.metaData.uniformsUsed.setNumPrecomputedValues(static_cast<uint8_t>(precomputedLocals.size()));
+    for(const auto& precomputed : precomputedLocals)
+        assign(it, precomputed.first->createReference()) = (Value(REG_UNIFORM, precomputed.first->type),
+            add_flag(precomputed.second, InstructionDecorations::WORK_GROUP_UNIFORM_VALUE));
+
     generateStopSegment(method);
 }
 
@@ -1152,10 +2392,19 @@ bool optimizations::removeConstantLoadInLoops(const Module& module, Method& meth
 
     std::map<LoopInclusionTreeNode*, std::vector<InstructionWalker>> instMapper;
 
+    // Hoisting a constant load extends the life-time of the loaded local to the whole loop, so only as many constant
+    // loads are moved as there are registers free within the loop, to not force locals to be spilled.
+    const auto& registerPressure = method.getAnalyses().getRegisterPressure();
+
     // find instructions to be moved
     for(auto& loop : inclusionTree->getNodes())
     {
         auto& node = inclusionTree->getOrCreateNode(loop.first);
+        auto freeRegisters = std::numeric_limits<unsigned>::max();
+        for(auto& cfgNode : *node.key)
+            freeRegisters =
+                std::min(freeRegisters, registerPressure.getMaximumPressure(*cfgNode->key).getFreeRegisters());
+
         for(auto& cfgNode : *node.key)
         {
             if(node.hasCFGNodeInChildren(cfgNode))
@@ -1169,6 +2418,14 @@ bool optimizations::removeConstantLoadInLoops(const Module& module, Method& meth
             {
                 if(it->isConstantInstruction() && (check(it->checkOutputLocal()) & &Local::getSingleWriter) == it.get())
                 {
+                    if(freeRegisters == 0)
+                    {
+                        CPPLOG_LAZY(logging::Level::DEBUG,
+                            log << "Not moving constant load out of loop to not increase register pressure: "
+                                << it->to_string() << logging::endl);
+                        continue;
+                    }
+                    --freeRegisters;
                     // can only move constant writes of locals only written exactly here
                     instMapper[&node].push_back(it);
                     hasChanged = true;
@@ -1411,75 +2668,363 @@ bool optimizations::mergeAdjacentBasicBlocks(const Module& module, Method& metho
     return !blocksToMerge.empty();
 }
 
-bool optimizations::reorderBasicBlocks(const Module& module, Method& method, const Configuration& config)
+// The probability (in 1/16th) of a loop back-edge being taken, if the block has other successors
+static constexpr uint64_t BACK_EDGE_PROBABILITY = 14;
+// The factor the statically estimated weight of a transition is multiplied with per level of enclosing loops
+static constexpr uint64_t LOOP_WEIGHT_FACTOR = 16;
+// The maximum loop depth considered for the static weight of a transition, to not overflow the weight
+static constexpr unsigned MAX_WEIGHTED_LOOP_DEPTH = 4;
+
+struct LayoutEdge
+{
+    BasicBlock* source;
+    BasicBlock* destination;
+    // the (estimated) number of times this transition is taken
+    uint64_t weight;
+    // whether the destination is currently the fall-through successor of the source, preferred for equal weights
+    bool isFallThrough;
+};
+
+/*
+ * Estimates how often the transition from the source to the destination block is taken.
+ *
+ * If the execution profile contains both blocks, the number of executions is taken from the profile. Otherwise it is
+ * estimated statically from the number of successors of the source block (assuming loop back-edges to be taken most of
+ * the time) and the depth of the loops containing the transition.
+ */
+static uint64_t estimateEdgeWeight(const Module& module, const Method& method, const CFGNode& source,
+    const CFGNode& destination, const CFGEdge& edge, const FastMap<const CFGNode*, unsigned>& loopDepths)
+{
+    const auto& profile = module.executionProfile;
+    auto sourceFrequency = profile.getBlockFrequency(method, *source.key);
+    auto destinationFrequency = profile.getBlockFrequency(method, *destination.key);
+    if(sourceFrequency && destinationFrequency)
+    {
+        if(destination.getSinglePredecessor() == &source)
+            return *destinationFrequency;
+        if(source.getSingleSuccessor() == &destination)
+            return *sourceFrequency;
+        return std::min(*sourceFrequency, *destinationFrequency);
+    }
+
+    uint64_t numSuccessors = 0;
+    uint64_t numBackEdges = 0;
+    source.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge& otherEdge) -> bool {
+        ++numSuccessors;
+        if(otherEdge.data.isBackEdge(source.key))
+            ++numBackEdges;
+        return true;
+    });
+    uint64_t probability = 16;
+    if(numSuccessors > 1 && edge.data.isBackEdge(source.key))
+        probability = BACK_EDGE_PROBABILITY / numBackEdges;
+    else if(numSuccessors > 1 && numBackEdges > 0)
+        probability = (16 - BACK_EDGE_PROBABILITY) / (numSuccessors - numBackEdges);
+    else if(numSuccessors > 1)
+        probability = 16 / numSuccessors;
+
+    auto sourceDepthIt = loopDepths.find(&source);
+    auto destinationDepthIt = loopDepths.find(&destination);
+    unsigned depth = std::min(sourceDepthIt != loopDepths.end() ? sourceDepthIt->second : 0u,
+        destinationDepthIt != loopDepths.end() ? destinationDepthIt->second : 0u);
+    uint64_t weight = std::max(probability, uint64_t{1});
+    for(unsigned i = 0; i < std::min(depth, MAX_WEIGHTED_LOOP_DEPTH); ++i)
+        weight *= LOOP_WEIGHT_FACTOR;
+    return weight;
+}
+
+/*
+ * Determines the new order of the basic blocks by greedily concatenating the chains of blocks with the most often taken
+ * transitions between them (see K. Pettis, R. Hansen: "Profile guided code positioning").
+ */
+static FastAccessList<BasicBlock*> determineBlockOrder(const Module& module, Method& method)
+{
+    auto& cfg = method.getCFG();
+    FastMap<const CFGNode*, unsigned> loopDepths;
+    for(const auto& loop : cfg.findLoops(true))
+    {
+        for(auto node : loop)
+            ++loopDepths[node];
+    }
+
+    // initially, every block forms its own chain
+    FastAccessList<FastAccessList<BasicBlock*>> chains;
+    FastMap<const BasicBlock*, std::size_t> chainIndices;
+    BasicBlock* firstBlock = &*method.begin();
+    BasicBlock* lastBlock = nullptr;
+    for(auto& block : method)
+    {
+        chainIndices.emplace(&block, chains.size());
+        chains.emplace_back(FastAccessList<BasicBlock*>{&block});
+        if(block.getLabel()->getLabel()->name == BasicBlock::LAST_BLOCK)
+            lastBlock = &block;
+    }
+    const std::size_t numBlocks = chains.size();
+
+    FastAccessList<LayoutEdge> edges;
+    for(auto& block : method)
+    {
+        auto& node = cfg.assertNode(&block);
+        node.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge& edge) -> bool {
+            // the start of the method always stays the first block and nothing is placed after the end of the method
+            if(successor.key != &block && successor.key != firstBlock && &block != lastBlock)
+            {
+                auto weight = estimateEdgeWeight(module, method, node, successor, edge, loopDepths);
+                edges.push_back(LayoutEdge{&block, successor.key, weight, edge.data.isImplicit(&block)});
+            }
+            return true;
+        });
+    }
+    std::stable_sort(edges.begin(), edges.end(), [](const LayoutEdge& one, const LayoutEdge& other) -> bool {
+        if(one.weight != other.weight)
+            return one.weight > other.weight;
+        return one.isFallThrough && !other.isFallThrough;
+    });
+
+    // the chain starting with the first block is placed first and the chain containing the last block is placed last,
+    // so they can only be concatenated, if there are no other blocks left. Since this might only be the case after
+    // other chains are concatenated, the transitions are visited twice.
+    for(unsigned round = 0; round < 2; ++round)
+    {
+        for(const auto& edge : edges)
+        {
+            auto sourceChain = chainIndices.at(edge.source);
+            auto destinationChain = chainIndices.at(edge.destination);
+            if(sourceChain == destinationChain || chains[sourceChain].back() != edge.source ||
+                chains[destinationChain].front() != edge.destination)
+                continue;
+            if(lastBlock && sourceChain == chainIndices.at(firstBlock) &&
+                destinationChain == chainIndices.at(lastBlock) &&
+                chains[sourceChain].size() + chains[destinationChain].size() != numBlocks)
+                continue;
+            for(auto block : chains[destinationChain])
+            {
+                chains[sourceChain].push_back(block);
+                chainIndices[block] = sourceChain;
+            }
+            chains[destinationChain].clear();
+        }
+    }
+
+    // place the chains, preferring the chain most often transitioned to from the already placed blocks
+    FastAccessList<BasicBlock*> order;
+    order.reserve(numBlocks);
+    FastSet<const BasicBlock*> placedBlocks;
+    const std::size_t lastChain = lastBlock ? chainIndices.at(lastBlock) : numBlocks;
+    auto nextChain = chainIndices.at(firstBlock);
+    while(nextChain < numBlocks)
+    {
+        for(auto block : chains[nextChain])
+        {
+            order.push_back(block);
+            placedBlocks.emplace(block);
+        }
+        chains[nextChain].clear();
+
+        nextChain = numBlocks;
+        uint64_t bestWeight = 0;
+        for(const auto& edge : edges)
+        {
+            auto index = chainIndices.at(edge.destination);
+            if(chains[index].empty() || index == lastChain || placedBlocks.find(edge.source) == placedBlocks.end())
+                continue;
+            if(nextChain == numBlocks || edge.weight > bestWeight || (edge.weight == bestWeight && index < nextChain))
+            {
+                nextChain = index;
+                bestWeight = edge.weight;
+            }
+        }
+        for(std::size_t i = 0; i < numBlocks && nextChain == numBlocks; ++i)
+        {
+            // no remaining chain is reachable from the placed blocks, fall back to the original order
+            if(!chains[i].empty() && i != lastChain)
+                nextChain = i;
+        }
+        if(nextChain == numBlocks && lastChain < numBlocks && !chains[lastChain].empty())
+            nextChain = lastChain;
+    }
+    return order;
+}
+
+/*
+ * Copies small blocks with several predecessors into the predecessors unconditionally branching to them (and not
+ * placed directly in front of them), replacing the taken branch into the block with the branch at its end.
+ *
+ * Returns the number of copies inserted.
+ */
+static std::size_t duplicateTails(const Module& module, Method& method, const Configuration& config)
 {
-    if(method.empty())
-        return false;
     auto& cfg = method.getCFG();
-    auto blockIt = method.begin();
-    auto prevIt = method.begin();
-    ++blockIt;
-    while(blockIt != method.end())
+    const auto& profile = module.executionProfile;
+    std::size_t numCopies = 0;
+    for(auto& block : method)
     {
-        auto& node = cfg.assertNode(&(*blockIt));
-        const auto predecessor = node.getSinglePredecessor();
-        // Never re-order end-of-block. Though it should work, there could be trouble anyway
-        if(blockIt->getLabel()->getLabel()->name != BasicBlock::LAST_BLOCK && predecessor != nullptr &&
-            predecessor->key != &(*prevIt) && !prevIt->fallsThroughToNextBlock())
+        if(&block == &*method.begin() || block.getLabel()->getLabel()->name == BasicBlock::LAST_BLOCK)
+            continue;
+
+        // only blocks ending with an unconditional branch (and containing no other branch) are copied
+        FastAccessList<const IntermediateInstruction*> body;
+        FastSet<const IntermediateInstruction*> blockInstructions;
+        const Branch* exitBranch = nullptr;
+        bool canBeCopied = true;
+        for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock() && canBeCopied; it.nextInBlock())
         {
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Reordering block with single predecessor not being the previous block: " << blockIt->to_string()
-                    << logging::endl);
+            if(!it.has())
+                continue;
+            blockInstructions.emplace(it.get());
+            if(exitBranch)
+                canBeCopied = false;
+            else if(auto branch = it.get<Branch>())
+                exitBranch = branch;
+            else
+                body.push_back(it.get());
+        }
+        if(!canBeCopied || !exitBranch || !exitBranch->isUnconditional() ||
+            exitBranch->hasDecoration(InstructionDecorations::WORK_GROUP_LOOP) ||
+            exitBranch->getTarget() == block.getLabel()->getLabel() ||
+            body.size() > config.additionalOptions.maxTailDuplicationSize)
+            continue;
 
-            auto predecessorIt = method.begin();
-            while(predecessorIt != method.end())
+        auto& node = cfg.assertNode(&block);
+        FastAccessList<InstructionWalker> candidates;
+        bool hasLayoutPredecessor = false;
+        unsigned numPredecessors = 0;
+        node.forAllIncomingEdges([&](CFGNode& predecessor, CFGEdge& edge) -> bool {
+            if(predecessor.key == &block)
+                return true;
+            ++numPredecessors;
+            if(edge.data.isImplicit(predecessor.key) || method.getNextBlockAfter(predecessor.key) == &block)
             {
-                if(&(*predecessorIt) == predecessor->key)
-                    break;
-                ++predecessorIt;
+                // the transition from this predecessor is already free
+                hasLayoutPredecessor = true;
+                return true;
             }
+            auto branchIt = edge.data.getPredecessor(predecessor.key);
+            auto branch = branchIt.get<Branch>();
+            if(branch && branch->isUnconditional() && !edge.data.isBackEdge(predecessor.key) &&
+                !edge.data.isWorkGroupLoop && branchIt.copy().nextInBlock().isEndOfBlock())
+                candidates.push_back(branchIt);
+            return true;
+        });
+        if(numPredecessors < 2 || candidates.empty())
+            continue;
+        if(!hasLayoutPredecessor && candidates.size() == numPredecessors)
+        {
+            // keep the least often executed transition to not leave the block unreachable
+            auto getFrequency = [&](const InstructionWalker& it) -> uint64_t {
+                return profile.getBlockFrequency(method, *it.getBasicBlock()).value_or(0);
+            };
+            std::stable_sort(candidates.begin(), candidates.end(),
+                [&](const InstructionWalker& one, const InstructionWalker& other) -> bool {
+                    return getFrequency(one) > getFrequency(other);
+                });
+            candidates.pop_back();
+        }
 
-            if(predecessorIt == method.end())
-                throw CompilationError(CompilationStep::OPTIMIZER,
-                    "Failed to find predecessor basic block: ", predecessor->key->to_string());
-
-            // we insert before the iteration, so we need to set the iterator after the predecessor
-            ++predecessorIt;
-            method.moveBlock(blockIt, predecessorIt);
-            // prevIt stays the same, since we removed the block and the next blockIt now follows prevIt
-            blockIt = prevIt;
-            ++blockIt;
-
-            // if the now moved block did fall-through, we need to insert an explicit branch to its previous successor,
-            // since they might now not longer be adjacent.
-            const CFGNode* fallThroughSuccessor = nullptr;
-            node.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge& edge) -> bool {
-                if(edge.data.isImplicit(node.key))
+        // locals only used within the block are renamed in the copies, all other locals are shared
+        auto isBlockLocal = [&](const Local* loc) -> bool {
+            if(loc->is<Parameter>() || loc->is<BuiltinLocal>() || loc->is<Global>() || loc->is<StackAllocation>() ||
+                loc->type == TYPE_LABEL)
+                return false;
+            const auto& users = loc->getUsers();
+            return std::all_of(users.begin(), users.end(), [&](const auto& user) -> bool {
+                return blockInstructions.find(user.first) != blockInstructions.end();
+            });
+        };
+        for(auto branchIt : candidates)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Copying " << body.size() << " instructions of block '" << block.to_string()
+                    << "' to replace the branch in: " << branchIt.getBasicBlock()->to_string() << logging::endl);
+            InlineMapping mapping;
+            for(auto inst : body)
+            {
+                for(const auto& pair : inst->getUsedLocals())
                 {
-                    if(fallThroughSuccessor)
-                        throw CompilationError(CompilationStep::GENERAL, "Multiple implicit branches from basic block",
-                            node.key->to_string());
-                    fallThroughSuccessor = &successor;
+                    if(mapping.find(pair.first) == mapping.end())
+                        mapping.emplace(pair.first,
+                            isBlockLocal(pair.first) ? method.addNewLocal(pair.first->type, "%tail").local() :
+                                                       pair.first);
                 }
-                return true;
-            });
-            if(fallThroughSuccessor)
+            }
+            for(auto inst : body)
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
-                    log << "Inserting explicit branch to previous fall-through successor for moved block '"
-                        << node.key->to_string() << "' to '" << fallThroughSuccessor->key->to_string() << '\''
-                        << logging::endl);
-                node.key->walkEnd().emplace(
-                    new intermediate::Branch(fallThroughSuccessor->key->getLabel()->getLabel()));
+                branchIt.emplace(inst->copyFor(method, "", mapping));
+                branchIt.nextInBlock();
             }
+            branchIt.reset(new Branch(exitBranch->getTarget()));
+            ++numCopies;
         }
-        else
+    }
+    return numCopies;
+}
+
+bool optimizations::reorderBasicBlocks(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.empty())
+        return false;
+
+    // remember the fall-through successors, since they might no longer be placed after their predecessors
+    auto& cfg = method.getCFG();
+    FastMap<const BasicBlock*, BasicBlock*> fallThroughSuccessors;
+    for(auto& block : method)
+    {
+        auto& node = cfg.assertNode(&block);
+        node.forAllOutgoingEdges([&](const CFGNode& successor, const CFGEdge& edge) -> bool {
+            if(edge.data.isImplicit(node.key))
+            {
+                if(fallThroughSuccessors.find(&block) != fallThroughSuccessors.end())
+                    throw CompilationError(
+                        CompilationStep::GENERAL, "Multiple implicit branches from basic block", node.key->to_string());
+                fallThroughSuccessors.emplace(&block, successor.key);
+            }
+            return true;
+        });
+    }
+
+    auto order = determineBlockOrder(module, method);
+    FastMap<const BasicBlock*, decltype(method.begin())> positions;
+    bool isReordered = false;
+    {
+        auto orderIt = order.begin();
+        for(auto blockIt = method.begin(); blockIt != method.end(); ++blockIt, ++orderIt)
+        {
+            positions.emplace(&*blockIt, blockIt);
+            isReordered = isReordered || &*blockIt != *orderIt;
+        }
+    }
+    if(isReordered)
+    {
+        CPPLOG_LAZY_BLOCK(logging::Level::DEBUG, {
+            logging::debug() << "Reordering basic blocks of '" << method.name << "' to: " << logging::endl;
+            for(auto block : order)
+                logging::debug() << '\t' << block->to_string() << logging::endl;
+        });
+        // moving all blocks in the new order to the end of the method leaves them in the new order
+        for(auto block : order)
+            method.moveBlock(positions.at(block), method.end());
+
+        // if a block did fall-through, we need to insert an explicit branch to its previous successor, since they might
+        // now no longer be adjacent.
+        for(auto block : order)
         {
-            ++blockIt;
-            ++prevIt;
+            auto successorIt = fallThroughSuccessors.find(block);
+            if(successorIt == fallThroughSuccessors.end() || method.getNextBlockAfter(block) == successorIt->second)
+                continue;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Inserting explicit branch to previous fall-through successor for moved block '"
+                    << block->to_string() << "' to '" << successorIt->second->to_string() << '\'' << logging::endl);
+            block->walkEnd().emplace(new Branch(successorIt->second->getLabel()->getLabel()));
         }
     }
 
+    // the branches to the now succeeding blocks are removed by #simplifyBranches
+    // copying the blocks increases the code size, so it is skipped when optimizing for size
+    auto numCopies = config.optimizationLevel == OptimizationLevel::SIZE ? 0 : duplicateTails(module, method, config);
+    if(numCopies > 0)
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Duplicated " << numCopies << " small blocks into their predecessors" << logging::endl);
+
 #ifdef DEBUG_MODE
     cfg.dumpGraph("/tmp/vc4c-cfg-reordered.dot", false);
 #endif
@@ -1739,52 +3284,391 @@ bool optimizations::simplifyConditionalBlocks(const Module& module, Method& meth
                         continue;
                     }
 
-                    lastIt.emplace(inst.release());
+                    lastIt.emplace(inst.release());
+
+                    // 3.) modify all instructions writing non-locals to only write under same condition as the
+                    // branch
+                    // XXX do we win anything in making all the instructions conditional? Technically this would be
+                    // possible
+                    for(auto loc : nonlocalLocals)
+                    {
+                        if(lastIt->writesLocal(loc) && lastIt.get<ExtendedInstruction>())
+                        {
+                            lastIt.get<ExtendedInstruction>()->setCondition(cond);
+                            break;
+                        }
+                    }
+
+                    lastIt.nextInBlock();
+                }
+
+                // 4.) remove branch to original block
+                if(condVal)
+                    lastIt.erase();
+
+                // 5.) remove original block
+                if(!method.removeBlock(*succ->key))
+                {
+                    CPPLOG_LAZY_BLOCK(logging::Level::WARNING, {
+                        logging::warn() << "Failed to remove move-from basic block: " << succ->key->to_string()
+                                        << logging::endl;
+                        succ->key->dumpInstructions();
+                    });
+                    // XXX throw exception here or continue??
+                }
+
+                // there is only one incoming edge
+                return false;
+            });
+        }
+
+        // insert branch to successor block to guarantee we switch into that, independent of the block order
+        block.predecessor->key->walkEnd().emplace(
+            new intermediate::Branch(block.successor->key->getLabel()->getLabel()));
+
+        changedCode = true;
+    }
+
+    return changedCode;
+}
+
+namespace
+{
+    /*
+     * A small if-then or if-then-else region of the control flow which can be replaced by conditional execution:
+     *
+     * If-Then:              If-Then-Else:
+     * Predecessor              Predecessor
+     *  |  \                     /      \
+     *  |  Then                Then    Else
+     *  |  /                     \      /
+     * Successor                Successor
+     */
+    struct IfConversionRegion
+    {
+        // the block containing the conditional branches
+        BasicBlock* predecessor;
+        // the first of the branches at the end of the predecessor block
+        InstructionWalker firstBranch;
+        // the blocks to be executed conditionally with the condition they are executed for
+        FastAccessList<std::pair<BasicBlock*, ConditionCode>> conditionalBlocks;
+        // the common successor of the region
+        BasicBlock* successor;
+        // the value to set the flags on for the conditional execution, if the flags set for the branches are not
+        // usable for conditional execution
+        Optional<Value> conditionValue;
+    };
+} // namespace
+
+/*
+ * Returns the first of the branches terminating the given block, if all instructions following it are branches too
+ */
+static Optional<InstructionWalker> findTerminatingBranches(BasicBlock& block)
+{
+    Optional<InstructionWalker> firstBranch;
+    for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(it.get<intermediate::Branch>())
+        {
+            if(!firstBranch)
+                firstBranch = it;
+        }
+        else if(firstBranch)
+            return {};
+    }
+    return firstBranch;
+}
+
+/*
+ * Returns the number of instructions of the block which are executed if the block is converted to conditional
+ * execution, or nothing if the block cannot be converted (e.g. since it contains instructions with side-effects).
+ */
+static Optional<unsigned> getConvertibleBlockSize(const BasicBlock& block, const BasicBlock& successor)
+{
+    unsigned numInstructions = 0;
+    bool branchFound = false;
+    for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(branchFound)
+            // there should be nothing after the single branch to the successor
+            return {};
+        if(auto branch = it.get<const intermediate::Branch>())
+        {
+            if(!branch->isUnconditional() || branch->getTarget() != successor.getLabel()->getLabel())
+                return {};
+            branchFound = true;
+            continue;
+        }
+        if((!it.get<const intermediate::ExtendedInstruction>() && !it.get<const intermediate::Nop>()) ||
+            it->hasSideEffects() || it->hasConditionalExecution())
+            return {};
+        if(it->mapsToASMInstruction())
+            ++numInstructions;
+    }
+    return numInstructions;
+}
+
+/*
+ * Returns the costs of reaching the given block from the branches terminating the predecessor, i.e. the costs of all
+ * branches executed before the branch to the given block is taken or the block is reached via fall-through
+ */
+static unsigned getBranchCostsTo(InstructionWalker firstBranch, const BasicBlock& block)
+{
+    unsigned numBranches = 0;
+    for(auto it = firstBranch; !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(auto branch = it.get<const intermediate::Branch>())
+        {
+            ++numBranches;
+            if(branch->getTarget() == block.getLabel()->getLabel())
+                break;
+        }
+    }
+    return numBranches * BRANCH_COSTS;
+}
+
+static BasicBlock* getNextBlockAfterRegion(Method& method, const IfConversionRegion& region)
+{
+    auto next = method.getNextBlockAfter(region.predecessor);
+    while(next &&
+        std::any_of(region.conditionalBlocks.begin(), region.conditionalBlocks.end(),
+            [&](const std::pair<BasicBlock*, ConditionCode>& pair) -> bool { return pair.first == next; }))
+        next = method.getNextBlockAfter(next);
+    return next;
+}
+
+/*
+ * Determines whether the region is converted to conditional execution.
+ *
+ * Since we do not know which path is taken more often, the costs of executing the instructions of all conditional
+ * blocks (and setting the flags) need to not exceed the average costs of the original paths, including the costs of
+ * all executed branches and their delay slots.
+ */
+static bool isIfConversionProfitable(Method& method, const IfConversionRegion& region)
+{
+    FastAccessList<unsigned> pathCosts;
+    unsigned convertedCosts = region.conditionValue ? 1 : 0;
+    for(const auto& pair : region.conditionalBlocks)
+    {
+        auto blockSize = getConvertibleBlockSize(*pair.first, *region.successor).value();
+        auto lastBranch = findTerminatingBranches(*pair.first);
+        pathCosts.push_back(getBranchCostsTo(region.firstBranch, *pair.first) + blockSize +
+            (lastBranch ? BRANCH_COSTS : 0));
+        convertedCosts += blockSize;
+    }
+    if(region.conditionalBlocks.size() == 1)
+        // if-without-else, the other path directly jumps to the successor
+        pathCosts.push_back(getBranchCostsTo(region.firstBranch, *region.successor));
+    if(getNextBlockAfterRegion(method, region) != region.successor)
+        convertedCosts += BRANCH_COSTS;
+
+    auto originalCosts = std::accumulate(pathCosts.begin(), pathCosts.end(), 0u);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "If-conversion costs for " << region.predecessor->to_string() << ": " << convertedCosts
+            << " instructions vs. average branching costs of " << (originalCosts / 2) << logging::endl);
+    return convertedCosts * 2 <= originalCosts;
+}
+
+static Optional<IfConversionRegion> findIfConversionRegion(Method& method, BasicBlock& block)
+{
+    auto& node = method.getCFG().assertNode(&block);
+    FastAccessList<CFGNode*> successors;
+    node.forAllOutgoingEdges([&](CFGNode& successor, CFGEdge& edge) -> bool {
+        successors.push_back(&successor);
+        return true;
+    });
+    if(successors.size() != 2 || successors[0] == &node || successors[1] == &node)
+        return {};
+
+    auto isConditionalBlock = [&](CFGNode* candidate) -> bool {
+        return candidate->getSinglePredecessor() == &node && candidate->getSingleSuccessor() != nullptr &&
+            candidate->getSingleSuccessor() != &node && candidate->getSingleSuccessor() != candidate;
+    };
 
-                    // 3.) modify all instructions writing non-locals to only write under same condition as the
-                    // branch
-                    // XXX do we win anything in making all the instructions conditional? Technically this would be
-                    // possible
-                    for(auto loc : nonlocalLocals)
-                    {
-                        if(lastIt->writesLocal(loc) && lastIt.get<ExtendedInstruction>())
-                        {
-                            lastIt.get<ExtendedInstruction>()->setCondition(cond);
-                            break;
-                        }
-                    }
+    IfConversionRegion region{&block, InstructionWalker{}, {}, nullptr, {}};
+    FastAccessList<BasicBlock*> conditionalBlocks;
+    if(isConditionalBlock(successors[0]) && isConditionalBlock(successors[1]) &&
+        successors[0]->getSingleSuccessor() == successors[1]->getSingleSuccessor())
+    {
+        // if-then-else
+        conditionalBlocks = {successors[0]->key, successors[1]->key};
+        region.successor = successors[0]->getSingleSuccessor()->key;
+    }
+    else if(isConditionalBlock(successors[0]) && successors[0]->getSingleSuccessor() == successors[1])
+    {
+        // if-then
+        conditionalBlocks = {successors[0]->key};
+        region.successor = successors[1]->key;
+    }
+    else if(isConditionalBlock(successors[1]) && successors[1]->getSingleSuccessor() == successors[0])
+    {
+        // if-then
+        conditionalBlocks = {successors[1]->key};
+        region.successor = successors[0]->key;
+    }
+    else
+        return {};
 
-                    lastIt.nextInBlock();
-                }
+    auto firstBranch = findTerminatingBranches(block);
+    if(!firstBranch)
+        return {};
+    region.firstBranch = *firstBranch;
+    auto branch = region.firstBranch.get<const intermediate::Branch>();
+    if(branch->isUnconditional())
+        return {};
+    // the first branch jumps on the condition, any following branch (or fall-through) is the inverted case
+    auto condition = branch->branchCondition.toConditionCode();
+    for(auto conditionalBlock : conditionalBlocks)
+    {
+        if(!getConvertibleBlockSize(*conditionalBlock, *region.successor))
+            return {};
+        bool isBranchTarget = branch->getTarget() == conditionalBlock->getLabel()->getLabel();
+        region.conditionalBlocks.emplace_back(conditionalBlock, isBranchTarget ? condition : condition.invert());
+    }
 
-                // 4.) remove branch to original block
-                if(condVal)
-                    lastIt.erase();
+    auto flagsSetter = block.findLastSettingOfFlags(region.firstBranch);
+    if(!flagsSetter)
+        return {};
+    auto branchCondition =
+        intermediate::getBranchCondition(flagsSetter->get<const intermediate::ExtendedInstruction>());
+    if(branchCondition.first && branchCondition.second == 0x1)
+        // the flags are set by or-ing the scalar condition with the element number, which is not usable for
+        // conditional execution of all elements, so we need to set the flags for the condition itself
+        region.conditionValue = branchCondition.first;
+    else
+    {
+        // the flags are set directly by the condition, e.g. for conditional phi-nodes
+        auto move = flagsSetter->get<const intermediate::MoveOperation>();
+        if(!move || move->hasConditionalExecution() || !move->getOutput() || !move->getOutput()->hasRegister(REG_NOP))
+            return {};
+    }
+    return region;
+}
 
-                // 5.) remove original block
-                if(!method.removeBlock(*succ->key))
-                {
-                    CPPLOG_LAZY_BLOCK(logging::Level::WARNING, {
-                        logging::warn() << "Failed to remove move-from basic block: " << succ->key->to_string()
-                                        << logging::endl;
-                        succ->key->dumpInstructions();
-                    });
-                    // XXX throw exception here or continue??
-                }
+/*
+ * Returns all locals written in the given block which are accessed outside of it or read before their first write
+ * within the block. Writes to these locals need to be conditional, all other locals can be written unconditionally.
+ */
+static FastSet<const Local*> findNonLocalOutputs(const BasicBlock& block)
+{
+    FastSet<const LocalUser*> instructions;
+    for(const auto& inst : block)
+    {
+        if(inst)
+            instructions.emplace(inst.get());
+    }
+    FastSet<const Local*> writtenLocals;
+    FastSet<const Local*> nonLocalOutputs;
+    for(const auto& inst : block)
+    {
+        if(!inst)
+            continue;
+        for(const auto& arg : inst->getArguments())
+        {
+            if(auto loc = arg.checkLocal())
+            {
+                if(writtenLocals.find(loc) == writtenLocals.end())
+                    nonLocalOutputs.emplace(loc);
+            }
+        }
+        if(auto loc = inst->checkOutputLocal())
+        {
+            writtenLocals.emplace(loc);
+            for(const auto& user : loc->getUsers())
+            {
+                if(instructions.find(user.first) == instructions.end())
+                    nonLocalOutputs.emplace(loc);
+            }
+        }
+    }
+    // only the outputs are of interest
+    FastSet<const Local*> result;
+    for(auto loc : nonLocalOutputs)
+    {
+        if(writtenLocals.find(loc) != writtenLocals.end())
+            result.emplace(loc);
+    }
+    return result;
+}
 
-                // there is only one incoming edge
-                return false;
-            });
+static void convertToConditionalExecution(Method& method, IfConversionRegion& region)
+{
+    auto insertIt = region.firstBranch;
+    if(region.conditionValue)
+    {
+        // don't or with the element number, since we need to set the flags for all SIMD elements
+        insertIt.emplace(new intermediate::MoveOperation(
+            NOP_REGISTER, *region.conditionValue, COND_ALWAYS, SetFlag::SET_FLAGS));
+        insertIt.nextInBlock();
+    }
+
+    for(auto& pair : region.conditionalBlocks)
+    {
+        auto nonLocalOutputs = findNonLocalOutputs(*pair.first);
+        auto it = pair.first->walk().nextInBlock();
+        while(!it.isEndOfBlock())
+        {
+            if(!it.has() || it.get<intermediate::Branch>())
+            {
+                it.erase();
+                continue;
+            }
+            std::unique_ptr<intermediate::IntermediateInstruction> inst(it.release());
+            it.erase();
+            auto extendedInst = dynamic_cast<intermediate::ExtendedInstruction*>(inst.get());
+            auto loc = inst->checkOutputLocal();
+            if(extendedInst && loc && nonLocalOutputs.find(loc) != nonLocalOutputs.end())
+                extendedInst->setCondition(pair.second);
+            insertIt.emplace(inst.release());
+            insertIt.nextInBlock();
         }
+    }
 
-        // insert branch to successor block to guarantee we switch into that, independent of the block order
-        block.predecessor->key->walkEnd().emplace(
-            new intermediate::Branch(block.successor->key->getLabel()->getLabel()));
+    // remove the branches to the conditional blocks
+    while(!insertIt.isEndOfBlock())
+        insertIt.erase();
+    for(auto& pair : region.conditionalBlocks)
+    {
+        if(!method.removeBlock(*pair.first))
+            throw CompilationError(CompilationStep::OPTIMIZER,
+                "Failed to remove basic block converted to conditional execution", pair.first->to_string());
+    }
+    if(method.getNextBlockAfter(region.predecessor) != region.successor)
+        region.predecessor->walkEnd().emplace(new intermediate::Branch(region.successor->getLabel()->getLabel()));
+}
 
-        changedCode = true;
+bool optimizations::convertIfBlocks(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.empty())
+        return false;
+
+    FastAccessList<IfConversionRegion> regions;
+    for(auto& block : method)
+    {
+        auto region = findIfConversionRegion(method, block);
+        if(region && isIfConversionProfitable(method, *region))
+            regions.emplace_back(*region);
     }
 
-    return changedCode;
+    for(auto& region : regions)
+    {
+        CPPLOG_LAZY_BLOCK(logging::Level::DEBUG, {
+            logging::debug() << "Converting conditional blocks to conditional execution in: "
+                             << region.predecessor->to_string() << logging::endl;
+            for(const auto& pair : region.conditionalBlocks)
+                logging::debug() << "\t" << pair.first->to_string() << " (" << pair.second.to_string() << ')'
+                                 << logging::endl;
+            logging::debug() << "Successor: " << region.successor->to_string() << logging::endl;
+        });
+        convertToConditionalExecution(method, region);
+    }
+
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 339, "If-conversions", regions.size());
+    return !regions.empty();
 }
 
 // If we loop through all work-groups, the initial work-group id for all dimensions is always zero
@@ -1849,8 +3733,11 @@ static void resetReturnBranches(Method& method, BasicBlock& lastBlock, BasicBloc
 // - reads uniform address
 // - reads maximum values for all group id dimensions
 // - resets uniform pointer to previously read address
-NODISCARD static InstructionWalker insertAddressResetBlock(
-    Method& method, InstructionWalker it, const Value& maxGroupIdX, const Value& maxGroupIdY, const Value& maxGroupIdZ)
+//
+// If all UNIFORMs of the kernel code are read once before the work-group loop (see hoistWorkGroupUniforms()), the
+// remaining UNIFORMs are also read only once in the given block and the UNIFORM pointer is not reset.
+NODISCARD static InstructionWalker insertAddressResetBlock(Method& method, InstructionWalker it,
+    const Value& maxGroupIdX, const Value& maxGroupIdY, const Value& maxGroupIdZ, BasicBlock* uniformsBlock)
 {
     auto& lastBlock = *it.getBasicBlock();
     it = method.emplaceLabel(
@@ -1861,6 +3748,17 @@ NODISCARD static InstructionWalker insertAddressResetBlock(
     // insert after label, not before
     it.nextInBlock();
 
+    if(uniformsBlock)
+    {
+        auto uniformIt = uniformsBlock->walkEnd();
+        // the UNIFORM address still needs to be read to get to the following UNIFORMs
+        assign(uniformIt, NOP_REGISTER) = UNIFORM_REGISTER;
+        assign(uniformIt, maxGroupIdX) = UNIFORM_REGISTER;
+        assign(uniformIt, maxGroupIdY) = UNIFORM_REGISTER;
+        assign(uniformIt, maxGroupIdZ) = UNIFORM_REGISTER;
+        return it;
+    }
+
     auto tmp = assign(it, TYPE_INT32) = UNIFORM_REGISTER;
     assign(it, maxGroupIdX) = UNIFORM_REGISTER;
     assign(it, maxGroupIdY) = UNIFORM_REGISTER;
@@ -1925,15 +3823,15 @@ NODISCARD static InstructionWalker insertSingleDimensionRepetitionBlock(Method&
     return it;
 }
 
-static void insertRepetitionBlocks(
-    Method& method, const BasicBlock& defaultBlock, BasicBlock& lastBlock, bool mergeGroupIds)
+static void insertRepetitionBlocks(Method& method, const BasicBlock& defaultBlock, BasicBlock& lastBlock,
+    bool mergeGroupIds, BasicBlock* uniformsBlock)
 {
     auto maxGroupIdX = method.findOrCreateBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_X)->createReference();
     auto maxGroupIdY = method.findOrCreateBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_Y)->createReference();
     auto maxGroupIdZ = method.findOrCreateBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_Z)->createReference();
 
     auto it = lastBlock.walk();
-    it = insertAddressResetBlock(method, it, maxGroupIdX, maxGroupIdY, maxGroupIdZ);
+    it = insertAddressResetBlock(method, it, maxGroupIdX, maxGroupIdY, maxGroupIdZ, uniformsBlock);
 
     auto groupIdX = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_X)->createReference();
     it = insertSingleDimensionRepetitionBlock(
@@ -1948,6 +3846,428 @@ static void insertRepetitionBlocks(
         method, defaultBlock, groupIdZ, maxGroupIdZ, it, groupIdY.local(), mergeGroupIds ? 2 : -1);
 }
 
+/*
+ * Returns whether the given instruction only reads/writes registers which allow it to be executed once before the
+ * work-group loop instead of at the beginning of every work-group
+ */
+static bool hasOnlyDispatchUniformRegisterAccesses(const IntermediateInstruction& inst)
+{
+    if(inst.getSignal().hasSideEffects())
+        return false;
+    if(auto reg = inst.checkOutputRegister())
+    {
+        if(*reg != REG_NOP && *reg != REG_TMU_NOSWAP)
+            return false;
+    }
+    return std::all_of(inst.getArguments().begin(), inst.getArguments().end(), [](const Value& arg) -> bool {
+        return !arg.checkRegister() || arg.hasRegister(REG_UNIFORM) || arg.hasRegister(REG_ELEMENT_NUMBER) ||
+            arg.hasRegister(REG_QPU_NUMBER);
+    });
+}
+
+static bool isOnlyWrittenBy(const Value& val, const FastSet<const IntermediateInstruction*>& writers)
+{
+    auto loc = val.checkLocal();
+    if(!loc)
+        return true;
+    if(loc->is<Global>())
+        return false;
+    const auto& localWriters = loc->getUsers(LocalUse::Type::WRITER);
+    return std::all_of(localWriters.begin(), localWriters.end(),
+        [&](const LocalUser* writer) -> bool { return writers.find(writer) != writers.end(); });
+}
+
+/*
+ * Moves the loading of the UNIFORMs (work-item info and parameters) at the start of the kernel code in front of the
+ * work-group loop.
+ *
+ * Since the UNIFORM pointer is reset to the same UNIFORM values for every work-group, all UNIFORMs (except for the
+ * group ids, which are already removed) have the same value for all work-groups of the dispatch. This is only done if
+ * all UNIFORMs are read there, since otherwise the UNIFORM pointer still needs to be reset for every work-group.
+ *
+ * Returns the instructions moved in front of the work-group loop.
+ */
+static FastSet<const IntermediateInstruction*> hoistWorkGroupUniforms(
+    Method& method, BasicBlock& defaultBlock, BasicBlock& startBlock)
+{
+    FastSet<const IntermediateInstruction*> leadingInstructions;
+    for(auto it = defaultBlock.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(!(it.get<Operation>() || it.get<MoveOperation>() || it.get<intermediate::LoadImmediate>()) ||
+            !hasOnlyDispatchUniformRegisterAccesses(*it.get()))
+            break;
+        leadingInstructions.emplace(it.get());
+    }
+
+    // all locals read and written need to be only written in the moved instructions
+    FastSet<const IntermediateInstruction*> hoisted;
+    FastAccessList<InstructionWalker> hoistedWalkers;
+    auto lastSettingOfFlags = defaultBlock.walk();
+    for(auto it = defaultBlock.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(leadingInstructions.find(it.get()) == leadingInstructions.end() ||
+            !std::all_of(it->getArguments().begin(), it->getArguments().end(),
+                [&](const Value& arg) -> bool { return isOnlyWrittenBy(arg, hoisted); }) ||
+            (it->getOutput() && !isOnlyWrittenBy(it->getOutput().value(), leadingInstructions)))
+            break;
+        hoisted.emplace(it.get());
+        hoistedWalkers.emplace_back(it);
+        if(it->doesSetFlag())
+            lastSettingOfFlags = it;
+    }
+
+    for(auto& block : method)
+    {
+        if(&block == &startBlock)
+            continue;
+        for(const auto& inst : block)
+        {
+            if(inst && inst->readsRegister(REG_UNIFORM) && hoisted.find(inst.get()) == hoisted.end())
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Cannot move UNIFORM loads out of work-group loop, since UNIFORMs are also read in: "
+                        << inst->to_string() << logging::endl);
+                return {};
+            }
+        }
+    }
+    if(!lastSettingOfFlags.isStartOfBlock())
+    {
+        // the flags set by the moved instructions must not be used by the remaining kernel code
+        for(auto it = hoistedWalkers.back().copy().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            auto branch = it.get<intermediate::Branch>();
+            if(it->hasConditionalExecution() || (branch && !branch->isUnconditional()))
+                return {};
+            if(it->doesSetFlag())
+                break;
+        }
+    }
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Moving " << hoistedWalkers.size() << " instructions loading UNIFORMs out of work-group loop"
+            << logging::endl);
+    auto insertIt = startBlock.walkEnd();
+    for(auto& it : hoistedWalkers)
+    {
+        insertIt.emplace(it.release());
+        insertIt.nextInBlock();
+        it.erase();
+    }
+    return hoisted;
+}
+
+/*
+ * Moves the calculations at the start of the kernel code which only depend on values calculated in front of the
+ * work-group loop (e.g. parameters and work-item info) in front of the work-group loop too
+ */
+static void hoistWorkGroupUniformCalculations(
+    Method& method, BasicBlock& defaultBlock, BasicBlock& startBlock, FastSet<const IntermediateInstruction*>& hoisted)
+{
+    // Hoisting a calculation extends the life-time of its result to the whole kernel code, so only as many calculations
+    // are moved as there are registers free, to not force locals to be spilled.
+    method.getAnalyses().invalidate();
+    const auto& registerPressure = method.getAnalyses().getRegisterPressure();
+    auto freeRegisters = std::numeric_limits<unsigned>::max();
+    for(auto& block : method)
+    {
+        if(&block != &startBlock)
+            freeRegisters = std::min(freeRegisters, registerPressure.getMaximumPressure(block).getFreeRegisters());
+    }
+
+    auto isDispatchUniform = [&](const Value& arg) -> bool {
+        if(arg.checkRegister())
+            return arg.hasRegister(REG_ELEMENT_NUMBER) || arg.hasRegister(REG_QPU_NUMBER);
+        return isOnlyWrittenBy(arg, hoisted);
+    };
+    auto insertIt = startBlock.walkEnd();
+    auto it = defaultBlock.walk().nextInBlock();
+    while(!it.isEndOfBlock() && freeRegisters > 0)
+    {
+        auto move = it.get<MoveOperation>();
+        auto isPure = it.get<Operation>() || it.get<intermediate::LoadImmediate>() || (move && move->isSimpleMove());
+        if(!isPure || it->hasConditionalExecution() || it->doesSetFlag() || it->hasSideEffects() ||
+            !it->checkOutputLocal() || it->checkOutputLocal()->getUsers(LocalUse::Type::WRITER).size() != 1 ||
+            !std::all_of(it->getArguments().begin(), it->getArguments().end(), isDispatchUniform))
+        {
+            it.nextInBlock();
+            continue;
+        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Moving work-group uniform calculation out of work-group loop: " << it->to_string()
+                << logging::endl);
+        hoisted.emplace(it.get());
+        --freeRegisters;
+        insertIt.emplace(it.release());
+        insertIt.nextInBlock();
+        it.erase();
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 343, "Work-group uniform calculations moved", 1);
+    }
+}
+
+/*
+ * Returns whether the work-items of the given kernel can be distributed dynamically across the QPUs, i.e. whether the
+ * work-items of a work-group do not need to be executed at the same time by the QPUs started for the work-group.
+ */
+static bool canDistributeWorkItemsDynamically(Method& method, const Configuration& config)
+{
+    if(method.metaData.workItemsPerQPU != 1 || config.generateThreadedCode)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Cannot distribute coarsened or threaded work-items dynamically, using static work-group loop"
+                << logging::endl);
+        return false;
+    }
+    auto isLocalMemory = [](const Value& val) -> bool {
+        auto ptrType = val.type.getPointerType();
+        return ptrType && ptrType->addressSpace == AddressSpace::LOCAL;
+    };
+    if(method.vpm->countAreas(periphery::VPMUsage::LOCAL_MEMORY) != 0 ||
+        std::any_of(method.parameters.begin(), method.parameters.end(),
+            [&](const Parameter& param) -> bool { return isLocalMemory(param.createReference()); }))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Cannot distribute work-items sharing local memory dynamically, using static work-group loop"
+                << logging::endl);
+        return false;
+    }
+    for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+    {
+        if(!it.has())
+            continue;
+        // barriers are the only instructions using the semaphores, they require all work-items of the group to be run
+        // at the same time
+        if(it.get<intermediate::SemaphoreAdjustment>() ||
+            std::any_of(it->getArguments().begin(), it->getArguments().end(), isLocalMemory))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Cannot distribute work-items dynamically, since they need to be synchronized for: "
+                    << it->to_string() << logging::endl);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the read of the UNIFORM writing the given local in the given block, if any
+static Optional<InstructionWalker> findUniformRead(BasicBlock& block, const Local* loc)
+{
+    for(auto it = block.walk(); loc && !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(it.has() && it->readsRegister(REG_UNIFORM) && it->writesLocal(loc))
+            return it;
+    }
+    return {};
+}
+
+// Inserts a new (empty) basic block in front of the given block and returns its end
+static InstructionWalker insertBlockBefore(Method& method, BasicBlock& successor, const std::string& name)
+{
+    auto it = method.emplaceLabel(
+        successor.walk(), new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL, "", name).local()));
+    return it.nextInBlock();
+}
+
+// Inserts a branch to the given block which is taken if the given condition is met
+static InstructionWalker insertConditionalBranch(
+    Method& method, InstructionWalker it, ConditionCode cond, const BasicBlock& target)
+{
+    auto condValue = method.addNewLocal(TYPE_BOOL);
+    assign(it, condValue) = (BOOL_TRUE, cond);
+    assign(it, condValue) = (BOOL_FALSE, cond.invert());
+    BranchCond branchCond = BRANCH_ALWAYS;
+    std::tie(it, branchCond) = intermediate::insertBranchCondition(method, it, condValue);
+    it.emplace(new intermediate::Branch(target.getLabel()->getLabel(), branchCond));
+    it.nextInBlock();
+    return it;
+}
+
+// Extracts the local size of the given dimension from the packed local sizes. Since the sizes of unused dimensions
+// might be zero, the size is at least one.
+static Value extractLocalSize(InstructionWalker& it, const Value& localSizes, uint8_t dimension)
+{
+    auto shiftedSizes = localSizes;
+    if(dimension > 0)
+        shiftedSizes = assign(it, TYPE_INT32, "%local_sizes") = as_unsigned{localSizes} >>
+            Value(Literal(static_cast<uint32_t>(dimension * 8)), TYPE_INT8);
+    auto size = assign(it, TYPE_INT32, "%local_size") = shiftedSizes & 255_val;
+    return assign(it, TYPE_INT32, "%local_size") = max(as_signed{size}, as_signed{INT_ONE});
+}
+
+// Fills the given block with the repetition of
+//   if(%coordinate >= %limit) { %coordinate -= %limit; %next_coordinate += 1; }
+// until the coordinate lies within its limit, i.e. carries the overflow of the coordinate into the next coordinate.
+static void insertCarryBlock(
+    Method& method, BasicBlock& block, const Value& coordinate, const Value& limit, const Value& nextCoordinate)
+{
+    auto it = block.walkEnd();
+    auto cond = assignNop(it) = as_signed{coordinate} >= as_signed{limit};
+    assign(it, coordinate) = (coordinate - limit, cond);
+    assign(it, nextCoordinate) = (nextCoordinate + INT_ONE, cond);
+    insertConditionalBranch(method, it, cond, block);
+}
+
+/*
+ * Inserts the loop distributing the work-items of all work-groups dynamically across the QPUs:
+ *
+ * The QPUs repeatedly fetch and increment the index of the next work-item to execute from a counter in VPM, guarded by
+ * the hardware mutex, until all work-items of all work-groups are processed. Since the work-items are numbered
+ * linearly (local ID X, Y, Z, then group ID X, Y, Z), the local and group IDs of the fetched work-item are determined
+ * by carrying the distance to the previously fetched work-item through the IDs of all dimensions.
+ *
+ * The counter is initialized by the QPU running the work-item with local ID zero, which then signals all other QPUs
+ * via a semaphore to start fetching work-items.
+ */
+static void insertWorkItemDistribution(Method& method, BasicBlock& defaultBlock, BasicBlock& lastBlock,
+    BasicBlock& startBlock, bool mergedGroupIds, const periphery::VPMArea& counterArea)
+{
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Distributing work-items dynamically across QPUs via counter in VPM row "
+            << static_cast<unsigned>(counterArea.rowOffset) << logging::endl);
+    auto workInfoDecorations =
+        add_flag(InstructionDecorations::UNSIGNED_RESULT, InstructionDecorations::WORK_GROUP_UNIFORM_VALUE);
+
+    // The local sizes and the (initial) local IDs are needed to calculate the local IDs of the fetched work-items
+    auto localSizes = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_SIZES);
+    auto sizesRead = findUniformRead(startBlock, localSizes);
+    if(!sizesRead)
+    {
+        auto it = startBlock.walk().nextInBlock();
+        if(auto dimensionsRead = findUniformRead(startBlock, method.findBuiltin(BuiltinLocal::Type::WORK_DIMENSIONS)))
+            it = dimensionsRead->copy().nextInBlock();
+        else
+        {
+            while(!it.isEndOfBlock() && !(it.has() && it->readsRegister(REG_UNIFORM)))
+                it.nextInBlock();
+        }
+        it.emplace((new MoveOperation(localSizes->createReference(), Value(REG_UNIFORM, TYPE_INT32)))
+                       ->addDecorations(workInfoDecorations));
+        sizesRead = it;
+    }
+    auto qpuLocalIds = method.addNewLocal(TYPE_INT32, "%qpu_local_ids");
+    auto localIds = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_IDS);
+    if(auto idsRead = findUniformRead(startBlock, localIds))
+        // the local IDs builtin is now written for every fetched work-item
+        (*idsRead)->setOutput(qpuLocalIds);
+    else
+    {
+        auto it = sizesRead->copy().nextInBlock();
+        it.emplace((new MoveOperation(qpuLocalIds, Value(REG_UNIFORM, TYPE_INT32)))
+                       ->addDecorations(InstructionDecorations::UNSIGNED_RESULT));
+    }
+
+    // Redirect the end of the kernel code to the fetching of the next work-item. This also loads the number of
+    // work-groups per dimension and therefore needs to be done after inserting all other UNIFORM reads.
+    auto maxGroupIdX = method.findOrCreateBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_X)->createReference();
+    auto maxGroupIdY = method.findOrCreateBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_Y)->createReference();
+    auto maxGroupIdZ = method.findOrCreateBuiltin(BuiltinLocal::Type::MAX_GROUP_ID_Z)->createReference();
+    auto resetIt =
+        insertAddressResetBlock(method, lastBlock.walk(), maxGroupIdX, maxGroupIdY, maxGroupIdZ, &startBlock);
+
+    auto setupIt = insertBlockBefore(method, defaultBlock, "%work_item_setup");
+    auto waitIt = insertBlockBefore(method, defaultBlock, "%work_counter_wait");
+    auto initIt = insertBlockBefore(method, defaultBlock, "%work_counter_init");
+    auto signalIt = insertBlockBefore(method, defaultBlock, "%work_counter_signal");
+    auto fetchIt = insertBlockBefore(method, defaultBlock, "%work_item_fetch");
+    auto& signalBlock = *signalIt.getBasicBlock();
+    auto& fetchBlock = *fetchIt.getBasicBlock();
+
+    auto localIdX = method.addNewLocal(TYPE_INT32, "%local_id_x");
+    auto localIdY = method.addNewLocal(TYPE_INT32, "%local_id_y");
+    auto localIdZ = method.addNewLocal(TYPE_INT32, "%local_id_z");
+    auto groupIdX = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_X)->createReference();
+    auto groupIdY = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_Y)->createReference();
+    auto groupIdZ = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_Z)->createReference();
+    auto previousIndex = method.addNewLocal(TYPE_INT32, "%previous_work_item");
+
+    // label: %work_item_setup
+    auto localSizeX = extractLocalSize(setupIt, localSizes->createReference(), 0);
+    auto localSizeY = extractLocalSize(setupIt, localSizes->createReference(), 1);
+    auto localSizeZ = extractLocalSize(setupIt, localSizes->createReference(), 2);
+    for(const auto& id : {localIdX, localIdY, localIdZ, previousIndex})
+        assign(setupIt, id) = INT_ZERO;
+    if(mergedGroupIds)
+    {
+        // the group IDs are only initialized in their merged form
+        for(const auto& id : {groupIdX, groupIdY, groupIdZ})
+            assign(setupIt, id) = INT_ZERO;
+    }
+    auto cond = assignNop(setupIt) = as_unsigned{qpuLocalIds} == as_unsigned{INT_ZERO};
+    insertConditionalBranch(method, setupIt, cond, *initIt.getBasicBlock());
+
+    // label: %work_counter_wait
+    waitIt.emplace(new intermediate::SemaphoreAdjustment(Semaphore::BARRIER_WORK_ITEM_0, false));
+    waitIt.nextInBlock();
+    waitIt.emplace(new intermediate::Branch(fetchBlock.getLabel()->getLabel(), BRANCH_ALWAYS));
+
+    // label: %work_counter_init
+    initIt.emplace(new intermediate::MutexLock(intermediate::MutexAccess::LOCK));
+    initIt.nextInBlock();
+    initIt = method.vpm->insertWriteVPM(method, initIt, INT_ZERO, &counterArea, false);
+    initIt.emplace(new intermediate::MutexLock(intermediate::MutexAccess::RELEASE));
+    initIt.nextInBlock();
+    // every QPU started (one per work-item of the work-group) except this one waits for the signal
+    auto numItems = assign(initIt, TYPE_INT32, "%num_local_items") = mul24(localSizeX, localSizeY);
+    numItems = assign(initIt, TYPE_INT32, "%num_local_items") = mul24(numItems, localSizeZ);
+    auto numSignals = method.addNewLocal(TYPE_INT32, "%work_counter_signals");
+    assign(initIt, numSignals) = numItems - INT_ONE;
+    cond = assignNop(initIt) = as_unsigned{numSignals} == as_unsigned{INT_ZERO};
+    insertConditionalBranch(method, initIt, cond, fetchBlock);
+
+    // label: %work_counter_signal
+    signalIt.emplace(new intermediate::SemaphoreAdjustment(Semaphore::BARRIER_WORK_ITEM_0, true));
+    signalIt.nextInBlock();
+    assign(signalIt, numSignals) = numSignals - INT_ONE;
+    cond = assignNop(signalIt) = as_unsigned{numSignals} != as_unsigned{INT_ZERO};
+    insertConditionalBranch(method, signalIt, cond, signalBlock);
+
+    // label: %work_item_fetch
+    fetchIt.emplace(new intermediate::MutexLock(intermediate::MutexAccess::LOCK));
+    fetchIt.nextInBlock();
+    auto currentIndex = method.addNewLocal(TYPE_INT32, "%work_item");
+    fetchIt = method.vpm->insertReadVPM(method, fetchIt, currentIndex, &counterArea, false);
+    auto nextIndex = assign(fetchIt, TYPE_INT32, "%next_work_item") = currentIndex + INT_ONE;
+    fetchIt = method.vpm->insertWriteVPM(method, fetchIt, nextIndex, &counterArea, false);
+    fetchIt.emplace(new intermediate::MutexLock(intermediate::MutexAccess::RELEASE));
+    fetchIt.nextInBlock();
+    auto distance = assign(fetchIt, TYPE_INT32, "%work_item_distance") = currentIndex - previousIndex;
+    assign(fetchIt, previousIndex) = currentIndex;
+    assign(fetchIt, localIdX) = localIdX + distance;
+
+    // label: %carry_local_id_x, ..., %carry_group_id_y
+    const std::array<Value, 6> coordinates{localIdX, localIdY, localIdZ, groupIdX, groupIdY, groupIdZ};
+    const std::array<Value, 5> limits{localSizeX, localSizeY, localSizeZ, maxGroupIdX, maxGroupIdY};
+    for(std::size_t i = 0; i < limits.size(); ++i)
+    {
+        auto it = insertBlockBefore(method, defaultBlock, "%carry_" + coordinates[i].local()->name.substr(1));
+        insertCarryBlock(method, *it.getBasicBlock(), coordinates[i], limits[i], coordinates[i + 1]);
+    }
+
+    // label: %work_item_ids
+    auto idsIt = insertBlockBefore(method, defaultBlock, "%work_item_ids");
+    if(!localIds->getUsers(LocalUse::Type::READER).empty())
+    {
+        auto shiftedY = assign(idsIt, TYPE_INT32, "%local_ids") = localIdY << 8_val;
+        auto shiftedZ = assign(idsIt, TYPE_INT32, "%local_ids") = localIdZ << 16_val;
+        auto mergedXY = assign(idsIt, TYPE_INT32, "%local_ids") = localIdX | shiftedY;
+        assign(idsIt, localIds->createReference()) = (mergedXY | shiftedZ, InstructionDecorations::UNSIGNED_RESULT);
+    }
+    // all work-items are processed if the group ID in the highest dimension overflows
+    cond = assignNop(idsIt) = as_signed{groupIdZ} >= as_signed{maxGroupIdZ};
+    insertConditionalBranch(method, idsIt, cond, lastBlock);
+
+    // label: %work_group_repetition
+    resetIt.emplace((new intermediate::Branch(fetchBlock.getLabel()->getLabel(), BRANCH_ALWAYS))
+                        ->addDecorations(InstructionDecorations::WORK_GROUP_LOOP));
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 348, "Dynamic work-item distributions", 1);
+}
+
 bool optimizations::addWorkGroupLoop(const Module& module, Method& method, const Configuration& config)
 {
     if(method.walkAllInstructions().isEndOfMethod())
@@ -1978,8 +4298,29 @@ bool optimizations::addWorkGroupLoop(const Module& module, Method& method, const
     // Remove reads of UNIFORMs for group ids and move initializing to zero out of loop
     bool groupIdsNotUsed = moveGroupIdInitializers(method, defaultBlock, startBlock);
 
-    // Insert all the code required to increment/reset the ids and repeat the kernel code
-    insertRepetitionBlocks(method, defaultBlock, *lastBlock, groupIdsNotUsed);
+    // Load the UNIFORMs which are the same for all work-groups only once
+    auto hoistedInstructions = hoistWorkGroupUniforms(method, defaultBlock, startBlock);
+
+    // The dynamic distribution relies on the UNIFORMs being read only once, since the QPUs execute different numbers
+    // of work-items
+    const periphery::VPMArea* counterArea = nullptr;
+    if(config.distributeWorkItemsDynamically && !hoistedInstructions.empty() &&
+        canDistributeWorkItemsDynamically(method, config))
+    {
+        auto counter = method.addNewLocal(TYPE_INT32, "%work_item_counter");
+        counterArea = method.vpm->addArea(counter.local(), TYPE_INT32, false);
+    }
+
+    if(counterArea)
+        // Insert the code fetching the next work-item to execute and calculating its ids
+        insertWorkItemDistribution(method, defaultBlock, *lastBlock, startBlock, groupIdsNotUsed, *counterArea);
+    else
+        // Insert all the code required to increment/reset the ids and repeat the kernel code
+        insertRepetitionBlocks(
+            method, defaultBlock, *lastBlock, groupIdsNotUsed, hoistedInstructions.empty() ? nullptr : &startBlock);
+
+    if(!hoistedInstructions.empty())
+        hoistWorkGroupUniformCalculations(method, defaultBlock, startBlock, hoistedInstructions);
 
     // set correct information to metadata
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Adjusting kernel metadata..." << logging::endl);
@@ -1990,6 +4331,11 @@ bool optimizations::addWorkGroupLoop(const Module& module, Method& method, const
     method.metaData.uniformsUsed.setMaxGroupIDXUsed(true);
     method.metaData.uniformsUsed.setMaxGroupIDYUsed(true);
     method.metaData.uniformsUsed.setMaxGroupIDZUsed(true);
+    if(counterArea)
+    {
+        method.metaData.uniformsUsed.setLocalSizesUsed(true);
+        method.metaData.uniformsUsed.setLocalIDsUsed(true);
+    }
 
     return true;
 }
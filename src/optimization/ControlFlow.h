@@ -23,6 +23,133 @@ namespace vc4c
          */
         bool vectorizeLoops(const Module& module, Method& method, const Configuration& config);
 
+        /*
+         * Unrolls inner-most loops consisting of a single basic block with a statically known number of iterations.
+         *
+         * If the whole unrolled loop fits into the configured instruction limit, the loop is fully unrolled and the
+         * loop branch is removed. Otherwise, the loop body is repeated by the largest factor dividing the number of
+         * iterations and still fitting the limit. Since every loop back-edge costs a branch and its 3 delay slots, this
+         * mainly improves small loops with many iterations.
+         *
+         * Example:
+         *   label: %loop
+         *   [body]
+         *   br.ifallzc %loop
+         *
+         * is converted to (for an unroll factor of 2):
+         *   label: %loop
+         *   [body]
+         *   [body]
+         *   br.ifallzc %loop
+         *
+         * NOTE: Loops are not unrolled, if the register pressure within the loop is already (nearly) exhausted or the
+         * execution profile (if any) shows that the loop is never executed.
+         */
+        bool unrollLoops(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Software-pipelines the first TMU load of inner-most single-block loops, i.e. issues the load for the next
+         * iteration at the end of the current iteration, so the memory access latency is hidden behind the loop
+         * condition and branch instead of stalling the loading of the result.
+         *
+         * Example:
+         *   label: %loop
+         *   %addr = add %base, %offset
+         *   tmu0_s = %addr
+         *   nop (ldtmu0)
+         *   %val = r4
+         *   [body]
+         *   - = or.setf elem_num, %cond
+         *   br.ifallzc %loop
+         *   label: %exit
+         *
+         * is converted to:
+         *   %addr = add %base, %offset
+         *   tmu0_s = %addr
+         *   label: %loop
+         *   nop (ldtmu0)
+         *   %val = r4
+         *   [body]
+         *   %addr = add %base, %offset
+         *   tmu0_s = %addr
+         *   - = or.setf elem_num, %cond
+         *   br.ifallzc %loop
+         *   label: %exit
+         *   nop (ldtmu0)
+         *
+         * Similarly, a DMA load of a single 32-bit vector at the beginning of the loop body is pipelined by loading
+         * into a VPM row reserved for every QPU (see periphery::VPMUsage::DMA_BUFFER). The hardware mutex is released
+         * while the DMA load is executed, so the DMA load of the next iteration runs in parallel to the loop condition
+         * and the other QPUs accessing the VPM, and only the wait for the DMA load and the reading of the loaded row
+         * are executed at the beginning of the next iteration.
+         *
+         * NOTE: This reads the memory one iteration past the last loop iteration, the result of which is discarded.
+         */
+        bool pipelineLoopLoads(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Replaces the calculation of values linear in a loop induction variable (e.g. the element addresses
+         * base + i * stride) in every iteration with a running value initialized before the loop and incremented
+         * together with the induction variable.
+         *
+         * Since the multiplications are already converted to shifts, additions and mul24 instructions, these are the
+         * calculations recognized. The calculation is only replaced if this saves at least one instruction per
+         * iteration, the instructions no longer used are removed by the dead code elimination.
+         *
+         * Example:
+         *   label: %loop
+         *   %i = %i.initial (phi)
+         *   [...]
+         *   %offset = shl %i, 2
+         *   %addr = add %base, %offset
+         *   [...]
+         *   %i.next = add %i, 1
+         *   %i = %i.next (phi)
+         *   br %loop
+         *
+         * is converted to:
+         *   %offset = shl %i, 2
+         *   %addr.running = add %base, %offset
+         *   label: %loop
+         *   [...]
+         *   %offset = shl %i, 2
+         *   %addr = %addr.running
+         *   [...]
+         *   %i.next = add %i, 1
+         *   %i = %i.next (phi)
+         *   %addr.running = add %addr.running, 4
+         *   br %loop
+         */
+        bool reduceStrengthInLoops(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Moves the instructions calculating the same value in every loop iteration (e.g. values calculated from the
+         * work-group info or kernel parameters) out of the loop into the block preceding the loop. Since the inner-most
+         * loops are processed first, invariant instructions can be moved out of several nested loops.
+         *
+         * Only instructions which can be executed speculatively (without side-effects, flags or conditional execution)
+         * and whose output is not written anywhere else are moved. The number of moved instructions is limited by the
+         * registers free inside the loop, since the life-time of the moved values extends over the whole loop.
+         *
+         * NOTE: Together with the common subexpression elimination (which operates on the dominator tree), this also
+         * removes the redundancy of values calculated both in front and inside of the loop.
+         *
+         * Example:
+         *   label: %loop
+         *   %size = mul24 %local_size, %group_id
+         *   %index = add %size, %i
+         *   [...]
+         *   br %loop
+         *
+         * is converted to:
+         *   %size = mul24 %local_size, %group_id
+         *   label: %loop
+         *   %index = add %size, %i
+         *   [...]
+         *   br %loop
+         */
+        bool moveLoopInvariantCode(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Adds the start- and stop-segment to the kernel code
          *
@@ -59,9 +186,15 @@ namespace vc4c
         bool mergeAdjacentBasicBlocks(const Module& module, Method& method, const Configuration& config);
 
         /*
-         * Reorders basic blocks so as much transitions as possible can be replaced by implicit transitions in
+         * Reorders basic blocks so the most often taken transitions can be replaced by implicit transitions in
          * #simplifyBranches.
          *
+         * The blocks are greedily concatenated to chains along the transitions taken most often, as given by the
+         * execution profile (if any) or estimated statically (loop back-edges are assumed to be taken, transitions
+         * inside of loops are preferred over transitions outside of loops). Afterwards, small blocks with several
+         * predecessors are copied into the predecessors unconditionally branching to them, removing the taken branch
+         * into the block (see OptimizationOptions#maxTailDuplicationSize), unless optimizing for size.
+         *
          * Example:
          *   br %4
          *   label: %3
@@ -81,6 +214,8 @@ namespace vc4c
          *   [...]
          *   br %5
          *   label: %5
+         *
+         * NOTE: The first block and the last block (if any) of the method are never moved.
          */
         bool reorderBasicBlocks(const Module& module, Method& method, const Configuration& config);
 
@@ -123,6 +258,37 @@ namespace vc4c
          */
         bool simplifyConditionalBlocks(const Module& module, Method& method, const Configuration& config);
 
+        /**
+         * Converts small if-then and if-then-else regions of the control flow to conditional execution of the
+         * instructions of all conditional blocks, removing the branches and their delay slots.
+         *
+         * Only blocks without side-effects are converted. Writes of locals used outside of the conditional blocks
+         * are executed under the condition the block was originally executed for, all other instructions are executed
+         * unconditionally. A region is only converted, if the costs of executing all conditional blocks do not exceed
+         * the average costs of the original paths including their branches.
+         *
+         * Example:
+         *   - = or.setf elem_num, %cond
+         *   br.ifallzc %1
+         *   br %2
+         *   label: %1
+         *   %a = add %b, 1
+         *   %c = %a
+         *   br %3
+         *   label: %2
+         *   %c = 42
+         *   label: %3
+         *
+         * is converted to:
+         *   - = or.setf elem_num, %cond
+         *   - = mov.setf %cond
+         *   %a = add %b, 1
+         *   %c = %a (ifzc)
+         *   %c = 42 (ifz)
+         *   label: %3
+         */
+        bool convertIfBlocks(const Module& module, Method& method, const Configuration& config);
+
         /**
          * Extends kernel code to be able to run for all work-groups without the need to return to host-code.
          *
@@ -134,6 +300,17 @@ namespace vc4c
          *
          * Also moves the group id variables to the start of the kernel to be only loaded once.
          *
+         * If all the UNIFORMs of the kernel code (the work-item info and the parameters) are loaded at its beginning,
+         * the loading is moved in front of the work-group loop too, since the values are the same for all work-groups
+         * of the dispatch. Then the UNIFORM pointer no longer needs to be reset and the calculations at the beginning
+         * of the kernel code only depending on these values are moved out of the loop as well (limited by the number
+         * of free registers).
+         *
+         * If enabled in the configuration and the work-items of the kernel do not need to be executed at the same time
+         * (i.e. do not use barriers or local memory), the static loop over the work-groups is replaced by the QPUs
+         * fetching the next work-item to execute from a counter in VPM. Since every QPU executes one work-item at a
+         * time, this distributes the work at work-item granularity and balances work-items of differing run-time.
+         *
          * Generates:
          * label: %start_of_kernel
          * %gid_x = 0
@@ -7,12 +7,15 @@
 #include "Eliminator.h"
 
 #include "../InstructionWalker.h"
+#include "../Logging.h"
 #include "../Profiler.h"
+#include "../analysis/AnalysisManager.h"
 #include "../analysis/AvailableExpressionAnalysis.h"
+#include "../analysis/DominatorTree.h"
+#include "../analysis/InterferenceGraph.h"
 #include "../intermediate/Helper.h"
 #include "../normalization/LiteralValues.h"
 #include "../periphery/SFU.h"
-#include "log.h"
 
 #include <algorithm>
 #include <list>
@@ -54,7 +57,7 @@ bool optimizations::eliminateDeadCode(const Module& module, Method& method, cons
                     bool isRead = !dest->getUsers(LocalUse::Type::READER).empty();
                     if(!isRead)
                     {
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Removing instruction " << instr->to_string() << ", since its output is never read"
                                 << logging::endl);
                         it.erase();
@@ -81,7 +84,7 @@ bool optimizations::eliminateDeadCode(const Module& module, Method& method, cons
                     if(!isWrittenTo && inLoc->type == outLoc->type)
                     {
                         // TODO what if both locals are written before (and used differently), possible??
-                        CPPLOG_LAZY(logging::Level::DEBUG,
+                        LOG_LAZY(logging::Level::DEBUG,
                             log << "Merging locals " << inLoc->to_string() << " and " << outLoc->to_string()
                                 << " since they contain the same value" << logging::endl);
                         outLoc->forUsers(LocalUse::Type::READER, [inLoc, outLoc](const LocalUser* instr) -> void {
@@ -147,7 +150,7 @@ bool optimizations::eliminateDeadCode(const Module& module, Method& method, cons
 
                         if(disableFunc)
                         {
-                            CPPLOG_LAZY(logging::Level::DEBUG,
+                            LOG_LAZY(logging::Level::DEBUG,
                                 log << "Removing read of work-group UNIFORM, since it is never used: "
                                     << move->to_string() << logging::endl);
                             // disable work-group UNIFORM from method
@@ -195,7 +198,7 @@ bool optimizations::eliminateDeadCode(const Module& module, Method& method, cons
 
             if(!isUsed)
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Removing write to special purpose register which is never used: " << it->to_string()
                         << logging::endl);
                 it.erase();
@@ -218,7 +221,7 @@ bool optimizations::eliminateDeadCode(const Module& module, Method& method, cons
             }
             if(!checkIt.isEndOfBlock() && !checkIt->readsLocal(loc))
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Removing write to local which is overridden before the next read: " << it->to_string()
                         << logging::endl);
                 it.erase();
@@ -263,7 +266,7 @@ InstructionWalker optimizations::simplifyOperation(
             // one of the operands is the absorbing element, operation can be replaced with move
             if(leftAbsorbing && firstArg.hasLiteral(leftAbsorbing->getLiteralValue().value()))
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Replacing obsolete " << op->to_string() << " with move 1" << logging::endl);
                 it.reset((new intermediate::MoveOperation(
                               op->getOutput().value(), leftAbsorbing.value(), op->getCondition(), op->getFlags()))
@@ -271,7 +274,7 @@ InstructionWalker optimizations::simplifyOperation(
             }
             else if(rightAbsorbing && secondArg && secondArg->hasLiteral(rightAbsorbing->getLiteralValue().value()))
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Replacing obsolete " << op->to_string() << " with move 2" << logging::endl);
                 it.reset((new intermediate::MoveOperation(
                               op->getOutput().value(), rightAbsorbing.value(), op->getCondition(), op->getFlags()))
@@ -282,7 +285,7 @@ InstructionWalker optimizations::simplifyOperation(
             {
                 // do not replace xor true, true, since this is almost always combined with or true, true for inverted
                 // condition
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Replacing obsolete " << op->to_string() << " with move 7" << logging::endl);
                 it.reset((new intermediate::MoveOperation(op->getOutput().value(),
                               Value(Literal(0u), op->getOutput()->type), op->getCondition(), op->getFlags()))
@@ -294,14 +297,14 @@ InstructionWalker optimizations::simplifyOperation(
                 // check whether second-arg exists and does nothing
                 if(rightIdentity && secondArg && secondArg->hasLiteral(rightIdentity->getLiteralValue().value()))
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
+                    LOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
                     it.erase();
                     // don't skip next instruction
                     it.previousInBlock();
                 }
                 else if(op->op.isIdempotent() && secondArg && secondArg.value() == firstArg)
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
+                    LOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
                     it.erase();
                     // don't skip next instruction
                     it.previousInBlock();
@@ -312,7 +315,7 @@ InstructionWalker optimizations::simplifyOperation(
                 // check whether first-arg does nothing
                 if(leftIdentity && firstArg.hasLiteral(leftIdentity->getLiteralValue().value()))
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
+                    LOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
                     it.erase();
                     // don't skip next instruction
                     it.previousInBlock();
@@ -320,7 +323,7 @@ InstructionWalker optimizations::simplifyOperation(
                 else if(op->op.isIdempotent() && secondArg && secondArg.value() == firstArg &&
                     !firstArg.checkRegister() && !firstArg.isUndefined())
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
+                    LOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << op->to_string() << logging::endl);
                     it.erase();
                     // don't skip next instruction
                     it.previousInBlock();
@@ -331,7 +334,7 @@ InstructionWalker optimizations::simplifyOperation(
                 // check whether second argument exists and does nothing
                 if(rightIdentity && secondArg && secondArg->hasLiteral(rightIdentity->getLiteralValue().value()))
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Replacing obsolete " << op->to_string() << " with move 3" << logging::endl);
                     it.reset((new intermediate::MoveOperation(
                                   op->getOutput().value(), op->getFirstArg(), op->getCondition(), op->getFlags()))
@@ -340,7 +343,7 @@ InstructionWalker optimizations::simplifyOperation(
                 // check whether first argument does nothing
                 else if(leftIdentity && secondArg && firstArg.hasLiteral(leftIdentity->getLiteralValue().value()))
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Replacing obsolete " << op->to_string() << " with move 4" << logging::endl);
                     it.reset((new intermediate::MoveOperation(
                                   op->getOutput().value(), op->assertArgument(1), op->getCondition(), op->getFlags()))
@@ -362,7 +365,7 @@ InstructionWalker optimizations::simplifyOperation(
                 else if(op->op == OP_XOR && op->getFirstArg().getLiteralValue() == Literal(-1))
                 {
                     // LLVM converts ~%a to %a xor -1, we convert it back to free the local from use-with-literal
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Replacing XOR " << op->to_string() << " with NOT" << logging::endl);
                     it.reset((new intermediate::Operation(OP_NOT, op->getOutput().value(), op->getSecondArg().value(),
                                   op->getCondition(), op->getFlags()))
@@ -370,7 +373,7 @@ InstructionWalker optimizations::simplifyOperation(
                 }
                 else if(op->op == OP_XOR && (op->getSecondArg() & &Value::getLiteralValue) == Literal(-1))
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Replacing XOR " << op->to_string() << " with NOT" << logging::endl);
                     it.reset((new intermediate::Operation(OP_NOT, op->getOutput().value(), op->getFirstArg(),
                                   op->getCondition(), op->getFlags()))
@@ -385,7 +388,7 @@ InstructionWalker optimizations::simplifyOperation(
         if(move->getSource() == move->getOutput().value() && move->isSimpleMove())
         {
             // skip copying to same, if no flags/signals/pack and unpack-modes are set
-            CPPLOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << move->to_string() << logging::endl);
+            LOG_LAZY(logging::Level::DEBUG, log << "Removing obsolete " << move->to_string() << logging::endl);
             it.erase();
             // don't skip next instruction
             it.previousInBlock();
@@ -393,7 +396,7 @@ InstructionWalker optimizations::simplifyOperation(
         if(it.get<intermediate::VectorRotation>() && move->getSource().isLiteralValue())
         {
             // replace rotation of constant with move
-            CPPLOG_LAZY(logging::Level::DEBUG,
+            LOG_LAZY(logging::Level::DEBUG,
                 log << "Replacing obsolete " << move->to_string() << " with move 6" << logging::endl);
             it.reset((new intermediate::MoveOperation(
                           move->getOutput().value(), move->getSource(), move->getCondition(), move->getFlags()))
@@ -425,7 +428,7 @@ InstructionWalker optimizations::foldConstants(
             }
             if(auto value = op->precalculate(3).first)
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Replacing '" << op->to_string() << "' with constant value: " << value.to_string()
                         << logging::endl);
                 it.reset((new intermediate::MoveOperation(op->getOutput().value(), value.value()))->copyExtrasFrom(op));
@@ -435,64 +438,132 @@ InstructionWalker optimizations::foldConstants(
     return it;
 }
 
-static void mapPhi(const intermediate::PhiNode& node, Method& method, InstructionWalker it)
+/*
+ * A single operand of a phi-node, which is copied when leaving the predecessor block. All copies for the phi-nodes of
+ * the same block are (semantically) executed in parallel.
+ */
+struct PhiCopy
 {
-    while(!it.isStartOfBlock())
-    {
-        it.previousInBlock();
-    }
-    const Local* label = it.get<intermediate::BranchLabel>()->getLabel();
-    for(const auto& pair : node.getValuesForLabels())
+    const intermediate::PhiNode* node;
+    Value destination;
+    Value source;
+};
+
+static InstructionWalker findPhiCopyPosition(
+    BasicBlock& block, const Local* label, ConditionCode& jumpCondition, Value& condition)
+{
+    // make sure, moves are inserted before the outgoing branches
+    InstructionWalker blockIt = block.walkEnd();
+    while(blockIt.copy().previousInBlock().get<intermediate::Branch>() ||
+        blockIt.copy().previousInBlock()->doesSetFlag())
     {
-        BasicBlock* bb = method.findBasicBlock(pair.first);
-        if(bb == nullptr)
-        {
-            logging::error() << "Cannot map phi-node to label: " << pair.first->name << logging::endl;
-            throw CompilationError(CompilationStep::OPTIMIZER, "Failed to map all phi-options to valid basic-blocks",
-                pair.first->to_string());
-        }
-        // make sure, moves are inserted before the outgoing branches
-        InstructionWalker blockIt = bb->walkEnd();
-        ConditionCode jumpCondition = COND_ALWAYS;
-        Value condition(UNDEFINED_VALUE);
-        while(blockIt.copy().previousInBlock().get<intermediate::Branch>() ||
-            blockIt.copy().previousInBlock()->doesSetFlag())
+        blockIt.previousInBlock();
+        auto branch = blockIt.get<intermediate::Branch>();
+        if(branch && branch->getTarget() == label)
         {
-            blockIt.previousInBlock();
-            auto branch = blockIt.get<intermediate::Branch>();
-            if(branch && branch->getTarget() == label)
+            jumpCondition = branch->branchCondition.toConditionCode();
+            if(branch->branchCondition != BRANCH_ALWAYS)
             {
-                jumpCondition = branch->branchCondition.toConditionCode();
-                if(branch->branchCondition != BRANCH_ALWAYS)
-                {
-                    if(auto branchCondition = bb->findLastSettingOfFlags(blockIt))
-                        condition =
-                            intermediate::getBranchCondition(branchCondition->get<intermediate::ExtendedInstruction>())
-                                .first.value();
-                }
+                if(auto branchCondition = block.findLastSettingOfFlags(blockIt))
+                    condition =
+                        intermediate::getBranchCondition(branchCondition->get<intermediate::ExtendedInstruction>())
+                            .first.value();
             }
         }
-        // Since originally the value of the PHI node is set after the jump (at the start of the destination basic
-        // block)  and we have conditional branches "jump to A or B", we need to only set the value if we take the
-        // (conditional) branch jumping to this basic block.
+    }
+    return blockIt;
+}
+
+static bool isReadByOtherCopy(const PhiCopy& copy, const std::vector<PhiCopy>& copies)
+{
+    auto loc = copy.destination.checkLocal();
+    return loc && std::any_of(copies.begin(), copies.end(), [&](const PhiCopy& other) -> bool {
+        return &other != &copy && other.source.hasLocal(loc);
+    });
+}
 
-        if(jumpCondition != COND_ALWAYS)
+/*
+ * Inserts the copies of the phi-nodes of the block with the given label into the end of the given predecessor block.
+ *
+ * The parallel copies are sequentialized, so no copy overwrites a value still read by another copy. Cyclic
+ * dependencies (e.g. two values swapped in every loop iteration) are broken up by saving one of the values into a
+ * temporary.
+ */
+static void insertPhiCopies(Method& method, const Local* predecessor, const Local* label, std::vector<PhiCopy>&& copies,
+    std::vector<InstructionWalker>& coalescingCandidates)
+{
+    BasicBlock* bb = method.findBasicBlock(predecessor);
+    if(bb == nullptr)
+    {
+        logging::error() << "Cannot map phi-node to label: " << predecessor->name << logging::endl;
+        throw CompilationError(CompilationStep::OPTIMIZER, "Failed to map all phi-options to valid basic-blocks",
+            predecessor->to_string());
+    }
+    ConditionCode jumpCondition = COND_ALWAYS;
+    Value condition(UNDEFINED_VALUE);
+    auto blockIt = findPhiCopyPosition(*bb, label, jumpCondition, condition);
+
+    // copies of a local to itself (e.g. of values not modified in a loop) are not required
+    copies.erase(std::remove_if(copies.begin(), copies.end(),
+                     [](const PhiCopy& copy) -> bool {
+                         return copy.destination.checkLocal() && copy.source.hasLocal(copy.destination.local());
+                     }),
+        copies.end());
+    if(copies.empty())
+        return;
+
+    // Since originally the value of the PHI node is set after the jump (at the start of the destination basic
+    // block)  and we have conditional branches "jump to A or B", we need to only set the value if we take the
+    // (conditional) branch jumping to this basic block.
+    if(jumpCondition != COND_ALWAYS)
+    {
+        // Since the correct flags for the branch might not be set, we need to set them here.
+        // Also, don't "or" with element number, since we might need to set the flags for more than the first
+        // SIMD-element, this way, we set it for all
+        blockIt.emplace(new intermediate::MoveOperation(NOP_REGISTER, condition, COND_ALWAYS, SetFlag::SET_FLAGS));
+        blockIt.nextInBlock();
+    }
+
+    while(!copies.empty())
+    {
+        auto copyIt = std::find_if(copies.begin(), copies.end(),
+            [&](const PhiCopy& copy) -> bool { return !isReadByOtherCopy(copy, copies); });
+        if(copyIt == copies.end())
         {
-            // Since the correct flags for the branch might not be set, we need to set them here.
-            // Also, don't "or" with element number, since we might need to set the flags for more than the first
-            // SIMD-element, this way, we set it for all
-            blockIt.emplace(new intermediate::MoveOperation(NOP_REGISTER, condition, COND_ALWAYS, SetFlag::SET_FLAGS));
+            // all remaining copies are part of cycles, so save the previous value of one destination and read the
+            // temporary instead, which breaks the cycle
+            const auto& copy = copies.front();
+            auto tmp = method.addNewLocal(copy.destination.type, "%phi_tmp");
+            blockIt.emplace((new intermediate::MoveOperation(tmp, copy.destination))
+                                ->addDecorations(intermediate::InstructionDecorations::PHI_NODE));
+            LOG_LAZY(logging::Level::DEBUG,
+                log << "Breaking cyclic phi-node copies in basic-block '" << predecessor->name
+                    << "': " << blockIt->to_string() << logging::endl);
             blockIt.nextInBlock();
+            auto loc = copy.destination.local();
+            for(auto& other : copies)
+            {
+                if(other.source.hasLocal(loc))
+                    other.source = tmp;
+            }
+            continue;
         }
-        blockIt.emplace(
-            (new intermediate::MoveOperation(node.getOutput().value(), pair.second, jumpCondition))
-                ->copyExtrasFrom(&node)
-                ->addDecorations(add_flag(node.decoration, intermediate::InstructionDecorations::PHI_NODE)));
-        CPPLOG_LAZY(logging::Level::DEBUG,
-            log << "Inserting into end of basic-block '" << pair.first->name << "': " << blockIt->to_string()
+        blockIt.emplace((new intermediate::MoveOperation(copyIt->destination, copyIt->source, jumpCondition))
+                            ->copyExtrasFrom(copyIt->node)
+                            ->addDecorations(
+                                add_flag(copyIt->node->decoration, intermediate::InstructionDecorations::PHI_NODE)));
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Inserting into end of basic-block '" << predecessor->name << "': " << blockIt->to_string()
                 << logging::endl);
+        if(jumpCondition == COND_ALWAYS)
+            coalescingCandidates.emplace_back(blockIt);
+        blockIt.nextInBlock();
+        copies.erase(copyIt);
     }
+}
 
+static void setPhiReference(const intermediate::PhiNode& node)
+{
     // set reference of local to original reference, if always the same for all possible sources
     if(auto output = node.checkOutputLocal())
     {
@@ -513,28 +584,130 @@ static void mapPhi(const intermediate::PhiNode& node, Method& method, Instructio
 
         if(ref && node.getOutput()->type.getPointerType())
             node.getOutput()->local()->set(ReferenceData(*ref, ANY_ELEMENT));
-        CPPLOG_LAZY(
+        LOG_LAZY(
             logging::Level::DEBUG, log << "PHI output: " << node.getOutput()->to_string(true, true) << logging::endl);
     }
 }
 
+static bool canBeCoalesced(const Local* destination, const Local* source)
+{
+    if(destination == source || !(destination->type == source->type) || source->type.getPointerType())
+        return false;
+    if(source->is<Parameter>() || source->is<BuiltinLocal>() || source->residesInMemory())
+        return false;
+    // the source needs to be completely replaceable by the phi-node output, so it may only be written once
+    auto writer = source->getSingleWriter();
+    return writer && !writer->hasConditionalExecution();
+}
+
+/*
+ * Removes the unconditional copies of the phi-node operands by renaming the copied local to the phi-node output, if
+ * the live ranges of both locals do not interfere.
+ */
+static void coalescePhiCopies(Method& method, const std::vector<InstructionWalker>& candidates)
+{
+    if(candidates.empty())
+        return;
+    auto interferenceGraph = analysis::InterferenceGraph::createGraph(method);
+    // the locals already renamed to the given local, which interfere with the same locals as the original local
+    FastMap<const Local*, FastSet<const Local*>> coalescedLocals;
+    auto getCoalescedLocals = [&](const Local* loc) -> FastSet<const Local*> {
+        auto entry = coalescedLocals.find(loc);
+        FastSet<const Local*> locals = entry != coalescedLocals.end() ? entry->second : FastSet<const Local*>{};
+        locals.emplace(loc);
+        return locals;
+    };
+    auto interferes = [&](const Local* first, const Local* second) -> bool {
+        auto secondLocals = getCoalescedLocals(second);
+        for(auto loc : getCoalescedLocals(first))
+        {
+            auto node = interferenceGraph->findNode(const_cast<Local*>(loc));
+            if(!node)
+                continue;
+            for(auto other : secondLocals)
+            {
+                auto otherNode = interferenceGraph->findNode(const_cast<Local*>(other));
+                if(otherNode && node->isAdjacent(otherNode))
+                    return true;
+            }
+        }
+        return false;
+    };
+
+    for(auto it : candidates)
+    {
+        auto move = it.get<intermediate::MoveOperation>();
+        auto destination = move ? move->checkOutputLocal() : nullptr;
+        auto source = move ? move->getSource().checkLocal() : nullptr;
+        if(!destination || !source || !canBeCoalesced(destination, source) || interferes(destination, source))
+            continue;
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Coalescing phi-node operand '" << source->name << "' with phi-node output: " << move->to_string()
+                << logging::endl);
+        // Local#forUsers can't be used here, since we modify the list of users via LocalUser#replaceLocal
+        FastSet<const LocalUser*> users = source->getUsers(LocalUse::Type::BOTH);
+        for(const LocalUser* user : users)
+            const_cast<LocalUser*>(user)->replaceLocal(source, destination);
+        auto sourceLocals = getCoalescedLocals(source);
+        coalescedLocals.erase(source);
+        coalescedLocals[destination].insert(sourceLocals.begin(), sourceLocals.end());
+        it.erase();
+    }
+}
+
 void optimizations::eliminatePhiNodes(const Module& module, Method& method, const Configuration& config)
 {
-    // Search for all phi-nodes and insert all mapped instructions to the end of the corresponding basic block
-    auto it = method.walkAllInstructions();
-    while(!it.isEndOfMethod())
+    std::vector<InstructionWalker> coalescingCandidates;
+    for(auto& block : method)
     {
-        if(auto phiNode = it.get<intermediate::PhiNode>())
+        // Collect the operands of all phi-nodes of the block per predecessor, since all phi-nodes of a block are
+        // evaluated in parallel
+        std::vector<std::pair<const Local*, std::vector<PhiCopy>>> copiesPerPredecessor;
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
         {
-            // 2) map the phi-node to the move-operations per predecessor-label
-            CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Eliminating phi-node by inserting moves: " << it->to_string() << logging::endl);
-            mapPhi(*phiNode, method, it);
-            it.erase();
+            if(auto phiNode = it.get<intermediate::PhiNode>())
+            {
+                LOG_LAZY(logging::Level::DEBUG,
+                    log << "Eliminating phi-node by inserting moves: " << it->to_string() << logging::endl);
+                for(const auto& pair : phiNode->getValuesForLabels())
+                {
+                    auto entry = std::find_if(copiesPerPredecessor.begin(), copiesPerPredecessor.end(),
+                        [&](const std::pair<const Local*, std::vector<PhiCopy>>& entry) -> bool {
+                            return entry.first == pair.first;
+                        });
+                    if(entry == copiesPerPredecessor.end())
+                        entry = copiesPerPredecessor.emplace(
+                            copiesPerPredecessor.end(), pair.first, std::vector<PhiCopy>{});
+                    // the same predecessor can be listed multiple times (e.g. for switches with several cases jumping
+                    // to the same block), but always with the same value
+                    if(std::none_of(entry->second.begin(), entry->second.end(),
+                           [&](const PhiCopy& copy) -> bool { return copy.node == phiNode; }))
+                        entry->second.emplace_back(PhiCopy{phiNode, phiNode->getOutput().value(), pair.second});
+                }
+            }
+            it.nextInBlock();
+        }
+        if(copiesPerPredecessor.empty())
+            continue;
+        const Local* label = block.getLabel()->getLabel();
+        for(auto& entry : copiesPerPredecessor)
+            insertPhiCopies(method, entry.first, label, std::move(entry.second), coalescingCandidates);
+
+        // the phi-nodes are still referenced by the copies above, so only remove them afterwards
+        it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(auto phiNode = it.get<intermediate::PhiNode>())
+            {
+                setPhiReference(*phiNode);
+                it.erase();
+            }
+            else
+                it.nextInBlock();
         }
-        else
-            it.nextInMethod();
     }
+    coalescePhiCopies(method, coalescingCandidates);
 }
 
 InstructionWalker optimizations::eliminateReturn(
@@ -546,7 +719,7 @@ InstructionWalker optimizations::eliminateReturn(
         if(!target)
             target = &method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
 
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Replacing return in kernel-function with branch to end-label" << logging::endl);
         it.reset(new intermediate::Branch(target->getLabel()->getLabel()));
     }
@@ -702,7 +875,7 @@ bool optimizations::eliminateRedundantMoves(const Module& module, Method& method
             {
                 if(move->getSignal() == SIGNAL_NONE)
                 {
-                    CPPLOG_LAZY(
+                    LOG_LAZY(
                         logging::Level::DEBUG, log << "Removing obsolete move: " << it->to_string() << logging::endl);
                     it.erase();
                     // don't skip next instruction
@@ -711,7 +884,7 @@ bool optimizations::eliminateRedundantMoves(const Module& module, Method& method
                 }
                 else
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Removing obsolete move with nop: " << it->to_string() << logging::endl);
                     it.reset(new intermediate::Nop(intermediate::DelayType::WAIT_REGISTER, move->getSignal()));
                     codeChanged = true;
@@ -725,7 +898,7 @@ bool optimizations::eliminateRedundantMoves(const Module& module, Method& method
                 // the output with the input
                 // XXX we need to check the type equality, since otherwise Reordering might re-order the reading before
                 // the writing (if the local is written as type A and read as type B)
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Removing obsolete move by replacing uses of the output with the input: " << it->to_string()
                         << logging::endl);
                 (*destinationReader)
@@ -754,7 +927,7 @@ bool optimizations::eliminateRedundantMoves(const Module& module, Method& method
                 // TODO This could potentially lead to far longer usage-ranges for operands of sourceWriter and
                 // therefore to register conflicts
                 // TODO when replacing moves which set flags, need to make sure, flags are not overridden in between!
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Replacing obsolete move with instruction calculating its source: " << it->to_string()
                         << logging::endl);
                 auto output = it->getOutput();
@@ -782,7 +955,7 @@ bool optimizations::eliminateRedundantMoves(const Module& module, Method& method
                 // if the source is a register, the output is only used once, this instruction has no signals/sets no
                 // flags, the output consumer does not also read this move's source and there is no read of the source
                 // between the move and the consumer, the consumer can directly use the register moved here
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Replacing obsolete move by inserting the source into the instruction consuming its result: "
                         << it->to_string() << logging::endl);
                 const Value newInput(move->getSource().reg(), move->getOutput()->type);
@@ -935,30 +1108,34 @@ bool optimizations::eliminateRedundantBitOp(const Module& module, Method& method
                     mask = (1u << offset) - 1u;
                 }
                 auto out = op->checkOutputLocal();
-                if(mask != uint32_t{0xFFFFFFFF} && out &&
-                    std::all_of(out->getUsers().begin(), out->getUsers().end(),
-                        [&](const std::pair<const LocalUser*, LocalUse> user) -> bool {
-                            if(!user.second.readsLocal())
-                                return true;
-                            if(auto userOp = dynamic_cast<const intermediate::Operation*>(user.first))
-                            {
-                                auto otherArg = userOp->findOtherArgument(*op->getOutput());
-                                auto otherLit =
-                                    (otherArg ? otherArg->getConstantValue() : NO_VALUE) & &Value::getLiteralValue;
-                                return userOp->op == OP_AND && !userOp->hasUnpackMode() && otherLit &&
-                                    isPowerTwo(otherLit->unsignedInt() + 1u) && otherLit->unsignedInt() <= mask;
-                            }
-                            return false;
-                        }))
+                if(mask != uint32_t{0xFFFFFFFF} && out)
                 {
-                    // if all of our readers are simple ANDs with a constant mask which covers less or equal bits than
-                    // the mask of we calculated, we know that all the sign-extended bits are not used. Therefore the
-                    // (actually relevant part of the) result for the ASR is the same as for SHR -> simplify.
-                    CPPLOG_LAZY(logging::Level::DEBUG,
-                        log << "Replacing arithmetic shift with simpler bit-wise shift: " << op->to_string()
-                            << logging::endl);
-                    op->op = OP_SHR;
-                    replaced = true;
+                    const auto users = out->getUsers();
+                    if(std::all_of(users.begin(), users.end(),
+                            [&](const std::pair<const LocalUser*, LocalUse> user) -> bool {
+                                if(!user.second.readsLocal())
+                                    return true;
+                                if(auto userOp = dynamic_cast<const intermediate::Operation*>(user.first))
+                                {
+                                    auto otherArg = userOp->findOtherArgument(*op->getOutput());
+                                    auto otherLit =
+                                        (otherArg ? otherArg->getConstantValue() : NO_VALUE) & &Value::getLiteralValue;
+                                    return userOp->op == OP_AND && !userOp->hasUnpackMode() && otherLit &&
+                                        isPowerTwo(otherLit->unsignedInt() + 1u) && otherLit->unsignedInt() <= mask;
+                                }
+                                return false;
+                            }))
+                    {
+                        // if all of our readers are simple ANDs with a constant mask which covers less or equal bits
+                        // than the mask of we calculated, we know that all the sign-extended bits are not used.
+                        // Therefore the (actually relevant part of the) result for the ASR is the same as for SHR ->
+                        // simplify.
+                        LOG_LAZY(logging::Level::DEBUG,
+                            log << "Replacing arithmetic shift with simpler bit-wise shift: " << op->to_string()
+                                << logging::endl);
+                        op->op = OP_SHR;
+                        replaced = true;
+                    }
                 }
             }
             // fall-through on purpose, since we can improve on the above even further with the check below
@@ -986,7 +1163,7 @@ bool optimizations::eliminateRedundantBitOp(const Module& module, Method& method
                     writer->getSecondArg() &&
                     writer->getSecondArg()->getConstantValue() == op->getSecondArg()->getConstantValue())
                 {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Replacing redundant left and right shift with same offset to and with mask: "
                             << op->to_string() << logging::endl);
                     auto input = writer->getFirstArg();
@@ -1005,79 +1182,187 @@ bool optimizations::eliminateRedundantBitOp(const Module& module, Method& method
     return replaced;
 }
 
-bool optimizations::eliminateCommonSubexpressions(const Module& module, Method& method, const Configuration& config)
+/*
+ * The state of a single basic block in the dominator tree traversal of the global value numbering
+ */
+struct ValueNumberingScope
+{
+    const analysis::CFGNode* node;
+    // the blocks immediately dominated by this block which are not yet processed
+    FastAccessList<const analysis::CFGNode*> pendingChildren;
+    // the expressions and locals made available by this block, removed again when leaving the block
+    FastAccessList<const Expression*> addedExpressions;
+    FastAccessList<const Local*> addedLocals;
+};
+
+/*
+ * Returns whether the input of an expression has the same value everywhere the locals defined along the current path
+ * in the dominator tree are available
+ */
+static bool isAvailableInput(const SubExpression& input, const FastSet<const Local*>& definedLocals)
+{
+    if(!input)
+        return true;
+    auto val = input.checkValue();
+    if(!val)
+        return false;
+    if(auto loc = val->checkLocal())
+        // the local needs to be written exactly once by a dominating instruction or never written at all (e.g.
+        // parameters, globals)
+        return definedLocals.find(loc) != definedLocals.end() || loc->getUsers(LocalUse::Type::WRITER).empty();
+    if(auto reg = val->checkRegister())
+        // most registers change their value, but these are fixed for the whole execution
+        return *reg == REG_ELEMENT_NUMBER || *reg == REG_QPU_NUMBER;
+    return true;
+}
+
+static bool numberValues(BasicBlock& block, ExpressionTable& table,
+    FastMap<const Expression*, Value>& availableExpressions, FastSet<const Local*>& definedLocals,
+    ValueNumberingScope& scope, const Configuration& config)
 {
     bool replacedSomething = false;
-    for(auto& block : method)
-    {
-        // we do not run the whole analysis in front, but only the next step to save on memory usage
-        // For that purpose, we also override the previous expressions on every step
-        analysis::AvailableExpressionAnalysis::Cache cache{};
-        AvailableExpressions expressions{};
-        FastMap<const Local*, std::shared_ptr<Expression>> calculatingExpressions{};
+    // we do not run the whole analysis in front, but only the next step to save on memory usage
+    // For that purpose, we also override the previous expressions on every step
+    FastMap<const Local*, FastSet<const Expression*>> readers{};
+    AvailableExpressions expressions{};
+    FastMap<const Local*, std::shared_ptr<Expression>> calculatingExpressions{};
 
-        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+    for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        std::shared_ptr<Expression> expr;
+        std::tie(expressions, expr) = analysis::AvailableExpressionAnalysis::analyzeAvailableExpressions(
+            it.get(), expressions, readers, table, config.additionalOptions.maxCommonExpressionDinstance);
+        if(expr)
         {
-            if(!it.has())
-                continue;
-            std::shared_ptr<Expression> expr;
-            std::tie(expressions, expr) = analysis::AvailableExpressionAnalysis::analyzeAvailableExpressions(
-                it.get(), expressions, cache, config.additionalOptions.maxCommonExpressionDinstance);
-            if(expr)
+            auto newExpr = expr;
+            if(auto out = it->checkOutputLocal())
+                // remove from cache before using the result for the expression not to depend on itself
+                calculatingExpressions.erase(out);
+
+            // replace instruction with a dominating instruction calculating the same expression, if the expression is
+            // not constant (no use replacing loading of constants with copies of a local initialized with a constant)
+            // or a simple move
+            bool isCandidate = !expr->getConstantExpression() && !expr->isMoveExpression() &&
+                isAvailableInput(expr->arg0, definedLocals) && isAvailableInput(expr->arg1, definedLocals);
+            auto availableIt = isCandidate ? availableExpressions.find(expr.get()) : availableExpressions.end();
+            if(availableIt != availableExpressions.end())
             {
-                auto newExpr = expr;
-                if(auto out = it->checkOutputLocal())
-                    // remove from cache before using the result for the expression not to depend on itself
-                    calculatingExpressions.erase(out);
-
-                auto exprIt = expressions.find(expr);
-                // replace instruction with matching expression, if the expression is not constant (no use replacing
-                // loading of constants with copies of a local initialized with a constant)
-                if(exprIt != expressions.end() && exprIt->second.first != it.get() && !expr->getConstantExpression())
-                {
-                    CPPLOG_LAZY(logging::Level::DEBUG,
-                        log << "Found common subexpression: " << it->to_string() << " is the same as "
-                            << exprIt->second.first->to_string() << logging::endl);
-                    it.reset(new intermediate::MoveOperation(
-                        it->getOutput().value(), exprIt->second.first->getOutput().value()));
-                    replacedSomething = true;
-                }
-                else if(*(newExpr = expr->combineWith(calculatingExpressions)) != *expr)
+                LOG_LAZY(logging::Level::DEBUG,
+                    log << "Found common subexpression: " << it->to_string() << " is the same as "
+                        << availableIt->second.to_string() << logging::endl);
+                it.reset(new intermediate::MoveOperation(it->getOutput().value(), availableIt->second));
+                replacedSomething = true;
+            }
+            else if((newExpr = table.canonicalize(*expr->combineWith(calculatingExpressions))) != expr)
+            {
+                // since the rewritten expression is interned, its sub-expressions are found in the available ones
+                if(newExpr->insertInstructions(it, it->getOutput().value(), expressions))
                 {
-                    if(newExpr->insertInstructions(it, it->getOutput().value(), expressions))
-                    {
-                        CPPLOG_LAZY(logging::Level::WARNING,
-                            log << "Rewriting expression '" << expr->to_string() << "' to '" << newExpr->to_string()
-                                << "'" << logging::endl);
+                    LOG_LAZY(logging::Level::WARNING,
+                        log << "Rewriting expression '" << expr->to_string() << "' to '" << newExpr->to_string()
+                            << "'" << logging::endl);
 
-                        if(exprIt != expressions.end() && exprIt->second.first == it.get())
-                            // reset this expression, since the mapped instruction will be overwritten
-                            expressions.erase(exprIt);
+                    auto exprIt = expressions.find(expr.get());
+                    if(exprIt != expressions.end() && exprIt->second.first == it.get())
+                        // reset this expression, since the mapped instruction will be overwritten
+                        expressions.erase(exprIt);
 
-                        // remove original instruction
-                        it.erase();
-                        it.previousInBlock();
-                        if(auto loc = it->checkOutputLocal())
-                            calculatingExpressions.emplace(loc, newExpr);
-                        replacedSomething = true;
-                        expressions.emplace(newExpr, std::make_pair(it.get(), 0));
-                    }
+                    // remove original instruction
+                    it.erase();
+                    it.previousInBlock();
+                    if(auto loc = it->checkOutputLocal())
+                        calculatingExpressions.emplace(loc, newExpr);
+                    replacedSomething = true;
+                    expressions.emplace(newExpr.get(), std::make_pair(it.get(), 0));
                 }
+            }
 
-                if(auto out = it->checkOutputLocal())
-                    // add to cache after using the result for the expression not to depend on itself
-                    // NOTE: not overwriting the above emplace is on purpose
-                    calculatingExpressions.emplace(out, expr);
+            if(isCandidate && availableIt == availableExpressions.end() && it->checkOutputLocal() &&
+                it->checkOutputLocal()->getSingleWriter() == it.get())
+            {
+                // the result is never overwritten, so it can be used by all instructions dominated by this one. If the
+                // expression was rewritten above, the rewritten instruction still calculates the same value.
+                availableExpressions.emplace(expr.get(), it->getOutput().value());
+                scope.addedExpressions.emplace_back(expr.get());
             }
-            else if(auto loc = it->checkOutputLocal())
+
+            if(auto out = it->checkOutputLocal())
+                // add to cache after using the result for the expression not to depend on itself
+                // NOTE: not overwriting the above emplace is on purpose
+                calculatingExpressions.emplace(out, expr);
+        }
+        else if(auto loc = it->checkOutputLocal())
+        {
+            // if we failed to create an expression for an output local (e.g. because of conditional access, etc.),
+            // need to reset the expression for that local, since any previous expression might no longer be
+            // accurate.
+            calculatingExpressions.erase(loc);
+        }
+
+        auto out = it->checkOutputLocal();
+        if(out && out->getSingleWriter() == it.get() && definedLocals.emplace(out).second)
+            scope.addedLocals.emplace_back(out);
+    }
+    return replacedSomething;
+}
+
+bool optimizations::eliminateCommonSubexpressions(const Module& module, Method& method, const Configuration& config)
+{
+    // Global value numbering: The blocks are processed in pre-order of the dominator tree and every expression
+    // calculated is available for all blocks dominated by the calculating block. Since the expressions are removed
+    // again when leaving the block, every block is only processed once and every lookup is a single hash-table access.
+    PROFILE_START(GlobalValueNumbering);
+    auto& cfg = method.getCFG();
+    const auto& dominators = method.getAnalyses().getDominatorTree();
+    bool replacedSomething = false;
+    // all expressions of the method are interned, so they can be looked up by identity
+    ExpressionTable table;
+    FastMap<const Expression*, Value> availableExpressions;
+    // the locals written exactly once by an instruction located on the current path in the dominator tree
+    FastSet<const Local*> definedLocals;
+
+    auto createScope = [&](const analysis::CFGNode* node) -> ValueNumberingScope {
+        ValueNumberingScope scope{node, {}, {}, {}};
+        dominators.assertNode(node).forAllOutgoingEdges(
+            [&](const analysis::DominatorTreeNode& child, const analysis::DominatorTreeNode::EdgeType&) -> bool {
+                scope.pendingChildren.emplace_back(child.key);
+                return true;
+            });
+        return scope;
+    };
+
+    FastAccessList<ValueNumberingScope> scopes;
+    for(auto& block : method)
+    {
+        const auto& root = cfg.assertNode(&block);
+        if(dominators.getImmediateDominator(root))
+            continue;
+        scopes.emplace_back(createScope(&root));
+        replacedSomething = numberValues(block, table, availableExpressions, definedLocals, scopes.back(), config) ||
+            replacedSomething;
+        while(!scopes.empty())
+        {
+            if(scopes.back().pendingChildren.empty())
             {
-                // if we failed to create an expression for an output local (e.g. because of conditional access, etc.),
-                // need to reset the expression for that local, since any previous expression might no longer be
-                // accurate.
-                calculatingExpressions.erase(loc);
+                // leaving the block, the values calculated here are no longer available
+                for(auto expr : scopes.back().addedExpressions)
+                    availableExpressions.erase(expr);
+                for(auto loc : scopes.back().addedLocals)
+                    definedLocals.erase(loc);
+                scopes.pop_back();
+                continue;
             }
+            auto child = scopes.back().pendingChildren.back();
+            scopes.back().pendingChildren.pop_back();
+            scopes.emplace_back(createScope(child));
+            replacedSomething =
+                numberValues(*child->key, table, availableExpressions, definedLocals, scopes.back(), config) ||
+                replacedSomething;
         }
     }
+    PROFILE_END(GlobalValueNumbering);
     return replacedSomething;
 }
 
@@ -1100,7 +1385,7 @@ InstructionWalker optimizations::rewriteConstantSFUCall(
     if(auto result =
             constantValue ? periphery::precalculateSFU(it->getOutput()->reg(), constantValue.value()) : NO_VALUE)
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Replacing SFU call with constant input '" << it->to_string()
                 << "' to move of result: " << result->to_string() << logging::endl);
 
@@ -22,6 +22,33 @@ namespace vc4c
          * just now.
          */
         bool eliminateDeadCode(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Replaces the phi-nodes with copies of their operands at the end of the corresponding predecessor blocks.
+         *
+         * Since all phi-nodes of a block are evaluated in parallel, the copies for the same predecessor are ordered to
+         * not overwrite any value still read by another copy, inserting a temporary for cyclic copies. Afterwards, the
+         * unconditional copies are removed by renaming the copied local to the phi-node output, if their live ranges
+         * do not interfere (e.g. for the increment of a loop induction variable).
+         *
+         * Example:
+         *   label: %loop
+         *   %a = phi [%init, %a.init], [%loop, %b]
+         *   %b = phi [%init, %b.init], [%loop, %a]
+         *   %i = phi [%init, 0], [%loop, %i.next]
+         *   [...]
+         *   %i.next = add %i, 1
+         *   br %loop
+         *
+         * is converted to:
+         *   label: %loop
+         *   [...]
+         *   %i = add %i, 1
+         *   %phi_tmp = %a
+         *   %a = %b
+         *   %b = %phi_tmp
+         *   br %loop
+         */
         void eliminatePhiNodes(const Module& module, Method& method, const Configuration& config);
 
         /*
@@ -185,8 +212,9 @@ namespace vc4c
         /*
          * Common Subexpression Elimination (CSE)
          *
-         * Iterates over each basic block and looks for instructions calculating the same value and combines them, if
-         * possible.
+         * Runs a global value numbering over the dominator tree and replaces instructions calculating the same value as
+         * a dominating instruction with a copy of its result. Additionally, expressions within a single basic block are
+         * combined, if possible.
          *
          * Example:
          *   %a = add %b, %c
@@ -7,9 +7,15 @@
 #include "Flags.h"
 
 #include "../InstructionWalker.h"
+#include "../Logging.h"
 #include "../Method.h"
+#include "../analysis/AnalysisManager.h"
+#include "../analysis/ControlFlowGraph.h"
+#include "../analysis/DivergenceAnalysis.h"
+#include "../intermediate/Helper.h"
 #include "../intermediate/IntermediateInstruction.h"
-#include "log.h"
+
+#include <algorithm>
 
 using namespace vc4c;
 using namespace vc4c::optimizations;
@@ -35,12 +41,12 @@ static bool rewriteSettingOfFlags(
         // flags are set but never used
         if(setFlags->writesRegister(REG_NOP) && !setFlags->getSignal().hasSideEffects())
         {
-            CPPLOG_LAZY(logging::Level::DEBUG,
+            LOG_LAZY(logging::Level::DEBUG,
                 log << "Removing unused setting of flags: " << setFlags->to_string() << logging::endl);
             setFlags.erase();
             return true;
         }
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Removing unused SetFlags bit from instruction: " << setFlags->to_string() << logging::endl);
         setFlags.get<intermediate::ExtendedInstruction>()->setSetFlags(SetFlag::DONT_SET);
         return true;
@@ -66,7 +72,7 @@ static bool rewriteSettingOfFlags(
                 if(flags.matchesCondition(cond))
                 {
                     // condition is statically matched, remove conditional
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Making instruction with constant condition unconditional: " << (*condIt)->to_string()
                             << logging::endl);
                     (*condIt).get<intermediate::ExtendedInstruction>()->setCondition(COND_ALWAYS);
@@ -79,7 +85,7 @@ static bool rewriteSettingOfFlags(
                 else
                 {
                     // condition is statically not matched, remove instruction
-                    CPPLOG_LAZY(logging::Level::DEBUG,
+                    LOG_LAZY(logging::Level::DEBUG,
                         log << "Removing conditional instruction which will never be executed: "
                             << (*condIt)->to_string() << logging::endl);
                     condIt->erase();
@@ -143,6 +149,318 @@ bool optimizations::removeUselessFlags(const Module& module, Method& method, con
     return changedSomething;
 }
 
+/*
+ * The calculation the flags are set from. Two instructions with the same source set the same flags, as long as none of
+ * the inputs are modified in between.
+ */
+struct FlagsSource
+{
+    // moves are not mapped to a single operation code, but are always generated the same
+    bool isMove;
+    OpCode op;
+    tools::SmallVector<Value, 2> arguments;
+
+    bool operator==(const FlagsSource& other) const
+    {
+        return isMove == other.isMove && op == other.op && arguments == other.arguments;
+    }
+
+    bool readsLocal(const Local* local) const
+    {
+        return std::any_of(arguments.begin(), arguments.end(),
+            [local](const Value& arg) -> bool { return arg.hasLocal(local); });
+    }
+};
+
+static Optional<FlagsSource> getFlagsSource(const intermediate::IntermediateInstruction& inst)
+{
+    if(!inst.doesSetFlag() || inst.hasConditionalExecution() || inst.hasUnpackMode() || inst.hasPackMode())
+        // conditional instructions only set the flags for some of the elements
+        return {};
+    auto move = dynamic_cast<const intermediate::MoveOperation*>(&inst);
+    auto op = dynamic_cast<const intermediate::Operation*>(&inst);
+    if((!move && !op) || dynamic_cast<const intermediate::VectorRotation*>(&inst))
+        return {};
+    for(const auto& arg : inst.getArguments())
+    {
+        // the values of all other registers may change at any time or are changed by reading them
+        if(auto reg = arg.checkRegister())
+        {
+            if(*reg != REG_ELEMENT_NUMBER && *reg != REG_QPU_NUMBER)
+                return {};
+        }
+    }
+    return FlagsSource{move != nullptr, op ? op->op : OP_NOP, inst.getArguments()};
+}
+
+/*
+ * Applies the instructions of the block to the flags source valid at the start of the block and returns the flags
+ * source valid at its end. If the container is given, the instructions setting flags already set are added to it.
+ */
+static Optional<FlagsSource> applyBlock(BasicBlock& block, Optional<FlagsSource> flags,
+    FastAccessList<InstructionWalker>* redundantFlags = nullptr)
+{
+    for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(it->doesSetFlag())
+        {
+            auto source = getFlagsSource(*it.get());
+            if(source && flags && *source == *flags)
+            {
+                if(redundantFlags)
+                    redundantFlags->push_back(it);
+            }
+            else
+                flags = std::move(source);
+        }
+        auto output = it->checkOutputLocal();
+        if(output && flags && flags->readsLocal(output))
+            // the inputs of the flags calculation are modified, so it cannot be repeated
+            flags = {};
+    }
+    return flags;
+}
+
+bool optimizations::removeRedundantFlags(const Module& module, Method& method, const Configuration& config)
+{
+    const auto& cfg = method.getCFG();
+    const auto* startBlock = &*method.begin();
+    // the flags source at the end of the already processed blocks, a missing entry is treated as not yet known (to
+    // optimistically handle loops), an empty entry as unknown flags
+    FastMap<const BasicBlock*, Optional<FlagsSource>> outgoingFlags;
+    auto getIncomingFlags = [&](const BasicBlock& block) -> Optional<FlagsSource> {
+        // the flags are undefined at the kernel start, even if it is the target of the work-group loop
+        if(&block == startBlock)
+            return {};
+        Optional<FlagsSource> flags;
+        bool isFirstPredecessor = true;
+        cfg.assertNode(const_cast<BasicBlock*>(&block))
+            .forAllIncomingEdges([&](const analysis::CFGNode& predecessor, const analysis::CFGEdge& edge) -> bool {
+                auto predecessorIt = outgoingFlags.find(predecessor.key);
+                if(predecessorIt == outgoingFlags.end())
+                    return true;
+                if(isFirstPredecessor)
+                    flags = predecessorIt->second;
+                else if(flags && (!predecessorIt->second || !(*flags == *predecessorIt->second)))
+                    flags = {};
+                isFirstPredecessor = false;
+                return true;
+            });
+        return flags;
+    };
+
+    bool changed = true;
+    while(changed)
+    {
+        changed = false;
+        for(auto& block : method)
+        {
+            auto flags = applyBlock(block, getIncomingFlags(block));
+            auto it = outgoingFlags.find(&block);
+            if(it == outgoingFlags.end())
+            {
+                outgoingFlags.emplace(&block, std::move(flags));
+                changed = true;
+            }
+            else if(static_cast<bool>(it->second) != static_cast<bool>(flags) || (flags && !(*flags == *it->second)))
+            {
+                it->second = std::move(flags);
+                changed = true;
+            }
+        }
+    }
+
+    bool removedFlags = false;
+    for(auto& block : method)
+    {
+        FastAccessList<InstructionWalker> redundantFlags;
+        applyBlock(block, getIncomingFlags(block), &redundantFlags);
+        for(auto it : redundantFlags)
+        {
+            if(it->writesRegister(REG_NOP) && !it->getSignal().hasSideEffects())
+            {
+                LOG_LAZY(logging::Level::DEBUG,
+                    log << "Removing setting of flags which are already set: " << it->to_string() << logging::endl);
+                it.erase();
+            }
+            else
+            {
+                LOG_LAZY(logging::Level::DEBUG,
+                    log << "Removing SetFlags bit for flags which are already set from instruction: "
+                        << it->to_string() << logging::endl);
+                it.get<intermediate::ExtendedInstruction>()->setSetFlags(SetFlag::DONT_SET);
+            }
+            removedFlags = true;
+        }
+    }
+    return removedFlags;
+}
+
+/*
+ * Returns the condition (of the flags set by the returned instruction) for which the given boolean value is true, if
+ * the boolean value is materialized from these flags by conditional writes of constants directly before the given
+ * instruction.
+ *
+ * Example:
+ *   - = xor %a, %b (setf)
+ *   %cond = 1 (ifz)
+ *   %cond = 0 (ifzc)
+ *   - = or elem_num, %cond (setf)
+ *
+ * returns ifz and the xor instruction.
+ */
+static Optional<std::pair<ConditionCode, InstructionWalker>> getMaterializedCondition(
+    const Local& boolean, InstructionWalker flagsIt)
+{
+    // the conditions and values (whether non-zero) of the writes of the boolean value, in reverse order
+    FastAccessList<std::pair<ConditionCode, bool>> writes;
+    auto it = flagsIt.copy().previousInBlock();
+    while(!it.isStartOfBlock() && (!it.has() || !it->doesSetFlag()))
+    {
+        if(it.has() && it->checkOutputLocal() == &boolean)
+        {
+            auto move = it.get<const intermediate::MoveOperation>();
+            auto literal = move ? move->getSource().getLiteralValue() : Optional<Literal>{};
+            if(!literal || move->hasPackMode() || move->hasUnpackMode() ||
+                dynamic_cast<const intermediate::VectorRotation*>(move))
+                return {};
+            writes.emplace_back(move->getCondition(), literal->unsignedInt() != 0);
+        }
+        it.previousInBlock();
+    }
+    if(it.isStartOfBlock() || writes.size() != 2 || boolean.getUsers(LocalUse::Type::WRITER).size() != 2)
+        return {};
+    const auto& first = writes[1];
+    const auto& second = writes[0];
+    if(first.second == second.second || second.first == COND_ALWAYS)
+        // the boolean value is constant or the second write overwrites the first
+        return {};
+    if(first.first != COND_ALWAYS && !first.first.isInversionOf(second.first))
+        return {};
+    // the boolean value is either set by the (unconditional) first write and overwritten if the condition of the second
+    // write holds, or set by exactly one of the writes with inverted conditions
+    auto condition = second.second ? second.first : second.first.invert();
+    return std::make_pair(condition, it);
+}
+
+/*
+ * Returns whether the flags set at the end of the given block may be read by any (transitive) successor block
+ */
+static bool areFlagsLiveOut(const analysis::ControlFlowGraph& cfg, const BasicBlock& block)
+{
+    FastSet<const BasicBlock*> visitedBlocks;
+    FastAccessList<const BasicBlock*> pendingBlocks;
+    auto addSuccessors = [&](const BasicBlock& predecessor) {
+        cfg.assertNode(const_cast<BasicBlock*>(&predecessor))
+            .forAllOutgoingEdges([&](const analysis::CFGNode& successor, const analysis::CFGEdge& edge) -> bool {
+                if(visitedBlocks.emplace(successor.key).second)
+                    pendingBlocks.push_back(successor.key);
+                return true;
+            });
+    };
+    addSuccessors(block);
+    while(!pendingBlocks.empty())
+    {
+        const auto* successor = pendingBlocks.back();
+        pendingBlocks.pop_back();
+        bool flagsOverwritten = false;
+        for(const auto& inst : *successor)
+        {
+            if(!inst)
+                continue;
+            auto branch = dynamic_cast<const intermediate::Branch*>(inst.get());
+            if(inst->hasConditionalExecution() || (branch && !branch->isUnconditional()))
+                // the flags are read before they are set
+                return true;
+            if(inst->doesSetFlag())
+            {
+                flagsOverwritten = true;
+                break;
+            }
+        }
+        if(!flagsOverwritten)
+            // the flags are passed through this block
+            addSuccessors(*successor);
+    }
+    return false;
+}
+
+bool optimizations::branchOnConditionFlags(const Module& module, Method& method, const Configuration& config)
+{
+    const auto& cfg = method.getCFG();
+    const auto& divergence = method.getAnalyses().getDivergence();
+    bool changedSomething = false;
+    for(auto& block : method)
+    {
+        // find the first conditional branch at the end of the block
+        Optional<InstructionWalker> firstBranch;
+        for(auto it = block.walkEnd().previousInBlock(); !it.isStartOfBlock() && it.get<intermediate::Branch>();
+            it.previousInBlock())
+        {
+            if(!it.get<intermediate::Branch>()->isUnconditional())
+                firstBranch = it;
+        }
+        if(!firstBranch)
+            continue;
+        auto flagsIt = block.findLastSettingOfFlags(*firstBranch);
+        if(!flagsIt || (*flagsIt)->hasConditionalExecution() || !(*flagsIt)->writesRegister(REG_NOP) ||
+            (*flagsIt)->getSignal().hasSideEffects())
+            continue;
+        auto branchCondition = intermediate::getBranchCondition(flagsIt->get<intermediate::ExtendedInstruction>());
+        if(!branchCondition.first || branchCondition.second != 0x1 || !branchCondition.first->checkLocal())
+            continue;
+        auto materialized = getMaterializedCondition(*branchCondition.first->local(), *flagsIt);
+        if(!materialized)
+            continue;
+
+        // the flags of all SIMD elements are the same, if they are set by an element-wise operation on lane-uniform
+        // values. Then the branch condition (only checking the first element) is true for all or none of the elements
+        const auto& setter = *materialized->second.get();
+        if(setter.hasConditionalExecution() || setter.hasUnpackMode() || setter.hasPackMode() ||
+            (!dynamic_cast<const intermediate::Operation*>(&setter) &&
+                !dynamic_cast<const intermediate::MoveOperation*>(&setter)) ||
+            dynamic_cast<const intermediate::VectorRotation*>(&setter) ||
+            !std::all_of(setter.getArguments().begin(), setter.getArguments().end(),
+                [&](const Value& arg) -> bool { return divergence.isLaneUniform(arg); }))
+            continue;
+
+        // the flags set for the branches must not be read by anything else
+        bool flagsUsedOtherwise = false;
+        for(auto it = flagsIt->copy().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has() && !it.get<intermediate::Branch>() && (it->hasConditionalExecution() || it->doesSetFlag()))
+                flagsUsedOtherwise = true;
+            auto branch = it.get<const intermediate::Branch>();
+            if(branch && !branch->isUnconditional() && branch->branchCondition != BRANCH_ALL_Z_CLEAR &&
+                branch->branchCondition != BRANCH_ANY_Z_SET)
+                flagsUsedOtherwise = true;
+        }
+        if(flagsUsedOtherwise || areFlagsLiveOut(cfg, block))
+            continue;
+
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Branching directly on the flags set by '" << setter.to_string()
+                << "' instead of the materialized condition: " << (*flagsIt)->to_string() << logging::endl);
+        auto condition = materialized->first;
+        for(auto it = flagsIt->copy().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            auto branch = it.get<intermediate::Branch>();
+            if(!branch || branch->isUnconditional())
+                continue;
+            // the branch on the condition being true (for the first element) is converted to the branch on the
+            // condition, the inverted branch to the branch on the inverted condition
+            branch->branchCondition = branch->branchCondition == BRANCH_ALL_Z_CLEAR ?
+                condition.toBranchCondition() :
+                condition.invert().toBranchCondition();
+        }
+        flagsIt->erase();
+        changedSomething = true;
+    }
+    return changedSomething;
+}
+
 InstructionWalker optimizations::combineSameFlags(
     const Module& module, Method& method, InstructionWalker it, const Configuration& config)
 {
@@ -167,7 +485,7 @@ InstructionWalker optimizations::combineSameFlags(
             if(checkIt.get<intermediate::MoveOperation>() != nullptr &&
                 checkIt.get<intermediate::MoveOperation>()->getSource() == src && !checkIt->hasConditionalExecution())
             {
-                CPPLOG_LAZY(logging::Level::DEBUG,
+                LOG_LAZY(logging::Level::DEBUG,
                     log << "Removing duplicate setting of same flags: " << it->to_string() << logging::endl);
                 it.erase();
                 // don't skip next instruction
@@ -258,7 +576,7 @@ InstructionWalker optimizations::combineFlagWithOutput(
     }
     if(!resultIt.isEndOfBlock())
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Combining move to set flags '" << it->to_string()
                 << "' with move to output: " << resultIt->to_string() << logging::endl);
         resultIt.get<intermediate::ExtendedInstruction>()->setSetFlags(SetFlag::SET_FLAGS);
@@ -51,6 +51,63 @@ namespace vc4c
          */
         bool removeUselessFlags(const Module& module, Method& method, const Configuration& config);
 
+        /*
+         * Removes the setting of flags which are already set to the same values, also across basic blocks.
+         *
+         * A forward data-flow analysis over the CFG determines for every point in the method the calculation (the
+         * operation and its inputs) the current flags were set from, as long as the same calculation reaches that point
+         * on all incoming paths and none of its inputs were modified since. Any instruction setting the flags from
+         * this same calculation again is redundant.
+         *
+         * Example:
+         *   - = xor %i, %n (setf)
+         *   br.ifz %exit
+         *   %body:
+         *   [...]
+         *   %exit:
+         *   - = xor %i, %n (setf)
+         *   %a = %b (ifz)
+         *
+         * becomes:
+         *   - = xor %i, %n (setf)
+         *   br.ifz %exit
+         *   %body:
+         *   [...]
+         *   %exit:
+         *   %a = %b (ifz)
+         *
+         * NOTE: This also covers the successive setting of the same flags handled by #combineSameFlags within a single
+         * basic block.
+         */
+        bool removeRedundantFlags(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Replaces the setting of the flags for conditional branches on a boolean value materialized from other flags
+         * with branching directly on these other flags, if they are the same for all SIMD elements.
+         *
+         * The boolean condition of a branch is usually calculated by a comparison, converted to a boolean value via
+         * conditional writes and then checked for the first SIMD element only by or-ing it with the element number.
+         * If the comparison is executed on lane-uniform values (see DivergenceAnalysis), the flags of all SIMD
+         * elements are equal, so the branch can be taken if all (or any) of the elements fulfill the condition of the
+         * comparison. This e.g. removes the re-calculation of the flags from the loop exit conditions.
+         *
+         * Example:
+         *   - = xor %i, %n (setf)
+         *   %cond = 1 (ifz)
+         *   %cond = 0 (ifzc)
+         *   - = or elem_num, %cond (setf)
+         *   br.allzc %exit
+         *
+         * becomes:
+         *   - = xor %i, %n (setf)
+         *   %cond = 1 (ifz)
+         *   %cond = 0 (ifzc)
+         *   br.allz %exit
+         *
+         * NOTE: The conditional writes of the boolean value are removed as dead code, if it is not used otherwise.
+         */
+        bool branchOnConditionFlags(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Combines successive setting of the same flag (e.g. introduced by PHI-nodes)
          *
@@ -7,11 +7,15 @@
 #include "InstructionScheduler.h"
 
 #include "../InstructionWalker.h"
+#include "../Module.h"
 #include "../Profiler.h"
+#include "../ThreadPool.h"
 #include "../analysis/DependencyGraph.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "log.h"
 
+#include <array>
+
 using namespace vc4c;
 using namespace vc4c::optimizations;
 
@@ -151,9 +155,11 @@ static int calculateSchedulingPriority(analysis::DependencyEdge& dependency, Bas
         if(instr->readsRegister(REG_TMU_OUT) || instr->readsRegister(REG_VPM_IO) ||
             instr->writesRegister(REG_TMU0_ADDRESS) || instr->writesRegister(REG_TMU1_ADDRESS))
             latencyLeft -= 4;
-        if(instr->readsRegister(REG_VPM_DMA_LOAD_WAIT) || instr->readsRegister(REG_VPM_DMA_STORE_WAIT) ||
-            instr->readsRegister(REG_MUTEX))
+        if(instr->readsRegister(REG_VPM_DMA_LOAD_WAIT) || instr->readsRegister(REG_VPM_DMA_STORE_WAIT))
             latencyLeft += 2;
+        // devalue instructions expected to stall the QPU (e.g. mutex acquire) by the stall cycles
+        const auto& target = block.getMethod().module.compilationConfig.target;
+        latencyLeft += static_cast<int>(analysis::getExpectedStallCycles(*instr, target));
         if(std::any_of(instr->getArguments().begin(), instr->getArguments().end(), [&](const Value& arg) -> bool {
                return arg.checkLocal() && arg.local()->getUsers(LocalUse::Type::READER).size() == 1;
            }))
@@ -171,10 +177,6 @@ static int calculateSchedulingPriority(analysis::DependencyEdge& dependency, Bas
     return (latencyLeft > 0 && dependency.data.isMandatoryDelay) ? MIN_PRIORITY : latencyLeft;
     // TODO also look into the future and keep some instructions (e.g. vector rotations/arithmetics) close to their
     // use?? (would need to calculate priority of uses and deduct distance)
-    // or look into the future and calculate the maximum mandatory (+preferred) delay between this instruction and the
-    // end of block (e.g. maximum path for all dependent delays) -> prefer maximum mandatory delay > maximum preferred
-    // delay > any other. Or directly calculate remaining delay into priority mandatory/preferred. Delay "behind"
-    // instruction can be calculated once per instruction?!
 }
 
 static int checkDependenciesMet(analysis::DependencyNode& entry, BasicBlock& block, OpenSet& openNodes)
@@ -210,8 +212,34 @@ static int checkDependenciesMet(analysis::DependencyNode& entry, BasicBlock& blo
     return schedulingPriority;
 }
 
+/*
+ * Returns the index of the TMU the given instruction triggers a load for, if any
+ */
+static Optional<std::size_t> getTMULoadRequest(const intermediate::IntermediateInstruction& inst)
+{
+    if(inst.writesRegister(REG_TMU0_ADDRESS))
+        return 0;
+    if(inst.writesRegister(REG_TMU1_ADDRESS))
+        return 1;
+    return {};
+}
+
+/*
+ * Returns the index of the TMU the given instruction reads the loaded value from, if any
+ */
+static Optional<std::size_t> getTMULoadResponse(const intermediate::IntermediateInstruction& inst)
+{
+    if(inst.getSignal() == SIGNAL_LOAD_TMU0)
+        return 0;
+    if(inst.getSignal() == SIGNAL_LOAD_TMU1)
+        return 1;
+    return {};
+}
+
+using TMUQueues = std::array<unsigned, 2>;
+
 static OpenSet::const_iterator selectInstruction(OpenSet& openNodes, analysis::DependencyGraph& graph,
-    BasicBlock& block, const DelaysMap& successiveMandatoryDelays, const DelaysMap& successiveDelays)
+    BasicBlock& block, const DelaysMap& criticalPathHeights, const TMUQueues& pendingTMURequests)
 {
     // iterate open-set until entry with no more dependencies
     auto it = openNodes.begin();
@@ -222,9 +250,14 @@ static OpenSet::const_iterator selectInstruction(OpenSet& openNodes, analysis::D
     {
         // select first entry (with highest priority) for which all dependencies are fulfilled (with latency)
         int priority = checkDependenciesMet(graph.assertNode(*it), block, openNodes);
+        auto tmuRequest = getTMULoadRequest(**it);
+        if(tmuRequest && pendingTMURequests[*tmuRequest] >= analysis::TMU_QUEUE_DEPTH)
+            // queuing more requests than the TMU can handle hangs the QPU
+            priority = MIN_PRIORITY;
         if(priority < MIN_PRIORITY)
-            priority -= static_cast<int>(successiveMandatoryDelays.at(*it));
-        // TODO use preferred delays?
+            // prefer the instructions with the longest (mandatory and preferred) latencies still to be covered behind
+            // them, since their succeeding instructions cannot be scheduled before the latencies are over anyway
+            priority -= static_cast<int>(criticalPathHeights.at(*it));
         // TODO remove adding/removing priorities in calculateSchedulingPriority?
         // TODO remove extra cases here?
         // TODO need to combine more instructions!
@@ -265,17 +298,12 @@ static OpenSet::const_iterator selectInstruction(OpenSet& openNodes, analysis::D
 
 // FIXME largely extends usage-ranges and increases pressure on registers
 // FIXME increases mutex-ranges!!
-// TODO make sure no more than 4(8?) TMU requests/responds are queued at any time (per TMU?)
-// - Specification documents 8 entries of single row (for general memory query), but does not specify whether one queue
-// or per TMU
-// - Tests show that up to 8 requests per TMU run (whether result is correct not tested!!), 9+ hang QPU
 
 /*
  * Select an instruction which does not depend on any instruction (not yet scheduled) anymore and insert it into the
  * basic block
  */
-static void selectInstructions(analysis::DependencyGraph& graph, BasicBlock& block,
-    const DelaysMap& successiveMandatoryDelays, const DelaysMap& successiveDelays)
+static void selectInstructions(analysis::DependencyGraph& graph, BasicBlock& block, const DelaysMap& criticalPathHeights)
 {
     // 1. "empty" basic block without deleting the instructions, skipping the label
     auto it = block.walk().nextInBlock();
@@ -291,9 +319,11 @@ static void selectInstructions(analysis::DependencyGraph& graph, BasicBlock& blo
     }
 
     // 2. fill again with reordered instructions
+    // the number of loads per TMU triggered (in this block) but not yet read back
+    TMUQueues pendingTMURequests{};
     while(!openNodes.empty())
     {
-        auto inst = selectInstruction(openNodes, graph, block, successiveMandatoryDelays, successiveDelays);
+        auto inst = selectInstruction(openNodes, graph, block, criticalPathHeights, pendingTMURequests);
         if(inst == openNodes.end())
         {
             // no instruction could be scheduled not violating the fixed latency, insert NOPs
@@ -303,29 +333,69 @@ static void selectInstructions(analysis::DependencyGraph& graph, BasicBlock& blo
         }
         else
         {
+            if(auto tmuRequest = getTMULoadRequest(**inst))
+                ++pendingTMURequests[*tmuRequest];
+            if(auto tmuResponse = getTMULoadResponse(**inst))
+                pendingTMURequests[*tmuResponse] -= std::min(pendingTMURequests[*tmuResponse], 1u);
             block.walkEnd().emplace(*inst);
             openNodes.erase(inst);
         }
     }
 }
 
+/*
+ * The per-block data required to reorder the instructions of a basic block
+ */
+struct BlockSchedule
+{
+    BasicBlock* block;
+    std::unique_ptr<analysis::DependencyGraph> dependencies;
+    // the critical path heights (the required and recommended successive delays) for all instructions
+    DelaysMap criticalPathHeights;
+};
+
+static void prepareSchedule(BlockSchedule* const& schedule)
+{
+    schedule->dependencies = analysis::DependencyGraph::createGraph(*schedule->block);
+    PROFILE_START(CalculateCriticalPath);
+    for(const auto& node : schedule->dependencies->getNodes())
+    {
+        // since we cache all delays (also for all intermediate results), it is only calculated once per node
+        node.second.calculateSucceedingCriticalPathLength(false, &schedule->criticalPathHeights);
+    }
+    PROFILE_END(CalculateCriticalPath);
+}
+
 bool optimizations::reorderInstructions(const Module& module, Method& kernel, const Configuration& config)
 {
+    FastAccessList<BlockSchedule> schedules;
+    schedules.reserve(kernel.size());
+    FastAccessList<BlockSchedule*> pendingSchedules;
+    pendingSchedules.reserve(kernel.size());
     for(BasicBlock& bb : kernel)
     {
-        auto dependencies = analysis::DependencyGraph::createGraph(bb);
-        // calculate required and recommended successive delays for all instructions
-        DelaysMap successiveMandatoryDelays;
-        DelaysMap successiveDelays;
-        PROFILE_START(CalculateCriticalPath);
-        for(const auto& node : dependencies->getNodes())
+        if(module.executionProfile.isNeverExecuted(kernel, bb))
         {
-            // since we cache all delays (also for all intermediate results), it is only calculated once per node
-            node.second.calculateSucceedingCriticalPathLength(true, &successiveMandatoryDelays);
-            node.second.calculateSucceedingCriticalPathLength(false, &successiveDelays);
+            // rescheduling increases the usage ranges of the locals, which is not worth it for blocks never executed
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Skipping reordering of block never executed according to the execution profile: "
+                    << bb.to_string() << logging::endl);
+            continue;
         }
-        PROFILE_END(CalculateCriticalPath);
-        selectInstructions(*dependencies, bb, successiveMandatoryDelays, successiveDelays);
+        schedules.emplace_back(BlockSchedule{&bb, nullptr, {}});
+        pendingSchedules.emplace_back(&schedules.back());
+    }
+
+    // Creating the dependency graphs only reads the instructions (and the users of the locals accessed), so they can
+    // be created in parallel. Since the reordering modifies the instructions of the block (and thus the users of the
+    // locals), all graphs are created before any block is rescheduled.
+    ThreadPool::getDefaultPool().scheduleAll<BlockSchedule*>(pendingSchedules, prepareSchedule);
+
+    for(auto& schedule : schedules)
+    {
+        selectInstructions(*schedule.dependencies, *schedule.block, schedule.criticalPathHeights);
+        // free the memory as early as possible
+        schedule.dependencies.reset();
     }
     return false;
 }
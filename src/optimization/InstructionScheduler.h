@@ -15,6 +15,14 @@ namespace vc4c
 
     namespace optimizations
     {
+        /*
+         * Reorders the instructions within the basic blocks (list scheduling), filling the latencies of the hardware
+         * units (see the machine model in DependencyGraph.h) with independent instructions instead of NOPs.
+         *
+         * The instructions are selected by the remaining latencies of their dependencies and their critical path
+         * height (the mandatory and preferred delays of all instructions depending on them), so long latency chains
+         * (e.g. TMU loads) are started as early as possible. No more TMU loads are queued than the TMU can handle.
+         */
         bool reorderInstructions(const Module& module, Method& kernel, const Configuration& config);
 
     } /* namespace optimizations */
@@ -8,11 +8,16 @@
 
 #include "../InstructionWalker.h"
 #include "../Method.h"
+#include "../analysis/AnalysisManager.h"
+#include "../analysis/ControlFlowGraph.h"
+#include "../analysis/DivergenceAnalysis.h"
+#include "../analysis/LivenessAnalysis.h"
 #include "../intermediate/VectorHelper.h"
 #include "../intermediate/operators.h"
 #include "CompilationError.h"
 #include "log.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -27,7 +32,7 @@ static const std::vector<BuiltinLocal::Type> workGroupLocalNames = {BuiltinLocal
     BuiltinLocal::Type::GLOBAL_OFFSET_Z, BuiltinLocal::Type::WORK_DIMENSIONS, BuiltinLocal::Type::GLOBAL_DATA_ADDRESS};
 
 static NODISCARD InstructionWalker compressLocalWrite(
-    Method& method, InstructionWalker it, const BuiltinLocal& local, const Local& container, unsigned char index)
+    Method& method, InstructionWalker it, const Local& local, const Local& container, unsigned char index)
 {
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Compressing write of local '" << local.name << "' into container '" << container.name
@@ -66,7 +71,7 @@ static NODISCARD InstructionWalker compressLocalWrite(
 }
 
 static NODISCARD InstructionWalker compressLocalRead(
-    Method& method, InstructionWalker it, const BuiltinLocal& local, const Local& container, unsigned char index)
+    Method& method, InstructionWalker it, const Local& local, const Local& container, unsigned char index)
 {
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Compressing read of local '" << local.name << "' from container '" << container.name << "' at position "
@@ -81,8 +86,7 @@ static NODISCARD InstructionWalker compressLocalRead(
     return it;
 }
 
-static void compressLocalIntoRegister(
-    Method& method, const BuiltinLocal& local, const Local& container, unsigned char index)
+static void compressLocalIntoRegister(Method& method, const Local& local, const Local& container, unsigned char index)
 {
     if(index > 15)
         throw CompilationError(CompilationStep::OPTIMIZER, "Container index out of bounds", std::to_string(index));
@@ -125,3 +129,166 @@ bool optimizations::compressWorkGroupLocals(const Module& module, Method& method
 
     return false;
 }
+
+// the number of locals which can be held in registers at the same time
+static constexpr unsigned NUM_REGISTERS =
+    analysis::RegisterPressure::NUM_ACCUMULATORS + 2 * analysis::RegisterPressure::NUM_FILE_REGISTERS;
+// the weight of the reads per nesting level of loops (i.e. the estimated number of iterations)
+static constexpr unsigned LOOP_WEIGHT_SHIFT = 3;
+static constexpr unsigned MAX_LOOP_DEPTH = 3;
+
+struct CompressionCandidate
+{
+    const Local* local;
+    // the number of reads (and therefore of inserted extractions), weighted by the nesting depth of their loops
+    unsigned weightedReads;
+};
+
+/*
+ * Determines the instructions after which the flags are still read (by a conditional instruction or branch) before
+ * being set again, so no element selection can be inserted there
+ */
+static FastSet<const intermediate::IntermediateInstruction*> determineLiveFlags(Method& method)
+{
+    FastSet<const intermediate::IntermediateInstruction*> liveFlags;
+    std::vector<const intermediate::IntermediateInstruction*> instructions;
+    for(auto& block : method)
+    {
+        instructions.clear();
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has())
+                instructions.push_back(it.get());
+        }
+        bool flagsRead = false;
+        for(auto instIt = instructions.rbegin(); instIt != instructions.rend(); ++instIt)
+        {
+            if(flagsRead)
+                liveFlags.emplace(*instIt);
+            auto branch = dynamic_cast<const intermediate::Branch*>(*instIt);
+            if((*instIt)->hasConditionalExecution() || (branch && !branch->isUnconditional()))
+                flagsRead = true;
+            else if((*instIt)->doesSetFlag())
+                flagsRead = false;
+        }
+    }
+    return liveFlags;
+}
+
+static bool isCompressibleReader(const intermediate::IntermediateInstruction& reader)
+{
+    // the extracted value is only valid in the first SIMD element, so the reader may only calculate a scalar value
+    // element-wise and may not set any flags (which would be set for all elements)
+    if(!reader.checkOutputLocal() || !reader.getOutput()->type.isScalarType() || reader.doesSetFlag())
+        return false;
+    if(dynamic_cast<const intermediate::VectorRotation*>(&reader))
+        return false;
+    return dynamic_cast<const intermediate::MoveOperation*>(&reader) ||
+        dynamic_cast<const intermediate::Operation*>(&reader);
+}
+
+static bool isCompressible(const Local& local, const analysis::DivergenceAnalysis& divergence,
+    const FastSet<const intermediate::IntermediateInstruction*>& liveFlags)
+{
+    if(!local.type.isScalarType() || local.is<Parameter>() || local.is<BuiltinLocal>() || local.residesInMemory() ||
+        local.get<MultiRegisterData>())
+        return false;
+    // since only a single SIMD element is stored, the value needs to be the same for all elements
+    if(!divergence.isLaneUniform(local.createReference()))
+        return false;
+    auto writer = local.getSingleWriter();
+    // the element insertion after the writer sets the flags
+    if(!writer || writer->hasConditionalExecution() || writer->doesSetFlag() ||
+        liveFlags.find(writer) != liveFlags.end() || writer->readsLocal(&local))
+        return false;
+    bool hasReaders = false;
+    bool allReadersCompressible = true;
+    local.forUsers(LocalUse::Type::READER, [&](const LocalUser* reader) {
+        hasReaders = true;
+        allReadersCompressible = allReadersCompressible && isCompressibleReader(*reader);
+    });
+    return hasReaders && allReadersCompressible;
+}
+
+bool optimizations::compressUniformLocals(const Module& module, Method& method, const Configuration& config)
+{
+    if(method.size() == 0 || method.begin()->empty())
+        return false;
+    auto& analyses = method.getAnalyses();
+    const auto& registerPressure = analyses.getRegisterPressure();
+    if(registerPressure.getMaximumPressure().total() <= NUM_REGISTERS)
+        return false;
+    auto numExcessLocals = registerPressure.getMaximumPressure().total() - NUM_REGISTERS;
+
+    // only the locals live across the blocks with the highest register pressure are worth compressing
+    analysis::GlobalLivenessAnalysis liveness(false);
+    liveness(method);
+    FastSet<const Local*> liveLocals;
+    FastMap<const intermediate::IntermediateInstruction*, unsigned> readWeights;
+    FastMap<const BasicBlock*, unsigned> loopDepths;
+    for(const auto& loop : analyses.getLoops(true))
+    {
+        for(const auto* node : loop)
+            ++loopDepths[node->key];
+    }
+    for(auto& block : method)
+    {
+        if(registerPressure.getMaximumPressure(block).total() > NUM_REGISTERS)
+        {
+            const auto& incomingLocals = liveness.getIncomingLiveLocals(block);
+            liveLocals.insert(incomingLocals.begin(), incomingLocals.end());
+        }
+        auto depthIt = loopDepths.find(&block);
+        auto weight = 1u << (LOOP_WEIGHT_SHIFT * std::min(depthIt != loopDepths.end() ? depthIt->second : 0u,
+                                                      MAX_LOOP_DEPTH));
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has())
+                readWeights.emplace(it.get(), weight);
+        }
+    }
+
+    const auto& divergence = analyses.getDivergence();
+    auto liveFlags = determineLiveFlags(method);
+    std::vector<CompressionCandidate> candidates;
+    for(auto local : liveLocals)
+    {
+        if(!isCompressible(*local, divergence, liveFlags))
+            continue;
+        unsigned weightedReads = 0;
+        local->forUsers(LocalUse::Type::READER,
+            [&](const LocalUser* reader) { weightedReads += readWeights.at(reader); });
+        candidates.push_back(CompressionCandidate{local, weightedReads});
+    }
+    // prefer the locals with the fewest extractions to be inserted, the name makes the order deterministic
+    std::sort(candidates.begin(), candidates.end(),
+        [](const CompressionCandidate& one, const CompressionCandidate& other) -> bool {
+            return one.weightedReads < other.weightedReads ||
+                (one.weightedReads == other.weightedReads && one.local->name < other.local->name);
+        });
+
+    // every container occupies a register itself
+    std::size_t numCompressed = 0;
+    while(numCompressed < candidates.size() &&
+        numCompressed - (numCompressed + NATIVE_VECTOR_SIZE - 1) / NATIVE_VECTOR_SIZE < numExcessLocals)
+        ++numCompressed;
+    if(numCompressed < 2)
+        // compressing a single local into a container does not free any register
+        return false;
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Compressing " << numCompressed << " uniform locals to reduce the register pressure of "
+            << registerPressure.getMaximumPressure().to_string() << logging::endl);
+    Value container = UNDEFINED_VALUE;
+    for(std::size_t i = 0; i < numCompressed; ++i)
+    {
+        auto index = static_cast<unsigned char>(i % NATIVE_VECTOR_SIZE);
+        if(index == 0)
+        {
+            container = method.addNewLocal(TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE), "%compressed_locals");
+            method.begin()->walk().nextInBlock().emplace(new intermediate::MoveOperation(container, INT_ZERO));
+        }
+        compressLocalIntoRegister(method, *candidates[i].local, *container.local(), index);
+    }
+    return true;
+}
@@ -42,6 +42,31 @@ namespace vc4c
          *
          */
         bool compressWorkGroupLocals(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Reduces the register pressure of methods which would otherwise need to spill locals by combining several
+         * long-living scalar locals into the SIMD elements of shared container registers.
+         *
+         * Only locals which are live across the basic blocks exceeding the available registers, have the same value in
+         * all SIMD elements (see DivergenceAnalysis), are written once and are only read by scalar ALU operations are
+         * compressed. Since an element extraction is inserted before every read, the locals with the fewest reads
+         * (weighted by the nesting depth of the loops containing them) are selected first and only as many locals are
+         * compressed as required to not exceed the available registers.
+         *
+         * Example:
+         *   %a = %b + 4
+         *   ...
+         *   %c = %a * %d
+         *
+         * is converted to:
+         *   %tmp = %b + 4
+         *   - = xor elem_num, 3 (setf)
+         *   %compressed_locals = %tmp << 3 (ifz)
+         *   ...
+         *   %tmp1 = %compressed_locals >> 3
+         *   %c = %tmp1 * %d
+         */
+        bool compressUniformLocals(const Module& module, Method& method, const Configuration& config);
     } /* namespace optimizations */
 } /* namespace vc4c */
 #endif /* VC4C_LOCAL_COMPRESSION_H */
@@ -6,6 +6,8 @@
 
 #include "Optimizer.h"
 
+#include "../CompilationState.h"
+#include "../Logging.h"
 #include "../Module.h"
 #include "../Profiler.h"
 #include "../ThreadPool.h"
@@ -17,15 +19,18 @@
 #include "InstructionScheduler.h"
 #include "LocalCompression.h"
 #include "Reordering.h"
-#include "log.h"
+
+#include <algorithm>
+#include <numeric>
 
 using namespace vc4c;
 using namespace vc4c::optimizations;
 
 OptimizationPass::OptimizationPass(const std::string& name, const std::string& parameterName, const Pass& pass,
-    const std::string& description, OptimizationType type) :
+    const std::string& description, OptimizationType type, analysis::CachedAnalysis preservedAnalyses) :
     name(name),
-    parameterName(parameterName), description(description), type(type), pass(pass)
+    parameterName(parameterName), description(description), type(type), preservedAnalyses(preservedAnalyses),
+    pass(pass)
 {
 }
 
@@ -34,7 +39,10 @@ bool OptimizationPass::operator()(const Module& module, Method& method, const Co
     return pass(module, method, config);
 }
 
-OptimizationStep::OptimizationStep(const std::string& name, const Step& step) : name(name), step(step) {}
+OptimizationStep::OptimizationStep(const std::string& name, const Step& step, StepTarget target) :
+    name(name), target(target), step(step)
+{
+}
 
 InstructionWalker OptimizationStep::operator()(
     const Module& module, Method& method, InstructionWalker it, const Configuration& config) const
@@ -42,56 +50,185 @@ InstructionWalker OptimizationStep::operator()(
     return step(module, method, it, config);
 }
 
+bool OptimizationStep::isApplicableTo(StepTarget instructionProperties) const noexcept
+{
+    return target == StepTarget::ANY || intersect_flags(instructionProperties, target) != StepTarget::ANY;
+}
+
+StepTarget OptimizationStep::classify(InstructionWalker it)
+{
+    if(!it.has())
+        return StepTarget::ANY;
+    StepTarget properties = StepTarget::ANY;
+    if(it.get<intermediate::MoveOperation>())
+        properties = add_flag(properties, StepTarget::MOVE);
+    else if(it.get<intermediate::Operation>())
+        properties = add_flag(properties, StepTarget::OPERATION);
+    if(it->doesSetFlag())
+        properties = add_flag(properties, StepTarget::SETS_FLAGS);
+    if(it->checkOutputRegister() & &Register::isSpecialFunctionsUnit)
+        properties = add_flag(properties, StepTarget::WRITES_SFU);
+    return properties;
+}
+
 static const std::vector<OptimizationStep> SINGLE_STEPS = {
     // combine consecutive instructions writing the same local with a value and zero depending on some flags
-    OptimizationStep("CombineSelectionWithZero", combineSelectionWithZero),
+    OptimizationStep("CombineSelectionWithZero", combineSelectionWithZero, StepTarget::MOVE),
     // combine successive setting of the same flags
-    OptimizationStep("CombineSettingSameFlags", combineSameFlags),
+    OptimizationStep("CombineSettingSameFlags", combineSameFlags, StepTarget::SETS_FLAGS),
     // combine writing of value to set flags with writing of same value into output
-    OptimizationStep("CombineSettingFlagsWithOutput", combineFlagWithOutput),
+    OptimizationStep("CombineSettingFlagsWithOutput", combineFlagWithOutput, StepTarget::SETS_FLAGS),
     // calculates constant operations
-    OptimizationStep("FoldConstants", foldConstants),
+    OptimizationStep("FoldConstants", foldConstants, StepTarget::OPERATION),
     // simplifies arithmetic operations into moves or into "easier" operations
-    OptimizationStep("SimplifyArithmetics", simplifyOperation),
+    OptimizationStep("SimplifyArithmetics", simplifyOperation, add_flag(StepTarget::MOVE, StepTarget::OPERATION)),
     // combines operations according to arithmetic rules
-    OptimizationStep("CombineArithmetics", combineArithmeticOperations),
+    OptimizationStep("CombineArithmetics", combineArithmeticOperations, StepTarget::OPERATION),
+    // replaces bitwise idioms (e.g. rotations, bit-selections) with shorter sequences of native operations
+    OptimizationStep("CombineBitwiseIdioms", combineBitwiseOperations, StepTarget::OPERATION),
+    // fuses half-precision floating-point conversions into the un-/pack modes of the consuming/producing instructions
+    OptimizationStep("CombineHalfConversions", combineHalfConversions, StepTarget::OPERATION),
+    // fuses integer extensions and byte extractions into the unpack modes of the consuming instructions
+    OptimizationStep(
+        "CombineExtensionUnpacks", combineExtensionUnpacks, add_flag(StepTarget::MOVE, StepTarget::OPERATION)),
+    // replaces additions/subtractions of bytes saturated via min/max with the saturating packed 8-bit operations
+    OptimizationStep("CombineSaturatedByteOperations", combineSaturatedByteOperations, StepTarget::OPERATION),
+    // applies the saturating pack-modes of moves directly to the operations calculating the moved values
+    OptimizationStep("CombineSaturationPackModes", combineSaturationPackModes, StepTarget::MOVE),
     // removes calls to SFU registers with constant input
-    OptimizationStep("RewriteConstantSFU", rewriteConstantSFUCall)};
+    OptimizationStep("RewriteConstantSFU", rewriteConstantSFUCall, StepTarget::WRITES_SFU)};
 
-static bool runSingleSteps(const Module& module, Method& method, const Configuration& config)
-{
-    LCOV_EXCL_START
-    logging::logLazy(logging::Level::DEBUG, [&](std::wostream& log) {
-        log << "Running steps: ";
-        for(const OptimizationStep& step : SINGLE_STEPS)
-            log << step.name << ", ";
-        log << logging::endl;
-    });
-    LCOV_EXCL_STOP
+/*
+ * The minimum number of instructions of a method for the single steps to be run in parallel for independent basic
+ * blocks. For smaller methods, the overhead of grouping and scheduling the blocks is not worth it.
+ */
+static constexpr std::size_t MIN_INSTRUCTIONS_FOR_PARALLEL_STEPS = 4096;
 
+static void runSingleStepsOnBlock(const Module& module, Method& method, BasicBlock& block, const Configuration& config)
+{
     // since an optimization-step can be run on the result of the previous step,
     // we can't just pass the resulting iterator (pointing behind the optimization result) into the next
     // optimization-step  but since lists do not reallocate elements at inserting/removing, we can re-use the previous
     // iterator
-    auto it = method.walkAllInstructions();
+    auto it = block.walk().nextInBlock();
     // this construct with previous iterator is required, because the iterator could be invalidated (if the underlying
     // node is removed)
-    auto prevIt = it;
-    while(!it.isEndOfMethod())
+    auto prevIt = block.walk();
+    while(!it.isEndOfBlock())
     {
+        // the steps are only run for the instructions they can be applied to, which avoids the (repeated) checks for
+        // the instruction type within the steps for the majority of the instructions
+        auto properties = OptimizationStep::classify(it);
         for(const OptimizationStep& step : SINGLE_STEPS)
         {
+            if(!step.isApplicableTo(properties))
+                continue;
             PROFILE_START_DYNAMIC(step.name);
             auto newIt = step(module, method, it, config);
             // we can't just test newIt == it here, since if we replace the content of the iterator instead of deleting
             // it, the iterators are still the same, even if we emplace instructions before
-            if(newIt.copy().previousInMethod() != prevIt || newIt != it)
+            if(newIt != it || (!newIt.isStartOfBlock() && newIt.copy().previousInBlock() != prevIt))
+            {
                 it = prevIt;
+                properties = OptimizationStep::classify(it);
+            }
             PROFILE_END_DYNAMIC(step.name);
         }
-        it.nextInMethod();
-        prevIt = it.copy().previousInMethod();
+        it.nextInBlock();
+        prevIt = it.copy().previousInBlock();
     }
+}
+
+/*
+ * Groups the basic blocks of the method into sets of blocks which do not share any local.
+ *
+ * The single steps only access the instruction they are run for, the locals it uses and the other instructions
+ * reading/writing these locals (e.g. to pre-calculate the value of an argument), so blocks of different groups can be
+ * optimized in parallel without any further synchronization. Globals track their users thread-safe (since they are
+ * shared across kernels) and labels are not modified by the single steps, so they do not connect blocks. New locals
+ * (e.g. created by combining bitwise operations into a bit-select) are inserted thread-safe by the method itself (see
+ * Method#addNewLocal()) and are only used within the block they are created for.
+ */
+static std::vector<std::vector<BasicBlock*>> groupIndependentBlocks(Method& method)
+{
+    std::vector<BasicBlock*> blocks;
+    blocks.reserve(method.size());
+    for(auto& block : method)
+        blocks.emplace_back(&block);
+
+    // union-find over the block indices
+    std::vector<std::size_t> parents(blocks.size());
+    std::iota(parents.begin(), parents.end(), std::size_t{0});
+    auto findRoot = [&](std::size_t index) -> std::size_t {
+        while(parents[index] != index)
+        {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    };
+
+    FastMap<const Local*, std::size_t> localBlocks;
+    for(std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        for(const auto& inst : *blocks[i])
+        {
+            if(!inst)
+                continue;
+            inst->forUsedLocals(
+                [&](const Local* loc, LocalUse::Type type, const intermediate::IntermediateInstruction& user) {
+                    if(loc->type.isLabelType() || loc->is<Global>())
+                        return;
+                    auto firstBlock = localBlocks.emplace(loc, i).first->second;
+                    parents[findRoot(i)] = findRoot(firstBlock);
+                });
+        }
+    }
+
+    std::vector<std::vector<BasicBlock*>> groups;
+    FastMap<std::size_t, std::size_t> groupIndices;
+    for(std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        auto groupIt = groupIndices.emplace(findRoot(i), groups.size());
+        if(groupIt.second)
+            groups.emplace_back();
+        groups[groupIt.first->second].emplace_back(blocks[i]);
+    }
+    return groups;
+}
+
+static bool runSingleSteps(const Module& module, Method& method, const Configuration& config)
+{
+    LCOV_EXCL_START
+    logging::logLazy(logging::Level::DEBUG, [&](std::wostream& log) {
+        log << "Running steps: ";
+        for(const OptimizationStep& step : SINGLE_STEPS)
+            log << step.name << ", ";
+        log << logging::endl;
+    });
+    LCOV_EXCL_STOP
+
+    if(method.countInstructions() >= MIN_INSTRUCTIONS_FOR_PARALLEL_STEPS)
+    {
+        auto groups = groupIndependentBlocks(method);
+        if(groups.size() > 1)
+        {
+            LOG_LAZY(logging::Level::DEBUG,
+                log << "Running steps in parallel for " << groups.size() << " groups of independent blocks"
+                    << logging::endl);
+            const std::function<void(const std::vector<BasicBlock*>&)> func =
+                [&](const std::vector<BasicBlock*>& group) {
+                    for(auto block : group)
+                        runSingleStepsOnBlock(module, method, *block, config);
+                };
+            ThreadPool::getDefaultPool().scheduleAll<std::vector<BasicBlock*>>(groups, func, 1);
+            // XXX
+            return true;
+        }
+    }
+
+    for(auto& block : method)
+        runSingleStepsOnBlock(module, method, block, config);
 
     // XXX
     return true;
@@ -133,35 +270,191 @@ Optimizer::Optimizer(const Configuration& config) : config(config)
     }
 }
 
-static bool runPass(
-    const OptimizationPass& pass, std::size_t index, const Module& module, Method& method, const Configuration& config)
+/*
+ * Tracks the modifications of the basic blocks of a method by the single optimization passes.
+ *
+ * Since not all passes reliably report whether they changed the method and many instructions are modified in-place,
+ * the modifications are detected by comparing the fingerprints of the instructions of every block before and after
+ * running a pass. This allows to skip passes, if the method did not change since their last execution.
+ *
+ * NOTE: The optimization passes always work on the whole method, so a pass is re-run on all blocks if any block was
+ * modified.
+ */
+class ModificationTracker
 {
+public:
+    explicit ModificationTracker(const Method& method)
+    {
+        for(const auto& block : method)
+            blocks.emplace(&block, BlockState{calculateFingerprint(block), 0, {}});
+    }
+
+    /*
+     * Updates the fingerprints of all blocks after the given pass was run and returns whether any block was modified
+     */
+    bool update(const Method& method, const OptimizationPass& pass)
+    {
+        ++currentTime;
+        lastRuns[&pass] = currentTime;
+        bool modified = method.size() != blocks.size();
+        for(const auto& block : method)
+        {
+            auto fingerprint = calculateFingerprint(block);
+            auto it = blocks.find(&block);
+            if(it == blocks.end())
+                it = blocks.emplace(&block, BlockState{fingerprint + 1, 0, {}}).first;
+            if(it->second.fingerprint != fingerprint)
+            {
+                it->second.fingerprint = fingerprint;
+                it->second.lastModification = currentTime;
+                if(std::find(it->second.modifyingPasses.begin(), it->second.modifyingPasses.end(), &pass) ==
+                    it->second.modifyingPasses.end())
+                    it->second.modifyingPasses.emplace_back(&pass);
+                modified = true;
+            }
+        }
+        if(method.size() != blocks.size())
+        {
+            // some blocks were removed, drop their states
+            FastMap<const BasicBlock*, BlockState> remainingBlocks;
+            remainingBlocks.reserve(method.size());
+            for(const auto& block : method)
+                remainingBlocks.emplace(&block, std::move(blocks.at(&block)));
+            blocks = std::move(remainingBlocks);
+        }
+        if(modified)
+            lastModification = currentTime;
+        return modified;
+    }
+
+    /*
+     * Returns whether any block was modified since the last execution of the given pass
+     */
+    bool isModifiedSinceLastRun(const OptimizationPass& pass) const
+    {
+        auto it = lastRuns.find(&pass);
+        return it == lastRuns.end() || lastModification > it->second;
+    }
+
+    void dumpModifications(const Method& method) const
+    {
+        logging::logLazy(logging::Level::DEBUG, [&]() {
+            for(const auto& block : method)
+            {
+                auto it = blocks.find(&block);
+                if(it == blocks.end() || it->second.modifyingPasses.empty())
+                    continue;
+                logging::debug() << "Block " << block.to_string() << " modified by: ";
+                for(auto pass : it->second.modifyingPasses)
+                    logging::debug() << pass->name << ", ";
+                logging::debug() << logging::endl;
+            }
+        });
+    }
+
+private:
+    struct BlockState
+    {
+        std::size_t fingerprint;
+        // the time of the last modification of this block
+        std::size_t lastModification;
+        // the passes which modified this block
+        FastAccessList<const OptimizationPass*> modifyingPasses;
+    };
+
+    // the "time" is the number of passes run so far
+    std::size_t currentTime = 0;
+    std::size_t lastModification = 0;
+    FastMap<const BasicBlock*, BlockState> blocks;
+    FastMap<const OptimizationPass*, std::size_t> lastRuns;
+
+    static std::size_t calculateFingerprint(const BasicBlock& block)
+    {
+        std::size_t fingerprint = block.size();
+        for(const auto& inst : block)
+            fingerprint = fingerprint * 31 + (inst ? inst->getFingerprint() : 0);
+        return fingerprint;
+    }
+};
+
+static bool runPass(const OptimizationPass& pass, std::size_t index, const Module& module, Method& method,
+    const Configuration& config, ModificationTracker& tracker, OptimizationStatistics& statistics)
+{
+    checkCancellation();
     logging::logLazy(logging::Level::DEBUG, [&]() {
         logging::debug() << logging::endl;
         logging::debug() << "Running pass: " << pass.name << logging::endl;
     });
     PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + index, pass.name + " (before)", method.countInstructions());
     PROFILE_START_DYNAMIC(pass.name);
-    bool changedMethod = (pass)(module, method, config);
+    auto traceStart = profiler::startTraceEvent();
+    auto start = std::chrono::steady_clock::now();
+    bool reportedChange = (pass)(module, method, config);
+    profiler::endTraceEvent("optimization", pass.name.c_str(), traceStart);
+    auto& passStatistics = statistics.passes[pass.name];
+    passStatistics.duration +=
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
     PROFILE_END_DYNAMIC(pass.name);
+    bool changedMethod = tracker.update(method, pass);
+    ++passStatistics.numRuns;
+    if(changedMethod)
+        ++passStatistics.numChanges;
+    // the return value of the passes run only once is not used and therefore not necessarily correct
+    if(changedMethod || reportedChange || pass.type != OptimizationType::REPEAT)
+        method.getAnalyses().invalidate(pass.preservedAnalyses);
+    // recalculating the analyses is cheaper than running out of memory
+    if(profiler::exceedsMemoryLimit(config.maxCompilationMemory))
+    {
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "Dropping cached analyses after pass " << pass.name << ", memory limit is exceeded"
+                << logging::endl);
+        method.getAnalyses().release();
+    }
     PROFILE_COUNTER_WITH_PREV(vc4c::profiler::COUNTER_OPTIMIZATION + index + 10, pass.name + " (after)",
         method.countInstructions(), vc4c::profiler::COUNTER_OPTIMIZATION + index);
     return changedMethod;
 }
 
-static void runOptimizationPasses(const Module& module, Method& method, const Configuration& config,
+/*
+ * Returns whether the given pass can be run within the configured time budgets (see
+ * OptimizationOptions#passTimeBudget and OptimizationOptions#kernelTimeBudget). Otherwise, records the pass as cut.
+ */
+static bool isWithinTimeBudget(const OptimizationPass& pass, const Configuration& config,
+    OptimizationStatistics& statistics, std::chrono::steady_clock::time_point kernelStart)
+{
+    const auto& options = config.additionalOptions;
+    auto& passStatistics = statistics.passes[pass.name];
+    bool exceedsPassBudget =
+        options.passTimeBudget != 0 && passStatistics.duration >= std::chrono::milliseconds(options.passTimeBudget);
+    bool exceedsKernelBudget = options.kernelTimeBudget != 0 &&
+        std::chrono::steady_clock::now() - kernelStart >= std::chrono::milliseconds(options.kernelTimeBudget);
+    if(!exceedsPassBudget && !exceedsKernelBudget)
+        return true;
+    LOG_LAZY(logging::Level::DEBUG,
+        log << "Skipping pass " << pass.name << ", the " << (exceedsPassBudget ? "pass" : "kernel")
+            << " time budget is exceeded" << logging::endl);
+    ++passStatistics.numCutByBudget;
+    statistics.exceededTimeBudget = true;
+    return false;
+}
+
+static OptimizationStatistics runOptimizationPasses(const Module& module, Method& method, const Configuration& config,
     const std::vector<const OptimizationPass*>& initialPasses,
     const std::vector<const OptimizationPass*>& repeatingPasses,
     const std::vector<const OptimizationPass*>& finalPasses)
 {
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
-    CPPLOG_LAZY(logging::Level::INFO, log << "Running optimization passes for: " << method.name << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
+    LOG_LAZY(logging::Level::INFO, log << "Running optimization passes for: " << method.name << logging::endl);
     std::size_t numInstructions = method.countInstructions();
+    OptimizationStatistics statistics;
+    ModificationTracker tracker(method);
+    const auto kernelStart = std::chrono::steady_clock::now();
 
     std::size_t index = 0;
     for(const OptimizationPass* pass : initialPasses)
     {
-        runPass(*pass, index, module, method, config);
+        if(isWithinTimeBudget(*pass, config, statistics, kernelStart))
+            runPass(*pass, index, module, method, config, tracker, statistics);
         index += 100;
     }
 
@@ -171,10 +464,12 @@ static void runOptimizationPasses(const Module& module, Method& method, const Co
     unsigned iterationsLeft = config.additionalOptions.maxOptimizationIterations;
     for(; continueLoop && iterationsLeft > 0; --iterationsLeft)
     {
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Running optimization iteration "
                 << (config.additionalOptions.maxOptimizationIterations - iterationsLeft) << "..." << logging::endl);
+        ++statistics.numIterations;
         index = startIndex;
+        bool changedInIteration = false;
         for(const OptimizationPass* pass : repeatingPasses)
         {
             if(lastChangingOptimization == pass)
@@ -183,10 +478,26 @@ static void runOptimizationPasses(const Module& module, Method& method, const Co
                 continueLoop = false;
                 break;
             }
-            if(runPass(*pass, index, module, method, config))
+            if(!tracker.isModifiedSinceLastRun(*pass))
+            {
+                // running the pass again on the unmodified method would not change anything
+                LOG_LAZY(logging::Level::DEBUG,
+                    log << "Skipping pass " << pass->name << ", the method was not modified since its last run"
+                        << logging::endl);
+                ++statistics.passes[pass->name].numSkipped;
+            }
+            // after the kernel budget is exceeded, no pass changes anything anymore, which stops the iterations
+            else if(isWithinTimeBudget(*pass, config, statistics, kernelStart) &&
+                runPass(*pass, index, module, method, config, tracker, statistics))
+            {
                 lastChangingOptimization = pass;
+                changedInIteration = true;
+            }
             index += 100;
         }
+        if(!changedInIteration)
+            // none of the passes changed anything, so further iterations would not either
+            continueLoop = false;
     }
     index = startIndex + repeatingPasses.size() * 100;
     if(iterationsLeft == 0 && config.additionalOptions.maxOptimizationIterations > 0 &&
@@ -198,41 +509,66 @@ static void runOptimizationPasses(const Module& module, Method& method, const Co
 
     for(const OptimizationPass* pass : finalPasses)
     {
-        runPass(*pass, index, module, method, config);
+        if(isWithinTimeBudget(*pass, config, statistics, kernelStart))
+            runPass(*pass, index, module, method, config, tracker, statistics);
         index += 100;
     }
 
+    if(statistics.exceededTimeBudget)
+    {
+        auto& stream = logging::warn() << "Optimization time budget exceeded for '" << method.name
+                                       << "', skipped passes:";
+        for(const auto& entry : statistics.passes)
+        {
+            if(entry.second.numCutByBudget > 0)
+                stream << ' ' << entry.first << " (" << entry.second.numCutByBudget << "x)";
+        }
+        stream << logging::endl;
+    }
+
     LCOV_EXCL_START
     logging::logLazy(logging::Level::INFO, [&]() {
         logging::info() << logging::endl;
         if(numInstructions != method.countInstructions())
         {
-            logging::info() << "Optimizations done in "
-                            << (config.additionalOptions.maxOptimizationIterations - iterationsLeft - 1)
+            logging::info() << "Optimizations done in " << statistics.numIterations
                             << " iterations, changed number of instructions from " << numInstructions << " to "
                             << method.countInstructions() << logging::endl;
         }
         else
         {
-            logging::info() << "Optimizations done in "
-                            << (config.additionalOptions.maxOptimizationIterations - iterationsLeft - 1)
-                            << " iterations" << logging::endl;
+            logging::info() << "Optimizations done in " << statistics.numIterations << " iterations"
+                            << logging::endl;
         }
     });
+    logging::logLazy(logging::Level::DEBUG, [&]() {
+        for(const auto& entry : statistics.passes)
+            logging::debug() << "Pass " << entry.first << ": " << entry.second.numRuns << " runs ("
+                             << entry.second.numChanges << " with changes, " << entry.second.numSkipped
+                             << " skipped) in " << entry.second.duration.count() << " us" << logging::endl;
+    });
+    tracker.dumpModifications(method);
     LCOV_EXCL_STOP
-    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + index, "OptimizationIterations",
-        config.additionalOptions.maxOptimizationIterations - iterationsLeft - 1);
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + index, "OptimizationIterations", statistics.numIterations);
+    LOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
     method.dumpInstructions();
+    return statistics;
 }
 
 void Optimizer::optimize(Module& module) const
 {
     auto kernels = module.getKernels();
-    const auto f = [&](Method* kernelFunc) {
-        runOptimizationPasses(module, *kernelFunc, config, initialPasses, repeatingPasses, finalPasses);
-    };
-    ThreadPool{"Optimizer"}.scheduleAll<Method*>(kernels, f);
+    const auto f = [&](Method* kernelFunc) { optimizeMethod(module, *kernelFunc); };
+    ThreadPool::getDefaultPool().scheduleAll<Method*>(kernels, f);
+}
+
+OptimizationStatistics Optimizer::optimizeMethod(const Module& module, Method& method) const
+{
+    // we do not know what happened to the method before (or will happen after) the optimizations
+    method.getAnalyses().invalidate();
+    auto statistics = runOptimizationPasses(module, method, config, initialPasses, repeatingPasses, finalPasses);
+    method.getAnalyses().invalidate();
+    return statistics;
 }
 
 const std::vector<OptimizationPass> Optimizer::ALL_PASSES = {
@@ -243,7 +579,12 @@ const std::vector<OptimizationPass> Optimizer::ALL_PASSES = {
     OptimizationPass("AddWorkGroupLoops", "loop-work-groups", addWorkGroupLoop,
         "merges all work-group executions into a single kernel execution", OptimizationType::INITIAL),
     OptimizationPass("ReorderBasicBlocks", "reorder-blocks", reorderBasicBlocks,
-        "reorders basic blocks to eliminate as many explicit branches as possible", OptimizationType::INITIAL),
+        "reorders basic blocks to replace the most often taken branches with fall-through and copies small blocks into "
+        "their predecessors",
+        OptimizationType::INITIAL),
+    OptimizationPass("IfConversion", "if-conversion", convertIfBlocks,
+        "converts small if-then and if-then-else blocks to conditional execution, if this is cheaper than branching",
+        OptimizationType::INITIAL),
     OptimizationPass("SimplifyConditionalBlocks", "simplify-conditionals", simplifyConditionalBlocks,
         "simplifies selected if-else and switch-case blocks by replacing the control-flow with conditional execution",
         OptimizationType::INITIAL),
@@ -254,30 +595,59 @@ const std::vector<OptimizationPass> Optimizer::ALL_PASSES = {
         "merges adjacent basic blocks if there are no other conflicting transitions", OptimizationType::INITIAL),
     OptimizationPass("VectorizeLoops", "vectorize-loops", vectorizeLoops, "vectorizes supported types of loops",
         OptimizationType::INITIAL),
+    // executed after the vectorization, since vectorizing a loop is preferred over unrolling it
+    OptimizationPass("UnrollLoops", "unroll-loops", unrollLoops,
+        "unrolls small loops with known iteration counts to remove loop branches", OptimizationType::INITIAL),
+    OptimizationPass("PipelineLoopLoads", "pipeline-loads", pipelineLoopLoads,
+        "issues TMU and DMA loads for the next loop iteration during the current iteration to hide the memory latency",
+        OptimizationType::INITIAL),
+    OptimizationPass("LoopInvariantCodeMotion", "move-loop-invariants", moveLoopInvariantCode,
+        "moves calculations of values which are the same in all iterations of a loop out of the loop",
+        OptimizationType::INITIAL),
+    OptimizationPass("StrengthReduction", "strength-reduction", reduceStrengthInLoops,
+        "replaces calculations linear in the loop induction variables with running values incremented every iteration",
+        OptimizationType::INITIAL),
     /*
      * The second block executes optimizations only within a single basic block.
      * These optimizations may be executed in a loop until there are not more changes to the instructions
      */
     OptimizationPass("SingleSteps", "single-steps", runSingleSteps,
         "runs all the single-step optimizations. Combining them results in fewer iterations over the instructions",
-        OptimizationType::REPEAT),
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("CombineRotations", "combine-rotations", combineVectorRotations,
         "combines duplicate vector rotations, e.g. introduced by vector-shuffle into a single rotation",
-        OptimizationType::REPEAT),
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
+    OptimizationPass("VectorizeElementOperations", "vectorize-elements", vectorizeElementOperations,
+        "packs isomorphic scalar operations calculating the elements of a vector into a single vector operation",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("EliminateMoves", "eliminate-moves", eliminateRedundantMoves,
-        "Replaces moves with the operation producing their source", OptimizationType::REPEAT),
+        "Replaces moves with the operation producing their source",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     // executed after eliminate-moves to not have to rewrite simple moves with the more complex expression rewrite
     OptimizationPass("CommonSubexpressionElimination", "eliminate-common-subexpressions", eliminateCommonSubexpressions,
         "eliminates repetitive calculations of common expressions by re-using previous results (WIP, slow)",
-        OptimizationType::REPEAT),
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("EliminateBitOperations", "eliminate-bit-operations", eliminateRedundantBitOp,
-        "Rewrites redundant bit operations", OptimizationType::REPEAT),
+        "Rewrites redundant bit operations", OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
+    OptimizationPass("SimplifyExpressions", "simplify-expressions", simplifyExpressionTrees,
+        "simplifies integer calculations spanning several instructions, e.g. by reassociating constants or removing "
+        "redundant masks",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("PropagateMoves", "copy-propagation", propagateMoves,
-        "Replaces operands with their moved-from value", OptimizationType::REPEAT),
+        "Replaces operands with their moved-from value",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("RemoveFlags", "remove-unused-flags", removeUselessFlags,
-        "rewrites and removes all flags with constant conditions", OptimizationType::REPEAT),
+        "rewrites and removes all flags with constant conditions",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
+    OptimizationPass("RemoveRedundantFlags", "remove-redundant-flags", removeRedundantFlags,
+        "removes the setting of flags which are already set from the same calculation, also across basic blocks",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
+    OptimizationPass("BranchOnConditionFlags", "branch-on-flags", branchOnConditionFlags,
+        "replaces branches on boolean values materialized from lane-uniform flags with branches on these flags",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("EliminateDeadCode", "eliminate-dead-code", eliminateDeadCode,
-        "eliminates dead code (move to same, redundant arithmetic operations, ...)", OptimizationType::REPEAT),
+        "eliminates dead code (move to same, redundant arithmetic operations, ...)",
+        OptimizationType::REPEAT, analysis::CachedAnalysis::CONTROL_FLOW),
     /*
      * The third block of optimizations is executed once after all the other optimizations finished and
      * can therefore introduce instructions or constructs (e.g. combined instructions) not supported by
@@ -285,38 +655,74 @@ const std::vector<OptimizationPass> Optimizer::ALL_PASSES = {
      */
     // XXX not enabled with any optimization level for now. TODO also move before repeated optimizations?
     OptimizationPass("CompressWorkGroupInfo", "compress-work-group-info", compressWorkGroupLocals,
-        "compresses work-group info into single local", OptimizationType::FINAL),
+        "compresses work-group info into single local",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
+    OptimizationPass("CompressUniformLocals", "compress-uniform-locals", compressUniformLocals,
+        "compresses long-living uniform scalar locals into the elements of shared registers, if the method would "
+        "otherwise exceed the available registers",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("SplitReadAfterWrites", "split-read-write", splitReadAfterWrites,
         "splits read-after-writes (except if the local is used only very locally), so the reordering and "
         "register-allocation have an easier job",
-        OptimizationType::FINAL),
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("CombineConstantLoads", "combine-loads", combineLoadingConstants,
-        "combines loadings of the same constant value within a small range of a basic block", OptimizationType::FINAL),
+        "combines loadings of the same constant value within a small range of a basic block",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("RemoveConstantLoadInLoops", "extract-loads-from-loops", removeConstantLoadInLoops,
         "move constant loads in (nested) loops outside the loops", OptimizationType::FINAL),
     OptimizationPass("CacheAcrossWorkGroup", "work-group-cache", cacheWorkGroupDMAAccess,
         "finds memory access across the work-group which can be cached in VPM to combine the DMA operation (WIP)",
         OptimizationType::FINAL),
+    OptimizationPass("OptimizeMutexRegions", "optimize-mutex", optimizeMutexRegions,
+        "moves calculations out of critical sections and merges critical sections close to each other",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("InstructionScheduler", "schedule-instructions", reorderInstructions,
         "schedule instructions according to their dependencies within basic blocks (WIP, slow)",
-        OptimizationType::FINAL),
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("ReorderInstructions", "reorder", reorderWithinBasicBlocks,
-        "re-order instructions to eliminate more NOPs and stall cycles", OptimizationType::FINAL),
+        "re-order instructions to eliminate more NOPs and stall cycles",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
+    OptimizationPass("PairALUInstructions", "pair-alu", pairALUOperations,
+        "combines independent ALU-operations of a basic block into as many instructions using both ALUs as possible",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW),
     OptimizationPass("CombineALUIinstructions", "combine", combineOperations,
-        "run peep-hole optimization to combine ALU-operations", OptimizationType::FINAL)};
+        "run peep-hole optimization to combine ALU-operations",
+        OptimizationType::FINAL, analysis::CachedAnalysis::CONTROL_FLOW)};
 
 std::set<std::string> Optimizer::getPasses(OptimizationLevel level)
 {
     std::set<std::string> passes;
     switch(level)
     {
+    case OptimizationLevel::SIZE:
+        passes = getPasses(OptimizationLevel::MEDIUM);
+        // the work-group loop duplicates the kernel start-up and finishing code
+        passes.erase("loop-work-groups");
+        // only the full optimizations which do not increase the code size, i.e. no loop unrolling and vectorization,
+        // no pipelining and no caching of loads
+        passes.emplace("move-loop-invariants");
+        passes.emplace("if-conversion");
+        passes.emplace("schedule-instructions");
+        passes.emplace("pair-alu");
+        passes.emplace("eliminate-common-subexpressions");
+        passes.emplace("simplify-expressions");
+        passes.emplace("simplify-conditionals");
+        break;
     case OptimizationLevel::FULL:
         passes.emplace("vectorize-loops");
+        passes.emplace("unroll-loops");
+        passes.emplace("pipeline-loads");
+        passes.emplace("move-loop-invariants");
+        passes.emplace("strength-reduction");
+        passes.emplace("if-conversion");
+        passes.emplace("vectorize-elements");
         passes.emplace("extract-loads-from-loops");
         passes.emplace("schedule-instructions");
+        passes.emplace("pair-alu");
         passes.emplace("work-group-cache");
         // XXX move CSE to medium? Need to profile performance and re-check all emulation tests with CSE enabled
         passes.emplace("eliminate-common-subexpressions");
+        passes.emplace("simplify-expressions");
         // XXX if tested enough, move to full
         passes.emplace("simplify-conditionals");
         FALL_THROUGH
@@ -327,6 +733,10 @@ std::set<std::string> Optimizer::getPasses(OptimizationLevel level)
         passes.emplace("eliminate-bit-operations");
         passes.emplace("copy-propagation");
         passes.emplace("combine-loads");
+        passes.emplace("optimize-mutex");
+        passes.emplace("compress-uniform-locals");
+        passes.emplace("remove-redundant-flags");
+        passes.emplace("branch-on-flags");
         FALL_THROUGH
     case OptimizationLevel::BASIC:
         passes.emplace("reorder-blocks");
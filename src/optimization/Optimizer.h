@@ -7,8 +7,10 @@
 #ifndef OPTIMIZER_H
 #define OPTIMIZER_H
 
+#include "../analysis/AnalysisManager.h"
 #include "config.h"
 
+#include <chrono>
 #include <functional>
 #include <map>
 #include <set>
@@ -56,7 +58,8 @@ namespace vc4c
             using Pass = std::function<bool(const Module&, Method&, const Configuration&)>;
 
             OptimizationPass(const std::string& name, const std::string& parameterName, const Pass& pass,
-                const std::string& description, OptimizationType type);
+                const std::string& description, OptimizationType type,
+                analysis::CachedAnalysis preservedAnalyses = analysis::CachedAnalysis::NONE);
 
             bool operator()(const Module& module, Method& method, const Configuration& config) const;
 
@@ -64,11 +67,31 @@ namespace vc4c
             const std::string parameterName;
             const std::string description;
             const OptimizationType type;
+            /*
+             * The cached analysis results (see Method#getAnalyses()) which stay valid after running this pass
+             */
+            const analysis::CachedAnalysis preservedAnalyses;
 
         private:
             const Pass pass;
         };
 
+        /*
+         * The properties of the instructions an OptimizationStep is applicable to.
+         *
+         * Every instruction is classified once when walking the instructions and only the steps applicable to at least
+         * one of its properties are run for it.
+         */
+        enum class StepTarget : unsigned char
+        {
+            // the step is run for all instructions
+            ANY = 0,
+            MOVE = 1 << 0,
+            OPERATION = 1 << 1,
+            SETS_FLAGS = 1 << 2,
+            WRITES_SFU = 1 << 3
+        };
+
         /*
          * An OptimizationStep handles a single instruction per invocation
          */
@@ -83,17 +106,58 @@ namespace vc4c
             using Step =
                 std::function<InstructionWalker(const Module&, Method&, InstructionWalker, const Configuration&)>;
 
-            OptimizationStep(const std::string& name, const Step& step);
+            OptimizationStep(const std::string& name, const Step& step, StepTarget target = StepTarget::ANY);
 
             InstructionWalker operator()(
                 const Module& module, Method& method, InstructionWalker it, const Configuration& config) const;
 
+            /*
+             * Returns whether this step can modify an instruction with the given properties (see #classify(...))
+             */
+            bool isApplicableTo(StepTarget instructionProperties) const noexcept;
+
+            /*
+             * Determines the properties of the instruction the given walker points to
+             */
+            static StepTarget classify(InstructionWalker it);
+
             const std::string name;
+            const StepTarget target;
 
         private:
             const Step step;
         };
 
+        /*
+         * The statistics of running a single optimization pass on a single method
+         */
+        struct PassStatistics
+        {
+            // the number of times the pass was executed
+            unsigned numRuns = 0;
+            // the number of executions which modified the method
+            unsigned numChanges = 0;
+            // the number of times the pass was skipped, since the method was not modified since its last execution
+            unsigned numSkipped = 0;
+            // the number of times the pass was skipped, since the pass or kernel time budget was exceeded
+            unsigned numCutByBudget = 0;
+            // the accumulated wall-time of all executions
+            std::chrono::microseconds duration{0};
+        };
+
+        /*
+         * The statistics of running all enabled optimization passes on a single method
+         */
+        struct OptimizationStatistics
+        {
+            // the number of iterations run for the repeated passes
+            unsigned numIterations = 0;
+            // the statistics of the single passes, by pass name
+            std::map<std::string, PassStatistics> passes;
+            // whether any pass was skipped, since the pass or kernel time budget was exceeded
+            bool exceededTimeBudget = false;
+        };
+
         class Optimizer
         {
         public:
@@ -101,6 +165,15 @@ namespace vc4c
 
             void optimize(Module& module) const;
 
+            /*
+             * Runs all enabled optimization passes on the given method.
+             *
+             * Returns the per-pass statistics (number of executions, wall-time) for the method.
+             *
+             * NOTE: This can be run in parallel for different kernels of the same module
+             */
+            OptimizationStatistics optimizeMethod(const Module& module, Method& method) const;
+
             /*
              * The complete list of all optimization passes available to be used
              *
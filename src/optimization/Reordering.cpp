@@ -7,9 +7,13 @@
 #include "Reordering.h"
 
 #include "../Profiler.h"
+#include "../analysis/ControlFlowGraph.h"
+#include "../analysis/LivenessAnalysis.h"
 #include "../intermediate/Helper.h"
 #include "log.h"
 
+#include <algorithm>
+
 using namespace vc4c;
 using namespace vc4c::optimizations;
 using namespace vc4c::intermediate;
@@ -184,6 +188,9 @@ static NODISCARD InstructionWalker findReplacementCandidate(
     case DelayType::THREAD_END:
         // there are no more instructions after THREND
         return basicBlock.walkEnd();
+    case DelayType::THREAD_SWITCH:
+        // These type of NOPs do not yet exist (they are created after the optimizations)
+        return basicBlock.walkEnd();
     case DelayType::WAIT_VPM:
     case DelayType::WAIT_REGISTER:
     {
@@ -418,6 +425,166 @@ bool optimizations::reorderWithinBasicBlocks(const Module& module, Method& metho
     return hasChanged;
 }
 
+// The maximum number of instructions between two critical sections to still be merged into a single one
+static constexpr unsigned MAX_MERGED_MUTEX_GAP = 4;
+
+static bool isMutexAccess(InstructionWalker it, MutexAccess access)
+{
+    auto mutex = it.get<MutexLock>();
+    return mutex && (access == MutexAccess::LOCK ? mutex->locksMutex() : mutex->releasesMutex());
+}
+
+/*
+ * Checks whether the instruction only calculates a local from other locals or constants and therefore can be moved
+ * freely within the basic block (as long as the data dependencies are kept)
+ */
+static bool isMovableCalculation(const IntermediateInstruction& inst)
+{
+    if(!inst.checkOutputLocal() || inst.hasSideEffects() || inst.hasConditionalExecution() || inst.doesSetFlag() ||
+        inst.getSignal() != SIGNAL_NONE)
+        return false;
+    return std::all_of(inst.getArguments().begin(), inst.getArguments().end(),
+        [](const Value& arg) -> bool { return arg.checkLocal() || arg.getLiteralValue(); });
+}
+
+static bool accessesAnyLocal(const IntermediateInstruction& inst, const FastSet<const Local*>& locals)
+{
+    for(const auto& pair : inst.getUsedLocals())
+    {
+        if(locals.find(pair.first) != locals.end())
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Moves the calculations not depending on the VPM accesses in the critical section starting at the given mutex
+ * acquisition in front of it and the calculations no VPM access depends on behind the mutex release.
+ *
+ * Returns the mutex release or the end of the block, if the critical section spans several blocks.
+ */
+static InstructionWalker shrinkMutexRegion(InstructionWalker lockIt, std::size_t& numMoved)
+{
+    auto releaseIt = lockIt.copy().nextInBlock();
+    while(!releaseIt.isEndOfBlock() && !isMutexAccess(releaseIt, MutexAccess::RELEASE))
+        releaseIt.nextInBlock();
+    if(releaseIt.isEndOfBlock())
+        return releaseIt;
+
+    // locals written/read by the instructions staying inside of the critical section
+    FastSet<const Local*> writtenLocals;
+    FastSet<const Local*> readLocals;
+    auto it = lockIt.copy().nextInBlock();
+    while(it != releaseIt)
+    {
+        if(it.has() && isMovableCalculation(*it.get()) && !accessesAnyLocal(*it.get(), writtenLocals) &&
+            readLocals.find(it->checkOutputLocal()) == readLocals.end())
+        {
+            lockIt.emplace(it.release());
+            lockIt.nextInBlock();
+            it.erase();
+            ++numMoved;
+            continue;
+        }
+        if(it.has())
+        {
+            for(const auto& pair : it->getUsedLocals())
+            {
+                if(has_flag(pair.second, LocalUse::Type::WRITER))
+                    writtenLocals.emplace(pair.first);
+                if(has_flag(pair.second, LocalUse::Type::READER))
+                    readLocals.emplace(pair.first);
+            }
+        }
+        it.nextInBlock();
+    }
+
+    writtenLocals.clear();
+    readLocals.clear();
+    it = releaseIt.copy().previousInBlock();
+    while(it != lockIt)
+    {
+        if(it.has() && isMovableCalculation(*it.get()) && !accessesAnyLocal(*it.get(), writtenLocals) &&
+            readLocals.find(it->checkOutputLocal()) == readLocals.end())
+        {
+            // inserting directly behind the mutex release keeps the order of the moved instructions
+            auto insertIt = releaseIt.copy().nextInBlock();
+            insertIt.emplace(it.release());
+            ++numMoved;
+        }
+        else if(it.has())
+        {
+            for(const auto& pair : it->getUsedLocals())
+            {
+                if(has_flag(pair.second, LocalUse::Type::WRITER))
+                    writtenLocals.emplace(pair.first);
+                if(has_flag(pair.second, LocalUse::Type::READER))
+                    readLocals.emplace(pair.first);
+            }
+        }
+        it.previousInBlock();
+    }
+    return releaseIt;
+}
+
+/*
+ * Merges the critical section ending at the given mutex release with the directly following one, if they are only
+ * separated by a few instructions without any side-effects.
+ */
+static bool mergeMutexRegions(InstructionWalker releaseIt)
+{
+    unsigned numInstructions = 0;
+    auto it = releaseIt.copy().nextInBlock();
+    for(; !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(isMutexAccess(it, MutexAccess::LOCK))
+            break;
+        if(!isMovableCalculation(*it.get()) || ++numInstructions > MAX_MERGED_MUTEX_GAP)
+            return false;
+    }
+    if(it.isEndOfBlock())
+        return false;
+    releaseIt.reset(nullptr);
+    it.reset(nullptr);
+    return true;
+}
+
+bool optimizations::optimizeMutexRegions(const Module& module, Method& method, const Configuration& config)
+{
+    std::size_t numMoved = 0;
+    std::size_t numMerged = 0;
+    for(BasicBlock& block : method)
+    {
+        FastAccessList<InstructionWalker> releases;
+        for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(isMutexAccess(it, MutexAccess::LOCK))
+            {
+                it = shrinkMutexRegion(it, numMoved);
+                if(it.isEndOfBlock())
+                    break;
+                releases.emplace_back(it);
+            }
+        }
+        // merge only after all critical sections are shrunk, so the gaps contain the instructions moved out
+        for(const auto& releaseIt : releases)
+        {
+            if(mergeMutexRegions(releaseIt))
+                ++numMerged;
+        }
+    }
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Moved " << numMoved << " instructions out of critical sections and merged " << numMerged
+            << " critical sections" << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 345, "Instructions moved out of mutex", numMoved);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 346, "Mutex regions merged", numMerged);
+    method.cleanEmptyInstructions();
+    return numMoved > 0 || numMerged > 0;
+}
+
 InstructionWalker optimizations::moveRotationSourcesToAccumulators(
     const Module& module, Method& method, InstructionWalker it, const Configuration& config)
 {
@@ -478,3 +645,551 @@ InstructionWalker optimizations::moveRotationSourcesToAccumulators(
     }
     return it;
 }
+
+static constexpr unsigned NUM_BRANCH_DELAY_SLOTS = 3;
+
+static void collectRegisterAccesses(const IntermediateInstruction& inst,
+    const FastMap<const Local*, Register>& registerMapping, FastSet<Register>& reads, FastSet<Register>& writes)
+{
+    if(auto combined = dynamic_cast<const CombinedOperation*>(&inst))
+    {
+        if(combined->op1)
+            collectRegisterAccesses(*combined->op1, registerMapping, reads, writes);
+        if(combined->op2)
+            collectRegisterAccesses(*combined->op2, registerMapping, reads, writes);
+        return;
+    }
+    auto toRegister = [&](const Value& val) -> Optional<Register> {
+        if(auto reg = val.checkRegister())
+            return *reg;
+        if(auto loc = val.checkLocal())
+        {
+            auto it = registerMapping.find(loc);
+            if(it != registerMapping.end())
+                return it->second;
+        }
+        return {};
+    };
+    if(auto out = inst.getOutput())
+    {
+        if(auto reg = toRegister(*out))
+            writes.emplace(*reg);
+    }
+    for(const auto& arg : inst.getArguments())
+    {
+        if(auto reg = toRegister(arg))
+            reads.emplace(*reg);
+    }
+}
+
+/*
+ * Whether the instruction depends on the exact distance to the preceding instructions, e.g. to wait for the result of a
+ * periphery. Moving instructions away from in front of it might shorten the required delay.
+ */
+static bool isDistanceDependent(const IntermediateInstruction& inst)
+{
+    if(auto combined = dynamic_cast<const CombinedOperation*>(&inst))
+        return (combined->op1 && isDistanceDependent(*combined->op1)) ||
+            (combined->op2 && isDistanceDependent(*combined->op2));
+    if(auto nop = dynamic_cast<const Nop*>(&inst))
+        return nop->type != DelayType::WAIT_REGISTER;
+    if(inst.getSignal() != SIGNAL_NONE)
+        return true;
+    return std::any_of(inst.getArguments().begin(), inst.getArguments().end(), [](const Value& arg) -> bool {
+        return arg.checkRegister() && (arg.reg().hasSideEffectsOnRead() || arg.reg() == REG_SFU_OUT);
+    });
+}
+
+/*
+ * Whether the instruction can be moved into a branch delay slot, i.e. it has no side-effects, is executed
+ * unconditionally and only accesses literal values and locals mapped to general purpose registers or accumulators
+ */
+static bool isDelaySlotCandidate(
+    const IntermediateInstruction& inst, const FastMap<const Local*, Register>& registerMapping)
+{
+    if(!dynamic_cast<const Operation*>(&inst) && !dynamic_cast<const MoveOperation*>(&inst) &&
+        !dynamic_cast<const LoadImmediate*>(&inst))
+        return false;
+    if(dynamic_cast<const VectorRotation*>(&inst) || inst.hasSideEffects() || inst.hasConditionalExecution() ||
+        inst.hasPackMode() || inst.hasUnpackMode())
+        return false;
+    auto isMappedToFreeRegister = [&](const Value& val) -> bool {
+        auto loc = val.checkLocal();
+        if(!loc)
+            return false;
+        auto it = registerMapping.find(loc);
+        // r4 and r5 have special semantics which depend on the surrounding instructions
+        return it != registerMapping.end() &&
+            (it->second.isGeneralPurpose() ||
+                (it->second.isAccumulator() && it->second.getAccumulatorNumber() >= 0 &&
+                    it->second.getAccumulatorNumber() < 4));
+    };
+    if(!inst.getOutput() || !isMappedToFreeRegister(*inst.getOutput()))
+        return false;
+    return std::all_of(inst.getArguments().begin(), inst.getArguments().end(),
+        [&](const Value& arg) -> bool { return arg.getLiteralValue() || isMappedToFreeRegister(arg); });
+}
+
+/*
+ * Whether the two instructions cannot be reordered, since one accesses a register written by the other
+ */
+static bool hasRegisterDependency(const IntermediateInstruction& first, const IntermediateInstruction& second,
+    const FastMap<const Local*, Register>& registerMapping)
+{
+    FastSet<Register> firstReads;
+    FastSet<Register> firstWrites;
+    FastSet<Register> secondReads;
+    FastSet<Register> secondWrites;
+    collectRegisterAccesses(first, registerMapping, firstReads, firstWrites);
+    collectRegisterAccesses(second, registerMapping, secondReads, secondWrites);
+    auto intersects = [](const FastSet<Register>& a, const FastSet<Register>& b) -> bool {
+        return std::any_of(a.begin(), a.end(), [&](Register reg) -> bool { return b.find(reg) != b.end(); });
+    };
+    return intersects(firstReads, secondWrites) || intersects(firstWrites, secondReads) ||
+        intersects(firstWrites, secondWrites);
+}
+
+/*
+ * Whether the second instruction cannot directly follow the first one, since it reads a physical register (or the
+ * vector rotation source) written by the first instruction
+ */
+static bool hasReadAfterWriteHazard(const IntermediateInstruction* first, const IntermediateInstruction* second,
+    const FastMap<const Local*, Register>& registerMapping)
+{
+    if(!first || !second)
+        return false;
+    FastSet<Register> firstReads;
+    FastSet<Register> firstWrites;
+    FastSet<Register> secondReads;
+    FastSet<Register> secondWrites;
+    collectRegisterAccesses(*first, registerMapping, firstReads, firstWrites);
+    collectRegisterAccesses(*second, registerMapping, secondReads, secondWrites);
+    bool isRotation = dynamic_cast<const VectorRotation*>(second) != nullptr;
+    return std::any_of(firstWrites.begin(), firstWrites.end(), [&](Register reg) -> bool {
+        return secondReads.find(reg) != secondReads.end() && (!reg.isAccumulator() || isRotation);
+    });
+}
+
+static const IntermediateInstruction* findFirstInstruction(const BasicBlock* block)
+{
+    if(!block)
+        return nullptr;
+    for(auto it = block->begin(); it != block->end(); ++it)
+    {
+        if(*it && (*it)->mapsToASMInstruction())
+            return it->get();
+    }
+    return nullptr;
+}
+
+namespace
+{
+    struct DelaySlots
+    {
+        InstructionWalker branch;
+        // the branch delay nops following the branch
+        FastAccessList<InstructionWalker> slots;
+    };
+
+    /*
+     * The instructions to move into the delay slots of a basic block:
+     * - the preceding instructions are moved from in front of the first branch into its delay slots
+     * - the succeeding instructions are moved from the start of the basic block exclusively executed after the last
+     *   branch into the remaining delay slots of the last branch
+     */
+    struct DelaySlotFilling
+    {
+        FastAccessList<DelaySlots> branches;
+        FastAccessList<InstructionWalker> preceding;
+        FastAccessList<InstructionWalker> succeeding;
+        BasicBlock* successor = nullptr;
+
+        /*
+         * Returns the instructions executed in the delay slots of the given branch after the filling
+         */
+        FastAccessList<const IntermediateInstruction*> getSlotInstructions(std::size_t branchIndex) const
+        {
+            FastAccessList<const IntermediateInstruction*> result;
+            const auto& delays = branches[branchIndex];
+            bool isFirst = branchIndex == 0;
+            bool isLast = branchIndex == branches.size() - 1;
+            std::size_t numPreceding = isFirst ? preceding.size() : 0;
+            std::size_t numSucceeding = isLast ? succeeding.size() : 0;
+            for(std::size_t i = 0; i < delays.slots.size(); ++i)
+            {
+                if(i < numPreceding)
+                    result.push_back(preceding[i].get());
+                else if(i < numPreceding + numSucceeding)
+                    result.push_back(succeeding[i - numPreceding].get());
+                else
+                    result.push_back(delays.slots[i].get());
+            }
+            return result;
+        }
+    };
+} // namespace
+
+static FastAccessList<DelaySlots> findBranchDelaySlots(BasicBlock& block)
+{
+    FastAccessList<DelaySlots> result;
+    for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.get<Branch>())
+            continue;
+        DelaySlots delays{it, {}};
+        auto slotIt = it.copy().nextInBlock();
+        while(!slotIt.isEndOfBlock() && delays.slots.size() < NUM_BRANCH_DELAY_SLOTS)
+        {
+            auto nop = slotIt.get<Nop>();
+            if(!nop || nop->type != DelayType::BRANCH_DELAY || nop->hasSideEffects())
+                break;
+            delays.slots.push_back(slotIt);
+            slotIt.nextInBlock();
+        }
+        if(delays.slots.size() != NUM_BRANCH_DELAY_SLOTS)
+            // unexpected layout, e.g. the delay slots are already filled
+            return {};
+        result.push_back(delays);
+    }
+    return result;
+}
+
+/*
+ * Selects the instructions in front of the branch which can be moved behind the branch, since they neither access the
+ * flags nor any register accessed by the instructions staying in between them and the branch
+ */
+static FastAccessList<InstructionWalker> selectPrecedingInstructions(
+    InstructionWalker branchIt, const FastMap<const Local*, Register>& registerMapping)
+{
+    FastAccessList<InstructionWalker> selected;
+    FastAccessList<const IntermediateInstruction*> remaining;
+    auto it = branchIt.copy().previousInBlock();
+    for(; !it.isStartOfBlock() && selected.size() < NUM_BRANCH_DELAY_SLOTS; it.previousInBlock())
+    {
+        if(!it.has() || !it->mapsToASMInstruction())
+            continue;
+        if(isDistanceDependent(*it.get()))
+            break;
+        if(isDelaySlotCandidate(*it.get(), registerMapping) &&
+            std::none_of(remaining.begin(), remaining.end(), [&](const IntermediateInstruction* inst) -> bool {
+                return hasRegisterDependency(*it.get(), *inst, registerMapping);
+            }))
+            selected.push_back(it);
+        else
+            remaining.push_back(it.get());
+    }
+    std::reverse(selected.begin(), selected.end());
+    return selected;
+}
+
+/*
+ * Determines the basic block which is only executed after the last branch of the block and the registers which must
+ * not be written by any instruction moved from it into the delay slots, since they are live on the other path.
+ */
+static BasicBlock* findExclusiveSuccessor(Method& method, BasicBlock& block, const Branch& lastBranch,
+    const FastMap<const Local*, Register>& registerMapping, const analysis::GlobalLivenessAnalysis& liveness,
+    FastSet<Register>& blockedRegisters)
+{
+    auto& cfg = method.getCFG();
+    auto& node = cfg.assertNode(&block);
+    BasicBlock* successor = nullptr;
+    BasicBlock* otherPath = nullptr;
+    if(lastBranch.isUnconditional())
+        successor = method.findBasicBlock(lastBranch.getTarget());
+    else
+    {
+        // the delay slots are also executed if the branch is taken, so the moved instructions must not modify
+        // anything live at the branch target
+        successor = method.getNextBlockAfter(&block);
+        otherPath = method.findBasicBlock(lastBranch.getTarget());
+        if(!otherPath || otherPath == successor)
+            return nullptr;
+    }
+    if(!successor || successor == &block || cfg.assertNode(successor).getSinglePredecessor() != &node)
+        return nullptr;
+    if(otherPath)
+    {
+        for(auto loc : liveness.getIncomingLiveLocals(*otherPath))
+        {
+            auto it = registerMapping.find(loc);
+            if(it != registerMapping.end())
+                blockedRegisters.emplace(it->second);
+        }
+    }
+    return successor;
+}
+
+static FastAccessList<InstructionWalker> selectSucceedingInstructions(BasicBlock& successor, std::size_t numSlots,
+    const FastSet<Register>& blockedRegisters, const FastMap<const Local*, Register>& registerMapping)
+{
+    FastAccessList<InstructionWalker> selected;
+    for(auto it = successor.walk().nextInBlock(); !it.isEndOfBlock() && selected.size() < numSlots; it.nextInBlock())
+    {
+        if(!it.has() || !it->mapsToASMInstruction())
+            continue;
+        // only take a continuous prefix of the block to not reorder any instructions
+        if(!isDelaySlotCandidate(*it.get(), registerMapping) ||
+            blockedRegisters.find(registerMapping.at(it->getOutput()->local())) != blockedRegisters.end())
+            break;
+        selected.push_back(it);
+    }
+    return selected;
+}
+
+/*
+ * Checks whether the instructions which are directly executed after one another after the filling of the delay slots
+ * introduce any new read-after-write hazards
+ */
+static bool isValidFilling(const Method& method, BasicBlock& block, const DelaySlotFilling& filling,
+    const FastMap<const Local*, Register>& registerMapping)
+{
+    FastSet<const IntermediateInstruction*> moved;
+    for(const auto& it : filling.preceding)
+        moved.emplace(it.get());
+    for(const auto& it : filling.succeeding)
+        moved.emplace(it.get());
+
+    FastAccessList<const IntermediateInstruction*> oldSequence;
+    FastAccessList<const IntermediateInstruction*> newSequence;
+    FastMap<const IntermediateInstruction*, std::size_t> slotBranches;
+    for(std::size_t i = 0; i < filling.branches.size(); ++i)
+    {
+        for(const auto& slot : filling.branches[i].slots)
+            slotBranches.emplace(slot.get(), i);
+    }
+    FastMap<std::size_t, FastAccessList<const IntermediateInstruction*>> slotInstructions;
+    for(std::size_t i = 0; i < filling.branches.size(); ++i)
+        slotInstructions.emplace(i, filling.getSlotInstructions(i));
+
+    FastMap<std::size_t, std::size_t> slotIndices;
+    auto addBlockSequence = [&](const BasicBlock& bb) {
+        for(const auto& inst : bb)
+        {
+            if(!inst || !inst->mapsToASMInstruction())
+                continue;
+            oldSequence.push_back(inst.get());
+            auto slotIt = slotBranches.find(inst.get());
+            if(slotIt != slotBranches.end())
+                newSequence.push_back(slotInstructions.at(slotIt->second).at(slotIndices[slotIt->second]++));
+            else if(moved.find(inst.get()) == moved.end())
+                newSequence.push_back(inst.get());
+        }
+    };
+    addBlockSequence(block);
+    if(filling.successor)
+        addBlockSequence(*filling.successor);
+
+    // maps the instructions to their direct successors in the original order
+    FastMap<const IntermediateInstruction*, const IntermediateInstruction*> oldSuccessors;
+    for(std::size_t i = 1; i < oldSequence.size(); ++i)
+        oldSuccessors.emplace(oldSequence[i - 1], oldSequence[i]);
+    for(std::size_t i = 1; i < newSequence.size(); ++i)
+    {
+        auto oldIt = oldSuccessors.find(newSequence[i - 1]);
+        bool isNewPair = oldIt == oldSuccessors.end() || oldIt->second != newSequence[i];
+        if(isNewPair && hasReadAfterWriteHazard(newSequence[i - 1], newSequence[i], registerMapping))
+            return false;
+    }
+
+    // the last delay slot of a branch is also followed by the first instruction of the branch target (and the
+    // fall-through block for the last branch)
+    for(std::size_t i = 0; i < filling.branches.size(); ++i)
+    {
+        auto lastSlot = slotInstructions.at(i).back();
+        auto branch = filling.branches[i].branch.get<const Branch>();
+        FastAccessList<const BasicBlock*> followingBlocks{method.findBasicBlock(branch->getTarget())};
+        if(i == filling.branches.size() - 1 && !branch->isUnconditional())
+            followingBlocks.push_back(const_cast<Method&>(method).getNextBlockAfter(&block));
+        for(auto followingBlock : followingBlocks)
+        {
+            if(followingBlock == filling.successor)
+                // already checked above
+                continue;
+            if(!followingBlock && moved.find(lastSlot) != moved.end())
+                return false;
+            if(hasReadAfterWriteHazard(lastSlot, findFirstInstruction(followingBlock), registerMapping))
+                return false;
+        }
+    }
+    return true;
+}
+
+static std::size_t fillBranchDelaySlots(Method& method, BasicBlock& block,
+    const FastMap<const Local*, Register>& registerMapping, const analysis::GlobalLivenessAnalysis& liveness)
+{
+    DelaySlotFilling filling;
+    filling.branches = findBranchDelaySlots(block);
+    if(filling.branches.empty())
+        return 0;
+
+    filling.preceding = selectPrecedingInstructions(filling.branches.front().branch, registerMapping);
+
+    auto numPreceding = filling.branches.size() == 1 ? filling.preceding.size() : 0;
+    if(numPreceding < NUM_BRANCH_DELAY_SLOTS)
+    {
+        FastSet<Register> blockedRegisters;
+        filling.successor = findExclusiveSuccessor(method, block,
+            *filling.branches.back().branch.get<const Branch>(), registerMapping, liveness, blockedRegisters);
+        // the successor must not be the target of another branch, since its instructions would then be skipped
+        if(filling.successor &&
+            std::any_of(filling.branches.begin(), filling.branches.end() - 1, [&](const DelaySlots& delays) -> bool {
+                return method.findBasicBlock(delays.branch.get<const Branch>()->getTarget()) == filling.successor;
+            }))
+            filling.successor = nullptr;
+        if(filling.successor)
+            filling.succeeding = selectSucceedingInstructions(
+                *filling.successor, NUM_BRANCH_DELAY_SLOTS - numPreceding, blockedRegisters, registerMapping);
+        if(filling.succeeding.empty())
+            filling.successor = nullptr;
+    }
+
+    // reduce the number of moved instructions until we do not introduce any new hazards
+    while(!isValidFilling(method, block, filling, registerMapping))
+    {
+        if(!filling.succeeding.empty())
+            filling.succeeding.pop_back();
+        else if(!filling.preceding.empty())
+            filling.preceding.erase(filling.preceding.begin());
+        if(filling.succeeding.empty())
+            filling.successor = nullptr;
+        if(filling.preceding.empty() && filling.succeeding.empty())
+            return 0;
+    }
+
+    // replace the delay nops with the moved instructions
+    for(std::size_t i = 0; i < filling.branches.size(); ++i)
+    {
+        bool isFirst = i == 0;
+        bool isLast = i == filling.branches.size() - 1;
+        std::size_t numPreceding = isFirst ? filling.preceding.size() : 0;
+        std::size_t numSucceeding = isLast ? filling.succeeding.size() : 0;
+        auto& slots = filling.branches[i].slots;
+        for(std::size_t k = 0; k < slots.size() && k < numPreceding + numSucceeding; ++k)
+        {
+            auto& source = k < numPreceding ? filling.preceding[k] : filling.succeeding[k - numPreceding];
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Moving instruction into branch delay slot: " << source->to_string() << logging::endl);
+            slots[k].reset(source.release());
+            source.erase();
+        }
+    }
+    return filling.preceding.size() + filling.succeeding.size();
+}
+
+bool optimizations::fillBranchDelaySlots(Method& method, const FastMap<const Local*, Register>& registerMapping,
+    const analysis::GlobalLivenessAnalysis& liveness)
+{
+    std::size_t numMoved = 0;
+    for(auto& block : method)
+        numMoved += ::fillBranchDelaySlots(method, block, registerMapping, liveness);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 338, "Filled branch delay slots", numMoved);
+    return numMoved > 0;
+}
+
+static const IntermediateInstruction* findNextInstruction(InstructionWalker it)
+{
+    for(it.nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(it.has() && it->mapsToASMInstruction())
+            return it.get();
+    }
+    return nullptr;
+}
+
+static bool isThreadSwitch(const IntermediateInstruction& inst)
+{
+    auto nop = dynamic_cast<const Nop*>(&inst);
+    return inst.getSignal() == SIGNAL_SWITCH_THREAD || (nop && nop->type == DelayType::THREAD_SWITCH);
+}
+
+/*
+ * Finds an instruction following the nop which can be moved into its position, i.e. it does not depend on any of the
+ * instructions it is moved over and moving it does not introduce any new read-after-write hazards or shorten the
+ * distance of any following instruction depending on it.
+ */
+static InstructionWalker findDelayNopReplacement(InstructionWalker nopIt, const IntermediateInstruction* previous,
+    const FastMap<const Local*, Register>& registerMapping, unsigned searchDistance)
+{
+    FastAccessList<const IntermediateInstruction*> skipped;
+    auto it = nopIt.copy().nextInBlock();
+    for(; !it.isEndOfBlock() && skipped.size() < searchDistance; it.nextInBlock())
+    {
+        if(!it.has() || !it->mapsToASMInstruction())
+            continue;
+        if(it.get<Branch>() || it.get<BranchLabel>() || isThreadSwitch(*it.get()))
+            // never move anything over branches or thread switches
+            break;
+        auto candidate = it.get();
+        auto following = findNextInstruction(it);
+        if(!isDelaySlotCandidate(*candidate, registerMapping) || !following ||
+            std::any_of(skipped.begin(), skipped.end(), [&](const IntermediateInstruction* inst) -> bool {
+                return hasRegisterDependency(*candidate, *inst, registerMapping);
+            }))
+        {
+            skipped.push_back(candidate);
+            continue;
+        }
+        // the new direct neighbors of the candidate and of the instructions it is removed from between
+        auto successor = skipped.empty() ? following : skipped.front();
+        if(hasReadAfterWriteHazard(previous, candidate, registerMapping) ||
+            hasReadAfterWriteHazard(candidate, successor, registerMapping) ||
+            (!skipped.empty() && hasReadAfterWriteHazard(skipped.back(), following, registerMapping)))
+        {
+            skipped.push_back(candidate);
+            continue;
+        }
+        // the instructions following the candidate are moved up by one position and therefore closer to all
+        // instructions before the candidate
+        bool shortensDelay = false;
+        auto checkIt = it.copy().nextInBlock();
+        for(unsigned i = 0; !checkIt.isEndOfBlock() && i < NUM_BRANCH_DELAY_SLOTS && !shortensDelay;
+            checkIt.nextInBlock())
+        {
+            if(!checkIt.has() || !checkIt->mapsToASMInstruction())
+                continue;
+            shortensDelay = isDistanceDependent(*checkIt.get());
+            ++i;
+        }
+        if(!shortensDelay)
+            return it;
+        skipped.push_back(candidate);
+    }
+    return nopIt.getBasicBlock()->walkEnd();
+}
+
+bool optimizations::fillDelayNops(
+    Method& method, const FastMap<const Local*, Register>& registerMapping, unsigned searchDistance)
+{
+    std::size_t numFilled = 0;
+    for(auto& block : method)
+    {
+        const IntermediateInstruction* previous = nullptr;
+        for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has() || !it->mapsToASMInstruction())
+                continue;
+            auto nop = it.get<Nop>();
+            // the branch delay slots are handled by #fillBranchDelaySlots and nothing may be moved after the thread end
+            // or over a thread switch
+            if(nop && !nop->hasSideEffects() && nop->type != DelayType::BRANCH_DELAY &&
+                nop->type != DelayType::THREAD_END && nop->type != DelayType::THREAD_SWITCH)
+            {
+                auto replacementIt = findDelayNopReplacement(it, previous, registerMapping, searchDistance);
+                if(!replacementIt.isEndOfBlock())
+                {
+                    CPPLOG_LAZY(logging::Level::DEBUG,
+                        log << "Replacing delay NOP with: " << replacementIt->to_string() << logging::endl);
+                    auto isMandatoryDelay = has_flag(nop->decoration, InstructionDecorations::MANDATORY_DELAY);
+                    it.reset(replacementIt.release());
+                    replacementIt.erase();
+                    if(isMandatoryDelay)
+                        it->addDecorations(InstructionDecorations::MANDATORY_DELAY);
+                    ++numFilled;
+                }
+            }
+            previous = it.get();
+        }
+    }
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 347, "Filled delay nops", numFilled);
+    return numFilled > 0;
+}
@@ -7,12 +7,21 @@
 #ifndef REORDERING_H
 #define REORDERING_H
 
+#include "../performance.h"
+
 namespace vc4c
 {
     class Method;
     class Module;
     class InstructionWalker;
+    class Local;
     struct Configuration;
+    struct Register;
+
+    namespace analysis
+    {
+        class GlobalLivenessAnalysis;
+    } // namespace analysis
 
     namespace optimizations
     {
@@ -44,6 +53,41 @@ namespace vc4c
          */
         bool reorderWithinBasicBlocks(const Module& module, Method& method, const Configuration& config);
 
+        /*
+         * Reduces the time the hardware mutex is held (and therefore the time other QPUs are blocked from accessing
+         * the VPM) by moving calculations which do not access the VPM (e.g. the calculation of addresses and offsets)
+         * out of the critical sections and merging critical sections only separated by a few instructions, saving the
+         * releasing and re-acquiring of the mutex.
+         *
+         * Example:
+         *   mutex_acq
+         *   %offset = shl %index, 2
+         *   vpr_setup = add %setup, %offset
+         *   %a = vpm
+         *   %b = fadd %a, %c
+         *   mutex_rel
+         *   %d = add %e, 1
+         *   mutex_acq
+         *   vpw_setup = %setup2
+         *   vpm = %f
+         *   mutex_rel
+         *
+         * is converted to:
+         *   %offset = shl %index, 2
+         *   mutex_acq
+         *   vpr_setup = add %setup, %offset
+         *   %a = vpm
+         *   %b = fadd %a, %c
+         *   %d = add %e, 1
+         *   vpw_setup = %setup2
+         *   vpm = %f
+         *   mutex_rel
+         *
+         * NOTE: The accesses to per-QPU VPM areas still need to hold the mutex, since the VPM setup registers are
+         * shared.
+         */
+        bool optimizeMutexRegions(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Prevents register-mapping errors by guaranteeing the source of a vector-rotation to be mappable to an
          * accumulator. To do this, long-living used in a vector-rotation are moved to a temporary local which then can
@@ -51,6 +95,65 @@ namespace vc4c
          */
         InstructionWalker moveRotationSourcesToAccumulators(
             const Module& module, Method& method, InstructionWalker it, const Configuration& config);
+
+        /*
+         * Fills the delay slots of branches with instructions from in front of the branch or from the start of the
+         * basic block only executed after the branch, instead of executing nop-instructions.
+         *
+         * Instructions are moved from in front of the first branch of a basic block if they do not depend on any
+         * instruction staying between them and the branch. The remaining delay slots of the last branch are filled
+         * with the leading instructions of the successor block, if that block has no other predecessor. For
+         * conditional branches, this is only done for the fall-through block and the moved instructions must not
+         * write any register live at the start of the branch target, since the delay slots are executed on both
+         * paths.
+         *
+         * Since the delay slots are only inserted at the end of the normalization and the register fixups might insert
+         * instructions, this is run on the register-allocated code and checks the physical registers for conflicts.
+         *
+         * Example:
+         *   %a = add %b, %c
+         *   br %label
+         *   nop (branch delay)
+         *   nop (branch delay)
+         *   nop (branch delay)
+         *   label: %label
+         *   %d = mul24 %e, %f
+         *
+         * is converted to:
+         *   br %label
+         *   %a = add %b, %c
+         *   %d = mul24 %e, %f
+         *   nop (branch delay)
+         *   label: %label
+         */
+        bool fillBranchDelaySlots(Method& method, const FastMap<const Local*, Register>& registerMapping,
+            const analysis::GlobalLivenessAnalysis& liveness);
+
+        /*
+         * Replaces the remaining delay nops (e.g. waiting for a register to be written or for the result of the SFU
+         * or TMU) with independent instructions following them within the same basic block.
+         *
+         * In contrast to #reorderWithinBasicBlocks, this runs on the register-allocated code and therefore checks the
+         * exact dependencies between the physical registers, which allows moving instructions whose locals could not
+         * be moved before (e.g. since the register allocator could have mapped them to the same register). Only
+         * instructions without side-effects and only accessing general purpose registers or the accumulators r0 to r3
+         * are moved, so the reason for the delay is never violated.
+         *
+         * Example:
+         *   %a = add %b, %c
+         *   nop (wait register)
+         *   %d = sub %a, %e
+         *   %f = mul24 %g, %h
+         *
+         * is converted to:
+         *   %a = add %b, %c
+         *   %f = mul24 %g, %h
+         *   %d = sub %a, %e
+         *
+         * The maximum distance of the moved instructions is given by OptimizationOptions#replaceNopThreshold.
+         */
+        bool fillDelayNops(
+            Method& method, const FastMap<const Local*, Register>& registerMapping, unsigned searchDistance);
     } // namespace optimizations
 } // namespace vc4c
 
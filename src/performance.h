@@ -7,8 +7,11 @@
 #ifndef PERFORMANCE_H
 #define PERFORMANCE_H
 
+#include "tools/FlatHashTable.h"
+
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -43,13 +46,28 @@ namespace vc4c
     /*!
      * A set type where the elements are sorted according to their (natural or explicit) order
      */
-    template <typename T, typename C = std::less<T>>
-    using SortedSet = std::set<T, C>;
+    template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+    using SortedSet = std::set<T, C, A>;
     /*!
      * A set type which allows fast lookup and insertion of elements
+     *
+     * NOTE: If the FLAT_CONTAINERS build option is enabled, this is an open-addressing hash set which does not
+     * guarantee the references to the elements to stay valid on insertion (unless enough space is reserved
+     * beforehand), use StableSet if the references need to stay valid!
      */
+#ifdef FLAT_CONTAINERS
+    template <typename T, typename H = std::hash<T>>
+    using FastSet = tools::FlatHashSet<T, H>;
+#else
     template <typename T, typename H = std::hash<T>>
     using FastSet = std::unordered_set<T, H>;
+#endif
+    /*!
+     * A set type which allows fast lookup and insertion of elements, where the references (and pointers) to the
+     * elements stay valid on insertion of other elements
+     */
+    template <typename T, typename H = std::hash<T>>
+    using StableSet = std::unordered_set<T, H>;
 
     /*!
      * A map type where the entries are sorted according to the (natural or explicit) order of the keys
@@ -58,9 +76,24 @@ namespace vc4c
     using SortedMap = std::map<K, V, C>;
     /*!
      * A map type providing fast lookup and insertion of elements
+     *
+     * NOTE: If the FLAT_CONTAINERS build option is enabled, this is an open-addressing hash map which does not
+     * guarantee the references to the entries to stay valid on insertion (unless enough space is reserved
+     * beforehand), use StableMap if the references need to stay valid!
      */
+#ifdef FLAT_CONTAINERS
+    template <typename K, typename V, typename H = std::hash<K>>
+    using FastMap = tools::FlatHashMap<K, V, H>;
+#else
     template <typename K, typename V, typename H = std::hash<K>>
     using FastMap = std::unordered_map<K, V, H>;
+#endif
+    /*!
+     * A map type providing fast lookup and insertion of elements, where the references (and pointers) to the entries
+     * stay valid on insertion of other entries
+     */
+    template <typename K, typename V, typename H = std::hash<K>>
+    using StableMap = std::unordered_map<K, V, H>;
 } // namespace vc4c
 
 #endif /* PERFORMANCE_H */
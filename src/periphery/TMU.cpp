@@ -8,6 +8,7 @@
 
 #include "../GlobalValues.h"
 #include "../InstructionWalker.h"
+#include "../analysis/AlignmentAnalysis.h"
 #include "../intermediate/VectorHelper.h"
 #include "../intermediate/operators.h"
 #include "log.h"
@@ -21,6 +22,21 @@ const TMU periphery::TMU0{REG_TMU0_COORD_S_U_X, REG_TMU0_COORD_T_V_Y, REG_TMU0_C
 const TMU periphery::TMU1{REG_TMU1_COORD_S_U_X, REG_TMU1_COORD_T_V_Y, REG_TMU1_COORD_R_BORDER_COLOR,
     REG_TMU1_COORD_B_LOD_BIAS, SIGNAL_LOAD_TMU1};
 
+const TMU& periphery::selectTMU(InstructionWalker it)
+{
+    while(!it.isStartOfBlock())
+    {
+        it.previousInBlock();
+        if(!it.has())
+            continue;
+        if(it->writesRegister(REG_TMU0_ADDRESS))
+            return TMU1;
+        if(it->writesRegister(REG_TMU1_ADDRESS))
+            return TMU0;
+    }
+    return TMU0;
+}
+
 static NODISCARD InstructionWalker insertCalculateAddressOffsets(
     Method& method, InstructionWalker it, const Value& baseAddress, DataType type, Value& outputAddress)
 {
@@ -137,6 +153,32 @@ static NODISCARD InstructionWalker insertExtractByteElements(
     return it;
 }
 
+/*
+ * If the offset of the element addresses to the 32-bit word is known at compile-time (e.g. for aligned accesses), the
+ * position of the elements within the loaded words is known too and we can skip calculating it at run-time.
+ */
+static NODISCARD InstructionWalker insertExtractElementsWithKnownOffset(
+    InstructionWalker it, const Value& dest, const Value& src, uint32_t byteOffset)
+{
+    auto elementBits = dest.type.getScalarBitCount() <= 8 ? 8u : 16u;
+    auto shiftOffset = byteOffset * 8u;
+    Value mask(
+        Literal(elementBits == 8 ? TYPE_INT8.getScalarWidthMask() : TYPE_INT16.getScalarWidthMask()), TYPE_INT32);
+    if(shiftOffset == 0)
+        // dest = src & 0xFF/0xFFFF
+        assign(it, dest) = src & mask;
+    else if(shiftOffset + elementBits == 32)
+        // dest = src >> 24/16, the upper bits are already zero
+        assign(it, dest) = as_unsigned{src} >> Value(Literal(shiftOffset), TYPE_INT32);
+    else
+    {
+        // dest = (src >> (8 * offset)) & 0xFF
+        Value tmp = assign(it, dest.type, "%tmu_result") = as_unsigned{src} >> Value(Literal(shiftOffset), TYPE_INT32);
+        assign(it, dest) = tmp & mask;
+    }
+    return it;
+}
+
 /*
  * For 64-bit read, do the following:
  * - read 2*N (where N is vector-size) 32-bit elements, if possible (e.g. N <= 8) in one go
@@ -166,39 +208,40 @@ static NODISCARD InstructionWalker insertReadLongVectorFromTMU(
     Value upperAddresses(UNDEFINED_VALUE);
     it = insertCalculateAddressOffsets(method, it, tmpAddress, dest.type, upperAddresses);
 
+    // issue both loads (to different TMUs) before reading the first result, so they are executed in parallel
+    const TMU& otherTMU = tmu.signal == TMU0.signal ? TMU1 : TMU0;
     assign(it, tmu.getAddress(addr.type)) = lowerAddresses;
-    nop(it, intermediate::DelayType::WAIT_TMU, tmu.signal);
-    // TODO do we get more performance when first writing both addresses and then triggering both loads?
-    assign(it, tmu.getAddress(addr.type)) = upperAddresses;
-    nop(it, intermediate::DelayType::WAIT_TMU, tmu.signal);
+    assign(it, otherTMU.getAddress(addr.type)) = upperAddresses;
 
     // read the lower and upper elements into the result variables
+    nop(it, intermediate::DelayType::WAIT_TMU, tmu.signal);
     assign(it, outputData->lower->createReference()) = TMU_READ_REGISTER;
+    nop(it, intermediate::DelayType::WAIT_TMU, otherTMU.signal);
     assign(it, outputData->upper->createReference()) = TMU_READ_REGISTER;
 
     return it;
 }
 
-InstructionWalker periphery::insertReadVectorFromTMU(
-    Method& method, InstructionWalker it, const Value& dest, const Value& addr, const TMU& tmu)
+/*
+ * Loads the elements from the given (per-element) addresses and extracts the values for types smaller than 32-bit
+ */
+static NODISCARD InstructionWalker insertLoadFromTMU(Method& method, InstructionWalker it, const Value& dest,
+    const Value& addresses, const TMU& tmu, const analysis::KnownAlignment& alignment)
 {
-    if(!dest.type.isSimpleType() && !dest.type.getPointerType())
-        throw CompilationError(
-            CompilationStep::GENERAL, "Reading of this type via TMU is not (yet) implemented", dest.type.to_string());
-
-    if(dest.type.getScalarBitCount() == 64)
-        return insertReadLongVectorFromTMU(method, it, dest, addr, tmu);
-
-    Value addresses(UNDEFINED_VALUE);
-    it = insertCalculateAddressOffsets(method, it, addr, dest.type, addresses);
-
     //"General-memory lookups are performed by writing to just the s-parameter, using the absolute memory address" (page
     // 41)  1) write address to TMU_S register
-    assign(it, tmu.getAddress(addr.type)) = addresses;
+    assign(it, tmu.getAddress(addresses.type)) = addresses;
     // 2) trigger loading of TMU
     nop(it, intermediate::DelayType::WAIT_TMU, tmu.signal);
     // 3) read value from R4
     // FIXME in both cases, result values are unsigned (as in zero-, not sign-extended)!! (Same behavior as for VPM?!)
+    uint32_t byteOffset = 0;
+    if(dest.type.getScalarBitCount() <= 16 && alignment.getOffsetTo(4, byteOffset) &&
+        byteOffset % (dest.type.getScalarBitCount() <= 8 ? 1u : 2u) == 0)
+    {
+        Value tmp = assign(it, TYPE_INT32.toVectorType(dest.type.getVectorWidth()), "%tmu_result") = TMU_READ_REGISTER;
+        return insertExtractElementsWithKnownOffset(it, dest, tmp, byteOffset);
+    }
     if(dest.type.getScalarBitCount() <= 8)
     {
         Value tmp = assign(it, TYPE_INT32.toVectorType(dest.type.getVectorWidth()), "%tmu_result") = TMU_READ_REGISTER;
@@ -217,6 +260,34 @@ InstructionWalker periphery::insertReadVectorFromTMU(
     return it;
 }
 
+InstructionWalker periphery::insertReadVectorFromTMU(
+    Method& method, InstructionWalker it, const Value& dest, const Value& addr, const TMU& tmu)
+{
+    if(!dest.type.isSimpleType() && !dest.type.getPointerType())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Reading of this type via TMU is not (yet) implemented", dest.type.to_string());
+
+    if(dest.type.getScalarBitCount() == 64)
+        return insertReadLongVectorFromTMU(method, it, dest, addr, tmu);
+
+    // for scalar accesses, the alignment of the only used element address is the alignment of the base address
+    auto alignment =
+        dest.type.getVectorWidth() == 1 ? analysis::KnownAlignment::getAlignment(addr) : analysis::KnownAlignment{};
+    Value addresses(UNDEFINED_VALUE);
+    it = insertCalculateAddressOffsets(method, it, addr, dest.type, addresses);
+    return insertLoadFromTMU(method, it, dest, addresses, tmu, alignment);
+}
+
+InstructionWalker periphery::insertGatherFromTMU(
+    Method& method, InstructionWalker it, const Value& dest, const Value& addresses, const TMU& tmu)
+{
+    if(!dest.type.isSimpleType() || dest.type.getScalarBitCount() > 32 ||
+        dest.type.getVectorWidth() != addresses.type.getVectorWidth())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Gathering of this type via TMU is not supported", dest.type.to_string());
+    return insertLoadFromTMU(method, it, dest, addresses, tmu, analysis::KnownAlignment::getAlignment(addresses));
+}
+
 InstructionWalker periphery::insertReadTMU(Method& method, InstructionWalker it, const Value& image, const Value& dest,
     const Value& xCoord, const Optional<Value>& yCoord, const TMU& tmu)
 {
@@ -52,6 +52,14 @@ namespace vc4c
          * by element X, write 0 per element to disable.
          */
 
+        /*
+         * Returns the TMU to use for a load inserted at the given position.
+         *
+         * Alternates between both TMUs for the loads within a basic block, so twice as many requests can be queued
+         * before the first result needs to be read.
+         */
+        const TMU& selectTMU(InstructionWalker it);
+
         /*
          * Perform a general memory lookup via the TMU.
          *
@@ -61,6 +69,15 @@ namespace vc4c
         NODISCARD InstructionWalker insertReadVectorFromTMU(
             Method& method, InstructionWalker it, const Value& dest, const Value& addr, const TMU& tmu = TMU0);
 
+        /*
+         * Performs a per-element memory lookup (gather) via the TMU.
+         *
+         * Every SIMD element of dest is loaded from the address given by the same element of addresses. Elements of
+         * types smaller than 32-bit are extracted from the loaded words according to the alignment of their addresses.
+         */
+        NODISCARD InstructionWalker insertGatherFromTMU(
+            Method& method, InstructionWalker it, const Value& dest, const Value& addresses, const TMU& tmu = TMU0);
+
         /*
          * Inserts a read via TMU from the given image-parameter at the coordinates x, y (y optional), which need to be
          * converted to [0, 1] prior to this call and stores the result in dest.
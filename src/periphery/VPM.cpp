@@ -7,11 +7,13 @@
 #include "VPM.h"
 
 #include "../Profiler.h"
+#include "../analysis/AlignmentAnalysis.h"
 #include "../intermediate/Helper.h"
 #include "../intermediate/VectorHelper.h"
 #include "../intermediate/operators.h"
 #include "log.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 
@@ -403,13 +405,18 @@ static NODISCARD InstructionWalker calculateElementOffsetInVPM(
  * - if "original" type is vector (of size N) and offset is multiple of that vector size, every entry is the first N
  * elements of its own 16-element vector, so just calculate the offset of the whole entry (fast case, simple divide
  * offset by element size)
+ * - if the offset is known to be a multiple of the vector size (see KnownAlignment), this is the same fast case
  * - otherwise (e.g. offset unknown), we need to assume "unaligned" (not a multiple of the element size) access, so need
  * to access multiple elements and rotate/combine the results
  */
 static bool isUnalignedMemoryVPMAccess(const Value& offset, DataType elementType)
 {
-    return elementType.getVectorWidth() > 1 &&
-        (!offset.getLiteralValue() || (offset.getLiteralValue()->unsignedInt() % elementType.getInMemoryWidth()) != 0);
+    if(elementType.getVectorWidth() == 1)
+        return false;
+    if(auto lit = offset.getLiteralValue())
+        return (lit->unsignedInt() % elementType.getInMemoryWidth()) != 0;
+    // e.g. for offsets calculated as multiple of the vector size from the work-item ID
+    return !analysis::KnownAlignment::getAlignment(offset).isAlignedTo(elementType.getInMemoryWidth());
 }
 
 InstructionWalker VPM::insertReadVPM(Method& method, InstructionWalker it, const Value& dest, const VPMArea* area,
@@ -802,10 +809,58 @@ InstructionWalker VPM::insertWriteRAM(Method& method, InstructionWalker it, cons
     return it;
 }
 
+/*
+ * Calculates the address with the given constant byte offset to the base address, keeping the reference to the
+ * accessed memory object
+ */
+static Value insertAddressOffset(
+    InstructionWalker& it, const Value& baseAddress, unsigned byteOffset, std::string&& name)
+{
+    if(byteOffset == 0)
+        return baseAddress;
+    Value address = assign(it, baseAddress.type, std::move(name)) =
+        baseAddress + Value(Literal(byteOffset), TYPE_INT32);
+    if(auto data = Local::getLocalData<ReferenceData>(baseAddress.checkLocal()))
+        address.local()->set(ReferenceData(*data->base, ANY_ELEMENT));
+    return address;
+}
+
 InstructionWalker VPM::insertCopyRAM(Method& method, InstructionWalker it, const Value& destAddress,
     const Value& srcAddress, const unsigned numBytes, const VPMArea* area, bool useMutex)
 {
     const auto size = getBestVectorSize(numBytes);
+    const unsigned rowSize = VPM_NUM_COLUMNS * VPM_WORD_WIDTH;
+    if(area == nullptr && size.first.getScalarBitCount() == 32 && numBytes >= 2 * rowSize)
+    {
+        // Copy whole rows of 32-bit words with a single DMA read and write per as many rows as can be read at once.
+        // Since the DMA needs to finish an access before starting the next one, this saves waiting for a DMA access
+        // per copied row.
+        const auto rowType = TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE);
+        const unsigned numRows = numBytes / rowSize;
+        const unsigned maxRows = std::max(1u, std::min(getMaxCacheVectors(TYPE_INT32, false), numRows));
+        updateScratchSize(static_cast<unsigned char>(maxRows));
+
+        it = insertLockMutex(it, useMutex);
+        for(unsigned row = 0; row < numRows; row += maxRows)
+        {
+            const unsigned chunkRows = std::min(maxRows, numRows - row);
+            const Value numEntries = chunkRows == 1 ? INT_ONE : Value(Literal(chunkRows), TYPE_INT8);
+            auto tmpSource = insertAddressOffset(it, srcAddress, row * rowSize, "%mem_copy_addr");
+            auto tmpDest = insertAddressOffset(it, destAddress, row * rowSize, "%mem_copy_addr");
+            it = insertReadRAM(method, it, tmpSource, rowType, nullptr, false, INT_ZERO, numEntries);
+            it = insertWriteRAM(method, it, tmpDest, rowType, nullptr, false, INT_ZERO, numEntries);
+        }
+        if(auto remainder = numBytes % rowSize)
+        {
+            // copy the remaining (less than a row of) 32-bit words
+            auto tmpSource = insertAddressOffset(it, srcAddress, numRows * rowSize, "%mem_copy_addr");
+            auto tmpDest = insertAddressOffset(it, destAddress, numRows * rowSize, "%mem_copy_addr");
+            it = insertCopyRAM(method, it, tmpDest, tmpSource, remainder, nullptr, false);
+        }
+        it = insertUnlockMutex(it, useMutex);
+        return it;
+    }
+
     if(area != nullptr)
         area->checkAreaSize(size.first.getLogicalWidth());
     else
@@ -813,22 +868,14 @@ InstructionWalker VPM::insertCopyRAM(Method& method, InstructionWalker it, const
 
     it = insertLockMutex(it, useMutex);
 
-    // TODO use insertReadRAM/insertWriteRAM with multiple entries??
     it = insertReadRAM(method, it, srcAddress, size.first, area, false);
     it = insertWriteRAM(method, it, destAddress, size.first, area, false);
 
     for(unsigned i = 1; i < size.second; ++i)
     {
         // increment offset from base address
-        Value tmpSource = assign(it, srcAddress.type, "%mem_copy_addr") =
-            srcAddress + Value(Literal(i * size.first.getInMemoryWidth()), TYPE_INT8);
-        Value tmpDest = assign(it, destAddress.type, "%mem_copy_addr") =
-            destAddress + Value(Literal(i * size.first.getInMemoryWidth()), TYPE_INT8);
-
-        if(auto data = Local::getLocalData<ReferenceData>(srcAddress.checkLocal()))
-            tmpSource.local()->set(ReferenceData(*data->base, ANY_ELEMENT));
-        if(auto data = Local::getLocalData<ReferenceData>(destAddress.checkLocal()))
-            tmpDest.local()->set(ReferenceData(*data->base, ANY_ELEMENT));
+        auto tmpSource = insertAddressOffset(it, srcAddress, i * size.first.getInMemoryWidth(), "%mem_copy_addr");
+        auto tmpDest = insertAddressOffset(it, destAddress, i * size.first.getInMemoryWidth(), "%mem_copy_addr");
 
         it = insertReadRAM(method, it, tmpSource, size.first, area, false);
         it = insertWriteRAM(method, it, tmpDest, size.first, area, false);
@@ -921,6 +968,45 @@ InstructionWalker VPM::insertFillRAM(Method& method, InstructionWalker it, const
     return it;
 }
 
+InstructionWalker VPM::insertFillRAM(Method& method, InstructionWalker it, const Value& memoryAddress,
+    const Value& fillVector, const unsigned numBytes, bool useMutex)
+{
+    if(numBytes == 0)
+        return it;
+
+    const unsigned rowSize = VPM_NUM_COLUMNS * VPM_WORD_WIDTH;
+    const unsigned numRows = numBytes / rowSize;
+    // Replicate the fill vector into multiple VPM rows (limited to not occupy too much of the VPM), so whole rows can
+    // be written to RAM with a single DMA access per as many rows.
+    const unsigned maxRows = std::max(1u, std::min({getMaxCacheVectors(TYPE_INT32, true), numRows, 16u}));
+    updateScratchSize(static_cast<unsigned char>(maxRows));
+
+    it = insertLockMutex(it, useMutex);
+    it = insertWriteVPM(method, it, fillVector, nullptr, false);
+    // the VPM write setup is incremented by one row per write
+    for(unsigned row = 1; row < maxRows; ++row)
+        assign(it, VPM_IO_REGISTER) = fillVector;
+
+    const auto rowType = TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE);
+    for(unsigned row = 0; row < numRows; row += maxRows)
+    {
+        const unsigned chunkRows = std::min(maxRows, numRows - row);
+        const Value numEntries = chunkRows == 1 ? INT_ONE : Value(Literal(chunkRows), TYPE_INT8);
+        auto tmpDest = insertAddressOffset(it, memoryAddress, row * rowSize, "%mem_fill_addr");
+        it = insertWriteRAM(method, it, tmpDest, rowType, nullptr, false, INT_ZERO, numEntries);
+    }
+    if(auto remainder = numBytes % rowSize)
+    {
+        // fill the remaining (less than a row of) bytes from the first row
+        const auto size = getBestVectorSize(remainder);
+        auto tmpDest = insertAddressOffset(it, memoryAddress, numRows * rowSize, "%mem_fill_addr");
+        it = insertFillRAM(method, it, tmpDest, size.first, size.second, nullptr, false);
+    }
+    it = insertUnlockMutex(it, useMutex);
+
+    return it;
+}
+
 InstructionWalker VPM::insertFillRAMDynamic(Method& method, InstructionWalker it, const Value& memoryAddress,
     DataType type, const Value& numCopies, const VPMArea* area, bool useMutex)
 {
@@ -951,6 +1037,24 @@ InstructionWalker VPM::insertFillRAMDynamic(Method& method, InstructionWalker it
     return it;
 }
 
+bool VPMAreaLifetime::overlaps(const VPMAreaLifetime& other) const
+{
+    if(numPhases != other.numPhases)
+        return true;
+    const auto& first = firstPhase <= other.firstPhase ? *this : other;
+    const auto& second = firstPhase <= other.firstPhase ? other : *this;
+    if(first.lastPhase >= second.firstPhase)
+        // no barrier between the last access of the first and the first access of the second area
+        return true;
+    // the next work-group might start accessing the first area while the previous is still accessing the second one
+    return (second.lastPhase + 1) >= numPhases && first.firstPhase == 0;
+}
+
+static bool hasDisjointLifetimes(const Optional<VPMAreaLifetime>& first, const Optional<VPMAreaLifetime>& second)
+{
+    return first && second && !first->overlaps(*second);
+}
+
 void VPMArea::checkAreaSize(const unsigned requestedSize) const
 {
     if(requestedSize > (numRows * VPM_NUM_COLUMNS * VPM_WORD_WIDTH)) // TODO rewrite packed/not packed!
@@ -965,7 +1069,8 @@ bool VPMArea::operator<(const VPMArea& other) const
 
 bool VPMArea::requiresSpacePerQPU() const
 {
-    return usageType == VPMUsage::REGISTER_SPILLING || usageType == VPMUsage::STACK;
+    return usageType == VPMUsage::REGISTER_SPILLING || usageType == VPMUsage::STACK ||
+        usageType == VPMUsage::DMA_BUFFER;
 }
 
 DataType VPMArea::getElementType() const
@@ -984,6 +1089,9 @@ DataType VPMArea::getElementType() const
     case VPMUsage::STACK:
         // is not known
         return TYPE_UNKNOWN;
+    case VPMUsage::DMA_BUFFER:
+        // a whole row of 32-bit words is buffered per QPU
+        return TYPE_INT32.toVectorType(16);
     }
     return TYPE_UNKNOWN;
 }
@@ -1180,6 +1288,8 @@ static std::string toUsageString(VPMUsage usage, const Local* local)
         return "scratch area";
     case VPMUsage::STACK:
         return "stack" + (local ? " " + local->to_string() : "");
+    case VPMUsage::DMA_BUFFER:
+        return "DMA buffer" + (local ? " for " + local->to_string() : "");
     }
     throw CompilationError(
         CompilationStep::GENERAL, "Unhandled VPM usage type", std::to_string(static_cast<unsigned>(usage)));
@@ -1209,10 +1319,26 @@ const VPMArea* VPM::findArea(const Local* local)
     for(const auto& area : areas)
         if(area && area->originalAddress == local)
             return area.get();
+    for(const auto& area : sharingAreas)
+        if(area->originalAddress == local)
+            return area.get();
     return nullptr;
 }
 
-const VPMArea* VPM::addArea(const Local* local, DataType elementType, bool isStackArea, unsigned numStacks)
+bool VPM::isRowAvailable(unsigned row, const Optional<VPMAreaLifetime>& lifetime) const
+{
+    if(!areas[row])
+        return true;
+    // only areas lowered from local memory are accessed at known positions and therefore can share rows
+    auto canShareRow = [&](const std::shared_ptr<VPMArea>& other) -> bool {
+        return row < other->rowOffset || row >= (other->rowOffset + other->numRows) ||
+            (other->usageType == VPMUsage::LOCAL_MEMORY && hasDisjointLifetimes(lifetime, other->lifetime));
+    };
+    return canShareRow(areas[row]) && std::all_of(sharingAreas.begin(), sharingAreas.end(), canShareRow);
+}
+
+const VPMArea* VPM::addArea(const Local* local, DataType elementType, bool isStackArea, unsigned numStacks,
+    const Optional<VPMAreaLifetime>& lifetime)
 {
     // Since we can only read/write in packages of 16-element vectors on the QPU-side, we need to reserve enough space
     // for 16-element vectors (even if we do not use all of the elements)
@@ -1228,13 +1354,82 @@ const VPMArea* VPM::addArea(const Local* local, DataType elementType, bool isSta
     if(area != nullptr && area->numRows >= numRows)
         return area;
 
+    auto rowOffset = findFreeRows(numRows, isStackArea ? Optional<VPMAreaLifetime>{} : lifetime);
+    if(!rowOffset)
+        // no more (big enough) free space on VPM
+        return nullptr;
+
+    // for now align all new VPM areas at the beginning of a row
+    auto ptr = std::make_shared<VPMArea>(isStackArea ? VPMUsage::STACK : VPMUsage::LOCAL_MEMORY,
+        static_cast<uint8_t>(rowOffset.value()), numRows, local, lifetime);
+    bool sharesRows = false;
+    for(auto i = rowOffset.value(); i < (rowOffset.value() + numRows); ++i)
+    {
+        if(areas[i])
+            sharesRows = true;
+        else
+            areas[i] = ptr;
+    }
+    if(sharesRows)
+        sharingAreas.emplace_back(ptr);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Allocating " << numRows << " rows (per 64 byte) of VPM cache starting at row " << rowOffset.value()
+            << " for local: " << local->to_string(false)
+            << (isStackArea ? std::string(" (") + std::to_string(numStacks) + " stacks)" : "")
+            << (sharesRows ? " (sharing rows with areas of disjoint life-times)" : "") << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 90, "VPM cache size", requestedSize);
+    return ptr.get();
+}
+
+const VPMArea* VPM::addPerQPUArea(const Local* local, VPMUsage usage)
+{
+    const VPMArea* area = findArea(local);
+    if(area != nullptr && area->usageType == usage)
+        return area;
+
+    // every QPU accesses a whole row (16 32-bit elements) of its own
+    const auto numRows = static_cast<uint8_t>(NUM_QPUS);
+    auto rowOffset = findFreeRows(numRows, {});
+    if(!rowOffset)
+        return nullptr;
+
+    auto ptr = std::make_shared<VPMArea>(usage, static_cast<uint8_t>(rowOffset.value()), numRows, local);
+    for(auto i = rowOffset.value(); i < (rowOffset.value() + numRows); ++i)
+        areas[i] = ptr;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Allocating " << static_cast<unsigned>(numRows) << " rows (per 64 byte) of VPM starting at row "
+            << rowOffset.value() << " for: " << ptr->to_string() << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 91, "VPM per-QPU area size",
+        static_cast<unsigned>(numRows) * VPM_NUM_COLUMNS * VPM_WORD_WIDTH);
+    return ptr.get();
+}
+
+std::size_t VPM::countAreas(VPMUsage usage) const
+{
+    // an area is listed once for every row it reserves
+    FastSet<const VPMArea*> matchingAreas;
+    for(const auto& area : areas)
+    {
+        if(area && area->usageType == usage)
+            matchingAreas.emplace(area.get());
+    }
+    for(const auto& area : sharingAreas)
+    {
+        if(area && area->usageType == usage)
+            matchingAreas.emplace(area.get());
+    }
+    return matchingAreas.size();
+}
+
+Optional<unsigned> VPM::findFreeRows(uint8_t numRows, const Optional<VPMAreaLifetime>& lifetime) const
+{
     // find free consecutive space in VPM with the requested size and return it
-    // to keep the remaining space free for scratch, we start allocating space from the end of the VPM
-    Optional<unsigned> rowOffset;
+    // to keep the remaining space free for scratch, we start allocating space from the end of the VPM. Since all areas
+    // are allocated from the end, this also prefers reusing rows of areas with disjoint life-times over free rows.
     uint8_t numFreeRows = 0;
     for(auto i = areas.size() - 1; i > 0 /* index 0 is always reserved for scratch */; --i)
     {
-        if(areas[i])
+        if(!isRowAvailable(static_cast<unsigned>(i), lifetime))
         {
             // row is already reserved
             numFreeRows = 0;
@@ -1243,26 +1438,10 @@ const VPMArea* VPM::addArea(const Local* local, DataType elementType, bool isSta
         else
             ++numFreeRows;
         if(numFreeRows >= numRows)
-        {
-            rowOffset = static_cast<unsigned>(i);
-            break;
-        }
+            return static_cast<unsigned>(i);
     }
-    if(!rowOffset)
-        // no more (big enough) free space on VPM
-        return nullptr;
-
-    // for now align all new VPM areas at the beginning of a row
-    auto ptr = std::make_shared<VPMArea>(isStackArea ? VPMUsage::STACK : VPMUsage::LOCAL_MEMORY,
-        static_cast<uint8_t>(rowOffset.value()), numRows, local);
-    for(auto i = rowOffset.value(); i < (rowOffset.value() + numRows); ++i)
-        areas[i] = ptr;
-    CPPLOG_LAZY(logging::Level::DEBUG,
-        log << "Allocating " << numRows << " rows (per 64 byte) of VPM cache starting at row " << rowOffset.value()
-            << " for local: " << local->to_string(false)
-            << (isStackArea ? std::string(" (") + std::to_string(numStacks) + " stacks)" : "") << logging::endl);
-    PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 90, "VPM cache size", requestedSize);
-    return ptr.get();
+    // no more (big enough) free space on VPM
+    return {};
 }
 
 unsigned VPM::getMaxCacheVectors(DataType type, bool writeAccess) const
@@ -1488,6 +1667,9 @@ void VPM::dumpUsage() const
         if(numEmpty > 0)
             writeArea(stream, "", (numEmpty * outputWidth) / VPM_NUM_ROWS);
         stream << logging::endl;
+
+        for(const auto& area : sharingAreas)
+            logging::debug() << "Sharing rows with other areas: " << area->to_string() << logging::endl;
     });
 }
 LCOV_EXCL_STOP
@@ -684,7 +684,42 @@ namespace vc4c
              * NOTE:
              * Its size needs include the spilled locals for all available QPUs!
              */
-            STACK
+            STACK,
+            /*
+             * This area is used as buffer for DMA loads issued ahead of the use of the loaded data (e.g. for the next
+             * loop iteration), so the DMA transfer can run without holding the hardware mutex.
+             *
+             * NOTE:
+             * Its size needs include the buffers for all available QPUs!
+             */
+            DMA_BUFFER
+        };
+
+        /*
+         * The life-time of a VPM area, given as the range of synchronization phases the area is accessed in.
+         *
+         * A synchronization phase is the code between two work-group barriers (or the start/end of the kernel), in
+         * the order of the basic blocks of the kernel. Since all QPUs of a work-group have finished all accesses of
+         * one phase before any QPU starts with the next phase, areas accessed in disjoint phases can share the same
+         * rows of VPM.
+         */
+        struct VPMAreaLifetime
+        {
+            // the first phase (inclusive) the area is accessed in
+            unsigned firstPhase;
+            // the last phase (inclusive) the area is accessed in
+            unsigned lastPhase;
+            // the total number of phases of the kernel
+            unsigned numPhases;
+
+            /*
+             * Returns whether the two life-times overlap, i.e. whether the areas cannot share VPM rows.
+             *
+             * NOTE: Since the kernel code might be repeated for the next work-group without any synchronization in
+             * between, the life-times also overlap if they are not separated by a barrier across the end of the kernel
+             * code.
+             */
+            bool overlaps(const VPMAreaLifetime& other) const;
         };
 
         /*
@@ -692,8 +727,10 @@ namespace vc4c
          */
         struct VPMArea
         {
-            VPMArea(VPMUsage usage, uint8_t rowOffset, uint8_t numRows, const Local* basePointer = nullptr) :
-                usageType(usage), rowOffset(rowOffset), numRows(numRows), originalAddress(basePointer)
+            VPMArea(VPMUsage usage, uint8_t rowOffset, uint8_t numRows, const Local* basePointer = nullptr,
+                const Optional<VPMAreaLifetime>& lifetime = {}) :
+                usageType(usage), rowOffset(rowOffset), numRows(numRows), originalAddress(basePointer),
+                lifetime(lifetime)
             {
             }
             VPMArea(const VPMArea&) = delete;
@@ -725,6 +762,13 @@ namespace vc4c
              * is lowered into VPM).
              */
             const Local* originalAddress;
+            /*
+             * The (optional) life-time of this area.
+             *
+             * Areas without a known life-time are assumed to be used over the whole kernel execution and therefore can
+             * never share their rows with other areas.
+             */
+            const Optional<VPMAreaLifetime> lifetime;
 
             void checkAreaSize(unsigned requestedSize) const;
 
@@ -829,8 +873,23 @@ namespace vc4c
 
             const VPMArea& getScratchArea() const;
             const VPMArea* findArea(const Local* local);
-            const VPMArea* addArea(
-                const Local* local, DataType elementType, bool isStackArea, unsigned numStacks = NUM_QPUS);
+            /*
+             * Reserves an area in VPM for the given local.
+             *
+             * If the life-time of the area is given, the area can reuse the rows of other areas with disjoint
+             * life-times, allowing more memory areas to be kept in VPM at the same time.
+             */
+            const VPMArea* addArea(const Local* local, DataType elementType, bool isStackArea,
+                unsigned numStacks = NUM_QPUS, const Optional<VPMAreaLifetime>& lifetime = {});
+            /*
+             * Reserves an area in VPM with the given usage (e.g. to spill the given local into), containing a single
+             * row for every QPU. The row for a QPU is selected by its QPU number.
+             */
+            const VPMArea* addPerQPUArea(const Local* local, VPMUsage usage);
+            /*
+             * Returns the number of areas reserved with the given usage, e.g. the number of spilled locals
+             */
+            std::size_t countAreas(VPMUsage usage) const;
 
             /*
              * The maximum number of vectors (of the given type) which can be cached in this VPM.
@@ -868,6 +927,9 @@ namespace vc4c
                 const Value& inAreaOffset = INT_ZERO, const Value& numEntries = INT_ONE);
             /*
              * Inserts a copy from RAM via DMA and VPM into RAM
+             *
+             * NOTE: If no area is given, multiples of whole VPM rows of 32-bit words are copied with a single DMA read
+             * and write for as many rows as can be read at once.
              */
             NODISCARD InstructionWalker insertCopyRAM(Method& method, InstructionWalker it, const Value& destAddress,
                 const Value& srcAddress, unsigned numBytes, const VPMArea* area = nullptr, bool useMutex = true);
@@ -880,6 +942,13 @@ namespace vc4c
              */
             NODISCARD InstructionWalker insertFillRAM(Method& method, InstructionWalker it, const Value& memoryAddress,
                 DataType type, unsigned numCopies, const VPMArea* area = nullptr, bool useMutex = true);
+            /*
+             * Inserts a filling of the given number of bytes of a memory-area with the given 16-element vector of
+             * 32-bit words, which is written into multiple rows of the scratch area, so every DMA write covers
+             * multiple rows of the memory-area
+             */
+            NODISCARD InstructionWalker insertFillRAM(Method& method, InstructionWalker it, const Value& memoryAddress,
+                const Value& fillVector, unsigned numBytes, bool useMutex = true);
             NODISCARD InstructionWalker insertFillRAMDynamic(Method& method, InstructionWalker it,
                 const Value& memoryAddress, DataType type, const Value& numCopies, const VPMArea* area = nullptr,
                 bool useMutex = true);
@@ -904,7 +973,13 @@ namespace vc4c
 
         private:
             const unsigned maximumVPMSize;
+            // the area first reserving the row, for every row in VPM
             std::vector<std::shared_ptr<VPMArea>> areas;
+            // the additional areas reusing (some of) the rows already reserved by other areas
+            std::vector<std::shared_ptr<VPMArea>> sharingAreas;
+
+            bool isRowAvailable(unsigned row, const Optional<VPMAreaLifetime>& lifetime) const;
+            Optional<unsigned> findFreeRows(uint8_t numRows, const Optional<VPMAreaLifetime>& lifetime) const;
 
             InstructionWalker insertLockMutex(InstructionWalker it, bool useMutex) const;
             InstructionWalker insertUnlockMutex(InstructionWalker it, bool useMutex) const;
@@ -6,9 +6,11 @@
 
 #include "FrontendCompiler.h"
 
+#include "../MappedFile.h"
 #include "../ProcessUtil.h"
 #include "../Profiler.h"
 #include "../helper.h"
+#include "../llvm/Linker.h"
 #include "LibClang.h"
 #include "log.h"
 
@@ -98,7 +100,7 @@ static std::vector<std::string> buildClangCommand(const std::string& compiler, c
     if(usePCH)
     {
         command.emplace_back("-include-pch");
-        command.emplace_back(Precompiler::findStandardLibraryFiles().precompiledHeader);
+        command.emplace_back(Precompiler::findPrecompiledHeader(options));
     }
     else
     {
@@ -243,6 +245,24 @@ void precompilation::linkInStdlibModule(LLVMIRSource&& source, const std::string
 {
     if(Precompiler::findStandardLibraryFiles().llvmModule.empty())
         throw CompilationError(CompilationStep::LINKER, "LLVM IR module for VC4CL std-lib is not defined!");
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+    {
+        // link in-process to not have to re-read the whole std-lib module for every compilation
+        PROFILE_START(LinkInStdlibModule);
+        LLVMIRSource src(std::forward<LLVMIRSource>(source));
+        std::unique_ptr<std::istream> fileIn;
+        if(src.file)
+            fileIn.reset(new std::ifstream(src.file.value(), std::ios_base::in | std::ios_base::binary));
+        std::unique_ptr<std::ostream> fileOut;
+        if(result.file)
+            fileOut.reset(new std::ofstream(
+                result.file.value(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary));
+        llvm2qasm::linkInStandardLibrary(fileIn ? *fileIn : *src.stream, fileOut ? *fileOut : *result.stream,
+            Precompiler::findStandardLibraryFiles().llvmModule);
+        PROFILE_END(LinkInStdlibModule);
+        return;
+    }
+#endif
     std::vector<LLVMIRSource> sources;
     sources.emplace_back(std::forward<LLVMIRSource>(source));
     sources.emplace_back(Precompiler::findStandardLibraryFiles().llvmModule);
@@ -321,6 +341,33 @@ void precompilation::linkLLVMModules(
 {
     // TODO add call to llvm-lto??!
     PROFILE_START(LinkLLVMModules);
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+    {
+        // link in-process to not need to write all inputs into (temporary) files and run llvm-link
+        std::vector<std::istream*> inputs;
+        std::vector<std::unique_ptr<std::istream>> fileInputs;
+        for(auto& source : sources)
+        {
+            if(source.file)
+            {
+                fileInputs.emplace_back(new MappedFileStream(source.file.value()));
+                inputs.emplace_back(fileInputs.back().get());
+            }
+            else
+                inputs.emplace_back(source.stream);
+        }
+        std::unique_ptr<std::ostream> fileOut;
+        if(result.file)
+            fileOut.reset(new std::ofstream(
+                result.file.value(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary));
+        CPPLOG_LAZY(logging::Level::INFO,
+            log << "Linking " << sources.size() << " LLVM modules in-process..." << logging::endl);
+        llvm2qasm::linkModules(
+            inputs, fileOut ? *fileOut : *result.stream, userOptions.find("-only-needed") != std::string::npos);
+        PROFILE_END(LinkLLVMModules);
+        return;
+    }
+#endif
 #ifndef LLVM_LINK_PATH
     throw CompilationError(CompilationStep::PRECOMPILATION, "llvm-link is not available!");
 #else
@@ -66,8 +66,15 @@ namespace vc4c
         {
             return [step1, step2](PrecompilationSource<InType>&& in, const std::string& userOptions,
                        PrecompilationResult<OutType>& result) {
+#ifdef USE_LIBCLANG
+                // the intermediate result is written by the in-process compiler or piped from/to the external tools,
+                // so there is no need for a round-trip through the file-system
+                std::stringstream buffer;
+                PrecompilationResult<IntermediateType> intermediateResult(&buffer);
+#else
                 TemporaryFile f;
                 PrecompilationResult<IntermediateType> intermediateResult(f.fileName);
+#endif
                 step1(std::forward<PrecompilationSource<InType>>(in), userOptions, intermediateResult);
                 return step2(PrecompilationSource<IntermediateType>(intermediateResult), userOptions, result);
             };
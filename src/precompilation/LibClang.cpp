@@ -19,6 +19,12 @@
 #include "clang/Frontend/CompilerInvocation.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/raw_os_ostream.h"
+#if LLVM_LIBRARY_VERSION >= 40
+#include "llvm/Bitcode/BitcodeWriter.h"
+#else
+#include "llvm/Bitcode/ReaderWriter.h"
+#endif
 
 #include <memory>
 
@@ -227,13 +233,10 @@ void precompilation::compileLibClang(const std::vector<std::string>& command, st
     invocation->getHeaderSearchOpts().AddPath(
         "/home/daniel/workspace/VC4C/../VC4CLStdLib/include", clang::frontend::IncludeDirGroup::System, false, true);
 
-    // TODO redirect output if stream (or copy MemoryBuffer to stream afterwards)
-
     dumpCompilationOptions(*invocation);
 
     // XXX can set PCHReader, make use to directly include pch??
     // TODO also directly link in stdlib module??
-    // TODO also compile into buffer and re-use buffer (no temporary file!)
     clang::CompilerInstance instance;
     instance.setInvocation(invocation);
 
@@ -241,6 +244,32 @@ void precompilation::compileLibClang(const std::vector<std::string>& command, st
     if(!instance.hasDiagnostics())
         throw CompilationError(CompilationStep::PRECOMPILATION, "compiler instance has no diagnostics set");
 
+    if(outputStream)
+    {
+        // generate the module in memory and write it directly into the output stream, no need for a temporary file
+        PROFILE_START(EmitLLVMOnlyAction);
+        clang::EmitLLVMOnlyAction action;
+        if(!instance.ExecuteAction(action))
+        {
+            // TODO print diagnostics
+            throw CompilationError(CompilationStep::PRECOMPILATION, "Error in precompilation - BETTER ERROR MESSAGE!");
+        }
+        PROFILE_END(EmitLLVMOnlyAction);
+        std::unique_ptr<llvm::Module> module = action.takeModule();
+        if(!module)
+            throw CompilationError(CompilationStep::PRECOMPILATION, "Pre-compilation did not generate a module");
+        llvm::raw_os_ostream out(*outputStream);
+        if(invocation->getFrontendOpts().ProgramAction == clang::frontend::EmitLLVM)
+            module->print(out, nullptr);
+        else
+#if LLVM_LIBRARY_VERSION >= 70
+            llvm::WriteBitcodeToFile(*module, out);
+#else
+            llvm::WriteBitcodeToFile(module.get(), out);
+#endif
+        return;
+    }
+
     PROFILE_START(EmitBCAction);
     clang::EmitBCAction action;
     if(!instance.ExecuteAction(action))
@@ -249,8 +278,6 @@ void precompilation::compileLibClang(const std::vector<std::string>& command, st
         throw CompilationError(CompilationStep::PRECOMPILATION, "Error in precompilation - BETTER ERROR MESSAGE!");
     }
     PROFILE_END(EmitBCAction);
-
-    // TODO use module directly: action.takeModule()
 }
 
 #endif /* USE_LIBCLANG */
@@ -6,24 +6,46 @@
 
 #include "Precompiler.h"
 
+#include "../MappedFile.h"
 #include "../Profiler.h"
+#include "../ThreadPool.h"
 #include "../helper.h"
 #include "FrontendCompiler.h"
 #include "log.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iterator>
 #include <libgen.h>
+#include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace vc4c;
 using namespace vc4c::precompilation;
 
+#ifndef VC4C_VERSION
+#define VC4C_VERSION ""
+#endif
+
 extern void runPrecompiler(const std::string& command, std::istream* inputStream, std::ostream* outputStream);
 
+#if defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40
+// the LLVM front-end runs the optimization passes in-process on the loaded module (see llvm2qasm::optimizeModule)
+static constexpr bool RUN_OPT_PROCESS = false;
+#else
+static constexpr bool RUN_OPT_PROCESS = true;
+#endif
+
 bool vc4c::isSupportedByFrontend(SourceType inputType, Frontend frontend)
 {
     switch(inputType)
@@ -52,6 +74,7 @@ void Precompiler::precompile(std::istream& input, std::unique_ptr<std::istream>&
     const std::string& options, const Optional<std::string>& inputFile, const Optional<std::string>& outputFile)
 {
     PROFILE_START(Precompile);
+    PROFILE_TRACE_START(Precompile);
     Precompiler precompiler(config, input, Precompiler::getSourceType(input), inputFile);
     if(config.frontend != Frontend::DEFAULT)
         precompiler.run(output, config.frontend == Frontend::LLVM_IR ? SourceType::LLVM_IR_BIN : SourceType::SPIRV_BIN,
@@ -76,6 +99,7 @@ void Precompiler::precompile(std::istream& input, std::unique_ptr<std::istream>&
 #endif
     }
     PROFILE_END(Precompile);
+    PROFILE_TRACE_END("stage", Precompile);
 }
 
 SourceType Precompiler::getSourceType(std::istream& stream)
@@ -97,8 +121,24 @@ SourceType Precompiler::getSourceType(std::istream& stream)
         return s.str();
     }();
     std::array<char, 1024> buffer{};
-    stream.read(buffer.data(), 1000);
-    const std::string s(buffer.data(), static_cast<std::size_t>(stream.gcount()));
+    std::size_t numBytes = 0;
+    if(auto mappedFile = getMappedBuffer(stream))
+    {
+        // no need to read the data (and reset the stream afterwards), just look at the mapped file contents
+        numBytes = std::min(mappedFile->size(), std::size_t{1000});
+        std::copy_n(mappedFile->data(), numBytes, buffer.data());
+    }
+    else
+    {
+        stream.read(buffer.data(), 1000);
+        numBytes = static_cast<std::size_t>(stream.gcount());
+
+        // reset flags (e.g. if we were at the end of the file)
+        stream.clear();
+        // reset stream position
+        stream.seekg(0);
+    }
+    const std::string s(buffer.data(), numBytes);
 
     SourceType type = SourceType::UNKNOWN;
     if(s.find("ModuleID") != std::string::npos || s.find("\ntarget triple") != std::string::npos)
@@ -123,11 +163,6 @@ SourceType Precompiler::getSourceType(std::istream& stream)
         // TODO need better check, or simply default to OpenCL C??
         type = SourceType::OPENCL_C;
 
-    // reset flags (e.g. if we were at the end of the file)
-    stream.clear();
-    // reset stream position
-    stream.seekg(0);
-
     PROFILE_END(GetSourceType);
     return type;
 }
@@ -135,7 +170,7 @@ SourceType Precompiler::getSourceType(std::istream& stream)
 static std::pair<bool, bool> determinePossibleLinkers(
     const std::unordered_map<std::istream*, Optional<std::string>>& inputs)
 {
-#ifdef LLVM_LINK_PATH
+#if defined LLVM_LINK_PATH || (defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40)
     bool llvmLinkerPossible = true;
 #else
     bool llvmLinkerPossible = false;
@@ -212,6 +247,48 @@ static NODISCARD Optional<TemporaryFile> compileToLLVM(const std::pair<std::istr
             std::to_string(static_cast<unsigned>(type)));
 }
 
+/*
+ * Compiles all inputs to the common source type in parallel on the shared thread pool.
+ *
+ * Returns the temporary file with the compiled code for each input (in the order of the inputs), or null if the
+ * input does not need to be converted.
+ */
+static std::vector<std::unique_ptr<TemporaryFile>> compileInParallel(
+    const std::unordered_map<std::istream*, Optional<std::string>>& inputs,
+    Optional<TemporaryFile> (*compile)(const std::pair<std::istream*, Optional<std::string>>&))
+{
+    std::vector<std::unique_ptr<TemporaryFile>> compiledFiles(inputs.size());
+    auto& pool = ThreadPool::getDefaultPool();
+    std::vector<std::future<void>> futures;
+    futures.reserve(inputs.size());
+    std::size_t index = 0;
+    for(const auto& input : inputs)
+    {
+        auto& file = compiledFiles[index++];
+        futures.emplace_back(pool.schedule([&input, &file, compile]() {
+            if(auto temp = compile(input))
+                file = std::make_unique<TemporaryFile>(std::move(temp.value()));
+        }));
+    }
+    // wait for all tasks to finish before re-throwing any error, since the tasks reference the local variables
+    std::exception_ptr error;
+    for(auto& future : futures)
+    {
+        try
+        {
+            pool.waitFor(future);
+        }
+        catch(...)
+        {
+            if(!error)
+                error = std::current_exception();
+        }
+    }
+    if(error)
+        std::rethrow_exception(error);
+    return compiledFiles;
+}
+
 SourceType Precompiler::linkSourceCode(const std::unordered_map<std::istream*, Optional<std::string>>& inputs,
     std::ostream& output, bool includeStandardLibrary)
 {
@@ -226,18 +303,20 @@ SourceType Precompiler::linkSourceCode(const std::unordered_map<std::istream*, O
     // prefer SPIR-V linker, since it a) does not require an extra process and b) supports more source code types
     if(spirvLinkerPossible)
     {
+        auto compiledFiles = compileInParallel(inputs, compileToSPIRV);
         std::vector<SPIRVSource> sources;
         sources.reserve(inputs.size());
-        std::transform(inputs.begin(), inputs.end(), std::back_inserter(sources), [&](const auto& pair) -> SPIRVSource {
-            if(auto temp = compileToSPIRV(pair))
-            {
-                tempFiles.emplace_back(std::make_unique<TemporaryFile>(std::move(temp.value())));
-                return SPIRVSource(tempFiles.back()->fileName);
-            }
-            if(pair.second)
-                return SPIRVSource(pair.second.value());
-            return SPIRVSource(*pair.first);
-        });
+        auto fileIt = compiledFiles.begin();
+        for(const auto& pair : inputs)
+        {
+            auto& compiled = *fileIt++;
+            if(compiled)
+                sources.emplace_back(compiled->fileName);
+            else if(pair.second)
+                sources.emplace_back(pair.second.value());
+            else
+                sources.emplace_back(*pair.first);
+        }
 
         if(includeStandardLibrary)
         {
@@ -255,19 +334,20 @@ SourceType Precompiler::linkSourceCode(const std::unordered_map<std::istream*, O
     }
     else if(llvmLinkerPossible)
     {
+        auto compiledFiles = compileInParallel(inputs, compileToLLVM);
         std::vector<LLVMIRSource> sources;
         sources.reserve(inputs.size());
-        std::transform(
-            inputs.begin(), inputs.end(), std::back_inserter(sources), [&](const auto& pair) -> LLVMIRSource {
-                if(auto temp = compileToLLVM(pair))
-                {
-                    tempFiles.emplace_back(std::make_unique<TemporaryFile>(std::move(temp.value())));
-                    return LLVMIRSource(tempFiles.back()->fileName);
-                }
-                if(pair.second)
-                    return LLVMIRSource(pair.second.value());
-                return LLVMIRSource(*pair.first);
-            });
+        auto fileIt = compiledFiles.begin();
+        for(const auto& pair : inputs)
+        {
+            auto& compiled = *fileIt++;
+            if(compiled)
+                sources.emplace_back(compiled->fileName);
+            else if(pair.second)
+                sources.emplace_back(pair.second.value());
+            else
+                sources.emplace_back(*pair.first);
+        }
         if(includeStandardLibrary)
         {
             // need to link the std-lib module with the special function to set the correct flags (e.g. to not fail if
@@ -299,7 +379,7 @@ bool Precompiler::isLinkerAvailable(const std::unordered_map<std::istream*, Opti
         {
         case SourceType::OPENCL_C:
         case SourceType::LLVM_IR_BIN:
-#ifdef LLVM_LINK_PATH
+#if defined LLVM_LINK_PATH || (defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40)
             return true;
 #endif
         case SourceType::LLVM_IR_TEXT:
@@ -316,7 +396,7 @@ bool Precompiler::isLinkerAvailable(const std::unordered_map<std::istream*, Opti
 
 bool Precompiler::isLinkerAvailable()
 {
-#if defined(SPIRV_FRONTEND) || defined(LLVM_LINK_PATH)
+#if defined(SPIRV_FRONTEND) || defined(LLVM_LINK_PATH) || (defined USE_LLVM_LIBRARY && LLVM_LIBRARY_VERSION >= 40)
     return true;
 #else
     return false;
@@ -343,6 +423,13 @@ static std::string determineFilePath(const std::string& fileName, const std::vec
     return "";
 }
 
+static std::string getUserCacheFolder()
+{
+    if(auto homeDir = std::getenv("HOME"))
+        return std::string(homeDir) + "/.cache/vc4c";
+    return "";
+}
+
 const StdlibFiles& Precompiler::findStandardLibraryFiles(const std::vector<std::string>& additionalFolders)
 {
     static const StdlibFiles paths = [&]() {
@@ -352,14 +439,16 @@ const StdlibFiles& Precompiler::findStandardLibraryFiles(const std::vector<std::
 #endif
         allPaths.emplace_back("/usr/local/include/vc4cl-stdlib/");
         allPaths.emplace_back("/usr/include/vc4cl-stdlib/");
-        if(auto homeDir = std::getenv("HOME"))
+        auto cacheFolder = getUserCacheFolder();
+        if(!cacheFolder.empty())
         {
-            allPaths.emplace_back(std::string(homeDir) + "/.cache/vc4c");
+            allPaths.emplace_back(cacheFolder);
         }
         StdlibFiles tmp;
         tmp.configurationHeader = determineFilePath("defines.h", allPaths);
         tmp.llvmModule = determineFilePath("VC4CLStdLib.bc", allPaths);
         tmp.precompiledHeader = determineFilePath("VC4CLStdLib.h.pch", allPaths);
+        tmp.sourceHeader = determineFilePath("VC4CLStdLib.h", allPaths);
         if(tmp.configurationHeader.empty() || (tmp.llvmModule.empty() && tmp.precompiledHeader.empty()))
         {
             throw CompilationError(CompilationStep::PRECOMPILATION,
@@ -371,32 +460,178 @@ const StdlibFiles& Precompiler::findStandardLibraryFiles(const std::vector<std::
     return paths;
 }
 
-void Precompiler::precompileStandardLibraryFiles(const std::string& sourceFile, const std::string& destinationFolder)
-{
-    PROFILE_START(PrecompileStandardLibraryFiles);
-    // TODO merge with creating of parameters in FrontendCompiler#buildClangCommand
-    auto pchArgs =
-        " -cc1 -triple spir-unknown-unknown -O3 -ffp-contract=off -cl-std=CL1.2 -cl-kernel-arg-info "
-        "-cl-single-precision-constant -fgnu89-inline -Wno-all -Wno-gcc-compat -Wdouble-promotion "
-        "-Wno-undefined-inline "
-        "-Wno-unknown-attributes -x cl "
-        "-emit-pch -o ";
-    auto moduleArgs =
-        " -cc1 -triple spir-unknown-unknown -O3 -ffp-contract=off -cl-std=CL1.2 -cl-kernel-arg-info "
-        "-cl-single-precision-constant -fgnu89-inline -Wno-all -Wno-gcc-compat -Wdouble-promotion "
-        "-Wno-undefined-inline "
-        "-Wno-unknown-attributes -x cl "
-        "-emit-llvm-bc -o ";
+/*
+ * The options the standard-library PCH and module are compiled with by default, which are also the values used by
+ * FrontendCompiler#buildClangCommand if the user does not specify them.
+ */
+static const std::set<std::string> DEFAULT_STDLIB_OPTIONS = {
+    "-O3", "-ffp-contract=off", "-cl-std=CL1.2", "-cl-kernel-arg-info", "-cl-single-precision-constant"};
 
+static std::string buildStdlibCommand(const std::set<std::string>& languageOptions, const std::string& emitter,
+    const std::string& outputFile, const std::string& sourceFile)
+{
 #ifdef SPIRV_CLANG_PATH
     // just OpenCL C -> LLVM IR (but with Khronos CLang)
     const std::string compiler = SPIRV_CLANG_PATH;
 #else
     const std::string compiler = CLANG_PATH;
 #endif
+    // TODO merge with creating of parameters in FrontendCompiler#buildClangCommand
+    return compiler + " -cc1 -triple spir-unknown-unknown " + to_string<std::string>(languageOptions, " ") +
+        " -fgnu89-inline -Wno-all -Wno-gcc-compat -Wdouble-promotion -Wno-undefined-inline -Wno-unknown-attributes "
+        "-x cl " +
+        emitter + " -o " + outputFile + " " + sourceFile;
+}
+
+/*
+ * Extracts the options which need to match between the PCH and the compilation including it (the language options
+ * and the optimization level, see clang's ASTReader) and adds the default values for the options not given.
+ */
+static std::set<std::string> getLanguageOptions(const std::string& userOptions)
+{
+    std::set<std::string> languageOptions;
+    bool hasOptimizationLevel = false;
+    bool hasFPContract = false;
+    bool hasStandard = false;
+    std::istringstream tmp{userOptions};
+    std::string option;
+    while(tmp >> option)
+    {
+        if(option.find("-O") == 0)
+            hasOptimizationLevel = true;
+        else if(option.find("-ffp-contract") == 0)
+            hasFPContract = true;
+        else if(option.find("-cl-std") == 0)
+            hasStandard = true;
+        else if(option.find("-cl-") != 0)
+            continue;
+        languageOptions.emplace(option);
+    }
+    if(!hasOptimizationLevel)
+        languageOptions.emplace("-O3");
+    if(!hasFPContract)
+        languageOptions.emplace("-ffp-contract=off");
+    if(!hasStandard)
+        languageOptions.emplace("-cl-std=CL1.2");
+    languageOptions.emplace("-cl-kernel-arg-info");
+    languageOptions.emplace("-cl-single-precision-constant");
+    return languageOptions;
+}
 
-    auto pchCommand = compiler + pchArgs + destinationFolder + "/VC4CLStdLib.h.pch " + sourceFile;
-    auto moduleCommand = compiler + moduleArgs + destinationFolder + "/VC4CLStdLib.bc " + sourceFile;
+/*
+ * The key for a PCH variant, depending on everything which affects its contents: The compiler version, the
+ * standard-library header (path and last modification) and the language options.
+ *
+ * Uses the 64-bit FNV-1a hash, since the key needs to be stable across processes.
+ */
+static std::string calculateVariantKey(const std::set<std::string>& languageOptions, const std::string& sourceHeader)
+{
+    struct stat info = {};
+    stat(sourceHeader.data(), &info);
+    std::stringstream s;
+    s << VC4C_VERSION << '\n'
+      << buildStdlibCommand(languageOptions, "-emit-pch", "", sourceHeader) << '\n'
+      << info.st_size << ';' << info.st_mtime;
+    uint64_t hash = 0xcbf29ce484222325;
+    for(auto c : s.str())
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    std::stringstream key;
+    key << std::hex << std::setfill('0') << std::setw(16) << hash;
+    return key.str();
+}
+
+static bool buildPrecompiledHeaderVariant(
+    const std::set<std::string>& languageOptions, const std::string& sourceHeader, const std::string& outputFile)
+{
+    auto folder = outputFile.substr(0, outputFile.find_last_of('/'));
+    // create all missing parent folders
+    for(auto pos = folder.find('/', 1); pos != std::string::npos; pos = folder.find('/', pos + 1))
+        mkdir(folder.substr(0, pos).data(), 0755);
+    if(mkdir(folder.data(), 0755) != 0 && errno != EEXIST)
+    {
+        logging::warn() << "Failed to create folder for pre-compiled headers '" << folder << "': " << strerror(errno)
+                        << logging::endl;
+        return false;
+    }
+    // compile into a temporary file first and then rename it to not expose half-written PCHs to other processes
+    std::string tmpName = folder + "/.pch-XXXXXX";
+    int fd = mkstemp(&tmpName[0]);
+    if(fd < 0)
+    {
+        logging::warn() << "Failed to create pre-compiled header: " << strerror(errno) << logging::endl;
+        return false;
+    }
+    close(fd);
+    auto command = buildStdlibCommand(languageOptions, "-emit-pch", tmpName, sourceHeader);
+    CPPLOG_LAZY(logging::Level::INFO, log << "Pre-compiling standard library with: " << command << logging::endl);
+    try
+    {
+        runPrecompiler(command, nullptr, nullptr);
+    }
+    catch(const CompilationError& err)
+    {
+        remove(tmpName.data());
+        logging::warn() << "Failed to pre-compile standard library header: " << err.what() << logging::endl;
+        return false;
+    }
+    if(rename(tmpName.data(), outputFile.data()) != 0)
+    {
+        remove(tmpName.data());
+        logging::warn() << "Failed to store pre-compiled header '" << outputFile << "': " << strerror(errno)
+                        << logging::endl;
+        return false;
+    }
+    return true;
+}
+
+const std::string& Precompiler::findPrecompiledHeader(const std::string& userOptions)
+{
+    const auto& files = findStandardLibraryFiles();
+    auto languageOptions = getLanguageOptions(userOptions);
+    if(languageOptions == DEFAULT_STDLIB_OPTIONS && !files.precompiledHeader.empty())
+        return files.precompiledHeader;
+
+    // the variants are only built once per process and the cached files are reused by all later processes
+    static std::mutex variantsLock;
+    static std::map<std::set<std::string>, std::string> variants;
+    std::lock_guard<std::mutex> guard(variantsLock);
+    auto it = variants.find(languageOptions);
+    if(it != variants.end())
+        return it->second;
+
+    auto cacheFolder = getUserCacheFolder();
+    if(files.sourceHeader.empty() || cacheFolder.empty())
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Cannot build standard-library PCH for options '" << to_string<std::string>(languageOptions, " ")
+                << "', using default PCH" << logging::endl);
+        return variants.emplace(languageOptions, files.precompiledHeader).first->second;
+    }
+    PROFILE_START(FindPrecompiledHeaderVariant);
+    auto path = cacheFolder + "/pch/VC4CLStdLib-" + calculateVariantKey(languageOptions, files.sourceHeader) +
+        ".h.pch";
+    if(access(path.data(), R_OK) == 0)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG, log << "Using cached standard-library PCH: " << path << logging::endl);
+    }
+    else if(!buildPrecompiledHeaderVariant(languageOptions, files.sourceHeader, path))
+    {
+        path = files.precompiledHeader;
+    }
+    PROFILE_END(FindPrecompiledHeaderVariant);
+    return variants.emplace(languageOptions, path).first->second;
+}
+
+void Precompiler::precompileStandardLibraryFiles(const std::string& sourceFile, const std::string& destinationFolder)
+{
+    PROFILE_START(PrecompileStandardLibraryFiles);
+    auto pchCommand =
+        buildStdlibCommand(DEFAULT_STDLIB_OPTIONS, "-emit-pch", destinationFolder + "/VC4CLStdLib.h.pch", sourceFile);
+    auto moduleCommand =
+        buildStdlibCommand(DEFAULT_STDLIB_OPTIONS, "-emit-llvm-bc", destinationFolder + "/VC4CLStdLib.bc", sourceFile);
 
     CPPLOG_LAZY(logging::Level::INFO, log << "Pre-compiling standard library with: " << pchCommand << logging::endl);
     runPrecompiler(pchCommand, nullptr, nullptr);
@@ -425,10 +660,12 @@ void Precompiler::run(std::unique_ptr<std::istream>& output, const SourceType ou
         throw CompilationError(CompilationStep::PRECOMPILATION, "Invalid output-type for pre-compilation",
             std::to_string(static_cast<unsigned>(outputType)));
 
+#ifndef USE_LIBCLANG
     if(!outputFile)
         logging::warn() << "When running the pre-compiler with root rights and writing to /dev/stdout, the compiler "
                            "might delete the /dev/stdout symlink!"
                         << logging::endl;
+#endif
 
     std::string extendedOptions = options;
     if(inputFile)
@@ -443,6 +680,12 @@ void Precompiler::run(std::unique_ptr<std::istream>& output, const SourceType ou
 
     if(inputType == outputType)
     {
+        if(inputFile)
+        {
+            // nothing to convert, so directly use the file contents without copying them around
+            output = std::make_unique<MappedFileStream>(inputFile.value());
+            return;
+        }
         const std::string buffer(std::istreambuf_iterator<char>(input), {});
         output = std::make_unique<std::istringstream>(buffer);
         return;
@@ -456,7 +699,7 @@ void Precompiler::run(std::unique_ptr<std::istream>& output, const SourceType ou
         if(outputType == SourceType::LLVM_IR_TEXT)
         {
             LLVMIRTextResult res = outputFile ? LLVMIRTextResult(outputFile.value()) : LLVMIRTextResult(&tempStream);
-            if(config.useOpt)
+            if(config.useOpt && RUN_OPT_PROCESS)
             {
                 auto steps = chainSteps<SourceType::LLVM_IR_TEXT, SourceType::OPENCL_C, SourceType::LLVM_IR_TEXT>(
                     compileOpenCLToLLVMText, optimizeLLVMText);
@@ -470,7 +713,7 @@ void Precompiler::run(std::unique_ptr<std::istream>& output, const SourceType ou
         else if(outputType == SourceType::LLVM_IR_BIN)
         {
             LLVMIRResult res = outputFile ? LLVMIRResult(outputFile.value()) : LLVMIRResult(&tempStream);
-            if(config.useOpt)
+            if(config.useOpt && RUN_OPT_PROCESS)
             {
                 auto steps = chainSteps<SourceType::LLVM_IR_BIN, SourceType::OPENCL_C, SourceType::LLVM_IR_BIN>(
                     compileOpenCLToLLVMIR, optimizeLLVMIR);
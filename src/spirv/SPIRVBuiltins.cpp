@@ -18,10 +18,9 @@ using namespace vc4c::spirv;
 
 SPIRVBuiltin::~SPIRVBuiltin() noexcept = default;
 
-Local::RAIILock SPIRVBuiltin::getUsersLock() const
+Local::SharedUsers* SPIRVBuiltin::getSharedUsers() const
 {
-    usersLock.lock();
-    return RAIILock([&]() { usersLock.unlock(); });
+    return &sharedUsers;
 }
 
 // get_work_dim - scalar integer
@@ -51,6 +50,17 @@ SPIRVBuiltin spirv::BUILTIN_GLOBAL_OFFSET{
 
 std::string spirv::BUILTIN_INTRINSIC{"load_builtin"};
 
+SPIRVBuiltin* spirv::findBuiltin(const std::string& name)
+{
+    for(auto builtin : {&BUILTIN_WORK_DIMENSIONS, &BUILTIN_GLOBAL_SIZE, &BUILTIN_GLOBAL_ID, &BUILTIN_LOCAL_SIZE,
+            &BUILTIN_LOCAL_ID, &BUILTIN_NUM_GROUPS, &BUILTIN_GROUP_ID, &BUILTIN_GLOBAL_OFFSET})
+    {
+        if(builtin->name == name)
+            return builtin;
+    }
+    return nullptr;
+}
+
 static Optional<Value> getDimensionalArgument(const intermediate::IntrinsicOperation& intrinsicOp)
 {
     // if the intrinsic function calls are converted from a SPIR-V variable with built-in decoration, they do not have
@@ -44,8 +44,9 @@ namespace vc4c
             bool hasDimensionalArgument;
 
         protected:
-            mutable std::mutex usersLock;
-            RAIILock getUsersLock() const override;
+            // the built-ins are shared across all kernels
+            mutable SharedUsers sharedUsers;
+            SharedUsers* getSharedUsers() const override;
         };
 
         // get_work_dim - scalar integer
@@ -68,6 +69,11 @@ namespace vc4c
         // The magic constant indicating an intermediate::IntrinsicOperation which for reading a built-in value
         extern std::string BUILTIN_INTRINSIC;
 
+        /*
+         * Returns the built-in with the given name, or a nullptr if there is no such built-in
+         */
+        SPIRVBuiltin* findBuiltin(const std::string& name);
+
         /**
          * Lowers the "loading" of OpenCL C work-item functions from SPIR-V constant memory into the "normal" intrinsic
          * functions.
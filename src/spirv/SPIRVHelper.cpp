@@ -6,15 +6,19 @@
 
 #include "SPIRVHelper.h"
 
+#include "../MappedFile.h"
 #include "../Module.h"
 #include "../performance.h"
 #include "CompilationError.h"
 #include "log.h"
 
+#include <cstring>
+
 #ifdef SPIRV_FRONTEND
 #if __has_include("spirv-tools/linker.hpp")
 #include "spirv-tools/linker.hpp"
 #endif
+#include "spirv-tools/optimizer.hpp"
 
 #include <algorithm>
 
@@ -783,6 +787,13 @@ void spirv::consumeSPIRVMessage(
 std::vector<uint32_t> spirv::readStreamOfWords(std::istream* in)
 {
     std::vector<uint32_t> words;
+    if(auto mappedFile = getMappedBuffer(*in))
+    {
+        // copy all complete words at once
+        words.resize(mappedFile->size() / sizeof(uint32_t));
+        std::memcpy(words.data(), mappedFile->data(), words.size() * sizeof(uint32_t));
+        return words;
+    }
     words.reserve(static_cast<std::size_t>(in->rdbuf()->in_avail()));
     char buffer[sizeof(uint32_t)];
     while(in->read(buffer, sizeof(uint32_t)).good())
@@ -826,6 +837,40 @@ void spirv::linkSPIRVModules(const std::vector<std::istream*>& inputModules, std
 #endif
 }
 
+void spirv::optimizeSPIRVModule(std::vector<uint32_t>& words)
+{
+    spvtools::Optimizer optimizer(SPV_ENV_OPENCL_EMBEDDED_1_2);
+    optimizer.SetMessageConsumer(consumeSPIRVMessage);
+    // Inlining first exposes the constant arguments of the (mostly standard-library) callees to the folding and
+    // removes the calls, leaving the callee functions dead. Passes only supporting shader modules do not change the
+    // module.
+    optimizer.RegisterPass(spvtools::CreateInlineExhaustivePass())
+        .RegisterPass(spvtools::CreateEliminateDeadFunctionsPass())
+        .RegisterPass(spvtools::CreateFoldSpecConstantOpAndCompositePass())
+        .RegisterPass(spvtools::CreateCCPPass())
+        .RegisterPass(spvtools::CreateDeadBranchElimPass())
+        .RegisterPass(spvtools::CreateAggressiveDCEPass())
+        .RegisterPass(spvtools::CreateUnifyConstantPass())
+        .RegisterPass(spvtools::CreateEliminateDeadConstantPass())
+        .RegisterPass(spvtools::CreateEliminateDeadFunctionsPass())
+        .RegisterPass(spvtools::CreateCompactIdsPass());
+
+    spvtools::OptimizerOptions options;
+    // the parser reports errors in the module anyway
+    options.set_run_validator(false);
+
+    std::vector<uint32_t> optimizedWords;
+    if(!optimizer.Run(words.data(), words.size(), &optimizedWords, options))
+    {
+        logging::warn() << "Failed to optimize SPIR-V module, continuing with unoptimized module" << logging::endl;
+        return;
+    }
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Optimized SPIR-V module from " << words.size() << " to " << optimizedWords.size() << " words"
+            << logging::endl);
+    words.swap(optimizedWords);
+}
+
 std::string spirv::demangleFunctionName(const std::string& name)
 {
     if(name.find("_Z") != 0)
@@ -40,6 +40,11 @@ namespace vc4c
 
         std::vector<uint32_t> readStreamOfWords(std::istream* in);
         void linkSPIRVModules(const std::vector<std::istream*>& inputModules, std::ostream& output);
+        /*
+         * Runs the SPIRV-Tools optimizer on the given SPIR-V binary in-place, see Configuration#optimizeSPIRV. On
+         * failure, the binary is left unchanged.
+         */
+        void optimizeSPIRVModule(std::vector<uint32_t>& words);
 
         std::string demangleFunctionName(const std::string& name);
 
@@ -10,6 +10,7 @@
 #include "../intermediate/Helper.h"
 #include "../intermediate/TypeConversions.h"
 #include "../intermediate/VectorHelper.h"
+#include "../intrinsics/ConstantFolding.h"
 #include "../intrinsics/Images.h"
 #include "../intrinsics/Operators.h"
 #include "SPIRVBuiltins.h"
@@ -129,70 +130,19 @@ void SPIRVInstruction::mapInstruction(TypeMapping& types, ConstantMapping& const
 Optional<Value> SPIRVInstruction::precalculate(
     const TypeMapping& types, const ConstantMapping& constants, const LocalMapping& memoryAllocated) const
 {
-    const Value op1 = constants.at(operands.at(0)).toValue().value_or(UNDEFINED_VALUE);
-    const Value op2 =
-        operands.size() > 1 ? constants.at(operands[1]).toValue().value_or(UNDEFINED_VALUE) : UNDEFINED_VALUE;
-
-    if(opcode == "fptoui")
-        return Value(Literal(static_cast<uint32_t>(op1.literal().real())), TYPE_INT32);
-    if(opcode == "fptosi")
-        return Value(Literal(static_cast<int32_t>(op1.literal().real())), TYPE_INT32);
-    if(opcode == "sitofp")
-        return Value(Literal(static_cast<float>(op1.literal().signedInt())), TYPE_FLOAT);
-    if(opcode == "uitofp")
-        return Value(Literal(static_cast<float>(op1.literal().unsignedInt())), TYPE_FLOAT);
-    if(opcode == OP_NEGATE)
-        return op1.type.isFloatingType() ? Value(Literal(-op1.literal().real()), TYPE_FLOAT) :
-                                           Value(Literal(-op1.literal().signedInt()), TYPE_INT32);
-    if(opcode == "add")
-        return Value(Literal(op1.literal().signedInt() + op2.literal().signedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "fadd")
-        return Value(Literal(op1.literal().real() + op2.literal().real()), op1.type.getUnionType(op2.type));
-    if(opcode == "sub")
-        return Value(Literal(op1.literal().signedInt() - op2.literal().signedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "fsub")
-        return Value(Literal(op1.literal().real() - op2.literal().real()), op1.type.getUnionType(op2.type));
-    if(opcode == "mul")
-        return Value(Literal(op1.literal().signedInt() * op2.literal().signedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "fmul")
-        return Value(Literal(op1.literal().real() * op2.literal().real()), op1.type.getUnionType(op2.type));
-    if(opcode == "udiv")
-        return Value(
-            Literal(op1.literal().unsignedInt() / op2.literal().unsignedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "sdiv")
-        return Value(Literal(op1.literal().signedInt() / op2.literal().signedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "fdiv")
-        return Value(Literal(op1.literal().real() / op2.literal().real()), op1.type.getUnionType(op2.type));
-    if(opcode == "umod")
-        return Value(
-            Literal(op1.literal().unsignedInt() % op2.literal().unsignedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "srem")
-        return Value(intrinsics::srem(op1.type, op1.literal(), op2.literal()), op1.type);
-    if(opcode == "smod")
-        return Value(intrinsics::smod(op1.type, op1.literal(), op2.literal()), op1.type);
-    if(opcode == "frem")
-        return Value(intrinsics::frem(op1.type, op1.literal(), op2.literal()), op1.type);
-    if(opcode == "fmod")
-        return Value(intrinsics::fmod(op1.type, op1.literal(), op2.literal()), op1.type);
-    if(opcode == "or")
-        return Value(
-            Literal(op1.literal().unsignedInt() | op2.literal().unsignedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "and")
-        return Value(
-            Literal(op1.literal().unsignedInt() & op2.literal().unsignedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "xor")
-        return Value(
-            Literal(op1.literal().unsignedInt() ^ op2.literal().unsignedInt()), op1.type.getUnionType(op2.type));
-    if(opcode == "not")
-        return Value(Literal(~op1.literal().unsignedInt()), op1.type);
-    if(opcode == "shr")
-        // in C++, unsigned right shift is logical (fills with zeroes)
-        return Value(Literal(op1.literal().unsignedInt() >> op2.literal().signedInt()), op1.type);
-    if(opcode == "asr")
-        return Value(intrinsics::asr(op1.literal(), op2.literal()), op1.type);
-    if(opcode == "shl")
-        return Value(Literal(op1.literal().unsignedInt() << op2.literal().signedInt()), op1.type);
-
+    auto op1 = constants.find(operands.at(0));
+    if(op1 == constants.end())
+        return NO_VALUE;
+    Optional<CompoundConstant> op2;
+    if(operands.size() > 1)
+    {
+        auto it = constants.find(operands[1]);
+        if(it == constants.end())
+            return NO_VALUE;
+        op2 = it->second;
+    }
+    if(auto result = intrinsics::foldConstantOperation(opcode, types.at(typeID), op1->second, op2))
+        return result->toValue();
     return NO_VALUE;
 }
 
@@ -220,34 +170,12 @@ void SPIRVComparison::mapInstruction(TypeMapping& types, ConstantMapping& consta
 Optional<Value> SPIRVComparison::precalculate(
     const TypeMapping& types, const ConstantMapping& constants, const LocalMapping& memoryAllocated) const
 {
-    const Value op1 = constants.at(operands.at(0)).toValue().value_or(UNDEFINED_VALUE);
-    const Value op2 = constants.at(operands.at(1)).toValue().value_or(UNDEFINED_VALUE);
-
-    if(intermediate::COMP_EQ == opcode)
-        return op1 == op2 ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_FALSE == opcode)
-        return BOOL_FALSE;
-    if(intermediate::COMP_NEQ == opcode)
-        return op1 != op2 ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_TRUE == opcode)
-        return BOOL_TRUE;
-    if(intermediate::COMP_SIGNED_GE == opcode)
-        return op1.literal().signedInt() >= op2.literal().signedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_SIGNED_GT == opcode)
-        return op1.literal().signedInt() > op2.literal().signedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_SIGNED_LE == opcode)
-        return op1.literal().signedInt() <= op2.literal().signedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_SIGNED_LT == opcode)
-        return op1.literal().signedInt() < op2.literal().signedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_UNSIGNED_GE == opcode)
-        return op1.literal().unsignedInt() >= op2.literal().unsignedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_UNSIGNED_GT == opcode)
-        return op1.literal().unsignedInt() > op2.literal().unsignedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_UNSIGNED_LE == opcode)
-        return op1.literal().unsignedInt() <= op2.literal().unsignedInt() ? BOOL_TRUE : BOOL_FALSE;
-    if(intermediate::COMP_UNSIGNED_LT == opcode)
-        return op1.literal().unsignedInt() < op2.literal().unsignedInt() ? BOOL_TRUE : BOOL_FALSE;
-
+    auto op1 = constants.find(operands.at(0));
+    auto op2 = constants.find(operands.at(1));
+    if(op1 == constants.end() || op2 == constants.end())
+        return NO_VALUE;
+    if(auto result = intrinsics::foldConstantComparison(opcode, types.at(typeID), op1->second, op2->second))
+        return result->toValue();
     return NO_VALUE;
 }
 
@@ -611,33 +539,33 @@ Optional<Value> SPIRVConversion::precalculate(
     const TypeMapping& types, const ConstantMapping& constants, const LocalMapping& memoryAllocated) const
 {
     auto it = constants.find(sourceID);
-    if(it != constants.end())
+    if(it == constants.end())
+        return NO_VALUE;
+    auto destType = types.at(typeID);
+    const auto sourceWidth = it->second.type.getScalarBitCount();
+    const auto destWidth = destType.getScalarBitCount();
+    std::string operation;
+    switch(type)
     {
-        auto source = it->second.toValue();
-        if(!source)
-            return NO_VALUE;
-        Value dest(UNDEFINED_VALUE);
-        auto destType = types.at(typeID);
-        switch(type)
-        {
-        case ConversionType::BITCAST:
-            dest = *source;
-            dest.type = destType;
-            return dest;
-        case ConversionType::FLOATING:
-            // double representation of all floating-point values is the same for the same value
-            return source;
-        case ConversionType::SIGNED_TO_SIGNED:
-            // TODO trunc/sext + saturation
-            break;
-        case ConversionType::UNSIGNED_TO_UNSIGNED:
-            // TODO trunc/zext + saturation
-            break;
-        case ConversionType::SIGNED_TO_UNSIGNED:
-        case ConversionType::UNSIGNED_TO_SIGNED:
-            break;
-        }
+    case ConversionType::BITCAST:
+        operation = "bitcast";
+        break;
+    case ConversionType::FLOATING:
+        operation = "fptrunc";
+        break;
+    case ConversionType::SIGNED_TO_SIGNED:
+        operation = sourceWidth > destWidth ? "trunc" : "sext";
+        break;
+    case ConversionType::UNSIGNED_TO_UNSIGNED:
+        operation = sourceWidth > destWidth ? "trunc" : "zext";
+        break;
+    case ConversionType::SIGNED_TO_UNSIGNED:
+    case ConversionType::UNSIGNED_TO_SIGNED:
+        // TODO saturation
+        return NO_VALUE;
     }
+    if(auto result = intrinsics::foldConstantOperation(operation, destType, it->second))
+        return result->toValue();
     return NO_VALUE;
 }
 
@@ -790,7 +718,17 @@ void SPIRVInsertionExtraction::mapInstruction(TypeMapping& types, ConstantMappin
     auto index = indicesAreLiteral ? Value(Literal(indices[0]), TYPE_INT8) :
                                      getValue(indices[0], *method.method, types, constants, localTypes, localMapping);
 
-    if(element) // we have source element -> insertions
+    if(intermediate::isSplitStructType(container.type) && index.getLiteralValue())
+    {
+        // small structs are kept in a local per member, so insertion and extraction are only copies of the members
+        if(element)
+            ignoreReturnValue(intermediate::insertStructInsertion(method.method->appendToEnd(), *method.method, dest,
+                container, index.getLiteralValue()->unsignedInt(), *element));
+        else
+            ignoreReturnValue(intermediate::insertStructExtraction(method.method->appendToEnd(), *method.method,
+                container, index.getLiteralValue()->unsignedInt(), dest));
+    }
+    else if(element) // we have source element -> insertions
     {
         CPPLOG_LAZY(logging::Level::DEBUG,
             log << "Generating intermediate insertion of " << element->to_string() << " into element "
@@ -885,6 +823,12 @@ void SPIRVShuffle::mapInstruction(TypeMapping& types, ConstantMapping& constants
 Optional<Value> SPIRVShuffle::precalculate(
     const TypeMapping& types, const ConstantMapping& constants, const LocalMapping& memoryAllocated) const
 {
+    auto first = constants.find(source0);
+    auto second = constants.find(source1);
+    if(compositeIndex || first == constants.end() || second == constants.end())
+        return NO_VALUE;
+    if(auto result = intrinsics::foldConstantShuffle(types.at(typeID), first->second, second->second, indices))
+        return result->toValue();
     return NO_VALUE;
 }
 
@@ -972,62 +916,23 @@ Optional<Value> SPIRVIndexOf::precalculate(
         throw CompilationError(CompilationStep::LLVM_2_IR, "Invalid constant container!");
     }
 
-    std::vector<Value> indexValues;
+    std::vector<CompoundConstant> indexValues;
     indexValues.reserve(indices.size());
-    std::for_each(indices.begin(), indices.end(),
-        [&indexValues, &constants](uint32_t index) { indexValues.push_back(*constants.at(index).toValue()); });
+    for(auto index : indices)
+    {
+        auto it = constants.find(index);
+        if(it == constants.end())
+            return NO_VALUE;
+        indexValues.push_back(it->second);
+    }
 
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Pre-calculating indices of " << container.to_string() << logging::endl);
 
     // TODO regard isPtrAcessChain, if set, type of first index is original type
 
-    Value offset = INT_ZERO;
-    DataType subContainerType = container.type;
-    for(const Value& index : indexValues)
-    {
-        Value subOffset(UNDEFINED_VALUE);
-        if(subContainerType.getPointerType() || subContainerType.getArrayType())
-        {
-            // index is index in pointer/array
-            //-> add offset of element at given index to global offset
-            if(index.getLiteralValue())
-            {
-                subOffset = Value(Literal(index.getLiteralValue()->signedInt() *
-                                      static_cast<int>(subContainerType.getElementType().getInMemoryWidth())),
-                    TYPE_INT32);
-            }
-            else
-            {
-                throw CompilationError(
-                    CompilationStep::LLVM_2_IR, "Invalid index for constant expression", index.to_string());
-            }
-
-            subContainerType = subContainerType.getElementType();
-        }
-        else if(subContainerType.getStructType())
-        {
-            // index is element in struct -> MUST be literal
-            if(!index.getLiteralValue())
-                throw CompilationError(CompilationStep::LLVM_2_IR, "Can't access struct-element with non-literal index",
-                    index.to_string());
-
-            subOffset = Value(Literal(container.type.getStructType()->getStructSize(
-                                  static_cast<int>(index.getLiteralValue()->unsignedInt()))),
-                TYPE_INT32);
-            subContainerType = subContainerType.getElementType(index.getLiteralValue()->signedInt());
-        }
-        else
-            throw CompilationError(CompilationStep::LLVM_2_IR, "Invalid container-type to retrieve element via index",
-                subContainerType.to_string());
-
-        if(offset.checkLiteral() && subOffset.getLiteralValue())
-            offset.literal() = Literal(offset.literal().signedInt() + subOffset.getLiteralValue()->signedInt());
-        else
-            throw CompilationError(
-                CompilationStep::LLVM_2_IR, "Invalid index for constant expression", offset.to_string());
-    }
-
-    return offset;
+    if(auto offset = intrinsics::foldConstantElementOffset(container.type, indexValues))
+        return Value(Literal(*offset), TYPE_INT32);
+    throw CompilationError(CompilationStep::LLVM_2_IR, "Invalid index for constant expression", container.to_string());
 }
 
 SPIRVPhi::SPIRVPhi(const uint32_t id, SPIRVMethod& method, const uint32_t resultType,
@@ -1054,6 +959,21 @@ void SPIRVPhi::mapInstruction(TypeMapping& types, ConstantMapping& constants, Lo
         const Value val = getValue(option.first, *method.method, types, constants, localTypes, localMapping);
         labelPairs.emplace_back(val, source.local());
     }
+    if(intermediate::isSplitStructType(dest.type))
+    {
+        // small structs are kept in a local per member, so we need a phi-node per member
+        for(unsigned i = 0; i < dest.type.getStructType()->elementTypes.size(); ++i)
+        {
+            std::vector<std::pair<Value, const Local*>> memberPairs;
+            memberPairs.reserve(labelPairs.size());
+            for(const auto& pair : labelPairs)
+                memberPairs.emplace_back(
+                    intermediate::getSplitStructMember(*method.method, pair.first, i), pair.second);
+            method.method->appendToEnd(new intermediate::PhiNode(
+                intermediate::getSplitStructMember(*method.method, dest, i), std::move(memberPairs)));
+        }
+        return;
+    }
     method.method->appendToEnd(new intermediate::PhiNode(std::move(dest), std::move(labelPairs)));
 }
 
@@ -1094,6 +1014,19 @@ void SPIRVSelect::mapInstruction(TypeMapping& types, ConstantMapping& constants,
         method.method->appendToEnd(
             new intermediate::MoveOperation(NOP_REGISTER, condition, COND_ALWAYS, SetFlag::SET_FLAGS));
 
+    if(intermediate::isSplitStructType(dest.type))
+    {
+        // small structs are kept in a local per member, so we select every member on its own
+        for(unsigned i = 0; i < dest.type.getStructType()->elementTypes.size(); ++i)
+        {
+            auto member = intermediate::getSplitStructMember(*method.method, dest, i);
+            method.method->appendToEnd(new intermediate::MoveOperation(
+                member, intermediate::getSplitStructMember(*method.method, sourceTrue, i), COND_ZERO_CLEAR));
+            method.method->appendToEnd(new intermediate::MoveOperation(
+                member, intermediate::getSplitStructMember(*method.method, sourceFalse, i), COND_ZERO_SET));
+        }
+        return;
+    }
     method.method->appendToEnd(new intermediate::MoveOperation(dest, sourceTrue, COND_ZERO_CLEAR));
     method.method->appendToEnd(new intermediate::MoveOperation(dest, sourceFalse, COND_ZERO_SET));
 }
@@ -9,6 +9,7 @@
 #ifdef SPIRV_FRONTEND
 
 #include "../Module.h"
+#include "../tools/IdMap.h"
 #include "Optional.h"
 
 #include <map>
@@ -36,11 +37,18 @@ namespace vc4c
             SPIRVMethod(uint32_t id, Module& module) : method(new Method(module)), id(id) {}
         };
 
-        using TypeMapping = std::map<uint32_t, DataType>;
-        using ConstantMapping = std::map<uint32_t, CompoundConstant>;
-        using LocalTypeMapping = std::map<uint32_t, uint32_t>;
+        /*
+         * The mappings of the SPIR-V IDs are queried for every operand of every instruction, so they are stored as
+         * dense tables indexed by the ID (pre-sized to the ID bound of the module).
+         *
+         * The methods are kept in an ordered map, since empty methods are removed and the order of the methods is
+         * retained in the module.
+         */
+        using TypeMapping = tools::IdMap<DataType>;
+        using ConstantMapping = tools::IdMap<CompoundConstant>;
+        using LocalTypeMapping = tools::IdMap<uint32_t>;
         using MethodMapping = std::map<uint32_t, SPIRVMethod>;
-        using LocalMapping = std::map<uint32_t, const Local*>;
+        using LocalMapping = tools::IdMap<const Local*>;
 
         class SPIRVOperation
         {
@@ -53,6 +61,11 @@ namespace vc4c
             virtual Optional<Value> precalculate(const TypeMapping& types, const ConstantMapping& constants,
                 const LocalMapping& memoryAllocated) const = 0;
 
+            const SPIRVMethod& getMethod() const
+            {
+                return method;
+            }
+
         protected:
             const uint32_t id;
             SPIRVMethod& method;
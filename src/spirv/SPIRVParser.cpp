@@ -6,7 +6,10 @@
 
 #include "SPIRVParser.h"
 
+#include "../Profiler.h"
+#include "../ThreadPool.h"
 #include "../intermediate/IntermediateInstruction.h"
+#include "../intrinsics/ConstantFolding.h"
 #include "../intrinsics/Images.h"
 #include "SPIRVBuiltins.h"
 #include "SPIRVHelper.h"
@@ -15,6 +18,9 @@
 #include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
 
 // out-of-line destructor
 vc4c::spirv::SPIRVParser::~SPIRVParser() = default;
@@ -25,7 +31,7 @@ using namespace vc4c;
 using namespace vc4c::spirv;
 
 SPIRVParser::SPIRVParser(std::istream& input, const bool isSPIRVText) :
-    isTextInput(isSPIRVText), input(input), currentMethod(nullptr), module(nullptr)
+    isTextInput(isSPIRVText), input(input), currentMethod(nullptr), currentMethodHasForwardCalls(false), module(nullptr)
 {
 }
 
@@ -86,6 +92,14 @@ void SPIRVParser::parse(Module& module)
             logging::Level::DEBUG, log << "Read SPIR-V binary with " << words.size() << " words" << logging::endl);
     }
 
+    // the declarations do not change and are only parsed to be used as-is, so skip the optimization there
+    if(module.compilationConfig.optimizeSPIRV && !declarationsOnly)
+    {
+        PROFILE_START(OptimizeSPIRV);
+        optimizeSPIRVModule(words);
+        PROFILE_END(OptimizeSPIRV);
+    }
+
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Starting parsing..." << logging::endl);
 
     // parse input
@@ -104,60 +118,28 @@ void SPIRVParser::parse(Module& module)
     CPPLOG_LAZY(logging::Level::DEBUG, log << "SPIR-V binary successfully parsed" << logging::endl);
     spvContextDestroy(context);
 
-    // resolve method parameters
-    // set names, e.g. for methods, parameters
-    for(auto& m : methods)
-    {
-        auto it = names.find(m.first);
-        if(it != names.end())
-            m.second.method->name = it->second;
-        m.second.method->parameters.reserve(m.second.parameters.size());
-        std::istringstream parameterTypeNames{};
-        {
-            // This is e.g. used to specify the original kernel parameter names, at least for more recent clang/SPIR-V
-            // compilers, see
-            // https://github.com/KhronosGroup/SPIRV-LLVM-Translator/blob/5de39350b76246609a2b233e9453e54f48f0a9c6/lib/SPIRV/SPIRVWriter.cpp#L1910
-            // this is in the format "kernel_arg_type.%kernel_name%.typename0,typename1,..."
-            auto searchText = "kernel_arg_type." + m.second.method->name;
-            auto it = std::find_if(
-                strings.begin(), strings.end(), [&](const auto& s) -> bool { return s.find(searchText) == 0; });
-            if(it != strings.end() && it->find('.') != std::string::npos)
-                parameterTypeNames.str(it->substr(it->find_last_of('.') + 1));
-        }
-        for(const auto& pair : m.second.parameters)
-        {
-            auto type = typeMappings.at(pair.second);
-            Parameter param(std::string("%") + std::to_string(pair.first), type);
-            auto it2 = decorationMappings.find(pair.first);
-            if(it2 != decorationMappings.end())
-                setParameterDecorations(param, it2->second);
-            it = names.find(pair.first);
-            if(it != names.end())
-                // parameters are referenced by their IDs, not their names, but for meta-data the names are better
-                param.parameterName = it->second;
-
-            if(param.type.getImageType())
-                intermediate::reserveImageConfiguration(module, param);
-
-            std::string parameterType{};
-            if(parameterTypeNames && std::getline(parameterTypeNames, parameterType, ','))
-                param.origTypeName = parameterType;
-
-            auto& ptr = m.second.method->addParameter(std::move(param));
-            memoryAllocatedData.emplace(pair.first, &ptr);
-        }
-
-        // to support OpenCL built-in operations, we need to demangle all VC4CL std-lib definitions of the OpenCL C
-        // standard functions to be able to map them correctly.
-        m.second.method->name = demangleFunctionName(m.second.method->name);
-    }
-
-    // map SPIRVOperations to IntermediateInstructions
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Mapping instructions to intermediate..." << logging::endl);
-    for(const auto& op : instructions)
-    {
-        op->mapInstruction(typeMappings, constantMappings, localTypes, methods, memoryAllocatedData);
-    }
+    // map the SPIRVOperations of the methods calling methods defined later in the module to IntermediateInstructions,
+    // all other methods are already mapped directly when they were completely parsed
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Mapping " << deferredInstructions.size() << " deferred instructions to intermediate..."
+            << logging::endl);
+    // The bodies of the functions are independent from each other once all module-level mappings are known, so they
+    // can be mapped in parallel
+    using MethodInstructions = std::map<const SPIRVMethod*, std::vector<SPIRVOperation*>>;
+    MethodInstructions methodInstructions;
+    for(const auto& op : deferredInstructions)
+        methodInstructions[&op->getMethod()].emplace_back(op.get());
+    const std::function<void(const MethodInstructions::value_type&)> mapMethod =
+        [&](const MethodInstructions::value_type& entry) {
+            // only the mappings of the local IDs are modified, and only with IDs local to the function
+            LocalTypeMapping methodLocalTypes(localTypes);
+            LocalMapping methodLocals(memoryAllocatedData);
+            for(auto op : entry.second)
+                op->mapInstruction(typeMappings, constantMappings, methodLocalTypes, methods, methodLocals);
+        };
+    ThreadPool::getDefaultPool().scheduleAll<MethodInstructions::value_type, MethodInstructions>(
+        methodInstructions, mapMethod, 1);
+    deferredInstructions.clear();
 
     // apply kernel meta-data, decorations, ...
     for(const auto& pair : metadataMappings)
@@ -184,7 +166,10 @@ void SPIRVParser::parse(Module& module)
     auto it = methods.begin();
     while(it != methods.end())
     {
-        if(it->second.method->countInstructions() == 0)
+        if(declarationsOnly)
+            // none of the methods has a body, so only keep the kernels
+            it = it->second.method->isKernel ? std::next(it) : methods.erase(it);
+        else if(it->second.method->countInstructions() == 0)
             it = methods.erase(it);
         else if(it->second.method->countInstructions() == 1 && it->second.method->begin()->empty())
         {
@@ -206,14 +191,99 @@ void SPIRVParser::parse(Module& module)
     addFunctionAliases(module);
 }
 
+void SPIRVParser::parseDeclarations(Module& module)
+{
+    // The SPIR-V module has no separate declaration section, so the whole input is still parsed, but the (expensive)
+    // mapping of the method bodies to intermediate instructions is skipped
+    declarationsOnly = true;
+    parse(module);
+}
+
+void SPIRVParser::finishMethod(SPIRVMethod& method)
+{
+    // resolve method parameters
+    // set names, e.g. for methods, parameters
+    auto it = names.find(method.id);
+    if(it != names.end())
+        method.method->name = it->second;
+    method.method->parameters.reserve(method.parameters.size());
+    std::istringstream parameterTypeNames{};
+    {
+        // This is e.g. used to specify the original kernel parameter names, at least for more recent clang/SPIR-V
+        // compilers, see
+        // https://github.com/KhronosGroup/SPIRV-LLVM-Translator/blob/5de39350b76246609a2b233e9453e54f48f0a9c6/lib/SPIRV/SPIRVWriter.cpp#L1910
+        // this is in the format "kernel_arg_type.%kernel_name%.typename0,typename1,..."
+        auto searchText = "kernel_arg_type." + method.method->name;
+        auto it = std::find_if(
+            strings.begin(), strings.end(), [&](const auto& s) -> bool { return s.find(searchText) == 0; });
+        if(it != strings.end() && it->find('.') != std::string::npos)
+            parameterTypeNames.str(it->substr(it->find_last_of('.') + 1));
+    }
+    for(const auto& pair : method.parameters)
+    {
+        auto type = typeMappings.at(pair.second);
+        Parameter param(std::string("%") + std::to_string(pair.first), type);
+        auto it2 = decorationMappings.find(pair.first);
+        if(it2 != decorationMappings.end())
+            setParameterDecorations(param, it2->second);
+        it = names.find(pair.first);
+        if(it != names.end())
+            // parameters are referenced by their IDs, not their names, but for meta-data the names are better
+            param.parameterName = it->second;
+
+        if(param.type.getImageType())
+            intermediate::reserveImageConfiguration(*module, param);
+
+        std::string parameterType{};
+        if(parameterTypeNames && std::getline(parameterTypeNames, parameterType, ','))
+            param.origTypeName = parameterType;
+
+        auto& ptr = method.method->addParameter(std::move(param));
+        memoryAllocatedData.emplace(pair.first, &ptr);
+    }
+
+    // to support OpenCL built-in operations, we need to demangle all VC4CL std-lib definitions of the OpenCL C
+    // standard functions to be able to map them correctly.
+    method.method->name = demangleFunctionName(method.method->name);
+    finishedMethods.emplace(method.id);
+
+    if(declarationsOnly)
+        // the method bodies are not required, so they are dropped without being mapped
+        instructions.clear();
+    else if(currentMethodHasForwardCalls)
+    {
+        // the names of the called methods are not yet known, so map the instructions after the whole module is parsed
+        std::move(instructions.begin(), instructions.end(), std::back_inserter(deferredInstructions));
+    }
+    else
+    {
+        // All module-level mappings (types, constants, global data) precede the method definitions and all IDs used
+        // only within this method are known now, so the SPIRVOperations can be mapped to IntermediateInstructions
+        // directly and released again. This way, only the SPIRVOperations of a single method are kept at any time.
+        // The mappings of the local IDs are added to the global mappings, since the IDs are unique within the module
+        // and therefore do not interfere with any other method.
+        for(auto& op : instructions)
+            op->mapInstruction(typeMappings, constantMappings, localTypes, methods, memoryAllocatedData);
+    }
+    instructions.clear();
+    currentMethodHasForwardCalls = false;
+}
+
 spv_result_t SPIRVParser::parseHeader(
     spv_endianness_t endian, uint32_t magic, uint32_t version, uint32_t generator, uint32_t id_bound, uint32_t reserved)
 {
     // see:
     // https://www.khronos.org/registry/spir-v/specs/1.2/SPIRV.html#_a_id_physicallayout_a_physical_layout_of_a_spir_v_module_and_instruction
-    // not completely true, since the header is not mapped to instructions, but still better than increasing every X new
-    // instruction
-    instructions.reserve(id_bound);
+    // all IDs are below the bound, so the ID tables never need to be resized while parsing
+    constantMappings.reserve(id_bound);
+    memoryAllocatedData.reserve(id_bound);
+    typeMappings.reserve(id_bound);
+    sampledImages.reserve(id_bound);
+    decorationMappings.reserve(id_bound);
+    localTypes.reserve(id_bound);
+    metadataMappings.reserve(id_bound);
+    names.reserve(id_bound);
+    extensionConsumers.reserve(id_bound);
 
     return SPV_SUCCESS;
 }
@@ -473,7 +543,8 @@ spv_result_t SPIRVParser::parseInstruction(const spv_parsed_instruction_t* parse
      * Constants are resolved immediately
      * Specializations are immediately mapped to constants
      * Names are resolved immediately
-     * All instructions are enqueued to be mapped later
+     * All other instructions are enqueued to be mapped at the end of their method (or at the end of the module, if
+     * the method calls methods defined later in the module)
      *
      * Only opcodes for supported capabilities (or standard-opcodes) are listed here
      */
@@ -873,9 +944,19 @@ spv_result_t SPIRVParser::parseInstruction(const spv_parsed_instruction_t* parse
         {
             const auto result = calculateConstantOperation(parsed_instruction);
             if(result.first == SPV_SUCCESS && result.second)
-                // FIXME how to get Value to CompoundConstant??
-                // constantMappings.emplace(parsed_instruction->result_id, result.second.value());
-                throw CompilationError(CompilationStep::PARSER, "OpSpecConstantOp is currently not supported!");
+            {
+                // the access chains are pre-calculated to the offset into the container, which is not the value of
+                // the (pointer) constant
+                auto opCode = static_cast<spv::Op>(getWord(parsed_instruction, 3));
+                bool isAccessChain = opCode == spv::Op::OpAccessChain || opCode == spv::Op::OpInBoundsAccessChain ||
+                    opCode == spv::Op::OpPtrAccessChain || opCode == spv::Op::OpInBoundsPtrAccessChain;
+                auto constant = intrinsics::toCompoundConstant(result.second.value());
+                if(isAccessChain || !constant)
+                    throw CompilationError(CompilationStep::PARSER, "OpSpecConstantOp is currently not supported!",
+                        result.second->to_string());
+                constantMappings.emplace(parsed_instruction->result_id, std::move(constant.value()));
+                return SPV_SUCCESS;
+            }
             else if(result.first == SPV_SUCCESS)
                 // can't fall back to inserting the instruction, since there is no method associated with it!
                 throw CompilationError(CompilationStep::PARSER, "Failed to pre-calculate specialization value!");
@@ -900,9 +981,12 @@ spv_result_t SPIRVParser::parseInstruction(const spv_parsed_instruction_t* parse
                 << parsed_instruction->result_id << logging::endl);
         return SPV_SUCCESS;
     case spv::Op::OpFunctionEnd:
+        finishMethod(*currentMethod);
         currentMethod = nullptr;
         return SPV_SUCCESS;
     case spv::Op::OpFunctionCall:
+        if(finishedMethods.find(getWord(parsed_instruction, 3)) == finishedMethods.end())
+            currentMethodHasForwardCalls = true;
         localTypes[parsed_instruction->result_id] = parsed_instruction->type_id;
         instructions.emplace_back(new SPIRVCallSite(parsed_instruction->result_id, *currentMethod,
             getWord(parsed_instruction, 3), parsed_instruction->type_id, parseArguments(parsed_instruction, 4)));
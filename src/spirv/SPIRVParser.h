@@ -32,6 +32,7 @@ namespace vc4c
             ~SPIRVParser() override;
 
             void parse(Module& module) override;
+            void parseDeclarations(Module& module) override;
 
             spv_result_t parseHeader(spv_endianness_t endian, uint32_t magic, uint32_t version, uint32_t generator,
                 uint32_t id_bound, uint32_t reserved);
@@ -60,12 +61,18 @@ namespace vc4c
 
             // whether the input is SPIR-V text representation
             const bool isTextInput;
+            // whether only the declarations of the kernels are read, i.e. the method bodies are not mapped
+            bool declarationsOnly = false;
             // all global methods in the module
             MethodMapping methods;
             // the input stream
             std::istream& input;
             // the currently processed method, only valid while parsing
             SPIRVMethod* currentMethod;
+            // whether the currently processed method calls methods which are not yet completely parsed
+            bool currentMethodHasForwardCalls;
+            // the IDs of the methods which are completely parsed (and whose names are final)
+            FastSet<uint32_t> finishedMethods;
             // the global mapping of ID -> constants
             ConstantMapping constantMappings;
             // the mapping of ID -> global/stack allocated data
@@ -73,25 +80,30 @@ namespace vc4c
             // the global mapping of ID -> type
             TypeMapping typeMappings;
             // the global mapping of ID -> sampled images
-            FastMap<uint32_t, SampledImage> sampledImages;
+            tools::IdMap<SampledImage> sampledImages;
             // the global mapping of ID -> decorations (applied to this ID)
-            FastMap<uint32_t, std::vector<Decoration>> decorationMappings;
+            tools::IdMap<std::vector<Decoration>> decorationMappings;
             // mapping of locals to their types
             LocalTypeMapping localTypes;
-            // the global list of instructions, each instruction stores its own reference to the method it is in
+            // the instructions of the currently processed method, each instruction stores its own reference to the
+            // method it is in
             std::vector<std::unique_ptr<SPIRVOperation>> instructions;
+            // the instructions of all methods which could not be mapped directly after being parsed, since they call
+            // methods defined later in the module
+            std::vector<std::unique_ptr<SPIRVOperation>> deferredInstructions;
             // the global mapping of kernel ID -> meta-data
-            FastMap<uint32_t, std::map<MetaDataType, std::array<uint32_t, 3>>> metadataMappings;
+            tools::IdMap<std::map<MetaDataType, std::array<uint32_t, 3>>> metadataMappings;
             // the global list of custom strings (e.g. kernel original parameter type names)
             FastAccessList<std::string> strings;
             // the global mapping of ID -> name for this ID (e.g. type-, function-name)
-            FastMap<uint32_t, std::string> names;
+            tools::IdMap<std::string> names;
             // the global mapping of ID -> extended instruction set consumer
-            std::unordered_map<uint32_t, spv_result_t (SPIRVParser::*)(const spv_parsed_instruction_t*)>
-                extensionConsumers;
+            tools::IdMap<spv_result_t (SPIRVParser::*)(const spv_parsed_instruction_t*)> extensionConsumers;
 
             Module* module;
 
+            void finishMethod(SPIRVMethod& method);
+
             std::pair<spv_result_t, Optional<Value>> calculateConstantOperation(
                 const spv_parsed_instruction_t* instruction);
 
@@ -0,0 +1,203 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "CompilationError.h"
+#include "tools.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+/*
+ * A single modification of the current timing model, returns whether the timing model was changed
+ */
+using Modification = std::function<bool(TimingModel&)>;
+
+static const std::vector<std::pair<std::string, uint32_t TimingModel::*>> TIMING_PARAMETERS = {
+    {"tmuLatency", &TimingModel::tmuLatency},
+    {"tmuCacheHitLatency", &TimingModel::tmuCacheHitLatency},
+    {"tmuCacheLines", &TimingModel::tmuCacheLines},
+    {"tmuCacheLineSize", &TimingModel::tmuCacheLineSize},
+    {"dmaLatency", &TimingModel::dmaLatency},
+    {"memoryBytesPerCycle", &TimingModel::memoryBytesPerCycle},
+};
+
+TimingModel tools::readTimingModel(std::istream& in)
+{
+    TimingModel model;
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        auto pos = line.find('=');
+        if(pos == std::string::npos)
+            throw CompilationError(CompilationStep::GENERAL, "Invalid line in timing model", line);
+        auto name = line.substr(0, pos);
+        auto paramIt = std::find_if(TIMING_PARAMETERS.begin(), TIMING_PARAMETERS.end(),
+            [&](const std::pair<std::string, uint32_t TimingModel::*>& param) -> bool { return param.first == name; });
+        if(paramIt == TIMING_PARAMETERS.end())
+            throw CompilationError(CompilationStep::GENERAL, "Unknown timing model parameter", name);
+        try
+        {
+            model.*(paramIt->second) = static_cast<uint32_t>(std::stoul(line.substr(pos + 1), nullptr, 0));
+        }
+        catch(const std::exception&)
+        {
+            throw CompilationError(CompilationStep::GENERAL, "Invalid value for timing model parameter", line);
+        }
+    }
+    if(model.tmuCacheLines != 0 && model.tmuCacheLineSize == 0)
+        throw CompilationError(CompilationStep::GENERAL, "The TMU cache line size cannot be zero");
+    return model;
+}
+
+void tools::writeTimingModel(std::ostream& out, const TimingModel& model)
+{
+    for(const auto& param : TIMING_PARAMETERS)
+        out << param.first << '=' << model.*(param.second) << std::endl;
+}
+
+TimingModel tools::createTimingModel(const TargetProfile& target)
+{
+    TimingModel model;
+    // the scheduler latency is the number of instructions between writing the address and triggering the load, which
+    // itself takes another cycle
+    model.tmuLatency = target.tmuLoadLatency + 1;
+    model.tmuCacheHitLatency = std::min(model.tmuCacheHitLatency, model.tmuLatency);
+    model.tmuCacheLines = target.tmuCacheSize / model.tmuCacheLineSize;
+    return model;
+}
+
+static void addParameterModifications(
+    std::vector<Modification>& modifications, uint32_t TimingModel::*parameter, std::initializer_list<uint32_t> values)
+{
+    for(uint32_t value : values)
+    {
+        modifications.emplace_back([parameter, value](TimingModel& model) -> bool {
+            if(model.*parameter == value)
+                return false;
+            model.*parameter = value;
+            return true;
+        });
+    }
+}
+
+static std::vector<Modification> createModifications()
+{
+    std::vector<Modification> modifications;
+    // the bandwidth and the memory latencies affect all memory-bound samples, so fit them first
+    addParameterModifications(modifications, &TimingModel::memoryBytesPerCycle, {0u, 1u, 2u, 4u, 8u, 16u});
+    addParameterModifications(modifications, &TimingModel::tmuLatency, {9u, 12u, 16u, 20u, 24u, 32u, 48u, 64u});
+    addParameterModifications(modifications, &TimingModel::dmaLatency, {12u, 16u, 24u, 32u, 48u, 64u, 96u, 128u});
+    addParameterModifications(modifications, &TimingModel::tmuCacheLines, {0u, 16u, 32u, 64u, 128u});
+    addParameterModifications(modifications, &TimingModel::tmuCacheLineSize, {32u, 64u});
+    addParameterModifications(modifications, &TimingModel::tmuCacheHitLatency, {4u, 6u, 9u, 12u, 16u});
+    return modifications;
+}
+
+/*
+ * Returns the mean relative difference between the emulated and the measured cycles of all samples or a negative value
+ * if any sample could not be emulated with the given timing model
+ */
+static double calculateError(const CalibrationData& data,
+    const std::vector<std::unique_ptr<PreparedKernel>>& kernels, const TimingModel& model)
+{
+    double error = 0.0;
+    for(std::size_t i = 0; i < data.samples.size(); ++i)
+    {
+        EmulationData emulation = data.samples[i].emulation;
+        emulation.memoryDump.clear();
+        emulation.instrumentationDump.clear();
+        emulation.profileDump.clear();
+        emulation.hotspotDump.clear();
+        emulation.checkpointFile.clear();
+        emulation.resumeCheckpoint.clear();
+        emulation.cycleAccurate = true;
+        emulation.timing = model;
+        auto result = kernels[i]->run(emulation);
+        if(!result.executionSuccessful)
+            return -1.0;
+        auto measured = static_cast<double>(data.samples[i].measuredCycles);
+        error += std::abs(static_cast<double>(result.numCycles) - measured) / measured;
+    }
+    return error / static_cast<double>(data.samples.size());
+}
+
+CalibrationResult tools::calibrateTimingModel(const CalibrationData& data)
+{
+    if(data.samples.empty())
+        throw CompilationError(CompilationStep::GENERAL, "Calibration requires at least a single sample");
+    if(data.maxTrials == 0)
+        throw CompilationError(CompilationStep::GENERAL, "Calibration requires at least a single trial");
+
+    // the kernels are only extracted once and then emulated for every tried timing model
+    std::vector<std::unique_ptr<PreparedKernel>> kernels;
+    kernels.reserve(data.samples.size());
+    for(const auto& sample : data.samples)
+    {
+        if(sample.measuredCycles == 0)
+            throw CompilationError(CompilationStep::GENERAL, "Calibration sample has no measured cycles",
+                sample.emulation.kernelName);
+        kernels.emplace_back(new PreparedKernel(sample.emulation));
+    }
+
+    CalibrationResult result;
+    result.model = data.baseModel;
+    result.baseError = result.error = calculateError(data, kernels, result.model);
+    ++result.numTrials;
+    if(result.baseError < 0.0)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to emulate the samples with the base timing model");
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Calibrating timing model for " << data.samples.size() << " samples starting with an error of "
+            << result.baseError << logging::endl);
+
+    // Greedily apply every single modification to the best timing model found so far and keep it, if it reduces the
+    // error. This is repeated until no modification improves the timing model or the trials are used up.
+    const auto modifications = createModifications();
+    bool improved = true;
+    while(improved && result.numTrials < data.maxTrials)
+    {
+        improved = false;
+        for(const auto& modification : modifications)
+        {
+            if(result.numTrials >= data.maxTrials)
+                break;
+            auto model = result.model;
+            if(!modification(model))
+                continue;
+            auto error = calculateError(data, kernels, model);
+            ++result.numTrials;
+            if(error < 0.0)
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Rejecting timing model exceeding the maximum emulation cycles" << logging::endl);
+                continue;
+            }
+            if(error < result.error)
+            {
+                CPPLOG_LAZY(logging::Level::INFO,
+                    log << "Reduced error from " << result.error << " to " << error << logging::endl);
+                result.model = model;
+                result.error = error;
+                improved = true;
+            }
+        }
+    }
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Calibrated timing model from an error of " << result.baseError << " to " << result.error << " in "
+            << result.numTrials << " trials" << logging::endl);
+    return result;
+}
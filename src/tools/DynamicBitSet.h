@@ -0,0 +1,171 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /**
+         * Set of non-negative integers (e.g. the dense indices of locals or instructions, see IndexTable) stored as a
+         * bit-mask of variable size.
+         *
+         * In contrast to a hash-set of pointers, the set operations (union, intersection, difference) operate on whole
+         * machine words and therefore are much faster for the big sets of locals occurring in large kernels.
+         *
+         * The set grows automatically when elements out of the current range are inserted, sets of different sizes
+         * can be combined.
+         */
+        class DynamicBitSet
+        {
+            using Word = uint64_t;
+            static constexpr std::size_t BITS_PER_WORD = sizeof(Word) * 8;
+
+        public:
+            explicit DynamicBitSet(std::size_t numBits = 0) : words((numBits + BITS_PER_WORD - 1) / BITS_PER_WORD, 0)
+            {
+            }
+
+            /*
+             * Inserts the given element, returns whether the element was not in the set before
+             */
+            bool insert(std::size_t index)
+            {
+                if(index / BITS_PER_WORD >= words.size())
+                    words.resize(index / BITS_PER_WORD + 1, 0);
+                auto& word = words[index / BITS_PER_WORD];
+                auto mask = Word{1} << (index % BITS_PER_WORD);
+                bool isNew = (word & mask) == 0;
+                word |= mask;
+                return isNew;
+            }
+
+            /*
+             * Removes the given element, returns whether the element was in the set
+             */
+            bool erase(std::size_t index) noexcept
+            {
+                if(index / BITS_PER_WORD >= words.size())
+                    return false;
+                auto& word = words[index / BITS_PER_WORD];
+                auto mask = Word{1} << (index % BITS_PER_WORD);
+                bool wasSet = (word & mask) != 0;
+                word &= ~mask;
+                return wasSet;
+            }
+
+            bool contains(std::size_t index) const noexcept
+            {
+                if(index / BITS_PER_WORD >= words.size())
+                    return false;
+                return (words[index / BITS_PER_WORD] & (Word{1} << (index % BITS_PER_WORD))) != 0;
+            }
+
+            bool empty() const noexcept
+            {
+                return std::all_of(words.begin(), words.end(), [](Word w) -> bool { return w == 0; });
+            }
+
+            /*
+             * Returns the number of elements in this set
+             */
+            std::size_t size() const noexcept
+            {
+                std::size_t count = 0;
+                for(auto word : words)
+                    count += static_cast<std::size_t>(__builtin_popcountll(word));
+                return count;
+            }
+
+            void clear() noexcept
+            {
+                std::fill(words.begin(), words.end(), Word{0});
+            }
+
+            /*
+             * Inserts all elements of the other set into this set (set union), returns whether any new element was
+             * inserted
+             */
+            bool insertAll(const DynamicBitSet& other)
+            {
+                if(other.words.size() > words.size())
+                    words.resize(other.words.size(), 0);
+                Word changed = 0;
+                for(std::size_t i = 0; i < other.words.size(); ++i)
+                {
+                    changed |= other.words[i] & ~words[i];
+                    words[i] |= other.words[i];
+                }
+                return changed != 0;
+            }
+
+            /*
+             * Removes all elements of the other set from this set (set difference)
+             */
+            void eraseAll(const DynamicBitSet& other) noexcept
+            {
+                auto numWords = std::min(words.size(), other.words.size());
+                for(std::size_t i = 0; i < numWords; ++i)
+                    words[i] &= ~other.words[i];
+            }
+
+            /*
+             * Removes all elements not in the other set from this set (set intersection)
+             */
+            void retainAll(const DynamicBitSet& other) noexcept
+            {
+                for(std::size_t i = 0; i < words.size(); ++i)
+                    words[i] &= i < other.words.size() ? other.words[i] : Word{0};
+            }
+
+            /*
+             * Executes the given consumer for all elements of this set in ascending order
+             */
+            template <typename Func>
+            void forAll(Func&& consumer) const
+            {
+                for(std::size_t i = 0; i < words.size(); ++i)
+                {
+                    auto word = words[i];
+                    while(word != 0)
+                    {
+                        auto bit = static_cast<std::size_t>(__builtin_ctzll(word));
+                        consumer(i * BITS_PER_WORD + bit);
+                        // clear lowest set bit
+                        word &= word - 1;
+                    }
+                }
+            }
+
+            bool operator==(const DynamicBitSet& other) const noexcept
+            {
+                auto numWords = std::max(words.size(), other.words.size());
+                for(std::size_t i = 0; i < numWords; ++i)
+                {
+                    auto left = i < words.size() ? words[i] : Word{0};
+                    auto right = i < other.words.size() ? other.words[i] : Word{0};
+                    if(left != right)
+                        return false;
+                }
+                return true;
+            }
+
+            bool operator!=(const DynamicBitSet& other) const noexcept
+            {
+                return !(*this == other);
+            }
+
+        private:
+            std::vector<Word> words;
+        };
+    } // namespace tools
+} // namespace vc4c
@@ -7,7 +7,10 @@
 #include "Emulator.h"
 
 #include "../GlobalValues.h"
+#include "../Logging.h"
 #include "../Profiler.h"
+#include "../ThreadPool.h"
+#include "../analysis/ExecutionProfile.h"
 #include "../asm/ALUInstruction.h"
 #include "../asm/BranchInstruction.h"
 #include "../asm/Instruction.h"
@@ -19,14 +22,18 @@
 #include "CompilationError.h"
 #include "Compiler.h"
 
-#include "log.h"
-
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <exception>
 #include <fstream>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <random>
+#include <type_traits>
 
 using namespace vc4c;
 using namespace vc4c::tools;
@@ -49,88 +56,124 @@ tools::Word EmulationData::calcNumWorkItems() const
         workGroup.numGroups[1] * workGroup.numGroups[2];
 }
 
-tools::Word* Memory::getWordAddress(MemoryAddress address)
+// the size of the pages of the address translation table (4 KB)
+static constexpr unsigned MEMORY_PAGE_BITS = 12;
+
+Memory::Memory(std::size_t size) : directBuffer(size, 0xDEADBEEF)
+{
+    addRegion(0, reinterpret_cast<uint8_t*>(directBuffer.data()), directBuffer.size() * sizeof(Word));
+    profiler::trackMemory(profiler::MemoryCategory::EMULATOR, static_cast<int64_t>(directBuffer.size() * sizeof(Word)));
+}
+
+Memory::Memory(const std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>& buffers)
+{
+    for(const auto& buffer : buffers)
+        addRegion(buffer.first, buffer.second.get().data(), buffer.second.get().size());
+}
+
+Memory::~Memory() noexcept
+{
+    // the mapped buffers are owned by the caller
+    profiler::trackMemory(
+        profiler::MemoryCategory::EMULATOR, -static_cast<int64_t>(directBuffer.size() * sizeof(Word)));
+}
+
+void Memory::mapBuffer(MemoryAddress address, uint8_t* data, std::size_t numBytes)
+{
+    addRegion(address, data, numBytes);
+}
+
+void Memory::reset(std::size_t size)
+{
+    regions.clear();
+    pageTable.clear();
+    profiler::trackMemory(profiler::MemoryCategory::EMULATOR,
+        static_cast<int64_t>(size * sizeof(Word)) - static_cast<int64_t>(directBuffer.size() * sizeof(Word)));
+    directBuffer.assign(size, 0xDEADBEEF);
+    addRegion(0, reinterpret_cast<uint8_t*>(directBuffer.data()), directBuffer.size() * sizeof(Word));
+}
+
+void Memory::addRegion(MemoryAddress address, uint8_t* data, std::size_t numBytes)
 {
-    if(auto direct = VariantNamespace::get_if<DirectBuffer>(&data))
+    if(numBytes == 0)
+        return;
+    Region region{address, static_cast<MemoryAddress>(address + numBytes), data};
+    auto it = std::upper_bound(regions.begin(), regions.end(), region,
+        [](const Region& one, const Region& other) -> bool { return one.start < other.start; });
+    if((it != regions.end() && it->start < region.end) || (it != regions.begin() && std::prev(it)->end > address))
+        throw CompilationError(
+            CompilationStep::GENERAL, "Mapped memory buffers overlap at address", std::to_string(address));
+    regions.insert(it, region);
+
+    const auto firstAddress = regions.front().start;
+    const auto numPages = ((regions.back().end - 1 - firstAddress) >> MEMORY_PAGE_BITS) + 1;
+    pageTable.assign(numPages, 0);
+    uint32_t index = 0;
+    for(std::size_t page = 0; page < numPages; ++page)
     {
-        if(address >= direct->size() * sizeof(Word))
-        {
-            logging::warn() << "Buffer: [0, " << std::hex << direct->size() << std::dec << ")" << logging::endl;
-            throw CompilationError(CompilationStep::GENERAL,
-                "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
-        }
-        return direct->data() + (address / sizeof(Word));
+        auto pageStart = firstAddress + static_cast<MemoryAddress>(page << MEMORY_PAGE_BITS);
+        while(index < regions.size() && regions[index].end <= pageStart)
+            ++index;
+        pageTable[page] = index;
     }
-    auto& buffers = VariantNamespace::get<MappedBuffers>(data);
-    if(address >= (buffers.rbegin()->first + buffers.rbegin()->second.get().size()))
+}
+
+const Memory::Region* Memory::findRegion(MemoryAddress address) const
+{
+    if(regions.empty() || address < regions.front().start)
+        return nullptr;
+    auto page = static_cast<std::size_t>((address - regions.front().start) >> MEMORY_PAGE_BITS);
+    if(page >= pageTable.size())
+        return nullptr;
+    // only the regions overlapping the same page need to be checked
+    for(auto index = pageTable[page]; index < regions.size() && regions[index].start <= address; ++index)
     {
-        logging::logLazy(logging::Level::WARNING, [&]() {
-            for(const auto& buffer : buffers)
-                logging::warn() << "Buffer: [" << std::hex << buffer.first << ", "
-                                << (buffer.first + buffer.second.get().size()) << std::dec << ")" << logging::endl;
-        });
-        throw CompilationError(CompilationStep::GENERAL,
-            "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
-    }
-    for(const auto& buf : buffers)
-    {
-        if(buf.first <= address && (buf.first + buf.second.get().size()) > address)
-        {
-            auto wordBoundsAddress = (address / sizeof(Word)) * sizeof(Word);
-            return reinterpret_cast<Word*>(buf.second.get().data() + wordBoundsAddress - buf.first);
-        }
+        if(address < regions[index].end)
+            return &regions[index];
     }
+    return nullptr;
+}
+
+void Memory::throwInvalidAccess(MemoryAddress address, const std::string& message) const
+{
     logging::logLazy(logging::Level::WARNING, [&]() {
-        for(const auto& buffer : buffers)
-            logging::warn() << "Buffer: [" << std::hex << buffer.first << ", "
-                            << (buffer.first + buffer.second.get().size()) << std::dec << ")" << logging::endl;
+        for(const auto& region : regions)
+            logging::warn() << "Buffer: [" << std::hex << region.start << ", " << region.end << std::dec << ")"
+                            << logging::endl;
     });
-    throw CompilationError(CompilationStep::GENERAL, "Address is not part of any buffer", std::to_string(address));
+    throw CompilationError(CompilationStep::GENERAL, message, std::to_string(address));
+}
+
+tools::Word* Memory::getWordAddress(MemoryAddress address)
+{
+    return const_cast<Word*>(static_cast<const Memory&>(*this).getWordAddress(address));
 }
 
 const tools::Word* Memory::getWordAddress(MemoryAddress address) const
 {
-    if(auto direct = VariantNamespace::get_if<DirectBuffer>(&data))
-    {
-        if(address >= direct->size() * sizeof(Word))
-        {
-            logging::warn() << "Buffer: [0, " << std::hex << direct->size() << std::dec << ")" << logging::endl;
-            throw CompilationError(CompilationStep::GENERAL,
-                "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
-        }
-        return direct->data() + (address / sizeof(Word));
-    }
-    auto& buffers = VariantNamespace::get<MappedBuffers>(data);
-    if(address >= (buffers.rbegin()->first + buffers.rbegin()->second.get().size()))
-    {
-        logging::logLazy(logging::Level::WARNING, [&]() {
-            for(const auto& buffer : buffers)
-                logging::warn() << "Buffer: [" << std::hex << buffer.first << ", "
-                                << (buffer.first + buffer.second.get().size()) << std::dec << ")" << logging::endl;
-        });
-        throw CompilationError(CompilationStep::GENERAL,
-            "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
-    }
-    for(const auto& buf : buffers)
-    {
-        if(buf.first <= address && (buf.first + buf.second.get().size()) > address)
-        {
-            auto wordBoundsAddress = (address / sizeof(Word)) * sizeof(Word);
-            return reinterpret_cast<const Word*>(buf.second.get().data() + wordBoundsAddress - buf.first);
-        }
-    }
-    logging::logLazy(logging::Level::WARNING, [&]() {
-        for(const auto& buffer : buffers)
-            logging::warn() << "Buffer: [" << std::hex << buffer.first << ", "
-                            << (buffer.first + buffer.second.get().size()) << std::dec << ")" << logging::endl;
-    });
-    throw CompilationError(CompilationStep::GENERAL, "Address is not part of any buffer", std::to_string(address));
+    auto wordBoundsAddress = (address / sizeof(Word)) * sizeof(Word);
+    return reinterpret_cast<const Word*>(getBytes(static_cast<MemoryAddress>(wordBoundsAddress), 1));
+}
+
+uint8_t* Memory::getBytes(MemoryAddress address, std::size_t numBytes)
+{
+    return const_cast<uint8_t*>(static_cast<const Memory&>(*this).getBytes(address, numBytes));
+}
+
+const uint8_t* Memory::getBytes(MemoryAddress address, std::size_t numBytes) const
+{
+    auto region = findRegion(address);
+    if(!region)
+        throwInvalidAccess(address, "Address is not part of any buffer");
+    if(numBytes > region->end - address)
+        throwInvalidAccess(address, "Memory address is out of bounds, consider using larger buffer");
+    return region->data + (address - region->start);
 }
 
 tools::Word Memory::readWord(MemoryAddress address) const
 {
     if(address % sizeof(Word) != 0)
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "Reading word from non-word-aligned memory location will be truncated to align with "
                    "word-boundaries: "
                 << address << logging::endl);
@@ -144,18 +187,167 @@ MemoryAddress Memory::incrementAddress(MemoryAddress address, DataType typeSize)
 
 MemoryAddress Memory::getMaximumAddress() const
 {
-    if(auto direct = VariantNamespace::get_if<DirectBuffer>(&data))
-        return static_cast<MemoryAddress>(direct->size() * sizeof(Word));
-    return VariantNamespace::get<MappedBuffers>(data).rbegin()->first +
-        static_cast<Word>(VariantNamespace::get<MappedBuffers>(data).begin()->second.get().size());
+    return regions.empty() ? 0 : regions.back().end;
+}
+
+bool Memory::isValidAddress(MemoryAddress address) const
+{
+    return findRegion(address) != nullptr;
 }
 
 void Memory::setUniforms(const std::vector<Word>& uniforms, MemoryAddress address)
 {
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 10, "setUniforms", 1);
-    std::size_t offset = address / sizeof(Word);
     std::copy_n(uniforms.begin(), uniforms.size(),
-        VariantNamespace::get<DirectBuffer>(data).begin() + static_cast<std::vector<Word>::difference_type>(offset));
+        reinterpret_cast<Word*>(getBytes(address, uniforms.size() * sizeof(Word))));
+}
+
+uint32_t MemoryBus::transfer(uint32_t cycle, uint32_t numBytes)
+{
+    if(bytesPerCycle == 0)
+        return cycle;
+    busyUntil = std::max(busyUntil, cycle) + (numBytes + bytesPerCycle - 1) / bytesPerCycle;
+    return busyUntil;
+}
+
+void MemoryTrace::record(const Access& access)
+{
+    std::lock_guard<std::mutex> guard(accessLock);
+    accesses.push_back(access);
+}
+
+std::vector<MemoryTrace::Access> MemoryTrace::getAccesses() const
+{
+    std::vector<Access> result;
+    {
+        std::lock_guard<std::mutex> guard(accessLock);
+        result = accesses;
+    }
+    // the QPUs running ahead of each other (see emulateParallel()) record their accesses out of order
+    std::stable_sort(result.begin(), result.end(), [](const Access& one, const Access& other) -> bool {
+        return one.cycle < other.cycle || (one.cycle == other.cycle && one.qpu < other.qpu);
+    });
+    return result;
+}
+
+static std::string toTraceName(MemoryTrace::AccessType type)
+{
+    switch(type)
+    {
+    case MemoryTrace::AccessType::TMU_LOAD:
+        return "tmu_load";
+    case MemoryTrace::AccessType::DMA_LOAD:
+        return "dma_load";
+    case MemoryTrace::AccessType::DMA_STORE:
+        return "dma_store";
+    case MemoryTrace::AccessType::VPM_READ_SETUP:
+        return "vpm_read_setup";
+    case MemoryTrace::AccessType::VPM_WRITE_SETUP:
+        return "vpm_write_setup";
+    }
+    throw CompilationError(CompilationStep::GENERAL, "Unhandled memory access type");
+}
+
+static std::string toTraceName(MemoryTrace::AccessPattern pattern)
+{
+    switch(pattern)
+    {
+    case MemoryTrace::AccessPattern::CONTIGUOUS:
+        return "contiguous";
+    case MemoryTrace::AccessPattern::STRIDED:
+        return "strided";
+    case MemoryTrace::AccessPattern::GATHER:
+        return "gather";
+    }
+    throw CompilationError(CompilationStep::GENERAL, "Unhandled memory access pattern");
+}
+
+void MemoryTrace::writeReport(std::ostream& out, uint32_t numCycles) const
+{
+    struct TypeSummary
+    {
+        unsigned numAccesses = 0;
+        uint64_t numBytes = 0;
+        uint64_t latencies = 0;
+        // the number of accesses per AccessPattern
+        std::array<unsigned, 3> patterns{};
+    };
+    struct TMUSummary
+    {
+        unsigned numLoads = 0;
+        uint32_t busyCycles = 0;
+        // the end of the cycles already counted as busy, the loads are issued in order of their cycles
+        uint32_t busyUntil = 0;
+    };
+
+    const auto accesses = getAccesses();
+    std::map<AccessType, TypeSummary> types;
+    // the TMUs are shared by all QPUs of a slice, indexed by slice and TMU number
+    std::map<std::pair<unsigned, unsigned>, TMUSummary> tmus;
+    unsigned numSmallDMALoads = 0;
+    for(const auto& access : accesses)
+    {
+        auto& summary = types[access.type];
+        ++summary.numAccesses;
+        summary.numBytes += access.numBytes;
+        summary.latencies += access.doneCycle - access.cycle;
+        ++summary.patterns[static_cast<unsigned>(access.pattern)];
+        if(access.type == AccessType::DMA_LOAD && access.numBytes < NATIVE_VECTOR_SIZE * sizeof(Word))
+            ++numSmallDMALoads;
+        if(access.type != AccessType::TMU_LOAD)
+            continue;
+        auto& tmu = tmus[std::make_pair(access.qpu / 4u, static_cast<unsigned>(access.unit))];
+        ++tmu.numLoads;
+        auto start = std::max(access.cycle, tmu.busyUntil);
+        if(access.doneCycle > start)
+        {
+            tmu.busyCycles += access.doneCycle - start;
+            tmu.busyUntil = access.doneCycle;
+        }
+    }
+
+    const double cycles = std::max(numCycles, 1u);
+    uint64_t totalBytes = 0;
+    out << "# Memory accesses of " << numCycles << " cycles" << std::endl;
+    for(const auto& entry : types)
+    {
+        const auto& summary = entry.second;
+        // the VPM setups do not transfer any data from or to the memory
+        if(entry.first != AccessType::VPM_READ_SETUP && entry.first != AccessType::VPM_WRITE_SETUP)
+            totalBytes += summary.numBytes;
+        out << "# " << toTraceName(entry.first) << ": " << summary.numAccesses << " accesses, " << summary.numBytes
+            << " bytes, " << (static_cast<double>(summary.numBytes) / cycles) << " bytes/cycle, "
+            << (static_cast<double>(summary.latencies) / summary.numAccesses) << " cycles average latency, "
+            << summary.patterns[0] << " contiguous, " << summary.patterns[1] << " strided, " << summary.patterns[2]
+            << " gather" << std::endl;
+    }
+    out << "# total: " << totalBytes << " bytes, " << (static_cast<double>(totalBytes) / cycles) << " bytes/cycle"
+        << std::endl;
+    for(const auto& entry : tmus)
+    {
+        out << "# TMU" << entry.first.second << " of slice " << entry.first.first << ": " << entry.second.numLoads
+            << " loads, " << entry.second.busyCycles << " busy cycles, "
+            << (100.0 * entry.second.busyCycles / cycles) << "% utilization" << std::endl;
+    }
+
+    // hints on the memory lowering (see MemoryAccessType) which would have matched the access patterns better
+    auto tmuLoads = types.find(AccessType::TMU_LOAD);
+    if(tmuLoads != types.end() && tmuLoads->second.patterns[0] != 0)
+        out << "# hint: " << tmuLoads->second.patterns[0]
+            << " TMU loads read contiguous memory and could be combined into DMA loads (RAM_READ_WRITE_VPM)"
+            << std::endl;
+    if(numSmallDMALoads != 0)
+        out << "# hint: " << numSmallDMALoads
+            << " DMA loads transfer less than a vector and could be loaded via TMU (RAM_LOAD_TMU)" << std::endl;
+
+    out << "# cycle qpu type tmu address bytes stride pattern done" << std::endl;
+    for(const auto& access : accesses)
+    {
+        out << access.cycle << ' ' << static_cast<unsigned>(access.qpu) << ' ' << toTraceName(access.type) << ' '
+            << static_cast<unsigned>(access.unit) << " 0x" << std::hex << access.address << std::dec << ' '
+            << access.numBytes << ' ' << access.stride << ' ' << toTraceName(access.pattern) << ' ' << access.doneCycle
+            << std::endl;
+    }
 }
 
 bool Mutex::isLocked() const
@@ -207,7 +399,7 @@ LCOV_EXCL_STOP
 
 void Registers::writeRegister(Register reg, const SIMDVector& val, std::bitset<16> elementMask, BitMask bitMask)
 {
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Writing into register '" << reg.to_string(true, false)
             << "': " << toRegisterWriteString(val, elementMask) << logging::endl);
     if(reg.isGeneralPurpose())
@@ -238,13 +430,13 @@ void Registers::writeRegister(Register reg, const SIMDVector& val, std::bitset<1
     else if(reg.num == REG_VPM_IO.num)
         qpu.vpm.writeValue(val);
     else if(reg == REG_VPM_IN_SETUP)
-        qpu.vpm.setReadSetup(val);
+        qpu.vpm.setReadSetup(qpu.ID, val);
     else if(reg == REG_VPM_OUT_SETUP)
-        qpu.vpm.setWriteSetup(val);
+        qpu.vpm.setWriteSetup(qpu.ID, val);
     else if(reg == REG_VPM_DMA_LOAD_ADDR)
-        qpu.vpm.setDMAReadAddress(val);
+        qpu.vpm.setDMAReadAddress(qpu.ID, val);
     else if(reg == REG_VPM_DMA_STORE_ADDR)
-        qpu.vpm.setDMAWriteAddress(val);
+        qpu.vpm.setDMAWriteAddress(qpu.ID, val);
     else if(reg.num == REG_MUTEX.num)
         qpu.mutex.unlock(qpu.ID);
     else if(reg.num == REG_SFU_RECIP.num)
@@ -290,19 +482,18 @@ std::pair<SIMDVector, bool> Registers::readRegister(Register reg, bool anyElemen
     {
     case REG_SFU_OUT.num:
     {
-        auto it = readCache.find(REG_SFU_OUT);
-        if(it != readCache.end())
-            return std::make_pair(it->second, true);
+        if(auto cached = getReadCache(REG_SFU_OUT))
+            return std::make_pair(*cached, true);
         auto pair = qpu.readR4();
-        ignoreReturnValue(setReadCache(REG_SFU_OUT, pair.first));
+        setReadCache(REG_SFU_OUT, pair.first);
         return pair;
     }
     case REG_UNIFORM.num:
     {
-        auto it = readCache.find(REG_UNIFORM);
-        if(it == readCache.end())
-            it = setReadCache(REG_UNIFORM, qpu.uniforms.readUniform());
-        return std::make_pair(it->second, true);
+        auto cached = getReadCache(REG_UNIFORM);
+        if(!cached)
+            cached = &setReadCache(REG_UNIFORM, qpu.uniforms.readUniform());
+        return std::make_pair(*cached, true);
     }
     case REG_VARYING.num:
     {
@@ -350,10 +541,10 @@ std::pair<SIMDVector, bool> Registers::readRegister(Register reg, bool anyElemen
         return std::make_pair(readStorageRegister(reg, anyElementUsed), true);
     case REG_VPM_IO.num:
     {
-        auto it = readCache.find(REG_VPM_IO);
-        if(it == readCache.end())
-            it = setReadCache(REG_VPM_IO, qpu.vpm.readValue());
-        return std::make_pair(it->second, true);
+        auto cached = getReadCache(REG_VPM_IO);
+        if(!cached)
+            cached = &setReadCache(REG_VPM_IO, qpu.vpm.readValue());
+        return std::make_pair(*cached, true);
     }
     case REG_VPM_DMA_LOAD_WAIT.num:
         if(reg == REG_VPM_DMA_LOAD_WAIT)
@@ -364,11 +555,11 @@ std::pair<SIMDVector, bool> Registers::readRegister(Register reg, bool anyElemen
         break;
     case REG_MUTEX.num:
     {
-        auto it = readCache.find(REG_MUTEX);
-        if(it == readCache.end())
-            it = setReadCache(
+        auto cached = getReadCache(REG_MUTEX);
+        if(!cached)
+            cached = &setReadCache(
                 REG_MUTEX, qpu.mutex.lock(qpu.ID) ? SIMDVector(Literal(true)) : SIMDVector(Literal(false)));
-        return std::make_pair(it->second, it->second[0].isTrue());
+        return std::make_pair(*cached, (*cached)[0].isTrue());
     }
     }
     throw CompilationError(CompilationStep::GENERAL, "Read of invalid register", reg.to_string());
@@ -383,7 +574,13 @@ SIMDVector Registers::getInterruptValue() const
 
 void Registers::clearReadCache()
 {
-    readCache.clear();
+    // invalidates all entries written with the previous generation
+    if(++readCacheGeneration == 0)
+    {
+        // on overflow, the entries of the initial generation would become valid again
+        readCache.fill(std::make_pair(SIMDVector{}, 0u));
+        readCacheGeneration = 1;
+    }
 }
 
 static constexpr uint8_t toIndex(Register reg) noexcept
@@ -405,7 +602,7 @@ SIMDVector Registers::readStorageRegister(Register reg, bool anyElementUsed)
             // for ALU operations which are not actually executed (e.g. flags do not match), we can return a dummy value
             return SIMDVector{};
     }
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Reading from register '" << reg.to_string(true, true) << "': " << vec.first.to_string(true)
             << logging::endl);
     if(reg.isGeneralPurpose() && qpu.currentCycle - 1 <= vec.second)
@@ -414,19 +611,20 @@ SIMDVector Registers::readStorageRegister(Register reg, bool anyElementUsed)
     return vec.first;
 }
 
-static SIMDVector toStorageValue(
-    const SIMDVector& oldVal, const SIMDVector& newVal, std::bitset<16> elementMask, BitMask bitMask)
+static void writeStorageValue(
+    SIMDVector& storage, const SIMDVector& newVal, std::bitset<16> elementMask, BitMask bitMask)
 {
     if(elementMask.all())
-        return newVal;
-    if(elementMask.none())
-        return oldVal;
-    SIMDVector result;
-    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        storage = newVal;
+    else if(elementMask.any())
     {
-        result[i] = elementMask.test(i) ? bitMask(newVal[i], oldVal[i]) : oldVal[i];
+        // only the lanes written are modified in place, all other lanes retain their old value
+        for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            if(elementMask.test(i))
+                storage[i] = bitMask(newVal[i], storage[i]);
+        }
     }
-    return result;
 }
 
 void Registers::writeStorageRegister(Register reg, SIMDVector&& val, std::bitset<16> elementMask, BitMask bitMask)
@@ -445,8 +643,9 @@ void Registers::writeStorageRegister(Register reg, SIMDVector&& val, std::bitset
         // actual value stored is truncated to lowest 1 Bit and replicated across all elements
         val = SIMDVector(Literal(val[0].unsignedInt() & 1));
     }
-    auto& vec = storageRegisters.at(toIndex(reg)) = std::make_pair(
-        toStorageValue(storageRegisters.at(toIndex(reg)).first, val, elementMask, bitMask), qpu.currentCycle);
+    auto& vec = storageRegisters.at(toIndex(reg));
+    writeStorageValue(vec.first, val, elementMask, bitMask);
+    vec.second = qpu.currentCycle;
     if(reg.num == REG_REPLICATE_ALL.num && elementMask.any())
     {
         // TODO if some flags are set, but not the 0th (or 0th, 4th, 8th and 12th), need to retain old value?
@@ -472,13 +671,18 @@ void Registers::writeStorageRegister(Register reg, SIMDVector&& val, std::bitset
     }
 }
 
-SortedMap<Register, SIMDVector>::iterator Registers::setReadCache(Register reg, const SIMDVector& val)
+const SIMDVector* Registers::getReadCache(Register reg) const
+{
+    const auto& entry = readCache[reg.num];
+    return entry.second == readCacheGeneration ? &entry.first : nullptr;
+}
+
+const SIMDVector& Registers::setReadCache(Register reg, const SIMDVector& val)
 {
-    auto it = readCache.find(reg);
-    if(it == readCache.end())
-        return readCache.emplace(reg, val).first;
-    it->second = val;
-    return it;
+    auto& entry = readCache[reg.num];
+    entry.first = val;
+    entry.second = readCacheGeneration;
+    return entry.first;
 }
 
 SIMDVector UniformCache::readUniform()
@@ -489,7 +693,7 @@ SIMDVector UniformCache::readUniform()
     SIMDVector val(Literal(memory.readWord(uniformAddress)));
     // do not increment UNIFORM pointer for multiple reads in same instruction
     uniformAddress = memory.incrementAddress(uniformAddress, TYPE_INT32);
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Reading UNIFORM value: " << val.to_string(true) << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Reading UNIFORM value: " << val.to_string(true) << logging::endl);
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 40, "UNIFORM read", 1);
     return val;
 }
@@ -498,7 +702,7 @@ void UniformCache::setUniformAddress(const SIMDVector& val)
 {
     // only first element is used, see Broadcom specification, page 22
     uniformAddress = val[0].toImmediate();
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Reset UNIFORM address to: " << uniformAddress << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Reset UNIFORM address to: " << uniformAddress << logging::endl);
     lastAddressSetCycle = qpu.getCurrentCycle();
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 50, "write UNIFORM address", 1);
 }
@@ -545,7 +749,7 @@ std::pair<SIMDVector, bool> TMUs::readTMU()
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 68, "TMU0 read", 1);
     else
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 69, "TMU1 read", 1);
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Reading from TMU: " << front.first.to_string(true) << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Reading from TMU: " << front.first.to_string(true) << logging::endl);
     return std::make_pair(front.first, true);
 }
 
@@ -570,7 +774,24 @@ void TMUs::setTMURegisterS(uint8_t tmu, const SIMDVector& val)
 
     if(requestQueue.size() >= 8)
         throw CompilationError(CompilationStep::GENERAL, "TMU request queue is full!");
-    requestQueue.push(std::make_pair(readMemoryAddress(val), qpu.getCurrentCycle()));
+    // the addresses are validated when reading the memory
+    auto result = readMemoryAddress(val);
+    auto readyCycle = calculateReadyCycle(val);
+    if(trace)
+    {
+        MemoryTrace::Access access{qpu.getCurrentCycle(), readyCycle, qpu.ID, MemoryTrace::AccessType::TMU_LOAD, tmu,
+            MemoryTrace::AccessPattern::STRIDED, val[0].unsignedInt(), NATIVE_VECTOR_SIZE * sizeof(Word),
+            static_cast<int32_t>(val[1].unsignedInt() - val[0].unsignedInt())};
+        for(uint8_t i = 2; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            if(static_cast<int32_t>(val[i].unsignedInt() - val[i - 1].unsignedInt()) != access.stride)
+                access.pattern = MemoryTrace::AccessPattern::GATHER;
+        }
+        if(access.pattern != MemoryTrace::AccessPattern::GATHER && access.stride == sizeof(Word))
+            access.pattern = MemoryTrace::AccessPattern::CONTIGUOUS;
+        trace->record(access);
+    }
+    requestQueue.push(std::make_pair(std::move(result), readyCycle));
 }
 
 void TMUs::setTMURegisterT(uint8_t tmu, const SIMDVector& val)
@@ -604,20 +825,22 @@ bool TMUs::triggerTMURead(uint8_t tmu)
         throw CompilationError(CompilationStep::GENERAL, "TMU response queue is full!");
 
     auto val = requestQueue.front();
+    if(!qpu.cycleAccurate)
+    {
+        // the loaded value is available immediately
+        requestQueue.pop();
+        responseQueue.push(std::make_pair(val.first, qpu.getCurrentCycle()));
+        return true;
+    }
     if(tmu == 0)
         PROFILE_COUNTER(
-            vc4c::profiler::COUNTER_EMULATOR + 65, "TMU0 read trigger", val.second + 9 <= qpu.getCurrentCycle());
+            vc4c::profiler::COUNTER_EMULATOR + 65, "TMU0 read trigger", val.second <= qpu.getCurrentCycle());
     else
         PROFILE_COUNTER(
-            vc4c::profiler::COUNTER_EMULATOR + 66, "TMU1 read trigger", val.second + 9 <= qpu.getCurrentCycle());
-    if(val.second + 9 > qpu.getCurrentCycle())
-        // block for at least 9 cycles
+            vc4c::profiler::COUNTER_EMULATOR + 66, "TMU1 read trigger", val.second <= qpu.getCurrentCycle());
+    if(val.second > qpu.getCurrentCycle())
+        // block until the value is loaded
         return false;
-    else if(val.second + 20 > qpu.getCurrentCycle())
-        // blocks up to 20 cycles when reading from RAM
-        CPPLOG_LAZY(logging::Level::DEBUG,
-            log << "Distance between triggering of TMU read and read is " << (qpu.getCurrentCycle() - val.second)
-                << ", additional stalls may be introduced" << logging::endl);
     requestQueue.pop();
     responseQueue.push(std::make_pair(val.first, qpu.getCurrentCycle()));
     return true;
@@ -644,12 +867,37 @@ SIMDVector TMUs::readMemoryAddress(const SIMDVector& address) const
             res[i] = Literal(memory.readWord(address[i].toImmediate()));
     }
     // XXX for cosmetic/correctness, this should print the rounded-down (to word boundaries) addresses
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Reading via TMU from memory address " << address.to_string(true) << ": " << res.to_string(true)
             << logging::endl);
     return res;
 }
 
+uint32_t TMUs::calculateReadyCycle(const SIMDVector& address)
+{
+    auto cycle = qpu.getCurrentCycle();
+    if(!qpu.cycleAccurate)
+        return cycle;
+    if(cacheTags.empty())
+        // without cache, every element is read from memory
+        return bus.transfer(cycle, NATIVE_VECTOR_SIZE * sizeof(Word)) + timing.tmuLatency;
+    uint32_t numMisses = 0;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        auto line = address[i].toImmediate() / timing.tmuCacheLineSize;
+        auto& tag = cacheTags[line % cacheTags.size()];
+        if(tag != line)
+        {
+            tag = line;
+            ++numMisses;
+        }
+    }
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 67, "TMU cache misses", numMisses);
+    if(numMisses == 0)
+        return cycle + timing.tmuCacheHitLatency;
+    return bus.transfer(cycle, numMisses * timing.tmuCacheLineSize) + timing.tmuLatency;
+}
+
 uint8_t TMUs::toRealTMU(uint8_t tmu) const
 {
     bool upperHalf = (qpu.ID % 4) >= 2;
@@ -666,7 +914,7 @@ SIMDVector SFU::readSFU()
     auto val = sfuResult.value();
     sfuResult = {};
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 70, "SFU read", 1);
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Reading from SFU: " << val.to_string(true) << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Reading from SFU: " << val.to_string(true) << logging::endl);
     return val;
 }
 
@@ -746,6 +994,20 @@ static std::pair<uint32_t, uint32_t> toStride(T setup)
     throw CompilationError(CompilationStep::GENERAL, "Unhandled VPM type-size", std::to_string(setup.getSize()));
 }
 
+template <typename T>
+static MemoryTrace::Access toSetupAccess(
+    uint32_t cycle, uint8_t qpu, MemoryTrace::AccessType type, T setup, uint32_t numVectors)
+{
+    uint32_t typeSize = setup.getSize() == 0 ? 1 /* Byte */ : setup.getSize() == 1 ? 2 /* Half-word */ : 4 /* Word */;
+    // the stride is given in units of the address, which addresses sub-words for bytes and half-words, 0 => 64
+    int32_t stride = setup.getStride() == 0 ? 64 : setup.getStride();
+    auto pattern = static_cast<uint32_t>(stride) * typeSize == sizeof(tools::Word) ?
+        MemoryTrace::AccessPattern::CONTIGUOUS :
+        MemoryTrace::AccessPattern::STRIDED;
+    auto numBytes = static_cast<uint32_t>(numVectors * NATIVE_VECTOR_SIZE * typeSize);
+    return MemoryTrace::Access{cycle, cycle, qpu, type, 0, pattern, setup.getAddress(), numBytes, stride};
+}
+
 SIMDVector VPM::readValue()
 {
     periphery::VPRSetup setup = periphery::VPRSetup::fromLiteral(vpmReadSetup);
@@ -798,7 +1060,7 @@ SIMDVector VPM::readValue()
     setup.genericSetup.setNumber(static_cast<uint8_t>((16 + setup.genericSetup.getNumber() - 1) % 16));
     vpmReadSetup = setup.value;
 
-    logging::logLazy(logging::Level::DEBUG, [&]() {
+    LOG_LAZY_BLOCK(logging::Level::DEBUG, {
         logging::debug() << "Read value from VPM: " << result.to_string(true) << logging::endl;
         logging::debug() << "New read setup is now: " << setup.to_string() << logging::endl;
     });
@@ -859,14 +1121,14 @@ void VPM::writeValue(const SIMDVector& val)
         static_cast<uint8_t>(setup.genericSetup.getAddress() + setup.genericSetup.getStride()));
     vpmWriteSetup = setup.value;
 
-    logging::logLazy(logging::Level::DEBUG, [&]() {
+    LOG_LAZY_BLOCK(logging::Level::DEBUG, {
         logging::debug() << "Wrote value into VPM: " << val.to_string(true) << logging::endl;
         logging::debug() << "New write setup is now: " << setup.to_string() << logging::endl;
     });
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 90, "VPM written", 1);
 }
 
-void VPM::setWriteSetup(const SIMDVector& val)
+void VPM::setWriteSetup(uint8_t qpu, const SIMDVector& val)
 {
     auto element0 = val[0];
     if(element0.isUndefined())
@@ -875,16 +1137,22 @@ void VPM::setWriteSetup(const SIMDVector& val)
     if(setup.isDMASetup())
         dmaWriteSetup = setup.value;
     else if(setup.isGenericSetup())
+    {
         vpmWriteSetup = setup.value;
+        if(trace)
+            // every write to the VPM writes a single vector
+            trace->record(
+                toSetupAccess(currentCycle, qpu, MemoryTrace::AccessType::VPM_WRITE_SETUP, setup.genericSetup, 1));
+    }
     else if(setup.isStrideSetup())
         writeStrideSetup = setup.value;
     else
         throw CompilationError(
             CompilationStep::GENERAL, "Writing unknown VPM write setup", std::to_string(element0.unsignedInt()));
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Set VPM write setup: " << setup.to_string() << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Set VPM write setup: " << setup.to_string() << logging::endl);
 }
 
-void VPM::setReadSetup(const SIMDVector& val)
+void VPM::setReadSetup(uint8_t qpu, const SIMDVector& val)
 {
     auto element0 = val[0];
     if(element0.isUndefined())
@@ -893,18 +1161,26 @@ void VPM::setReadSetup(const SIMDVector& val)
     if(setup.isDMASetup())
         dmaReadSetup = setup.value;
     else if(setup.isGenericSetup())
+    {
         // TODO warn/error if there is still VPM read pending from previous setup. TODO or create VPM read queue like
         // for TMU?
         vpmReadSetup = setup.value;
+        if(trace)
+        {
+            auto numVectors = setup.genericSetup.getNumber() == 0 ? 16u /* 0 => 16 */ : setup.genericSetup.getNumber();
+            trace->record(toSetupAccess(
+                currentCycle, qpu, MemoryTrace::AccessType::VPM_READ_SETUP, setup.genericSetup, numVectors));
+        }
+    }
     else if(setup.isStrideSetup())
         readStrideSetup = setup.value;
     else
         throw CompilationError(
             CompilationStep::GENERAL, "Writing unknown VPM read setup", std::to_string(element0.unsignedInt()));
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Set VPM read setup: " << setup.to_string() << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Set VPM read setup: " << setup.to_string() << logging::endl);
 }
 
-void VPM::setDMAWriteAddress(const SIMDVector& val)
+void VPM::setDMAWriteAddress(uint8_t qpu, const SIMDVector& val)
 {
     auto element0 = val[0];
     if(element0.isUndefined())
@@ -934,7 +1210,7 @@ void VPM::setDMAWriteAddress(const SIMDVector& val)
 
     MemoryAddress address = static_cast<MemoryAddress>(element0.unsignedInt());
 
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Copying " << sizes.first << " rows with " << sizes.second << " elements of " << typeSize
             << " bytes each " << (setup.dmaSetup.getHorizontal() ? "horizontally" : "vertically")
             << " from VPM address " << vpmBaseAddress.first << "," << vpmBaseAddress.second << " into RAM at "
@@ -948,15 +1224,13 @@ void VPM::setDMAWriteAddress(const SIMDVector& val)
     {
         for(uint32_t i = 0; i < sizes.first; ++i)
         {
-            if(address + typeSize * sizes.second >= memory.getMaximumAddress())
-                throw CompilationError(CompilationStep::GENERAL,
-                    "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
-            memcpy(reinterpret_cast<uint8_t*>(memory.getWordAddress(address)) + address % sizeof(Word),
+            memcpy(memory.getBytes(address, typeSize * sizes.second),
                 reinterpret_cast<uint8_t*>(&cache.at(vpmBaseAddress.first).at(vpmBaseAddress.second)) + byteOffset,
                 typeSize * sizes.second);
-            logging::debug() << "\tVPM row: "
-                             << to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first))
-                             << logging::endl;
+            LOG_LAZY(logging::Level::DEBUG,
+                log << "\tVPM row: "
+                    << (to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first)))
+                    << logging::endl);
             vpmBaseAddress.first += 1;
             // write stride is end-to-start, so add size of vector
             address += stride + (typeSize * sizes.second);
@@ -966,12 +1240,9 @@ void VPM::setDMAWriteAddress(const SIMDVector& val)
     {
         for(uint32_t i = 0; i < sizes.second; ++i)
         {
-            if(address + typeSize * sizes.first >= memory.getMaximumAddress())
-                throw CompilationError(CompilationStep::GENERAL,
-                    "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
             for(uint32_t k = 0; k < sizes.first; ++k)
             {
-                memcpy(reinterpret_cast<uint8_t*>(memory.getWordAddress(address)) + address % sizeof(Word),
+                memcpy(memory.getBytes(address, typeSize),
                     reinterpret_cast<uint8_t*>(&cache.at(vpmBaseAddress.first + k).at(vpmBaseAddress.second + i)) +
                         byteOffset,
                     typeSize);
@@ -982,17 +1253,28 @@ void VPM::setDMAWriteAddress(const SIMDVector& val)
 
         for(uint32_t i = 0; i < sizes.first; ++i)
         {
-            logging::debug() << "\tVPM row: "
-                             << to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first + i))
-                             << logging::endl;
+            LOG_LAZY(logging::Level::DEBUG,
+                log << "\tVPM row: "
+                    << (to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first + i)))
+                    << logging::endl);
         }
     }
 
-    lastDMAWriteTrigger = currentCycle;
+    dmaWriteDone = bus.transfer(currentCycle, sizes.first * sizes.second * typeSize) + timing.dmaLatency;
+    if(trace)
+    {
+        // the horizontal transfers write rows of sizes.second elements, the vertical ones columns of sizes.first
+        // elements, the write stride is the distance between the end of one and the start of the next row/column
+        auto numRows = setup.dmaSetup.getHorizontal() ? sizes.first : sizes.second;
+        auto rowSize = typeSize * (setup.dmaSetup.getHorizontal() ? sizes.second : sizes.first);
+        trace->record(MemoryTrace::Access{currentCycle, dmaWriteDone, qpu, MemoryTrace::AccessType::DMA_STORE, 0,
+            numRows <= 1 || stride == 0 ? MemoryTrace::AccessPattern::CONTIGUOUS : MemoryTrace::AccessPattern::STRIDED,
+            static_cast<uint32_t>(element0.unsignedInt()), numRows * rowSize, static_cast<int32_t>(stride + rowSize)});
+    }
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 100, "write DMA write address", 1);
 }
 
-void VPM::setDMAReadAddress(const SIMDVector& val)
+void VPM::setDMAReadAddress(uint8_t qpu, const SIMDVector& val)
 {
     auto element0 = val[0];
     if(element0.isUndefined())
@@ -1026,7 +1308,7 @@ void VPM::setDMAReadAddress(const SIMDVector& val)
 
     MemoryAddress address = static_cast<MemoryAddress>(element0.unsignedInt());
 
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Copying " << sizes.first << " rows with " << sizes.second << " elements of " << typeSize
             << " bytes each from RAM address " << address << " into VPM at " << vpmBaseAddress.first << ","
             << vpmBaseAddress.second << " with byte-offset of " << byteOffset << " and a memory pitch of " << pitch
@@ -1039,33 +1321,45 @@ void VPM::setDMAReadAddress(const SIMDVector& val)
     for(uint32_t i = 0; i < sizes.first; ++i)
     {
         memcpy(reinterpret_cast<uint8_t*>(&cache.at(vpmBaseAddress.first).at(vpmBaseAddress.second)) + byteOffset,
-            reinterpret_cast<uint8_t*>(memory.getWordAddress(address)) + address % sizeof(Word),
-            typeSize * sizes.second);
-        logging::debug() << "\tVPM row: "
-                         << to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first))
-                         << logging::endl;
+            memory.getBytes(address, typeSize * sizes.second), typeSize * sizes.second);
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "\tVPM row: "
+                << (to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first)))
+                << logging::endl);
         vpmBaseAddress.first += static_cast<uint32_t>((vpitch * typeSize) / sizeof(Word));
         vpmBaseAddress.second += static_cast<uint32_t>((vpitch * typeSize) % sizeof(Word));
         // read pitch is start-to-start, so we don't have to add anything
         address += pitch;
     }
 
-    lastDMAReadTrigger = currentCycle;
+    dmaReadDone = bus.transfer(currentCycle, sizes.first * sizes.second * typeSize) + timing.dmaLatency;
+    if(trace)
+    {
+        auto rowSize = typeSize * sizes.second;
+        trace->record(MemoryTrace::Access{currentCycle, dmaReadDone, qpu, MemoryTrace::AccessType::DMA_LOAD, 0,
+            sizes.first <= 1 || pitch == rowSize ? MemoryTrace::AccessPattern::CONTIGUOUS :
+                                                   MemoryTrace::AccessPattern::STRIDED,
+            static_cast<uint32_t>(element0.unsignedInt()), sizes.first * rowSize, static_cast<int32_t>(pitch)});
+    }
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 110, "write DMA read address", 1);
 }
 
 bool VPM::waitDMAWrite() const
 {
-    // XXX how many cycles?
-    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 120, "wait DMA write", lastDMAWriteTrigger + 12 < currentCycle);
-    return lastDMAWriteTrigger + 12 < currentCycle;
+    if(!cycleAccurate)
+        // the DMA write is already executed when triggered
+        return true;
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 120, "wait DMA write", dmaWriteDone < currentCycle);
+    return dmaWriteDone < currentCycle;
 }
 
 bool VPM::waitDMARead() const
 {
-    // XXX how many cycles?
-    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 130, "wait DMA read", lastDMAReadTrigger + 12 < currentCycle);
-    return lastDMAReadTrigger + 12 < currentCycle;
+    if(!cycleAccurate)
+        // the DMA read is already executed when triggered
+        return true;
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 130, "wait DMA read", dmaReadDone < currentCycle);
+    return dmaReadDone < currentCycle;
 }
 
 void VPM::incrementCycle()
@@ -1099,7 +1393,7 @@ std::pair<SIMDVector, bool> Semaphores::increment(uint8_t index)
     if(cnt == 15)
         return std::make_pair(SIMDVector(Literal(15)), false);
     ++cnt;
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Semaphore " << static_cast<unsigned>(index) << " increased to: " << static_cast<unsigned>(cnt)
             << logging::endl);
     // Broadcom specification, page 33: "The instruction otherwise behaves like a 32-bit load immediate instruction, so
@@ -1114,7 +1408,7 @@ std::pair<SIMDVector, bool> Semaphores::decrement(uint8_t index)
     if(cnt == 0)
         return std::make_pair(SIMDVector(Literal(0u)), false);
     --cnt;
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << "Semaphore " << static_cast<unsigned>(index) << " decreased to: " << static_cast<unsigned>(cnt)
             << logging::endl);
     // Broadcom specification, page 33: "The instruction otherwise behaves like a 32-bit load immediate instruction, so
@@ -1122,16 +1416,19 @@ std::pair<SIMDVector, bool> Semaphores::decrement(uint8_t index)
     return std::make_pair(SIMDVector(Literal((1u << 4) | static_cast<uint32_t>(cnt))), true);
 }
 
-void Semaphores::checkAllZero() const
+bool Semaphores::checkAllZero() const
 {
+    bool allZero = true;
     for(unsigned i = 0; i < counter.size(); ++i)
     {
         if(counter[i] != 0)
         {
-            CPPLOG_LAZY(logging::Level::ERROR,
+            LOG_LAZY(logging::Level::ERROR,
                 log << "Semaphore " << i << " (" << counter[i] << ") is not reset to zero!" << logging::endl);
+            allZero = false;
         }
     }
+    return allZero;
 }
 
 uint32_t QPU::getCurrentCycle() const
@@ -1166,115 +1463,263 @@ static VectorFlags generateImmediateFlags(const SIMDVector& vector)
     return flags;
 }
 
-bool QPU::execute(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction)
+/*
+ * Reading the UNIFORMs (from memory), the VPM, the DMA wait registers or the hardware mutex accesses the periphery
+ * shared between all QPUs
+ */
+static bool isSharedRead(Address address)
+{
+    return address == REG_UNIFORM.num || (address >= REG_VPM_IO.num && address <= REG_MUTEX.num);
+}
+
+/*
+ * Writing the general purpose registers, the accumulators, the QPU-local registers and the SFU only modifies the state
+ * of the executing QPU, everything else (e.g. the VPM, the hardware mutex or the TMU address registers reading the
+ * memory) accesses the periphery shared between all QPUs
+ */
+static bool isSharedWrite(Register reg)
+{
+    if(reg.num <= REG_UNIFORM_ADDRESS.num || reg.num == REG_MS_MASK.num)
+        return false;
+    return reg.num < REG_SFU_RECIP.num || reg.num > REG_SFU_LOG2.num;
+}
+
+DecodedInstruction::DecodedInstruction(const qpu_asm::Instruction& instruction) :
+    instruction(&instruction), type(Type::INVALID), signal(instruction.getSig())
+{
+    if(auto alu = instruction.as<qpu_asm::ALUInstruction>())
+    {
+        type = Type::ALU;
+        addCondition = alu->getAddCondition();
+        mulCondition = alu->getMulCondition();
+        setFlags = alu->getSetFlag() == SetFlag::SET_FLAGS;
+        addOut = toRegister(alu->getAddOut(), alu->getWriteSwap() == WriteSwap::SWAP);
+        mulOut = toRegister(alu->getMulOut(), alu->getWriteSwap() == WriteSwap::DONT_SWAP);
+        pack = alu->getPack();
+        addCode = &OpCode::toOpCode(alu->getAddition(), false);
+        mulCode = &OpCode::toOpCode(alu->getMultiplication(), true);
+        executeAdd = addCondition != COND_NEVER && alu->getAddition() != OP_NOP.opAdd;
+        executeMul = mulCondition != COND_NEVER && alu->getMultiplication() != OP_NOP.opMul;
+        addMuxA = alu->getAddMultiplexA();
+        addMuxB = alu->getAddMultiplexB();
+        mulMuxA = alu->getMulMultiplexA();
+        mulMuxB = alu->getMulMultiplexB();
+        inputA = alu->getInputA();
+        inputB = alu->getInputB();
+        regBIsImmediate = signal == SIGNAL_ALU_IMMEDIATE;
+        unpack = alu->getUnpack();
+        packMulOutput = alu->getWriteSwap() == WriteSwap::SWAP;
+        flagsSetByMul = isFlagSetByMulALU(alu->getAddition(), alu->getMultiplication());
+        SmallImmediate offset(inputB);
+        vectorRotation = alu->isVectorRotation() && offset.isVectorRotation();
+        if(vectorRotation)
+        {
+            fullRangeRotation = alu->isFullRangeRotation();
+            rotationFromR5 = offset == VECTOR_ROTATE_R5;
+            if(!rotationFromR5)
+                rotationOffset = offset.getRotationOffset().value();
+        }
+    }
+    else if(auto br = instruction.as<qpu_asm::BranchInstruction>())
+    {
+        type = Type::BRANCH;
+        branchCondition = br->getBranchCondition();
+        branchOffset = 4 /* Branch starts at PC + 4 */ +
+            (br->getImmediate() / static_cast<int32_t>(sizeof(uint64_t))) /* immediate offset is in bytes */;
+        unsupportedBranch =
+            br->getAddRegister() == BranchReg::BRANCH_REG || br->getBranchRelative() == BranchRel::BRANCH_ABSOLUTE;
+        addOut = toRegister(br->getAddOut(), br->getWriteSwap() == WriteSwap::SWAP);
+        mulOut = toRegister(br->getMulOut(), br->getWriteSwap() == WriteSwap::DONT_SWAP);
+    }
+    else if(auto load = instruction.as<qpu_asm::LoadInstruction>())
+    {
+        type = Type::LOAD;
+        SIMDVector values;
+        switch(load->getType())
+        {
+        case OpLoad::LOAD_IMM_32:
+            values = SIMDVector(Literal(load->getImmediateInt()));
+            break;
+        case OpLoad::LOAD_SIGNED:
+            values = intermediate::LoadImmediate::toLoadedValues(
+                load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_SIGNED);
+            break;
+        case OpLoad::LOAD_UNSIGNED:
+            values = intermediate::LoadImmediate::toLoadedValues(
+                load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_UNSIGNED);
+            break;
+        }
+        loadedFlags = generateImmediateFlags(values);
+        pack = load->getPack();
+        loadedValue = pack(values, loadedFlags, false);
+        mask = pack.getMask();
+        addCondition = load->getAddCondition();
+        mulCondition = load->getMulCondition();
+        setFlags = load->getSetFlag() == SetFlag::SET_FLAGS;
+        addOut = toRegister(load->getAddOut(), load->getWriteSwap() == WriteSwap::SWAP);
+        mulOut = toRegister(load->getMulOut(), load->getWriteSwap() == WriteSwap::DONT_SWAP);
+    }
+    else if(auto sema = instruction.as<qpu_asm::SemaphoreInstruction>())
+    {
+        type = Type::SEMAPHORE;
+        semaphore = static_cast<uint8_t>(sema->getSemaphore());
+        // NOTE: "acquire" is decrement, see SemaphoreInstruction#getAcquire() function documentation
+        acquire = sema->getAcquire();
+        pack = sema->getPack();
+        mask = pack.getMask();
+        addCondition = sema->getAddCondition();
+        mulCondition = sema->getMulCondition();
+        setFlags = sema->getSetFlag() == SetFlag::SET_FLAGS;
+        addOut = toRegister(sema->getAddOut(), sema->getWriteSwap() == WriteSwap::SWAP);
+        mulOut = toRegister(sema->getMulOut(), sema->getWriteSwap() == WriteSwap::DONT_SWAP);
+    }
+
+    // NOTE: The signals only access the state of the executing QPU (e.g. its TMU queues), since the TMUs read the
+    // memory when the address is written
+    switch(type)
+    {
+    case Type::ALU:
+    {
+        auto muxes = {addMuxA, addMuxB, mulMuxA, mulMuxB};
+        bool readsA = std::find(muxes.begin(), muxes.end(), InputMultiplex::REGA) != muxes.end();
+        bool readsB = !regBIsImmediate && std::find(muxes.begin(), muxes.end(), InputMultiplex::REGB) != muxes.end();
+        accessesSharedState = (readsA && isSharedRead(inputA)) || (readsB && isSharedRead(inputB)) ||
+            (executeAdd && isSharedWrite(addOut)) || (executeMul && isSharedWrite(mulOut));
+        // ALU instructions only stall on reading the TMU result, the DMA wait registers or the hardware mutex
+        if(std::find(muxes.begin(), muxes.end(), InputMultiplex::ACC4) != muxes.end())
+            stallReason = StallReason::TMU;
+        else if((readsA && inputA == REG_MUTEX.num) || (readsB && inputB == REG_MUTEX.num))
+            stallReason = StallReason::MUTEX;
+        else
+            stallReason = StallReason::VPM;
+        break;
+    }
+    case Type::BRANCH:
+        // the return addresses are written unconditionally, if the branch is taken
+        accessesSharedState = isSharedWrite(addOut) || isSharedWrite(mulOut);
+        break;
+    case Type::LOAD:
+        accessesSharedState = (addCondition != COND_NEVER && isSharedWrite(addOut)) ||
+            (mulCondition != COND_NEVER && isSharedWrite(mulOut));
+        break;
+    case Type::SEMAPHORE:
+        accessesSharedState = true;
+        stallReason = StallReason::SEMAPHORE;
+        break;
+    case Type::INVALID:
+        accessesSharedState = true;
+        break;
+    }
+}
+
+static void countStall(InstrumentationResult& result, StallReason reason)
+{
+    ++result.numStalls;
+    switch(reason)
+    {
+    case StallReason::TMU:
+        ++result.numTMUStalls;
+        break;
+    case StallReason::VPM:
+        ++result.numVPMStalls;
+        break;
+    case StallReason::MUTEX:
+        ++result.numMutexStalls;
+        break;
+    case StallReason::SEMAPHORE:
+        ++result.numSemaphoreStalls;
+        break;
+    }
+}
+
+bool QPU::execute()
 {
-    const qpu_asm::Instruction* inst = &(*(firstInstruction + pc));
-    ++instrumentation[inst].numExecutions;
-    CPPLOG_LAZY(logging::Level::INFO,
-        log << "QPU " << static_cast<unsigned>(ID) << " (0x" << std::hex << pc << std::dec
-            << "): " << inst->toASMString() << logging::endl);
+    if(pc >= program.size())
+        throw CompilationError(CompilationStep::GENERAL, "Program counter is out of bounds", std::to_string(pc));
+    const DecodedInstruction& inst = program[pc];
+    InstrumentationResult& instrumentationResult = instrumentation[pc];
+    ++instrumentationResult.numExecutions;
+    if(cycleAccurate)
+        LOG_LAZY(logging::Level::INFO,
+            log << "QPU " << static_cast<unsigned>(ID) << " (0x" << std::hex << pc << std::dec
+                << "): " << inst.instruction->toASMString() << logging::endl);
     ProgramCounter nextPC = pc;
-    if(inst->getSig() == SIGNAL_END_PROGRAM)
+    if(inst.signal == SIGNAL_END_PROGRAM)
         // end program
         return false;
-    if(inst->getSig() == SIGNAL_NONE || executeSignal(inst->getSig()))
+    if(inst.signal != SIGNAL_NONE && !executeSignal(inst.signal))
+        // the TMU load could not be triggered, the instruction is repeated
+        countStall(instrumentationResult, StallReason::TMU);
+    else
     {
-        if(auto op = inst->as<qpu_asm::ALUInstruction>())
+        switch(inst.type)
         {
-            if(executeALU(op))
+        case DecodedInstruction::Type::ALU:
+            if(executeALU(inst))
                 ++nextPC;
             // otherwise the execution stalled and the PC stays the same
-        }
-        else if(auto br = inst->as<qpu_asm::BranchInstruction>())
+            break;
+        case DecodedInstruction::Type::BRANCH:
         {
-            if(isConditionMet(br->getBranchCondition()))
+            bool branchTaken = isConditionMet(inst.branchCondition);
+            if(branchTaken)
             {
-                ++instrumentation[inst].numBranchTaken;
-                int32_t offset = 4 /* Branch starts at PC + 4 */ +
-                    (br->getImmediate() / static_cast<int32_t>(sizeof(uint64_t))) /* immediate offset is in bytes */;
-                if(br->getAddRegister() == BranchReg::BRANCH_REG ||
-                    br->getBranchRelative() == BranchRel::BRANCH_ABSOLUTE)
-                    throw CompilationError(
-                        CompilationStep::GENERAL, "This kind of branch is not yet implemented", br->toASMString());
-                nextPC += static_cast<ProgramCounter>(offset);
+                ++instrumentationResult.numBranchTaken;
+                if(inst.unsupportedBranch)
+                    throw CompilationError(CompilationStep::GENERAL, "This kind of branch is not yet implemented",
+                        inst.instruction->toASMString());
+                nextPC += static_cast<ProgramCounter>(inst.branchOffset);
 
                 // see Broadcom specification, page 34
-                registers.writeRegister(toRegister(br->getAddOut(), br->getWriteSwap() == WriteSwap::SWAP),
-                    SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF), BITMASK_ALL);
-                registers.writeRegister(toRegister(br->getMulOut(), br->getWriteSwap() == WriteSwap::DONT_SWAP),
-                    SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF), BITMASK_ALL);
+                registers.writeRegister(inst.addOut, SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF), BITMASK_ALL);
+                registers.writeRegister(inst.mulOut, SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF), BITMASK_ALL);
             }
             else
                 // simply skip to next PC
                 ++nextPC;
-            PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 160, "branches taken",
-                isConditionMet(br->getBranchCondition()) ? 1 : 0);
+            PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 160, "branches taken", branchTaken ? 1 : 0);
+            break;
         }
-        else if(auto load = inst->as<qpu_asm::LoadInstruction>())
+        case DecodedInstruction::Type::LOAD:
         {
-            auto type = load->getType();
-            SIMDVector loadedValues;
-            switch(type)
-            {
-            case OpLoad::LOAD_IMM_32:
-                loadedValues = SIMDVector(Literal(load->getImmediateInt()));
-                break;
-            case OpLoad::LOAD_SIGNED:
-                loadedValues = intermediate::LoadImmediate::toLoadedValues(
-                    load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_SIGNED);
-                break;
-            case OpLoad::LOAD_UNSIGNED:
-                loadedValues = intermediate::LoadImmediate::toLoadedValues(
-                    load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_UNSIGNED);
-                break;
-            }
-
-            auto flags = generateImmediateFlags(loadedValues);
-            if(load->getPack().hasEffect())
+            if(inst.pack.hasEffect())
                 PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-            SIMDVector imm = load->getPack()(loadedValues, flags, false);
-            auto mask = load->getPack().getMask();
-            writeConditional(toRegister(load->getAddOut(), load->getWriteSwap() == WriteSwap::SWAP), imm,
-                load->getAddCondition(), mask);
-            writeConditional(toRegister(load->getMulOut(), load->getWriteSwap() == WriteSwap::DONT_SWAP), imm,
-                load->getMulCondition(), mask);
-            if(load->getSetFlag() == SetFlag::SET_FLAGS)
-                setFlags(imm, load->getAddCondition() != COND_NEVER ? load->getAddCondition() : load->getMulCondition(),
-                    flags);
+            writeConditional(inst.addOut, inst.loadedValue, inst.addCondition, inst.mask);
+            writeConditional(inst.mulOut, inst.loadedValue, inst.mulCondition, inst.mask);
+            if(inst.setFlags)
+                setFlags(inst.loadedValue, inst.addCondition != COND_NEVER ? inst.addCondition : inst.mulCondition,
+                    inst.loadedFlags);
             ++nextPC;
+            break;
         }
-        else if(auto semaphore = inst->as<qpu_asm::SemaphoreInstruction>())
+        case DecodedInstruction::Type::SEMAPHORE:
         {
             bool dontStall = true;
             SIMDVector result{};
-            if(semaphore->getAcquire())
-                // NOTE: "acquire" is decrement, see SemaphoreInstruction#getAcquire() function documentation
-                std::tie(result, dontStall) = semaphores.decrement(static_cast<uint8_t>(semaphore->getSemaphore()));
+            if(inst.acquire)
+                std::tie(result, dontStall) = semaphores.decrement(inst.semaphore);
             else
-                std::tie(result, dontStall) = semaphores.increment(static_cast<uint8_t>(semaphore->getSemaphore()));
+                std::tie(result, dontStall) = semaphores.increment(inst.semaphore);
 
             if(dontStall)
             {
-                if(semaphore->getPack().hasEffect())
+                if(inst.pack.hasEffect())
                     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-                result = semaphore->getPack()(result, {}, false);
-                auto mask = semaphore->getPack().getMask();
-                writeConditional(toRegister(semaphore->getAddOut(), semaphore->getWriteSwap() == WriteSwap::SWAP),
-                    result, semaphore->getAddCondition(), mask);
-                writeConditional(toRegister(semaphore->getMulOut(), semaphore->getWriteSwap() == WriteSwap::DONT_SWAP),
-                    result, semaphore->getMulCondition(), mask);
-                if(semaphore->getSetFlag() == SetFlag::SET_FLAGS)
-                    setFlags(result,
-                        semaphore->getAddCondition() != COND_NEVER ? semaphore->getAddCondition() :
-                                                                     semaphore->getMulCondition(),
-                        {});
+                result = inst.pack(result, {}, false);
+                writeConditional(inst.addOut, result, inst.addCondition, inst.mask);
+                writeConditional(inst.mulOut, result, inst.mulCondition, inst.mask);
+                if(inst.setFlags)
+                    setFlags(result, inst.addCondition != COND_NEVER ? inst.addCondition : inst.mulCondition, {});
                 ++nextPC;
             }
             else
-                ++instrumentation[inst].numStalls;
+                countStall(instrumentationResult, inst.stallReason);
+            break;
+        }
+        case DecodedInstruction::Type::INVALID:
+            throw CompilationError(
+                CompilationStep::GENERAL, "Invalid assembler instruction", inst.instruction->toASMString());
         }
-        else
-            throw CompilationError(CompilationStep::GENERAL, "Invalid assembler instruction", inst->toASMString());
     }
 
     // clear cache for registers already read this instruction
@@ -1285,10 +1730,15 @@ bool QPU::execute(std::vector<qpu_asm::Instruction>::const_iterator firstInstruc
     return true;
 }
 
-const qpu_asm::Instruction* QPU::getCurrentInstruction(
-    std::vector<qpu_asm::Instruction>::const_iterator firstInstruction) const
+const qpu_asm::Instruction* QPU::getCurrentInstruction() const
 {
-    return &(*(firstInstruction + pc));
+    return program.at(pc).instruction;
+}
+
+bool QPU::isAccessingSharedState() const
+{
+    // an out-of-bounds program counter throws on execution, which is handled like any other error
+    return pc < program.size() && program[pc].accessesSharedState;
 }
 
 static std::pair<SIMDVector, bool> toInputValue(Registers& registers, InputMultiplex mux, Address addressA,
@@ -1320,18 +1770,15 @@ static std::pair<SIMDVector, bool> toInputValue(Registers& registers, InputMulti
 }
 
 static std::pair<SIMDVector, bool> applyVectorRotation(std::pair<SIMDVector, bool>&& input,
-    const qpu_asm::ALUInstruction* ins, Registers& registers, bool anyElementExecuted)
+    const DecodedInstruction& ins, Registers& registers, bool anyElementExecuted)
 {
     if(!input.second)
         // if we stall, do not rotate
         return std::move(input);
-    if(!ins->isVectorRotation())
+    if(!ins.vectorRotation)
         // no rotation set
         return std::move(input);
-    SmallImmediate offset(ins->getInputB());
-    if(!offset.isVectorRotation())
-        return std::move(input);
-    if(ins->getMulMultiplexA() == InputMultiplex::REGB || ins->getMulMultiplexB() == InputMultiplex::REGB)
+    if(ins.mulMuxA == InputMultiplex::REGB || ins.mulMuxB == InputMultiplex::REGB)
         // XXX can't we actually?! See http://maazl.de/project/vc4asm/doc/VideoCoreIV-addendum.html
         throw CompilationError(CompilationStep::GENERAL, "Cannot read vector rotation offset", input.first.to_string());
 
@@ -1339,21 +1786,20 @@ static std::pair<SIMDVector, bool> applyVectorRotation(std::pair<SIMDVector, boo
         return std::move(input);
 
     unsigned char distance;
-    if(offset == VECTOR_ROTATE_R5)
+    if(ins.rotationFromR5)
         //"Mul output vector rotation is taken from accumulator r5, element 0, bits [3:0]"
         // - Broadcom Specification, page 30
         distance = static_cast<uint8_t>(registers.readRegister(REG_ACC5, anyElementExecuted).first[0].unsignedInt());
     else
-        distance = offset.getRotationOffset().value();
+        distance = ins.rotationOffset;
 
     SIMDVector result(std::move(input.first));
-    if(ins->isFullRangeRotation())
+    if(ins.fullRangeRotation)
         result = std::move(result).rotate(distance & 0xF);
     else
         result = std::move(result).rotatePerQuad(distance & 0x3);
 
-    PROFILE_COUNTER(
-        vc4c::profiler::COUNTER_EMULATOR + 170, "vector rotations (full/total)", ins->isFullRangeRotation());
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 170, "vector rotations (full/total)", ins.fullRangeRotation);
     return std::make_pair(result, true);
 }
 
@@ -1363,83 +1809,83 @@ static bool isAnyElementExecuted(const VectorFlags& flags, ConditionCode code)
         std::any_of(flags.begin(), flags.end(), [=](ElementFlags flag) { return flag.matchesCondition(code); });
 }
 
-bool QPU::executeALU(const qpu_asm::ALUInstruction* aluInst)
+bool QPU::executeALU(const DecodedInstruction& aluInst)
 {
     SIMDVector addIn0{};
     SIMDVector addIn1{};
     SIMDVector mulIn0{};
     SIMDVector mulIn1{};
 
-    const OpCode& addCode = OpCode::toOpCode(aluInst->getAddition(), false);
-    const OpCode& mulCode = OpCode::toOpCode(aluInst->getMultiplication(), true);
+    const OpCode& addCode = *aluInst.addCode;
+    const OpCode& mulCode = *aluInst.mulCode;
+    InstrumentationResult& instrumentationResult = instrumentation[pc];
 
     // need to read both input before writing any registers
-    if(aluInst->getAddCondition() != COND_NEVER && aluInst->getAddition() != OP_NOP.opAdd)
+    if(aluInst.executeAdd)
     {
-        bool anyElementExecuting = isAnyElementExecuted(flags, aluInst->getAddCondition());
+        bool anyElementExecuting = isAnyElementExecuted(flags, aluInst.addCondition);
 
         bool addIn0NotStall = true;
         bool addIn1NotStall = true;
-        std::tie(addIn0, addIn0NotStall) = toInputValue(registers, aluInst->getAddMultiplexA(), aluInst->getInputA(),
-            aluInst->getInputB(), aluInst->getSig() == SIGNAL_ALU_IMMEDIATE, anyElementExecuting);
+        std::tie(addIn0, addIn0NotStall) = toInputValue(registers, aluInst.addMuxA, aluInst.inputA, aluInst.inputB,
+            aluInst.regBIsImmediate, anyElementExecuting);
         if(addCode.numOperands > 1)
-            std::tie(addIn1, addIn1NotStall) =
-                toInputValue(registers, aluInst->getAddMultiplexB(), aluInst->getInputA(), aluInst->getInputB(),
-                    aluInst->getSig() == SIGNAL_ALU_IMMEDIATE, anyElementExecuting);
+            std::tie(addIn1, addIn1NotStall) = toInputValue(registers, aluInst.addMuxB, aluInst.inputA,
+                aluInst.inputB, aluInst.regBIsImmediate, anyElementExecuting);
 
         if(!addIn0NotStall || !addIn1NotStall)
         {
             // we stall on input, so do not calculate anything
-            ++instrumentation[aluInst].numStalls;
+            countStall(instrumentationResult, aluInst.stallReason);
             return false;
         }
     }
 
-    if(aluInst->getMulCondition() != COND_NEVER && aluInst->getMultiplication() != OP_NOP.opMul)
+    if(aluInst.executeMul)
     {
-        bool anyElementExecuting = isAnyElementExecuted(flags, aluInst->getMulCondition());
+        bool anyElementExecuting = isAnyElementExecuted(flags, aluInst.mulCondition);
 
         bool mulIn0NotStall = true;
         bool mulIn1NotStall = true;
 
         PROFILE_START(EmulateVectorRotation);
         std::tie(mulIn0, mulIn0NotStall) = applyVectorRotation(
-            toInputValue(registers, aluInst->getMulMultiplexA(), aluInst->getInputA(), aluInst->getInputB(),
-                aluInst->getSig() == SIGNAL_ALU_IMMEDIATE, anyElementExecuting),
+            toInputValue(registers, aluInst.mulMuxA, aluInst.inputA, aluInst.inputB, aluInst.regBIsImmediate,
+                anyElementExecuting),
             aluInst, registers, anyElementExecuting);
         if(mulCode.numOperands > 1)
             std::tie(mulIn1, mulIn1NotStall) = applyVectorRotation(
-                toInputValue(registers, aluInst->getMulMultiplexB(), aluInst->getInputA(), aluInst->getInputB(),
-                    aluInst->getSig() == SIGNAL_ALU_IMMEDIATE, anyElementExecuting),
+                toInputValue(registers, aluInst.mulMuxB, aluInst.inputA, aluInst.inputB, aluInst.regBIsImmediate,
+                    anyElementExecuting),
                 aluInst, registers, anyElementExecuting);
         PROFILE_END(EmulateVectorRotation);
 
         if(!mulIn0NotStall || !mulIn1NotStall)
         {
             // we stall on input, so do not calculate anything
-            ++instrumentation[aluInst].numStalls;
+            countStall(instrumentationResult, aluInst.stallReason);
             return false;
         }
     }
 
-    if(aluInst->getAddCondition() != COND_NEVER && aluInst->getAddition() != OP_NOP.opAdd)
+    if(aluInst.executeAdd)
     {
-        if(aluInst->getUnpack().hasEffect())
+        if(aluInst.unpack.hasEffect())
         {
             PROFILE_START(EmulateUnpack);
-            if(aluInst->getUnpack().isUnpackFromR4())
+            if(aluInst.unpack.isUnpackFromR4())
             {
-                if(aluInst->getAddMultiplexA() == InputMultiplex::ACC4)
-                    addIn0 = aluInst->getUnpack()(addIn0, addCode.acceptsFloat);
-                if(aluInst->getAddMultiplexB() == InputMultiplex::ACC4)
-                    addIn1 = aluInst->getUnpack()(addIn1, addCode.acceptsFloat);
+                if(aluInst.addMuxA == InputMultiplex::ACC4)
+                    addIn0 = aluInst.unpack(addIn0, addCode.acceptsFloat);
+                if(aluInst.addMuxB == InputMultiplex::ACC4)
+                    addIn1 = aluInst.unpack(addIn1, addCode.acceptsFloat);
             }
             else
             {
-                if(aluInst->getAddMultiplexA() == InputMultiplex::REGA)
-                    addIn0 = aluInst->getUnpack()(addIn0, addCode.acceptsFloat);
-                if(aluInst->getAddMultiplexB() == InputMultiplex::REGA)
-                    addIn1 = aluInst->getUnpack()(addIn1, addCode.acceptsFloat);
+                if(aluInst.addMuxA == InputMultiplex::REGA)
+                    addIn0 = aluInst.unpack(addIn0, addCode.acceptsFloat);
+                if(aluInst.addMuxB == InputMultiplex::REGA)
+                    addIn1 = aluInst.unpack(addIn1, addCode.acceptsFloat);
             }
             PROFILE_END(EmulateUnpack);
         }
@@ -1453,39 +1899,38 @@ bool QPU::executeALU(const qpu_asm::ALUInstruction* aluInst)
         // fall-through for errors above on purpose so the next instruction throws an exception
         auto result = std::move(tmp.first).value();
         auto mask = BITMASK_ALL;
-        if(aluInst->getWriteSwap() == WriteSwap::DONT_SWAP && aluInst->getPack().hasEffect())
+        if(!aluInst.packMulOutput && aluInst.pack.hasEffect())
         {
             PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-            if(aluInst->getPack().supportsMulALU())
+            if(aluInst.pack.supportsMulALU())
                 throw CompilationError(CompilationStep::GENERAL, "Cannot apply mul pack mode on add result!");
-            result = aluInst->getPack()(result, tmp.second, addCode.returnsFloat);
-            mask = aluInst->getPack().getMask();
+            result = aluInst.pack(result, tmp.second, addCode.returnsFloat);
+            mask = aluInst.pack.getMask();
         }
 
-        writeConditional(toRegister(aluInst->getAddOut(), aluInst->getWriteSwap() == WriteSwap::SWAP), result,
-            aluInst->getAddCondition(), mask, aluInst, nullptr);
-        if(aluInst->getSetFlag() == SetFlag::SET_FLAGS)
-            setFlags(result, aluInst->getAddCondition(), tmp.second);
+        writeConditional(aluInst.addOut, result, aluInst.addCondition, mask, &instrumentationResult, nullptr);
+        if(aluInst.setFlags)
+            setFlags(result, aluInst.addCondition, tmp.second);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 180, "add instructions", 1);
     }
-    if(aluInst->getMulCondition() != COND_NEVER && aluInst->getMultiplication() != OP_NOP.opMul)
+    if(aluInst.executeMul)
     {
-        if(aluInst->getUnpack().hasEffect())
+        if(aluInst.unpack.hasEffect())
         {
             PROFILE_START(EmulateUnpack);
-            if(aluInst->getUnpack().isUnpackFromR4())
+            if(aluInst.unpack.isUnpackFromR4())
             {
-                if(aluInst->getMulMultiplexA() == InputMultiplex::ACC4)
-                    mulIn0 = aluInst->getUnpack()(mulIn0, mulCode.acceptsFloat);
-                if(aluInst->getMulMultiplexB() == InputMultiplex::ACC4)
-                    mulIn1 = aluInst->getUnpack()(mulIn1, mulCode.acceptsFloat);
+                if(aluInst.mulMuxA == InputMultiplex::ACC4)
+                    mulIn0 = aluInst.unpack(mulIn0, mulCode.acceptsFloat);
+                if(aluInst.mulMuxB == InputMultiplex::ACC4)
+                    mulIn1 = aluInst.unpack(mulIn1, mulCode.acceptsFloat);
             }
             else
             {
-                if(aluInst->getMulMultiplexA() == InputMultiplex::REGA)
-                    mulIn0 = aluInst->getUnpack()(mulIn0, mulCode.acceptsFloat);
-                if(aluInst->getMulMultiplexB() == InputMultiplex::REGA)
-                    mulIn1 = aluInst->getUnpack()(mulIn1, mulCode.acceptsFloat);
+                if(aluInst.mulMuxA == InputMultiplex::REGA)
+                    mulIn0 = aluInst.unpack(mulIn0, mulCode.acceptsFloat);
+                if(aluInst.mulMuxB == InputMultiplex::REGA)
+                    mulIn1 = aluInst.unpack(mulIn1, mulCode.acceptsFloat);
             }
             PROFILE_END(EmulateUnpack);
         }
@@ -1498,48 +1943,46 @@ bool QPU::executeALU(const qpu_asm::ALUInstruction* aluInst)
                              << mulIn0.to_string(true) << " and " << mulIn1.to_string(true) << logging::endl;
         auto result = std::move(tmp.first).value();
         auto mask = BITMASK_ALL;
-        if(aluInst->getWriteSwap() == WriteSwap::SWAP && aluInst->getPack().hasEffect())
+        if(aluInst.packMulOutput && aluInst.pack.hasEffect())
         {
             PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-            if(!aluInst->getPack().supportsMulALU())
+            if(!aluInst.pack.supportsMulALU())
                 throw CompilationError(CompilationStep::GENERAL, "Cannot apply add pack mode on mul result!");
-            result = aluInst->getPack()(result, tmp.second, mulCode.returnsFloat);
-            mask = aluInst->getPack().getMask();
+            result = aluInst.pack(result, tmp.second, mulCode.returnsFloat);
+            mask = aluInst.pack.getMask();
         }
 
         // FIXME these might depend on flags of add ALU set in same instruction (which is wrong)
-        writeConditional(toRegister(aluInst->getMulOut(), aluInst->getWriteSwap() == WriteSwap::DONT_SWAP), result,
-            aluInst->getMulCondition(), mask, nullptr, aluInst);
-        if(aluInst->getSetFlag() == SetFlag::SET_FLAGS &&
-            isFlagSetByMulALU(aluInst->getAddition(), aluInst->getMultiplication()))
-            setFlags(result, aluInst->getMulCondition(), tmp.second);
+        writeConditional(aluInst.mulOut, result, aluInst.mulCondition, mask, nullptr, &instrumentationResult);
+        if(aluInst.setFlags && aluInst.flagsSetByMul)
+            setFlags(result, aluInst.mulCondition, tmp.second);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 190, "mul instructions", 1);
     }
 
-    if(aluInst->getUnpack().hasEffect())
+    if(aluInst.unpack.hasEffect())
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 220, "values unpacked", 1);
 
     return true;
 }
 
 void QPU::writeConditional(Register dest, const SIMDVector& in, ConditionCode cond, BitMask bitMask,
-    const qpu_asm::ALUInstruction* addInst, const qpu_asm::ALUInstruction* mulInst)
+    InstrumentationResult* addResult, InstrumentationResult* mulResult)
 {
     if(cond == COND_ALWAYS)
     {
         registers.writeRegister(dest, in, std::bitset<16>(0xFFFF), bitMask);
-        if(addInst)
-            ++instrumentation[addInst].numAddALUExecuted;
-        if(mulInst)
-            ++instrumentation[mulInst].numMulALUExecuted;
+        if(addResult)
+            ++addResult->numAddALUExecuted;
+        if(mulResult)
+            ++mulResult->numMulALUExecuted;
         return;
     }
     else if(cond == COND_NEVER)
     {
-        if(addInst)
-            ++instrumentation[addInst].numAddALUSkipped;
-        if(mulInst)
-            ++instrumentation[mulInst].numMulALUSkipped;
+        if(addResult)
+            ++addResult->numAddALUSkipped;
+        if(mulResult)
+            ++mulResult->numMulALUSkipped;
         return;
     }
 
@@ -1565,19 +2008,19 @@ void QPU::writeConditional(Register dest, const SIMDVector& in, ConditionCode co
         registers.writeRegister(dest, in, elementMask, bitMask);
     }
 
-    if(addInst != nullptr)
+    if(addResult != nullptr)
     {
         if(elementMask.any())
-            ++instrumentation[addInst].numAddALUExecuted;
+            ++addResult->numAddALUExecuted;
         else
-            ++instrumentation[addInst].numAddALUSkipped;
+            ++addResult->numAddALUSkipped;
     }
-    if(mulInst != nullptr)
+    if(mulResult != nullptr)
     {
         if(elementMask.any())
-            ++instrumentation[mulInst].numMulALUExecuted;
+            ++mulResult->numMulALUExecuted;
         else
-            ++instrumentation[mulInst].numMulALUSkipped;
+            ++mulResult->numMulALUSkipped;
     }
 }
 
@@ -1653,6 +2096,9 @@ bool QPU::executeSignal(Signaling signal)
         signal == SIGNAL_NONE)
         // ignore
         return true;
+    if(signal == SIGNAL_SWITCH_THREAD || signal == SIGNAL_THREAD_SWITCH_LAST)
+        // only a single thread is emulated per QPU, so the thread just continues
+        return true;
     if(signal == SIGNAL_LOAD_TMU0)
         return tmus.triggerTMURead(0);
     else if(signal == SIGNAL_LOAD_TMU1)
@@ -1664,7 +2110,10 @@ bool QPU::executeSignal(Signaling signal)
 void QPU::setFlags(const SIMDVector& output, ConditionCode cond, const VectorFlags& newFlags)
 {
     std::vector<std::string> parts;
-    logging::logLazy(logging::Level::DEBUG, [&]() { parts.reserve(flags.size()); });
+    // this is called for nearly every executed instruction, so only check once whether the flags are logged at all
+    const bool logFlags = vc4c::isLogLevelEnabled(logging::Level::DEBUG);
+    if(logFlags)
+        parts.reserve(flags.size());
     for(uint8_t i = 0; i < flags.size(); ++i)
     {
         if(flags[i].matchesCondition(cond))
@@ -1674,11 +2123,13 @@ void QPU::setFlags(const SIMDVector& output, ConditionCode cond, const VectorFla
             // do not set overflow flag, it is only valid for the one instruction
             flags[i].overflow = FlagStatus::UNDEFINED;
 
-            logging::logLazy(logging::Level::DEBUG, [&]() { parts.emplace_back(flags[i].to_string()); });
+            if(logFlags)
+                parts.emplace_back(flags[i].to_string());
         }
     }
-    CPPLOG_LAZY(
-        logging::Level::DEBUG, log << "Setting flags: {" + to_string<std::string>(parts) << "}" << logging::endl);
+    if(logFlags)
+        CPPLOG_LAZY(
+            logging::Level::DEBUG, log << "Setting flags: {" + to_string<std::string>(parts) << "}" << logging::endl);
 
     // TODO not completely correct, see http://maazl.de/project/vc4asm/doc/instructions.html
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 200, "flags set", 1);
@@ -1686,7 +2137,8 @@ void QPU::setFlags(const SIMDVector& output, ConditionCode cond, const VectorFla
 
 std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress baseAddress,
     const std::vector<MemoryAddress>& parameter, const WorkGroupConfig& config, MemoryAddress globalData,
-    const KernelUniforms& uniformsUsed)
+    const KernelUniforms& uniformsUsed, const Optional<std::array<Word, 3>>& totalNumGroups,
+    const std::vector<UniformExpression>& precomputedUniforms)
 {
     std::vector<MemoryAddress> res;
 
@@ -1700,6 +2152,18 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
         !(uniformsUsed.getMaxGroupIDXUsed() && uniformsUsed.getMaxGroupIDYUsed() && uniformsUsed.getMaxGroupIDZUsed()))
         throw CompilationError(CompilationStep::GENERAL,
             "Emulator of multiple work-groups requires work-group-loop optimization to be enabled!");
+    if(precomputedUniforms.size() != uniformsUsed.getNumPrecomputedValues())
+        throw CompilationError(CompilationStep::GENERAL, "The expressions for the precomputed UNIFORMs are missing");
+
+    const auto& numGroups = totalNumGroups ? totalNumGroups.value() : config.numGroups;
+    std::vector<Word> precomputedValues;
+    precomputedValues.reserve(precomputedUniforms.size());
+    for(const auto& expression : precomputedUniforms)
+        precomputedValues.push_back(expression.evaluate(
+            {config.dimensions, (config.localSizes[2] << 16) | (config.localSizes[1] << 8) | config.localSizes[0],
+                numGroups[0], numGroups[1], numGroups[2], config.globalOffsets[0], config.globalOffsets[1],
+                config.globalOffsets[2]},
+            parameter));
 
     for(uint8_t q = 0; q < numQPUs; ++q)
     {
@@ -1714,11 +2178,11 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
         if(uniformsUsed.getLocalIDsUsed())
             qpuUniforms[i++] = (localIDs[2] << 16) | (localIDs[1] << 8) | localIDs[0];
         if(uniformsUsed.getNumGroupsXUsed())
-            qpuUniforms[i++] = config.numGroups[0];
+            qpuUniforms[i++] = numGroups[0];
         if(uniformsUsed.getNumGroupsYUsed())
-            qpuUniforms[i++] = config.numGroups[1];
+            qpuUniforms[i++] = numGroups[1];
         if(uniformsUsed.getNumGroupsZUsed())
-            qpuUniforms[i++] = config.numGroups[2];
+            qpuUniforms[i++] = numGroups[2];
         if(uniformsUsed.getGroupIDXUsed())
             qpuUniforms[i++] = 0; // is only set for single work-groups
         if(uniformsUsed.getGroupIDYUsed())
@@ -1735,6 +2199,8 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
             qpuUniforms[i++] = globalData;
         for(auto param : parameter)
             qpuUniforms[i++] = param;
+        for(auto value : precomputedValues)
+            qpuUniforms[i++] = value;
         if(uniformsUsed.getUniformAddressUsed())
             qpuUniforms[i++] = baseAddress;
         if(uniformsUsed.getMaxGroupIDXUsed())
@@ -1752,8 +2218,7 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
     return res;
 }
 
-static void emulateStep(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction, std::vector<QPU>& qpus,
-    std::bitset<NATIVE_VECTOR_SIZE>& activeQPUs)
+static void emulateStep(std::vector<QPU>& qpus, std::bitset<NATIVE_VECTOR_SIZE>& activeQPUs)
 {
     for(unsigned i = 0; i < qpus.size(); ++i)
     {
@@ -1761,7 +2226,7 @@ static void emulateStep(std::vector<qpu_asm::Instruction>::const_iterator firstI
             continue;
         try
         {
-            bool continueRunning = qpus[i].execute(firstInstruction);
+            bool continueRunning = qpus[i].execute();
             if(!continueRunning)
                 // this QPU has finished
                 activeQPUs.reset(i);
@@ -1770,81 +2235,603 @@ static void emulateStep(std::vector<qpu_asm::Instruction>::const_iterator firstI
         {
             logging::error() << "Emulation threw exception execution in following instruction on QPU "
                              << static_cast<unsigned>(qpus[i].ID) << ": "
-                             << qpus[i].getCurrentInstruction(firstInstruction)->toHexString(true) << logging::endl;
+                             << qpus[i].getCurrentInstruction()->toHexString(true) << logging::endl;
             // re-throw error
             throw;
         }
     }
 }
 
-bool tools::emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction, Memory& memory,
-    const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation, uint32_t maxCycles)
+static void addInstrumentation(InstrumentationResults& instrumentation, const InstrumentationResults& results)
+{
+    instrumentation.resize(std::max(instrumentation.size(), results.size()), InstrumentationResult{});
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        instrumentation[i].numAddALUExecuted += results[i].numAddALUExecuted;
+        instrumentation[i].numAddALUSkipped += results[i].numAddALUSkipped;
+        instrumentation[i].numMulALUExecuted += results[i].numMulALUExecuted;
+        instrumentation[i].numMulALUSkipped += results[i].numMulALUSkipped;
+        instrumentation[i].numBranchTaken += results[i].numBranchTaken;
+        instrumentation[i].numStalls += results[i].numStalls;
+        instrumentation[i].numTMUStalls += results[i].numTMUStalls;
+        instrumentation[i].numVPMStalls += results[i].numVPMStalls;
+        instrumentation[i].numMutexStalls += results[i].numMutexStalls;
+        instrumentation[i].numSemaphoreStalls += results[i].numSemaphoreStalls;
+        instrumentation[i].numExecutions += results[i].numExecutions;
+    }
+}
+
+static void logRunningQPUs(const std::vector<QPU>& qpus)
+{
+    logging::error() << "After the maximum number of execution cycles, following QPUs are still running: "
+                     << logging::endl;
+    for(const QPU& qpu : qpus)
+        logging::error() << "QPU " << static_cast<unsigned>(qpu.ID) << ": "
+                         << qpu.getCurrentInstruction()->toASMString() << logging::endl;
+}
+
+/*
+ * Emulates the QPUs block-wise (on multiple host threads) with the same results as the serial emulation in #emulate().
+ *
+ * The instructions only accessing the state of their own QPU are executed for all QPUs in parallel, each QPU running
+ * ahead until its next instruction accesses the periphery shared between the QPUs (see
+ * DecodedInstruction#accessesSharedState). The pending instructions accessing shared state are then executed on a
+ * single thread in the order of the serial emulation (by cycle, then by QPU number), as long as the earliest pending
+ * instruction of all QPUs is such an instruction. Since the VPM is the only shared periphery depending on the cycle, it
+ * is advanced to the cycle of the instruction before every execution.
+ *
+ * For a single thread, the blocks of QPU-local instructions are executed on the calling thread one QPU after the
+ * other, which saves stepping all QPUs and the periphery cycle by cycle.
+ */
+static bool emulateParallel(std::vector<QPU>& qpus, std::array<SFU, NUM_QPUS>& sfus, VPM& vpm, uint32_t maxCycles,
+    unsigned numThreads, uint32_t& numCycles)
+{
+    struct QPUState
+    {
+        // the cycle of the next instruction to execute
+        uint32_t cycle = 0;
+        bool active = true;
+        // the error thrown by the instruction at the current cycle
+        std::exception_ptr error;
+    };
+    std::vector<QPUState> states(qpus.size());
+    uint32_t vpmCycle = 0;
+    bool timedOut = false;
+
+    auto step = [&](std::size_t index) {
+        auto& state = states[index];
+        try
+        {
+            if(!qpus[index].execute())
+                // this QPU has finished
+                state.active = false;
+        }
+        catch(const std::exception&)
+        {
+            state.error = std::current_exception();
+            state.active = false;
+            return;
+        }
+        sfus[index].incrementCycle();
+        ++state.cycle;
+        if(state.cycle == maxCycles)
+            state.active = false;
+    };
+
+    auto runLocalBlock = [&](const std::size_t& index) {
+        while(states[index].active && !qpus[index].isAccessingSharedState())
+            step(index);
+    };
+
+    std::vector<std::size_t> indices(qpus.size());
+    std::iota(indices.begin(), indices.end(), std::size_t{0});
+    std::unique_ptr<ThreadPool> pool;
+    if(numThreads > 1)
+        pool.reset(new ThreadPool{"Emulator", numThreads});
+    while(true)
+    {
+        if(pool)
+            pool->scheduleAll<std::size_t, std::vector<std::size_t>>(indices, runLocalBlock, 1);
+        else
+            std::for_each(indices.begin(), indices.end(), runLocalBlock);
+
+        while(true)
+        {
+            // the pending instruction which would be executed next by the serial emulation
+            auto next = states.end();
+            for(auto it = states.begin(); it != states.end(); ++it)
+            {
+                if((it->active || it->error) && (next == states.end() || it->cycle < next->cycle))
+                    next = it;
+            }
+            if(next == states.end())
+            {
+                for(const auto& state : states)
+                    timedOut = timedOut || state.cycle == maxCycles;
+                if(timedOut)
+                    logRunningQPUs(qpus);
+                numCycles = std::accumulate(states.begin(), states.end(), 0u,
+                    [](uint32_t cycles, const QPUState& state) -> uint32_t { return std::max(cycles, state.cycle); });
+                for(; vpmCycle < numCycles; ++vpmCycle)
+                    vpm.incrementCycle();
+                return !timedOut;
+            }
+            auto index = static_cast<std::size_t>(next - states.begin());
+            if(next->error)
+            {
+                logging::error() << "Emulation threw exception execution in following instruction on QPU "
+                                 << static_cast<unsigned>(qpus[index].ID) << ": "
+                                 << qpus[index].getCurrentInstruction()->toHexString(true) << logging::endl;
+                std::rethrow_exception(next->error);
+            }
+            if(!qpus[index].isAccessingSharedState())
+                // continue executing the QPU-local instructions in parallel
+                break;
+            for(; vpmCycle < next->cycle; ++vpmCycle)
+                vpm.incrementCycle();
+            step(index);
+        }
+    }
+}
+
+/*
+ * Checkpoints of the emulator state
+ *
+ * The state is written in the host's native binary representation, so a checkpoint can only be restored by the same
+ * build of the emulator for the same kernel and input.
+ */
+static constexpr char CHECKPOINT_MAGIC[] = "VC4CEMU";
+static constexpr uint32_t CHECKPOINT_VERSION = 2;
+
+template <typename T>
+static void writeState(std::ostream& out, const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable state can be written directly");
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static void readState(std::istream& in, T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable state can be read directly");
+    if(!in.read(reinterpret_cast<char*>(&value), sizeof(T)))
+        throw CompilationError(CompilationStep::GENERAL, "Unexpected end of emulator checkpoint");
+}
+
+static void writeState(std::ostream& out, const SIMDVector& vector)
+{
+    for(const auto& element : vector)
+        writeState(out, element);
+}
+
+static void readState(std::istream& in, SIMDVector& vector)
+{
+    SIMDVector tmp;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        readState(in, tmp[i]);
+    vector = tmp;
+}
+
+static void writeState(std::ostream& out, const Optional<SIMDVector>& vector)
+{
+    writeState(out, vector.has_value());
+    if(vector)
+        writeState(out, *vector);
+}
+
+static void readState(std::istream& in, Optional<SIMDVector>& vector)
+{
+    bool hasValue = false;
+    readState(in, hasValue);
+    vector = {};
+    if(hasValue)
+    {
+        SIMDVector tmp;
+        readState(in, tmp);
+        vector = tmp;
+    }
+}
+
+static void writeState(std::ostream& out, const std::queue<std::pair<SIMDVector, uint32_t>>& queue)
+{
+    writeState(out, static_cast<uint32_t>(queue.size()));
+    auto copy = queue;
+    while(!copy.empty())
+    {
+        writeState(out, copy.front().first);
+        writeState(out, copy.front().second);
+        copy.pop();
+    }
+}
+
+static void readState(std::istream& in, std::queue<std::pair<SIMDVector, uint32_t>>& queue)
+{
+    uint32_t size = 0;
+    readState(in, size);
+    queue = {};
+    for(uint32_t i = 0; i < size; ++i)
+    {
+        std::pair<SIMDVector, uint32_t> entry;
+        readState(in, entry.first);
+        readState(in, entry.second);
+        queue.emplace(std::move(entry));
+    }
+}
+
+void Memory::saveState(std::ostream& out) const
+{
+    writeState(out, static_cast<uint32_t>(regions.size()));
+    for(const auto& region : regions)
+    {
+        writeState(out, region.start);
+        writeState(out, region.end);
+        out.write(reinterpret_cast<const char*>(region.data), region.end - region.start);
+    }
+}
+
+void Memory::restoreState(std::istream& in)
+{
+    uint32_t numRegions = 0;
+    readState(in, numRegions);
+    if(numRegions != regions.size())
+        throw CompilationError(CompilationStep::GENERAL, "Memory layout of emulator checkpoint does not match");
+    for(auto& region : regions)
+    {
+        MemoryAddress start = 0;
+        MemoryAddress end = 0;
+        readState(in, start);
+        readState(in, end);
+        if(start != region.start || end != region.end)
+            throw CompilationError(CompilationStep::GENERAL, "Memory layout of emulator checkpoint does not match",
+                std::to_string(start) + " - " + std::to_string(end));
+        if(!in.read(reinterpret_cast<char*>(region.data), region.end - region.start))
+            throw CompilationError(CompilationStep::GENERAL, "Unexpected end of emulator checkpoint");
+    }
+}
+
+void Mutex::saveState(std::ostream& out) const
+{
+    writeState(out, locked);
+    writeState(out, lockOwner);
+}
+
+void Mutex::restoreState(std::istream& in)
+{
+    readState(in, locked);
+    readState(in, lockOwner);
+}
+
+void Registers::saveState(std::ostream& out) const
+{
+    for(const auto& reg : storageRegisters)
+    {
+        writeState(out, reg.first);
+        writeState(out, reg.second);
+    }
+    writeState(out, hostInterrupt);
+}
+
+void Registers::restoreState(std::istream& in)
+{
+    for(auto& reg : storageRegisters)
+    {
+        readState(in, reg.first);
+        readState(in, reg.second);
+    }
+    readState(in, hostInterrupt);
+    // the checkpoints are taken between two instructions, so no register is read in the current instruction yet
+    clearReadCache();
+}
+
+void UniformCache::saveState(std::ostream& out) const
+{
+    writeState(out, uniformAddress);
+    writeState(out, lastAddressSetCycle);
+}
+
+void UniformCache::restoreState(std::istream& in)
+{
+    readState(in, uniformAddress);
+    readState(in, lastAddressSetCycle);
+}
+
+void TMUs::saveState(std::ostream& out) const
+{
+    writeState(out, tmuNoSwap);
+    writeState(out, lastTMUNoSwap);
+    writeState(out, tmu0RequestQueue);
+    writeState(out, tmu0ResponseQueue);
+    writeState(out, tmu1RequestQueue);
+    writeState(out, tmu1ResponseQueue);
+    writeState(out, static_cast<uint32_t>(cacheTags.size()));
+    for(auto tag : cacheTags)
+        writeState(out, tag);
+}
+
+void TMUs::restoreState(std::istream& in)
+{
+    readState(in, tmuNoSwap);
+    readState(in, lastTMUNoSwap);
+    readState(in, tmu0RequestQueue);
+    readState(in, tmu0ResponseQueue);
+    readState(in, tmu1RequestQueue);
+    readState(in, tmu1ResponseQueue);
+    uint32_t numCacheLines = 0;
+    readState(in, numCacheLines);
+    if(numCacheLines != cacheTags.size())
+        throw CompilationError(CompilationStep::GENERAL, "TMU cache size of emulator checkpoint does not match");
+    for(auto& tag : cacheTags)
+        readState(in, tag);
+}
+
+void SFU::saveState(std::ostream& out) const
+{
+    writeState(out, lastSFUWrite);
+    writeState(out, currentCycle);
+    writeState(out, sfuResult);
+}
+
+void SFU::restoreState(std::istream& in)
+{
+    readState(in, lastSFUWrite);
+    readState(in, currentCycle);
+    readState(in, sfuResult);
+}
+
+void VPM::saveState(std::ostream& out) const
+{
+    for(auto setup : {vpmReadSetup, vpmWriteSetup, dmaReadSetup, dmaWriteSetup, readStrideSetup, writeStrideSetup,
+            dmaReadDone, dmaWriteDone, currentCycle})
+        writeState(out, setup);
+    writeState(out, cache);
+}
+
+void VPM::restoreState(std::istream& in)
+{
+    for(auto setup : {&vpmReadSetup, &vpmWriteSetup, &dmaReadSetup, &dmaWriteSetup, &readStrideSetup,
+            &writeStrideSetup, &dmaReadDone, &dmaWriteDone, &currentCycle})
+        readState(in, *setup);
+    readState(in, cache);
+}
+
+void MemoryBus::saveState(std::ostream& out) const
+{
+    writeState(out, busyUntil);
+}
+
+void MemoryBus::restoreState(std::istream& in)
+{
+    readState(in, busyUntil);
+}
+
+void Semaphores::saveState(std::ostream& out) const
+{
+    writeState(out, counter);
+}
+
+void Semaphores::restoreState(std::istream& in)
+{
+    readState(in, counter);
+}
+
+void QPU::saveState(std::ostream& out) const
+{
+    writeState(out, currentCycle);
+    writeState(out, pc);
+    for(const auto& elementFlags : flags)
+        writeState(out, elementFlags);
+    registers.saveState(out);
+    uniforms.saveState(out);
+    tmus.saveState(out);
+}
+
+void QPU::restoreState(std::istream& in)
+{
+    readState(in, currentCycle);
+    readState(in, pc);
+    for(auto& elementFlags : flags)
+        readState(in, elementFlags);
+    registers.restoreState(in);
+    uniforms.restoreState(in);
+    tmus.restoreState(in);
+}
+
+static std::vector<DecodedInstruction> decodeInstructions(
+    std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+    std::vector<qpu_asm::Instruction>::const_iterator lastInstruction)
+{
+    // decode the instructions once up front instead of on every execution
+    PROFILE_START(DecodeInstructions);
+    std::vector<DecodedInstruction> program;
+    program.reserve(static_cast<std::size_t>(std::distance(firstInstruction, lastInstruction)));
+    for(auto it = firstInstruction; it != lastInstruction; ++it)
+        program.emplace_back(*it);
+    PROFILE_END(DecodeInstructions);
+    return program;
+}
+
+bool tools::emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+    std::vector<qpu_asm::Instruction>::const_iterator lastInstruction, Memory& memory,
+    const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation, uint32_t maxCycles,
+    uint32_t* numCycles, unsigned numThreads, bool cycleAccurate)
+{
+    return emulate(decodeInstructions(firstInstruction, lastInstruction), memory, uniformAddresses, instrumentation,
+        maxCycles, numCycles, numThreads, cycleAccurate);
+}
+
+bool tools::emulate(const std::vector<DecodedInstruction>& program, Memory& memory,
+    const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation, uint32_t maxCycles,
+    uint32_t* numCycles, unsigned numThreads, bool cycleAccurate, const CheckpointSettings& checkpoints,
+    const TimingModel& timing, MemoryTrace* trace)
 {
     if(uniformAddresses.size() > NUM_QPUS)
         throw CompilationError(CompilationStep::GENERAL, "Cannot use more than 12 QPUs!");
+    if(timing.tmuCacheLines != 0 && timing.tmuCacheLineSize == 0)
+        throw CompilationError(CompilationStep::GENERAL, "The TMU cache line size cannot be zero");
+
+    instrumentation.assign(program.size(), InstrumentationResult{});
 
     Mutex mutex;
     // FIXME is SFU execution per QPU or need SFUs be locked?
     std::array<SFU, NUM_QPUS> sfus;
-    VPM vpm(memory);
+    MemoryBus bus(timing.memoryBytesPerCycle);
+    VPM vpm(memory, bus, timing, cycleAccurate, trace);
     Semaphores semaphores;
 
+    // The block-wise emulation has the same results as the cycle-wise emulation, but interleaves the log output of the
+    // QPUs differently, so it is only used for multiple threads or for the functional emulation, which does not log
+    // the executed instructions anyway. Since the QPUs run ahead of each other, there is no single cycle to take a
+    // checkpoint at.
+    // NOTE: This only saves stepping all QPUs and the periphery cycle by cycle, every instruction is still interpreted.
+    // TODO translate the blocks of QPU-local instructions to host code (e.g. via LLVM) for long-running emulations
+    const bool useCheckpoints = checkpoints.checkpointInterval != 0 || !checkpoints.resumeFile.empty();
+    const bool runBlockWise = (numThreads > 1 || !cycleAccurate) && uniformAddresses.size() > 1 && !useCheckpoints;
+    // when running in parallel, every QPU counts into its own results which are accumulated afterwards
+    std::vector<InstrumentationResults> qpuInstrumentation(
+        runBlockWise ? uniformAddresses.size() : 0, InstrumentationResults(program.size(), InstrumentationResult{}));
+
     std::vector<QPU> qpus;
     qpus.reserve(uniformAddresses.size());
     std::bitset<NATIVE_VECTOR_SIZE> activeQPUs = (1 << uniformAddresses.size()) - 1;
     uint8_t numQPU = 0;
     for(MemoryAddress uniformPointer : uniformAddresses)
     {
-        qpus.emplace_back(numQPU, mutex, sfus.at(numQPU), vpm, semaphores, memory, uniformPointer, instrumentation);
+        qpus.emplace_back(numQPU, mutex, sfus.at(numQPU), vpm, semaphores, memory, bus, uniformPointer, program,
+            runBlockWise ? qpuInstrumentation[numQPU] : instrumentation, timing, cycleAccurate, trace);
         ++numQPU;
     }
 
     uint32_t cycle = 0;
+    auto writeCheckpoint = [&]() {
+        // the previous checkpoint is only replaced once the new one is complete
+        auto tmpFile = checkpoints.checkpointFile + ".tmp";
+        {
+            std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+            out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+            writeState(out, CHECKPOINT_VERSION);
+            writeState(out, static_cast<uint32_t>(program.size()));
+            writeState(out, static_cast<uint32_t>(qpus.size()));
+            writeState(out, cycle);
+            writeState(out, static_cast<uint32_t>(activeQPUs.to_ulong()));
+            for(const auto& result : instrumentation)
+                writeState(out, result);
+            memory.saveState(out);
+            bus.saveState(out);
+            mutex.saveState(out);
+            vpm.saveState(out);
+            semaphores.saveState(out);
+            for(const auto& sfu : sfus)
+                sfu.saveState(out);
+            for(const auto& qpu : qpus)
+                qpu.saveState(out);
+            if(!out)
+                throw CompilationError(CompilationStep::GENERAL, "Failed to write emulator checkpoint", tmpFile);
+        }
+        if(std::rename(tmpFile.data(), checkpoints.checkpointFile.data()) != 0)
+            throw CompilationError(
+                CompilationStep::GENERAL, "Failed to replace emulator checkpoint", checkpoints.checkpointFile);
+        LOG_LAZY(logging::Level::INFO,
+            log << "Wrote emulator checkpoint for cycle " << cycle << " to: " << checkpoints.checkpointFile
+                << logging::endl);
+    };
+    auto restoreCheckpoint = [&]() {
+        std::ifstream in(checkpoints.resumeFile, std::ios::binary);
+        if(!in)
+            throw CompilationError(
+                CompilationStep::GENERAL, "Failed to open emulator checkpoint", checkpoints.resumeFile);
+        char magic[sizeof(CHECKPOINT_MAGIC)] = {};
+        uint32_t version = 0;
+        uint32_t numInstructions = 0;
+        uint32_t numQPUs = 0;
+        in.read(magic, sizeof(magic));
+        readState(in, version);
+        readState(in, numInstructions);
+        readState(in, numQPUs);
+        if(std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 || version != CHECKPOINT_VERSION)
+            throw CompilationError(
+                CompilationStep::GENERAL, "Invalid or unsupported emulator checkpoint", checkpoints.resumeFile);
+        if(numInstructions != program.size() || numQPUs != qpus.size())
+            throw CompilationError(CompilationStep::GENERAL,
+                "Emulator checkpoint was written for a different kernel or work-group size", checkpoints.resumeFile);
+        uint32_t active = 0;
+        readState(in, cycle);
+        readState(in, active);
+        activeQPUs = active;
+        for(auto& result : instrumentation)
+            readState(in, result);
+        memory.restoreState(in);
+        bus.restoreState(in);
+        mutex.restoreState(in);
+        vpm.restoreState(in);
+        semaphores.restoreState(in);
+        for(auto& sfu : sfus)
+            sfu.restoreState(in);
+        for(auto& qpu : qpus)
+            qpu.restoreState(in);
+        LOG_LAZY(logging::Level::INFO,
+            log << "Resuming emulation at cycle " << cycle << " from checkpoint: " << checkpoints.resumeFile
+                << logging::endl);
+    };
+    if(!checkpoints.resumeFile.empty())
+        restoreCheckpoint();
+    const auto startCycle = cycle;
+
     bool success = true;
     PROFILE_START(Emulation);
+    if(runBlockWise)
+    {
+        success = emulateParallel(qpus, sfus, vpm, maxCycles, numThreads, cycle);
+        for(const auto& results : qpuInstrumentation)
+            addInstrumentation(instrumentation, results);
+        activeQPUs.reset();
+    }
     while(activeQPUs.any())
     {
-        CPPLOG_LAZY(logging::Level::DEBUG, log << "Emulating cycle: " << cycle << logging::endl);
+        if(checkpoints.checkpointInterval != 0 && cycle != startCycle && cycle % checkpoints.checkpointInterval == 0)
+            writeCheckpoint();
+        if(cycleAccurate)
+            LOG_LAZY(logging::Level::DEBUG, log << "Emulating cycle: " << cycle << logging::endl);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 250, "emulation cycles (utilization)", qpus.size());
-        emulateStep(firstInstruction, qpus, activeQPUs);
+        emulateStep(qpus, activeQPUs);
+        // the SFU cycles are still required to detect reading the SFU result too early
         for(SFU& sfu : sfus)
             sfu.incrementCycle();
-        vpm.incrementCycle();
+        if(cycleAccurate)
+            vpm.incrementCycle();
 
         ++cycle;
 
-        if(cycle == maxCycles)
+        if(cycle >= maxCycles)
         {
-            logging::error() << "After the maximum number of execution cycles, following QPUs are still running: "
-                             << logging::endl;
-            for(const QPU& qpu : qpus)
-                logging::error() << "QPU " << static_cast<unsigned>(qpu.ID) << ": "
-                                 << qpu.getCurrentInstruction(firstInstruction)->toASMString() << logging::endl;
+            logRunningQPUs(qpus);
             success = false;
             break;
         }
     }
     PROFILE_END(Emulation);
 
-    // Run some sanity checks
-    semaphores.checkAllZero();
+    // Run some sanity checks, a kernel leaving a semaphore set would block the next kernel executed on the hardware
+    if(!semaphores.checkAllZero())
+        success = false;
     if(mutex.isLocked())
     {
-        CPPLOG_LAZY(logging::Level::ERROR, log << "Hardware mutex was not unlocked!" << logging::endl);
+        LOG_LAZY(logging::Level::ERROR, log << "Hardware mutex was not unlocked!" << logging::endl);
     }
 
-    CPPLOG_LAZY(logging::Level::INFO,
+    LOG_LAZY(logging::Level::INFO,
         log << "Emulation " << (success ? "finished" : "timed out") << " for " << uniformAddresses.size()
             << " QPUs after " << cycle << " cycles" << logging::endl);
 
     vpm.dumpContents();
+    if(numCycles)
+        *numCycles = cycle;
     return success;
 }
 
 bool tools::emulateTask(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
-    const std::vector<MemoryAddress>& parameter, Memory& memory, MemoryAddress uniformBaseAddress,
-    MemoryAddress globalData, const KernelUniforms& uniformsUsed, InstrumentationResults& instrumentation,
-    uint32_t maxCycles)
+    std::vector<qpu_asm::Instruction>::const_iterator lastInstruction, const std::vector<MemoryAddress>& parameter,
+    Memory& memory, MemoryAddress uniformBaseAddress, MemoryAddress globalData, const KernelUniforms& uniformsUsed,
+    InstrumentationResults& instrumentation, uint32_t maxCycles)
 {
     WorkGroupConfig config;
     config.dimensions = 1;
@@ -1853,11 +2840,11 @@ bool tools::emulateTask(std::vector<qpu_asm::Instruction>::const_iterator firstI
     config.numGroups = {1, 1, 1};
     const auto uniformAddresses =
         buildUniforms(memory, uniformBaseAddress, parameter, config, globalData, uniformsUsed);
-    return emulate(firstInstruction, memory, uniformAddresses, instrumentation, maxCycles);
+    return emulate(firstInstruction, lastInstruction, memory, uniformAddresses, instrumentation, maxCycles);
 }
 
-static Memory fillMemory(const StableList<Global>& globalData, const EmulationData& settings,
-    MemoryAddress& uniformBaseAddressOut, MemoryAddress& globalDataAddressOut,
+static void fillMemory(Memory& mem, const StableList<Global>& globalData, const EmulationData& settings,
+    tools::Word numWorkItems, MemoryAddress& uniformBaseAddressOut, MemoryAddress& globalDataAddressOut,
     std::vector<MemoryAddress>& parameterAddressesOut)
 {
     auto globalDataSize =
@@ -1868,20 +2855,20 @@ static Memory fillMemory(const StableList<Global>& globalData, const EmulationDa
     // make sure to have enough space to align UNIFORMs
     while((size % 8) != 0)
         ++size;
-    size += settings.calcNumWorkItems() * (16 + settings.parameter.size());
-    Memory mem(size);
+    size += numWorkItems * (16 + settings.parameter.size());
+    mem.reset(size);
 
     MemoryAddress currentAddress = 0;
     globalDataAddressOut = currentAddress;
 
-    CPPLOG_LAZY(logging::Level::DEBUG, log << "Memory layout:" << logging::endl);
+    LOG_LAZY(logging::Level::DEBUG, log << "Memory layout:" << logging::endl);
 
     for(const Global& global : globalData)
     {
         if(!global.initialValue.type.getArrayType() || global.initialValue.type.getElementType() != TYPE_INT32)
             throw CompilationError(
                 CompilationStep::GENERAL, "Unhandled type of global data", global.initialValue.type.to_string());
-        CPPLOG_LAZY(logging::Level::DEBUG,
+        LOG_LAZY(logging::Level::DEBUG,
             log << "\tGlobal '" << global.name << "' at offset 0x" << std::hex << currentAddress << std::dec
                 << logging::endl);
         if(auto compound = global.initialValue.getCompound())
@@ -1905,10 +2892,16 @@ static Memory fillMemory(const StableList<Global>& globalData, const EmulationDa
     parameterAddressesOut.reserve(settings.parameter.size());
     for(const auto& pair : settings.parameter)
     {
+        if(settings.mappedParameters.find(parameterAddressesOut.size()) != settings.mappedParameters.end())
+        {
+            // the address is assigned when the buffer is mapped below
+            parameterAddressesOut.emplace_back(0);
+            continue;
+        }
         tools::Word* addr = mem.getWordAddress(currentAddress);
         if(pair.second)
         {
-            CPPLOG_LAZY(logging::Level::DEBUG,
+            LOG_LAZY(logging::Level::DEBUG,
                 log << "\tParameter at offset 0x" << std::hex << currentAddress << std::dec << " with "
                     << pair.second->size() << " words" << logging::endl);
             parameterAddressesOut.emplace_back(currentAddress);
@@ -1927,7 +2920,24 @@ static Memory fillMemory(const StableList<Global>& globalData, const EmulationDa
 
     uniformBaseAddressOut = currentAddress;
 
-    return mem;
+    // the caller-owned buffers are mapped behind the memory owned by the emulator
+    auto mappedAddress = mem.getMaximumAddress();
+    for(const auto& mapped : settings.mappedParameters)
+    {
+        if(mapped.first >= settings.parameter.size())
+            throw CompilationError(CompilationStep::GENERAL, "Mapped buffer for invalid parameter index",
+                std::to_string(mapped.first));
+        if(mappedAddress % (sizeof(tools::Word) * 8) != 0)
+            mappedAddress +=
+                static_cast<MemoryAddress>((sizeof(tools::Word) * 8) - (mappedAddress % (sizeof(tools::Word) * 8)));
+        LOG_LAZY(logging::Level::DEBUG,
+            log << "\tMapped parameter at offset 0x" << std::hex << mappedAddress << std::dec << " with "
+                << mapped.second.numWords << " words" << logging::endl);
+        mem.mapBuffer(mappedAddress, reinterpret_cast<uint8_t*>(mapped.second.data),
+            mapped.second.numWords * sizeof(tools::Word));
+        parameterAddressesOut[mapped.first] = mappedAddress;
+        mappedAddress += static_cast<MemoryAddress>(mapped.second.numWords * sizeof(tools::Word));
+    }
 }
 
 LCOV_EXCL_START
@@ -1945,13 +2955,17 @@ static void dumpMemory(const Memory& memory, const std::string& fileName, Memory
             f << "Uniforms: " << std::endl;
         if(addr % (sizeof(tools::Word) * 8) == 0)
             f << std::hex << "0x" << addr << "\t";
-        f << " " << std::hex << std::setfill('0') << std::setw(8) << memory.readWord(addr);
+        if(memory.isValidAddress(addr))
+            f << " " << std::hex << std::setfill('0') << std::setw(8) << memory.readWord(addr);
+        else
+            // gap between the mapped buffers
+            f << " --------";
         if(addr % (sizeof(tools::Word) * 8) == (sizeof(tools::Word) * 7))
             f << std::endl;
         addr += static_cast<MemoryAddress>(sizeof(tools::Word));
     }
     f << std::endl;
-    CPPLOG_LAZY(logging::Level::DEBUG,
+    LOG_LAZY(logging::Level::DEBUG,
         log << std::dec << "Dumped " << addr << " words of memory into " << fileName << logging::endl);
 }
 
@@ -1988,70 +3002,419 @@ std::string InstrumentationResult::to_string() const
         parts.emplace_back(tmp.str());
         tmp.str("");
     }
+    if(numTMUStalls > 0)
+        parts.emplace_back("tmu: " + std::to_string(numTMUStalls));
+    if(numVPMStalls > 0)
+        parts.emplace_back("vpm: " + std::to_string(numVPMStalls));
+    if(numMutexStalls > 0)
+        parts.emplace_back("mutex: " + std::to_string(numMutexStalls));
+    if(numSemaphoreStalls > 0)
+        parts.emplace_back("semaphore: " + std::to_string(numSemaphoreStalls));
 
     return vc4c::to_string<std::string>(parts);
 }
 LCOV_EXCL_STOP
 
-EmulationResult tools::emulate(const EmulationData& data)
+/*
+ * Creates the execution profile from the number of executions of the first instruction of every basic block of the
+ * kernel and adds it to the profile file
+ */
+static void writeExecutionProfile(
+    const EmulationData& data, const std::string& kernelName, const std::vector<InstrumentationResult>& instrumentation)
+{
+    if(data.profileBlockPositions.empty())
+        throw CompilationError(
+            CompilationStep::GENERAL, "The basic block positions are required to create an execution profile");
+    auto positions = analysis::ExecutionProfile::readFile(data.profileBlockPositions);
+    auto blocks = positions.getEntries(kernelName);
+    if(!blocks)
+        throw CompilationError(CompilationStep::GENERAL, "No basic block positions found for kernel", kernelName);
+
+    analysis::ExecutionProfile profile;
+    {
+        std::ifstream previousProfile(data.profileDump);
+        if(previousProfile)
+            profile.readFrom(previousProfile);
+    }
+    for(const auto& block : *blocks)
+    {
+        auto index = block.second / sizeof(uint64_t);
+        // empty blocks at the end of the kernel are positioned behind the last instruction
+        profile.addEntry(
+            kernelName, block.first, index < instrumentation.size() ? instrumentation[index].numExecutions : 0);
+    }
+
+    std::ofstream out(data.profileDump, std::ios::trunc);
+    if(!out)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Failed to open file to write execution profile", data.profileDump);
+    profile.writeTo(out);
+}
+
+static tools::Word calcNumWorkItems(const WorkGroupConfig& config)
+{
+    return config.localSizes[0] * config.localSizes[1] * config.localSizes[2] * config.numGroups[0] *
+        config.numGroups[1] * config.numGroups[2];
+}
+
+/*
+ * Splits the work-groups along the outermost dimension with multiple work-groups into at most the given number of
+ * shards of consecutive work-groups.
+ *
+ * Since the work-group loop always starts at the work-group ID zero, the work-groups of a shard are selected by
+ * shifting the global offset.
+ */
+static std::vector<WorkGroupConfig> splitWorkGroups(const WorkGroupConfig& config, unsigned numShards)
+{
+    std::size_t dim = config.numGroups.size();
+    while(dim > 0 && config.numGroups[dim - 1] <= 1)
+        --dim;
+    if(numShards <= 1 || dim == 0)
+        return {config};
+    --dim;
+    auto numGroups = config.numGroups[dim];
+    numShards = std::min(numShards, numGroups);
+
+    std::vector<WorkGroupConfig> shards;
+    shards.reserve(numShards);
+    for(unsigned shard = 0; shard < numShards; ++shard)
+    {
+        auto firstGroup = static_cast<tools::Word>(uint64_t{numGroups} * shard / numShards);
+        auto endGroup = static_cast<tools::Word>(uint64_t{numGroups} * (shard + 1) / numShards);
+        shards.emplace_back(config);
+        shards.back().numGroups[dim] = endGroup - firstGroup;
+        shards.back().globalOffsets[dim] += firstGroup * config.localSizes[dim];
+    }
+    return shards;
+}
+
+/*
+ * Emulates the shards of work-groups independently of each other on multiple host threads, each with its own copy of
+ * the memory. Afterwards, the words modified by the shards in the global data and the parameter buffers (everything
+ * below the UNIFORMs) are merged into the given memory.
+ */
+static bool emulateWorkGroupShards(const std::vector<DecodedInstruction>& program, const StableList<Global>& globals,
+    const EmulationData& data, const qpu_asm::KernelInfo& kernelInfo, const std::vector<WorkGroupConfig>& shards,
+    Memory& memory, MemoryAddress uniformAddress, InstrumentationResults& instrumentation, uint32_t& numCycles)
+{
+    if(data.checkWorkGroupShards && !data.mappedParameters.empty())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Cannot check work-group shards directly modifying caller-owned buffers");
+
+    struct ShardResult
+    {
+        std::unique_ptr<Memory> memory;
+        InstrumentationResults instrumentation;
+        uint32_t numCycles = 0;
+        bool successful = false;
+        std::exception_ptr error;
+    };
+    std::vector<ShardResult> results(shards.size());
+
+    std::vector<std::size_t> indices(shards.size());
+    std::iota(indices.begin(), indices.end(), std::size_t{0});
+    ThreadPool::getDefaultPool().scheduleAll<std::size_t, std::vector<std::size_t>>(
+        indices,
+        [&](const std::size_t& index) {
+            auto& result = results[index];
+            try
+            {
+                MemoryAddress shardUniformAddress;
+                MemoryAddress globalDataAddress;
+                std::vector<MemoryAddress> paramAddresses;
+                result.memory.reset(new Memory(0));
+                fillMemory(*result.memory, globals, data, calcNumWorkItems(shards[index]), shardUniformAddress,
+                    globalDataAddress, paramAddresses);
+                auto uniformAddresses = buildUniforms(*result.memory, shardUniformAddress, paramAddresses,
+                    shards[index], globalDataAddress, kernelInfo.uniformsUsed, data.workGroup.numGroups,
+                    kernelInfo.precomputedUniforms);
+                result.successful = emulate(program, *result.memory, uniformAddresses, result.instrumentation,
+                    data.maxEmulationCycles, &result.numCycles, data.numThreads, data.cycleAccurate, {}, data.timing);
+            }
+            catch(const std::exception&)
+            {
+                result.error = std::current_exception();
+            }
+        },
+        1);
+
+    for(const auto& result : results)
+    {
+        if(result.error)
+            std::rethrow_exception(result.error);
+    }
+
+    const auto numWords = uniformAddress / sizeof(tools::Word);
+    const auto* baseWords = reinterpret_cast<const tools::Word*>(memory.getBytes(0, uniformAddress));
+    std::vector<tools::Word> initialWords(baseWords, baseWords + numWords);
+    // the shard which modified the word, if checked for conflicts
+    std::vector<std::size_t> writers(data.checkWorkGroupShards ? numWords : 0, shards.size());
+    bool success = true;
+    numCycles = 0;
+    for(std::size_t index = 0; index < results.size(); ++index)
+    {
+        const auto& result = results[index];
+        success = success && result.successful;
+        // the work-groups are executed one after the other on the same QPUs
+        numCycles += result.numCycles;
+        addInstrumentation(instrumentation, result.instrumentation);
+
+        const auto* shardWords = reinterpret_cast<const tools::Word*>(result.memory->getBytes(0, uniformAddress));
+        auto* words = reinterpret_cast<tools::Word*>(memory.getBytes(0, uniformAddress));
+        for(std::size_t i = 0; i < numWords; ++i)
+        {
+            if(shardWords[i] == initialWords[i])
+                continue;
+            if(data.checkWorkGroupShards)
+            {
+                if(writers[i] != shards.size())
+                    throw CompilationError(CompilationStep::GENERAL,
+                        "Work-group shards " + std::to_string(writers[i]) + " and " + std::to_string(index) +
+                            " both modify the memory at address",
+                        std::to_string(i * sizeof(tools::Word)));
+                writers[i] = index;
+            }
+            words[i] = shardWords[i];
+        }
+    }
+    LOG_LAZY(logging::Level::INFO,
+        log << "Merged memory of " << shards.size() << " work-group shards emulated in " << numCycles
+            << " cycles total" << logging::endl);
+    return success;
+}
+
+/*
+ * Writes the emulated cycles of the kernel rolled up into its basic blocks and loops in the folded stack format, i.e.
+ * one line "kernel;outer loop;inner loop;block count" per basic block and one line per stall reason of the block.
+ *
+ * The basic blocks start at the kernel start, the branch targets and behind the delay slots of every branch. Every
+ * backward branch closes a loop starting at its target.
+ */
+static void writeHotspots(const EmulationData& data, const std::string& kernelName,
+    const std::vector<DecodedInstruction>& program, const std::vector<InstrumentationResult>& instrumentation)
+{
+    const auto numInstructions = instrumentation.size();
+    std::map<std::size_t, std::string> blockNames{{0, ""}};
+    if(!data.profileBlockPositions.empty())
+    {
+        auto positions = analysis::ExecutionProfile::readFile(data.profileBlockPositions);
+        if(auto blocks = positions.getEntries(kernelName))
+        {
+            for(const auto& block : *blocks)
+            {
+                auto index = static_cast<std::size_t>(block.second / sizeof(uint64_t));
+                if(index < numInstructions)
+                    blockNames[index] = block.first;
+            }
+        }
+    }
+    // the end of the loop (including the delay slots of the closing branch) per loop header
+    std::map<std::size_t, std::size_t> loops;
+    for(std::size_t i = 0; i < numInstructions; ++i)
+    {
+        const auto& inst = program[i];
+        if(inst.type != DecodedInstruction::Type::BRANCH)
+            continue;
+        // the 3 delay slots are executed before the branch is taken
+        if(i + 4 < numInstructions)
+            blockNames.emplace(i + 4, "");
+        if(inst.unsupportedBranch)
+            continue;
+        auto target = static_cast<std::size_t>(static_cast<int64_t>(i) + inst.branchOffset);
+        if(target >= numInstructions)
+            continue;
+        blockNames.emplace(target, "");
+        if(target <= i)
+            loops[target] = std::max(loops[target], std::min(i + 3, numInstructions - 1));
+    }
+    for(auto& block : blockNames)
+    {
+        if(block.second.empty())
+            block.second = "block " + std::to_string(block.first);
+    }
+
+    std::ofstream out(data.hotspotDump, std::ios::trunc);
+    if(!out)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open file to write hotspots", data.hotspotDump);
+    for(auto it = blockNames.begin(); it != blockNames.end(); ++it)
+    {
+        auto end = std::next(it) != blockNames.end() ? std::next(it)->first : numInstructions;
+        InstrumentationResult sum{};
+        for(auto i = it->first; i < end; ++i)
+        {
+            sum.numExecutions += instrumentation[i].numExecutions;
+            sum.numStalls += instrumentation[i].numStalls;
+            sum.numTMUStalls += instrumentation[i].numTMUStalls;
+            sum.numVPMStalls += instrumentation[i].numVPMStalls;
+            sum.numMutexStalls += instrumentation[i].numMutexStalls;
+            sum.numSemaphoreStalls += instrumentation[i].numSemaphoreStalls;
+        }
+        if(sum.numExecutions == 0)
+            continue;
+
+        // the loops are ordered by their header, so the outer loops come first
+        std::string stack = kernelName;
+        for(const auto& loop : loops)
+        {
+            if(loop.first <= it->first && it->first <= loop.second)
+                stack.append(";loop ").append(blockNames.at(loop.first));
+        }
+        stack.append(";").append(it->second);
+
+        if(sum.numExecutions > sum.numStalls)
+            out << stack << ' ' << (sum.numExecutions - sum.numStalls) << '\n';
+        if(sum.numTMUStalls > 0)
+            out << stack << ";stall TMU " << sum.numTMUStalls << '\n';
+        if(sum.numVPMStalls > 0)
+            out << stack << ";stall VPM " << sum.numVPMStalls << '\n';
+        if(sum.numMutexStalls > 0)
+            out << stack << ";stall mutex " << sum.numMutexStalls << '\n';
+        if(sum.numSemaphoreStalls > 0)
+            out << stack << ";stall semaphore " << sum.numSemaphoreStalls << '\n';
+    }
+}
+
+struct PreparedKernel::Impl
 {
     qpu_asm::ModuleInfo module;
     StableList<Global> globals;
     std::vector<qpu_asm::Instruction> instructions;
+    const qpu_asm::KernelInfo* kernelInfo = nullptr;
+    std::vector<qpu_asm::Instruction>::const_iterator kernelStart;
+    std::vector<DecodedInstruction> program;
+
+    // the memories of finished executions, to be reused by the next executions
+    mutable std::mutex memoryLock;
+    mutable std::vector<std::unique_ptr<Memory>> freeMemories;
+
+    std::unique_ptr<Memory> acquireMemory() const
+    {
+        std::lock_guard<std::mutex> guard(memoryLock);
+        if(freeMemories.empty())
+            return std::unique_ptr<Memory>(new Memory(0));
+        auto memory = std::move(freeMemories.back());
+        freeMemories.pop_back();
+        return memory;
+    }
+
+    void releaseMemory(std::unique_ptr<Memory>&& memory) const
+    {
+        std::lock_guard<std::mutex> guard(memoryLock);
+        freeMemories.emplace_back(std::move(memory));
+    }
+};
+
+PreparedKernel::PreparedKernel(const EmulationData& data) : impl(new Impl())
+{
     if(data.module.second != nullptr)
-        extractBinary(*data.module.second, module, globals, instructions);
+        extractBinary(*data.module.second, impl->module, impl->globals, impl->instructions);
     else
     {
         std::ifstream f(data.module.first, std::ios_base::in | std::ios_base::binary);
-        extractBinary(f, module, globals, instructions);
+        extractBinary(f, impl->module, impl->globals, impl->instructions);
     }
-    if(instructions.empty())
+    if(impl->instructions.empty())
         throw CompilationError(CompilationStep::GENERAL, "Extracted module has no instructions!");
-    if(module.kernelInfos.empty())
+    if(impl->module.kernelInfos.empty())
         throw CompilationError(CompilationStep::GENERAL, "Extracted module has no kernels!");
 
-    auto kernelInfo = std::find_if(module.kernelInfos.begin(), module.kernelInfos.end(),
+    const auto& kernelInfos = impl->module.kernelInfos;
+    auto kernelInfo = std::find_if(kernelInfos.begin(), kernelInfos.end(),
         [&data](const qpu_asm::KernelInfo& info) -> bool { return info.name == data.kernelName; });
-    if(data.kernelName.empty() && module.kernelInfos.size() == 1)
-        kernelInfo = module.kernelInfos.begin();
-    if(kernelInfo == module.kernelInfos.end())
+    if(data.kernelName.empty() && kernelInfos.size() == 1)
+        kernelInfo = kernelInfos.begin();
+    if(kernelInfo == kernelInfos.end())
         throw CompilationError(CompilationStep::GENERAL, "Failed to find kernel-info for kernel", data.kernelName);
+    impl->kernelInfo = &*kernelInfo;
+
+    impl->kernelStart = impl->instructions.cbegin() +
+        static_cast<std::vector<qpu_asm::Instruction>::difference_type>(
+            (kernelInfo->getOffset() - kernelInfos.front().getOffset()).getValue());
+    impl->program = decodeInstructions(impl->kernelStart, impl->instructions.cend());
+}
+
+PreparedKernel::PreparedKernel(PreparedKernel&&) noexcept = default;
+PreparedKernel::~PreparedKernel() noexcept = default;
+
+PreparedKernel& PreparedKernel::operator=(PreparedKernel&&) noexcept = default;
+
+EmulationResult PreparedKernel::run(const EmulationData& data) const
+{
+    const auto& kernelInfo = *impl->kernelInfo;
     // Count number of direct parameter words (e.g. also for literal vectors)
-    auto numKernelWords = std::accumulate(kernelInfo->parameters.begin(), kernelInfo->parameters.end(), 0u,
+    auto numKernelWords = std::accumulate(kernelInfo.parameters.begin(), kernelInfo.parameters.end(), 0u,
         [](unsigned u, const qpu_asm::ParamInfo& param) -> unsigned { return u + param.getVectorElements(); });
     if(data.parameter.size() != numKernelWords)
         throw CompilationError(CompilationStep::GENERAL,
             "The number of parameters specified (" + std::to_string(data.parameter.size()) +
                 ") does not match the number of kernel arguments (" +
-                std::to_string(static_cast<unsigned>(kernelInfo->getParamCount())) + ')');
+                std::to_string(static_cast<unsigned>(kernelInfo.getParamCount())) + ')');
+
+    if(data.workGroup.localSizes[0] * data.workGroup.localSizes[1] * data.workGroup.localSizes[2] >
+        std::min(data.numQPUs, NUM_QPUS))
+        throw CompilationError(CompilationStep::GENERAL,
+            "The work-group size exceeds the number of available QPUs", std::to_string(data.numQPUs));
 
     MemoryAddress uniformAddress;
     MemoryAddress globalDataAddress;
     std::vector<MemoryAddress> paramAddresses;
-    Memory mem(fillMemory(globals, data, uniformAddress, globalDataAddress, paramAddresses));
+    auto memory = impl->acquireMemory();
+    Memory& mem = *memory;
+    fillMemory(mem, impl->globals, data, data.calcNumWorkItems(), uniformAddress, globalDataAddress, paramAddresses);
 
     auto uniformAddresses =
-        buildUniforms(mem, uniformAddress, paramAddresses, data.workGroup, globalDataAddress, kernelInfo->uniformsUsed);
+        buildUniforms(mem, uniformAddress, paramAddresses, data.workGroup, globalDataAddress, kernelInfo.uniformsUsed,
+            {}, kernelInfo.precomputedUniforms);
 
     if(!data.memoryDump.empty())
         dumpMemory(mem, data.memoryDump, uniformAddress, true);
 
     InstrumentationResults instrumentation;
-    bool status = emulate(instructions.begin() +
-            static_cast<std::vector<qpu_asm::Instruction>::difference_type>(
-                (kernelInfo->getOffset() - module.kernelInfos.front().getOffset()).getValue()),
-        mem, uniformAddresses, instrumentation, data.maxEmulationCycles);
+    uint32_t numCycles = 0;
+    bool status = false;
+    CheckpointSettings checkpoints;
+    checkpoints.checkpointFile = data.checkpointFile;
+    checkpoints.checkpointInterval = data.checkpointFile.empty() ? 0 : data.checkpointInterval;
+    checkpoints.resumeFile = data.resumeCheckpoint;
+    const auto shards = splitWorkGroups(data.workGroup, data.numWorkGroupShards);
+    if(shards.size() > 1 && (checkpoints.checkpointInterval != 0 || !checkpoints.resumeFile.empty()))
+        throw CompilationError(
+            CompilationStep::GENERAL, "Checkpoints are not supported for the emulation of work-group shards");
+    if(shards.size() > 1 && !data.memoryTraceDump.empty())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Memory traces are not supported for the emulation of work-group shards");
+    std::unique_ptr<MemoryTrace> trace;
+    if(!data.memoryTraceDump.empty())
+        trace.reset(new MemoryTrace());
+    if(shards.size() > 1)
+        status = emulateWorkGroupShards(impl->program, impl->globals, data, kernelInfo, shards, mem,
+            uniformAddress, instrumentation, numCycles);
+    else
+        status = emulate(impl->program, mem, uniformAddresses, instrumentation, data.maxEmulationCycles, &numCycles,
+            data.numThreads, data.cycleAccurate, checkpoints, data.timing, trace.get());
+
+    if(trace)
+    {
+        std::ofstream out(data.memoryTraceDump);
+        trace->writeReport(out, numCycles);
+        if(!out)
+            throw CompilationError(CompilationStep::GENERAL, "Failed to write memory trace", data.memoryTraceDump);
+    }
 
     if(!data.memoryDump.empty())
         dumpMemory(mem, data.memoryDump, uniformAddress, false);
 
     EmulationResult result{data};
     result.executionSuccessful = status;
+    result.numCycles = numCycles;
 
     result.results.reserve(data.parameter.size());
     for(std::size_t i = 0; i < data.parameter.size(); ++i)
     {
-        if(!data.parameter[i].second)
+        if(data.mappedParameters.find(i) != data.mappedParameters.end())
+            // the results were directly written into the caller's buffer
+            result.results.emplace_back(std::make_pair(paramAddresses[i], Optional<std::vector<uint32_t>>{}));
+        else if(!data.parameter[i].second)
             result.results.emplace_back(std::make_pair(data.parameter[i].first, Optional<std::vector<uint32_t>>{}));
         else
         {
@@ -2060,29 +3423,80 @@ EmulationResult tools::emulate(const EmulationData& data)
                 std::back_inserter(*result.results[i].second));
         }
     }
+    impl->releaseMemory(std::move(memory));
 
     // Map and dump instrumentation results
     std::unique_ptr<std::ofstream> dumpInstrumentation;
     if(!data.instrumentationDump.empty())
         dumpInstrumentation.reset(new std::ofstream(data.instrumentationDump));
-    auto it = instructions.begin() +
-        static_cast<std::vector<qpu_asm::Instruction>::difference_type>(
-            (kernelInfo->getOffset() - module.kernelInfos.front().getOffset()).getValue());
-    result.instrumentation.reserve(kernelInfo->getLength().getValue());
+    auto it = impl->kernelStart;
+    result.instrumentation.reserve(kernelInfo.getLength().getValue());
     while(true)
     {
-        result.instrumentation.emplace_back(instrumentation[&(*it)]);
+        const auto& instrumentationResult = instrumentation[static_cast<std::size_t>(it - impl->kernelStart)];
+        result.instrumentation.emplace_back(instrumentationResult);
         if(dumpInstrumentation)
             *dumpInstrumentation << std::left << std::setw(80) << it->toASMString() << "//"
-                                 << instrumentation[&(*it)].to_string() << std::endl;
+                                 << instrumentationResult.to_string() << std::endl;
         if(it->getSig() == SIGNAL_END_PROGRAM)
             break;
         ++it;
     }
 
+    if(!data.profileDump.empty())
+        writeExecutionProfile(data, kernelInfo.name, result.instrumentation);
+    if(!data.hotspotDump.empty())
+        writeHotspots(data, kernelInfo.name, impl->program, result.instrumentation);
+
     return result;
 }
 
+std::vector<EmulationResult> PreparedKernel::runBatch(
+    const std::vector<EmulationData>& inputs, unsigned numThreads) const
+{
+    struct BatchResult
+    {
+        std::unique_ptr<EmulationResult> result;
+        std::exception_ptr error;
+    };
+    std::vector<BatchResult> batchResults(inputs.size());
+
+    std::vector<std::size_t> indices(inputs.size());
+    std::iota(indices.begin(), indices.end(), std::size_t{0});
+    auto runSingle = [&](const std::size_t& index) {
+        try
+        {
+            batchResults[index].result.reset(new EmulationResult(run(inputs[index])));
+        }
+        catch(const std::exception&)
+        {
+            batchResults[index].error = std::current_exception();
+        }
+    };
+    if(numThreads == 0)
+        ThreadPool::getDefaultPool().scheduleAll<std::size_t, std::vector<std::size_t>>(indices, runSingle, 1);
+    else
+    {
+        ThreadPool pool{"Emulator", numThreads};
+        pool.scheduleAll<std::size_t, std::vector<std::size_t>>(indices, runSingle, 1);
+    }
+
+    std::vector<EmulationResult> results;
+    results.reserve(inputs.size());
+    for(auto& batchResult : batchResults)
+    {
+        if(batchResult.error)
+            std::rethrow_exception(batchResult.error);
+        results.emplace_back(std::move(*batchResult.result));
+    }
+    return results;
+}
+
+EmulationResult tools::emulate(const EmulationData& data)
+{
+    return PreparedKernel{data}.run(data);
+}
+
 static std::vector<qpu_asm::Instruction> extractInstructions(const uint64_t* start, uint32_t numInstructions)
 {
     std::vector<qpu_asm::Instruction> res;
@@ -2108,23 +3522,27 @@ LowLevelEmulationResult tools::emulate(const LowLevelEmulationData& data)
     Memory mem(data.buffers);
 
     InstrumentationResults instrumentation;
-    bool status = emulate(instructions.begin(), mem, data.uniformAddresses, instrumentation, data.maxEmulationCycles);
+    uint32_t numCycles = 0;
+    bool status = emulate(instructions.cbegin(), instructions.cend(), mem, data.uniformAddresses, instrumentation,
+        data.maxEmulationCycles, &numCycles, data.numThreads, data.cycleAccurate);
 
     LowLevelEmulationResult result{data};
     result.executionSuccessful = status;
+    result.numCycles = numCycles;
 
     // Map and dump instrumentation results
     std::unique_ptr<std::ofstream> dumpInstrumentation;
     if(!data.instrumentationDump.empty())
         dumpInstrumentation.reset(new std::ofstream(data.instrumentationDump));
-    auto it = instructions.begin();
+    auto it = instructions.cbegin();
     result.instrumentation.reserve(data.numInstructions);
     while(true)
     {
-        result.instrumentation.emplace_back(instrumentation[&(*it)]);
+        const auto& instrumentationResult = instrumentation[static_cast<std::size_t>(it - instructions.cbegin())];
+        result.instrumentation.emplace_back(instrumentationResult);
         if(dumpInstrumentation)
             *dumpInstrumentation << std::left << std::setw(80) << it->toASMString() << "//"
-                                 << instrumentation[&(*it)].to_string() << std::endl;
+                                 << instrumentationResult.to_string() << std::endl;
         if(it->getSig() == SIGNAL_END_PROGRAM)
             break;
         ++it;
@@ -17,11 +17,16 @@
 #include <array>
 #include <bitset>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <queue>
+#include <string>
+#include <vector>
 
 namespace vc4c
 {
     struct KernelUniforms;
+    struct UniformExpression;
 
     namespace qpu_asm
     {
@@ -40,33 +45,165 @@ namespace vc4c
         {
         public:
             /*
-             * Use a direct buffer
+             * Use a direct buffer of the given number of words, starting at address zero
              */
-            explicit Memory(std::size_t size) : data(DirectBuffer(size, 0xDEADBEEF)) {}
+            explicit Memory(std::size_t size);
             /*
              * Use a mapping of existing buffers
              *
              * The first element is the start "device address", the second element the buffer mapped for the part
              * [start "device address", start "device address"+ buffer.size())
              */
-            explicit Memory(const std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>& buffers) :
-                data(MappedBuffers(buffers))
-            {
-            }
+            explicit Memory(const std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>& buffers);
+            ~Memory() noexcept;
+
+            /*
+             * Maps the given buffer owned by the caller into the address range [address, address + numBytes), the
+             * buffer is then accessed directly without copying its contents.
+             */
+            void mapBuffer(MemoryAddress address, uint8_t* data, std::size_t numBytes);
+            /*
+             * Removes all mapped buffers and resets the direct buffer to the given number of words, reusing its
+             * allocation where possible.
+             */
+            void reset(std::size_t size);
 
             Word* getWordAddress(MemoryAddress address);
             const Word* getWordAddress(MemoryAddress address) const;
+            /*
+             * Returns the host address of the given range of bytes, which needs to lie completely within a single
+             * buffer
+             */
+            uint8_t* getBytes(MemoryAddress address, std::size_t numBytes);
+            const uint8_t* getBytes(MemoryAddress address, std::size_t numBytes) const;
 
             Word readWord(MemoryAddress address) const;
             MemoryAddress incrementAddress(MemoryAddress address, DataType typeSize) const;
 
             MemoryAddress getMaximumAddress() const;
+            bool isValidAddress(MemoryAddress address) const;
             void setUniforms(const std::vector<Word>& uniforms, MemoryAddress address);
 
+            /*
+             * Writes the contents of all buffers into the checkpoint stream and restores them from there. The buffers
+             * of the restoring memory need to have the same layout as the buffers of the saved memory.
+             */
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
+
+        private:
+            /*
+             * The part [start, end) of the emulated address space backed by a host buffer
+             */
+            struct Region
+            {
+                MemoryAddress start;
+                MemoryAddress end;
+                uint8_t* data;
+            };
+
+            // the buffer owned by this memory, if not only existing buffers are mapped
+            std::vector<Word> directBuffer;
+            // the mapped regions, sorted by their start address
+            std::vector<Region> regions;
+            /*
+             * The index of the first region not ending before the page, for every page starting from the first region.
+             * This translates addresses in constant time instead of searching all regions.
+             */
+            std::vector<uint32_t> pageTable;
+
+            void addRegion(MemoryAddress address, uint8_t* data, std::size_t numBytes);
+            const Region* findRegion(MemoryAddress address) const;
+            [[noreturn]] void throwInvalidAccess(MemoryAddress address, const std::string& message) const;
+        };
+
+        /*
+         * The interface to the memory shared by the TMUs and the VPM DMA of all QPUs, which transfers a limited number
+         * of bytes per cycle (see TimingModel#memoryBytesPerCycle)
+         */
+        class MemoryBus : private NonCopyable
+        {
+        public:
+            explicit MemoryBus(uint32_t bytesPerCycle) : bytesPerCycle(bytesPerCycle), busyUntil(0) {}
+
+            /*
+             * Schedules the transfer of the given number of bytes, starting at the given cycle, but not before all
+             * previously scheduled transfers are finished. Returns the cycle the transfer is finished at.
+             */
+            uint32_t transfer(uint32_t cycle, uint32_t numBytes);
+
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
+
+        private:
+            // zero for an unlimited bandwidth
+            const uint32_t bytesPerCycle;
+            uint32_t busyUntil;
+        };
+
+        /*
+         * Records the memory accesses of all QPUs (the TMU loads, the VPM DMA transfers and the setups of the VPM
+         * reads and writes) and summarizes them into the achieved bandwidth, the utilization of the TMUs and the
+         * access patterns, see EmulationData#memoryTraceDump
+         */
+        class MemoryTrace : private NonCopyable
+        {
+        public:
+            enum class AccessType : unsigned char
+            {
+                TMU_LOAD,
+                DMA_LOAD,
+                DMA_STORE,
+                VPM_READ_SETUP,
+                VPM_WRITE_SETUP
+            };
+
+            enum class AccessPattern : unsigned char
+            {
+                // all elements (or rows) directly follow each other
+                CONTIGUOUS,
+                // the elements (or rows) have a constant distance other than their size
+                STRIDED,
+                // the elements are read from arbitrary addresses
+                GATHER
+            };
+
+            struct Access
+            {
+                // the cycle the access is issued at and the cycle the data is transferred at
+                uint32_t cycle;
+                uint32_t doneCycle;
+                uint8_t qpu;
+                AccessType type;
+                // the TMU used for TMU loads, zero otherwise
+                uint8_t unit;
+                AccessPattern pattern;
+                // the first memory address accessed, the VPM row address for VPM setups
+                uint32_t address;
+                uint32_t numBytes;
+                // the distance in bytes between the starts of the elements (TMU, only valid if not a gather) or the
+                // rows (DMA), the increment of the VPM address (VPM setups)
+                int32_t stride;
+            };
+
+            /*
+             * Thread-safe, since the QPUs may access the TMUs in parallel
+             */
+            void record(const Access& access);
+
+            /*
+             * Returns all recorded accesses ordered by cycle and QPU
+             */
+            std::vector<Access> getAccesses() const;
+
+            /*
+             * Writes the aggregated reports and a line per recorded access into the given stream
+             */
+            void writeReport(std::ostream& out, uint32_t numCycles) const;
+
         private:
-            using DirectBuffer = std::vector<Word>;
-            using MappedBuffers = std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>;
-            Variant<DirectBuffer, MappedBuffers> data;
+            mutable std::mutex accessLock;
+            std::vector<Access> accesses;
         };
 
         class Mutex : private NonCopyable
@@ -75,6 +212,8 @@ namespace vc4c
             bool isLocked() const;
             NODISCARD bool lock(uint8_t qpu);
             void unlock(uint8_t qpu);
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             bool locked{false};
@@ -92,16 +231,25 @@ namespace vc4c
             SIMDVector getInterruptValue() const;
 
             void clearReadCache();
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             QPU& qpu;
             std::array<std::pair<SIMDVector, uint32_t>, 4 * 64> storageRegisters;
             Optional<SIMDVector> hostInterrupt;
-            SortedMap<Register, SIMDVector> readCache;
+            /*
+             * The values of the periphery registers already read in the current instruction, indexed by the register
+             * number. An entry is only valid if its generation matches the current read cache generation, which
+             * allows to invalidate all entries at once without touching them.
+             */
+            std::array<std::pair<SIMDVector, uint32_t>, 64> readCache;
+            uint32_t readCacheGeneration = 1;
 
             SIMDVector readStorageRegister(Register reg, bool anyElementUsed);
             void writeStorageRegister(Register reg, SIMDVector&& val, std::bitset<16> elementMask, BitMask bitMask);
-            NODISCARD SortedMap<Register, SIMDVector>::iterator setReadCache(Register reg, const SIMDVector& val);
+            const SIMDVector* getReadCache(Register reg) const;
+            const SIMDVector& setReadCache(Register reg, const SIMDVector& val);
         };
 
         class UniformCache : private NonCopyable
@@ -114,6 +262,8 @@ namespace vc4c
 
             SIMDVector readUniform();
             void setUniformAddress(const SIMDVector& val);
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             QPU& qpu;
@@ -125,7 +275,11 @@ namespace vc4c
         class TMUs : private NonCopyable
         {
         public:
-            TMUs(QPU& qpu, Memory& memory) : qpu(qpu), tmuNoSwap(false), lastTMUNoSwap(0), memory(memory) {}
+            TMUs(QPU& qpu, Memory& memory, MemoryBus& bus, const TimingModel& timing, MemoryTrace* trace) :
+                qpu(qpu), tmuNoSwap(false), lastTMUNoSwap(0), memory(memory), bus(bus), timing(timing), trace(trace),
+                cacheTags(timing.tmuCacheLines, std::numeric_limits<MemoryAddress>::max())
+            {
+            }
 
             std::pair<SIMDVector, bool> readTMU();
             bool hasValueOnR4() const;
@@ -137,19 +291,29 @@ namespace vc4c
             void setTMURegisterB(uint8_t tmu, const SIMDVector& val);
 
             NODISCARD bool triggerTMURead(uint8_t tmu);
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             QPU& qpu;
             bool tmuNoSwap;
             uint32_t lastTMUNoSwap;
             Memory& memory;
+            MemoryBus& bus;
+            const TimingModel& timing;
+            // the trace to record the TMU loads into, if enabled
+            MemoryTrace* trace;
+            // the requests hold the loaded values and the cycles they are available at
             std::queue<std::pair<SIMDVector, uint32_t>> tmu0RequestQueue;
             std::queue<std::pair<SIMDVector, uint32_t>> tmu0ResponseQueue;
             std::queue<std::pair<SIMDVector, uint32_t>> tmu1RequestQueue;
             std::queue<std::pair<SIMDVector, uint32_t>> tmu1ResponseQueue;
+            // the memory line held by every line of the direct-mapped TMU cache, the maximum value for empty lines
+            std::vector<MemoryAddress> cacheTags;
 
             void checkTMUWriteCycle() const;
             SIMDVector readMemoryAddress(const SIMDVector& address) const;
+            uint32_t calculateReadyCycle(const SIMDVector& address);
             uint8_t toRealTMU(uint8_t tmu) const;
         };
 
@@ -165,6 +329,8 @@ namespace vc4c
             void startLog2(const SIMDVector& val);
 
             void incrementCycle();
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             // FIXME is SFU calculation per QPU? Or do QPUs need to lock the SFU access?
@@ -177,21 +343,23 @@ namespace vc4c
         class VPM : private NonCopyable
         {
         public:
-            explicit VPM(Memory& memory) :
-                memory(memory), vpmReadSetup(0), vpmWriteSetup(0), dmaReadSetup(0), dmaWriteSetup(0),
-                readStrideSetup(0), writeStrideSetup(0), lastDMAReadTrigger(0), lastDMAWriteTrigger(0), currentCycle(0),
-                cache({})
+            VPM(Memory& memory, MemoryBus& bus, const TimingModel& timing, bool cycleAccurate = true,
+                MemoryTrace* trace = nullptr) :
+                memory(memory),
+                bus(bus), timing(timing), cycleAccurate(cycleAccurate), trace(trace), vpmReadSetup(0),
+                vpmWriteSetup(0), dmaReadSetup(0), dmaWriteSetup(0), readStrideSetup(0), writeStrideSetup(0),
+                dmaReadDone(0), dmaWriteDone(0), currentCycle(0), cache({})
             {
             }
 
             SIMDVector readValue();
             void writeValue(const SIMDVector& val);
 
-            void setWriteSetup(const SIMDVector& val);
-            void setReadSetup(const SIMDVector& val);
+            void setWriteSetup(uint8_t qpu, const SIMDVector& val);
+            void setReadSetup(uint8_t qpu, const SIMDVector& val);
 
-            void setDMAWriteAddress(const SIMDVector& val);
-            void setDMAReadAddress(const SIMDVector& val);
+            void setDMAWriteAddress(uint8_t qpu, const SIMDVector& val);
+            void setDMAReadAddress(uint8_t qpu, const SIMDVector& val);
 
             NODISCARD bool waitDMAWrite() const;
             NODISCARD bool waitDMARead() const;
@@ -199,17 +367,26 @@ namespace vc4c
             void incrementCycle();
 
             void dumpContents() const;
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             Memory& memory;
+            MemoryBus& bus;
+            const TimingModel& timing;
+            // whether to emulate the DMA latencies, otherwise the DMA accesses finish immediately
+            const bool cycleAccurate;
+            // the trace to record the DMA transfers and VPM setups into, if enabled
+            MemoryTrace* trace;
             uint32_t vpmReadSetup;
             uint32_t vpmWriteSetup;
             uint32_t dmaReadSetup;
             uint32_t dmaWriteSetup;
             uint32_t readStrideSetup;
             uint32_t writeStrideSetup;
-            uint32_t lastDMAReadTrigger;
-            uint32_t lastDMAWriteTrigger;
+            // the cycles the last triggered DMA transfers are finished at
+            uint32_t dmaReadDone;
+            uint32_t dmaWriteDone;
             uint32_t currentCycle;
 
             std::array<std::array<Word, 16>, 64> cache;
@@ -226,7 +403,10 @@ namespace vc4c
             std::pair<SIMDVector, bool> increment(uint8_t index);
             std::pair<SIMDVector, bool> decrement(uint8_t index);
 
-            void checkAllZero() const;
+            // Returns whether all semaphores are reset to zero, logs the ones which are not
+            bool checkAllZero() const;
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             std::array<uint8_t, 16> counter;
@@ -234,16 +414,111 @@ namespace vc4c
 
         using ProgramCounter = uint32_t;
 
-        using InstrumentationResults = FastMap<const qpu_asm::Instruction*, InstrumentationResult>;
+        /*
+         * The periphery an instruction stalls waiting for
+         */
+        enum class StallReason : unsigned char
+        {
+            TMU,
+            VPM,
+            MUTEX,
+            SEMAPHORE
+        };
+
+        /*
+         * A single instruction with all fields required for its execution already extracted and resolved (e.g. the
+         * op-codes, the output registers with the write-swap applied or the packed immediate value), so the machine
+         * code only needs to be decoded once instead of on every execution of the instruction.
+         */
+        struct DecodedInstruction
+        {
+            enum class Type : unsigned char
+            {
+                ALU,
+                BRANCH,
+                LOAD,
+                SEMAPHORE,
+                // not a valid instruction, only throws when executed
+                INVALID
+            };
+
+            explicit DecodedInstruction(const qpu_asm::Instruction& instruction);
+
+            // the original instruction, e.g. for logging
+            const qpu_asm::Instruction* instruction;
+            Type type;
+            Signaling signal;
+            ConditionCode addCondition = COND_NEVER;
+            ConditionCode mulCondition = COND_NEVER;
+            bool setFlags = false;
+            // the output registers with the write-swap already applied
+            Register addOut = REG_NOP;
+            Register mulOut = REG_NOP;
+            Pack pack = PACK_NOP;
+
+            /* ALU instructions */
+            const OpCode* addCode = nullptr;
+            const OpCode* mulCode = nullptr;
+            // whether the ALU executes anything, i.e. an operation other than NOP with a condition other than never
+            bool executeAdd = false;
+            bool executeMul = false;
+            InputMultiplex addMuxA = InputMultiplex::ACC0;
+            InputMultiplex addMuxB = InputMultiplex::ACC0;
+            InputMultiplex mulMuxA = InputMultiplex::ACC0;
+            InputMultiplex mulMuxB = InputMultiplex::ACC0;
+            Address inputA = 0;
+            Address inputB = 0;
+            bool regBIsImmediate = false;
+            Unpack unpack = UNPACK_NOP;
+            // whether the pack mode is applied to the output of the mul ALU instead of the add ALU
+            bool packMulOutput = false;
+            bool flagsSetByMul = false;
+            bool vectorRotation = false;
+            bool fullRangeRotation = false;
+            bool rotationFromR5 = false;
+            uint8_t rotationOffset = 0;
+
+            /* branch instructions */
+            BranchCond branchCondition = BRANCH_ALWAYS;
+            // the offset of the branch target (in instructions) relative to the branch instruction
+            int32_t branchOffset = 0;
+            // whether the branch uses modes not supported by the emulator
+            bool unsupportedBranch = false;
+
+            /*
+             * Whether the instruction accesses the state shared between the QPUs (e.g. the memory, the VPM, the
+             * hardware mutex or the semaphores), i.e. whether it needs to be executed in the same order relative to
+             * the instructions of other QPUs as in the serial emulation.
+             */
+            bool accessesSharedState = false;
+            // the periphery this instruction waits for, if it stalls
+            StallReason stallReason = StallReason::TMU;
+
+            /* load immediate and semaphore instructions */
+            // the loaded value with the pack mode already applied
+            SIMDVector loadedValue;
+            VectorFlags loadedFlags;
+            BitMask mask = BITMASK_ALL;
+            uint8_t semaphore = 0;
+            bool acquire = false;
+        };
+
+        /*
+         * The instrumentation results indexed by the program counter of the instructions
+         */
+        using InstrumentationResults = std::vector<InstrumentationResult>;
 
         class QPU : private NonCopyable
         {
         public:
             QPU(uint8_t id, Mutex& mutex, SFU& sfu, VPM& vpm, Semaphores& semaphores, Memory& memory,
-                MemoryAddress uniformAddress, InstrumentationResults& instrumentation) :
+                MemoryBus& bus, MemoryAddress uniformAddress, const std::vector<DecodedInstruction>& program,
+                InstrumentationResults& instrumentation, const TimingModel& timing, bool cycleAccurate = true,
+                MemoryTrace* trace = nullptr) :
                 ID(id),
-                mutex(mutex), registers(*this), uniforms(*this, memory, uniformAddress), tmus(*this, memory), sfu(sfu),
-                vpm(vpm), semaphores(semaphores), currentCycle(0), pc(0), instrumentation(instrumentation)
+                mutex(mutex), registers(*this), uniforms(*this, memory, uniformAddress),
+                tmus(*this, memory, bus, timing, trace), sfu(sfu), vpm(vpm), semaphores(semaphores), currentCycle(0),
+                pc(0), program(program), instrumentation(instrumentation), cycleAccurate(cycleAccurate)
             {
             }
 
@@ -252,10 +527,21 @@ namespace vc4c
             uint32_t getCurrentCycle() const;
             std::pair<SIMDVector, bool> readR4();
 
-            NODISCARD bool execute(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction);
+            NODISCARD bool execute();
+
+            const qpu_asm::Instruction* getCurrentInstruction() const;
+            /*
+             * Returns whether the next instruction to be executed accesses the state shared with other QPUs (see
+             * DecodedInstruction#accessesSharedState)
+             */
+            bool isAccessingSharedState() const;
 
-            const qpu_asm::Instruction* getCurrentInstruction(
-                std::vector<qpu_asm::Instruction>::const_iterator firstInstruction) const;
+            /*
+             * Writes the state of this QPU (e.g. its registers, flags and TMU queues) into the checkpoint stream and
+             * restores it from there
+             */
+            void saveState(std::ostream& out) const;
+            void restoreState(std::istream& in);
 
         private:
             Mutex& mutex;
@@ -268,7 +554,13 @@ namespace vc4c
             uint32_t currentCycle;
             VectorFlags flags;
             ProgramCounter pc;
+            const std::vector<DecodedInstruction>& program;
             InstrumentationResults& instrumentation;
+            /*
+             * Whether to emulate the latencies of the periphery (e.g. the stalls of TMU loads) and log every executed
+             * instruction. Otherwise, only the functional behavior is emulated.
+             */
+            const bool cycleAccurate;
 
             friend class Registers;
             friend class UniformCache;
@@ -276,21 +568,61 @@ namespace vc4c
             friend class SFU;
             friend class VPM;
 
-            NODISCARD bool executeALU(const qpu_asm::ALUInstruction* aluInst);
+            NODISCARD bool executeALU(const DecodedInstruction& aluInst);
             void writeConditional(Register dest, const SIMDVector& in, ConditionCode cond, BitMask bitMask,
-                const qpu_asm::ALUInstruction* addInst = nullptr, const qpu_asm::ALUInstruction* mulInst = nullptr);
+                InstrumentationResult* addResult = nullptr, InstrumentationResult* mulResult = nullptr);
             bool isConditionMet(BranchCond cond) const;
             NODISCARD bool executeSignal(Signaling signal);
             void setFlags(const SIMDVector& output, ConditionCode cond, const VectorFlags& newFlags);
         };
 
+        /*
+         * Writes the UNIFORMs for all QPUs executing the work-groups of the given configuration and returns their
+         * addresses.
+         *
+         * If only a part of the work-groups of an execution is emulated, the total number of work-groups is passed as
+         * parameter, to be returned by the kernel's get_num_groups().
+         *
+         * The values of the precomputed UNIFORMs (see KernelUniforms#NumPrecomputedValues) are calculated from the
+         * given expressions.
+         */
         std::vector<MemoryAddress> buildUniforms(Memory& memory, MemoryAddress baseAddress,
             const std::vector<MemoryAddress>& parameter, const WorkGroupConfig& config, MemoryAddress globalData,
-            const KernelUniforms& uniformsUsed);
-        bool emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction, Memory& memory,
+            const KernelUniforms& uniformsUsed, const Optional<std::array<Word, 3>>& totalNumGroups = {},
+            const std::vector<UniformExpression>& precomputedUniforms = {});
+        /*
+         * Where and how often to write checkpoints of the complete emulator state and the checkpoint to resume an
+         * emulation from, see EmulationData#checkpointFile
+         */
+        struct CheckpointSettings
+        {
+            std::string checkpointFile;
+            uint32_t checkpointInterval = 0;
+            std::string resumeFile;
+        };
+
+        /*
+         * Emulates the code in the range [firstInstruction, lastInstruction), starting at the first instruction.
+         *
+         * The instrumentation results are indexed by the offset of the instruction to the first instruction.
+         */
+        bool emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+            std::vector<qpu_asm::Instruction>::const_iterator lastInstruction, Memory& memory,
             const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation,
-            uint32_t maxCycles = std::numeric_limits<uint32_t>::max());
+            uint32_t maxCycles = std::numeric_limits<uint32_t>::max(), uint32_t* numCycles = nullptr,
+            unsigned numThreads = 1, bool cycleAccurate = true);
+        /*
+         * Emulates the already decoded program, starting at its first instruction (or at the state of the checkpoint
+         * to resume from). The latencies of the memory accesses are determined by the given timing model. If a trace
+         * is given, all memory accesses are recorded into it.
+         */
+        bool emulate(const std::vector<DecodedInstruction>& program, Memory& memory,
+            const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation,
+            uint32_t maxCycles = std::numeric_limits<uint32_t>::max(), uint32_t* numCycles = nullptr,
+            unsigned numThreads = 1, bool cycleAccurate = true, const CheckpointSettings& checkpoints = {},
+            const TimingModel& timing = {}, MemoryTrace* trace = nullptr);
         bool emulateTask(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+            std::vector<qpu_asm::Instruction>::const_iterator lastInstruction,
             const std::vector<MemoryAddress>& parameter, Memory& memory, MemoryAddress uniformBaseAddress,
             MemoryAddress globalData, const KernelUniforms& uniformsUsed, InstrumentationResults& instrumentation,
             uint32_t maxCycles = std::numeric_limits<uint32_t>::max());
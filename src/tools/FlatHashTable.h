@@ -0,0 +1,976 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        namespace detail
+        {
+            /*
+             * Hash table with open addressing and linear probing, storing the elements directly in a single array.
+             *
+             * In addition to the elements, a control byte is stored for every slot, which marks the slot as empty,
+             * deleted or occupied. For occupied slots, the control byte also contains 7 bits of the hash, so most of the
+             * probed non-matching elements can be skipped without comparing the actual keys.
+             *
+             * NOTE: In contrast to the node-based std::unordered_map/std::unordered_set, inserting elements might move
+             * the other elements and therefore invalidates all references, pointers and iterators to elements, unless
+             * enough space was reserved before via #reserve()! Erasing elements only invalidates references to the erased
+             * elements.
+             */
+            template <typename K, typename Slot, typename KeyOf, typename H>
+            class FlatHashTable
+            {
+                static constexpr uint8_t CONTROL_EMPTY = 0x00;
+                static constexpr uint8_t CONTROL_DELETED = 0x01;
+                // marks the end of the control bytes, so the iteration stops there
+                static constexpr uint8_t CONTROL_SENTINEL = 0x02;
+                static constexpr uint8_t CONTROL_FULL = 0x80;
+
+                static constexpr std::size_t MIN_CAPACITY = 8;
+
+                static bool isFull(uint8_t control) noexcept
+                {
+                    return (control & CONTROL_FULL) != 0;
+                }
+
+                static const uint8_t* getEmptyControls() noexcept
+                {
+                    // used for tables without any allocated slots, so the iterators can always dereference the control
+                    static const uint8_t emptyControls[1] = {CONTROL_SENTINEL};
+                    return emptyControls;
+                }
+
+            public:
+                template <bool IsConst>
+                class Iterator
+                {
+                public:
+                    using iterator_category = std::forward_iterator_tag;
+                    using value_type = Slot;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = typename std::conditional<IsConst, const Slot*, Slot*>::type;
+                    using reference = typename std::conditional<IsConst, const Slot&, Slot&>::type;
+
+                    constexpr Iterator() noexcept : control(nullptr), slot(nullptr) {}
+                    // allow conversion from non-const to const iterator
+                    template <bool B = IsConst, typename = typename std::enable_if<B>::type>
+                    constexpr Iterator(const Iterator<false>& other) noexcept :
+                        control(other.control), slot(other.slot)
+                    {
+                    }
+
+                    reference operator*() const noexcept
+                    {
+                        return *slot;
+                    }
+
+                    pointer operator->() const noexcept
+                    {
+                        return slot;
+                    }
+
+                    Iterator& operator++() noexcept
+                    {
+                        do
+                        {
+                            ++control;
+                            ++slot;
+                        } while(!isFull(*control) && *control != CONTROL_SENTINEL);
+                        return *this;
+                    }
+
+                    Iterator operator++(int) noexcept
+                    {
+                        Iterator tmp = *this;
+                        ++(*this);
+                        return tmp;
+                    }
+
+                    bool operator==(const Iterator& other) const noexcept
+                    {
+                        return control == other.control;
+                    }
+
+                    bool operator!=(const Iterator& other) const noexcept
+                    {
+                        return control != other.control;
+                    }
+
+                private:
+                    const uint8_t* control;
+                    Slot* slot;
+
+                    Iterator(const uint8_t* control, Slot* slot) noexcept : control(control), slot(slot) {}
+
+                    /*
+                     * Skips all non-occupied slots
+                     */
+                    Iterator& skipEmpty() noexcept
+                    {
+                        while(!isFull(*control) && *control != CONTROL_SENTINEL)
+                        {
+                            ++control;
+                            ++slot;
+                        }
+                        return *this;
+                    }
+
+                    friend class FlatHashTable;
+                    friend class Iterator<!IsConst>;
+                };
+
+                using iterator = Iterator<false>;
+                using const_iterator = Iterator<true>;
+                using size_type = std::size_t;
+
+                explicit FlatHashTable(std::size_t numInitialElements = 0, const H& hash = H{}) :
+                    hasher(hash), controls(const_cast<uint8_t*>(getEmptyControls())), slots(nullptr), capacity(0),
+                    numElements(0), numDeleted(0)
+                {
+                    reserve(numInitialElements);
+                }
+
+                FlatHashTable(const FlatHashTable& other) : FlatHashTable(other.size(), other.hasher)
+                {
+                    for(const auto& elem : other)
+                        insertUnique(hashKey(KeyOf{}(elem)), elem);
+                }
+
+                FlatHashTable(FlatHashTable&& other) noexcept : FlatHashTable()
+                {
+                    swap(other);
+                }
+
+                ~FlatHashTable() noexcept
+                {
+                    clear();
+                    deallocate();
+                }
+
+                FlatHashTable& operator=(const FlatHashTable& other)
+                {
+                    if(&other != this)
+                    {
+                        FlatHashTable tmp(other);
+                        swap(tmp);
+                    }
+                    return *this;
+                }
+
+                FlatHashTable& operator=(FlatHashTable&& other) noexcept
+                {
+                    if(&other != this)
+                    {
+                        clear();
+                        swap(other);
+                    }
+                    return *this;
+                }
+
+                iterator begin() noexcept
+                {
+                    return iterator{controls, slots}.skipEmpty();
+                }
+
+                const_iterator begin() const noexcept
+                {
+                    return const_iterator{controls, slots}.skipEmpty();
+                }
+
+                const_iterator cbegin() const noexcept
+                {
+                    return begin();
+                }
+
+                iterator end() noexcept
+                {
+                    return iterator{controls + capacity, slots + capacity};
+                }
+
+                const_iterator end() const noexcept
+                {
+                    return const_iterator{controls + capacity, slots + capacity};
+                }
+
+                const_iterator cend() const noexcept
+                {
+                    return end();
+                }
+
+                bool empty() const noexcept
+                {
+                    return numElements == 0;
+                }
+
+                size_type size() const noexcept
+                {
+                    return numElements;
+                }
+
+                size_type max_size() const noexcept
+                {
+                    return std::numeric_limits<std::size_t>::max() / sizeof(Slot);
+                }
+
+                void clear() noexcept
+                {
+                    for(std::size_t i = 0; i < capacity; ++i)
+                    {
+                        if(isFull(controls[i]))
+                            slots[i].~Slot();
+                        controls[i] = CONTROL_EMPTY;
+                    }
+                    numElements = 0;
+                    numDeleted = 0;
+                }
+
+                /*
+                 * Makes sure, the given number of elements can be inserted without rehashing (and therefore
+                 * invalidating any references to elements)
+                 */
+                void reserve(std::size_t minElements)
+                {
+                    if(!needsGrowth(minElements + numDeleted))
+                        return;
+                    std::size_t newCapacity = std::max(capacity, std::size_t{MIN_CAPACITY});
+                    while(minElements * 8 > newCapacity * 7)
+                        newCapacity *= 2;
+                    rehash(newCapacity);
+                }
+
+                std::size_t bucket_count() const noexcept
+                {
+                    return capacity;
+                }
+
+                template <typename Key>
+                iterator find(const Key& key)
+                {
+                    auto index = findIndex(key, hashKey(key));
+                    return index == capacity ? end() : iterator{controls + index, slots + index};
+                }
+
+                template <typename Key>
+                const_iterator find(const Key& key) const
+                {
+                    auto index = findIndex(key, hashKey(key));
+                    return index == capacity ? end() : const_iterator{controls + index, slots + index};
+                }
+
+                template <typename Key>
+                size_type count(const Key& key) const
+                {
+                    return findIndex(key, hashKey(key)) == capacity ? 0 : 1;
+                }
+
+                /*
+                 * Inserts the given element, if no element with the same key exists yet
+                 */
+                template <typename S>
+                std::pair<iterator, bool> insert(S&& slot)
+                {
+                    const auto& key = KeyOf{}(slot);
+                    auto hash = hashKey(key);
+                    auto index = findIndex(key, hash);
+                    if(index != capacity)
+                        return std::make_pair(iterator{controls + index, slots + index}, false);
+                    return std::make_pair(insertUnique(hash, std::forward<S>(slot)), true);
+                }
+
+                /*
+                 * Inserts the element created by the given function for the given key, if no element with the key
+                 * exists yet
+                 */
+                template <typename Key, typename Func>
+                std::pair<iterator, bool> insertWith(const Key& key, Func&& creator)
+                {
+                    auto hash = hashKey(key);
+                    auto index = findIndex(key, hash);
+                    if(index != capacity)
+                        return std::make_pair(iterator{controls + index, slots + index}, false);
+                    if(needsGrowth(numElements + numDeleted + 1))
+                        grow();
+                    index = findFreeIndex(hash);
+                    new(slots + index) Slot(creator());
+                    markFull(index, hash);
+                    return std::make_pair(iterator{controls + index, slots + index}, true);
+                }
+
+                iterator erase(const_iterator pos)
+                {
+                    auto index = static_cast<std::size_t>(pos.control - controls);
+                    slots[index].~Slot();
+                    --numElements;
+                    // if the next slot is empty, no probe sequence continues behind this slot, so we can mark it as
+                    // empty too instead of leaving a tombstone
+                    if(controls[(index + 1) & (capacity - 1)] == CONTROL_EMPTY)
+                        controls[index] = CONTROL_EMPTY;
+                    else
+                    {
+                        controls[index] = CONTROL_DELETED;
+                        ++numDeleted;
+                    }
+                    return iterator{controls + index, slots + index}.skipEmpty();
+                }
+
+                template <typename Key>
+                size_type eraseKey(const Key& key)
+                {
+                    auto index = findIndex(key, hashKey(key));
+                    if(index == capacity)
+                        return 0;
+                    erase(const_iterator{controls + index, slots + index});
+                    return 1;
+                }
+
+                void swap(FlatHashTable& other) noexcept
+                {
+                    std::swap(hasher, other.hasher);
+                    std::swap(controls, other.controls);
+                    std::swap(slots, other.slots);
+                    std::swap(capacity, other.capacity);
+                    std::swap(numElements, other.numElements);
+                    std::swap(numDeleted, other.numDeleted);
+                }
+
+            private:
+                H hasher;
+                // capacity + 1 entries, the last is the sentinel
+                uint8_t* controls;
+                Slot* slots;
+                std::size_t capacity;
+                std::size_t numElements;
+                std::size_t numDeleted;
+
+                template <typename Key>
+                std::size_t hashKey(const Key& key) const
+                {
+                    // many of the hashed keys are pointers for which std::hash is the identity, so mix all the bits
+                    // (Fibonacci hashing) to not end up with most elements in the same few slots
+                    auto hash = static_cast<uint64_t>(hasher(key)) * UINT64_C(0x9E3779B97F4A7C15);
+                    return static_cast<std::size_t>(hash ^ (hash >> 32));
+                }
+
+                static uint8_t toControl(std::size_t hash) noexcept
+                {
+                    return static_cast<uint8_t>(CONTROL_FULL | (hash & 0x7F));
+                }
+
+                std::size_t toIndex(std::size_t hash) const noexcept
+                {
+                    return (hash >> 7) & (capacity - 1);
+                }
+
+                bool needsGrowth(std::size_t numUsedSlots) const noexcept
+                {
+                    // keep the load factor below 7/8 to not get too long probe sequences
+                    return numUsedSlots * 8 > capacity * 7;
+                }
+
+                template <typename Key>
+                std::size_t findIndex(const Key& key, std::size_t hash) const
+                {
+                    if(capacity == 0)
+                        return capacity;
+                    const auto control = toControl(hash);
+                    auto index = toIndex(hash);
+                    while(controls[index] != CONTROL_EMPTY)
+                    {
+                        if(controls[index] == control && KeyOf{}(slots[index]) == key)
+                            return index;
+                        index = (index + 1) & (capacity - 1);
+                    }
+                    return capacity;
+                }
+
+                std::size_t findFreeIndex(std::size_t hash) const noexcept
+                {
+                    auto index = toIndex(hash);
+                    while(isFull(controls[index]))
+                        index = (index + 1) & (capacity - 1);
+                    return index;
+                }
+
+                void markFull(std::size_t index, std::size_t hash) noexcept
+                {
+                    if(controls[index] == CONTROL_DELETED)
+                        --numDeleted;
+                    controls[index] = toControl(hash);
+                    ++numElements;
+                }
+
+                template <typename S>
+                iterator insertUnique(std::size_t hash, S&& slot)
+                {
+                    if(needsGrowth(numElements + numDeleted + 1))
+                        grow();
+                    auto index = findFreeIndex(hash);
+                    new(slots + index) Slot(std::forward<S>(slot));
+                    markFull(index, hash);
+                    return iterator{controls + index, slots + index};
+                }
+
+                void grow()
+                {
+                    // if there are many tombstones, only clean them up without increasing the capacity
+                    if(capacity != 0 && !needsGrowth((numElements + 1) * 2))
+                        rehash(capacity);
+                    else
+                        rehash(std::max(capacity * 2, std::size_t{MIN_CAPACITY}));
+                }
+
+                void rehash(std::size_t newCapacity)
+                {
+                    std::unique_ptr<uint8_t[]> newControls(new uint8_t[newCapacity + 1]);
+                    std::fill_n(newControls.get(), newCapacity, uint8_t{CONTROL_EMPTY});
+                    newControls[newCapacity] = CONTROL_SENTINEL;
+                    auto newSlots = static_cast<Slot*>(::operator new(newCapacity * sizeof(Slot)));
+
+                    auto oldControls = controls;
+                    auto oldSlots = slots;
+                    auto oldCapacity = capacity;
+                    controls = newControls.release();
+                    slots = newSlots;
+                    capacity = newCapacity;
+                    numElements = 0;
+                    numDeleted = 0;
+                    for(std::size_t i = 0; i < oldCapacity; ++i)
+                    {
+                        if(!isFull(oldControls[i]))
+                            continue;
+                        auto hash = hashKey(KeyOf{}(oldSlots[i]));
+                        auto index = findFreeIndex(hash);
+                        new(slots + index) Slot(std::move(oldSlots[i]));
+                        markFull(index, hash);
+                        oldSlots[i].~Slot();
+                    }
+                    if(oldCapacity != 0)
+                    {
+                        delete[] oldControls;
+                        ::operator delete(oldSlots);
+                    }
+                }
+
+                void deallocate() noexcept
+                {
+                    if(capacity != 0)
+                    {
+                        delete[] controls;
+                        ::operator delete(slots);
+                    }
+                    controls = const_cast<uint8_t*>(getEmptyControls());
+                    slots = nullptr;
+                    capacity = 0;
+                }
+            };
+
+            template <typename K, typename V>
+            struct PairKey
+            {
+                const K& operator()(const std::pair<K, V>& pair) const noexcept
+                {
+                    return pair.first;
+                }
+            };
+
+            template <typename K>
+            struct IdentityKey
+            {
+                const K& operator()(const K& key) const noexcept
+                {
+                    return key;
+                }
+            };
+        } // namespace detail
+
+        /**
+         * Map type with open addressing, storing all entries in a single flat array.
+         *
+         * Provides the subset of the std::unordered_map interface used by the compiler.
+         *
+         * NOTE: Inserting entries invalidates all references to other entries (unless enough space is reserved)!
+         */
+        template <typename K, typename V, typename H = std::hash<K>>
+        class FlatHashMap
+        {
+            // the entries are stored with a mutable key internally to be able to move them on rehashing, but only the
+            // const-key version is ever exposed
+            using Table = detail::FlatHashTable<K, std::pair<K, V>, detail::PairKey<K, V>, H>;
+
+            template <bool IsConst>
+            class Iterator
+            {
+                using BaseIterator =
+                    typename std::conditional<IsConst, typename Table::const_iterator, typename Table::iterator>::type;
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::pair<const K, V>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = typename std::conditional<IsConst, const value_type*, value_type*>::type;
+                using reference = typename std::conditional<IsConst, const value_type&, value_type&>::type;
+
+                Iterator() noexcept = default;
+                // allow conversion from non-const to const iterator
+                template <bool B = IsConst, typename = typename std::enable_if<B>::type>
+                Iterator(const Iterator<false>& other) noexcept : it(other.it)
+                {
+                }
+
+                reference operator*() const noexcept
+                {
+                    return reinterpret_cast<reference>(*it);
+                }
+
+                pointer operator->() const noexcept
+                {
+                    return &**this;
+                }
+
+                Iterator& operator++() noexcept
+                {
+                    ++it;
+                    return *this;
+                }
+
+                Iterator operator++(int) noexcept
+                {
+                    Iterator tmp = *this;
+                    ++it;
+                    return tmp;
+                }
+
+                bool operator==(const Iterator& other) const noexcept
+                {
+                    return it == other.it;
+                }
+
+                bool operator!=(const Iterator& other) const noexcept
+                {
+                    return it != other.it;
+                }
+
+            private:
+                BaseIterator it;
+
+                explicit Iterator(BaseIterator it) noexcept : it(it) {}
+
+                friend class FlatHashMap;
+                friend class Iterator<!IsConst>;
+            };
+
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = std::pair<const K, V>;
+            using hasher = H;
+            using reference = value_type&;
+            using const_reference = const value_type&;
+            using iterator = Iterator<false>;
+            using const_iterator = Iterator<true>;
+            using size_type = std::size_t;
+            using difference_type = std::ptrdiff_t;
+
+            explicit FlatHashMap(std::size_t numInitialElements = 0, const H& hash = H{}) : table(numInitialElements, hash) {}
+            FlatHashMap(std::initializer_list<value_type> list) : table(list.size())
+            {
+                insert(list.begin(), list.end());
+            }
+            template <typename It>
+            FlatHashMap(It first, It last) : table()
+            {
+                insert(first, last);
+            }
+
+            iterator begin() noexcept
+            {
+                return iterator{table.begin()};
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return const_iterator{table.begin()};
+            }
+
+            const_iterator cbegin() const noexcept
+            {
+                return begin();
+            }
+
+            iterator end() noexcept
+            {
+                return iterator{table.end()};
+            }
+
+            const_iterator end() const noexcept
+            {
+                return const_iterator{table.end()};
+            }
+
+            const_iterator cend() const noexcept
+            {
+                return end();
+            }
+
+            bool empty() const noexcept
+            {
+                return table.empty();
+            }
+
+            size_type size() const noexcept
+            {
+                return table.size();
+            }
+
+            size_type max_size() const noexcept
+            {
+                return table.max_size();
+            }
+
+            void clear() noexcept
+            {
+                table.clear();
+            }
+
+            void reserve(std::size_t minElements)
+            {
+                table.reserve(minElements);
+            }
+
+            std::size_t bucket_count() const noexcept
+            {
+                return table.bucket_count();
+            }
+
+            iterator find(const K& key)
+            {
+                return iterator{table.find(key)};
+            }
+
+            const_iterator find(const K& key) const
+            {
+                return const_iterator{table.find(key)};
+            }
+
+            size_type count(const K& key) const
+            {
+                return table.count(key);
+            }
+
+            V& at(const K& key)
+            {
+                auto it = table.find(key);
+                if(it == table.end())
+                    throw std::out_of_range("Key not found in map");
+                return it->second;
+            }
+
+            const V& at(const K& key) const
+            {
+                auto it = table.find(key);
+                if(it == table.end())
+                    throw std::out_of_range("Key not found in map");
+                return it->second;
+            }
+
+            V& operator[](const K& key)
+            {
+                return table.insertWith(key, [&]() { return std::pair<K, V>(key, V{}); }).first->second;
+            }
+
+            V& operator[](K&& key)
+            {
+                return table.insertWith(key, [&]() { return std::pair<K, V>(std::move(key), V{}); }).first->second;
+            }
+
+            std::pair<iterator, bool> insert(const value_type& value)
+            {
+                auto res = table.insert(std::pair<K, V>(value.first, value.second));
+                return std::make_pair(iterator{res.first}, res.second);
+            }
+
+            template <typename P, typename = typename std::enable_if<std::is_constructible<value_type, P&&>::value>::type>
+            std::pair<iterator, bool> insert(P&& value)
+            {
+                return emplace(std::forward<P>(value));
+            }
+
+            iterator insert(const_iterator /* hint */, const value_type& value)
+            {
+                return insert(value).first;
+            }
+
+            template <typename It>
+            void insert(It first, It last)
+            {
+                for(; first != last; ++first)
+                    emplace(*first);
+            }
+
+            void insert(std::initializer_list<value_type> list)
+            {
+                insert(list.begin(), list.end());
+            }
+
+            template <typename... Args>
+            std::pair<iterator, bool> emplace(Args&&... args)
+            {
+                // the key is only known after constructing the entry
+                auto res = table.insert(std::pair<K, V>(std::forward<Args>(args)...));
+                return std::make_pair(iterator{res.first}, res.second);
+            }
+
+            template <typename... Args>
+            iterator emplace_hint(const_iterator /* hint */, Args&&... args)
+            {
+                return emplace(std::forward<Args>(args)...).first;
+            }
+
+            iterator erase(const_iterator pos)
+            {
+                return iterator{table.erase(pos.it)};
+            }
+
+            iterator erase(iterator pos)
+            {
+                return iterator{table.erase(pos.it)};
+            }
+
+            size_type erase(const K& key)
+            {
+                return table.eraseKey(key);
+            }
+
+            void swap(FlatHashMap& other) noexcept
+            {
+                table.swap(other.table);
+            }
+
+            bool operator==(const FlatHashMap& other) const
+            {
+                if(size() != other.size())
+                    return false;
+                for(const auto& entry : *this)
+                {
+                    auto it = other.find(entry.first);
+                    if(it == other.end() || !(it->second == entry.second))
+                        return false;
+                }
+                return true;
+            }
+
+            bool operator!=(const FlatHashMap& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            Table table;
+        };
+
+        /**
+         * Set type with open addressing, storing all elements in a single flat array.
+         *
+         * Provides the subset of the std::unordered_set interface used by the compiler.
+         *
+         * NOTE: Inserting elements invalidates all references to other elements (unless enough space is reserved)!
+         */
+        template <typename T, typename H = std::hash<T>>
+        class FlatHashSet
+        {
+            using Table = detail::FlatHashTable<T, T, detail::IdentityKey<T>, H>;
+
+        public:
+            using key_type = T;
+            using value_type = T;
+            using hasher = H;
+            using reference = const T&;
+            using const_reference = const T&;
+            // like for std::unordered_set, the elements can never be modified via the iterators
+            using iterator = typename Table::const_iterator;
+            using const_iterator = typename Table::const_iterator;
+            using size_type = std::size_t;
+            using difference_type = std::ptrdiff_t;
+
+            explicit FlatHashSet(std::size_t numInitialElements = 0, const H& hash = H{}) : table(numInitialElements, hash) {}
+            FlatHashSet(std::initializer_list<T> list) : table(list.size())
+            {
+                insert(list.begin(), list.end());
+            }
+            template <typename It>
+            FlatHashSet(It first, It last) : table()
+            {
+                insert(first, last);
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return table.begin();
+            }
+
+            const_iterator cbegin() const noexcept
+            {
+                return table.begin();
+            }
+
+            const_iterator end() const noexcept
+            {
+                return table.end();
+            }
+
+            const_iterator cend() const noexcept
+            {
+                return table.end();
+            }
+
+            bool empty() const noexcept
+            {
+                return table.empty();
+            }
+
+            size_type size() const noexcept
+            {
+                return table.size();
+            }
+
+            size_type max_size() const noexcept
+            {
+                return table.max_size();
+            }
+
+            void clear() noexcept
+            {
+                table.clear();
+            }
+
+            void reserve(std::size_t minElements)
+            {
+                table.reserve(minElements);
+            }
+
+            std::size_t bucket_count() const noexcept
+            {
+                return table.bucket_count();
+            }
+
+            const_iterator find(const T& key) const
+            {
+                return table.find(key);
+            }
+
+            size_type count(const T& key) const
+            {
+                return table.count(key);
+            }
+
+            std::pair<iterator, bool> insert(const T& value)
+            {
+                return table.insert(value);
+            }
+
+            std::pair<iterator, bool> insert(T&& value)
+            {
+                return table.insert(std::move(value));
+            }
+
+            iterator insert(const_iterator /* hint */, const T& value)
+            {
+                return insert(value).first;
+            }
+
+            template <typename It>
+            void insert(It first, It last)
+            {
+                for(; first != last; ++first)
+                    insert(*first);
+            }
+
+            void insert(std::initializer_list<T> list)
+            {
+                insert(list.begin(), list.end());
+            }
+
+            template <typename... Args>
+            std::pair<iterator, bool> emplace(Args&&... args)
+            {
+                return table.insert(T(std::forward<Args>(args)...));
+            }
+
+            template <typename... Args>
+            iterator emplace_hint(const_iterator /* hint */, Args&&... args)
+            {
+                return emplace(std::forward<Args>(args)...).first;
+            }
+
+            iterator erase(const_iterator pos)
+            {
+                return table.erase(pos);
+            }
+
+            size_type erase(const T& key)
+            {
+                return table.eraseKey(key);
+            }
+
+            void swap(FlatHashSet& other) noexcept
+            {
+                table.swap(other.table);
+            }
+
+            bool operator==(const FlatHashSet& other) const
+            {
+                if(size() != other.size())
+                    return false;
+                for(const auto& elem : *this)
+                {
+                    if(other.find(elem) == other.end())
+                        return false;
+                }
+                return true;
+            }
+
+            bool operator!=(const FlatHashSet& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            Table table;
+        };
+    } // namespace tools
+} // namespace vc4c
+
+namespace std
+{
+    template <typename K, typename V, typename H>
+    inline void swap(vc4c::tools::FlatHashMap<K, V, H>& map1, vc4c::tools::FlatHashMap<K, V, H>& map2) noexcept
+    {
+        map1.swap(map2);
+    }
+
+    template <typename T, typename H>
+    inline void swap(vc4c::tools::FlatHashSet<T, H>& set1, vc4c::tools::FlatHashSet<T, H>& set2) noexcept
+    {
+        set1.swap(set2);
+    }
+} // namespace std
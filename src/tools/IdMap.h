@@ -0,0 +1,161 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /**
+         * Map for small dense integral IDs (e.g. the SPIR-V result IDs, which are all below the ID bound given in the
+         * module header), which looks up the entries by directly indexing a vector instead of hashing or comparing.
+         *
+         * The entries are stored in order of insertion, references to the entries stay valid on insertion (like for
+         * the node-based standard maps). Entries cannot be removed.
+         *
+         * The interface is a subset of the interface of the standard maps.
+         */
+        template <typename T>
+        class IdMap
+        {
+            using Storage = std::deque<std::pair<const uint32_t, T>>;
+
+        public:
+            using key_type = uint32_t;
+            using mapped_type = T;
+            using value_type = typename Storage::value_type;
+            using iterator = typename Storage::iterator;
+            using const_iterator = typename Storage::const_iterator;
+
+            IdMap() = default;
+
+            explicit IdMap(uint32_t idBound)
+            {
+                reserve(idBound);
+            }
+
+            /*
+             * Pre-sizes the ID look-up table for IDs up to (excluding) the given bound. IDs above the bound can still be
+             * inserted, but may require the table to be resized.
+             */
+            void reserve(uint32_t idBound)
+            {
+                if(idBound > indices.size())
+                    indices.resize(idBound, NO_ENTRY);
+            }
+
+            iterator begin() noexcept
+            {
+                return entries.begin();
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return entries.begin();
+            }
+
+            iterator end() noexcept
+            {
+                return entries.end();
+            }
+
+            const_iterator end() const noexcept
+            {
+                return entries.end();
+            }
+
+            std::size_t size() const noexcept
+            {
+                return entries.size();
+            }
+
+            bool empty() const noexcept
+            {
+                return entries.empty();
+            }
+
+            iterator find(uint32_t id) noexcept
+            {
+                auto index = getIndex(id);
+                return index == NO_ENTRY ? entries.end() : entries.begin() + index;
+            }
+
+            const_iterator find(uint32_t id) const noexcept
+            {
+                auto index = getIndex(id);
+                return index == NO_ENTRY ? entries.end() : entries.begin() + index;
+            }
+
+            std::size_t count(uint32_t id) const noexcept
+            {
+                return getIndex(id) == NO_ENTRY ? 0 : 1;
+            }
+
+            T& at(uint32_t id)
+            {
+                auto index = getIndex(id);
+                if(index == NO_ENTRY)
+                    throw std::out_of_range("No entry for ID: " + std::to_string(id));
+                return entries[index].second;
+            }
+
+            const T& at(uint32_t id) const
+            {
+                auto index = getIndex(id);
+                if(index == NO_ENTRY)
+                    throw std::out_of_range("No entry for ID: " + std::to_string(id));
+                return entries[index].second;
+            }
+
+            /*
+             * Inserts a new entry constructed from the given arguments, if there is no entry for the ID yet. Returns the
+             * (new or existing) entry and whether it was inserted.
+             */
+            template <typename... Args>
+            std::pair<iterator, bool> emplace(uint32_t id, Args&&... args)
+            {
+                auto index = getIndex(id);
+                if(index != NO_ENTRY)
+                    return std::make_pair(entries.begin() + index, false);
+                reserve(id + 1);
+                indices[id] = static_cast<uint32_t>(entries.size());
+                entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(id),
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+                return std::make_pair(std::prev(entries.end()), true);
+            }
+
+            T& operator[](uint32_t id)
+            {
+                return emplace(id).first->second;
+            }
+
+        private:
+            static constexpr uint32_t NO_ENTRY = ~uint32_t{0};
+
+            // maps the ID to the index of the entry (or NO_ENTRY), sized to the largest ID known
+            std::vector<uint32_t> indices;
+            Storage entries;
+
+            uint32_t getIndex(uint32_t id) const noexcept
+            {
+                return id < indices.size() ? indices[id] : NO_ENTRY;
+            }
+        };
+
+        template <typename T>
+        constexpr uint32_t IdMap<T>::NO_ENTRY;
+    } // namespace tools
+} // namespace vc4c
@@ -0,0 +1,103 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#pragma once
+
+#include "../performance.h"
+#include "DynamicBitSet.h"
+
+#include <cstdint>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /**
+         * Assigns dense indices (in the range [0, size()) in order of insertion) to objects, e.g. the locals or
+         * instructions of a method, and allows to look up the objects by their index.
+         *
+         * This allows to store sets of these objects as DynamicBitSet, which is much more efficient for set operations
+         * than hash-sets of pointers.
+         *
+         * NOTE: The indices are only a snapshot, objects created after the table was created are not known to it (but
+         * can be added explicitly), removed objects are not removed from the table!
+         */
+        template <typename T>
+        class IndexTable
+        {
+        public:
+            static constexpr uint32_t INVALID_INDEX = ~uint32_t{0};
+
+            IndexTable() = default;
+
+            explicit IndexTable(std::size_t expectedSize)
+            {
+                objects.reserve(expectedSize);
+                indices.reserve(expectedSize);
+            }
+
+            /*
+             * Returns the index of the object, assigning a new index if the object is not yet known
+             */
+            uint32_t addObject(const T& object)
+            {
+                auto it = indices.emplace(object, static_cast<uint32_t>(objects.size()));
+                if(it.second)
+                    objects.push_back(object);
+                return it.first->second;
+            }
+
+            /*
+             * Returns the index of the object or INVALID_INDEX if the object is not known to this table
+             */
+            uint32_t getIndex(const T& object) const
+            {
+                auto it = indices.find(object);
+                return it != indices.end() ? it->second : INVALID_INDEX;
+            }
+
+            const T& operator[](uint32_t index) const
+            {
+                return objects[index];
+            }
+
+            std::size_t size() const noexcept
+            {
+                return objects.size();
+            }
+
+            /*
+             * Converts the given set of objects to a bit-set of their indices, assigning new indices if required
+             */
+            template <typename Container>
+            DynamicBitSet toBitSet(const Container& container)
+            {
+                DynamicBitSet set(objects.size());
+                for(const auto& obj : container)
+                    set.insert(addObject(obj));
+                return set;
+            }
+
+            /*
+             * Converts the given bit-set of indices to the set of the objects with these indices
+             */
+            FastSet<T> toSet(const DynamicBitSet& set) const
+            {
+                FastSet<T> result;
+                result.reserve(set.size());
+                set.forAll([&](std::size_t index) { result.emplace(objects[index]); });
+                return result;
+            }
+
+        private:
+            FastAccessList<T> objects;
+            FastMap<T, uint32_t> indices;
+        };
+
+        template <typename T>
+        constexpr uint32_t IndexTable<T>::INVALID_INDEX;
+    } // namespace tools
+} // namespace vc4c
@@ -0,0 +1,337 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#pragma once
+
+#include "MemoryPool.h"
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /**
+         * Doubly-linked list where the links are stored together with the element in a single node, the nodes are
+         * allocated from the memory pool.
+         *
+         * In addition to the std::list interface used by the compiler, every element carries an ordinal number which is
+         * increasing along the list, allowing to check the order of two elements of the same list in constant time
+         * (see #isBefore()). The ordinals are assigned in a sparse manner, so inserting elements does (in most of the
+         * cases) not require any renumbering. If there is no gap left, all ordinals are directly recalculated on
+         * insertion. Thus, querying the order never modifies the list and can be done concurrently from multiple
+         * threads (as long as the list itself is not modified at the same time).
+         *
+         * Like std::list, inserting or removing elements does not invalidate any iterators (except for iterators to
+         * the removed elements).
+         *
+         * NOTE: The list objects itself are not movable, since the end-iterator refers to the list object.
+         *
+         * The memory of the nodes is accounted to the given category, see profiler::trackMemory().
+         */
+        template <typename T, profiler::MemoryCategory Category = profiler::MemoryCategory::OTHER>
+        class IntrusiveList
+        {
+            // the distance between the ordinals of two neighboring elements after renumbering
+            static constexpr std::size_t ORDINAL_STEP = 1024;
+
+            struct Link
+            {
+                Link* prev;
+                Link* next;
+                std::size_t ordinal;
+            };
+
+            struct Node : public Link
+            {
+                template <typename... Args>
+                explicit Node(Args&&... args) : Link{nullptr, nullptr, 0}, value(std::forward<Args>(args)...)
+                {
+                }
+
+                T value;
+            };
+
+            using NodeAllocator = PoolAllocator<Node, Category>;
+
+            template <bool IsConst>
+            class Iterator
+            {
+            public:
+                using iterator_category = std::bidirectional_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = typename std::conditional<IsConst, const T*, T*>::type;
+                using reference = typename std::conditional<IsConst, const T&, T&>::type;
+
+                constexpr Iterator() noexcept : link(nullptr) {}
+                // allow conversion from non-const to const iterator
+                template <bool B = IsConst, typename = typename std::enable_if<B>::type>
+                constexpr Iterator(const Iterator<false>& other) noexcept : link(other.link)
+                {
+                }
+
+                reference operator*() const noexcept
+                {
+                    return static_cast<Node*>(link)->value;
+                }
+
+                pointer operator->() const noexcept
+                {
+                    return &static_cast<Node*>(link)->value;
+                }
+
+                Iterator& operator++() noexcept
+                {
+                    link = link->next;
+                    return *this;
+                }
+
+                Iterator operator++(int) noexcept
+                {
+                    Iterator tmp = *this;
+                    link = link->next;
+                    return tmp;
+                }
+
+                Iterator& operator--() noexcept
+                {
+                    link = link->prev;
+                    return *this;
+                }
+
+                Iterator operator--(int) noexcept
+                {
+                    Iterator tmp = *this;
+                    link = link->prev;
+                    return tmp;
+                }
+
+                constexpr bool operator==(const Iterator& other) const noexcept
+                {
+                    return link == other.link;
+                }
+
+                constexpr bool operator!=(const Iterator& other) const noexcept
+                {
+                    return link != other.link;
+                }
+
+            private:
+                Link* link;
+
+                explicit constexpr Iterator(Link* link) noexcept : link(link) {}
+
+                friend class IntrusiveList;
+                friend class Iterator<!IsConst>;
+            };
+
+        public:
+            using value_type = T;
+            using reference = T&;
+            using const_reference = const T&;
+            using pointer = T*;
+            using const_pointer = const T*;
+            using iterator = Iterator<false>;
+            using const_iterator = Iterator<true>;
+            using reverse_iterator = std::reverse_iterator<iterator>;
+            using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+            using difference_type = std::ptrdiff_t;
+            using size_type = std::size_t;
+
+            IntrusiveList() noexcept : sentinel{&sentinel, &sentinel, 0}, numElements(0) {}
+            IntrusiveList(const IntrusiveList&) = delete;
+            IntrusiveList(IntrusiveList&&) = delete;
+            ~IntrusiveList()
+            {
+                clear();
+            }
+
+            IntrusiveList& operator=(const IntrusiveList&) = delete;
+            IntrusiveList& operator=(IntrusiveList&&) = delete;
+
+            iterator begin() noexcept
+            {
+                return iterator{sentinel.next};
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return const_iterator{sentinel.next};
+            }
+
+            iterator end() noexcept
+            {
+                return iterator{&sentinel};
+            }
+
+            const_iterator end() const noexcept
+            {
+                return const_iterator{const_cast<Link*>(&sentinel)};
+            }
+
+            reverse_iterator rbegin() noexcept
+            {
+                return reverse_iterator{end()};
+            }
+
+            const_reverse_iterator rbegin() const noexcept
+            {
+                return const_reverse_iterator{end()};
+            }
+
+            reverse_iterator rend() noexcept
+            {
+                return reverse_iterator{begin()};
+            }
+
+            const_reverse_iterator rend() const noexcept
+            {
+                return const_reverse_iterator{begin()};
+            }
+
+            bool empty() const noexcept
+            {
+                return numElements == 0;
+            }
+
+            size_type size() const noexcept
+            {
+                return numElements;
+            }
+
+            reference front()
+            {
+                return *begin();
+            }
+
+            const_reference front() const
+            {
+                return *begin();
+            }
+
+            reference back()
+            {
+                return *(--end());
+            }
+
+            const_reference back() const
+            {
+                return *(--end());
+            }
+
+            template <typename... Args>
+            iterator emplace(const_iterator pos, Args&&... args)
+            {
+                NodeAllocator alloc;
+                auto node = alloc.allocate(1);
+                try
+                {
+                    new(node) Node(std::forward<Args>(args)...);
+                }
+                catch(...)
+                {
+                    alloc.deallocate(node, 1);
+                    throw;
+                }
+                link(pos.link, node);
+                return iterator{node};
+            }
+
+            iterator insert(const_iterator pos, T&& value)
+            {
+                return emplace(pos, std::move(value));
+            }
+
+            template <typename... Args>
+            reference emplace_back(Args&&... args)
+            {
+                return *emplace(end(), std::forward<Args>(args)...);
+            }
+
+            void push_back(T&& value)
+            {
+                emplace(end(), std::move(value));
+            }
+
+            iterator erase(const_iterator pos)
+            {
+                auto node = static_cast<Node*>(pos.link);
+                auto next = node->next;
+                node->prev->next = next;
+                next->prev = node->prev;
+                --numElements;
+                NodeAllocator alloc;
+                node->~Node();
+                alloc.deallocate(node, 1);
+                // removing elements keeps the order of the remaining elements, so no need to invalidate the ordinals
+                return iterator{next};
+            }
+
+            void clear() noexcept
+            {
+                while(!empty())
+                    erase(begin());
+            }
+
+            /*
+             * Returns whether the first element is located before the second element.
+             *
+             * Both iterators need to belong to this list, the end-iterator is located behind all elements.
+             */
+            bool isBefore(const_iterator first, const_iterator second) const noexcept
+            {
+                if(first == second || first == end())
+                    return false;
+                if(second == end())
+                    return true;
+                return first.link->ordinal < second.link->ordinal;
+            }
+
+        private:
+            Link sentinel;
+            std::size_t numElements;
+
+            void link(Link* next, Link* node) noexcept
+            {
+                auto prev = next->prev;
+                node->prev = prev;
+                node->next = next;
+                prev->next = node;
+                next->prev = node;
+                ++numElements;
+                // the sentinel is located before the first and after the last element
+                const auto prevOrdinal = prev == &sentinel ? std::size_t{0} : prev->ordinal;
+                if(next == &sentinel)
+                {
+                    if(prevOrdinal > std::numeric_limits<std::size_t>::max() - ORDINAL_STEP)
+                        renumber();
+                    else
+                        node->ordinal = prevOrdinal + ORDINAL_STEP;
+                }
+                else if(next->ordinal - prevOrdinal > 1 && next->ordinal > prevOrdinal)
+                    node->ordinal = prevOrdinal + (next->ordinal - prevOrdinal) / 2;
+                else
+                    // no more space in-between, need to renumber all elements
+                    renumber();
+            }
+
+            void renumber() noexcept
+            {
+                std::size_t ordinal = 0;
+                for(Link* link = sentinel.next; link != &sentinel; link = link->next)
+                {
+                    ordinal += ORDINAL_STEP;
+                    link->ordinal = ordinal;
+                }
+            }
+        };
+    } // namespace tools
+} // namespace vc4c
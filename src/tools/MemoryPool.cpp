@@ -0,0 +1,277 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "MemoryPool.h"
+
+#include <array>
+#include <iterator>
+#include <map>
+#include <mutex>
+#if DEBUG_MODE
+#include <atomic>
+#endif
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+// all blocks are multiples of the maximum fundamental alignment to be correctly aligned for any object
+static constexpr std::size_t BLOCK_GRANULARITY = alignof(std::max_align_t);
+static constexpr std::size_t MAX_POOLED_SIZE = 512;
+static constexpr std::size_t NUM_SIZE_CLASSES = MAX_POOLED_SIZE / BLOCK_GRANULARITY;
+static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+// the number of blocks moved between the per-thread and global free-lists at once
+static constexpr std::size_t TRANSFER_BATCH_SIZE = 64;
+
+#if DEBUG_MODE
+// only tracked in debug builds to not add contended atomic operations to every allocation
+static std::atomic_size_t numLiveBlocks{0};
+static std::atomic_size_t numReusedBlocks{0};
+#endif
+
+namespace
+{
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct FreeList
+    {
+        FreeBlock* head = nullptr;
+        std::size_t numBlocks = 0;
+
+        void push(void* ptr) noexcept
+        {
+            auto block = reinterpret_cast<FreeBlock*>(ptr);
+            block->next = head;
+            head = block;
+            ++numBlocks;
+        }
+
+        void* pop() noexcept
+        {
+            auto block = head;
+            head = block->next;
+            --numBlocks;
+            return block;
+        }
+
+        /*
+         * Moves up to the given number of blocks to the other free-list
+         */
+        void transfer(FreeList& other, std::size_t maxBlocks) noexcept
+        {
+            for(std::size_t i = 0; i < maxBlocks && head; ++i)
+                other.push(pop());
+        }
+    };
+
+    struct Slab
+    {
+        std::unique_ptr<char[]> memory;
+        std::size_t numBlocks;
+        // only used while releasing the unused slabs
+        std::size_t numFreeBlocks;
+    };
+
+    /*
+     * The global state shared between all threads, owning all the slabs
+     */
+    struct GlobalPool
+    {
+        std::mutex mutex;
+        std::array<FreeList, NUM_SIZE_CLASSES> freeLists;
+        // the slabs, indexed by their start address to find the slab containing a block
+        std::map<const char*, Slab> slabs;
+
+        void refill(FreeList& localList, std::size_t sizeClass)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto& globalList = freeLists[sizeClass];
+            if(globalList.head)
+            {
+                globalList.transfer(localList, TRANSFER_BATCH_SIZE);
+                return;
+            }
+            const auto blockSize = (sizeClass + 1) * BLOCK_GRANULARITY;
+            std::unique_ptr<char[]> memory(new char[SLAB_SIZE]);
+            auto slab = memory.get();
+            slabs.emplace(slab, Slab{std::move(memory), SLAB_SIZE / blockSize, 0});
+            for(std::size_t offset = 0; offset + blockSize <= SLAB_SIZE; offset += blockSize)
+                localList.push(slab + offset);
+        }
+
+        void release(FreeList& localList, std::size_t sizeClass, std::size_t maxBlocks) noexcept
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            localList.transfer(freeLists[sizeClass], maxBlocks);
+        }
+
+        Slab& findSlab(const void* block)
+        {
+            // the slab with the largest start address not greater than the block
+            return std::prev(slabs.upper_bound(reinterpret_cast<const char*>(block)))->second;
+        }
+
+        /*
+         * Frees all slabs of which all blocks are in the global free-lists
+         */
+        std::size_t releaseUnusedSlabs()
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for(auto& slab : slabs)
+                slab.second.numFreeBlocks = 0;
+            for(auto& list : freeLists)
+            {
+                for(auto block = list.head; block; block = block->next)
+                    ++findSlab(block).numFreeBlocks;
+            }
+            // remove the blocks of the unused slabs from the free-lists before freeing the slabs
+            for(auto& list : freeLists)
+            {
+                FreeList remainingBlocks;
+                while(list.head)
+                {
+                    auto block = list.pop();
+                    auto& slab = findSlab(block);
+                    if(slab.numFreeBlocks != slab.numBlocks)
+                        remainingBlocks.push(block);
+                }
+                list = remainingBlocks;
+            }
+            std::size_t numReleased = 0;
+            for(auto it = slabs.begin(); it != slabs.end();)
+            {
+                if(it->second.numFreeBlocks == it->second.numBlocks)
+                {
+                    it = slabs.erase(it);
+                    ++numReleased;
+                }
+                else
+                    ++it;
+            }
+            return numReleased;
+        }
+    };
+} // namespace
+
+static GlobalPool& getGlobalPool()
+{
+    // intentionally never destroyed, since pooled objects might still be freed while running the static destructors.
+    // The slabs are returned to the system by #releaseUnusedPoolMemory() once all their blocks are free.
+    static auto pool = new GlobalPool();
+    return *pool;
+}
+
+// set when the cache of the current thread is destroyed, afterwards all blocks are directly returned to the global pool
+static thread_local bool threadCacheDestroyed = false;
+
+namespace
+{
+    struct ThreadCache
+    {
+        std::array<FreeList, NUM_SIZE_CLASSES> freeLists;
+
+        ~ThreadCache()
+        {
+            // hand all cached blocks back to be reused by other threads
+            for(std::size_t sizeClass = 0; sizeClass < NUM_SIZE_CLASSES; ++sizeClass)
+                getGlobalPool().release(freeLists[sizeClass], sizeClass, freeLists[sizeClass].numBlocks);
+            threadCacheDestroyed = true;
+        }
+    };
+} // namespace
+
+static thread_local ThreadCache threadCache;
+
+static std::size_t getSizeClass(std::size_t size) noexcept
+{
+    return size == 0 ? 0 : (size - 1) / BLOCK_GRANULARITY;
+}
+
+void* tools::allocatePooled(std::size_t size)
+{
+    if(size > MAX_POOLED_SIZE)
+        return ::operator new(size);
+    auto sizeClass = getSizeClass(size);
+#if DEBUG_MODE
+    ++numLiveBlocks;
+#endif
+    if(threadCacheDestroyed)
+    {
+        FreeList tmp;
+        getGlobalPool().refill(tmp, sizeClass);
+        auto block = tmp.pop();
+        getGlobalPool().release(tmp, sizeClass, tmp.numBlocks);
+        return block;
+    }
+    auto& localList = threadCache.freeLists[sizeClass];
+#if DEBUG_MODE
+    if(localList.head)
+        ++numReusedBlocks;
+#endif
+    if(!localList.head)
+        getGlobalPool().refill(localList, sizeClass);
+    return localList.pop();
+}
+
+void tools::deallocatePooled(void* ptr, std::size_t size) noexcept
+{
+    if(ptr == nullptr)
+        return;
+    if(size > MAX_POOLED_SIZE)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    auto sizeClass = getSizeClass(size);
+#if DEBUG_MODE
+    --numLiveBlocks;
+#endif
+    if(threadCacheDestroyed)
+    {
+        FreeList tmp;
+        tmp.push(ptr);
+        getGlobalPool().release(tmp, sizeClass, 1);
+        return;
+    }
+    auto& localList = threadCache.freeLists[sizeClass];
+    localList.push(ptr);
+    // do not let a single thread hoard the blocks freed by it (e.g. when destroying the module allocated in another
+    // thread), but make them available to the other threads
+    if(localList.numBlocks > 4 * TRANSFER_BATCH_SIZE)
+        getGlobalPool().release(localList, sizeClass, 2 * TRANSFER_BATCH_SIZE);
+}
+
+std::size_t tools::releaseUnusedPoolMemory()
+{
+    if(!threadCacheDestroyed)
+    {
+        // the blocks cached by the current thread would otherwise keep their slabs alive
+        for(std::size_t sizeClass = 0; sizeClass < NUM_SIZE_CLASSES; ++sizeClass)
+        {
+            auto& localList = threadCache.freeLists[sizeClass];
+            getGlobalPool().release(localList, sizeClass, localList.numBlocks);
+        }
+    }
+    return getGlobalPool().releaseUnusedSlabs();
+}
+
+MemoryPoolStatistics tools::getMemoryPoolStatistics()
+{
+    MemoryPoolStatistics stats;
+    {
+        auto& pool = getGlobalPool();
+        std::lock_guard<std::mutex> guard(pool.mutex);
+        stats.numSlabs = pool.slabs.size();
+    }
+#if DEBUG_MODE
+    stats.hasBlockStatistics = true;
+    stats.numLiveBlocks = numLiveBlocks;
+    stats.numReusedBlocks = numReusedBlocks;
+#endif
+    return stats;
+}
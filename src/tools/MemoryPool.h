@@ -0,0 +1,134 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+#ifndef VC4C_MEMORY_POOL_H
+#define VC4C_MEMORY_POOL_H
+
+#include "../Profiler.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /*
+         * Allocates a memory block of the given size from the pool of small objects.
+         *
+         * The memory is taken from slabs which are split into blocks of the same size class. Freed blocks are cached
+         * in a per-thread free-list and reused for subsequent allocations of the same size class, so most allocations
+         * and deallocations only push/pop a single pointer without any synchronization. Requests larger than the
+         * largest size class are directly forwarded to the global allocator.
+         *
+         * NOTE: The size passed to #deallocatePooled() needs to be the same as the size of the allocation!
+         */
+        void* allocatePooled(std::size_t size);
+        void deallocatePooled(void* ptr, std::size_t size) noexcept;
+
+        /*
+         * Returns all slabs of which no block is in use anymore to the global allocator and returns the number of
+         * released slabs.
+         *
+         * Blocks cached by other threads than the calling one keep their slabs alive.
+         */
+        std::size_t releaseUnusedPoolMemory();
+
+        /*
+         * Statistics about the usage of the memory pool
+         */
+        struct MemoryPoolStatistics
+        {
+            // the number of slabs currently allocated from the global allocator
+            std::size_t numSlabs = 0;
+            // whether the following block statistics are tracked, which is only the case for debug builds
+            bool hasBlockStatistics = false;
+            // the number of currently allocated pooled blocks
+            std::size_t numLiveBlocks = 0;
+            // the number of allocations which were served from a free-list
+            std::size_t numReusedBlocks = 0;
+        };
+
+        MemoryPoolStatistics getMemoryPoolStatistics();
+
+        /*
+         * Base type for objects which are allocated in large numbers, e.g. instructions or locals.
+         *
+         * Overloads the class-specific allocation functions to use the memory pool. Since the sized deallocation
+         * function is called with the size of the dynamic type of the object (as long as the base has a virtual
+         * destructor), this also works for class hierarchies with differently sized child classes.
+         *
+         * The allocated memory is accounted to the given category, see profiler::trackMemory().
+         */
+        template <profiler::MemoryCategory Category = profiler::MemoryCategory::OTHER>
+        struct PooledObject
+        {
+            static void* operator new(std::size_t size)
+            {
+                auto ptr = allocatePooled(size);
+                profiler::trackMemory(Category, static_cast<int64_t>(size));
+                return ptr;
+            }
+
+            static void operator delete(void* ptr, std::size_t size) noexcept
+            {
+                profiler::trackMemory(Category, -static_cast<int64_t>(size));
+                deallocatePooled(ptr, size);
+            }
+        };
+
+        /*
+         * Standard library allocator using the memory pool, e.g. for the nodes of node-based containers.
+         *
+         * The allocated memory is accounted to the given category, see profiler::trackMemory().
+         */
+        template <typename T, profiler::MemoryCategory Category = profiler::MemoryCategory::OTHER>
+        struct PoolAllocator
+        {
+            using value_type = T;
+
+            // the default rebind only works for allocators without non-type template parameters
+            template <typename U>
+            struct rebind
+            {
+                using other = PoolAllocator<U, Category>;
+            };
+
+            PoolAllocator() noexcept = default;
+            template <typename U>
+            PoolAllocator(const PoolAllocator<U, Category>& /* other */) noexcept
+            {
+            }
+
+            T* allocate(std::size_t n)
+            {
+                auto ptr = static_cast<T*>(allocatePooled(n * sizeof(T)));
+                profiler::trackMemory(Category, static_cast<int64_t>(n * sizeof(T)));
+                return ptr;
+            }
+
+            void deallocate(T* ptr, std::size_t n) noexcept
+            {
+                profiler::trackMemory(Category, -static_cast<int64_t>(n * sizeof(T)));
+                deallocatePooled(ptr, n * sizeof(T));
+            }
+
+            template <typename U>
+            bool operator==(const PoolAllocator<U, Category>& /* other */) const noexcept
+            {
+                return true;
+            }
+
+            template <typename U>
+            bool operator!=(const PoolAllocator<U, Category>& /* other */) const noexcept
+            {
+                return false;
+            }
+        };
+    } // namespace tools
+} // namespace vc4c
+
+#endif /* VC4C_MEMORY_POOL_H */
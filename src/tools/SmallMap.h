@@ -12,6 +12,7 @@
 #include <array>
 #include <map>
 #include <type_traits>
+#include <vector>
 
 namespace vc4c
 {
@@ -244,6 +245,179 @@ namespace vc4c
             }
         };
 
+        /**
+         * Container similar to a std::map, but stores the elements sorted in a contiguous array.
+         *
+         * This container is used instead of std::map for the big version of the SmallSortedPointerMap if the
+         * FLAT_CONTAINERS build option is enabled, since it has better cache behavior for the number of elements
+         * usually stored (e.g. the users of a local).
+         *
+         * NOTE: In contrast to std::map, inserting or deleting elements might invalidate iterators!
+         */
+        template <typename K, typename V, typename C = std::less<K>>
+        class SortedVectorMap
+        {
+            // the elements are stored with a mutable key to be able to shift them around
+            using Container = std::vector<std::pair<K, V>>;
+            using Element = typename Container::value_type;
+
+            struct ElementComparator
+            {
+                C comp;
+                bool operator()(const Element& e1, const Element& e2) const
+                {
+                    return comp(e1.first, e2.first);
+                }
+                bool operator()(const Element& e1, const K& k2) const
+                {
+                    return comp(e1.first, k2);
+                }
+            };
+
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = std::pair<const K, V>;
+            using key_compare = C;
+            using reference = value_type&;
+            using const_reference = const value_type&;
+            using pointer = value_type*;
+            using const_pointer = const value_type*;
+            using iterator = typename Container::iterator;
+            using const_iterator = typename Container::const_iterator;
+            using difference_type = typename Container::difference_type;
+            using size_type = typename Container::size_type;
+
+            SortedVectorMap() = default;
+
+            template <typename It>
+            SortedVectorMap(It first, It last)
+            {
+                for(; first != last; ++first)
+                    emplace(first->first, first->second);
+            }
+
+            SortedVectorMap(std::initializer_list<value_type> init) : SortedVectorMap(init.begin(), init.end()) {}
+
+            iterator begin() noexcept
+            {
+                return data.begin();
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return data.begin();
+            }
+
+            iterator end() noexcept
+            {
+                return data.end();
+            }
+
+            const_iterator end() const noexcept
+            {
+                return data.end();
+            }
+
+            bool empty() const noexcept
+            {
+                return data.empty();
+            }
+
+            size_type size() const noexcept
+            {
+                return data.size();
+            }
+
+            mapped_type& operator[](const key_type& key)
+            {
+                auto it = findInner(key);
+                if(it == data.end() || C{}(key, it->first))
+                    it = data.emplace(it, key, V{});
+                return it->second;
+            }
+
+            mapped_type& at(const key_type& key)
+            {
+                auto it = find(key);
+                if(it == data.end())
+                    throw std::out_of_range{"Key not in sorted vector map"};
+                return it->second;
+            }
+
+            const mapped_type& at(const key_type& key) const
+            {
+                auto it = find(key);
+                if(it == data.end())
+                    throw std::out_of_range{"Key not in sorted vector map"};
+                return it->second;
+            }
+
+            iterator erase(const_iterator position)
+            {
+                return data.erase(position);
+            }
+
+            size_type erase(const key_type& key)
+            {
+                auto it = find(key);
+                if(it == data.end())
+                    return 0;
+                data.erase(it);
+                return 1;
+            }
+
+            void clear()
+            {
+                data.clear();
+            }
+
+            template <typename... Args>
+            std::pair<iterator, bool> emplace(Args&&... args)
+            {
+                Element tmp{std::forward<Args>(args)...};
+                auto it = findInner(tmp.first);
+                if(it != data.end() && !C{}(tmp.first, it->first))
+                    return std::make_pair(it, false);
+                return std::make_pair(data.emplace(it, std::move(tmp)), true);
+            }
+
+            iterator find(const key_type& key)
+            {
+                auto it = findInner(key);
+                return it != data.end() && !C{}(key, it->first) ? it : data.end();
+            }
+
+            const_iterator find(const key_type& key) const
+            {
+                auto it = findInner(key);
+                return it != data.end() && !C{}(key, it->first) ? it : data.end();
+            }
+
+            bool operator==(const SortedVectorMap& other) const
+            {
+                return data == other.data;
+            }
+
+            bool operator!=(const SortedVectorMap& other) const
+            {
+                return data != other.data;
+            }
+
+        private:
+            Container data;
+
+            iterator findInner(const key_type& key)
+            {
+                return std::lower_bound(data.begin(), data.end(), key, ElementComparator{});
+            }
+
+            const_iterator findInner(const key_type& key) const
+            {
+                return std::lower_bound(data.begin(), data.end(), key, ElementComparator{});
+            }
+        };
+
         /**
          * Container similar to a std::map, but stores the first few elements in-line.
          *
@@ -267,8 +441,12 @@ namespace vc4c
 
             using Comparator = std::less<K>;
             using SmallContainer = FixedSortedPointerMap<K, V, SmallSize, Comparator>;
+#ifdef FLAT_CONTAINERS
+            using BigContainer = SortedVectorMap<K, V, Comparator>;
+#else
             using BigContainer = std::map<K, V, Comparator>;
-            static_assert(sizeof(SmallContainer) <= sizeof(BigContainer), "Small container is too big");
+#endif
+            static_assert(sizeof(SmallContainer) <= sizeof(std::map<K, V>), "Small container is too big");
 
             struct ConstIterator
             {
@@ -294,12 +472,14 @@ namespace vc4c
 
                 const std::pair<const K, V>& operator*() const noexcept
                 {
-                    return isBig ? *bigIt : reinterpret_cast<const std::pair<const K, V>&>(*smallIt);
+                    return isBig ? reinterpret_cast<const std::pair<const K, V>&>(*bigIt) :
+                               reinterpret_cast<const std::pair<const K, V>&>(*smallIt);
                 }
 
                 const std::pair<const K, V>* operator->() const noexcept
                 {
-                    return isBig ? &*bigIt : reinterpret_cast<const std::pair<const K, V>*>(&*smallIt);
+                    return isBig ? reinterpret_cast<const std::pair<const K, V>*>(&*bigIt) :
+                               reinterpret_cast<const std::pair<const K, V>*>(&*smallIt);
                 }
 
                 ConstIterator& operator++() noexcept
@@ -365,12 +545,14 @@ namespace vc4c
 
                 std::pair<const K, V>& operator*() noexcept
                 {
-                    return isBig ? *bigIt : reinterpret_cast<std::pair<const K, V>&>(*smallIt);
+                    return isBig ? reinterpret_cast<std::pair<const K, V>&>(*bigIt) :
+                               reinterpret_cast<std::pair<const K, V>&>(*smallIt);
                 }
 
                 std::pair<const K, V>* operator->() noexcept
                 {
-                    return isBig ? &*bigIt : reinterpret_cast<std::pair<const K, V>*>(&*smallIt);
+                    return isBig ? reinterpret_cast<std::pair<const K, V>*>(&*bigIt) :
+                               reinterpret_cast<std::pair<const K, V>*>(&*smallIt);
                 }
 
                 Iterator& operator++() noexcept
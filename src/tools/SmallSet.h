@@ -12,6 +12,7 @@
 #include <array>
 #include <set>
 #include <type_traits>
+#include <vector>
 
 namespace vc4c
 {
@@ -186,6 +187,114 @@ namespace vc4c
             }
         };
 
+        /**
+         * Container similar to a std::set, but stores the elements sorted in a contiguous array.
+         *
+         * This container is used instead of std::set for the big version of the SmallSortedPointerSet if the
+         * FLAT_CONTAINERS build option is enabled.
+         *
+         * NOTE: In contrast to std::set, inserting or deleting elements might invalidate iterators!
+         */
+        template <typename T, typename C = std::less<T>>
+        class SortedVectorSet
+        {
+            using Container = std::vector<T>;
+
+        public:
+            using key_type = T;
+            using value_type = T;
+            using key_compare = C;
+            using value_compare = C;
+            using reference = const T&;
+            using const_reference = const T&;
+            using pointer = const T*;
+            using const_pointer = const T*;
+            // like for std::set, the elements can never be modified via the iterators
+            using iterator = typename Container::const_iterator;
+            using const_iterator = typename Container::const_iterator;
+            using difference_type = typename Container::difference_type;
+            using size_type = typename Container::size_type;
+
+            SortedVectorSet() = default;
+
+            template <typename It>
+            SortedVectorSet(It first, It last)
+            {
+                for(; first != last; ++first)
+                    emplace(*first);
+            }
+
+            SortedVectorSet(std::initializer_list<value_type> init) : SortedVectorSet(init.begin(), init.end()) {}
+
+            const_iterator begin() const noexcept
+            {
+                return data.begin();
+            }
+
+            const_iterator end() const noexcept
+            {
+                return data.end();
+            }
+
+            bool empty() const noexcept
+            {
+                return data.empty();
+            }
+
+            size_type size() const noexcept
+            {
+                return data.size();
+            }
+
+            iterator erase(const_iterator position)
+            {
+                return data.erase(position);
+            }
+
+            size_type erase(const key_type& key)
+            {
+                auto it = find(key);
+                if(it == data.end())
+                    return 0;
+                data.erase(it);
+                return 1;
+            }
+
+            void clear()
+            {
+                data.clear();
+            }
+
+            template <typename... Args>
+            std::pair<iterator, bool> emplace(Args&&... args)
+            {
+                T tmp{std::forward<Args>(args)...};
+                auto it = std::lower_bound(data.cbegin(), data.cend(), tmp, C{});
+                if(it != data.end() && !C{}(tmp, *it))
+                    return std::make_pair(it, false);
+                return std::make_pair(const_iterator{data.emplace(it, std::move(tmp))}, true);
+            }
+
+            const_iterator find(const key_type& key) const
+            {
+                auto it = std::lower_bound(data.begin(), data.end(), key, C{});
+                return it != data.end() && !C{}(key, *it) ? it : data.end();
+            }
+
+            bool operator==(const SortedVectorSet& other) const
+            {
+                return data == other.data;
+            }
+
+            bool operator!=(const SortedVectorSet& other) const
+            {
+                return data != other.data;
+            }
+
+        private:
+            Container data;
+        };
+
         /**
          * Container similar to a std::set, but stores the first few elements in-line.
          *
@@ -209,8 +318,12 @@ namespace vc4c
 
             using Comparator = std::less<T>;
             using SmallContainer = FixedSortedPointerSet<T, SmallSize, Comparator>;
+#ifdef FLAT_CONTAINERS
+            using BigContainer = SortedVectorSet<T, Comparator>;
+#else
             using BigContainer = std::set<T, Comparator>;
-            static_assert(sizeof(SmallContainer) <= sizeof(BigContainer), "Small container is too big");
+#endif
+            static_assert(sizeof(SmallContainer) <= sizeof(std::set<T>), "Small container is too big");
 
             struct ConstIterator
             {
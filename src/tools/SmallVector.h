@@ -0,0 +1,352 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#pragma once
+
+#include "CompilationError.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /**
+         * Container similar to a vector, but with space for up to N elements allocated inline in the object.
+         *
+         * Only if more than N elements are stored, the elements are moved into a heap-allocated buffer. The inline
+         * storage is then re-used to store the pointer to and the capacity of the heap buffer.
+         *
+         * NOTE: Like std::vector, inserting elements invalidates iterators, but in contrast to std::vector, also moving
+         * the container invalidates all iterators if the elements are stored inline!
+         */
+        template <typename T, std::size_t N>
+        class SmallVector
+        {
+            static_assert(N > 0, "Need to store at least one element inline");
+
+            struct HeapBuffer
+            {
+                T* elements;
+                std::size_t capacity;
+            };
+
+            using InlineStorage = typename std::aligned_storage<std::max(sizeof(T) * N, sizeof(HeapBuffer)),
+                std::max(alignof(T), alignof(HeapBuffer))>::type;
+
+        public:
+            using value_type = T;
+            using reference = T&;
+            using const_reference = const T&;
+            using pointer = T*;
+            using const_pointer = const T*;
+            using iterator = T*;
+            using const_iterator = const T*;
+            using reverse_iterator = std::reverse_iterator<iterator>;
+            using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+            using difference_type = std::ptrdiff_t;
+            using size_type = std::size_t;
+
+            SmallVector() noexcept : numElements(0), isInline(true) {}
+
+            SmallVector(std::initializer_list<T> list) : SmallVector()
+            {
+                reserve(list.size());
+                for(const auto& elem : list)
+                    push_back(elem);
+            }
+
+            SmallVector(const SmallVector& other) : SmallVector()
+            {
+                reserve(other.size());
+                for(const auto& elem : other)
+                    push_back(elem);
+            }
+
+            SmallVector(SmallVector&& other) noexcept : SmallVector()
+            {
+                *this = std::move(other);
+            }
+
+            ~SmallVector() noexcept
+            {
+                clear();
+                releaseHeapBuffer();
+            }
+
+            SmallVector& operator=(const SmallVector& other)
+            {
+                if(&other != this)
+                {
+                    clear();
+                    reserve(other.size());
+                    for(const auto& elem : other)
+                        push_back(elem);
+                }
+                return *this;
+            }
+
+            SmallVector& operator=(SmallVector&& other) noexcept
+            {
+                if(&other == this)
+                    return *this;
+                clear();
+                releaseHeapBuffer();
+                if(other.isInline)
+                {
+                    for(auto& elem : other)
+                        new(data() + numElements++) T(std::move(elem));
+                    other.clear();
+                }
+                else
+                {
+                    // take over the heap buffer
+                    heap() = other.heap();
+                    isInline = false;
+                    numElements = other.numElements;
+                    other.isInline = true;
+                    other.numElements = 0;
+                }
+                return *this;
+            }
+
+            bool operator==(const SmallVector& other) const
+            {
+                return size() == other.size() && std::equal(begin(), end(), other.begin());
+            }
+
+            bool operator!=(const SmallVector& other) const
+            {
+                return !(*this == other);
+            }
+
+            T* data() noexcept
+            {
+                return isInline ? reinterpret_cast<T*>(&storage) : heap().elements;
+            }
+
+            const T* data() const noexcept
+            {
+                return isInline ? reinterpret_cast<const T*>(&storage) : heap().elements;
+            }
+
+            iterator begin() noexcept
+            {
+                return data();
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return data();
+            }
+
+            iterator end() noexcept
+            {
+                return data() + numElements;
+            }
+
+            const_iterator end() const noexcept
+            {
+                return data() + numElements;
+            }
+
+            reverse_iterator rbegin() noexcept
+            {
+                return reverse_iterator{end()};
+            }
+
+            const_reverse_iterator rbegin() const noexcept
+            {
+                return const_reverse_iterator{end()};
+            }
+
+            reverse_iterator rend() noexcept
+            {
+                return reverse_iterator{begin()};
+            }
+
+            const_reverse_iterator rend() const noexcept
+            {
+                return const_reverse_iterator{begin()};
+            }
+
+            bool empty() const noexcept
+            {
+                return numElements == 0;
+            }
+
+            size_type size() const noexcept
+            {
+                return numElements;
+            }
+
+            size_type capacity() const noexcept
+            {
+                return isInline ? N : heap().capacity;
+            }
+
+            /*
+             * Whether the elements are currently stored inline in this object
+             */
+            bool isSmall() const noexcept
+            {
+                return isInline;
+            }
+
+            reference operator[](size_type index) noexcept
+            {
+                return data()[index];
+            }
+
+            const_reference operator[](size_type index) const noexcept
+            {
+                return data()[index];
+            }
+
+            reference at(size_type index)
+            {
+                if(index >= numElements)
+                    throw CompilationError(CompilationStep::GENERAL, "Index out of bounds");
+                return data()[index];
+            }
+
+            const_reference at(size_type index) const
+            {
+                if(index >= numElements)
+                    throw CompilationError(CompilationStep::GENERAL, "Index out of bounds");
+                return data()[index];
+            }
+
+            reference front() noexcept
+            {
+                return *begin();
+            }
+
+            const_reference front() const noexcept
+            {
+                return *begin();
+            }
+
+            reference back() noexcept
+            {
+                return *(end() - 1);
+            }
+
+            const_reference back() const noexcept
+            {
+                return *(end() - 1);
+            }
+
+            void reserve(size_type newCapacity)
+            {
+                if(newCapacity <= capacity())
+                    return;
+                std::unique_ptr<T, void (*)(T*)> newElements(
+                    static_cast<T*>(::operator new(newCapacity * sizeof(T))), [](T* ptr) { ::operator delete(ptr); });
+                for(size_type i = 0; i < numElements; ++i)
+                {
+                    new(newElements.get() + i) T(std::move(data()[i]));
+                    data()[i].~T();
+                }
+                releaseHeapBuffer();
+                isInline = false;
+                heap() = HeapBuffer{newElements.release(), newCapacity};
+            }
+
+            template <typename... Args>
+            reference emplace_back(Args&&... args)
+            {
+                if(numElements == capacity())
+                {
+                    // the arguments might refer to an element of this container, so construct the element first
+                    T tmp(std::forward<Args>(args)...);
+                    reserve(numElements * 2);
+                    new(data() + numElements) T(std::move(tmp));
+                }
+                else
+                    new(data() + numElements) T(std::forward<Args>(args)...);
+                return data()[numElements++];
+            }
+
+            void push_back(const T& value)
+            {
+                emplace_back(value);
+            }
+
+            void push_back(T&& value)
+            {
+                emplace_back(std::move(value));
+            }
+
+            template <typename... Args>
+            iterator emplace(const_iterator pos, Args&&... args)
+            {
+                auto index = static_cast<size_type>(pos - begin());
+                emplace_back(std::forward<Args>(args)...);
+                std::rotate(begin() + index, end() - 1, end());
+                return begin() + index;
+            }
+
+            iterator insert(const_iterator pos, const T& value)
+            {
+                return emplace(pos, value);
+            }
+
+            iterator insert(const_iterator pos, T&& value)
+            {
+                return emplace(pos, std::move(value));
+            }
+
+            iterator erase(const_iterator pos)
+            {
+                auto index = static_cast<size_type>(pos - begin());
+                std::move(begin() + index + 1, end(), begin() + index);
+                pop_back();
+                return begin() + index;
+            }
+
+            void pop_back() noexcept
+            {
+                data()[--numElements].~T();
+            }
+
+            void clear() noexcept
+            {
+                while(numElements > 0)
+                    pop_back();
+            }
+
+        private:
+            InlineStorage storage;
+            uint32_t numElements;
+            bool isInline;
+
+            HeapBuffer& heap() noexcept
+            {
+                return *reinterpret_cast<HeapBuffer*>(&storage);
+            }
+
+            const HeapBuffer& heap() const noexcept
+            {
+                return *reinterpret_cast<const HeapBuffer*>(&storage);
+            }
+
+            void releaseHeapBuffer() noexcept
+            {
+                if(!isInline)
+                    ::operator delete(heap().elements);
+                isInline = true;
+            }
+        };
+    } // namespace tools
+} // namespace vc4c
@@ -0,0 +1,451 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "../helper.h"
+#include "../optimization/Optimizer.h"
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "tools.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+/*
+ * A single modification of the current configuration, returns whether the configuration was changed
+ */
+using Modification = std::function<bool(Configuration&)>;
+
+struct Trial
+{
+    bool successful = false;
+    uint32_t numCycles = 0;
+    // the contents of all buffer parameter after the execution
+    std::vector<std::vector<uint32_t>> buffers;
+    std::string error;
+};
+
+static bool isPassEnabled(const Configuration& config, const std::string& passName)
+{
+    if(config.additionalDisabledOptimizations.find(passName) != config.additionalDisabledOptimizations.end())
+        return false;
+    if(config.additionalEnabledOptimizations.find(passName) != config.additionalEnabledOptimizations.end())
+        return true;
+    auto levelPasses = optimizations::Optimizer::getPasses(config.optimizationLevel);
+    return levelPasses.find(passName) != levelPasses.end();
+}
+
+/*
+ * Returns the optimization passes enabled by the configuration, in execution order
+ */
+static std::vector<std::string> getEnabledPasses(const Configuration& config)
+{
+    std::vector<std::string> enabledPasses;
+    for(const auto& pass : optimizations::Optimizer::ALL_PASSES)
+    {
+        if(isPassEnabled(config, pass.parameterName))
+            enabledPasses.emplace_back(pass.parameterName);
+    }
+    return enabledPasses;
+}
+
+/*
+ * Returns the configuration with only the first numPasses of its enabled passes enabled
+ */
+static Configuration limitPasses(
+    const Configuration& config, const std::vector<std::string>& enabledPasses, std::size_t numPasses)
+{
+    auto limitedConfig = config;
+    for(auto i = numPasses; i < enabledPasses.size(); ++i)
+    {
+        limitedConfig.additionalEnabledOptimizations.erase(enabledPasses[i]);
+        limitedConfig.additionalDisabledOptimizations.emplace(enabledPasses[i]);
+    }
+    return limitedConfig;
+}
+
+/*
+ * Removes the explicitly enabled (disabled) passes which are already enabled (disabled) by the optimization level, to
+ * keep the generated configuration parameters minimal
+ */
+static void simplifyPassSelection(Configuration& config)
+{
+    auto levelPasses = optimizations::Optimizer::getPasses(config.optimizationLevel);
+    for(auto it = config.additionalEnabledOptimizations.begin(); it != config.additionalEnabledOptimizations.end();)
+    {
+        if(levelPasses.find(*it) != levelPasses.end())
+            it = config.additionalEnabledOptimizations.erase(it);
+        else
+            ++it;
+    }
+    for(auto it = config.additionalDisabledOptimizations.begin(); it != config.additionalDisabledOptimizations.end();)
+    {
+        if(levelPasses.find(*it) == levelPasses.end())
+            it = config.additionalDisabledOptimizations.erase(it);
+        else
+            ++it;
+    }
+}
+
+template <typename T>
+static void addThresholdModifications(
+    std::vector<Modification>& modifications, T OptimizationOptions::*option, std::initializer_list<T> values)
+{
+    for(T value : values)
+    {
+        modifications.emplace_back([option, value](Configuration& config) -> bool {
+            if(config.additionalOptions.*option == value)
+                return false;
+            config.additionalOptions.*option = value;
+            return true;
+        });
+    }
+}
+
+static std::vector<Modification> createModifications()
+{
+    std::vector<Modification> modifications;
+    // the optimization level selects the largest number of passes at once, so try it first
+    for(auto level :
+        {OptimizationLevel::BASIC, OptimizationLevel::MEDIUM, OptimizationLevel::FULL, OptimizationLevel::SIZE})
+    {
+        modifications.emplace_back([level](Configuration& config) -> bool {
+            if(config.optimizationLevel == level)
+                return false;
+            config.optimizationLevel = level;
+            return true;
+        });
+    }
+    for(const auto& pass : optimizations::Optimizer::ALL_PASSES)
+    {
+        auto passName = pass.parameterName;
+        modifications.emplace_back([passName](Configuration& config) -> bool {
+            if(isPassEnabled(config, passName))
+            {
+                config.additionalEnabledOptimizations.erase(passName);
+                config.additionalDisabledOptimizations.emplace(passName);
+            }
+            else
+            {
+                config.additionalDisabledOptimizations.erase(passName);
+                config.additionalEnabledOptimizations.emplace(passName);
+            }
+            return true;
+        });
+    }
+    addThresholdModifications(modifications, &OptimizationOptions::combineLoadThreshold, {2u, 4u, 6u, 8u, 12u, 16u});
+    // values below 5 insert a NOP for all conditional branches (see OptimizationOptions#accumulatorThreshold)
+    addThresholdModifications(modifications, &OptimizationOptions::accumulatorThreshold, {5u, 6u, 8u, 12u, 16u});
+    addThresholdModifications(modifications, &OptimizationOptions::replaceNopThreshold, {4u, 8u, 16u, 32u, 64u});
+    addThresholdModifications(modifications, &OptimizationOptions::moveConstantsDepth, {-1, 1, 2, 3});
+    return modifications;
+}
+
+static void prepareConfiguration(Configuration& config)
+{
+    // the kernel info is required by the emulator and the additional output files would be overwritten by every trial
+    config.writeKernelInfo = true;
+    config.moduleOutputFile.clear();
+    config.profileGenerateFile.clear();
+    config.statisticsOutputFile.clear();
+    config.traceOutputFile.clear();
+    config.intermediateOutputFile.clear();
+    config.memoryReportFile.clear();
+}
+
+static Trial runTrial(const std::string& source, const std::string& compilerOptions, const EmulationData& data,
+    const Configuration& config)
+{
+    Trial trial;
+    try
+    {
+        std::istringstream input(source);
+        auto binary = Compiler::compileToBinary(input, config, compilerOptions);
+        std::istringstream module(std::string(binary.begin(), binary.end()));
+
+        EmulationData emulation = data;
+        emulation.module = std::make_pair("", &module);
+        emulation.memoryDump.clear();
+        emulation.instrumentationDump.clear();
+        emulation.profileBlockPositions.clear();
+        emulation.profileDump.clear();
+        auto result = emulate(emulation);
+        if(!result.executionSuccessful)
+        {
+            trial.error = "Exceeded the maximum number of emulation cycles";
+            return trial;
+        }
+        for(auto& param : result.results)
+        {
+            if(param.second)
+                trial.buffers.emplace_back(std::move(param.second.value()));
+        }
+        trial.numCycles = result.numCycles;
+        trial.successful = true;
+    }
+    catch(const CompilationError& e)
+    {
+        trial.error = e.what();
+    }
+    return trial;
+}
+
+TuningResult tools::tuneConfiguration(const TuningData& data)
+{
+    if(data.maxTrials == 0)
+        throw CompilationError(CompilationStep::GENERAL, "Tuning requires at least a single trial");
+
+    TuningResult result;
+    result.config = data.baseConfig;
+    prepareConfiguration(result.config);
+    simplifyPassSelection(result.config);
+
+    const auto baseTrial = runTrial(data.source, data.compilerOptions, data.emulation, result.config);
+    ++result.numTrials;
+    if(!baseTrial.successful)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Failed to run kernel with the base configuration", baseTrial.error);
+    result.baseCycles = result.numCycles = baseTrial.numCycles;
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Tuning kernel '" << data.emulation.kernelName << "' starting with " << result.baseCycles << " cycles"
+            << logging::endl);
+
+    // Greedily apply every single modification to the best configuration found so far and keep it, if it improves the
+    // number of cycles. This is repeated until no modification improves the configuration or the trials are used up.
+    const auto modifications = createModifications();
+    bool improved = true;
+    while(improved && result.numTrials < data.maxTrials)
+    {
+        improved = false;
+        for(const auto& modification : modifications)
+        {
+            if(result.numTrials >= data.maxTrials)
+                break;
+            auto config = result.config;
+            if(!modification(config))
+                continue;
+            simplifyPassSelection(config);
+            auto trial = runTrial(data.source, data.compilerOptions, data.emulation, config);
+            ++result.numTrials;
+            if(!trial.successful)
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Rejecting configuration '" << to_string<std::string>(toConfigurationParameters(config), " ")
+                        << "': " << trial.error << logging::endl);
+                continue;
+            }
+            if(!(trial.buffers == baseTrial.buffers))
+            {
+                CPPLOG_LAZY(logging::Level::WARNING,
+                    log << "Rejecting configuration '" << to_string<std::string>(toConfigurationParameters(config), " ")
+                        << "' which produces results differing from the base configuration" << logging::endl);
+                continue;
+            }
+            if(trial.numCycles < result.numCycles)
+            {
+                CPPLOG_LAZY(logging::Level::INFO,
+                    log << "Improved from " << result.numCycles << " to " << trial.numCycles
+                        << " cycles with configuration '"
+                        << to_string<std::string>(toConfigurationParameters(config), " ") << "'" << logging::endl);
+                result.config = std::move(config);
+                result.numCycles = trial.numCycles;
+                improved = true;
+            }
+        }
+    }
+
+    result.parameters = toConfigurationParameters(result.config);
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Tuned kernel '" << data.emulation.kernelName << "' from " << result.baseCycles << " to "
+            << result.numCycles << " cycles in " << result.numTrials << " trials" << logging::endl);
+    return result;
+}
+
+/*
+ * Returns whether the trial of the candidate configuration differs from the trial of the reference configuration
+ */
+static bool isMiscompiled(const Trial& reference, const Trial& trial)
+{
+    return !trial.successful || !(trial.buffers == reference.buffers);
+}
+
+DifferentialResult tools::checkOptimizations(const DifferentialData& data)
+{
+    auto candidate = data.config;
+    prepareConfiguration(candidate);
+    auto reference = candidate;
+    reference.optimizationLevel = OptimizationLevel::NONE;
+    reference.additionalEnabledOptimizations.clear();
+
+    DifferentialResult result;
+    result.parameters = toConfigurationParameters(candidate);
+    const auto referenceTrial = runTrial(data.source, data.compilerOptions, data.emulation, reference);
+    ++result.numTrials;
+    if(!referenceTrial.successful)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Failed to run kernel with the reference configuration", referenceTrial.error);
+
+    const auto candidateTrial = runTrial(data.source, data.compilerOptions, data.emulation, candidate);
+    ++result.numTrials;
+    if(!isMiscompiled(referenceTrial, candidateTrial))
+        return result;
+    result.isMiscompiled = true;
+    result.error = candidateTrial.successful ? "Results differ from the reference configuration" : candidateTrial.error;
+    CPPLOG_LAZY(logging::Level::WARNING,
+        log << "Kernel '" << data.emulation.kernelName << "' is miscompiled with configuration '"
+            << to_string<std::string>(result.parameters, " ") << "': " << result.error << logging::endl);
+
+    const auto enabledPasses = getEnabledPasses(candidate);
+    // Runs the candidate configuration with only the first numPasses enabled passes and returns whether the kernel is
+    // still miscompiled
+    auto isMiscompiledWithPasses = [&](std::size_t numPasses) -> bool {
+        auto config = limitPasses(candidate, enabledPasses, numPasses);
+        ++result.numTrials;
+        return isMiscompiled(referenceTrial, runTrial(data.source, data.compilerOptions, data.emulation, config));
+    };
+
+    if(isMiscompiledWithPasses(0))
+    {
+        CPPLOG_LAZY(logging::Level::WARNING,
+            log << "Miscompilation also occurs with all optimization passes disabled" << logging::endl);
+        return result;
+    }
+    // bisect the passes, the kernel is known to be correct with the first lower and miscompiled with the first upper
+    // passes enabled
+    std::size_t lower = 0;
+    std::size_t upper = enabledPasses.size();
+    while(upper - lower > 1)
+    {
+        auto middle = lower + (upper - lower) / 2;
+        if(isMiscompiledWithPasses(middle))
+            upper = middle;
+        else
+            lower = middle;
+    }
+    result.failingPass = enabledPasses[lower];
+    CPPLOG_LAZY(logging::Level::WARNING,
+        log << "Miscompilation is caused by optimization pass '" << result.failingPass << "' (bisected in "
+            << result.numTrials << " trials)" << logging::endl);
+    return result;
+}
+
+// the statistics are written for every profiled step and read back afterwards
+static const std::string PASS_STATISTICS_FILE = "./pass_profile_statistics.json";
+
+/*
+ * Reads the value of the given key for the given kernel from the statistics written by the compiler (see
+ * Configuration#statisticsOutputFile)
+ */
+static double readStatistic(const std::string& statistics, const std::string& kernelName, const std::string& key)
+{
+    auto pos = statistics.find("\"" + kernelName + "\": {");
+    if(pos != std::string::npos)
+        pos = statistics.find("\"" + key + "\": ", pos);
+    if(pos == std::string::npos)
+        throw CompilationError(CompilationStep::GENERAL, "Missing statistic for kernel " + kernelName, key);
+    return std::stod(statistics.substr(pos + key.size() + 4));
+}
+
+PassProfileResult tools::profilePasses(const PassProfileData& data)
+{
+    auto baseConfig = data.config;
+    prepareConfiguration(baseConfig);
+    const auto enabledPasses = getEnabledPasses(baseConfig);
+
+    PassProfileResult result;
+    auto runStep = [&](std::size_t numPasses) -> PassProfileStep {
+        auto config = limitPasses(baseConfig, enabledPasses, numPasses);
+        config.statisticsOutputFile = PASS_STATISTICS_FILE;
+        PassProfileStep step;
+        step.numPasses = numPasses;
+        step.pass = numPasses == 0 ? "" : enabledPasses[numPasses - 1];
+        if(!data.intermediateDirectory.empty())
+        {
+            std::stringstream fileName;
+            fileName << data.intermediateDirectory << '/' << std::setfill('0') << std::setw(2) << numPasses << '_'
+                     << (step.pass.empty() ? "none" : step.pass) << ".ir";
+            step.intermediateFile = config.intermediateOutputFile = fileName.str();
+        }
+
+        auto trial = runTrial(data.source, data.compilerOptions, data.emulation, config);
+        ++result.numTrials;
+        std::string statistics;
+        {
+            std::ifstream in(PASS_STATISTICS_FILE);
+            statistics.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        std::remove(PASS_STATISTICS_FILE.data());
+        if(!trial.successful)
+            throw CompilationError(CompilationStep::GENERAL,
+                "Failed to run kernel with " + std::to_string(numPasses) + " optimization passes enabled", trial.error);
+        step.numInstructions =
+            static_cast<std::size_t>(readStatistic(statistics, data.emulation.kernelName, "instructions"));
+        step.estimatedCycles = readStatistic(statistics, data.emulation.kernelName, "estimatedCycles");
+        step.numCycles = trial.numCycles;
+        CPPLOG_LAZY(logging::Level::INFO,
+            log << "After pass '" << (step.pass.empty() ? "(none)" : step.pass) << "': " << step.numInstructions
+                << " instructions, " << step.estimatedCycles << " estimated cycles, " << step.numCycles
+                << " emulated cycles" << logging::endl);
+        return step;
+    };
+
+    if(!data.bisect)
+    {
+        for(std::size_t numPasses = 0; numPasses <= enabledPasses.size(); ++numPasses)
+            result.steps.emplace_back(runStep(numPasses));
+        for(std::size_t i = 1; i < result.steps.size() && result.slowdownPass.empty(); ++i)
+        {
+            if(result.steps[i].numCycles > result.steps[i - 1].numCycles * (1.0 + data.slowdownThreshold))
+                result.slowdownPass = result.steps[i].pass;
+        }
+        return result;
+    }
+
+    result.steps.emplace_back(runStep(0));
+    const double maxCycles =
+        (data.referenceCycles != 0 ? data.referenceCycles : result.steps.front().numCycles) *
+        (1.0 + data.slowdownThreshold);
+    if(result.steps.front().numCycles > maxCycles)
+    {
+        CPPLOG_LAZY(logging::Level::WARNING,
+            log << "Slowdown also occurs with all optimization passes disabled" << logging::endl);
+        return result;
+    }
+    if(enabledPasses.empty())
+        return result;
+    result.steps.emplace_back(runStep(enabledPasses.size()));
+    if(result.steps.back().numCycles <= maxCycles)
+        return result;
+    // bisect the passes, the kernel is known to be fast enough with the first lower and too slow with the first upper
+    // passes enabled
+    std::size_t lower = 0;
+    std::size_t upper = enabledPasses.size();
+    while(upper - lower > 1)
+    {
+        auto middle = lower + (upper - lower) / 2;
+        result.steps.emplace_back(runStep(middle));
+        if(result.steps.back().numCycles > maxCycles)
+            upper = middle;
+        else
+            lower = middle;
+    }
+    result.slowdownPass = enabledPasses[lower];
+    std::sort(result.steps.begin(), result.steps.end(), [](const PassProfileStep& one, const PassProfileStep& other) {
+        return one.numPasses < other.numPasses;
+    });
+    CPPLOG_LAZY(logging::Level::WARNING,
+        log << "Slowdown is caused by optimization pass '" << result.slowdownPass << "' (bisected in "
+            << result.numTrials << " trials)" << logging::endl);
+    return result;
+}
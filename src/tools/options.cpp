@@ -119,6 +119,11 @@ bool tools::parseConfigurationParameter(Configuration& config, const std::string
         config.optimizationLevel = OptimizationLevel::FULL;
         return true;
     }
+    if(arg == "-Os")
+    {
+        config.optimizationLevel = OptimizationLevel::SIZE;
+        return true;
+    }
     if(arg == "--use-opt")
     {
         config.useOpt = true;
@@ -129,6 +134,125 @@ bool tools::parseConfigurationParameter(Configuration& config, const std::string
         config.useOpt = false;
         return true;
     }
+    if(arg == "--spirv-opt")
+    {
+        config.optimizeSPIRV = true;
+        return true;
+    }
+    if(arg.find("--target-") == 0 && arg.find('=') != std::string::npos)
+    {
+        // target profile parameter
+        const auto paramStart = std::string("--target-").size();
+        const std::string paramName = arg.substr(paramStart, arg.find('=') - paramStart);
+        unsigned value;
+        try
+        {
+            value = static_cast<unsigned>(std::stoul(arg.substr(arg.find('=') + 1)));
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Error converting target profile parameter for '" << paramName << ": " << e.what()
+                      << std::endl;
+            return false;
+        }
+        auto& target = config.target;
+        if(paramName == "qpus")
+        {
+            if(value == 0 || value > NUM_QPUS)
+            {
+                std::cerr << "The number of QPUs needs to be between 1 and " << NUM_QPUS << ", got: " << value
+                          << std::endl;
+                return false;
+            }
+            target.numQPUs = value;
+        }
+        else if(paramName == "vpm-size")
+            target.availableVPMSize = value;
+        else if(paramName == "icache-size")
+            target.instructionCacheSize = value;
+        else if(paramName == "tmu-cache-size")
+            target.tmuCacheSize = value;
+        else if(paramName == "tmu-latency")
+            target.tmuLoadLatency = value;
+        else if(paramName == "dma-load-latency")
+            target.vpmDMALoadLatency = value;
+        else if(paramName == "dma-store-latency")
+            target.vpmDMAStoreLatency = value;
+        else if(paramName == "mutex-latency")
+            target.mutexAcquireLatency = value;
+        else
+        {
+            std::cerr << "Cannot set unknown target profile parameter: " << paramName << " to " << value << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if(arg.find("--cache-dir=") == 0)
+    {
+        config.cacheDirectory = arg.substr(std::string("--cache-dir=").size());
+        return true;
+    }
+    if(arg.find("--cache-size=") == 0)
+    {
+        try
+        {
+            config.maxCacheSize = std::stoul(arg.substr(std::string("--cache-size=").size()));
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Error converting compilation cache size: " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if(arg.find("--max-memory=") == 0)
+    {
+        try
+        {
+            config.maxCompilationMemory = std::stoul(arg.substr(std::string("--max-memory=").size()));
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Error converting maximum compilation memory: " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if(arg.find("--write-module=") == 0)
+    {
+        config.moduleOutputFile = arg.substr(std::string("--write-module=").size());
+        return true;
+    }
+    if(arg.find("--profile-generate=") == 0)
+    {
+        config.profileGenerateFile = arg.substr(std::string("--profile-generate=").size());
+        return true;
+    }
+    if(arg.find("--write-statistics=") == 0)
+    {
+        config.statisticsOutputFile = arg.substr(std::string("--write-statistics=").size());
+        return true;
+    }
+    if(arg.find("--trace=") == 0)
+    {
+        config.traceOutputFile = arg.substr(std::string("--trace=").size());
+        return true;
+    }
+    if(arg.find("--write-ir=") == 0)
+    {
+        config.intermediateOutputFile = arg.substr(std::string("--write-ir=").size());
+        return true;
+    }
+    if(arg.find("--memory-report=") == 0)
+    {
+        config.memoryReportFile = arg.substr(std::string("--memory-report=").size());
+        return true;
+    }
+    if(arg.find("--profile-use=") == 0)
+    {
+        config.profileUseFile = arg.substr(std::string("--profile-use=").size());
+        return true;
+    }
     if(arg == "--verification-error")
     {
         config.stopWhenVerificationFailed = true;
@@ -139,6 +263,195 @@ bool tools::parseConfigurationParameter(Configuration& config, const std::string
         config.stopWhenVerificationFailed = false;
         return true;
     }
+    if(arg == "--sectioned-binary")
+    {
+        config.sectionedBinary = true;
+        return true;
+    }
+    if(arg == "--coarsen-work-items")
+    {
+        config.coarsenWorkItems = true;
+        return true;
+    }
+    if(arg == "--precompute-uniforms")
+    {
+        config.precomputeUniformValues = true;
+        return true;
+    }
+    if(arg == "--dynamic-work-distribution")
+    {
+        config.distributeWorkItemsDynamically = true;
+        return true;
+    }
+    if(arg == "--threaded")
+    {
+        config.generateThreadedCode = true;
+        return true;
+    }
+    if(arg.find("--register-allocator=") == 0)
+    {
+        const std::string allocator = arg.substr(std::string("--register-allocator=").size());
+        if(allocator == "greedy")
+            config.registerAllocator = RegisterAllocator::GREEDY;
+        else if(allocator == "coalescing")
+            config.registerAllocator = RegisterAllocator::COALESCING;
+        else if(allocator == "linear-scan")
+            config.registerAllocator = RegisterAllocator::LINEAR_SCAN;
+        else
+        {
+            std::cerr << "Unknown register allocator, expected 'greedy', 'coalescing' or 'linear-scan': " << allocator
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if(arg.find("--specialize=") == 0)
+    {
+        // --specialize=<kernel>:<variant>:<index>=<value>[,<index>=<value>...]
+        const std::string spec = arg.substr(std::string("--specialize=").size());
+        const auto firstColon = spec.find(':');
+        const auto secondColon = firstColon == std::string::npos ? firstColon : spec.find(':', firstColon + 1);
+        if(secondColon == std::string::npos)
+        {
+            std::cerr << "Invalid kernel specialization, expected <kernel>:<variant>:<index>=<value>,...: " << spec
+                      << std::endl;
+            return false;
+        }
+        KernelSpecialization specialization;
+        specialization.kernelName = spec.substr(0, firstColon);
+        specialization.variantName = spec.substr(firstColon + 1, secondColon - firstColon - 1);
+        std::size_t start = secondColon + 1;
+        while(start < spec.size())
+        {
+            auto end = spec.find(',', start);
+            if(end == std::string::npos)
+                end = spec.size();
+            const std::string binding = spec.substr(start, end - start);
+            try
+            {
+                const auto equals = binding.find('=');
+                if(equals == std::string::npos)
+                    throw std::invalid_argument("missing value");
+                const auto index = static_cast<unsigned>(std::stoul(binding.substr(0, equals)));
+                // the value is the bit-pattern as passed by the host, so allow negative and hexadecimal values
+                const auto value = static_cast<uint32_t>(std::stoll(binding.substr(equals + 1), nullptr, 0));
+                specialization.parameterValues[index] = value;
+            }
+            catch(std::exception& e)
+            {
+                std::cerr << "Error converting kernel specialization parameter '" << binding << "': " << e.what()
+                          << std::endl;
+                return false;
+            }
+            start = end + 1;
+        }
+        config.kernelSpecializations.emplace_back(std::move(specialization));
+        return true;
+    }
+    if(arg.find("--fuse=") == 0)
+    {
+        // --fuse=<fused>:<kernel>[=<index>,<index>...][+<kernel>[=<index>,<index>...]...]
+        const std::string spec = arg.substr(std::string("--fuse=").size());
+        const auto colon = spec.find(':');
+        if(colon == std::string::npos || colon + 1 >= spec.size())
+        {
+            std::cerr << "Invalid kernel fusion, expected <fused>:<kernel>[=<index>,...][+<kernel>[=<index>,...]...]: "
+                      << spec << std::endl;
+            return false;
+        }
+        KernelFusion fusion;
+        fusion.fusedName = spec.substr(0, colon);
+        std::size_t start = colon + 1;
+        while(start < spec.size())
+        {
+            auto end = spec.find('+', start);
+            if(end == std::string::npos)
+                end = spec.size();
+            const std::string kernel = spec.substr(start, end - start);
+            const auto equals = kernel.find('=');
+            std::vector<unsigned> indices;
+            std::size_t indexStart = equals == std::string::npos ? kernel.size() : equals + 1;
+            while(indexStart < kernel.size())
+            {
+                auto indexEnd = kernel.find(',', indexStart);
+                if(indexEnd == std::string::npos)
+                    indexEnd = kernel.size();
+                try
+                {
+                    indices.push_back(
+                        static_cast<unsigned>(std::stoul(kernel.substr(indexStart, indexEnd - indexStart))));
+                }
+                catch(std::exception& e)
+                {
+                    std::cerr << "Error converting kernel fusion parameter index '" << kernel << "': " << e.what()
+                              << std::endl;
+                    return false;
+                }
+                indexStart = indexEnd + 1;
+            }
+            fusion.kernels.emplace_back(kernel.substr(0, equals), std::move(indices));
+            start = end + 1;
+        }
+        config.kernelFusions.emplace_back(std::move(fusion));
+        return true;
+    }
+    if(arg.find("--kernel-version=") == 0)
+    {
+        // --kernel-version=<kernel>:<version>:<assumption>[,<assumption>...]
+        const std::string spec = arg.substr(std::string("--kernel-version=").size());
+        const auto firstColon = spec.find(':');
+        const auto secondColon = firstColon == std::string::npos ? firstColon : spec.find(':', firstColon + 1);
+        if(secondColon == std::string::npos)
+        {
+            std::cerr << "Invalid kernel version, expected <kernel>:<version>:<assumption>,...: " << spec << std::endl;
+            return false;
+        }
+        KernelVersion version;
+        version.kernelName = spec.substr(0, firstColon);
+        version.versionName = spec.substr(firstColon + 1, secondColon - firstColon - 1);
+        std::size_t start = secondColon + 1;
+        while(start < spec.size())
+        {
+            auto end = spec.find(',', start);
+            if(end == std::string::npos)
+                end = spec.size();
+            const std::string assumption = spec.substr(start, end - start);
+            try
+            {
+                if(assumption == "no-alias")
+                    version.noAliasing = true;
+                else if(assumption.find("align=") == 0)
+                    version.pointerAlignment =
+                        static_cast<unsigned>(std::stoul(assumption.substr(std::string("align=").size())));
+                else if(assumption.find("work-group-size=") == 0)
+                {
+                    // <x>[x<y>[x<z>]]
+                    std::size_t sizeStart = std::string("work-group-size=").size();
+                    for(auto& size : version.workGroupSizes)
+                    {
+                        if(sizeStart >= assumption.size())
+                            break;
+                        auto sizeEnd = assumption.find('x', sizeStart);
+                        if(sizeEnd == std::string::npos)
+                            sizeEnd = assumption.size();
+                        size = static_cast<uint32_t>(std::stoul(assumption.substr(sizeStart, sizeEnd - sizeStart)));
+                        sizeStart = sizeEnd + 1;
+                    }
+                }
+                else
+                    throw std::invalid_argument("unknown assumption");
+            }
+            catch(std::exception& e)
+            {
+                std::cerr << "Error converting kernel version assumption '" << assumption << "': " << e.what()
+                          << std::endl;
+                return false;
+            }
+            start = end + 1;
+        }
+        config.kernelVersions.emplace_back(std::move(version));
+        return true;
+    }
 
     std::string passName;
     if(arg.find("--fno-") == 0)
@@ -187,6 +500,18 @@ bool tools::parseConfigurationParameter(Configuration& config, const std::string
                 config.additionalOptions.maxOptimizationIterations = static_cast<unsigned>(intValue);
             else if(paramName == "common-subexpression-threshold")
                 config.additionalOptions.maxCommonExpressionDinstance = static_cast<unsigned>(intValue);
+            else if(paramName == "unroll-threshold")
+                config.additionalOptions.maxUnrolledLoopSize = static_cast<unsigned>(intValue);
+            else if(paramName == "tail-duplication-threshold")
+                config.additionalOptions.maxTailDuplicationSize = static_cast<unsigned>(intValue);
+            else if(paramName == "constant-pool-threshold")
+                config.additionalOptions.constantPoolThreshold = static_cast<unsigned>(intValue);
+            else if(paramName == "loop-alignment")
+                config.additionalOptions.loopAlignment = static_cast<unsigned>(intValue);
+            else if(paramName == "pass-time-budget")
+                config.additionalOptions.passTimeBudget = static_cast<unsigned>(intValue);
+            else if(paramName == "kernel-time-budget")
+                config.additionalOptions.kernelTimeBudget = static_cast<unsigned>(intValue);
             else
             {
                 std::cerr << "Cannot set unknown optimization parameter: " << paramName << " to " << value << std::endl;
@@ -205,3 +530,64 @@ bool tools::parseConfigurationParameter(Configuration& config, const std::string
     }
     return false;
 }
+
+std::vector<std::string> tools::toConfigurationParameters(const Configuration& config)
+{
+    const Configuration defaultConfig{};
+    std::vector<std::string> params;
+    if(config.optimizationLevel != defaultConfig.optimizationLevel)
+    {
+        switch(config.optimizationLevel)
+        {
+        case OptimizationLevel::NONE:
+            params.emplace_back("-O0");
+            break;
+        case OptimizationLevel::BASIC:
+            params.emplace_back("-O1");
+            break;
+        case OptimizationLevel::MEDIUM:
+            params.emplace_back("-O2");
+            break;
+        case OptimizationLevel::FULL:
+            params.emplace_back("-O3");
+            break;
+        case OptimizationLevel::SIZE:
+            params.emplace_back("-Os");
+            break;
+        }
+    }
+
+    // sort the passes to generate the same parameters for the same configuration
+    const std::set<std::string> enabledPasses(
+        config.additionalEnabledOptimizations.begin(), config.additionalEnabledOptimizations.end());
+    for(const auto& pass : enabledPasses)
+        params.emplace_back("--f" + pass);
+    const std::set<std::string> disabledPasses(
+        config.additionalDisabledOptimizations.begin(), config.additionalDisabledOptimizations.end());
+    for(const auto& pass : disabledPasses)
+        params.emplace_back("--fno-" + pass);
+
+    auto addParameter = [&params](const std::string& name, int64_t value, int64_t defaultValue) {
+        if(value != defaultValue)
+            params.emplace_back("--f" + name + "=" + std::to_string(value));
+    };
+    const auto& options = config.additionalOptions;
+    const auto& defaultOptions = defaultConfig.additionalOptions;
+    addParameter("combine-load-threshold", options.combineLoadThreshold, defaultOptions.combineLoadThreshold);
+    addParameter("accumulator-threshold", options.accumulatorThreshold, defaultOptions.accumulatorThreshold);
+    addParameter("replace-nop-threshold", options.replaceNopThreshold, defaultOptions.replaceNopThreshold);
+    addParameter(
+        "register-resolver-rounds", options.registerResolverMaxRounds, defaultOptions.registerResolverMaxRounds);
+    addParameter("move-constants-depth", options.moveConstantsDepth, defaultOptions.moveConstantsDepth);
+    addParameter(
+        "optimization-iterations", options.maxOptimizationIterations, defaultOptions.maxOptimizationIterations);
+    addParameter("common-subexpression-threshold", options.maxCommonExpressionDinstance,
+        defaultOptions.maxCommonExpressionDinstance);
+    addParameter("unroll-threshold", options.maxUnrolledLoopSize, defaultOptions.maxUnrolledLoopSize);
+    addParameter("tail-duplication-threshold", options.maxTailDuplicationSize, defaultOptions.maxTailDuplicationSize);
+    addParameter("constant-pool-threshold", options.constantPoolThreshold, defaultOptions.constantPoolThreshold);
+    addParameter("loop-alignment", options.loopAlignment, defaultOptions.loopAlignment);
+    addParameter("pass-time-budget", options.passTimeBudget, defaultOptions.passTimeBudget);
+    addParameter("kernel-time-budget", options.kernelTimeBudget, defaultOptions.kernelTimeBudget);
+    return params;
+}
@@ -390,17 +390,25 @@ static std::vector<Entry> allKernels =
 
 };
 
-RegressionTest::RegressionTest(const vc4c::Configuration& config, const vc4c::Frontend frontend, bool onlyRegressions, bool onlyFast) : config(config)
+RegressionTest::RegressionTest(const vc4c::Configuration& config, const vc4c::Frontend frontend, bool onlyRegressions, bool onlyFast,
+    unsigned shardIndex, unsigned numShards) : config(config)
 {
+    unsigned index = 0;
     for(const auto& tuple : allKernels)
     {
     	if(std::get<0>(tuple) == PASSED && (!onlyFast || std::get<1>(tuple) == FAST))
     	{
-    		TEST_ADD_THREE_ARGUMENTS(RegressionTest::testRegression, static_cast<std::string>(std::get<2>(tuple)), static_cast<std::string>(std::get<3>(tuple)), static_cast<vc4c::Frontend>(frontend));
+    		if(index++ % numShards == shardIndex)
+    		{
+    			TEST_ADD_THREE_ARGUMENTS(RegressionTest::testRegression, static_cast<std::string>(std::get<2>(tuple)), static_cast<std::string>(std::get<3>(tuple)), static_cast<vc4c::Frontend>(frontend));
+    		}
     	}
     	else if(!onlyRegressions && std::get<0>(tuple) == PENDING_BOTH && std::get<1>(tuple) == FAST)
     	{
-    		TEST_ADD_THREE_ARGUMENTS(RegressionTest::testPending, static_cast<std::string>(std::get<2>(tuple)), static_cast<std::string>(std::get<3>(tuple)), static_cast<vc4c::Frontend>(frontend));
+    		if(index++ % numShards == shardIndex)
+    		{
+    			TEST_ADD_THREE_ARGUMENTS(RegressionTest::testPending, static_cast<std::string>(std::get<2>(tuple)), static_cast<std::string>(std::get<3>(tuple)), static_cast<vc4c::Frontend>(frontend));
+    		}
     	}
     	else if(!onlyRegressions && std::get<0>(tuple) == PENDING_BOTH && !onlyFast && std::get<1>(tuple) == SLOW)
     	{
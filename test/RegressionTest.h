@@ -13,7 +13,12 @@
 class RegressionTest : public Test::Suite
 {
 public:
-    RegressionTest(const vc4c::Configuration& config, const vc4c::Frontend frontend, bool onlyRegressions = false, bool onlyFast = false);
+    /*
+     * Only the test-cases with an index modulo numShards equal to shardIndex are added, which allows to split the
+     * test-cases across multiple processes
+     */
+    RegressionTest(const vc4c::Configuration& config, const vc4c::Frontend frontend, bool onlyRegressions = false, bool onlyFast = false,
+        unsigned shardIndex = 0, unsigned numShards = 1);
     ~RegressionTest() override;
     
     void testRegression(std::string clFile, std::string options, vc4c::Frontend frontend);
@@ -6,8 +6,21 @@
 
 #include "TestCustomContainers.h"
 
+#include "tools/DynamicBitSet.h"
+#include "tools/FlatHashTable.h"
+#include "tools/IdMap.h"
+#include "tools/IndexTable.h"
+#include "tools/IntrusiveList.h"
+#include "tools/MemoryPool.h"
 #include "tools/SmallMap.h"
 #include "tools/SmallSet.h"
+#include "tools/SmallVector.h"
+
+#include <array>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 using namespace vc4c::tools;
 
@@ -18,6 +31,14 @@ TestCustomContainers::TestCustomContainers()
 
     TEST_ADD(TestCustomContainers::testFixedSortedPointerSet);
     TEST_ADD(TestCustomContainers::testSmallSortedPointerSet);
+
+    TEST_ADD(TestCustomContainers::testMemoryPool);
+    TEST_ADD(TestCustomContainers::testIntrusiveList);
+    TEST_ADD(TestCustomContainers::testSmallVector);
+    TEST_ADD(TestCustomContainers::testFlatHashContainers);
+    TEST_ADD(TestCustomContainers::testSortedVectorContainers);
+    TEST_ADD(TestCustomContainers::testDynamicBitSet);
+    TEST_ADD(TestCustomContainers::testIdMap);
 }
 
 TestCustomContainers::~TestCustomContainers() = default;
@@ -373,6 +394,114 @@ void TestCustomContainers::testSmallSortedPointerSet()
     TEST_ASSERT(hasSameSetContent(reference, set0));
 }
 
+struct PooledTestObject : public PooledObject<>
+{
+    explicit PooledTestObject(std::size_t val) : value(val) {}
+    virtual ~PooledTestObject() noexcept = default;
+
+    std::size_t value;
+};
+
+struct LargePooledTestObject : public PooledTestObject
+{
+    explicit LargePooledTestObject(std::size_t val) : PooledTestObject(val), padding{} {}
+
+    std::array<char, 1024> padding;
+};
+
+void TestCustomContainers::testMemoryPool()
+{
+    std::vector<std::unique_ptr<PooledTestObject>> objects;
+    for(std::size_t i = 0; i < 1000; ++i)
+    {
+        if(i % 10 == 0)
+            objects.emplace_back(new LargePooledTestObject(i));
+        else
+            objects.emplace_back(new PooledTestObject(i));
+    }
+    for(std::size_t i = 0; i < objects.size(); ++i)
+        TEST_ASSERT_EQUALS(i, objects[i]->value);
+
+    auto stats = getMemoryPoolStatistics();
+    TEST_ASSERT(stats.numSlabs > 0);
+    if(stats.hasBlockStatistics)
+        TEST_ASSERT(stats.numLiveBlocks >= 900);
+
+    // freed blocks are reused by the next allocations
+    objects.resize(500);
+    auto numReused = stats.numReusedBlocks;
+    for(std::size_t i = 500; i < 1000; ++i)
+        objects.emplace_back(new PooledTestObject(i));
+    stats = getMemoryPoolStatistics();
+    if(stats.hasBlockStatistics)
+        TEST_ASSERT(stats.numReusedBlocks >= numReused + 450);
+    for(std::size_t i = 0; i < objects.size(); ++i)
+        TEST_ASSERT_EQUALS(i, objects[i]->value);
+
+    // slabs are released once all their blocks are freed again
+    objects.clear();
+    releaseUnusedPoolMemory();
+    auto numSlabsBefore = getMemoryPoolStatistics().numSlabs;
+    for(std::size_t i = 0; i < 100000; ++i)
+        objects.emplace_back(new PooledTestObject(i));
+    TEST_ASSERT(getMemoryPoolStatistics().numSlabs > numSlabsBefore);
+    objects.clear();
+    TEST_ASSERT(releaseUnusedPoolMemory() > 0);
+    TEST_ASSERT(getMemoryPoolStatistics().numSlabs <= numSlabsBefore);
+
+    std::set<std::size_t, std::less<std::size_t>, PoolAllocator<std::size_t>> set;
+    for(std::size_t i = 0; i < 1000; ++i)
+        TEST_ASSERT(set.emplace(i).second);
+    TEST_ASSERT_EQUALS(1000u, set.size());
+    TEST_ASSERT_EQUALS(0u, *set.begin());
+    TEST_ASSERT_EQUALS(999u, *set.rbegin());
+}
+
+void TestCustomContainers::testIntrusiveList()
+{
+    IntrusiveList<std::unique_ptr<std::size_t>> list;
+    TEST_ASSERT(list.empty());
+    TEST_ASSERT(list.begin() == list.end());
+
+    for(std::size_t i = 0; i < 8; ++i)
+        list.emplace_back(new std::size_t(i));
+    TEST_ASSERT_EQUALS(8u, list.size());
+    TEST_ASSERT_EQUALS(0u, *list.front());
+    TEST_ASSERT_EQUALS(7u, *list.back());
+
+    auto first = list.begin();
+    auto second = std::next(first, 4);
+    TEST_ASSERT(list.isBefore(first, second));
+    TEST_ASSERT(!list.isBefore(second, first));
+    TEST_ASSERT(!list.isBefore(second, second));
+    TEST_ASSERT(list.isBefore(second, list.end()));
+    TEST_ASSERT(!list.isBefore(list.end(), first));
+
+    // repeatedly inserting at the same position exhausts the gap between the ordinals and requires renumbering
+    auto pos = second;
+    for(std::size_t i = 0; i < 32; ++i)
+        pos = list.emplace(pos, new std::size_t(100 + i));
+    TEST_ASSERT_EQUALS(40u, list.size());
+    TEST_ASSERT(list.isBefore(first, pos));
+    TEST_ASSERT(list.isBefore(pos, second));
+    TEST_ASSERT(list.isBefore(std::next(pos), second));
+    TEST_ASSERT(!list.isBefore(std::next(pos), pos));
+
+    // iterators to the other elements stay valid when erasing elements
+    auto it = list.erase(pos);
+    TEST_ASSERT_EQUALS(130u, **it);
+    TEST_ASSERT_EQUALS(4u, **second);
+    while(it != second)
+        it = list.erase(it);
+    TEST_ASSERT_EQUALS(8u, list.size());
+    std::size_t expected = 7;
+    for(auto revIt = list.rbegin(); revIt != list.rend(); ++revIt, --expected)
+        TEST_ASSERT_EQUALS(expected, **revIt);
+
+    list.clear();
+    TEST_ASSERT(list.empty());
+}
+
 template <typename T, typename U>
 static bool hasSameMapContent(const T& first, const U& second)
 {
@@ -454,3 +583,221 @@ static bool hasSameSetContent(const T& first, const U& second)
         return false;
     return true;
 }
+
+void TestCustomContainers::testSmallVector()
+{
+    SmallVector<std::string, 2> vec;
+    TEST_ASSERT(vec.empty());
+    TEST_ASSERT(vec.isSmall());
+    TEST_ASSERT_EQUALS(2u, vec.capacity());
+
+    vec.emplace_back("foo");
+    vec.push_back("bar");
+    TEST_ASSERT_EQUALS(2u, vec.size());
+    TEST_ASSERT(vec.isSmall());
+    // the elements are stored in the object itself
+    auto objectStart = reinterpret_cast<const char*>(&vec);
+    auto elementStart = reinterpret_cast<const char*>(vec.data());
+    TEST_ASSERT(elementStart >= objectStart && elementStart < objectStart + sizeof(vec));
+
+    // inserting more elements than fit inline moves them to the heap
+    vec.insert(vec.begin() + 1, "baz");
+    vec.push_back(vec.front());
+    TEST_ASSERT(!vec.isSmall());
+    TEST_ASSERT_EQUALS(4u, vec.size());
+    TEST_ASSERT_EQUALS(std::string("foo"), vec[0]);
+    TEST_ASSERT_EQUALS(std::string("baz"), vec[1]);
+    TEST_ASSERT_EQUALS(std::string("bar"), vec[2]);
+    TEST_ASSERT_EQUALS(std::string("foo"), vec.back());
+
+    auto copy = vec;
+    TEST_ASSERT(copy == vec);
+    auto moved = std::move(copy);
+    TEST_ASSERT(moved == vec);
+    TEST_ASSERT(copy.empty());
+
+    moved.erase(moved.begin());
+    TEST_ASSERT_EQUALS(3u, moved.size());
+    TEST_ASSERT_EQUALS(std::string("baz"), moved.front());
+    TEST_ASSERT(moved != vec);
+
+    SmallVector<std::string, 2> small{"a", "b"};
+    SmallVector<std::string, 2> otherSmall = std::move(small);
+    TEST_ASSERT(otherSmall.isSmall());
+    TEST_ASSERT_EQUALS(2u, otherSmall.size());
+    TEST_ASSERT_EQUALS(std::string("b"), otherSmall.back());
+    TEST_THROWS(otherSmall.at(2), vc4c::CompilationError);
+
+    otherSmall.clear();
+    TEST_ASSERT(otherSmall.empty());
+}
+
+void TestCustomContainers::testFlatHashContainers()
+{
+    FlatHashMap<int, std::string> map;
+    TEST_ASSERT(map.empty());
+    TEST_ASSERT(map.begin() == map.end());
+    TEST_ASSERT(map.find(42) == map.end());
+
+    for(int i = 0; i < 100; ++i)
+        map.emplace(i, std::to_string(i));
+    TEST_ASSERT_EQUALS(100u, map.size());
+    TEST_ASSERT(!map.emplace(17, "foo").second);
+    TEST_ASSERT_EQUALS(std::string("17"), map.at(17));
+    TEST_THROWS(map.at(100), std::out_of_range);
+    map[100] = "bar";
+    TEST_ASSERT_EQUALS(101u, map.size());
+    TEST_ASSERT_EQUALS(std::string("bar"), map.find(100)->second);
+
+    std::size_t numEntries = 0;
+    for(const auto& entry : map)
+    {
+        TEST_ASSERT_EQUALS(entry.first == 100 ? std::string("bar") : std::to_string(entry.first), entry.second);
+        ++numEntries;
+    }
+    TEST_ASSERT_EQUALS(map.size(), numEntries);
+
+    // removing elements leaves the other elements accessible
+    for(int i = 0; i < 100; i += 2)
+        TEST_ASSERT_EQUALS(1u, map.erase(i));
+    TEST_ASSERT_EQUALS(0u, map.erase(0));
+    TEST_ASSERT_EQUALS(51u, map.size());
+    for(int i = 0; i < 100; ++i)
+        TEST_ASSERT_EQUALS(i % 2 == 0 ? 0u : 1u, map.count(i));
+
+    auto copy = map;
+    TEST_ASSERT(copy == map);
+    copy.erase(copy.find(1));
+    TEST_ASSERT(copy != map);
+
+    // reserving enough space guarantees the references to stay valid
+    FlatHashMap<int, int> reserved;
+    reserved.reserve(64);
+    auto buckets = reserved.bucket_count();
+    auto& first = reserved[0];
+    for(int i = 1; i < 64; ++i)
+        reserved.emplace(i, i);
+    TEST_ASSERT_EQUALS(buckets, reserved.bucket_count());
+    TEST_ASSERT_EQUALS(&first, &reserved[0]);
+
+    FlatHashSet<std::string> set{"foo", "bar", "baz"};
+    TEST_ASSERT_EQUALS(3u, set.size());
+    TEST_ASSERT(!set.insert("foo").second);
+    TEST_ASSERT(set.insert("qux").second);
+    TEST_ASSERT_EQUALS(1u, set.count("bar"));
+    TEST_ASSERT_EQUALS(1u, set.erase("bar"));
+    TEST_ASSERT(set.find("bar") == set.end());
+    TEST_ASSERT((set == FlatHashSet<std::string>{"qux", "baz", "foo"}));
+    set.clear();
+    TEST_ASSERT(set.empty());
+}
+
+void TestCustomContainers::testSortedVectorContainers()
+{
+    SortedVectorMap<int, std::string> map{{3, "c"}, {1, "a"}, {2, "b"}};
+    TEST_ASSERT_EQUALS(3u, map.size());
+    // the entries are sorted by their key
+    int lastKey = 0;
+    for(const auto& entry : map)
+    {
+        TEST_ASSERT(entry.first > lastKey);
+        lastKey = entry.first;
+    }
+    TEST_ASSERT(!map.emplace(2, "x").second);
+    TEST_ASSERT_EQUALS(std::string("b"), map.at(2));
+    map[0] = "0";
+    TEST_ASSERT_EQUALS(0, map.begin()->first);
+    TEST_ASSERT_EQUALS(1u, map.erase(1));
+    TEST_ASSERT(map.find(1) == map.end());
+    TEST_THROWS(map.at(1), std::out_of_range);
+
+    SortedVectorSet<int> set{5, 3, 4, 3};
+    TEST_ASSERT_EQUALS(3u, set.size());
+    TEST_ASSERT_EQUALS(3, *set.begin());
+    TEST_ASSERT(set.emplace(1).second);
+    TEST_ASSERT_EQUALS(1, *set.begin());
+    TEST_ASSERT_EQUALS(0u, set.erase(2));
+    TEST_ASSERT(set.find(4) != set.end());
+    set.clear();
+    TEST_ASSERT(set.empty());
+}
+
+void TestCustomContainers::testDynamicBitSet()
+{
+    DynamicBitSet set;
+    TEST_ASSERT(set.empty());
+    TEST_ASSERT(set.insert(3));
+    TEST_ASSERT(!set.insert(3));
+    // inserting out of the current range grows the set
+    TEST_ASSERT(set.insert(200));
+    TEST_ASSERT_EQUALS(2u, set.size());
+    TEST_ASSERT(set.contains(200));
+    TEST_ASSERT(!set.contains(100));
+    TEST_ASSERT(!set.contains(1000));
+
+    DynamicBitSet other(64);
+    other.insert(3);
+    other.insert(63);
+    TEST_ASSERT(set.insertAll(other));
+    TEST_ASSERT(!set.insertAll(other));
+    TEST_ASSERT_EQUALS(3u, set.size());
+
+    std::vector<std::size_t> elements;
+    set.forAll([&](std::size_t index) { elements.push_back(index); });
+    TEST_ASSERT((std::vector<std::size_t>{3, 63, 200}) == elements);
+
+    auto copy = set;
+    copy.retainAll(other);
+    TEST_ASSERT(copy == other);
+    set.eraseAll(other);
+    TEST_ASSERT_EQUALS(1u, set.size());
+    TEST_ASSERT(set.erase(200));
+    TEST_ASSERT(!set.erase(200));
+    TEST_ASSERT(set.empty());
+    TEST_ASSERT(set == DynamicBitSet{});
+
+    std::array<std::string, 3> objects{"foo", "bar", "baz"};
+    IndexTable<const std::string*> table;
+    TEST_ASSERT_EQUALS(0u, table.addObject(&objects[0]));
+    TEST_ASSERT_EQUALS(1u, table.addObject(&objects[1]));
+    TEST_ASSERT_EQUALS(0u, table.addObject(&objects[0]));
+    TEST_ASSERT_EQUALS(IndexTable<const std::string*>::INVALID_INDEX, table.getIndex(&objects[2]));
+    TEST_ASSERT_EQUALS(&objects[1], table[1]);
+
+    auto bits = table.toBitSet(std::vector<const std::string*>{&objects[2], &objects[1]});
+    TEST_ASSERT_EQUALS(3u, table.size());
+    TEST_ASSERT(bits.contains(2) && bits.contains(1) && !bits.contains(0));
+    TEST_ASSERT((table.toSet(bits) == vc4c::FastSet<const std::string*>{&objects[1], &objects[2]}));
+}
+
+void TestCustomContainers::testIdMap()
+{
+    IdMap<std::string> map(16);
+    TEST_ASSERT(map.empty());
+    TEST_ASSERT(map.emplace(7, "foo").second);
+    TEST_ASSERT(!map.emplace(7, "bar").second);
+    TEST_ASSERT_EQUALS("foo", map.at(7));
+    // IDs above the bound grow the table
+    auto& ref = map.at(7);
+    TEST_ASSERT(map.emplace(100, "baz").second);
+    TEST_ASSERT_EQUALS(&ref, &map.at(7));
+    TEST_ASSERT_EQUALS(2u, map.size());
+    TEST_ASSERT(map.find(3) == map.end());
+    TEST_ASSERT(map.find(1000) == map.end());
+    TEST_ASSERT_EQUALS(0u, map.count(3));
+    TEST_ASSERT_EQUALS(1u, map.count(100));
+    TEST_THROWS(map.at(3), std::out_of_range);
+    TEST_ASSERT(map[3].empty());
+    TEST_ASSERT_EQUALS(3u, map.size());
+
+    // entries are iterated in order of insertion
+    std::vector<uint32_t> ids;
+    for(const auto& entry : map)
+        ids.push_back(entry.first);
+    TEST_ASSERT((std::vector<uint32_t>{7, 100, 3}) == ids);
+
+    auto copy = map;
+    copy[7] = "other";
+    TEST_ASSERT_EQUALS("foo", map.at(7));
+    TEST_ASSERT_EQUALS("other", copy.find(7)->second);
+}
@@ -20,6 +20,14 @@ public:
     
     void testFixedSortedPointerSet();
     void testSmallSortedPointerSet();
+
+    void testMemoryPool();
+    void testIntrusiveList();
+    void testSmallVector();
+    void testFlatHashContainers();
+    void testSortedVectorContainers();
+    void testDynamicBitSet();
+    void testIdMap();
 };
 
 #endif /* VC4C_TEST_CUSTOM_CONTAINERS_H */
@@ -15,6 +15,7 @@
 
 #include "test_cases.h"
 
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <sstream>
@@ -54,6 +55,20 @@ TestEmulator::TestEmulator(const vc4c::Configuration& config) : config(config),
 #endif
     TEST_ADD(TestEmulator::testCRC16);
     TEST_ADD(TestEmulator::testPearson16);
+    TEST_ADD(TestEmulator::testTuning);
+    TEST_ADD(TestEmulator::testDifferentialCheck);
+    TEST_ADD(TestEmulator::testPassProfile);
+    TEST_ADD(TestEmulator::testParallelEmulation);
+    TEST_ADD(TestEmulator::testWorkGroupShards);
+    TEST_ADD(TestEmulator::testFunctionalEmulation);
+    TEST_ADD(TestEmulator::testBlockWiseEmulation);
+    TEST_ADD(TestEmulator::testDynamicWorkDistribution);
+    TEST_ADD(TestEmulator::testMappedParameters);
+    TEST_ADD(TestEmulator::testPreparedKernel);
+    TEST_ADD(TestEmulator::testHotspots);
+    TEST_ADD(TestEmulator::testMemoryTrace);
+    TEST_ADD(TestEmulator::testCheckpoints);
+    TEST_ADD(TestEmulator::testTimingModel);
     TEST_ADD(TestEmulator::printProfilingInfo);
 }
 
@@ -582,6 +597,575 @@ void TestEmulator::testPearson16()
     }
 }
 
+void TestEmulator::testTuning()
+{
+    std::ifstream input("./example/test_prime.cl");
+    TuningData data;
+    data.source.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data.baseConfig = config;
+    data.emulation.kernelName = "test_prime";
+    data.emulation.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.emulation.parameter.emplace_back(17u, Optional<std::vector<uint32_t>>{});
+    data.emulation.parameter.emplace_back(0u, std::vector<uint32_t>(1));
+    data.maxTrials = 4;
+
+    const auto result = tuneConfiguration(data);
+    TEST_ASSERT(result.numTrials <= data.maxTrials)
+    TEST_ASSERT(result.baseCycles > 0)
+    TEST_ASSERT(result.numCycles <= result.baseCycles)
+
+    // the written parameters reproduce the tuned configuration
+    Configuration parsedConfig;
+    for(const auto& param : result.parameters)
+        TEST_ASSERT(parseConfigurationParameter(parsedConfig, param))
+    TEST_ASSERT_EQUALS(to_string<std::string>(result.parameters, " "),
+        to_string<std::string>(toConfigurationParameters(parsedConfig), " "))
+}
+
+void TestEmulator::testDifferentialCheck()
+{
+    std::ifstream input("./example/test_prime.cl");
+    DifferentialData data;
+    data.source.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data.config = config;
+    data.config.optimizationLevel = OptimizationLevel::FULL;
+    data.emulation.kernelName = "test_prime";
+    data.emulation.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.emulation.parameter.emplace_back(17u, Optional<std::vector<uint32_t>>{});
+    data.emulation.parameter.emplace_back(0u, std::vector<uint32_t>(1));
+
+    // the optimized kernel produces the same results as the unoptimized one, so there is nothing to bisect
+    const auto result = checkOptimizations(data);
+    TEST_ASSERT(!result.isMiscompiled)
+    TEST_ASSERT(result.failingPass.empty())
+    TEST_ASSERT_EQUALS(2u, result.numTrials)
+
+    // a kernel exceeding the maximum emulation cycles already for the reference configuration cannot be checked
+    data.emulation.maxEmulationCycles = 1;
+    TEST_THROWS(checkOptimizations(data), CompilationError);
+}
+
+void TestEmulator::testPassProfile()
+{
+    std::ifstream input("./example/test_prime.cl");
+    PassProfileData data;
+    data.source.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data.config = config;
+    data.config.optimizationLevel = OptimizationLevel::FULL;
+    data.emulation.kernelName = "test_prime";
+    data.emulation.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.emulation.parameter.emplace_back(17u, Optional<std::vector<uint32_t>>{});
+    data.emulation.parameter.emplace_back(0u, std::vector<uint32_t>(1));
+    data.intermediateDirectory = ".";
+
+    // every enabled pass is profiled on its own, starting without any passes
+    auto result = profilePasses(data);
+    TEST_ASSERT(result.steps.size() > 1)
+    TEST_ASSERT_EQUALS(result.steps.size(), result.numTrials)
+    TEST_ASSERT_EQUALS(0u, result.steps.front().numPasses)
+    TEST_ASSERT(result.steps.front().pass.empty())
+    for(std::size_t i = 0; i < result.steps.size(); ++i)
+    {
+        const auto& step = result.steps[i];
+        TEST_ASSERT_EQUALS(i, step.numPasses)
+        TEST_ASSERT(step.numInstructions > 0)
+        TEST_ASSERT(step.estimatedCycles > 0.0)
+        TEST_ASSERT(step.numCycles > 0)
+        std::ifstream intermediateCode(step.intermediateFile);
+        TEST_ASSERT(!!intermediateCode)
+        std::string line;
+        TEST_ASSERT(!!std::getline(intermediateCode, line))
+        TEST_ASSERT_EQUALS("; kernel test_prime", line)
+        intermediateCode.close();
+        std::remove(step.intermediateFile.data());
+    }
+
+    // without any passes, the kernel is already slower than the reference, so there is nothing to bisect
+    data.intermediateDirectory.clear();
+    data.bisect = true;
+    data.referenceCycles = 1;
+    result = profilePasses(data);
+    TEST_ASSERT(result.slowdownPass.empty())
+    TEST_ASSERT_EQUALS(1u, result.numTrials)
+
+    // with all passes enabled, the kernel is not slower than the reference, so no pass introduces a slowdown
+    data.referenceCycles = std::numeric_limits<uint32_t>::max() / 2;
+    result = profilePasses(data);
+    TEST_ASSERT(result.slowdownPass.empty())
+    TEST_ASSERT_EQUALS(2u, result.numTrials)
+    TEST_ASSERT(result.steps.front().numPasses < result.steps.back().numPasses)
+}
+
+void TestEmulator::testParallelEmulation()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./testing/test_barrier.cl", "", cachePrecompilation);
+    std::stringstream serialBuffer(buffer.str());
+    std::stringstream parallelBuffer(buffer.str());
+
+    EmulationData serialData;
+    serialData.kernelName = "test_barrier";
+    serialData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    serialData.module = std::make_pair("", &serialBuffer);
+    serialData.workGroup.localSizes = {8, 1, 1};
+    serialData.workGroup.numGroups = {2, 1, 1};
+    serialData.parameter.emplace_back(0u, std::vector<uint32_t>(12 * serialData.calcNumWorkItems()));
+
+    EmulationData parallelData = serialData;
+    parallelData.module = std::make_pair("", &parallelBuffer);
+    parallelData.numThreads = 4;
+
+    const auto serialResult = emulate(serialData);
+    const auto parallelResult = emulate(parallelData);
+    TEST_ASSERT(serialResult.executionSuccessful)
+    TEST_ASSERT(parallelResult.executionSuccessful)
+
+    // the parallel emulation produces exactly the same results as the serial one
+    TEST_ASSERT_EQUALS(serialResult.numCycles, parallelResult.numCycles)
+    TEST_ASSERT(*serialResult.results.front().second == *parallelResult.results.front().second)
+    TEST_ASSERT_EQUALS(serialResult.instrumentation.size(), parallelResult.instrumentation.size())
+    for(std::size_t i = 0; i < serialResult.instrumentation.size(); ++i)
+    {
+        TEST_ASSERT_EQUALS(serialResult.instrumentation[i].to_string(), parallelResult.instrumentation[i].to_string())
+    }
+}
+
+void TestEmulator::testWorkGroupShards()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./testing/test_work_item.cl", "", cachePrecompilation);
+    std::stringstream fullBuffer(buffer.str());
+    std::stringstream shardBuffer(buffer.str());
+
+    EmulationData fullData;
+    fullData.kernelName = "test_work_item";
+    fullData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    fullData.module = std::make_pair("", &fullBuffer);
+    fullData.workGroup.localSizes = {8, 1, 1};
+    fullData.workGroup.numGroups = {4, 1, 1};
+    fullData.parameter.emplace_back(0, std::vector<uint32_t>(24 * fullData.calcNumWorkItems()));
+
+    EmulationData shardData = fullData;
+    shardData.module = std::make_pair("", &shardBuffer);
+    shardData.numWorkGroupShards = 3;
+    shardData.checkWorkGroupShards = true;
+
+    const auto fullResult = emulate(fullData);
+    const auto shardResult = emulate(shardData);
+    TEST_ASSERT(fullResult.executionSuccessful)
+    TEST_ASSERT(shardResult.executionSuccessful)
+    TEST_ASSERT(shardResult.numCycles > 0)
+
+    const auto& fullOut = *fullResult.results.front().second;
+    const auto& shardOut = *shardResult.results.front().second;
+    TEST_ASSERT_EQUALS(fullOut.size(), shardOut.size())
+    for(std::size_t i = 0; i < fullOut.size(); ++i)
+    {
+        // the global offset and the work-group IDs are relative to the shard
+        if(i % 24 == 7 || i % 24 == 13)
+            continue;
+        TEST_ASSERT_EQUALS(fullOut[i], shardOut[i])
+    }
+
+    // all work-groups modify the same counter
+    std::stringstream atomicBuffer;
+    compileFile(atomicBuffer, "./testing/test_atomic.cl", "", cachePrecompilation);
+    EmulationData atomicData;
+    atomicData.kernelName = "test_atomic_inc";
+    atomicData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    atomicData.module = std::make_pair("", &atomicBuffer);
+    atomicData.workGroup.numGroups = {2, 1, 1};
+    atomicData.parameter.emplace_back(0, std::vector<uint32_t>(1));
+    atomicData.numWorkGroupShards = 2;
+    atomicData.checkWorkGroupShards = true;
+    TEST_THROWS(emulate(atomicData), CompilationError);
+}
+
+void TestEmulator::testFunctionalEmulation()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+    std::stringstream accurateBuffer(buffer.str());
+    std::stringstream functionalBuffer(buffer.str());
+
+    EmulationData accurateData;
+    accurateData.kernelName = "hello_world";
+    accurateData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    accurateData.module = std::make_pair("", &accurateBuffer);
+    accurateData.workGroup.localSizes = {8, 1, 1};
+    accurateData.parameter.emplace_back(
+        0u, std::vector<uint32_t>(accurateData.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+
+    EmulationData functionalData = accurateData;
+    functionalData.module = std::make_pair("", &functionalBuffer);
+    functionalData.cycleAccurate = false;
+
+    const auto accurateResult = emulate(accurateData);
+    const auto functionalResult = emulate(functionalData);
+    TEST_ASSERT(accurateResult.executionSuccessful)
+    TEST_ASSERT(functionalResult.executionSuccessful)
+    TEST_ASSERT(*accurateResult.results.front().second == *functionalResult.results.front().second)
+    // no stalls for waiting on the periphery
+    TEST_ASSERT(functionalResult.numCycles <= accurateResult.numCycles)
+}
+
+void TestEmulator::testBlockWiseEmulation()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./testing/test_barrier.cl", "", cachePrecompilation);
+    std::stringstream accurateBuffer(buffer.str());
+    std::stringstream blockBuffer(buffer.str());
+    std::stringstream stepBuffer(buffer.str());
+
+    EmulationData accurateData;
+    accurateData.kernelName = "test_barrier";
+    accurateData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    accurateData.module = std::make_pair("", &accurateBuffer);
+    accurateData.workGroup.localSizes = {8, 1, 1};
+    accurateData.workGroup.numGroups = {2, 1, 1};
+    accurateData.parameter.emplace_back(0u, std::vector<uint32_t>(12 * accurateData.calcNumWorkItems()));
+
+    // the functional emulation on a single thread runs the QPUs block-wise
+    EmulationData blockData = accurateData;
+    blockData.module = std::make_pair("", &blockBuffer);
+    blockData.cycleAccurate = false;
+    blockData.numThreads = 1;
+
+    // writing checkpoints forces the cycle-wise emulation, the interval is never reached
+    static const std::string checkpointFile = "./block_wise_emulation.checkpoint";
+    EmulationData stepData = blockData;
+    stepData.module = std::make_pair("", &stepBuffer);
+    stepData.checkpointFile = checkpointFile;
+    stepData.checkpointInterval = std::numeric_limits<uint32_t>::max();
+
+    const auto accurateResult = emulate(accurateData);
+    const auto blockResult = emulate(blockData);
+    const auto stepResult = emulate(stepData);
+    TEST_ASSERT(accurateResult.executionSuccessful)
+    TEST_ASSERT(blockResult.executionSuccessful)
+    TEST_ASSERT(stepResult.executionSuccessful)
+    TEST_ASSERT(!std::ifstream(checkpointFile))
+
+    TEST_ASSERT(*accurateResult.results.front().second == *blockResult.results.front().second)
+    TEST_ASSERT(*stepResult.results.front().second == *blockResult.results.front().second)
+    // the block-wise emulation produces exactly the same cycles and instrumentation as the cycle-wise one
+    TEST_ASSERT_EQUALS(stepResult.numCycles, blockResult.numCycles)
+    TEST_ASSERT_EQUALS(stepResult.instrumentation.size(), blockResult.instrumentation.size())
+    for(std::size_t i = 0; i < stepResult.instrumentation.size(); ++i)
+    {
+        TEST_ASSERT_EQUALS(stepResult.instrumentation[i].to_string(), blockResult.instrumentation[i].to_string())
+    }
+}
+
+void TestEmulator::testDynamicWorkDistribution()
+{
+    std::stringstream staticBuffer;
+    compileFile(staticBuffer, "./testing/test_work_item.cl", "", cachePrecompilation);
+    std::stringstream buffer;
+    config.distributeWorkItemsDynamically = true;
+    compileFile(buffer, "./testing/test_work_item.cl", "", cachePrecompilation);
+    config.distributeWorkItemsDynamically = false;
+    // the work-items are fetched from the shared counter instead of the static work-group loop
+    TEST_ASSERT(buffer.str() != staticBuffer.str())
+
+    for(bool cycleAccurate : {true, false})
+    {
+        std::stringstream moduleBuffer(buffer.str());
+        EmulationData data;
+        data.kernelName = "test_work_item";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &moduleBuffer);
+        data.workGroup.localSizes = {4, 1, 1};
+        data.workGroup.numGroups = {3, 1, 1};
+        data.parameter.emplace_back(0, std::vector<uint32_t>(24 * data.calcNumWorkItems()));
+        data.cycleAccurate = cycleAccurate;
+
+        const auto result = emulate(data);
+        // this also checks all semaphores (e.g. the one handing over the counter) to be reset to zero at the end
+        TEST_ASSERT(result.executionSuccessful)
+        const auto& out = *result.results.front().second;
+        for(uint32_t globalId = 0; globalId < data.calcNumWorkItems(); ++globalId)
+        {
+            const auto* workItem = &out[globalId * 24];
+            TEST_ASSERT_EQUALS(globalId, workItem[4])
+            TEST_ASSERT_EQUALS(globalId / 4, workItem[13])
+            TEST_ASSERT_EQUALS(globalId % 4, workItem[19])
+            // every work-item is executed exactly once
+            TEST_ASSERT_EQUALS(1u, workItem[22])
+        }
+    }
+}
+
+void TestEmulator::testMappedParameters()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+    std::stringstream copiedBuffer(buffer.str());
+    std::stringstream mappedBuffer(buffer.str());
+
+    EmulationData copiedData;
+    copiedData.kernelName = "hello_world";
+    copiedData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    copiedData.module = std::make_pair("", &copiedBuffer);
+    copiedData.workGroup.localSizes = {8, 1, 1};
+    copiedData.parameter.emplace_back(0u, std::vector<uint32_t>(copiedData.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+
+    std::vector<uint32_t> output(copiedData.parameter.front().second->size(), 0);
+    EmulationData mappedData = copiedData;
+    mappedData.module = std::make_pair("", &mappedBuffer);
+    mappedData.parameter.front().second = {};
+    mappedData.mappedParameters.emplace(0, BufferSpan{output.data(), output.size()});
+
+    const auto copiedResult = emulate(copiedData);
+    const auto mappedResult = emulate(mappedData);
+    TEST_ASSERT(copiedResult.executionSuccessful)
+    TEST_ASSERT(mappedResult.executionSuccessful)
+    // the results are written directly into the caller-owned buffer
+    TEST_ASSERT(!mappedResult.results.front().second)
+    TEST_ASSERT(*copiedResult.results.front().second == output)
+
+    // mapping a parameter which does not exist
+    std::stringstream invalidBuffer(buffer.str());
+    mappedData.module = std::make_pair("", &invalidBuffer);
+    mappedData.mappedParameters.emplace(1, BufferSpan{output.data(), output.size()});
+    TEST_THROWS(emulate(mappedData), CompilationError);
+}
+
+void TestEmulator::testPreparedKernel()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+    std::stringstream singleBuffer(buffer.str());
+    std::stringstream preparedBuffer(buffer.str());
+
+    EmulationData singleData;
+    singleData.kernelName = "hello_world";
+    singleData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    singleData.module = std::make_pair("", &singleBuffer);
+    singleData.workGroup.localSizes = {8, 1, 1};
+    singleData.parameter.emplace_back(0u, std::vector<uint32_t>(singleData.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+    const auto singleResult = emulate(singleData);
+    TEST_ASSERT(singleResult.executionSuccessful)
+
+    EmulationData preparedData = singleData;
+    preparedData.module = std::make_pair("", &preparedBuffer);
+    PreparedKernel kernel(preparedData);
+
+    // the memory of the first execution is reused by the second one
+    for(unsigned i = 0; i < 2; ++i)
+    {
+        const auto result = kernel.run(preparedData);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(singleResult.numCycles, result.numCycles)
+        TEST_ASSERT(*singleResult.results.front().second == *result.results.front().second)
+    }
+
+    std::vector<EmulationData> inputs(4, preparedData);
+    const auto results = kernel.runBatch(inputs, 2);
+    TEST_ASSERT_EQUALS(inputs.size(), results.size())
+    for(const auto& result : results)
+    {
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT(*singleResult.results.front().second == *result.results.front().second)
+    }
+
+    // the number of parameters is only checked per execution
+    EmulationData invalidData = preparedData;
+    invalidData.parameter.clear();
+    TEST_THROWS(kernel.run(invalidData), CompilationError);
+}
+
+void TestEmulator::testHotspots()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+
+    EmulationData data;
+    data.kernelName = "hello_world";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes = {8, 1, 1};
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(data.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+    data.hotspotDump = "./hotspots.folded";
+
+    const auto result = emulate(data);
+    TEST_ASSERT(result.executionSuccessful)
+
+    unsigned numExecutions = 0;
+    for(const auto& instrumentation : result.instrumentation)
+    {
+        numExecutions += instrumentation.numExecutions;
+        TEST_ASSERT_EQUALS(instrumentation.numStalls,
+            instrumentation.numTMUStalls + instrumentation.numVPMStalls + instrumentation.numMutexStalls +
+                instrumentation.numSemaphoreStalls)
+    }
+
+    // all executed cycles are attributed to some basic block of the kernel
+    std::ifstream hotspots(data.hotspotDump);
+    TEST_ASSERT(!!hotspots)
+    unsigned numCycles = 0;
+    std::string line;
+    while(std::getline(hotspots, line))
+    {
+        TEST_ASSERT_EQUALS(0u, line.find("hello_world;"))
+        numCycles += static_cast<unsigned>(std::stoul(line.substr(line.rfind(' ') + 1)));
+    }
+    TEST_ASSERT_EQUALS(numExecutions, numCycles)
+    hotspots.close();
+    std::remove(data.hotspotDump.data());
+}
+
+void TestEmulator::testMemoryTrace()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+    std::stringstream shardBuffer(buffer.str());
+
+    EmulationData data;
+    data.kernelName = "hello_world";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes = {8, 1, 1};
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(data.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+    data.memoryTraceDump = "./memory.trace";
+
+    const auto result = emulate(data);
+    TEST_ASSERT(result.executionSuccessful)
+
+    // every work-item stores its 16 bytes, the accesses are ordered by their cycles
+    std::ifstream trace(data.memoryTraceDump);
+    TEST_ASSERT(!!trace)
+    unsigned numStoredBytes = 0;
+    unsigned lastCycle = 0;
+    bool hasSummary = false;
+    std::string line;
+    while(std::getline(trace, line))
+    {
+        if(line.find("# total: ") == 0)
+            hasSummary = true;
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::istringstream ss(line);
+        unsigned cycle = 0;
+        unsigned qpu = 0;
+        std::string type;
+        unsigned tmu = 0;
+        std::string address;
+        unsigned numBytes = 0;
+        int stride = 0;
+        std::string pattern;
+        unsigned doneCycle = 0;
+        TEST_ASSERT(!!(ss >> cycle >> qpu >> type >> tmu >> address >> numBytes >> stride >> pattern >> doneCycle))
+        TEST_ASSERT(cycle >= lastCycle)
+        TEST_ASSERT(doneCycle >= cycle)
+        TEST_ASSERT(cycle <= result.numCycles)
+        TEST_ASSERT(qpu < 8u)
+        lastCycle = cycle;
+        if(type == "dma_store")
+            numStoredBytes += numBytes;
+    }
+    TEST_ASSERT(hasSummary)
+    TEST_ASSERT_EQUALS(data.calcNumWorkItems() * 16u, numStoredBytes)
+    trace.close();
+    std::remove(data.memoryTraceDump.data());
+
+    // the shards are emulated independently of each other, so there is no common cycle to trace the accesses by
+    data.module = std::make_pair("", &shardBuffer);
+    data.workGroup.numGroups = {2, 1, 1};
+    data.parameter.clear();
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(data.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+    data.numWorkGroupShards = 2;
+    TEST_THROWS(emulate(data), CompilationError);
+}
+
+void TestEmulator::testCheckpoints()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+    std::stringstream fullBuffer(buffer.str());
+    std::stringstream checkpointBuffer(buffer.str());
+    std::stringstream resumeBuffer(buffer.str());
+
+    EmulationData fullData;
+    fullData.kernelName = "hello_world";
+    fullData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    fullData.module = std::make_pair("", &fullBuffer);
+    fullData.workGroup.localSizes = {8, 1, 1};
+    fullData.parameter.emplace_back(0u, std::vector<uint32_t>(fullData.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+    const auto fullResult = emulate(fullData);
+    TEST_ASSERT(fullResult.executionSuccessful)
+
+    EmulationData checkpointData = fullData;
+    checkpointData.module = std::make_pair("", &checkpointBuffer);
+    checkpointData.checkpointFile = "./emulator.checkpoint";
+    checkpointData.checkpointInterval = fullResult.numCycles / 2;
+    const auto checkpointResult = emulate(checkpointData);
+    TEST_ASSERT(checkpointResult.executionSuccessful)
+    TEST_ASSERT_EQUALS(fullResult.numCycles, checkpointResult.numCycles)
+
+    // resuming from the checkpoint written in the middle of the execution produces the same results
+    EmulationData resumeData = fullData;
+    resumeData.module = std::make_pair("", &resumeBuffer);
+    resumeData.resumeCheckpoint = checkpointData.checkpointFile;
+    const auto resumeResult = emulate(resumeData);
+    TEST_ASSERT(resumeResult.executionSuccessful)
+    TEST_ASSERT_EQUALS(fullResult.numCycles, resumeResult.numCycles)
+    TEST_ASSERT(*fullResult.results.front().second == *resumeResult.results.front().second)
+    TEST_ASSERT_EQUALS(fullResult.instrumentation.size(), resumeResult.instrumentation.size())
+    for(std::size_t i = 0; i < fullResult.instrumentation.size(); ++i)
+    {
+        TEST_ASSERT_EQUALS(fullResult.instrumentation[i].to_string(), resumeResult.instrumentation[i].to_string())
+    }
+    std::remove(checkpointData.checkpointFile.data());
+}
+
+void TestEmulator::testTimingModel()
+{
+    std::stringstream buffer;
+    compileFile(buffer, "./example/hello_world.cl", "", cachePrecompilation);
+
+    EmulationData data;
+    data.kernelName = "hello_world";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes = {8, 1, 1};
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(data.calcNumWorkItems() * 16 / sizeof(uint32_t)));
+    PreparedKernel kernel(data);
+    const auto defaultResult = kernel.run(data);
+    TEST_ASSERT(defaultResult.executionSuccessful)
+
+    // slower memory accesses and contention between the QPUs only change the timing, not the results
+    EmulationData slowData = data;
+    slowData.timing.tmuLatency = 32;
+    slowData.timing.dmaLatency = 64;
+    slowData.timing.memoryBytesPerCycle = 1;
+    const auto slowResult = kernel.run(slowData);
+    TEST_ASSERT(slowResult.executionSuccessful)
+    TEST_ASSERT(slowResult.numCycles > defaultResult.numCycles)
+    TEST_ASSERT(*defaultResult.results.front().second == *slowResult.results.front().second)
+
+    std::stringstream model;
+    writeTimingModel(model, slowData.timing);
+    const auto readModel = readTimingModel(model);
+    TEST_ASSERT_EQUALS(slowData.timing.tmuLatency, readModel.tmuLatency)
+    TEST_ASSERT_EQUALS(slowData.timing.dmaLatency, readModel.dmaLatency)
+    TEST_ASSERT_EQUALS(slowData.timing.memoryBytesPerCycle, readModel.memoryBytesPerCycle)
+    std::stringstream invalidModel("noSuchLatency=42");
+    TEST_THROWS(readTimingModel(invalidModel), CompilationError);
+
+    // fitting the default model to the cycles of the slow model moves the model towards the slow one
+    std::stringstream calibrationBuffer(buffer.str());
+    CalibrationData calibration;
+    calibration.samples.emplace_back();
+    calibration.samples.back().emulation = data;
+    calibration.samples.back().emulation.module = std::make_pair("", &calibrationBuffer);
+    calibration.samples.back().measuredCycles = slowResult.numCycles;
+    calibration.maxTrials = 8;
+    const auto calibrationResult = calibrateTimingModel(calibration);
+    TEST_ASSERT(calibrationResult.numTrials <= calibration.maxTrials)
+    TEST_ASSERT(calibrationResult.error < calibrationResult.baseError)
+}
+
 void TestEmulator::printProfilingInfo()
 {
 #if DEBUG_MODE
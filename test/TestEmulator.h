@@ -43,6 +43,20 @@ public:
     void testPartialMD5();
     void testCRC16();
     void testPearson16();
+    void testTuning();
+    void testDifferentialCheck();
+    void testPassProfile();
+    void testParallelEmulation();
+    void testWorkGroupShards();
+    void testFunctionalEmulation();
+    void testBlockWiseEmulation();
+    void testDynamicWorkDistribution();
+    void testMappedParameters();
+    void testPreparedKernel();
+    void testHotspots();
+    void testMemoryTrace();
+    void testCheckpoints();
+    void testTimingModel();
 
     void printProfilingInfo();
 
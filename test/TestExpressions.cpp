@@ -24,6 +24,7 @@ TestExpressions::TestExpressions()
     TEST_ADD(TestExpressions::testCombination);
     TEST_ADD(TestExpressions::testConvergence);
     TEST_ADD(TestExpressions::testValueRange);
+    TEST_ADD(TestExpressions::testInterning);
 }
 
 TestExpressions::~TestExpressions() = default;
@@ -821,3 +822,32 @@ void TestExpressions::testValueRange()
 
     // TODO (un)pack modes
 }
+
+void TestExpressions::testInterning()
+{
+    Configuration config{};
+    Module mod{config};
+    Method method(mod);
+    ExpressionTable table;
+
+    auto a = method.addNewLocal(TYPE_INT32, "%a");
+    auto b = method.addNewLocal(TYPE_INT32, "%b");
+
+    // equal expressions are interned as the same node, independent of the order of commutative operands
+    auto aPlusB = table.intern(*expression(a + b));
+    TEST_ASSERT_EQUALS(aPlusB, table.intern(*expression(a + b)))
+    TEST_ASSERT_EQUALS(aPlusB, table.intern(*expression(b + a)))
+    TEST_ASSERT(aPlusB != table.intern(*expression(a - b)))
+    TEST_ASSERT(table.intern(*expression(a - b)) != table.intern(*expression(b - a)))
+    TEST_ASSERT(aPlusB != table.intern(*expression((a + b, PACK_INT_TO_SIGNED_SHORT_SATURATE))))
+    TEST_ASSERT_EQUALS(4u, table.size())
+
+    // the sub-expressions are interned too, so the nested expressions are shared
+    auto nested = std::make_shared<Expression>(OP_SHL, expression(a + b), Value(2_lit, TYPE_INT32));
+    auto otherNested = std::make_shared<Expression>(OP_SHL, expression(b + a), Value(2_lit, TYPE_INT32));
+    auto canonical = table.canonicalize(*nested);
+    TEST_ASSERT_EQUALS(canonical, table.canonicalize(*otherNested))
+    TEST_ASSERT_EQUALS(*nested, *canonical)
+    TEST_ASSERT_EQUALS(table[aPlusB], canonical->arg0.checkExpression())
+    TEST_ASSERT_EQUALS(5u, table.size())
+}
@@ -19,6 +19,7 @@ public:
     void testCombination();
     void testConvergence();
     void testValueRange();
+    void testInterning();
 };
 
 #endif /* TEST_EXPRESSIONS_H */
@@ -6,10 +6,17 @@
 
 #include "TestFrontends.h"
 
+#include "CompilationServer.h"
 #include "GlobalValues.h"
+#include "Method.h"
+#include "Module.h"
+#include "ModuleSerializer.h"
+#include "Profiler.h"
 #include "VC4C.h"
 #include "asm/Instruction.h"
 #include "asm/KernelInfo.h"
+#include "intermediate/IntermediateInstruction.h"
+#include "intermediate/operators.h"
 #include "spirv/SPIRVHelper.h"
 #include "tools.h"
 #ifdef SPIRV_FRONTEND
@@ -18,9 +25,15 @@
 using namespace vc4c::spirv;
 #endif
 
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using namespace vc4c;
 
@@ -44,6 +57,14 @@ TestFrontends::TestFrontends()
     TEST_ADD_SINGLE_ARGUMENT(TestFrontends::testCompilation, SourceType::LLVM_IR_BIN);
 
     TEST_ADD(TestFrontends::testKernelAttributes);
+    TEST_ADD(TestFrontends::testModuleSerialization);
+    TEST_ADD(TestFrontends::testModuleLinking);
+    TEST_ADD(TestFrontends::testCompilationTrace);
+    TEST_ADD(TestFrontends::testMemoryAccounting);
+    TEST_ADD(TestFrontends::testAsynchronousCompilation);
+    TEST_ADD(TestFrontends::testCompilationCache);
+    TEST_ADD(TestFrontends::testCompilationServer);
+    TEST_ADD(TestFrontends::testKernelInfoExtraction);
 }
 
 // out-of-line virtual destructor
@@ -176,6 +197,43 @@ void TestFrontends::testDisassembler()
     }
 
     TEST_ASSERT_EQUALS(originalContent, disassembledContent)
+
+    qpu_asm::ModuleInfo module;
+    StableList<Global> globals;
+    std::vector<qpu_asm::Instruction> instructions;
+    {
+        std::ifstream in{inputFile, std::ios_base::in | std::ios_base::binary};
+        extractBinary(in, module, globals, instructions);
+    }
+
+    {
+        std::ifstream in{inputFile, std::ios_base::in | std::ios_base::binary};
+        std::stringstream out;
+        TEST_ASSERT_EQUALS(instructions.size(), disassembleModuleTable(in, out, DisassemblyTable::CSV))
+        std::string line;
+        TEST_ASSERT(!!std::getline(out, line))
+        TEST_ASSERT_EQUALS("index,kernel,code,type,signal,instruction", line)
+        std::size_t numLines = 0;
+        while(std::getline(out, line))
+            ++numLines;
+        TEST_ASSERT_EQUALS(instructions.size(), numLines)
+    }
+
+    {
+        std::ifstream in{inputFile, std::ios_base::in | std::ios_base::binary};
+        std::stringstream out;
+        TEST_ASSERT_EQUALS(instructions.size(), disassembleModuleTable(in, out, DisassemblyTable::JSON))
+        std::string line;
+        TEST_ASSERT(!!std::getline(out, line))
+        TEST_ASSERT_EQUALS("[", line)
+        std::size_t numObjects = 0;
+        while(std::getline(out, line))
+        {
+            if(!line.empty() && line.front() == '{')
+                ++numObjects;
+        }
+        TEST_ASSERT_EQUALS(instructions.size(), numObjects)
+    }
 }
 
 static std::pair<std::stringstream, SourceType> compile(
@@ -250,3 +308,533 @@ void TestFrontends::testKernelAttributes()
     TEST_ASSERT(!module.kernelInfos.empty())
     TEST_ASSERT_EQUALS(uint64_t{0x0000000300020002}, module.kernelInfos[0].workGroupSize)
 }
+
+void TestFrontends::testModuleSerialization()
+{
+    using namespace vc4c::intermediate;
+    using namespace vc4c::operators;
+    Configuration config{};
+    Module module{config};
+    auto structType = module.createStructType("%struct.foo", {TYPE_INT32, TYPE_FLOAT.toVectorType(4)});
+    // self-referencing struct
+    structType->elementTypes.push_back(DataType{module.createPointerType(DataType{structType})});
+    module.globalData.emplace_back("%global", DataType{module.createPointerType(TYPE_INT32, AddressSpace::CONSTANT)},
+        CompoundConstant(TYPE_INT32, Literal(42)), true);
+
+    module.methods.emplace_back(new Method(module));
+    auto& method = *module.methods.back();
+    method.name = "kernel";
+    method.isKernel = true;
+    method.metaData.workGroupSizes = {4, 2, 1};
+    auto& param = method.addParameter(Parameter("%in",
+        DataType{module.createPointerType(DataType{structType}, AddressSpace::GLOBAL)}, ParameterDecorations::READ_ONLY));
+    param.parameterName = "in";
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& next = method.createAndInsertNewBlock(method.end(), "%next");
+    auto it = start.walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = UNIFORM_REGISTER;
+    auto b = assign(it, TYPE_INT32, "%b") = (a + 17_val, COND_ZERO_CLEAR, SetFlag::SET_FLAGS);
+    auto vec = module.storeVector(SIMDVector(Literal(3u)), TYPE_INT32.toVectorType(16));
+    auto c = assign(it, TYPE_INT32.toVectorType(16), "%c") = vec ^ b;
+    it.emplace(new VectorRotation(c, c, SmallImmediate::fromRotationOffset(3), RotationType::ANY)).nextInBlock();
+    it.emplace(new Branch(next.getLabel()->getLabel(), BRANCH_ALWAYS)).nextInBlock();
+    it = next.walkEnd();
+    auto& global = module.globalData.back();
+    ignoreReturnValue(assign(it, global.type, "%e") = Value(&global, global.type));
+    ignoreReturnValue(assign(it, param.type, "%f") = Value(&param, param.type));
+    auto d = method.addNewLocal(TYPE_INT32, "%d");
+    it.emplace(new PhiNode(Value(d), std::vector<std::pair<Value, const Local*>>{{b, start.getLabel()->getLabel()}})).nextInBlock();
+    it.emplace(new LoadImmediate(NOP_REGISTER, 0x12345678u, LoadType::PER_ELEMENT_UNSIGNED)).nextInBlock();
+    it.emplace(new Return());
+
+    std::stringstream buffer;
+    serializeModule(module, buffer);
+    TEST_ASSERT(isSerializedModule(buffer))
+
+    Module copy{config};
+    deserializeModule(copy, buffer);
+    TEST_ASSERT_EQUALS(1u, copy.globalData.size())
+    TEST_ASSERT_EQUALS(module.globalData.back().to_string(true), copy.globalData.back().to_string(true))
+    TEST_ASSERT_EQUALS(1u, copy.methods.size())
+    auto& copiedMethod = *copy.methods.back();
+    TEST_ASSERT_EQUALS(method.name, copiedMethod.name)
+    TEST_ASSERT(copiedMethod.isKernel)
+    TEST_ASSERT(method.metaData.workGroupSizes == copiedMethod.metaData.workGroupSizes)
+    TEST_ASSERT_EQUALS(1u, copiedMethod.parameters.size())
+    TEST_ASSERT_EQUALS(param.to_string(true), copiedMethod.parameters[0].to_string(true))
+    TEST_ASSERT_EQUALS("in", copiedMethod.parameters[0].parameterName)
+    auto copiedStruct = copiedMethod.parameters[0].type.getPointerType()->elementType.getStructType();
+    TEST_ASSERT(copiedStruct != nullptr)
+    TEST_ASSERT_EQUALS(3u, copiedStruct->elementTypes.size())
+    TEST_ASSERT(copiedStruct->elementTypes[2].getPointerType()->elementType.getStructType() == copiedStruct)
+
+    auto origIt = method.walkAllInstructions();
+    auto copyIt = copiedMethod.walkAllInstructions();
+    while(!origIt.isEndOfMethod() && !copyIt.isEndOfMethod())
+    {
+        TEST_ASSERT_EQUALS(origIt->to_string(), copyIt->to_string())
+        origIt.nextInMethod();
+        copyIt.nextInMethod();
+    }
+    TEST_ASSERT(origIt.isEndOfMethod())
+    TEST_ASSERT(copyIt.isEndOfMethod())
+
+    std::stringstream invalid("some other input");
+    TEST_ASSERT(!isSerializedModule(invalid))
+    Module empty{config};
+    TEST_THROWS(deserializeModule(empty, invalid), CompilationError)
+}
+
+static std::string createObject(const std::string& kernelName, const std::string& globalName, uint32_t globalValue,
+    bool isConstant, const std::string& aliasTarget)
+{
+    using namespace vc4c::operators;
+    Configuration config{};
+    Module module{config};
+    auto ptrType = DataType{module.createPointerType(TYPE_INT32, AddressSpace::CONSTANT)};
+    module.globalData.emplace_back("%shared", ptrType, CompoundConstant(TYPE_INT32, Literal(17u)), true);
+    module.globalData.emplace_back("%str", ptrType, CompoundConstant(TYPE_INT32, Literal(globalValue)), true);
+    module.globalData.emplace_back(
+        globalName, ptrType, CompoundConstant(TYPE_INT32, Literal(globalValue)), isConstant);
+    if(!aliasTarget.empty())
+        module.functionAliases.emplace(kernelName + ".alias", aliasTarget);
+
+    module.methods.emplace_back(new Method(module));
+    auto& method = *module.methods.back();
+    method.name = kernelName;
+    method.isKernel = true;
+    auto it = method.createAndInsertNewBlock(method.end(), "%start").walkEnd();
+    for(auto& global : module.globalData)
+        ignoreReturnValue(assign(it, global.type, "%use") = Value(&global, global.type));
+    it.emplace(new intermediate::Return());
+
+    std::stringstream buffer;
+    serializeModule(module, buffer);
+    return buffer.str();
+}
+
+void TestFrontends::testModuleLinking()
+{
+    Configuration config{};
+    Module module{config};
+    std::stringstream first(createObject("first", "%first", 1, false, "foo"));
+    std::stringstream second(createObject("second", "%second", 2, false, ""));
+    deserializeModule(module, first);
+    deserializeModule(module, second);
+
+    TEST_ASSERT_EQUALS(2u, module.methods.size())
+    TEST_ASSERT_EQUALS(1u, module.functionAliases.size())
+    // the identical shared global is merged, the different constants with the same name are kept apart
+    TEST_ASSERT_EQUALS(5u, module.globalData.size())
+    TEST_ASSERT(module.findGlobal("%shared") != nullptr)
+    TEST_ASSERT(module.findGlobal("%str") != nullptr)
+    TEST_ASSERT(module.findGlobal("%str.1") != nullptr)
+    TEST_ASSERT(module.findGlobal("%first") != nullptr)
+    TEST_ASSERT(module.findGlobal("%second") != nullptr)
+
+    // the kernels reference their own globals
+    const auto getGlobalUses = [](Method& method) -> std::vector<const Local*> {
+        std::vector<const Local*> uses;
+        for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+        {
+            if(auto move = it.get<intermediate::MoveOperation>())
+                uses.push_back(move->getSource().checkLocal());
+        }
+        return uses;
+    };
+    auto firstUses = getGlobalUses(*module.methods[0]);
+    auto secondUses = getGlobalUses(*module.methods[1]);
+    TEST_ASSERT_EQUALS(3u, firstUses.size())
+    TEST_ASSERT_EQUALS(3u, secondUses.size())
+    TEST_ASSERT(module.findGlobal("%shared") == firstUses[0])
+    TEST_ASSERT(module.findGlobal("%shared") == secondUses[0])
+    TEST_ASSERT(module.findGlobal("%str") == firstUses[1])
+    TEST_ASSERT(module.findGlobal("%str.1") == secondUses[1])
+    TEST_ASSERT(module.findGlobal("%second") == secondUses[2])
+
+    // kernels and non-constant globals cannot be defined multiple times
+    std::stringstream duplicateKernel(createObject("first", "%other", 3, true, ""));
+    TEST_THROWS(deserializeModule(module, duplicateKernel), CompilationError)
+    Module otherModule{config};
+    std::stringstream global(createObject("first", "%global", 1, false, ""));
+    std::stringstream conflictingGlobal(createObject("second", "%global", 2, false, ""));
+    deserializeModule(otherModule, global);
+    TEST_THROWS(deserializeModule(otherModule, conflictingGlobal), CompilationError)
+}
+
+void TestFrontends::testCompilationTrace()
+{
+    static const std::string stageName = "test-stage";
+    const auto countEvents = [](const std::string& trace) -> std::size_t {
+        std::size_t count = 0;
+        for(auto pos = trace.find("\"name\": \"" + stageName + "\""); pos != std::string::npos;
+            pos = trace.find("\"name\": \"" + stageName + "\"", pos + 1))
+            ++count;
+        return count;
+    };
+
+    {
+        // nothing is recorded before the tracing is started
+        profiler::TraceScope scope("test", stageName.c_str());
+    }
+    profiler::startTracing();
+    {
+        profiler::TraceScope scope("test", stageName.c_str());
+    }
+    std::stringstream trace;
+    profiler::writeTrace(trace);
+    TEST_ASSERT(trace.str().find("\"traceEvents\": [") != std::string::npos)
+    TEST_ASSERT(trace.str().find("\"ph\": \"X\"") != std::string::npos)
+    TEST_ASSERT(trace.str().find("\"peakRSS_kB\": ") != std::string::npos)
+    TEST_ASSERT_EQUALS(1u, countEvents(trace.str()))
+
+    {
+        // writing the trace stops the tracing
+        profiler::TraceScope scope("test", stageName.c_str());
+    }
+    std::stringstream emptyTrace;
+    profiler::writeTrace(emptyTrace);
+    TEST_ASSERT_EQUALS(0u, countEvents(emptyTrace.str()))
+}
+
+void TestFrontends::testMemoryAccounting()
+{
+    static const auto OTHER = static_cast<std::size_t>(profiler::MemoryCategory::OTHER);
+    static const auto INSTRUCTIONS = static_cast<std::size_t>(profiler::MemoryCategory::INSTRUCTIONS);
+    {
+        profiler::MemoryScope outerScope;
+        auto start = outerScope.getUsage();
+        {
+            profiler::MemoryScope innerScope;
+            profiler::trackMemory(profiler::MemoryCategory::OTHER, 4096);
+            profiler::trackMemory(profiler::MemoryCategory::OTHER, -4096);
+            auto usage = innerScope.getUsage();
+            TEST_ASSERT_EQUALS(start.current[OTHER], usage.current[OTHER])
+            TEST_ASSERT(usage.peak[OTHER] >= usage.current[OTHER] + 4096)
+        }
+        // the peak of the inner scope is also accounted for the outer scope
+        TEST_ASSERT(outerScope.getUsage().peakTotal >= start.currentTotal + 4096)
+    }
+
+    {
+        // the usage of an isolated scope is not accounted for the enclosing scope
+        profiler::MemoryScope outerScope;
+        auto start = outerScope.getUsage();
+        {
+            profiler::MemoryScope isolatedScope(true);
+            TEST_ASSERT_EQUALS(0, isolatedScope.getUsage().currentTotal)
+            profiler::trackMemory(profiler::MemoryCategory::OTHER, 1 << 30);
+            TEST_ASSERT_EQUALS(1 << 30, isolatedScope.getUsage().peak[OTHER])
+            profiler::trackMemory(profiler::MemoryCategory::OTHER, -(1 << 30));
+        }
+        TEST_ASSERT_EQUALS(start.current[OTHER], outerScope.getUsage().current[OTHER])
+        TEST_ASSERT(outerScope.getUsage().peakTotal < start.currentTotal + (1 << 30))
+    }
+
+    {
+        // the pooled objects are accounted to their category
+        profiler::MemoryScope scope;
+        auto before = scope.getUsage().current[INSTRUCTIONS];
+        std::unique_ptr<intermediate::IntermediateInstruction> inst(
+            new intermediate::Nop(intermediate::DelayType::WAIT_VPM));
+        TEST_ASSERT(scope.getUsage().current[INSTRUCTIONS] > before)
+        inst.reset();
+        TEST_ASSERT_EQUALS(before, scope.getUsage().current[INSTRUCTIONS])
+    }
+
+    static const std::string reportFile = "./memory_report.json";
+    std::ifstream in("./example/fibonacci.cl");
+    std::stringstream out;
+    Configuration config{};
+    config.memoryReportFile = reportFile;
+    Compiler::compile(in, out, config);
+
+    std::ifstream reportStream(reportFile);
+    std::string report((std::istreambuf_iterator<char>(reportStream)), std::istreambuf_iterator<char>());
+    TEST_ASSERT(report.find("\"fibonacci\": {\"Normalizer\": {\"peak\": ") != std::string::npos)
+    TEST_ASSERT(report.find("\"Optimizer\": {\"peak\": ") != std::string::npos)
+    TEST_ASSERT(report.find("\"CodeGenerator\": {\"peak\": ") != std::string::npos)
+    TEST_ASSERT(report.find("\"total\": {\"peak\": ") != std::string::npos)
+    TEST_ASSERT(report.find("\"registerAllocation\": ") != std::string::npos)
+    TEST_ASSERT(report.find("\"process\": {\"peak\": ") != std::string::npos)
+    std::remove(reportFile.data());
+
+    // with the memory limit always exceeded, the kernels are compiled one after another (without dead-locking on
+    // the parallel optimization steps) and every kernel gets its own usage report
+    std::ifstream multipleKernels("./example/histogram.cl");
+    std::stringstream multipleOut;
+    config.maxCompilationMemory = 1;
+    Compiler::compile(multipleKernels, multipleOut, config, "-DTYPE=float");
+    TEST_ASSERT(!multipleOut.str().empty())
+
+    std::ifstream multipleReportStream(reportFile);
+    std::string multipleReport(
+        (std::istreambuf_iterator<char>(multipleReportStream)), std::istreambuf_iterator<char>());
+    for(const auto* kernel :
+        {"histogram_single_min_max", "histogram_single", "histogram_parallel_min_max", "histogram_parallel"})
+        TEST_ASSERT(multipleReport.find("\"" + std::string(kernel) + "\": {\"Normalizer\": {\"peak\": ") !=
+            std::string::npos)
+    std::remove(reportFile.data());
+}
+
+void TestFrontends::testAsynchronousCompilation()
+{
+    {
+        std::ifstream in("./example/fibonacci.cl");
+        std::stringstream out;
+        std::mutex stagesLock;
+        std::vector<std::pair<CompilationStep, std::string>> stages;
+        auto handle = Compiler::compileAsync(in, out, Configuration{}, "", {},
+            [&](CompilationStep step, const std::string& kernelName) {
+                std::lock_guard<std::mutex> guard(stagesLock);
+                stages.emplace_back(step, kernelName);
+            });
+        auto bytesWritten = handle.get();
+        TEST_ASSERT(handle.isFinished())
+        TEST_ASSERT(bytesWritten > 0)
+        TEST_ASSERT(!out.str().empty())
+
+        std::lock_guard<std::mutex> guard(stagesLock);
+        TEST_ASSERT(!stages.empty())
+        TEST_ASSERT_EQUALS(CompilationStep::PRECOMPILATION, stages.front().first)
+        TEST_ASSERT_EQUALS(CompilationStep::CODE_GENERATION, stages.back().first)
+        TEST_ASSERT_EQUALS(std::string("fibonacci"), stages.back().second)
+    }
+
+    {
+        // a cancelled compilation stops at the next stage and reports an error
+        std::ifstream in("./example/fibonacci.cl");
+        std::stringstream out;
+        auto handle = Compiler::compileAsync(in, out);
+        handle.cancel();
+        TEST_THROWS(handle.get(), CompilationError);
+        TEST_ASSERT(handle.isFinished())
+    }
+}
+
+void TestFrontends::testCompilationCache()
+{
+    Configuration config{};
+    config.cacheDirectory = "./compilation_cache";
+    CompilationCache::clear(config.cacheDirectory);
+    const auto initialStats = CompilationCache::getStatistics(config.cacheDirectory);
+    TEST_ASSERT_EQUALS(0u, initialStats.numEntries)
+    TEST_ASSERT_EQUALS(0u, initialStats.totalSize)
+
+    // the key is stable and depends on the input, the options and the configuration
+    static const std::string source = "__kernel void test(__global int* out) { *out = 42; }";
+    const auto key = CompilationCache::calculateKey(source, config, "-O3");
+    TEST_ASSERT_EQUALS(32u, key.size())
+    TEST_ASSERT_EQUALS(key, CompilationCache::calculateKey(source, config, "-O3"))
+    TEST_ASSERT(key != CompilationCache::calculateKey(source, config, "-O2"))
+    TEST_ASSERT(key != CompilationCache::calculateKey(source + " ", config, "-O3"))
+    Configuration otherConfig = config;
+    otherConfig.optimizationLevel = OptimizationLevel::NONE;
+    TEST_ASSERT(key != CompilationCache::calculateKey(source, otherConfig, "-O3"))
+
+    // inputs including other files are not cached, since their contents are not part of the key
+    TEST_ASSERT(CompilationCache::isCacheable(source, "-O3"))
+    TEST_ASSERT(!CompilationCache::isCacheable("#include \"header.h\"\n" + source, "-O3"))
+    TEST_ASSERT(!CompilationCache::isCacheable(source, "-include header.h"))
+
+    // lookup of a missing entry
+    std::stringstream missing;
+    TEST_ASSERT(!CompilationCache::lookup(key, config, missing))
+    TEST_ASSERT(missing.str().empty())
+
+    // insertion and lookup of an entry which is also kept in memory
+    CompilationCache::insert(key, config, "compiled code", 42);
+    std::stringstream found;
+    auto bytesWritten = CompilationCache::lookup(key, config, found);
+    TEST_ASSERT(bytesWritten && *bytesWritten == 42u)
+    TEST_ASSERT_EQUALS("compiled code", found.str())
+
+    // large entries are not kept in memory, so they are read from the cache directory
+    const std::string largeResult(5 * 1024 * 1024, 'x');
+    const auto largeKey = CompilationCache::calculateKey(source, otherConfig, "-O3");
+    CompilationCache::insert(largeKey, config, largeResult, largeResult.size());
+    std::stringstream largeFound;
+    bytesWritten = CompilationCache::lookup(largeKey, config, largeFound);
+    TEST_ASSERT(bytesWritten && *bytesWritten == largeResult.size())
+    TEST_ASSERT(largeFound.str() == largeResult)
+
+    auto stats = CompilationCache::getStatistics(config.cacheDirectory);
+    TEST_ASSERT_EQUALS(initialStats.numHits + 2u, stats.numHits)
+    TEST_ASSERT_EQUALS(initialStats.numMisses + 1u, stats.numMisses)
+    TEST_ASSERT_EQUALS(initialStats.numInsertions + 2u, stats.numInsertions)
+    TEST_ASSERT_EQUALS(initialStats.numEvictions, stats.numEvictions)
+    TEST_ASSERT_EQUALS(2u, stats.numEntries)
+    TEST_ASSERT(stats.totalSize > largeResult.size())
+
+    // exceeding the maximum cache size evicts the least recently used entries
+    config.maxCacheSize = largeResult.size() + 64;
+    CompilationCache::insert(CompilationCache::calculateKey(source, config, "-O1"), config, "more code", 9);
+    stats = CompilationCache::getStatistics(config.cacheDirectory);
+    TEST_ASSERT(stats.numEvictions > initialStats.numEvictions)
+    TEST_ASSERT(stats.numEntries < 3u)
+    TEST_ASSERT(stats.totalSize <= config.maxCacheSize)
+
+    // entries which would be evicted immediately are not inserted at all
+    config.maxCacheSize = 16;
+    CompilationCache::insert(CompilationCache::calculateKey(source, config, "-O0"), config, "too large", 9);
+    TEST_ASSERT_EQUALS(stats.numInsertions, CompilationCache::getStatistics(config.cacheDirectory).numInsertions)
+
+    CompilationCache::clear(config.cacheDirectory);
+    std::stringstream cleared;
+    TEST_ASSERT(!CompilationCache::lookup(key, config, cleared))
+    TEST_ASSERT_EQUALS(0u, CompilationCache::getStatistics(config.cacheDirectory).numEntries)
+    rmdir(config.cacheDirectory.data());
+}
+
+static bool writeData(int fd, const void* data, std::size_t length)
+{
+    return write(fd, data, length) == static_cast<ssize_t>(length);
+}
+
+static bool writeRequest(int fd, const std::vector<std::string>& args, const std::string& input)
+{
+    auto numArgs = static_cast<uint32_t>(args.size());
+    bool success = writeData(fd, &numArgs, sizeof(numArgs));
+    for(const auto& arg : args)
+    {
+        auto length = static_cast<uint32_t>(arg.size());
+        success = success && writeData(fd, &length, sizeof(length)) && writeData(fd, arg.data(), arg.size());
+    }
+    auto inputLength = static_cast<uint64_t>(input.size());
+    return success && writeData(fd, &inputLength, sizeof(inputLength)) && writeData(fd, input.data(), input.size());
+}
+
+static bool readData(int fd, void* data, std::size_t length)
+{
+    auto ptr = reinterpret_cast<char*>(data);
+    while(length > 0)
+    {
+        auto numRead = read(fd, ptr, length);
+        if(numRead <= 0)
+            return false;
+        ptr += numRead;
+        length -= static_cast<std::size_t>(numRead);
+    }
+    return true;
+}
+
+/*
+ * Sends the raw request data via a socket pair to the request handler of the compilation server and reads its
+ * response
+ */
+static bool runServerRequest(const std::function<bool(int)>& writeRequestData, uint32_t& status, std::string& payload)
+{
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        return false;
+    bool success = writeRequestData(fds[0]);
+    // signal the end of the request, e.g. for truncated requests
+    shutdown(fds[0], SHUT_WR);
+    handleCompilationRequest(fds[1]);
+    close(fds[1]);
+    uint64_t length = 0;
+    success = success && readData(fds[0], &status, sizeof(status)) && readData(fds[0], &length, sizeof(length));
+    if(success)
+    {
+        payload.resize(static_cast<std::size_t>(length));
+        success = readData(fds[0], &payload[0], payload.size());
+    }
+    close(fds[0]);
+    return success;
+}
+
+void TestFrontends::testCompilationServer()
+{
+    uint32_t status = 0;
+    std::string payload;
+
+    // successful compilation
+    std::ifstream in("./example/fibonacci.cl");
+    const std::string source{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    TEST_ASSERT(runServerRequest(
+        [&](int fd) -> bool { return writeRequest(fd, {"-O1", "-cl-fast-relaxed-math"}, source); }, status, payload))
+    TEST_ASSERT_EQUALS(0u, status)
+    TEST_ASSERT(!payload.empty())
+
+    // failed compilation
+    TEST_ASSERT(runServerRequest(
+        [&](int fd) -> bool { return writeRequest(fd, {}, "__kernel void broken("); }, status, payload))
+    TEST_ASSERT_EQUALS(1u, status)
+    TEST_ASSERT(!payload.empty())
+
+    // options writing files on the server are rejected
+    TEST_ASSERT(runServerRequest(
+        [&](int fd) -> bool { return writeRequest(fd, {"-O1", "--write-ir=/tmp/server.ir"}, source); }, status,
+        payload))
+    TEST_ASSERT_EQUALS(1u, status)
+    TEST_ASSERT(payload.find("--write-ir=/tmp/server.ir") != std::string::npos)
+
+    // malformed requests are rejected without allocating the requested sizes (or killing the server)
+    TEST_ASSERT(runServerRequest(
+        [](int fd) -> bool {
+            uint32_t numArgs = 0xFFFFFFFF;
+            return writeData(fd, &numArgs, sizeof(numArgs));
+        },
+        status, payload))
+    TEST_ASSERT_EQUALS(1u, status)
+    TEST_ASSERT(payload.find("Invalid compilation request") == 0)
+
+    TEST_ASSERT(runServerRequest(
+        [](int fd) -> bool {
+            uint32_t numArgs = 1;
+            uint32_t argLength = 0xFFFFFFFF;
+            return writeData(fd, &numArgs, sizeof(numArgs)) && writeData(fd, &argLength, sizeof(argLength));
+        },
+        status, payload))
+    TEST_ASSERT_EQUALS(1u, status)
+    TEST_ASSERT(payload.find("Invalid compilation request") == 0)
+
+    TEST_ASSERT(runServerRequest(
+        [](int fd) -> bool {
+            uint32_t numArgs = 0;
+            uint64_t inputLength = 0xFFFFFFFFFFFFFFFF;
+            return writeData(fd, &numArgs, sizeof(numArgs)) && writeData(fd, &inputLength, sizeof(inputLength));
+        },
+        status, payload))
+    TEST_ASSERT_EQUALS(1u, status)
+    TEST_ASSERT(payload.find("Invalid compilation request") == 0)
+
+    // truncated request
+    TEST_ASSERT(runServerRequest(
+        [](int fd) -> bool {
+            uint32_t numArgs = 2;
+            uint32_t argLength = 3;
+            return writeData(fd, &numArgs, sizeof(numArgs)) && writeData(fd, &argLength, sizeof(argLength)) &&
+                writeData(fd, "-O1", argLength);
+        },
+        status, payload))
+    TEST_ASSERT_EQUALS(1u, status)
+    TEST_ASSERT(payload.find("Invalid compilation request") == 0)
+}
+
+void TestFrontends::testKernelInfoExtraction()
+{
+    Configuration config{};
+    config.outputMode = OutputMode::BINARY;
+
+    std::ifstream in("./example/fibonacci.cl");
+    std::stringstream info;
+    auto bytesWritten = Compiler::extractKernelInfo(in, info, config);
+    TEST_ASSERT_EQUALS(info.str().size(), bytesWritten)
+    // the kernel and parameter names are written into the kernel information
+    TEST_ASSERT(info.str().find("fibonacci") != std::string::npos)
+    TEST_ASSERT(info.str().find("start0") != std::string::npos)
+    TEST_ASSERT(info.str().find("start1") != std::string::npos)
+
+    // the extracted kernel information matches the one of the compiled module, except for the kernel code
+    std::ifstream in2("./example/fibonacci.cl");
+    std::stringstream binary;
+    Compiler::compile(in2, binary, config);
+    TEST_ASSERT(binary.str().size() > bytesWritten)
+    auto infoStart = info.str().find("fibonacci");
+    auto binaryStart = binary.str().find("fibonacci");
+    TEST_ASSERT(binaryStart != std::string::npos)
+    // compare the kernel name and the parameter infos
+    TEST_ASSERT_EQUALS(info.str().substr(infoStart, 64), binary.str().substr(binaryStart, 64))
+}
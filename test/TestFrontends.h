@@ -23,6 +23,14 @@ public:
     void testDisassembler();
     void testCompilation(vc4c::SourceType type);
     void testKernelAttributes();
+    void testModuleSerialization();
+    void testModuleLinking();
+    void testCompilationTrace();
+    void testMemoryAccounting();
+    void testAsynchronousCompilation();
+    void testCompilationCache();
+    void testCompilationServer();
+    void testKernelInfoExtraction();
 
 private:
     void testEmulation(std::stringstream& binary);
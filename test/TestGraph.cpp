@@ -42,6 +42,10 @@ TestGraph::TestGraph()
 
     TEST_ADD(TestGraph::testEdgeNodes);
     TEST_ADD(TestGraph::testDirection);
+
+    TEST_ADD(TestGraph::testFreezeUndirected);
+    TEST_ADD(TestGraph::testFreezeDirected);
+    TEST_ADD(TestGraph::testFrozenFromEdges);
 }
 
 TestGraph::~TestGraph() = default;
@@ -255,3 +259,86 @@ void TestGraph::testDirection()
     e->addInput(m);
     TEST_ASSERT_EQUALS(Direction::BOTH, e->getDirection())
 }
+
+void TestGraph::testFreezeUndirected()
+{
+    UndirectedGraph graph;
+    auto& n = graph.getOrCreateNode(1);
+    auto& m = graph.getOrCreateNode(2);
+    auto& o = graph.getOrCreateNode(3);
+    graph.getOrCreateNode(4);
+    n.addEdge(&m, 7);
+    n.addEdge(&o, 8);
+
+    auto frozen = graph.freeze();
+    TEST_ASSERT_EQUALS(4u, frozen.size())
+    TEST_ASSERT(frozen.hasNode(4))
+    TEST_ASSERT(!frozen.hasNode(5))
+    TEST_THROWS(frozen.getIndex(5), CompilationError);
+
+    auto nIndex = frozen.getIndex(1);
+    TEST_ASSERT_EQUALS(1, frozen.getKey(nIndex))
+    auto edges = frozen.getEdges(nIndex);
+    TEST_ASSERT_EQUALS(2u, edges.size())
+    int sum = 0;
+    for(const auto& edge : edges)
+    {
+        TEST_ASSERT(frozen.getKey(edge.neighbor) == 2 || frozen.getKey(edge.neighbor) == 3)
+        sum += edge.data;
+    }
+    TEST_ASSERT_EQUALS(15, sum)
+
+    edges = frozen.getEdges(frozen.getIndex(2));
+    TEST_ASSERT_EQUALS(1u, edges.size())
+    TEST_ASSERT_EQUALS(nIndex, edges.begin()->neighbor)
+    TEST_ASSERT_EQUALS(7, edges.begin()->data)
+    TEST_ASSERT(frozen.getEdges(frozen.getIndex(4)).empty())
+}
+
+void TestGraph::testFreezeDirected()
+{
+    BidirectionalGraph graph;
+    auto& n = graph.getOrCreateNode(1);
+    auto& m = graph.getOrCreateNode(2);
+    auto& o = graph.getOrCreateNode(3);
+    n.addEdge(&m, 7)->addInput(m);
+    n.addEdge(&o, 8);
+
+    auto frozen = graph.freeze();
+    TEST_ASSERT_EQUALS(3u, frozen.size())
+    auto nIndex = frozen.getIndex(1);
+    auto mIndex = frozen.getIndex(2);
+    auto oIndex = frozen.getIndex(3);
+    TEST_ASSERT_EQUALS(2u, frozen.getOutgoingEdges(nIndex).size())
+    TEST_ASSERT_EQUALS(1u, frozen.getIncomingEdges(nIndex).size())
+    TEST_ASSERT_EQUALS(mIndex, frozen.getIncomingEdges(nIndex).begin()->neighbor)
+    TEST_ASSERT_EQUALS(1u, frozen.getOutgoingEdges(mIndex).size())
+    TEST_ASSERT_EQUALS(1u, frozen.getIncomingEdges(mIndex).size())
+    TEST_ASSERT(frozen.getOutgoingEdges(oIndex).empty())
+    TEST_ASSERT_EQUALS(1u, frozen.getIncomingEdges(oIndex).size())
+    TEST_ASSERT_EQUALS(nIndex, frozen.getIncomingEdges(oIndex).begin()->neighbor)
+    TEST_ASSERT_EQUALS(8, frozen.getIncomingEdges(oIndex).begin()->data)
+}
+
+void TestGraph::testFrozenFromEdges()
+{
+    using FrozenUndirectedGraph = FrozenGraph<int, int, Directionality::UNDIRECTED>;
+    using FrozenEdge = FrozenUndirectedGraph::FrozenEdge;
+
+    // 1 - 2 (7), 1 - 3 (8), 4 without edges
+    FrozenUndirectedGraph frozen(FastAccessList<int>{1, 2, 3, 4}, FastAccessList<uint32_t>{0, 2, 3, 4, 4},
+        FastAccessList<FrozenEdge>{FrozenEdge{1, 7}, FrozenEdge{2, 8}, FrozenEdge{0, 7}, FrozenEdge{0, 8}});
+    TEST_ASSERT_EQUALS(4u, frozen.size())
+    TEST_ASSERT_EQUALS(2u, frozen.getIndex(3))
+    TEST_ASSERT_EQUALS(2u, frozen.getEdges(frozen.getIndex(1)).size())
+    auto edges = frozen.getEdges(frozen.getIndex(3));
+    TEST_ASSERT_EQUALS(1u, edges.size())
+    TEST_ASSERT_EQUALS(0u, edges.begin()->neighbor)
+    TEST_ASSERT_EQUALS(8, edges.begin()->data)
+    TEST_ASSERT(frozen.getEdges(frozen.getIndex(4)).empty())
+
+    // the offsets do not match the number of nodes
+    TEST_THROWS(FrozenUndirectedGraph(FastAccessList<int>{1, 2}, FastAccessList<uint32_t>{0, 1},
+                    FastAccessList<FrozenEdge>{FrozenEdge{1, 7}}),
+        CompilationError);
+}
@@ -33,6 +33,10 @@ public:
 
     void testEdgeNodes();
     void testDirection();
+
+    void testFreezeUndirected();
+    void testFreezeDirected();
+    void testFrozenFromEdges();
 };
 
 #endif /* VC4C_TEST_GRAPH */
@@ -9,13 +9,16 @@
 #include "Bitfield.h"
 #include "GlobalValues.h"
 #include "HalfType.h"
+#include "InstructionWalker.h"
 #include "Module.h"
 #include "Values.h"
 #include "analysis/ValueRange.h"
 #include "asm/ALUInstruction.h"
+#include "asm/CodeGenerator.h"
 #include "asm/LoadInstruction.h"
 #include "asm/OpCodes.h"
 #include "intermediate/IntermediateInstruction.h"
+#include "intrinsics/ConstantFolding.h"
 #include "normalization/LiteralValues.h"
 
 #include <functional>
@@ -45,8 +48,10 @@ TestInstructions::TestInstructions()
     TEST_ADD(TestInstructions::testValue);
     TEST_ADD(TestInstructions::testTypes);
     TEST_ADD(TestInstructions::testCompoundConstants);
+    TEST_ADD(TestInstructions::testConstantFolding);
     TEST_ADD(TestInstructions::testALUInstructions);
     TEST_ADD(TestInstructions::testLoadInstruction);
+    TEST_ADD(TestInstructions::testKernelStatistics);
     TEST_ADD(TestInstructions::testValueRanges);
     TEST_ADD(TestInstructions::testInstructionEquality);
 }
@@ -644,7 +649,15 @@ void TestInstructions::testOpCodeProperties()
                 }
             }
         }
+
+        // name lookup
+        TEST_ASSERT(op == OpCode::toOpCode(op.name))
+        TEST_ASSERT_EQUALS(std::string(op.name), OpCode::findOpCode(op.name).name)
     }
+
+    TEST_ASSERT(OP_NOP == OpCode::findOpCode("fooo"))
+    TEST_ASSERT(OP_NOP == OpCode::findOpCode(""))
+    TEST_THROWS(OpCode::toOpCode("mul"), CompilationError)
 }
 
 void TestInstructions::testHalfFloat()
@@ -872,6 +885,33 @@ void TestInstructions::testOpCodeFlags()
     TEST_ASSERT(checkFlagSet(OP_XOR(INT_ONE, INT_ONE).second, FlagsMask::ZERO))
     TEST_ASSERT(checkFlagSet(OP_XOR(INT_ONE, INT_MINUS_ONE).second, FlagsMask::NEGATIVE))
 
+    // the batched calculation of whole vectors matches the calculation of the single elements
+    SIMDVector first{Literal(0u), Literal(1u), Literal(-1), Literal(0x7FFFFFFFu), Literal(0x80000000u), Literal(17u),
+        Literal(0xFFFFFFu), Literal(-42), Literal(1u << 16), Literal(3u), Literal(0xF0F0F0F0u), Literal(31u),
+        Literal(-1), Literal(5u), Literal(0x1000000u), Literal(0u)};
+    // only use positive second operands, since asr with negative offsets is not supported
+    SIMDVector second{Literal(0u), Literal(0x7FFFFFFFu), Literal(1u), Literal(1u), Literal(1u), Literal(4u),
+        Literal(0xFFFFFFu), Literal(33u), Literal(1u << 16), Literal(31u), Literal(0x0F0F0F0Fu), Literal(3u),
+        Literal(0x40000000u), Literal(7u), Literal(2u), Literal(32u)};
+    for(auto op : {OP_ADD, OP_SUB, OP_SHR, OP_ASR, OP_SHL, OP_MIN, OP_MAX, OP_AND, OP_OR, OP_XOR, OP_NOT, OP_MUL24})
+    {
+        auto vectorResult = op(first, second);
+        TEST_ASSERT(!!vectorResult.first)
+        for(unsigned i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            auto elementResult = op(first[i], second[i], TYPE_INT32);
+            TEST_ASSERT(!!elementResult.first)
+            TEST_ASSERT_EQUALS(elementResult.first->getLiteralValue(), (*vectorResult.first)[i])
+            TEST_ASSERT_EQUALS(elementResult.second[0], vectorResult.second[i])
+        }
+    }
+    // undefined elements stay undefined
+    first[3] = UNDEFINED_LITERAL;
+    auto vectorResult = OP_ADD(first, second);
+    TEST_ASSERT(vectorResult.first && (*vectorResult.first)[3].isUndefined())
+    TEST_ASSERT_EQUALS(ElementFlags{}, vectorResult.second[3])
+    TEST_ASSERT_EQUALS(Literal(21u), (*vectorResult.first)[5])
+
     // TODO v8ops
 }
 
@@ -1538,6 +1578,13 @@ void TestInstructions::testTypes()
         TEST_ASSERT_EQUALS("<{i32, f32, i8, i16}>", struct1->getContent())
         TEST_ASSERT(*struct0 == *type.getStructType())
         TEST_ASSERT(!(*struct0 == *struct1))
+
+        // the cached layout is recalculated when the elements are only set after creating the type
+        auto lateStruct = GLOBAL_TYPE_HOLDER.createStructType("MyLateStruct", {}, false);
+        TEST_ASSERT_EQUALS(0, lateStruct->getStructSize())
+        lateStruct->elementTypes = {TYPE_INT8, TYPE_INT32};
+        TEST_ASSERT_EQUALS(4, lateStruct->getStructSize(1))
+        TEST_ASSERT_EQUALS(8, lateStruct->getStructSize())
     }
 
     // array type
@@ -1624,6 +1671,71 @@ void TestInstructions::testCompoundConstants()
     }
 }
 
+void TestInstructions::testConstantFolding()
+{
+    using namespace intrinsics;
+    const CompoundConstant seven{TYPE_INT32, Literal(7u)};
+    const CompoundConstant minusTwo{TYPE_INT32, Literal(-2)};
+
+    // arithmetic, with names of OpCodes, intrinsics and LLVM instructions
+    TEST_ASSERT_EQUALS(Literal(5u), foldConstantOperation("add", TYPE_INT32, seven, minusTwo)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(-14), foldConstantOperation("mul", TYPE_INT32, seven, minusTwo)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(-3), foldConstantOperation("sdiv", TYPE_INT32, seven, minusTwo)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(1), foldConstantOperation("srem", TYPE_INT32, seven, minusTwo)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(-1), foldConstantOperation("smod", TYPE_INT32, seven, minusTwo)->getScalar())
+    const CompoundConstant one{TYPE_INT32, Literal(1u)};
+    TEST_ASSERT_EQUALS(Literal(3u), foldConstantOperation("lshr", TYPE_INT32, seven, one)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(7u), foldConstantOperation("max", TYPE_INT32, seven, minusTwo)->getScalar())
+    TEST_ASSERT(!foldConstantOperation("udiv", TYPE_INT32, seven, CompoundConstant{TYPE_INT32, Literal(0u)}))
+    TEST_ASSERT(!foldConstantOperation("foo", TYPE_INT32, seven, minusTwo))
+    TEST_ASSERT(foldConstantOperation("add", TYPE_INT32, seven, CompoundConstant{TYPE_INT32, UNDEFINED_LITERAL})
+                    ->isUndefined())
+
+    // conversions
+    const CompoundConstant minusOneChar{TYPE_INT8, Literal(0xFFu)};
+    TEST_ASSERT_EQUALS(Literal(0xFFu), foldConstantOperation("zext", TYPE_INT32, minusOneChar)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(-1), foldConstantOperation("sext", TYPE_INT32, minusOneChar)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(0xFEu), foldConstantOperation("trunc", TYPE_INT8, minusTwo)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(-2.0f), foldConstantOperation("sitofp", TYPE_FLOAT, minusTwo)->getScalar())
+
+    // element-wise on vectors
+    const CompoundConstant vector{TYPE_INT32.toVectorType(2), {seven, minusTwo}};
+    auto sum = foldConstantOperation("add", TYPE_INT32.toVectorType(2), vector, vector);
+    TEST_ASSERT(!!sum)
+    TEST_ASSERT_EQUALS(Literal(14u), sum->getCompound()->at(0).getScalar())
+    TEST_ASSERT_EQUALS(Literal(-4), sum->getCompound()->at(1).getScalar())
+
+    // comparisons
+    TEST_ASSERT_EQUALS(Literal(true),
+        foldConstantComparison(intermediate::COMP_SIGNED_GT, TYPE_BOOL, seven, minusTwo)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(false),
+        foldConstantComparison(intermediate::COMP_UNSIGNED_GT, TYPE_BOOL, seven, minusTwo)->getScalar())
+    const CompoundConstant nan{TYPE_FLOAT, Literal(std::numeric_limits<float>::quiet_NaN())};
+    TEST_ASSERT_EQUALS(Literal(false),
+        foldConstantComparison(intermediate::COMP_ORDERED_NEQ, TYPE_BOOL, nan, nan)->getScalar())
+    TEST_ASSERT_EQUALS(Literal(true),
+        foldConstantComparison(intermediate::COMP_UNORDERED_NEQ, TYPE_BOOL, nan, nan)->getScalar())
+
+    // shuffles
+    auto shuffled =
+        foldConstantShuffle(TYPE_INT32.toVectorType(3), vector, vector, std::vector<uint32_t>{3, 0, 0xFFFFFFFF});
+    TEST_ASSERT(!!shuffled)
+    TEST_ASSERT_EQUALS(Literal(-2), shuffled->getCompound()->at(0).getScalar())
+    TEST_ASSERT_EQUALS(Literal(7u), shuffled->getCompound()->at(1).getScalar())
+    TEST_ASSERT(shuffled->getCompound()->at(2).isUndefined())
+
+    // element offsets
+    Module module{Configuration{}};
+    auto arrayType = module.createArrayType(TYPE_INT16, 8);
+    DataType pointerType{module.createPointerType(DataType{arrayType}, AddressSpace::GLOBAL)};
+    DataType elementType = TYPE_UNKNOWN;
+    const CompoundConstant two{TYPE_INT32, Literal(2u)};
+    const CompoundConstant three{TYPE_INT32, Literal(3u)};
+    TEST_ASSERT_EQUALS(2 * 16 + 3 * 2, foldConstantElementOffset(pointerType, {two, three}, &elementType))
+    TEST_ASSERT_EQUALS(TYPE_INT16, elementType)
+    TEST_ASSERT(!foldConstantElementOffset(pointerType, {CompoundConstant{TYPE_INT32, UNDEFINED_LITERAL}}))
+}
+
 void TestInstructions::testALUInstructions()
 {
     using namespace vc4c::qpu_asm;
@@ -1738,6 +1850,94 @@ void TestInstructions::testLoadInstruction()
     }
 }
 
+void TestInstructions::testKernelStatistics()
+{
+    using namespace vc4c::qpu_asm;
+
+    const auto alu = [](Signaling sig, Address addOut, Address mulOut, const OpCode& mul, const OpCode& add,
+                         Address inA, InputMultiplex muxAdd, InputMultiplex muxMul) -> DecoratedInstruction {
+        return DecoratedInstruction(ALUInstruction{sig, UNPACK_NOP, PACK_NOP, COND_ALWAYS, COND_ALWAYS,
+            SetFlag::DONT_SET, WriteSwap::DONT_SWAP, addOut, mulOut, mul, add, inA, REG_NOP.num, muxAdd, muxAdd,
+            muxMul, muxMul});
+    };
+    const auto nop = REG_NOP.num;
+
+    FastAccessList<DecoratedInstruction> instructions;
+    // ra1 = or unif, unif
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, 1, nop, OP_NOP, OP_OR, REG_UNIFORM.num, InputMultiplex::REGA, InputMultiplex::ACC0));
+    // nop
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, nop, nop, OP_NOP, OP_NOP, nop, InputMultiplex::ACC0, InputMultiplex::ACC0));
+    // r0 = add ra1, ra1; r1 = fmul r0, r0
+    instructions.emplace_back(alu(SIGNAL_NONE, REG_ACC0.num, REG_ACC1.num, OP_FMUL, OP_ADD, 1, InputMultiplex::REGA,
+        InputMultiplex::ACC0));
+    // tmu0_s = or ra1, ra1
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_TMU0_ADDRESS.num, nop, OP_NOP, OP_OR, 1, InputMultiplex::REGA, InputMultiplex::ACC0));
+    // nop; load_tmu0
+    instructions.emplace_back(
+        alu(SIGNAL_LOAD_TMU0, nop, nop, OP_NOP, OP_NOP, nop, InputMultiplex::ACC0, InputMultiplex::ACC0));
+    // r2 = or mutex_acq, mutex_acq
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_ACC2.num, nop, OP_NOP, OP_OR, REG_MUTEX.num, InputMultiplex::REGA, InputMultiplex::ACC0));
+    // vpm = or r2, r2
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_VPM_IO.num, nop, OP_NOP, OP_OR, nop, InputMultiplex::ACC2, InputMultiplex::ACC0));
+    // r3 = or vpm, vpm
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_ACC3.num, nop, OP_NOP, OP_OR, REG_VPM_IO.num, InputMultiplex::REGA, InputMultiplex::ACC0));
+    // mutex_rel = or r3, r3
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_MUTEX.num, nop, OP_NOP, OP_OR, nop, InputMultiplex::ACC3, InputMultiplex::ACC0));
+
+    auto statistics = calculateKernelStatistics(instructions, 3);
+    TEST_ASSERT_EQUALS(9u, statistics.numInstructions)
+    TEST_ASSERT_EQUALS(1u, statistics.numNops)
+    TEST_ASSERT_EQUALS(7u, statistics.numALUInstructions)
+    TEST_ASSERT_EQUALS(1u, statistics.numPairedInstructions)
+    TEST_ASSERT_EQUALS(1.0 / 7.0, statistics.getPairingRate())
+    TEST_ASSERT_EQUALS(3u, statistics.numSpilledLocals)
+    TEST_ASSERT_EQUALS(2u, statistics.numVPMAccesses)
+    TEST_ASSERT_EQUALS(1u, statistics.numTMUAccesses)
+    TEST_ASSERT_EQUALS(1u, statistics.numMutexRegions)
+    // ra1, r0, r1, r2 and r3
+    TEST_ASSERT_EQUALS(5u, statistics.numRegistersUsed)
+    TEST_ASSERT_EQUALS(1u, statistics.numUniformReads)
+    // the TMU load stalls for the TMU latency (9 cycles) minus the one instruction since writing the address
+    TEST_ASSERT_EQUALS(8u, statistics.numTMUStallCycles)
+    TEST_ASSERT_EQUALS(0u, statistics.numSFUStallCycles)
+    TEST_ASSERT_EQUALS(0u, statistics.numVPMStallCycles)
+    TEST_ASSERT_EQUALS(4u, statistics.numMutexCycles)
+    TEST_ASSERT_EQUALS(4u, statistics.maxMutexRegionCycles)
+    TEST_ASSERT_EQUALS(1u, statistics.blocks.size())
+    TEST_ASSERT_EQUALS(17.0, statistics.estimatedCycles)
+
+    // the second block is executed 4 times
+    std::vector<BlockCost> blocks(2);
+    blocks[1].firstInstruction = 5;
+    blocks[1].weight = 4.0;
+    statistics = calculateKernelStatistics(instructions, 3, blocks);
+    TEST_ASSERT_EQUALS(5u, statistics.blocks[0].numInstructions)
+    TEST_ASSERT_EQUALS(13u, statistics.blocks[0].numCycles)
+    TEST_ASSERT_EQUALS(4u, statistics.blocks[1].numInstructions)
+    TEST_ASSERT_EQUALS(4u, statistics.blocks[1].numCycles)
+    TEST_ASSERT_EQUALS(13.0 + 4.0 * 4.0, statistics.estimatedCycles)
+
+    instructions.clear();
+    // sfu_recip = or ra1, ra1
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_SFU_RECIP.num, nop, OP_NOP, OP_OR, 1, InputMultiplex::REGA, InputMultiplex::ACC0));
+    // r0 = or r4, r4
+    instructions.emplace_back(
+        alu(SIGNAL_NONE, REG_ACC0.num, nop, OP_NOP, OP_OR, nop, InputMultiplex::ACC4, InputMultiplex::ACC0));
+    statistics = calculateKernelStatistics(instructions, 0);
+    TEST_ASSERT_EQUALS(2u, statistics.numSFUStallCycles)
+    TEST_ASSERT_EQUALS(4.0, statistics.estimatedCycles)
+
+    TEST_ASSERT_EQUALS(0.0, calculateKernelStatistics({}, 0).getPairingRate())
+}
+
 void TestInstructions::testValueRanges()
 {
     // undefined/unlimited range
@@ -1840,6 +2040,41 @@ void TestInstructions::testValueRanges()
         analysis::ValueRange::getValueRange(intermediate::InstructionDecorations::BUILTIN_GROUP_ID))
     TEST_ASSERT_EQUALS(analysis::ValueRange(1.0, 3.0),
         analysis::ValueRange::getValueRange(intermediate::InstructionDecorations::BUILTIN_WORK_DIMENSIONS))
+
+    // local IDs/sizes limited by the QPUs of the target profile
+    {
+        Configuration config{};
+        config.target.numQPUs = 8;
+        Module module{config};
+        Method method(module);
+        TEST_ASSERT_EQUALS(analysis::ValueRange(0.0, 7.0),
+            analysis::ValueRange::getValueRange(intermediate::InstructionDecorations::BUILTIN_LOCAL_ID, &method))
+        TEST_ASSERT_EQUALS(analysis::ValueRange(0.0, 8.0),
+            analysis::ValueRange::getValueRange(intermediate::InstructionDecorations::BUILTIN_LOCAL_SIZE, &method))
+        TEST_ASSERT_EQUALS(8u, method.metaData.getWorkGroupSize(config.target.numQPUs))
+    }
+
+    // memoized recursive ranges
+    {
+        Configuration config{};
+        Module module{config};
+        Method method(module);
+        auto it = method.createAndInsertNewBlock(method.end(), "%start").walkEnd();
+        auto a = method.addNewLocal(TYPE_INT32, "%a");
+        auto b = method.addNewLocal(TYPE_INT32, "%b");
+        it.emplace(new intermediate::MoveOperation(a, Value(Literal(17), TYPE_INT32)));
+        it.nextInBlock();
+        it.emplace(new intermediate::Operation(OP_ADD, b, a, Value(Literal(4), TYPE_INT32)));
+        it.nextInBlock();
+
+        analysis::ValueRangeCache cache(method);
+        auto range = cache.getValueRange(b);
+        TEST_ASSERT_EQUALS(analysis::ValueRange::getValueRangeRecursive(b, &method), range)
+        TEST_ASSERT_EQUALS(range, cache.getValueRange(b))
+        TEST_ASSERT_EQUALS(analysis::ValueRange(17.0, 17.0), cache.getValueRange(a))
+        cache.invalidate();
+        TEST_ASSERT_EQUALS(range, cache.getValueRange(b))
+    }
 }
 
 void TestInstructions::testInstructionEquality()
@@ -36,9 +36,11 @@ public:
     void testValue();
     void testTypes();
     void testCompoundConstants();
+    void testConstantFolding();
 
     void testALUInstructions();
     void testLoadInstruction();
+    void testKernelStatistics();
 
     void testValueRanges();
     
@@ -11,6 +11,9 @@
 #include "helper.h"
 #include "intrinsics/Operators.h"
 
+#include <algorithm>
+#include <numeric>
+
 static const std::string UNARY_FUNCTION = R"(
 // trick to allow concatenating macro (content!!) to symbol
 #define VAL(A) VAL_(A)
@@ -58,6 +61,13 @@ __kernel void test(__global OUT* out, const __global IN* in) {
 }
 )";
 
+static const std::string BINARY_OPERATION_SECOND_UNIFORM = R"(
+__kernel void test(__global OUT* out, const __global IN* in, const IN uniform) {
+  size_t gid = get_global_id(0);
+  out[gid] = in[gid] OP uniform;
+}
+)";
+
 static const std::string BINARY_FUNCTION = R"(
 // trick to allow concatenating macro (content!!) to symbol
 #define VAL(A) VAL_(A)
@@ -180,8 +190,12 @@ TestIntrinsicFunctions::TestIntrinsicFunctions(const vc4c::Configuration& config
     TEST_ADD(TestIntrinsicFunctions::testUnsignedShortModuloByConstant);
     TEST_ADD(TestIntrinsicFunctions::testUnsignedCharModuloByConstant);
 
+    TEST_ADD(TestIntrinsicFunctions::testIntDivisionByUniform);
+    TEST_ADD(TestIntrinsicFunctions::testUnsignedIntDivisionByUniform);
+
     TEST_ADD(TestIntrinsicFunctions::testFloatMultiplicationWithConstant);
     TEST_ADD(TestIntrinsicFunctions::testFloatDivisionByConstant);
+    TEST_ADD(TestIntrinsicFunctions::testFloatDivisionByUniform);
 
     TEST_ADD(TestIntrinsicFunctions::testIntToFloat);
     TEST_ADD(TestIntrinsicFunctions::testShortToFloat);
@@ -204,6 +218,8 @@ TestIntrinsicFunctions::TestIntrinsicFunctions(const vc4c::Configuration& config
     TEST_ADD(TestIntrinsicFunctions::testSfuExp2);
     TEST_ADD(TestIntrinsicFunctions::testSfuLog2);
     TEST_ADD(TestIntrinsicFunctions::testSfuRecip);
+    TEST_ADD(TestIntrinsicFunctions::testRefinedSfuRecip);
+    TEST_ADD(TestIntrinsicFunctions::testRefinedSfuRsqrt);
     TEST_ADD(TestIntrinsicFunctions::testIsNaN);
     TEST_ADD(TestIntrinsicFunctions::testIsInfNaN);
 
@@ -245,6 +261,9 @@ TestIntrinsicFunctions::TestIntrinsicFunctions(const vc4c::Configuration& config
 
     TEST_ADD(TestIntrinsicFunctions::testDMAReadWrite);
     TEST_ADD(TestIntrinsicFunctions::testDMACopy);
+
+    TEST_ADD(TestIntrinsicFunctions::testVectorReduction);
+    TEST_ADD(TestIntrinsicFunctions::testVectorScan);
 }
 
 TestIntrinsicFunctions::~TestIntrinsicFunctions() = default;
@@ -292,6 +311,38 @@ static void testBinaryOperationWithSecondConstants(std::stringstream& code, cons
         in0, tmpIn1, out, op, options.substr(pos, options.find(' ', pos) - pos), onError);
 }
 
+template <typename In, typename Out, typename Comparison = CompareEqual<Out>>
+static void testBinaryOperationWithSecondUniform(std::stringstream& code, const std::string& options, In uniform,
+    const std::function<Out(In, In)>& op, const std::function<void(const std::string&, const std::string&)>& onError)
+{
+    using namespace vc4c::tools;
+
+    auto in0 = generateInput<In, 12>(true);
+    std::array<In, 12> tmpIn1{};
+    tmpIn1.fill(uniform);
+
+    std::vector<std::pair<uint32_t, vc4c::Optional<std::vector<uint32_t>>>> parameter;
+    parameter.emplace_back(0, std::vector<uint32_t>(12));
+    parameter.emplace_back(0, std::vector<uint32_t>(12));
+    copyConvert<12>(in0, parameter.back().second.value());
+    parameter.emplace_back(vc4c::bit_cast<In, uint32_t>(uniform), vc4c::Optional<std::vector<uint32_t>>{});
+
+    WorkGroupConfig workGroups;
+    workGroups.dimensions = 1;
+    workGroups.localSizes[0] = 12;
+    workGroups.numGroups[0] = 1;
+    EmulationData data(code, "test", parameter, workGroups);
+    auto result = emulate(data);
+    if(!result.executionSuccessful)
+        throw vc4c::CompilationError(vc4c::CompilationStep::GENERAL, "Kernel execution failed");
+
+    std::array<Out, 12> out{0};
+    copyConvert<12>(result.results[0].second.value(), out);
+    auto pos = options.find("-DOP=") + std::string("-DOP=").size();
+    checkBinaryResults<Out, In, 12, Comparison>(
+        in0, tmpIn1, out, op, options.substr(pos, options.find(' ', pos) - pos), onError);
+}
+
 template <typename In, typename Out, std::size_t N, typename Comparison = CompareEqual<Out>>
 static void testBinaryFunction(std::stringstream& code, const std::string& options,
     const std::function<Out(In, In)>& op, const std::function<void(const std::string&, const std::string&)>& onError)
@@ -903,6 +954,43 @@ void TestIntrinsicFunctions::testUnsignedCharModuloByConstant()
         std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
 }
 
+void TestIntrinsicFunctions::testIntDivisionByUniform()
+{
+    for(const std::string op : {"/", "%"})
+    {
+        std::string options = "-DOP=" + op + " -DIN=int -DOUT=int";
+        std::stringstream code;
+        compileBuffer(config, code, BINARY_OPERATION_SECOND_UNIFORM, options);
+        for(int divisor : {7, 1000, -13, 123456789})
+        {
+            testBinaryOperationWithSecondUniform<int, int>(code, options, divisor,
+                op == "/" ? std::function<int(int, int)>(std::divides<int>{}) : std::modulus<int>{},
+                std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+            code.clear();
+            code.seekg(0);
+        }
+    }
+}
+
+void TestIntrinsicFunctions::testUnsignedIntDivisionByUniform()
+{
+    for(const std::string op : {"/", "%"})
+    {
+        std::string options = "-DOP=" + op + " -DIN=uint -DOUT=uint";
+        std::stringstream code;
+        compileBuffer(config, code, BINARY_OPERATION_SECOND_UNIFORM, options);
+        for(unsigned divisor : {1u, 7u, 640u, 0x87654321u})
+        {
+            testBinaryOperationWithSecondUniform<unsigned, unsigned>(code, options, divisor,
+                op == "/" ? std::function<unsigned(unsigned, unsigned)>(std::divides<unsigned>{}) :
+                            std::modulus<unsigned>{},
+                std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+            code.clear();
+            code.seekg(0);
+        }
+    }
+}
+
 void TestIntrinsicFunctions::testFloatMultiplicationWithConstant()
 {
     // constant 2^x
@@ -971,6 +1059,21 @@ void TestIntrinsicFunctions::testFloatDivisionByConstant()
         std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
 }
 
+void TestIntrinsicFunctions::testFloatDivisionByUniform()
+{
+    std::string options = "-DOP=/ -DIN=float -DOUT=float";
+    std::stringstream code;
+    compileBuffer(config, code, BINARY_OPERATION_SECOND_UNIFORM, options);
+    for(float divisor : {17.0f, -0.125f, 1234.5f})
+    {
+        testBinaryOperationWithSecondUniform<float, float, CompareULP<3>>(code, options, divisor,
+            std::divides<float>{},
+            std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+        code.clear();
+        code.seekg(0);
+    }
+}
+
 void TestIntrinsicFunctions::testIntToFloat()
 {
     std::string options = "-DFUNC=(float) -DIN=int -DOUT=float";
@@ -1213,6 +1316,40 @@ void TestIntrinsicFunctions::testSfuRecip()
         std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
 }
 
+void TestIntrinsicFunctions::testRefinedSfuRecip()
+{
+    auto func = [](float f) -> float { return 1.0f / f; };
+
+    std::string options = "-DFUNC=vc4cl_half_recip -DIN=float -DOUT=float -DDEFINE_PROTOTYPE";
+    std::stringstream code;
+    compileBuffer(config, code, UNARY_FUNCTION, options);
+    testUnaryFunction<float, float, 1, unsigned, CompareULP<8192>>(code, options, func,
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+
+    options = "-DFUNC=vc4cl_recip -DIN=float -DOUT=float -DDEFINE_PROTOTYPE";
+    code.str("");
+    compileBuffer(config, code, UNARY_FUNCTION, options);
+    testUnaryFunction<float, float, 1, unsigned, CompareULP<4>>(code, options, func,
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+void TestIntrinsicFunctions::testRefinedSfuRsqrt()
+{
+    auto func = [](float f) -> float { return 1.0f / std::sqrt(f); };
+
+    std::string options = "-DFUNC=vc4cl_half_rsqrt -DIN=float -DOUT=float -DDEFINE_PROTOTYPE";
+    std::stringstream code;
+    compileBuffer(config, code, UNARY_FUNCTION, options);
+    testUnaryFunction<float, float, 1, unsigned, CompareULP<8192>>(code, options, func,
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+
+    options = "-DFUNC=vc4cl_rsqrt -DIN=float -DOUT=float -DDEFINE_PROTOTYPE";
+    code.str("");
+    compileBuffer(config, code, UNARY_FUNCTION, options);
+    testUnaryFunction<float, float, 1, unsigned, CompareULP<4>>(code, options, func,
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+}
+
 void TestIntrinsicFunctions::testIsNaN()
 {
     auto func = [](float f) -> int { return std::isnan(f); };
@@ -1830,3 +1967,59 @@ void TestIntrinsicFunctions::testDMACopy()
     testUnaryFunction<unsigned, unsigned, 16>(code, options, func,
         std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
 }
+
+template <typename T>
+static void testVectorFunction(vc4c::Configuration& config, const std::string& function,
+    const std::function<std::array<T, 16>(const std::array<T, 16>&)>& op,
+    const std::function<void(const std::string&, const std::string&)>& onError)
+{
+    std::string options = "-DFUNC=" + function + " -DIN=int16 -DOUT=int16 -DDEFINE_PROTOTYPE";
+    std::stringstream code;
+    compileBuffer(config, code, UNARY_FUNCTION, options);
+    // limit the input values to not overflow on accumulation
+    auto in = generateInput<T, 16 * 12, short>(true);
+    auto out = runEmulation<T, T, 16, 12>(code, {in});
+    checkUnaryGroupedResults<T, T, 16 * 12, 16>(in, out, op, function, onError);
+}
+
+void TestIntrinsicFunctions::testVectorReduction()
+{
+    testVectorFunction<int>(
+        config, "vc4cl_vector_reduce_add",
+        [](const std::array<int, 16>& in) -> std::array<int, 16> {
+            std::array<int, 16> res{};
+            res.fill(std::accumulate(in.begin(), in.end(), 0));
+            return res;
+        },
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+
+    testVectorFunction<int>(
+        config, "vc4cl_vector_reduce_max",
+        [](const std::array<int, 16>& in) -> std::array<int, 16> {
+            std::array<int, 16> res{};
+            res.fill(*std::max_element(in.begin(), in.end()));
+            return res;
+        },
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+void TestIntrinsicFunctions::testVectorScan()
+{
+    testVectorFunction<int>(
+        config, "vc4cl_vector_scan_inclusive_add",
+        [](const std::array<int, 16>& in) -> std::array<int, 16> {
+            std::array<int, 16> res{};
+            std::partial_sum(in.begin(), in.end(), res.begin());
+            return res;
+        },
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+
+    testVectorFunction<int>(
+        config, "vc4cl_vector_scan_exclusive_add",
+        [](const std::array<int, 16>& in) -> std::array<int, 16> {
+            std::array<int, 16> res{};
+            std::partial_sum(in.begin(), in.end() - 1, res.begin() + 1);
+            return res;
+        },
+        std::bind(&TestIntrinsicFunctions::onMismatch, this, std::placeholders::_1, std::placeholders::_2));
+}
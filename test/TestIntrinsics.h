@@ -39,8 +39,12 @@ public:
     void testUnsignedShortModuloByConstant();
     void testUnsignedCharModuloByConstant();
 
+    void testIntDivisionByUniform();
+    void testUnsignedIntDivisionByUniform();
+
     void testFloatMultiplicationWithConstant();
     void testFloatDivisionByConstant();
+    void testFloatDivisionByUniform();
 
     // TODO fptrunc
 
@@ -65,6 +69,8 @@ public:
     void testSfuExp2();
     void testSfuLog2();
     void testSfuRecip();
+    void testRefinedSfuRecip();
+    void testRefinedSfuRsqrt();
     void testIsNaN();
     void testIsInfNaN();
 
@@ -105,6 +111,9 @@ public:
     void testDMAReadWrite();
     void testDMACopy();
 
+    void testVectorReduction();
+    void testVectorScan();
+
 private:
     void onMismatch(const std::string& expected, const std::string& result);
 };
@@ -194,6 +194,25 @@ __kernel void test(__global Type* out, __global Type* in, __global const ulong*
   out[gid] = in[gid];
 })";
 
+static const std::string HISTOGRAM = R"(
+__attribute__((reqd_work_group_size(1,1,1)))
+__kernel void test(__global uint* restrict histogram, const __global uint* restrict in, uint count) {
+  for(uint i = 0; i < count; ++i)
+    histogram[in[i] & 0xF] += 1;
+})";
+
+static const std::string PREFETCH = R"(
+__kernel void test(__global uint* out, const __global uint* in, uint count) {
+  __private uint tmp[16];
+  prefetch(in, count);
+  prefetch(out, count);
+  prefetch(tmp, 16);
+  uint sum = 0;
+  for(uint i = 0; i < count; ++i)
+    sum += in[i];
+  out[get_global_id(0)] = sum;
+})";
+
 TestMemoryAccess::TestMemoryAccess(const Configuration& config) : TestEmulator(false, config)
 {
     TEST_ADD(TestMemoryAccess::testPrivateStorage);
@@ -242,6 +261,9 @@ TestMemoryAccess::TestMemoryAccess(const Configuration& config) : TestEmulator(f
     TEST_ADD(TestMemoryAccess::testCopyPhiParameter);
     TEST_ADD(TestMemoryAccess::testReadSelectParameterOrLocal);
     TEST_ADD(TestMemoryAccess::testReadSelectRegister);
+
+    TEST_ADD(TestMemoryAccess::testVPMCachedGlobalMemory);
+    TEST_ADD(TestMemoryAccess::testPrefetch);
 }
 
 TestMemoryAccess::~TestMemoryAccess() = default;
@@ -1388,6 +1410,63 @@ void TestMemoryAccess::testReadSelectRegister()
     }
 }
 
+void TestMemoryAccess::testVPMCachedGlobalMemory()
+{
+    std::stringstream code;
+    compileBuffer(config, code, HISTOGRAM, "");
+
+    constexpr unsigned NUM_BINS = 16;
+    constexpr unsigned NUM_VALUES = 64;
+
+    auto tmp = generateInput<unsigned, NUM_BINS>(true, 0, 100);
+    std::vector<unsigned> histogram{tmp.begin(), tmp.end()};
+    auto tmp2 = generateInput<unsigned, NUM_VALUES>(true);
+    std::vector<unsigned> in{tmp2.begin(), tmp2.end()};
+
+    std::unique_ptr<vc4c::tools::EmulationResult> result;
+    emulateKernel(code, "test", 1, result, {histogram, in, {NUM_VALUES}});
+
+    auto expected = histogram;
+    for(auto val : in)
+        ++expected[val & 0xF];
+    auto& resultHistogram = result->results[0].second.value();
+    for(unsigned i = 0; i < NUM_BINS; ++i)
+    {
+        if(expected[i] != resultHistogram[i])
+        {
+            TEST_ASSERT_EQUALS(std::to_string(expected[i]) + " for bin " + std::to_string(i),
+                std::to_string(resultHistogram[i]) + " (before " + std::to_string(histogram[i]) + ")");
+        }
+    }
+}
+
+void TestMemoryAccess::testPrefetch()
+{
+    std::stringstream code;
+    compileBuffer(config, code, PREFETCH, "");
+
+    constexpr unsigned NUM_ITEMS = 16;
+    constexpr unsigned NUM_VALUES = 40;
+
+    auto tmp = generateInput<unsigned, NUM_VALUES>(true, 0, 100);
+    std::vector<unsigned> in{tmp.begin(), tmp.end()};
+    std::vector<unsigned> out(NUM_ITEMS, 0);
+
+    std::unique_ptr<vc4c::tools::EmulationResult> result;
+    emulateKernel(code, "test", NUM_ITEMS, result, {out, in, {NUM_VALUES}});
+
+    unsigned expected = 0;
+    for(auto val : in)
+        expected += val;
+    auto& resultOut = result->results[0].second.value();
+    for(unsigned i = 0; i < NUM_ITEMS; ++i)
+    {
+        if(expected != resultOut[i])
+            TEST_ASSERT_EQUALS(
+                std::to_string(expected) + " for item " + std::to_string(i), std::to_string(resultOut[i]));
+    }
+}
+
 void TestMemoryAccess::emulateKernel(std::istream& code, const std::string& kernelName, unsigned numItems,
     std::unique_ptr<vc4c::tools::EmulationResult>& result, const std::vector<std::vector<unsigned>>& args)
 {
@@ -89,6 +89,9 @@ public:
     void testReadSelectRegister();
     // TODO void testReadWriteSelectRegister();
 
+    void testVPMCachedGlobalMemory();
+    void testPrefetch();
+
 private:
     void onMismatch(const std::string& expected, const std::string& result);
 
@@ -8,13 +8,41 @@
 #include "Expression.h"
 #include "Method.h"
 #include "Module.h"
+#include "analysis/AlignmentAnalysis.h"
+#include "analysis/AnalysisManager.h"
+#include "analysis/DivergenceAnalysis.h"
+#include "analysis/DominatorTree.h"
+#include "analysis/ExecutionProfile.h"
+#include "analysis/LivenessAnalysis.h"
+#include "analysis/MemoryAnalysis.h"
+#include "asm/GraphColoring.h"
 #include "intermediate/Helper.h"
+#include "intermediate/TypeConversions.h"
+#include "intermediate/VectorHelper.h"
 #include "intermediate/operators.h"
+#include "intrinsics/Intrinsics.h"
+#include "normalization/AddressCalculation.h"
+#include "normalization/ConstantPool.h"
+#include "normalization/LiteralValues.h"
+#include "normalization/LongOperations.h"
+#include "normalization/MemoryAccess.h"
+#include "normalization/MemoryMappings.h"
+#include "normalization/Rewrite.h"
+#include "normalization/Specialization.h"
+#include "normalization/WorkItemCoarsening.h"
 #include "optimization/Combiner.h"
+#include "optimization/ControlFlow.h"
 #include "optimization/Eliminator.h"
 #include "optimization/Flags.h"
+#include "optimization/LocalCompression.h"
+#include "optimization/Optimizer.h"
+#include "optimization/Reordering.h"
+#include "periphery/VPM.h"
 
+#include <algorithm>
 #include <cmath>
+#include <set>
+#include <sstream>
 
 using namespace vc4c;
 using namespace vc4c::optimizations;
@@ -33,6 +61,66 @@ TestOptimizationSteps::TestOptimizationSteps()
     TEST_ADD(TestOptimizationSteps::testCombineConstantLoads);
     TEST_ADD(TestOptimizationSteps::testEliminateBitOperations);
     TEST_ADD(TestOptimizationSteps::testCombineRotations);
+    TEST_ADD(TestOptimizationSteps::testMethodCheckpoint);
+    TEST_ADD(TestOptimizationSteps::testModificationBatch);
+    TEST_ADD(TestOptimizationSteps::testAnalysisManager);
+    TEST_ADD(TestOptimizationSteps::testDominatorTree);
+    TEST_ADD(TestOptimizationSteps::testGlobalValueNumbering);
+    TEST_ADD(TestOptimizationSteps::testLoopInfo);
+    TEST_ADD(TestOptimizationSteps::testRegisterPressure);
+    TEST_ADD(TestOptimizationSteps::testDivergenceAnalysis);
+    TEST_ADD(TestOptimizationSteps::testAlignmentAnalysis);
+    TEST_ADD(TestOptimizationSteps::testOptimizerStatistics);
+    TEST_ADD(TestOptimizationSteps::testParallelSingleSteps);
+    TEST_ADD(TestOptimizationSteps::testFillBranchDelaySlots);
+    TEST_ADD(TestOptimizationSteps::testFillDelayNops);
+    TEST_ADD(TestOptimizationSteps::testIfConversion);
+    TEST_ADD(TestOptimizationSteps::testVectorizeElementOperations);
+    TEST_ADD(TestOptimizationSteps::testProfileGuidedBlockOrder);
+    TEST_ADD(TestOptimizationSteps::testStrengthReduction);
+    TEST_ADD(TestOptimizationSteps::testLoopInvariantCodeMotion);
+    TEST_ADD(TestOptimizationSteps::testSingleStepDispatch);
+    TEST_ADD(TestOptimizationSteps::testWorkGroupLoopUniforms);
+    TEST_ADD(TestOptimizationSteps::testDynamicWorkDistribution);
+    TEST_ADD(TestOptimizationSteps::testPrecomputedUniforms);
+    TEST_ADD(TestOptimizationSteps::testWorkItemCoarsening);
+    TEST_ADD(TestOptimizationSteps::testTailDuplication);
+    TEST_ADD(TestOptimizationSteps::testPairALUOperations);
+    TEST_ADD(TestOptimizationSteps::testSimplifyExpressionTrees);
+    TEST_ADD(TestOptimizationSteps::testKernelSpecialization);
+    TEST_ADD(TestOptimizationSteps::testKernelVersions);
+    TEST_ADD(TestOptimizationSteps::testKernelDeduplication);
+    TEST_ADD(TestOptimizationSteps::testLongOperationFastPaths);
+    TEST_ADD(TestOptimizationSteps::testMultiplicationNarrowing);
+    TEST_ADD(TestOptimizationSteps::testCombineBitwiseIdioms);
+    TEST_ADD(TestOptimizationSteps::testVPMAreaLifetimes);
+    TEST_ADD(TestOptimizationSteps::testOptimizeMutexRegions);
+    TEST_ADD(TestOptimizationSteps::testMemoryMappingOrder);
+    TEST_ADD(TestOptimizationSteps::testMemoryDependencies);
+    TEST_ADD(TestOptimizationSteps::testMultiRowMemoryCopy);
+    TEST_ADD(TestOptimizationSteps::testConstantVectorSynthesis);
+    TEST_ADD(TestOptimizationSteps::testConstantPool);
+    TEST_ADD(TestOptimizationSteps::testGlobalDataOptimization);
+    TEST_ADD(TestOptimizationSteps::testPhiElimination);
+    TEST_ADD(TestOptimizationSteps::testCombineAddressCalculations);
+    TEST_ADD(TestOptimizationSteps::testCombineHalfConversions);
+    TEST_ADD(TestOptimizationSteps::testCombineExtensionUnpacks);
+    TEST_ADD(TestOptimizationSteps::testCombineSaturatedByteOperations);
+    TEST_ADD(TestOptimizationSteps::testCombineSaturationPackModes);
+    TEST_ADD(TestOptimizationSteps::testRemoveWorkGroupSynchronization);
+    TEST_ADD(TestOptimizationSteps::testCombineCriticalSections);
+    TEST_ADD(TestOptimizationSteps::testSplitStackAllocations);
+    TEST_ADD(TestOptimizationSteps::testSplitStructValues);
+    TEST_ADD(TestOptimizationSteps::testKernelFusion);
+    TEST_ADD(TestOptimizationSteps::testCoalescingRegisterAllocator);
+    TEST_ADD(TestOptimizationSteps::testLinearScanRegisterAllocator);
+    TEST_ADD(TestOptimizationSteps::testRegisterFilePartitioning);
+    TEST_ADD(TestOptimizationSteps::testThreadSwitchInsertion);
+    TEST_ADD(TestOptimizationSteps::testUniformLocalCompression);
+    TEST_ADD(TestOptimizationSteps::testSizeOptimizationLevel);
+    TEST_ADD(TestOptimizationSteps::testRedundantFlagsRemoval);
+    TEST_ADD(TestOptimizationSteps::testBranchOnConditionFlags);
+    TEST_ADD(TestOptimizationSteps::testVectorShuffleSynthesis);
 }
 
 static bool checkEquals(
@@ -1769,3 +1857,2922 @@ void TestOptimizationSteps::testCombineRotations()
 
     testMethodsEquals(inputMethod, outputMethod);
 }
+
+void TestOptimizationSteps::testMethodCheckpoint()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    Method expectedMethod(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& expectedBlock = expectedMethod.createAndInsertNewBlock(expectedMethod.end(), "%start");
+    auto it = block.walkEnd();
+    auto expectedIt = expectedBlock.walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = UNIFORM_REGISTER;
+    assign(expectedIt, a) = UNIFORM_REGISTER;
+    auto b = method.addNewLocal(TYPE_INT32, "%b");
+    assign(it, b) = a;
+    auto readIt = it.copy().previousInBlock();
+    assign(expectedIt, b) = a;
+    auto removedLabel = method.createAndInsertNewBlock(method.end(), "%removed").getLabel()->getLabel();
+    expectedMethod.createAndInsertNewBlock(expectedMethod.end(), "%removed");
+    auto numReaders = a.local()->getUsers(LocalUse::Type::READER).size();
+
+    {
+        MethodCheckpoint checkpoint(method);
+        // the state stored in the checkpoint is not visible as user
+        TEST_ASSERT_EQUALS(numReaders, a.local()->getUsers(LocalUse::Type::READER).size());
+
+        readIt.erase();
+        method.createAndInsertNewBlock(method.end(), "%added");
+        TEST_ASSERT(method.removeBlock(*method.findBasicBlock(removedLabel), true));
+        TEST_ASSERT_EQUALS(numReaders - 1, a.local()->getUsers(LocalUse::Type::READER).size());
+
+        checkpoint.rollback();
+        TEST_ASSERT(!checkpoint.isActive());
+        TEST_THROWS(checkpoint.commit(), CompilationError);
+    }
+    testMethodsEquals(method, expectedMethod);
+    TEST_ASSERT_EQUALS(numReaders, a.local()->getUsers(LocalUse::Type::READER).size());
+    TEST_ASSERT(method.findBasicBlock(removedLabel) != nullptr);
+
+    // committed changes are kept
+    {
+        MethodCheckpoint checkpoint(method);
+        method.createAndInsertNewBlock(method.end(), "%kept");
+        checkpoint.commit();
+    }
+    expectedMethod.createAndInsertNewBlock(expectedMethod.end(), "%kept");
+    testMethodsEquals(method, expectedMethod);
+}
+
+void TestOptimizationSteps::testModificationBatch()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& startBlock = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& endBlock = method.createAndInsertNewBlock(method.end(), "%end");
+    auto it = startBlock.walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = UNIFORM_REGISTER;
+    assign(it, NOP_REGISTER) = a;
+    TEST_ASSERT_EQUALS(
+        &method.getCFG().assertNode(&endBlock), method.getCFG().assertNode(&startBlock).getSingleSuccessor())
+
+    std::unique_ptr<IntermediateInstruction> released;
+    {
+        ModificationBatch outerBatch(method);
+        {
+            ModificationBatch innerBatch(method);
+            // split the block and jump over the new block
+            auto splitIt = method.emplaceLabel(
+                it.copy().previousInBlock(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "%skipped").local()));
+            startBlock.walkEnd().emplace(new Branch(endBlock.getLabel()->getLabel(), BRANCH_ALWAYS));
+            released.reset(splitIt.nextInBlock().release());
+            innerBatch.commit();
+            TEST_THROWS(innerBatch.commit(), CompilationError);
+        }
+        // the empty position is only removed by the outermost batch
+        TEST_ASSERT_EQUALS(3u, method.size())
+        TEST_ASSERT(!std::next(method.begin())->walk().nextInBlock().has())
+    }
+    auto& skippedBlock = *std::next(method.begin());
+    TEST_ASSERT(skippedBlock.walk().nextInBlock().isEndOfBlock())
+    // the CFG is re-created with the modified control flow
+    auto& cfg = method.getCFG();
+    TEST_ASSERT_EQUALS(&cfg.assertNode(&endBlock), cfg.assertNode(&startBlock).getSingleSuccessor())
+    TEST_ASSERT_EQUALS(&cfg.assertNode(&endBlock), cfg.assertNode(&skippedBlock).getSingleSuccessor())
+    TEST_ASSERT(cfg.assertNode(&skippedBlock).getSinglePredecessor() == nullptr)
+}
+
+void TestOptimizationSteps::testAnalysisManager()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    method.createAndInsertNewBlock(method.end(), "%start");
+    auto& loopBlock = method.createAndInsertNewBlock(method.end(), "%loop");
+    loopBlock.walkEnd().emplace(new Branch(loopBlock.getLabel()->getLabel(), BRANCH_ALWAYS));
+    method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto& analyses = method.getAnalyses();
+    const auto* dominators = &analyses.getDominatorTree();
+    TEST_ASSERT_EQUALS(1u, analyses.getLoops(false).size());
+
+    // results are cached
+    TEST_ASSERT_EQUALS(dominators, &analyses.getDominatorTree());
+    const auto* dependencies = &analyses.getDataDependencies();
+    TEST_ASSERT_EQUALS(dependencies, &analyses.getDataDependencies());
+
+    // preserved results are kept, the others are re-calculated
+    analyses.invalidate(analysis::CachedAnalysis::CONTROL_FLOW);
+    TEST_ASSERT_EQUALS(dominators, &analyses.getDominatorTree());
+    TEST_ASSERT(dependencies != &analyses.getDataDependencies());
+
+    // changing the control flow invalidates all results
+    method.createAndInsertNewBlock(method.end(), "%added");
+    TEST_ASSERT(dominators != &analyses.getDominatorTree());
+    TEST_ASSERT_EQUALS(1u, analyses.getLoops(false).size());
+}
+
+void TestOptimizationSteps::testDominatorTree()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    // if-else: %start -> %then/%else -> %end
+    auto& startBlock = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& thenBlock = method.createAndInsertNewBlock(method.end(), "%then");
+    auto& elseBlock = method.createAndInsertNewBlock(method.end(), "%else");
+    auto& endBlock = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = startBlock.walkEnd();
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(elseBlock.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(thenBlock.getLabel()->getLabel(), cond.invert()));
+    thenBlock.walkEnd().emplace(new Branch(endBlock.getLabel()->getLabel(), BRANCH_ALWAYS));
+
+    auto& cfg = method.getCFG();
+    const auto& start = cfg.assertNode(&startBlock);
+    const auto& thenNode = cfg.assertNode(&thenBlock);
+    const auto& elseNode = cfg.assertNode(&elseBlock);
+    const auto& end = cfg.assertNode(&endBlock);
+
+    const auto& dominators = method.getAnalyses().getDominatorTree();
+    TEST_ASSERT(!dominators.isPostDominators())
+    TEST_ASSERT(dominators.getImmediateDominator(start) == nullptr)
+    TEST_ASSERT(dominators.getImmediateDominator(thenNode) == &start)
+    TEST_ASSERT(dominators.getImmediateDominator(elseNode) == &start)
+    TEST_ASSERT(dominators.getImmediateDominator(end) == &start)
+    TEST_ASSERT(dominators.dominates(start, end))
+    TEST_ASSERT(dominators.dominates(end, end))
+    TEST_ASSERT(!dominators.strictlyDominates(end, end))
+    TEST_ASSERT(!dominators.dominates(thenNode, end))
+    TEST_ASSERT(!dominators.dominates(end, start))
+    TEST_ASSERT(dominators.getDominanceFrontier(start).empty())
+    auto frontier = dominators.getDominanceFrontier(thenNode);
+    TEST_ASSERT_EQUALS(1u, frontier.size())
+    TEST_ASSERT(frontier.front() == &end)
+
+    const auto& postDominators = method.getAnalyses().getPostDominatorTree();
+    TEST_ASSERT(postDominators.isPostDominators())
+    TEST_ASSERT(postDominators.getImmediateDominator(end) == nullptr)
+    TEST_ASSERT(postDominators.getImmediateDominator(start) == &end)
+    TEST_ASSERT(postDominators.getImmediateDominator(elseNode) == &end)
+    TEST_ASSERT(postDominators.dominates(end, start))
+    TEST_ASSERT(!postDominators.dominates(thenNode, start))
+    TEST_ASSERT(postDominators.getDominanceFrontier(end).empty())
+    frontier = postDominators.getDominanceFrontier(elseNode);
+    TEST_ASSERT_EQUALS(1u, frontier.size())
+    TEST_ASSERT(frontier.front() == &start)
+}
+
+void TestOptimizationSteps::testGlobalValueNumbering()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    // if-else: %start -> %then/%else -> %end
+    auto& startBlock = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& thenBlock = method.createAndInsertNewBlock(method.end(), "%then");
+    auto& elseBlock = method.createAndInsertNewBlock(method.end(), "%else");
+    auto& endBlock = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = startBlock.walkEnd();
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto y = assign(it, TYPE_INT32, "%y") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_INT32, "%a") = x + y;
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(elseBlock.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(thenBlock.getLabel()->getLabel(), cond.invert()));
+
+    it = thenBlock.walkEnd();
+    auto b = assign(it, TYPE_INT32, "%b") = y + x;
+    auto c = assign(it, TYPE_INT32, "%c") = x - y;
+    it.emplace(new Branch(endBlock.getLabel()->getLabel(), BRANCH_ALWAYS));
+
+    it = elseBlock.walkEnd();
+    auto d = assign(it, TYPE_INT32, "%d") = x - y;
+
+    it = endBlock.walkEnd();
+    auto e = assign(it, TYPE_INT32, "%e") = x + y;
+
+    TEST_ASSERT(eliminateCommonSubexpressions(module, method, config))
+
+    // redundant with the calculation in the dominating block
+    for(const auto& val : {b, e})
+    {
+        auto move = dynamic_cast<const MoveOperation*>(val.getSingleWriter());
+        TEST_ASSERT(move != nullptr)
+        TEST_ASSERT(move && move->getSource() == a)
+    }
+    // the other calculation does not dominate this one
+    TEST_ASSERT(dynamic_cast<const Operation*>(c.getSingleWriter()) != nullptr)
+    TEST_ASSERT(dynamic_cast<const Operation*>(d.getSingleWriter()) != nullptr)
+}
+
+void TestOptimizationSteps::testLoopInfo()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    // nested loops: %start -> %outer -> %inner (-> %inner) -> %latch (-> %outer) -> %end
+    method.createAndInsertNewBlock(method.end(), "%start");
+    auto& outerBlock = method.createAndInsertNewBlock(method.end(), "%outer");
+    auto& innerBlock = method.createAndInsertNewBlock(method.end(), "%inner");
+    auto& latchBlock = method.createAndInsertNewBlock(method.end(), "%latch");
+    auto& endBlock = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = innerBlock.walkEnd();
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(innerBlock.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(latchBlock.getLabel()->getLabel(), cond.invert()));
+
+    it = latchBlock.walkEnd();
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(outerBlock.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(endBlock.getLabel()->getLabel(), cond.invert()));
+
+    auto& analyses = method.getAnalyses();
+    const auto& infos = analyses.getLoopInfos();
+    TEST_ASSERT_EQUALS(2u, infos.size())
+    auto innerIt =
+        std::find_if(infos.begin(), infos.end(), [](const analysis::LoopInfo& info) { return info.loop.size() == 1; });
+    auto outerIt =
+        std::find_if(infos.begin(), infos.end(), [](const analysis::LoopInfo& info) { return info.loop.size() > 1; });
+    TEST_ASSERT(innerIt != infos.end())
+    TEST_ASSERT(outerIt != infos.end())
+    if(innerIt != infos.end() && outerIt != infos.end())
+    {
+        auto outerIndex = static_cast<std::size_t>(outerIt - infos.begin());
+        TEST_ASSERT_EQUALS(outerIndex, innerIt->parentLoop.value_or(infos.size()))
+        TEST_ASSERT_EQUALS(1u, innerIt->nestingDepth)
+        TEST_ASSERT(!outerIt->parentLoop)
+        TEST_ASSERT_EQUALS(0u, outerIt->nestingDepth)
+        TEST_ASSERT_EQUALS(1u, outerIt->innerLoops.size())
+        // no induction variables, since the loops are controlled by UNIFORMs
+        TEST_ASSERT(!innerIt->iterationVariable)
+        TEST_ASSERT(!innerIt->tripCount)
+    }
+
+    // results are cached until invalidated
+    TEST_ASSERT_EQUALS(&infos, &analyses.getLoopInfos())
+    analyses.invalidate(analysis::CachedAnalysis::CONTROL_FLOW);
+    TEST_ASSERT_EQUALS(2u, analyses.getLoopInfos().size())
+
+    // trip counts for the supported step operations
+    auto counter = method.addNewLocal(TYPE_INT32, "%counter");
+    Operation add(OP_ADD, counter, counter, Value(Literal(2), TYPE_INT32));
+    analysis::InductionVariable var{
+        counter.local(), nullptr, &add, std::make_pair(COMP_SIGNED_LT, Value(Literal(10), TYPE_INT32))};
+    TEST_ASSERT_EQUALS(5u, analysis::LoopInfo::calculateTripCount(var, Literal(0), Literal(10), Literal(2)).value())
+    var.repeatCondition = std::make_pair(COMP_SIGNED_LE, Value(Literal(10), TYPE_INT32));
+    TEST_ASSERT_EQUALS(11u, analysis::LoopInfo::calculateTripCount(var, Literal(0), Literal(10), Literal(1)).value())
+    // type wrap and zero step are not supported
+    TEST_ASSERT(!analysis::LoopInfo::calculateTripCount(var, Literal(10), Literal(0), Literal(1)))
+    TEST_ASSERT(!analysis::LoopInfo::calculateTripCount(var, Literal(0), Literal(10), Literal(0)))
+
+    Operation sub(OP_SUB, counter, counter, Value(Literal(1), TYPE_INT32));
+    var.inductionStep = &sub;
+    var.repeatCondition = std::make_pair(COMP_SIGNED_GT, Value(Literal(0), TYPE_INT32));
+    TEST_ASSERT_EQUALS(8u, analysis::LoopInfo::calculateTripCount(var, Literal(8), Literal(0), Literal(1)).value())
+}
+
+void TestOptimizationSteps::testRegisterPressure()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = UNIFORM_REGISTER;
+    auto b = assign(it, TYPE_INT32, "%b") = UNIFORM_REGISTER;
+    auto c = assign(it, TYPE_INT32, "%c") = a + b;
+    assignNop(it) = c;
+    auto lastInstruction = it.copy().previousInBlock().get();
+
+    const auto& pressure = method.getAnalyses().getRegisterPressure();
+    // the pressure at an instruction includes the locals read by it, but not the local written
+    TEST_ASSERT_EQUALS(0u, pressure.getPressure(a.getSingleWriter()).total())
+    TEST_ASSERT_EQUALS(1u, pressure.getPressure(b.getSingleWriter()).total())
+    TEST_ASSERT_EQUALS(2u, pressure.getPressure(c.getSingleWriter()).total())
+    TEST_ASSERT_EQUALS(2u, pressure.getPressure(c.getSingleWriter()).unconstrained)
+    TEST_ASSERT_EQUALS(1u, pressure.getPressure(lastInstruction).total())
+    TEST_ASSERT_EQUALS(2u, pressure.getMaximumPressure(block).total())
+    TEST_ASSERT_EQUALS(2u, pressure.getMaximumPressure().total())
+    TEST_ASSERT(!pressure.getMaximumPressure().exceedsRegisters())
+    TEST_ASSERT_EQUALS(67u, pressure.getMaximumPressure().getFreeRegisters())
+
+    analysis::RegisterPressure fullPressure{};
+    fullPressure.accumulators = 6;
+    TEST_ASSERT(fullPressure.exceedsRegisters())
+    TEST_ASSERT_EQUALS(0u, fullPressure.getFreeRegisters())
+    fullPressure.accumulators = 5;
+    fullPressure.unconstrained = 64;
+    TEST_ASSERT(!fullPressure.exceedsRegisters())
+    TEST_ASSERT_EQUALS(0u, fullPressure.getFreeRegisters())
+    fullPressure.fileA = 1;
+    TEST_ASSERT(fullPressure.exceedsRegisters())
+}
+
+void TestOptimizationSteps::testDivergenceAnalysis()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    // if(local_id) then: %start -> %then -> %end, %start -> %end
+    auto& startBlock = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& thenBlock = method.createAndInsertNewBlock(method.end(), "%then");
+    auto& endBlock = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = startBlock.walkEnd();
+    auto uniform = assign(it, TYPE_INT32, "%uniform") = UNIFORM_REGISTER;
+    auto element = assign(it, TYPE_INT32, "%element") = ELEMENT_NUMBER_REGISTER + uniform;
+    auto localIds = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_IDS)->createReference();
+    auto lid = method.addNewLocal(TYPE_INT32, "%lid");
+    it.emplace((new MoveOperation(lid, localIds))->addDecorations(InstructionDecorations::BUILTIN_LOCAL_ID));
+    it.nextInBlock();
+    auto offset = assign(it, TYPE_INT32, "%offset") = lid << 2_val;
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, offset);
+    it.emplace(new Branch(endBlock.getLabel()->getLabel(), cond.invert()));
+    it.nextInBlock();
+    it.emplace(new Branch(thenBlock.getLabel()->getLabel(), cond));
+
+    it = thenBlock.walkEnd();
+    auto escaping = assign(it, TYPE_INT32, "%escaping") = uniform + 1_val;
+    auto internal = assign(it, TYPE_INT32, "%internal") = uniform + 2_val;
+    assignNop(it) = internal;
+
+    it = endBlock.walkEnd();
+    assignNop(it) = escaping;
+
+    const auto& divergence = method.getAnalyses().getDivergence();
+    TEST_ASSERT_EQUALS(analysis::Uniformity::UNIFORM, divergence.getUniformity(uniform))
+    TEST_ASSERT_EQUALS(analysis::Uniformity::GROUP_UNIFORM, divergence.getUniformity(element))
+    TEST_ASSERT_EQUALS(analysis::Uniformity::LANE_UNIFORM, divergence.getUniformity(lid))
+    TEST_ASSERT_EQUALS(analysis::Uniformity::LANE_UNIFORM, divergence.getUniformity(offset))
+    TEST_ASSERT(!divergence.isDivergentBlock(startBlock))
+    TEST_ASSERT(divergence.isDivergentBlock(thenBlock))
+    TEST_ASSERT(!divergence.isDivergentBlock(endBlock))
+    // only the work-items executing the conditional block see the value written there
+    TEST_ASSERT_EQUALS(analysis::Uniformity::LANE_UNIFORM, divergence.getUniformity(escaping))
+    TEST_ASSERT_EQUALS(analysis::Uniformity::UNIFORM, divergence.getUniformity(internal))
+    TEST_ASSERT(divergence.isGroupUniform(uniform))
+    TEST_ASSERT(!divergence.isLaneUniform(element))
+}
+
+void TestOptimizationSteps::testAlignmentAnalysis()
+{
+    using namespace vc4c::intermediate;
+    using analysis::KnownAlignment;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& param = method.addParameter(Parameter("%in", method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL)));
+    auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+    auto it = block.walkEnd();
+    auto in = assign(it, TYPE_INT32, "%uniform") = UNIFORM_REGISTER;
+    auto index = assign(it, TYPE_INT32, "%index") = in << 2_val;
+    auto address = assign(it, TYPE_INT32, "%address") = param.createReference() + index;
+    auto upperHalf = assign(it, TYPE_INT32, "%upper_half") = address + 2_val;
+    auto masked = assign(it, TYPE_INT32, "%masked") = in & Value(Literal(0xFFFFFFF8u), TYPE_INT32);
+    auto product = assign(it, TYPE_INT32, "%product") = mul24(in, 12_val);
+    auto multiple = method.addNewLocal(TYPE_INT32, "%multiple");
+    assign(it, multiple) = (8_val, COND_ZERO_SET);
+    assign(it, multiple) = (24_val, COND_ZERO_CLEAR);
+
+    TEST_ASSERT_EQUALS(1u, KnownAlignment::getAlignment(in).alignment)
+    TEST_ASSERT(KnownAlignment::getAlignment(param.createReference()).isAlignedTo(4))
+    TEST_ASSERT(KnownAlignment::getAlignment(index).isAlignedTo(4))
+    TEST_ASSERT(KnownAlignment::getAlignment(address).isAlignedTo(4))
+    TEST_ASSERT(!KnownAlignment::getAlignment(address).isAlignedTo(8))
+    TEST_ASSERT(!KnownAlignment::getAlignment(upperHalf).isAlignedTo(4))
+    uint32_t offset = 0;
+    TEST_ASSERT(KnownAlignment::getAlignment(upperHalf).getOffsetTo(4, offset))
+    TEST_ASSERT_EQUALS(2u, offset)
+    TEST_ASSERT(KnownAlignment::getAlignment(masked).isAlignedTo(8))
+    TEST_ASSERT(KnownAlignment::getAlignment(product).isAlignedTo(4))
+    TEST_ASSERT(!KnownAlignment::getAlignment(product).isAlignedTo(8))
+    // 8 and 24 are both 8 more than a multiple of 16
+    TEST_ASSERT(KnownAlignment::getAlignment(multiple).isAlignedTo(8))
+    TEST_ASSERT(KnownAlignment::getAlignment(multiple).getOffsetTo(16, offset))
+    TEST_ASSERT_EQUALS(8u, offset)
+}
+
+void TestOptimizationSteps::testOptimizerStatistics()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    config.optimizationLevel = OptimizationLevel::NONE;
+    config.additionalEnabledOptimizations = {"remove-unused-flags", "eliminate-dead-code"};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto dead = assign(it, TYPE_INT32, "%dead") = in + 7_val;
+    auto deadWriter = dead.getSingleWriter();
+
+    // modifying an instruction in-place changes its fingerprint
+    auto fingerprint = deadWriter->getFingerprint();
+    TEST_ASSERT_EQUALS(fingerprint, deadWriter->getFingerprint())
+    const_cast<IntermediateInstruction*>(deadWriter)->setArgument(1, 5_val);
+    TEST_ASSERT(fingerprint != deadWriter->getFingerprint())
+
+    optimizations::Optimizer optimizer(config);
+    auto statistics = optimizer.optimizeMethod(module, method);
+    TEST_ASSERT(dead.local()->getUsers(LocalUse::Type::WRITER).empty())
+
+    // iteration 1: RemoveFlags (no change), EliminateDeadCode (change)
+    // iteration 2: RemoveFlags (no change), stop before EliminateDeadCode
+    TEST_ASSERT_EQUALS(2u, statistics.numIterations)
+    const auto& deadCodeStatistics = statistics.passes.at("EliminateDeadCode");
+    TEST_ASSERT_EQUALS(1u, deadCodeStatistics.numRuns)
+    TEST_ASSERT_EQUALS(1u, deadCodeStatistics.numChanges)
+    const auto& flagStatistics = statistics.passes.at("RemoveFlags");
+    TEST_ASSERT_EQUALS(2u, flagStatistics.numRuns)
+    TEST_ASSERT_EQUALS(0u, flagStatistics.numChanges)
+
+    // nothing left to optimize, no pass modifies the method
+    statistics = optimizer.optimizeMethod(module, method);
+    TEST_ASSERT_EQUALS(1u, statistics.numIterations)
+    TEST_ASSERT_EQUALS(0u, statistics.passes.at("EliminateDeadCode").numChanges)
+}
+
+static void createBitSelections(Method& method, const std::string& blockName, unsigned numSelections)
+{
+    using namespace vc4c::intermediate;
+    auto& block = method.createAndInsertNewBlock(method.end(), blockName);
+    auto it = block.walkEnd();
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto y = assign(it, TYPE_INT32, "%y") = UNIFORM_REGISTER;
+    auto mask = assign(it, TYPE_INT32, "%mask") = UNIFORM_REGISTER;
+    for(unsigned i = 0; i < numSelections; ++i)
+    {
+        // (x & ~mask) | (y & mask), which is rewritten to x ^ ((x ^ y) & mask) with new locals for the temporaries
+        auto invertedMask = assign(it, TYPE_INT32, "%inverted_mask") = ~mask;
+        auto first = assign(it, TYPE_INT32, "%first") = x & invertedMask;
+        auto second = assign(it, TYPE_INT32, "%second") = mask & y;
+        auto selection = assign(it, TYPE_INT32, "%selection") = first | second;
+        assignNop(it) = selection;
+    }
+}
+
+static std::vector<std::string> getOperationSequence(const BasicBlock& block)
+{
+    std::vector<std::string> sequence;
+    for(const auto& inst : block)
+    {
+        if(auto op = dynamic_cast<const intermediate::Operation*>(inst.get()))
+            sequence.emplace_back(op->op.name);
+        else if(dynamic_cast<const intermediate::MoveOperation*>(inst.get()))
+            sequence.emplace_back("mov");
+        else if(inst)
+            sequence.emplace_back("other");
+    }
+    return sequence;
+}
+
+void TestOptimizationSteps::testParallelSingleSteps()
+{
+    using namespace vc4c::intermediate;
+    static constexpr unsigned NUM_BLOCKS = 8;
+    static constexpr unsigned NUM_SELECTIONS = 110;
+    Configuration config{};
+    config.optimizationLevel = OptimizationLevel::NONE;
+    config.additionalEnabledOptimizations = {"single-steps"};
+    Module module{config};
+    optimizations::Optimizer optimizer(config);
+
+    // a single block is too small for the parallel execution, so it is optimized serially as reference
+    Method serialMethod(module);
+    createBitSelections(serialMethod, "%block", NUM_SELECTIONS);
+    optimizer.optimizeMethod(module, serialMethod);
+    const auto expectedSequence = getOperationSequence(*serialMethod.begin());
+
+    // enough independent blocks and (not constant-folded) instructions for the single steps to be run in parallel
+    Method method(module);
+    for(unsigned i = 0; i < NUM_BLOCKS; ++i)
+        createBitSelections(method, "%block" + std::to_string(i), NUM_SELECTIONS);
+    TEST_ASSERT(method.countInstructions() >= 4096u)
+    optimizer.optimizeMethod(module, method);
+
+    std::size_t numBlocks = 0;
+    for(const auto& block : method)
+    {
+        ++numBlocks;
+        TEST_ASSERT(getOperationSequence(block) == expectedSequence)
+
+        // every selection is rewritten, creating new locals concurrently for all blocks
+        std::size_t numSelections = 0;
+        for(const auto& inst : block)
+        {
+            auto op = dynamic_cast<const Operation*>(inst.get());
+            TEST_ASSERT(!op || op->op != OP_OR)
+            if(op && op->op == OP_XOR && op->getArguments().size() == 2 && op->assertArgument(1).checkLocal() &&
+                op->assertArgument(1).local()->name.find("%bitselect") == 0)
+                ++numSelections;
+        }
+        TEST_ASSERT_EQUALS(NUM_SELECTIONS, numSelections)
+    }
+    TEST_ASSERT_EQUALS(NUM_BLOCKS, numBlocks)
+
+    // all new locals got unique names and are registered with the method
+    std::set<std::string> names;
+    for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+    {
+        if(it.has() && it->checkOutputLocal() && it->getOutput()->local()->name.find("%bitselect") == 0)
+        {
+            const auto* loc = it->getOutput()->local();
+            TEST_ASSERT(names.emplace(loc->name).second)
+            TEST_ASSERT(loc == method.findLocal(loc->name))
+        }
+    }
+    TEST_ASSERT_EQUALS(2u * NUM_BLOCKS * NUM_SELECTIONS, names.size())
+}
+
+void TestOptimizationSteps::testFillBranchDelaySlots()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& next = method.createAndInsertNewBlock(method.end(), "%next");
+    auto it = start.walkEnd();
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_INT32, "%a") = x + 1_val;
+    auto aWriter = it.copy().previousInBlock().get();
+    it.emplace(new Branch(next.getLabel()->getLabel()));
+    it.nextInBlock();
+    for(unsigned i = 0; i < 3; ++i)
+    {
+        it.emplace(new Nop(DelayType::BRANCH_DELAY));
+        it.nextInBlock();
+    }
+    it = next.walkEnd();
+    auto c = assign(it, TYPE_INT32, "%c") = x + 3_val;
+    auto cWriter = it.copy().previousInBlock().get();
+    assignNop(it) = a + c;
+
+    FastMap<const Local*, Register> registerMapping;
+    registerMapping.emplace(x.local(), REG_ACC0);
+    registerMapping.emplace(a.local(), Register{RegisterFile::PHYSICAL_A, 1});
+    registerMapping.emplace(c.local(), Register{RegisterFile::PHYSICAL_B, 2});
+    analysis::GlobalLivenessAnalysis liveness(false);
+    liveness(method);
+
+    TEST_ASSERT(optimizations::fillBranchDelaySlots(method, registerMapping, liveness))
+
+    // the write of %a is moved from above the branch, the write of %c from the exclusive successor
+    it = start.walk().nextInBlock();
+    TEST_ASSERT(it.get<MoveOperation>() && it->getOutput()->hasLocal(x.checkLocal()))
+    it.nextInBlock();
+    TEST_ASSERT(!!it.get<Branch>())
+    it.nextInBlock();
+    TEST_ASSERT_EQUALS(aWriter, it.get())
+    it.nextInBlock();
+    TEST_ASSERT_EQUALS(cWriter, it.get())
+    it.nextInBlock();
+    TEST_ASSERT(it.get<Nop>() && it.get<Nop>()->type == DelayType::BRANCH_DELAY)
+    it.nextInBlock();
+    TEST_ASSERT(it.isEndOfBlock())
+    TEST_ASSERT_EQUALS(2u, next.size())
+
+    // all delay slots are already filled
+    TEST_ASSERT(!optimizations::fillBranchDelaySlots(method, registerMapping, liveness))
+}
+
+void TestOptimizationSteps::testFillDelayNops()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_INT32, "%a") = x + 1_val;
+    auto aWriter = it.copy().previousInBlock().get();
+    it.emplace(new Nop(DelayType::WAIT_REGISTER));
+    it.nextInBlock();
+    auto d = assign(it, TYPE_INT32, "%d") = a + 2_val;
+    auto dWriter = it.copy().previousInBlock().get();
+    auto f = assign(it, TYPE_INT32, "%f") = x + 3_val;
+    auto fWriter = it.copy().previousInBlock().get();
+    assignNop(it) = f + 4_val;
+
+    FastMap<const Local*, Register> registerMapping;
+    registerMapping.emplace(x.local(), REG_ACC0);
+    registerMapping.emplace(a.local(), Register{RegisterFile::PHYSICAL_A, 1});
+    registerMapping.emplace(d.local(), Register{RegisterFile::PHYSICAL_B, 2});
+    registerMapping.emplace(f.local(), REG_ACC1);
+
+    TEST_ASSERT(optimizations::fillDelayNops(method, registerMapping, 8))
+
+    // the write of %f does not depend on the write of %a and is moved into the delay
+    it = block.walk().nextInBlock();
+    TEST_ASSERT(it.get<MoveOperation>() && it->getOutput()->hasLocal(x.checkLocal()))
+    it.nextInBlock();
+    TEST_ASSERT_EQUALS(aWriter, it.get())
+    it.nextInBlock();
+    TEST_ASSERT_EQUALS(fWriter, it.get())
+    it.nextInBlock();
+    TEST_ASSERT_EQUALS(dWriter, it.get())
+    TEST_ASSERT_EQUALS(6u, block.size())
+
+    // no more delay nops left
+    TEST_ASSERT(!optimizations::fillDelayNops(method, registerMapping, 8))
+}
+
+void TestOptimizationSteps::testIfConversion()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& thenBlock = method.createAndInsertNewBlock(method.end(), "%then");
+    auto& elseBlock = method.createAndInsertNewBlock(method.end(), "%else");
+    auto& successor = method.createAndInsertNewBlock(method.end(), "%successor");
+
+    auto it = start.walkEnd();
+    auto b = assign(it, TYPE_INT32, "%b") = UNIFORM_REGISTER;
+    auto cond = assign(it, TYPE_INT32, "%cond") = b & 1_val;
+    auto branchCondition = insertBranchCondition(method, it, cond);
+    it = branchCondition.first;
+    it.emplace(new Branch(thenBlock.getLabel()->getLabel(), branchCondition.second));
+    it.nextInBlock();
+    it.emplace(new Branch(elseBlock.getLabel()->getLabel(), branchCondition.second.invert()));
+
+    it = thenBlock.walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = b + 1_val;
+    auto c = method.addNewLocal(TYPE_INT32, "%c");
+    assign(it, c) = a;
+    it.emplace(new Branch(successor.getLabel()->getLabel()));
+
+    // falls through to the successor
+    it = elseBlock.walkEnd();
+    assign(it, c) = 42_val;
+
+    it = successor.walkEnd();
+    assignNop(it) = c;
+
+    TEST_ASSERT(optimizations::convertIfBlocks(module, method, config))
+    TEST_ASSERT_EQUALS(2u, method.size())
+
+    // the local %a is only used in the then-block, so it is written unconditionally
+    auto writer = a.getSingleWriter();
+    TEST_ASSERT(!!writer)
+    TEST_ASSERT(!writer->hasConditionalExecution())
+    // the local %c is written in both conditional blocks and is used in the successor
+    bool writtenIfZeroClear = false;
+    bool writtenIfZeroSet = false;
+    for(const auto& user : c.local()->getUsers())
+    {
+        if(!user.second.writesLocal())
+            continue;
+        auto ext = dynamic_cast<const ExtendedInstruction*>(user.first);
+        TEST_ASSERT(!!ext)
+        writtenIfZeroClear = writtenIfZeroClear || ext->getCondition() == COND_ZERO_CLEAR;
+        writtenIfZeroSet = writtenIfZeroSet || ext->getCondition() == COND_ZERO_SET;
+    }
+    TEST_ASSERT(writtenIfZeroClear)
+    TEST_ASSERT(writtenIfZeroSet)
+
+    for(auto& inst : start)
+        TEST_ASSERT(!dynamic_cast<const Branch*>(inst.get()))
+    TEST_ASSERT_EQUALS(&successor, method.getNextBlockAfter(&start))
+}
+
+void TestOptimizationSteps::testVectorizeElementOperations()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%dummy");
+    auto it = block.walkEnd();
+    auto vectorType = TYPE_INT32.toVectorType(4);
+    auto a = assign(it, vectorType, "%a") = UNIFORM_REGISTER;
+    auto b = assign(it, vectorType, "%b") = UNIFORM_REGISTER;
+    auto c = method.addNewLocal(vectorType, "%c");
+    for(unsigned i = 0; i < 4; ++i)
+    {
+        auto index = Value(Literal(i), TYPE_INT8);
+        auto elementA = method.addNewLocal(TYPE_INT32, "%a_elem");
+        it = insertVectorExtraction(it, method, a, index, elementA);
+        auto elementB = method.addNewLocal(TYPE_INT32, "%b_elem");
+        it = insertVectorExtraction(it, method, b, index, elementB);
+        auto result = assign(it, TYPE_INT32, "%c_elem") = elementA + elementB;
+        it = insertVectorInsertion(it, method, c, index, result);
+    }
+    assignNop(it) = c;
+
+    TEST_ASSERT(optimizations::vectorizeElementOperations(module, method, config))
+
+    auto writer = c.getSingleWriter();
+    TEST_ASSERT(!!writer)
+    auto op = dynamic_cast<const Operation*>(writer);
+    TEST_ASSERT(!!op)
+    TEST_ASSERT(op->op == OP_ADD)
+    TEST_ASSERT_EQUALS(a, op->getFirstArg())
+    TEST_ASSERT_EQUALS(b, op->assertArgument(1))
+    TEST_ASSERT(!op->hasConditionalExecution())
+    // the flags for the single element insertions are not used anymore
+    for(auto& inst : block)
+    {
+        if(inst && inst->doesSetFlag())
+            TEST_ASSERT(!inst->getOutput() || !inst->getOutput()->hasRegister(REG_NOP))
+    }
+}
+
+void TestOptimizationSteps::testProfileGuidedBlockOrder()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    method.name = "@profiled";
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& frequentBlock = method.createAndInsertNewBlock(method.end(), "%frequent");
+    auto& rareBlock = method.createAndInsertNewBlock(method.end(), "%rare");
+    auto& end = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = start.walkEnd();
+    auto cond = assign(it, TYPE_INT32, "%cond") = UNIFORM_REGISTER;
+    auto branchCondition = insertBranchCondition(method, it, cond);
+    it = branchCondition.first;
+    it.emplace(new Branch(rareBlock.getLabel()->getLabel(), branchCondition.second));
+    it.nextInBlock();
+    it.emplace(new Branch(frequentBlock.getLabel()->getLabel()));
+
+    it = frequentBlock.walkEnd();
+    assignNop(it) = cond + 1_val;
+    it.emplace(new Branch(end.getLabel()->getLabel()));
+
+    it = rareBlock.walkEnd();
+    assignNop(it) = cond + 2_val;
+    it.emplace(new Branch(end.getLabel()->getLabel()));
+
+    it = end.walkEnd();
+    assignNop(it) = cond;
+
+    // the profile is stored as tab-separated kernel name, block label and number of executions
+    std::stringstream profile;
+    profile << "profiled\t%start\t12\n"
+            << "profiled\t%frequent\t9\n"
+            << "profiled\t%rare\t1\n"
+            << "profiled\t%rare\t2\n"
+            << "profiled\t%end\t12\n";
+    module.executionProfile.readFrom(profile);
+    TEST_ASSERT_EQUALS(9u, module.executionProfile.getBlockFrequency(method, frequentBlock).value())
+    TEST_ASSERT_EQUALS(3u, module.executionProfile.getBlockFrequency(method, rareBlock).value())
+    TEST_ASSERT(!module.executionProfile.isNeverExecuted(method, rareBlock))
+
+    std::stringstream written;
+    module.executionProfile.writeTo(written);
+    analysis::ExecutionProfile readBack;
+    readBack.readFrom(written);
+    TEST_ASSERT_EQUALS(12u, readBack.getBlockFrequency(method, end).value())
+
+    // without the profile, the rare block would be moved directly behind its single predecessor
+    optimizations::reorderBasicBlocks(module, method, config);
+    TEST_ASSERT_EQUALS(&frequentBlock, method.getNextBlockAfter(&start))
+    TEST_ASSERT_EQUALS(&end, method.getNextBlockAfter(&frequentBlock))
+    TEST_ASSERT_EQUALS(&rareBlock, method.getNextBlockAfter(&end))
+}
+
+void TestOptimizationSteps::testTailDuplication()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& left = method.createAndInsertNewBlock(method.end(), "%left");
+    auto& right = method.createAndInsertNewBlock(method.end(), "%right");
+    auto& tail = method.createAndInsertNewBlock(method.end(), "%tail");
+    auto& end = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = start.walkEnd();
+    auto cond = assign(it, TYPE_INT32, "%cond") = UNIFORM_REGISTER;
+    auto branchCondition = insertBranchCondition(method, it, cond);
+    it = branchCondition.first;
+    it.emplace(new Branch(left.getLabel()->getLabel(), branchCondition.second));
+    it.nextInBlock();
+    it.emplace(new Branch(right.getLabel()->getLabel()));
+
+    it = left.walkEnd();
+    assignNop(it) = cond + 1_val;
+    it.emplace(new Branch(tail.getLabel()->getLabel()));
+
+    it = right.walkEnd();
+    assignNop(it) = cond + 2_val;
+    it.emplace(new Branch(tail.getLabel()->getLabel()));
+
+    it = tail.walkEnd();
+    auto tmp = assign(it, TYPE_INT32, "%tmp") = cond + 3_val;
+    assignNop(it) = tmp;
+    it.emplace(new Branch(end.getLabel()->getLabel()));
+
+    it = end.walkEnd();
+    assignNop(it) = cond;
+
+    optimizations::reorderBasicBlocks(module, method, config);
+
+    // only one of the predecessors of the tail block can be placed in front of it, the other gets a copy of it
+    TEST_ASSERT_EQUALS(&tail, method.getNextBlockAfter(&left))
+    auto lastIt = right.walkEnd().previousInBlock();
+    TEST_ASSERT(lastIt.get<Branch>() != nullptr)
+    TEST_ASSERT_EQUALS(end.getLabel()->getLabel(), lastIt.get<Branch>()->getTarget())
+    bool hasCopiedLocal = false;
+    for(auto& inst : right)
+    {
+        TEST_ASSERT(!inst || !inst->readsLocal(tmp.checkLocal()))
+        auto out = inst ? inst->checkOutputLocal() : nullptr;
+        hasCopiedLocal = hasCopiedLocal || (out && out->name.find("%tail") == 0);
+    }
+    TEST_ASSERT(hasCopiedLocal)
+    // the original block is still reached from the other predecessor
+    TEST_ASSERT(tmp.local()->getSingleWriter() != nullptr)
+}
+
+void TestOptimizationSteps::testStrengthReduction()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& loop = method.createAndInsertNewBlock(method.end(), "%loop");
+    auto& end = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = start.walkEnd();
+    auto base = assign(it, TYPE_INT32, "%base") = UNIFORM_REGISTER;
+    auto i = method.addNewLocal(TYPE_INT32, "%i");
+    assign(it, i) = (0_val, InstructionDecorations::PHI_NODE);
+
+    // %addr = %base + %i * 4
+    it = loop.walkEnd();
+    auto offset = assign(it, TYPE_INT32, "%offset") = i << 2_val;
+    auto addr = assign(it, TYPE_INT32, "%addr") = base + offset;
+    assignNop(it) = addr;
+    auto next = assign(it, TYPE_INT32, "%i.next") = i + 1_val;
+    assign(it, i) = (next, InstructionDecorations::PHI_NODE);
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(loop.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(end.getLabel()->getLabel(), cond.invert()));
+
+    TEST_ASSERT(optimizations::reduceStrengthInLoops(module, method, config))
+
+    // the address is copied from the running value, which is initialized before and incremented inside of the loop
+    auto move = dynamic_cast<const MoveOperation*>(addr.getSingleWriter());
+    TEST_ASSERT(!!move)
+    if(!move)
+        return;
+    auto runningValue = move->getSource().checkLocal();
+    TEST_ASSERT(!!runningValue)
+    if(!runningValue)
+        return;
+    unsigned numWritesBefore = 0;
+    unsigned numWritesInside = 0;
+    for(auto writer : runningValue->getUsers(LocalUse::Type::WRITER))
+    {
+        for(auto& inst : start)
+            numWritesBefore += inst.get() == writer ? 1 : 0;
+        for(auto& inst : loop)
+        {
+            if(inst.get() != writer)
+                continue;
+            ++numWritesInside;
+            auto op = dynamic_cast<const Operation*>(writer);
+            TEST_ASSERT(op && op->op == OP_ADD)
+            TEST_ASSERT(op && op->assertArgument(1).getLiteralValue().value_or(Literal(0)) == Literal(4))
+        }
+    }
+    TEST_ASSERT_EQUALS(1u, numWritesBefore)
+    TEST_ASSERT_EQUALS(1u, numWritesInside)
+}
+
+void TestOptimizationSteps::testLoopInvariantCodeMotion()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& loop = method.createAndInsertNewBlock(method.end(), "%loop");
+    auto& end = method.createAndInsertNewBlock(method.end(), "%end");
+
+    auto it = start.walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = UNIFORM_REGISTER;
+
+    it = loop.walkEnd();
+    auto b = assign(it, TYPE_INT32, "%b") = a + 1_val;
+    auto c = assign(it, TYPE_INT32, "%c") = b << 2_val;
+    // reading an UNIFORM has side-effects and therefore cannot be moved
+    auto d = assign(it, TYPE_INT32, "%d") = UNIFORM_REGISTER;
+    auto e = assign(it, TYPE_INT32, "%e") = c + d;
+    assignNop(it) = e;
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(loop.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(end.getLabel()->getLabel(), cond.invert()));
+
+    TEST_ASSERT(optimizations::moveLoopInvariantCode(module, method, config))
+
+    auto isInBlock = [](const BasicBlock& block, const LocalUser* inst) -> bool {
+        return std::any_of(block.begin(), block.end(),
+            [&](const auto& i) -> bool { return i.get() == inst; });
+    };
+    TEST_ASSERT(isInBlock(start, b.getSingleWriter()))
+    TEST_ASSERT(isInBlock(start, c.getSingleWriter()))
+    TEST_ASSERT(isInBlock(loop, d.getSingleWriter()))
+    TEST_ASSERT(isInBlock(loop, e.getSingleWriter()))
+    // the instructions are moved in order of their dependencies
+    auto bIt = std::find_if(start.begin(), start.end(),
+        [&](const auto& i) -> bool { return i.get() == b.getSingleWriter(); });
+    auto cIt = std::find_if(start.begin(), start.end(),
+        [&](const auto& i) -> bool { return i.get() == c.getSingleWriter(); });
+    TEST_ASSERT(std::distance(start.begin(), bIt) < std::distance(start.begin(), cIt))
+}
+
+void TestOptimizationSteps::testSingleStepDispatch()
+{
+    using namespace vc4c::intermediate;
+    using optimizations::OptimizationStep;
+    using optimizations::StepTarget;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto moveIt = it.copy().previousInBlock();
+    auto out = assign(it, TYPE_INT32, "%out") = (in + 7_val, SetFlag::SET_FLAGS);
+    auto operationIt = it.copy().previousInBlock();
+    assign(it, Value(REG_SFU_EXP2, TYPE_FLOAT)) = out;
+    auto sfuIt = it.copy().previousInBlock();
+
+    TEST_ASSERT(StepTarget::MOVE == OptimizationStep::classify(moveIt))
+    TEST_ASSERT(add_flag(StepTarget::OPERATION, StepTarget::SETS_FLAGS) == OptimizationStep::classify(operationIt))
+    TEST_ASSERT(add_flag(StepTarget::MOVE, StepTarget::WRITES_SFU) == OptimizationStep::classify(sfuIt))
+    TEST_ASSERT(StepTarget::ANY == OptimizationStep::classify(block.walk()))
+
+    auto step = [](const Module&, Method&, InstructionWalker it, const Configuration&) -> InstructionWalker {
+        return it;
+    };
+    OptimizationStep anyStep("Any", step);
+    OptimizationStep flagStep("Flags", step, StepTarget::SETS_FLAGS);
+    OptimizationStep arithmeticStep("Arithmetic", step, add_flag(StepTarget::MOVE, StepTarget::OPERATION));
+    TEST_ASSERT(anyStep.isApplicableTo(StepTarget::ANY))
+    TEST_ASSERT(!flagStep.isApplicableTo(OptimizationStep::classify(moveIt)))
+    TEST_ASSERT(flagStep.isApplicableTo(OptimizationStep::classify(operationIt)))
+    TEST_ASSERT(arithmeticStep.isApplicableTo(OptimizationStep::classify(moveIt)))
+    TEST_ASSERT(arithmeticStep.isApplicableTo(OptimizationStep::classify(sfuIt)))
+    TEST_ASSERT(!arithmeticStep.isApplicableTo(OptimizationStep::classify(block.walk())))
+}
+
+void TestOptimizationSteps::testWorkGroupLoopUniforms()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& param = method.addParameter(Parameter("%in", TYPE_INT32));
+
+    auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+    auto it = block.walkEnd();
+    auto offset = assign(it, TYPE_INT32, "%offset") = param.createReference() + 4_val;
+    auto groupId = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_X)->createReference();
+    auto index = assign(it, TYPE_INT32, "%index") = groupId + offset;
+    assignNop(it) = index;
+    method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
+
+    optimizations::addStartStopSegment(module, method, config);
+    TEST_ASSERT(optimizations::addWorkGroupLoop(module, method, config))
+
+    auto& startBlock = *method.begin();
+    auto isInStartBlock = [&](const LocalUser* inst) -> bool {
+        return std::any_of(
+            startBlock.begin(), startBlock.end(), [&](const auto& i) -> bool { return i.get() == inst; });
+    };
+    // the parameter and the calculation only depending on it are the same for all work-groups
+    TEST_ASSERT(isInStartBlock(param.getSingleWriter()))
+    TEST_ASSERT(isInStartBlock(offset.getSingleWriter()))
+    TEST_ASSERT(!isInStartBlock(index.getSingleWriter()))
+    // all UNIFORMs are read only once, so the UNIFORM pointer is never reset
+    for(auto& bb : method)
+    {
+        for(auto& inst : bb)
+        {
+            TEST_ASSERT(!inst || !inst->writesRegister(REG_UNIFORM_ADDRESS))
+            TEST_ASSERT(!inst || !inst->readsRegister(REG_UNIFORM) || &bb == &startBlock)
+        }
+    }
+}
+
+void TestOptimizationSteps::testDynamicWorkDistribution()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    config.distributeWorkItemsDynamically = true;
+    Module module{config};
+
+    auto createKernel = [&](Method& method, AddressSpace addressSpace) {
+        auto& param = method.addParameter(Parameter("%in", method.createPointerType(TYPE_INT32, addressSpace)));
+        auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+        auto it = block.walkEnd();
+        auto localIds = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_IDS)->createReference();
+        auto groupId = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_X)->createReference();
+        auto index = assign(it, TYPE_INT32, "%index") = groupId + localIds;
+        assignNop(it) = param.createReference() + index;
+        method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
+
+        optimizations::addStartStopSegment(module, method, config);
+        TEST_ASSERT(optimizations::addWorkGroupLoop(module, method, config))
+    };
+    auto countInstructions = [](Method& method, const std::function<bool(const IntermediateInstruction&)>& pred) {
+        std::size_t count = 0;
+        for(auto it = method.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+            count += it.has() && pred(*it.get()) ? 1 : 0;
+        return count;
+    };
+
+    {
+        Method method(module);
+        createKernel(method, AddressSpace::GLOBAL);
+
+        // the work-items are fetched from the counter in VPM under the hardware mutex
+        TEST_ASSERT_EQUALS(1u, method.vpm->countAreas(periphery::VPMUsage::LOCAL_MEMORY))
+        TEST_ASSERT(countInstructions(method, [](const IntermediateInstruction& inst) -> bool {
+            return dynamic_cast<const MutexLock*>(&inst);
+        }) >= 4)
+        TEST_ASSERT_EQUALS(2u, countInstructions(method, [](const IntermediateInstruction& inst) -> bool {
+            return dynamic_cast<const SemaphoreAdjustment*>(&inst);
+        }))
+        // the local and group IDs are calculated from the fetched work-item, not read from the UNIFORMs
+        auto& startBlock = *method.begin();
+        for(auto type : {BuiltinLocal::Type::LOCAL_IDS, BuiltinLocal::Type::GROUP_ID_X})
+        {
+            method.findBuiltin(type)->forUsers(LocalUse::Type::WRITER, [&](const LocalUser* writer) {
+                TEST_ASSERT(!writer->readsRegister(REG_UNIFORM))
+            });
+        }
+        for(auto& bb : method)
+        {
+            for(auto& inst : bb)
+            {
+                TEST_ASSERT(!inst || !inst->writesRegister(REG_UNIFORM_ADDRESS))
+                TEST_ASSERT(!inst || !inst->readsRegister(REG_UNIFORM) || &bb == &startBlock)
+            }
+        }
+        const auto& uniformsUsed = method.metaData.uniformsUsed;
+        TEST_ASSERT(uniformsUsed.getLocalSizesUsed())
+        TEST_ASSERT(uniformsUsed.getLocalIDsUsed())
+        TEST_ASSERT(!uniformsUsed.getGroupIDXUsed())
+        TEST_ASSERT(uniformsUsed.getMaxGroupIDZUsed())
+    }
+
+    {
+        // work-items accessing local memory need to be executed at the same time, so keep the static loop
+        Method method(module);
+        createKernel(method, AddressSpace::LOCAL);
+        TEST_ASSERT_EQUALS(0u, method.vpm->countAreas(periphery::VPMUsage::LOCAL_MEMORY))
+        TEST_ASSERT_EQUALS(0u, countInstructions(method, [](const IntermediateInstruction& inst) -> bool {
+            return dynamic_cast<const MutexLock*>(&inst);
+        }))
+    }
+}
+
+void TestOptimizationSteps::testPrecomputedUniforms()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    config.precomputeUniformValues = true;
+    Module module{config};
+    Method method(module);
+    auto& param = method.addParameter(Parameter("%in", TYPE_INT32));
+
+    auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+    auto it = block.walkEnd();
+    auto localSizes = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_SIZES)->createReference();
+    auto numGroups = method.findOrCreateBuiltin(BuiltinLocal::Type::NUM_GROUPS_X)->createReference();
+    auto groupId = method.findOrCreateBuiltin(BuiltinLocal::Type::GROUP_ID_X)->createReference();
+    auto localSize = assign(it, TYPE_INT8, "%local_size") = localSizes & 255_val;
+    auto globalSize = assign(it, TYPE_INT32, "%global_size") = mul24(localSize, numGroups);
+    auto stride = assign(it, TYPE_INT32, "%stride") = param.createReference() << 2_val;
+    auto index = assign(it, TYPE_INT32, "%index") = groupId + globalSize;
+    assignNop(it) = index + stride;
+    method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
+
+    optimizations::addStartStopSegment(module, method, config);
+
+    // the global size and the stride are read from UNIFORMs, the group ID still needs to be read
+    const auto& uniformsUsed = method.metaData.uniformsUsed;
+    TEST_ASSERT_EQUALS(2u, static_cast<unsigned>(uniformsUsed.getNumPrecomputedValues()))
+    TEST_ASSERT_EQUALS(2u, method.metaData.precomputedUniforms.size())
+    TEST_ASSERT(!uniformsUsed.getLocalSizesUsed())
+    TEST_ASSERT(!uniformsUsed.getNumGroupsXUsed())
+    TEST_ASSERT(uniformsUsed.getGroupIDXUsed())
+    TEST_ASSERT(globalSize.getSingleWriter()->readsRegister(REG_UNIFORM))
+    TEST_ASSERT(stride.getSingleWriter()->readsRegister(REG_UNIFORM))
+    TEST_ASSERT(localSize.local()->getUsers().empty())
+
+    std::array<uint32_t, 8> workInfo = {1, (1u << 16) | (1u << 8) | 8u, 4, 1, 1, 0, 0, 0};
+    TEST_ASSERT_EQUALS(32u, method.metaData.precomputedUniforms[0].evaluate(workInfo, {3}))
+    TEST_ASSERT_EQUALS(12u, method.metaData.precomputedUniforms[1].evaluate(workInfo, {3}))
+}
+
+void TestOptimizationSteps::testWorkItemCoarsening()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    auto createKernel = [&](Method& method, bool withFlags) -> Value {
+        method.metaData.workGroupSizes = {32, 1, 1};
+        auto ptrType = method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL);
+        auto& in = method.addParameter(Parameter("%in", ptrType));
+        auto& out = method.addParameter(Parameter("%out", ptrType));
+
+        auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+        auto it = block.walkEnd();
+        auto localIds = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_IDS)->createReference();
+        auto lid = method.addNewLocal(TYPE_INT32, "%lid");
+        it.emplace((new MoveOperation(lid, localIds))
+                       ->setUnpackMode(UNPACK_8A_32)
+                       ->addDecorations(add_flag(
+                           InstructionDecorations::BUILTIN_LOCAL_ID, InstructionDecorations::UNSIGNED_RESULT)));
+        it.nextInBlock();
+        auto offset = assign(it, TYPE_INT32, "%offset") = lid << 2_val;
+        auto inAddr = assign(it, in.type, "%in_addr") = in.createReference() + offset;
+        auto outAddr = assign(it, out.type, "%out_addr") = out.createReference() + offset;
+        auto val = method.addNewLocal(TYPE_INT32, "%val");
+        it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val), Value(inAddr)));
+        it.nextInBlock();
+        auto result = assign(it, TYPE_INT32, "%result") = val + 1_val;
+        if(withFlags)
+            // the flags would differ between the work-items
+            assign(it, NOP_REGISTER) = (result, SetFlag::SET_FLAGS);
+        it.emplace(new MemoryInstruction(MemoryOperation::WRITE, Value(outAddr), Value(result)));
+        method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
+        return result;
+    };
+
+    {
+        Method method(module);
+        auto result = createKernel(method, false);
+        TEST_ASSERT(normalization::coarsenWorkItems(module, method, config))
+        TEST_ASSERT_EQUALS(16u, method.metaData.workItemsPerQPU)
+        // the values loaded and calculated differ per work-item, the addresses only by their stride
+        TEST_ASSERT_EQUALS(16u, result.local()->type.getVectorWidth())
+        bool hasScaledLocalId = false;
+        for(auto& inst : *method.begin())
+        {
+            auto op = dynamic_cast<const Operation*>(inst.get());
+            if(op && op->op == OP_SHL && op->getOutput()->checkLocal() &&
+                op->getOutput()->local()->name == "%lid" && op->assertArgument(1).getLiteralValue() &&
+                op->assertArgument(1).getLiteralValue()->unsignedInt() == 4u)
+                hasScaledLocalId = true;
+            auto mem = dynamic_cast<const MemoryInstruction*>(inst.get());
+            if(mem && mem->op == MemoryOperation::READ)
+                TEST_ASSERT_EQUALS(16u, mem->getSourceElementType().getVectorWidth())
+            if(mem && mem->op == MemoryOperation::WRITE)
+            {
+                TEST_ASSERT_EQUALS(16u, mem->getDestinationElementType().getVectorWidth())
+                TEST_ASSERT_EQUALS(16u, mem->getSource().type.getVectorWidth())
+            }
+        }
+        TEST_ASSERT(hasScaledLocalId)
+    }
+
+    {
+        Method method(module);
+        auto result = createKernel(method, true);
+        TEST_ASSERT(!normalization::coarsenWorkItems(module, method, config))
+        TEST_ASSERT_EQUALS(1u, method.metaData.workItemsPerQPU)
+        TEST_ASSERT_EQUALS(1u, result.local()->type.getVectorWidth())
+    }
+
+    {
+        // table lookups from read-only memory are converted to TMU gathers
+        Method method(module);
+        method.metaData.workGroupSizes = {16, 1, 1};
+        auto ptrType = method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL);
+        auto& in = method.addParameter(Parameter("%in", ptrType));
+        auto& table = method.addParameter(Parameter(
+            "%table", method.createPointerType(TYPE_INT8, AddressSpace::CONSTANT), ParameterDecorations::READ_ONLY));
+        auto& out = method.addParameter(Parameter("%out", ptrType));
+
+        auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+        auto it = block.walkEnd();
+        auto localIds = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_IDS)->createReference();
+        auto lid = method.addNewLocal(TYPE_INT32, "%lid");
+        it.emplace((new MoveOperation(lid, localIds))->setUnpackMode(UNPACK_8A_32));
+        it.nextInBlock();
+        auto offset = assign(it, TYPE_INT32, "%offset") = lid << 2_val;
+        auto inAddr = assign(it, in.type, "%in_addr") = in.createReference() + offset;
+        auto index = method.addNewLocal(TYPE_INT32, "%index");
+        it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(index), Value(inAddr)));
+        it.nextInBlock();
+        auto tableAddr = assign(it, table.type, "%table_addr") = table.createReference() + index;
+        auto entry = method.addNewLocal(TYPE_INT8, "%entry");
+        it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(entry), Value(tableAddr)));
+        it.nextInBlock();
+        auto result = assign(it, TYPE_INT32, "%result") = entry + 1_val;
+        auto outAddr = assign(it, out.type, "%out_addr") = out.createReference() + offset;
+        it.emplace(new MemoryInstruction(MemoryOperation::WRITE, Value(outAddr), Value(result)));
+        method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
+
+        TEST_ASSERT(normalization::coarsenWorkItems(module, method, config))
+        TEST_ASSERT_EQUALS(16u, entry.local()->type.getVectorWidth())
+        bool hasTableRead = false;
+        bool hasGather = false;
+        for(auto& inst : *method.begin())
+        {
+            auto mem = dynamic_cast<const MemoryInstruction*>(inst.get());
+            if(mem && mem->getSource().hasLocal(tableAddr.checkLocal()))
+                hasTableRead = true;
+            if(inst && (inst->writesRegister(REG_TMU0_ADDRESS) || inst->writesRegister(REG_TMU1_ADDRESS)))
+                hasGather = true;
+        }
+        TEST_ASSERT(!hasTableRead)
+        TEST_ASSERT(hasGather)
+        TEST_ASSERT(has_flag(table.decorations, ParameterDecorations::INPUT))
+    }
+}
+
+void TestOptimizationSteps::testPairALUOperations()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto x = assign(it, TYPE_FLOAT, "%x") = UNIFORM_REGISTER;
+    auto y = assign(it, TYPE_FLOAT, "%y") = UNIFORM_REGISTER;
+    auto z = assign(it, TYPE_FLOAT, "%z") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_FLOAT, "%a") = as_float{x} + as_float{y};
+    // depends on the previous instruction and can therefore not be combined with it
+    auto b = assign(it, TYPE_FLOAT, "%b") = as_float{a} + as_float{z};
+    // independent of the previous instruction, can be moved up to be combined with the first addition
+    auto c = assign(it, TYPE_FLOAT, "%c") = as_float{x} * as_float{y};
+
+    TEST_ASSERT(!optimizations::combineOperations(module, method, config))
+    TEST_ASSERT(optimizations::pairALUOperations(module, method, config))
+
+    auto combIt = block.walk().nextInBlock().nextInBlock().nextInBlock().nextInBlock();
+    auto comb = combIt.get<CombinedOperation>();
+    TEST_ASSERT(comb != nullptr)
+    if(comb)
+    {
+        TEST_ASSERT(comb->getFirstOp()->writesLocal(a.checkLocal()))
+        TEST_ASSERT(comb->getSecondOP()->writesLocal(c.checkLocal()))
+    }
+    TEST_ASSERT(combIt.nextInBlock().has() && combIt->writesLocal(b.checkLocal()))
+    TEST_ASSERT(combIt.nextInBlock().isEndOfBlock())
+}
+
+void TestOptimizationSteps::testSimplifyExpressionTrees()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto y = assign(it, TYPE_INT32, "%y") = UNIFORM_REGISTER;
+
+    {
+        // (x + 1) + (y + 2) = (x + y) + 3
+        auto left = std::make_shared<Expression>(OP_ADD, x, 1_val);
+        auto right = std::make_shared<Expression>(OP_ADD, y, 2_val);
+        auto expr = std::make_shared<Expression>(OP_ADD, left, right);
+        auto simplified = expr->simplify(&method);
+        TEST_ASSERT_EQUALS(OP_ADD, simplified->code)
+        TEST_ASSERT(simplified->arg1.getLiteralValue() && simplified->arg1.getLiteralValue()->signedInt() == 3)
+        auto inner = simplified->arg0.checkExpression();
+        TEST_ASSERT(inner && inner->code == OP_ADD && inner->arg0.checkLocal() == x.local() &&
+            inner->arg1.checkLocal() == y.checkLocal())
+    }
+
+    // ((x + 1) << 2) + 4 + y = ((x << 2) + 8) + y
+    auto a = assign(it, TYPE_INT32, "%a") = x + 1_val;
+    auto b = assign(it, TYPE_INT32, "%b") = a << 2_val;
+    auto c = assign(it, TYPE_INT32, "%c") = b + 4_val;
+    auto d = assign(it, TYPE_INT32, "%d") = c + y;
+    // (x >> 24) & 0xFF = x >> 24
+    auto e = assign(it, TYPE_INT32, "%e") = as_unsigned{x} >> 24_val;
+    auto f = assign(it, TYPE_INT32, "%f") = e & 255_val;
+    assignNop(it) = d;
+    assignNop(it) = f;
+
+    TEST_ASSERT(optimizations::simplifyExpressionTrees(module, method, config))
+
+    auto dWriter = dynamic_cast<const Operation*>(d.getSingleWriter());
+    TEST_ASSERT(dWriter && dWriter->op == OP_ADD && dWriter->getSecondArg() == y)
+    if(dWriter)
+    {
+        auto constWriter = dynamic_cast<const Operation*>(dWriter->getFirstArg().getSingleWriter());
+        TEST_ASSERT(constWriter && constWriter->op == OP_ADD && constWriter->assertArgument(1).getLiteralValue() &&
+            constWriter->assertArgument(1).getLiteralValue()->signedInt() == 8)
+    }
+    auto fWriter = dynamic_cast<const Operation*>(f.getSingleWriter());
+    TEST_ASSERT(fWriter && fWriter->op == OP_SHR && fWriter->getFirstArg() == x)
+}
+
+void TestOptimizationSteps::testKernelSpecialization()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    config.kernelSpecializations.emplace_back(KernelSpecialization{"test", "test_4", {{0, 4}}});
+    Module module{config};
+
+    module.methods.emplace_back(new Method(module));
+    auto& kernel = *module.methods.back();
+    kernel.name = "@test";
+    kernel.isKernel = true;
+    auto& width = kernel.addParameter(Parameter("%width", TYPE_INT32));
+    auto& out = kernel.addParameter(Parameter("%out", kernel.createPointerType(TYPE_INT32, AddressSpace::GLOBAL)));
+    auto it = kernel.createAndInsertNewBlock(kernel.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+    auto val = assign(it, TYPE_INT32, "%val") = width.createReference() + 1_val;
+    it.emplace(new MemoryInstruction(MemoryOperation::WRITE, out.createReference(), Value(val)));
+
+    normalization::specializeKernels(module, config);
+
+    TEST_ASSERT_EQUALS(2u, module.methods.size())
+    auto& variant = *module.methods.back();
+    TEST_ASSERT_EQUALS("@test_4", variant.name)
+    TEST_ASSERT(variant.isKernel)
+    TEST_ASSERT_EQUALS(2u, variant.parameters.size())
+    // the bound parameter is still passed by the host, but no longer read
+    TEST_ASSERT_EQUALS(0u, variant.parameters[0].getUsers(LocalUse::Type::READER).size())
+    TEST_ASSERT_EQUALS(1u, variant.parameters[1].getUsers(LocalUse::Type::READER).size())
+    auto add = variant.begin()->walk().nextInBlock().get<Operation>();
+    TEST_ASSERT(add && add->op == OP_ADD && add->getFirstArg().getLiteralValue() &&
+        add->getFirstArg().getLiteralValue()->signedInt() == 4)
+    // the original kernel is unchanged
+    TEST_ASSERT_EQUALS(1u, width.getUsers(LocalUse::Type::READER).size())
+
+    // pointer parameters can not be bound to constants
+    Configuration pointerConfig{};
+    pointerConfig.kernelSpecializations.emplace_back(KernelSpecialization{"test", "test_ptr", {{1, 0}}});
+    TEST_THROWS(normalization::specializeKernels(module, pointerConfig), CompilationError);
+    // there is no such kernel
+    Configuration missingConfig{};
+    missingConfig.kernelSpecializations.emplace_back(KernelSpecialization{"foo", "foo_4", {{0, 4}}});
+    TEST_THROWS(normalization::specializeKernels(module, missingConfig), CompilationError);
+}
+
+void TestOptimizationSteps::testKernelVersions()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    KernelVersion version{"test", "test_fast"};
+    version.pointerAlignment = 16;
+    version.noAliasing = true;
+    version.workGroupSizes = {16, 0, 0};
+    config.kernelVersions.emplace_back(version);
+    Module module{config};
+
+    module.methods.emplace_back(new Method(module));
+    auto& kernel = *module.methods.back();
+    kernel.name = "@test";
+    kernel.isKernel = true;
+    auto& width = kernel.addParameter(Parameter("%width", TYPE_INT32));
+    auto& out = kernel.addParameter(Parameter("%out", kernel.createPointerType(TYPE_INT8, AddressSpace::GLOBAL)));
+    auto it = kernel.createAndInsertNewBlock(kernel.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+    auto val = assign(it, TYPE_INT8, "%val") = width.createReference() + 1_val;
+    it.emplace(new MemoryInstruction(MemoryOperation::WRITE, out.createReference(), Value(val)));
+
+    normalization::createKernelVersions(module, config);
+
+    TEST_ASSERT_EQUALS(2u, module.methods.size())
+    auto& copy = *module.methods.back();
+    TEST_ASSERT_EQUALS("@test_fast", copy.name)
+    TEST_ASSERT(copy.isKernel)
+    TEST_ASSERT_EQUALS(2u, copy.parameters.size())
+    // only the pointer parameters are affected by the assumptions
+    TEST_ASSERT(copy.parameters[0].type == TYPE_INT32)
+    TEST_ASSERT(!has_flag(copy.parameters[0].decorations, ParameterDecorations::RESTRICT))
+    TEST_ASSERT(has_flag(copy.parameters[1].decorations, ParameterDecorations::RESTRICT))
+    TEST_ASSERT_EQUALS(16u, copy.parameters[1].type.getPointerType()->getAlignment())
+    TEST_ASSERT(analysis::KnownAlignment::getAlignment(copy.parameters[1].createReference()).isAlignedTo(16))
+    TEST_ASSERT_EQUALS(16u, copy.metaData.workGroupSizes[0])
+    TEST_ASSERT_EQUALS(1u, copy.metaData.workGroupSizes[1])
+    TEST_ASSERT_EQUALS(1u, copy.metaData.workGroupSizes[2])
+    // the original kernel is the unchanged fallback
+    TEST_ASSERT_EQUALS(1u, out.type.getPointerType()->getAlignment())
+    TEST_ASSERT(!has_flag(out.decorations, ParameterDecorations::RESTRICT))
+    TEST_ASSERT(!kernel.metaData.isWorkGroupSizeSet())
+
+    // the alignment needs to be a power of two
+    Configuration alignmentConfig{};
+    alignmentConfig.kernelVersions.emplace_back(KernelVersion{"test", "test_odd", 12});
+    TEST_THROWS(normalization::createKernelVersions(module, alignmentConfig), CompilationError);
+    // the version name is already in use
+    TEST_THROWS(normalization::createKernelVersions(module, config), CompilationError);
+}
+
+void TestOptimizationSteps::testKernelDeduplication()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    auto createKernel = [&](const std::string& name, const std::string& suffix, uint32_t offset) -> Method& {
+        module.methods.emplace_back(new Method(module));
+        auto& kernel = *module.methods.back();
+        kernel.name = name;
+        kernel.isKernel = true;
+        auto& in = kernel.addParameter(Parameter("%in" + suffix, TYPE_INT32));
+        auto& out =
+            kernel.addParameter(Parameter("%out" + suffix, kernel.createPointerType(TYPE_INT32, AddressSpace::GLOBAL)));
+        auto it = kernel.createAndInsertNewBlock(kernel.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+        auto val = assign(it, TYPE_INT32, "%val" + suffix) = in.createReference() + Value(Literal(offset), TYPE_INT32);
+        it.emplace(new MemoryInstruction(MemoryOperation::WRITE, out.createReference(), Value(val)));
+        return kernel;
+    };
+    auto& first = createKernel("@add_rgba", "", 1);
+    // only differs in the names
+    auto& second = createKernel("@add_bgra", "_bgra", 1);
+    // differs in the code
+    createKernel("@add_argb", "_argb", 2);
+
+    auto duplicates = normalization::findDuplicateKernels(module, config);
+    TEST_ASSERT_EQUALS(1u, duplicates.size())
+    TEST_ASSERT(duplicates.find(&second) != duplicates.end())
+    TEST_ASSERT_EQUALS(&first, duplicates.at(&second))
+
+    // the execution profile is stored per kernel, so the kernels are kept separately
+    Configuration profileConfig{};
+    profileConfig.profileGenerateFile = "/tmp/profile";
+    TEST_ASSERT(normalization::findDuplicateKernels(module, profileConfig).empty())
+}
+
+void TestOptimizationSteps::testLongOperationFastPaths()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto it = method.createAndInsertNewBlock(method.begin(), "%dummy").walkEnd();
+
+    // zero-extended 16-bit value
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto a = method.addNewLocal(TYPE_INT64, "%a");
+    auto aData = a.local()->get<MultiRegisterData>();
+    assign(it, aData->lower->createReference()) = in & 0xFFFF_val;
+    assign(it, aData->upper->createReference()) = INT_ZERO;
+
+    // shift by constant offset of value with zero upper part
+    auto b = assign(it, TYPE_INT64, "%b") = a << 4_val;
+    normalization::lowerLongOperation(module, method, it.copy().previousInBlock(), config);
+    auto bData = b.local()->get<MultiRegisterData>();
+    auto lowWriter = dynamic_cast<const Operation*>(bData->lower->getSingleWriter());
+    TEST_ASSERT(lowWriter && lowWriter->op == OP_SHL && lowWriter->assertArgument(1).getLiteralValue() &&
+        lowWriter->assertArgument(1).getLiteralValue()->unsignedInt() == 4)
+    auto upWriter = dynamic_cast<const Operation*>(bData->upper->getSingleWriter());
+    TEST_ASSERT(upWriter && upWriter->op == OP_SHR && upWriter->getFirstArg() == aData->lower->createReference() &&
+        upWriter->assertArgument(1).getLiteralValue() &&
+        upWriter->assertArgument(1).getLiteralValue()->unsignedInt() == 28)
+
+    // addition without carry
+    auto c = assign(it, TYPE_INT64, "%c") = a + a;
+    normalization::lowerLongOperation(module, method, it.copy().previousInBlock(), config);
+    auto cData = c.local()->get<MultiRegisterData>();
+    lowWriter = dynamic_cast<const Operation*>(cData->lower->getSingleWriter());
+    TEST_ASSERT(lowWriter && lowWriter->op == OP_ADD && !lowWriter->doesSetFlag())
+    upWriter = dynamic_cast<const Operation*>(cData->upper->getSingleWriter());
+    TEST_ASSERT(upWriter && upWriter->op == OP_ADD && !upWriter->hasConditionalExecution())
+
+    // comparison against zero, only the zero flag is read
+    auto cond = assignNop(it) = as_unsigned{c} == as_unsigned{INT_ZERO};
+    auto flagIt = it.copy().previousInBlock();
+    auto res = assign(it, TYPE_BOOL, "%res") = (BOOL_TRUE, cond);
+    normalization::lowerLongOperation(module, method, flagIt, config);
+    // the lowered setting of flags is directly in front of the conditional write
+    TEST_ASSERT(res.getSingleWriter() == it.copy().previousInBlock().get())
+    auto setFlags = it.copy().previousInBlock().previousInBlock().get<Operation>();
+    TEST_ASSERT(setFlags && setFlags->op == OP_OR && setFlags->doesSetFlag() && setFlags->writesRegister(REG_NOP))
+}
+
+void TestOptimizationSteps::testMultiplicationNarrowing()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+    auto it = block.walkEnd();
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto localIds = method.findOrCreateBuiltin(BuiltinLocal::Type::LOCAL_IDS)->createReference();
+    auto lid = method.addNewLocal(TYPE_INT32, "%lid");
+    it.emplace((new MoveOperation(lid, localIds))
+                   ->setUnpackMode(UNPACK_8A_32)
+                   ->addDecorations(
+                       add_flag(InstructionDecorations::BUILTIN_LOCAL_ID, InstructionDecorations::UNSIGNED_RESULT)));
+    it.nextInBlock();
+    auto masked = assign(it, TYPE_INT32, "%masked") = in & 0xFFFF_val;
+
+    auto narrowed = method.addNewLocal(TYPE_INT32, "%narrowed");
+    it.emplace(new IntrinsicOperation("mul", Value(narrowed), Value(lid), Value(masked)));
+    intrinsics::intrinsify(module, method, it, config);
+    auto writer = dynamic_cast<const Operation*>(narrowed.local()->getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_MUL24)
+
+    // the full range of the input value might not fit into 24 bits
+    it = block.walkEnd();
+    auto full = method.addNewLocal(TYPE_INT32, "%full");
+    it.emplace(new IntrinsicOperation("mul", Value(full), Value(lid), Value(in)));
+    intrinsics::intrinsify(module, method, it, config);
+    writer = dynamic_cast<const Operation*>(full.local()->getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_ADD)
+}
+
+void TestOptimizationSteps::testCombineBitwiseIdioms()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto it = method.createAndInsertNewBlock(method.begin(), "%dummy").walkEnd();
+
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto y = assign(it, TYPE_INT32, "%y") = UNIFORM_REGISTER;
+    auto mask = assign(it, TYPE_INT32, "%mask") = UNIFORM_REGISTER;
+
+    // rotation by constant offset
+    auto a = assign(it, TYPE_INT32, "%a") = x << 7_val;
+    auto b = assign(it, TYPE_INT32, "%b") = as_unsigned{x} >> 25_val;
+    auto c = assign(it, TYPE_INT32, "%c") = a | b;
+    combineBitwiseOperations(module, method, it.copy().previousInBlock(), config);
+    auto rotation = dynamic_cast<const Operation*>(c.getSingleWriter());
+    TEST_ASSERT(rotation && rotation->op == OP_ROR && rotation->getFirstArg() == x &&
+        rotation->assertArgument(1).getLiteralValue() &&
+        rotation->assertArgument(1).getLiteralValue()->unsignedInt() == 25)
+
+    // bit-selection
+    auto invertedMask = assign(it, TYPE_INT32, "%inverted_mask") = ~mask;
+    auto d = assign(it, TYPE_INT32, "%d") = x & invertedMask;
+    auto e = assign(it, TYPE_INT32, "%e") = mask & y;
+    auto f = assign(it, TYPE_INT32, "%f") = d | e;
+    combineBitwiseOperations(module, method, it.copy().previousInBlock(), config);
+    auto selection = dynamic_cast<const Operation*>(f.getSingleWriter());
+    TEST_ASSERT(selection && selection->op == OP_XOR && selection->getFirstArg() == x)
+    auto masked = selection ? dynamic_cast<const Operation*>(selection->assertArgument(1).getSingleWriter()) : nullptr;
+    TEST_ASSERT(masked && masked->op == OP_AND && masked->assertArgument(1) == mask)
+    auto difference = masked ? dynamic_cast<const Operation*>(masked->getFirstArg().getSingleWriter()) : nullptr;
+    TEST_ASSERT(difference && difference->op == OP_XOR && difference->getFirstArg() == x &&
+        difference->assertArgument(1) == y)
+
+    // shifts whose results are used elsewhere are kept
+    auto g = assign(it, TYPE_INT32, "%g") = y << 3_val;
+    auto h = assign(it, TYPE_INT32, "%h") = as_unsigned{y} >> 29_val;
+    auto i = assign(it, TYPE_INT32, "%i") = g | h;
+    assignNop(it) = g;
+    combineBitwiseOperations(module, method, it.copy().previousInBlock().previousInBlock(), config);
+    auto unchanged = dynamic_cast<const Operation*>(i.getSingleWriter());
+    TEST_ASSERT(unchanged && unchanged->op == OP_OR)
+}
+
+void TestOptimizationSteps::testVPMAreaLifetimes()
+{
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    periphery::VPM vpm(config.target.availableVPMSize);
+
+    auto arrayType = method.createArrayType(TYPE_INT32.toVectorType(16), 4);
+    auto pointerType = method.createPointerType(arrayType, AddressSpace::LOCAL);
+    auto a = method.addNewLocal(pointerType, "%a").local();
+    auto b = method.addNewLocal(pointerType, "%b").local();
+    auto c = method.addNewLocal(pointerType, "%c").local();
+    auto d = method.addNewLocal(pointerType, "%d").local();
+
+    // wrap-around across the end of the kernel, when repeated for the next work-group
+    TEST_ASSERT((periphery::VPMAreaLifetime{0, 1, 3}.overlaps(periphery::VPMAreaLifetime{2, 2, 3})))
+    TEST_ASSERT(!(periphery::VPMAreaLifetime{0, 1, 4}.overlaps(periphery::VPMAreaLifetime{2, 2, 4})))
+
+    auto areaA = vpm.addArea(a, arrayType, false, NUM_QPUS, periphery::VPMAreaLifetime{0, 1, 4});
+    auto areaB = vpm.addArea(b, arrayType, false, NUM_QPUS, periphery::VPMAreaLifetime{2, 2, 4});
+    auto areaC = vpm.addArea(c, arrayType, false, NUM_QPUS, periphery::VPMAreaLifetime{1, 2, 4});
+    auto areaD = vpm.addArea(d, arrayType, false);
+    TEST_ASSERT(areaA && areaB && areaC && areaD)
+    if(!areaA || !areaB || !areaC || !areaD)
+        return;
+
+    // disjoint life-times share the rows
+    TEST_ASSERT_EQUALS(areaA->rowOffset, areaB->rowOffset)
+    TEST_ASSERT_EQUALS(areaA->numRows, areaB->numRows)
+    TEST_ASSERT_EQUALS(areaB, vpm.findArea(b))
+
+    // overlapping or unknown life-times do not
+    TEST_ASSERT(areaC->rowOffset + areaC->numRows <= areaA->rowOffset)
+    TEST_ASSERT(areaD->rowOffset + areaD->numRows <= areaC->rowOffset)
+}
+
+void TestOptimizationSteps::testOptimizeMutexRegions()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    auto index = assign(it, TYPE_INT32, "%index") = UNIFORM_REGISTER;
+    auto setup = assign(it, TYPE_INT32, "%setup") = UNIFORM_REGISTER;
+    auto c = assign(it, TYPE_FLOAT, "%c") = UNIFORM_REGISTER;
+    auto e = assign(it, TYPE_INT32, "%e") = UNIFORM_REGISTER;
+    auto f = assign(it, TYPE_INT32, "%f") = UNIFORM_REGISTER;
+
+    it.emplace(new MutexLock(MutexAccess::LOCK));
+    it.nextInBlock();
+    auto offset = assign(it, TYPE_INT32, "%offset") = index << 2_val;
+    assign(it, VPM_IN_SETUP_REGISTER) = setup + offset;
+    auto a = assign(it, TYPE_FLOAT, "%a") = VPM_IO_REGISTER;
+    ignoreReturnValue(assign(it, TYPE_FLOAT, "%b") = a + c);
+    it.emplace(new MutexLock(MutexAccess::RELEASE));
+    it.nextInBlock();
+    ignoreReturnValue(assign(it, TYPE_INT32, "%d") = e + 1_val);
+    it.emplace(new MutexLock(MutexAccess::LOCK));
+    it.nextInBlock();
+    assign(it, VPM_OUT_SETUP_REGISTER) = setup;
+    assign(it, VPM_IO_REGISTER) = f;
+    it.emplace(new MutexLock(MutexAccess::RELEASE));
+    it.nextInBlock();
+
+    TEST_ASSERT(optimizations::optimizeMutexRegions(module, method, config))
+
+    // the offset calculation is moved in front of the (single remaining) critical section
+    unsigned numLocks = 0;
+    unsigned numReleases = 0;
+    bool offsetCalculated = false;
+    for(auto& inst : block)
+    {
+        if(!inst)
+            continue;
+        if(auto mutex = dynamic_cast<const MutexLock*>(inst.get()))
+        {
+            numLocks += mutex->locksMutex() ? 1 : 0;
+            numReleases += mutex->releasesMutex() ? 1 : 0;
+            if(mutex->locksMutex())
+                TEST_ASSERT(offsetCalculated)
+        }
+        offsetCalculated = offsetCalculated || inst->writesLocal(offset.checkLocal());
+    }
+    TEST_ASSERT_EQUALS(1u, numLocks)
+    TEST_ASSERT_EQUALS(1u, numReleases)
+}
+
+void TestOptimizationSteps::testMemoryMappingOrder()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto smallType = method.createArrayType(TYPE_INT32, 32);
+    auto bigType = method.createArrayType(TYPE_INT32, 64);
+    module.globalData.emplace_back("%once", method.createPointerType(smallType, AddressSpace::LOCAL),
+        CompoundConstant(smallType, UNDEFINED_LITERAL), false);
+    auto& once = module.globalData.back();
+    module.globalData.emplace_back("%repeated", method.createPointerType(bigType, AddressSpace::LOCAL),
+        CompoundConstant(bigType, UNDEFINED_LITERAL), false);
+    auto& repeated = module.globalData.back();
+
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+    auto& loop = method.createAndInsertNewBlock(method.end(), "%loop");
+    auto& end = method.createAndInsertNewBlock(method.end(), "%end");
+
+    // the smaller buffer is accessed more often in the code, but only outside of the loop
+    auto it = start.walkEnd();
+    it.emplace(new MemoryInstruction(MemoryOperation::WRITE, once.createReference(), Value(INT_ZERO)));
+    it.nextInBlock();
+    it.emplace(new MemoryInstruction(MemoryOperation::WRITE, once.createReference(), Value(INT_ONE)));
+    it.nextInBlock();
+
+    it = loop.walkEnd();
+    auto val = method.addNewLocal(TYPE_INT32, "%val");
+    it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val), repeated.createReference()));
+    it.nextInBlock();
+    assignNop(it) = val;
+    BranchCond cond = BRANCH_ALWAYS;
+    std::tie(it, cond) = intermediate::insertBranchCondition(method, it, UNIFORM_REGISTER);
+    it.emplace(new Branch(loop.getLabel()->getLabel(), cond));
+    it.nextInBlock();
+    it.emplace(new Branch(end.getLabel()->getLabel(), cond.invert()));
+
+    auto accessInfo = normalization::determineMemoryAccess(method);
+    TEST_ASSERT_EQUALS(2u, accessInfo.memoryAccesses.size())
+    TEST_ASSERT(accessInfo.memoryAccesses.at(&once).preferred == analysis::MemoryAccessType::VPM_SHARED_ACCESS)
+    TEST_ASSERT(accessInfo.memoryAccesses.at(&repeated).preferred == analysis::MemoryAccessType::VPM_SHARED_ACCESS)
+
+    // the buffer accessed in the loop saves more costs per VPM row and therefore reserves its VPM area first
+    auto order = normalization::determineMappingOrder(method, accessInfo.memoryAccesses);
+    TEST_ASSERT_EQUALS(2u, order.size())
+    TEST_ASSERT_EQUALS(static_cast<const Local*>(&repeated), order.front())
+    TEST_ASSERT_EQUALS(static_cast<const Local*>(&once), order.back())
+}
+
+void TestOptimizationSteps::testMemoryDependencies()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto globalPtrType = method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL);
+    auto localPtrType = method.createPointerType(TYPE_INT32, AddressSpace::LOCAL);
+    auto& in = method.addParameter(Parameter("%in", globalPtrType));
+    auto& out = method.addParameter(Parameter("%out", globalPtrType));
+    auto& restricted = method.addParameter(Parameter("%restricted", globalPtrType, ParameterDecorations::RESTRICT));
+    auto& local = method.addParameter(Parameter("%local", localPtrType));
+    module.globalData.emplace_back("%buffer", localPtrType, CompoundConstant(TYPE_INT32, UNDEFINED_LITERAL), false);
+    auto& buffer = module.globalData.back();
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%dummy");
+    auto it = block.walkEnd();
+    auto makeAddress = [&](const Local& base, const Value& offset, std::string name) -> Value {
+        auto addr = assign(it, base.type, std::move(name)) = base.createReference() + offset;
+        const_cast<Local*>(addr.checkLocal())->set(ReferenceData(base, ANY_ELEMENT));
+        return addr;
+    };
+    auto index = assign(it, TYPE_INT32, "%index") = UNIFORM_REGISTER;
+    auto inFirst = makeAddress(in, 0_val, "%in_first");
+    auto inSecond = makeAddress(in, 4_val, "%in_second");
+    auto inDynamic = makeAddress(in, index, "%in_dynamic");
+    auto outFirst = makeAddress(out, 0_val, "%out_first");
+    auto restrictedFirst = makeAddress(restricted, 0_val, "%restricted_first");
+    auto localFirst = makeAddress(local, 0_val, "%local_first");
+    auto bufferFirst = makeAddress(buffer, 0_val, "%buffer_first");
+
+    // different parameters in the same address space might point to the same buffer
+    TEST_ASSERT(analysis::mayAlias(method, inFirst, 4, outFirst, 4))
+    // ... unless they are restrict
+    TEST_ASSERT(!analysis::mayAlias(method, inFirst, 4, restrictedFirst, 4))
+    // different address spaces and separate memory objects never overlap
+    TEST_ASSERT(!analysis::mayAlias(method, inFirst, 4, localFirst, 4))
+    TEST_ASSERT(!analysis::mayAlias(method, localFirst, 4, bufferFirst, 4))
+    // the same memory object is independent for disjoint offsets only
+    TEST_ASSERT(analysis::mayAlias(method, inFirst, 4, inFirst, 4))
+    TEST_ASSERT(!analysis::mayAlias(method, inFirst, 4, inSecond, 4))
+    TEST_ASSERT(analysis::mayAlias(method, inFirst, 8, inSecond, 4))
+    TEST_ASSERT(analysis::mayAlias(method, inFirst, 4, inDynamic, 4))
+    // unknown memory objects might be anything
+    TEST_ASSERT(analysis::mayAlias(method, index, 4, localFirst, 4))
+}
+
+void TestOptimizationSteps::testMultiRowMemoryCopy()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto ptrType = method.createPointerType(TYPE_INT32);
+    auto& in = method.addParameter(Parameter("%in", ptrType));
+    auto& out = method.addParameter(Parameter("%out", ptrType));
+    auto& start = method.createAndInsertNewBlock(method.end(), "%start");
+
+    auto countAccesses = [&](Register reg) -> unsigned {
+        return static_cast<unsigned>(std::count_if(start.begin(), start.end(),
+            [&](const std::unique_ptr<IntermediateInstruction>& inst) { return inst && inst->writesRegister(reg); }));
+    };
+
+    // 20 rows and 8 bytes: 15 rows, 5 rows and the remaining 2 words
+    auto it = start.walkEnd();
+    it = method.vpm->insertCopyRAM(method, it, out.createReference(), in.createReference(), 20 * 64 + 8);
+    TEST_ASSERT_EQUALS(3u, countAccesses(REG_VPM_DMA_LOAD_ADDR))
+    TEST_ASSERT_EQUALS(3u, countAccesses(REG_VPM_DMA_STORE_ADDR))
+
+    // 20 rows and 16 bytes: 16 rows, 4 rows and the remaining 4 words
+    auto fillVector = method.addNewLocal(TYPE_INT32.toVectorType(16), "%fill");
+    it = method.vpm->insertFillRAM(method, it, out.createReference(), fillVector, 20 * 64 + 16);
+    TEST_ASSERT_EQUALS(3u, countAccesses(REG_VPM_DMA_LOAD_ADDR))
+    TEST_ASSERT_EQUALS(6u, countAccesses(REG_VPM_DMA_STORE_ADDR))
+}
+
+void TestOptimizationSteps::testConstantVectorSynthesis()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.end(), "%dummy");
+
+    auto countInstructions = [&]() -> std::size_t {
+        return static_cast<std::size_t>(
+            std::count_if(block.begin(), block.end(), [](const std::unique_ptr<IntermediateInstruction>& inst) {
+                return inst && !dynamic_cast<const BranchLabel*>(inst.get());
+            }));
+    };
+
+    // 100 + 3 * (elem_num >> 1): shift, multiplication, addition and load of the offset
+    SIMDVector progression;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        progression[i] = Literal(100u + 3u * (i / 2u));
+    auto vectorType = TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE);
+    auto out = method.addNewLocal(vectorType, "%out");
+    auto it = block.walkEnd();
+    it.emplace(new MoveOperation(out, module.storeVector(std::move(progression), vectorType)));
+    it = normalization::handleContainer(module, method, it, config);
+    TEST_ASSERT_EQUALS(3u, countInstructions())
+    auto writer = dynamic_cast<const Operation*>(out.local()->getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_ADD)
+
+    // selection between two floating-point values: masked load, and, xor
+    SIMDVector selection;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        selection[i] = Literal(i % 3 == 0 ? 1.5f : 17.25f);
+    auto floatType = TYPE_FLOAT.toVectorType(NATIVE_VECTOR_SIZE);
+    auto outFloat = method.addNewLocal(floatType, "%out_float");
+    it.emplace(new MoveOperation(outFloat, module.storeVector(std::move(selection), floatType)));
+    it = normalization::handleContainer(module, method, it, config);
+    TEST_ASSERT_EQUALS(6u, countInstructions())
+    writer = dynamic_cast<const Operation*>(outFloat.local()->getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_XOR)
+}
+
+void TestOptimizationSteps::testConstantPool()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    module.methods.emplace_back(new Method(module));
+    auto& kernel = *module.methods.back();
+    kernel.isKernel = true;
+    auto it = kernel.createAndInsertNewBlock(kernel.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+
+    auto vectorType = TYPE_INT32.toVectorType(NATIVE_VECTOR_SIZE);
+    SIMDVector expensive;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        expensive[i] = Literal(0x12345u * (i + 1u) * (i + 1u) ^ 0x5A5A5u);
+    SIMDVector cheap;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        cheap[i] = Literal(i + 7u);
+    auto in = assign(it, vectorType, "%in") = UNIFORM_REGISTER;
+    auto a = assign(it, vectorType, "%a") = in + module.storeVector(SIMDVector(expensive), vectorType);
+    auto b = assign(it, vectorType, "%b") = in + module.storeVector(SIMDVector(expensive), vectorType);
+    auto c = assign(it, vectorType, "%c") = in + module.storeVector(std::move(cheap), vectorType);
+
+    normalization::createConstantPool(module, config);
+
+    // both uses of the expensive constant share the same pool entry
+    TEST_ASSERT_EQUALS(1u, module.globalData.size())
+    const auto& entry = module.globalData.front();
+    TEST_ASSERT(entry.isConstantPoolEntry && entry.isConstant)
+    auto aWriter = dynamic_cast<const Operation*>(a.local()->getSingleWriter());
+    auto bWriter = dynamic_cast<const Operation*>(b.local()->getSingleWriter());
+    auto cWriter = dynamic_cast<const Operation*>(c.local()->getSingleWriter());
+    TEST_ASSERT(aWriter && aWriter->assertArgument(1).checkLocal())
+    TEST_ASSERT(bWriter && bWriter->assertArgument(1).checkLocal())
+    TEST_ASSERT(cWriter && cWriter->assertArgument(1).checkVector())
+    auto load = dynamic_cast<const MemoryInstruction*>(aWriter->assertArgument(1).local()->getSingleWriter());
+    TEST_ASSERT(load && load->op == MemoryOperation::READ && load->getSource().local() == &entry)
+
+    // disabled constant pool
+    SIMDVector disabled(expensive);
+    config.additionalOptions.constantPoolThreshold = 0;
+    auto d = assign(it, vectorType, "%d") = in + module.storeVector(std::move(disabled), vectorType);
+    normalization::createConstantPool(module, config);
+    TEST_ASSERT_EQUALS(1u, module.globalData.size())
+    auto dWriter = dynamic_cast<const Operation*>(d.local()->getSingleWriter());
+    TEST_ASSERT(dWriter && dWriter->assertArgument(1).checkVector())
+}
+
+void TestOptimizationSteps::testGlobalDataOptimization()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    module.methods.emplace_back(new Method(module));
+    auto& kernel = *module.methods.back();
+    kernel.isKernel = true;
+    auto it = kernel.createAndInsertNewBlock(kernel.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+
+    auto arrayType = kernel.createArrayType(TYPE_INT32, 2);
+    auto createArray = [&](uint32_t first, uint32_t second) -> CompoundConstant {
+        return CompoundConstant(arrayType,
+            std::vector<CompoundConstant>{CompoundConstant(TYPE_INT32, Literal(first)),
+                CompoundConstant(TYPE_INT32, Literal(second))});
+    };
+    module.globalData.emplace_back("%byte", kernel.createPointerType(TYPE_INT8, AddressSpace::GLOBAL),
+        CompoundConstant(TYPE_INT8, Literal(17u)), false);
+    auto& byte = module.globalData.back();
+    module.globalData.emplace_back("%unused", kernel.createPointerType(arrayType, AddressSpace::GLOBAL),
+        createArray(1, 2), false);
+    module.globalData.emplace_back("%first", kernel.createPointerType(arrayType, AddressSpace::CONSTANT, 4),
+        createArray(3, 4), true);
+    auto& first = module.globalData.back();
+    module.globalData.emplace_back("%second", kernel.createPointerType(arrayType, AddressSpace::CONSTANT, 8),
+        createArray(3, 4), true);
+    auto& second = module.globalData.back();
+    module.globalData.emplace_back("%mutable", kernel.createPointerType(arrayType, AddressSpace::GLOBAL),
+        createArray(3, 4), false);
+    auto& mutableCopy = module.globalData.back();
+
+    auto a = assign(it, TYPE_INT8, "%a") = byte.createReference();
+    auto b = assign(it, first.type, "%b") = first.createReference();
+    auto c = assign(it, second.type, "%c") = second.createReference();
+    auto d = assign(it, mutableCopy.type, "%d") = mutableCopy.createReference();
+    // pointer into the merged global
+    auto e = kernel.addNewLocal(kernel.createPointerType(TYPE_INT32, AddressSpace::CONSTANT), "%e");
+    e.local()->set(ReferenceData(first, 1));
+    assign(it, e) = b + 4_val;
+
+    normalization::optimizeGlobalData(module);
+
+    // the unused global is dropped, the identical constants are merged into the stricter aligned one
+    TEST_ASSERT_EQUALS(3u, module.globalData.size())
+    TEST_ASSERT(!module.findGlobal("%unused"))
+    TEST_ASSERT(!module.findGlobal("%first"))
+    TEST_ASSERT_EQUALS(&second, module.findGlobal("%second"))
+    auto bWriter = dynamic_cast<const MoveOperation*>(b.local()->getSingleWriter());
+    TEST_ASSERT(bWriter && bWriter->getSource().local() == &second)
+    auto cWriter = dynamic_cast<const MoveOperation*>(c.local()->getSingleWriter());
+    TEST_ASSERT(cWriter && cWriter->getSource().local() == &second)
+    TEST_ASSERT_EQUALS(&second, e.local()->get<ReferenceData>()->base)
+    // non-constant globals are never merged
+    auto dWriter = dynamic_cast<const MoveOperation*>(d.local()->getSingleWriter());
+    TEST_ASSERT(dWriter && dWriter->getSource().local() == &mutableCopy)
+    auto aWriter = dynamic_cast<const MoveOperation*>(a.local()->getSingleWriter());
+    TEST_ASSERT(aWriter && aWriter->getSource().local() == &byte)
+
+    // the globals are packed by descending alignment, so the byte does not require any padding
+    TEST_ASSERT_EQUALS(&second, &module.globalData.front())
+    TEST_ASSERT_EQUALS(&byte, &module.globalData.back())
+    TEST_ASSERT_EQUALS(17u, module.getGlobalDataOffset(nullptr).value())
+}
+
+void TestOptimizationSteps::testPhiElimination()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    module.methods.emplace_back(new Method(module));
+    auto& kernel = *module.methods.back();
+    kernel.isKernel = true;
+    auto& start = kernel.createAndInsertNewBlock(kernel.end(), "%start");
+    auto& loop = kernel.createAndInsertNewBlock(kernel.end(), "%loop");
+    const Local* startLabel = start.getLabel()->getLabel();
+    const Local* loopLabel = loop.getLabel()->getLabel();
+
+    auto it = start.walkEnd();
+    auto aInit = assign(it, TYPE_INT32, "%a.init") = UNIFORM_REGISTER;
+    auto bInit = assign(it, TYPE_INT32, "%b.init") = UNIFORM_REGISTER;
+    it.emplace(new Branch(loopLabel)).nextInBlock();
+
+    it = loop.walkEnd();
+    auto a = kernel.addNewLocal(TYPE_INT32, "%a");
+    auto b = kernel.addNewLocal(TYPE_INT32, "%b");
+    auto i = kernel.addNewLocal(TYPE_INT32, "%i");
+    auto iNext = kernel.addNewLocal(TYPE_INT32, "%i.next");
+    using Operands = std::vector<std::pair<Value, const Local*>>;
+    // a and b are swapped in every iteration
+    it.emplace(new PhiNode(Value(a), Operands{{aInit, startLabel}, {b, loopLabel}})).nextInBlock();
+    it.emplace(new PhiNode(Value(b), Operands{{bInit, startLabel}, {a, loopLabel}})).nextInBlock();
+    it.emplace(new PhiNode(Value(i), Operands{{INT_ZERO, startLabel}, {iNext, loopLabel}})).nextInBlock();
+    assign(it, iNext) = i + 1_val;
+    assign(it, NOP_REGISTER) = a + b;
+    it.emplace(new Branch(loopLabel)).nextInBlock();
+
+    optimizations::eliminatePhiNodes(module, kernel, config);
+
+    for(auto instIt = kernel.walkAllInstructions(); !instIt.isEndOfMethod(); instIt.nextInMethod())
+        TEST_ASSERT(!instIt.get<PhiNode>())
+
+    // the initial values and the incremented induction variable are coalesced with the phi-node outputs
+    TEST_ASSERT(aInit.local()->getUsers().empty())
+    TEST_ASSERT(bInit.local()->getUsers().empty())
+    TEST_ASSERT(iNext.local()->getUsers().empty())
+    auto increment = std::find_if(loop.begin(), loop.end(), [&](const std::unique_ptr<IntermediateInstruction>& inst) {
+        auto op = dynamic_cast<const Operation*>(inst.get());
+        return op && op->op == OP_ADD && op->writesLocal(i.checkLocal()) && op->getFirstArg() == i;
+    });
+    TEST_ASSERT(increment != loop.end())
+
+    // the swap is sequentialized via a temporary
+    std::vector<const MoveOperation*> moves;
+    for(auto instIt = loop.walk(); !instIt.isEndOfBlock(); instIt.nextInBlock())
+    {
+        if(auto move = instIt.get<MoveOperation>())
+            moves.push_back(move);
+    }
+    TEST_ASSERT_EQUALS(3u, moves.size())
+    auto tmp = moves[0]->getOutput().value();
+    TEST_ASSERT(moves[0]->getSource() == a)
+    TEST_ASSERT(moves[1]->writesLocal(a.checkLocal()) && moves[1]->getSource() == b)
+    TEST_ASSERT(moves[2]->writesLocal(b.checkLocal()) && moves[2]->getSource() == tmp)
+}
+
+void TestOptimizationSteps::testCombineAddressCalculations()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    Method method(module);
+    auto ptrType = method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL);
+    auto& in = method.addParameter(Parameter("%in", ptrType));
+    auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+    auto it = block.walkEnd();
+    auto i = assign(it, TYPE_INT32, "%i") = UNIFORM_REGISTER;
+
+    // loads a[i], a[i + 1] and a[i + 2]
+    std::vector<Value> addresses;
+    for(unsigned k = 0; k < 3; ++k)
+    {
+        auto index = k == 0 ? i : (assign(it, TYPE_INT32, "%index") = i + Value(Literal(k), TYPE_INT32));
+        auto offset = assign(it, TYPE_INT32, "%offset") = index << 2_val;
+        addresses.emplace_back(assign(it, in.type, "%addr") = in.createReference() + offset);
+        auto val = method.addNewLocal(TYPE_INT32, "%val");
+        it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val), Value(addresses.back())));
+        it.nextInBlock();
+    }
+
+    normalization::combineAddressCalculations(module, method, config);
+
+    auto firstWriter = dynamic_cast<const Operation*>(addresses[0].getSingleWriter());
+    TEST_ASSERT(firstWriter && firstWriter->op == OP_ADD && firstWriter->readsLocal(&in))
+    for(unsigned k = 1; k < 3; ++k)
+    {
+        auto writer = dynamic_cast<const Operation*>(addresses[k].getSingleWriter());
+        TEST_ASSERT(writer && writer->op == OP_ADD)
+        TEST_ASSERT(writer->getFirstArg() == addresses[0])
+        TEST_ASSERT(writer->assertArgument(1).getLiteralValue() &&
+            writer->assertArgument(1).getLiteralValue()->unsignedInt() == 4 * k)
+    }
+}
+
+void TestOptimizationSteps::testCombineHalfConversions()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    // load half, convert to float, calculate, convert back to half
+    auto tmuResult = assign(it, TYPE_INT32, "%tmu_result") = UNIFORM_REGISTER;
+    auto mask = assign(it, TYPE_INT32, "%mask") = Value(Literal(0xFFFFu), TYPE_INT32);
+    auto h = assign(it, TYPE_HALF, "%h") = tmuResult & mask;
+    auto f = method.addNewLocal(TYPE_FLOAT, "%f");
+    it = insertFloatingPointConversion(it, method, h, f);
+    auto g = assign(it, TYPE_FLOAT, "%g") = as_float{f} + as_float{f};
+    auto result = method.addNewLocal(TYPE_HALF, "%result");
+    it = insertFloatingPointConversion(it, method, g, result);
+
+    for(unsigned i = 0; i < 2; ++i)
+    {
+        auto stepIt = block.walk().nextInBlock();
+        while(!stepIt.isEndOfBlock())
+        {
+            auto nextIt = combineHalfConversions(module, method, stepIt, config);
+            if(nextIt == stepIt)
+                stepIt.nextInBlock();
+            else
+                stepIt = nextIt;
+        }
+    }
+
+    TEST_ASSERT(h.local()->getUsers().empty())
+    TEST_ASSERT(f.local()->getUsers().empty())
+    TEST_ASSERT(g.local()->getUsers().empty())
+    auto writer = dynamic_cast<const Operation*>(result.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_FADD)
+    TEST_ASSERT(writer->getFirstArg() == tmuResult && writer->assertArgument(1) == tmuResult)
+    TEST_ASSERT_EQUALS(UNPACK_HALF_TO_FLOAT, writer->getUnpackMode())
+    TEST_ASSERT_EQUALS(PACK_FLOAT_TO_HALF_TRUNCATE, writer->getPackMode())
+}
+
+void TestOptimizationSteps::testCombineExtensionUnpacks()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    // extract the second byte, e.g. for a bit-cast from uint to uchar4
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto shifted = method.addNewLocal(TYPE_INT32, "%shifted");
+    it.emplace(new Operation(OP_SHR, shifted, x, Value(Literal(8u), TYPE_INT8)));
+    it.nextInBlock();
+    auto byte = assign(it, TYPE_INT32, "%byte") = shifted & Value(Literal(0xFFu), TYPE_INT32);
+    auto sum = assign(it, TYPE_INT32, "%sum") = byte + byte;
+    // sign-extend a short
+    auto y = assign(it, TYPE_INT16, "%y") = UNIFORM_REGISTER;
+    auto extended = method.addNewLocal(TYPE_INT32, "%extended");
+    it = insertSignExtension(it, method, y, extended, true);
+    auto moved = assign(it, TYPE_INT32, "%moved") = extended;
+    // not combined, since the unpack mode would convert the byte to float
+    auto masked = assign(it, TYPE_INT32, "%masked") = x & Value(Literal(0xFFu), TYPE_INT32);
+    auto floatSum = assign(it, TYPE_FLOAT, "%float_sum") = as_float{masked} + as_float{masked};
+
+    auto stepIt = block.walk().nextInBlock();
+    while(!stepIt.isEndOfBlock())
+    {
+        auto nextIt = combineExtensionUnpacks(module, method, stepIt, config);
+        if(nextIt == stepIt)
+            stepIt.nextInBlock();
+        else
+            stepIt = nextIt;
+    }
+
+    TEST_ASSERT(byte.local()->getUsers().empty())
+    auto writer = dynamic_cast<const Operation*>(sum.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_ADD)
+    TEST_ASSERT(writer->getFirstArg() == x && writer->assertArgument(1) == x)
+    TEST_ASSERT_EQUALS(UNPACK_8B_32, writer->getUnpackMode())
+
+    TEST_ASSERT(extended.local()->getUsers().empty())
+    auto move = dynamic_cast<const MoveOperation*>(moved.getSingleWriter());
+    TEST_ASSERT(move && move->getSource() == y)
+    TEST_ASSERT_EQUALS(UNPACK_SHORT_TO_INT_SEXT, move->getUnpackMode())
+
+    writer = dynamic_cast<const Operation*>(floatSum.getSingleWriter());
+    TEST_ASSERT(writer && writer->getFirstArg() == masked && !writer->hasUnpackMode())
+}
+
+void TestOptimizationSteps::testCombineSaturatedByteOperations()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto y = assign(it, TYPE_INT32, "%y") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_INT32, "%a") = x & Value(Literal(0xFFu), TYPE_INT32);
+    auto b = assign(it, TYPE_INT32, "%b") = y & Value(Literal(0xFFu), TYPE_INT32);
+    // saturated addition and subtraction of unsigned bytes
+    auto sum = assign(it, TYPE_INT32, "%sum") = a + b;
+    auto addResult = method.addNewLocal(TYPE_INT32, "%add_result");
+    it.emplace(new Operation(OP_MIN, addResult, sum, Value(Literal(0xFFu), TYPE_INT32)));
+    it.nextInBlock();
+    auto diff = assign(it, TYPE_INT32, "%diff") = a - b;
+    auto subResult = method.addNewLocal(TYPE_INT32, "%sub_result");
+    it.emplace(new Operation(OP_MAX, subResult, diff, INT_ZERO));
+    it.nextInBlock();
+    // not combined, since the inputs are not known to be bytes
+    auto unknownSum = assign(it, TYPE_INT32, "%unknown_sum") = x + y;
+    auto unknownResult = method.addNewLocal(TYPE_INT32, "%unknown_result");
+    it.emplace(new Operation(OP_MIN, unknownResult, unknownSum, Value(Literal(0xFFu), TYPE_INT32)));
+    it.nextInBlock();
+
+    for(auto stepIt = block.walk().nextInBlock(); !stepIt.isEndOfBlock(); stepIt.nextInBlock())
+        stepIt = combineSaturatedByteOperations(module, method, stepIt, config);
+
+    auto writer = dynamic_cast<const Operation*>(addResult.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_V8ADDS)
+    TEST_ASSERT(writer->getFirstArg() == a && writer->assertArgument(1) == b)
+    writer = dynamic_cast<const Operation*>(subResult.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_V8SUBS)
+    TEST_ASSERT(writer->getFirstArg() == a && writer->assertArgument(1) == b)
+    writer = dynamic_cast<const Operation*>(unknownResult.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_MIN)
+}
+
+void TestOptimizationSteps::testCombineSaturationPackModes()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    // float to uchar saturation is calculated via clamping and the pack-mode
+    auto f = assign(it, TYPE_FLOAT, "%f") = UNIFORM_REGISTER;
+    auto byteResult = method.addNewLocal(TYPE_INT8, "%byte_result");
+    it = insertFloatToIntegerSaturation(it, method, f, byteResult, 0, 255);
+    // integer to short saturation of a value calculated without overflow
+    auto x = assign(it, TYPE_INT32, "%x") = UNIFORM_REGISTER;
+    auto masked = assign(it, TYPE_INT32, "%masked") = x & Value(Literal(0x7FFFFFFFu), TYPE_INT32);
+    auto shortResult = method.addNewLocal(TYPE_INT16, "%short_result");
+    it.emplace((new MoveOperation(shortResult, masked))->setPackMode(PACK_INT_TO_SIGNED_SHORT_SATURATE));
+    it.nextInBlock();
+    // not combined, since the addition could overflow
+    auto sum = assign(it, TYPE_INT32, "%sum") = x + x;
+    auto overflowResult = method.addNewLocal(TYPE_INT8, "%overflow_result");
+    it.emplace((new MoveOperation(overflowResult, sum))->setPackMode(PACK_INT_TO_UNSIGNED_CHAR_SATURATE));
+    it.nextInBlock();
+
+    auto writer = dynamic_cast<const Operation*>(byteResult.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_FTOI)
+    TEST_ASSERT_EQUALS(PACK_INT_TO_UNSIGNED_CHAR_SATURATE, writer->getPackMode())
+    auto clampWriter = dynamic_cast<const Operation*>(writer->getFirstArg().getSingleWriter());
+    TEST_ASSERT(clampWriter && clampWriter->op == OP_FMIN)
+
+    for(auto stepIt = block.walk().nextInBlock(); !stepIt.isEndOfBlock(); stepIt.nextInBlock())
+        stepIt = combineSaturationPackModes(module, method, stepIt, config);
+
+    TEST_ASSERT(masked.local()->getUsers().empty())
+    writer = dynamic_cast<const Operation*>(shortResult.getSingleWriter());
+    TEST_ASSERT(writer && writer->op == OP_AND)
+    TEST_ASSERT_EQUALS(PACK_INT_TO_SIGNED_SHORT_SATURATE, writer->getPackMode())
+    TEST_ASSERT(dynamic_cast<const MoveOperation*>(overflowResult.getSingleWriter()))
+}
+
+void TestOptimizationSteps::testRemoveWorkGroupSynchronization()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+
+    auto createKernel = [&](Method& method) {
+        auto& block = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK);
+        auto it = block.walkEnd();
+        it.emplace((new SemaphoreAdjustment(Semaphore::BARRIER_WORK_ITEM_0, true))
+                       ->addDecorations(InstructionDecorations::WORK_GROUP_BARRIER));
+        it.nextInBlock();
+        it.emplace(new MemoryBarrier(MemoryScope::WORK_GROUP, MemorySemantics::ACQUIRE_RELEASE));
+        it.nextInBlock();
+        it.emplace((new SemaphoreAdjustment(Semaphore::BARRIER_WORK_ITEM_0, false))
+                       ->addDecorations(InstructionDecorations::WORK_GROUP_BARRIER));
+        it.nextInBlock();
+        method.createAndInsertNewBlock(method.end(), BasicBlock::LAST_BLOCK);
+    };
+    auto countSemaphoreAdjustments = [](Method& method) -> std::size_t {
+        std::size_t count = 0;
+        for(auto& block : method)
+            count += static_cast<std::size_t>(std::count_if(block.begin(), block.end(),
+                [](const std::unique_ptr<IntermediateInstruction>& inst) -> bool {
+                    return dynamic_cast<const SemaphoreAdjustment*>(inst.get());
+                }));
+        return count;
+    };
+
+    {
+        // a single work-item per work-group
+        Method method(module);
+        method.metaData.workGroupSizes = {1, 1, 1};
+        createKernel(method);
+        TEST_ASSERT(normalization::removeWorkGroupSynchronization(module, method, config))
+        TEST_ASSERT_EQUALS(0u, countSemaphoreAdjustments(method))
+    }
+
+    {
+        // all work-items of the work-group are coarsened into a single QPU
+        Method method(module);
+        method.metaData.workGroupSizes = {16, 0, 0};
+        method.metaData.workItemsPerQPU = 16;
+        createKernel(method);
+        TEST_ASSERT(normalization::removeWorkGroupSynchronization(module, method, config))
+        TEST_ASSERT_EQUALS(0u, countSemaphoreAdjustments(method))
+    }
+
+    {
+        // the work-group is executed by multiple QPUs
+        Method method(module);
+        method.metaData.workGroupSizes = {2, 1, 1};
+        createKernel(method);
+        TEST_ASSERT(!normalization::removeWorkGroupSynchronization(module, method, config))
+        TEST_ASSERT_EQUALS(2u, countSemaphoreAdjustments(method))
+    }
+
+    {
+        // unknown work-group size
+        Method method(module);
+        createKernel(method);
+        TEST_ASSERT(!normalization::removeWorkGroupSynchronization(module, method, config))
+        TEST_ASSERT_EQUALS(2u, countSemaphoreAdjustments(method))
+    }
+
+    {
+        // semaphore accesses not belonging to a work-group barrier are kept
+        Method method(module);
+        method.metaData.workGroupSizes = {1, 1, 1};
+        createKernel(method);
+        auto it = method.begin()->walk().nextInBlock();
+        it.emplace(new SemaphoreAdjustment(Semaphore::BARRIER_WORK_ITEM_1, true));
+        TEST_ASSERT(normalization::removeWorkGroupSynchronization(module, method, config))
+        TEST_ASSERT_EQUALS(1u, countSemaphoreAdjustments(method))
+    }
+}
+
+void TestOptimizationSteps::testCombineCriticalSections()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& counter =
+        method.addParameter(Parameter("%counter", method.createPointerType(TYPE_INT32, AddressSpace::GLOBAL)));
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    // two atomic increments of the same counter
+    auto insertIncrement = [&](const std::string& name) -> std::pair<Value, Value> {
+        it.emplace(new MutexLock(MutexAccess::LOCK));
+        it.nextInBlock();
+        auto val = method.addNewLocal(TYPE_INT32, name);
+        it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val), counter.createReference(), Value(INT_ONE),
+            false));
+        it.nextInBlock();
+        auto inc = assign(it, TYPE_INT32, name + ".inc") = val + 1_val;
+        it.emplace(new MemoryInstruction(MemoryOperation::WRITE, counter.createReference(), Value(inc), Value(INT_ONE),
+            false));
+        it.nextInBlock();
+        it.emplace(new MutexLock(MutexAccess::RELEASE));
+        it.nextInBlock();
+        return std::make_pair(val, inc);
+    };
+    auto first = insertIncrement("%a");
+    auto second = insertIncrement("%b");
+
+    normalization::combineCriticalSections(module, method, config);
+
+    std::size_t numLocks = 0;
+    std::size_t numReads = 0;
+    std::size_t numWrites = 0;
+    for(auto& inst : block)
+    {
+        if(auto mutex = dynamic_cast<const MutexLock*>(inst.get()))
+            numLocks += mutex->locksMutex() ? 1 : 0;
+        if(auto mem = dynamic_cast<const MemoryInstruction*>(inst.get()))
+        {
+            numReads += mem->op == MemoryOperation::READ ? 1 : 0;
+            numWrites += mem->op == MemoryOperation::WRITE ? 1 : 0;
+            if(mem->op == MemoryOperation::WRITE)
+                TEST_ASSERT(mem->getSource() == second.second)
+        }
+    }
+    TEST_ASSERT_EQUALS(1u, numLocks)
+    TEST_ASSERT_EQUALS(1u, numReads)
+    TEST_ASSERT_EQUALS(1u, numWrites)
+    auto move = dynamic_cast<const MoveOperation*>(second.first.getSingleWriter());
+    TEST_ASSERT(move && move->getSource() == first.second)
+}
+
+void TestOptimizationSteps::testSplitStackAllocations()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    // int[32] is too large to be lowered into a single register
+    auto arrayType = method.createArrayType(TYPE_INT32, 32);
+    auto& array =
+        *method.stackAllocations.emplace(StackAllocation("%array", method.createPointerType(arrayType), 128, 4)).first;
+    auto& dynamicArray =
+        *method.stackAllocations.emplace(StackAllocation("%dynamic", method.createPointerType(arrayType), 128, 4))
+             .first;
+    auto index = method.addNewLocal(TYPE_INT32, "%index");
+
+    // constant offsets, also via derived addresses
+    auto addr0 = assign(it, array.type, "%addr") = array.createReference() + 8_val;
+    auto addr1 = assign(it, array.type, "%addr") = addr0 + 4_val;
+    it.emplace(new MemoryInstruction(MemoryOperation::WRITE, Value(addr0), Value(17_val), Value(INT_ONE), false));
+    it.nextInBlock();
+    it.emplace(new MemoryInstruction(MemoryOperation::WRITE, Value(addr1), Value(42_val), Value(INT_ONE), false));
+    it.nextInBlock();
+    auto val0 = method.addNewLocal(TYPE_INT32, "%val");
+    it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val0), Value(addr1), Value(INT_ONE), false));
+    it.nextInBlock();
+
+    // dynamic offset
+    auto addr2 = assign(it, dynamicArray.type, "%addr") = dynamicArray.createReference() + index;
+    auto val1 = method.addNewLocal(TYPE_INT32, "%val");
+    it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val1), Value(addr2), Value(INT_ONE), false));
+    it.nextInBlock();
+
+    normalization::splitStackAllocations(module, method, config);
+
+    TEST_ASSERT(array.isLowered)
+    TEST_ASSERT(!dynamicArray.isLowered)
+    std::size_t numMemoryAccesses = 0;
+    for(auto& inst : block)
+    {
+        if(auto mem = dynamic_cast<const MemoryInstruction*>(inst.get()))
+        {
+            ++numMemoryAccesses;
+            TEST_ASSERT(mem->getSource() == addr2)
+        }
+    }
+    TEST_ASSERT_EQUALS(1u, numMemoryAccesses)
+    auto move = dynamic_cast<const MoveOperation*>(val0.getSingleWriter());
+    TEST_ASSERT(move != nullptr)
+    auto element = move ? move->getSource().getSingleWriter() : nullptr;
+    TEST_ASSERT(element && element->getArgument(0) == 42_val)
+}
+
+void TestOptimizationSteps::testSplitStructValues()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+    auto& block = method.createAndInsertNewBlock(method.begin(), "%dummy");
+    auto it = block.walkEnd();
+
+    auto structType = method.createStructType("%pair", {TYPE_INT32, TYPE_FLOAT});
+    TEST_ASSERT(isSplitStructType(structType))
+    TEST_ASSERT(!isSplitStructType(method.createStructType("%long_pair", {TYPE_INT64, TYPE_INT64})))
+    TEST_ASSERT(!isSplitStructType(method.createStructType("%vector_pair", {TYPE_INT32.toVectorType(4), TYPE_INT32})))
+
+    // %tmp = insertvalue undef, 17, 0
+    // %pair = insertvalue %tmp, %in, 1
+    // %out = extractvalue %pair, 1
+    auto in = method.addNewLocal(TYPE_FLOAT, "%in");
+    auto tmp = method.addNewLocal(structType, "%tmp");
+    auto pair = method.addNewLocal(structType, "%pair");
+    auto out = method.addNewLocal(TYPE_FLOAT, "%out");
+    it = insertStructInsertion(it, method, tmp, Value(structType), 0, 17_val);
+    it = insertStructInsertion(it, method, pair, tmp, 1, in);
+    it = insertStructExtraction(it, method, pair, 1, out);
+
+    // undefined members are not copied, all other members are simple moves between the member locals
+    TEST_ASSERT_EQUALS(4u, block.size() - 1 /* label */)
+    for(auto& inst : block)
+    {
+        if(dynamic_cast<const BranchLabel*>(inst.get()))
+            continue;
+        TEST_ASSERT(dynamic_cast<const MoveOperation*>(inst.get()) != nullptr)
+        TEST_ASSERT(!inst->getOutput()->type.getStructType())
+    }
+    auto member0 = getSplitStructMember(method, pair, 0);
+    TEST_ASSERT_EQUALS("%pair.member.0", member0.local()->name)
+    auto move = dynamic_cast<const MoveOperation*>(member0.getSingleWriter());
+    TEST_ASSERT(move && move->getSource() == getSplitStructMember(method, tmp, 0))
+    move = dynamic_cast<const MoveOperation*>(out.getSingleWriter());
+    TEST_ASSERT(move && move->getSource() == getSplitStructMember(method, pair, 1))
+    move = move ? dynamic_cast<const MoveOperation*>(move->getSource().getSingleWriter()) : nullptr;
+    TEST_ASSERT(move && move->getSource() == in)
+}
+
+void TestOptimizationSteps::testKernelFusion()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    // blur(%in, %tmp) -> threshold(%tmp, %out)
+    config.kernelFusions.emplace_back(KernelFusion{"blur_threshold", {{"blur", {0, 1}}, {"threshold", {1, 2}}}});
+    Module module{config};
+
+    auto createKernel = [&](const std::string& name) -> Method& {
+        module.methods.emplace_back(new Method(module));
+        auto& kernel = *module.methods.back();
+        kernel.name = "@" + name;
+        kernel.isKernel = true;
+        auto& in = kernel.addParameter(Parameter("%in",
+            kernel.createPointerType(TYPE_INT32, AddressSpace::GLOBAL),
+            add_flag(ParameterDecorations::INPUT, ParameterDecorations::READ_ONLY)));
+        auto& out = kernel.addParameter(Parameter(
+            "%out", kernel.createPointerType(TYPE_INT32, AddressSpace::GLOBAL), ParameterDecorations::OUTPUT));
+        auto it = kernel.createAndInsertNewBlock(kernel.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+        auto val = kernel.addNewLocal(TYPE_INT32, "%val");
+        it.emplace(new MemoryInstruction(MemoryOperation::READ, Value(val), in.createReference()));
+        it.nextInBlock();
+        it.emplace(new MemoryInstruction(MemoryOperation::WRITE, out.createReference(), Value(val)));
+        it.nextInBlock();
+        it.emplace(new Return());
+        return kernel;
+    };
+    createKernel("blur");
+    createKernel("threshold");
+
+    normalization::fuseKernels(module, config);
+
+    TEST_ASSERT_EQUALS(3u, module.methods.size())
+    auto& fused = *module.methods.back();
+    TEST_ASSERT_EQUALS("@blur_threshold", fused.name)
+    TEST_ASSERT(fused.isKernel)
+    TEST_ASSERT_EQUALS(3u, fused.parameters.size())
+    TEST_ASSERT_EQUALS("%in", fused.parameters[0].name)
+    TEST_ASSERT_EQUALS("%out", fused.parameters[1].name)
+    TEST_ASSERT_EQUALS("%out.2", fused.parameters[2].name)
+    // the intermediate buffer is written by the first and read by the second kernel
+    TEST_ASSERT(has_flag(fused.parameters[1].decorations, ParameterDecorations::INPUT))
+    TEST_ASSERT(has_flag(fused.parameters[1].decorations, ParameterDecorations::OUTPUT))
+    TEST_ASSERT(!has_flag(fused.parameters[1].decorations, ParameterDecorations::READ_ONLY))
+    TEST_ASSERT(has_flag(fused.parameters[0].decorations, ParameterDecorations::READ_ONLY))
+    TEST_ASSERT_EQUALS(2u, fused.parameters[1].getUsers().size())
+
+    // only the return of the last kernel is kept, the return of the first kernel branches to the second kernel
+    std::size_t numReturns = 0;
+    std::size_t numBranches = 0;
+    fused.forAllInstructions([&](const IntermediateInstruction& inst) {
+        if(dynamic_cast<const Return*>(&inst))
+            ++numReturns;
+        if(dynamic_cast<const Branch*>(&inst))
+            ++numBranches;
+    });
+    TEST_ASSERT_EQUALS(1u, numReturns)
+    TEST_ASSERT_EQUALS(1u, numBranches)
+
+    // the same kernel can not be fused twice
+    Configuration duplicateConfig{};
+    duplicateConfig.kernelFusions.emplace_back(KernelFusion{"duplicate", {{"blur", {}}, {"blur", {}}}});
+    TEST_THROWS(normalization::fuseKernels(module, duplicateConfig), CompilationError);
+    // there is no such kernel
+    Configuration missingConfig{};
+    missingConfig.kernelFusions.emplace_back(KernelFusion{"missing", {{"blur", {}}, {"foo", {}}}});
+    TEST_THROWS(normalization::fuseKernels(module, missingConfig), CompilationError);
+}
+
+void TestOptimizationSteps::testCoalescingRegisterAllocator()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto it = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_INT32, "%a") = in + 1_val;
+    auto b = method.addNewLocal(TYPE_INT32, "%b");
+    assign(it, b) = a;
+    auto c = assign(it, TYPE_INT32, "%c") = b + in;
+    assignNop(it) = (c, SetFlag::SET_FLAGS);
+
+    qpu_asm::GraphColoring coloring(method, method.walkAllInstructions(), RegisterAllocator::COALESCING);
+    TEST_ASSERT(coloring.colorGraph())
+    auto registers = coloring.toRegisterMap();
+    // the copied local does not interfere with its source, so both are assigned the same register
+    TEST_ASSERT_EQUALS(registers.at(a.checkLocal()), registers.at(b.checkLocal()))
+    TEST_ASSERT(registers.at(a.checkLocal()) != registers.at(in.checkLocal()))
+    TEST_ASSERT(registers.at(c.checkLocal()) != registers.at(in.checkLocal()))
+}
+
+void TestOptimizationSteps::testLinearScanRegisterAllocator()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto it = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto a = assign(it, TYPE_INT32, "%a") = in + 1_val;
+    auto b = assign(it, TYPE_INT32, "%b") = in + 2_val;
+    auto c = assign(it, TYPE_INT32, "%c") = a + b;
+    auto d = assign(it, TYPE_INT32, "%d") = c + in;
+    assignNop(it) = (d, SetFlag::SET_FLAGS);
+
+    qpu_asm::GraphColoring coloring(method, method.walkAllInstructions(), RegisterAllocator::LINEAR_SCAN);
+    TEST_ASSERT(coloring.colorGraph())
+    auto registers = coloring.toRegisterMap();
+    TEST_ASSERT_EQUALS(5u, registers.size())
+    // all locals live at the same time are assigned different registers
+    TEST_ASSERT(registers.at(a.checkLocal()) != registers.at(b.checkLocal()))
+    TEST_ASSERT(registers.at(a.checkLocal()) != registers.at(in.checkLocal()))
+    TEST_ASSERT(registers.at(b.checkLocal()) != registers.at(in.checkLocal()))
+    TEST_ASSERT(registers.at(c.checkLocal()) != registers.at(in.checkLocal()))
+}
+
+void TestOptimizationSteps::testRegisterFilePartitioning()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto it = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+    // more values live at the same time than there are accumulators
+    std::vector<Value> values;
+    for(unsigned i = 0; i < 8; ++i)
+        values.push_back(assign(it, TYPE_INT32, "%value") = UNIFORM_REGISTER);
+    // every value is read together with its neighbors, so the values on physical registers need to alternate between
+    // the register-files A and B
+    std::vector<Value> sums;
+    for(unsigned i = 0; i + 1 < values.size(); ++i)
+        sums.push_back(assign(it, TYPE_INT32, "%sum") = values[i] + values[i + 1]);
+    for(const auto& sum : sums)
+        assignNop(it) = (sum, SetFlag::SET_FLAGS);
+
+    qpu_asm::GraphColoring coloring(method, method.walkAllInstructions());
+    TEST_ASSERT(coloring.colorGraph())
+    auto registers = coloring.toRegisterMap();
+    for(unsigned i = 0; i + 1 < values.size(); ++i)
+    {
+        auto first = registers.at(values[i].checkLocal());
+        auto second = registers.at(values[i + 1].checkLocal());
+        if(!first.isAccumulator() && !second.isAccumulator())
+            TEST_ASSERT(first.file != second.file)
+    }
+}
+
+void TestOptimizationSteps::testThreadSwitchInsertion()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    config.generateThreadedCode = true;
+    Module module{config};
+
+    auto createKernel = [](Method& method, bool lockMutex, bool useSemaphore) {
+        auto it = method.createAndInsertNewBlock(method.end(), BasicBlock::DEFAULT_BLOCK).walkEnd();
+        auto addr = assign(it, TYPE_VOID_POINTER, "%addr") = UNIFORM_REGISTER;
+        if(lockMutex)
+        {
+            it.emplace(new MutexLock(MutexAccess::LOCK));
+            it.nextInBlock();
+        }
+        if(useSemaphore)
+        {
+            it.emplace(new SemaphoreAdjustment(Semaphore::BARRIER_WORK_ITEM_0, true));
+            it.nextInBlock();
+        }
+        assign(it, Value(REG_TMU0_ADDRESS, TYPE_VOID_POINTER)) = addr;
+        nop(it, DelayType::WAIT_TMU, SIGNAL_LOAD_TMU0);
+        ignoreReturnValue(assign(it, TYPE_INT32, "%val") = Value(REG_TMU_OUT, TYPE_INT32));
+        if(lockMutex)
+        {
+            it.emplace(new MutexLock(MutexAccess::RELEASE));
+            it.nextInBlock();
+        }
+    };
+    auto countThreadSwitches = [](Method& method) -> std::size_t {
+        std::size_t count = 0;
+        for(auto& block : method)
+            count += static_cast<std::size_t>(std::count_if(block.begin(), block.end(),
+                [](const std::unique_ptr<IntermediateInstruction>& inst) -> bool {
+                    return inst && inst->getSignal() == SIGNAL_SWITCH_THREAD;
+                }));
+        return count;
+    };
+
+    {
+        Method method(module);
+        createKernel(method, false, false);
+        normalization::insertThreadSwitches(module, method, config);
+        TEST_ASSERT_EQUALS(1u, countThreadSwitches(method))
+        TEST_ASSERT(method.metaData.isThreadable)
+        // the thread switch is followed by its delay slots and then the TMU load
+        auto it = method.walkAllInstructions();
+        while(!it.isEndOfMethod() && it->getSignal() != SIGNAL_SWITCH_THREAD)
+            it.nextInMethod();
+        TEST_ASSERT(it.nextInBlock().get<Nop>() && it.get<Nop>()->type == DelayType::THREAD_SWITCH)
+        TEST_ASSERT(it.nextInBlock().get<Nop>() && it.get<Nop>()->type == DelayType::THREAD_SWITCH)
+        TEST_ASSERT_EQUALS(SIGNAL_LOAD_TMU0, it.nextInBlock()->getSignal())
+    }
+
+    {
+        // the other thread could not lock the mutex while this thread waits
+        Method method(module);
+        createKernel(method, true, false);
+        normalization::insertThreadSwitches(module, method, config);
+        TEST_ASSERT_EQUALS(0u, countThreadSwitches(method))
+        TEST_ASSERT(!method.metaData.isThreadable)
+    }
+
+    {
+        // kernels accessing semaphores are not threaded
+        Method method(module);
+        createKernel(method, false, true);
+        normalization::insertThreadSwitches(module, method, config);
+        TEST_ASSERT_EQUALS(0u, countThreadSwitches(method))
+        TEST_ASSERT(!method.metaData.isThreadable)
+    }
+
+    {
+        // threaded code is not enabled
+        Configuration defaultConfig{};
+        Method method(module);
+        createKernel(method, false, false);
+        normalization::insertThreadSwitches(module, method, defaultConfig);
+        TEST_ASSERT_EQUALS(0u, countThreadSwitches(method))
+    }
+}
+
+void TestOptimizationSteps::testUniformLocalCompression()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    // more locals live across the blocks than registers are available
+    const unsigned numLocals = 80;
+    auto it = method.createAndInsertNewBlock(method.end(), "%start").walkEnd();
+    std::vector<Value> locals;
+    for(unsigned i = 0; i < numLocals; ++i)
+        locals.push_back(assign(it, TYPE_INT32, "%l" + std::to_string(i)) = UNIFORM_REGISTER);
+    it = method.createAndInsertNewBlock(method.end(), "%use").walkEnd();
+    auto sum = locals.front();
+    for(unsigned i = 1; i < numLocals; ++i)
+        sum = assign(it, TYPE_INT32, "%sum") = sum + locals[i];
+    assignNop(it) = sum;
+
+    TEST_ASSERT(method.getAnalyses().getRegisterPressure().getMaximumPressure().exceedsRegisters())
+    TEST_ASSERT(optimizations::compressUniformLocals(module, method, config))
+
+    // every compressed local is replaced by an element of the container, which occupies a register itself
+    auto numCompressed = std::count_if(locals.begin(), locals.end(),
+        [](const Value& local) -> bool { return local.local()->getUsers(LocalUse::Type::READER).empty(); });
+    TEST_ASSERT_EQUALS(12u, static_cast<unsigned>(numCompressed))
+
+    // nothing to compress without exceeding the registers
+    Method smallMethod(module);
+    it = smallMethod.createAndInsertNewBlock(smallMethod.end(), "%start").walkEnd();
+    auto a = assign(it, TYPE_INT32, "%a") = UNIFORM_REGISTER;
+    assignNop(it) = a + INT_ONE;
+    TEST_ASSERT(!optimizations::compressUniformLocals(module, smallMethod, config))
+}
+
+void TestOptimizationSteps::testSizeOptimizationLevel()
+{
+    auto sizePasses = optimizations::Optimizer::getPasses(OptimizationLevel::SIZE);
+    auto fullPasses = optimizations::Optimizer::getPasses(OptimizationLevel::FULL);
+    // all passes run for small code are also run for full optimization
+    TEST_ASSERT(std::includes(fullPasses.begin(), fullPasses.end(), sizePasses.begin(), sizePasses.end()))
+    // the passes run for medium optimization level also shrink the code
+    auto mediumPasses = optimizations::Optimizer::getPasses(OptimizationLevel::MEDIUM);
+    mediumPasses.erase("loop-work-groups");
+    TEST_ASSERT(std::includes(sizePasses.begin(), sizePasses.end(), mediumPasses.begin(), mediumPasses.end()))
+
+    // no passes increasing the code size are run
+    for(const auto* pass : {"vectorize-loops", "unroll-loops", "pipeline-loads", "extract-loads-from-loops",
+            "work-group-cache", "loop-work-groups"})
+        TEST_ASSERT_EQUALS(0u, sizePasses.count(pass))
+}
+
+void TestOptimizationSteps::testRedundantFlagsRemoval()
+{
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto it = method.createAndInsertNewBlock(method.end(), "%start").walkEnd();
+    auto in = assign(it, TYPE_INT32, "%in") = UNIFORM_REGISTER;
+    auto out = method.addNewLocal(TYPE_INT32, "%out");
+    assignNop(it) = (in ^ ELEMENT_NUMBER_REGISTER, SetFlag::SET_FLAGS);
+    assign(it, out) = (INT_ONE, COND_ZERO_SET);
+
+    // the flags set in the predecessor block are still valid, the setting is removed
+    it = method.createAndInsertNewBlock(method.end(), "%same").walkEnd();
+    assignNop(it) = (in ^ ELEMENT_NUMBER_REGISTER, SetFlag::SET_FLAGS);
+    assign(it, out) = (INT_ZERO, COND_ZERO_CLEAR);
+
+    // the input of the flags calculation is modified, the setting is kept
+    it = method.createAndInsertNewBlock(method.end(), "%modified").walkEnd();
+    assign(it, in) = in + INT_ONE;
+    assignNop(it) = (in ^ ELEMENT_NUMBER_REGISTER, SetFlag::SET_FLAGS);
+    assign(it, out) = (INT_ONE, COND_ZERO_SET);
+
+    auto countFlagSetters = [](const BasicBlock& block) -> unsigned {
+        return static_cast<unsigned>(std::count_if(block.begin(), block.end(),
+            [](const std::unique_ptr<intermediate::IntermediateInstruction>& inst) -> bool {
+                return inst && inst->doesSetFlag();
+            }));
+    };
+
+    TEST_ASSERT(optimizations::removeRedundantFlags(module, method, config))
+    auto blockIt = method.begin();
+    TEST_ASSERT_EQUALS(1u, countFlagSetters(*blockIt))
+    ++blockIt;
+    TEST_ASSERT_EQUALS(0u, countFlagSetters(*blockIt))
+    ++blockIt;
+    TEST_ASSERT_EQUALS(1u, countFlagSetters(*blockIt))
+
+    // nothing left to remove
+    TEST_ASSERT(!optimizations::removeRedundantFlags(module, method, config))
+}
+
+void TestOptimizationSteps::testBranchOnConditionFlags()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& loop = method.createAndInsertNewBlock(method.end(), "%loop");
+    auto& exit = method.createAndInsertNewBlock(method.end(), "%exit");
+    auto it = loop.walkEnd();
+    auto uniform = assign(it, TYPE_INT32, "%uniform") = UNIFORM_REGISTER;
+    auto divergent = assign(it, TYPE_INT32, "%divergent") = uniform + ELEMENT_NUMBER_REGISTER;
+
+    // branch on the lane-uniform condition, the flags of the comparison are used directly
+    auto cond = method.addNewLocal(TYPE_BOOL, "%cond");
+    assignNop(it) = (uniform ^ 42_val, SetFlag::SET_FLAGS);
+    assign(it, cond) = (BOOL_TRUE, COND_ZERO_SET);
+    assign(it, cond) = (BOOL_FALSE, COND_ZERO_CLEAR);
+    BranchCond branchCond = BRANCH_ALWAYS;
+    std::tie(it, branchCond) = insertBranchCondition(method, it, cond);
+    it.emplace(new Branch(exit.getLabel()->getLabel(), branchCond));
+    it.nextInBlock();
+    it.emplace(new Branch(loop.getLabel()->getLabel(), branchCond.invert()));
+    it.nextInBlock();
+
+    // branch on the divergent condition, only the first element decides the branch
+    it = exit.walkEnd();
+    auto otherCond = method.addNewLocal(TYPE_BOOL, "%other_cond");
+    assignNop(it) = (divergent ^ 42_val, SetFlag::SET_FLAGS);
+    assign(it, otherCond) = (BOOL_TRUE, COND_ZERO_SET);
+    assign(it, otherCond) = (BOOL_FALSE, COND_ZERO_CLEAR);
+    std::tie(it, branchCond) = insertBranchCondition(method, it, otherCond);
+    it.emplace(new Branch(loop.getLabel()->getLabel(), branchCond));
+    it.nextInBlock();
+
+    TEST_ASSERT(optimizations::branchOnConditionFlags(module, method, config))
+
+    auto countFlagSetters = [](const BasicBlock& block) -> unsigned {
+        return static_cast<unsigned>(std::count_if(block.begin(), block.end(),
+            [](const std::unique_ptr<intermediate::IntermediateInstruction>& inst) -> bool {
+                return inst && inst->doesSetFlag();
+            }));
+    };
+    TEST_ASSERT_EQUALS(1u, countFlagSetters(loop))
+    auto branchIt = loop.walkEnd().previousInBlock();
+    TEST_ASSERT_EQUALS(BRANCH_ALL_Z_CLEAR, branchIt.get<Branch>()->branchCondition)
+    branchIt.previousInBlock();
+    TEST_ASSERT_EQUALS(BRANCH_ANY_Z_SET, branchIt.get<Branch>()->branchCondition)
+
+    TEST_ASSERT_EQUALS(2u, countFlagSetters(exit))
+    TEST_ASSERT_EQUALS(BRANCH_ALL_Z_CLEAR, exit.walkEnd().previousInBlock().get<Branch>()->branchCondition)
+}
+
+void TestOptimizationSteps::testVectorShuffleSynthesis()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module module{config};
+    Method method(module);
+
+    auto& block = method.createAndInsertNewBlock(method.end(), "%start");
+    auto it = block.walkEnd();
+    auto type = TYPE_FLOAT.toVectorType(4);
+    auto source = assign(it, type, "%source") = UNIFORM_REGISTER;
+
+    auto countInstructions = [&](const std::function<bool(const IntermediateInstruction&)>& predicate) -> unsigned {
+        return static_cast<unsigned>(std::count_if(block.begin(), block.end(),
+            [&](const std::unique_ptr<IntermediateInstruction>& inst) -> bool { return inst && predicate(*inst); }));
+    };
+
+    // reversing the vector requires 4 different rotations, one of them written unconditionally and the flags for the
+    // others being set by 2 instructions
+    auto reversed = method.addNewLocal(type, "%reversed");
+    it = insertVectorShuffle(it, method, reversed, source, UNDEFINED_VALUE,
+        module.storeVector(SIMDVector({Literal(3), Literal(2), Literal(1), Literal(0)}), TYPE_INT32.toVectorType(4)));
+    TEST_ASSERT_EQUALS(4u, countInstructions([](const IntermediateInstruction& inst) -> bool {
+        return dynamic_cast<const VectorRotation*>(&inst) != nullptr;
+    }))
+    TEST_ASSERT_EQUALS(2u,
+        countInstructions([](const IntermediateInstruction& inst) -> bool { return inst.doesSetFlag(); }))
+    TEST_ASSERT_EQUALS(3u, countInstructions([&](const IntermediateInstruction& inst) -> bool {
+        return inst.hasConditionalExecution() && inst.writesLocal(reversed.local());
+    }))
+
+    // the undefined element does not prevent the replication of the single used element
+    auto splat = method.addNewLocal(type, "%splat");
+    it = insertVectorShuffle(it, method, splat, source, UNDEFINED_VALUE,
+        module.storeVector(
+            SIMDVector({Literal(2), Literal(2), UNDEFINED_LITERAL, Literal(2)}), TYPE_INT32.toVectorType(4)));
+    TEST_ASSERT(it.copy().previousInBlock()->readsRegister(REG_REPLICATE_ALL))
+}
@@ -32,6 +32,67 @@ public:
     void testEliminateMoves();
     void testEliminateDeadCode();
 
+    void testMethodCheckpoint();
+    void testModificationBatch();
+    void testAnalysisManager();
+    void testDominatorTree();
+    void testGlobalValueNumbering();
+    void testLoopInfo();
+    void testRegisterPressure();
+    void testDivergenceAnalysis();
+    void testAlignmentAnalysis();
+    void testOptimizerStatistics();
+    void testParallelSingleSteps();
+    void testFillBranchDelaySlots();
+    void testFillDelayNops();
+    void testIfConversion();
+    void testVectorizeElementOperations();
+    void testProfileGuidedBlockOrder();
+    void testStrengthReduction();
+    void testLoopInvariantCodeMotion();
+    void testSingleStepDispatch();
+    void testWorkGroupLoopUniforms();
+    void testDynamicWorkDistribution();
+    void testPrecomputedUniforms();
+    void testWorkItemCoarsening();
+    void testTailDuplication();
+    void testPairALUOperations();
+    void testSimplifyExpressionTrees();
+    void testKernelSpecialization();
+    void testKernelVersions();
+    void testKernelDeduplication();
+    void testLongOperationFastPaths();
+    void testMultiplicationNarrowing();
+    void testCombineBitwiseIdioms();
+    void testVPMAreaLifetimes();
+    void testOptimizeMutexRegions();
+    void testMemoryMappingOrder();
+    void testMemoryDependencies();
+    void testMultiRowMemoryCopy();
+    void testConstantVectorSynthesis();
+    void testConstantPool();
+    void testGlobalDataOptimization();
+    void testPhiElimination();
+    void testCombineAddressCalculations();
+    void testCombineHalfConversions();
+    void testCombineExtensionUnpacks();
+    void testCombineSaturatedByteOperations();
+    void testCombineSaturationPackModes();
+    void testRemoveWorkGroupSynchronization();
+    void testCombineCriticalSections();
+    void testSplitStackAllocations();
+    void testSplitStructValues();
+    void testKernelFusion();
+    void testCoalescingRegisterAllocator();
+    void testLinearScanRegisterAllocator();
+    void testRegisterFilePartitioning();
+    void testThreadSwitchInsertion();
+    void testUniformLocalCompression();
+    void testSizeOptimizationLevel();
+    void testRedundantFlagsRemoval();
+    void testBranchOnConditionFlags();
+    void testVectorShuffleSynthesis();
+
 private:
     void testMethodsEquals(vc4c::Method& m1, vc4c::Method& m2);
 };
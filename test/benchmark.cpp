@@ -0,0 +1,277 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "Profiler.h"
+#include "tools.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace vc4c;
+
+/*
+ * Measures the compilation speed of the compiler by compiling a corpus of OpenCL C files repeatedly and writes the
+ * duration of the compilation stages (as recorded by the compiler trace, see profiler::TraceScope), the number of
+ * generated instructions per second of every stage and the peak memory usage as JSON object.
+ */
+
+// the stages in the order they run, Precompile and Parser run once per module, the other stages once per kernel
+static const std::vector<std::string> STAGES = {
+    "Precompile", "Parser", "PrepareModule", "Normalizer", "Optimizer", "SecondNormalizer", "CodeGenerator"};
+
+static const std::string STATISTICS_FILE = "./benchmark_statistics.json";
+
+struct FileResult
+{
+    std::string file;
+    bool successful = false;
+    std::string error;
+    // the number of machine code instructions generated for all kernels of the file
+    std::size_t numInstructions = 0;
+    // the summed up durations of all iterations and the maximum peak memory usage per stage
+    std::map<std::string, profiler::TraceSummary> stages;
+};
+
+static void printHelp()
+{
+    std::cout << "Usage: BenchmarkVC4C [-n <iterations>] [-o <output-file>] [options] <files or directories...>"
+              << std::endl;
+    std::cout << "Compiles all given OpenCL C files (and all .cl files in the given directories) repeatedly and "
+                 "reports the duration and throughput of the compilation stages and the peak memory usage as JSON"
+              << std::endl;
+    std::cout << "\t-n <iterations>\t\tThe number of times every file is compiled, defaults to 3" << std::endl;
+    std::cout << "\t-o <output-file>\tWrites the JSON results into the file specified instead of the standard output"
+              << std::endl;
+    std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
+    std::cout << "[options] are used to compile all files and accept any compiler option (see vc4c --help), all other "
+                 "options are passed to the pre-compiler"
+              << std::endl;
+}
+
+static void addSourceFiles(const std::string& path, std::vector<std::string>& files)
+{
+    struct stat status = {};
+    if(stat(path.data(), &status) != 0)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to access corpus path", path);
+    if(!S_ISDIR(status.st_mode))
+    {
+        files.push_back(path);
+        return;
+    }
+    DIR* dir = opendir(path.data());
+    if(!dir)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open corpus directory", path);
+    std::vector<std::string> entries;
+    while(auto entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if(name != "." && name != "..")
+            entries.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    // sort the files to keep the order of the output stable
+    std::sort(entries.begin(), entries.end());
+    for(const auto& entry : entries)
+    {
+        if(stat(entry.data(), &status) == 0 &&
+            (S_ISDIR(status.st_mode) || (entry.size() > 3 && entry.compare(entry.size() - 3, 3, ".cl") == 0)))
+            addSourceFiles(entry, files);
+    }
+}
+
+static std::size_t countInstructions(const std::string& statisticsFile)
+{
+    std::ifstream in(statisticsFile);
+    std::string statistics((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::size_t numInstructions = 0;
+    const std::string key = "\"instructions\": ";
+    for(auto pos = statistics.find(key); pos != std::string::npos; pos = statistics.find(key, pos + key.size()))
+        numInstructions += std::stoul(statistics.substr(pos + key.size()));
+    return numInstructions;
+}
+
+static FileResult benchmarkFile(
+    const std::string& file, const Configuration& baseConfig, const std::string& options, unsigned numIterations)
+{
+    FileResult result;
+    result.file = file;
+    Configuration config = baseConfig;
+    config.statisticsOutputFile = STATISTICS_FILE;
+    // the cached kernels would skip most of the measured stages
+    config.cacheDirectory.clear();
+    try
+    {
+        for(unsigned i = 0; i < numIterations; ++i)
+        {
+            std::ifstream input(file);
+            if(!input)
+                throw CompilationError(CompilationStep::GENERAL, "Failed to open source file", file);
+            std::stringstream output;
+            profiler::startTracing();
+            Compiler::compile(input, output, config, options, file);
+            for(const auto& stage : profiler::summarizeTrace("stage"))
+            {
+                auto& summary = result.stages[stage.first];
+                summary.numEvents += stage.second.numEvents;
+                summary.duration += stage.second.duration;
+                summary.peakResidentSize = std::max(summary.peakResidentSize, stage.second.peakResidentSize);
+            }
+        }
+        result.numInstructions = countInstructions(STATISTICS_FILE);
+        result.successful = true;
+    }
+    catch(const std::exception& e)
+    {
+        // stop the tracing of the failed compilation
+        profiler::summarizeTrace("stage");
+        result.error = e.what();
+    }
+    std::remove(STATISTICS_FILE.data());
+    return result;
+}
+
+static void writeString(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for(char c : text)
+    {
+        if(c == '"' || c == '\\')
+            out << '\\';
+        out << (c == '\n' ? ' ' : c);
+    }
+    out << '"';
+}
+
+static void writeStages(std::ostream& out, const std::map<std::string, profiler::TraceSummary>& stages,
+    std::size_t numInstructions, unsigned numIterations, const std::string& indent)
+{
+    out << "{";
+    bool isFirst = true;
+    for(const auto& name : STAGES)
+    {
+        auto it = stages.find(name);
+        if(it == stages.end())
+            continue;
+        auto seconds = std::chrono::duration<double>(it->second.duration).count() / numIterations;
+        out << (isFirst ? "\n" : ",\n") << indent << "  ";
+        writeString(out, name);
+        out << ": {\"seconds\": " << seconds << ", \"instructionsPerSecond\": "
+            << (seconds > 0.0 ? static_cast<double>(numInstructions) / seconds : 0.0)
+            << ", \"peakRSS_kB\": " << it->second.peakResidentSize << "}";
+        isFirst = false;
+    }
+    out << "\n" << indent << "}";
+}
+
+int main(int argc, char** argv)
+{
+    setLogger(std::wcout, true, LogLevel::ERROR);
+
+    if(argc == 1 || std::string("-h") == argv[1] || std::string("--help") == argv[1])
+    {
+        printHelp();
+        return 0;
+    }
+
+    Configuration config;
+    std::string options;
+    std::string outputFile;
+    unsigned numIterations = 3;
+    std::vector<std::string> files;
+
+    try
+    {
+        for(int i = 1; i < argc; ++i)
+        {
+            if(std::string("-n") == argv[i] && i + 1 < argc)
+                numIterations = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 0)));
+            else if(std::string("-o") == argv[i] && i + 1 < argc)
+                outputFile = argv[++i];
+            else if(argv[i][0] == '-')
+            {
+                if(!tools::parseConfigurationParameter(config, argv[i]))
+                    options.append(argv[i]).append(" ");
+            }
+            else
+                addSourceFiles(argv[i], files);
+        }
+    }
+    catch(const CompilationError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<FileResult> results;
+    std::map<std::string, profiler::TraceSummary> totalStages;
+    std::size_t totalInstructions = 0;
+    unsigned numFailed = 0;
+    for(const auto& file : files)
+    {
+        std::cerr << "Compiling " << file << "..." << std::endl;
+        results.emplace_back(benchmarkFile(file, config, options, numIterations));
+        const auto& result = results.back();
+        if(!result.successful)
+        {
+            std::cerr << "Failed to compile " << file << ": " << result.error << std::endl;
+            ++numFailed;
+            continue;
+        }
+        totalInstructions += result.numInstructions;
+        for(const auto& stage : result.stages)
+        {
+            auto& summary = totalStages[stage.first];
+            summary.numEvents += stage.second.numEvents;
+            summary.duration += stage.second.duration;
+            summary.peakResidentSize = std::max(summary.peakResidentSize, stage.second.peakResidentSize);
+        }
+    }
+
+    rusage usage{};
+    long peakResidentSize = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+
+    std::ofstream outputFileStream;
+    if(!outputFile.empty())
+        outputFileStream.open(outputFile);
+    std::ostream& out = outputFile.empty() ? std::cout : outputFileStream;
+    out << "{\n  \"iterations\": " << numIterations << ",\n  \"files\": [";
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"file\": ";
+        writeString(out, result.file);
+        out << ", \"successful\": " << (result.successful ? "true" : "false");
+        if(!result.successful)
+        {
+            out << ", \"error\": ";
+            writeString(out, result.error);
+            out << "}";
+            continue;
+        }
+        out << ", \"instructions\": " << result.numInstructions << ", \"stages\": ";
+        writeStages(out, result.stages, result.numInstructions, numIterations, "    ");
+        out << "}";
+    }
+    out << "\n  ],\n  \"total\": {\"files\": " << (results.size() - numFailed) << ", \"failed\": " << numFailed
+        << ", \"instructions\": " << totalInstructions << ", \"peakRSS_kB\": " << peakResidentSize
+        << ", \"stages\": ";
+    writeStages(out, totalStages, totalInstructions, numIterations, "  ");
+    out << "}\n}" << std::endl;
+    return 0;
+}
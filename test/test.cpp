@@ -4,8 +4,14 @@
  * See the file "LICENSE" for the full license governing this code.
  */
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <vector>
 
 #include "cpptest.h"
@@ -41,27 +47,31 @@ using namespace std;
 
 static vc4c::Configuration config;
 
+// the part of the regression test-cases to run in this process, see runParallel()
+static unsigned shardIndex = 0;
+static unsigned numShards = 1;
+
 template<bool R>
 static Test::Suite* newLLVMCompilationTest()
 {
-	return new RegressionTest(config, vc4c::Frontend::LLVM_IR, R);
+	return new RegressionTest(config, vc4c::Frontend::LLVM_IR, R, false, shardIndex, numShards);
 }
 
 template<bool R>
 static Test::Suite* newSPIRVCompiltionTest()
 {
-	return new RegressionTest(config, vc4c::Frontend::SPIR_V, R);
+	return new RegressionTest(config, vc4c::Frontend::SPIR_V, R, false, shardIndex, numShards);
 }
 
 template<bool R>
 static Test::Suite* newCompilationTest()
 {
-	return new RegressionTest(config, vc4c::Frontend::DEFAULT, R);
+	return new RegressionTest(config, vc4c::Frontend::DEFAULT, R, false, shardIndex, numShards);
 }
 
 static Test::Suite* newFastRegressionTest()
 {
-	return new RegressionTest(config, vc4c::Frontend::DEFAULT, true, true);
+	return new RegressionTest(config, vc4c::Frontend::DEFAULT, true, true, shardIndex, numShards);
 }
 
 static Test::Suite* newEmulatorTest()
@@ -124,6 +134,166 @@ static Test::Suite* newOptimizationsTest()
     return new TestOptimizations(config);
 }
 
+struct SuiteEntry
+{
+    std::string name;
+    bool runByDefault;
+    // whether the test-cases of the suite can be split across multiple processes
+    bool isSharded;
+};
+
+static std::vector<SuiteEntry> suites;
+
+template <typename Factory>
+static void registerSuite(Factory newSuite, const std::string& name, const std::string& description,
+    bool runByDefault = true, bool isSharded = false)
+{
+    Test::registerSuite(newSuite, name, description, runByDefault);
+    suites.push_back(SuiteEntry{name, runByDefault, isSharded});
+}
+
+struct TestJob
+{
+    std::string suite;
+    unsigned shardIndex;
+    unsigned numShards;
+    // the output of the child process, is only printed after the job finished to not interleave the output of the jobs
+    FILE* output;
+    pid_t process;
+    int status;
+};
+
+static void startJob(TestJob& job, std::vector<char*> args)
+{
+    std::cout.flush();
+    std::wcout.flush();
+    job.process = fork();
+    if(job.process == -1)
+    {
+        perror("Failed to start test process");
+        std::exit(EXIT_FAILURE);
+    }
+    if(job.process != 0)
+        return;
+    // child process, redirect all output (including the log) into the job output and run the single suite (shard)
+    dup2(fileno(job.output), STDOUT_FILENO);
+    dup2(fileno(job.output), STDERR_FILENO);
+    shardIndex = job.shardIndex;
+    numShards = job.numShards;
+    std::string suiteArg = "--" + job.suite;
+    args.insert(args.begin() + 1, &suiteArg[0]);
+    auto result = Test::runSuites(int(args.size()), args.data());
+    std::cout.flush();
+    std::wcout.flush();
+    std::exit(result);
+}
+
+static void printJob(const TestJob& job)
+{
+    std::cout << "==== " << job.suite;
+    if(job.numShards > 1)
+        std::cout << " (part " << (job.shardIndex + 1) << " of " << job.numShards << ")";
+    std::cout << " ====" << std::endl;
+    std::rewind(job.output);
+    char buffer[4096];
+    std::size_t numBytes = 0;
+    while((numBytes = std::fread(buffer, 1, sizeof(buffer), job.output)) > 0)
+        std::cout.write(buffer, static_cast<std::streamsize>(numBytes));
+    std::fclose(job.output);
+    if(WIFSIGNALED(job.status))
+        std::cout << "Test process terminated by signal " << WTERMSIG(job.status) << std::endl;
+    std::cout << std::endl;
+}
+
+/*
+ * Runs the selected suites in up to numJobs child processes in parallel. The test-cases of the regression suites are
+ * split across all jobs. Running the suites in separate processes isolates the global state of the compiler (e.g.
+ * the logger and the profiler) as well as crashes of single test-cases.
+ *
+ * The output of every job is buffered and printed in the order the suites were registered, independent of the order
+ * the jobs finish in.
+ */
+static int runParallel(unsigned numJobs, const std::vector<char*>& args)
+{
+    std::vector<std::string> selectedSuites;
+    for(const auto& suite : suites)
+    {
+        for(auto arg : args)
+        {
+            if(std::string("--") + suite.name == arg)
+                selectedSuites.push_back(suite.name);
+        }
+    }
+    // cpptest-lite runs all default suites if none is selected explicitly
+    std::vector<char*> otherArgs;
+    for(auto arg : args)
+    {
+        bool isSuite = false;
+        for(const auto& suite : suites)
+            isSuite = isSuite || std::string("--") + suite.name == arg;
+        if(!isSuite)
+            otherArgs.push_back(arg);
+    }
+
+    std::vector<TestJob> jobs;
+    for(const auto& suite : suites)
+    {
+        bool isSelected = selectedSuites.empty() ?
+            suite.runByDefault :
+            std::find(selectedSuites.begin(), selectedSuites.end(), suite.name) != selectedSuites.end();
+        if(!isSelected)
+            continue;
+        unsigned suiteShards = suite.isSharded ? numJobs : 1;
+        for(unsigned i = 0; i < suiteShards; ++i)
+            jobs.push_back(TestJob{suite.name, i, suiteShards, nullptr, -1, 0});
+    }
+
+    int result = EXIT_SUCCESS;
+    std::size_t nextJob = 0;
+    std::size_t nextPrinted = 0;
+    unsigned numRunning = 0;
+    while(nextPrinted < jobs.size())
+    {
+        while(numRunning < numJobs && nextJob < jobs.size())
+        {
+            jobs[nextJob].output = std::tmpfile();
+            if(!jobs[nextJob].output)
+            {
+                perror("Failed to create test output file");
+                return EXIT_FAILURE;
+            }
+            startJob(jobs[nextJob], otherArgs);
+            ++nextJob;
+            ++numRunning;
+        }
+        int status = 0;
+        pid_t process = wait(&status);
+        if(process == -1)
+        {
+            perror("Failed to wait for test process");
+            return EXIT_FAILURE;
+        }
+        for(auto& job : jobs)
+        {
+            if(job.process == process)
+            {
+                job.status = status;
+                job.process = 0;
+                if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                    result = EXIT_FAILURE;
+            }
+        }
+        --numRunning;
+        // print all finished jobs in order, stopping at the first job still running
+        while(nextPrinted < nextJob && jobs[nextPrinted].process == 0)
+        {
+            printJob(jobs[nextPrinted]);
+            ++nextPrinted;
+        }
+    }
+    return result;
+}
+
 /*
  * 
  */
@@ -132,49 +302,60 @@ int main(int argc, char** argv)
     //only output errors
     logging::LOGGER.reset(new logging::ConsoleLogger(logging::Level::WARNING));
 
-    Test::registerSuite(Test::newInstance<TestOptimizationSteps>, "test-optimization-steps", "Runs unit tests on the single optimization steps");
-    Test::registerSuite(newOptimizationsTest, "test-optimizations", "Runs smoke tests on the single optimization steps");
-    Test::registerSuite(Test::newInstance<TestOperators>, "test-operators", "Tests the implementation of some operators");
-    Test::registerSuite(Test::newInstance<TestInstructions>, "test-instructions", "Tests some common instruction handling");
-    Test::registerSuite(Test::newInstance<TestFrontends>, "test-frontend", "Tests various functions of the default front-end");
-    Test::registerSuite(Test::newInstance<TestExpressions>, "test-expressions", "Tests the internal expression handling");
-    Test::registerSuite(newLLVMCompilationTest<true>, "regressions-llvm", "Runs the regression-test using the LLVM-IR front-end", false);
-    Test::registerSuite(newSPIRVCompiltionTest<true>, "regressions-spirv", "Runs the regression-test using the SPIR-V front-end", false);
-    Test::registerSuite(newCompilationTest<true>, "regressions", "Runs the regression-test using the default front-end", false);
-    Test::registerSuite(newCompilationTest<false>, "test-compilation", "Runs all the compilation tests using the default front-end", true);
-    Test::registerSuite(newLLVMCompilationTest<false>, "test-compilation-llvm", "Runs all the compilation tests using the LLVM-IR front-end", false);
-    Test::registerSuite(newSPIRVCompiltionTest<false>, "test-compilation-spirv", "Runs all the compilation tests using the SPIR-V front-end", false);
-    Test::registerSuite(newFastRegressionTest, "fast-regressions", "Runs regression test-cases marked as fast", false);
+    registerSuite(Test::newInstance<TestOptimizationSteps>, "test-optimization-steps", "Runs unit tests on the single optimization steps");
+    registerSuite(newOptimizationsTest, "test-optimizations", "Runs smoke tests on the single optimization steps");
+    registerSuite(Test::newInstance<TestOperators>, "test-operators", "Tests the implementation of some operators");
+    registerSuite(Test::newInstance<TestInstructions>, "test-instructions", "Tests some common instruction handling");
+    registerSuite(Test::newInstance<TestFrontends>, "test-frontend", "Tests various functions of the default front-end");
+    registerSuite(Test::newInstance<TestExpressions>, "test-expressions", "Tests the internal expression handling");
+    registerSuite(newLLVMCompilationTest<true>, "regressions-llvm", "Runs the regression-test using the LLVM-IR front-end", false, true);
+    registerSuite(newSPIRVCompiltionTest<true>, "regressions-spirv", "Runs the regression-test using the SPIR-V front-end", false, true);
+    registerSuite(newCompilationTest<true>, "regressions", "Runs the regression-test using the default front-end", false, true);
+    registerSuite(newCompilationTest<false>, "test-compilation", "Runs all the compilation tests using the default front-end", true, true);
+    registerSuite(newLLVMCompilationTest<false>, "test-compilation-llvm", "Runs all the compilation tests using the LLVM-IR front-end", false, true);
+    registerSuite(newSPIRVCompiltionTest<false>, "test-compilation-spirv", "Runs all the compilation tests using the SPIR-V front-end", false, true);
+    registerSuite(newFastRegressionTest, "fast-regressions", "Runs regression test-cases marked as fast", false, true);
     
-    Test::registerSuite(newEmulatorTest, "test-emulator", "Runs selected code-samples through the emulator");
-    Test::registerSuite(newMathFunctionsTest, "emulate-math", "Runs emulation tests for the OpenCL standard-library math functions");
-    Test::registerSuite(Test::newInstance<TestGraph>, "test-graph", "Runs basic test for the graph data structure");
-    Test::registerSuite(newArithmeticTest, "emulate-arithmetic", "Runs emulation tests for various kind of operations");
-    Test::registerSuite(newIntegerFunctionsTest, "emulate-integer", "Runs emulation tests for the OpenCL standard-library integer functions");
-    Test::registerSuite(newCommonFunctionsTest, "emulate-common", "Runs emulation tests for the OpenCL standard-library common functions");
-    Test::registerSuite(newGometricFunctionsTest, "emulate-geometric", "Runs emulation tests for the OpenCL standard-library geometric functions");
-    Test::registerSuite(newRelationalFunctionsTest, "emulate-relational", "Runs emulation tests for the OpenCL standard-library relational functions");
-    Test::registerSuite(newVectorFunctionsTest, "emulate-vector", "Runs emulation tests for the OpenCL standard-library vector functions");
-    Test::registerSuite(newMemoryAccessTest, "emulate-memory", "Runs emulation tests for various functions testing different kinds of memory access");
-    Test::registerSuite(newConversionFunctionsTest, "emulate-conversions", "Runs emulation tests for the OpenCL standard-library type conversion functions");
-    Test::registerSuite(newIntrinsicsTest, "test-intrinsics", "Runs tests on the code generated for intrinsic functions");
-    Test::registerSuite(Test::newInstance<TestPatternMatching>, "test-patterns", "Runs tests on the pattern matching framework");
-    Test::registerSuite(Test::newInstance<TestCustomContainers>, "test-container", "Runs tests on the custom container types");
+    registerSuite(newEmulatorTest, "test-emulator", "Runs selected code-samples through the emulator");
+    registerSuite(newMathFunctionsTest, "emulate-math", "Runs emulation tests for the OpenCL standard-library math functions");
+    registerSuite(Test::newInstance<TestGraph>, "test-graph", "Runs basic test for the graph data structure");
+    registerSuite(newArithmeticTest, "emulate-arithmetic", "Runs emulation tests for various kind of operations");
+    registerSuite(newIntegerFunctionsTest, "emulate-integer", "Runs emulation tests for the OpenCL standard-library integer functions");
+    registerSuite(newCommonFunctionsTest, "emulate-common", "Runs emulation tests for the OpenCL standard-library common functions");
+    registerSuite(newGometricFunctionsTest, "emulate-geometric", "Runs emulation tests for the OpenCL standard-library geometric functions");
+    registerSuite(newRelationalFunctionsTest, "emulate-relational", "Runs emulation tests for the OpenCL standard-library relational functions");
+    registerSuite(newVectorFunctionsTest, "emulate-vector", "Runs emulation tests for the OpenCL standard-library vector functions");
+    registerSuite(newMemoryAccessTest, "emulate-memory", "Runs emulation tests for various functions testing different kinds of memory access");
+    registerSuite(newConversionFunctionsTest, "emulate-conversions", "Runs emulation tests for the OpenCL standard-library type conversion functions");
+    registerSuite(newIntrinsicsTest, "test-intrinsics", "Runs tests on the code generated for intrinsic functions");
+    registerSuite(Test::newInstance<TestPatternMatching>, "test-patterns", "Runs tests on the pattern matching framework");
+    registerSuite(Test::newInstance<TestCustomContainers>, "test-container", "Runs tests on the custom container types");
 
     auto args = std::vector<char*>();
     // we need this first argument, since the  cpptest-lite helper expects the first argument to be skipped (as if passed directly the main arguments)
     args.push_back(argv[0]);
+    unsigned numJobs = 1;
+    bool showHelp = false;
 
     for(auto i = 1; i < argc; ++i)
     { 
-        if (!vc4c::tools::parseConfigurationParameter(config, argv[i]))
+        if(std::string(argv[i]).find("--jobs=") == 0)
+            numJobs = std::max(1u, static_cast<unsigned>(std::strtoul(argv[i] + 7, nullptr, 0)));
+        else if (!vc4c::tools::parseConfigurationParameter(config, argv[i]))
             args.push_back(argv[i]);
 
         //TODO rewrite, actually print same help (parts of it) as VC4C
         if(std::string("--help") == argv[i] || std::string("-h") == argv[i])
+        {
             std::cout << "NOTE: This only lists the options for the 'cpptest-lite' test-suite. For more options see 'VC4C --help'!" << std::endl;
+            std::cout << "\t--jobs=<num>\tRuns the selected suites in <num> parallel processes, splitting "
+                         "regression test-cases across all processes" << std::endl;
+            showHelp = true;
+        }
     }
 
+    if(numJobs > 1 && !showHelp)
+        return runParallel(numJobs, args);
     return Test::runSuites(int(args.size()), args.data());
 }
 
@@ -0,0 +1,363 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "tools/Emulator.h"
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "Profiler.h"
+
+#include "log.h"
+
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+/*
+ * A kernel compiled and emulated on fixed inputs
+ */
+struct Benchmark
+{
+    std::string name;
+    std::string sourceFile;
+    // additional options passed to the pre-compiler
+    std::string compilerOptions;
+    EmulationData emulation;
+};
+
+/*
+ * The quality of the code generated for a benchmark, lower values are better for all metrics
+ */
+struct Metrics
+{
+    uint32_t instructions = 0;
+    uint32_t cycles = 0;
+    uint32_t spills = 0;
+    uint32_t nops = 0;
+};
+
+static const std::array<std::pair<std::string, uint32_t Metrics::*>, 4> METRICS = {{
+    {"instructions", &Metrics::instructions},
+    {"cycles", &Metrics::cycles},
+    {"spills", &Metrics::spills},
+    {"nops", &Metrics::nops},
+}};
+
+static void printHelp()
+{
+    std::cout << "Usage: benchmark [-b <baseline-file>] [-u] [-t <threshold>] [-c <cycles>] [options] benchmark-file"
+              << std::endl;
+    std::cout << "Compiles and emulates the kernels of the benchmark file and records the number of instructions, the "
+                 "emulated cycles, the spilled locals and the nops per kernel"
+              << std::endl;
+    std::cout << "\t-b <baseline-file>\tCompares the results against the baseline file specified and fails if any "
+                 "value regresses by more than the threshold"
+              << std::endl;
+    std::cout << "\t-u\t\t\tWrites the results into the baseline file instead of comparing against it" << std::endl;
+    std::cout << "\t-t <threshold>\t\tThe regression (in percent) tolerated for every value, defaults to 5"
+              << std::endl;
+    std::cout << "\t-c <cycles>\t\tThe maximum number of cycles to emulate every kernel for, defaults to 2^26"
+              << std::endl;
+    std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
+    std::cout << "\t-q, --quiet\t\tQuiet all debug output" << std::endl;
+    std::cout << "\t--verbose\t\tPrint verbose debug output" << std::endl;
+    std::cout << "[options] are used to compile all kernels and accept any compiler option (see vc4c --help)"
+              << std::endl;
+    std::cout << "The benchmark file contains a single benchmark per line in the format:" << std::endl;
+    std::cout << "\t<name> <source-file> <kernel-name> [-l <local-sizes>] [-g <num-groups>] [compiler-options] [args]"
+              << std::endl;
+    std::cout << "\t<name>\t\t\tThe unique name of the benchmark in the baseline file" << std::endl;
+    std::cout << "\t-l <local-sizes>\tUses the given local sizes in the format x y z (3 parameter)" << std::endl;
+    std::cout << "\t-g <num-groups>\t\tUses the given number of work-groups in the format x y z (3 parameter)"
+              << std::endl;
+    std::cout << "\t[compiler-options]\tAny other option starting with '-' is passed to the pre-compiler" << std::endl;
+    std::cout << "[args] specify the values for the input parameters and can take following values:" << std::endl;
+    std::cout << "\t-b <num>\t\tAllocate an empty buffer with <num> words of size" << std::endl;
+    std::cout << "\t<data>\t\t\tUse <data> as input word" << std::endl;
+    std::cout << "Empty lines and lines starting with '#' are skipped in both the benchmark and the baseline file."
+              << std::endl;
+}
+
+static bool readBenchmark(const std::string& line, Benchmark& benchmark)
+{
+    std::istringstream ss(line);
+    if(!(ss >> benchmark.name >> benchmark.sourceFile >> benchmark.emulation.kernelName))
+        return false;
+    benchmark.emulation.workGroup.dimensions = 1;
+    benchmark.emulation.workGroup.globalOffsets = {0, 0, 0};
+    benchmark.emulation.workGroup.localSizes = {1, 1, 1};
+    benchmark.emulation.workGroup.numGroups = {1, 1, 1};
+
+    std::string arg;
+    while(ss >> arg)
+    {
+        if(arg == "-l" || arg == "-g")
+        {
+            auto& sizes =
+                arg == "-l" ? benchmark.emulation.workGroup.localSizes : benchmark.emulation.workGroup.numGroups;
+            if(!(ss >> sizes[0] >> sizes[1] >> sizes[2]))
+                return false;
+            benchmark.emulation.workGroup.dimensions = 3;
+        }
+        else if(arg == "-b")
+        {
+            std::size_t numWords = 0;
+            if(!(ss >> numWords))
+                return false;
+            benchmark.emulation.parameter.emplace_back(0u, std::vector<tools::Word>(numWords, 0x0));
+        }
+        else if(arg[0] == '-' && (arg.size() < 2 || !std::isdigit(arg[1])))
+            benchmark.compilerOptions.append(arg).append(" ");
+        else
+            benchmark.emulation.parameter.emplace_back(
+                static_cast<tools::Word>(std::strtol(arg.data(), nullptr, 0)), Optional<std::vector<uint32_t>>{});
+    }
+    return true;
+}
+
+/*
+ * Reads the value of the given key from the statistics of the given kernel, as written by the compiler (see
+ * Configuration#statisticsOutputFile)
+ */
+static uint32_t readStatistic(const std::string& statistics, const std::string& kernelName, const std::string& key)
+{
+    auto kernelPos = statistics.find("\"" + kernelName + "\": {");
+    auto kernelEnd = statistics.find('}', kernelPos);
+    auto keyPos = statistics.find("\"" + key + "\": ", kernelPos);
+    if(kernelPos == std::string::npos || keyPos == std::string::npos || keyPos > kernelEnd)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to read statistics of kernel", kernelName);
+    return static_cast<uint32_t>(std::stoul(statistics.substr(keyPos + key.size() + 4)));
+}
+
+static Metrics runBenchmark(const Benchmark& benchmark, const Configuration& baseConfig, uint32_t maxCycles)
+{
+    Configuration config = baseConfig;
+    // the kernel info is required by the emulator
+    config.writeKernelInfo = true;
+    config.statisticsOutputFile = "./benchmark_statistics.json";
+
+    std::ifstream source(benchmark.sourceFile);
+    if(!source)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open source file", benchmark.sourceFile);
+    auto binary = Compiler::compileToBinary(source, config, benchmark.compilerOptions, benchmark.sourceFile);
+
+    std::ifstream statisticsFile(config.statisticsOutputFile);
+    std::string statistics((std::istreambuf_iterator<char>(statisticsFile)), std::istreambuf_iterator<char>());
+    statisticsFile.close();
+    std::remove(config.statisticsOutputFile.data());
+
+    Metrics metrics;
+    metrics.instructions = readStatistic(statistics, benchmark.emulation.kernelName, "instructions");
+    metrics.spills = readStatistic(statistics, benchmark.emulation.kernelName, "spilledLocals");
+    metrics.nops = readStatistic(statistics, benchmark.emulation.kernelName, "nops");
+
+    std::istringstream module(std::string(binary.begin(), binary.end()));
+    EmulationData emulation = benchmark.emulation;
+    emulation.module = std::make_pair("", &module);
+    emulation.maxEmulationCycles = maxCycles;
+    auto result = emulate(emulation);
+    if(!result.executionSuccessful)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Exceeded the maximum number of emulation cycles", benchmark.name);
+    metrics.cycles = result.numCycles;
+    return metrics;
+}
+
+static std::map<std::string, Metrics> readBaseline(std::istream& in)
+{
+    std::map<std::string, Metrics> baseline;
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::istringstream ss(line);
+        std::string name;
+        ss >> name;
+        auto& metrics = baseline[name];
+        std::string entry;
+        while(ss >> entry)
+        {
+            auto pos = entry.find('=');
+            for(const auto& metric : METRICS)
+            {
+                if(pos != std::string::npos && entry.substr(0, pos) == metric.first)
+                    metrics.*(metric.second) = static_cast<uint32_t>(std::strtoul(entry.data() + pos + 1, nullptr, 0));
+            }
+        }
+    }
+    return baseline;
+}
+
+static void writeMetrics(std::ostream& out, const std::string& name, const Metrics& metrics)
+{
+    out << name;
+    for(const auto& metric : METRICS)
+        out << ' ' << metric.first << '=' << metrics.*(metric.second);
+    out << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    setLogger(std::wcout, true, LogLevel::WARNING);
+
+    if(argc == 1 || (argc == 2 && (std::string("-h") == argv[1] || std::string("--help") == argv[1])))
+    {
+        printHelp();
+        return 0;
+    }
+
+    Configuration config;
+    std::string baselineFile;
+    bool updateBaseline = false;
+    double threshold = 5.0;
+    uint32_t maxCycles = 1u << 26u;
+
+    for(int i = 1; i < argc - 1; ++i)
+    {
+        if(std::string("-h") == argv[i] || std::string("--help") == argv[i])
+        {
+            printHelp();
+            return 0;
+        }
+        else if(std::string("-b") == argv[i])
+        {
+            ++i;
+            baselineFile = argv[i];
+        }
+        else if(std::string("-u") == argv[i])
+        {
+            updateBaseline = true;
+        }
+        else if(std::string("-t") == argv[i])
+        {
+            ++i;
+            threshold = std::strtod(argv[i], nullptr);
+        }
+        else if(std::string("-c") == argv[i])
+        {
+            ++i;
+            maxCycles = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("-q") == argv[i] || std::string("--quiet") == argv[i])
+        {
+            setLogger(std::wcout, true, LogLevel::ERROR);
+        }
+        else if(std::string("--verbose") == argv[i])
+        {
+            setLogger(std::wcout, true, LogLevel::INFO);
+        }
+        else if(!tools::parseConfigurationParameter(config, argv[i]))
+        {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(updateBaseline && baselineFile.empty())
+    {
+        std::cerr << "Updating the baseline requires a baseline file" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[argc - 1]);
+    if(!input)
+    {
+        std::cerr << "Failed to open benchmark file: " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    std::vector<Benchmark> benchmarks;
+    std::string line;
+    while(std::getline(input, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        Benchmark benchmark;
+        if(!readBenchmark(line, benchmark))
+        {
+            std::cerr << "Invalid benchmark: " << line << std::endl;
+            return 1;
+        }
+        benchmarks.emplace_back(std::move(benchmark));
+    }
+
+    std::vector<std::pair<std::string, Metrics>> results;
+    for(const auto& benchmark : benchmarks)
+    {
+        try
+        {
+            results.emplace_back(benchmark.name, runBenchmark(benchmark, config, maxCycles));
+        }
+        catch(const CompilationError& e)
+        {
+            std::cerr << "Benchmark '" << benchmark.name << "' failed: " << e.what() << std::endl;
+            return 2;
+        }
+        writeMetrics(std::cout, results.back().first, results.back().second);
+    }
+
+    if(updateBaseline)
+    {
+        std::ofstream baseline(baselineFile, std::ios::trunc);
+        baseline << "# Generated by qpu_benchmark -u, update after intended changes of the generated code" << std::endl;
+        for(const auto& result : results)
+            writeMetrics(baseline, result.first, result.second);
+        if(!baseline)
+        {
+            std::cerr << "Failed to write baseline file: " << baselineFile << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if(baselineFile.empty())
+        return 0;
+
+    std::ifstream baselineInput(baselineFile);
+    if(!baselineInput)
+    {
+        std::cerr << "Failed to open baseline file: " << baselineFile << std::endl;
+        return 1;
+    }
+    const auto baseline = readBaseline(baselineInput);
+    unsigned numRegressions = 0;
+    for(const auto& result : results)
+    {
+        auto baseIt = baseline.find(result.first);
+        if(baseIt == baseline.end())
+        {
+            std::cerr << "Benchmark '" << result.first << "' has no baseline" << std::endl;
+            continue;
+        }
+        for(const auto& metric : METRICS)
+        {
+            auto baseValue = baseIt->second.*(metric.second);
+            auto value = result.second.*(metric.second);
+            if(static_cast<double>(value) > static_cast<double>(baseValue) * (1.0 + threshold / 100.0))
+            {
+                std::cerr << "Benchmark '" << result.first << "' regressed in " << metric.first << " from "
+                          << baseValue << " to " << value << std::endl;
+                ++numRegressions;
+            }
+            else if(value < baseValue)
+                std::cerr << "Benchmark '" << result.first << "' improved in " << metric.first << " from "
+                          << baseValue << " to " << value << std::endl;
+        }
+    }
+    std::cerr << numRegressions << " regressions in " << results.size() << " benchmarks" << std::endl;
+
+#ifdef DEBUG_MODE
+    vc4c::profiler::dumpProfileResults(true);
+#endif
+
+    return numRegressions == 0 ? 0 : 3;
+}
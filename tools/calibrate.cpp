@@ -0,0 +1,193 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "tools/Emulator.h"
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "Profiler.h"
+
+#include "log.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+static void printHelp()
+{
+    std::cout << "Usage: calibrate [-t <trials>] [-i <timing-file>] [-o <output-file>] [options] sample-file"
+              << std::endl;
+    std::cout << "Fits the latencies and the memory bandwidth of the emulator timing model to the number of cycles "
+                 "measured for kernel executions on the hardware"
+              << std::endl;
+    std::cout << "\t-t <trials>\t\tThe maximum number of timing models to emulate all samples with, defaults to 128"
+              << std::endl;
+    std::cout << "\t-i <timing-file>\tStarts the search from the timing model specified instead of the default model"
+              << std::endl;
+    std::cout << "\t-o <output-file>\tWrites the calibrated timing model into the file specified instead of the "
+                 "standard output"
+              << std::endl;
+    std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
+    std::cout << "\t-q, --quiet\t\tQuiet all debug output" << std::endl;
+    std::cout << "\t--verbose\t\tPrint verbose debug output" << std::endl;
+    std::cout << "The sample file contains a single measured kernel execution per line in the format:" << std::endl;
+    std::cout << "\t<cycles> <module-file> <kernel-name> [-l <local-sizes>] [-g <num-groups>] [args]" << std::endl;
+    std::cout << "\t<cycles>\t\tThe number of QPU cycles measured, e.g. the kernel execution time reported by clpeak "
+                 "multiplied by the QPU clock rate"
+              << std::endl;
+    std::cout << "\t<module-file>\t\tThe compiled module (in binary format) containing the kernel" << std::endl;
+    std::cout << "\t-l <local-sizes>\tUses the given local sizes in the format x y z (3 parameter)" << std::endl;
+    std::cout << "\t-g <num-groups>\t\tUses the given number of work-groups in the format x y z (3 parameter)"
+              << std::endl;
+    std::cout << "[args] specify the values for the input parameters and can take following values:" << std::endl;
+    std::cout << "\t-b <num>\t\tAllocate an empty buffer with <num> words of size" << std::endl;
+    std::cout << "\t<data>\t\t\tUse <data> as input word" << std::endl;
+    std::cout << "Empty lines and lines starting with '#' are skipped. The timing model written can be passed directly "
+                 "to the emulator, e.g. qpu_emulator --timing <output-file> ..."
+              << std::endl;
+}
+
+static bool readSample(const std::string& line, CalibrationSample& sample)
+{
+    std::istringstream ss(line);
+    std::string moduleFile;
+    if(!(ss >> sample.measuredCycles >> moduleFile >> sample.emulation.kernelName))
+        return false;
+    sample.emulation.module = std::make_pair(moduleFile, nullptr);
+    sample.emulation.workGroup.dimensions = 1;
+    sample.emulation.workGroup.globalOffsets = {0, 0, 0};
+    sample.emulation.workGroup.localSizes = {1, 1, 1};
+    sample.emulation.workGroup.numGroups = {1, 1, 1};
+
+    std::string arg;
+    while(ss >> arg)
+    {
+        if(arg == "-l" || arg == "-g")
+        {
+            auto& sizes = arg == "-l" ? sample.emulation.workGroup.localSizes : sample.emulation.workGroup.numGroups;
+            if(!(ss >> sizes[0] >> sizes[1] >> sizes[2]))
+                return false;
+            sample.emulation.workGroup.dimensions = 3;
+        }
+        else if(arg == "-b")
+        {
+            std::size_t numWords = 0;
+            if(!(ss >> numWords))
+                return false;
+            sample.emulation.parameter.emplace_back(0u, std::vector<tools::Word>(numWords, 0x0));
+        }
+        else
+            sample.emulation.parameter.emplace_back(
+                static_cast<tools::Word>(std::strtol(arg.data(), nullptr, 0)), Optional<std::vector<uint32_t>>{});
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    setLogger(std::wcout, true, LogLevel::WARNING);
+
+    if(argc == 1 || (argc == 2 && (std::string("-h") == argv[1] || std::string("--help") == argv[1])))
+    {
+        printHelp();
+        return 0;
+    }
+
+    CalibrationData data;
+    std::string outputFile;
+
+    for(int i = 1; i < argc - 1; ++i)
+    {
+        if(std::string("-h") == argv[i] || std::string("--help") == argv[i])
+        {
+            printHelp();
+            return 0;
+        }
+        else if(std::string("-t") == argv[i])
+        {
+            ++i;
+            data.maxTrials = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("-i") == argv[i])
+        {
+            ++i;
+            std::ifstream timingFile(argv[i]);
+            if(!timingFile)
+            {
+                std::cerr << "Failed to open timing model file: " << argv[i] << std::endl;
+                return 1;
+            }
+            data.baseModel = readTimingModel(timingFile);
+        }
+        else if(std::string("-o") == argv[i])
+        {
+            ++i;
+            outputFile = argv[i];
+        }
+        else if(std::string("-q") == argv[i] || std::string("--quiet") == argv[i])
+        {
+            setLogger(std::wcout, true, LogLevel::ERROR);
+        }
+        else if(std::string("--verbose") == argv[i])
+        {
+            setLogger(std::wcout, true, LogLevel::INFO);
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::ifstream input(argv[argc - 1]);
+    if(!input)
+    {
+        std::cerr << "Failed to open sample file: " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    std::string line;
+    while(std::getline(input, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        CalibrationSample sample;
+        if(!readSample(line, sample))
+        {
+            std::cerr << "Invalid sample: " << line << std::endl;
+            return 1;
+        }
+        data.samples.emplace_back(std::move(sample));
+    }
+
+    CalibrationResult result;
+    try
+    {
+        result = calibrateTimingModel(data);
+    }
+    catch(const CompilationError& e)
+    {
+        std::cerr << "Calibration failed: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::cerr << "Reduced mean relative error from " << result.baseError << " to " << result.error << " in "
+              << result.numTrials << " trials" << std::endl;
+    std::ofstream outputFileStream;
+    if(!outputFile.empty())
+        outputFileStream.open(outputFile);
+    std::ostream& output = outputFile.empty() ? std::cout : outputFileStream;
+    writeTimingModel(output, result.model);
+
+#ifdef DEBUG_MODE
+    vc4c::profiler::dumpProfileResults(true);
+#endif
+
+    return 0;
+}
@@ -163,6 +163,35 @@ static void printHelp()
                  "defaults to single execution"
               << std::endl;
     std::cout << "\t-i <dump-file>\t\tWrites the result of the instrumentation into the file specified" << std::endl;
+    std::cout << "\t-p <positions> <profile>\tAdds the number of executions of the basic blocks at the given "
+                 "positions (as written by the compiler with --profile-generate) to the execution profile specified"
+              << std::endl;
+    std::cout << "\t--hotspots <file>\tWrites the emulated cycles per basic block and loop into the file specified, "
+                 "in the folded stack format of flame graph tools"
+              << std::endl;
+    std::cout << "\t--memory-trace <file>\tWrites every TMU load and VPM access with the achieved bandwidth, the TMU "
+                 "utilization and the access patterns into the file specified"
+              << std::endl;
+    std::cout << "\t-j <threads>\t\tEmulates the QPUs on the given number of host threads, defaults to a single "
+                 "thread"
+              << std::endl;
+    std::cout << "\t-w <shards>\t\tSplits the work-groups into the given number of independently emulated shards, "
+                 "only valid for work-groups not communicating via global memory"
+              << std::endl;
+    std::cout << "\t--check-shards\t\tChecks the work-group shards for modifications of the same memory" << std::endl;
+    std::cout << "\t--qpus <number>\t\tThe number of QPUs available on the emulated hardware, defaults to " << NUM_QPUS
+              << std::endl;
+    std::cout << "\t--functional\t\tOnly emulates the functional behavior without the latencies of the periphery"
+              << std::endl;
+    std::cout << "\t--timing <file>\t\tUses the latencies and memory bandwidth of the timing model specified, e.g. as "
+                 "written by qpu_calibrate"
+              << std::endl;
+    std::cout << "\t--checkpoint <file> <cycles>\tWrites a checkpoint of the emulator state into the file specified "
+                 "every <cycles> cycles"
+              << std::endl;
+    std::cout << "\t--resume <file>\t\tResumes the emulation from the checkpoint specified, which needs to be written "
+                 "for the same kernel and arguments"
+              << std::endl;
     std::cout << "\t-o <number>\t\tSpecifies the given parameter index as output and prints it when finished"
               << std::endl;
     std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
@@ -247,6 +276,69 @@ int main(int argc, char** argv)
             ++i;
             data.instrumentationDump = argv[i];
         }
+        else if(std::string("-p") == argv[i])
+        {
+            ++i;
+            data.profileBlockPositions = argv[i];
+            ++i;
+            data.profileDump = argv[i];
+        }
+        else if(std::string("--hotspots") == argv[i])
+        {
+            ++i;
+            data.hotspotDump = argv[i];
+        }
+        else if(std::string("--memory-trace") == argv[i])
+        {
+            ++i;
+            data.memoryTraceDump = argv[i];
+        }
+        else if(std::string("-j") == argv[i])
+        {
+            ++i;
+            data.numThreads = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("-w") == argv[i])
+        {
+            ++i;
+            data.numWorkGroupShards = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("--check-shards") == argv[i])
+        {
+            data.checkWorkGroupShards = true;
+        }
+        else if(std::string("--qpus") == argv[i])
+        {
+            ++i;
+            data.numQPUs = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("--functional") == argv[i])
+        {
+            data.cycleAccurate = false;
+        }
+        else if(std::string("--timing") == argv[i])
+        {
+            ++i;
+            std::ifstream timingFile(argv[i]);
+            if(!timingFile)
+            {
+                std::cerr << "Failed to open timing model file: " << argv[i] << std::endl;
+                return 1;
+            }
+            data.timing = readTimingModel(timingFile);
+        }
+        else if(std::string("--checkpoint") == argv[i])
+        {
+            ++i;
+            data.checkpointFile = argv[i];
+            ++i;
+            data.checkpointInterval = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("--resume") == argv[i])
+        {
+            ++i;
+            data.resumeCheckpoint = argv[i];
+        }
         else if(std::string("-f") == argv[i])
         {
             ++i;
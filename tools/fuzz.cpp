@@ -0,0 +1,282 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "Profiler.h"
+#include "tools.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+/*
+ * Generates random valid kernels, compiles them without optimizations and with the candidate configuration, emulates
+ * both and reports (and bisects) all kernels producing different results.
+ *
+ * The generated kernels only use unsigned integer arithmetic (with guarded divisions and shifts) to not depend on
+ * undefined or implementation-defined behavior, which could legitimately differ between the two configurations.
+ */
+
+// the number of work-items executed, also the size of the input and output buffers
+static constexpr unsigned NUM_ITEMS = 16;
+static constexpr unsigned LOCAL_SIZE = 8;
+
+class KernelGenerator
+{
+public:
+    explicit KernelGenerator(std::mt19937& rng) : rng(rng) {}
+
+    std::string generate()
+    {
+        readableVariables.clear();
+        numVariables = random(2, 6);
+        std::stringstream ss;
+        ss << "__kernel void fuzz(__global uint* output, __global const uint* input)\n{\n";
+        ss << "    const uint gid = get_global_id(0);\n";
+        for(unsigned i = 0; i < numVariables; ++i)
+        {
+            ss << "    uint v" << i << " = input[(gid + " << random(0, NUM_ITEMS - 1) << "u) % " << NUM_ITEMS
+               << "u];\n";
+            readableVariables.emplace_back("v" + std::to_string(i));
+        }
+        readableVariables.emplace_back("gid");
+        auto numStatements = random(1, 8);
+        for(unsigned i = 0; i < numStatements; ++i)
+            ss << statement(1, 0);
+        ss << "    output[gid] = v0";
+        for(unsigned i = 1; i < numVariables; ++i)
+            ss << " ^ v" << i;
+        ss << ";\n}\n";
+        return ss.str();
+    }
+
+private:
+    std::mt19937& rng;
+    unsigned numVariables = 0;
+    std::vector<std::string> readableVariables;
+
+    unsigned random(unsigned min, unsigned max)
+    {
+        return std::uniform_int_distribution<unsigned>(min, max)(rng);
+    }
+
+    std::string constant()
+    {
+        static const std::vector<std::string> specialValues = {"0u", "1u", "2u", "31u", "0x7FFFFFFFu", "0xFFFFFFFFu"};
+        if(random(0, 3) == 0)
+            return specialValues[random(0, static_cast<unsigned>(specialValues.size() - 1))];
+        return std::to_string(random(0, 1000)) + "u";
+    }
+
+    std::string variable()
+    {
+        return readableVariables[random(0, static_cast<unsigned>(readableVariables.size() - 1))];
+    }
+
+    std::string expression(unsigned depth)
+    {
+        if(depth >= 4 || random(0, 3) == 0)
+        {
+            switch(random(0, 2))
+            {
+            case 0:
+                return constant();
+            case 1:
+                return "input[" + variable() + " % " + std::to_string(NUM_ITEMS) + "u]";
+            default:
+                return variable();
+            }
+        }
+        auto left = expression(depth + 1);
+        auto right = expression(depth + 1);
+        static const std::vector<std::string> binaryOperators = {"+", "-", "*", "&", "|", "^"};
+        static const std::vector<std::string> comparisons = {"<", "<=", ">", ">=", "==", "!="};
+        static const std::vector<std::string> binaryFunctions = {
+            "min", "max", "rotate", "mul_hi", "hadd", "rhadd", "abs_diff", "add_sat", "sub_sat"};
+        static const std::vector<std::string> unaryFunctions = {"clz", "popcount"};
+        switch(random(0, 6))
+        {
+        case 0:
+        case 1:
+            return "(" + left + " " + binaryOperators[random(0, 5)] + " " + right + ")";
+        case 2:
+            // shifts by the type width or more are undefined
+            return "(" + left + (random(0, 1) ? " << " : " >> ") + "(" + right + " & 31u))";
+        case 3:
+            // divisions by zero are undefined
+            return "(" + left + (random(0, 1) ? " / " : " % ") + "(" + right + " | 1u))";
+        case 4:
+            return "(" + left + " " + comparisons[random(0, 5)] + " " + right + " ? " + expression(depth + 1) +
+                " : " + expression(depth + 1) + ")";
+        case 5:
+            return binaryFunctions[random(0, static_cast<unsigned>(binaryFunctions.size() - 1))] + "(" + left + ", " +
+                right + ")";
+        default:
+            return unaryFunctions[random(0, 1)] + "(" + left + ")";
+        }
+    }
+
+    std::string statement(unsigned indentation, unsigned depth)
+    {
+        std::string indent(4 * indentation, ' ');
+        auto variable = "v" + std::to_string(random(0, numVariables - 1));
+        if(depth < 2 && random(0, 4) == 0)
+        {
+            // loop with a constant number of iterations
+            auto counter = "i" + std::to_string(depth);
+            std::string s = indent + "for(uint " + counter + " = 0; " + counter + " < " +
+                std::to_string(random(1, 8)) + "u; ++" + counter + ")\n" + indent + "{\n";
+            readableVariables.emplace_back(counter);
+            auto numStatements = random(1, 3);
+            for(unsigned i = 0; i < numStatements; ++i)
+                s += statement(indentation + 1, depth + 1);
+            readableVariables.pop_back();
+            return s + indent + "}\n";
+        }
+        if(depth < 2 && random(0, 4) == 0)
+        {
+            std::string s = indent + "if(" + expression(2) + " > " + constant() + ")\n" + indent + "{\n" +
+                statement(indentation + 1, depth + 1) + indent + "}\n";
+            if(random(0, 1))
+                s += indent + "else\n" + indent + "{\n" + statement(indentation + 1, depth + 1) + indent + "}\n";
+            return s;
+        }
+        static const std::vector<std::string> assignments = {"=", "+=", "-=", "*=", "^=", "|=", "&="};
+        return indent + variable + " " + assignments[random(0, 6)] + " " + expression(0) + ";\n";
+    }
+};
+
+static void printHelp()
+{
+    std::cout << "Usage: fuzz [-n <iterations>] [-s <seed>] [-o <output-directory>] [options]" << std::endl;
+    std::cout << "Generates random kernels and checks the results of the kernels compiled with the given "
+                 "configuration against the results of the kernels compiled with all optimizations disabled"
+              << std::endl;
+    std::cout << "\t-n <iterations>\t\tThe number of kernels to generate and check, defaults to 100" << std::endl;
+    std::cout << "\t-s <seed>\t\tThe seed for the random generator, defaults to a random seed" << std::endl;
+    std::cout << "\t-o <output-directory>\tWrites the source code of all miscompiled kernels into the directory "
+                 "specified, defaults to the current directory"
+              << std::endl;
+    std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
+    std::cout << "\t-q, --quiet\t\tQuiet all debug output" << std::endl;
+    std::cout << "\t--verbose\t\tPrint verbose debug output" << std::endl;
+    std::cout << "[options] determine the candidate configuration and accept any compiler option (see vc4c --help), "
+                 "all other options are passed to the pre-compiler"
+              << std::endl;
+    std::cout << "Returns 3 if any generated kernel was miscompiled. The optimization pass causing the miscompilation "
+                 "is bisected automatically."
+              << std::endl;
+}
+
+static void writeReproducer(const std::string& fileName, const DifferentialData& data, const DifferentialResult& result)
+{
+    std::ofstream out(fileName);
+    out << "// " << result.error << std::endl;
+    out << "// failing pass: " << (result.failingPass.empty() ? "(none)" : result.failingPass) << std::endl;
+    out << "// options:";
+    for(const auto& param : result.parameters)
+        out << ' ' << param;
+    out << ' ' << data.compilerOptions << std::endl;
+    out << "// local size: " << LOCAL_SIZE << ", number of work-groups: " << (NUM_ITEMS / LOCAL_SIZE) << std::endl;
+    out << "// input:";
+    for(auto word : data.emulation.parameter.back().second.value())
+        out << ' ' << word;
+    out << std::endl << std::endl;
+    out << data.source;
+}
+
+int main(int argc, char** argv)
+{
+    setLogger(std::wcout, true, LogLevel::WARNING);
+
+    DifferentialData data;
+    data.emulation.kernelName = "fuzz";
+    data.emulation.workGroup.dimensions = 1;
+    data.emulation.workGroup.globalOffsets = {0, 0, 0};
+    data.emulation.workGroup.localSizes = {LOCAL_SIZE, 1, 1};
+    data.emulation.workGroup.numGroups = {NUM_ITEMS / LOCAL_SIZE, 1, 1};
+    // the generated loops are bounded, so any kernel running longer than this is miscompiled
+    data.emulation.maxEmulationCycles = 1u << 22u;
+
+    unsigned numIterations = 100;
+    unsigned seed = std::random_device{}();
+    std::string outputDirectory = ".";
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::string("-h") == argv[i] || std::string("--help") == argv[i])
+        {
+            printHelp();
+            return 0;
+        }
+        else if(std::string("-n") == argv[i] && i + 1 < argc)
+            numIterations = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 0));
+        else if(std::string("-s") == argv[i] && i + 1 < argc)
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 0));
+        else if(std::string("-o") == argv[i] && i + 1 < argc)
+            outputDirectory = argv[++i];
+        else if(std::string("-q") == argv[i] || std::string("--quiet") == argv[i])
+            setLogger(std::wcout, true, LogLevel::ERROR);
+        else if(std::string("--verbose") == argv[i])
+            setLogger(std::wcout, true, LogLevel::INFO);
+        else if(!tools::parseConfigurationParameter(data.config, argv[i]))
+            data.compilerOptions.append(argv[i]).append(" ");
+    }
+
+    std::cerr << "Fuzzing " << numIterations << " kernels with seed " << seed << std::endl;
+    std::mt19937 rng(seed);
+    KernelGenerator generator(rng);
+    unsigned numMiscompiled = 0;
+    unsigned numSkipped = 0;
+    for(unsigned iteration = 0; iteration < numIterations; ++iteration)
+    {
+        data.source = generator.generate();
+        std::vector<uint32_t> input(NUM_ITEMS);
+        for(auto& word : input)
+            word = static_cast<uint32_t>(rng());
+        data.emulation.parameter.clear();
+        data.emulation.parameter.emplace_back(0u, std::vector<uint32_t>(NUM_ITEMS, 0x0));
+        data.emulation.parameter.emplace_back(0u, std::move(input));
+
+        DifferentialResult result;
+        try
+        {
+            result = checkOptimizations(data);
+        }
+        catch(const CompilationError& e)
+        {
+            // the reference configuration failed, e.g. for unsupported features, so there is nothing to compare with
+            std::cerr << "Skipping kernel " << iteration << ": " << e.what() << std::endl;
+            ++numSkipped;
+            continue;
+        }
+        if(!result.isMiscompiled)
+            continue;
+        ++numMiscompiled;
+        auto fileName = outputDirectory + "/fuzz_" + std::to_string(seed) + "_" + std::to_string(iteration) + ".cl";
+        writeReproducer(fileName, data, result);
+        std::cerr << "Kernel " << iteration << " is miscompiled"
+                  << (result.failingPass.empty() ? "" : " by optimization pass '" + result.failingPass + "'") << ": "
+                  << result.error << ", written to " << fileName << std::endl;
+    }
+
+    std::cerr << "Checked " << (numIterations - numSkipped) << " kernels, skipped " << numSkipped
+              << ", found " << numMiscompiled << " miscompilations" << std::endl;
+
+#ifdef DEBUG_MODE
+    vc4c::profiler::dumpProfileResults(true);
+#endif
+
+    return numMiscompiled == 0 ? 0 : 3;
+}
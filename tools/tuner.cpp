@@ -0,0 +1,366 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "tools/Emulator.h"
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "Profiler.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+template <typename T>
+static std::vector<tools::Word> readDirectBuffer(const std::string& data)
+{
+    std::vector<tools::Word> words;
+    std::stringstream ss(data);
+    T t = 0;
+    while(ss >> t)
+        words.emplace_back(bit_cast<T, uint32_t>(t));
+    return words;
+}
+
+static std::vector<std::string> readLines(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    std::vector<std::string> lines;
+    std::string line;
+    while(std::getline(in, line))
+        lines.emplace_back(std::move(line));
+    return lines;
+}
+
+// the maximum size of the table of the longest common subsequence calculated to diff the intermediate code
+static constexpr std::size_t MAX_DIFF_TABLE_SIZE = 1u << 24u;
+
+/*
+ * Prints the lines removed (prefixed with '-') and added (prefixed with '+') between the two files
+ */
+static void printDiff(std::ostream& out, const std::string& oldFile, const std::string& newFile)
+{
+    const auto oldLines = readLines(oldFile);
+    const auto newLines = readLines(newFile);
+    // the passes usually only change small parts of the code, so the common start and end are skipped
+    std::size_t start = 0;
+    while(start < oldLines.size() && start < newLines.size() && oldLines[start] == newLines[start])
+        ++start;
+    std::size_t oldEnd = oldLines.size();
+    std::size_t newEnd = newLines.size();
+    while(oldEnd > start && newEnd > start && oldLines[oldEnd - 1] == newLines[newEnd - 1])
+    {
+        --oldEnd;
+        --newEnd;
+    }
+
+    out << "--- " << oldFile << std::endl << "+++ " << newFile << std::endl;
+    if(start == oldEnd && start == newEnd)
+        return;
+    out << "@@ line " << (start + 1) << " @@" << std::endl;
+    const std::size_t numOld = oldEnd - start;
+    const std::size_t numNew = newEnd - start;
+    if((numOld + 1) * (numNew + 1) > MAX_DIFF_TABLE_SIZE)
+    {
+        // too large to diff, print the whole changed range
+        for(auto i = start; i < oldEnd; ++i)
+            out << '-' << oldLines[i] << std::endl;
+        for(auto i = start; i < newEnd; ++i)
+            out << '+' << newLines[i] << std::endl;
+        return;
+    }
+    // lengths of the longest common subsequences of the remaining old and new lines
+    std::vector<uint32_t> table((numOld + 1) * (numNew + 1), 0);
+    auto length = [&](std::size_t i, std::size_t k) -> uint32_t& { return table[i * (numNew + 1) + k]; };
+    for(auto i = numOld; i-- > 0;)
+    {
+        for(auto k = numNew; k-- > 0;)
+            length(i, k) = oldLines[start + i] == newLines[start + k] ? length(i + 1, k + 1) + 1 :
+                                                                        std::max(length(i + 1, k), length(i, k + 1));
+    }
+    std::size_t i = 0;
+    std::size_t k = 0;
+    while(i < numOld || k < numNew)
+    {
+        if(i < numOld && k < numNew && oldLines[start + i] == newLines[start + k])
+        {
+            ++i;
+            ++k;
+        }
+        else if(k < numNew && (i == numOld || length(i, k + 1) >= length(i + 1, k)))
+            out << '+' << newLines[start + k++] << std::endl;
+        else
+            out << '-' << oldLines[start + i++] << std::endl;
+    }
+}
+
+static void printPassProfile(std::ostream& out, const PassProfileResult& result, bool printDiffs)
+{
+    out << std::left << std::setw(6) << "passes" << std::setw(36) << "last pass" << std::setw(14) << "instructions"
+        << std::setw(18) << "estimated cycles"
+        << "emulated cycles" << std::endl;
+    for(std::size_t i = 0; i < result.steps.size(); ++i)
+    {
+        const auto& step = result.steps[i];
+        out << std::left << std::setw(6) << step.numPasses << std::setw(36) << (step.pass.empty() ? "-" : step.pass)
+            << std::setw(14) << step.numInstructions << std::setw(18) << step.estimatedCycles << step.numCycles
+            << std::endl;
+        if(printDiffs && i > 0)
+            printDiff(out, result.steps[i - 1].intermediateFile, step.intermediateFile);
+    }
+    if(result.slowdownPass.empty())
+        out << "No optimization pass slows down the kernel" << std::endl;
+    else
+        out << "Slowdown introduced by optimization pass: " << result.slowdownPass << std::endl;
+}
+
+static void printHelp()
+{
+    std::cout << "Usage: tuner [-k <kernel-name>] [-l <local-sizes>] [-g <global-sizes>] [-t <trials>] "
+                 "[-o <output-file>] [options] [args] input-file"
+              << std::endl;
+    std::cout << "       tuner --profile-passes [--bisect [<reference-cycles>]] [--threshold <relative>] "
+                 "[--dump-ir <directory>] [--diff] [-k <kernel-name>] [...] [options] [args] input-file"
+              << std::endl;
+    std::cout << "Searches the optimization settings executing the kernel with the given inputs in the lowest number "
+                 "of emulated cycles"
+              << std::endl;
+    std::cout << "\t-k <kernel-name>\tSpecifies the kernel to run, defaults to the first/only kernel in the module"
+              << std::endl;
+    std::cout << "\t-l <local-sizes>\tUses the given local sizes in the format x y z (3 parameter), defaults to single "
+                 "execution"
+              << std::endl;
+    std::cout << "\t-g <num-groups>\t\tUses the given number of work-groups in the format x y z (3 parameter), "
+                 "defaults to single execution"
+              << std::endl;
+    std::cout << "\t-t <trials>\t\tThe maximum number of configurations to compile and emulate, defaults to 64"
+              << std::endl;
+    std::cout << "\t-o <output-file>\tWrites the compiler options of the best configuration found into the file "
+                 "specified instead of the standard output"
+              << std::endl;
+    std::cout << "\t--profile-passes\tInstead of tuning, enables the optimization passes of the configuration one "
+                 "after the other and reports the instructions, the estimated and the emulated cycles after every pass"
+              << std::endl;
+    std::cout << "\t--bisect [<cycles>]\tOnly bisects the first pass making the kernel slower than the reference "
+                 "cycles given, defaults to the cycles without any optimization passes"
+              << std::endl;
+    std::cout << "\t--threshold <relative>\tThe relative increase of cycles tolerated before counting as slowdown, "
+                 "e.g. 0.05 for 5%, defaults to 0"
+              << std::endl;
+    std::cout << "\t--dump-ir <directory>\tWrites the intermediate code after every profiled pass into the directory "
+                 "specified"
+              << std::endl;
+    std::cout << "\t--diff\t\t\tPrints the changes of the intermediate code made by every profiled pass, requires "
+                 "--dump-ir"
+              << std::endl;
+    std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
+    std::cout << "\t-q, --quiet\t\tQuiet all debug output" << std::endl;
+    std::cout << "\t--verbose\t\tPrint verbose debug output" << std::endl;
+    std::cout << "[options] are used as base configuration and accept any compiler option (see vc4c --help), all "
+                 "other options are passed to the pre-compiler"
+              << std::endl;
+    std::cout << "[args] specify the values for the input parameters and can take following values:" << std::endl;
+    std::cout << "\t-b <num>\t\tAllocate an empty buffer with <num> words of size" << std::endl;
+    std::cout << "\t-ib <values>\t\tAllocate a buffer containing the given values. The values are passed "
+                 "space-separated inside a string (double-quotes, e.g. \"0 1 2 3 ...\")"
+              << std::endl;
+    std::cout << "\t-fb <values>\t\tAllocate a buffer containing the given values. The values are passed "
+                 "space-separated inside a string (double-quotes, e.g. \"0.0 1.0 2.0 3.0 ...\")"
+              << std::endl;
+    std::cout << "\t<data>\t\t\tUse <data> as input word" << std::endl;
+    std::cout << "The options written can be passed directly to the compiler, e.g. vc4c $(cat <output-file>) ..."
+              << std::endl;
+    std::cout << "When profiling the optimization passes, returns 3 if a pass slowing down the kernel was found"
+              << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    setLogger(std::wcout, true, LogLevel::WARNING);
+
+    if(argc == 1 || (argc == 2 && (std::string("-h") == argv[1] || std::string("--help") == argv[1])))
+    {
+        printHelp();
+        return 0;
+    }
+
+    TuningData data;
+    data.emulation.workGroup.dimensions = 1;
+    data.emulation.workGroup.globalOffsets = {0, 0, 0};
+    data.emulation.workGroup.localSizes = {1, 1, 1};
+    data.emulation.workGroup.numGroups = {1, 1, 1};
+
+    std::string outputFile;
+    bool profileMode = false;
+    bool printDiffs = false;
+    PassProfileData profileData;
+
+    for(int i = 1; i < argc - 1; ++i)
+    {
+        if(std::string("-h") == argv[i] || std::string("--help") == argv[i])
+        {
+            printHelp();
+            return 0;
+        }
+        else if(std::string("-l") == argv[i])
+        {
+            for(std::size_t dim = 0; dim < 3; ++dim)
+                data.emulation.workGroup.localSizes.at(dim) =
+                    static_cast<tools::Word>(std::strtol(argv[++i], nullptr, 0));
+            data.emulation.workGroup.dimensions = 3;
+        }
+        else if(std::string("-g") == argv[i])
+        {
+            for(std::size_t dim = 0; dim < 3; ++dim)
+                data.emulation.workGroup.numGroups.at(dim) =
+                    static_cast<tools::Word>(std::strtol(argv[++i], nullptr, 0));
+            data.emulation.workGroup.dimensions = 3;
+        }
+        else if(std::string("-k") == argv[i])
+        {
+            ++i;
+            data.emulation.kernelName = argv[i];
+        }
+        else if(std::string("-t") == argv[i])
+        {
+            ++i;
+            data.maxTrials = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("-o") == argv[i])
+        {
+            ++i;
+            outputFile = argv[i];
+        }
+        else if(std::string("-b") == argv[i])
+        {
+            ++i;
+            data.emulation.parameter.emplace_back(
+                0u, std::vector<tools::Word>(static_cast<std::size_t>(std::strtol(argv[i], nullptr, 0)), 0x0));
+        }
+        else if(std::string("-ib") == argv[i])
+        {
+            ++i;
+            data.emulation.parameter.emplace_back(0u, readDirectBuffer<int>(argv[i]));
+        }
+        else if(std::string("-fb") == argv[i])
+        {
+            ++i;
+            data.emulation.parameter.emplace_back(0u, readDirectBuffer<float>(argv[i]));
+        }
+        else if(std::string("--profile-passes") == argv[i])
+        {
+            profileMode = true;
+        }
+        else if(std::string("--bisect") == argv[i])
+        {
+            profileData.bisect = true;
+            if(i + 2 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                profileData.referenceCycles = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+        }
+        else if(std::string("--threshold") == argv[i])
+        {
+            ++i;
+            profileData.slowdownThreshold = std::strtod(argv[i], nullptr);
+        }
+        else if(std::string("--dump-ir") == argv[i])
+        {
+            ++i;
+            profileData.intermediateDirectory = argv[i];
+        }
+        else if(std::string("--diff") == argv[i])
+        {
+            printDiffs = true;
+        }
+        else if(std::string("-q") == argv[i] || std::string("--quiet") == argv[i])
+        {
+            setLogger(std::wcout, true, LogLevel::ERROR);
+        }
+        else if(std::string("--verbose") == argv[i])
+        {
+            setLogger(std::wcout, true, LogLevel::INFO);
+        }
+        else if(argv[i][0] == '-')
+        {
+            if(!tools::parseConfigurationParameter(data.baseConfig, argv[i]))
+                data.compilerOptions.append(argv[i]).append(" ");
+        }
+        else
+            data.emulation.parameter.emplace_back(
+                static_cast<tools::Word>(std::strtol(argv[i], nullptr, 0)), Optional<std::vector<uint32_t>>{});
+    }
+
+    std::ifstream input(argv[argc - 1]);
+    if(!input)
+    {
+        std::cerr << "Failed to open input file: " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    data.source.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+
+    std::ofstream outputFileStream;
+    if(!outputFile.empty())
+        outputFileStream.open(outputFile);
+    std::ostream& output = outputFile.empty() ? std::cout : outputFileStream;
+
+    if(profileMode)
+    {
+        if(printDiffs && profileData.intermediateDirectory.empty())
+        {
+            std::cerr << "Printing the changes of the intermediate code requires --dump-ir" << std::endl;
+            return 1;
+        }
+        profileData.source = std::move(data.source);
+        profileData.compilerOptions = std::move(data.compilerOptions);
+        profileData.config = data.baseConfig;
+        profileData.emulation = std::move(data.emulation);
+        PassProfileResult profile;
+        try
+        {
+            profile = profilePasses(profileData);
+        }
+        catch(const CompilationError& e)
+        {
+            std::cerr << "Profiling the optimization passes failed: " << e.what() << std::endl;
+            return 2;
+        }
+        std::cerr << "Profiled optimization passes in " << profile.numTrials << " trials" << std::endl;
+        printPassProfile(output, profile, printDiffs);
+        return profile.slowdownPass.empty() ? 0 : 3;
+    }
+
+    TuningResult result;
+    try
+    {
+        result = tuneConfiguration(data);
+    }
+    catch(const CompilationError& e)
+    {
+        std::cerr << "Tuning failed: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::cerr << "Reduced emulated cycles from " << result.baseCycles << " to " << result.numCycles << " in "
+              << result.numTrials << " trials" << std::endl;
+    for(const auto& param : result.parameters)
+        output << param << ' ';
+    output << std::endl;
+
+#ifdef DEBUG_MODE
+    vc4c::profiler::dumpProfileResults(true);
+#endif
+
+    return 0;
+}